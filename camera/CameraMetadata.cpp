@@ -32,28 +32,47 @@ namespace android {
 typedef Parcel::WritableBlob WritableBlob;
 typedef Parcel::ReadableBlob ReadableBlob;
 
+static std::atomic<uint64_t> sBuffersAllocated(0);
+static std::atomic<uint64_t> sBuffersShared(0);
+
+static camera_metadata_t *countAllocation(camera_metadata_t *buffer) {
+    if (buffer != NULL) {
+        sBuffersAllocated.fetch_add(1, std::memory_order_relaxed);
+    }
+    return buffer;
+}
+
 CameraMetadata::CameraMetadata() :
-        mBuffer(NULL), mLocked(false) {
+        mBuffer(NULL), mLocked(false), mShareCount(NULL) {
 }
 
 CameraMetadata::CameraMetadata(size_t entryCapacity, size_t dataCapacity) :
-        mLocked(false)
+        mBuffer(NULL), mLocked(false), mShareCount(NULL)
 {
-    mBuffer = allocate_camera_metadata(entryCapacity, dataCapacity);
+    adopt(countAllocation(allocate_camera_metadata(entryCapacity, dataCapacity)));
 }
 
 CameraMetadata::CameraMetadata(const CameraMetadata &other) :
-        mLocked(false) {
-    mBuffer = clone_camera_metadata(other.mBuffer);
+        mBuffer(NULL), mLocked(false), mShareCount(NULL) {
+    share(other);
 }
 
 CameraMetadata::CameraMetadata(camera_metadata_t *buffer) :
-        mBuffer(NULL), mLocked(false) {
+        mBuffer(NULL), mLocked(false), mShareCount(NULL) {
     acquire(buffer);
 }
 
 CameraMetadata &CameraMetadata::operator=(const CameraMetadata &other) {
-    return operator=(other.mBuffer);
+    if (mLocked) {
+        ALOGE("%s: Assignment to a locked CameraMetadata!", __FUNCTION__);
+        return *this;
+    }
+
+    if (CC_LIKELY(other.mBuffer != mBuffer)) {
+        drop();
+        share(other);
+    }
+    return *this;
 }
 
 CameraMetadata &CameraMetadata::operator=(const camera_metadata_t *buffer) {
@@ -63,13 +82,56 @@ CameraMetadata &CameraMetadata::operator=(const camera_metadata_t *buffer) {
     }
 
     if (CC_LIKELY(buffer != mBuffer)) {
-        camera_metadata_t *newBuffer = clone_camera_metadata(buffer);
+        camera_metadata_t *newBuffer =
+                countAllocation(clone_camera_metadata(buffer));
         clear();
-        mBuffer = newBuffer;
+        adopt(newBuffer);
     }
     return *this;
 }
 
+void CameraMetadata::adopt(camera_metadata_t *buffer) {
+    mBuffer = buffer;
+    mShareCount = (buffer == NULL) ? NULL : new std::atomic<int32_t>(1);
+}
+
+void CameraMetadata::share(const CameraMetadata &other) {
+    if (other.mBuffer != NULL) {
+        other.mShareCount->fetch_add(1, std::memory_order_relaxed);
+        sBuffersShared.fetch_add(1, std::memory_order_relaxed);
+    }
+    mBuffer = other.mBuffer;
+    mShareCount = other.mShareCount;
+}
+
+void CameraMetadata::drop() {
+    if (mBuffer == NULL) {
+        return;
+    }
+    if (mShareCount->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        free_camera_metadata(mBuffer);
+        delete mShareCount;
+    }
+    mBuffer = NULL;
+    mShareCount = NULL;
+}
+
+status_t CameraMetadata::unshare() {
+    if (mBuffer == NULL ||
+            mShareCount->load(std::memory_order_acquire) == 1) {
+        return OK;
+    }
+    camera_metadata_t *newBuffer =
+            countAllocation(clone_camera_metadata(mBuffer));
+    if (newBuffer == NULL) {
+        ALOGE("%s: Can't clone shared metadata buffer", __FUNCTION__);
+        return NO_MEMORY;
+    }
+    drop();
+    adopt(newBuffer);
+    return OK;
+}
+
 CameraMetadata::~CameraMetadata() {
     mLocked = false;
     clear();
@@ -94,13 +156,31 @@ status_t CameraMetadata::unlock(const camera_metadata_t *buffer) const {
     return OK;
 }
 
+status_t CameraMetadata::setVendorId(metadata_vendor_id_t vendorId) {
+    status_t res;
+    if (mLocked) {
+        ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
+        return INVALID_OPERATION;
+    }
+    if ((res = unshare()) != OK) {
+        return res;
+    }
+    set_camera_metadata_vendor_id(mBuffer, vendorId);
+    return OK;
+}
+
 camera_metadata_t* CameraMetadata::release() {
     if (mLocked) {
         ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
         return NULL;
     }
+    if (unshare() != OK) {
+        return NULL;
+    }
     camera_metadata_t *released = mBuffer;
+    delete mShareCount;
     mBuffer = NULL;
+    mShareCount = NULL;
     return released;
 }
 
@@ -109,10 +189,7 @@ void CameraMetadata::clear() {
         ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
         return;
     }
-    if (mBuffer) {
-        free_camera_metadata(mBuffer);
-        mBuffer = NULL;
-    }
+    drop();
 }
 
 void CameraMetadata::acquire(camera_metadata_t *buffer) {
@@ -121,7 +198,7 @@ void CameraMetadata::acquire(camera_metadata_t *buffer) {
         return;
     }
     clear();
-    mBuffer = buffer;
+    adopt(buffer);
 
     ALOGE_IF(validate_camera_metadata_structure(mBuffer, /*size*/NULL) != OK,
              "%s: Failed to validate metadata structure %p",
@@ -166,6 +243,10 @@ status_t CameraMetadata::sort() {
         ALOGE("%s: CameraMetadata is locked", __FUNCTION__);
         return INVALID_OPERATION;
     }
+    status_t res = unshare();
+    if (res != OK) {
+        return res;
+    }
     return sort_camera_metadata(mBuffer);
 }
 
@@ -361,6 +442,12 @@ camera_metadata_entry_t CameraMetadata::find(uint32_t tag) {
         entry.count = 0;
         return entry;
     }
+    // The caller may modify the entry in place
+    if (unshare() != OK) {
+        entry.count = 0;
+        entry.data.u8 = NULL;
+        return entry;
+    }
     res = find_camera_metadata_entry(mBuffer, tag, &entry);
     if (CC_UNLIKELY( res != OK )) {
         entry.count = 0;
@@ -398,6 +485,10 @@ status_t CameraMetadata::erase(uint32_t tag) {
                 tag, strerror(-res), res);
         return res;
     }
+    // Entry indices are the same in a clone
+    if ((res = unshare()) != OK) {
+        return res;
+    }
     res = delete_camera_metadata_entry(mBuffer, entry.index);
     if (res != OK) {
         ALOGE("%s: Error deleting entry %s.%s (%x): %s %d",
@@ -415,7 +506,8 @@ void CameraMetadata::dump(int fd, int verbosity, int indentation) const {
 
 status_t CameraMetadata::resizeIfNeeded(size_t extraEntries, size_t extraData) {
     if (mBuffer == NULL) {
-        mBuffer = allocate_camera_metadata(extraEntries * 2, extraData * 2);
+        adopt(countAllocation(
+                allocate_camera_metadata(extraEntries * 2, extraData * 2)));
         if (mBuffer == NULL) {
             ALOGE("%s: Can't allocate larger metadata buffer", __FUNCTION__);
             return NO_MEMORY;
@@ -437,15 +529,18 @@ status_t CameraMetadata::resizeIfNeeded(size_t extraEntries, size_t extraData) {
 
         if (newEntryCount > currentEntryCap ||
                 newDataCount > currentDataCap) {
-            camera_metadata_t *oldBuffer = mBuffer;
-            mBuffer = allocate_camera_metadata(newEntryCount,
-                    newDataCount);
-            if (mBuffer == NULL) {
+            camera_metadata_t *newBuffer = countAllocation(
+                    allocate_camera_metadata(newEntryCount, newDataCount));
+            if (newBuffer == NULL) {
                 ALOGE("%s: Can't allocate larger metadata buffer", __FUNCTION__);
                 return NO_MEMORY;
             }
-            append_camera_metadata(mBuffer, oldBuffer);
-            free_camera_metadata(oldBuffer);
+            append_camera_metadata(newBuffer, mBuffer);
+            drop();
+            adopt(newBuffer);
+        } else {
+            // Big enough already, update in place once we own the buffer
+            return unshare();
         }
     }
     return OK;
@@ -521,7 +616,8 @@ status_t CameraMetadata::readFromParcel(const Parcel& data,
                        reinterpret_cast<const camera_metadata_t*>(metadataStart);
         ALOGV("%s: alignment is: %zu, metadata start: %p, offset: %zu",
                 __FUNCTION__, alignment, tmp, offset);
-        metadata = allocate_copy_camera_metadata_checked(tmp, metadataSize);
+        metadata = countAllocation(
+                allocate_copy_camera_metadata_checked(tmp, metadataSize));
         if (metadata == NULL) {
             // We consider that allocation only fails if the validation
             // also failed, therefore the readFromParcel was a failure.
@@ -664,7 +760,7 @@ status_t CameraMetadata::readFromParcel(const Parcel *parcel) {
     }
 
     clear();
-    mBuffer = buffer;
+    adopt(buffer);
 
     return OK;
 }
@@ -692,9 +788,18 @@ void CameraMetadata::swap(CameraMetadata& other) {
 
     camera_metadata* thisBuf = mBuffer;
     camera_metadata* otherBuf = other.mBuffer;
+    std::atomic<int32_t> *thisCount = mShareCount;
+    std::atomic<int32_t> *otherCount = other.mShareCount;
 
     other.mBuffer = thisBuf;
+    other.mShareCount = thisCount;
     mBuffer = otherBuf;
+    mShareCount = otherCount;
+}
+
+void CameraMetadata::getBufferStats(uint64_t *allocated, uint64_t *shared) {
+    *allocated = sBuffersAllocated.load(std::memory_order_relaxed);
+    *shared = sBuffersShared.load(std::memory_order_relaxed);
 }
 
 status_t CameraMetadata::getTagFromName(const char *name,
@@ -106,6 +106,24 @@ void VendorTagDescriptor::copyFrom(const VendorTagDescriptor& src) {
     mSections = src.mSections;
     mTagCount = src.mTagCount;
     mVendorOps = src.mVendorOps;
+    buildTagInfoIndex();
+}
+
+void VendorTagDescriptor::buildTagInfoIndex() {
+    mTagInfo.clear();
+    size_t size = mTagToNameMap.size();
+    mTagInfo.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        uint32_t tag = mTagToNameMap.keyAt(i);
+        ssize_t sectionIndex = mTagToSectionMap.indexOfKey(tag);
+        ssize_t typeIndex = mTagToTypeMap.indexOfKey(tag);
+        TagInfo info;
+        info.name = mTagToNameMap.valueAt(i).string();
+        info.section = (sectionIndex < 0) ? VENDOR_SECTION_NAME_ERR :
+                mSections[mTagToSectionMap.valueAt(sectionIndex)].string();
+        info.type = (typeIndex < 0) ? VENDOR_TAG_TYPE_ERR : mTagToTypeMap.valueAt(typeIndex);
+        mTagInfo.emplace(tag, info);
+    }
 }
 
 status_t VendorTagDescriptor::readFromParcel(const android::Parcel* parcel) {
@@ -121,6 +139,8 @@ status_t VendorTagDescriptor::readFromParcel(const android::Parcel* parcel) {
         return res;
     }
 
+    mTagInfo.clear();
+
     if (tagCount < 0 || tagCount > INT32_MAX) {
         ALOGE("%s: tag count %d from vendor ops is invalid.", __FUNCTION__, tagCount);
         return BAD_VALUE;
@@ -214,6 +234,7 @@ status_t VendorTagDescriptor::readFromParcel(const android::Parcel* parcel) {
         mReverseMapping[reverseIndex]->add(mTagToNameMap.valueFor(tag), tag);
     }
 
+    buildTagInfoIndex();
     return res;
 }
 
@@ -233,27 +254,27 @@ void VendorTagDescriptor::getTagArray(uint32_t* tagArray) const {
 }
 
 const char* VendorTagDescriptor::getSectionName(uint32_t tag) const {
-    ssize_t index = mTagToSectionMap.indexOfKey(tag);
-    if (index < 0) {
+    auto it = mTagInfo.find(tag);
+    if (it == mTagInfo.end()) {
         return VENDOR_SECTION_NAME_ERR;
     }
-    return mSections[mTagToSectionMap.valueAt(index)].string();
+    return it->second.section;
 }
 
 const char* VendorTagDescriptor::getTagName(uint32_t tag) const {
-    ssize_t index = mTagToNameMap.indexOfKey(tag);
-    if (index < 0) {
+    auto it = mTagInfo.find(tag);
+    if (it == mTagInfo.end()) {
         return VENDOR_TAG_NAME_ERR;
     }
-    return mTagToNameMap.valueAt(index).string();
+    return it->second.name;
 }
 
 int VendorTagDescriptor::getTagType(uint32_t tag) const {
-    ssize_t index = mTagToNameMap.indexOfKey(tag);
-    if (index < 0) {
+    auto it = mTagInfo.find(tag);
+    if (it == mTagInfo.end()) {
         return VENDOR_TAG_TYPE_ERR;
     }
-    return mTagToTypeMap.valueFor(tag);
+    return it->second.type;
 }
 
 status_t VendorTagDescriptor::writeToParcel(android::Parcel* parcel) const {
@@ -582,6 +603,7 @@ status_t VendorTagDescriptor::createDescriptorFromOps(const vendor_tag_ops_t* vO
         desc->mReverseMapping[reverseIndex]->add(desc->mTagToNameMap.valueFor(tag), tag);
     }
 
+    desc->buildTagInfoIndex();
     descriptor = desc;
     return OK;
 }
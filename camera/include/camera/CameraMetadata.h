@@ -23,12 +23,18 @@
 #include <utils/Vector.h>
 #include <binder/Parcelable.h>
 
+#include <atomic>
+
 namespace android {
 
 class VendorTagDescriptor;
 
 /**
  * A convenience wrapper around the C-based camera_metadata_t library.
+ *
+ * Copies of a CameraMetadata share the same metadata buffer, which is only
+ * cloned once one of them is modified (copy-on-write). Entries returned by the
+ * non-const find() must not be written to after the object has been copied.
  */
 class CameraMetadata: public Parcelable {
   public:
@@ -43,11 +49,12 @@ class CameraMetadata: public Parcelable {
 
     /** Takes ownership of passed-in buffer */
     CameraMetadata(camera_metadata_t *buffer);
-    /** Clones the metadata */
+    /** Shares the metadata buffer of other until either object is modified */
     CameraMetadata(const CameraMetadata &other);
 
     /**
-     * Assignment clones metadata buffer.
+     * Assignment from another CameraMetadata shares its metadata buffer;
+     * assignment from a raw buffer clones it.
      */
     CameraMetadata &operator=(const CameraMetadata &other);
     CameraMetadata &operator=(const camera_metadata_t *buffer);
@@ -66,9 +73,17 @@ class CameraMetadata: public Parcelable {
      * given from getAndLock() may no longer be used. The pointer passed out
      * from getAndLock must be provided to guarantee that the right object is
      * being unlocked.
+     *
+     * The buffer may be shared with other CameraMetadata objects, so it must
+     * not be modified through the returned pointer.
      */
     status_t unlock(const camera_metadata_t *buffer) const;
 
+    /**
+     * Set the vendor tag id of the metadata buffer.
+     */
+    status_t setVendorId(metadata_vendor_id_t vendorId);
+
     /**
      * Release a raw metadata buffer to the caller. After this call,
      * CameraMetadata no longer references the buffer, and the caller takes
@@ -220,9 +235,38 @@ class CameraMetadata: public Parcelable {
     static status_t getTagFromName(const char *name,
             const VendorTagDescriptor* vTags, uint32_t *tag);
 
+    /**
+     * Process-wide counts of metadata buffers allocated by CameraMetadata,
+     * and of copies that shared an existing buffer instead of cloning it.
+     */
+    static void getBufferStats(uint64_t *allocated, uint64_t *shared);
+
   private:
     camera_metadata_t *mBuffer;
     mutable bool       mLocked;
+    // Number of CameraMetadata objects sharing mBuffer; NULL iff mBuffer is NULL
+    std::atomic<int32_t> *mShareCount;
+
+    /**
+     * Take ownership of a buffer no one else references
+     */
+    void adopt(camera_metadata_t *buffer);
+
+    /**
+     * Share the buffer of other
+     */
+    void share(const CameraMetadata &other);
+
+    /**
+     * Drop this object's reference to the buffer, freeing it if it was the
+     * last one
+     */
+    void drop();
+
+    /**
+     * Clone the buffer if other objects share it, so that it can be modified
+     */
+    status_t unshare();
 
     /**
      * Check if tag has a given type
@@ -236,6 +280,7 @@ class CameraMetadata: public Parcelable {
 
     /**
      * Resize metadata buffer if needed by reallocating it and copying it over.
+     * On success, the buffer is not shared with any other object.
      */
     status_t resizeIfNeeded(size_t extraEntries, size_t extraData);
 
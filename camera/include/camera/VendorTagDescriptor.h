@@ -114,6 +114,18 @@ class VendorTagDescriptor : public Parcelable {
         // must be int32_t to be compatible with Parcel::writeInt32
         int32_t mTagCount;
 
+        // Hashed index over the maps above, so that the per-tag getters used by metadata
+        // dumps and the NDK take a single lookup. Points into the strings of mTagToNameMap
+        // and mSections; rebuilt by buildTagInfoIndex whenever those change.
+        struct TagInfo {
+            const char* name;
+            const char* section;
+            int32_t type;
+        };
+        std::unordered_map<uint32_t, TagInfo> mTagInfo;
+
+        void buildTagInfoIndex();
+
         vendor_tag_ops mVendorOps;
 };
 } /* namespace params */
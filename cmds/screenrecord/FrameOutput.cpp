@@ -18,15 +18,13 @@
 //#define LOG_NDEBUG 0
 #include <utils/Log.h>
 
-#include <GLES2/gl2.h>
-#include <GLES2/gl2ext.h>
+#include <string.h>
 
 #include "FrameOutput.h"
 
 using namespace android;
 
 static const bool kShowTiming = false;      // set to "true" for debugging
-static const int kGlBytesPerPixel = 4;      // GL_RGBA
 static const int kOutBytesPerPixel = 3;     // RGB only
 
 inline void FrameOutput::setValueLE(uint8_t* buf, uint32_t value) {
@@ -42,44 +40,19 @@ inline void FrameOutput::setValueLE(uint8_t* buf, uint32_t value) {
 
 status_t FrameOutput::createInputSurface(int width, int height,
         sp<IGraphicBufferProducer>* pBufferProducer) {
-    status_t err;
-
-    err = mEglWindow.createPbuffer(width, height);
-    if (err != NO_ERROR) {
-        return err;
-    }
-    mEglWindow.makeCurrent();
-
-    glViewport(0, 0, width, height);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_CULL_FACE);
-
-    // Shader for rendering the external texture.
-    err = mExtTexProgram.setup(Program::PROGRAM_EXTERNAL_TEXTURE);
-    if (err != NO_ERROR) {
-        return err;
-    }
-
-    // Input side (buffers from virtual display).
-    glGenTextures(1, &mExtTextureName);
-    if (mExtTextureName == 0) {
-        ALOGE("glGenTextures failed: %#x", glGetError());
-        return UNKNOWN_ERROR;
-    }
-
     sp<IGraphicBufferProducer> producer;
     sp<IGraphicBufferConsumer> consumer;
     BufferQueue::createBufferQueue(&producer, &consumer);
-    mGlConsumer = new GLConsumer(consumer, mExtTextureName,
-                GL_TEXTURE_EXTERNAL_OES, true, false);
-    mGlConsumer->setName(String8("virtual display"));
-    mGlConsumer->setDefaultBufferSize(width, height);
+    mCpuConsumer = new CpuConsumer(consumer, 1);
+    mCpuConsumer->setName(String8("virtual display"));
+    mCpuConsumer->setDefaultBufferSize(width, height);
+    mCpuConsumer->setDefaultBufferFormat(HAL_PIXEL_FORMAT_RGBA_8888);
     producer->setMaxDequeuedBufferCount(4);
-    mGlConsumer->setConsumerUsageBits(GRALLOC_USAGE_HW_TEXTURE);
 
-    mGlConsumer->setFrameAvailableListener(this);
+    mCpuConsumer->setFrameAvailableListener(this);
 
-    mPixelBuf = new uint8_t[width * height * kGlBytesPerPixel];
+    mPixelBuf = new uint8_t[width * height * kOutBytesPerPixel];
+    mPixelBufSize = width * height * kOutBytesPerPixel;
 
     *pBufferProducer = producer;
 
@@ -91,7 +64,7 @@ status_t FrameOutput::copyFrame(FILE* fp, long timeoutUsec, bool rawFrames) {
     Mutex::Autolock _l(mMutex);
     ALOGV("copyFrame %ld\n", timeoutUsec);
 
-    if (!mFrameAvailable) {
+    if (mFramesAvailable == 0) {
         nsecs_t timeoutNsec = (nsecs_t)timeoutUsec * 1000;
         int cc = mEventCond.waitRelative(mMutex, timeoutNsec);
         if (cc == -ETIMEDOUT) {
@@ -102,7 +75,7 @@ status_t FrameOutput::copyFrame(FILE* fp, long timeoutUsec, bool rawFrames) {
             return cc;
         }
     }
-    if (!mFrameAvailable) {
+    if (mFramesAvailable == 0) {
         // This happens when Ctrl-C is hit.  Apparently POSIX says that the
         // pthread wait call doesn't return EINTR, treating this instead as
         // an instance of a "spurious wakeup".  We didn't get a frame, so
@@ -110,50 +83,61 @@ status_t FrameOutput::copyFrame(FILE* fp, long timeoutUsec, bool rawFrames) {
         return ETIMEDOUT;
     }
 
-    // A frame is available.  Clear the flag for the next round.
-    mFrameAvailable = false;
+    // A frame is available.  Count it as consumed.
+    mFramesAvailable--;
 
-    float texMatrix[16];
-    mGlConsumer->updateTexImage();
-    mGlConsumer->getTransformMatrix(texMatrix);
-
-    // The data is in an external texture, so we need to render it to the
-    // pbuffer to get access to RGB pixel data.  We also want to flip it
-    // upside-down for easy conversion to a bitmap.
-    int width = mEglWindow.getWidth();
-    int height = mEglWindow.getHeight();
-    status_t err = mExtTexProgram.blit(mExtTextureName, texMatrix, 0, 0,
-            width, height, true);
+    CpuConsumer::LockedBuffer buffer;
+    status_t err = mCpuConsumer->lockNextBuffer(&buffer);
     if (err != NO_ERROR) {
+        ALOGE("lockNextBuffer failed: %d", err);
         return err;
     }
 
-    // GLES only guarantees that glReadPixels() will work with GL_RGBA, so we
-    // need to get 4 bytes/pixel and reduce it.  Depending on the size of the
-    // screen and the device capabilities, this can take a while.
-    int64_t startWhenNsec, pixWhenNsec, endWhenNsec;
-    if (kShowTiming) {
-        startWhenNsec = systemTime(CLOCK_MONOTONIC);
+    int srcBytesPerPixel;
+    switch (buffer.format) {
+    case HAL_PIXEL_FORMAT_RGBA_8888:
+    case HAL_PIXEL_FORMAT_RGBX_8888:
+        srcBytesPerPixel = 4;
+        break;
+    case HAL_PIXEL_FORMAT_RGB_888:
+        srcBytesPerPixel = 3;
+        break;
+    default:
+        ALOGE("unsupported virtual display format %#x", buffer.format);
+        mCpuConsumer->unlockBuffer(buffer);
+        return UNKNOWN_ERROR;
     }
-    GLenum glErr;
-    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, mPixelBuf);
-    if ((glErr = glGetError()) != GL_NO_ERROR) {
-        ALOGE("glReadPixels failed: %#x", glErr);
+
+    uint32_t width = buffer.width;
+    uint32_t height = buffer.height;
+    size_t rgbDataLen = width * height * kOutBytesPerPixel;
+    if (rgbDataLen > mPixelBufSize) {
+        ALOGE("frame %ux%u larger than expected", width, height);
+        mCpuConsumer->unlockBuffer(buffer);
         return UNKNOWN_ERROR;
     }
+
+    // The buffer rows are padded to the stride, and may be RGBA; pack them
+    // into RGB rows.
+    int64_t startWhenNsec, endWhenNsec;
     if (kShowTiming) {
-        pixWhenNsec = systemTime(CLOCK_MONOTONIC);
+        startWhenNsec = systemTime(CLOCK_MONOTONIC);
+    }
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* src = buffer.data + y * buffer.stride * srcBytesPerPixel;
+        uint8_t* dst = mPixelBuf + y * width * kOutBytesPerPixel;
+        if (srcBytesPerPixel == kOutBytesPerPixel) {
+            memcpy(dst, src, width * kOutBytesPerPixel);
+        } else {
+            reduceRgbaToRgb(dst, src, width);
+        }
     }
-    reduceRgbaToRgb(mPixelBuf, width * height);
+    mCpuConsumer->unlockBuffer(buffer);
     if (kShowTiming) {
         endWhenNsec = systemTime(CLOCK_MONOTONIC);
-        ALOGD("got pixels (get=%.3f ms, reduce=%.3fms)",
-                (pixWhenNsec - startWhenNsec) / 1000000.0,
-                (endWhenNsec - pixWhenNsec) / 1000000.0);
+        ALOGD("got pixels (%.3f ms)", (endWhenNsec - startWhenNsec) / 1000000.0);
     }
 
-    size_t rgbDataLen = width * height * kOutBytesPerPixel;
-
     if (!rawFrames) {
         // Fill out the header.
         size_t headerLen = sizeof(uint32_t) * 5;
@@ -190,24 +174,23 @@ status_t FrameOutput::copyFrame(FILE* fp, long timeoutUsec, bool rawFrames) {
     return NO_ERROR;
 }
 
-void FrameOutput::reduceRgbaToRgb(uint8_t* buf, unsigned int pixelCount) {
+void FrameOutput::reduceRgbaToRgb(uint8_t* dst, const uint8_t* src, unsigned int pixelCount) {
     // Convert RGBA to RGB.
     //
     // Unaligned 32-bit accesses are allowed on ARM, so we could do this
     // with 32-bit copies advancing at different rates (taking care at the
     // end to not go one byte over).
-    const uint8_t* readPtr = buf;
     for (unsigned int i = 0; i < pixelCount; i++) {
-        *buf++ = *readPtr++;
-        *buf++ = *readPtr++;
-        *buf++ = *readPtr++;
-        readPtr++;
+        *dst++ = *src++;
+        *dst++ = *src++;
+        *dst++ = *src++;
+        src++;
     }
 }
 
 // Callback; executes on arbitrary thread.
 void FrameOutput::onFrameAvailable(const BufferItem& /* item */) {
     Mutex::Autolock _l(mMutex);
-    mFrameAvailable = true;
+    mFramesAvailable++;
     mEventCond.signal();
 }
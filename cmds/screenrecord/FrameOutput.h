@@ -17,27 +17,26 @@
 #ifndef SCREENRECORD_FRAMEOUTPUT_H
 #define SCREENRECORD_FRAMEOUTPUT_H
 
-#include "Program.h"
-#include "EglWindow.h"
-
 #include <gui/BufferQueue.h>
-#include <gui/GLConsumer.h>
+#include <gui/CpuConsumer.h>
 
 namespace android {
 
 /*
  * Support for "frames" output format.
+ *
+ * Frames from the virtual display are locked for CPU access and converted
+ * straight from the graphic buffer, without a GLES render and readback.
  */
-class FrameOutput : public GLConsumer::FrameAvailableListener {
+class FrameOutput : public ConsumerBase::FrameAvailableListener {
 public:
-    FrameOutput() : mFrameAvailable(false),
-        mExtTextureName(0),
-        mPixelBuf(NULL)
+    FrameOutput() : mFramesAvailable(0),
+        mPixelBuf(NULL),
+        mPixelBufSize(0)
         {}
 
     // Create an "input surface", similar in purpose to a MediaCodec input
-    // surface, that the virtual display can send buffers to.  Also configures
-    // EGL with a pbuffer surface on the current thread.
+    // surface, that the virtual display can send buffers to.
     status_t createInputSurface(int width, int height,
             sp<IGraphicBufferProducer>* pBufferProducer);
 
@@ -47,11 +46,6 @@ public:
     // Returns ETIMEDOUT if the timeout expired before we found a frame.
     status_t copyFrame(FILE* fp, long timeoutUsec, bool rawFrames);
 
-    // Prepare to copy frames.  Makes the EGL context used by this object current.
-    void prepareToCopy() {
-        mEglWindow.makeCurrent();
-    }
-
 private:
     FrameOutput(const FrameOutput&);
     FrameOutput& operator=(const FrameOutput&);
@@ -61,11 +55,11 @@ private:
         delete[] mPixelBuf;
     }
 
-    // (overrides GLConsumer::FrameAvailableListener method)
+    // (overrides ConsumerBase::FrameAvailableListener method)
     virtual void onFrameAvailable(const BufferItem& item);
 
-    // Reduces RGBA to RGB, in place.
-    static void reduceRgbaToRgb(uint8_t* buf, unsigned int pixelCount);
+    // Copies one row of RGBA or RGBX pixels to RGB.
+    static void reduceRgbaToRgb(uint8_t* dst, const uint8_t* src, unsigned int pixelCount);
 
     // Put a 32-bit value into a buffer, in little-endian byte order.
     static void setValueLE(uint8_t* buf, uint32_t value);
@@ -74,24 +68,17 @@ private:
     Mutex mMutex;
     Condition mEventCond;
 
-    // Set by the FrameAvailableListener callback.
-    bool mFrameAvailable;
-
-    // This receives frames from the virtual display and makes them available
-    // as an external texture.
-    sp<GLConsumer> mGlConsumer;
-
-    // EGL display / context / surface.
-    EglWindow mEglWindow;
-
-    // GL rendering support.
-    Program mExtTexProgram;
+    // Frames queued by the virtual display and not copied yet.  Incremented
+    // by the FrameAvailableListener callback.
+    int mFramesAvailable;
 
-    // External texture, updated by GLConsumer.
-    GLuint mExtTextureName;
+    // This receives frames from the virtual display and locks them for
+    // reading.
+    sp<CpuConsumer> mCpuConsumer;
 
-    // Pixel data buffer.
+    // Pixel data buffer, RGB.
     uint8_t* mPixelBuf;
+    size_t mPixelBufSize;
 };
 
 }; // namespace android
@@ -70,6 +70,7 @@ static const char* kMimeTypeAvc = "video/avc";
 static bool gVerbose = false;           // chatty on stdout
 static bool gRotate = false;            // rotate 90 degrees
 static bool gMonotonicTime = false;     // use system monotonic time for timestamps
+static bool gBenchmark = false;         // report encode latency and frame gaps
 static enum {
     FORMAT_MP4, FORMAT_H264, FORMAT_FRAMES, FORMAT_RAW_FRAMES
 } gOutputFormat = FORMAT_MP4;           // data format for output
@@ -322,6 +323,11 @@ static status_t runEncoder(const sp<MediaCodec>& encoder,
     status_t err;
     ssize_t trackIdx = -1;
     uint32_t debugNumFrames = 0;
+    uint32_t benchFrames = 0;
+    uint32_t benchMissedFrames = 0;
+    int64_t benchLatencySumUsec = 0;
+    int64_t benchLatencyMaxUsec = 0;
+    int64_t benchLastPtsUsec = 0;
     int64_t startWhenNsec = systemTime(CLOCK_MONOTONIC);
     int64_t endWhenNsec = startWhenNsec + seconds_to_nanoseconds(gTimeLimitSec);
     DisplayInfo mainDpyInfo;
@@ -386,6 +392,28 @@ static status_t runEncoder(const sp<MediaCodec>& encoder,
                     }
                 }
 
+                // The virtual display timestamps frames when they are
+                // composed, so the time since then is the encode latency.
+                // A gap of more than one and a half display frames between
+                // two frames counts the frames that were skipped.
+                if (gBenchmark && ptsUsec != 0 &&
+                        (flags & MediaCodec::BUFFER_FLAG_CODECCONFIG) == 0) {
+                    int64_t latencyUsec = systemTime(CLOCK_MONOTONIC) / 1000 - ptsUsec;
+                    benchLatencySumUsec += latencyUsec;
+                    if (latencyUsec > benchLatencyMaxUsec) {
+                        benchLatencyMaxUsec = latencyUsec;
+                    }
+                    if (benchLastPtsUsec != 0 && mainDpyInfo.fps > 0) {
+                        int64_t periodUsec = (int64_t) (1000000 / mainDpyInfo.fps);
+                        int64_t gapUsec = ptsUsec - benchLastPtsUsec;
+                        if (gapUsec * 2 > periodUsec * 3) {
+                            benchMissedFrames += (gapUsec + periodUsec / 2) / periodUsec - 1;
+                        }
+                    }
+                    benchLastPtsUsec = ptsUsec;
+                    benchFrames++;
+                }
+
                 // If the virtual display isn't providing us with timestamps,
                 // use the current time.  This isn't great -- we could get
                 // decoded data in clusters -- but we're not expecting
@@ -482,6 +510,14 @@ static status_t runEncoder(const sp<MediaCodec>& encoder,
                 debugNumFrames, nanoseconds_to_seconds(
                         systemTime(CLOCK_MONOTONIC) - startWhenNsec));
     }
+    if (gBenchmark) {
+        // stdout may be the output file
+        fprintf(stderr, "Benchmark: %u frames, %u skipped, encode latency ms:"
+                " mean=%.2f max=%.2f\n",
+                benchFrames, benchMissedFrames,
+                benchFrames > 0 ? benchLatencySumUsec / 1000.0 / benchFrames : 0.0,
+                benchLatencyMaxUsec / 1000.0);
+    }
     return NO_ERROR;
 }
 
@@ -680,11 +716,6 @@ static status_t recordScreen(const char* fileName) {
         //       the current frame header once and then follow it with an
         //       unbroken stream of data.
 
-        // Make the EGL context current again.  This gets unhooked if we're
-        // using "--bugreport" mode.
-        // TODO: figure out if we can eliminate this
-        frameOutput->prepareToCopy();
-
         while (!gStopRequested) {
             // Poll for frames, the same way we do for MediaCodec.  We do
             // all of the work on the main thread.
@@ -897,6 +928,7 @@ int main(int argc, char* const argv[]) {
         { "rotate",             no_argument,        NULL, 'r' },
         { "output-format",      required_argument,  NULL, 'o' },
         { "monotonic-time",     no_argument,        NULL, 'm' },
+        { "benchmark",          no_argument,        NULL, 'B' },
         { NULL,                 0,                  NULL, 0 }
     };
 
@@ -979,6 +1011,9 @@ int main(int argc, char* const argv[]) {
         case 'm':
             gMonotonicTime = true;
             break;
+        case 'B':
+            gBenchmark = true;
+            break;
         default:
             if (ic != '?') {
                 fprintf(stderr, "getopt_long returned unexpected value 0x%x\n", ic);
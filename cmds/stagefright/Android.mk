@@ -150,6 +150,29 @@ include $(BUILD_EXECUTABLE)
 
 include $(CLEAR_VARS)
 
+LOCAL_SRC_FILES:=               \
+        codecbench.cpp          \
+
+LOCAL_SHARED_LIBRARIES := \
+        libstagefright liblog libutils libbinder libstagefright_foundation \
+        libmedia
+
+LOCAL_C_INCLUDES:= \
+        frameworks/av/media/libstagefright \
+        $(TOP)/frameworks/native/include/media/openmax
+
+LOCAL_CFLAGS += -Wno-multichar -Werror -Wall
+
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_MODULE:= codecbench
+
+include $(BUILD_EXECUTABLE)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
 LOCAL_SRC_FILES:= \
         filters/argbtorgba.rs \
         filters/nightvision.rs \
@@ -209,3 +232,24 @@ LOCAL_MODULE_TAGS := optional
 LOCAL_MODULE:= muxer
 
 include $(BUILD_EXECUTABLE)
+
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=               \
+        abrsim.cpp              \
+
+LOCAL_SHARED_LIBRARIES := \
+        libstagefright_httplive liblog libutils
+
+LOCAL_C_INCLUDES:= \
+        frameworks/av/media/libstagefright
+
+LOCAL_CFLAGS += -Wno-multichar -Werror -Wall
+
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_MODULE:= abrsim
+
+include $(BUILD_EXECUTABLE)
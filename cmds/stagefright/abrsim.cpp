@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays a recorded network trace through an HTTP live streaming
+// AbrController, and reports the variants it picks, the time spent
+// rebuffering, and the number of switches.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <utils/Vector.h>
+
+#include "httplive/AbrController.h"
+
+using namespace android;
+
+// the most a fetcher buffers ahead, as PlaylistFetcher::kMinBufferedDurationUs
+static const int64_t kMaxBufferedDurationUs = 30000000ll;
+// the duration buffered before playback starts and resumes
+static const int64_t kStartDurationUs = 4000000ll;
+
+struct TraceEntry {
+    int64_t mDurationUs;
+    int64_t mBps;
+};
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-a controller] [-b kbps,kbps,...] [-s segment_secs] [-v] trace\n"
+                    "       -a  the controller to simulate (default: throughput-buffer)\n"
+                    "       -b  the bandwidths of the variants (default: 300,800,1500,3000)\n"
+                    "       -s  the duration of a segment (default: 4)\n"
+                    "       -v  print every segment\n"
+                    "The trace has a line per period: <duration_ms> <throughput_kbps>.\n"
+                    "It is repeated as needed.\n",
+                    me);
+    exit(1);
+}
+
+static bool readTrace(const char *path, Vector<TraceEntry> *trace) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        long long durationMs, kbps;
+        if (line[0] == '#' || sscanf(line, "%lld %lld", &durationMs, &kbps) != 2) {
+            continue;
+        }
+        if (durationMs > 0 && kbps > 0) {
+            TraceEntry entry;
+            entry.mDurationUs = durationMs * 1000ll;
+            entry.mBps = kbps * 1000ll;
+            trace->push(entry);
+        }
+    }
+    fclose(file);
+    return !trace->empty();
+}
+
+// Returns the time it takes to download |numBytes| from |*nowUs| on, and
+// advances |*nowUs| by it.
+static int64_t download(const Vector<TraceEntry> &trace, int64_t *nowUs, int64_t numBytes) {
+    int64_t traceDurationUs = 0;
+    for (size_t i = 0; i < trace.size(); ++i) {
+        traceDurationUs += trace[i].mDurationUs;
+    }
+
+    int64_t startUs = *nowUs;
+    double bitsLeft = numBytes * 8.0;
+    while (bitsLeft > 0) {
+        // find the period |*nowUs| is in
+        int64_t offsetUs = *nowUs % traceDurationUs;
+        size_t i = 0;
+        while (offsetUs >= trace[i].mDurationUs) {
+            offsetUs -= trace[i].mDurationUs;
+            ++i;
+        }
+
+        int64_t periodLeftUs = trace[i].mDurationUs - offsetUs;
+        double periodBits = trace[i].mBps * periodLeftUs / 1E6;
+        if (periodBits >= bitsLeft) {
+            *nowUs += (int64_t)(bitsLeft * 1E6 / trace[i].mBps) + 1;
+            break;
+        }
+        bitsLeft -= periodBits;
+        *nowUs += periodLeftUs;
+    }
+    return *nowUs - startUs;
+}
+
+int main(int argc, char **argv) {
+    const char *me = argv[0];
+    const char *name = "throughput-buffer";
+    const char *bandwidthList = "300,800,1500,3000";
+    int64_t segmentDurationUs = 4000000ll;
+    bool verbose = false;
+
+    int res;
+    while ((res = getopt(argc, argv, "a:b:s:vh")) >= 0) {
+        switch (res) {
+            case 'a':
+                name = optarg;
+                break;
+            case 'b':
+                bandwidthList = optarg;
+                break;
+            case 's':
+                segmentDurationUs = atof(optarg) * 1E6;
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                usage(me);
+        }
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (argc != 1 || segmentDurationUs <= 0) {
+        usage(me);
+    }
+
+    Vector<int32_t> bandwidths;
+    for (const char *s = bandwidthList; *s != '\0';) {
+        char *end;
+        long kbps = strtol(s, &end, 10);
+        if (end == s || kbps <= 0 || (bandwidths.size() > 0
+                && kbps * 1000 <= bandwidths[bandwidths.size() - 1])) {
+            fprintf(stderr, "bandwidths must be ascending kbps\n");
+            return 1;
+        }
+        bandwidths.push(kbps * 1000);
+        s = *end == ',' ? end + 1 : end;
+    }
+
+    Vector<TraceEntry> trace;
+    if (!readTrace(argv[0], &trace)) {
+        return 1;
+    }
+    int64_t traceDurationUs = 0;
+    for (size_t i = 0; i < trace.size(); ++i) {
+        traceDurationUs += trace[i].mDurationUs;
+    }
+
+    sp<AbrController> controller = AbrController::Create(name);
+    if (controller == NULL) {
+        fprintf(stderr, "unknown controller %s\n", name);
+        return 1;
+    }
+
+    // Plays the trace twice over, so that the controller settles.
+    int64_t endUs = 2 * traceDurationUs;
+    int64_t nowUs = 0;
+    int64_t bufferedUs = 0;
+    bool playing = false;
+    size_t index = 0;
+    size_t numSegments = 0, numSwitches = 0, numRebuffers = 0;
+    int64_t rebufferUs = 0;
+    double bitrateSum = 0;
+
+    while (nowUs < endUs) {
+        if (bufferedUs > kMaxBufferedDurationUs) {
+            // idle until there is room for a segment again
+            int64_t idleUs = bufferedUs - kMaxBufferedDurationUs;
+            nowUs += idleUs;
+            bufferedUs -= idleUs;
+        }
+
+        int64_t numBytes = (int64_t)bandwidths[index] * segmentDurationUs / 8000000ll;
+        int64_t delayUs = download(trace, &nowUs, numBytes);
+        controller->addBandwidthMeasurement(numBytes, delayUs, nowUs);
+
+        if (playing) {
+            if (delayUs > bufferedUs) {
+                rebufferUs += delayUs - bufferedUs;
+                ++numRebuffers;
+                bufferedUs = 0;
+                playing = false;
+            } else {
+                bufferedUs -= delayUs;
+            }
+        }
+        bufferedUs += segmentDurationUs;
+        if (!playing && bufferedUs >= kStartDurationUs) {
+            playing = true;
+        }
+
+        ++numSegments;
+        bitrateSum += bandwidths[index];
+
+        ssize_t predictedIndex;
+        size_t newIndex = controller->selectVariant(
+                bandwidths, index, bufferedUs, playing, nowUs, &predictedIndex);
+
+        if (verbose) {
+            printf("%8.2f s: segment %zu of %d kbps in %.2f s, buffered %.2f s, "
+                   "estimate %d kbps%s",
+                   nowUs / 1E6, numSegments, bandwidths[index] / 1000, delayUs / 1E6,
+                   bufferedUs / 1E6, controller->getBandwidthEstimate() / 1000,
+                   playing ? "" : " (rebuffering)");
+            if (newIndex != index) {
+                printf(", switching to %d kbps", bandwidths[newIndex] / 1000);
+            } else if (predictedIndex >= 0) {
+                printf(", predicting %d kbps", bandwidths[predictedIndex] / 1000);
+            }
+            printf("\n");
+        }
+
+        if (newIndex != index) {
+            ++numSwitches;
+            index = newIndex;
+        }
+    }
+
+    printf("%s: %zu segments, average %.0f kbps, %zu switches, "
+           "%zu rebuffers for %.2f s\n",
+           name, numSegments, bitrateSum / numSegments / 1000, numSwitches,
+           numRebuffers, rebufferUs / 1E6);
+    return 0;
+}
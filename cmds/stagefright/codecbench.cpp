@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "codecbench"
+#include <inttypes.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <utils/Log.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <binder/ProcessState.h>
+#include <media/MediaCodecBuffer.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/ColorConverter.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/NuMediaExtractor.h>
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s [-a] benchmark the audio track instead of the video track\n"
+                    "\t\t[-c component] decode with the named component,"
+                    " e.g. a software one\n"
+                    "\t\t[-C] also convert each decoded video frame to RGB565\n"
+                    "\t\t[-n runs] decode each file this many times (default 1)\n"
+                    "\t\t[-s seeks] number of seeks to time (default 10)\n"
+                    "\t\tfile...\n"
+                    "Prints one JSON object per run and file on stdout.\n",
+                    me);
+    exit(1);
+}
+
+namespace android {
+
+struct BenchOptions {
+    bool mUseAudio;
+    const char *mComponent;
+    bool mConvert;
+    int mSeeks;
+};
+
+struct BenchResult {
+    AString mComponent;
+    int64_t mOpenUs;
+    std::vector<int64_t> mSeekUs;
+    int64_t mFrames;
+    int64_t mDecodeUs;          // wall clock time from start to output EOS
+    int64_t mCpuNs;             // CPU time of this process while decoding
+    std::vector<int64_t> mLatencyUs;    // from queueing a sample to dequeueing its output
+    std::vector<int64_t> mConvertUs;
+    bool mConvertSupported;
+};
+
+static int64_t getCpuTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+// nearest-rank percentile, 0 if there are no values
+static int64_t percentile(std::vector<int64_t> values, int p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[(values.size() - 1) * p / 100];
+}
+
+// Converts a decoded frame, described by the current output format, to RGB565.
+struct FrameConverter {
+    FrameConverter(const sp<AMessage> &format, bool *supported)
+        : mConverter(NULL) {
+        int32_t colorFormat, width, height;
+        *supported = format->findInt32("color-format", &colorFormat)
+                && format->findInt32("width", &width)
+                && format->findInt32("height", &height);
+        if (!*supported) {
+            return;
+        }
+        if (!format->findInt32("stride", &mStride)) {
+            mStride = width;
+        }
+        if (!format->findInt32("slice-height", &mSliceHeight)) {
+            mSliceHeight = height;
+        }
+        if (!format->findRect("crop", &mCropLeft, &mCropTop, &mCropRight, &mCropBottom)) {
+            mCropLeft = mCropTop = 0;
+            mCropRight = width - 1;
+            mCropBottom = height - 1;
+        }
+        mConverter = new ColorConverter(
+                (OMX_COLOR_FORMATTYPE)colorFormat, OMX_COLOR_Format16bitRGB565);
+        *supported = mConverter->isValid();
+        mDst.resize((mCropRight - mCropLeft + 1) * (mCropBottom - mCropTop + 1) * 2);
+    }
+
+    ~FrameConverter() {
+        delete mConverter;
+    }
+
+    status_t convert(const sp<MediaCodecBuffer> &buffer) {
+        size_t dstWidth = mCropRight - mCropLeft + 1;
+        size_t dstHeight = mCropBottom - mCropTop + 1;
+        return mConverter->convert(
+                buffer->data(), mStride, mSliceHeight,
+                mCropLeft, mCropTop, mCropRight, mCropBottom,
+                mDst.data(), dstWidth, dstHeight,
+                0, 0, dstWidth - 1, dstHeight - 1);
+    }
+
+private:
+    ColorConverter *mConverter;
+    int32_t mStride, mSliceHeight;
+    int32_t mCropLeft, mCropTop, mCropRight, mCropBottom;
+    std::vector<uint8_t> mDst;
+};
+
+static status_t runBenchmark(
+        const sp<ALooper> &looper, const char *path, const BenchOptions &options,
+        BenchResult *result) {
+    static const int64_t kTimeoutUs = 5000ll;
+
+    int64_t startUs = ALooper::GetNowUs();
+    sp<NuMediaExtractor> extractor = new NuMediaExtractor;
+    if (extractor->setDataSource(NULL /* httpService */, path) != OK) {
+        fprintf(stderr, "%s: unable to instantiate extractor.\n", path);
+        return UNKNOWN_ERROR;
+    }
+    result->mOpenUs = ALooper::GetNowUs() - startUs;
+
+    sp<AMessage> format;
+    AString mime;
+    size_t track;
+    for (track = 0; track < extractor->countTracks(); ++track) {
+        if (extractor->getTrackFormat(track, &format) == OK
+                && format->findString("mime", &mime)
+                && !strncasecmp(mime.c_str(), options.mUseAudio ? "audio/" : "video/", 6)) {
+            break;
+        }
+    }
+    if (track == extractor->countTracks()) {
+        fprintf(stderr, "%s: no %s track.\n", path, options.mUseAudio ? "audio" : "video");
+        return UNKNOWN_ERROR;
+    }
+    status_t err = extractor->selectTrack(track);
+    if (err != OK) {
+        return err;
+    }
+
+    // seek latency, to evenly spaced positions
+    int64_t durationUs;
+    if (options.mSeeks > 0 && format->findInt64("durationUs", &durationUs)) {
+        for (int i = 0; i < options.mSeeks; ++i) {
+            int64_t seekStartUs = ALooper::GetNowUs();
+            extractor->seekTo(durationUs * i / options.mSeeks);
+            result->mSeekUs.push_back(ALooper::GetNowUs() - seekStartUs);
+        }
+        extractor->seekTo(0);
+    }
+
+    sp<MediaCodec> codec;
+    if (options.mComponent != NULL) {
+        codec = MediaCodec::CreateByComponentName(looper, options.mComponent, &err);
+    } else {
+        codec = MediaCodec::CreateByType(looper, mime.c_str(), false /* encoder */, &err);
+    }
+    if (codec == NULL) {
+        fprintf(stderr, "%s: unable to create codec for %s (err=%d).\n", path, mime.c_str(), err);
+        return err != OK ? err : UNKNOWN_ERROR;
+    }
+    codec->getName(&result->mComponent);
+
+    Vector<sp<MediaCodecBuffer> > inBuffers;
+    Vector<sp<MediaCodecBuffer> > outBuffers;
+    err = codec->configure(format, NULL /* surface */, NULL /* crypto */, 0 /* flags */);
+    if (err == OK) {
+        err = codec->start();
+    }
+    if (err == OK) {
+        err = codec->getInputBuffers(&inBuffers);
+    }
+    if (err == OK) {
+        err = codec->getOutputBuffers(&outBuffers);
+    }
+    if (err != OK) {
+        fprintf(stderr, "%s: unable to start %s (err=%d).\n",
+                path, result->mComponent.c_str(), err);
+        codec->release();
+        return err;
+    }
+
+    std::map<int64_t, int64_t> queueTimeUsByPts;
+    FrameConverter *converter = NULL;
+    result->mConvertSupported = false;
+    result->mFrames = 0;
+    bool sawInputEOS = false;
+    bool sawOutputEOS = false;
+    int64_t cpuStartNs = getCpuTimeNs();
+    startUs = ALooper::GetNowUs();
+
+    while (!sawOutputEOS && err == OK) {
+        size_t index;
+        if (!sawInputEOS && codec->dequeueInputBuffer(&index, kTimeoutUs) == OK) {
+            const sp<MediaCodecBuffer> &buffer = inBuffers.itemAt(index);
+            sp<ABuffer> abuffer = new ABuffer(buffer->base(), buffer->capacity());
+            int64_t timeUs = 0;
+            uint32_t flags = 0;
+            if (extractor->readSampleData(abuffer) != OK
+                    || extractor->getSampleTime(&timeUs) != OK) {
+                sawInputEOS = true;
+                abuffer->setRange(0, 0);
+                flags = MediaCodec::BUFFER_FLAG_EOS;
+            } else {
+                queueTimeUsByPts[timeUs] = ALooper::GetNowUs();
+                extractor->advance();
+            }
+            buffer->setRange(abuffer->offset(), abuffer->size());
+            err = codec->queueInputBuffer(index, 0 /* offset */, buffer->size(), timeUs, flags);
+            if (err != OK) {
+                break;
+            }
+        }
+
+        size_t offset;
+        size_t size;
+        int64_t presentationTimeUs;
+        uint32_t flags;
+        status_t outErr = codec->dequeueOutputBuffer(
+                &index, &offset, &size, &presentationTimeUs, &flags, kTimeoutUs);
+        if (outErr == OK) {
+            if (size > 0) {
+                ++result->mFrames;
+                auto it = queueTimeUsByPts.find(presentationTimeUs);
+                if (it != queueTimeUsByPts.end()) {
+                    result->mLatencyUs.push_back(ALooper::GetNowUs() - it->second);
+                    queueTimeUsByPts.erase(it);
+                }
+                if (converter != NULL && result->mConvertSupported) {
+                    int64_t convertStartUs = ALooper::GetNowUs();
+                    if (converter->convert(outBuffers.itemAt(index)) == OK) {
+                        result->mConvertUs.push_back(ALooper::GetNowUs() - convertStartUs);
+                    }
+                }
+            }
+            sawOutputEOS = (flags & MediaCodec::BUFFER_FLAG_EOS) != 0;
+            err = codec->releaseOutputBuffer(index);
+        } else if (outErr == INFO_OUTPUT_BUFFERS_CHANGED) {
+            err = codec->getOutputBuffers(&outBuffers);
+        } else if (outErr == INFO_FORMAT_CHANGED) {
+            if (options.mConvert && !options.mUseAudio) {
+                sp<AMessage> outputFormat;
+                err = codec->getOutputFormat(&outputFormat);
+                if (err == OK) {
+                    delete converter;
+                    converter = new FrameConverter(outputFormat, &result->mConvertSupported);
+                }
+            }
+        } else if (outErr != -EAGAIN) {
+            err = outErr;
+        }
+    }
+
+    result->mDecodeUs = ALooper::GetNowUs() - startUs;
+    result->mCpuNs = getCpuTimeNs() - cpuStartNs;
+    delete converter;
+    codec->release();
+    if (err != OK) {
+        fprintf(stderr, "%s: decoding failed (err=%d).\n", path, err);
+    }
+    return err;
+}
+
+static void printResult(const char *path, int run, const BenchResult &result) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("{\"file\":\"%s\",\"run\":%d,\"component\":\"%s\"", path, run,
+            result.mComponent.c_str());
+    printf(",\"open_us\":%" PRId64 ",\"seek_p50_us\":%" PRId64 ",\"seek_max_us\":%" PRId64,
+            result.mOpenUs, percentile(result.mSeekUs, 50), percentile(result.mSeekUs, 100));
+    printf(",\"frames\":%" PRId64 ",\"fps\":%.2f,\"cpu_us_per_frame\":%.1f",
+            result.mFrames,
+            result.mDecodeUs > 0 ? result.mFrames * 1E6 / result.mDecodeUs : 0.,
+            result.mFrames > 0 ? result.mCpuNs / 1E3 / result.mFrames : 0.);
+    printf(",\"latency_p50_us\":%" PRId64 ",\"latency_p99_us\":%" PRId64,
+            percentile(result.mLatencyUs, 50), percentile(result.mLatencyUs, 99));
+    if (result.mConvertSupported) {
+        printf(",\"convert_p50_us\":%" PRId64 ",\"convert_p99_us\":%" PRId64,
+                percentile(result.mConvertUs, 50), percentile(result.mConvertUs, 99));
+    }
+    printf(",\"max_rss_kb\":%ld}\n", usage.ru_maxrss);
+    fflush(stdout);
+}
+
+}  // namespace android
+
+int main(int argc, char **argv) {
+    using namespace android;
+
+    const char *me = argv[0];
+
+    BenchOptions options;
+    options.mUseAudio = false;
+    options.mComponent = NULL;
+    options.mConvert = false;
+    options.mSeeks = 10;
+    int runs = 1;
+
+    int res;
+    while ((res = getopt(argc, argv, "hac:Cn:s:")) >= 0) {
+        switch (res) {
+            case 'a':
+            {
+                options.mUseAudio = true;
+                break;
+            }
+            case 'c':
+            {
+                options.mComponent = optarg;
+                break;
+            }
+            case 'C':
+            {
+                options.mConvert = true;
+                break;
+            }
+            case 'n':
+            {
+                runs = atoi(optarg);
+                if (runs < 1) {
+                    usage(me);
+                }
+                break;
+            }
+            case 's':
+            {
+                options.mSeeks = atoi(optarg);
+                if (options.mSeeks < 0) {
+                    usage(me);
+                }
+                break;
+            }
+            case '?':
+            case 'h':
+            default:
+            {
+                usage(me);
+            }
+        }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if (argc < 1) {
+        usage(me);
+    }
+
+    ProcessState::self()->startThreadPool();
+
+    sp<ALooper> looper = new ALooper;
+    looper->start();
+
+    int failures = 0;
+    for (int i = 0; i < argc; ++i) {
+        for (int run = 0; run < runs; ++run) {
+            BenchResult result;
+            if (runBenchmark(looper, argv[i], options, &result) != OK) {
+                ++failures;
+                break;
+            }
+            printResult(argv[i], run, result);
+        }
+    }
+
+    looper->stop();
+
+    return failures > 0 ? 1 : 0;
+}
@@ -106,6 +106,8 @@ status_t DrmManager::loadPlugIns(const String8& plugInDirPath) {
             delete info;
         }
     }
+    Mutex::Autolock _c(mPlugInIdCacheLock);
+    mMimeTypeToPlugInIdCache.clear();
     return DRM_NO_ERROR;
 }
 
@@ -115,6 +117,8 @@ status_t DrmManager::unloadPlugIns() {
     mDecryptSessionMap.clear();
     mPlugInManager.unloadPlugIns();
     mSupportInfoToPlugInIdMap.clear();
+    Mutex::Autolock _c(mPlugInIdCacheLock);
+    mMimeTypeToPlugInIdCache.clear();
     return DRM_NO_ERROR;
 }
 
@@ -560,14 +564,21 @@ String8 DrmManager::getSupportedPlugInId(const String8& mimeType) {
     String8 plugInId("");
 
     if (EMPTY_STRING != mimeType) {
+        Mutex::Autolock _c(mPlugInIdCacheLock);
+        ssize_t cacheIndex = mMimeTypeToPlugInIdCache.indexOfKey(mimeType);
+        if (cacheIndex >= 0) {
+            return mMimeTypeToPlugInIdCache.valueAt(cacheIndex);
+        }
+
         for (size_t index = 0; index < mSupportInfoToPlugInIdMap.size(); index++) {
             const DrmSupportInfo& drmSupportInfo = mSupportInfoToPlugInIdMap.keyAt(index);
 
             if (drmSupportInfo.isSupportedMimeType(mimeType)) {
-                plugInId = mSupportInfoToPlugInIdMap.valueFor(drmSupportInfo);
+                plugInId = mSupportInfoToPlugInIdMap.valueAt(index);
                 break;
             }
         }
+        mMimeTypeToPlugInIdCache.add(mimeType, plugInId);
     }
     return plugInId;
 }
@@ -157,6 +157,10 @@ private:
     Mutex mConvertLock;
     TPlugInManager<IDrmEngine> mPlugInManager;
     KeyedVector< DrmSupportInfo, String8 > mSupportInfoToPlugInIdMap;
+    // Plug-in resolved for each MIME type seen so far, empty if none supports it. Guarded by
+    // mPlugInIdCacheLock, as lookups happen under either mLock or mConvertLock.
+    Mutex mPlugInIdCacheLock;
+    KeyedVector< String8, String8 > mMimeTypeToPlugInIdCache;
     KeyedVector< int, IDrmEngine*> mConvertSessionMap;
     KeyedVector< int, sp<IDrmServiceListener> > mServiceListeners;
     KeyedVector< int, IDrmEngine*> mDecryptSessionMap;
@@ -260,7 +260,7 @@ status_t CryptoHal::toSharedBuffer(const sp<IMemory>& memory, int32_t seqNum, ::
     ssize_t offset;
     size_t size;
 
-    if (memory == NULL && buffer == NULL) {
+    if (memory == NULL || buffer == NULL) {
         return UNEXPECTED_NULL;
     }
 
@@ -270,9 +270,10 @@ status_t CryptoHal::toSharedBuffer(const sp<IMemory>& memory, int32_t seqNum, ::
     }
 
     // memory must be in the declared heap
-    CHECK(mHeapBases.indexOfKey(seqNum) >= 0);
+    ssize_t index = mHeapBases.indexOfKey(seqNum);
+    CHECK(index >= 0);
 
-    buffer->bufferId = mHeapBases.valueFor(seqNum);
+    buffer->bufferId = mHeapBases.valueAt(index);
     buffer->offset = offset >= 0 ? offset : 0;
     buffer->size = size;
     return OK;
@@ -311,14 +312,15 @@ ssize_t CryptoHal::decrypt(const uint8_t keyId[16], const uint8_t iv[16],
     hPattern.encryptBlocks = pattern.mEncryptBlocks;
     hPattern.skipBlocks = pattern.mSkipBlocks;
 
-    std::vector<SubSample> stdSubSamples;
+    // The table only needs to live for the duration of the call, so lend the reused one to the
+    // hidl_vec instead of allocating and copying one per sample.
+    mSubSamples.resize(numSubSamples);
     for (size_t i = 0; i < numSubSamples; i++) {
-        SubSample subSample;
-        subSample.numBytesOfClearData = subSamples[i].mNumBytesOfClearData;
-        subSample.numBytesOfEncryptedData = subSamples[i].mNumBytesOfEncryptedData;
-        stdSubSamples.push_back(subSample);
+        mSubSamples[i].numBytesOfClearData = subSamples[i].mNumBytesOfClearData;
+        mSubSamples[i].numBytesOfEncryptedData = subSamples[i].mNumBytesOfEncryptedData;
     }
-    auto hSubSamples = hidl_vec<SubSample>(stdSubSamples);
+    hidl_vec<SubSample> hSubSamples;
+    hSubSamples.setToExternal(mSubSamples.data(), numSubSamples);
 
     int32_t heapSeqNum = source.mHeapSeqNum;
     bool secure;
@@ -53,7 +53,16 @@ class CCHelper {
     status_t getLocalTime(int64_t* localTime);
     status_t getLocalFreq(uint64_t* freq);
 
+    // Conversions between a number of audio frames at sampleRate and a duration in ticks of a
+    // clock running at freq (see getCommonFreq() and getLocalFreq()), rounded to the nearest
+    // tick or frame.  Unlike a conversion through floating point or microseconds, these stay
+    // exact to the frame for the frame positions of an AudioTrack timestamp.
+    static int64_t framesToTicks(int64_t frames, uint32_t sampleRate, uint64_t freq);
+    static int64_t ticksToFrames(int64_t ticks, uint64_t freq, uint32_t sampleRate);
+
   private:
+    static int64_t scale(int64_t value, uint64_t numerator, uint64_t denominator);
+
     class CommonClockListener : public BnCommonClockListener {
       public:
         void onTimelineChanged(uint64_t timelineID);
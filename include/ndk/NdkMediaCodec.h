@@ -249,6 +249,27 @@ media_status_t AMediaCodec_setParameters(
  */
 media_status_t AMediaCodec_signalEndOfInputStream(AMediaCodec *mData);
 
+/**
+ * Send |count| buffers to the codec for processing in one call, as if each were sent with
+ * AMediaCodec_queueInputBuffer. |idx| holds the indices of the buffers and |info| the offset,
+ * size, presentation time and flags of each.
+ *
+ * Stops at the first buffer that fails to be queued and returns its error. If |queued| is not
+ * NULL, it is set to the number of buffers that were queued.
+ */
+media_status_t AMediaCodec_queueInputBuffers(AMediaCodec*,
+        const size_t *idx, const AMediaCodecBufferInfo *info, size_t count, size_t *queued);
+
+/**
+ * Get up to |maxCount| buffers of processed data in one call, waiting up to |timeoutUs| for
+ * the first. The indices of the buffers are stored in |idx| and their info in |info|.
+ *
+ * Returns the number of buffers, or one of the AMEDIACODEC_INFO_* values or an error as
+ * AMediaCodec_dequeueOutputBuffer does if no buffer is returned.
+ */
+ssize_t AMediaCodec_dequeueOutputBuffers(AMediaCodec*,
+        size_t *idx, AMediaCodecBufferInfo *info, size_t maxCount, int64_t timeoutUs);
+
 
 
 typedef enum {
@@ -335,10 +335,15 @@ public:
         mTimestamp.clear();
     }
 
+    // Return the number of times obtainBuffer() was woken up by the server
+    uint32_t    getFutexWakeCount() const { return mFutexWakeCount; }
+
 private:
     // This is a copy of mCblk->mBufferSizeInFrames
     uint32_t   mBufferSizeInFrames;  // effective size of the buffer
 
+    uint32_t   mFutexWakeCount;      // see getFutexWakeCount()
+
     Modulo<uint32_t> mEpoch;
 
     // The shared buffer contents referred to by the timestamp observer
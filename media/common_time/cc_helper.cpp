@@ -126,4 +126,26 @@ CCHELPER_METHOD(getLocalTime(int64_t* localTime),
 CCHELPER_METHOD(getLocalFreq(uint64_t* freq),
                 getLocalFreq(freq))
 
+// Computes value * numerator / denominator, rounded to nearest, without the intermediate product
+// overflowing as long as numerator and denominator are below 2^32.
+int64_t CCHelper::scale(int64_t value, uint64_t numerator, uint64_t denominator) {
+    if (value < 0)
+        return -scale(-value, numerator, denominator);
+
+    uint64_t quotient = (uint64_t)value / denominator;
+    uint64_t remainder = (uint64_t)value % denominator;
+    return (int64_t)(quotient * numerator +
+                     (remainder * numerator + denominator / 2) / denominator);
+}
+
+int64_t CCHelper::framesToTicks(int64_t frames, uint32_t sampleRate, uint64_t freq) {
+    assert(sampleRate > 0);
+    return scale(frames, freq, sampleRate);
+}
+
+int64_t CCHelper::ticksToFrames(int64_t ticks, uint64_t freq, uint32_t sampleRate) {
+    assert(freq > 0);
+    return scale(ticks, sampleRate, freq);
+}
+
 }  // namespace android
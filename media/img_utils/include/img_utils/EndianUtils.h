@@ -131,34 +131,28 @@ class ANDROID_API EndianOutput : public Output {
 template<typename T>
 inline status_t EndianOutput::writeHelper(const T* buf, size_t offset, size_t count) {
     assert(offset <= count);
+    if (mEndian != BIG && mEndian != LITTLE) {
+        return BAD_VALUE;
+    }
     status_t res = OK;
     size_t size = sizeof(T);
-    switch(mEndian) {
-        case BIG: {
-            for (size_t i = offset; i < count; ++i) {
-                T tmp = convertToBigEndian<T>(buf[offset + i]);
-                if ((res = mOutput->write(reinterpret_cast<uint8_t*>(&tmp), 0, size))
-                        != OK) {
-                    return res;
-                }
-                mOffset += size;
-            }
-            break;
-        }
-        case LITTLE: {
-            for (size_t i = offset; i < count; ++i) {
-                T tmp = convertToLittleEndian<T>(buf[offset + i]);
-                if ((res = mOutput->write(reinterpret_cast<uint8_t*>(&tmp), 0, size))
-                        != OK) {
-                    return res;
-                }
-                mOffset += size;
-            }
-            break;
+    // Convert into a small buffer and write it out in chunks, rather than calling into the
+    // output once per value
+    const size_t CHUNK_COUNT = 256;
+    T tmp[CHUNK_COUNT];
+    size_t i = offset;
+    while (i < count) {
+        size_t chunk = count - i;
+        if (chunk > CHUNK_COUNT) chunk = CHUNK_COUNT;
+        for (size_t j = 0; j < chunk; ++j) {
+            tmp[j] = (mEndian == BIG) ? convertToBigEndian<T>(buf[offset + i + j]) :
+                    convertToLittleEndian<T>(buf[offset + i + j]);
         }
-        default: {
-            return BAD_VALUE;
+        if ((res = mOutput->write(reinterpret_cast<uint8_t*>(tmp), 0, chunk * size)) != OK) {
+            return res;
         }
+        mOffset += chunk * size;
+        i += chunk;
     }
     return res;
 }
@@ -173,6 +173,12 @@ aaudio_result_t AudioEndpoint::readUpCommand(AAudioServiceMessage *commandPtr)
     return mUpCommandQueue->read(commandPtr, 1);
 }
 
+aaudio_result_t AudioEndpoint::readUpCommands(AAudioServiceMessage *commands,
+                                              int32_t maxCommands)
+{
+    return mUpCommandQueue->read(commands, maxCommands);
+}
+
 aaudio_result_t AudioEndpoint::writeDataNow(const void *buffer, int32_t numFrames)
 {
     return mDataQueue->write(buffer, numFrames);
@@ -48,6 +48,12 @@ public:
      */
     aaudio_result_t readUpCommand(AAudioServiceMessage *commandPtr);
 
+    /**
+     * Non-blocking read of all the available commands, up to maxCommands, in one transfer.
+     * @return number of commands received, or negative error.
+     */
+    aaudio_result_t readUpCommands(AAudioServiceMessage *commands, int32_t maxCommands);
+
     /**
      * Non-blocking write.
      * @return framesWritten or a negative error code.
@@ -56,6 +56,9 @@ using namespace aaudio;
 
 #define LOG_TIMESTAMPS   0
 
+// Commands read from the service at once.
+#define MAX_COMMANDS_PER_READ    16
+
 AudioStreamInternal::AudioStreamInternal(AAudioServiceInterface  &serviceInterface, bool inService)
         : AudioStream()
         , mClockModel()
@@ -149,6 +152,9 @@ aaudio_result_t AudioStreamInternal::open(const AudioStreamBuilder &builder) {
 
         mClockModel.setSampleRate(getSampleRate());
         mClockModel.setFramesPerBurst(mFramesPerBurst);
+        mClockTuning = AAudioProperty_getClockTuning();
+        mClockModel.setAdaptiveMarginEnabled(mClockTuning != AAUDIO_CLOCK_TUNING_OFF);
+        mBufferSizeSet = false;
 
         if (getDataCallbackProc()) {
             mCallbackFrames = builder.getFramesPerDataCallback();
@@ -461,27 +467,39 @@ aaudio_result_t AudioStreamInternal::onEventFromServer(AAudioServiceMessage *mes
 // Process all the commands coming from the server.
 aaudio_result_t AudioStreamInternal::processCommands() {
     aaudio_result_t result = AAUDIO_OK;
+    AAudioServiceMessage messages[MAX_COMMANDS_PER_READ];
 
     while (result == AAUDIO_OK) {
         //ALOGD("AudioStreamInternal::processCommands() - looping, %d", result);
-        AAudioServiceMessage message;
-        if (mAudioEndpoint.readUpCommand(&message) != 1) {
+        int32_t count = mAudioEndpoint.readUpCommands(messages, MAX_COMMANDS_PER_READ);
+        if (count <= 0) {
             break; // no command this time, no problem
         }
-        switch (message.what) {
-        case AAudioServiceMessage::code::TIMESTAMP:
-            result = onTimestampFromServer(&message);
-            break;
+        for (int32_t i = 0; i < count && result == AAUDIO_OK; i++) {
+            AAudioServiceMessage *message = &messages[i];
+            switch (message->what) {
+            case AAudioServiceMessage::code::TIMESTAMP:
+                // If we fell behind, only the latest of consecutive timestamps is useful.
+                if (i + 1 < count
+                        && messages[i + 1].what == AAudioServiceMessage::code::TIMESTAMP) {
+                    break;
+                }
+                result = onTimestampFromServer(message);
+                break;
 
-        case AAudioServiceMessage::code::EVENT:
-            result = onEventFromServer(&message);
-            break;
+            case AAudioServiceMessage::code::EVENT:
+                result = onEventFromServer(message);
+                break;
 
-        default:
-            ALOGE("WARNING - AudioStreamInternal::processCommands() Unrecognized what = %d",
-                 (int) message.what);
-            result = AAUDIO_ERROR_INTERNAL;
-            break;
+            default:
+                ALOGE("WARNING - AudioStreamInternal::processCommands() Unrecognized what = %d",
+                     (int) message->what);
+                result = AAUDIO_ERROR_INTERNAL;
+                break;
+            }
+        }
+        if (count < MAX_COMMANDS_PER_READ) {
+            break; // the queue is empty
         }
     }
     return result;
@@ -554,9 +572,25 @@ aaudio_result_t AudioStreamInternal::processData(void *buffer, int32_t numFrames
 
 void AudioStreamInternal::processTimestamp(uint64_t position, int64_t time) {
     mClockModel.processTimestamp(position, time);
+
+    // Run at the smallest size that covers the timestamp jitter, unless the size was chosen.
+    if (mClockTuning == AAUDIO_CLOCK_TUNING_BUFFER && !mBufferSizeSet) {
+        int32_t recommendedFrames = mClockModel.getRecommendedBufferSize();
+        if (recommendedFrames > 0 && recommendedFrames != getBufferSize()) {
+            ALOGD("AudioStreamInternal::processTimestamp() margin = %d usec, recommend %d frames",
+                  mClockModel.getLatenessMarginNanos() / (int32_t) AAUDIO_NANOS_PER_MICROSECOND,
+                  recommendedFrames);
+            setBufferSizeInternal(recommendedFrames);
+        }
+    }
 }
 
 aaudio_result_t AudioStreamInternal::setBufferSize(int32_t requestedFrames) {
+    mBufferSizeSet = true;
+    return setBufferSizeInternal(requestedFrames);
+}
+
+aaudio_result_t AudioStreamInternal::setBufferSizeInternal(int32_t requestedFrames) {
     int32_t actualFrames = 0;
     // Round to the next highest burst size.
     if (getFramesPerBurst() > 0) {
@@ -26,6 +26,7 @@
 #include "client/IsochronousClockModel.h"
 #include "client/AudioEndpoint.h"
 #include "core/AudioStream.h"
+#include "utility/AAudioUtilities.h"
 #include "utility/LinearRamp.h"
 
 using android::sp;
@@ -155,12 +156,18 @@ private:
     // Adjust timing model based on timestamp from service.
     void processTimestamp(uint64_t position, int64_t time);
 
+    // Round up to a whole number of bursts and set the size of the data queue.
+    aaudio_result_t setBufferSizeInternal(int32_t requestedFrames);
+
     AudioEndpointParcelable  mEndPointParcelable; // description of the buffers filled by service
     EndpointDescriptor       mEndpointDescriptor; // buffer description with resolved addresses
     AAudioServiceInterface  &mServiceInterface;   // abstract interface to the service
 
     // The service uses this for SHARED mode.
     bool                     mInService = false;  // Is this running in the client or the service?
+
+    int32_t                  mClockTuning = AAUDIO_CLOCK_TUNING_OFF; // AudioClockModel feedback
+    bool                     mBufferSizeSet = false; // was setBufferSize() called?
 };
 
 } /* namespace aaudio */
@@ -18,6 +18,7 @@
 //#define LOG_NDEBUG 0
 #include <utils/Log.h>
 
+#include <algorithm>
 #include <stdint.h>
 
 #include "utility/AudioClock.h"
@@ -25,6 +26,18 @@
 
 #define MIN_LATENESS_NANOS (10 * AAUDIO_NANOS_PER_MICROSECOND)
 
+// Gains of the moving averages of the lateness, as in the TCP retransmission timer.
+#define LATENESS_MEAN_SHIFT       3   // 1/8
+#define LATENESS_DEVIATION_SHIFT  2   // 1/4
+// The peak decays by 1/64 per timestamp.
+#define LATENESS_PEAK_DECAY_SHIFT 6
+// The adaptive margin is the mean plus this many deviations.
+#define LATENESS_DEVIATIONS       4
+// Timestamps needed before the statistics are used.
+#define MIN_LATENESS_COUNT        16
+// The adaptive margin never exceeds this many bursts.
+#define MAX_LATENESS_BURSTS       4
+
 using namespace android;
 using namespace aaudio;
 
@@ -35,6 +48,11 @@ IsochronousClockModel::IsochronousClockModel()
         , mFramesPerBurst(64)
         , mMaxLatenessInNanos(0)
         , mState(STATE_STOPPED)
+        , mAdaptiveMarginEnabled(false)
+        , mLatenessCount(0)
+        , mLatenessMean(0)
+        , mLatenessDeviation(0)
+        , mLatenessPeak(0)
 {
 }
 
@@ -94,6 +112,7 @@ void IsochronousClockModel::processTimestamp(int64_t framePosition, int64_t nano
         }
         break;
     case STATE_RUNNING:
+        updateLateness(nanosDelta - expectedNanosDelta);
         if (nanosDelta < expectedNanosDelta) {
             // Earlier than expected timestamp.
             // This data is probably more accurate so use it.
@@ -126,11 +145,56 @@ void IsochronousClockModel::setFramesPerBurst(int32_t framesPerBurst) {
     update();
 }
 
+void IsochronousClockModel::setAdaptiveMarginEnabled(bool enabled) {
+    mAdaptiveMarginEnabled = enabled;
+    update();
+}
+
 void IsochronousClockModel::update() {
     int64_t nanosLate = convertDeltaPositionToTime(mFramesPerBurst); // uses mSampleRate
+    if (mAdaptiveMarginEnabled && mLatenessCount >= MIN_LATENESS_COUNT) {
+        int64_t maxNanosLate = MAX_LATENESS_BURSTS * nanosLate;
+        nanosLate = mLatenessMean + (LATENESS_DEVIATIONS * mLatenessDeviation);
+        if (nanosLate > maxNanosLate) {
+            nanosLate = maxNanosLate;
+        }
+    }
     mMaxLatenessInNanos = (nanosLate > MIN_LATENESS_NANOS) ? nanosLate : MIN_LATENESS_NANOS;
 }
 
+void IsochronousClockModel::updateLateness(int64_t latenessNanos) {
+    if (latenessNanos < 0) {
+        latenessNanos = 0; // early timestamps move the marker, so they are not jitter
+    }
+    if (mLatenessCount < MIN_LATENESS_COUNT) {
+        mLatenessCount++;
+    }
+    int64_t deviation = latenessNanos - mLatenessMean;
+    mLatenessMean += deviation >> LATENESS_MEAN_SHIFT;
+    if (deviation < 0) {
+        deviation = -deviation;
+    }
+    mLatenessDeviation += (deviation - mLatenessDeviation) >> LATENESS_DEVIATION_SHIFT;
+    mLatenessPeak -= mLatenessPeak >> LATENESS_PEAK_DECAY_SHIFT;
+    if (latenessNanos > mLatenessPeak) {
+        mLatenessPeak = latenessNanos;
+    }
+    if (mAdaptiveMarginEnabled) {
+        update();
+    }
+}
+
+int32_t IsochronousClockModel::getRecommendedBufferSize() const {
+    if (mLatenessCount < MIN_LATENESS_COUNT || mFramesPerBurst <= 0 || mSampleRate <= 0) {
+        return 0;
+    }
+    // One burst for the DSP, plus enough bursts to cover the worst recent lateness.
+    int64_t nanosPerBurst = convertDeltaPositionToTime(mFramesPerBurst);
+    int64_t jitterNanos = std::max(mLatenessPeak, (int64_t) mMaxLatenessInNanos);
+    int64_t numBursts = 1 + ((jitterNanos + nanosPerBurst - 1) / nanosPerBurst);
+    return (int32_t) (numBursts * mFramesPerBurst);
+}
+
 int64_t IsochronousClockModel::convertDeltaPositionToTime(
         int64_t framesDelta) const {
     return (AAUDIO_NANOS_PER_SECOND * framesDelta) / mSampleRate;
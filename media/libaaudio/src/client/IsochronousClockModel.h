@@ -86,6 +86,30 @@ public:
      */
     int64_t convertDeltaTimeToPosition(int64_t nanosDelta) const;
 
+    /**
+     * By default a timestamp is late if it comes more than one burst after the expected time.
+     * When enabled, the margin follows the lateness of the recent timestamps instead,
+     * so it grows on devices with bursty timestamps and shrinks on steady ones.
+     *
+     * @param enabled true to adapt the margin to the timestamp jitter
+     */
+    void setAdaptiveMarginEnabled(bool enabled);
+
+    /**
+     * @return current margin for late timestamps in nanoseconds
+     */
+    int32_t getLatenessMarginNanos() const {
+        return mMaxLatenessInNanos;
+    }
+
+    /**
+     * Calculate the smallest buffer size that covers the timestamp jitter seen recently.
+     * The lateness statistics are tracked whether or not the margin is adaptive.
+     *
+     * @return size in frames, a multiple of the burst size, or 0 if not known yet
+     */
+    int32_t getRecommendedBufferSize() const;
+
 private:
     enum clock_model_state_t {
         STATE_STOPPED,
@@ -101,7 +125,16 @@ private:
     int32_t             mMaxLatenessInNanos;
     clock_model_state_t mState;
 
+    // Statistics on how late the timestamps are, in nanoseconds.
+    bool                mAdaptiveMarginEnabled;
+    int32_t             mLatenessCount;     // saturates
+    int64_t             mLatenessMean;      // moving average
+    int64_t             mLatenessDeviation; // moving average of the absolute deviation
+    int64_t             mLatenessPeak;      // decays slowly
+
     void update();
+
+    void updateLateness(int64_t latenessNanos);
 };
 
 } /* namespace aaudio */
@@ -14,7 +14,10 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cstring>
+#include <errno.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 
@@ -22,6 +25,8 @@
 //#define LOG_NDEBUG 0
 #include <utils/Log.h>
 
+#include <cutils/ashmem.h>
+
 #include "FifoControllerBase.h"
 #include "FifoController.h"
 #include "FifoControllerIndirect.h"
@@ -29,10 +34,45 @@
 
 using namespace android; // TODO just import names needed
 
-FifoBuffer::FifoBuffer(int32_t bytesPerFrame, fifo_frames_t capacityInFrames)
+// Map a new shared memory region twice, back to back.
+// Returns nullptr if that is not possible.
+static uint8_t *FifoBuffer_allocateMirrored(int32_t bytesPerBuffer) {
+    if (bytesPerBuffer <= 0 || (bytesPerBuffer % getpagesize()) != 0) {
+        ALOGW("FifoBuffer: cannot mirror %d bytes", bytesPerBuffer);
+        return nullptr;
+    }
+    int fd = ashmem_create_region("FifoBuffer", bytesPerBuffer);
+    if (fd < 0) {
+        ALOGE("FifoBuffer: ashmem_create_region() failed %d", errno);
+        return nullptr;
+    }
+    // Reserve the address range, then map the region over each half of it.
+    uint8_t *storage = (uint8_t *) mmap(nullptr, 2 * bytesPerBuffer, PROT_NONE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (storage == MAP_FAILED) {
+        ALOGE("FifoBuffer: mmap() of %d bytes failed %d", 2 * bytesPerBuffer, errno);
+        storage = nullptr;
+    } else {
+        for (int i = 0; i < 2; i++) {
+            void *half = mmap(storage + i * bytesPerBuffer, bytesPerBuffer,
+                              PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+            if (half == MAP_FAILED) {
+                ALOGE("FifoBuffer: mmap() of half %d failed %d", i, errno);
+                munmap(storage, 2 * bytesPerBuffer);
+                storage = nullptr;
+                break;
+            }
+        }
+    }
+    close(fd); // the mappings keep the region alive
+    return storage;
+}
+
+FifoBuffer::FifoBuffer(int32_t bytesPerFrame, fifo_frames_t capacityInFrames, bool mirrored)
         : mFrameCapacity(capacityInFrames)
         , mBytesPerFrame(bytesPerFrame)
         , mStorage(nullptr)
+        , mMirrored(false)
         , mFramesReadCount(0)
         , mFramesUnderrunCount(0)
         , mUnderrunCount(0)
@@ -41,10 +81,16 @@ FifoBuffer::FifoBuffer(int32_t bytesPerFrame, fifo_frames_t capacityInFrames)
     mFifo = new FifoController(capacityInFrames, capacityInFrames);
     // allocate buffer
     int32_t bytesPerBuffer = bytesPerFrame * capacityInFrames;
-    mStorage = new uint8_t[bytesPerBuffer];
+    if (mirrored) {
+        mStorage = FifoBuffer_allocateMirrored(bytesPerBuffer);
+        mMirrored = (mStorage != nullptr);
+    }
+    if (mStorage == nullptr) {
+        mStorage = new uint8_t[bytesPerBuffer];
+    }
     mStorageOwned = true;
-    ALOGD("FifoBuffer: capacityInFrames = %d, bytesPerFrame = %d",
-          capacityInFrames, bytesPerFrame);
+    ALOGD("FifoBuffer: capacityInFrames = %d, bytesPerFrame = %d, mirrored = %d",
+          capacityInFrames, bytesPerFrame, mMirrored);
 }
 
 FifoBuffer::FifoBuffer( int32_t   bytesPerFrame,
@@ -56,6 +102,7 @@ FifoBuffer::FifoBuffer( int32_t   bytesPerFrame,
         : mFrameCapacity(capacityInFrames)
         , mBytesPerFrame(bytesPerFrame)
         , mStorage(static_cast<uint8_t *>(dataStorageAddress))
+        , mMirrored(false)
         , mFramesReadCount(0)
         , mFramesUnderrunCount(0)
         , mUnderrunCount(0)
@@ -68,7 +115,9 @@ FifoBuffer::FifoBuffer( int32_t   bytesPerFrame,
 }
 
 FifoBuffer::~FifoBuffer() {
-    if (mStorageOwned) {
+    if (mMirrored) {
+        munmap(mStorage, 2 * convertFramesToBytes(mFrameCapacity));
+    } else if (mStorageOwned) {
         delete[] mStorage;
     }
     delete mFifo;
@@ -88,11 +137,12 @@ void FifoBuffer::fillWrappingBuffer(WrappingBuffer *wrappingBuffer,
 
         uint8_t *source = &mStorage[convertFramesToBytes(startIndex)];
         // Does the available data cross the end of the FIFO?
-        if ((startIndex + framesAvailable) > mFrameCapacity) {
+        // The mirror of the storage makes it contiguous anyway.
+        if (!mMirrored && (startIndex + framesAvailable) > mFrameCapacity) {
             wrappingBuffer->data[0] = source;
             wrappingBuffer->numFrames[0] = mFrameCapacity - startIndex;
             wrappingBuffer->data[1] = &mStorage[0];
-            wrappingBuffer->numFrames[1] = mFrameCapacity - startIndex;
+            wrappingBuffer->numFrames[1] = framesAvailable - wrappingBuffer->numFrames[0];
 
         } else {
             wrappingBuffer->data[0] = source;
@@ -118,6 +168,17 @@ void FifoBuffer::getEmptyRoomAvailable(WrappingBuffer *wrappingBuffer) {
 }
 
 fifo_frames_t FifoBuffer::read(void *buffer, fifo_frames_t numFrames) {
+    if (mMirrored) {
+        fifo_frames_t framesRead = std::min(numFrames, mFifo->getFullFramesAvailable());
+        if (framesRead <= 0) {
+            return 0;
+        }
+        memcpy(buffer, &mStorage[convertFramesToBytes(mFifo->getReadIndex())],
+               convertFramesToBytes(framesRead));
+        mFifo->advanceReadIndex(framesRead);
+        return framesRead;
+    }
+
     WrappingBuffer wrappingBuffer;
     uint8_t *destination = (uint8_t *) buffer;
     fifo_frames_t framesLeft = numFrames;
@@ -149,6 +210,17 @@ fifo_frames_t FifoBuffer::read(void *buffer, fifo_frames_t numFrames) {
 }
 
 fifo_frames_t FifoBuffer::write(const void *buffer, fifo_frames_t numFrames) {
+    if (mMirrored) {
+        fifo_frames_t framesWritten = std::min(numFrames, mFifo->getEmptyFramesAvailable());
+        if (framesWritten <= 0) {
+            return 0;
+        }
+        memcpy(&mStorage[convertFramesToBytes(mFifo->getWriteIndex())], buffer,
+               convertFramesToBytes(framesWritten));
+        mFifo->advanceWriteIndex(framesWritten);
+        return framesWritten;
+    }
+
     WrappingBuffer wrappingBuffer;
     uint8_t *source = (uint8_t *) buffer;
     fifo_frames_t framesLeft = numFrames;
@@ -208,3 +280,17 @@ fifo_frames_t FifoBuffer::getBufferCapacityInFrames() {
     return mFifo->getCapacity();
 }
 
+fifo_frames_t FifoBuffer::getMirroredCapacity(int32_t bytesPerFrame,
+                                              fifo_frames_t capacityInFrames) {
+    // The storage must be a whole number of pages, and of frames.
+    int32_t pageSize = getpagesize();
+    int32_t a = pageSize;
+    int32_t b = bytesPerFrame;
+    while (b != 0) {
+        int32_t remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    fifo_frames_t framesPerUnit = pageSize / a; // a is gcd(pageSize, bytesPerFrame)
+    return ((capacityInFrames + framesPerUnit - 1) / framesPerUnit) * framesPerUnit;
+}
@@ -37,7 +37,17 @@ struct WrappingBuffer {
 
 class FifoBuffer {
 public:
-    FifoBuffer(int32_t bytesPerFrame, fifo_frames_t capacityInFrames);
+    /**
+     * Allocate the storage of the FIFO.
+     *
+     * If mirrored is true, the storage is mapped twice, back to back, so that any span of
+     * up to capacityInFrames frames in the FIFO is contiguous in memory. Then read() and write()
+     * do a single copy, and getFullDataAvailable() and getEmptyRoomAvailable() always return
+     * a single part, which can be processed in place.
+     * This falls back to normal storage if the size of the storage is not a multiple of the
+     * page size, see getMirroredCapacity(), or if it cannot be mapped. See isMirrored().
+     */
+    FifoBuffer(int32_t bytesPerFrame, fifo_frames_t capacityInFrames, bool mirrored = false);
 
     FifoBuffer(int32_t bytesPerFrame,
                fifo_frames_t capacityInFrames,
@@ -59,6 +69,14 @@ public:
 
     fifo_frames_t getBufferCapacityInFrames();
 
+    bool isMirrored() const { return mMirrored; }
+
+    /**
+     * @return the smallest capacity >= capacityInFrames for which the storage can be mirrored
+     */
+    static fifo_frames_t getMirroredCapacity(int32_t bytesPerFrame,
+                                             fifo_frames_t capacityInFrames);
+
     /**
      * Return pointer to available full frames in data1 and set size in numFrames1.
      * if the data is split across the end of the FIFO then set data2 and numFrames2.
@@ -118,6 +136,7 @@ private:
     const int32_t mBytesPerFrame;
     uint8_t *mStorage;
     bool mStorageOwned; // did this object allocate the storage?
+    bool mMirrored;     // is the storage mapped twice?
     FifoControllerBase *mFifo;
     fifo_counter_t mFramesReadCount;
     fifo_counter_t mFramesUnderrunCount;
@@ -371,3 +371,24 @@ int32_t AAudioProperty_getHardwareBurstMinMicros() {
     }
     return prop;
 }
+
+int32_t AAudioProperty_getMixerThreads() {
+    const int32_t defaultThreads = 1;
+    const int32_t maxThreads = 8; // arbitrary
+    int32_t prop = property_get_int32(AAUDIO_PROP_MIXER_THREADS, defaultThreads);
+    if (prop < 1 || prop > maxThreads) {
+        ALOGE("AAudioProperty_getMixerThreads: invalid = %d", prop);
+        prop = defaultThreads;
+    }
+    return prop;
+}
+
+int32_t AAudioProperty_getClockTuning() {
+    const int32_t defaultTuning = AAUDIO_CLOCK_TUNING_OFF;
+    int32_t prop = property_get_int32(AAUDIO_PROP_CLOCK_TUNING, defaultTuning);
+    if (prop < AAUDIO_CLOCK_TUNING_OFF || prop > AAUDIO_CLOCK_TUNING_BUFFER) {
+        ALOGE("AAudioProperty_getClockTuning: invalid = %d", prop);
+        prop = defaultTuning;
+    }
+    return prop;
+}
@@ -211,4 +211,31 @@ int32_t AAudioProperty_getMixerBursts();
  */
 int32_t AAudioProperty_getHardwareBurstMinMicros();
 
+#define AAUDIO_PROP_MIXER_THREADS          "aaudio.mixer_threads"
+
+/**
+ * Read system property.
+ * The streams of a shared output endpoint are split between this many mixer threads
+ * when there are enough of them.
+ *
+ * @return number of threads mixing a shared output endpoint, 1 to mix on a single thread
+ */
+int32_t AAudioProperty_getMixerThreads();
+
+#define AAUDIO_PROP_CLOCK_TUNING           "aaudio.clock_tuning"
+
+enum {
+    AAUDIO_CLOCK_TUNING_OFF = 0,    // late timestamps have a fixed margin of one burst
+    AAUDIO_CLOCK_TUNING_MARGIN = 1, // the margin follows the jitter of the timestamps
+    AAUDIO_CLOCK_TUNING_BUFFER = 2, // also use the recommended buffer size, until the app sets one
+};
+
+/**
+ * Read system property.
+ * This controls how the client follows the timestamps of the DSP.
+ *
+ * @return AAUDIO_CLOCK_TUNING_OFF, AAUDIO_CLOCK_TUNING_MARGIN or AAUDIO_CLOCK_TUNING_BUFFER
+ */
+int32_t AAudioProperty_getClockTuning();
+
 #endif //UTILITY_AAUDIO_UTILITIES_H
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit tests for the AAudio FifoBuffer.
+
+#include <stdint.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fifo/FifoBuffer.h"
+
+using android::fifo_frames_t;
+using android::FifoBuffer;
+using android::WrappingBuffer;
+
+static const int32_t kBytesPerFrame = 2 * sizeof(int16_t); // stereo
+
+static void fillRamp(int16_t *buffer, int32_t numSamples, int16_t first) {
+    for (int32_t i = 0; i < numSamples; i++) {
+        buffer[i] = first + i;
+    }
+}
+
+// Write and read across the end of the storage, many times.
+static void checkWrapping(FifoBuffer *fifo) {
+    const fifo_frames_t capacity = fifo->getBufferCapacityInFrames();
+    const fifo_frames_t chunk = capacity / 3 + 1; // does not divide the capacity
+    std::vector<int16_t> source(chunk * 2);
+    std::vector<int16_t> destination(chunk * 2);
+    int16_t next = 0;
+    for (int i = 0; i < 10; i++) {
+        fillRamp(source.data(), source.size(), next);
+        ASSERT_EQ(chunk, fifo->write(source.data(), chunk));
+
+        WrappingBuffer wrappingBuffer;
+        fifo->getFullDataAvailable(&wrappingBuffer);
+        ASSERT_EQ(chunk, wrappingBuffer.numFrames[0] + wrappingBuffer.numFrames[1]);
+        if (fifo->isMirrored()) {
+            ASSERT_EQ(chunk, wrappingBuffer.numFrames[0]);
+            ASSERT_EQ(next, ((int16_t *) wrappingBuffer.data[0])[0]);
+            ASSERT_EQ((int16_t) (next + chunk * 2 - 1),
+                      ((int16_t *) wrappingBuffer.data[0])[chunk * 2 - 1]);
+        }
+
+        ASSERT_EQ(chunk, fifo->read(destination.data(), chunk));
+        for (size_t j = 0; j < destination.size(); j++) {
+            ASSERT_EQ(source[j], destination[j]);
+        }
+        next += source.size();
+    }
+}
+
+TEST(test_fifo_buffer, fifo_wrapping) {
+    FifoBuffer fifo(kBytesPerFrame, 100);
+    ASSERT_FALSE(fifo.isMirrored());
+    checkWrapping(&fifo);
+}
+
+TEST(test_fifo_buffer, fifo_mirrored_wrapping) {
+    fifo_frames_t capacity = FifoBuffer::getMirroredCapacity(kBytesPerFrame, 100);
+    ASSERT_LE(100, capacity);
+    FifoBuffer fifo(kBytesPerFrame, capacity, true /* mirrored */);
+    ASSERT_TRUE(fifo.isMirrored());
+    checkWrapping(&fifo);
+}
+
+TEST(test_fifo_buffer, fifo_mirrored_fallback) {
+    // 3 bytes per frame never fills a whole page with 100 frames
+    FifoBuffer fifo(3, 100, true /* mirrored */);
+    ASSERT_FALSE(fifo.isMirrored());
+}
+
+TEST(test_fifo_buffer, fifo_full) {
+    fifo_frames_t capacity = FifoBuffer::getMirroredCapacity(kBytesPerFrame, 1);
+    FifoBuffer fifo(kBytesPerFrame, capacity, true /* mirrored */);
+    std::vector<int16_t> buffer((capacity + 1) * 2);
+    ASSERT_EQ(capacity, fifo.write(buffer.data(), capacity + 1));
+    ASSERT_EQ(0, fifo.write(buffer.data(), 1));
+    ASSERT_EQ(capacity, fifo.read(buffer.data(), capacity + 1));
+    ASSERT_EQ(0, fifo.read(buffer.data(), 1));
+}
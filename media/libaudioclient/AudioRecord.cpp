@@ -928,6 +928,56 @@ ssize_t AudioRecord::read(void* buffer, size_t userSize, bool blocking)
     return read;
 }
 
+status_t AudioRecord::obtainCaptureSpan(CaptureSpan *span, size_t maxFrames, bool blocking)
+{
+    if (span == NULL) {
+        return BAD_VALUE;
+    }
+    span->frameCount = 0;
+    span->data = NULL;
+    span->position = mFramesRead;
+    span->overrun = false;
+    if (mTransfer != TRANSFER_SYNC) {
+        return INVALID_OPERATION;
+    }
+    if (maxFrames == 0) {
+        return BAD_VALUE;
+    }
+
+    Buffer audioBuffer;
+    audioBuffer.frameCount = maxFrames;
+    status_t err = obtainBuffer(&audioBuffer,
+            blocking ? &ClientProxy::kForever : &ClientProxy::kNonBlocking);
+    if (err < 0) {
+        if (err == TIMED_OUT || err == -EINTR) {
+            err = WOULD_BLOCK;
+        }
+        return err;
+    }
+
+    span->frameCount = audioBuffer.frameCount;
+    span->data = audioBuffer.raw;
+    {
+        AutoMutex lock(mLock);
+        // there is no callback thread in TRANSFER_SYNC mode to report the overrun
+        span->overrun = (android_atomic_and(~CBLK_OVERRUN, &mCblk->mFlags) & CBLK_OVERRUN) != 0;
+    }
+    return NO_ERROR;
+}
+
+void AudioRecord::releaseCaptureSpan(const CaptureSpan *span)
+{
+    if (mTransfer != TRANSFER_SYNC || span == NULL || span->frameCount == 0) {
+        return;
+    }
+    Buffer audioBuffer;
+    audioBuffer.frameCount = span->frameCount;
+    audioBuffer.size = span->frameCount * mFrameSize;
+    audioBuffer.raw = const_cast<void *>(span->data);
+    releaseBuffer(&audioBuffer);
+    mFramesRead += span->frameCount;
+}
+
 // -------------------------------------------------------------------------
 
 nsecs_t AudioRecord::processAudioBuffer()
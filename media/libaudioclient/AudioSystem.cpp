@@ -166,6 +166,19 @@ status_t AudioSystem::setStreamVolume(audio_stream_type_t stream, float value,
     return NO_ERROR;
 }
 
+status_t AudioSystem::setStreamVolumes(const Vector<audio_stream_type_t>& streams,
+        const Vector<float>& values, audio_io_handle_t output)
+{
+    if (streams.size() != values.size()) return BAD_VALUE;
+    for (size_t i = 0; i < streams.size(); i++) {
+        if (uint32_t(streams[i]) >= AUDIO_STREAM_CNT) return BAD_VALUE;
+    }
+    const sp<IAudioFlinger>& af = AudioSystem::get_audio_flinger();
+    if (af == 0) return PERMISSION_DENIED;
+    af->setStreamVolumes(streams, values, output);
+    return NO_ERROR;
+}
+
 status_t AudioSystem::setStreamMute(audio_stream_type_t stream, bool mute)
 {
     if (uint32_t(stream) >= AUDIO_STREAM_CNT) return BAD_VALUE;
@@ -261,7 +274,7 @@ status_t AudioSystem::getOutputSamplingRate(uint32_t* samplingRate, audio_stream
         streamType = AUDIO_STREAM_MUSIC;
     }
 
-    output = getOutput(streamType);
+    output = getOutputForStream(streamType);
     if (output == 0) {
         return PERMISSION_DENIED;
     }
@@ -269,6 +282,15 @@ status_t AudioSystem::getOutputSamplingRate(uint32_t* samplingRate, audio_stream
     return getSamplingRate(output, samplingRate);
 }
 
+audio_io_handle_t AudioSystem::getOutputForStream(audio_stream_type_t streamType)
+{
+    const sp<AudioFlingerClient> afc = getAudioFlingerClient();
+    if (afc == 0) {
+        return getOutput(streamType);
+    }
+    return afc->getOutputForStream(streamType);
+}
+
 status_t AudioSystem::getSamplingRate(audio_io_handle_t ioHandle,
                                       uint32_t* samplingRate)
 {
@@ -298,7 +320,7 @@ status_t AudioSystem::getOutputFrameCount(size_t* frameCount, audio_stream_type_
         streamType = AUDIO_STREAM_MUSIC;
     }
 
-    output = getOutput(streamType);
+    output = getOutputForStream(streamType);
     if (output == AUDIO_IO_HANDLE_NONE) {
         return PERMISSION_DENIED;
     }
@@ -335,7 +357,7 @@ status_t AudioSystem::getOutputLatency(uint32_t* latency, audio_stream_type_t st
         streamType = AUDIO_STREAM_MUSIC;
     }
 
-    output = getOutput(streamType);
+    output = getOutputForStream(streamType);
     if (output == AUDIO_IO_HANDLE_NONE) {
         return PERMISSION_DENIED;
     }
@@ -466,6 +488,47 @@ void AudioSystem::AudioFlingerClient::clearIoCache()
     mInSamplingRate = 0;
     mInFormat = AUDIO_FORMAT_DEFAULT;
     mInChannelMask = AUDIO_CHANNEL_NONE;
+    clearStreamOutputs_l();
+}
+
+void AudioSystem::AudioFlingerClient::clearStreamOutputs()
+{
+    Mutex::Autolock _l(mLock);
+    clearStreamOutputs_l();
+}
+
+void AudioSystem::AudioFlingerClient::clearStreamOutputs_l()
+{
+    for (size_t i = 0; i < AUDIO_STREAM_CNT; i++) {
+        mStreamOutputs[i] = AUDIO_IO_HANDLE_NONE;
+        mStreamOutputTimesNs[i] = 0;
+    }
+}
+
+audio_io_handle_t AudioSystem::AudioFlingerClient::getOutputForStream(
+        audio_stream_type_t stream)
+{
+    if (uint32_t(stream) >= AUDIO_STREAM_CNT) {
+        return AudioSystem::getOutput(stream);
+    }
+    // Apps query the output parameters for a stream type repeatedly, e.g. to compute minimum
+    // buffer sizes, so save a round trip to audio policy for each of them.
+    const nsecs_t now = systemTime();
+    {
+        Mutex::Autolock _l(mLock);
+        if (mStreamOutputs[stream] != AUDIO_IO_HANDLE_NONE
+                && now - mStreamOutputTimesNs[stream] < kStreamOutputCacheNs) {
+            return mStreamOutputs[stream];
+        }
+    }
+    audio_io_handle_t output = AudioSystem::getOutput(stream);
+    if (output != AUDIO_IO_HANDLE_NONE) {
+        // A benign race is possible here: we could overwrite a fresher cache entry
+        Mutex::Autolock _l(mLock);
+        mStreamOutputs[stream] = output;
+        mStreamOutputTimesNs[stream] = now;
+    }
+    return output;
 }
 
 void AudioSystem::AudioFlingerClient::binderDied(const wp<IBinder>& who __unused)
@@ -498,6 +561,12 @@ void AudioSystem::AudioFlingerClient::ioConfigChanged(audio_io_config_event even
     {
         Mutex::Autolock _l(mLock);
 
+        // outputs selected for stream types may differ once outputs come, go or change devices
+        if (event == AUDIO_OUTPUT_OPENED || event == AUDIO_OUTPUT_CLOSED
+                || event == AUDIO_OUTPUT_CONFIG_CHANGED) {
+            clearStreamOutputs_l();
+        }
+
         switch (event) {
         case AUDIO_OUTPUT_OPENED:
         case AUDIO_INPUT_OPENED: {
@@ -1316,6 +1385,12 @@ void AudioSystem::AudioPolicyServiceClient::binderDied(const wp<IBinder>& who __
         Mutex::Autolock _l(gLockAPS);
         AudioSystem::gAudioPolicyService.clear();
     }
+    {
+        Mutex::Autolock _l(gLock);
+        if (gAudioFlingerClient != 0) {
+            gAudioFlingerClient->clearStreamOutputs();
+        }
+    }
 
     ALOGW("AudioPolicyService server died!");
 }
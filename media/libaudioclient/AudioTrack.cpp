@@ -491,6 +491,7 @@ status_t AudioTrack::set(
                 notificationFrames, minNotificationsPerBuffer, maxNotificationsPerBuffer);
     }
     mNotificationFramesAct = 0;
+    mWakeupFraction = 0.0f;
     if (sessionId == AUDIO_SESSION_ALLOCATE) {
         mSessionId = (audio_session_t) AudioSystem::newAudioUniqueId(AUDIO_UNIQUE_ID_USE_SESSION);
     } else {
@@ -985,6 +986,33 @@ ssize_t AudioTrack::setBufferSizeInFrames(size_t bufferSizeInFrames)
     return (ssize_t) mProxy->setBufferSizeInFrames((uint32_t) bufferSizeInFrames);
 }
 
+status_t AudioTrack::setWakeupFraction(float fraction)
+{
+    if (!(fraction >= 0.0f && fraction <= 1.0f)) {
+        return BAD_VALUE;
+    }
+    if (mTransfer != TRANSFER_SYNC && mTransfer != TRANSFER_OBTAIN) {
+        return INVALID_OPERATION;
+    }
+    AutoMutex lock(mLock);
+    if (mProxy.get() == 0) {
+        return NO_INIT;
+    }
+    mWakeupFraction = fraction;
+    updateMinimum_l();
+    return NO_ERROR;
+}
+
+void AudioTrack::updateMinimum_l()
+{
+    size_t minimum = mNotificationFramesAct;
+    if (mWakeupFraction > 0.0f) {
+        // the server caps the minimum to half of the buffer
+        minimum = max(minimum, (size_t) (mWakeupFraction * mFrameCount));
+    }
+    mProxy->setMinimum(minimum);
+}
+
 status_t AudioTrack::setLoop(uint32_t loopStart, uint32_t loopEnd, int loopCount)
 {
     if (mSharedBuffer == 0 || isOffloadedOrDirect()) {
@@ -1578,7 +1606,8 @@ status_t AudioTrack::createTrack_l()
     playbackRateTemp.mSpeed = effectiveSpeed;
     playbackRateTemp.mPitch = effectivePitch;
     mProxy->setPlaybackRate(playbackRateTemp);
-    mProxy->setMinimum(mNotificationFramesAct);
+    updateMinimum_l();
+    mProxyCreatedNs = systemTime();
 
     mDeathNotifier = new DeathNotifier(this);
     IInterface::asBinder(mAudioTrack)->linkToDeath(mDeathNotifier, this);
@@ -2731,6 +2760,14 @@ status_t AudioTrack::dump(int fd, const Vector<String16>& args __unused) const
     result.append(buffer);
     snprintf(buffer, 255, "  state(%d), latency (%d)\n", mState, mLatency);
     result.append(buffer);
+    if (mProxy != 0) {
+        const uint32_t wakeCount = mProxy->getFutexWakeCount();
+        const nsecs_t elapsedNs = systemTime() - mProxyCreatedNs;
+        snprintf(buffer, 255, "  futex wakes(%u), per second(%.2f), wakeup fraction(%.2f)\n",
+                wakeCount, elapsedNs > 0 ? wakeCount * 1e9 / elapsedNs : 0.0,
+                mWakeupFraction);
+        result.append(buffer);
+    }
     ::write(fd, result.string(), result.size());
     return NO_ERROR;
 }
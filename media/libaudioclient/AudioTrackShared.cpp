@@ -69,6 +69,7 @@ Proxy::Proxy(audio_track_cblk_t* cblk, void *buffers, size_t frameCount, size_t
 ClientProxy::ClientProxy(audio_track_cblk_t* cblk, void *buffers, size_t frameCount,
         size_t frameSize, bool isOut, bool clientInServer)
     : Proxy(cblk, buffers, frameCount, frameSize, isOut, clientInServer)
+    , mFutexWakeCount(0)
     , mEpoch(0)
     , mTimestampObserver(&cblk->mExtendedTimestampQueue)
 {
@@ -299,6 +300,8 @@ status_t ClientProxy::obtainBuffer(Buffer* buffer, const struct timespec *reques
             }
             switch (error) {
             case 0:            // normal wakeup by server, or by binderDied()
+                mFutexWakeCount++;
+                break;
             case EWOULDBLOCK:  // benign race condition with server
             case EINTR:        // wait was interrupted by signal or other spurious wakeup
             case ETIMEDOUT:    // time-out expired
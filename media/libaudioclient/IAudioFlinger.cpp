@@ -83,6 +83,7 @@ enum {
     GET_AUDIO_HW_SYNC,
     SYSTEM_READY,
     FRAME_COUNT_HAL,
+    SET_STREAM_VOLUMES,
 };
 
 #define MAX_ITEMS_PER_LIST 1024
@@ -358,6 +359,27 @@ public:
         return reply.readInt32();
     }
 
+    virtual status_t setStreamVolumes(const Vector<audio_stream_type_t>& streams,
+            const Vector<float>& values, audio_io_handle_t output)
+    {
+        if (streams.size() != values.size()) {
+            return BAD_VALUE;
+        }
+        Parcel data, reply;
+        data.writeInterfaceToken(IAudioFlinger::getInterfaceDescriptor());
+        data.writeInt32((int32_t) output);
+        data.writeInt32((int32_t) streams.size());
+        for (size_t i = 0; i < streams.size(); i++) {
+            data.writeInt32((int32_t) streams[i]);
+            data.writeFloat(values[i]);
+        }
+        status_t status = remote()->transact(SET_STREAM_VOLUMES, data, &reply);
+        if (status != NO_ERROR) {
+            return status;
+        }
+        return reply.readInt32();
+    }
+
     virtual status_t setStreamMute(audio_stream_type_t stream, bool muted)
     {
         Parcel data, reply;
@@ -954,6 +976,7 @@ status_t BnAudioFlinger::onTransact(
         case SET_MASTER_VOLUME:
         case SET_MASTER_MUTE:
         case SET_STREAM_VOLUME:
+        case SET_STREAM_VOLUMES:
         case SET_STREAM_MUTE:
         case SET_MIC_MUTE:
         case SET_PARAMETERS:
@@ -1091,6 +1114,23 @@ status_t BnAudioFlinger::onTransact(
             reply->writeInt32( setStreamVolume((audio_stream_type_t) stream, volume, output) );
             return NO_ERROR;
         } break;
+        case SET_STREAM_VOLUMES: {
+            CHECK_INTERFACE(IAudioFlinger, data, reply);
+            audio_io_handle_t output = (audio_io_handle_t) data.readInt32();
+            uint32_t count = (uint32_t) data.readInt32();
+            if (count > AUDIO_STREAM_CNT) {
+                reply->writeInt32(BAD_VALUE);
+                return NO_ERROR;
+            }
+            Vector<audio_stream_type_t> streams;
+            Vector<float> volumes;
+            for (uint32_t i = 0; i < count; i++) {
+                streams.add((audio_stream_type_t) data.readInt32());
+                volumes.add(data.readFloat());
+            }
+            reply->writeInt32( setStreamVolumes(streams, volumes, output) );
+            return NO_ERROR;
+        } break;
         case SET_STREAM_MUTE: {
             CHECK_INTERFACE(IAudioFlinger, data, reply);
             int stream = data.readInt32();
@@ -1222,11 +1222,13 @@ void ToneGenerator::audioCallback(int event, void* user, void *info) {
                 unsigned int lFreqIdx = 0;
                 unsigned short lFrequency = lpToneDesc->segments[lpToneGen->mCurSegment].waveFreq[lFreqIdx];
 
-                while (lFrequency != 0) {
-                    WaveGenerator *lpWaveGen = lpToneGen->mWaveGens.valueFor(lFrequency);
-                    lpWaveGen->getSamples(lpOut, lGenSmp, lWaveCmd);
+                WaveGenerator *lpWaveGens[TONEGEN_MAX_WAVES];
+                unsigned int lNumWaveGens = 0;
+                while (lFrequency != 0 && lNumWaveGens < TONEGEN_MAX_WAVES) {
+                    lpWaveGens[lNumWaveGens++] = lpToneGen->mWaveGens.valueFor(lFrequency);
                     lFrequency = lpToneDesc->segments[lpToneGen->mCurSegment].waveFreq[++lFreqIdx];
                 }
+                WaveGenerator::mixSamples(lpWaveGens, lNumWaveGens, lpOut, lGenSmp, lWaveCmd);
                 ALOGV("ON->OFF, lGenSmp: %d, lReqSmp: %d", lGenSmp, lReqSmp);
             }
 
@@ -1308,11 +1310,13 @@ void ToneGenerator::audioCallback(int event, void* user, void *info) {
             unsigned int lFreqIdx = 0;
             unsigned short lFrequency = lpToneDesc->segments[lpToneGen->mCurSegment].waveFreq[lFreqIdx];
 
-            while (lFrequency != 0) {
-                WaveGenerator *lpWaveGen = lpToneGen->mWaveGens.valueFor(lFrequency);
-                lpWaveGen->getSamples(lpOut, lGenSmp, lWaveCmd);
+            WaveGenerator *lpWaveGens[TONEGEN_MAX_WAVES];
+            unsigned int lNumWaveGens = 0;
+            while (lFrequency != 0 && lNumWaveGens < TONEGEN_MAX_WAVES) {
+                lpWaveGens[lNumWaveGens++] = lpToneGen->mWaveGens.valueFor(lFrequency);
                 lFrequency = lpToneDesc->segments[lpToneGen->mCurSegment].waveFreq[++lFreqIdx];
             }
+            WaveGenerator::mixSamples(lpWaveGens, lNumWaveGens, lpOut, lGenSmp, lWaveCmd);
         }
 
         lNumSmp -= lReqSmp;
@@ -1603,54 +1607,101 @@ ToneGenerator::WaveGenerator::~WaveGenerator() {
 ////////////////////////////////////////////////////////////////////////////////
 void ToneGenerator::WaveGenerator::getSamples(short *outBuffer,
         unsigned int count, unsigned int command) {
-    long lS1, lS2;
-    long lA1, lAmplitude;
+    WaveGenerator *lpWaveGen = this;
+    mixSamples(&lpWaveGen, 1, outBuffer, count, command);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//    Method:        WaveGenerator::mixSamples()
+//
+//    Description:    Generates count samples of the sine waves of several
+//        generators and accumulates their sum in outBuffer. The generators run
+//        side by side, so that outBuffer is read and written only once.
+//
+//    Input:
+//        generators:     Wave generators of the tone segment.
+//        numGenerators:  Number of generators, at most TONEGEN_MAX_WAVES.
+//        outBuffer:      Output buffer where to accumulate samples.
+//        count:          number of samples to produce.
+//        command:        special action requested (see enum gen_command).
+//
+//    Output:
+//        none
+//
+////////////////////////////////////////////////////////////////////////////////
+void ToneGenerator::WaveGenerator::mixSamples(WaveGenerator * const *generators,
+        unsigned int numGenerators, short *outBuffer, unsigned int count,
+        unsigned int command) {
+    long lS1[TONEGEN_MAX_WAVES], lS2[TONEGEN_MAX_WAVES];
+    long lA1[TONEGEN_MAX_WAVES], lAmplitude[TONEGEN_MAX_WAVES];
+    long lDec[TONEGEN_MAX_WAVES];
     long Sample;  // current sample
+    unsigned int lIdx;
+
+    if (numGenerators > TONEGEN_MAX_WAVES) {
+        numGenerators = TONEGEN_MAX_WAVES;
+    }
+    if (numGenerators == 0 || (command == WAVEGEN_STOP && count == 0)) {
+        return;
+    }
 
     // init local
-    if (command == WAVEGEN_START) {
-        lS1 = (long)0;
-        lS2 = (long)mS2_0;
-    } else {
-        lS1 = mS1;
-        lS2 = mS2;
+    for (lIdx = 0; lIdx < numGenerators; lIdx++) {
+        const WaveGenerator *lpWaveGen = generators[lIdx];
+        if (command == WAVEGEN_START) {
+            lS1[lIdx] = (long)0;
+            lS2[lIdx] = (long)lpWaveGen->mS2_0;
+        } else {
+            lS1[lIdx] = lpWaveGen->mS1;
+            lS2[lIdx] = lpWaveGen->mS2;
+        }
+        lA1[lIdx] = (long)lpWaveGen->mA1_Q14;
+        lAmplitude[lIdx] = (long)lpWaveGen->mAmplitude_Q15;
+        if (command == WAVEGEN_STOP) {
+            lAmplitude[lIdx] <<= 16;
+            lDec[lIdx] = lAmplitude[lIdx]/count;
+        }
     }
-    lA1 = (long)mA1_Q14;
-    lAmplitude = (long)mAmplitude_Q15;
 
     if (command == WAVEGEN_STOP) {
-        lAmplitude <<= 16;
-        if (count == 0) {
-            return;
-        }
-        long dec = lAmplitude/count;
-        // loop generation
+        // loop generation, ramping the volume down
         while (count) {
             count--;
-            Sample = ((lA1 * lS1) >> S_Q14) - lS2;
-            // shift delay
-            lS2 = lS1;
-            lS1 = Sample;
-            Sample = ((lAmplitude>>16) * Sample) >> S_Q15;
-            *(outBuffer++) += (short)Sample;  // put result in buffer
-            lAmplitude -= dec;
+            int lSum = *outBuffer;
+            for (lIdx = 0; lIdx < numGenerators; lIdx++) {
+                Sample = ((lA1[lIdx] * lS1[lIdx]) >> S_Q14) - lS2[lIdx];
+                // shift delay
+                lS2[lIdx] = lS1[lIdx];
+                lS1[lIdx] = Sample;
+                Sample = ((lAmplitude[lIdx]>>16) * Sample) >> S_Q15;
+                lSum += (short)Sample;
+                lAmplitude[lIdx] -= lDec[lIdx];
+            }
+            *(outBuffer++) = (short)lSum;  // put result in buffer
         }
     } else {
         // loop generation
         while (count) {
             count--;
-            Sample = ((lA1 * lS1) >> S_Q14) - lS2;
-            // shift delay
-            lS2 = lS1;
-            lS1 = Sample;
-            Sample = (lAmplitude * Sample) >> S_Q15;
-            *(outBuffer++) += (short)Sample;  // put result in buffer
+            int lSum = *outBuffer;
+            for (lIdx = 0; lIdx < numGenerators; lIdx++) {
+                Sample = ((lA1[lIdx] * lS1[lIdx]) >> S_Q14) - lS2[lIdx];
+                // shift delay
+                lS2[lIdx] = lS1[lIdx];
+                lS1[lIdx] = Sample;
+                Sample = (lAmplitude[lIdx] * Sample) >> S_Q15;
+                lSum += (short)Sample;
+            }
+            *(outBuffer++) = (short)lSum;  // put result in buffer
         }
     }
 
     // save status
-    mS1 = lS1;
-    mS2 = lS2;
+    for (lIdx = 0; lIdx < numGenerators; lIdx++) {
+        generators[lIdx]->mS1 = lS1[lIdx];
+        generators[lIdx]->mS2 = lS2[lIdx];
+    }
 }
 
 }  // end namespace android
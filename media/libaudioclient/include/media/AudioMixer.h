@@ -130,6 +130,12 @@ public:
 
     size_t      getUnreleasedFrames(int name) const;
 
+    // When CPU accounting is enabled, process() measures the time spent on the resampling,
+    // volume and accumulation of each track; consumeTrackProcessNs() returns the nanoseconds
+    // charged to a track name since the previous call, and clears them.
+    void        setCpuAccounting(bool enabled);
+    int64_t     consumeTrackProcessNs(int name);
+
     static inline bool isValidPcmTrackFormat(audio_format_t format) {
         switch (format) {
         case AUDIO_FORMAT_PCM_8_BIT:
@@ -167,6 +173,9 @@ private:
     typedef void (*hook_t)(track_t* t, int32_t* output, size_t numOutFrames, int32_t* temp,
                            int32_t* aux);
     static const int BLOCKSIZE = 16; // 4 cache lines
+    // frames per block for process__genericResamplingFused(); the block of
+    // int32_t accumulators for up to MAX_NUM_CHANNELS stays resident in L1.
+    static const int FUSED_BLOCKSIZE = 64;
 
     struct track_t {
         uint32_t    needs;
@@ -260,6 +269,9 @@ private:
 
         AudioPlaybackRate    mPlaybackRate;
 
+        hook_t      accountedHook;  // the hook timed by track__accounted, when accounting
+        int64_t     mProcessNs;     // time charged to this track, see consumeTrackProcessNs()
+
         bool        needsRamp() { return (volumeInc[0] | volumeInc[1] | auxInc) != 0; }
         bool        setResampler(uint32_t trackSampleRate, uint32_t devSampleRate);
         bool        doesResample() const { return resampler != NULL; }
@@ -287,7 +299,7 @@ private:
         int32_t         *outputTemp;
         int32_t         *resampleTemp;
         NBLog::Writer*  mLog;
-        int32_t         reserved[1];
+        int32_t         cpuAccounting;  // actually bool
         // FIXME allocate dynamically to save some memory when maxNumTracks < MAX_NUM_TRACKS
         track_t         tracks[MAX_NUM_TRACKS] __attribute__((aligned(32)));
     };
@@ -317,6 +329,8 @@ private:
     static void track__genericResample(track_t* t, int32_t* out, size_t numFrames, int32_t* temp,
             int32_t* aux);
     static void track__nop(track_t* t, int32_t* out, size_t numFrames, int32_t* temp, int32_t* aux);
+    static void track__accounted(track_t* t, int32_t* out, size_t numFrames, int32_t* temp,
+            int32_t* aux);
     static void track__16BitsStereo(track_t* t, int32_t* out, size_t numFrames, int32_t* temp,
             int32_t* aux);
     static void track__16BitsMono(track_t* t, int32_t* out, size_t numFrames, int32_t* temp,
@@ -330,11 +344,15 @@ private:
     static void process__nop(state_t* state);
     static void process__genericNoResampling(state_t* state);
     static void process__genericResampling(state_t* state);
+    static void process__genericResamplingFused(state_t* state);
     static void process__OneTrack16BitsStereoNoResampling(state_t* state);
 
     static pthread_once_t   sOnceControl;
     static void             sInitRoutine();
 
+    // true if process__genericResamplingFused() replaces process__genericResampling()
+    static bool             sFusedMixing;
+
     /* multi-format volume mixing function (calls template functions
      * in AudioMixerOps.h).  The template parameters are as follows:
      *
@@ -488,6 +488,34 @@ public:
      */
             ssize_t     read(void* buffer, size_t size, bool blocking = true);
 
+    /* Span of captured frames returned by obtainCaptureSpan().
+     * The frames are in the buffer shared with the RecordThread, and must not be modified.
+     */
+    class CaptureSpan
+    {
+    public:
+        size_t      frameCount;     // on output from obtainCaptureSpan(), the number of frames
+                                    // on input to releaseCaptureSpan(), the number of frames
+                                    //    consumed, which may be less than obtained
+        const void* data;           // first frame of the span
+        int64_t     position;       // number of frames read before the first frame of the span
+        bool        overrun;        // true if the server dropped captured frames since the
+                                    //    previous span was obtained, so that frames are
+                                    //    missing between the previous span and this one
+    };
+
+    /* An alternative to read() which avoids copying the frames: the caller processes them
+     * in place, then releases them with releaseCaptureSpan() before obtaining the next span.
+     * Only for TRANSFER_SYNC mode. Up to maxFrames contiguous frames are returned.
+     * If blocking is false and no frames are available, returns WOULD_BLOCK.
+     * Returned status is NO_ERROR, or one of the negative status codes of read().
+     */
+            status_t    obtainCaptureSpan(CaptureSpan *span, size_t maxFrames,
+                                          bool blocking = true);
+
+    /* Release the first span->frameCount frames of the span last obtained. */
+            void        releaseCaptureSpan(const CaptureSpan *span);
+
     /* Return the number of input frames lost in the audio driver since the last call of this
      * function.  Audio driver is expected to reset the value to 0 and restart counting upon
      * returning the current value by this function call.  Such loss typically occurs when the
@@ -28,6 +28,7 @@
 #include <system/audio_policy.h>
 #include <utils/Errors.h>
 #include <utils/Mutex.h>
+#include <utils/Timers.h>
 
 namespace android {
 
@@ -66,6 +67,10 @@ public:
     // set/get stream volume on specified output
     static status_t setStreamVolume(audio_stream_type_t stream, float value,
                                     audio_io_handle_t output);
+    // set the volumes of several streams on the specified output with a single binder call
+    static status_t setStreamVolumes(const Vector<audio_stream_type_t>& streams,
+                                     const Vector<float>& values,
+                                     audio_io_handle_t output);
     static status_t getStreamVolume(audio_stream_type_t stream, float* volume,
                                     audio_io_handle_t output);
 
@@ -382,9 +387,14 @@ private:
         AudioFlingerClient() :
             mInBuffSize(0), mInSamplingRate(0),
             mInFormat(AUDIO_FORMAT_DEFAULT), mInChannelMask(AUDIO_CHANNEL_NONE) {
+            clearStreamOutputs_l();
         }
 
         void clearIoCache();
+        void clearStreamOutputs();
+        // returns getOutput(stream) with default parameters, cached until an output is
+        // opened, closed or reconfigured, or for at most kStreamOutputCacheNs
+        audio_io_handle_t getOutputForStream(audio_stream_type_t stream);
         status_t getInputBufferSize(uint32_t sampleRate, audio_format_t format,
                                     audio_channel_mask_t channelMask, size_t* buffSize);
         sp<AudioIoDescriptor> getIoDescriptor(audio_io_handle_t ioHandle);
@@ -417,7 +427,12 @@ private:
         uint32_t                            mInSamplingRate;
         audio_format_t                      mInFormat;
         audio_channel_mask_t                mInChannelMask;
+        // cached values for getOutputForStream() queries, AUDIO_IO_HANDLE_NONE when invalid
+        static const nsecs_t                kStreamOutputCacheNs = 1000000000LL;
+        audio_io_handle_t                   mStreamOutputs[AUDIO_STREAM_CNT];
+        nsecs_t                             mStreamOutputTimesNs[AUDIO_STREAM_CNT];
         sp<AudioIoDescriptor> getIoDescriptor_l(audio_io_handle_t ioHandle);
+        void clearStreamOutputs_l();
     };
 
     class AudioPolicyServiceClient: public IBinder::DeathRecipient,
@@ -448,6 +463,7 @@ private:
 
     static const sp<AudioFlingerClient> getAudioFlingerClient();
     static sp<AudioIoDescriptor> getIoDescriptor(audio_io_handle_t ioHandle);
+    static audio_io_handle_t getOutputForStream(audio_stream_type_t streamType);
 
     static sp<AudioFlingerClient> gAudioFlingerClient;
     static sp<AudioPolicyServiceClient> gAudioPolicyServiceClient;
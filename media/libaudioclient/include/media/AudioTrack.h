@@ -378,6 +378,21 @@ public:
      */
             ssize_t     setBufferSizeInFrames(size_t size);
 
+    /* Set how much of the buffer must be available before a write() or obtainBuffer()
+     * blocked on a full buffer is woken up by the server, as a fraction of the frame count.
+     * Applications which write small chunks can raise it so that the server wakes them up
+     * once for several periods instead of once per period, and fill the buffer with
+     * fewer, larger transfers. The server limits the threshold to half of the buffer.
+     * A fraction of 0 restores the default, which is one notification period.
+     *
+     * Returned status (from utils/Errors.h) can be:
+     *  - NO_ERROR: successful operation
+     *  - NO_INIT: the track is not initialized
+     *  - BAD_VALUE: fraction is not in the range 0.0 to 1.0
+     *  - INVALID_OPERATION: the track does not use TRANSFER_SYNC or TRANSFER_OBTAIN
+     */
+            status_t    setWakeupFraction(float fraction);
+
     /* Return the static buffer specified in constructor or set(), or 0 for streaming mode */
             sp<IMemory> sharedBuffer() const { return mSharedBuffer; }
 
@@ -939,6 +954,9 @@ protected:
 
             uint32_t    getUnderrunCount_l() const;
 
+            // set the minimum number of frames for which the server wakes up the client
+            void        updateMinimum_l();
+
             bool     isOffloaded() const;
             bool     isDirect() const;
             bool     isOffloadedOrDirect() const;
@@ -1043,6 +1061,9 @@ protected:
     uint32_t                mNotificationFramesAct; // actual number of frames between each
                                                     // notification callback,
                                                     // at initial source sample rate
+    float                   mWakeupFraction;        // see setWakeupFraction(), 0 if default
+    nsecs_t                 mProxyCreatedNs;        // when mProxy was created, used to report
+                                                    // the rate of futex wakeups in dump()
     bool                    mRefreshRemaining;      // processAudioBuffer() should refresh
                                                     // mRemainingFrames and mRetryOnPartialBuffer
 
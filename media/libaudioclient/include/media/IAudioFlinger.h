@@ -33,6 +33,7 @@
 #include <media/IEffect.h>
 #include <media/IEffectClient.h>
 #include <utils/String8.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -119,6 +120,12 @@ public:
      */
     virtual     status_t    setStreamVolume(audio_stream_type_t stream, float value,
                                     audio_io_handle_t output) = 0;
+    /* set the volumes of several stream types on the same output in one call.
+     * streams and values must have the same size.
+     */
+    virtual     status_t    setStreamVolumes(const Vector<audio_stream_type_t>& streams,
+                                    const Vector<float>& values,
+                                    audio_io_handle_t output) = 0;
     virtual     status_t    setStreamMute(audio_stream_type_t stream, bool muted) = 0;
 
     virtual     float       streamVolume(audio_stream_type_t stream,
@@ -306,6 +306,10 @@ private:
         void getSamples(short *outBuffer, unsigned int count,
                 unsigned int command);
 
+        // same as calling getSamples() for each generator, in a single pass over outBuffer
+        static void mixSamples(WaveGenerator * const *generators, unsigned int numGenerators,
+                short *outBuffer, unsigned int count, unsigned int command);
+
     private:
         static const short GEN_AMP = 32000;  // amplitude of generator
         static const short S_Q14 = 14;  // shift for Q14
@@ -17,7 +17,11 @@
 #define LOG_TAG "EffectsFactoryHalHidl"
 //#define LOG_NDEBUG 0
 
+#include <mutex>
+#include <stdio.h>
+
 #include <cutils/native_handle.h>
+#include <media/audiohal/hidl/HalDeathHandler.h>
 
 #include "ConversionHelperHidl.h"
 #include "EffectHalHidl.h"
@@ -31,6 +35,83 @@ using ::android::hardware::Return;
 
 namespace android {
 
+namespace {
+
+// The HAL loads the effect libraries when it starts, so the list of descriptors does not
+// change while it runs. As a factory is created for each downmixer and each AudioFlinger
+// instance, all the factories of the process share the service and one copy of the
+// descriptors instead of querying them over HIDL. The copy is filled by the first query
+// and dropped if the HAL dies; the version counts the fills.
+class EffectsFactoryCache {
+  public:
+    typedef std::shared_ptr<const hidl_vec<EffectDescriptor>> Descriptors;
+
+    static EffectsFactoryCache& getInstance() {
+        static EffectsFactoryCache instance;
+        return instance;
+    }
+
+    sp<IEffectsFactory> getFactory() {
+        std::lock_guard<std::mutex> guard(mLock);
+        if (mFactory == 0) {
+            mFactory = IEffectsFactory::getService();
+            if (mFactory != 0) {
+                mFactory->linkToDeath(HalDeathHandler::getInstance(), 0 /*cookie*/);
+                HalDeathHandler::getInstance()->registerAtExitHandler(
+                        this, [this]() { invalidate(); });
+            }
+        }
+        return mFactory;
+    }
+
+    // Returns the cached descriptors, or nullptr if they must be queried from the HAL.
+    Descriptors getDescriptors() {
+        std::lock_guard<std::mutex> guard(mLock);
+        if (mDescriptors) {
+            mHits++;
+        } else {
+            mMisses++;
+        }
+        return mDescriptors;
+    }
+
+    Descriptors setDescriptors(const hidl_vec<EffectDescriptor>& descriptors) {
+        std::lock_guard<std::mutex> guard(mLock);
+        mDescriptors = std::make_shared<const hidl_vec<EffectDescriptor>>(descriptors);
+        mVersion++;
+        return mDescriptors;
+    }
+
+    void dump(int fd) {
+        std::lock_guard<std::mutex> guard(mLock);
+        const uint64_t lookups = mHits + mMisses;
+        dprintf(fd, "Effect descriptors cache: version %u, %zu descriptors, "
+                "%llu hits, %llu misses, hit rate %.1f%%\n",
+                mVersion, mDescriptors ? mDescriptors->size() : 0,
+                (unsigned long long)mHits, (unsigned long long)mMisses,
+                lookups > 0 ? 100.0 * mHits / lookups : 0.0);
+    }
+
+  private:
+    EffectsFactoryCache() : mVersion(0), mHits(0), mMisses(0) {}
+
+    // Called on a HAL binder thread before the process exits.
+    void invalidate() {
+        std::lock_guard<std::mutex> guard(mLock);
+        mFactory.clear();
+        mDescriptors.reset();
+    }
+
+    std::mutex mLock;
+    sp<IEffectsFactory> mFactory;
+    Descriptors mDescriptors;
+    uint32_t mVersion;
+    uint64_t mHits;
+    uint64_t mMisses;
+};
+
+}  // namespace
+
 // static
 sp<EffectsFactoryHalInterface> EffectsFactoryHalInterface::create() {
     return new EffectsFactoryHalHidl();
@@ -42,7 +123,7 @@ bool EffectsFactoryHalInterface::isNullUuid(const effect_uuid_t *pEffectUuid) {
 }
 
 EffectsFactoryHalHidl::EffectsFactoryHalHidl() : ConversionHelperHidl("EffectsFactory") {
-    mEffectsFactory = IEffectsFactory::getService();
+    mEffectsFactory = EffectsFactoryCache::getInstance().getFactory();
     if (mEffectsFactory == 0) {
         ALOGE("Failed to obtain IEffectsFactory service, terminating process.");
         exit(1);
@@ -54,40 +135,39 @@ EffectsFactoryHalHidl::~EffectsFactoryHalHidl() {
 
 status_t EffectsFactoryHalHidl::queryAllDescriptors() {
     if (mEffectsFactory == 0) return NO_INIT;
+    mLastDescriptors = EffectsFactoryCache::getInstance().getDescriptors();
+    if (mLastDescriptors) return OK;
     Result retval = Result::NOT_INITIALIZED;
     Return<void> ret = mEffectsFactory->getAllDescriptors(
             [&](Result r, const hidl_vec<EffectDescriptor>& result) {
                 retval = r;
                 if (retval == Result::OK) {
-                    mLastDescriptors = result;
+                    mLastDescriptors = EffectsFactoryCache::getInstance().setDescriptors(result);
                 }
             });
     if (ret.isOk()) {
         return retval == Result::OK ? OK : NO_INIT;
     }
-    mLastDescriptors.resize(0);
     return processReturn(__FUNCTION__, ret);
 }
 
 status_t EffectsFactoryHalHidl::queryNumberEffects(uint32_t *pNumEffects) {
     status_t queryResult = queryAllDescriptors();
     if (queryResult == OK) {
-        *pNumEffects = mLastDescriptors.size();
+        *pNumEffects = mLastDescriptors->size();
     }
     return queryResult;
 }
 
 status_t EffectsFactoryHalHidl::getDescriptor(
         uint32_t index, effect_descriptor_t *pDescriptor) {
-    // TODO: We need somehow to track the changes on the server side
-    // or figure out how to convert everybody to query all the descriptors at once.
     // TODO: check for nullptr
-    if (mLastDescriptors.size() == 0) {
+    if (!mLastDescriptors) {
         status_t queryResult = queryAllDescriptors();
         if (queryResult != OK) return queryResult;
     }
-    if (index >= mLastDescriptors.size()) return NAME_NOT_FOUND;
-    EffectHalHidl::effectDescriptorToHal(mLastDescriptors[index], pDescriptor);
+    if (index >= mLastDescriptors->size()) return NAME_NOT_FOUND;
+    EffectHalHidl::effectDescriptorToHal((*mLastDescriptors)[index], pDescriptor);
     return OK;
 }
 
@@ -95,6 +175,18 @@ status_t EffectsFactoryHalHidl::getDescriptor(
         const effect_uuid_t *pEffectUuid, effect_descriptor_t *pDescriptor) {
     // TODO: check for nullptr
     if (mEffectsFactory == 0) return NO_INIT;
+    if (queryAllDescriptors() == OK) {
+        for (const auto& descriptor : *mLastDescriptors) {
+            effect_uuid_t uuid;
+            HidlUtils::uuidToHal(descriptor.uuid, &uuid);
+            if (memcmp(&uuid, pEffectUuid, sizeof(effect_uuid_t)) == 0) {
+                EffectHalHidl::effectDescriptorToHal(descriptor, pDescriptor);
+                return OK;
+            }
+        }
+        return NAME_NOT_FOUND;
+    }
+    // The list could not be obtained, try the effect alone.
     Uuid hidlUuid;
     HidlUtils::uuidFromHal(*pEffectUuid, &hidlUuid);
     Result retval = Result::NOT_INITIALIZED;
@@ -142,6 +234,7 @@ status_t EffectsFactoryHalHidl::dumpEffects(int fd) {
     hidlHandle->data[0] = fd;
     Return<void> ret = mEffectsFactory->debugDump(hidlHandle);
     native_handle_delete(hidlHandle);
+    EffectsFactoryCache::getInstance().dump(fd);
     return processReturn(__FUNCTION__, ret);
 }
 
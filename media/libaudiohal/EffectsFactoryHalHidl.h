@@ -17,6 +17,8 @@
 #ifndef ANDROID_HARDWARE_EFFECTS_FACTORY_HAL_HIDL_H
 #define ANDROID_HARDWARE_EFFECTS_FACTORY_HAL_HIDL_H
 
+#include <memory>
+
 #include <android/hardware/audio/effect/2.0/IEffectsFactory.h>
 #include <android/hardware/audio/effect/2.0/types.h>
 #include <media/audiohal/EffectsFactoryHalInterface.h>
@@ -53,12 +55,14 @@ class EffectsFactoryHalHidl : public EffectsFactoryHalInterface, public Conversi
     friend class EffectsFactoryHalInterface;
 
     sp<IEffectsFactory> mEffectsFactory;
-    hidl_vec<EffectDescriptor> mLastDescriptors;
+    // Snapshot of the descriptors cache shared by all the factories, see EffectsFactoryCache.
+    std::shared_ptr<const hidl_vec<EffectDescriptor>> mLastDescriptors;
 
     // Can not be constructed directly by clients.
     EffectsFactoryHalHidl();
     virtual ~EffectsFactoryHalHidl();
 
+    // Takes a new snapshot of the descriptors, only querying the HAL when they are not cached.
     status_t queryAllDescriptors();
 };
 
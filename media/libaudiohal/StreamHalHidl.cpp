@@ -17,7 +17,11 @@
 #define LOG_TAG "StreamHalHidl"
 //#define LOG_NDEBUG 0
 
+#include <algorithm>
+#include <stdio.h>
+
 #include <android/hardware/audio/2.0/IStreamOutCallback.h>
+#include <cutils/properties.h>
 #include <hwbinder/IPCThreadState.h>
 #include <mediautils/SchedulingPolicyService.h>
 #include <utils/Log.h>
@@ -42,6 +46,9 @@ using ::android::hardware::Return;
 using ::android::hardware::Void;
 using ReadCommand = ::android::hardware::audio::V2_0::IStreamIn::ReadCommand;
 
+// When true, blocking writes to output streams are pipelined, see StreamOutHalHidl
+#define PROPERTY_PIPELINED_WRITE "audio.hal.pipelined_write"
+
 namespace android {
 
 StreamHalHidl::StreamHalHidl(IStream *stream)
@@ -255,7 +262,8 @@ struct StreamOutCallback : public IStreamOutCallback {
 }  // namespace
 
 StreamOutHalHidl::StreamOutHalHidl(const sp<IStreamOut>& stream)
-        : StreamHalHidl(stream.get()), mStream(stream), mWriterClient(0), mEfGroup(nullptr) {
+        : StreamHalHidl(stream.get()), mStream(stream), mWriterClient(0), mEfGroup(nullptr),
+          mPipelineDepth(0), mWritesInFlight(0), mBytesInFlight(0), mIssueIndex(0), mStats() {
 }
 
 StreamOutHalHidl::~StreamOutHalHidl() {
@@ -280,7 +288,8 @@ status_t StreamOutHalHidl::getFrameSize(size_t *size) {
 
 status_t StreamOutHalHidl::getLatency(uint32_t *latency) {
     if (mStream == 0) return NO_INIT;
-    if (mWriterClient == gettid() && mCommandMQ) {
+    // With writes in flight, a query through the writer thread would wait for them.
+    if (mWriterClient == gettid() && mCommandMQ && mWritesInFlight == 0) {
         return callWriterThread(
                 WriteCommand::GET_LATENCY, "getLatency", nullptr, 0,
                 [&](const WriteStatus& writeStatus) {
@@ -311,6 +320,9 @@ status_t StreamOutHalHidl::write(const void *buffer, size_t bytes, size_t *writt
         return status;
     }
 
+    if (mPipelineDepth > 0) {
+        return pipelinedWrite(static_cast<const uint8_t*>(buffer), bytes, written);
+    }
     return callWriterThread(
             WriteCommand::WRITE, "write", static_cast<const uint8_t*>(buffer), bytes,
             [&] (const WriteStatus& writeStatus) {
@@ -325,10 +337,24 @@ status_t StreamOutHalHidl::write(const void *buffer, size_t bytes, size_t *writt
 status_t StreamOutHalHidl::callWriterThread(
         WriteCommand cmd, const char* cmdName,
         const uint8_t* data, size_t dataSize, StreamOutHalHidl::WriterCallback callback) {
+    // The HAL processes the commands in order, and the replies of the writes in flight
+    // must be out of the status queue. Their errors have been logged already.
+    (void)drainPipelinedWrites();
+    status_t status = sendWriterCommand(cmd, cmdName, data, dataSize, nullptr /*queued*/);
+    if (status != OK) {
+        return status;
+    }
+    return receiveWriterStatus(cmdName, callback);
+}
+
+status_t StreamOutHalHidl::sendWriterCommand(
+        WriteCommand cmd, const char* cmdName,
+        const uint8_t* data, size_t dataSize, size_t *queued) {
     if (!mCommandMQ->write(&cmd)) {
         ALOGE("command message queue write failed for \"%s\"", cmdName);
         return -EAGAIN;
     }
+    size_t dataQueued = 0;
     if (data != nullptr) {
         size_t availableToWrite = mDataMQ->availableToWrite();
         if (dataSize > availableToWrite) {
@@ -336,16 +362,37 @@ status_t StreamOutHalHidl::callWriterThread(
                     (long long)dataSize, (long long)availableToWrite);
             dataSize = availableToWrite;
         }
-        if (!mDataMQ->write(data, dataSize)) {
+        if (mDataMQ->write(data, dataSize)) {
+            dataQueued = dataSize;
+        } else {
             ALOGE("data message queue write failed for \"%s\"", cmdName);
         }
     }
     mEfGroup->wake(static_cast<uint32_t>(MessageQueueFlagBits::NOT_EMPTY));
+    if (queued != nullptr) {
+        *queued = dataQueued;
+    }
+    return OK;
+}
 
+status_t StreamOutHalHidl::receiveWriterStatus(
+        const char* cmdName, StreamOutHalHidl::WriterCallback callback) {
     // TODO: Remove manual event flag handling once blocking MQ is implemented. b/33815422
     uint32_t efState = 0;
 retry:
-    status_t ret = mEfGroup->wait(static_cast<uint32_t>(MessageQueueFlagBits::NOT_FULL), &efState);
+    status_t ret = OK;
+    if (mPipelineDepth > 0 && mStatusMQ->availableToRead() > 0) {
+        // With several writes in flight, one notification can stand for several replies.
+        efState = static_cast<uint32_t>(MessageQueueFlagBits::NOT_FULL);
+    } else {
+        ret = mEfGroup->wait(static_cast<uint32_t>(MessageQueueFlagBits::NOT_FULL), &efState);
+        if (mPipelineDepth > 0 && (efState & static_cast<uint32_t>(
+                        MessageQueueFlagBits::NOT_FULL)) && mStatusMQ->availableToRead() == 0) {
+            // Notification of a reply which has been read already.
+            efState = 0;
+            ret = -EAGAIN;
+        }
+    }
     if (efState & static_cast<uint32_t>(MessageQueueFlagBits::NOT_FULL)) {
         WriteStatus writeStatus;
         writeStatus.retval = Result::NOT_INITIALIZED;
@@ -367,14 +414,88 @@ retry:
     return ret;
 }
 
+status_t StreamOutHalHidl::pipelinedWrite(
+        const uint8_t* data, size_t dataSize, size_t *written) {
+    // Wait for a free slot. An error found while doing so is reported by this write,
+    // as the writes which failed have returned already.
+    status_t status = OK;
+    const nsecs_t startNs = systemTime();
+    while (mWritesInFlight >= mPipelineDepth) {
+        status_t completeStatus = completePipelinedWrite();
+        if (status == OK) {
+            status = completeStatus;
+        }
+    }
+    const nsecs_t blockedNs = systemTime() - startNs;
+    mStats.totalBlockedNs += blockedNs;
+    mStats.maxBlockedNs = std::max(mStats.maxBlockedNs, blockedNs);
+    if (status != OK) {
+        return status;
+    }
+
+    size_t queued = 0;
+    status = sendWriterCommand(WriteCommand::WRITE, "write", data, dataSize, &queued);
+    if (status != OK) {
+        return status;
+    }
+    mIssueTimeNs[(mIssueIndex + mWritesInFlight) % kMaxPipelinedWrites] = systemTime();
+    mWritesInFlight++;
+    mBytesInFlight += queued;
+    mStats.writes++;
+    *written = queued;
+    return OK;
+}
+
+status_t StreamOutHalHidl::completePipelinedWrite() {
+    size_t bytesWritten = 0;
+    status_t status = receiveWriterStatus(
+            "write",
+            [&] (const WriteStatus& writeStatus) {
+                bytesWritten = writeStatus.reply.written;
+            });
+    const nsecs_t latencyNs = systemTime() - mIssueTimeNs[mIssueIndex];
+    mIssueIndex = (mIssueIndex + 1) % kMaxPipelinedWrites;
+    mWritesInFlight--;
+    mStats.completions++;
+    mStats.totalLatencyNs += latencyNs;
+    mStats.maxLatencyNs = std::max(mStats.maxLatencyNs, latencyNs);
+    if (status != OK) {
+        mStats.errors++;
+    }
+    // The HAL writes whatever is in the data queue, so a write can also write the data of
+    // the writes queued after it. The accounting is only exact when the pipeline is empty.
+    mBytesInFlight -= std::min(bytesWritten, mBytesInFlight);
+    if (mWritesInFlight == 0 && mBytesInFlight > 0) {
+        ALOGV("pipelined writes dropped %zu bytes", mBytesInFlight);
+        mStats.shortWrites++;
+        mStats.droppedBytes += mBytesInFlight;
+        mBytesInFlight = 0;
+    }
+    return status;
+}
+
+status_t StreamOutHalHidl::drainPipelinedWrites() {
+    status_t status = OK;
+    while (mWritesInFlight > 0) {
+        status_t completeStatus = completePipelinedWrite();
+        if (status == OK) {
+            status = completeStatus;
+        }
+    }
+    return status;
+}
+
 status_t StreamOutHalHidl::prepareForWriting(size_t bufferSize) {
     std::unique_ptr<CommandMQ> tempCommandMQ;
     std::unique_ptr<DataMQ> tempDataMQ;
     std::unique_ptr<StatusMQ> tempStatusMQ;
     Result retval;
     pid_t halThreadPid, halThreadTid;
+    // Pipelining does not apply to non-blocking writes, which have their own callback.
+    const bool pipelined = mCallback.unsafe_get() == nullptr &&
+            property_get_bool(PROPERTY_PIPELINED_WRITE, false /* default_value */);
     Return<void> ret = mStream->prepareForWriting(
-            1, bufferSize,
+            1, pipelined ? bufferSize * kMaxPipelinedWrites : bufferSize,
             [&](Result r,
                     const CommandMQ::Descriptor& commandMQ,
                     const DataMQ::Descriptor& dataMQ,
@@ -412,6 +533,14 @@ status_t StreamOutHalHidl::prepareForWriting(size_t bufferSize) {
     }
     requestHalThreadPriority(halThreadPid, halThreadTid);
 
+    if (pipelined) {
+        // Each write in flight needs a slot in each queue.
+        size_t depth = std::min(tempCommandMQ->getQuantumCount(),
+                tempStatusMQ->getQuantumCount());
+        depth = std::min(depth, tempDataMQ->getQuantumCount() / bufferSize);
+        mPipelineDepth = std::max(std::min(depth, (size_t)kMaxPipelinedWrites), (size_t)1);
+        ALOGV("pipelined writes, depth %u", mPipelineDepth);
+    }
     mCommandMQ = std::move(tempCommandMQ);
     mDataMQ = std::move(tempDataMQ);
     mStatusMQ = std::move(tempStatusMQ);
@@ -467,6 +596,9 @@ status_t StreamOutHalHidl::supportsPauseAndResume(bool *supportsPause, bool *sup
 
 status_t StreamOutHalHidl::pause() {
     if (mStream == 0) return NO_INIT;
+    if (mWriterClient == gettid()) {
+        (void)drainPipelinedWrites();
+    }
     return processReturn("pause", mStream->pause());
 }
 
@@ -488,12 +620,16 @@ status_t StreamOutHalHidl::drain(bool earlyNotify) {
 
 status_t StreamOutHalHidl::flush() {
     if (mStream == 0) return NO_INIT;
+    if (mWriterClient == gettid()) {
+        (void)drainPipelinedWrites();
+    }
     return processReturn("pause", mStream->flush());
 }
 
 status_t StreamOutHalHidl::getPresentationPosition(uint64_t *frames, struct timespec *timestamp) {
     if (mStream == 0) return NO_INIT;
-    if (mWriterClient == gettid() && mCommandMQ) {
+    // With writes in flight, a query through the writer thread would wait for them.
+    if (mWriterClient == gettid() && mCommandMQ && mWritesInFlight == 0) {
         return callWriterThread(
                 WriteCommand::GET_PRESENTATION_POSITION, "getPresentationPosition", nullptr, 0,
                 [&](const WriteStatus& writeStatus) {
@@ -516,6 +652,36 @@ status_t StreamOutHalHidl::getPresentationPosition(uint64_t *frames, struct time
     }
 }
 
+status_t StreamOutHalHidl::standby() {
+    if (mStream == 0) return NO_INIT;
+    if (mWriterClient == gettid()) {
+        // The data in flight is played before going into standby.
+        (void)drainPipelinedWrites();
+    }
+    return StreamHalHidl::standby();
+}
+
+status_t StreamOutHalHidl::dump(int fd) {
+    status_t status = StreamHalHidl::dump(fd);
+    if (mPipelineDepth == 0) {
+        return status;
+    }
+    // Not synchronized with the writer thread, the values may be slightly inconsistent.
+    const PipelineStats stats = mStats;
+    dprintf(fd, "  HAL pipelined writes: depth %u, writes %llu, errors %llu, "
+            "short writes %llu (%llu bytes dropped)\n",
+            mPipelineDepth, (unsigned long long)stats.writes, (unsigned long long)stats.errors,
+            (unsigned long long)stats.shortWrites, (unsigned long long)stats.droppedBytes);
+    if (stats.writes > 0 && stats.completions > 0) {
+        dprintf(fd, "    Blocked in write: mean %.2f ms, max %.2f ms\n",
+                (double)stats.totalBlockedNs / stats.writes * 1e-6, stats.maxBlockedNs * 1e-6);
+        dprintf(fd, "    Completion latency: mean %.2f ms, max %.2f ms\n",
+                (double)stats.totalLatencyNs / stats.completions * 1e-6,
+                stats.maxLatencyNs * 1e-6);
+    }
+    return status;
+}
+
 void StreamOutHalHidl::onWriteReady() {
     sp<StreamOutHalInterfaceCallback> callback = mCallback.promote();
     if (callback == 0) return;
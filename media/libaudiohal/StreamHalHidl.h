@@ -25,6 +25,7 @@
 #include <fmq/EventFlag.h>
 #include <fmq/MessageQueue.h>
 #include <media/audiohal/StreamHalInterface.h>
+#include <utils/Timers.h>
 
 #include "ConversionHelperHidl.h"
 
@@ -154,6 +155,11 @@ class StreamOutHalHidl : public StreamOutHalInterface, public StreamHalHidl {
     // Return a recent count of the number of audio frames presented to an external observer.
     virtual status_t getPresentationPosition(uint64_t *frames, struct timespec *timestamp);
 
+    // Put the audio hardware output into standby mode.
+    virtual status_t standby();
+
+    virtual status_t dump(int fd);
+
     // Methods used by StreamOutCallback (HIDL).
     void onWriteReady();
     void onDrainReady();
@@ -165,6 +171,23 @@ class StreamOutHalHidl : public StreamOutHalInterface, public StreamHalHidl {
     typedef MessageQueue<uint8_t, hardware::kSynchronizedReadWrite> DataMQ;
     typedef MessageQueue<WriteStatus, hardware::kSynchronizedReadWrite> StatusMQ;
 
+    // In pipelined mode, write() returns as soon as the data is in the data MQ, and the status
+    // of a write is only collected when a later command needs the queue slots. Up to
+    // kMaxPipelinedWrites writes can then be in flight, limited by the size of the MQs.
+    static const uint32_t kMaxPipelinedWrites = 4;
+
+    struct PipelineStats {
+        uint64_t writes;            // pipelined writes
+        uint64_t completions;       // pipelined writes whose status was collected
+        uint64_t shortWrites;       // completions that did not write all the queued data
+        uint64_t droppedBytes;      // queued data that the HAL did not write
+        uint64_t errors;            // completions with an error
+        nsecs_t totalBlockedNs;     // time write() waited for earlier writes to complete
+        nsecs_t maxBlockedNs;
+        nsecs_t totalLatencyNs;     // time between issuing a write and collecting its status
+        nsecs_t maxLatencyNs;
+    };
+
     wp<StreamOutHalInterfaceCallback> mCallback;
     sp<IStreamOut> mStream;
     std::unique_ptr<CommandMQ> mCommandMQ;
@@ -172,6 +195,13 @@ class StreamOutHalHidl : public StreamOutHalInterface, public StreamHalHidl {
     std::unique_ptr<StatusMQ> mStatusMQ;
     std::atomic<pid_t> mWriterClient;
     EventFlag* mEfGroup;
+    uint32_t mPipelineDepth;        // 0 when writes are synchronous
+    // Only accessed by the writer thread, except for mStats which dump() reads unlocked.
+    uint32_t mWritesInFlight;
+    size_t mBytesInFlight;          // queued by the writes in flight, minus what they wrote
+    nsecs_t mIssueTimeNs[kMaxPipelinedWrites]; // FIFO of the issue time of the writes in flight
+    uint32_t mIssueIndex;           // index of the oldest write in flight
+    PipelineStats mStats;
 
     // Can not be constructed directly by clients.
     StreamOutHalHidl(const sp<IStreamOut>& stream);
@@ -182,6 +212,13 @@ class StreamOutHalHidl : public StreamOutHalInterface, public StreamHalHidl {
     status_t callWriterThread(
             WriteCommand cmd, const char* cmdName,
             const uint8_t* data, size_t dataSize, WriterCallback callback);
+    status_t sendWriterCommand(
+            WriteCommand cmd, const char* cmdName,
+            const uint8_t* data, size_t dataSize, size_t *queued);
+    status_t receiveWriterStatus(const char* cmdName, WriterCallback callback);
+    status_t pipelinedWrite(const uint8_t* data, size_t dataSize, size_t *written);
+    status_t completePipelinedWrite();
+    status_t drainPipelinedWrites();
     status_t prepareForWriting(size_t bufferSize);
 };
 
@@ -26,9 +26,11 @@
 
 #include <utils/Errors.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
 
 #include <cutils/bitops.h>
 #include <cutils/compiler.h>
+#include <cutils/properties.h>
 #include <utils/Debug.h>
 
 #include <system/audio.h>
@@ -37,7 +39,9 @@
 #include <audio_utils/format.h>
 #include <media/AudioMixer.h>
 
-#include "AudioMixerOps.h"
+#include "AudioMixerOps.h" // USE_NEON and USE_SSE defined here
+#include "AudioMixerOpsNeon.h"
+#include "AudioMixerOpsSSE.h"
 
 // The FCC_2 macro refers to the Fixed Channel Count of 2 for the legacy integer mixer.
 #ifndef FCC_2
@@ -116,7 +120,7 @@ AudioMixer::AudioMixer(size_t frameCount, uint32_t sampleRate, uint32_t maxNumTr
     mState.outputTemp   = NULL;
     mState.resampleTemp = NULL;
     mState.mLog         = &mDummyLog;
-    // mState.reserved
+    mState.cpuAccounting = false;
 
     // FIXME Most of the following initialization is probably redundant since
     // tracks[i] should only be referenced if (mTrackNames & (1 << i)) != 0
@@ -227,6 +231,8 @@ int AudioMixer::getTrackName(audio_channel_mask_t channelMask,
                 AUDIO_CHANNEL_REPRESENTATION_POSITION, AUDIO_CHANNEL_OUT_STEREO);
         t->mMixerChannelCount = audio_channel_count_from_out_mask(t->mMixerChannelMask);
         t->mPlaybackRate = AUDIO_PLAYBACK_RATE_DEFAULT;
+        t->accountedHook = NULL;
+        t->mProcessNs = 0;
         // Check the downmixing (or upmixing) requirements.
         status_t status = t->prepareForDownmix();
         if (status != OK) {
@@ -908,8 +914,39 @@ void AudioMixer::setBufferProvider(int name, AudioBufferProvider* bufferProvider
 }
 
 
+void AudioMixer::setCpuAccounting(bool enabled)
+{
+    if (mState.cpuAccounting != (int32_t)enabled) {
+        mState.cpuAccounting = enabled;
+        // the track hooks are wrapped, or restored, by process__validate()
+        invalidateState(mTrackNames);
+    }
+}
+
+int64_t AudioMixer::consumeTrackProcessNs(int name)
+{
+    name -= TRACK0;
+    ALOG_ASSERT(uint32_t(name) < MAX_NUM_TRACKS, "bad track name %d", name);
+    track_t& t = mState.tracks[name];
+    const int64_t ns = t.mProcessNs;
+    t.mProcessNs = 0;
+    return ns;
+}
+
 void AudioMixer::process()
 {
+    const uint32_t enabledTracks = mState.enabledTracks;
+    if (CC_UNLIKELY(mState.cpuAccounting) && enabledTracks != 0
+            && (enabledTracks & (enabledTracks - 1)) == 0) {
+        // With a single track, the whole work is charged to it. This also covers
+        // process__OneTrack16BitsStereoNoResampling(), which does not call the track hook.
+        track_t& t = mState.tracks[31 - __builtin_clz(enabledTracks)];
+        const int64_t processNs = t.mProcessNs;
+        const nsecs_t startNs = systemTime();
+        mState.hook(&mState);
+        t.mProcessNs = processNs + (systemTime() - startNs);
+        return;
+    }
     mState.hook(&mState);
 }
 
@@ -1004,13 +1041,22 @@ void AudioMixer::process__validate(state_t* state)
     state->hook = process__nop;
     if (countActiveTracks > 0) {
         if (resampling) {
-            if (!state->outputTemp) {
-                state->outputTemp = new int32_t[MAX_NUM_CHANNELS * state->frameCount];
-            }
             if (!state->resampleTemp) {
                 state->resampleTemp = new int32_t[MAX_NUM_CHANNELS * state->frameCount];
             }
-            state->hook = process__genericResampling;
+            if (sFusedMixing) {
+                // the fused hook accumulates in a stack block, not in outputTemp
+                if (state->outputTemp) {
+                    delete [] state->outputTemp;
+                    state->outputTemp = NULL;
+                }
+                state->hook = process__genericResamplingFused;
+            } else {
+                if (!state->outputTemp) {
+                    state->outputTemp = new int32_t[MAX_NUM_CHANNELS * state->frameCount];
+                }
+                state->hook = process__genericResampling;
+            }
         } else {
             if (state->outputTemp) {
                 delete [] state->outputTemp;
@@ -1044,6 +1090,19 @@ void AudioMixer::process__validate(state_t* state)
         countActiveTracks, state->enabledTracks,
         all16BitsStereoNoResample, resampling, volumeRamp);
 
+    if (state->cpuAccounting) {
+        uint32_t en = state->enabledTracks;
+        while (en) {
+            const int i = 31 - __builtin_clz(en);
+            en &= ~(1<<i);
+            track_t& t = state->tracks[i];
+            if (t.hook != track__nop) {
+                t.accountedHook = t.hook;
+                t.hook = track__accounted;
+            }
+        }
+    }
+
    state->hook(state);
 
     // Now that the volume ramp has been done, set optimal state and
@@ -1116,6 +1175,15 @@ void AudioMixer::track__nop(track_t* t __unused, int32_t* out __unused,
 {
 }
 
+// times the hook selected by process__validate(), when CPU accounting is enabled
+void AudioMixer::track__accounted(track_t* t, int32_t* out, size_t outFrameCount,
+        int32_t* temp, int32_t* aux)
+{
+    const nsecs_t startNs = systemTime();
+    t->accountedHook(t, out, outFrameCount, temp, aux);
+    t->mProcessNs += systemTime() - startNs;
+}
+
 void AudioMixer::volumeRampStereo(track_t* t, int32_t* out, size_t frameCount, int32_t* temp,
         int32_t* aux)
 {
@@ -1587,6 +1655,122 @@ void AudioMixer::process__genericResampling(state_t* state)
     }
 }
 
+// generic code with resampling, fused over all tracks of an output buffer.
+// Unlike process__genericResampling, which makes one pass over the whole
+// output per track, every track is mixed into a FUSED_BLOCKSIZE block
+// while it is still in cache, then the block is converted to the output.
+void AudioMixer::process__genericResamplingFused(state_t* state)
+{
+    ALOGVV("process__genericResamplingFused\n");
+    int32_t outTemp[FUSED_BLOCKSIZE * MAX_NUM_CHANNELS] __attribute__((aligned(32)));
+
+    // acquire the buffer of each track that is not resampled;
+    // resampled tracks pull from their buffer provider inside the resampler.
+    uint32_t enabledTracks = state->enabledTracks;
+    uint32_t e0 = enabledTracks;
+    while (e0) {
+        const int i = 31 - __builtin_clz(e0);
+        e0 &= ~(1<<i);
+        track_t& t = state->tracks[i];
+        if (t.needs & NEEDS_RESAMPLE) {
+            continue;
+        }
+        t.buffer.frameCount = state->frameCount;
+        t.bufferProvider->getNextBuffer(&t.buffer);
+        t.frameCount = t.buffer.frameCount;
+        t.in = t.buffer.raw;
+    }
+
+    e0 = enabledTracks;
+    while (e0) {
+        // process by group of tracks with same output buffer
+        uint32_t e1 = e0, e2 = e0;
+        int j = 31 - __builtin_clz(e1);
+        track_t& t1 = state->tracks[j];
+        e2 &= ~(1<<j);
+        while (e2) {
+            j = 31 - __builtin_clz(e2);
+            e2 &= ~(1<<j);
+            track_t& t2 = state->tracks[j];
+            if (CC_UNLIKELY(t2.mainBuffer != t1.mainBuffer)) {
+                e1 &= ~(1<<j);
+            }
+        }
+        e0 &= ~(e1);
+        int32_t *out = t1.mainBuffer;
+        for (size_t numFrames = 0; numFrames < state->frameCount; ) {
+            const size_t blockFrames = min((size_t)FUSED_BLOCKSIZE,
+                    state->frameCount - numFrames);
+            memset(outTemp, 0, blockFrames * t1.mMixerChannelCount * sizeof(*outTemp));
+            e2 = e1;
+            while (e2) {
+                const int i = 31 - __builtin_clz(e2);
+                e2 &= ~(1<<i);
+                track_t& t = state->tracks[i];
+                int32_t *aux = NULL;
+                if (CC_UNLIKELY(t.needs & NEEDS_AUX)) {
+                    aux = t.auxBuffer + numFrames;
+                }
+                if (t.needs & NEEDS_RESAMPLE) {
+                    t.hook(&t, outTemp, blockFrames, state->resampleTemp, aux);
+                    continue;
+                }
+                size_t outFrames = blockFrames;
+                while (outFrames) {
+                    // t.in == NULL can happen if the track was flushed just after having
+                    // been enabled for mixing.
+                    if (t.in == NULL) {
+                        enabledTracks &= ~(1<<i);
+                        e1 &= ~(1<<i);
+                        break;
+                    }
+                    size_t inFrames = (t.frameCount > outFrames)?outFrames:t.frameCount;
+                    if (inFrames > 0) {
+                        t.hook(&t, outTemp + (blockFrames - outFrames) * t.mMixerChannelCount,
+                                inFrames, state->resampleTemp, aux);
+                        t.frameCount -= inFrames;
+                        outFrames -= inFrames;
+                        if (CC_UNLIKELY(aux != NULL)) {
+                            aux += inFrames;
+                        }
+                    }
+                    if (t.frameCount == 0 && outFrames) {
+                        t.bufferProvider->releaseBuffer(&t.buffer);
+                        t.buffer.frameCount = (state->frameCount - numFrames) -
+                                (blockFrames - outFrames);
+                        t.bufferProvider->getNextBuffer(&t.buffer);
+                        t.in = t.buffer.raw;
+                        if (t.in == NULL) {
+                            enabledTracks &= ~(1<<i);
+                            e1 &= ~(1<<i);
+                            break;
+                        }
+                        t.frameCount = t.buffer.frameCount;
+                    }
+                }
+            }
+
+            convertMixerFormat(out, t1.mMixerFormat, outTemp, t1.mMixerInFormat,
+                    blockFrames * t1.mMixerChannelCount);
+            out = reinterpret_cast<int32_t*>((uint8_t*)out
+                    + blockFrames * t1.mMixerChannelCount
+                        * audio_bytes_per_sample(t1.mMixerFormat));
+            numFrames += blockFrames;
+        }
+    }
+
+    // release the buffer of each track that is not resampled
+    e0 = enabledTracks;
+    while (e0) {
+        const int i = 31 - __builtin_clz(e0);
+        e0 &= ~(1<<i);
+        track_t& t = state->tracks[i];
+        if ((t.needs & NEEDS_RESAMPLE) == 0) {
+            t.bufferProvider->releaseBuffer(&t.buffer);
+        }
+    }
+}
+
 // one track, 16 bits stereo without resampling is the most common case
 void AudioMixer::process__OneTrack16BitsStereoNoResampling(state_t* state)
 {
@@ -1678,9 +1862,12 @@ void AudioMixer::process__OneTrack16BitsStereoNoResampling(state_t* state)
 
 /*static*/ pthread_once_t AudioMixer::sOnceControl = PTHREAD_ONCE_INIT;
 
+/*static*/ bool AudioMixer::sFusedMixing = true;
+
 /*static*/ void AudioMixer::sInitRoutine()
 {
     DownmixerBufferProvider::init(); // for the downmixer
+    sFusedMixing = property_get_bool("ro.audio.mixer.fused", true /* default_value */);
 }
 
 /* TODO: consider whether this level of optimization is necessary.
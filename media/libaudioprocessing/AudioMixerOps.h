@@ -17,6 +17,28 @@
 #ifndef ANDROID_AUDIO_MIXER_OPS_H
 #define ANDROID_AUDIO_MIXER_OPS_H
 
+// These definitions match AudioResamplerFirOps.h, so that both may be included.
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#ifndef USE_NEON
+#define USE_NEON (true)
+#endif
+#else
+#define USE_NEON (false)
+#endif
+#if USE_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__SSSE3__)  // Should be supported in x86 ABI for both 32 & 64-bit.
+#define USE_SSE (true)
+#include <tmmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#else
+#define USE_SSE (false)
+#endif
+
 namespace android {
 
 /* Behavior of is_same<>::value is true if the types are identical,
@@ -270,6 +292,39 @@ enum {
  *
  */
 
+/*
+ * MixVector provides optional vectorized versions of the constant volume
+ * (non-ramped, no aux) inner loop of volumeMulti().
+ *
+ * MixVector<>::volumeMulti() mixes as many leading frames as it can handle
+ * and returns the number of frames processed; volumeMulti() finishes the
+ * remaining frames with the scalar code below.  The generic version processes
+ * nothing and is specialized in AudioMixerOpsNeon.h and AudioMixerOpsSSE.h
+ * for <TO, TI, TV> = <float, float, float> and <int32_t, int16_t, int16_t>.
+ *
+ * Specializations must produce results bit-exact with MixMul<TO, TI, TV>
+ * followed by an add into out (in particular, no fused multiply-add).
+ */
+
+template <int MIXTYPE, int NCHAN, typename TO, typename TI, typename TV>
+struct MixVector {
+    static inline size_t volumeMulti(TO* out __unused, size_t frameCount __unused,
+            const TI* in __unused, const TV* vol __unused) {
+        return 0;
+    }
+};
+
+/*
+ * Returns true if a vector of LANES volumes, built by repeating the per-channel
+ * volumes, lines up with the output samples of every frame.  This holds for
+ * any MIXTYPE_MULTI_MONOVOL, and for mono or stereo MIXTYPE_MULTI.
+ */
+template <int MIXTYPE, int NCHAN, int LANES>
+inline bool mixVectorVolumeRepeats() {
+    return MIXTYPE == MIXTYPE_MULTI_MONOVOL
+            || (MIXTYPE == MIXTYPE_MULTI && NCHAN <= 2 && LANES % NCHAN == 0);
+}
+
 template <int MIXTYPE, int NCHAN,
         typename TO, typename TI, typename TV, typename TA, typename TAV>
 inline void volumeRampMulti(TO* out, size_t frameCount,
@@ -409,6 +464,14 @@ inline void volumeMulti(TO* out, size_t frameCount,
             *aux++ += MixMul<TA, TA, TAV>(auxaccum, vola);
         } while (--frameCount);
     } else {
+        const size_t vectorFrames =
+                MixVector<MIXTYPE, NCHAN, TO, TI, TV>::volumeMulti(out, frameCount, in, vol);
+        if (vectorFrames == frameCount) {
+            return;
+        }
+        frameCount -= vectorFrames;
+        out += vectorFrames * NCHAN;
+        in += (MIXTYPE == MIXTYPE_MONOEXPAND) ? vectorFrames : vectorFrames * NCHAN;
         do {
             switch (MIXTYPE) {
             case MIXTYPE_MULTI:
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_MIXER_OPS_NEON_H
+#define ANDROID_AUDIO_MIXER_OPS_NEON_H
+
+namespace android {
+
+// depends on AudioMixerOps.h
+
+#if USE_NEON
+
+//
+// NEON specializations of MixVector<> for volumeMulti() in AudioMixerOps.h
+//
+// Multiplies and adds are kept separate (vmulq followed by vaddq) so that
+// the results are bit-exact with the scalar MixMul path on both ARMv7 and ARMv8.
+//
+
+template <int MIXTYPE, int NCHAN>
+struct MixVector<MIXTYPE, NCHAN, float, float, float> {
+    static inline size_t volumeMulti(float* out, size_t frameCount,
+            const float* in, const float* vol) {
+        if (MIXTYPE == MIXTYPE_MONOEXPAND && NCHAN == 2) {
+            // 4 mono input samples expand to 4 stereo output frames.
+            const float32x4_t vLR = vcombine_f32(vld1_f32(vol), vld1_f32(vol));
+            size_t frames = frameCount & ~3;
+            for (size_t i = frames; i > 0; i -= 4) {
+                const float32x4x2_t inLR = vzipq_f32(vld1q_f32(in), vld1q_f32(in));
+                in += 4;
+                vst1q_f32(out, vaddq_f32(vld1q_f32(out), vmulq_f32(inLR.val[0], vLR)));
+                vst1q_f32(out + 4, vaddq_f32(vld1q_f32(out + 4), vmulq_f32(inLR.val[1], vLR)));
+                out += 8;
+            }
+            return frames;
+        }
+        if (!mixVectorVolumeRepeats<MIXTYPE, NCHAN, 4>()) {
+            return 0;
+        }
+        float32x4_t v;
+        if (MIXTYPE == MIXTYPE_MULTI_MONOVOL || NCHAN == 1) {
+            v = vdupq_n_f32(vol[0]);
+        } else { // NCHAN == 2
+            v = vcombine_f32(vld1_f32(vol), vld1_f32(vol));
+        }
+        // blocks of 4 frames are always a whole number of 4 sample vectors.
+        const size_t frames = frameCount & ~3;
+        for (size_t i = frames * NCHAN; i > 0; i -= 8) {
+            if (i == 4) { // odd trailing vector for NCHAN == 1, 3, 5, 7.
+                vst1q_f32(out, vaddq_f32(vld1q_f32(out), vmulq_f32(vld1q_f32(in), v)));
+                out += 4;
+                in += 4;
+                break;
+            }
+            vst1q_f32(out, vaddq_f32(vld1q_f32(out), vmulq_f32(vld1q_f32(in), v)));
+            vst1q_f32(out + 4, vaddq_f32(vld1q_f32(out + 4), vmulq_f32(vld1q_f32(in + 4), v)));
+            out += 8;
+            in += 8;
+        }
+        return frames;
+    }
+};
+
+template <int MIXTYPE, int NCHAN>
+struct MixVector<MIXTYPE, NCHAN, int32_t, int16_t, int16_t> {
+    static inline size_t volumeMulti(int32_t* out, size_t frameCount,
+            const int16_t* in, const int16_t* vol) {
+        if (MIXTYPE == MIXTYPE_MONOEXPAND && NCHAN == 2) {
+            // 4 mono input samples expand to 4 stereo output frames.
+            const int16_t volLR[4] = { vol[0], vol[1], vol[0], vol[1] };
+            const int16x4_t vLR = vld1_s16(volLR);
+            size_t frames = frameCount & ~3;
+            for (size_t i = frames; i > 0; i -= 4) {
+                const int16x4x2_t inLR = vzip_s16(vld1_s16(in), vld1_s16(in));
+                in += 4;
+                vst1q_s32(out, vmlal_s16(vld1q_s32(out), inLR.val[0], vLR));
+                vst1q_s32(out + 4, vmlal_s16(vld1q_s32(out + 4), inLR.val[1], vLR));
+                out += 8;
+            }
+            return frames;
+        }
+        if (!mixVectorVolumeRepeats<MIXTYPE, NCHAN, 4>()) {
+            return 0;
+        }
+        int16x4_t v;
+        if (MIXTYPE == MIXTYPE_MULTI_MONOVOL || NCHAN == 1) {
+            v = vdup_n_s16(vol[0]);
+        } else { // NCHAN == 2
+            const int16_t volLR[4] = { vol[0], vol[1], vol[0], vol[1] };
+            v = vld1_s16(volLR);
+        }
+        // vmlal_s16 computes the same Q4.27 product as MixMul<int32_t, int16_t, int16_t>.
+        const size_t frames = frameCount & ~3;
+        for (size_t i = frames * NCHAN; i > 0; i -= 4) {
+            vst1q_s32(out, vmlal_s16(vld1q_s32(out), vld1_s16(in), v));
+            out += 4;
+            in += 4;
+        }
+        return frames;
+    }
+};
+
+#endif //USE_NEON
+
+} // namespace android
+
+#endif /*ANDROID_AUDIO_MIXER_OPS_NEON_H*/
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_MIXER_OPS_SSE_H
+#define ANDROID_AUDIO_MIXER_OPS_SSE_H
+
+namespace android {
+
+// depends on AudioMixerOps.h
+
+#if USE_SSE
+
+//
+// SSSE3 (and AVX2 when compiled for it) specializations of MixVector<>
+// for volumeMulti() in AudioMixerOps.h
+//
+// FMA is not used, so that the results are bit-exact with the scalar MixMul path.
+//
+
+// out[0..7] += in[0..7] * v
+static inline void mixVectorMulAdd8(float* out, const float* in, __m128 v)
+{
+#if defined(__AVX2__)
+    const __m256 v8 = _mm256_insertf128_ps(_mm256_castps128_ps256(v), v, 1);
+    _mm256_storeu_ps(out, _mm256_add_ps(_mm256_loadu_ps(out),
+            _mm256_mul_ps(_mm256_loadu_ps(in), v8)));
+#else
+    _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), _mm_mul_ps(_mm_loadu_ps(in), v)));
+    _mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4),
+            _mm_mul_ps(_mm_loadu_ps(in + 4), v)));
+#endif
+}
+
+// out[0..7] += the Q4.27 products of the 8 int16_t samples in and volumes v
+static inline void mixVectorMulAdd8(int32_t* out, __m128i in, __m128i v)
+{
+    const __m128i lo = _mm_mullo_epi16(in, v);
+    const __m128i hi = _mm_mulhi_epi16(in, v);
+    __m128i* out128 = reinterpret_cast<__m128i*>(out);
+    _mm_storeu_si128(out128, _mm_add_epi32(_mm_loadu_si128(out128),
+            _mm_unpacklo_epi16(lo, hi)));
+    _mm_storeu_si128(out128 + 1, _mm_add_epi32(_mm_loadu_si128(out128 + 1),
+            _mm_unpackhi_epi16(lo, hi)));
+}
+
+template <int MIXTYPE, int NCHAN>
+struct MixVector<MIXTYPE, NCHAN, float, float, float> {
+    static inline size_t volumeMulti(float* out, size_t frameCount,
+            const float* in, const float* vol) {
+        if (MIXTYPE == MIXTYPE_MONOEXPAND && NCHAN == 2) {
+            // 4 mono input samples expand to 4 stereo output frames.
+            const __m128 vLR = _mm_setr_ps(vol[0], vol[1], vol[0], vol[1]);
+            size_t frames = frameCount & ~3;
+            for (size_t i = frames; i > 0; i -= 4) {
+                const __m128 mono = _mm_loadu_ps(in);
+                in += 4;
+                _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out),
+                        _mm_mul_ps(_mm_unpacklo_ps(mono, mono), vLR)));
+                _mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4),
+                        _mm_mul_ps(_mm_unpackhi_ps(mono, mono), vLR)));
+                out += 8;
+            }
+            return frames;
+        }
+        if (!mixVectorVolumeRepeats<MIXTYPE, NCHAN, 4>()) {
+            return 0;
+        }
+        const __m128 v = (MIXTYPE == MIXTYPE_MULTI_MONOVOL || NCHAN == 1)
+                ? _mm_set1_ps(vol[0]) : _mm_setr_ps(vol[0], vol[1], vol[0], vol[1]);
+        // blocks of 4 frames are always a whole number of 4 sample vectors.
+        const size_t frames = frameCount & ~3;
+        for (size_t i = frames * NCHAN; i > 0; i -= 8) {
+            if (i == 4) { // odd trailing vector for NCHAN == 1, 3, 5, 7.
+                _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out),
+                        _mm_mul_ps(_mm_loadu_ps(in), v)));
+                out += 4;
+                in += 4;
+                break;
+            }
+            mixVectorMulAdd8(out, in, v);
+            out += 8;
+            in += 8;
+        }
+        return frames;
+    }
+};
+
+template <int MIXTYPE, int NCHAN>
+struct MixVector<MIXTYPE, NCHAN, int32_t, int16_t, int16_t> {
+    static inline size_t volumeMulti(int32_t* out, size_t frameCount,
+            const int16_t* in, const int16_t* vol) {
+        if (MIXTYPE == MIXTYPE_MONOEXPAND && NCHAN == 2) {
+            // 4 mono input samples expand to 4 stereo output frames.
+            const __m128i vLR = _mm_set1_epi32((uint16_t)vol[0] | ((uint32_t)vol[1] << 16));
+            size_t frames = frameCount & ~3;
+            for (size_t i = frames; i > 0; i -= 4) {
+                const __m128i mono = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in));
+                in += 4;
+                mixVectorMulAdd8(out, _mm_unpacklo_epi16(mono, mono), vLR);
+                out += 8;
+            }
+            return frames;
+        }
+        if (!mixVectorVolumeRepeats<MIXTYPE, NCHAN, 8>()) {
+            return 0;
+        }
+        const __m128i v = (MIXTYPE == MIXTYPE_MULTI_MONOVOL || NCHAN == 1)
+                ? _mm_set1_epi16(vol[0])
+                : _mm_set1_epi32((uint16_t)vol[0] | ((uint32_t)vol[1] << 16));
+        // blocks of 4 frames are always a whole number of 4 sample vectors.
+        const size_t frames = frameCount & ~3;
+        for (size_t i = frames * NCHAN; i > 0; i -= 8) {
+            if (i == 4) { // odd trailing vector for NCHAN == 1, 3, 5, 7.
+                const __m128i prod = _mm_unpacklo_epi16(
+                        _mm_mullo_epi16(
+                                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in)), v),
+                        _mm_mulhi_epi16(
+                                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in)), v));
+                __m128i* out128 = reinterpret_cast<__m128i*>(out);
+                _mm_storeu_si128(out128, _mm_add_epi32(_mm_loadu_si128(out128), prod));
+                out += 4;
+                in += 4;
+                break;
+            }
+            mixVectorMulAdd8(out, _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), v);
+            out += 8;
+            in += 8;
+        }
+        return frames;
+    }
+};
+
+#endif //USE_SSE
+
+} // namespace android
+
+#endif /*ANDROID_AUDIO_MIXER_OPS_SSE_H*/
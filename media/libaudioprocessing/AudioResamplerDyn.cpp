@@ -18,7 +18,9 @@
 //#define LOG_NDEBUG 0
 
 #include <malloc.h>
+#include <pthread.h>
 #include <string.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <dlfcn.h>
 #include <math.h>
@@ -40,6 +42,159 @@
 
 namespace android {
 
+/*
+ * FirCoefficientCache is a short linked list, since only a handful of
+ * distinct conversion ratios are active at any time.
+ */
+struct FirCoefficientCacheEntry {
+    FirCoefficientCacheEntry* mNext;
+    int32_t         mInSampleRate;
+    int32_t         mOutSampleRate;
+    int             mQuality;
+    audio_format_t  mCoefFormat;
+    void*           mCoefs;
+    size_t          mSize;
+    uint32_t        mRefCount;
+};
+
+static pthread_mutex_t sFirCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static FirCoefficientCacheEntry* sFirCacheHead = NULL;
+static uint32_t sFirCacheHits = 0;
+static uint32_t sFirCacheMisses = 0;
+
+// Conversions common enough that their filter banks are kept once designed,
+// even when no resampler uses them.
+static const struct {
+    int32_t mInSampleRate;
+    int32_t mOutSampleRate;
+} kPinnedFirRates[] = {
+    { 44100, 48000 },
+    { 16000, 48000 },
+    {  8000, 48000 },
+    { 96000, 48000 },
+};
+
+static bool isPinnedFirRate(int32_t inSampleRate, int32_t outSampleRate)
+{
+    for (size_t i = 0; i < sizeof(kPinnedFirRates) / sizeof(kPinnedFirRates[0]); i++) {
+        if (kPinnedFirRates[i].mInSampleRate == inSampleRate
+                && kPinnedFirRates[i].mOutSampleRate == outSampleRate) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// must be called with sFirCacheLock held
+static FirCoefficientCacheEntry* findFirCacheEntry(int32_t inSampleRate, int32_t outSampleRate,
+        int quality, audio_format_t coefFormat)
+{
+    for (FirCoefficientCacheEntry* e = sFirCacheHead; e != NULL; e = e->mNext) {
+        if (e->mInSampleRate == inSampleRate && e->mOutSampleRate == outSampleRate
+                && e->mQuality == quality && e->mCoefFormat == coefFormat) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/*static*/
+const void* FirCoefficientCache::acquire(int32_t inSampleRate, int32_t outSampleRate,
+        int quality, audio_format_t coefFormat)
+{
+    const void* coefs = NULL;
+    pthread_mutex_lock(&sFirCacheLock);
+    FirCoefficientCacheEntry* e =
+            findFirCacheEntry(inSampleRate, outSampleRate, quality, coefFormat);
+    if (e != NULL) {
+        e->mRefCount++;
+        sFirCacheHits++;
+        coefs = e->mCoefs;
+    } else {
+        sFirCacheMisses++;
+    }
+    pthread_mutex_unlock(&sFirCacheLock);
+    return coefs;
+}
+
+/*static*/
+const void* FirCoefficientCache::insert(int32_t inSampleRate, int32_t outSampleRate,
+        int quality, audio_format_t coefFormat, void* coefs, size_t size)
+{
+    pthread_mutex_lock(&sFirCacheLock);
+    FirCoefficientCacheEntry* e =
+            findFirCacheEntry(inSampleRate, outSampleRate, quality, coefFormat);
+    if (e != NULL) {
+        // lost a race with another resampler designing the same filter.
+        free(coefs);
+    } else {
+        e = new FirCoefficientCacheEntry;
+        e->mInSampleRate = inSampleRate;
+        e->mOutSampleRate = outSampleRate;
+        e->mQuality = quality;
+        e->mCoefFormat = coefFormat;
+        e->mCoefs = coefs;
+        e->mSize = size;
+        e->mRefCount = 0;
+        e->mNext = sFirCacheHead;
+        sFirCacheHead = e;
+    }
+    e->mRefCount++;
+    const void* cached = e->mCoefs;
+    pthread_mutex_unlock(&sFirCacheLock);
+    return cached;
+}
+
+/*static*/
+void FirCoefficientCache::release(const void* coefs)
+{
+    if (coefs == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&sFirCacheLock);
+    for (FirCoefficientCacheEntry** pe = &sFirCacheHead; *pe != NULL; pe = &(*pe)->mNext) {
+        FirCoefficientCacheEntry* e = *pe;
+        if (e->mCoefs == coefs) {
+            if (--e->mRefCount == 0
+                    && !isPinnedFirRate(e->mInSampleRate, e->mOutSampleRate)) {
+                *pe = e->mNext;
+                free(e->mCoefs);
+                delete e;
+            }
+            pthread_mutex_unlock(&sFirCacheLock);
+            return;
+        }
+    }
+    pthread_mutex_unlock(&sFirCacheLock);
+    ALOGE("FirCoefficientCache::release(%p) of unknown filter", coefs);
+}
+
+/*static*/
+void FirCoefficientCache::dump(int fd)
+{
+    size_t entries = 0;
+    size_t bytes = 0;
+    uint32_t references = 0;
+    pthread_mutex_lock(&sFirCacheLock);
+    for (const FirCoefficientCacheEntry* e = sFirCacheHead; e != NULL; e = e->mNext) {
+        entries++;
+        bytes += e->mSize;
+        references += e->mRefCount;
+    }
+    const uint32_t hits = sFirCacheHits;
+    const uint32_t misses = sFirCacheMisses;
+    pthread_mutex_unlock(&sFirCacheLock);
+    dprintf(fd, "Resampler filter cache: %zu filters (%zu bytes) shared by %u resamplers,"
+            " %u hits, %u misses\n", entries, bytes, references, hits, misses);
+}
+
+template<typename TC>
+static inline audio_format_t firCoefFormat()
+{
+    return is_same<TC, float>::value ? AUDIO_FORMAT_PCM_FLOAT
+            : is_same<TC, int32_t>::value ? AUDIO_FORMAT_PCM_32_BIT : AUDIO_FORMAT_PCM_16_BIT;
+}
+
 /*
  * InBuffer is a type agnostic input buffer.
  *
@@ -190,7 +345,7 @@ AudioResamplerDyn<TC, TI, TO>::AudioResamplerDyn(
 template<typename TC, typename TI, typename TO>
 AudioResamplerDyn<TC, TI, TO>::~AudioResamplerDyn()
 {
-    free(mCoefBuffer);
+    FirCoefficientCache::release(mCoefBuffer);
 }
 
 template<typename TC, typename TI, typename TO>
@@ -223,12 +378,24 @@ template<typename TC, typename TI, typename TO>
 void AudioResamplerDyn<TC, TI, TO>::createKaiserFir(Constants &c,
         double stopBandAtten, int inSampleRate, int outSampleRate, double tbwCheat)
 {
+    // the filter design depends only on the rates, quality and coefficient type,
+    // so reuse a filter bank already generated by another resampler if possible.
+    const void* cached = FirCoefficientCache::acquire(
+            inSampleRate, outSampleRate, mFilterQuality, firCoefFormat<TC>());
+    if (cached != NULL) {
+        FirCoefficientCache::release(mCoefBuffer);
+        mCoefBuffer = cached;
+        c.mFirCoefs = static_cast<const TC*>(cached);
+        return;
+    }
+
     TC* buf = NULL;
     static const double atten = 0.9998;   // to avoid ripple overflow
     double fcr;
     double tbw = firKaiserTbw(c.mHalfNumCoefs, stopBandAtten);
+    const size_t size = (c.mL+1)*c.mHalfNumCoefs*sizeof(TC);
 
-    (void)posix_memalign(reinterpret_cast<void**>(&buf), 32, (c.mL+1)*c.mHalfNumCoefs*sizeof(TC));
+    (void)posix_memalign(reinterpret_cast<void**>(&buf), 32, size);
     if (inSampleRate < outSampleRate) { // upsample
         fcr = max(0.5*tbwCheat - tbw/2, tbw/2);
     } else { // downsample
@@ -236,11 +403,6 @@ void AudioResamplerDyn<TC, TI, TO>::createKaiserFir(Constants &c,
     }
     // create and set filter
     firKaiserGen(buf, c.mL, c.mHalfNumCoefs, stopBandAtten, fcr, atten);
-    c.mFirCoefs = buf;
-    if (mCoefBuffer) {
-        free(mCoefBuffer);
-    }
-    mCoefBuffer = buf;
 #ifdef DEBUG_RESAMPLER
     // print basic filter stats
     printf("L:%d  hnc:%d  stopBandAtten:%lf  fcr:%lf  atten:%lf  tbw:%lf\n",
@@ -255,6 +417,11 @@ void AudioResamplerDyn<TC, TI, TO>::createKaiserFir(Constants &c,
     printf("passband(%lf, %lf): %.8lf %.8lf %.8lf\n", 0., fp, passMin, passMax, passRipple);
     printf("stopband(%lf, %lf): %.8lf %.3lf\n", fs, 0.5, stopMax, stopRipple);
 #endif
+    const void* coefs = FirCoefficientCache::insert(
+            inSampleRate, outSampleRate, mFilterQuality, firCoefFormat<TC>(), buf, size);
+    FirCoefficientCache::release(mCoefBuffer);
+    mCoefBuffer = coefs;
+    c.mFirCoefs = static_cast<const TC*>(coefs);
 }
 
 // recursive gcd. Using objdump, it appears the tail recursion is converted to a while loop.
@@ -25,6 +25,37 @@
 
 namespace android {
 
+/* FirCoefficientCache
+ *
+ * Process-wide, reference counted cache of the polyphase filter banks generated
+ * by AudioResamplerDyn. Resamplers converting between the same sample rates with
+ * the same quality and coefficient format share a single filter bank, instead of
+ * each designing and storing their own copy.
+ *
+ * Filter banks are freed when the last reference is released, except those for the
+ * common conversions to 48 kHz, which are kept for the life of the process so that
+ * tracks at those rates do not design their filter again each time they start.
+ */
+class FirCoefficientCache {
+public:
+    // Returns the cached filter bank with a reference held, or NULL if not present.
+    static const void* acquire(int32_t inSampleRate, int32_t outSampleRate,
+            int quality, audio_format_t coefFormat);
+
+    // Adds a newly generated filter bank of size bytes, allocated with posix_memalign(),
+    // and returns it with a reference held. Ownership of coefs is transferred; if an
+    // identical filter bank was inserted concurrently, coefs is freed and that one is
+    // returned instead.
+    static const void* insert(int32_t inSampleRate, int32_t outSampleRate,
+            int quality, audio_format_t coefFormat, void* coefs, size_t size);
+
+    // Releases a reference returned by acquire() or insert(). NULL is ignored.
+    static void release(const void* coefs);
+
+    // Writes a one line summary of cache usage for dumpsys.
+    static void dump(int fd);
+};
+
 /* AudioResamplerDyn
  *
  * This class template is used for floating point and integer resamplers.
@@ -126,7 +157,7 @@ private:
      resample_ABP_t mResampleFunc;     // called function for resampling
             int32_t mFilterSampleRate; // designed filter sample rate.
         src_quality mFilterQuality;    // designed filter quality.
-              void* mCoefBuffer;       // if a filter is created, this is not null
+        const void* mCoefBuffer;       // if a filter is acquired, this is not null
 };
 
 } // namespace android
@@ -43,6 +43,17 @@ namespace android {
 #define USE_SSE (false)
 #endif
 
+// AVX2/FMA kernels are compiled with a function target attribute
+// and selected at runtime, as the x86 ABI only guarantees SSSE3.
+#if USE_SSE && defined(__GNUC__)
+#ifndef USE_AVX2
+#define USE_AVX2 (true)
+#endif
+#include <immintrin.h>
+#else
+#define USE_AVX2 (false)
+#endif
+
 template<typename T, typename U>
 struct is_same
 {
@@ -150,6 +150,159 @@ static inline void ProcessSSEIntrinsic(float* out,
     _mm_storel_pi(reinterpret_cast<__m64*>(out), outSamp);
 }
 
+#if USE_AVX2
+
+// Returns true if the CPU can run the AVX2/FMA kernels below.
+static inline bool CpuSupportsAVX2FMA()
+{
+    __builtin_cpu_init(); // may be called before static constructors have run
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+static const bool kUseAVX2FMA = CpuSupportsAVX2FMA();
+
+// AVX2/FMA variant of ProcessSSEIntrinsic, processing 8 coefficients per iteration.
+// The use of FMA means that results are not bit-exact with the SSE variant.
+template <int CHANNELS, int STRIDE, bool FIXED>
+__attribute__((target("avx2,fma")))
+static void ProcessAVX2Intrinsic(float* out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* volumeLR,
+        float lerpP,
+        const float* coefsP1,
+        const float* coefsN1)
+{
+    ALOG_ASSERT(count > 0 && (count & 7) == 0); // multiple of 8
+    static_assert(CHANNELS == 1 || CHANNELS == 2, "CHANNELS must be 1 or 2");
+
+    sP -= CHANNELS*(8-1);   // adjust sP for a loop iteration of eight
+
+    // reverses 8 mono samples; deinterleaves (and reverses) 4 stereo frames
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i deinterleaveReverse = _mm256_setr_epi32(6, 4, 2, 0, 7, 5, 3, 1);
+    const __m256i deinterleave = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+    __m256 interp;
+    if (!FIXED) {
+        interp = _mm256_set1_ps(lerpP);
+    }
+
+    __m256 accL, accR;
+    accL = _mm256_setzero_ps();
+    if (CHANNELS == 2) {
+        accR = _mm256_setzero_ps();
+    }
+
+    do {
+        __m256 posCoef = _mm256_loadu_ps(coefsP);
+        __m256 negCoef = _mm256_loadu_ps(coefsN);
+        coefsP += 8;
+        coefsN += 8;
+
+        if (!FIXED) { // interpolate
+            __m256 posCoef1 = _mm256_loadu_ps(coefsP1);
+            __m256 negCoef1 = _mm256_loadu_ps(coefsN1);
+            coefsP1 += 8;
+            coefsN1 += 8;
+
+            // posCoef = interp * (posCoef1 - posCoef) + posCoef
+            // negCoef = interp * (negCoef - negCoef1) + negCoef1
+            posCoef = _mm256_fmadd_ps(_mm256_sub_ps(posCoef1, posCoef), interp, posCoef);
+            negCoef = _mm256_fmadd_ps(_mm256_sub_ps(negCoef, negCoef1), interp, negCoef1);
+        }
+        switch (CHANNELS) {
+        case 1: {
+            __m256 posSamp = _mm256_permutevar8x32_ps(_mm256_loadu_ps(sP), reverse);
+            __m256 negSamp = _mm256_loadu_ps(sN);
+            sP -= 8;
+            sN += 8;
+
+            accL = _mm256_fmadd_ps(posSamp, posCoef, accL);
+            accL = _mm256_fmadd_ps(negSamp, negCoef, accL);
+        } break;
+        case 2: {
+            // the later positive frames hold the first (reversed) coefficients
+            __m256 posSamp0 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(sP+8),
+                    deinterleaveReverse);
+            __m256 posSamp1 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(sP),
+                    deinterleaveReverse);
+            __m256 negSamp0 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(sN), deinterleave);
+            __m256 negSamp1 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(sN+8), deinterleave);
+            sP -= 16;
+            sN += 16;
+
+            __m256 posSampL = _mm256_permute2f128_ps(posSamp0, posSamp1, 0x20);
+            __m256 posSampR = _mm256_permute2f128_ps(posSamp0, posSamp1, 0x31);
+            __m256 negSampL = _mm256_permute2f128_ps(negSamp0, negSamp1, 0x20);
+            __m256 negSampR = _mm256_permute2f128_ps(negSamp0, negSamp1, 0x31);
+
+            accL = _mm256_fmadd_ps(posSampL, posCoef, accL);
+            accR = _mm256_fmadd_ps(posSampR, posCoef, accR);
+            accL = _mm256_fmadd_ps(negSampL, negCoef, accL);
+            accR = _mm256_fmadd_ps(negSampR, negCoef, accR);
+        } break;
+        }
+    } while (count -= 8);
+
+    // fold down to four partial sums per channel
+    __m128 accL4 = _mm_add_ps(_mm256_castps256_ps128(accL), _mm256_extractf128_ps(accL, 1));
+    __m128 accR4;
+    if (CHANNELS == 2) {
+        accR4 = _mm_add_ps(_mm256_castps256_ps128(accR), _mm256_extractf128_ps(accR, 1));
+    }
+
+    // multiply by volume and save
+    __m128 vLR = _mm_setzero_ps();
+    __m128 outSamp;
+    vLR = _mm_loadl_pi(vLR, reinterpret_cast<const __m64*>(volumeLR));
+    outSamp = _mm_loadl_pi(vLR, reinterpret_cast<__m64*>(out));
+
+    // combine and funnel down accumulator
+    __m128 outAccum = _mm_setzero_ps();
+    if (CHANNELS == 1) {
+        // duplicate accL to both L and R
+        outAccum = _mm_add_ps(accL4, _mm_movehl_ps(accL4, accL4));
+        outAccum = _mm_add_ps(outAccum, _mm_shuffle_ps(outAccum, outAccum, 0x11));
+    } else if (CHANNELS == 2) {
+        // accR contains R, fold in
+        outAccum = _mm_hadd_ps(accL4, accR4);
+        outAccum = _mm_hadd_ps(outAccum, outAccum);
+    }
+
+    outSamp = _mm_fmadd_ps(outAccum, vLR, outSamp);
+    _mm_storel_pi(reinterpret_cast<__m64*>(out), outSamp);
+}
+
+#endif //USE_AVX2
+
+// Runs the AVX2/FMA kernel if the CPU supports it, otherwise the SSE kernel.
+template <int CHANNELS, int STRIDE, bool FIXED>
+static inline void ProcessX86Intrinsic(float* out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* volumeLR,
+        float lerpP,
+        const float* coefsP1,
+        const float* coefsN1)
+{
+#if USE_AVX2
+    if (kUseAVX2FMA) {
+        ProcessAVX2Intrinsic<CHANNELS, STRIDE, FIXED>(out, count, coefsP, coefsN, sP, sN,
+                volumeLR, lerpP, coefsP1, coefsN1);
+        return;
+    }
+#endif
+    ProcessSSEIntrinsic<CHANNELS, STRIDE, FIXED>(out, count, coefsP, coefsN, sP, sN,
+            volumeLR, lerpP, coefsP1, coefsN1);
+}
+
 template<>
 inline void ProcessL<1, 16>(float* const out,
         int count,
@@ -159,7 +312,7 @@ inline void ProcessL<1, 16>(float* const out,
         const float* sN,
         const float* const volumeLR)
 {
-    ProcessSSEIntrinsic<1, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+    ProcessX86Intrinsic<1, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
             0 /*lerpP*/, NULL /*coefsP1*/, NULL /*coefsN1*/);
 }
 
@@ -172,7 +325,7 @@ inline void ProcessL<2, 16>(float* const out,
         const float* sN,
         const float* const volumeLR)
 {
-    ProcessSSEIntrinsic<2, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+    ProcessX86Intrinsic<2, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
             0 /*lerpP*/, NULL /*coefsP1*/, NULL /*coefsN1*/);
 }
 
@@ -188,7 +341,7 @@ inline void Process<1, 16>(float* const out,
         float lerpP,
         const float* const volumeLR)
 {
-    ProcessSSEIntrinsic<1, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+    ProcessX86Intrinsic<1, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
             lerpP, coefsP1, coefsN1);
 }
 
@@ -204,7 +357,7 @@ inline void Process<2, 16>(float* const out,
         float lerpP,
         const float* const volumeLR)
 {
-    ProcessSSEIntrinsic<2, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+    ProcessX86Intrinsic<2, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
             lerpP, coefsP1, coefsN1);
 }
 
@@ -37,6 +37,60 @@ static inline T max(const T& a, const T& b)
 
 namespace android {
 
+// Kernels used when no resampling is needed, which do in a single pass over the frames what
+// would otherwise be done by a conversion to float, a channel conversion and a conversion
+// to the destination format, each with its own buffer. The loops are simple enough for the
+// compiler to vectorize them.
+
+template <typename TO, typename TI>
+static inline TO convertSample(TI sample);
+
+template <>
+inline float convertSample<float, int16_t>(int16_t sample)
+{
+    return float_from_i16(sample);
+}
+
+template <>
+inline int16_t convertSample<int16_t, float>(float sample)
+{
+    return clamp16_from_float(sample);
+}
+
+// same as memcpy_by_index_array() followed by memcpy_by_audio_format()
+template <typename TO, typename TI>
+static void remapAndConvert(TO *dst, uint32_t dstChannels,
+        const TI *src, uint32_t srcChannels, const int8_t *idxAry, size_t frames)
+{
+    for (size_t i = 0; i < frames; ++i) {
+        for (uint32_t c = 0; c < dstChannels; ++c) {
+            const int8_t index = idxAry[c];
+            dst[c] = index < 0 ? TO(0) : convertSample<TO, TI>(src[index]);
+        }
+        dst += dstChannels;
+        src += srcChannels;
+    }
+}
+
+// same as the legacy conversions through float: samples are duplicated for upmix, and the
+// average is rounded to the nearest, ties to even, for downmix
+static void upmixToStereo16FromMono16(int16_t *dst, const int16_t *src, size_t frames)
+{
+    for (size_t i = 0; i < frames; ++i) {
+        dst[2 * i] = dst[2 * i + 1] = src[i];
+    }
+}
+
+static void downmixToMono16FromStereo16(int16_t *dst, const int16_t *src, size_t frames)
+{
+    for (size_t i = 0; i < frames; ++i) {
+        const int32_t sum = (int32_t)src[2 * i] + (int32_t)src[2 * i + 1];
+        int32_t average = sum >> 1;
+        average += (sum & average & 1);
+        dst[i] = (int16_t)average;
+    }
+}
+
 RecordBufferConverter::RecordBufferConverter(
         audio_channel_mask_t srcChannelMask, audio_format_t srcFormat,
         uint32_t srcSampleRate,
@@ -56,6 +110,8 @@ RecordBufferConverter::RecordBufferConverter(
             mIsLegacyDownmix(false),
             mIsLegacyUpmix(false),
             mRequiresFloat(false),
+            mIsFusedLegacyMix(false),
+            mIsFusedRemap(false),
             mInputConverterProvider(NULL)
 {
     (void)updateParameters(srcChannelMask, srcFormat, srcSampleRate,
@@ -180,12 +236,26 @@ status_t RecordBufferConverter::updateParameters(
                    && (mDstChannelMask == AUDIO_CHANNEL_IN_STEREO
                             || mDstChannelMask == AUDIO_CHANNEL_IN_FRONT_BACK);
 
+    // can the legacy conversion be done directly on 16 bit data?
+    mIsFusedLegacyMix = mResampler == NULL && (mIsLegacyDownmix || mIsLegacyUpmix)
+            && mSrcFormat == AUDIO_FORMAT_PCM_16_BIT && mDstFormat == AUDIO_FORMAT_PCM_16_BIT;
+
+    // can the channel mask and format conversions be done in one pass?
+    mIsFusedRemap = mResampler == NULL && !mIsLegacyDownmix && !mIsLegacyUpmix
+            && mSrcChannelMask != mDstChannelMask
+            && ((mSrcFormat == AUDIO_FORMAT_PCM_16_BIT && mDstFormat == AUDIO_FORMAT_PCM_FLOAT)
+                || (mSrcFormat == AUDIO_FORMAT_PCM_FLOAT
+                        && mDstFormat == AUDIO_FORMAT_PCM_16_BIT));
+
     // do we need to process in float?
-    mRequiresFloat = mResampler != NULL || mIsLegacyDownmix || mIsLegacyUpmix;
+    mRequiresFloat = mResampler != NULL
+            || ((mIsLegacyDownmix || mIsLegacyUpmix) && !mIsFusedLegacyMix);
 
     // do we need a staging buffer to convert for destination (we can still optimize this)?
     // we use mBufFrameSize > 0 to indicate both frame size as well as buffer necessity
-    if (mResampler != NULL) {
+    if (mIsFusedLegacyMix || mIsFusedRemap) {
+        mBufFrameSize = 0;
+    } else if (mResampler != NULL) {
         mBufFrameSize = max(mSrcChannelCount, (uint32_t)FCC_2)
                 * audio_bytes_per_sample(AUDIO_FORMAT_PCM_FLOAT);
     } else if (mIsLegacyUpmix || mIsLegacyDownmix) { // legacy modes always float
@@ -225,6 +295,24 @@ void RecordBufferConverter::convertNoResampler(
         mBufFrames = frames;
         (void)posix_memalign(&mBuf, 32, mBufFrames * mBufFrameSize);
     }
+    if (mIsFusedLegacyMix) {
+        if (mIsLegacyUpmix) {
+            upmixToStereo16FromMono16((int16_t *)dst, (const int16_t *)src, frames);
+        } else /* mIsLegacyDownmix */ {
+            downmixToMono16FromStereo16((int16_t *)dst, (const int16_t *)src, frames);
+        }
+        return;
+    }
+    if (mIsFusedRemap) {
+        if (mSrcFormat == AUDIO_FORMAT_PCM_16_BIT) {
+            remapAndConvert((float *)dst, mDstChannelCount,
+                    (const int16_t *)src, mSrcChannelCount, mIdxAry, frames);
+        } else {
+            remapAndConvert((int16_t *)dst, mDstChannelCount,
+                    (const float *)src, mSrcChannelCount, mIdxAry, frames);
+        }
+        return;
+    }
     // do we need to do legacy upmix and downmix?
     if (mIsLegacyUpmix || mIsLegacyDownmix) {
         void *dstBuf = mBuf != NULL ? mBuf : dst;
@@ -54,6 +54,10 @@ public:
     static AudioResampler* create(audio_format_t format, int inChannelCount,
             int32_t sampleRate, src_quality quality=DEFAULT_QUALITY);
 
+    // Writes a summary of the filter coefficients shared by the dynamic resamplers
+    // (DYN_*_QUALITY) to fd, for dumpsys.
+    static void dumpFilterCache(int fd);
+
     virtual ~AudioResampler();
 
     virtual void init() = 0;
@@ -38,6 +38,7 @@ LOCAL_SRC_FILES := \
 
 LOCAL_C_INCLUDES := \
     $(call include-path-for, audio-utils) \
+    $(LOCAL_PATH)/.. \
 
 LOCAL_STATIC_LIBRARIES := \
     libsndfile \
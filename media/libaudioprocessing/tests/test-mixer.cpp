@@ -22,6 +22,10 @@
 #include <audio_utils/sndfile.h>
 #include <media/AudioBufferProvider.h>
 #include <media/AudioMixer.h>
+#include <utils/Log.h>
+#include "AudioMixerOps.h"
+#include "AudioMixerOpsNeon.h"
+#include "AudioMixerOpsSSE.h"
 #include "test_utils.h"
 
 /* Testing is typically through creation of an output WAV file from several
@@ -36,6 +40,8 @@
 using namespace android;
 
 static void usage(const char* name) {
+    fprintf(stderr, "Usage: %s -b\n", name);
+    fprintf(stderr, "    -b    check vectorized volume kernels for bit-exactness and exit\n");
     fprintf(stderr, "Usage: %s [-f] [-m] [-c channels]"
                     " [-s sample-rate] [-o <output-file>] [-a <aux-buffer-file>] [-P csv]"
                     " (<input-file> | <command>)+\n", name);
@@ -90,6 +96,68 @@ const char *parseFormat(const char *s, bool *useFloat) {
     return s;
 }
 
+/* Compares volumeMulti(), which uses the MixVector<> NEON/SSE specializations
+ * when available, against a scalar reference built from MixMul directly.
+ * Returns the number of mismatching configurations.
+ */
+template <int MIXTYPE, int NCHAN, typename TO, typename TI, typename TV>
+static int checkVolumeMulti(const char *name) {
+    static const size_t kMaxFrames = 67; // odd, to exercise the scalar tail
+    const size_t inChannels = (MIXTYPE == MIXTYPE_MONOEXPAND) ? 1 : NCHAN;
+    std::vector<TI> in(kMaxFrames * inChannels);
+    std::vector<TO> out(kMaxFrames * NCHAN);
+    std::vector<TO> ref(kMaxFrames * NCHAN);
+    const bool isFloat = is_same<TI, float>::value;
+    TV vol[AudioMixer::MAX_NUM_VOLUMES];
+    vol[0] = isFloat ? 0.37 : 0x0733;
+    vol[1] = isFloat ? 0.91 : 0x0f21;
+
+    for (size_t frames = 1; frames <= kMaxFrames; ++frames) {
+        for (size_t i = 0; i < in.size(); ++i) {
+            in[i] = isFloat ? (TI)(drand48() * 2. - 1.) : (TI)(lrand48() & 0xffff);
+        }
+        for (size_t i = 0; i < out.size(); ++i) {
+            out[i] = ref[i] = isFloat ? (TO)(drand48() * 2. - 1.) : (TO)(lrand48() >> 8);
+        }
+        volumeMulti<MIXTYPE, NCHAN, TO, TI, TV, int32_t, int32_t>(
+                &out[0], frames, &in[0], (int32_t *)NULL, vol, 0);
+        for (size_t f = 0; f < frames; ++f) {
+            for (int c = 0; c < NCHAN; ++c) {
+                const TI value = (MIXTYPE == MIXTYPE_MONOEXPAND) ? in[f] : in[f * NCHAN + c];
+                ref[f * NCHAN + c] += MixMul<TO, TI, TV>(value,
+                        vol[MIXTYPE == MIXTYPE_MULTI_MONOVOL ? 0 : c]);
+            }
+        }
+        if (memcmp(&out[0], &ref[0], out.size() * sizeof(TO)) != 0) {
+            printf("%s: mismatch at %zu frames\n", name, frames);
+            return 1;
+        }
+    }
+    printf("%s: bit-exact\n", name);
+    return 0;
+}
+
+static int checkVolumeKernels() {
+    int failures = 0;
+    failures += checkVolumeMulti<MIXTYPE_MULTI, 1, float, float, float>("float mono");
+    failures += checkVolumeMulti<MIXTYPE_MULTI, 2, float, float, float>("float stereo");
+    failures += checkVolumeMulti<MIXTYPE_MONOEXPAND, 2, float, float, float>(
+            "float mono expand");
+    failures += checkVolumeMulti<MIXTYPE_MULTI_MONOVOL, 5, float, float, float>(
+            "float 5 channel");
+    failures += checkVolumeMulti<MIXTYPE_MULTI_MONOVOL, 8, float, float, float>(
+            "float 8 channel");
+    failures += checkVolumeMulti<MIXTYPE_MULTI, 1, int32_t, int16_t, int16_t>("int16 mono");
+    failures += checkVolumeMulti<MIXTYPE_MULTI, 2, int32_t, int16_t, int16_t>("int16 stereo");
+    failures += checkVolumeMulti<MIXTYPE_MONOEXPAND, 2, int32_t, int16_t, int16_t>(
+            "int16 mono expand");
+    failures += checkVolumeMulti<MIXTYPE_MULTI_MONOVOL, 5, int32_t, int16_t, int16_t>(
+            "int16 5 channel");
+    failures += checkVolumeMulti<MIXTYPE_MULTI_MONOVOL, 8, int32_t, int16_t, int16_t>(
+            "int16 8 channel");
+    return failures;
+}
+
 int main(int argc, char* argv[]) {
     const char* const progname = argv[0];
     bool useInputFloat = false;
@@ -104,8 +172,10 @@ int main(int argc, char* argv[]) {
     std::vector<SignalProvider> providers;
     std::vector<audio_format_t> formats;
 
-    for (int ch; (ch = getopt(argc, argv, "fmc:s:o:a:P:")) != -1;) {
+    for (int ch; (ch = getopt(argc, argv, "bfmc:s:o:a:P:")) != -1;) {
         switch (ch) {
+        case 'b':
+            return checkVolumeKernels() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
         case 'f':
             useInputFloat = true;
             break;
@@ -4,6 +4,7 @@ include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES :=     \
         CentralTendencyStatistics.cpp \
+        LogHistogram.cpp \
         ThreadCpuUsage.cpp
 
 LOCAL_MODULE := libcpustats
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+
+#include <cpustats/LogHistogram.h>
+
+LogHistogram::LogHistogram(double lowest) : mLowest(lowest)
+{
+    reset();
+}
+
+void LogHistogram::sample(double x)
+{
+    int bucket;
+    if (!(x >= mLowest)) {
+        bucket = 0;
+    } else {
+        // x / mLowest = mantissa * 2^exponent, with mantissa in [0.5, 1)
+        int exponent;
+        double mantissa = frexp(x / mLowest, &exponent);
+        int octave = exponent - 1;
+        if (octave >= kOctaves) {
+            bucket = kBuckets - 1;
+        } else {
+            bucket = 1 + octave * kBucketsPerOctave +
+                    (int) ((mantissa - 0.5) * 2 * kBucketsPerOctave);
+        }
+    }
+    // there is a single writer, so no read-modify-write is needed
+    mCounts[bucket].store(mCounts[bucket].load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+    mN.store(mN.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+double LogHistogram::percentile(double p) const
+{
+    uint32_t counts[kBuckets];
+    uint64_t total = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        counts[i] = mCounts[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return NAN;
+    }
+    // smallest sample such that at least p percent of the samples are less or equal to it
+    double rank = ceil(p / 100 * total);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t cumulative = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        cumulative += counts[i];
+        if (cumulative >= rank) {
+            return bucketValue(i);
+        }
+    }
+    return bucketValue(kBuckets - 1);
+}
+
+void LogHistogram::reset()
+{
+    for (int i = 0; i < kBuckets; ++i) {
+        mCounts[i].store(0, std::memory_order_relaxed);
+    }
+    mN.store(0, std::memory_order_relaxed);
+}
+
+double LogHistogram::bucketValue(int bucket) const
+{
+    if (bucket == 0) {
+        return mLowest;
+    }
+    if (bucket == kBuckets - 1) {
+        return ldexp(mLowest, kOctaves);
+    }
+    // middle of the bucket
+    int octave = (bucket - 1) / kBucketsPerOctave;
+    int step = (bucket - 1) % kBucketsPerOctave;
+    return ldexp(mLowest * (1 + (step + 0.5) / kBucketsPerOctave), octave);
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LOG_HISTOGRAM_H
+#define _LOG_HISTOGRAM_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Histogram of samples in logarithmically spaced buckets, for estimating percentiles of a
+// stream of samples in constant memory and constant time per sample.
+// Each octave above the lowest bucket is split into kBucketsPerOctave equal buckets, so an
+// estimated percentile is within 1/(2 * kBucketsPerOctave) of the true value, relatively.
+//
+// sample() neither allocates nor blocks, so it may be called from a real-time thread.
+// Only one thread may call sample() and reset(). percentile() and n() may be called from any
+// thread, and then may not yet account for the samples being added concurrently.
+class LogHistogram {
+
+public:
+
+    // samples smaller than lowest (which must be > 0) are counted in a single bucket,
+    // as are samples of lowest * 2^kOctaves or more
+    explicit LogHistogram(double lowest);
+
+    ~LogHistogram() { }
+
+    // add x to the set of samples
+    void sample(double x);
+
+    // return an estimate of the p-th percentile (0 <= p <= 100) of all samples so far,
+    // or NAN if there are none
+    double percentile(double p) const;
+
+    // return the number of samples added so far
+    uint32_t n() const { return mN.load(std::memory_order_relaxed); }
+
+    // reset the set of samples to be empty
+    void reset();
+
+private:
+    static const int kBucketsPerOctave = 8;
+    static const int kOctaves = 24;
+    // first bucket is for samples below mLowest, last one for samples above all octaves
+    static const int kBuckets = kOctaves * kBucketsPerOctave + 2;
+
+    // return a representative value of the samples in the bucket
+    double bucketValue(int bucket) const;
+
+    const double mLowest;
+    std::atomic<uint32_t> mCounts[kBuckets];
+    std::atomic<uint32_t> mN;   // number of samples so far
+
+};
+
+#endif // _LOG_HISTOGRAM_H
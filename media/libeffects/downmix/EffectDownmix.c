@@ -26,12 +26,44 @@
 
 #include "EffectDownmix.h"
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define DOWNMIX_USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define DOWNMIX_USE_SSE2
+#endif
+
 // Do not submit with DOWNMIX_TEST_CHANNEL_INDEX defined, strictly for testing
 //#define DOWNMIX_TEST_CHANNEL_INDEX 0
-// Do not submit with DOWNMIX_ALWAYS_USE_GENERIC_DOWNMIXER defined, strictly for testing
-//#define DOWNMIX_ALWAYS_USE_GENERIC_DOWNMIXER 0
 
 #define MINUS_3_DB_IN_Q19_12 2896 // -3dB = 0.707 * 2^12 = 2896
+#define UNITY_IN_Q19_12 4096
+
+// Q19.12 contribution to the left and right outputs of each positional channel, indexed by the
+// position of its bit in the channel mask. Left channels fold to the left output, right channels
+// to the right output, and center channels and the LFE to both at -3dB.
+// The outputs are attenuated by 6dB after the fold, see Downmix_foldMatrix().
+static const int16_t kFoldMatrix[][2] = {
+    { UNITY_IN_Q19_12, 0 },                         // FRONT_LEFT
+    { 0, UNITY_IN_Q19_12 },                         // FRONT_RIGHT
+    { MINUS_3_DB_IN_Q19_12, MINUS_3_DB_IN_Q19_12 }, // FRONT_CENTER
+    { MINUS_3_DB_IN_Q19_12, MINUS_3_DB_IN_Q19_12 }, // LOW_FREQUENCY
+    { UNITY_IN_Q19_12, 0 },                         // BACK_LEFT
+    { 0, UNITY_IN_Q19_12 },                         // BACK_RIGHT
+    { UNITY_IN_Q19_12, 0 },                         // FRONT_LEFT_OF_CENTER
+    { 0, UNITY_IN_Q19_12 },                         // FRONT_RIGHT_OF_CENTER
+    { MINUS_3_DB_IN_Q19_12, MINUS_3_DB_IN_Q19_12 }, // BACK_CENTER
+    { UNITY_IN_Q19_12, 0 },                         // SIDE_LEFT
+    { 0, UNITY_IN_Q19_12 },                         // SIDE_RIGHT
+    { MINUS_3_DB_IN_Q19_12, MINUS_3_DB_IN_Q19_12 }, // TOP_CENTER
+    { UNITY_IN_Q19_12, 0 },                         // TOP_FRONT_LEFT
+    { MINUS_3_DB_IN_Q19_12, MINUS_3_DB_IN_Q19_12 }, // TOP_FRONT_CENTER
+    { 0, UNITY_IN_Q19_12 },                         // TOP_FRONT_RIGHT
+    { UNITY_IN_Q19_12, 0 },                         // TOP_BACK_LEFT
+    { MINUS_3_DB_IN_Q19_12, MINUS_3_DB_IN_Q19_12 }, // TOP_BACK_CENTER
+    { 0, UNITY_IN_Q19_12 },                         // TOP_BACK_RIGHT
+};
 
 // subset of possible audio_channel_mask_t values, and AUDIO_CHANNEL_OUT_* renamed to CHANNEL_MASK_*
 typedef enum {
@@ -87,94 +119,41 @@ const int kNbEffects = sizeof(gDescriptors) / sizeof(const effect_descriptor_t *
 /*----------------------------------------------------------------------------
  * Test code
  *--------------------------------------------------------------------------*/
-#ifdef DOWNMIX_TEST_CHANNEL_INDEX
-// strictly for testing, logs the indices of the channels for a given mask,
-// uses the same code as Downmix_foldGeneric()
-void Downmix_testIndexComputation(uint32_t mask) {
-    ALOGI("Testing index computation for 0x%" PRIx32 ":", mask);
-    // check against unsupported channels
-    if (mask & kUnsupported) {
-        ALOGE("Unsupported channels (top or front left/right of center)");
-        return;
-    }
-    // verify has FL/FR
-    if ((mask & AUDIO_CHANNEL_OUT_STEREO) != AUDIO_CHANNEL_OUT_STEREO) {
-        ALOGE("Front channels must be present");
-        return;
-    }
-    // verify uses SIDE as a pair (ok if not using SIDE at all)
-    bool hasSides = false;
-    if ((mask & kSides) != 0) {
-        if ((mask & kSides) != kSides) {
-            ALOGE("Side channels must be used as a pair");
-            return;
-        }
-        hasSides = true;
-    }
-    // verify uses BACK as a pair (ok if not using BACK at all)
-    bool hasBacks = false;
-    if ((mask & kBacks) != 0) {
-        if ((mask & kBacks) != kBacks) {
-            ALOGE("Back channels must be used as a pair");
-            return;
-        }
-        hasBacks = true;
-    }
-
-    const int numChan = audio_channel_count_from_out_mask(mask);
-    const bool hasFC = ((mask & AUDIO_CHANNEL_OUT_FRONT_CENTER) == AUDIO_CHANNEL_OUT_FRONT_CENTER);
-    const bool hasLFE =
-            ((mask & AUDIO_CHANNEL_OUT_LOW_FREQUENCY) == AUDIO_CHANNEL_OUT_LOW_FREQUENCY);
-    const bool hasBC = ((mask & AUDIO_CHANNEL_OUT_BACK_CENTER) == AUDIO_CHANNEL_OUT_BACK_CENTER);
-    // compute at what index each channel is: samples will be in the following order:
-    //   FL FR FC LFE BL BR BC SL SR
-    // when a channel is not present, its index is set to the same as the index of the preceding
-    // channel
-    const int indexFC  = hasFC    ? 2            : 1;        // front center
-    const int indexLFE = hasLFE   ? indexFC + 1  : indexFC;  // low frequency
-    const int indexBL  = hasBacks ? indexLFE + 1 : indexLFE; // back left
-    const int indexBR  = hasBacks ? indexBL + 1  : indexBL;  // back right
-    const int indexBC  = hasBC    ? indexBR + 1  : indexBR;  // back center
-    const int indexSL  = hasSides ? indexBC + 1  : indexBC;  // side left
-    const int indexSR  = hasSides ? indexSL + 1  : indexSL;  // side right
-
-    ALOGI("  FL FR FC LFE BL BR BC SL SR");
-    ALOGI("   %d  %d  %d   %d  %d  %d  %d  %d  %d",
-            0, 1, indexFC, indexLFE, indexBL, indexBR, indexBC, indexSL, indexSR);
-}
-#endif
 
 static bool Downmix_validChannelMask(uint32_t mask)
 {
     if (!mask) {
         return false;
     }
-    // check against unsupported channels
-    if (mask & kUnsupported) {
-        ALOGE("Unsupported channels (top or front left/right of center)");
+    // only positional masks have a known speaker layout
+    if (audio_channel_mask_get_representation(mask) != AUDIO_CHANNEL_REPRESENTATION_POSITION) {
+        ALOGE("Only positional channel masks are supported");
         return false;
     }
-    // verify has FL/FR
-    if ((mask & AUDIO_CHANNEL_OUT_STEREO) != AUDIO_CHANNEL_OUT_STEREO) {
-        ALOGE("Front channels must be present");
+    // check against unsupported channels
+    if (mask & ~kSupported) {
+        ALOGE("Unsupported channels 0x%" PRIx32, mask & ~kSupported);
         return false;
     }
-    // verify uses SIDE as a pair (ok if not using SIDE at all)
-    if ((mask & kSides) != 0) {
-        if ((mask & kSides) != kSides) {
-            ALOGE("Side channels must be used as a pair");
-            return false;
-        }
+    return true;
+}
+
+#ifdef DOWNMIX_TEST_CHANNEL_INDEX
+// strictly for testing, logs the matrix for a given mask,
+// uses the same code as Downmix_Configure()
+void Downmix_testMatrixComputation(uint32_t mask) {
+    ALOGI("Testing matrix computation for 0x%" PRIx32 ":", mask);
+    if (!Downmix_validChannelMask(mask)) {
+        return;
     }
-    // verify uses BACK as a pair (ok if not using BACK at all)
-    if ((mask & kBacks) != 0) {
-        if ((mask & kBacks) != kBacks) {
-            ALOGE("Back channels must be used as a pair");
-            return false;
-        }
+    downmix_object_t downmixer;
+    Downmix_setMatrix(&downmixer, mask);
+    for (int i = 0; i < downmixer.input_channel_count; i++) {
+        ALOGI("  channel %d: left %d right %d",
+                i, downmixer.matrix_left[i], downmixer.matrix_right[i]);
     }
-    return true;
 }
+#endif
 
 /*----------------------------------------------------------------------------
  * Effect API implementation
@@ -196,21 +175,19 @@ int32_t DownmixLib_Create(const effect_uuid_t *uuid,
 #ifdef DOWNMIX_TEST_CHANNEL_INDEX
     // should work (won't log an error)
     ALOGI("DOWNMIX_TEST_CHANNEL_INDEX: should work:");
-    Downmix_testIndexComputation(AUDIO_CHANNEL_OUT_FRONT_LEFT | AUDIO_CHANNEL_OUT_FRONT_RIGHT |
+    Downmix_testMatrixComputation(AUDIO_CHANNEL_OUT_FRONT_LEFT | AUDIO_CHANNEL_OUT_FRONT_RIGHT |
                     AUDIO_CHANNEL_OUT_LOW_FREQUENCY | AUDIO_CHANNEL_OUT_BACK_CENTER);
-    Downmix_testIndexComputation(CHANNEL_MASK_QUAD_SIDE | CHANNEL_MASK_QUAD_BACK);
-    Downmix_testIndexComputation(CHANNEL_MASK_5POINT1_SIDE | AUDIO_CHANNEL_OUT_BACK_CENTER);
-    Downmix_testIndexComputation(CHANNEL_MASK_5POINT1_BACK | AUDIO_CHANNEL_OUT_BACK_CENTER);
-    // shouldn't work (will log an error, won't display channel indices)
-    ALOGI("DOWNMIX_TEST_CHANNEL_INDEX: should NOT work:");
-    Downmix_testIndexComputation(AUDIO_CHANNEL_OUT_FRONT_LEFT | AUDIO_CHANNEL_OUT_FRONT_RIGHT |
+    Downmix_testMatrixComputation(CHANNEL_MASK_QUAD_SIDE | CHANNEL_MASK_QUAD_BACK);
+    Downmix_testMatrixComputation(CHANNEL_MASK_5POINT1_SIDE | AUDIO_CHANNEL_OUT_BACK_CENTER);
+    Downmix_testMatrixComputation(CHANNEL_MASK_5POINT1_BACK | AUDIO_CHANNEL_OUT_BACK_CENTER);
+    Downmix_testMatrixComputation(CHANNEL_MASK_7POINT1 | AUDIO_CHANNEL_OUT_TOP_FRONT_LEFT |
+                    AUDIO_CHANNEL_OUT_TOP_FRONT_RIGHT);
+    Downmix_testMatrixComputation(AUDIO_CHANNEL_OUT_FRONT_LEFT | AUDIO_CHANNEL_OUT_FRONT_RIGHT |
                         AUDIO_CHANNEL_OUT_LOW_FREQUENCY | AUDIO_CHANNEL_OUT_BACK_LEFT);
-    Downmix_testIndexComputation(AUDIO_CHANNEL_OUT_FRONT_LEFT | AUDIO_CHANNEL_OUT_FRONT_RIGHT |
-                            AUDIO_CHANNEL_OUT_LOW_FREQUENCY | AUDIO_CHANNEL_OUT_SIDE_LEFT);
-    Downmix_testIndexComputation(AUDIO_CHANNEL_OUT_FRONT_LEFT |
-                        AUDIO_CHANNEL_OUT_BACK_LEFT | AUDIO_CHANNEL_OUT_BACK_RIGHT);
-    Downmix_testIndexComputation(AUDIO_CHANNEL_OUT_FRONT_LEFT |
-                            AUDIO_CHANNEL_OUT_SIDE_LEFT | AUDIO_CHANNEL_OUT_SIDE_RIGHT);
+    // shouldn't work (will log an error, won't display the matrix)
+    ALOGI("DOWNMIX_TEST_CHANNEL_INDEX: should NOT work:");
+    Downmix_testMatrixComputation(AUDIO_CHANNEL_NONE);
+    Downmix_testMatrixComputation(audio_channel_mask_for_index_assignment_from_count(6));
 #endif
 
     if (pHandle == NULL || uuid == NULL) {
@@ -322,7 +299,6 @@ static int Downmix_Process(effect_handle_t self,
 
     const bool accumulate =
             (pDwmModule->config.outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE);
-    const uint32_t downmixInputChannelMask = pDwmModule->config.inputCfg.channels;
 
     switch(pDownmixer->type) {
 
@@ -347,36 +323,7 @@ static int Downmix_Process(effect_handle_t self,
           break;
 
       case DOWNMIX_TYPE_FOLD:
-#ifdef DOWNMIX_ALWAYS_USE_GENERIC_DOWNMIXER
-          // bypass the optimized downmix routines for the common formats
-          if (!Downmix_foldGeneric(
-                  downmixInputChannelMask, pSrc, pDst, numFrames, accumulate)) {
-              ALOGE("Multichannel configuration 0x%" PRIx32 " is not supported", downmixInputChannelMask);
-              return -EINVAL;
-          }
-          break;
-#endif
-        // optimize for the common formats
-        switch((downmix_input_channel_mask_t)downmixInputChannelMask) {
-        case CHANNEL_MASK_QUAD_BACK:
-        case CHANNEL_MASK_QUAD_SIDE:
-            Downmix_foldFromQuad(pSrc, pDst, numFrames, accumulate);
-            break;
-        case CHANNEL_MASK_5POINT1_BACK:
-        case CHANNEL_MASK_5POINT1_SIDE:
-            Downmix_foldFrom5Point1(pSrc, pDst, numFrames, accumulate);
-            break;
-        case CHANNEL_MASK_7POINT1:
-            Downmix_foldFrom7Point1(pSrc, pDst, numFrames, accumulate);
-            break;
-        default:
-            if (!Downmix_foldGeneric(
-                    downmixInputChannelMask, pSrc, pDst, numFrames, accumulate)) {
-                ALOGE("Multichannel configuration 0x%" PRIx32 " is not supported", downmixInputChannelMask);
-                return -EINVAL;
-            }
-            break;
-        }
+        Downmix_foldMatrix(pDownmixer, pSrc, pDst, numFrames, accumulate);
         break;
 
       default:
@@ -655,7 +602,6 @@ int Downmix_Configure(downmix_module_t *pDwmModule, effect_config_t *pConfig, bo
     if (init) {
         pDownmixer->type = DOWNMIX_TYPE_FOLD;
         pDownmixer->apply_volume_correction = false;
-        pDownmixer->input_channel_count = 8; // matches default input of AUDIO_CHANNEL_OUT_7POINT1
     } else {
         // when configuring the effect, do not allow a blank or unsupported channel mask
         if (!Downmix_validChannelMask(pConfig->inputCfg.channels)) {
@@ -663,9 +609,9 @@ int Downmix_Configure(downmix_module_t *pDwmModule, effect_config_t *pConfig, bo
                                                         pConfig->inputCfg.channels);
             return -EINVAL;
         }
-        pDownmixer->input_channel_count =
-                audio_channel_count_from_out_mask(pConfig->inputCfg.channels);
     }
+    // also sets input_channel_count
+    Downmix_setMatrix(pDownmixer, pConfig->inputCfg.channels);
 
     Downmix_Reset(pDownmixer, init);
 
@@ -802,293 +748,151 @@ int Downmix_getParameter(downmix_object_t *pDownmixer, int32_t param, uint32_t *
 
 
 /*----------------------------------------------------------------------------
- * Downmix_foldFromQuad()
+ * Downmix_setMatrix()
  *----------------------------------------------------------------------------
  * Purpose:
- * downmix a quad signal to stereo
+ * compute the fold matrix and the number of input channels for a channel mask
  *
  * Inputs:
- *  pSrc       quad audio samples to downmix
- *  numFrames  the number of quad frames to downmix
- *  accumulate whether to mix (when true) the result of the downmix with the contents of pDst,
- *               or overwrite pDst (when false)
+ *  mask       a channel mask accepted by Downmix_validChannelMask()
  *
  * Outputs:
- *  pDst       downmixed stereo audio samples
+ *  pDownmixer input_channel_count, matrix_left and matrix_right are updated
  *
  *----------------------------------------------------------------------------
  */
-void Downmix_foldFromQuad(int16_t *pSrc, int16_t*pDst, size_t numFrames, bool accumulate) {
-    // sample at index 0 is FL
-    // sample at index 1 is FR
-    // sample at index 2 is RL
-    // sample at index 3 is RR
-    if (accumulate) {
-        while (numFrames) {
-            // FL + RL
-            pDst[0] = clamp16(pDst[0] + ((pSrc[0] + pSrc[2]) >> 1));
-            // FR + RR
-            pDst[1] = clamp16(pDst[1] + ((pSrc[1] + pSrc[3]) >> 1));
-            pSrc += 4;
-            pDst += 2;
-            numFrames--;
-        }
-    } else { // same code as above but without adding and clamping pDst[i] to itself
-        while (numFrames) {
-            // FL + RL
-            pDst[0] = clamp16((pSrc[0] + pSrc[2]) >> 1);
-            // FR + RR
-            pDst[1] = clamp16((pSrc[1] + pSrc[3]) >> 1);
-            pSrc += 4;
-            pDst += 2;
-            numFrames--;
+void Downmix_setMatrix(downmix_object_t *pDownmixer, uint32_t mask) {
+    int numChan = 0;
+
+    memset(pDownmixer->matrix_left, 0, sizeof(pDownmixer->matrix_left));
+    memset(pDownmixer->matrix_right, 0, sizeof(pDownmixer->matrix_right));
+    // samples are in the order of the bits of the mask
+    for (size_t bit = 0; bit < sizeof(kFoldMatrix) / sizeof(kFoldMatrix[0]); bit++) {
+        if (mask & (1u << bit)) {
+            pDownmixer->matrix_left[numChan] = kFoldMatrix[bit][0];
+            pDownmixer->matrix_right[numChan] = kFoldMatrix[bit][1];
+            numChan++;
         }
     }
+    pDownmixer->input_channel_count = numChan;
 }
 
 
 /*----------------------------------------------------------------------------
- * Downmix_foldFrom5Point1()
+ * Downmix_foldMatrix()
  *----------------------------------------------------------------------------
  * Purpose:
- * downmix a 5.1 signal to stereo
+ * downmix a multichannel signal to stereo with the fold matrix of the downmixer
  *
- * Inputs:
- *  pSrc       5.1 audio samples to downmix
- *  numFrames  the number of 5.1 frames to downmix
- *  accumulate whether to mix (when true) the result of the downmix with the contents of pDst,
- *               or overwrite pDst (when false)
- *
- * Outputs:
- *  pDst       downmixed stereo audio samples
- *
- *----------------------------------------------------------------------------
- */
-void Downmix_foldFrom5Point1(int16_t *pSrc, int16_t*pDst, size_t numFrames, bool accumulate) {
-    int32_t lt, rt, centerPlusLfeContrib; // samples in Q19.12 format
-    // sample at index 0 is FL
-    // sample at index 1 is FR
-    // sample at index 2 is FC
-    // sample at index 3 is LFE
-    // sample at index 4 is RL
-    // sample at index 5 is RR
-    // code is mostly duplicated between the two values of accumulate to avoid repeating the test
-    // for every sample
-    if (accumulate) {
-        while (numFrames) {
-            // centerPlusLfeContrib = FC(-3dB) + LFE(-3dB)
-            centerPlusLfeContrib = (pSrc[2] * MINUS_3_DB_IN_Q19_12)
-                    + (pSrc[3] * MINUS_3_DB_IN_Q19_12);
-            // FL + centerPlusLfeContrib + RL
-            lt = (pSrc[0] << 12) + centerPlusLfeContrib + (pSrc[4] << 12);
-            // FR + centerPlusLfeContrib + RR
-            rt = (pSrc[1] << 12) + centerPlusLfeContrib + (pSrc[5] << 12);
-            // accumulate in destination
-            pDst[0] = clamp16(pDst[0] + (lt >> 13));
-            pDst[1] = clamp16(pDst[1] + (rt >> 13));
-            pSrc += 6;
-            pDst += 2;
-            numFrames--;
-        }
-    } else { // same code as above but without adding and clamping pDst[i] to itself
-        while (numFrames) {
-            // centerPlusLfeContrib = FC(-3dB) + LFE(-3dB)
-            centerPlusLfeContrib = (pSrc[2] * MINUS_3_DB_IN_Q19_12)
-                    + (pSrc[3] * MINUS_3_DB_IN_Q19_12);
-            // FL + centerPlusLfeContrib + RL
-            lt = (pSrc[0] << 12) + centerPlusLfeContrib + (pSrc[4] << 12);
-            // FR + centerPlusLfeContrib + RR
-            rt = (pSrc[1] << 12) + centerPlusLfeContrib + (pSrc[5] << 12);
-            // store in destination
-            pDst[0] = clamp16(lt >> 13); // differs from when accumulate is true above
-            pDst[1] = clamp16(rt >> 13); // differs from when accumulate is true above
-            pSrc += 6;
-            pDst += 2;
-            numFrames--;
-        }
-    }
-}
-
-
-/*----------------------------------------------------------------------------
- * Downmix_foldFrom7Point1()
- *----------------------------------------------------------------------------
- * Purpose:
- * downmix a 7.1 signal to stereo
+ * For each output, the input samples are weighted by their Q19.12 matrix coefficients, and
+ * the sum is attenuated by 6dB and clamped. The sums are exact, so the vector kernels give the
+ * same output as the scalar one.
  *
  * Inputs:
- *  pSrc       7.1 audio samples to downmix
- *  numFrames  the number of 7.1 frames to downmix
+ *  pDownmixer downmix context, with the fold matrix of the input channel mask
+ *  pSrc       multichannel audio buffer to downmix
+ *  numFrames  the number of multichannel frames to downmix
  *  accumulate whether to mix (when true) the result of the downmix with the contents of pDst,
  *               or overwrite pDst (when false)
  *
  * Outputs:
- *  pDst       downmixed stereo audio samples
+ *  pDst       downmixed stereo audio samples, may be the same buffer as pSrc
  *
  *----------------------------------------------------------------------------
  */
-void Downmix_foldFrom7Point1(int16_t *pSrc, int16_t*pDst, size_t numFrames, bool accumulate) {
-    int32_t lt, rt, centerPlusLfeContrib; // samples in Q19.12 format
-    // sample at index 0 is FL
-    // sample at index 1 is FR
-    // sample at index 2 is FC
-    // sample at index 3 is LFE
-    // sample at index 4 is RL
-    // sample at index 5 is RR
-    // sample at index 6 is SL
-    // sample at index 7 is SR
-    // code is mostly duplicated between the two values of accumulate to avoid repeating the test
-    // for every sample
+static inline void Downmix_storeFrame(int16_t *pDst, int32_t lt, int32_t rt, bool accumulate) {
     if (accumulate) {
-        while (numFrames) {
-            // centerPlusLfeContrib = FC(-3dB) + LFE(-3dB)
-            centerPlusLfeContrib = (pSrc[2] * MINUS_3_DB_IN_Q19_12)
-                    + (pSrc[3] * MINUS_3_DB_IN_Q19_12);
-            // FL + centerPlusLfeContrib + SL + RL
-            lt = (pSrc[0] << 12) + centerPlusLfeContrib + (pSrc[6] << 12) + (pSrc[4] << 12);
-            // FR + centerPlusLfeContrib + SR + RR
-            rt = (pSrc[1] << 12) + centerPlusLfeContrib + (pSrc[7] << 12) + (pSrc[5] << 12);
-            //accumulate in destination
-            pDst[0] = clamp16(pDst[0] + (lt >> 13));
-            pDst[1] = clamp16(pDst[1] + (rt >> 13));
-            pSrc += 8;
-            pDst += 2;
-            numFrames--;
-    }
-    } else { // same code as above but without adding and clamping pDst[i] to itself
-        while (numFrames) {
-            // centerPlusLfeContrib = FC(-3dB) + LFE(-3dB)
-            centerPlusLfeContrib = (pSrc[2] * MINUS_3_DB_IN_Q19_12)
-                    + (pSrc[3] * MINUS_3_DB_IN_Q19_12);
-            // FL + centerPlusLfeContrib + SL + RL
-            lt = (pSrc[0] << 12) + centerPlusLfeContrib + (pSrc[6] << 12) + (pSrc[4] << 12);
-            // FR + centerPlusLfeContrib + SR + RR
-            rt = (pSrc[1] << 12) + centerPlusLfeContrib + (pSrc[7] << 12) + (pSrc[5] << 12);
-            // store in destination
-            pDst[0] = clamp16(lt >> 13); // differs from when accumulate is true above
-            pDst[1] = clamp16(rt >> 13); // differs from when accumulate is true above
-            pSrc += 8;
-            pDst += 2;
-            numFrames--;
-        }
+        pDst[0] = clamp16(pDst[0] + (lt >> 13));
+        pDst[1] = clamp16(pDst[1] + (rt >> 13));
+    } else {
+        pDst[0] = clamp16(lt >> 13);
+        pDst[1] = clamp16(rt >> 13);
     }
 }
 
-
-/*----------------------------------------------------------------------------
- * Downmix_foldGeneric()
- *----------------------------------------------------------------------------
- * Purpose:
- * downmix to stereo a multichannel signal whose format is:
- *  - has FL/FR
- *  - if using AUDIO_CHANNEL_OUT_SIDE*, it contains both left and right
- *  - if using AUDIO_CHANNEL_OUT_BACK*, it contains both left and right
- *  - doesn't use any of the AUDIO_CHANNEL_OUT_TOP* channels
- *  - doesn't use any of the AUDIO_CHANNEL_OUT_FRONT_*_OF_CENTER channels
- * Only handles channel masks not enumerated in downmix_input_channel_mask_t
- *
- * Inputs:
- *  mask       the channel mask of pSrc
- *  pSrc       multichannel audio buffer to downmix
- *  numFrames  the number of multichannel frames to downmix
- *  accumulate whether to mix (when true) the result of the downmix with the contents of pDst,
- *               or overwrite pDst (when false)
- *
- * Outputs:
- *  pDst       downmixed stereo audio samples
- *
- * Returns: false if multichannel format is not supported
- *
- *----------------------------------------------------------------------------
- */
-bool Downmix_foldGeneric(
-        uint32_t mask, int16_t *pSrc, int16_t*pDst, size_t numFrames, bool accumulate) {
-
-    if (!Downmix_validChannelMask(mask)) {
-        return false;
+void Downmix_foldMatrix(const downmix_object_t *pDownmixer,
+        const int16_t *pSrc, int16_t *pDst, size_t numFrames, bool accumulate) {
+    const size_t numChan = pDownmixer->input_channel_count;
+    if (numChan == 0) {
+        return;
     }
 
-    const bool hasSides = (mask & kSides) != 0;
-    const bool hasBacks = (mask & kBacks) != 0;
-
-    const int numChan = audio_channel_count_from_out_mask(mask);
-    const bool hasFC = ((mask & AUDIO_CHANNEL_OUT_FRONT_CENTER) == AUDIO_CHANNEL_OUT_FRONT_CENTER);
-    const bool hasLFE =
-            ((mask & AUDIO_CHANNEL_OUT_LOW_FREQUENCY) == AUDIO_CHANNEL_OUT_LOW_FREQUENCY);
-    const bool hasBC = ((mask & AUDIO_CHANNEL_OUT_BACK_CENTER) == AUDIO_CHANNEL_OUT_BACK_CENTER);
-    // compute at what index each channel is: samples will be in the following order:
-    //   FL FR FC LFE BL BR BC SL SR
-    // when a channel is not present, its index is set to the same as the index of the preceding
-    // channel
-    const int indexFC  = hasFC    ? 2            : 1;        // front center
-    const int indexLFE = hasLFE   ? indexFC + 1  : indexFC;  // low frequency
-    const int indexBL  = hasBacks ? indexLFE + 1 : indexLFE; // back left
-    const int indexBR  = hasBacks ? indexBL + 1  : indexBL;  // back right
-    const int indexBC  = hasBC    ? indexBR + 1  : indexBR;  // back center
-    const int indexSL  = hasSides ? indexBC + 1  : indexBC;  // side left
-    const int indexSR  = hasSides ? indexSL + 1  : indexSL;  // side right
-
-    int32_t lt, rt, centersLfeContrib; // samples in Q19.12 format
-    // code is mostly duplicated between the two values of accumulate to avoid repeating the test
-    // for every sample
-    if (accumulate) {
-        while (numFrames) {
-            // compute contribution of FC, BC and LFE
-            centersLfeContrib = 0;
-            if (hasFC)  { centersLfeContrib += pSrc[indexFC]; }
-            if (hasLFE) { centersLfeContrib += pSrc[indexLFE]; }
-            if (hasBC)  { centersLfeContrib += pSrc[indexBC]; }
-            centersLfeContrib *= MINUS_3_DB_IN_Q19_12;
-            // always has FL/FR
-            lt = (pSrc[0] << 12);
-            rt = (pSrc[1] << 12);
-            // mix in sides and backs
-            if (hasSides) {
-                lt += pSrc[indexSL] << 12;
-                rt += pSrc[indexSR] << 12;
-            }
-            if (hasBacks) {
-                lt += pSrc[indexBL] << 12;
-                rt += pSrc[indexBR] << 12;
-            }
-            lt += centersLfeContrib;
-            rt += centersLfeContrib;
-            // accumulate in destination
-            pDst[0] = clamp16(pDst[0] + (lt >> 13));
-            pDst[1] = clamp16(pDst[1] + (rt >> 13));
-            pSrc += numChan;
-            pDst += 2;
-            numFrames--;
+#if defined(DOWNMIX_USE_NEON) || defined(DOWNMIX_USE_SSE2)
+    // A frame is read as whole vectors of 8 samples, which may extend into the next frame
+    // where the matrix is zero. The frames whose vectors would extend past the end of the
+    // buffer are left to the scalar kernel.
+    const size_t numVectors = (numChan + 7) / 8;
+    const size_t numSamples = numFrames * numChan;
+    size_t vectorFrames = 0;
+    if (numSamples >= numVectors * 8) {
+        vectorFrames = (numSamples - numVectors * 8) / numChan + 1;
+    }
+    numFrames -= vectorFrames;
+
+#if defined(DOWNMIX_USE_NEON)
+    int16x8_t vCoefL[DOWNMIX_MATRIX_CHANNELS / 8];
+    int16x8_t vCoefR[DOWNMIX_MATRIX_CHANNELS / 8];
+    for (size_t k = 0; k < numVectors; k++) {
+        vCoefL[k] = vld1q_s16(pDownmixer->matrix_left + 8 * k);
+        vCoefR[k] = vld1q_s16(pDownmixer->matrix_right + 8 * k);
+    }
+    while (vectorFrames) {
+        int32x4_t accL = vdupq_n_s32(0);
+        int32x4_t accR = vdupq_n_s32(0);
+        for (size_t k = 0; k < numVectors; k++) {
+            const int16x8_t in = vld1q_s16(pSrc + 8 * k);
+            accL = vmlal_s16(accL, vget_low_s16(in), vget_low_s16(vCoefL[k]));
+            accL = vmlal_s16(accL, vget_high_s16(in), vget_high_s16(vCoefL[k]));
+            accR = vmlal_s16(accR, vget_low_s16(in), vget_low_s16(vCoefR[k]));
+            accR = vmlal_s16(accR, vget_high_s16(in), vget_high_s16(vCoefR[k]));
         }
-    } else {
-        while (numFrames) {
-            // compute contribution of FC, BC and LFE
-            centersLfeContrib = 0;
-            if (hasFC)  { centersLfeContrib += pSrc[indexFC]; }
-            if (hasLFE) { centersLfeContrib += pSrc[indexLFE]; }
-            if (hasBC)  { centersLfeContrib += pSrc[indexBC]; }
-            centersLfeContrib *= MINUS_3_DB_IN_Q19_12;
-            // always has FL/FR
-            lt = (pSrc[0] << 12);
-            rt = (pSrc[1] << 12);
-            // mix in sides and backs
-            if (hasSides) {
-                lt += pSrc[indexSL] << 12;
-                rt += pSrc[indexSR] << 12;
-            }
-            if (hasBacks) {
-                lt += pSrc[indexBL] << 12;
-                rt += pSrc[indexBR] << 12;
-            }
-            lt += centersLfeContrib;
-            rt += centersLfeContrib;
-            // store in destination
-            pDst[0] = clamp16(lt >> 13); // differs from when accumulate is true above
-            pDst[1] = clamp16(rt >> 13); // differs from when accumulate is true above
-            pSrc += numChan;
-            pDst += 2;
-            numFrames--;
+        // { lt, rt }
+        const int32x2_t lr = vpadd_s32(vadd_s32(vget_low_s32(accL), vget_high_s32(accL)),
+                vadd_s32(vget_low_s32(accR), vget_high_s32(accR)));
+        Downmix_storeFrame(pDst, vget_lane_s32(lr, 0), vget_lane_s32(lr, 1), accumulate);
+        pSrc += numChan;
+        pDst += 2;
+        vectorFrames--;
+    }
+#else
+    __m128i vCoefL[DOWNMIX_MATRIX_CHANNELS / 8];
+    __m128i vCoefR[DOWNMIX_MATRIX_CHANNELS / 8];
+    for (size_t k = 0; k < numVectors; k++) {
+        vCoefL[k] = _mm_loadu_si128((const __m128i *)(pDownmixer->matrix_left + 8 * k));
+        vCoefR[k] = _mm_loadu_si128((const __m128i *)(pDownmixer->matrix_right + 8 * k));
+    }
+    while (vectorFrames) {
+        __m128i accL = _mm_setzero_si128();
+        __m128i accR = _mm_setzero_si128();
+        for (size_t k = 0; k < numVectors; k++) {
+            const __m128i in = _mm_loadu_si128((const __m128i *)(pSrc + 8 * k));
+            accL = _mm_add_epi32(accL, _mm_madd_epi16(in, vCoefL[k]));
+            accR = _mm_add_epi32(accR, _mm_madd_epi16(in, vCoefR[k]));
         }
+        // { lt, rt, x, x }
+        __m128i lr = _mm_add_epi32(_mm_unpacklo_epi32(accL, accR),
+                _mm_unpackhi_epi32(accL, accR));
+        lr = _mm_add_epi32(lr, _mm_srli_si128(lr, 8));
+        Downmix_storeFrame(pDst, _mm_cvtsi128_si32(lr), _mm_cvtsi128_si32(_mm_srli_si128(lr, 4)),
+                accumulate);
+        pSrc += numChan;
+        pDst += 2;
+        vectorFrames--;
+    }
+#endif
+#endif
+
+    const int16_t *coefL = pDownmixer->matrix_left;
+    const int16_t *coefR = pDownmixer->matrix_right;
+    while (numFrames) {
+        int32_t lt = 0, rt = 0; // samples in Q19.12 format
+        for (size_t i = 0; i < numChan; i++) {
+            lt += pSrc[i] * coefL[i];
+            rt += pSrc[i] * coefR[i];
+        }
+        Downmix_storeFrame(pDst, lt, rt, accumulate);
+        pSrc += numChan;
+        pDst += 2;
+        numFrames--;
     }
-    return true;
 }
@@ -28,6 +28,10 @@
 
 #define DOWNMIX_OUTPUT_CHANNELS AUDIO_CHANNEL_OUT_STEREO
 
+// Input channels supported by the matrix, a multiple of the 8 samples handled per vector
+// that is at least the number of positional output channels
+#define DOWNMIX_MATRIX_CHANNELS 24
+
 typedef enum {
     DOWNMIX_STATE_UNINITIALIZED,
     DOWNMIX_STATE_INITIALIZED,
@@ -40,6 +44,10 @@ typedef struct {
     downmix_type_t type;
     bool apply_volume_correction;
     uint8_t input_channel_count;
+    // Q19.12 contribution of each input channel to the left and right outputs, in the order
+    // of the input samples, and zero past input_channel_count
+    int16_t matrix_left[DOWNMIX_MATRIX_CHANNELS];
+    int16_t matrix_right[DOWNMIX_MATRIX_CHANNELS];
 } downmix_object_t;
 
 
@@ -49,10 +57,14 @@ typedef struct downmix_module_s {
     downmix_object_t context;
 } downmix_module_t;
 
-const uint32_t kSides = AUDIO_CHANNEL_OUT_SIDE_LEFT | AUDIO_CHANNEL_OUT_SIDE_RIGHT;
-const uint32_t kBacks = AUDIO_CHANNEL_OUT_BACK_LEFT | AUDIO_CHANNEL_OUT_BACK_RIGHT;
-const uint32_t kUnsupported =
+// the positional channels that can be folded, all others are rejected
+const uint32_t kSupported =
+        AUDIO_CHANNEL_OUT_FRONT_LEFT | AUDIO_CHANNEL_OUT_FRONT_RIGHT |
+        AUDIO_CHANNEL_OUT_FRONT_CENTER | AUDIO_CHANNEL_OUT_LOW_FREQUENCY |
+        AUDIO_CHANNEL_OUT_BACK_LEFT | AUDIO_CHANNEL_OUT_BACK_RIGHT |
         AUDIO_CHANNEL_OUT_FRONT_LEFT_OF_CENTER | AUDIO_CHANNEL_OUT_FRONT_RIGHT_OF_CENTER |
+        AUDIO_CHANNEL_OUT_BACK_CENTER |
+        AUDIO_CHANNEL_OUT_SIDE_LEFT | AUDIO_CHANNEL_OUT_SIDE_RIGHT |
         AUDIO_CHANNEL_OUT_TOP_CENTER |
         AUDIO_CHANNEL_OUT_TOP_FRONT_LEFT |
         AUDIO_CHANNEL_OUT_TOP_FRONT_CENTER |
@@ -96,10 +108,8 @@ int Downmix_Reset(downmix_object_t *pDownmixer, bool init);
 int Downmix_setParameter(downmix_object_t *pDownmixer, int32_t param, uint32_t size, void *pValue);
 int Downmix_getParameter(downmix_object_t *pDownmixer, int32_t param, uint32_t *pSize, void *pValue);
 
-void Downmix_foldFromQuad(int16_t *pSrc, int16_t*pDst, size_t numFrames, bool accumulate);
-void Downmix_foldFrom5Point1(int16_t *pSrc, int16_t*pDst, size_t numFrames, bool accumulate);
-void Downmix_foldFrom7Point1(int16_t *pSrc, int16_t*pDst, size_t numFrames, bool accumulate);
-bool Downmix_foldGeneric(
-        uint32_t mask, int16_t *pSrc, int16_t*pDst, size_t numFrames, bool accumulate);
+void Downmix_setMatrix(downmix_object_t *pDownmixer, uint32_t mask);
+void Downmix_foldMatrix(const downmix_object_t *pDownmixer,
+        const int16_t *pSrc, int16_t *pDst, size_t numFrames, bool accumulate);
 
 #endif /*ANDROID_EFFECTDOWNMIX_H_*/
@@ -615,6 +615,7 @@ int loadLibrary(cnode *root, const char *name)
     l->path = strndup(path, PATH_MAX);
     l->handle = hdl;
     l->desc = desc;
+    l->dump = (void (*)(int))dlsym(hdl, EFFECT_LIBRARY_DUMP_SYM_AS_STR);
     l->effects = NULL;
     pthread_mutex_init(&l->lock, NULL);
 
@@ -1079,6 +1080,9 @@ int EffectDumpEffects(int fd) {
             dprintf(fd, "%s", s);
             efx = efx->next;
         }
+        if (l->dump != NULL) {
+            l->dump(fd);
+        }
         e = e->next;
     }
 
@@ -29,6 +29,10 @@ extern "C" {
 
 #define PROPERTY_IGNORE_EFFECTS "ro.audio.ignore_effects"
 
+// Optional symbol of an effect library, a void (*)(int fd) called by EffectDumpEffects() to
+// dump the state shared by the effects of the library
+#define EFFECT_LIBRARY_DUMP_SYM_AS_STR "EffectLibraryDump"
+
 typedef struct list_elem_s {
     void *object;
     struct list_elem_s *next;
@@ -48,6 +52,7 @@ typedef struct lib_entry_s {
     char *name;
     char *path;
     void *handle;
+    void (*dump)(int fd); // may be NULL, see EFFECT_LIBRARY_DUMP_SYM_AS_STR
     list_elem_t *effects; //list of effect_descriptor_t
     pthread_mutex_t lock;
 } lib_entry_t;
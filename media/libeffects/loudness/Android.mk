@@ -6,7 +6,8 @@ include $(CLEAR_VARS)
 LOCAL_VENDOR_MODULE := true
 LOCAL_SRC_FILES:= \
 	EffectLoudnessEnhancer.cpp \
-	dsp/core/dynamic_range_compression.cpp
+	dsp/core/dynamic_range_compression.cpp \
+	dsp/core/lookahead_limiter.cpp
 
 LOCAL_CFLAGS+= -O2 -fvisibility=hidden
 LOCAL_CFLAGS += -Wall -Werror
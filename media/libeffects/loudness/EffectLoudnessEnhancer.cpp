@@ -25,10 +25,19 @@
 
 #include <new>
 
+#include <cutils/properties.h>
 #include <log/log.h>
 
 #include <audio_effects/effect_loudnessenhancer.h>
 #include "dsp/core/dynamic_range_compression.h"
+#include "dsp/core/lookahead_limiter.h"
+
+// When true, peaks above full scale after the compressor are limited with a lookahead of a
+// few ms instead of being clipped. This delays the output by the lookahead.
+#define PROPERTY_LE_LOOKAHEAD_LIMITER "audio.loudness.lookahead_limiter"
+
+// number of frames converted to float and processed at a time
+#define LE_BLOCK_SIZE 256
 
 extern "C" {
 
@@ -61,6 +70,8 @@ struct LoudnessEnhancerContext {
     // in this implementation, there is no coupling between the compression on the left and right
     // channels
     le_fx::AdaptiveDynamicRangeCompression* mCompressor;
+    // NULL unless the lookahead limiter is enabled
+    le_fx::LookaheadLimiter* mLimiter;
 };
 
 //
@@ -78,6 +89,9 @@ void LE_reset(LoudnessEnhancerContext *pContext)
     } else {
         ALOGE("LE_reset(%p): null compressors, can't apply target gain", pContext);
     }
+    if (pContext->mLimiter != NULL) {
+        pContext->mLimiter->Initialize(32767.0f, pContext->mConfig.inputCfg.samplingRate);
+    }
 }
 
 static inline int16_t clamp16(int32_t sample)
@@ -182,6 +196,10 @@ int LE_init(LoudnessEnhancerContext *pContext)
         pContext->mCompressor = new le_fx::AdaptiveDynamicRangeCompression();
         pContext->mCompressor->Initialize(targetAmp, pContext->mConfig.inputCfg.samplingRate);
     }
+    if (pContext->mLimiter == NULL &&
+            property_get_bool(PROPERTY_LE_LOOKAHEAD_LIMITER, false /* default_value */)) {
+        pContext->mLimiter = new le_fx::LookaheadLimiter();
+    }
 
     LE_setConfig(pContext, &pContext->mConfig);
 
@@ -213,6 +231,7 @@ int LELib_Create(const effect_uuid_t *uuid,
     pContext->mState = LOUDNESS_ENHANCER_STATE_UNINITIALIZED;
 
     pContext->mCompressor = NULL;
+    pContext->mLimiter = NULL;
     ret = LE_init(pContext);
     if (ret < 0) {
         ALOGW("LELib_Create() init failed");
@@ -242,6 +261,10 @@ int LELib_Release(effect_handle_t handle) {
         delete pContext->mCompressor;
         pContext->mCompressor = NULL;
     }
+    if (pContext->mLimiter != NULL) {
+        delete pContext->mLimiter;
+        pContext->mLimiter = NULL;
+    }
     delete pContext;
 
     return 0;
@@ -283,16 +306,25 @@ int LE_process(
     }
 
     //ALOGV("LE about to process %d samples", inBuffer->frameCount);
-    uint16_t inIdx;
     float inputAmp = pow(10, pContext->mTargetGainmB/2000.0f);
-    float leftSample, rightSample;
-    for (inIdx = 0 ; inIdx < inBuffer->frameCount ; inIdx++) {
+    float buffer[LE_BLOCK_SIZE * 2];
+    for (size_t frame = 0; frame < inBuffer->frameCount; frame += LE_BLOCK_SIZE) {
+        const size_t frameCount = inBuffer->frameCount - frame < LE_BLOCK_SIZE ?
+                inBuffer->frameCount - frame : LE_BLOCK_SIZE;
+        int16_t *samples = inBuffer->s16 + 2 * frame;
         // makeup gain is applied on the input of the compressor
-        leftSample  = inputAmp * (float)inBuffer->s16[2*inIdx];
-        rightSample = inputAmp * (float)inBuffer->s16[2*inIdx +1];
-        pContext->mCompressor->Compress(&leftSample, &rightSample);
-        inBuffer->s16[2*inIdx]    = (int16_t) leftSample;
-        inBuffer->s16[2*inIdx +1] = (int16_t) rightSample;
+        for (size_t i = 0; i < frameCount * 2; i++) {
+            buffer[i] = inputAmp * (float)samples[i];
+        }
+        // the limiter, when enabled, replaces the clipping of the compressor
+        pContext->mCompressor->CompressInterleaved(buffer, frameCount,
+                pContext->mLimiter == NULL /* clip */);
+        if (pContext->mLimiter != NULL) {
+            pContext->mLimiter->Process(buffer, frameCount);
+        }
+        for (size_t i = 0; i < frameCount * 2; i++) {
+            samples[i] = (int16_t)buffer[i];
+        }
     }
 
     if (inBuffer->raw != outBuffer->raw) {
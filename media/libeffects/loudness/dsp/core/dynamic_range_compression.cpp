@@ -17,6 +17,14 @@
 
 #include <cmath>
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LE_FX_USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LE_FX_USE_SSE2
+#endif
+
 #include "common/core/math.h"
 #include "common/core/types.h"
 #include "dsp/core/basic.h"
@@ -136,5 +144,141 @@ void AdaptiveDynamicRangeCompression::Compress(float *x1, float *x2) {
   }
 }
 
-}  // namespace le_fx
+void AdaptiveDynamicRangeCompression::CompressInterleaved(
+    float *x, size_t frame_count, bool clip) {
+  float buffer[kBlockSize];
+  while (frame_count > 0) {
+    const size_t n = std::min(frame_count, kBlockSize);
+    ComputeControlValues(x, n, buffer);
+    // The envelope detector is recursive, so this part remains sequential.
+    // The control values are replaced by the gains in place.
+    for (size_t i = 0; i < n; ++i) {
+      const float cv = buffer[i];
+      const float prev_state = state_;
+      if (cv <= state_) {
+        state_ = alpha_attack_ * state_ + (1.0f - alpha_attack_) * cv;
+      } else {
+        state_ = alpha_release_ * state_ + (1.0f - alpha_release_) * cv;
+      }
+      compressor_gain_ *=
+          math::ExpApproximationViaTaylorExpansionOrder5(state_ - prev_state);
+      buffer[i] = compressor_gain_;
+    }
+    ApplyGains(buffer, n, clip, x);
+    x += 2 * n;
+    frame_count -= n;
+  }
+}
 
+void AdaptiveDynamicRangeCompression::ComputeControlValues(
+    const float *x, size_t frame_count, float *cv) {
+  size_t i = 0;
+#if defined(LE_FX_USE_NEON) || defined(LE_FX_USE_SSE2)
+  // Same operations as math::fast_log(.) and Compress(x1, x2), four frames at
+  // a time.
+#if defined(LE_FX_USE_NEON)
+  const float32x4_t min_abs = vdupq_n_f32(kMinLogAbsValue);
+  const float32x4_t knee = vdupq_n_f32(knee_threshold_);
+  const float32x4_t slope = vdupq_n_f32(slope_);
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  for (; i + 4 <= frame_count; i += 4) {
+    const float32x4x2_t lr = vld2q_f32(x + 2 * i);
+    const float32x4_t max_abs_x = vmaxq_f32(vabsq_f32(lr.val[0]),
+        vmaxq_f32(vabsq_f32(lr.val[1]), min_abs));
+    int32x4_t bits = vreinterpretq_s32_f32(max_abs_x);
+    const int32x4_t log_2 = vsubq_s32(
+        vandq_s32(vshrq_n_s32(bits, 23), vdupq_n_s32(255)), vdupq_n_s32(128));
+    bits = vandq_s32(bits, vdupq_n_s32(~(255 << 23)));
+    bits = vaddq_s32(bits, vdupq_n_s32(127 << 23));
+    float32x4_t val = vreinterpretq_f32_s32(bits);
+    val = vmulq_f32(vaddq_f32(vmulq_f32(vdupq_n_f32(-1.0f / 3), val),
+        vdupq_n_f32(2.0f)), val);
+    val = vsubq_f32(val, vdupq_n_f32(2.0f / 3));
+    val = vaddq_f32(val, vcvtq_f32_s32(log_2));
+    const float32x4_t max_abs_x_dB = vmulq_f32(val,
+        vdupq_n_f32(0.693147180559945286226763982995180413126945495605468750f));
+    const float32x4_t rect = vmaxq_f32(vsubq_f32(max_abs_x_dB, knee), zero);
+    vst1q_f32(cv + i, vmulq_f32(rect, slope));
+  }
+#else
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 min_abs = _mm_set1_ps(kMinLogAbsValue);
+  const __m128 knee = _mm_set1_ps(knee_threshold_);
+  const __m128 slope = _mm_set1_ps(slope_);
+  for (; i + 4 <= frame_count; i += 4) {
+    const __m128 a = _mm_loadu_ps(x + 2 * i);
+    const __m128 b = _mm_loadu_ps(x + 2 * i + 4);
+    const __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    const __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    const __m128 max_abs_x = _mm_max_ps(_mm_and_ps(left, abs_mask),
+        _mm_max_ps(_mm_and_ps(right, abs_mask), min_abs));
+    __m128i bits = _mm_castps_si128(max_abs_x);
+    const __m128i log_2 = _mm_sub_epi32(
+        _mm_and_si128(_mm_srai_epi32(bits, 23), _mm_set1_epi32(255)),
+        _mm_set1_epi32(128));
+    bits = _mm_and_si128(bits, _mm_set1_epi32(~(255 << 23)));
+    bits = _mm_add_epi32(bits, _mm_set1_epi32(127 << 23));
+    __m128 val = _mm_castsi128_ps(bits);
+    val = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.0f / 3), val),
+        _mm_set1_ps(2.0f)), val);
+    val = _mm_sub_ps(val, _mm_set1_ps(2.0f / 3));
+    val = _mm_add_ps(val, _mm_cvtepi32_ps(log_2));
+    const __m128 max_abs_x_dB = _mm_mul_ps(val,
+        _mm_set1_ps(0.693147180559945286226763982995180413126945495605468750f));
+    const __m128 rect = _mm_max_ps(_mm_sub_ps(max_abs_x_dB, knee),
+        _mm_setzero_ps());
+    _mm_storeu_ps(cv + i, _mm_mul_ps(rect, slope));
+  }
+#endif
+#endif
+  for (; i < frame_count; ++i) {
+    const float max_abs_x = std::max(std::fabs(x[2 * i]),
+      std::max(std::fabs(x[2 * i + 1]), kMinLogAbsValue));
+    const float max_abs_x_dB = math::fast_log(max_abs_x);
+    const float rect = std::max(max_abs_x_dB - knee_threshold_, 0.0f);
+    cv[i] = rect * slope_;
+  }
+}
+
+void AdaptiveDynamicRangeCompression::ApplyGains(
+    const float *gain, size_t frame_count, bool clip, float *x) {
+  size_t i = 0;
+#if defined(LE_FX_USE_NEON)
+  const float32x4_t limit = vdupq_n_f32(clip ? kFixedPointLimit : HUGE_VALF);
+  const float32x4_t minus_limit = vnegq_f32(limit);
+  for (; i + 4 <= frame_count; i += 4) {
+    float32x4x2_t lr = vld2q_f32(x + 2 * i);
+    const float32x4_t g = vld1q_f32(gain + i);
+    lr.val[0] = vmaxq_f32(vminq_f32(vmulq_f32(lr.val[0], g), limit),
+        minus_limit);
+    lr.val[1] = vmaxq_f32(vminq_f32(vmulq_f32(lr.val[1], g), limit),
+        minus_limit);
+    vst2q_f32(x + 2 * i, lr);
+  }
+#elif defined(LE_FX_USE_SSE2)
+  const __m128 limit = _mm_set1_ps(clip ? kFixedPointLimit : HUGE_VALF);
+  const __m128 minus_limit = _mm_set1_ps(clip ? -kFixedPointLimit : -HUGE_VALF);
+  for (; i + 4 <= frame_count; i += 4) {
+    const __m128 g = _mm_loadu_ps(gain + i);
+    const __m128 a = _mm_mul_ps(_mm_loadu_ps(x + 2 * i),
+        _mm_unpacklo_ps(g, g));
+    const __m128 b = _mm_mul_ps(_mm_loadu_ps(x + 2 * i + 4),
+        _mm_unpackhi_ps(g, g));
+    _mm_storeu_ps(x + 2 * i, _mm_max_ps(_mm_min_ps(a, limit), minus_limit));
+    _mm_storeu_ps(x + 2 * i + 4,
+        _mm_max_ps(_mm_min_ps(b, limit), minus_limit));
+  }
+#endif
+  for (; i < frame_count; ++i) {
+    x[2 * i] *= gain[i];
+    x[2 * i + 1] *= gain[i];
+    if (clip) {
+      x[2 * i] = std::min(std::max(x[2 * i], -kFixedPointLimit),
+          kFixedPointLimit);
+      x[2 * i + 1] = std::min(std::max(x[2 * i + 1], -kFixedPointLimit),
+          kFixedPointLimit);
+    }
+  }
+}
+
+}  // namespace le_fx
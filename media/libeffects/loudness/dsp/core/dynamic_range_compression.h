@@ -58,6 +58,13 @@ class AdaptiveDynamicRangeCompression {
   // Stereo channel version of the compressor
   void Compress(float *x1, float *x2);
 
+  // Block version of the stereo compressor, for `frame_count` interleaved
+  // frames. The input of the envelope detector and the output gain are
+  // computed several frames at a time, which is otherwise equivalent to
+  // calling Compress(x1, x2) on each frame. When `clip` is false the output
+  // is not limited to the fixed-point range, so that a limiter can follow.
+  void CompressInterleaved(float *x, size_t frame_count, bool clip);
+
   // This version is slower than Compress(.) but faster than CompressSlow(.)
   float CompressNormalSpeed(float x);
 
@@ -91,6 +98,14 @@ class AdaptiveDynamicRangeCompression {
   static const float kTauAttack;
   // The release time of the envelope detector
   static const float kTauRelease;
+  // Number of frames processed at a time by CompressInterleaved(.)
+  static const size_t kBlockSize = 64;
+
+  // Computes the control value of the envelope detector for `frame_count`
+  // interleaved frames, frame_count <= kBlockSize.
+  void ComputeControlValues(const float *x, size_t frame_count, float *cv);
+  // Applies the gains of `frame_count` frames to interleaved samples.
+  void ApplyGains(const float *gain, size_t frame_count, bool clip, float *x);
 
   float sampling_rate_;
   // the internal state of the envelope detector
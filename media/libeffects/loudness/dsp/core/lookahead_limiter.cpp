@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+//#define LOG_NDEBUG 0
+
+#include <cmath>
+
+#include "common/core/math.h"
+#include "dsp/core/lookahead_limiter.h"
+
+namespace le_fx {
+
+const float LookaheadLimiter::kLookahead = 0.002f;
+const float LookaheadLimiter::kTauRelease = 0.05f;
+
+LookaheadLimiter::LookaheadLimiter()
+    : limit_(0.0f),
+      alpha_release_(0.0f),
+      window_size_(1),
+      inverse_window_size_(1.0f),
+      frame_index_(0),
+      delay_index_(0),
+      min_head_(0),
+      min_count_(0),
+      average_index_(0),
+      average_sum_(0.0f),
+      gain_(1.0f) {
+}
+
+bool LookaheadLimiter::Initialize(float limit, float sampling_rate) {
+  limit_ = limit;
+  alpha_release_ = std::exp(-1.0f / (kTauRelease * sampling_rate));
+  window_size_ = static_cast<size_t>(kLookahead * sampling_rate) + 1;
+  window_size_ = std::max(std::min(window_size_, kMaxWindowSize),
+      static_cast<size_t>(1));
+  inverse_window_size_ = 1.0f / window_size_;
+  frame_index_ = 0;
+  fill_n(delay_, 2 * kMaxWindowSize, 0.0f);
+  delay_index_ = 0;
+  min_head_ = 0;
+  min_count_ = 0;
+  fill_n(average_, kMaxWindowSize, 1.0f);
+  average_index_ = 0;
+  average_sum_ = window_size_;
+  gain_ = 1.0f;
+  return true;
+}
+
+void LookaheadLimiter::Process(float *x, size_t frame_count) {
+  const size_t delay_size = window_size_ - 1;
+  for (size_t i = 0; i < frame_count; ++i, x += 2) {
+    const float peak = std::max(std::fabs(x[0]), std::fabs(x[1]));
+    const float required = peak > limit_ ? limit_ / peak : 1.0f;
+
+    // Sliding minimum over the last window_size_ frames
+    if (min_count_ > 0 && frame_index_ - min_frame_[min_head_] >= window_size_) {
+      min_head_ = (min_head_ + 1) % window_size_;
+      --min_count_;
+    }
+    while (min_count_ > 0) {
+      const size_t back = (min_head_ + min_count_ - 1) % window_size_;
+      if (min_gain_[back] < required) {
+        break;
+      }
+      --min_count_;
+    }
+    const size_t back = (min_head_ + min_count_) % window_size_;
+    min_gain_[back] = required;
+    min_frame_[back] = frame_index_;
+    ++min_count_;
+    const float held = min_gain_[min_head_];
+    ++frame_index_;
+
+    // Moving average, summed again at each wrap to not accumulate rounding
+    average_sum_ += held - average_[average_index_];
+    average_[average_index_] = held;
+    if (++average_index_ == window_size_) {
+      average_index_ = 0;
+      average_sum_ = 0.0f;
+      for (size_t j = 0; j < window_size_; ++j) {
+        average_sum_ += average_[j];
+      }
+    }
+    const float target = average_sum_ * inverse_window_size_;
+    if (target < gain_) {
+      gain_ = target;
+    } else {
+      gain_ = alpha_release_ * gain_ + (1.0f - alpha_release_) * target;
+    }
+
+    float left = x[0];
+    float right = x[1];
+    if (delay_size > 0) {
+      std::swap(left, delay_[2 * delay_index_]);
+      std::swap(right, delay_[2 * delay_index_ + 1]);
+      if (++delay_index_ == delay_size) {
+        delay_index_ = 0;
+      }
+    }
+    // Bound the rounding of the average
+    x[0] = std::min(std::max(left * gain_, -limit_), limit_);
+    x[1] = std::min(std::max(right * gain_, -limit_), limit_);
+  }
+}
+
+}  // namespace le_fx
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LE_FX_ENGINE_DSP_CORE_LOOKAHEAD_LIMITER_H_
+#define LE_FX_ENGINE_DSP_CORE_LOOKAHEAD_LIMITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common/core/types.h"
+
+namespace le_fx {
+
+// A stereo peak limiter with lookahead. The signal is delayed by the
+// lookahead time, during which the gain is lowered smoothly ahead of any peak
+// that would exceed the limit, instead of clipping the peak.
+//
+// The gain that brings each frame under the limit is held for the length of
+// the lookahead window with a sliding minimum, and then smoothed with a moving
+// average over the same window. Every average which is applied to a peak then
+// only includes values that are at most the gain required by that peak.
+class LookaheadLimiter {
+ public:
+  LookaheadLimiter();
+
+  // Initializes the limiter for peaks above `limit`, and clears its state.
+  bool Initialize(float limit, float sampling_rate);
+
+  // Limits `frame_count` interleaved stereo frames, in place.
+  void Process(float *x, size_t frame_count);
+
+  // The delay added to the signal, in frames.
+  size_t latency() const { return window_size_ - 1; }
+
+ private:
+  // The lookahead time
+  static const float kLookahead;
+  // The release time of the gain
+  static const float kTauRelease;
+  // Bounds the window size at high sampling rates
+  static const size_t kMaxWindowSize = 1024;
+
+  float limit_;
+  float alpha_release_;
+  // The lookahead plus one frame
+  size_t window_size_;
+  float inverse_window_size_;
+  uint32_t frame_index_;
+
+  // Delay line of window_size_ - 1 interleaved frames
+  float delay_[2 * kMaxWindowSize];
+  size_t delay_index_;
+
+  // Sliding minimum of the required gains, as a queue of increasing values
+  float min_gain_[kMaxWindowSize];
+  uint32_t min_frame_[kMaxWindowSize];
+  size_t min_head_;
+  size_t min_count_;
+
+  // Moving average of the sliding minimum
+  float average_[kMaxWindowSize];
+  size_t average_index_;
+  float average_sum_;
+
+  // The gain that was last applied
+  float gain_;
+
+  LE_FX_DISALLOW_COPY_AND_ASSIGN(LookaheadLimiter);
+};
+
+}  // namespace le_fx
+
+#endif  // LE_FX_ENGINE_DSP_CORE_LOOKAHEAD_LIMITER_H_
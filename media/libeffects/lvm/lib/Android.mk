@@ -68,7 +68,12 @@ LOCAL_SRC_FILES:= \
     Common/src/PK_2I_D32F32C14G11_TRC_WRA_01.c \
     Common/src/PK_2I_D32F32CssGss_TRC_WRA_01_Init.c \
     Common/src/PK_2I_D32F32CllGss_TRC_WRA_01_Init.c \
+    Common/src/PK_2I_F32F32_TRC_WRA_01.c \
+    Common/src/PK_2I_F32F32CssGss_TRC_WRA_01_Init.c \
+    Common/src/PK_2I_F32F32CllGss_TRC_WRA_01_Init.c \
     Common/src/Int16LShiftToInt32_16x32.c \
+    Common/src/Int16ToFloat_16xF32.c \
+    Common/src/FloatToInt16_Sat_F32x16.c \
     Common/src/From2iToMono_16.c \
     Common/src/Copy_16.c \
     Common/src/MonoTo2I_16.c \
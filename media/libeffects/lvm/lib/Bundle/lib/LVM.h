@@ -155,6 +155,14 @@ typedef enum
     LVM_EQNB_DUMMY = LVM_MAXENUM
 } LVM_EQNB_Mode_en;
 
+/* N-Band Equaliser filter arithmetic */
+typedef enum
+{
+    LVM_EQNB_FIXED = 0,                                 /* 32-bit fixed point */
+    LVM_EQNB_FLOAT = 1,                                 /* Single precision floating point */
+    LVM_EQNB_PRECISION_DUMMY = LVM_MAXENUM
+} LVM_EQNB_Precision_en;
+
 /* Bass Enhancement operating mode */
 typedef enum
 {
@@ -277,6 +285,7 @@ typedef struct
     LVM_EQNB_Mode_en            EQNB_OperatingMode;     /* N-Band Equaliser operating mode */
     LVM_UINT16                  EQNB_NBands;            /* Number of bands */
     LVM_EQNB_BandDef_t          *pEQNB_BandDefinition;  /* Pointer to equaliser definitions */
+    LVM_EQNB_Precision_en       EQNB_Precision;         /* N-Band Equaliser filter arithmetic */
 
     /* Bass Enhancement parameters */
     LVM_BE_Mode_en              BE_OperatingMode;       /* Bass Enhancement operating mode */
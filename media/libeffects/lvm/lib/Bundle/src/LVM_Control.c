@@ -129,6 +129,7 @@ LVM_ReturnStatus_en LVM_SetControlParameters(LVM_Handle_t           hInstance,
     }
     if( /* N-Band Equaliser parameters */
         ((pParams->EQNB_OperatingMode != LVM_EQNB_OFF) && (pParams->EQNB_OperatingMode != LVM_EQNB_ON)) ||
+        ((pParams->EQNB_Precision != LVM_EQNB_FIXED) && (pParams->EQNB_Precision != LVM_EQNB_FLOAT)) ||
         (pParams->EQNB_NBands > pInstance->InstParams.EQNB_NumBands))
     {
         return (LVM_OUTOFRANGE);
@@ -663,6 +664,7 @@ LVM_ReturnStatus_en LVM_ApplyNewSettings(LVM_Handle_t   hInstance)
         EQNB_Params.SampleRate       = (LVEQNB_Fs_en)LocalParams.SampleRate;
         EQNB_Params.NBands           = LocalParams.EQNB_NBands;
         EQNB_Params.pBandDefinition  = (LVEQNB_BandDef_t *)LocalParams.pEQNB_BandDefinition;
+        EQNB_Params.Precision        = (LVEQNB_Precision_en)LocalParams.EQNB_Precision;
         if (LocalParams.SourceFormat == LVM_STEREO)    /* Mono format not supported */
         {
             EQNB_Params.SourceFormat = LVEQNB_STEREO;
@@ -757,6 +757,7 @@ LVM_ReturnStatus_en LVM_GetInstanceHandle(LVM_Handle_t           *phInstance,
         pInstance->Params.EQNB_OperatingMode   = LVM_EQNB_OFF;
         pInstance->Params.EQNB_NBands          = 0;
         pInstance->Params.pEQNB_BandDefinition = LVM_NULL;
+        pInstance->Params.EQNB_Precision       = LVM_EQNB_FIXED;
         pInstance->EQNB_Active                 = LVM_FALSE;
 
 
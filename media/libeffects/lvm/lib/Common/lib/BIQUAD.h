@@ -34,6 +34,12 @@ typedef struct
 
 } Biquad_Instance_t;
 
+typedef struct
+{
+    LVM_FLOAT Storage[6];
+
+} Biquad_FLOAT_Instance_t;
+
 
 /**********************************************************************************
    COEFFICIENT TYPE DEFINITIONS
@@ -144,6 +150,11 @@ typedef struct
     LVM_INT32 Storage[ (2*4) ];  /* Two channels, four taps of size LVM_INT32 */
 } Biquad_2I_Order2_Taps_t;
 
+typedef struct
+{
+    LVM_FLOAT Storage[ (2*4) ];  /* Two channels, four taps of size LVM_FLOAT */
+} Biquad_2I_Order2_FLOAT_Taps_t;
+
 /* The names of the functions are changed to satisfy QAC rules: Name should be Unique withing 16 characters*/
 #define BQ_2I_D32F32Cll_TRC_WRA_01_Init  Init_BQ_2I_D32F32Cll_TRC_WRA_01
 #define BP_1I_D32F32C30_TRC_WRA_02       TWO_BP_1I_D32F32C30_TRC_WRA_02
@@ -308,6 +319,22 @@ void PK_2I_D32F32C14G11_TRC_WRA_01 (        Biquad_Instance_t       *pInstance,
                                             LVM_INT32                    *pDataOut,
                                             LVM_INT16                    NrSamples);
 
+/*** Floating point data path STEREO **********************************************/
+
+/* The fixed point coefficients are converted, so both data paths share the design */
+void PK_2I_F32F32CllGss_TRC_WRA_01_Init (   Biquad_FLOAT_Instance_t       *pInstance,
+                                            Biquad_2I_Order2_FLOAT_Taps_t *pTaps,
+                                            PK_C32_Coefs_t                *pCoef);
+
+void PK_2I_F32F32CssGss_TRC_WRA_01_Init (   Biquad_FLOAT_Instance_t       *pInstance,
+                                            Biquad_2I_Order2_FLOAT_Taps_t *pTaps,
+                                            PK_C16_Coefs_t                *pCoef);
+
+void PK_2I_F32F32_TRC_WRA_01 (              Biquad_FLOAT_Instance_t *pInstance,
+                                            LVM_FLOAT                    *pDataIn,
+                                            LVM_FLOAT                    *pDataOut,
+                                            LVM_INT16                    NrSamples);
+
 
 /**********************************************************************************
    FUNCTION PROTOTYPES: DC REMOVAL FILTERS
@@ -169,6 +169,15 @@ void Int32RShiftToInt16_Sat_32x16(const  LVM_INT32  *src,
                                     LVM_INT16 n,
                                     LVM_INT16 shift );
 
+/* Full scale 16-bit is +/-1.0 */
+void Int16ToFloat_16xF32(const LVM_INT16 *src,
+                               LVM_FLOAT  *dst,
+                               LVM_INT16 n);
+
+void FloatToInt16_Sat_F32x16(const  LVM_FLOAT  *src,
+                                    LVM_INT16 *dst,
+                                    LVM_INT16 n);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
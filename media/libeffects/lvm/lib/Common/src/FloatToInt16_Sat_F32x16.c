@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**********************************************************************************
+   INCLUDE FILES
+***********************************************************************************/
+
+#include "VectorArithmetic.h"
+
+/**********************************************************************************
+   FUNCTION FLOATTOINT16_SAT_F32X16
+***********************************************************************************/
+
+void FloatToInt16_Sat_F32x16(const LVM_FLOAT  *src,
+                                   LVM_INT16 *dst,
+                                   LVM_INT16 n)
+{
+    LVM_FLOAT temp;
+    LVM_INT16 ii;
+
+    /* Works forwards, so the conversion can be done in place */
+    for (ii = n; ii != 0; ii--)
+    {
+        temp = *src * 32768.0f;
+        src++;
+
+        if (temp >= 32767.0f)
+        {
+            *dst = 0x7FFF;
+        }
+        else if (temp <= -32768.0f)
+        {
+            *dst = - 0x8000;
+        }
+        else
+        {
+            /* Round to nearest */
+            *dst = (LVM_INT16)(temp >= 0 ? temp + 0.5f : temp - 0.5f);
+        }
+
+        dst++;
+    }
+
+    return;
+}
+
+/**********************************************************************************/
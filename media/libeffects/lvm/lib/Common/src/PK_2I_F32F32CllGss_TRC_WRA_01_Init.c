@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BIQUAD.h"
+#include "PK_2I_F32F32_TRC_WRA_01_Private.h"
+
+/**************************************************************************
+ A0, -B2 and -B1 are converted from Q30 format and the Gain from Q11 format
+***************************************************************************/
+void  PK_2I_F32F32CllGss_TRC_WRA_01_Init(Biquad_FLOAT_Instance_t         *pInstance,
+                                         Biquad_2I_Order2_FLOAT_Taps_t   *pTaps,
+                                         PK_C32_Coefs_t                  *pCoef)
+{
+  PFilterFLOAT_State pBiquadState = (PFilterFLOAT_State) pInstance;
+  pBiquadState->pDelays       =(LVM_FLOAT *) pTaps;
+
+  pBiquadState->coefs[0]=(LVM_FLOAT)((double)pCoef->A0 / 1073741824.0);
+
+  pBiquadState->coefs[1]=(LVM_FLOAT)((double)pCoef->B2 / 1073741824.0);
+
+  pBiquadState->coefs[2]=(LVM_FLOAT)((double)pCoef->B1 / 1073741824.0);
+
+  pBiquadState->coefs[3]=(LVM_FLOAT)pCoef->G / 2048.0f;
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BIQUAD.h"
+#include "PK_2I_F32F32_TRC_WRA_01_Private.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PK_F32_USE_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define PK_F32_USE_SSE
+#endif
+
+/**************************************************************************
+ ASSUMPTIONS:
+ COEFS-
+ pBiquadState->coefs[0] is A0,
+ pBiquadState->coefs[1] is -B2,
+ pBiquadState->coefs[2] is -B1,
+ pBiquadState->coefs[3] is Gain, all unscaled
+
+
+ DELAYS-
+ pBiquadState->pDelays[0] is x(n-1)L
+ pBiquadState->pDelays[1] is x(n-1)R
+ pBiquadState->pDelays[2] is x(n-2)L
+ pBiquadState->pDelays[3] is x(n-2)R
+ pBiquadState->pDelays[4] is y(n-1)L
+ pBiquadState->pDelays[5] is y(n-1)R
+ pBiquadState->pDelays[6] is y(n-2)L
+ pBiquadState->pDelays[7] is y(n-2)R
+
+ The left and right channels are processed together in the two lanes of a
+ vector, with the delays kept in registers for the whole block. Multiplies
+ and adds are not fused, so the vector and scalar versions give the same
+ output.
+***************************************************************************/
+void PK_2I_F32F32_TRC_WRA_01 ( Biquad_FLOAT_Instance_t *pInstance,
+                               LVM_FLOAT               *pDataIn,
+                               LVM_FLOAT               *pDataOut,
+                               LVM_INT16               NrSamples)
+    {
+        LVM_INT16 ii;
+        PFilterFLOAT_State pBiquadState = (PFilterFLOAT_State) pInstance;
+        LVM_FLOAT *pDelays = pBiquadState->pDelays;
+
+#if defined(PK_F32_USE_NEON)
+        const float32x2_t A0   = vdup_n_f32(pBiquadState->coefs[0]);
+        const float32x2_t B2   = vdup_n_f32(pBiquadState->coefs[1]);
+        const float32x2_t B1   = vdup_n_f32(pBiquadState->coefs[2]);
+        const float32x2_t Gain = vdup_n_f32(pBiquadState->coefs[3]);
+        float32x2_t xn1 = vld1_f32(pDelays);
+        float32x2_t xn2 = vld1_f32(pDelays + 2);
+        float32x2_t yn1 = vld1_f32(pDelays + 4);
+        float32x2_t yn2 = vld1_f32(pDelays + 6);
+
+        for (ii = NrSamples; ii != 0; ii--)
+        {
+            const float32x2_t xn = vld1_f32(pDataIn);
+            float32x2_t yn;
+            pDataIn += 2;
+
+            /* yn = A0 * (x(n) - x(n-2)) - B2 * y(n-2) - B1 * y(n-1) */
+            yn = vmul_f32(A0, vsub_f32(xn, xn2));
+            yn = vadd_f32(yn, vmul_f32(B2, yn2));
+            yn = vadd_f32(yn, vmul_f32(B1, yn1));
+
+            /* Write Gain * yn + x(n) */
+            vst1_f32(pDataOut, vadd_f32(vmul_f32(Gain, yn), xn));
+            pDataOut += 2;
+
+            xn2 = xn1;
+            xn1 = xn;
+            yn2 = yn1;
+            yn1 = yn;
+        }
+
+        vst1_f32(pDelays, xn1);
+        vst1_f32(pDelays + 2, xn2);
+        vst1_f32(pDelays + 4, yn1);
+        vst1_f32(pDelays + 6, yn2);
+#elif defined(PK_F32_USE_SSE)
+        /* Only the two low lanes are used */
+        const __m128 A0   = _mm_set1_ps(pBiquadState->coefs[0]);
+        const __m128 B2   = _mm_set1_ps(pBiquadState->coefs[1]);
+        const __m128 B1   = _mm_set1_ps(pBiquadState->coefs[2]);
+        const __m128 Gain = _mm_set1_ps(pBiquadState->coefs[3]);
+        const __m128 Zero = _mm_setzero_ps();
+        __m128 xn1 = _mm_loadl_pi(Zero, (const __m64 *)pDelays);
+        __m128 xn2 = _mm_loadl_pi(Zero, (const __m64 *)(pDelays + 2));
+        __m128 yn1 = _mm_loadl_pi(Zero, (const __m64 *)(pDelays + 4));
+        __m128 yn2 = _mm_loadl_pi(Zero, (const __m64 *)(pDelays + 6));
+
+        for (ii = NrSamples; ii != 0; ii--)
+        {
+            const __m128 xn = _mm_loadl_pi(Zero, (const __m64 *)pDataIn);
+            __m128 yn;
+            pDataIn += 2;
+
+            /* yn = A0 * (x(n) - x(n-2)) - B2 * y(n-2) - B1 * y(n-1) */
+            yn = _mm_mul_ps(A0, _mm_sub_ps(xn, xn2));
+            yn = _mm_add_ps(yn, _mm_mul_ps(B2, yn2));
+            yn = _mm_add_ps(yn, _mm_mul_ps(B1, yn1));
+
+            /* Write Gain * yn + x(n) */
+            _mm_storel_pi((__m64 *)pDataOut, _mm_add_ps(_mm_mul_ps(Gain, yn), xn));
+            pDataOut += 2;
+
+            xn2 = xn1;
+            xn1 = xn;
+            yn2 = yn1;
+            yn1 = yn;
+        }
+
+        _mm_storel_pi((__m64 *)pDelays, xn1);
+        _mm_storel_pi((__m64 *)(pDelays + 2), xn2);
+        _mm_storel_pi((__m64 *)(pDelays + 4), yn1);
+        _mm_storel_pi((__m64 *)(pDelays + 6), yn2);
+#else
+        const LVM_FLOAT A0   = pBiquadState->coefs[0];
+        const LVM_FLOAT B2   = pBiquadState->coefs[1];
+        const LVM_FLOAT B1   = pBiquadState->coefs[2];
+        const LVM_FLOAT Gain = pBiquadState->coefs[3];
+
+        for (ii = NrSamples; ii != 0; ii--)
+        {
+            LVM_FLOAT xnL = *pDataIn++;
+            LVM_FLOAT xnR = *pDataIn++;
+            LVM_FLOAT ynL, ynR, temp;
+
+            /* ynL = A0 * (x(n)L - x(n-2)L) - B2 * y(n-2)L - B1 * y(n-1)L */
+            ynL  = A0 * (xnL - pDelays[2]);
+            temp = B2 * pDelays[6];
+            ynL += temp;
+            temp = B1 * pDelays[4];
+            ynL += temp;
+
+            /* ynR = A0 * (x(n)R - x(n-2)R) - B2 * y(n-2)R - B1 * y(n-1)R */
+            ynR  = A0 * (xnR - pDelays[3]);
+            temp = B2 * pDelays[7];
+            ynR += temp;
+            temp = B1 * pDelays[5];
+            ynR += temp;
+
+            pDelays[7] = pDelays[5];    /* y(n-2)R=y(n-1)R*/
+            pDelays[6] = pDelays[4];    /* y(n-2)L=y(n-1)L*/
+            pDelays[3] = pDelays[1];    /* x(n-2)R=x(n-1)R*/
+            pDelays[2] = pDelays[0];    /* x(n-2)L=x(n-1)L*/
+            pDelays[5] = ynR;           /* Update y(n-1)R */
+            pDelays[4] = ynL;           /* Update y(n-1)L */
+            pDelays[1] = xnR;           /* Update x(n-1)R */
+            pDelays[0] = xnL;           /* Update x(n-1)L */
+
+            /* Write Gain * yn + x(n) */
+            temp = Gain * ynL;
+            *pDataOut++ = temp + xnL;
+            temp = Gain * ynR;
+            *pDataOut++ = temp + xnR;
+        }
+#endif
+    }
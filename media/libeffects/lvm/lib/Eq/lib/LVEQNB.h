@@ -131,6 +131,15 @@ typedef enum
 } LVEQNB_FilterMode_en;
 
 
+/* Filter arithmetic */
+typedef enum
+{
+    LVEQNB_PRECISION_FIXED = 0,                         /* 32-bit fixed point */
+    LVEQNB_PRECISION_FLOAT = 1,                         /* Single precision floating point */
+    LVEQNB_PRECISION_MAX   = LVM_MAXINT_32
+} LVEQNB_Precision_en;
+
+
 /* Memory Types */
 typedef enum
 {
@@ -259,6 +268,7 @@ typedef struct
     /* Equaliser parameters */
     LVM_UINT16                  NBands;                 /* Number of bands */
     LVEQNB_BandDef_t            *pBandDefinition;       /* Pointer to equaliser definitions */
+    LVEQNB_Precision_en         Precision;              /* Filter arithmetic */
 
 } LVEQNB_Params_t;
 
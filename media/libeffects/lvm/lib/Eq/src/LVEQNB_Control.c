@@ -203,7 +203,8 @@ void    LVEQNB_SetFilters(LVEQNB_Instance_t     *pInstance,
 /*                                                                                  */
 /* DESCRIPTION:                                                                     */
 /*  Sets the filter coefficients. This uses the type to select single or double     */
-/*  precision coefficients.                                                         */
+/*  precision coefficients. The floating point filters are set from the same        */
+/*  coefficients, so that both data paths implement the same design.                */
 /*                                                                                  */
 /* PARAMETERS:                                                                      */
 /*  pInstance           Pointer to the instance                                     */
@@ -247,6 +248,9 @@ void    LVEQNB_SetCoefficients(LVEQNB_Instance_t     *pInstance)
                 PK_2I_D32F32CllGss_TRC_WRA_01_Init(&pInstance->pEQNB_FilterState[i],
                                                    &pInstance->pEQNB_Taps[i],
                                                    &Coefficients);
+                PK_2I_F32F32CllGss_TRC_WRA_01_Init(&pInstance->pEQNB_FloatFilterState[i],
+                                                   &pInstance->pEQNB_FloatTaps[i],
+                                                   &Coefficients);
                 break;
             }
 
@@ -267,6 +271,9 @@ void    LVEQNB_SetCoefficients(LVEQNB_Instance_t     *pInstance)
                 PK_2I_D32F32CssGss_TRC_WRA_01_Init(&pInstance->pEQNB_FilterState[i],
                                                    &pInstance->pEQNB_Taps[i],
                                                    &Coefficients);
+                PK_2I_F32F32CssGss_TRC_WRA_01_Init(&pInstance->pEQNB_FloatFilterState[i],
+                                                   &pInstance->pEQNB_FloatTaps[i],
+                                                   &Coefficients);
                 break;
             }
             default:
@@ -304,6 +311,16 @@ void    LVEQNB_ClearFilterHistory(LVEQNB_Instance_t     *pInstance)
                      pTapAddress,                       /* Destination */
                      NumTaps);                          /* Number of words */
     }
+
+    pTapAddress = (LVM_INT16 *)pInstance->pEQNB_FloatTaps;
+    NumTaps     = (LVM_INT16)((pInstance->Capabilities.MaxBands * sizeof(Biquad_2I_Order2_FLOAT_Taps_t))/sizeof(LVM_INT16));
+
+    if (NumTaps != 0)
+    {
+        LoadConst_16(0,                                 /* Clear the history, value 0.0 */
+                     pTapAddress,                       /* Destination */
+                     NumTaps);                          /* Number of words */
+    }
 }
 
 
@@ -365,7 +382,8 @@ LVEQNB_ReturnStatus_en LVEQNB_Control(LVEQNB_Handle_t        hInstance,
         (pInstance->Params.OperatingMode     !=  pParams->OperatingMode   ) ||
         (pInstance->Params.pBandDefinition   !=  pParams->pBandDefinition ) ||
         (pInstance->Params.SampleRate        !=  pParams->SampleRate      ) ||
-        (pInstance->Params.SourceFormat      !=  pParams->SourceFormat    ))
+        (pInstance->Params.SourceFormat      !=  pParams->SourceFormat    ) ||
+        (pInstance->Params.Precision         !=  pParams->Precision       ))
     {
 
         bChange = LVM_TRUE;
@@ -389,9 +407,11 @@ LVEQNB_ReturnStatus_en LVEQNB_Control(LVEQNB_Handle_t        hInstance,
     if(bChange){
 
         /*
-         * If the sample rate has changed clear the history
+         * If the sample rate or the arithmetic has changed clear the history, the
+         * taps of the path that was not running are stale
          */
-        if (pInstance->Params.SampleRate != pParams->SampleRate)
+        if ((pInstance->Params.SampleRate != pParams->SampleRate) ||
+            (pInstance->Params.Precision != pParams->Precision))
         {
             LVEQNB_ClearFilterHistory(pInstance);           /* Clear the history */
         }
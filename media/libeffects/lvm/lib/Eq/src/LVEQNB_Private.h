@@ -89,6 +89,8 @@ typedef struct
     /* Process variables */
     Biquad_2I_Order2_Taps_t         *pEQNB_Taps;        /* Equaliser Taps */
     Biquad_Instance_t               *pEQNB_FilterState; /* State for each filter band */
+    Biquad_2I_Order2_FLOAT_Taps_t   *pEQNB_FloatTaps;   /* Equaliser Taps, floating point */
+    Biquad_FLOAT_Instance_t         *pEQNB_FloatFilterState; /* State for each filter band, floating point */
 
     /* Filter definitions and call back */
     LVM_UINT16                      NBands;             /* Number of bands */
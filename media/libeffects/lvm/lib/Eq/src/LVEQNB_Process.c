@@ -92,7 +92,62 @@ LVEQNB_ReturnStatus_en LVEQNB_Process(LVEQNB_Handle_t       hInstance,
         return(LVEQNB_TOOMANYSAMPLES);
     }
 
-    if (pInstance->Params.OperatingMode == LVEQNB_ON)
+    if ((pInstance->Params.OperatingMode == LVEQNB_ON) &&
+        (pInstance->Params.Precision == LVEQNB_PRECISION_FLOAT))
+    {
+        LVM_FLOAT   *pScratchFloat = (LVM_FLOAT *)pScratch;
+
+        /*
+         * Convert from 16-bit to floating point
+         */
+        Int16ToFloat_16xF32(pInData,                        /* Source */
+                            pScratchFloat,                  /* Destination */
+                            (LVM_INT16)(2*NumSamples));     /* Left and Right */
+
+        /*
+         * For each section execte the filter unless the gain is 0dB. Both single and
+         * double precision bands use the same floating point filter
+         */
+        for (i=0; i<pInstance->NBands; i++)
+        {
+            if ((pInstance->pBandDefinitions[i].Gain != 0) &&
+                (pInstance->pBiquadType[i] != LVEQNB_OutOfRange))
+            {
+                PK_2I_F32F32_TRC_WRA_01(&pInstance->pEQNB_FloatFilterState[i],
+                                        pScratchFloat,
+                                        pScratchFloat,
+                                        (LVM_INT16)NumSamples);
+            }
+        }
+
+        if(pInstance->bInOperatingModeTransition == LVM_TRUE){
+                /*
+                 * Convert from floating point to 16- bit and saturate
+                 */
+                FloatToInt16_Sat_F32x16(pScratchFloat,                  /* Source */
+                                        (LVM_INT16 *)pScratch,          /* Destination */
+                                        (LVM_INT16)(2*NumSamples));     /* Left and Right */
+
+                LVC_MixSoft_2St_D16C31_SAT(&pInstance->BypassMixer,
+                                                (LVM_INT16 *)pScratch,
+                                                (LVM_INT16 *)pInData,
+                                                (LVM_INT16 *)pScratch,
+                                                (LVM_INT16)(2*NumSamples));
+
+                Copy_16((LVM_INT16*)pScratch,                           /* Source */
+                        pOutData,                                       /* Destination */
+                        (LVM_INT16)(2*NumSamples));                     /* Left and Right samples */
+        }
+        else{
+            /*
+             * Convert from floating point to 16- bit and saturate
+             */
+            FloatToInt16_Sat_F32x16(pScratchFloat,                  /* Source */
+                                    pOutData,                       /* Destination */
+                                    (LVM_INT16 )(2*NumSamples));    /* Left and Right */
+        }
+    }
+    else if (pInstance->Params.OperatingMode == LVEQNB_ON)
     {
         /*
          * Convert from 16-bit to 32-bit
@@ -0,0 +1,31 @@
+# Build the unit tests for the LVM effects library
+
+LOCAL_PATH := $(call my-dir)
+
+#
+# N-Band Equaliser floating point accuracy test
+#
+include $(CLEAR_VARS)
+
+LOCAL_VENDOR_MODULE := true
+
+LOCAL_SRC_FILES := \
+    lvm_eq_float_tests.cpp
+
+LOCAL_STATIC_LIBRARIES := \
+    libmusicbundle
+
+LOCAL_SHARED_LIBRARIES := \
+    liblog \
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/../lib/Common/lib \
+    $(LOCAL_PATH)/../lib/Eq/lib \
+
+LOCAL_MODULE := lvm_eq_float_tests
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_CFLAGS := -Werror -Wall
+
+include $(BUILD_NATIVE_TEST)
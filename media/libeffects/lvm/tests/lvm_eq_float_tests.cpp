@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "lvm_eq_float_tests"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <log/log.h>
+
+#include "LVEQNB.h"
+
+namespace {
+
+constexpr LVM_UINT16 kMaxBlockSize = 256;   // frames, as used by the bundle
+constexpr LVM_UINT16 kNumBands = 5;
+
+// Tolerances of the floating point output against the fixed point output
+constexpr int kMaxDifference = 8;           // LSB
+constexpr double kMinSnrDb = 55.;
+
+// The bundle presets.
+constexpr LVM_UINT16 kFrequencies[kNumBands] = { 60, 230, 910, 3600, 14000 };
+constexpr LVM_UINT16 kQFactors[kNumBands] = { 96, 96, 96, 96, 96 };
+
+// Owns the memory and the handle of one equaliser instance.
+class Equaliser {
+public:
+    Equaliser() : mHandle(LVM_NULL) {
+        memset(&mMemTab, 0, sizeof(mMemTab));
+        memset(&mCapabilities, 0, sizeof(mCapabilities));
+        mCapabilities.SampleRate = LVEQNB_CAP_FS_44100 | LVEQNB_CAP_FS_48000;
+        mCapabilities.SourceFormat = LVEQNB_CAP_STEREO;
+        mCapabilities.MaxBlockSize = kMaxBlockSize;
+        mCapabilities.MaxBands = kNumBands;
+    }
+
+    ~Equaliser() {
+        for (int i = 0; i < LVEQNB_NR_MEMORY_REGIONS; i++) {
+            free(mMemTab.Region[i].pBaseAddress);
+        }
+    }
+
+    bool init() {
+        if (LVEQNB_Memory(LVM_NULL, &mMemTab, &mCapabilities) != LVEQNB_SUCCESS) {
+            return false;
+        }
+        for (int i = 0; i < LVEQNB_NR_MEMORY_REGIONS; i++) {
+            if (mMemTab.Region[i].Size != 0) {
+                mMemTab.Region[i].pBaseAddress = calloc(1, mMemTab.Region[i].Size);
+            }
+        }
+        return LVEQNB_Init(&mHandle, &mMemTab, &mCapabilities) == LVEQNB_SUCCESS;
+    }
+
+    bool control(LVEQNB_Fs_en sampleRate, const LVM_INT16 gains[kNumBands],
+            LVEQNB_Precision_en precision) {
+        for (int i = 0; i < kNumBands; i++) {
+            mBands[i].Gain = gains[i];
+            mBands[i].Frequency = kFrequencies[i];
+            mBands[i].QFactor = kQFactors[i];
+        }
+        LVEQNB_Params_t params;
+        params.OperatingMode = LVEQNB_ON;
+        params.SampleRate = sampleRate;
+        params.SourceFormat = LVEQNB_STEREO;
+        params.NBands = kNumBands;
+        params.pBandDefinition = mBands;
+        params.Precision = precision;
+        return LVEQNB_Control(mHandle, &params) == LVEQNB_SUCCESS;
+    }
+
+    // Run silence through the bypass transition, which leaves the filter history cleared.
+    bool warmUp(size_t frames) {
+        std::vector<LVM_INT16> out;
+        return process(std::vector<LVM_INT16>(frames * 2), &out);
+    }
+
+    bool process(const std::vector<LVM_INT16> &in, std::vector<LVM_INT16> *out) {
+        const size_t frames = in.size() / 2;
+        out->resize(in.size());
+        for (size_t i = 0; i < frames; i += kMaxBlockSize) {
+            const LVM_UINT16 count = (LVM_UINT16) std::min((size_t) kMaxBlockSize, frames - i);
+            if (LVEQNB_Process(mHandle, &in[2 * i], &(*out)[2 * i], count) != LVEQNB_SUCCESS) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    LVEQNB_Handle_t         mHandle;
+    LVEQNB_MemTab_t         mMemTab;
+    LVEQNB_Capabilities_t   mCapabilities;
+    LVEQNB_BandDef_t        mBands[kNumBands];
+};
+
+// Stereo test signal at about -12 dBFS, so that the fixed point path does not clip:
+// a tone in each band, offset between channels, and white noise.
+std::vector<LVM_INT16> makeSignal(size_t frames, double sampleRate) {
+    std::vector<LVM_INT16> signal(frames * 2);
+    srand(42);
+    for (size_t i = 0; i < frames; i++) {
+        for (size_t c = 0; c < 2; c++) {
+            double v = 0.;
+            for (int b = 0; b < kNumBands; b++) {
+                v += 0.04 * sin(2. * M_PI * kFrequencies[b] * (1. + 0.1 * c) * i / sampleRate);
+            }
+            v += 0.05 * ((double) rand() / RAND_MAX - 0.5);
+            signal[2 * i + c] = (LVM_INT16) lrint(v * 32768.);
+        }
+    }
+    return signal;
+}
+
+struct Difference {
+    int maxAbs;
+    double snrDb;   // signal to difference ratio
+};
+
+Difference compare(const std::vector<LVM_INT16> &reference,
+        const std::vector<LVM_INT16> &test) {
+    Difference d = { 0, 0. };
+    double signalPower = 0.;
+    double errorPower = 0.;
+    for (size_t i = 0; i < reference.size(); i++) {
+        const int diff = abs((int) reference[i] - (int) test[i]);
+        d.maxAbs = std::max(d.maxAbs, diff);
+        signalPower += (double) reference[i] * reference[i];
+        errorPower += (double) diff * diff;
+    }
+    d.snrDb = errorPower == 0. ? INFINITY : 10. * log10(signalPower / errorPower);
+    return d;
+}
+
+void testAccuracy(LVEQNB_Fs_en fs, double sampleRate, const LVM_INT16 gains[kNumBands]) {
+    Equaliser fixedEq, floatEq;
+    ASSERT_TRUE(fixedEq.init());
+    ASSERT_TRUE(floatEq.init());
+    ASSERT_TRUE(fixedEq.control(fs, gains, LVEQNB_PRECISION_FIXED));
+    ASSERT_TRUE(floatEq.control(fs, gains, LVEQNB_PRECISION_FLOAT));
+    ASSERT_TRUE(fixedEq.warmUp((size_t) sampleRate));
+    ASSERT_TRUE(floatEq.warmUp((size_t) sampleRate));
+
+    const std::vector<LVM_INT16> in = makeSignal((size_t) sampleRate /* 1 second */, sampleRate);
+    std::vector<LVM_INT16> fixedOut, floatOut;
+    ASSERT_TRUE(fixedEq.process(in, &fixedOut));
+    ASSERT_TRUE(floatEq.process(in, &floatOut));
+
+    const Difference d = compare(fixedOut, floatOut);
+    ALOGV("sample rate %.0f: max difference %d, SNR %.1f dB", sampleRate, d.maxAbs, d.snrDb);
+    // Most of the difference is the error of the fixed point path, which truncates in each
+    // multiply and in the final shift: against a double precision cascade with the same
+    // coefficients it is biased by about -3 LSB, where the floating point path is unbiased.
+    EXPECT_LE(d.maxAbs, kMaxDifference);
+    EXPECT_GE(d.snrDb, kMinSnrDb);
+}
+
+} // namespace
+
+TEST(lvm_eq_float, accuracy_44100) {
+    const LVM_INT16 gains[kNumBands] = { 6, 3, 0, -3, 8 };
+    testAccuracy(LVEQNB_FS_44100, 44100., gains);
+}
+
+TEST(lvm_eq_float, accuracy_48000) {
+    const LVM_INT16 gains[kNumBands] = { -12, 9, -6, 12, -15 };
+    testAccuracy(LVEQNB_FS_48000, 48000., gains);
+}
+
+TEST(lvm_eq_float, flat_is_transparent) {
+    // With all bands at 0 dB no filter runs, and the conversions must be lossless.
+    const LVM_INT16 gains[kNumBands] = { 0, 0, 0, 0, 0 };
+    Equaliser floatEq;
+    ASSERT_TRUE(floatEq.init());
+    ASSERT_TRUE(floatEq.control(LVEQNB_FS_48000, gains, LVEQNB_PRECISION_FLOAT));
+    ASSERT_TRUE(floatEq.warmUp(48000));
+    const std::vector<LVM_INT16> in = makeSignal(48000, 48000.);
+    std::vector<LVM_INT16> out;
+    ASSERT_TRUE(floatEq.process(in, &out));
+    EXPECT_EQ(0, memcmp(in.data(), out.data(), in.size() * sizeof(LVM_INT16)));
+}
+
+TEST(lvm_eq_float, switch_precision) {
+    const LVM_INT16 gains[kNumBands] = { 6, 3, 0, -3, 8 };
+    Equaliser eq;
+    ASSERT_TRUE(eq.init());
+    ASSERT_TRUE(eq.control(LVEQNB_FS_44100, gains, LVEQNB_PRECISION_FIXED));
+    ASSERT_TRUE(eq.warmUp(44100));
+    const std::vector<LVM_INT16> in = makeSignal(44100, 44100.);
+    std::vector<LVM_INT16> fixedOut, floatOut;
+    ASSERT_TRUE(eq.process(in, &fixedOut));
+    ASSERT_TRUE(eq.control(LVEQNB_FS_44100, gains, LVEQNB_PRECISION_FLOAT));
+    ASSERT_TRUE(eq.process(in, &floatOut));
+    // changing the precision clears the history, so both runs start from the same state
+    const Difference d = compare(fixedOut, floatOut);
+    EXPECT_LE(d.maxAbs, kMaxDifference);
+    EXPECT_GE(d.snrDb, kMinSnrDb);
+}
@@ -25,6 +25,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <cutils/properties.h>
 #include <log/log.h>
 
 #include "EffectBundle.h"
@@ -630,6 +631,9 @@ int LvmBundle_init(EffectContext *pContext){
     params.EQNB_OperatingMode     = LVM_EQNB_OFF;
     params.EQNB_NBands            = FIVEBAND_NUMBANDS;
     params.pEQNB_BandDefinition   = &BandDefs[0];
+    // The floating point equaliser is not bit-exact with the fixed point one
+    params.EQNB_Precision         = property_get_bool("audio.lvm.float_eq", false /* default_value */)
+                                    ? LVM_EQNB_FLOAT : LVM_EQNB_FIXED;
 
     for (int i=0; i<FIVEBAND_NUMBANDS; i++)
     {
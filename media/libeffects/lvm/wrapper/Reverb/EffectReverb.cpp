@@ -22,9 +22,12 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <new>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <cutils/properties.h>
 #include <log/log.h>
 
 #include "EffectReverb.h"
@@ -133,6 +136,8 @@ static const effect_descriptor_t * const gDescriptors[] = {
         &gInsertPresetReverbDescriptor
 };
 
+struct ReverbShared;
+
 struct ReverbContext{
     const struct effect_interface_s *itfe;
     effect_config_t                 config;
@@ -162,8 +167,42 @@ struct ReverbContext{
     LVM_INT16                       prevLeftVolume;
     LVM_INT16                       prevRightVolume;
     int                             volumeMode;
+    int32_t                         ioId;
+    bool                            shareInstance;  // share hInstance with identical reverbs
+    ReverbShared                    *pShared;       // non NULL when hInstance is shared
+    uint32_t                        sharedGeneration; // generation of the last send added
+    uint32_t                        instanceSize;   // bytes allocated for an LVREV instance
 };
 
+// An LVREV instance shared by the insert preset reverbs of an output that use the same preset.
+// Reverb is linear, so rather than each reverb processing its own send, the sends of all users
+// are summed and processed once. Each user adds its dry signal to its own output, and the user
+// which processes the summed send adds the wet signal to its output.
+// As the users are processed one after the other by the thread of the output, the summed send
+// is processed when a user finds that it has already contributed to it, which delays the wet
+// signal by one period.
+// Protected by gSharedLock.
+struct ReverbShared {
+    ReverbShared                    *next;
+    int32_t                         ioId;
+    uint16_t                        preset;
+    LVM_Fs_en                       SampleRate;
+    LVREV_Handle_t                  hInstance;
+    uint32_t                        instanceSize;   // bytes allocated for hInstance
+    int                             users;
+    uint32_t                        generation;     // incremented each time the send is processed
+    int                             sendFrames;     // frames in SendFrames32
+    LVM_INT32                       *SendFrames32;  // stereo sum of the sends not yet processed
+    LVM_INT32                       *WetFrames32;   // stereo wet signal of the last send processed
+};
+
+pthread_mutex_t gSharedLock = PTHREAD_MUTEX_INITIALIZER;
+ReverbShared *gSharedList;          // all shared instances
+uint64_t gSharedBytesSaved;         // bytes not allocated thanks to sharing, for dump
+uint64_t gSharedSendsProcessed;     // sends processed by shared instances, for dump
+
+#define PROPERTY_REVERB_SHARE_INSERT "audio.reverb.share_insert"
+
 enum {
     REVERB_VOLUME_OFF,
     REVERB_VOLUME_FLAT,
@@ -187,12 +226,19 @@ int  Reverb_getParameter    (ReverbContext *pContext,
                              uint32_t      *pValueSize,
                              void          *pValue);
 int Reverb_LoadPreset       (ReverbContext   *pContext);
+int  Reverb_allocInstance   (ReverbContext *pContext, LVREV_Handle_t *phInstance);
+void Reverb_freeInstance    (LVREV_Handle_t hInstance);
+LVREV_Handle_t Reverb_detachShared(ReverbContext *pContext);
+void Reverb_leaveShared     (ReverbContext *pContext);
+void Reverb_updateShared    (ReverbContext *pContext);
+LVREV_ReturnStatus_en Reverb_processShared(ReverbContext *pContext, int frameCount,
+                                           const LVM_INT32 **ppWet, int *pWetFrames);
 
 /* Effect Library Interface Implementation */
 
 extern "C" int EffectCreate(const effect_uuid_t *uuid,
                             int32_t             sessionId __unused,
-                            int32_t             ioId __unused,
+                            int32_t             ioId,
                             effect_handle_t  *pHandle){
     int ret;
     int i;
@@ -223,6 +269,8 @@ extern "C" int EffectCreate(const effect_uuid_t *uuid,
 
     pContext->itfe      = &gReverbInterface;
     pContext->hInstance = NULL;
+    pContext->ioId      = ioId;
+    pContext->pShared   = NULL;
 
     pContext->auxiliary = false;
     if ((desc->flags & EFFECT_FLAG_TYPE_MASK) == EFFECT_FLAG_TYPE_AUXILIARY){
@@ -243,6 +291,10 @@ extern "C" int EffectCreate(const effect_uuid_t *uuid,
         ALOGV("\tEffectCreate - ENVIRONMENTAL");
     }
 
+    // only insert preset reverbs can share an instance, as their whole state is the preset
+    pContext->shareInstance = !pContext->auxiliary && pContext->preset &&
+            property_get_bool(PROPERTY_REVERB_SHARE_INSERT, false /* default_value */);
+
     ALOGV("\tEffectCreate - Calling Reverb_init");
     ret = Reverb_init(pContext);
 
@@ -421,6 +473,8 @@ int process( LVM_INT16     *pIn,
     LVM_INT16               samplesPerFrame = 1;
     LVREV_ReturnStatus_en   LvmStatus = LVREV_SUCCESS;              /* Function call status */
     LVM_INT16 *OutFrames16;
+    const LVM_INT32 *pWet = NULL;   // wet signal of a shared instance
+    int wetFrames = 0;
 
 
     // Check that the input is either mono or stereo
@@ -471,11 +525,17 @@ int process( LVM_INT16     *pIn,
             ALOGV("\tZeroing %d samples per frame at the end of call", samplesPerFrame);
         }
 
-        /* Process the samples, producing a stereo output */
-        LvmStatus = LVREV_Process(pContext->hInstance,      /* Instance handle */
-                                  pContext->InFrames32,     /* Input buffer */
-                                  pContext->OutFrames32,    /* Output buffer */
-                                  frameCount);              /* Number of samples to read */
+        if (pContext->pShared != NULL) {
+            LvmStatus = Reverb_processShared(pContext, frameCount, &pWet, &wetFrames);
+            // the wet signal is added after the volume, which is already applied to the send
+            memset(pContext->OutFrames32, 0, frameCount * sizeof(LVM_INT32) * 2);
+        } else {
+            /* Process the samples, producing a stereo output */
+            LvmStatus = LVREV_Process(pContext->hInstance,      /* Instance handle */
+                                      pContext->InFrames32,     /* Input buffer */
+                                      pContext->OutFrames32,    /* Output buffer */
+                                      frameCount);              /* Number of samples to read */
+        }
     }
 
     LVM_ERROR_CHECK(LvmStatus, "LVREV_Process", "process")
@@ -526,6 +586,10 @@ int process( LVM_INT16     *pIn,
             pContext->prevRightVolume = pContext->rightVolume;
             pContext->volumeMode = REVERB_VOLUME_RAMP;
         }
+
+        for (int i = 0; i < wetFrames * 2; i++) {
+            OutFrames16[i] = clamp16((LVM_INT32)OutFrames16[i] + (pWet[i] >> 8));
+        }
     }
 
     #ifdef LVM_PCM
@@ -548,28 +612,28 @@ int process( LVM_INT16     *pIn,
 }    /* end process */
 
 //----------------------------------------------------------------------------
-// Reverb_free()
+// Reverb_freeInstance()
 //----------------------------------------------------------------------------
-// Purpose: Free all memory associated with the Bundle.
+// Purpose: Free all memory associated with an LVREV instance.
 //
 // Inputs:
-//  pContext:   effect engine context
+//  hInstance:  instance allocated by Reverb_allocInstance()
 //
 // Outputs:
 //
 //----------------------------------------------------------------------------
 
-void Reverb_free(ReverbContext *pContext){
+void Reverb_freeInstance(LVREV_Handle_t hInstance){
 
     LVREV_ReturnStatus_en     LvmStatus=LVREV_SUCCESS;         /* Function call status */
     LVREV_MemoryTable_st      MemTab;
 
     /* Free the algorithm memory */
-    LvmStatus = LVREV_GetMemoryTable(pContext->hInstance,
+    LvmStatus = LVREV_GetMemoryTable(hInstance,
                                    &MemTab,
                                    LVM_NULL);
 
-    LVM_ERROR_CHECK(LvmStatus, "LVM_GetMemoryTable", "Reverb_free")
+    LVM_ERROR_CHECK(LvmStatus, "LVM_GetMemoryTable", "Reverb_freeInstance")
 
     for (int i=0; i<LVM_NR_MEMORY_REGIONS; i++){
         if (MemTab.Region[i].Size != 0){
@@ -588,8 +652,259 @@ void Reverb_free(ReverbContext *pContext){
             }
         }
     }
+}    /* end Reverb_freeInstance */
+
+//----------------------------------------------------------------------------
+// Reverb_free()
+//----------------------------------------------------------------------------
+// Purpose: Free all memory associated with the Bundle.
+//
+// Inputs:
+//  pContext:   effect engine context
+//
+// Outputs:
+//
+//----------------------------------------------------------------------------
+
+void Reverb_free(ReverbContext *pContext){
+    if (pContext->pShared != NULL) {
+        // a shared instance is only freed by its last user
+        pContext->hInstance = Reverb_detachShared(pContext);
+    }
+    if (pContext->hInstance != NULL) {
+        Reverb_freeInstance(pContext->hInstance);
+        pContext->hInstance = NULL;
+    }
 }    /* end Reverb_free */
 
+//----------------------------------------------------------------------------
+// Reverb_detachShared()
+//----------------------------------------------------------------------------
+// Purpose: Stop using the shared instance of the reverb
+//
+// Inputs:
+//  pContext:   effect engine context, with a shared instance
+//
+// Outputs:
+//  returns the shared instance if pContext was its last user, and is now its owner,
+//  NULL otherwise
+//
+//----------------------------------------------------------------------------
+
+LVREV_Handle_t Reverb_detachShared(ReverbContext *pContext){
+    ReverbShared *pShared = pContext->pShared;
+    LVREV_Handle_t hInstance = NULL;
+
+    pthread_mutex_lock(&gSharedLock);
+    pContext->pShared = NULL;
+    if (--pShared->users == 0) {
+        ReverbShared **ppShared = &gSharedList;
+        while (*ppShared != pShared) {
+            ppShared = &(*ppShared)->next;
+        }
+        *ppShared = pShared->next;
+        hInstance = pShared->hInstance;
+        free(pShared->SendFrames32);
+        free(pShared->WetFrames32);
+        delete pShared;
+    } else {
+        gSharedBytesSaved -= pShared->instanceSize;
+    }
+    pthread_mutex_unlock(&gSharedLock);
+    return hInstance;
+}   /* end Reverb_detachShared */
+
+//----------------------------------------------------------------------------
+// Reverb_leaveShared()
+//----------------------------------------------------------------------------
+// Purpose: Give the reverb its own instance, with the settings of the shared instance,
+//  before the settings of the reverb change
+//
+// Inputs:
+//  pContext:   effect engine context
+//
+// Outputs:
+//
+//----------------------------------------------------------------------------
+
+void Reverb_leaveShared(ReverbContext *pContext){
+    LVREV_ControlParams_st    ActiveParams;
+    LVREV_ReturnStatus_en     LvmStatus;
+
+    if (pContext->pShared == NULL) {
+        return;
+    }
+
+    LvmStatus = LVREV_GetControlParameters(pContext->hInstance, &ActiveParams);
+    LVM_ERROR_CHECK(LvmStatus, "LVREV_GetControlParameters", "Reverb_leaveShared")
+
+    pContext->hInstance = Reverb_detachShared(pContext);
+    if (pContext->hInstance != NULL) {
+        return;
+    }
+    if (Reverb_allocInstance(pContext, &pContext->hInstance) != 0) {
+        ALOGE("Reverb_leaveShared failed to allocate an instance");
+        pContext->hInstance = NULL;
+        return;
+    }
+    if (LvmStatus == LVREV_SUCCESS) {
+        LvmStatus = LVREV_SetControlParameters(pContext->hInstance, &ActiveParams);
+        LVM_ERROR_CHECK(LvmStatus, "LVREV_SetControlParameters", "Reverb_leaveShared")
+    }
+}   /* end Reverb_leaveShared */
+
+//----------------------------------------------------------------------------
+// Reverb_updateShared()
+//----------------------------------------------------------------------------
+// Purpose: Share the instance of the reverb with the reverbs of the same output that use
+//  the same preset at the same sample rate, or stop sharing it if the preset or the sample
+//  rate changed
+//
+// Inputs:
+//  pContext:   effect engine context
+//
+// Outputs:
+//
+//----------------------------------------------------------------------------
+
+void Reverb_updateShared(ReverbContext *pContext){
+    ReverbShared *pShared = pContext->pShared;
+    LVREV_Handle_t hUnused = NULL;
+
+    if (!pContext->shareInstance) {
+        return;
+    }
+    const bool eligible = pContext->nextPreset != REVERB_PRESET_NONE;
+    if (pShared != NULL) {
+        if (eligible && pShared->preset == pContext->nextPreset &&
+                pShared->SampleRate == pContext->SampleRate) {
+            return;
+        }
+        Reverb_leaveShared(pContext);
+    }
+    if (!eligible || pContext->hInstance == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&gSharedLock);
+    for (pShared = gSharedList; pShared != NULL; pShared = pShared->next) {
+        if (pShared->ioId == pContext->ioId && pShared->preset == pContext->nextPreset &&
+                pShared->SampleRate == pContext->SampleRate) {
+            break;
+        }
+    }
+    if (pShared == NULL) {
+        // first user, which lends its instance
+        pShared = new (std::nothrow) ReverbShared;
+        if (pShared == NULL) {
+            pthread_mutex_unlock(&gSharedLock);
+            return;
+        }
+        pShared->SendFrames32 =
+                (LVM_INT32 *)malloc(LVREV_MAX_FRAME_SIZE * sizeof(LVM_INT32) * 2);
+        pShared->WetFrames32 =
+                (LVM_INT32 *)malloc(LVREV_MAX_FRAME_SIZE * sizeof(LVM_INT32) * 2);
+        if (pShared->SendFrames32 == NULL || pShared->WetFrames32 == NULL) {
+            free(pShared->SendFrames32);
+            free(pShared->WetFrames32);
+            delete pShared;
+            pthread_mutex_unlock(&gSharedLock);
+            return;
+        }
+        pShared->ioId = pContext->ioId;
+        pShared->preset = pContext->nextPreset;
+        pShared->SampleRate = pContext->SampleRate;
+        pShared->hInstance = pContext->hInstance;
+        pShared->instanceSize = pContext->instanceSize;
+        pShared->users = 0;
+        pShared->generation = 0;
+        pShared->sendFrames = 0;
+        pShared->next = gSharedList;
+        gSharedList = pShared;
+    } else {
+        // the preset is loaded in the shared instance by its first user
+        hUnused = pContext->hInstance;
+        pContext->hInstance = pShared->hInstance;
+        pContext->curPreset = pContext->nextPreset;
+        gSharedBytesSaved += pShared->instanceSize;
+    }
+    pShared->users++;
+    pContext->pShared = pShared;
+    // not part of the pending send
+    pContext->sharedGeneration = pShared->generation - 1;
+    pthread_mutex_unlock(&gSharedLock);
+
+    if (hUnused != NULL) {
+        Reverb_freeInstance(hUnused);
+    }
+    ALOGV("Reverb_updateShared io %d preset %u: %d users", pContext->ioId,
+            pContext->nextPreset, pShared->users);
+}   /* end Reverb_updateShared */
+
+//----------------------------------------------------------------------------
+// Reverb_processShared()
+//----------------------------------------------------------------------------
+// Purpose: Add the send of the reverb to the send of its shared instance, after processing
+//  the pending send if the reverb has already contributed to it
+//
+// Inputs:
+//  pContext:   effect engine context, with a shared instance
+//  frameCount: Frames in pContext->InFrames32
+//
+// Outputs:
+//  ppWet:      the wet signal to add to the output of the reverb, NULL if none
+//  pWetFrames: the frames in *ppWet
+//
+//----------------------------------------------------------------------------
+
+LVREV_ReturnStatus_en Reverb_processShared(ReverbContext *pContext, int frameCount,
+                                           const LVM_INT32 **ppWet, int *pWetFrames){
+    ReverbShared *pShared = pContext->pShared;
+    LVREV_ReturnStatus_en LvmStatus = LVREV_SUCCESS;
+
+    *ppWet = NULL;
+    *pWetFrames = 0;
+
+    pthread_mutex_lock(&gSharedLock);
+    if (pContext->sharedGeneration == pShared->generation && pShared->sendFrames > 0) {
+        // the other users have added their send since this one did
+        LvmStatus = LVREV_Process(pShared->hInstance,
+                                  pShared->SendFrames32,
+                                  pShared->WetFrames32,
+                                  pShared->sendFrames);
+        if (LvmStatus == LVREV_SUCCESS) {
+            *ppWet = pShared->WetFrames32;
+            *pWetFrames = pShared->sendFrames < frameCount ? pShared->sendFrames : frameCount;
+        }
+        pShared->generation++;
+        pShared->sendFrames = 0;
+        gSharedSendsProcessed++;
+    }
+
+    // the volume of each user applies to its contribution to the wet signal
+    LVM_INT32 *pSend = pShared->SendFrames32;
+    for (int i = 0; i < frameCount; i++) {
+        const LVM_INT32 left =
+                (LVM_INT32)(((int64_t)pContext->InFrames32[2*i] * pContext->leftVolume) >> 12);
+        const LVM_INT32 right =
+                (LVM_INT32)(((int64_t)pContext->InFrames32[2*i+1] * pContext->rightVolume) >> 12);
+        if (i < pShared->sendFrames) {
+            pSend[2*i] += left;
+            pSend[2*i+1] += right;
+        } else {
+            pSend[2*i] = left;
+            pSend[2*i+1] = right;
+        }
+    }
+    if (frameCount > pShared->sendFrames) {
+        pShared->sendFrames = frameCount;
+    }
+    pContext->sharedGeneration = pShared->generation;
+    pthread_mutex_unlock(&gSharedLock);
+
+    return LvmStatus;
+}   /* end Reverb_processShared */
+
 //----------------------------------------------------------------------------
 // Reverb_setConfig()
 //----------------------------------------------------------------------------
@@ -654,6 +969,7 @@ int Reverb_setConfig(ReverbContext *pContext, effect_config_t *pConfig){
         LVREV_ReturnStatus_en     LvmStatus = LVREV_SUCCESS;
 
         //ALOGV("\tReverb_setConfig change sampling rate to %d", SampleRate);
+        Reverb_leaveShared(pContext);
 
         /* Get the current settings */
         LvmStatus = LVREV_GetControlParameters(pContext->hInstance,
@@ -673,6 +989,7 @@ int Reverb_setConfig(ReverbContext *pContext, effect_config_t *pConfig){
     }else{
         //ALOGV("\tReverb_setConfig keep sampling rate at %d", SampleRate);
     }
+    Reverb_updateShared(pContext);
 
     //ALOGV("\tReverb_setConfig End");
     return 0;
@@ -698,56 +1015,21 @@ void Reverb_getConfig(ReverbContext *pContext, effect_config_t *pConfig)
 }   /* end Reverb_getConfig */
 
 //----------------------------------------------------------------------------
-// Reverb_init()
+// Reverb_allocInstance()
 //----------------------------------------------------------------------------
-// Purpose: Initialize engine with default configuration
+// Purpose: Allocate an LVREV instance with the capabilities needed by the wrapper
 //
 // Inputs:
 //  pContext:   effect engine context
 //
 // Outputs:
+//  phInstance: the new instance, to be freed with Reverb_freeInstance()
+//  pContext->instanceSize: the bytes allocated for the instance
 //
 //----------------------------------------------------------------------------
 
-int Reverb_init(ReverbContext *pContext){
-    ALOGV("\tReverb_init start");
-
-    CHECK_ARG(pContext != NULL);
-
-    if (pContext->hInstance != NULL){
-        Reverb_free(pContext);
-    }
-
-    pContext->config.inputCfg.accessMode                    = EFFECT_BUFFER_ACCESS_READ;
-    if (pContext->auxiliary) {
-        pContext->config.inputCfg.channels                  = AUDIO_CHANNEL_OUT_MONO;
-    } else {
-        pContext->config.inputCfg.channels                  = AUDIO_CHANNEL_OUT_STEREO;
-    }
-
-    pContext->config.inputCfg.format                        = AUDIO_FORMAT_PCM_16_BIT;
-    pContext->config.inputCfg.samplingRate                  = 44100;
-    pContext->config.inputCfg.bufferProvider.getBuffer      = NULL;
-    pContext->config.inputCfg.bufferProvider.releaseBuffer  = NULL;
-    pContext->config.inputCfg.bufferProvider.cookie         = NULL;
-    pContext->config.inputCfg.mask                          = EFFECT_CONFIG_ALL;
-    pContext->config.outputCfg.accessMode                   = EFFECT_BUFFER_ACCESS_ACCUMULATE;
-    pContext->config.outputCfg.channels                     = AUDIO_CHANNEL_OUT_STEREO;
-    pContext->config.outputCfg.format                       = AUDIO_FORMAT_PCM_16_BIT;
-    pContext->config.outputCfg.samplingRate                 = 44100;
-    pContext->config.outputCfg.bufferProvider.getBuffer     = NULL;
-    pContext->config.outputCfg.bufferProvider.releaseBuffer = NULL;
-    pContext->config.outputCfg.bufferProvider.cookie        = NULL;
-    pContext->config.outputCfg.mask                         = EFFECT_CONFIG_ALL;
-
-    pContext->leftVolume = REVERB_UNIT_VOLUME;
-    pContext->rightVolume = REVERB_UNIT_VOLUME;
-    pContext->prevLeftVolume = REVERB_UNIT_VOLUME;
-    pContext->prevRightVolume = REVERB_UNIT_VOLUME;
-    pContext->volumeMode = REVERB_VOLUME_FLAT;
-
+int Reverb_allocInstance(ReverbContext *pContext, LVREV_Handle_t *phInstance){
     LVREV_ReturnStatus_en     LvmStatus=LVREV_SUCCESS;        /* Function call status */
-    LVREV_ControlParams_st    params;                         /* Control Parameters */
     LVREV_InstanceParams_st   InstParams;                     /* Instance parameters */
     LVREV_MemoryTable_st      MemTab;                         /* Memory allocation table */
     bool                      bMallocFailure = LVM_FALSE;
@@ -762,7 +1044,7 @@ int Reverb_init(ReverbContext *pContext){
                                   &MemTab,
                                   &InstParams);
 
-    LVM_ERROR_CHECK(LvmStatus, "LVREV_GetMemoryTable", "Reverb_init")
+    LVM_ERROR_CHECK(LvmStatus, "LVREV_GetMemoryTable", "Reverb_allocInstance")
     if(LvmStatus != LVREV_SUCCESS) return -EINVAL;
 
     ALOGV("\tCreateInstance Succesfully called LVM_GetMemoryTable\n");
@@ -773,11 +1055,11 @@ int Reverb_init(ReverbContext *pContext){
             MemTab.Region[i].pBaseAddress = malloc(MemTab.Region[i].Size);
 
             if (MemTab.Region[i].pBaseAddress == LVM_NULL){
-                ALOGV("\tLVREV_ERROR :Reverb_init CreateInstance Failed to allocate %" PRIu32
+                ALOGV("\tLVREV_ERROR :Reverb_allocInstance Failed to allocate %" PRIu32
                         " bytes for region %u\n", MemTab.Region[i].Size, i );
                 bMallocFailure = LVM_TRUE;
             }else{
-                ALOGV("\tReverb_init CreateInstance allocate %" PRIu32
+                ALOGV("\tReverb_allocInstance allocate %" PRIu32
                         " bytes for region %u at %p\n",
                         MemTab.Region[i].Size, i, MemTab.Region[i].pBaseAddress);
             }
@@ -790,10 +1072,10 @@ int Reverb_init(ReverbContext *pContext){
     if(bMallocFailure == LVM_TRUE){
         for (int i=0; i<LVM_NR_MEMORY_REGIONS; i++){
             if (MemTab.Region[i].pBaseAddress == LVM_NULL){
-                ALOGV("\tLVM_ERROR :Reverb_init CreateInstance Failed to allocate %" PRIu32
+                ALOGV("\tLVM_ERROR :Reverb_allocInstance Failed to allocate %" PRIu32
                         " bytes for region %u - Not freeing\n", MemTab.Region[i].Size, i );
             }else{
-                ALOGV("\tLVM_ERROR :Reverb_init CreateInstance Failed: but allocated %" PRIu32
+                ALOGV("\tLVM_ERROR :Reverb_allocInstance Failed: but allocated %" PRIu32
                         " bytes for region %u at %p- free\n",
                         MemTab.Region[i].Size, i, MemTab.Region[i].pBaseAddress);
                 free(MemTab.Region[i].pBaseAddress);
@@ -801,20 +1083,83 @@ int Reverb_init(ReverbContext *pContext){
         }
         return -EINVAL;
     }
-    ALOGV("\tReverb_init CreateInstance Succesfully malloc'd memory\n");
+    ALOGV("\tReverb_allocInstance Succesfully malloc'd memory\n");
+
+    pContext->instanceSize = 0;
+    for (int i=0; i<LVM_NR_MEMORY_REGIONS; i++){
+        pContext->instanceSize += MemTab.Region[i].Size;
+    }
 
     /* Initialise */
-    pContext->hInstance = LVM_NULL;
+    *phInstance = LVM_NULL;
 
     /* Init sets the instance handle */
-    LvmStatus = LVREV_GetInstanceHandle(&pContext->hInstance,
+    LvmStatus = LVREV_GetInstanceHandle(phInstance,
                                         &MemTab,
                                         &InstParams);
 
-    LVM_ERROR_CHECK(LvmStatus, "LVM_GetInstanceHandle", "Reverb_init")
+    LVM_ERROR_CHECK(LvmStatus, "LVM_GetInstanceHandle", "Reverb_allocInstance")
     if(LvmStatus != LVREV_SUCCESS) return -EINVAL;
 
-    ALOGV("\tReverb_init CreateInstance Succesfully called LVM_GetInstanceHandle\n");
+    ALOGV("\tReverb_allocInstance Succesfully called LVM_GetInstanceHandle\n");
+    return 0;
+}   /* end Reverb_allocInstance */
+
+//----------------------------------------------------------------------------
+// Reverb_init()
+//----------------------------------------------------------------------------
+// Purpose: Initialize engine with default configuration
+//
+// Inputs:
+//  pContext:   effect engine context
+//
+// Outputs:
+//
+//----------------------------------------------------------------------------
+
+int Reverb_init(ReverbContext *pContext){
+    ALOGV("\tReverb_init start");
+
+    CHECK_ARG(pContext != NULL);
+
+    if (pContext->hInstance != NULL){
+        Reverb_free(pContext);
+    }
+
+    pContext->config.inputCfg.accessMode                    = EFFECT_BUFFER_ACCESS_READ;
+    if (pContext->auxiliary) {
+        pContext->config.inputCfg.channels                  = AUDIO_CHANNEL_OUT_MONO;
+    } else {
+        pContext->config.inputCfg.channels                  = AUDIO_CHANNEL_OUT_STEREO;
+    }
+
+    pContext->config.inputCfg.format                        = AUDIO_FORMAT_PCM_16_BIT;
+    pContext->config.inputCfg.samplingRate                  = 44100;
+    pContext->config.inputCfg.bufferProvider.getBuffer      = NULL;
+    pContext->config.inputCfg.bufferProvider.releaseBuffer  = NULL;
+    pContext->config.inputCfg.bufferProvider.cookie         = NULL;
+    pContext->config.inputCfg.mask                          = EFFECT_CONFIG_ALL;
+    pContext->config.outputCfg.accessMode                   = EFFECT_BUFFER_ACCESS_ACCUMULATE;
+    pContext->config.outputCfg.channels                     = AUDIO_CHANNEL_OUT_STEREO;
+    pContext->config.outputCfg.format                       = AUDIO_FORMAT_PCM_16_BIT;
+    pContext->config.outputCfg.samplingRate                 = 44100;
+    pContext->config.outputCfg.bufferProvider.getBuffer     = NULL;
+    pContext->config.outputCfg.bufferProvider.releaseBuffer = NULL;
+    pContext->config.outputCfg.bufferProvider.cookie        = NULL;
+    pContext->config.outputCfg.mask                         = EFFECT_CONFIG_ALL;
+
+    pContext->leftVolume = REVERB_UNIT_VOLUME;
+    pContext->rightVolume = REVERB_UNIT_VOLUME;
+    pContext->prevLeftVolume = REVERB_UNIT_VOLUME;
+    pContext->prevRightVolume = REVERB_UNIT_VOLUME;
+    pContext->volumeMode = REVERB_VOLUME_FLAT;
+
+    LVREV_ReturnStatus_en     LvmStatus=LVREV_SUCCESS;        /* Function call status */
+    LVREV_ControlParams_st    params;                         /* Control Parameters */
+
+    if (Reverb_allocInstance(pContext, &pContext->hInstance) != 0) {
+        return -EINVAL;
+    }
 
     /* Set the initial process parameters */
     /* General parameters */
@@ -1772,6 +2117,7 @@ int Reverb_setParameter (ReverbContext *pContext, void *pParam, void *pValue){
             return -EINVAL;
         }
         pContext->nextPreset = preset;
+        Reverb_updateShared(pContext);
         return 0;
     }
 
@@ -2148,6 +2494,49 @@ const struct effect_interface_s gReverbInterface = {
     NULL,
 };    /* end gReverbInterface */
 
+// Called by the effects factory when dumping the effects
+__attribute__ ((visibility ("default")))
+void EffectLibraryDump(int fd) {
+    static const int kMaxDumped = 16;
+    struct {
+        int32_t ioId;
+        uint16_t preset;
+        int users;
+        uint32_t instanceSize;
+    } shared[kMaxDumped];
+    int count = 0;
+    int total = 0;
+
+    // copy, to not hold the lock while writing to fd
+    pthread_mutex_lock(&android::gSharedLock);
+    for (android::ReverbShared *pShared = android::gSharedList; pShared != NULL;
+            pShared = pShared->next, total++) {
+        if (count < kMaxDumped) {
+            shared[count].ioId = pShared->ioId;
+            shared[count].preset = pShared->preset;
+            shared[count].users = pShared->users;
+            shared[count].instanceSize = pShared->instanceSize;
+            count++;
+        }
+    }
+    const uint64_t bytesSaved = android::gSharedBytesSaved;
+    const uint64_t sendsProcessed = android::gSharedSendsProcessed;
+    pthread_mutex_unlock(&android::gSharedLock);
+
+    dprintf(fd, "  Shared insert preset reverbs (%s): %d instances, %" PRIu64
+            " bytes saved, %" PRIu64 " sends processed\n",
+            property_get_bool(PROPERTY_REVERB_SHARE_INSERT, false /* default_value */)
+                    ? "enabled" : "disabled",
+            total, bytesSaved, sendsProcessed);
+    for (int i = 0; i < count; i++) {
+        dprintf(fd, "   io %d preset %u: %d users of %" PRIu32 " bytes\n",
+                shared[i].ioId, shared[i].preset, shared[i].users, shared[i].instanceSize);
+    }
+    if (count < total) {
+        dprintf(fd, "   ...\n");
+    }
+}
+
 // This is the only symbol that needs to be exported
 __attribute__ ((visibility ("default")))
 audio_effect_library_t AUDIO_EFFECT_LIBRARY_INFO_SYM = {
@@ -802,6 +802,24 @@ int Effect_Release(preproc_effect_t *effect)
 static const int kPreprocDefaultSr = 16000;
 static const int kPreProcDefaultCnl = 1;
 
+// Positional masks only exist for mono and stereo capture, larger microphone arrays are
+// described with channel index masks.
+static audio_channel_mask_t Session_ChannelMaskFromCount(uint32_t channelCount)
+{
+    if (channelCount <= 2) {
+        return audio_channel_in_mask_from_count(channelCount);
+    }
+    return audio_channel_mask_for_index_assignment_from_count(channelCount);
+}
+
+// Whether 10 ms of channelCount channels at the APM sampling rate fit in a webrtc AudioFrame
+static bool Session_FitsAudioFrame(preproc_session_t *session, uint32_t channelCount)
+{
+    return channelCount > 0 &&
+            (session->apmSamplingRate / 100) * channelCount <=
+                    webrtc::AudioFrame::kMaxDataSizeSamples;
+}
+
 int Session_Init(preproc_session_t *session)
 {
     size_t i;
@@ -948,6 +966,7 @@ int Session_SetConfig(preproc_session_t *session, effect_config_t *config)
     int status;
 
     // AEC implementation is limited to 16kHz
+    uint32_t apmSamplingRate = session->apmSamplingRate;
     if (config->inputCfg.samplingRate >= 32000 && !(session->createdMsk & (1 << PREPROC_AEC))) {
         session->apmSamplingRate = 32000;
     } else
@@ -956,6 +975,13 @@ int Session_SetConfig(preproc_session_t *session, effect_config_t *config)
     } else if (config->inputCfg.samplingRate >= 8000) {
         session->apmSamplingRate = 8000;
     }
+    // all channels are processed in a single AudioFrame
+    if (!Session_FitsAudioFrame(session, inCnl) || !Session_FitsAudioFrame(session, outCnl)) {
+        ALOGW("Session_SetConfig %u in, %u out channels not supported at %u Hz",
+                inCnl, outCnl, session->apmSamplingRate);
+        session->apmSamplingRate = apmSamplingRate;
+        return -EINVAL;
+    }
 
     const webrtc::ProcessingConfig processing_config = {
       {{static_cast<int>(session->apmSamplingRate), inCnl},
@@ -1052,9 +1078,9 @@ void Session_GetConfig(preproc_session_t *session, effect_config_t *config)
     memset(config, 0, sizeof(effect_config_t));
     config->inputCfg.samplingRate = config->outputCfg.samplingRate = session->samplingRate;
     config->inputCfg.format = config->outputCfg.format = AUDIO_FORMAT_PCM_16_BIT;
-    config->inputCfg.channels = audio_channel_in_mask_from_count(session->inChannelCount);
+    config->inputCfg.channels = Session_ChannelMaskFromCount(session->inChannelCount);
     // "out" doesn't mean output device, so this is the correct API to convert channel count to mask
-    config->outputCfg.channels = audio_channel_in_mask_from_count(session->outChannelCount);
+    config->outputCfg.channels = Session_ChannelMaskFromCount(session->outChannelCount);
     config->inputCfg.mask = config->outputCfg.mask =
             (EFFECT_CONFIG_SMP_RATE | EFFECT_CONFIG_CHANNELS | EFFECT_CONFIG_FORMAT);
 }
@@ -1078,6 +1104,11 @@ int Session_SetReverseConfig(preproc_session_t *session, effect_config_t *config
         return -EINVAL;
     }
     uint32_t inCnl = audio_channel_count_from_out_mask(config->inputCfg.channels);
+    if (!Session_FitsAudioFrame(session, inCnl)) {
+        ALOGW("Session_SetReverseConfig %u channels not supported at %u Hz",
+                inCnl, session->apmSamplingRate);
+        return -EINVAL;
+    }
     const webrtc::ProcessingConfig processing_config = {
        {{static_cast<int>(session->apmSamplingRate), session->inChannelCount},
         {static_cast<int>(session->apmSamplingRate), session->outChannelCount},
@@ -1087,6 +1118,21 @@ int Session_SetReverseConfig(preproc_session_t *session, effect_config_t *config
     if (status < 0) {
         return -EINVAL;
     }
+    if (session->revResampler != NULL && inCnl != session->revChannelCount) {
+        int error;
+        SpeexResamplerState *resampler = speex_resampler_init(inCnl,
+                                                    session->samplingRate,
+                                                    session->apmSamplingRate,
+                                                    RESAMPLER_QUALITY,
+                                                    &error);
+        if (resampler == NULL) {
+            ALOGW("Session_SetReverseConfig Cannot create speex resampler: %s",
+                 speex_resampler_strerror(error));
+            return -EINVAL;
+        }
+        speex_resampler_destroy(session->revResampler);
+        session->revResampler = resampler;
+    }
     session->revChannelCount = inCnl;
     session->revFrame->num_channels_ = inCnl;
     session->revFrame->sample_rate_hz_ = session->apmSamplingRate;
@@ -1103,7 +1149,7 @@ void Session_GetReverseConfig(preproc_session_t *session, effect_config_t *confi
     config->inputCfg.samplingRate = config->outputCfg.samplingRate = session->samplingRate;
     config->inputCfg.format = config->outputCfg.format = AUDIO_FORMAT_PCM_16_BIT;
     config->inputCfg.channels = config->outputCfg.channels =
-            audio_channel_in_mask_from_count(session->revChannelCount);
+            Session_ChannelMaskFromCount(session->revChannelCount);
     config->inputCfg.mask = config->outputCfg.mask =
             (EFFECT_CONFIG_SMP_RATE | EFFECT_CONFIG_CHANNELS | EFFECT_CONFIG_FORMAT);
 }
@@ -1352,7 +1398,7 @@ int PreProcessingFx_Process(effect_handle_t     self,
         if (session->outResampler != NULL) {
             spx_uint32_t frIn = session->apmFrameCount;
             spx_uint32_t frOut = session->frameCount;
-            if (session->inChannelCount == 1) {
+            if (session->outChannelCount == 1) {
                 speex_resampler_process_int(session->outResampler,
                                     0,
                                     session->procFrame->data_,
@@ -1802,7 +1848,7 @@ int PreProcessingFx_ProcessReverse(effect_handle_t     self,
                 int16_t *buf;
                 session->revBufSize = session->framesRev + fr;
                 buf = (int16_t *)realloc(session->revBuf,
-                                 session->revBufSize * session->inChannelCount * sizeof(int16_t));
+                                 session->revBufSize * session->revChannelCount * sizeof(int16_t));
                 if (buf == NULL) {
                     session->framesRev = 0;
                     free(session->revBuf);
@@ -1811,9 +1857,9 @@ int PreProcessingFx_ProcessReverse(effect_handle_t     self,
                 }
                 session->revBuf = buf;
             }
-            memcpy(session->revBuf + session->framesRev * session->inChannelCount,
+            memcpy(session->revBuf + session->framesRev * session->revChannelCount,
                    inBuffer->s16,
-                   fr * session->inChannelCount * sizeof(int16_t));
+                   fr * session->revChannelCount * sizeof(int16_t));
 
             session->framesRev += fr;
             inBuffer->frameCount = fr;
@@ -1822,7 +1868,7 @@ int PreProcessingFx_ProcessReverse(effect_handle_t     self,
             }
             spx_uint32_t frIn = session->framesRev;
             spx_uint32_t frOut = session->apmFrameCount;
-            if (session->inChannelCount == 1) {
+            if (session->revChannelCount == 1) {
                 speex_resampler_process_int(session->revResampler,
                                             0,
                                             session->revBuf,
@@ -1837,17 +1883,17 @@ int PreProcessingFx_ProcessReverse(effect_handle_t     self,
                                                         &frOut);
             }
             memcpy(session->revBuf,
-                   session->revBuf + frIn * session->inChannelCount,
-                   (session->framesRev - frIn) * session->inChannelCount * sizeof(int16_t));
+                   session->revBuf + frIn * session->revChannelCount,
+                   (session->framesRev - frIn) * session->revChannelCount * sizeof(int16_t));
             session->framesRev -= frIn;
         } else {
             size_t fr = session->frameCount - session->framesRev;
             if (inBuffer->frameCount < fr) {
                 fr = inBuffer->frameCount;
             }
-            memcpy(session->revFrame->data_ + session->framesRev * session->inChannelCount,
+            memcpy(session->revFrame->data_ + session->framesRev * session->revChannelCount,
                    inBuffer->s16,
-                   fr * session->inChannelCount * sizeof(int16_t));
+                   fr * session->revChannelCount * sizeof(int16_t));
             session->framesRev += fr;
             inBuffer->frameCount = fr;
             if (session->framesRev < session->frameCount) {
@@ -22,14 +22,19 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <new>
 
+#include <cutils/ashmem.h>
 #include <log/log.h>
 
 #include <audio_effects/effect_visualizer.h>
 
+#include "VisualizerCaptureRing.h"
+
 extern "C" {
 
 // effect_handle_t interface implementation for visualizer effect
@@ -57,44 +62,67 @@ enum visualizer_state_e {
 // that the framework has stopped playing audio and we must start returning silence
 #define MAX_STALL_TIME_MS 1000
 
-#define CAPTURE_BUF_SIZE 65536 // "64k should be enough for everyone"
+#define CAPTURE_BUF_SIZE VISUALIZER_CAPTURE_RING_SIZE
 
 #define DISCARD_MEASUREMENTS_TIME_MS 2000 // discard measurements older than this number of ms
 
 #define MAX_LATENCY_MS 3000 // 3 seconds of latency for audio pipeline
 
 // maximum number of buffers for which we keep track of the measurements
-#define MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS 25 // note: buffer index is stored in uint8_t
-
-
-struct BufferStats {
-    bool mIsValid;
-    uint16_t mPeakU16; // the positive peak of the absolute value of the samples in a buffer
-    float mRmsSquared; // the average square of the samples in a buffer
-};
+#define MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS VISUALIZER_CAPTURE_RING_BLOCKS
 
 struct VisualizerContext {
     const struct effect_interface_s *mItfe;
     effect_config_t mConfig;
-    uint32_t mCaptureIdx;
     uint32_t mCaptureSize;
     uint32_t mScalingMode;
     uint8_t mState;
     uint32_t mLastCaptureIdx;
     uint32_t mLatency;
     struct timespec mBufferUpdateTime;
-    uint8_t mCaptureBuf[CAPTURE_BUF_SIZE];
+    // capture buffer and measurements, in shared memory
+    visualizer_capture_ring_t *mRing;
+    int mRingFd;
     // for measurements
     uint8_t mChannelCount; // to avoid recomputing it every time a buffer is processed
     uint32_t mMeasurementMode;
     uint8_t mMeasurementWindowSizeInBuffers;
-    uint8_t mMeasurementBufferIdx;
-    BufferStats mPastMeasurements[MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS];
 };
 
 //
 //--- Local functions
 //
+
+// The capture ring is only written between these, see VisualizerCaptureRing.h
+static inline void Visualizer_beginRingUpdate(VisualizerContext *pContext)
+{
+    std::atomic<uint32_t> &sequence = pContext->mRing->mSequence;
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+static inline void Visualizer_endRingUpdate(VisualizerContext *pContext)
+{
+    std::atomic<uint32_t> &sequence = pContext->mRing->mSequence;
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+static inline void Visualizer_clearMeasurements(VisualizerContext *pContext)
+{
+    for (uint32_t i=0 ; i<pContext->mMeasurementWindowSizeInBuffers ; i++) {
+        pContext->mRing->mBlocks[i].mIsValid = false;
+        pContext->mRing->mBlocks[i].mPeakU16 = 0;
+        pContext->mRing->mBlocks[i].mRmsSquared = 0;
+    }
+    pContext->mRing->mBlockIdx = 0;
+}
+
+static inline uint32_t Visualizer_timeMs(const struct timespec *ts)
+{
+    // 0 means idle
+    const uint32_t timeMs = ts->tv_sec * 1000 + ts->tv_nsec / 1000000;
+    return timeMs == 0 ? 1 : timeMs;
+}
 uint32_t Visualizer_getDeltaTimeMsFromUpdatedTime(VisualizerContext* pContext) {
     uint32_t deltaMs = 0;
     if (pContext->mBufferUpdateTime.tv_sec != 0) {
@@ -115,11 +143,66 @@ uint32_t Visualizer_getDeltaTimeMsFromUpdatedTime(VisualizerContext* pContext) {
 
 void Visualizer_reset(VisualizerContext *pContext)
 {
-    pContext->mCaptureIdx = 0;
     pContext->mLastCaptureIdx = 0;
     pContext->mBufferUpdateTime.tv_sec = 0;
     pContext->mLatency = 0;
-    memset(pContext->mCaptureBuf, 0x80, CAPTURE_BUF_SIZE);
+    Visualizer_beginRingUpdate(pContext);
+    pContext->mRing->mSampleRate = pContext->mConfig.inputCfg.samplingRate;
+    pContext->mRing->mCaptureIdx = 0;
+    pContext->mRing->mUpdateTimeMs = 0;
+    memset(pContext->mRing->mCaptureBuf, 0x80, CAPTURE_BUF_SIZE);
+    Visualizer_endRingUpdate(pContext);
+}
+
+//----------------------------------------------------------------------------
+// Visualizer_allocRing()
+//----------------------------------------------------------------------------
+// Purpose: Allocate the capture ring in shared memory, which other processes can only map
+//  read-only.
+//
+// Inputs:
+//  pContext:   effect engine context
+//
+// Outputs:
+//
+//----------------------------------------------------------------------------
+
+int Visualizer_allocRing(VisualizerContext *pContext)
+{
+    const size_t size = sizeof(visualizer_capture_ring_t);
+
+    pContext->mRingFd = ashmem_create_region("VisualizerCaptureRing", size);
+    if (pContext->mRingFd < 0) {
+        ALOGE("Visualizer_allocRing() ashmem_create_region() failed %d", errno);
+        return -ENOMEM;
+    }
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, pContext->mRingFd, 0);
+    if (base == MAP_FAILED) {
+        ALOGE("Visualizer_allocRing() mmap() failed %d", errno);
+        close(pContext->mRingFd);
+        pContext->mRingFd = -1;
+        return -ENOMEM;
+    }
+    // the existing mapping stays writable, later ones can only be read-only
+    if (ashmem_set_prot_region(pContext->mRingFd, PROT_READ) < 0) {
+        ALOGW("Visualizer_allocRing() ashmem_set_prot_region() failed %d", errno);
+    }
+    pContext->mRing = new (base) visualizer_capture_ring_t;
+    pContext->mRing->mVersion = VISUALIZER_CAPTURE_RING_VERSION;
+    pContext->mRing->mSequence.store(0, std::memory_order_relaxed);
+    return 0;
+}
+
+void Visualizer_freeRing(VisualizerContext *pContext)
+{
+    if (pContext->mRing != NULL) {
+        munmap(pContext->mRing, sizeof(visualizer_capture_ring_t));
+        pContext->mRing = NULL;
+    }
+    if (pContext->mRingFd >= 0) {
+        close(pContext->mRingFd);
+        pContext->mRingFd = -1;
+    }
 }
 
 //----------------------------------------------------------------------------
@@ -216,12 +299,9 @@ int Visualizer_init(VisualizerContext *pContext)
             audio_channel_count_from_out_mask(pContext->mConfig.inputCfg.channels);
     pContext->mMeasurementMode = MEASUREMENT_MODE_NONE;
     pContext->mMeasurementWindowSizeInBuffers = MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS;
-    pContext->mMeasurementBufferIdx = 0;
-    for (uint32_t i=0 ; i<pContext->mMeasurementWindowSizeInBuffers ; i++) {
-        pContext->mPastMeasurements[i].mIsValid = false;
-        pContext->mPastMeasurements[i].mPeakU16 = 0;
-        pContext->mPastMeasurements[i].mRmsSquared = 0;
-    }
+    Visualizer_beginRingUpdate(pContext);
+    Visualizer_clearMeasurements(pContext);
+    Visualizer_endRingUpdate(pContext);
 
     Visualizer_setConfig(pContext, &pContext->mConfig);
 
@@ -250,10 +330,15 @@ int VisualizerLib_Create(const effect_uuid_t *uuid,
 
     pContext->mItfe = &gVisualizerInterface;
     pContext->mState = VISUALIZER_STATE_UNINITIALIZED;
+    pContext->mRing = NULL;
 
-    ret = Visualizer_init(pContext);
+    ret = Visualizer_allocRing(pContext);
+    if (ret == 0) {
+        ret = Visualizer_init(pContext);
+    }
     if (ret < 0) {
         ALOGW("VisualizerLib_Create() init failed");
+        Visualizer_freeRing(pContext);
         delete pContext;
         return ret;
     }
@@ -276,6 +361,7 @@ int VisualizerLib_Release(effect_handle_t handle) {
         return -EINVAL;
     }
     pContext->mState = VISUALIZER_STATE_UNINITIALIZED;
+    Visualizer_freeRing(pContext);
     delete pContext;
 
     return 0;
@@ -324,6 +410,8 @@ int Visualizer_process(
         return -EINVAL;
     }
 
+    Visualizer_beginRingUpdate(pContext);
+
     // perform measurements if needed
     if (pContext->mMeasurementMode & MEASUREMENT_MODE_PEAK_RMS) {
         // find the peak and RMS squared for the new buffer
@@ -339,12 +427,12 @@ int Visualizer_process(
             rmsSqAcc += (inBuffer->s16[inIdx] * inBuffer->s16[inIdx]);
         }
         // store the measurement
-        pContext->mPastMeasurements[pContext->mMeasurementBufferIdx].mPeakU16 = (uint16_t)maxSample;
-        pContext->mPastMeasurements[pContext->mMeasurementBufferIdx].mRmsSquared =
-                rmsSqAcc / (inBuffer->frameCount * pContext->mChannelCount);
-        pContext->mPastMeasurements[pContext->mMeasurementBufferIdx].mIsValid = true;
-        if (++pContext->mMeasurementBufferIdx >= pContext->mMeasurementWindowSizeInBuffers) {
-            pContext->mMeasurementBufferIdx = 0;
+        visualizer_capture_block_t *block = &pContext->mRing->mBlocks[pContext->mRing->mBlockIdx];
+        block->mPeakU16 = (uint16_t)maxSample;
+        block->mRmsSquared = rmsSqAcc / (inBuffer->frameCount * pContext->mChannelCount);
+        block->mIsValid = true;
+        if (++pContext->mRing->mBlockIdx >= pContext->mMeasurementWindowSizeInBuffers) {
+            pContext->mRing->mBlockIdx = 0;
         }
     }
 
@@ -378,8 +466,8 @@ int Visualizer_process(
 
     uint32_t captIdx;
     uint32_t inIdx;
-    uint8_t *buf = pContext->mCaptureBuf;
-    for (inIdx = 0, captIdx = pContext->mCaptureIdx;
+    uint8_t *buf = pContext->mRing->mCaptureBuf;
+    for (inIdx = 0, captIdx = pContext->mRing->mCaptureIdx;
          inIdx < inBuffer->frameCount;
          inIdx++, captIdx++) {
         if (captIdx >= CAPTURE_BUF_SIZE) {
@@ -391,13 +479,15 @@ int Visualizer_process(
         buf[captIdx] = ((uint8_t)smp)^0x80;
     }
 
-    // XXX the following two should really be atomic, though it probably doesn't
-    // matter much for visualization purposes
-    pContext->mCaptureIdx = captIdx;
+    pContext->mRing->mCaptureIdx = captIdx;
     // update last buffer update time stamp
     if (clock_gettime(CLOCK_MONOTONIC, &pContext->mBufferUpdateTime) < 0) {
         pContext->mBufferUpdateTime.tv_sec = 0;
+        pContext->mRing->mUpdateTimeMs = 0;
+    } else {
+        pContext->mRing->mUpdateTimeMs = Visualizer_timeMs(&pContext->mBufferUpdateTime);
     }
+    Visualizer_endRingUpdate(pContext);
 
     if (inBuffer->raw != outBuffer->raw) {
         if (pContext->mConfig.outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE) {
@@ -572,11 +662,14 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
 
             // if audio framework has stopped playing audio although the effect is still
             // active we must clear the capture buffer to return silence
-            if ((pContext->mLastCaptureIdx == pContext->mCaptureIdx) &&
+            if ((pContext->mLastCaptureIdx == pContext->mRing->mCaptureIdx) &&
                     (pContext->mBufferUpdateTime.tv_sec != 0) &&
                     (deltaMs > MAX_STALL_TIME_MS)) {
                     ALOGV("capture going to idle");
                     pContext->mBufferUpdateTime.tv_sec = 0;
+                    Visualizer_beginRingUpdate(pContext);
+                    pContext->mRing->mUpdateTimeMs = 0;
+                    Visualizer_endRingUpdate(pContext);
                     memset(pReplyData, 0x80, captureSize);
             } else {
                 int32_t latencyMs = pContext->mLatency;
@@ -594,7 +687,7 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
                     deltaSmpl = CAPTURE_BUF_SIZE;
                 }
 
-                int32_t capturePoint = pContext->mCaptureIdx - deltaSmpl;
+                int32_t capturePoint = pContext->mRing->mCaptureIdx - deltaSmpl;
                 // a negative capturePoint means we wrap the buffer.
                 if (capturePoint < 0) {
                     uint32_t size = -capturePoint;
@@ -602,18 +695,18 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
                         size = captureSize;
                     }
                     memcpy(pReplyData,
-                           pContext->mCaptureBuf + CAPTURE_BUF_SIZE + capturePoint,
+                           pContext->mRing->mCaptureBuf + CAPTURE_BUF_SIZE + capturePoint,
                            size);
                     pReplyData = (char *)pReplyData + size;
                     captureSize -= size;
                     capturePoint = 0;
                 }
                 memcpy(pReplyData,
-                       pContext->mCaptureBuf + capturePoint,
+                       pContext->mRing->mCaptureBuf + capturePoint,
                        captureSize);
             }
 
-            pContext->mLastCaptureIdx = pContext->mCaptureIdx;
+            pContext->mLastCaptureIdx = pContext->mRing->mCaptureIdx;
         } else {
             memset(pReplyData, 0x80, captureSize);
         }
@@ -642,22 +735,20 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
         const int32_t delayMs = Visualizer_getDeltaTimeMsFromUpdatedTime(pContext);
         if (delayMs > DISCARD_MEASUREMENTS_TIME_MS) {
             ALOGV("Discarding measurements, last measurement is %" PRId32 "ms old", delayMs);
-            for (uint32_t i=0 ; i<pContext->mMeasurementWindowSizeInBuffers ; i++) {
-                pContext->mPastMeasurements[i].mIsValid = false;
-                pContext->mPastMeasurements[i].mPeakU16 = 0;
-                pContext->mPastMeasurements[i].mRmsSquared = 0;
-            }
-            pContext->mMeasurementBufferIdx = 0;
+            Visualizer_beginRingUpdate(pContext);
+            Visualizer_clearMeasurements(pContext);
+            Visualizer_endRingUpdate(pContext);
         } else {
             // only use actual measurements, otherwise the first RMS measure happening before
             // MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS have been played will always be artificially
             // low
             for (uint32_t i=0 ; i < pContext->mMeasurementWindowSizeInBuffers ; i++) {
-                if (pContext->mPastMeasurements[i].mIsValid) {
-                    if (pContext->mPastMeasurements[i].mPeakU16 > peakU16) {
-                        peakU16 = pContext->mPastMeasurements[i].mPeakU16;
+                const visualizer_capture_block_t *block = &pContext->mRing->mBlocks[i];
+                if (block->mIsValid) {
+                    if (block->mPeakU16 > peakU16) {
+                        peakU16 = block->mPeakU16;
                     }
-                    sumRmsSquared += pContext->mPastMeasurements[i].mRmsSquared;
+                    sumRmsSquared += block->mRmsSquared;
                     nbValidMeasurements++;
                 }
             }
@@ -681,6 +772,16 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
         }
         break;
 
+    case VISUALIZER_CMD_GET_CAPTURE_RING: {
+        if (pReplyData == NULL || replySize == NULL ||
+                *replySize != sizeof(visualizer_capture_ring_info_t)) {
+            return -EINVAL;
+        }
+        visualizer_capture_ring_info_t *info = (visualizer_capture_ring_info_t *)pReplyData;
+        info->mFd = pContext->mRingFd;
+        info->mSize = sizeof(visualizer_capture_ring_t);
+        } break;
+
     default:
         ALOGW("Visualizer_command invalid command %" PRIu32, cmdCode);
         return -EINVAL;
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_VISUALIZER_CAPTURE_RING_H
+#define ANDROID_VISUALIZER_CAPTURE_RING_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include <audio_effects/effect_visualizer.h>
+
+// The capture ring of a Visualizer is the memory where the effect writes the waveform
+// and the peak and RMS of each buffer it processes. It is in shared memory, which can only be
+// mapped read-only by other processes, so that readers can follow the output without sending
+// a command for each capture or measurement.
+//
+// There is a single writer, the effect, which never blocks. Readers use the sequence number:
+//   1. load mSequence with acquire ordering, and start over if it is odd (update in progress)
+//   2. copy what is needed
+//   3. issue an acquire fence and load mSequence again, and start over if it has changed
+// A reader which always starts over may fall back to VISUALIZER_CMD_CAPTURE.
+
+#define VISUALIZER_CAPTURE_RING_VERSION 1
+
+// must be a power of 2
+#define VISUALIZER_CAPTURE_RING_SIZE 65536 // "64k should be enough for everyone"
+
+// maximum number of buffers for which we keep track of the measurements
+#define VISUALIZER_CAPTURE_RING_BLOCKS 25
+
+// Reply to VISUALIZER_CMD_GET_CAPTURE_RING
+#define VISUALIZER_CMD_GET_CAPTURE_RING (VISUALIZER_CMD_MEASURE + 1)
+
+struct visualizer_capture_ring_info_t {
+    int32_t mFd;        // ashmem file descriptor, valid in the process which hosts the effect
+    uint32_t mSize;     // size of the mapping, sizeof(visualizer_capture_ring_t)
+};
+
+struct visualizer_capture_block_t {
+    uint32_t mIsValid;
+    uint32_t mPeakU16;  // the positive peak of the absolute value of the samples in a buffer
+    float mRmsSquared;  // the average square of the samples in a buffer
+};
+
+struct visualizer_capture_ring_t {
+    uint32_t mVersion;              // VISUALIZER_CAPTURE_RING_VERSION
+    uint32_t mSampleRate;
+    std::atomic<uint32_t> mSequence; // odd while the effect updates the ring
+    uint32_t mCaptureIdx;           // index of the next sample in mCaptureBuf
+    // time of the last update in CLOCK_MONOTONIC ms, 0 when the effect has gone idle
+    uint32_t mUpdateTimeMs;
+    uint32_t mBlockIdx;             // index of the next measurement in mBlocks
+    visualizer_capture_block_t mBlocks[VISUALIZER_CAPTURE_RING_BLOCKS];
+    // unsigned 8 bit mono waveform, as returned by VISUALIZER_CMD_CAPTURE
+    uint8_t mCaptureBuf[VISUALIZER_CAPTURE_RING_SIZE];
+};
+
+#endif // ANDROID_VISUALIZER_CAPTURE_RING_H
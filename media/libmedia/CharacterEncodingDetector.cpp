@@ -31,13 +31,8 @@
 namespace android {
 
 CharacterEncodingDetector::CharacterEncodingDetector() {
-
-    UErrorCode status = U_ZERO_ERROR;
-    mUtf8Conv = ucnv_open("UTF-8", &status);
-    if (U_FAILURE(status)) {
-        ALOGE("could not create UConverter for UTF-8");
-        mUtf8Conv = NULL;
-    }
+    // the UTF-8 converter is opened on first use, since most tags need no conversion
+    mUtf8Conv = NULL;
 }
 
 CharacterEncodingDetector::~CharacterEncodingDetector() {
@@ -72,12 +67,82 @@ static bool isPrintableAscii(const char *value, size_t len) {
     return true;
 }
 
+// true if value is well-formed UTF-8 (which includes ASCII) without control characters
+static bool isPrintableUtf8(const char *value, size_t len) {
+    const uint8_t *s = (const uint8_t *)value;
+    size_t i = 0;
+    while (i < len) {
+        uint8_t c = s[i];
+        if (c < 0x80) {
+            if (c < 0x20 || c == 0x7f) {
+                return false;
+            }
+            i++;
+            continue;
+        }
+        size_t count;
+        uint32_t min;
+        uint32_t codepoint;
+        if ((c & 0xe0) == 0xc0) {
+            count = 1;
+            min = 0x80;
+            codepoint = c & 0x1f;
+        } else if ((c & 0xf0) == 0xe0) {
+            count = 2;
+            min = 0x800;
+            codepoint = c & 0x0f;
+        } else if ((c & 0xf8) == 0xf0) {
+            count = 3;
+            min = 0x10000;
+            codepoint = c & 0x07;
+        } else {
+            return false;
+        }
+        if (len - i <= count) {
+            return false;
+        }
+        for (size_t j = 1; j <= count; j++) {
+            if ((s[i + j] & 0xc0) != 0x80) {
+                return false;
+            }
+            codepoint = (codepoint << 6) | (s[i + j] & 0x3f);
+        }
+        // reject overlong forms, surrogates, out of range code points and C1 controls
+        if (codepoint < min || codepoint > 0x10ffff
+                || (codepoint >= 0xd800 && codepoint <= 0xdfff)
+                || codepoint <= 0x9f) {
+            return false;
+        }
+        i += count + 1;
+    }
+    return true;
+}
+
 void CharacterEncodingDetector::detectAndConvert() {
 
     int size = mNames.size();
     ALOGV("%d tags before conversion", size);
+    bool allUtf8 = true;
     for (int i = 0; i < size; i++) {
-        ALOGV("%s: %s", mNames.getEntry(i), mValues.getEntry(i));
+        const char *value = mValues.getEntry(i);
+        ALOGV("%s: %s", mNames.getEntry(i), value);
+        if (allUtf8 && !isPrintableUtf8(value, strlen(value))) {
+            allUtf8 = false;
+        }
+    }
+
+    if (allUtf8) {
+        // Nothing to convert: skip charset detection altogether, which is what dominates the
+        // cost of scanning files with ASCII or UTF-8 tags.
+        ALOGV("all tags are ASCII or UTF-8");
+        size = 0;
+    } else if (size && mUtf8Conv == NULL) {
+        UErrorCode status = U_ZERO_ERROR;
+        mUtf8Conv = ucnv_open("UTF-8", &status);
+        if (U_FAILURE(status)) {
+            ALOGE("could not create UConverter for UTF-8");
+            mUtf8Conv = NULL;
+        }
     }
 
     if (size && mUtf8Conv) {
@@ -252,16 +317,16 @@ void CharacterEncodingDetector::detectAndConvert() {
             }
         }
 
-        for (int i = size - 1; i >= 0; --i) {
-            if (strlen(mValues.getEntry(i)) == 0) {
-                ALOGV("erasing %s because entry is empty", mNames.getEntry(i));
-                mNames.erase(i);
-                mValues.erase(i);
-            }
-        }
-
         ucsdet_close(csd);
     }
+
+    for (int i = mNames.size() - 1; i >= 0; --i) {
+        if (strlen(mValues.getEntry(i)) == 0) {
+            ALOGV("erasing %s because entry is empty", mNames.getEntry(i));
+            mNames.erase(i);
+            mValues.erase(i);
+        }
+    }
 }
 
 /*
@@ -36,8 +36,49 @@ enum {
     GET_FLAGS,
     TO_STRING,
     DRM_INITIALIZATION,
+    READ_RANGES_AT,
 };
 
+static bool checkRanges(const sp<IMemory> &memory, const size_t *sizes, size_t count) {
+    if (memory == NULL || count > IDataSource::kMaxRanges) {
+        return false;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (sizes[i] > memory->size() - total) {
+            return false;
+        }
+        total += sizes[i];
+    }
+    return true;
+}
+
+status_t IDataSource::readRangesAt(
+        const off64_t *offsets, const size_t *sizes, size_t count, ssize_t *results) {
+    sp<IMemory> memory = getIMemory();
+    if (!checkRanges(memory, sizes, count)) {
+        return BAD_VALUE;
+    }
+
+    size_t end = 0;
+    for (size_t i = 0; i < count; ++i) {
+        end += sizes[i];
+    }
+
+    // readAt() reads to the start of the memory. Going backwards, moving
+    // each range to its place only overwrites memory below the ranges that
+    // are in place already.
+    for (size_t i = count; i-- > 0;) {
+        end -= sizes[i];
+        results[i] = readAt(offsets[i], sizes[i]);
+        if (results[i] > 0 && end > 0) {
+            uint8_t *base = (uint8_t *)memory->pointer();
+            memmove(base + end, base, results[i]);
+        }
+    }
+    return OK;
+}
+
 struct BpDataSource : public BpInterface<IDataSource> {
     explicit BpDataSource(const sp<IBinder>& impl)
         : BpInterface<IDataSource>(impl) {}
@@ -67,6 +108,28 @@ struct BpDataSource : public BpInterface<IDataSource> {
         return (ssize_t)value;
     }
 
+    virtual status_t readRangesAt(
+            const off64_t *offsets, const size_t *sizes, size_t count, ssize_t *results) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IDataSource::getInterfaceDescriptor());
+        data.writeUint32(count);
+        for (size_t i = 0; i < count; ++i) {
+            data.writeInt64(offsets[i]);
+            data.writeInt64(sizes[i]);
+        }
+        status_t err = remote()->transact(READ_RANGES_AT, data, &reply);
+        if (err != OK) {
+            return err;
+        }
+        err = reply.readInt32();
+        for (size_t i = 0; err == OK && i < count; ++i) {
+            int64_t value = 0;
+            err = reply.readInt64(&value);
+            results[i] = (ssize_t)value;
+        }
+        return err;
+    }
+
     virtual status_t getSize(off64_t* size) {
         Parcel data, reply;
         data.writeInterfaceToken(IDataSource::getInterfaceDescriptor());
@@ -155,6 +218,28 @@ status_t BnDataSource::onTransact(
             reply->writeInt64(readAt(offset, size));
             return NO_ERROR;
         } break;
+        case READ_RANGES_AT: {
+            CHECK_INTERFACE(IDataSource, data, reply);
+            uint32_t count = data.readUint32();
+            if (count > kMaxRanges) {
+                reply->writeInt32(BAD_VALUE);
+                return NO_ERROR;
+            }
+            off64_t offsets[kMaxRanges];
+            size_t sizes[kMaxRanges];
+            ssize_t results[kMaxRanges];
+            for (uint32_t i = 0; i < count; ++i) {
+                offsets[i] = (off64_t) data.readInt64();
+                sizes[i] = (size_t) data.readInt64();
+            }
+            status_t err = checkRanges(getIMemory(), sizes, count)
+                    ? readRangesAt(offsets, sizes, count, results) : BAD_VALUE;
+            reply->writeInt32(err);
+            for (uint32_t i = 0; err == OK && i < count; ++i) {
+                reply->writeInt64(results[i]);
+            }
+            return NO_ERROR;
+        } break;
         case GET_SIZE: {
             CHECK_INTERFACE(IDataSource, data, reply);
             off64_t size;
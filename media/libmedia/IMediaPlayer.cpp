@@ -75,6 +75,7 @@ enum {
     // Modular DRM
     PREPARE_DRM,
     RELEASE_DRM,
+    PREPARE_AHEAD,
 };
 
 // ModDrm helpers
@@ -200,6 +201,14 @@ public:
         return reply.readInt32();
     }
 
+    status_t prepareAhead()
+    {
+        Parcel data, reply;
+        data.writeInterfaceToken(IMediaPlayer::getInterfaceDescriptor());
+        remote()->transact(PREPARE_AHEAD, data, &reply);
+        return reply.readInt32();
+    }
+
     status_t start()
     {
         Parcel data, reply;
@@ -646,6 +655,11 @@ status_t BnMediaPlayer::onTransact(
             reply->writeInt32(prepareAsync());
             return NO_ERROR;
         } break;
+        case PREPARE_AHEAD: {
+            CHECK_INTERFACE(IMediaPlayer, data, reply);
+            reply->writeInt32(prepareAhead());
+            return NO_ERROR;
+        } break;
         case START: {
             CHECK_INTERFACE(IMediaPlayer, data, reply);
             reply->writeInt32(start());
@@ -388,6 +388,24 @@ status_t BnMediaSource::onTransact(
                         }
                     }
                 }
+                if (transferBuf == nullptr && length > 0 && length <= kRingBufferSize) {
+                    if (mRing == nullptr) {
+                        mRing.reset(new MediaBufferGroup(
+                                kRingBuffers, kRingBufferSize, kRingBuffers /* growthLimit */));
+                    }
+                    // Never blocks; the buffer goes inline if the client holds the whole ring.
+                    if (mRing->acquire_buffer(
+                            &transferBuf, true /* nonBlocking */, length) == OK) {
+                        if (transferBuf->mMemory != nullptr) {
+                            ALOGV("Use ring buffer: %zu", length);
+                            memcpy(transferBuf->data(), (uint8_t*)buf->data() + offset, length);
+                            offset = 0;
+                        } else {
+                            transferBuf->release();
+                            transferBuf = nullptr;
+                        }
+                    }
+                }
                 if (transferBuf != nullptr) { // Using shared buffers.
                     if (!transferBuf->isObserved() && transferBuf != buf) {
                         // Transfer buffer must be part of a MediaBufferGroup.
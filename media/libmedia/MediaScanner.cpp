@@ -106,6 +106,15 @@ MediaScanResult MediaScanner::processDirectory(
     return result;
 }
 
+MediaScanResult MediaScanner::processFiles(
+        const Vector<String8> &paths, MediaScannerClient &client,
+        size_t /* maxConcurrency */, Vector<MediaScanResult> *results) {
+    for (size_t i = 0; i < paths.size(); ++i) {
+        results->push_back(processFile(paths[i].string(), NULL /* mimeType */, client));
+    }
+    return MEDIA_SCAN_RESULT_OK;
+}
+
 bool MediaScanner::shouldSkipDirectory(char *path) {
     if (path && mSkipList && mSkipIndex) {
         int len = strlen(path);
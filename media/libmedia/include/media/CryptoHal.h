@@ -25,6 +25,8 @@
 #include <utils/KeyedVector.h>
 #include <utils/threads.h>
 
+#include <vector>
+
 using ::android::hardware::drm::V1_0::ICryptoFactory;
 using ::android::hardware::drm::V1_0::ICryptoPlugin;
 using ::android::hardware::drm::V1_0::SharedBuffer;
@@ -83,6 +85,9 @@ private:
     uint32_t mNextBufferId;
     int32_t mHeapSeqNum;
 
+    // Subsample table passed to the plugin, reused across decrypt calls
+    std::vector<::android::hardware::drm::V1_0::SubSample> mSubSamples;
+
     Vector<sp<ICryptoFactory>> makeCryptoFactories();
     sp<ICryptoPlugin> makeCryptoPlugin(const sp<ICryptoFactory>& factory,
             const uint8_t uuid[16], const void *initData, size_t size);
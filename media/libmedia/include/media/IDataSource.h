@@ -32,12 +32,25 @@ class IDataSource : public IInterface {
 public:
     DECLARE_META_INTERFACE(DataSource);
 
+    enum {
+        // The most ranges readRangesAt() reads in one call.
+        kMaxRanges = 8,
+    };
+
     // Get the memory that readAt writes into.
     virtual sp<IMemory> getIMemory() = 0;
     // Read up to |size| bytes into the memory returned by getIMemory(). Returns
     // the number of bytes read, or -1 on error. |size| must not be larger than
     // the buffer.
     virtual ssize_t readAt(off64_t offset, size_t size) = 0;
+    // Reads up to |sizes[i]| bytes at |offsets[i]| for each of the |count|
+    // ranges, into consecutive parts of the memory returned by getIMemory():
+    // range i starts at the sum of |sizes| before it. |results[i]| receives
+    // what readAt() would have returned for range i. The |sizes| must add up
+    // to no more than the buffer, and |count| must not exceed kMaxRanges.
+    // The default implementation calls readAt() for each range.
+    virtual status_t readRangesAt(
+            const off64_t *offsets, const size_t *sizes, size_t count, ssize_t *results);
     // Get the size, or -1 if the size is unknown.
     virtual status_t getSize(off64_t* size) = 0;
     // This should be called before deleting |this|. The other methods may
@@ -43,6 +43,10 @@ public:
     virtual status_t        setDataSource(int fd, int64_t offset, int64_t length) = 0;
     virtual status_t        setDataSource(const sp<IDataSource>& dataSource) = 0;
     virtual sp<IMemory>     getFrameAtTime(int64_t timeUs, int option) = 0;
+    // Returns the frames at |timesUs|, in that order, laid out back to back as
+    // a VideoFrame followed by its pixels, each starting at an 8 byte boundary.
+    // A frame that could not be extracted has mSize 0.
+    virtual sp<IMemory>     getFramesAtTimes(const Vector<int64_t> &timesUs, int option) = 0;
     virtual sp<IMemory>     extractAlbumArt() = 0;
     virtual const char*     extractMetadata(int keyCode) = 0;
 };
@@ -65,6 +65,8 @@ public:
                                     BufferingSettings* buffering /* nonnull */) = 0;
     virtual status_t        setBufferingSettings(const BufferingSettings& buffering) = 0;
     virtual status_t        prepareAsync() = 0;
+    // Starts preparing ahead of prepareAsync(), without notifying the client.
+    virtual status_t        prepareAhead() = 0;
     virtual status_t        start() = 0;
     virtual status_t        stop() = 0;
     virtual status_t        pause() = 0;
@@ -185,6 +185,8 @@ public:
     static const size_t kTransferSharedAsSharedThreshold = 4 * 1024;  // if >= shared, else inline
     static const size_t kTransferInlineAsSharedThreshold = 64 * 1024; // if >= shared, else inline
     static const size_t kInlineMaxTransfer = 256 * 1024; // Binder size limited to BINDER_VM_SIZE.
+    static const size_t kRingBuffers = 32;          // shared buffers kept for small transfers
+    static const size_t kRingBufferSize = 16 * 1024; // if <= copied to the ring, else as above
 
 protected:
     virtual ~BnMediaSource();
@@ -194,6 +196,12 @@ private:
 
     std::unique_ptr<MediaBufferGroup> mGroup;
 
+    // Shared buffers carved from one heap that stay mapped by the client for the life of the
+    // source. Buffers that would otherwise be copied into the reply are copied here instead, so
+    // that once each buffer of the ring has been sent, a batch only carries descriptors. A buffer
+    // of the ring is free again when the client has released its reference to it.
+    std::unique_ptr<MediaBufferGroup> mRing;
+
     // To prevent marshalling IMemory with each read transaction, we cache the IMemory pointer
     // into a map.
     //
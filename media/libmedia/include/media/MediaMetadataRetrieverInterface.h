@@ -43,6 +43,16 @@ public:
     virtual status_t    setDataSource(int fd, int64_t offset, int64_t length) = 0;
     virtual status_t setDataSource(const sp<DataSource>& source) = 0;
     virtual VideoFrame* getFrameAtTime(int64_t timeUs, int option) = 0;
+    // Fills |frames| with the frames at |timesUs|, in that order, or NULL for
+    // those that could not be extracted. The caller owns the frames.
+    virtual status_t getFramesAtTimes(
+            const Vector<int64_t> &timesUs, int option, Vector<VideoFrame *> *frames) {
+        frames->clear();
+        for (size_t i = 0; i < timesUs.size(); ++i) {
+            frames->push_back(getFrameAtTime(timesUs[i], option));
+        }
+        return OK;
+    }
     virtual MediaAlbumArt* extractAlbumArt() = 0;
     virtual const char* extractMetadata(int keyCode) = 0;
 };
@@ -109,6 +109,8 @@ private:
     bool                 mIsLegacyDownmix;  // legacy stereo to mono conversion needed
     bool                 mIsLegacyUpmix;    // legacy mono to stereo conversion needed
     bool                 mRequiresFloat;    // data processing requires float (e.g. resampler)
+    bool                 mIsFusedLegacyMix; // legacy conversion done in one pass on 16 bit data
+    bool                 mIsFusedRemap;     // channel mask and format converted in one pass
     PassthruBufferProvider *mInputConverterProvider;    // converts input to float
     int8_t               mIdxAry[sizeof(uint32_t) * 8]; // used for channel mask conversion
 };
@@ -230,6 +230,11 @@ public:
             status_t        setBufferingSettings(const BufferingSettings& buffering);
             status_t        prepare();
             status_t        prepareAsync();
+            // Lets the player prepare in the background, e.g. for the next
+            // item of a playlist. The player stays initialized, and prepare()
+            // or prepareAsync() must still be called; they complete as soon as
+            // the background preparation is done.
+            status_t        prepareAhead();
             status_t        start();
             status_t        stop();
             status_t        pause();
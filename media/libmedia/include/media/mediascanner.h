@@ -22,6 +22,7 @@
 #include <utils/List.h>
 #include <utils/Errors.h>
 #include <utils/String8.h>
+#include <utils/Vector.h>
 #include <pthread.h>
 
 struct dirent;
@@ -78,6 +79,15 @@ struct MediaScanner {
     virtual MediaScanResult processDirectory(
             const char *path, MediaScannerClient &client);
 
+    // Scans each of |paths| as processFile() does, and appends the result
+    // for each to |results|. The client is called from the calling thread
+    // only, for one file at a time and in the order of |paths|. Up to
+    // |maxConcurrency| files may be read at a time. Returns
+    // MEDIA_SCAN_RESULT_ERROR if the scan could not be carried out.
+    virtual MediaScanResult processFiles(
+            const Vector<String8> &paths, MediaScannerClient &client,
+            size_t maxConcurrency, Vector<MediaScanResult> *results);
+
     void setLocale(const char *locale);
 
     virtual MediaAlbumArt *extractAlbumArt(int fd) = 0;
@@ -152,6 +152,17 @@ sp<IMemory> MediaMetadataRetriever::getFrameAtTime(int64_t timeUs, int option)
     return mRetriever->getFrameAtTime(timeUs, option);
 }
 
+sp<IMemory> MediaMetadataRetriever::getFramesAtTimes(const Vector<int64_t> &timesUs, int option)
+{
+    ALOGV("getFramesAtTimes: %zu frames option(%d)", timesUs.size(), option);
+    Mutex::Autolock _l(mLock);
+    if (mRetriever == 0) {
+        ALOGE("retriever is not initialized");
+        return NULL;
+    }
+    return mRetriever->getFramesAtTimes(timesUs, option);
+}
+
 const char* MediaMetadataRetriever::extractMetadata(int keyCode)
 {
     ALOGV("extractMetadata(%d)", keyCode);
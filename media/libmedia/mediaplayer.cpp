@@ -337,6 +337,17 @@ status_t MediaPlayer::prepareAsync()
     return prepareAsync_l();
 }
 
+status_t MediaPlayer::prepareAhead()
+{
+    ALOGV("prepareAhead");
+    Mutex::Autolock _l(mLock);
+    if ((mPlayer != 0) && (mCurrentState & MEDIA_PLAYER_INITIALIZED)) {
+        return mPlayer->prepareAhead();
+    }
+    ALOGE("prepareAhead called in state %d, mPlayer(%p)", mCurrentState, mPlayer.get());
+    return INVALID_OPERATION;
+}
+
 status_t MediaPlayer::start()
 {
     ALOGV("start");
@@ -41,8 +41,12 @@ namespace android {
 enum {
     GENERATE_UNIQUE_SESSIONID = IBinder::FIRST_CALL_TRANSACTION,
     SUBMIT_ITEM,
+    SUBMIT_ITEMS,
 };
 
+// bounds a batch, so a bad parcel can't make us allocate without limit
+static const int32_t kMaxBatchItems = 256;
+
 class BpMediaAnalyticsService: public BpInterface<IMediaAnalyticsService>
 {
 public:
@@ -105,6 +109,28 @@ public:
         return sessionid;
     }
 
+    virtual void submitBatch(const Vector<MediaAnalyticsItem *> &items, bool forcenew)
+    {
+        Parcel data;
+
+        if (items.size() == 0 || items.size() > (size_t) kMaxBatchItems) {
+            ALOGW("not submitting a batch of %zu records", items.size());
+            return;
+        }
+
+        data.writeInterfaceToken(IMediaAnalyticsService::getInterfaceDescriptor());
+        data.writeBool(forcenew);
+        data.writeInt32(items.size());
+        for (size_t i = 0; i < items.size(); i++) {
+            if(DEBUGGING_FLOW) {
+                ALOGD("client offers record: %s", items[i]->toString().c_str());
+            }
+            items[i]->writeToParcel(&data);
+        }
+
+        remote()->transact(SUBMIT_ITEMS, data, NULL, IBinder::FLAG_ONEWAY);
+    }
+
 };
 
 IMPLEMENT_META_INTERFACE(MediaAnalyticsService, "android.media.IMediaAnalyticsService");
@@ -155,6 +181,37 @@ status_t BnMediaAnalyticsService::onTransact(
             return NO_ERROR;
         } break;
 
+        case SUBMIT_ITEMS: {
+            CHECK_INTERFACE(IMediaAnalyticsService, data, reply);
+
+            bool forcenew;
+            int32_t count;
+
+            data.readBool(&forcenew);
+            count = data.readInt32();
+            if (count <= 0 || count > kMaxBatchItems) {
+                ALOGW("bad batch of %d records from pid %d", count, clientPid);
+                return BAD_VALUE;
+            }
+
+            Vector<MediaAnalyticsItem *> items;
+            for (int32_t i = 0; i < count; i++) {
+                MediaAnalyticsItem *item = new MediaAnalyticsItem;
+                if (item->readFromParcel(data) != 0) {
+                    // the rest of the parcel can't be trusted
+                    delete item;
+                    break;
+                }
+                item->setPid(clientPid);
+                items.push_back(item);
+            }
+
+            // submitBatch() takes over ownership of the items
+            submitBatch(items, forcenew);
+
+            return NO_ERROR;
+        } break;
+
         default:
             return BBinder::onTransact(code, data, reply, flags);
     }
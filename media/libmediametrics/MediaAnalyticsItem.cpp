@@ -573,27 +573,47 @@ int32_t MediaAnalyticsItem::readFromParcel(const Parcel& data) {
     mTimestamp = data.readInt64();
 
     int count = data.readInt32();
+    // each attribute takes at least a prefix length, a name and a type
+    if (count < 0 || (size_t) count > data.dataAvail() / (3 * sizeof(int32_t))) {
+        ALOGE("reading bad attribute count: %d", count);
+        return -1;
+    }
+    // make room for all of them at once
+    if (mPropCount + count > mPropSize) {
+        growProps(mPropCount + count - mPropSize);
+    }
+
+    // attribute names are sent as the length of the prefix they share
+    // with the previous name, followed by the rest of the name.
+    AString attr;
     for (int i = 0; i < count ; i++) {
-            MediaAnalyticsItem::Attr attr = data.readCString();
+            int32_t shared = data.readInt32();
+            const char *suffix = data.readCString();
+            if (shared < 0 || (size_t) shared > attr.size() || suffix == NULL) {
+                ALOGE("reading bad attribute name, idx %d", i);
+                return -1;
+            }
+            attr.erase(shared, attr.size() - shared);
+            attr.append(suffix);
             int32_t ztype = data.readInt32();
                 switch (ztype) {
                     case MediaAnalyticsItem::kTypeInt32:
-                            setInt32(attr, data.readInt32());
+                            setInt32(attr.c_str(), data.readInt32());
                             break;
                     case MediaAnalyticsItem::kTypeInt64:
-                            setInt64(attr, data.readInt64());
+                            setInt64(attr.c_str(), data.readInt64());
                             break;
                     case MediaAnalyticsItem::kTypeDouble:
-                            setDouble(attr, data.readDouble());
+                            setDouble(attr.c_str(), data.readDouble());
                             break;
                     case MediaAnalyticsItem::kTypeCString:
-                            setCString(attr, data.readCString());
+                            setCString(attr.c_str(), data.readCString());
                             break;
                     case MediaAnalyticsItem::kTypeRate:
                             {
                                 int64_t count = data.readInt64();
                                 int64_t duration = data.readInt64();
-                                setRate(attr, count, duration);
+                                setRate(attr.c_str(), count, duration);
                             }
                             break;
                     default:
@@ -616,11 +636,24 @@ int32_t MediaAnalyticsItem::writeToParcel(Parcel *data) {
     data->writeInt64(mTimestamp);
 
     // set of items
+    // names within a record mostly share a long prefix (e.g.
+    // "android.media.mediacodec."), so only send what differs from
+    // the previous name.
     int count = mPropCount;
     data->writeInt32(count);
+    const char *prevName = "";
+    size_t prevLen = 0;
     for (int i = 0 ; i < count; i++ ) {
             Prop *prop = &mProps[i];
-            data->writeCString(prop->mName);
+            size_t shared = 0;
+            while (shared < prevLen && shared < prop->mNameLen
+                    && prevName[shared] == prop->mName[shared]) {
+                shared++;
+            }
+            data->writeInt32(shared);
+            data->writeCString(prop->mName + shared);
+            prevName = prop->mName;
+            prevLen = prop->mNameLen;
             data->writeInt32(prop->mType);
             switch (prop->mType) {
                 case MediaAnalyticsItem::kTypeInt32:
@@ -734,7 +767,10 @@ bool MediaAnalyticsItem::selfrecord(bool forcenew) {
     sp<IMediaAnalyticsService> svc = getInstance();
 
     if (svc != NULL) {
-        svc->submit(this, forcenew);
+        // we don't use the session id the service assigns, so don't wait for it
+        Vector<MediaAnalyticsItem *> items;
+        items.push_back(this);
+        svc->submitBatch(items, forcenew);
         return true;
     } else {
         AString p = this->toString();
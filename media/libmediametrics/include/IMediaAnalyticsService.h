@@ -26,6 +26,7 @@
 #include <utils/Log.h>
 #include <utils/RefBase.h>
 #include <utils/List.h>
+#include <utils/Vector.h>
 
 #include <binder/IServiceManager.h>
 
@@ -52,6 +53,12 @@ public:
     // caller continues to own the passed item
     virtual MediaAnalyticsItem::SessionID_t submit(MediaAnalyticsItem *item, bool forcenew) = 0;
 
+    // submit several records in one call, as submit() does for each of them.
+    // the call is one-way: it returns before the service handles the records,
+    // and no sessionIDs come back.
+    // caller continues to own the passed items
+    virtual void submitBatch(const Vector<MediaAnalyticsItem *> &items, bool forcenew) = 0;
+
 };
 
 // ----------------------------------------------------------------------------
@@ -1079,6 +1079,14 @@ status_t MediaPlayerService::Client::prepareAsync()
     return ret;
 }
 
+status_t MediaPlayerService::Client::prepareAhead()
+{
+    ALOGV("[%d] prepareAhead", mConnId);
+    sp<MediaPlayerBase> p = getPlayer();
+    if (p == 0) return UNKNOWN_ERROR;
+    return p->prepareAhead();
+}
+
 status_t MediaPlayerService::Client::start()
 {
     ALOGV("[%d] start", mConnId);
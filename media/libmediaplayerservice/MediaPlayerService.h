@@ -312,6 +312,7 @@ private:
         virtual status_t        getDefaultBufferingSettings(
                                         BufferingSettings* buffering /* nonnull */) override;
         virtual status_t        prepareAsync();
+        virtual status_t        prepareAhead();
         virtual status_t        start();
         virtual status_t        stop();
         virtual status_t        pause();
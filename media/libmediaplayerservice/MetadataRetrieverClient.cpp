@@ -236,6 +236,74 @@ sp<IMemory> MetadataRetrieverClient::getFrameAtTime(int64_t timeUs, int option)
     return mThumbnail;
 }
 
+// Bounds the shared memory a single request for a timeline strip may take.
+static const size_t kMaxFramesPerRequest = 64;
+
+static size_t alignedFrameSize(const VideoFrame *frame) {
+    size_t size = sizeof(VideoFrame) + (frame != NULL ? frame->mSize : 0);
+    return (size + 7) & ~(size_t)7;
+}
+
+sp<IMemory> MetadataRetrieverClient::getFramesAtTimes(
+        const Vector<int64_t> &timesUs, int option)
+{
+    ALOGV("getFramesAtTimes: %zu frames option(%d)", timesUs.size(), option);
+    Mutex::Autolock lock(mLock);
+    Mutex::Autolock glock(sLock);
+    mThumbnail.clear();
+    if (mRetriever == NULL) {
+        ALOGE("retriever is not initialized");
+        return NULL;
+    }
+    if (timesUs.isEmpty() || timesUs.size() > kMaxFramesPerRequest) {
+        ALOGE("cannot capture %zu video frames at once", timesUs.size());
+        return NULL;
+    }
+    Vector<VideoFrame *> frames;
+    mRetriever->getFramesAtTimes(timesUs, option, &frames);
+
+    // All frames go back in a single heap, rather than one per frame.
+    size_t size = 0;
+    size_t numFrames = 0;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        size += alignedFrameSize(frames[i]);
+        if (frames[i] != NULL) {
+            ++numFrames;
+        }
+    }
+    if (numFrames > 0) {
+        sp<MemoryHeapBase> heap = new MemoryHeapBase(size, 0, "MetadataRetrieverClient");
+        if (heap != NULL && heap->getHeapID() >= 0) {
+            mThumbnail = new MemoryBase(heap, 0, size);
+        }
+    }
+    if (mThumbnail == NULL) {
+        ALOGE("failed to capture %zu video frames", timesUs.size());
+    } else {
+        uint8_t *dst = static_cast<uint8_t *>(mThumbnail->pointer());
+        memset(dst, 0, size);
+        for (size_t i = 0; i < frames.size(); ++i) {
+            const VideoFrame *frame = frames[i];
+            if (frame != NULL) {
+                VideoFrame *frameCopy = reinterpret_cast<VideoFrame *>(dst);
+                frameCopy->mWidth = frame->mWidth;
+                frameCopy->mHeight = frame->mHeight;
+                frameCopy->mDisplayWidth = frame->mDisplayWidth;
+                frameCopy->mDisplayHeight = frame->mDisplayHeight;
+                frameCopy->mSize = frame->mSize;
+                frameCopy->mRotationAngle = frame->mRotationAngle;
+                memcpy(dst + sizeof(VideoFrame), frame->mData, frame->mSize);
+                frameCopy->mData = 0;
+            }
+            dst += alignedFrameSize(frame);
+        }
+    }
+    for (size_t i = 0; i < frames.size(); ++i) {
+        delete frames[i];
+    }
+    return mThumbnail;
+}
+
 sp<IMemory> MetadataRetrieverClient::extractAlbumArt()
 {
     ALOGV("extractAlbumArt");
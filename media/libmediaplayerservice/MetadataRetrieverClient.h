@@ -51,6 +51,7 @@ public:
     virtual status_t                setDataSource(int fd, int64_t offset, int64_t length);
     virtual status_t                setDataSource(const sp<IDataSource>& source);
     virtual sp<IMemory>             getFrameAtTime(int64_t timeUs, int option);
+    virtual sp<IMemory>             getFramesAtTimes(const Vector<int64_t> &timesUs, int option);
     virtual sp<IMemory>             extractAlbumArt();
     virtual const char*             extractMetadata(int keyCode);
 
@@ -191,6 +191,11 @@ public:
 
     virtual status_t    prepare() = 0;
     virtual status_t    prepareAsync() = 0;
+    // Starts preparing without notifying the listener. A later prepare() or
+    // prepareAsync() completes once this preparation is done.
+    virtual status_t    prepareAhead() {
+        return INVALID_OPERATION;
+    }
     virtual status_t    start() = 0;
     virtual status_t    stop() = 0;
     virtual status_t    pause() = 0;
@@ -48,6 +48,16 @@ static const int kHighWaterMarkRebufferMs = 15000;  // 15secs
 static const int kLowWaterMarkKB  = 40;
 static const int kHighWaterMarkKB = 200;
 
+// Read-ahead targets for the queued audio and video packets. A track reads ahead until it
+// holds either the high watermark in bytes or in time, and starts again once it drops below
+// both low watermarks. The byte limits keep high bitrate content from queueing too much.
+static const size_t kAudioLowWaterMarkBytes   = 64 * 1024;
+static const size_t kAudioHighWaterMarkBytes  = 256 * 1024;
+static const size_t kVideoLowWaterMarkBytes   = 2 * 1024 * 1024;
+static const size_t kVideoHighWaterMarkBytes  = 8 * 1024 * 1024;
+static const int64_t kReadAheadLowWaterMarkUs  = 500000ll;   // 0.5secs
+static const int64_t kReadAheadHighWaterMarkUs = 2000000ll;  // 2secs
+
 NuPlayer::GenericSource::GenericSource(
         const sp<AMessage> &notify,
         bool uidValid,
@@ -290,6 +300,27 @@ status_t NuPlayer::GenericSource::startSources() {
     return OK;
 }
 
+void NuPlayer::GenericSource::startTrackReader(Track *track, const char *name) {
+    if (track->mReaderLooper != NULL) {
+        return;
+    }
+    track->mReader = new TrackReader(this);
+    track->mReaderLooper = new ALooper;
+    track->mReaderLooper->setName(name);
+    track->mReaderLooper->start();
+    track->mReaderLooper->registerHandler(track->mReader);
+}
+
+void NuPlayer::GenericSource::stopTrackReader(Track *track) {
+    if (track->mReaderLooper == NULL) {
+        return;
+    }
+    track->mReaderLooper->unregisterHandler(track->mReader->id());
+    track->mReaderLooper->stop();
+    track->mReaderLooper.clear();
+    track->mReader.clear();
+}
+
 int64_t NuPlayer::GenericSource::getLastReadPosition() {
     if (mAudioTrack.mSource != NULL) {
         return mAudioTimeUs;
@@ -318,6 +349,8 @@ void NuPlayer::GenericSource::setOffloadAudio(bool offload) {
 
 NuPlayer::GenericSource::~GenericSource() {
     ALOGV("~GenericSource");
+    stopTrackReader(&mAudioTrack);
+    stopTrackReader(&mVideoTrack);
     if (mLooper != NULL) {
         mLooper->unregisterHandler(id());
         mLooper->stop();
@@ -460,6 +493,13 @@ void NuPlayer::GenericSource::finishPrepareAsync() {
         return;
     }
 
+    if (mAudioTrack.mSource != NULL) {
+        startTrackReader(&mAudioTrack, "GSAudioReader");
+    }
+    if (mVideoTrack.mSource != NULL) {
+        startTrackReader(&mVideoTrack, "GSVideoReader");
+    }
+
     if (mIsStreaming) {
         if (mBufferingMonitorLooper == NULL) {
             mBufferingMonitor->prepare(mCachedSource, mDurationUs, mBitrate,
@@ -614,12 +654,16 @@ void NuPlayer::GenericSource::onMessageReceived(const sp<AMessage> &msg) {
           }
 
 
-          if (track->mSource != NULL) {
-              track->mSource->stop();
+          {
+              // wait for any read of the old source on the track reader
+              Mutex::Autolock _l(track->mReadLock);
+              if (track->mSource != NULL) {
+                  track->mSource->stop();
+              }
+              track->mSource = source;
+              track->mSource->start();
+              track->mIndex = trackIndex;
           }
-          track->mSource = source;
-          track->mSource->start();
-          track->mIndex = trackIndex;
 
           int64_t timeUs, actualTimeUs;
           const bool formatChange = true;
@@ -876,10 +920,12 @@ status_t NuPlayer::GenericSource::dequeueAccessUnit(
 
     status_t result = track->mPackets->dequeueAccessUnit(accessUnit);
 
-    // start pulling in more buffers if we only have one (or no) buffer left
-    // so that decoder has less chance of being starved
-    if (track->mPackets->getAvailableBufferCount(&finalResult) < 2) {
-        postReadBuffer(audio? MEDIA_TRACK_TYPE_AUDIO : MEDIA_TRACK_TYPE_VIDEO);
+    // start pulling in more buffers if we only have one (or no) buffer left, or
+    // are below the read-ahead target, so that decoder has less chance of being starved
+    media_track_type trackType = audio ? MEDIA_TRACK_TYPE_AUDIO : MEDIA_TRACK_TYPE_VIDEO;
+    if (track->mPackets->getAvailableBufferCount(&finalResult) < 2
+            || isBelowWatermark(trackType, false /* high */)) {
+        postReadBuffer(trackType);
     }
 
     if (result != OK) {
@@ -1355,7 +1401,14 @@ void NuPlayer::GenericSource::postReadBuffer(media_track_type trackType) {
 
     if ((mPendingReadBufferTypes & (1 << trackType)) == 0) {
         mPendingReadBufferTypes |= (1 << trackType);
-        sp<AMessage> msg = new AMessage(kWhatReadBuffer, this);
+        // audio and video are read on their track readers, if any
+        sp<AHandler> handler = this;
+        if (trackType == MEDIA_TRACK_TYPE_AUDIO && mAudioTrack.mReader != NULL) {
+            handler = mAudioTrack.mReader;
+        } else if (trackType == MEDIA_TRACK_TYPE_VIDEO && mVideoTrack.mReader != NULL) {
+            handler = mVideoTrack.mReader;
+        }
+        sp<AMessage> msg = new AMessage(kWhatReadBuffer, handler);
         msg->setInt32("trackType", trackType);
         msg->post();
     }
@@ -1365,16 +1418,55 @@ void NuPlayer::GenericSource::onReadBuffer(const sp<AMessage>& msg) {
     int32_t tmpType;
     CHECK(msg->findInt32("trackType", &tmpType));
     media_track_type trackType = (media_track_type)tmpType;
-    readBuffer(trackType);
+    size_t numBuffers = readBuffer(trackType);
     {
         // only protect the variable change, as readBuffer may
         // take considerable time.
         Mutex::Autolock _l(mReadBufferLock);
         mPendingReadBufferTypes &= ~(1 << trackType);
     }
+
+    // keep reading ahead up to the high watermark, unless the source has nothing for us yet
+    if (numBuffers > 0 && isBelowWatermark(trackType, true /* high */)) {
+        postReadBuffer(trackType);
+    }
 }
 
-void NuPlayer::GenericSource::readBuffer(
+bool NuPlayer::GenericSource::isBelowWatermark(media_track_type trackType, bool high) {
+    if (mStopRead) {
+        return false;
+    }
+
+    Track *track;
+    size_t markBytes;
+    switch (trackType) {
+        case MEDIA_TRACK_TYPE_VIDEO:
+            track = &mVideoTrack;
+            markBytes = high ? kVideoHighWaterMarkBytes : kVideoLowWaterMarkBytes;
+            break;
+        case MEDIA_TRACK_TYPE_AUDIO:
+            track = &mAudioTrack;
+            markBytes = high ? kAudioHighWaterMarkBytes : kAudioLowWaterMarkBytes;
+            break;
+        default:
+            return false;
+    }
+    int64_t markUs = high ? kReadAheadHighWaterMarkUs : kReadAheadLowWaterMarkUs;
+
+    if (track->mSource == NULL || track->mPackets == NULL) {
+        return false;
+    }
+
+    status_t finalResult;
+    int64_t durationUs = track->mPackets->getBufferedDurationUs(&finalResult);
+    if (finalResult != OK) {
+        // reached the end of the stream or an error
+        return false;
+    }
+    return track->mPackets->getBufferedBytes() < markBytes && durationUs < markUs;
+}
+
+size_t NuPlayer::GenericSource::readBuffer(
         media_track_type trackType, int64_t seekTimeUs, MediaPlayerSeekMode mode,
         int64_t *actualTimeUs, bool formatChange) {
     // Do not read data if Widevine source is stopped
@@ -1382,7 +1474,7 @@ void NuPlayer::GenericSource::readBuffer(
     // TODO: revisit after widevine is removed.  May be able to
     // combine mStopRead with mStarted.
     if (mStopRead) {
-        return;
+        return 0;
     }
     Track *track;
     size_t maxBuffers = 1;
@@ -1405,8 +1497,10 @@ void NuPlayer::GenericSource::readBuffer(
             TRESPASS();
     }
 
+    Mutex::Autolock _l(track->mReadLock);
+
     if (track->mSource == NULL) {
-        return;
+        return 0;
     }
 
     if (actualTimeUs) {
@@ -1427,7 +1521,8 @@ void NuPlayer::GenericSource::readBuffer(
         options.setNonBlocking();
     }
 
-    for (size_t numBuffers = 0; numBuffers < maxBuffers; ) {
+    size_t numBuffers = 0;
+    while (numBuffers < maxBuffers) {
         Vector<MediaBuffer *> mediaBuffers;
         status_t err = NO_ERROR;
 
@@ -1506,6 +1601,7 @@ void NuPlayer::GenericSource::readBuffer(
             break;
         }
     }
+    return numBuffers;
 }
 
 void NuPlayer::GenericSource::queueDiscontinuityIfNeeded(
@@ -1523,6 +1619,20 @@ void NuPlayer::GenericSource::queueDiscontinuityIfNeeded(
     }
 }
 
+NuPlayer::GenericSource::TrackReader::TrackReader(GenericSource *source)
+    : mSource(source) {
+}
+
+void NuPlayer::GenericSource::TrackReader::onMessageReceived(const sp<AMessage> &msg) {
+    switch (msg->what()) {
+        case kWhatReadBuffer:
+            mSource->onReadBuffer(msg);
+            break;
+        default:
+            TRESPASS();
+    }
+}
+
 NuPlayer::GenericSource::BufferingMonitor::BufferingMonitor(const sp<AMessage> &notify)
     : mNotify(notify),
       mDurationUs(-1ll),
@@ -124,10 +124,31 @@ private:
         kWhatReleaseDrm,
     };
 
+    // Reads ahead an audio or video track on a looper of its own, so that a slow read of
+    // one track does not hold up the other.
+    struct TrackReader : public AHandler {
+    public:
+        explicit TrackReader(GenericSource *source);
+
+    protected:
+        virtual void onMessageReceived(const sp<AMessage> &msg);
+
+    private:
+        // not a reference, the source stops the reader looper before going away.
+        GenericSource *mSource;
+
+        DISALLOW_EVIL_CONSTRUCTORS(TrackReader);
+    };
+
     struct Track {
         size_t mIndex;
         sp<IMediaSource> mSource;
         sp<AnotherPacketSource> mPackets;
+
+        // serializes reads, seeks and source changes of this track
+        Mutex mReadLock;
+        sp<ALooper> mReaderLooper;
+        sp<TrackReader> mReader;
     };
 
     // Helper to monitor buffering status. The polling happens every second.
@@ -260,6 +281,8 @@ private:
     void onSecureDecodersInstantiated(status_t err);
     void finishPrepareAsync();
     status_t startSources();
+    void startTrackReader(Track *track, const char *name);
+    void stopTrackReader(Track *track);
 
     void onGetFormatMeta(const sp<AMessage>& msg) const;
     sp<MetaData> doGetFormatMeta(bool audio) const;
@@ -296,12 +319,16 @@ private:
 
     void postReadBuffer(media_track_type trackType);
     void onReadBuffer(const sp<AMessage>& msg);
+    // Returns true if the packets queued for the audio or video track |trackType| are below
+    // its low (or high) buffering watermark.
+    bool isBelowWatermark(media_track_type trackType, bool high);
     // When |mode| is MediaPlayerSeekMode::SEEK_CLOSEST, the buffer read shall
     // include an item indicating skipping rendering all buffers with timestamp
     // earlier than |seekTimeUs|.
     // For other modes, the buffer read will not include the item as above in order
     // to facilitate fast seek operation.
-    void readBuffer(
+    // Returns the number of buffers queued.
+    size_t readBuffer(
             media_track_type trackType,
             int64_t seekTimeUs = -1ll,
             MediaPlayerSeekMode mode = MediaPlayerSeekMode::SEEK_PREVIOUS_SYNC,
@@ -82,6 +82,11 @@ struct NuPlayer::SeekAction : public Action {
         player->performSeek(mSeekTimeUs, mMode);
     }
 
+    void setSeekTo(int64_t seekTimeUs, MediaPlayerSeekMode mode) {
+        mSeekTimeUs = seekTimeUs;
+        mMode = mode;
+    }
+
 private:
     int64_t mSeekTimeUs;
     MediaPlayerSeekMode mMode;
@@ -98,6 +103,10 @@ struct NuPlayer::ResumeDecoderAction : public Action {
         player->performResumeDecoders(mNeedNotify);
     }
 
+    void addNeedNotify(bool needNotify) {
+        mNeedNotify = mNeedNotify || needNotify;
+    }
+
 private:
     bool mNeedNotify;
 
@@ -1340,18 +1349,22 @@ void NuPlayer::onMessageReceived(const sp<AMessage> &msg) {
                 break;
             }
 
+            if (coalescePendingSeek(seekTimeUs, (MediaPlayerSeekMode)mode, needNotify)) {
+                break;
+            }
+
             mDeferredActions.push_back(
                     new FlushDecoderAction(FLUSH_CMD_FLUSH /* audio */,
                                            FLUSH_CMD_FLUSH /* video */));
 
-            mDeferredActions.push_back(
-                    new SeekAction(seekTimeUs, (MediaPlayerSeekMode)mode));
+            mPendingSeekAction = new SeekAction(seekTimeUs, (MediaPlayerSeekMode)mode);
+            mDeferredActions.push_back(mPendingSeekAction);
 
             // After a flush without shutdown, decoder is paused.
             // Don't resume it until source seek is done, otherwise it could
             // start pulling stale data too soon.
-            mDeferredActions.push_back(
-                    new ResumeDecoderAction(needNotify));
+            mPendingResumeAction = new ResumeDecoderAction(needNotify);
+            mDeferredActions.push_back(mPendingResumeAction);
 
             processDeferredActions();
             break;
@@ -2094,7 +2107,12 @@ void NuPlayer::getStats(Vector<sp<AMessage> > *mTrackStats) {
 
     mTrackStats->clear();
     if (mVideoDecoder != NULL) {
-        mTrackStats->push_back(mVideoDecoder->getStats());
+        sp<AMessage> stats = mVideoDecoder->getStats()->dup();
+        sp<Renderer> renderer = mRenderer;
+        if (renderer != NULL) {
+            renderer->getVideoStats(stats);
+        }
+        mTrackStats->push_back(stats);
     }
     if (mAudioDecoder != NULL) {
         mTrackStats->push_back(mAudioDecoder->getStats());
@@ -2160,6 +2178,27 @@ void NuPlayer::processDeferredActions() {
     }
 }
 
+bool NuPlayer::coalescePendingSeek(
+        int64_t seekTimeUs, MediaPlayerSeekMode mode, bool needNotify) {
+    // The previous seek can only absorb this one if its source seek has not been
+    // performed yet, and nothing was queued after it.
+    if (mPendingSeekAction == NULL || mDeferredActions.size() < 2) {
+        return false;
+    }
+    List<sp<Action> >::iterator it = mDeferredActions.end();
+    if (*--it != mPendingResumeAction || *--it != mPendingSeekAction) {
+        mPendingSeekAction.clear();
+        mPendingResumeAction.clear();
+        return false;
+    }
+
+    ALOGV("coalescing seek to %lld us with pending seek", (long long)seekTimeUs);
+    mPendingSeekAction->setSeekTo(seekTimeUs, mode);
+    // a single seek complete covers both requests
+    mPendingResumeAction->addNeedNotify(needNotify);
+    return true;
+}
+
 void NuPlayer::performSeek(int64_t seekTimeUs, MediaPlayerSeekMode mode) {
     ALOGV("performSeek seekTimeUs=%lld us (%.2f secs), mode=%d",
           (long long)seekTimeUs, seekTimeUs / 1E6, mode);
@@ -2643,12 +2682,23 @@ void NuPlayer::sendTimedTextData(const sp<ABuffer> &buffer) {
         CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
         int32_t global = 0;
         if (buffer->meta()->findInt32("global", &global) && global) {
-            flag |= TextDescriptions::GLOBAL_DESCRIPTIONS;
+            if (mGlobalTimedTextData == NULL
+                    || mGlobalTimedTextData->size() != size
+                    || memcmp(mGlobalTimedTextData->data(), data, size)) {
+                TextDescriptions::getParcelOfDescriptions(
+                        (const uint8_t *)data, size,
+                        flag | TextDescriptions::GLOBAL_DESCRIPTIONS, timeUs / 1000,
+                        &mGlobalTimedTextDescriptions);
+                mGlobalTimedTextData = new ABuffer(size);
+                memcpy(mGlobalTimedTextData->data(), data, size);
+            }
+            parcel.appendFrom(
+                    &mGlobalTimedTextDescriptions, 0, mGlobalTimedTextDescriptions.dataSize());
         } else {
             flag |= TextDescriptions::LOCAL_DESCRIPTIONS;
+            TextDescriptions::getParcelOfDescriptions(
+                    (const uint8_t *)data, size, flag, timeUs / 1000, &parcel);
         }
-        TextDescriptions::getParcelOfDescriptions(
-                (const uint8_t *)data, size, flag, timeUs / 1000, &parcel);
     }
 
     if ((parcel.dataSize() > 0)) {
@@ -18,6 +18,7 @@
 
 #define NU_PLAYER_H_
 
+#include <binder/Parcel.h>
 #include <media/AudioResamplerPublic.h>
 #include <media/ICrypto.h>
 #include <media/MediaPlayerInterface.h>
@@ -178,6 +179,12 @@ private:
 
     List<sp<Action> > mDeferredActions;
 
+    // Source seek and decoder resume of the last seek request, while they are deferred
+    // behind its decoder flush. A new seek request updates these instead of queueing
+    // another flush, seek and resume.
+    sp<SeekAction> mPendingSeekAction;
+    sp<ResumeDecoderAction> mPendingResumeAction;
+
     bool mAudioEOS;
     bool mVideoEOS;
 
@@ -187,6 +194,11 @@ private:
     int32_t mPollDurationGeneration;
     int32_t mTimedTextGeneration;
 
+    // The last global timed text descriptions, and the data they were parsed
+    // from, sent again whenever the timed text track is selected.
+    sp<ABuffer> mGlobalTimedTextData;
+    Parcel mGlobalTimedTextDescriptions;
+
     enum FlushStatus {
         NONE,
         FLUSHING_DECODER,
@@ -301,6 +313,7 @@ private:
     void cancelPollDuration();
 
     void processDeferredActions();
+    bool coalescePendingSeek(int64_t seekTimeUs, MediaPlayerSeekMode mode, bool needNotify);
 
     void performSeek(int64_t seekTimeUs, MediaPlayerSeekMode mode);
     void performDecoderFlush(FlushCommand audio, FlushCommand video);
@@ -19,6 +19,8 @@
 #include <utils/Log.h>
 #include <inttypes.h>
 
+#include <algorithm>
+
 #include "NuPlayerDecoderPassThrough.h"
 
 #include "NuPlayerRenderer.h"
@@ -35,10 +37,14 @@
 
 namespace android {
 
-// TODO optimize buffer size for power consumption
-// The offload read buffer size is 32 KB but 24 KB uses less power.
+// The offload read buffer size is 32 KB but 24 KB uses less power. Sinks that
+// report a larger buffer get aggregate buffers of up to that size, so that each
+// wakeup of the DSP can be served with a single buffer.
 static const size_t kAggregateBufferSizeBytes = 24 * 1024;
+static const size_t kMaxAggregateBufferSizeBytes = 256 * 1024;
 static const size_t kMaxCachedBytes = 200000;
+// Keep at least this many aggregate buffers in flight.
+static const size_t kMinCachedAggregateBuffers = 4;
 
 NuPlayer::DecoderPassThrough::DecoderPassThrough(
         const sp<AMessage> &notify,
@@ -50,6 +56,8 @@ NuPlayer::DecoderPassThrough::DecoderPassThrough(
       mSkipRenderingUntilMediaTimeUs(-1ll),
       mReachedEOS(true),
       mPendingAudioErr(OK),
+      mAggregateBufferSizeBytes(kAggregateBufferSizeBytes),
+      mMaxCachedBytes(kMaxCachedBytes),
       mPendingBuffersToDrain(0),
       mCachedBytes(0),
       mComponentName("pass through decoder") {
@@ -79,7 +87,20 @@ void NuPlayer::DecoderPassThrough::onConfigure(const sp<AMessage> &format) {
             AUDIO_OUTPUT_FLAG_NONE /* flags */, NULL /* isOffloaded */, mSource->isStreaming());
     if (err != OK) {
         handleError(err);
+        return;
+    }
+
+    ssize_t sinkBufferSize = mRenderer->getAudioSinkBufferSize();
+    if (sinkBufferSize > (ssize_t)kAggregateBufferSizeBytes) {
+        mAggregateBufferSizeBytes =
+            std::min((size_t)sinkBufferSize, kMaxAggregateBufferSizeBytes);
+    } else {
+        mAggregateBufferSizeBytes = kAggregateBufferSizeBytes;
     }
+    mMaxCachedBytes = std::max(
+            kMaxCachedBytes, kMinCachedAggregateBuffers * mAggregateBufferSizeBytes);
+    ALOGV("[%s] aggregate buffer size = %zu, max cached bytes = %zu",
+            mComponentName.c_str(), mAggregateBufferSizeBytes, mMaxCachedBytes);
 }
 
 void NuPlayer::DecoderPassThrough::onSetParameters(const sp<AMessage> &/*params*/) {
@@ -103,7 +124,7 @@ bool NuPlayer::DecoderPassThrough::isDoneFetching() const {
     ALOGV("[%s] mCachedBytes = %zu, mReachedEOS = %d mPaused = %d",
             mComponentName.c_str(), mCachedBytes, mReachedEOS, mPaused);
 
-    return mCachedBytes >= kMaxCachedBytes || mReachedEOS || mPaused;
+    return mCachedBytes >= mMaxCachedBytes || mReachedEOS || mPaused;
 }
 
 /*
@@ -168,9 +189,9 @@ sp<ABuffer> NuPlayer::DecoderPassThrough::aggregateBuffer(
     size_t smallSize = accessUnit->size();
     if ((mAggregateBuffer == NULL)
             // Don't bother if only room for a few small buffers.
-            && (smallSize < (kAggregateBufferSizeBytes / 3))) {
+            && (smallSize < (mAggregateBufferSizeBytes / 3))) {
         // Create a larger buffer for combining smaller buffers from the extractor.
-        mAggregateBuffer = new ABuffer(kAggregateBufferSizeBytes);
+        mAggregateBuffer = new ABuffer(mAggregateBufferSizeBytes);
         mAggregateBuffer->setRange(0, 0); // start empty
     }
 
@@ -59,6 +59,9 @@ private:
     sp<ABuffer> mPendingAudioAccessUnit;
     status_t    mPendingAudioErr;
     sp<ABuffer> mAggregateBuffer;
+    // Size of the aggregate buffer, negotiated with the audio sink in onConfigure.
+    size_t      mAggregateBufferSizeBytes;
+    size_t      mMaxCachedBytes;
 
     // mPendingBuffersToDrain are only for debugging. It can be removed
     // when the power investigation is done.
@@ -47,6 +47,10 @@ static const char *kPlayerWidth = "android.media.mediaplayer.width";
 static const char *kPlayerHeight = "android.media.mediaplayer.height";
 static const char *kPlayerFrames = "android.media.mediaplayer.frames";
 static const char *kPlayerFramesDropped = "android.media.mediaplayer.dropped";
+static const char *kPlayerVsyncRepeats = "android.media.mediaplayer.vsync.repeats";
+static const char *kPlayerVsyncSkips = "android.media.mediaplayer.vsync.skips";
+static const char *kPlayerJudderAvg = "android.media.mediaplayer.judder.avgUs";
+static const char *kPlayerJudderMax = "android.media.mediaplayer.judder.maxUs";
 static const char *kPlayerAMime = "android.media.mediaplayer.audio.mime";
 static const char *kPlayerACodec = "android.media.mediaplayer.audio.codec";
 static const char *kPlayerDuration = "android.media.mediaplayer.durationMs";
@@ -59,6 +63,7 @@ static const char *kPlayerDataSourceType = "android.media.mediaplayer.dataSource
 NuPlayerDriver::NuPlayerDriver(pid_t pid)
     : mState(STATE_IDLE),
       mIsAsyncPrepare(false),
+      mPreparingAhead(false),
       mAsyncResult(UNKNOWN_ERROR),
       mSetSurfaceInProgress(false),
       mDurationUs(-1),
@@ -252,6 +257,17 @@ status_t NuPlayerDriver::prepare() {
 }
 
 status_t NuPlayerDriver::prepare_l() {
+    if (mPreparingAhead) {
+        mPreparingAhead = false;
+        while (mState == STATE_PREPARING) {
+            mCondition.wait(mLock);
+        }
+        if (mState == STATE_PREPARED) {
+            return OK;
+        }
+        // preparing ahead failed, try again
+    }
+
     switch (mState) {
         case STATE_UNPREPARED:
             mState = STATE_PREPARING;
@@ -285,6 +301,20 @@ status_t NuPlayerDriver::prepareAsync() {
     ALOGV("prepareAsync(%p)", this);
     Mutex::Autolock autoLock(mLock);
 
+    if (mPreparingAhead) {
+        mPreparingAhead = false;
+        if (mState == STATE_PREPARING) {
+            // notifyPrepareCompleted() will notify the listener
+            mIsAsyncPrepare = true;
+            return OK;
+        } else if (mState == STATE_PREPARED) {
+            mIsAsyncPrepare = true;
+            notifyListener_l(MEDIA_PREPARED);
+            return OK;
+        }
+        // preparing ahead failed, try again
+    }
+
     switch (mState) {
         case STATE_UNPREPARED:
             mState = STATE_PREPARING;
@@ -304,6 +334,24 @@ status_t NuPlayerDriver::prepareAsync() {
     };
 }
 
+status_t NuPlayerDriver::prepareAhead() {
+    ALOGV("prepareAhead(%p)", this);
+    Mutex::Autolock autoLock(mLock);
+
+    if (mState != STATE_UNPREPARED) {
+        return INVALID_OPERATION;
+    }
+
+    // NuPlayer prepares on its own looper, so this runs alongside the playback of
+    // other players. Decoders are only instantiated on start(), so no codec
+    // resources are held on behalf of the player until it is used.
+    mState = STATE_PREPARING;
+    mIsAsyncPrepare = false;
+    mPreparingAhead = true;
+    mPlayer->prepareAsync();
+    return OK;
+}
+
 status_t NuPlayerDriver::start() {
     ALOGD("start(%p), state is %d, eos is %d", this, mState, mAtEOS);
     Mutex::Autolock autoLock(mLock);
@@ -553,6 +601,16 @@ void NuPlayerDriver::updateMetrics(const char *where) {
                 mAnalyticsItem->setInt64(kPlayerFrames, numFramesTotal);
                 mAnalyticsItem->setInt64(kPlayerFramesDropped, numFramesDropped);
 
+                int64_t vsyncRepeats, vsyncSkips, judderAvgUs, judderMaxUs;
+                if (stats->findInt64("vsync-repeats", &vsyncRepeats)
+                        && stats->findInt64("vsync-skips", &vsyncSkips)
+                        && stats->findInt64("judder-avg-us", &judderAvgUs)
+                        && stats->findInt64("judder-max-us", &judderMaxUs)) {
+                    mAnalyticsItem->setInt64(kPlayerVsyncRepeats, vsyncRepeats);
+                    mAnalyticsItem->setInt64(kPlayerVsyncSkips, vsyncSkips);
+                    mAnalyticsItem->setInt64(kPlayerJudderAvg, judderAvgUs);
+                    mAnalyticsItem->setInt64(kPlayerJudderMax, judderMaxUs);
+                }
 
             } else if (mime.startsWith("audio/")) {
                 mAnalyticsItem->setCString(kPlayerAMime, mime.c_str());
@@ -625,6 +683,10 @@ status_t NuPlayerDriver::reset() {
 
         case STATE_PREPARING:
         {
+            if (mPreparingAhead) {
+                // the client has not asked for a notification
+                break;
+            }
             CHECK(mIsAsyncPrepare);
 
             notifyListener_l(MEDIA_PREPARED);
@@ -644,6 +706,7 @@ status_t NuPlayerDriver::reset() {
         dump(-1, args);
     }
 
+    mPreparingAhead = false;
     mState = STATE_RESET_IN_PROGRESS;
     mPlayer->resetAsync();
 
@@ -886,6 +949,24 @@ status_t NuPlayerDriver::dump(
                      numFramesTotal == 0
                             ? 0.0 : (double)(numFramesDropped * 100) / numFramesTotal);
             logString.append(buf);
+
+            int64_t vsyncFrames, vsyncRepeats, vsyncSkips, judderAvgUs, judderMaxUs;
+            AString cadence;
+            if (stats->findInt64("vsync-frames", &vsyncFrames)
+                    && stats->findInt64("vsync-repeats", &vsyncRepeats)
+                    && stats->findInt64("vsync-skips", &vsyncSkips)
+                    && stats->findInt64("judder-avg-us", &judderAvgUs)
+                    && stats->findInt64("judder-max-us", &judderMaxUs)
+                    && stats->findString("vsync-cadence", &cadence)) {
+                snprintf(buf, sizeof(buf), "    vsyncFrames(%lld), repeats(%lld), skips(%lld), "
+                         "judderAvg(%lld us), judderMax(%lld us)\n",
+                         (long long)vsyncFrames, (long long)vsyncRepeats,
+                         (long long)vsyncSkips, (long long)judderAvgUs,
+                         (long long)judderMaxUs);
+                logString.append(buf);
+                snprintf(buf, sizeof(buf), "    vsyncsPerFrame(%s)\n", cadence.c_str());
+                logString.append(buf);
+            }
         }
     }
 
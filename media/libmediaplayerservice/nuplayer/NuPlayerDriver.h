@@ -51,6 +51,7 @@ struct NuPlayerDriver : public MediaPlayerInterface {
 
     virtual status_t prepare();
     virtual status_t prepareAsync();
+    virtual status_t prepareAhead();
     virtual status_t start();
     virtual status_t stop();
     virtual status_t pause();
@@ -115,6 +116,8 @@ private:
     State mState;
 
     bool mIsAsyncPrepare;
+    // true from prepareAhead() until the client calls prepare() or prepareAsync()
+    bool mPreparingAhead;
     status_t mAsyncResult;
 
     // The following are protected through "mLock"
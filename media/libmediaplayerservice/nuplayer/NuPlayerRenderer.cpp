@@ -21,6 +21,7 @@
 #include "NuPlayerRenderer.h"
 #include <algorithm>
 #include <cutils/properties.h>
+#include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/AUtils.h>
@@ -75,6 +76,9 @@ static const int64_t kMaxAllowedAudioSinkDelayUs = 1500000ll;
 
 static const int64_t kMinimumAudioClockUpdatePeriodUs = 20 /* msec */ * 1000;
 
+// Most PCM data gathered from queued audio buffers into a single AudioSink write.
+static const size_t kAudioWriteBatchBytes = 32 * 1024;
+
 // static
 const NuPlayer::Renderer::PcmInfo NuPlayer::Renderer::AUDIO_PCMINFO_INITIALIZER = {
         AUDIO_CHANNEL_NONE,
@@ -427,6 +431,13 @@ void NuPlayer::Renderer::closeAudioSink() {
     msg->postAndAwaitResponse(&response);
 }
 
+ssize_t NuPlayer::Renderer::getAudioSinkBufferSize() const {
+    if (mAudioSink == NULL) {
+        return NO_INIT;
+    }
+    return mAudioSink->bufferSize();
+}
+
 void NuPlayer::Renderer::changeAudioFormat(
         const sp<AMessage> &format,
         bool offloadOnly,
@@ -1048,9 +1059,15 @@ bool NuPlayer::Renderer::onDrainAudioQueue() {
         }
 
         size_t copy = entry->mBuffer->size() - entry->mOffset;
+        const uint8_t *data = entry->mBuffer->data() + entry->mOffset;
+
+        // write small PCM buffers queued behind this one along with it
+        size_t numEntries = 1;
+        if (!offloadingAudio()) {
+            numEntries = batchAudioQueue(&data, &copy);
+        }
 
-        ssize_t written = mAudioSink->write(entry->mBuffer->data() + entry->mOffset,
-                                            copy, false /* blocking */);
+        ssize_t written = mAudioSink->write(data, copy, false /* blocking */);
         if (written < 0) {
             // An error in AudioSink write. Perhaps the AudioSink was not properly opened.
             if (written == WOULD_BLOCK) {
@@ -1064,20 +1081,25 @@ bool NuPlayer::Renderer::onDrainAudioQueue() {
             break;
         }
 
-        entry->mOffset += written;
-        size_t remainder = entry->mBuffer->size() - entry->mOffset;
-        if ((ssize_t)remainder < mAudioSink->frameSize()) {
-            if (remainder > 0) {
-                ALOGW("Corrupted audio buffer has fractional frames, discarding %zu bytes.",
-                        remainder);
-                entry->mOffset += remainder;
-                copy -= remainder;
-            }
+        if (numEntries > 1) {
+            consumeAudioBatch(numEntries, written);
+            entry = NULL;
+        } else {
+            entry->mOffset += written;
+            size_t remainder = entry->mBuffer->size() - entry->mOffset;
+            if ((ssize_t)remainder < mAudioSink->frameSize()) {
+                if (remainder > 0) {
+                    ALOGW("Corrupted audio buffer has fractional frames, discarding %zu bytes.",
+                            remainder);
+                    entry->mOffset += remainder;
+                    copy -= remainder;
+                }
 
-            entry->mNotifyConsumed->post();
-            mAudioQueue.erase(mAudioQueue.begin());
+                entry->mNotifyConsumed->post();
+                mAudioQueue.erase(mAudioQueue.begin());
 
-            entry = NULL;
+                entry = NULL;
+            }
         }
 
         size_t copiedFrames = written / mAudioSink->frameSize();
@@ -1129,6 +1151,67 @@ bool NuPlayer::Renderer::onDrainAudioQueue() {
     return reschedule;
 }
 
+// Gathers the PCM data of the buffers at the head of the audio queue into one write of at
+// most kAudioWriteBatchBytes. Only whole frames of data buffers are gathered; EOS and format
+// change entries end a batch. On return |data| and |size| describe what to write, and the
+// number of queue entries it covers is returned.
+size_t NuPlayer::Renderer::batchAudioQueue(const uint8_t **data, size_t *size) {
+    ssize_t frameSize = mAudioSink->frameSize();
+    if (frameSize <= 0 || *size % frameSize != 0 || *size >= kAudioWriteBatchBytes) {
+        return 1;
+    }
+
+    size_t numEntries = 0;
+    size_t total = 0;
+    for (List<QueueEntry>::iterator it = mAudioQueue.begin(); it != mAudioQueue.end(); ++it) {
+        if (it->mBuffer == NULL) {
+            break;
+        }
+        size_t remaining = it->mBuffer->size() - it->mOffset;
+        if (remaining == 0 || remaining % frameSize != 0
+                || total + remaining > kAudioWriteBatchBytes) {
+            break;
+        }
+        total += remaining;
+        ++numEntries;
+    }
+    if (numEntries < 2) {
+        return 1;
+    }
+
+    if (mAudioWriteBatch == NULL) {
+        mAudioWriteBatch = new ABuffer(kAudioWriteBatchBytes);
+    }
+    uint8_t *dst = mAudioWriteBatch->data();
+    List<QueueEntry>::iterator it = mAudioQueue.begin();
+    for (size_t i = 0; i < numEntries; ++i, ++it) {
+        size_t remaining = it->mBuffer->size() - it->mOffset;
+        memcpy(dst, it->mBuffer->data() + it->mOffset, remaining);
+        dst += remaining;
+    }
+
+    *data = mAudioWriteBatch->data();
+    *size = total;
+    return numEntries;
+}
+
+// Advances the |numEntries| queue entries of a batch by the |written| bytes the AudioSink
+// took, returning the buffers that were fully written to the decoder.
+void NuPlayer::Renderer::consumeAudioBatch(size_t numEntries, size_t written) {
+    for (size_t i = 0; i < numEntries && written > 0; ++i) {
+        QueueEntry *entry = &*mAudioQueue.begin();
+        size_t remaining = entry->mBuffer->size() - entry->mOffset;
+        mLastAudioBufferDrained = entry->mBufferOrdinal;
+        if (written < remaining) {
+            entry->mOffset += written;
+            break;
+        }
+        written -= remaining;
+        entry->mNotifyConsumed->post();
+        mAudioQueue.erase(mAudioQueue.begin());
+    }
+}
+
 int64_t NuPlayer::Renderer::getDurationUsIfPlayedAtSampleRate(uint32_t numFrames) {
     int32_t sampleRate = offloadingAudio() ?
             mCurrentOffloadInfo.sample_rate : mCurrentPcmInfo.mSampleRate;
@@ -1282,11 +1365,15 @@ void NuPlayer::Renderer::postDrainVideoQueue() {
                 postDelayUs = 10000;
             }
         } else if (needRepostDrainVideoQueue) {
-            // CHECK(mPlaybackRate > 0);
-            // CHECK(mAudioFirstAnchorTimeMediaUs >= 0);
-            // CHECK(mediaTimeUs - mAudioFirstAnchorTimeMediaUs >= 0);
-            postDelayUs = mediaTimeUs - mAudioFirstAnchorTimeMediaUs;
-            postDelayUs /= mPlaybackRate;
+            // Wait for the media clock to start and reach this frame, rather
+            // than guessing when it will.
+            msg->setWhat(kWhatPostDrainVideoQueue);
+            mMediaClock->addTimer(msg, mediaTimeUs,
+                    -2 * (mVideoScheduler->getVsyncPeriod() / 1000) /* adjustRealUs */);
+            mVideoScheduler->restart();
+            ALOGV("uninitialized media clock, waiting for %lld us", (long long)mediaTimeUs);
+            mDrainVideoQueuePending = true;
+            return;
         }
 
         if (postDelayUs >= 0) {
@@ -1444,8 +1531,10 @@ void NuPlayer::Renderer::onQueueBuffer(const sp<AMessage> &msg) {
 
     if (mHasVideo) {
         if (mVideoScheduler == NULL) {
-            mVideoScheduler = new VideoFrameScheduler();
-            mVideoScheduler->init();
+            sp<VideoFrameScheduler> scheduler = new VideoFrameScheduler();
+            scheduler->init();
+            Mutex::Autolock autoLock(mLock);
+            mVideoScheduler = scheduler;
         }
     }
 
@@ -1786,11 +1875,44 @@ void NuPlayer::Renderer::onResume() {
 
 void NuPlayer::Renderer::onSetVideoFrameRate(float fps) {
     if (mVideoScheduler == NULL) {
-        mVideoScheduler = new VideoFrameScheduler();
+        sp<VideoFrameScheduler> scheduler = new VideoFrameScheduler();
+        Mutex::Autolock autoLock(mLock);
+        mVideoScheduler = scheduler;
     }
     mVideoScheduler->init(fps);
 }
 
+void NuPlayer::Renderer::getVideoStats(const sp<AMessage> &stats) {
+    sp<VideoFrameScheduler> scheduler;
+    {
+        Mutex::Autolock autoLock(mLock);
+        scheduler = mVideoScheduler;
+    }
+    if (scheduler == NULL) {
+        return;
+    }
+
+    VideoFrameScheduler::Stats schedulerStats = scheduler->getStats();
+    if (schedulerStats.mNumFrames == 0) {
+        return;
+    }
+    stats->setInt64("vsync-frames", schedulerStats.mNumFrames);
+    stats->setInt64("vsync-repeats", schedulerStats.mNumRepeats);
+    stats->setInt64("vsync-skips", schedulerStats.mNumSkips);
+    stats->setInt64("judder-avg-us",
+            schedulerStats.mTotalJudderNs / schedulerStats.mNumFrames / 1000);
+    stats->setInt64("judder-max-us", schedulerStats.mMaxJudderNs / 1000);
+
+    AString cadence;
+    for (size_t i = 0; i < VideoFrameScheduler::kMaxVsyncsPerFrameStats; ++i) {
+        cadence.append(i == 0 ? "" : " ");
+        cadence.append(AStringPrintf("%zu%s:%lld", i,
+                i + 1 == VideoFrameScheduler::kMaxVsyncsPerFrameStats ? "+" : "",
+                (long long)schedulerStats.mVsyncsPerFrame[i]));
+    }
+    stats->setString("vsync-cadence", cadence);
+}
+
 int32_t NuPlayer::Renderer::getQueueGeneration(bool audio) {
     Mutex::Autolock autoLock(mLock);
     return (audio ? mAudioQueueGeneration : mVideoQueueGeneration);
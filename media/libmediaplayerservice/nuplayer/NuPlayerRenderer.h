@@ -68,6 +68,9 @@ struct NuPlayer::Renderer : public AHandler {
 
     void setVideoFrameRate(float fps);
 
+    // Adds the video cadence statistics of this session to |stats|.
+    void getVideoStats(const sp<AMessage> &stats);
+
     status_t getCurrentPosition(int64_t *mediaUs);
     int64_t getVideoLateByUs();
 
@@ -80,6 +83,10 @@ struct NuPlayer::Renderer : public AHandler {
             bool isStreaming);
     void closeAudioSink();
 
+    // Returns the size in bytes of the audio sink buffer, or a negative error
+    // if the sink is not open.
+    ssize_t getAudioSinkBufferSize() const;
+
     // re-open audio sink after all pending audio buffers played.
     void changeAudioFormat(
             const sp<AMessage> &format,
@@ -155,7 +162,9 @@ private:
     List<QueueEntry> mAudioQueue;
     List<QueueEntry> mVideoQueue;
     uint32_t mNumFramesWritten;
-    sp<VideoFrameScheduler> mVideoScheduler;
+    // staging buffer for writing several small PCM buffers to the AudioSink at once
+    sp<ABuffer> mAudioWriteBatch;
+    sp<VideoFrameScheduler> mVideoScheduler;  // set on the looper under mLock
 
     bool mDrainAudioQueuePending;
     bool mDrainVideoQueuePending;
@@ -229,6 +238,8 @@ private:
     size_t fillAudioBuffer(void *buffer, size_t size);
 
     bool onDrainAudioQueue();
+    size_t batchAudioQueue(const uint8_t **data, size_t *size);
+    void consumeAudioBatch(size_t numEntries, size_t written);
     void drainAudioQueueUntilLastEOS();
     int64_t getPendingAudioPlayoutDurationUs(int64_t nowUs);
     void postDrainAudioQueue_l(int64_t delayUs = 0);
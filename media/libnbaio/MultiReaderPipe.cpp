@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MultiReaderPipe"
+//#define LOG_NDEBUG 0
+
+#include <atomic>
+#include <string.h>
+
+#include <cutils/atomic.h>
+#include <cutils/compiler.h>
+#include <utils/Log.h>
+#include <media/nbaio/MultiReaderPipe.h>
+#include <audio_utils/roundup.h>
+
+namespace android {
+
+MultiReaderPipe::MultiReaderPipe(size_t maxFrames, const NBAIO_Format& format) :
+        NBAIO_Sink(format),
+        mMaxFrames(roundup(maxFrames)),
+        mFrameSize(Format_frameSize(format)),
+        mBuffer(malloc(mMaxFrames * mFrameSize)),
+        mRear(0),
+        mRearInProgress(0)
+{
+    for (size_t i = 0; i < kMaxReaders; i++) {
+        mSlots[i].mState = SLOT_FREE;
+        mSlots[i].mFront = 0;
+        mSlots[i].mThrottlesWriter = false;
+    }
+}
+
+MultiReaderPipe::~MultiReaderPipe()
+{
+    for (size_t i = 0; i < kMaxReaders; i++) {
+        ALOG_ASSERT(android_atomic_acquire_load(&mSlots[i].mState) == SLOT_FREE);
+    }
+    free(mBuffer);
+}
+
+size_t MultiReaderPipe::throttlingFilled(Modulo<int32_t> rear) const
+{
+    size_t filled = 0;
+    for (size_t i = 0; i < kMaxReaders; i++) {
+        const Slot& slot = mSlots[i];
+        if (android_atomic_acquire_load(&slot.mState) != SLOT_ACTIVE || !slot.mThrottlesWriter) {
+            continue;
+        }
+        const Modulo<int32_t> front(android_atomic_acquire_load(&slot.mFront));
+        const int32_t readerFilled = (rear - front).signedValue();
+        // A reader that is attaching may briefly have a stale front, so clamp.
+        if (readerFilled >= (int32_t) mMaxFrames) {
+            return mMaxFrames;
+        }
+        if (readerFilled > 0 && (size_t) readerFilled > filled) {
+            filled = (size_t) readerFilled;
+        }
+    }
+    return filled;
+}
+
+ssize_t MultiReaderPipe::availableToWrite()
+{
+    if (CC_UNLIKELY(!mNegotiated)) {
+        return NEGOTIATE;
+    }
+    return mMaxFrames - throttlingFilled(Modulo<int32_t>((int32_t) mRear));
+}
+
+ssize_t MultiReaderPipe::write(const void *buffer, size_t count)
+{
+    // count == 0 is unlikely and not worth checking for
+    if (CC_UNLIKELY(!mNegotiated)) {
+        return NEGOTIATE;
+    }
+    const Modulo<int32_t> rear((int32_t) mRear);   // only the writer modifies mRear
+    const size_t avail = mMaxFrames - throttlingFilled(rear);
+    if (count > avail) {
+        count = avail;
+    }
+    if (CC_UNLIKELY(count == 0)) {
+        return 0;
+    }
+    Modulo<int32_t> newRear(rear);
+    newRear += count;
+
+    // Readers that do not throttle the writer check mRearInProgress after copying,
+    // to detect frames that were overwritten while they were being read.
+    android_atomic_release_store(newRear.signedValue(), &mRearInProgress);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const size_t offset = rear.unsignedValue() & (mMaxFrames - 1);
+    size_t part1 = mMaxFrames - offset;
+    if (part1 > count) {
+        part1 = count;
+    }
+    memcpy((char *) mBuffer + offset * mFrameSize, buffer, part1 * mFrameSize);
+    if (part1 < count) {
+        memcpy(mBuffer, (const char *) buffer + part1 * mFrameSize,
+                (count - part1) * mFrameSize);
+    }
+    android_atomic_release_store(newRear.signedValue(), &mRear);
+    mFramesWritten += count;
+    return count;
+}
+
+}   // namespace android
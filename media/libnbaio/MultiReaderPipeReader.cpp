@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "MultiReaderPipeReader"
+//#define LOG_NDEBUG 0
+
+#include <atomic>
+#include <string.h>
+
+#include <cutils/atomic.h>
+#include <cutils/compiler.h>
+#include <utils/Log.h>
+#include <media/nbaio/MultiReaderPipeReader.h>
+
+namespace android {
+
+MultiReaderPipeReader::MultiReaderPipeReader(MultiReaderPipe& pipe, bool throttlesWriter) :
+        NBAIO_Source(pipe.mFormat),
+        mPipe(pipe), mSlot(NULL), mThrottlesWriter(throttlesWriter),
+        mFront(0),
+        mFramesOverrun(0),
+        mOverruns(0)
+{
+    for (size_t i = 0; i < MultiReaderPipe::kMaxReaders; i++) {
+        MultiReaderPipe::Slot *slot = &pipe.mSlots[i];
+        if (android_atomic_cmpxchg(MultiReaderPipe::SLOT_FREE, MultiReaderPipe::SLOT_CLAIMED,
+                &slot->mState) != 0) {
+            continue;
+        }
+        slot->mThrottlesWriter = throttlesWriter;
+        mFront = android_atomic_acquire_load(&pipe.mRear);
+        android_atomic_release_store(mFront.signedValue(), &slot->mFront);
+        android_atomic_release_store(MultiReaderPipe::SLOT_ACTIVE, &slot->mState);
+        // The writer may have advanced before it saw this reader, so start again from there.
+        mFront = android_atomic_acquire_load(&pipe.mRear);
+        android_atomic_release_store(mFront.signedValue(), &slot->mFront);
+        mSlot = slot;
+        break;
+    }
+    ALOGW_IF(mSlot == NULL, "MultiReaderPipeReader: more than %zu readers",
+            MultiReaderPipe::kMaxReaders);
+}
+
+MultiReaderPipeReader::~MultiReaderPipeReader()
+{
+    if (mSlot != NULL) {
+        android_atomic_release_store(MultiReaderPipe::SLOT_FREE, &mSlot->mState);
+    }
+}
+
+ssize_t MultiReaderPipeReader::sync(Modulo<int32_t> rear)
+{
+    const int32_t filled = (rear - mFront).signedValue();
+    if (CC_LIKELY(0 <= filled && (size_t) filled <= mPipe.mMaxFrames)) {
+        return filled;
+    }
+    if (filled < 0) {
+        // should not happen, but treat like a massive overrun and re-sync
+        mFront = rear;
+    } else {
+        // reader is not keeping up with writer, but give it the latest data
+        mFramesOverrun += filled - mPipe.mMaxFrames;
+        mFront = rear;
+        mFront -= mPipe.mMaxFrames;
+    }
+    ++mOverruns;
+    android_atomic_release_store(mFront.signedValue(), &mSlot->mFront);
+    return OVERRUN;
+}
+
+ssize_t MultiReaderPipeReader::availableToRead()
+{
+    if (CC_UNLIKELY(!mNegotiated)) {
+        return NEGOTIATE;
+    }
+    if (CC_UNLIKELY(mSlot == NULL)) {
+        return NO_INIT;
+    }
+    return sync(Modulo<int32_t>(android_atomic_acquire_load(&mPipe.mRear)));
+}
+
+ssize_t MultiReaderPipeReader::read(void *buffer, size_t count)
+{
+    if (CC_UNLIKELY(!mNegotiated)) {
+        return NEGOTIATE;
+    }
+    if (CC_UNLIKELY(mSlot == NULL)) {
+        return NO_INIT;
+    }
+    const ssize_t avail = sync(Modulo<int32_t>(android_atomic_acquire_load(&mPipe.mRear)));
+    if (CC_UNLIKELY(avail <= 0)) {
+        return avail;
+    }
+    if (count > (size_t) avail) {
+        count = avail;
+    }
+
+    const size_t maxFrames = mPipe.mMaxFrames;
+    const size_t frameSize = mPipe.mFrameSize;
+    const size_t offset = mFront.unsignedValue() & (maxFrames - 1);
+    size_t part1 = maxFrames - offset;
+    if (part1 > count) {
+        part1 = count;
+    }
+    memcpy(buffer, (const char *) mPipe.mBuffer + offset * frameSize, part1 * frameSize);
+    if (part1 < count) {
+        memcpy((char *) buffer + part1 * frameSize, mPipe.mBuffer, (count - part1) * frameSize);
+    }
+
+    if (!mThrottlesWriter) {
+        // The writer does not wait for us, so check that it did not start overwriting
+        // the frames we just copied.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const Modulo<int32_t> rearInProgress(
+                android_atomic_acquire_load(&mPipe.mRearInProgress));
+        if ((rearInProgress - mFront).signedValue() > (int32_t) maxFrames) {
+            (void) sync(rearInProgress);
+            return OVERRUN;
+        }
+    }
+
+    mFront += count;
+    android_atomic_release_store(mFront.signedValue(), &mSlot->mFront);
+    mFramesRead += count;
+    return count;
+}
+
+ssize_t MultiReaderPipeReader::flush()
+{
+    if (CC_UNLIKELY(!mNegotiated)) {
+        return NEGOTIATE;
+    }
+    if (CC_UNLIKELY(mSlot == NULL)) {
+        return NO_INIT;
+    }
+    const ssize_t flushed = sync(Modulo<int32_t>(android_atomic_acquire_load(&mPipe.mRear)));
+    if (flushed <= 0) {
+        return flushed;
+    }
+    mFront += flushed;
+    android_atomic_release_store(mFront.signedValue(), &mSlot->mFront);
+    mFramesRead += flushed;  // we consider flushed frames as read, but not lost frames
+    return flushed;
+}
+
+}   // namespace android
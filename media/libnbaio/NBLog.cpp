@@ -24,6 +24,7 @@
 #include <string.h>
 #include <sys/prctl.h>
 #include <time.h>
+#include <unistd.h>
 #include <new>
 #include <audio_utils/roundup.h>
 #include <media/nbaio/NBLog.h>
@@ -52,7 +53,7 @@ int NBLog::Entry::readAt(size_t offset) const
 // ---------------------------------------------------------------------------
 
 NBLog::FormatEntry::FormatEntry(const uint8_t *entry) : mEntry(entry) {
-    ALOGW_IF(entry[offsetof(struct entry, type)] != EVENT_START_FMT,
+    ALOGW_IF(!isRecordStart(entry[offsetof(struct entry, type)]),
         "Created format entry with invalid event type %d", entry[offsetof(struct entry, type)]);
 }
 
@@ -360,6 +361,46 @@ void NBLog::Writer::logEnd()
     log(&entry, true);
 }
 
+void NBLog::Writer::logMixStart()
+{
+    if (!mEnabled) {
+        return;
+    }
+    logEventTs(EVENT_MIX_START, NULL, 0);
+}
+
+void NBLog::Writer::logMixEnd()
+{
+    if (!mEnabled) {
+        return;
+    }
+    logEventTs(EVENT_MIX_END, NULL, 0);
+}
+
+void NBLog::Writer::logWriteDuration(int64_t ns)
+{
+    if (!mEnabled) {
+        return;
+    }
+    logEventTs(EVENT_WRITE_DURATION, &ns, sizeof(ns));
+}
+
+void NBLog::Writer::logUnderrun(int64_t ns)
+{
+    if (!mEnabled) {
+        return;
+    }
+    logEventTs(EVENT_UNDERRUN, &ns, sizeof(ns));
+}
+
+void NBLog::Writer::logOverrun(int64_t ns)
+{
+    if (!mEnabled) {
+        return;
+    }
+    logEventTs(EVENT_OVERRUN, &ns, sizeof(ns));
+}
+
 void NBLog::Writer::logFormat(const char *fmt, ...)
 {
     if (!mEnabled) {
@@ -456,6 +497,22 @@ void NBLog::Writer::log(Event event, const void *data, size_t length)
     log(&entry, true /*trusted*/);
 }
 
+void NBLog::Writer::logEventTs(Event event, const void *data, size_t length)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts)) {
+        return;
+    }
+    // typed events are laid out the same as a format entry without arguments,
+    // so that the snapshot, merge and author handling apply to them unchanged
+    Entry entry(event, data, length);
+    log(&entry, true /*trusted*/);
+    Entry timestamp(EVENT_TIMESTAMP, &ts, sizeof(ts));
+    log(&timestamp, true /*trusted*/);
+    Entry end(EVENT_END_FMT, NULL, 0);
+    log(&end, true /*trusted*/);
+}
+
 void NBLog::Writer::log(const NBLog::Entry *entry, bool trusted)
 {
     if (!mEnabled) {
@@ -568,6 +625,36 @@ void NBLog::LockedWriter::logEnd()
     Writer::logEnd();
 }
 
+void NBLog::LockedWriter::logMixStart()
+{
+    Mutex::Autolock _l(mLock);
+    Writer::logMixStart();
+}
+
+void NBLog::LockedWriter::logMixEnd()
+{
+    Mutex::Autolock _l(mLock);
+    Writer::logMixEnd();
+}
+
+void NBLog::LockedWriter::logWriteDuration(int64_t ns)
+{
+    Mutex::Autolock _l(mLock);
+    Writer::logWriteDuration(ns);
+}
+
+void NBLog::LockedWriter::logUnderrun(int64_t ns)
+{
+    Mutex::Autolock _l(mLock);
+    Writer::logUnderrun(ns);
+}
+
+void NBLog::LockedWriter::logOverrun(int64_t ns)
+{
+    Mutex::Autolock _l(mLock);
+    Writer::logOverrun(ns);
+}
+
 bool NBLog::LockedWriter::isEnabled() const
 {
     Mutex::Autolock _l(mLock);
@@ -621,6 +708,23 @@ uint8_t *NBLog::Reader::findLastEntryOfType(uint8_t *front, uint8_t *back, uint8
     return nullptr; // no entry found
 }
 
+uint8_t *NBLog::Reader::findLastRecordStart(uint8_t *front, uint8_t *back) {
+    while (back + Entry::kPreviousLengthOffset >= front) {
+        uint8_t *prev = back - back[Entry::kPreviousLengthOffset] - Entry::kOverhead;
+        if (prev < front || prev + prev[offsetof(FormatEntry::entry, length)] +
+                            Entry::kOverhead != back) {
+
+            // prev points to an out of limits or inconsistent entry
+            return nullptr;
+        }
+        if (isRecordStart(prev[offsetof(FormatEntry::entry, type)])) {
+            return prev;
+        }
+        back = prev;
+    }
+    return nullptr; // no entry found
+}
+
 std::unique_ptr<NBLog::Reader::Snapshot> NBLog::Reader::getSnapshot()
 {
     if (mFifoReader == NULL) {
@@ -663,14 +767,13 @@ std::unique_ptr<NBLog::Reader::Snapshot> NBLog::Reader::getSnapshot()
     } else {
         // end of snapshot points to after last END_FMT entry
         snapshot->mEnd = FormatEntry::iterator(lastEnd + Entry::kOverhead);
-        // find first START_FMT
+        // find first START_FMT or typed event
         uint8_t *firstStart = nullptr;
         uint8_t *firstStartTmp = lastEnd;
-        while ((firstStartTmp = findLastEntryOfType(front, firstStartTmp, EVENT_START_FMT))
-                != nullptr) {
+        while ((firstStartTmp = findLastRecordStart(front, firstStartTmp)) != nullptr) {
             firstStart = firstStartTmp;
         }
-        // firstStart is null if no START_FMT entry was found before lastEnd
+        // firstStart is null if no record start was found before lastEnd
         if (firstStart == nullptr) {
             snapshot->mBegin = snapshot->mEnd;
         } else {
@@ -798,9 +901,15 @@ void NBLog::Reader::dump(int fd, size_t indent, NBLog::Reader::Snapshot &snapsho
             break;
 #endif
         case EVENT_START_FMT:
-            // right now, this is the only supported case
             entry = handleFormat(FormatEntry(entry), &timestamp, &body);
             break;
+        case EVENT_MIX_START:
+        case EVENT_MIX_END:
+        case EVENT_WRITE_DURATION:
+        case EVENT_UNDERRUN:
+        case EVENT_OVERRUN:
+            entry = handleEvent(FormatEntry(entry), &timestamp, &body);
+            break;
         case EVENT_END_FMT:
             body.appendFormat("warning: got to end format event");
             ++entry;
@@ -954,6 +1063,35 @@ NBLog::FormatEntry::iterator NBLog::Reader::handleFormat(const FormatEntry &fmtE
     return arg;
 }
 
+NBLog::FormatEntry::iterator NBLog::Reader::handleEvent(const FormatEntry &eventEntry,
+                                                        String8 *timestamp,
+                                                        String8 *body) {
+    struct timespec ts = eventEntry.timestamp();
+    timestamp->clear();
+    timestamp->appendFormat("[%d.%03d]", (int) ts.tv_sec,
+                    (int) (ts.tv_nsec / 1000000));
+
+    handleAuthor(eventEntry, body);
+
+    NBLog::FormatEntry::iterator it = eventEntry.begin();
+    int64_t value = 0;
+    if (it->length == sizeof(value)) {
+        memcpy(&value, it->data, sizeof(value));
+    }
+    if (it->type == EVENT_MIX_START || it->type == EVENT_MIX_END) {
+        body->append(typedEventName(it->type));
+    } else {
+        // durations and time since last cycle
+        body->appendFormat("%s %.3f ms", typedEventName(it->type), value * 1e-6);
+    }
+
+    // skip the timestamp, the author if present, and anything else up to END_FMT
+    while ((++it)->type != EVENT_END_FMT) {
+    }
+    ++it;
+    return it;
+}
+
 // ---------------------------------------------------------------------------
 
 NBLog::Merger::Merger(const void *shared, size_t size):
@@ -996,6 +1134,9 @@ void NBLog::Merger::merge() {
     for (int i = 0; i < nLogs; ++i) {
         snapshots[i] = mNamedReaders[i].reader()->getSnapshot();
         offsets[i] = snapshots[i]->begin();
+        if (snapshots[i]->lost() > 0) {
+            mAnalysis.discontinuity(i);
+        }
     }
     // initialize offsets
     // TODO custom heap implementation could allow to update top, improving performance
@@ -1012,8 +1153,13 @@ void NBLog::Merger::merge() {
     while (!timestamps.empty()) {
         // find minimum timestamp
         int index = timestamps.top().index;
+        // typed events are analyzed as they are merged
+        FormatEntry entry(offsets[index]);
+        if (entry.begin()->type != EVENT_START_FMT) {
+            mAnalysis.analyzeEvent(entry, index);
+        }
         // copy it to the log, increasing offset
-        offsets[index] = FormatEntry(offsets[index]).copyWithAuthor(mFifoWriter, index);
+        offsets[index] = entry.copyWithAuthor(mFifoWriter, index);
         // update data structures
         timestamps.pop();
         if (offsets[index] != snapshots[index]->end()) {
@@ -1023,12 +1169,272 @@ void NBLog::Merger::merge() {
     }
 }
 
+// ---------------------------------------------------------------------------
+
+void NBLog::EventAnalysis::analyzeEvent(const NBLog::FormatEntry &eventEntry, int author) {
+    struct timespec ts = eventEntry.timestamp();
+    EventItem item;
+    item.ns = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    item.author = author;
+    item.type = eventEntry.begin()->type;
+    item.value = 0;
+    if (eventEntry.begin()->length == sizeof(item.value)) {
+        memcpy(&item.value, eventEntry.begin()->data, sizeof(item.value));
+    }
+
+    AutoMutex _l(mLock);
+    if ((size_t) author >= mThreads.size()) {
+        mThreads.resize(author + 1);
+    }
+    ThreadAnalysis &analysis = mThreads[author];
+    while (!mRecentEvents.empty() && mRecentEvents.front().ns < item.ns - kCorrelationWindowNs) {
+        mRecentEvents.pop_front();
+    }
+
+    switch (item.type) {
+    case EVENT_MIX_START: {
+        const int64_t period = item.ns - analysis.mLastMixStartNs;
+        if (analysis.mLastMixStartNs == 0 || period <= 0 || period > kMaxPeriodNs) {
+            // first period, or the thread was idle
+            break;
+        }
+        if (analysis.mPeriods == 0) {
+            analysis.mAveragePeriodNs = period;
+        }
+        const int64_t average = analysis.mAveragePeriodNs;
+        const int64_t deviation = period > average ? period - average : average - period;
+        size_t bucket = deviation / kJitterBucketNs;
+        if (bucket >= kJitterBuckets) {
+            bucket = kJitterBuckets - 1;
+        }
+        analysis.mJitterHistogram[bucket]++;
+        analysis.mPeriods++;
+
+        // an outlier is a period 50% longer than average, and is kept out of the average
+        if (analysis.mPeriods > kWarmupPeriods && period > average + average / 2) {
+            Outlier outlier;
+            outlier.startNs = analysis.mLastMixStartNs;
+            outlier.periodNs = period;
+            outlier.expectedNs = average;
+            outlier.author = author;
+            outlier.nearbyCount = 0;
+            for (auto it = mRecentEvents.rbegin();
+                    it != mRecentEvents.rend() && outlier.nearbyCount < kMaxNearby; ++it) {
+                // other threads' mix cycles are expected, so only keep the unusual events
+                if (it->author != author && it->type != EVENT_MIX_START &&
+                        it->type != EVENT_MIX_END) {
+                    outlier.nearby[outlier.nearbyCount++] = *it;
+                }
+            }
+            mOutliers.push_back(outlier);
+            if (mOutliers.size() > kMaxOutliers) {
+                mOutliers.pop_front();
+            }
+        } else {
+            analysis.mAveragePeriodNs += (period - average) >> kAverageShift;
+        }
+        } break;
+    case EVENT_WRITE_DURATION:
+        analysis.mWrites++;
+        analysis.mWriteTotalNs += item.value;
+        if (item.value > analysis.mWriteMaxNs) {
+            analysis.mWriteMaxNs = item.value;
+        }
+        break;
+    case EVENT_UNDERRUN:
+        analysis.mUnderruns++;
+        break;
+    case EVENT_OVERRUN:
+        analysis.mOverruns++;
+        break;
+    default:
+        break;
+    }
+    if (item.type == EVENT_MIX_START) {
+        analysis.mLastMixStartNs = item.ns;
+    }
+    mRecentEvents.push_back(item);
+}
+
+const char *NBLog::typedEventName(uint8_t type) {
+    switch (type) {
+    case EVENT_MIX_START:
+        return "mix start";
+    case EVENT_MIX_END:
+        return "mix end";
+    case EVENT_WRITE_DURATION:
+        return "write";
+    case EVENT_UNDERRUN:
+        return "underrun";
+    case EVENT_OVERRUN:
+        return "overrun";
+    default:
+        return "unknown";
+    }
+}
+
+void NBLog::EventAnalysis::discontinuity(int author) {
+    AutoMutex _l(mLock);
+    if ((size_t) author < mThreads.size()) {
+        mThreads[author].mLastMixStartNs = 0;
+    }
+}
+
+void NBLog::EventAnalysis::dump(int fd, size_t indent,
+                                const std::vector<NBLog::NamedReader> &namedReaders) const {
+    AutoMutex _l(mLock);
+    dprintf(fd, "%*sAnalysis:\n", (int) indent, "");
+    for (size_t i = 0; i < mThreads.size(); ++i) {
+        const ThreadAnalysis &analysis = mThreads[i];
+        if (analysis.mPeriods == 0 && analysis.mWrites == 0 && analysis.mUnderruns == 0 &&
+                analysis.mOverruns == 0) {
+            continue;
+        }
+        const char *name = i < namedReaders.size() ? namedReaders[i].name() : "?";
+        dprintf(fd, "%*s  %s: %u periods, average %.3f ms, %u underruns, %u overruns\n",
+                (int) indent, "", name, analysis.mPeriods, analysis.mAveragePeriodNs * 1e-6,
+                analysis.mUnderruns, analysis.mOverruns);
+        if (analysis.mWrites > 0) {
+            dprintf(fd, "%*s    writes: %u, average %.3f ms, max %.3f ms\n",
+                    (int) indent, "", analysis.mWrites,
+                    (analysis.mWriteTotalNs / analysis.mWrites) * 1e-6,
+                    analysis.mWriteMaxNs * 1e-6);
+        }
+        if (analysis.mPeriods > 0) {
+            dprintf(fd, "%*s    jitter |period - average| ms:", (int) indent, "");
+            for (size_t j = 0; j < kJitterBuckets; ++j) {
+                if (analysis.mJitterHistogram[j] == 0) {
+                    continue;
+                }
+                if (j == kJitterBuckets - 1) {
+                    dprintf(fd, " >=%.2f:%u", j * kJitterBucketNs * 1e-6,
+                            analysis.mJitterHistogram[j]);
+                } else {
+                    dprintf(fd, " <%.2f:%u", (j + 1) * kJitterBucketNs * 1e-6,
+                            analysis.mJitterHistogram[j]);
+                }
+            }
+            dprintf(fd, "\n");
+        }
+    }
+    if (mOutliers.empty()) {
+        return;
+    }
+    dprintf(fd, "%*sOutlier periods (most recent last):\n", (int) indent, "");
+    for (const Outlier &outlier : mOutliers) {
+        const char *name = (size_t) outlier.author < namedReaders.size() ?
+                namedReaders[outlier.author].name() : "?";
+        dprintf(fd, "%*s  [%d.%03d] %s: period %.3f ms, average %.3f ms\n", (int) indent, "",
+                (int) (outlier.startNs / 1000000000), (int) (outlier.startNs % 1000000000 / 1000000),
+                name, outlier.periodNs * 1e-6, outlier.expectedNs * 1e-6);
+        for (size_t j = 0; j < outlier.nearbyCount; ++j) {
+            const EventItem &event = outlier.nearby[j];
+            const char *nearbyName = (size_t) event.author < namedReaders.size() ?
+                    namedReaders[event.author].name() : "?";
+            dprintf(fd, "%*s      [%d.%03d] %s: %s %.3f ms\n", (int) indent, "",
+                    (int) (event.ns / 1000000000), (int) (event.ns % 1000000000 / 1000000),
+                    nearbyName, typedEventName(event.type), event.value * 1e-6);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+
 const std::vector<NBLog::NamedReader> *NBLog::Merger::getNamedReaders() const {
     return &mNamedReaders;
 }
 
 NBLog::MergeReader::MergeReader(const void *shared, size_t size, Merger &merger)
-    : Reader(shared, size), mNamedReaders(merger.getNamedReaders()) {}
+    : Reader(shared, size), mNamedReaders(merger.getNamedReaders()),
+      mAnalysis(merger.getAnalysis()), mHistoryLost(0) {
+    mHistory.reserve(kHistorySize + size);
+}
+
+void NBLog::MergeReader::dumpAnalysis(int fd, size_t indent) const {
+    mAnalysis->dump(fd, indent, *mNamedReaders);
+}
+
+// static
+NBLog::FormatEntry::iterator NBLog::MergeReader::nextRecord(FormatEntry::iterator it,
+                                                            const FormatEntry::iterator &end) {
+    while (it != end && it->type != EVENT_END_FMT) {
+        ++it;
+    }
+    if (it != end) {
+        ++it;
+    }
+    return it;
+}
+
+// static
+int64_t NBLog::MergeReader::recordNs(const FormatEntry::iterator &it) {
+    timespec ts = FormatEntry(it).timestamp();
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void NBLog::MergeReader::updateHistory() {
+    std::unique_ptr<Snapshot> snapshot = getSnapshot();
+    if (snapshot->data() == NULL) {
+        return;
+    }
+    const FormatEntry::iterator front(snapshot->data());
+    const uint8_t *begin = snapshot->data() + (snapshot->begin() - front);
+    const uint8_t *end = snapshot->data() + (snapshot->end() - front);
+
+    Mutex::Autolock _l(mHistoryLock);
+    mHistoryLost += snapshot->lost() + (begin - snapshot->data());
+    mHistory.insert(mHistory.end(), begin, end);
+    if (mHistory.size() > kHistorySize) {
+        // drop the oldest records, keeping the history record-aligned
+        const FormatEntry::iterator historyBegin(mHistory.data());
+        const FormatEntry::iterator historyEnd(mHistory.data() + mHistory.size());
+        FormatEntry::iterator it = historyBegin;
+        while (it != historyEnd && historyEnd - it > (int) kHistorySize) {
+            it = nextRecord(it, historyEnd);
+        }
+        mHistory.erase(mHistory.begin(), mHistory.begin() + (it - historyBegin));
+    }
+}
+
+void NBLog::MergeReader::dumpHistory(int fd, size_t indent, int64_t windowNs) {
+    Mutex::Autolock _l(mHistoryLock);
+    const FormatEntry::iterator begin(mHistory.data());
+    const FormatEntry::iterator end(mHistory.data() + mHistory.size());
+    FormatEntry::iterator first = begin;
+    if (windowNs > 0 && begin != end) {
+        // records are merged in timestamp order, so the last one is the most recent
+        FormatEntry::iterator last = begin;
+        for (FormatEntry::iterator it = begin; it != end; it = nextRecord(it, end)) {
+            last = it;
+        }
+        const int64_t sinceNs = recordNs(last) - windowNs;
+        while (first != end && recordNs(first) < sinceNs) {
+            first = nextRecord(first, end);
+        }
+    }
+
+    const size_t size = end - first;
+    Snapshot snapshot(size);
+    memcpy(snapshot.mData, mHistory.data() + (first - begin), size);
+    snapshot.mBegin = FormatEntry::iterator(snapshot.mData);
+    snapshot.mEnd = FormatEntry::iterator(snapshot.mData + size);
+    snapshot.mLost = windowNs > 0 ? 0 : mHistoryLost;
+    dump(fd, indent, snapshot);
+}
+
+void NBLog::MergeReader::dumpHistoryRaw(int fd) {
+    Mutex::Autolock _l(mHistoryLock);
+    const uint8_t *data = mHistory.data();
+    size_t left = mHistory.size();
+    while (left > 0) {
+        ssize_t written = write(fd, data, left);
+        if (written <= 0) {
+            break;
+        }
+        data += written;
+        left -= written;
+    }
+}
 
 size_t NBLog::MergeReader::handleAuthor(const NBLog::FormatEntry &fmtEntry, String8 *body) {
     int author = fmtEntry.author();
@@ -1037,8 +1443,9 @@ size_t NBLog::MergeReader::handleAuthor(const NBLog::FormatEntry &fmtEntry, Stri
     return NBLog::Entry::kOverhead + sizeof(author);
 }
 
-NBLog::MergeThread::MergeThread(NBLog::Merger &merger)
+NBLog::MergeThread::MergeThread(NBLog::Merger &merger, NBLog::MergeReader &mergeReader)
     : mMerger(merger),
+      mMergeReader(mergeReader),
       mTimeoutUs(0) {}
 
 NBLog::MergeThread::~MergeThread() {
@@ -1061,6 +1468,7 @@ bool NBLog::MergeThread::threadLoop() {
     }
     if (doMerge) {
         mMerger.merge();
+        mMergeReader.updateHistory();
     }
     return true;
 }
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_MULTI_READER_PIPE_H
+#define ANDROID_AUDIO_MULTI_READER_PIPE_H
+
+#include <media/Modulo.h>
+#include "NBAIO.h"
+
+namespace android {
+
+// MultiReaderPipe is a Pipe that can be read at different rates by up to kMaxReaders
+// MultiReaderPipeReader clients, each with its own read position:
+//  - a reader that throttles the writer is never overrun; write() instead returns a short
+//    transfer count when the slowest throttling reader has no more room, like MonoPipe
+//  - a reader that does not throttle the writer is overrun if it falls behind, like PipeReader,
+//    and the overrun is reported only by that reader
+// There are no mutexes.  It is safe for a single writer thread, and each reader is safe for a
+// single thread.  Readers can be added and removed dynamically, and it's OK to have no readers.
+class MultiReaderPipe : public NBAIO_Sink {
+
+    friend class MultiReaderPipeReader;
+
+public:
+    static const size_t kMaxReaders = 8;
+
+    // maxFrames will be rounded up to a power of 2, and all slots are available. Must be >= 2.
+    MultiReaderPipe(size_t maxFrames, const NBAIO_Format& format);
+    virtual ~MultiReaderPipe();
+
+    // NBAIO_Port interface
+
+    //virtual ssize_t negotiate(const NBAIO_Format offers[], size_t numOffers,
+    //                          NBAIO_Format counterOffers[], size_t& numCounterOffers);
+    //virtual NBAIO_Format format() const;
+
+    // NBAIO_Sink interface
+
+    //virtual int64_t framesWritten() const;
+    //virtual int64_t framesUnderrun() const;
+    //virtual int64_t underruns() const;
+
+    // returns n where 0 <= n <= mMaxFrames, the room left by the slowest throttling reader,
+    // or a negative status_t including the private status codes in NBAIO.h
+    virtual ssize_t availableToWrite();
+
+    // never overwrites frames not yet read by a throttling reader
+    virtual ssize_t write(const void *buffer, size_t count);
+    //virtual ssize_t writeVia(writeVia_t via, size_t total, void *user, size_t block);
+
+            size_t  maxFrames() const { return mMaxFrames; }
+
+private:
+    enum {
+        SLOT_FREE,      // available for a new reader
+        SLOT_CLAIMED,   // being set up by a new reader, or being released
+        SLOT_ACTIVE,    // read position is valid
+    };
+
+    struct Slot {
+        volatile int32_t    mState;
+        volatile int32_t    mFront;     // next frame to read, written only by the reader
+        bool                mThrottlesWriter;   // stable while mState is SLOT_ACTIVE
+    };
+
+            // frame count between rear and the front of the slowest throttling reader
+            size_t  throttlingFilled(Modulo<int32_t> rear) const;
+
+    const size_t    mMaxFrames;     // always a power of 2
+    const size_t    mFrameSize;
+    void * const    mBuffer;
+    volatile int32_t mRear;         // next frame to write, written only by the writer
+    volatile int32_t mRearInProgress;   // mRear after the write() in progress
+    Slot            mSlots[kMaxReaders];
+};
+
+}   // namespace android
+
+#endif  // ANDROID_AUDIO_MULTI_READER_PIPE_H
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_MULTI_READER_PIPE_READER_H
+#define ANDROID_AUDIO_MULTI_READER_PIPE_READER_H
+
+#include "MultiReaderPipe.h"
+
+namespace android {
+
+// MultiReaderPipeReader is safe for only a single thread
+class MultiReaderPipeReader : public NBAIO_Source {
+
+public:
+
+    // Construct a MultiReaderPipeReader and associate it with a MultiReaderPipe.
+    // The reader starts at the current write position of the pipe.
+    // If throttlesWriter is true, the writer will not overwrite frames this reader has not read.
+    // Check initCheck(), as there is a limit of MultiReaderPipe::kMaxReaders readers per pipe.
+    MultiReaderPipeReader(MultiReaderPipe& pipe, bool throttlesWriter = true);
+    virtual ~MultiReaderPipeReader();
+
+            // NO_ERROR, or NO_INIT if the pipe already had the maximum number of readers
+            status_t initCheck() const { return mSlot != NULL ? NO_ERROR : NO_INIT; }
+
+    // NBAIO_Port interface
+
+    //virtual ssize_t negotiate(const NBAIO_Format offers[], size_t numOffers,
+    //                          NBAIO_Format counterOffers[], size_t& numCounterOffers);
+    //virtual NBAIO_Format format() const;
+
+    // NBAIO_Source interface
+
+    //virtual size_t framesRead() const;
+    virtual int64_t framesOverrun() { return mFramesOverrun; }
+    virtual int64_t overruns()  { return mOverruns; }
+
+    virtual ssize_t availableToRead();
+
+    virtual ssize_t read(void *buffer, size_t count);
+
+    virtual ssize_t flush();
+
+    // NBAIO_Source end
+
+            bool    throttlesWriter() const { return mThrottlesWriter; }
+
+private:
+            // Returns the number of frames available to read, after skipping any
+            // frames lost to overrun, or OVERRUN if frames were lost.
+            ssize_t sync(Modulo<int32_t> rear);
+
+    MultiReaderPipe&        mPipe;
+    MultiReaderPipe::Slot*  mSlot;      // NULL if no free slot
+    const bool              mThrottlesWriter;
+    Modulo<int32_t>         mFront;     // local copy of mSlot->mFront
+    int64_t                 mFramesOverrun;
+    int64_t                 mOverruns;
+};
+
+}   // namespace android
+
+#endif  // ANDROID_AUDIO_MULTI_READER_PIPE_READER_H
@@ -24,6 +24,7 @@
 #include <utils/Mutex.h>
 #include <utils/threads.h>
 
+#include <deque>
 #include <vector>
 
 namespace android {
@@ -51,8 +52,19 @@ enum Event {
     EVENT_START_FMT,            // logFormat start event: entry includes format string, following
                                 // entries contain format arguments
     EVENT_END_FMT,              // end of logFormat argument list
+    // typed binary events, each followed by a TIMESTAMP entry and an END_FMT entry
+    EVENT_MIX_START,            // start of a mix cycle, no payload
+    EVENT_MIX_END,              // end of a mix cycle, no payload
+    EVENT_WRITE_DURATION,       // int64_t duration of a sink write in ns
+    EVENT_UNDERRUN,             // int64_t time since last cycle in ns
+    EVENT_OVERRUN,              // int64_t time since last cycle in ns
 };
 
+// true for the event types that begin a record in the log: START_FMT and the typed events
+static bool isRecordStart(uint8_t type) {
+    return type == EVENT_START_FMT || (type >= EVENT_MIX_START && type <= EVENT_OVERRUN);
+}
+
 
 // ---------------------------------------------------------------------------
 // API for handling format entry operations
@@ -65,6 +77,9 @@ enum Event {
 //    * format arg2
 //    * ...
 //    * END_FMT entry
+//
+// a typed event has the same structure, with the typed event entry and its binary payload in
+// place of the START_FMT entry, and no format args
 
 class FormatEntry {
 public:
@@ -187,6 +202,7 @@ public:
     static void    appendPID(String8 *body, const void *data, size_t length);
     static void    appendTimestamp(String8 *body, const void *data);
     static size_t  fmtEntryLength(const uint8_t *data);
+    static const char *typedEventName(uint8_t type);
 
 public:
 
@@ -257,6 +273,13 @@ public:
     virtual void    logStart(const char *fmt);
     virtual void    logEnd();
 
+    // typed binary events, timestamped with clock_gettime(CLOCK_MONOTONIC)
+    virtual void    logMixStart();
+    virtual void    logMixEnd();
+    virtual void    logWriteDuration(int64_t ns);
+    virtual void    logUnderrun(int64_t ns);
+    virtual void    logOverrun(int64_t ns);
+
 
     virtual bool    isEnabled() const;
 
@@ -271,6 +294,8 @@ private:
     // 0 <= length <= kMaxLength
     void    log(Event event, const void *data, size_t length);
     void    log(const Entry *entry, bool trusted = false);
+    // write a typed event followed by the current timestamp and an END_FMT entry
+    void    logEventTs(Event event, const void *data, size_t length);
 
     Shared* const   mShared;    // raw pointer to shared memory
     sp<IMemory>     mIMemory;   // ref-counted version, initialized in constructor and then const
@@ -304,6 +329,11 @@ public:
     virtual void    logPID();
     virtual void    logStart(const char *fmt);
     virtual void    logEnd();
+    virtual void    logMixStart();
+    virtual void    logMixEnd();
+    virtual void    logWriteDuration(int64_t ns);
+    virtual void    logUnderrun(int64_t ns);
+    virtual void    logOverrun(int64_t ns);
 
     virtual bool    isEnabled() const;
     virtual bool    setEnabled(bool enabled);
@@ -322,7 +352,7 @@ public:
     public:
         Snapshot() : mData(NULL), mLost(0) {}
 
-        Snapshot(size_t bufferSize) : mData(new uint8_t[bufferSize]) {}
+        Snapshot(size_t bufferSize) : mData(new uint8_t[bufferSize]), mLost(0) {}
 
         ~Snapshot() { delete[] mData; }
 
@@ -342,6 +372,7 @@ public:
 
     private:
         friend class Reader;
+        friend class MergeReader;
         uint8_t              *mData;
         size_t                mLost;
         FormatEntry::iterator mBegin;
@@ -379,12 +410,17 @@ private:
     FormatEntry::iterator   handleFormat(const FormatEntry &fmtEntry,
                                          String8 *timestamp,
                                          String8 *body);
+    FormatEntry::iterator   handleEvent(const FormatEntry &eventEntry,
+                                        String8 *timestamp,
+                                        String8 *body);
     // dummy method for handling absent author entry
     virtual size_t handleAuthor(const FormatEntry &fmtEntry, String8 *body) { return 0; }
 
     // Searches for the last entry of type <type> in the range [front, back)
     // back has to be entry-aligned. Returns nullptr if none enconuntered.
     static uint8_t *findLastEntryOfType(uint8_t *front, uint8_t *back, uint8_t type);
+    // Same as findLastEntryOfType, for any entry that begins a record (see isRecordStart)
+    static uint8_t *findLastRecordStart(uint8_t *front, uint8_t *back);
 
     static const size_t kSquashTimestamp = 5; // squash this many or more adjacent timestamps
 };
@@ -408,6 +444,73 @@ private:
 
 // ---------------------------------------------------------------------------
 
+// Per-thread statistics of the typed events, built by the Merger as the events are merged so
+// that no period is missed between two dumps. Builds a jitter histogram of the mix period of each
+// thread, and keeps the most recent outlier periods with the events of other threads that were
+// logged shortly before the end of the late period.
+class EventAnalysis {
+public:
+    EventAnalysis() { }
+
+    // the writer of author lost entries: restart its period measurement
+    void    discontinuity(int author);
+    void    analyzeEvent(const FormatEntry &eventEntry, int author);
+    void    dump(int fd, size_t indent, const std::vector<NamedReader> &namedReaders) const;
+
+private:
+    static const size_t   kJitterBuckets = 16;
+    static const int64_t  kJitterBucketNs = 250000;         // 0.25 ms
+    static const int64_t  kCorrelationWindowNs = 20000000;  // 20 ms
+    static const size_t   kMaxOutliers = 16;
+    static const size_t   kMaxNearby = 4;                   // correlated events kept per outlier
+    static const int      kAverageShift = 4;                // average over ~16 periods
+    static const uint32_t kWarmupPeriods = 4;               // periods before outlier detection
+    static const int64_t  kMaxPeriodNs = 1000000000;        // longer gaps restart the analysis
+
+    // a typed event, as kept for correlation
+    struct EventItem {
+        int64_t ns;             // CLOCK_MONOTONIC timestamp
+        int     author;
+        uint8_t type;
+        int64_t value;          // payload, 0 if none
+    };
+
+    // a mix period that was much longer than average
+    struct Outlier {
+        int64_t startNs;        // start of the late period
+        int64_t periodNs;
+        int64_t expectedNs;     // average period when the outlier was detected
+        int     author;
+        size_t  nearbyCount;    // number of valid entries in nearby
+        EventItem nearby[kMaxNearby];  // latest events of other threads within the window
+    };
+
+    // per-author statistics
+    struct ThreadAnalysis {
+        ThreadAnalysis() : mLastMixStartNs(0), mAveragePeriodNs(0), mPeriods(0),
+                mWrites(0), mWriteTotalNs(0), mWriteMaxNs(0), mUnderruns(0), mOverruns(0) {
+            memset(mJitterHistogram, 0, sizeof(mJitterHistogram));
+        }
+        int64_t  mLastMixStartNs;   // 0 if none seen since the last discontinuity
+        int64_t  mAveragePeriodNs;  // exponential average of the mix period
+        uint32_t mPeriods;
+        // |period - mAveragePeriodNs| in kJitterBucketNs buckets, last bucket is open-ended
+        uint32_t mJitterHistogram[kJitterBuckets];
+        uint32_t mWrites;
+        int64_t  mWriteTotalNs;
+        int64_t  mWriteMaxNs;
+        uint32_t mUnderruns;
+        uint32_t mOverruns;
+    };
+
+    mutable Mutex               mLock;          // merge thread vs. dump
+    std::vector<ThreadAnalysis> mThreads;       // indexed by author
+    std::deque<EventItem>       mRecentEvents;  // events no older than kCorrelationWindowNs
+    std::deque<Outlier>         mOutliers;      // the kMaxOutliers most recent outliers
+};
+
+// ---------------------------------------------------------------------------
+
 class Merger : public RefBase {
 public:
     Merger(const void *shared, size_t size);
@@ -418,6 +521,7 @@ public:
     // TODO add removeReader
     void merge();
     const std::vector<NamedReader> *getNamedReaders() const;
+    const EventAnalysis *getAnalysis() const { return &mAnalysis; }
 private:
     // vector of the readers the merger is supposed to merge from.
     // every reader reads from a writer's buffer
@@ -426,6 +530,8 @@ private:
     Shared * const mShared;
     std::unique_ptr<audio_utils_fifo> mFifo;
     std::unique_ptr<audio_utils_fifo_writer> mFifoWriter;
+    // analysis of the typed events, updated by merge()
+    EventAnalysis mAnalysis;
 
     static struct timespec getTimestamp(const uint8_t *data);
 };
@@ -433,8 +539,36 @@ private:
 class MergeReader : public Reader {
 public:
     MergeReader(const void *shared, size_t size, Merger &merger);
+
+    // dump the analysis of the typed events merged so far
+    void dumpAnalysis(int fd, size_t indent = 0) const;
+
+    // Consumes the merged log and appends its records to the history, which keeps the most
+    // recent kHistorySize bytes of records so that a dump can look back further than the last
+    // merge. Called by the MergeThread after each merge, and before a dump.
+    void updateHistory();
+
+    // dump the history; if windowNs > 0, only the records logged within windowNs of the most
+    // recent one
+    void dumpHistory(int fd, size_t indent = 0, int64_t windowNs = 0);
+
+    // write the records of the history to fd as they are, in the merged log's binary format
+    void dumpHistoryRaw(int fd);
+
 private:
+    static const size_t kHistorySize = 256 * 1024;
+
     const std::vector<NamedReader> *mNamedReaders;
+    const EventAnalysis *mAnalysis;
+
+    Mutex                mHistoryLock;   // merge thread vs. dump
+    std::vector<uint8_t> mHistory;       // complete records, oldest first
+    size_t               mHistoryLost;   // bytes lost by the merged log before reaching history
+
+    // returns the start of the record following the one that starts at it
+    static FormatEntry::iterator nextRecord(FormatEntry::iterator it,
+                                            const FormatEntry::iterator &end);
+    static int64_t recordNs(const FormatEntry::iterator &it);
     // handle author entry by looking up the author's name and appending it to the body
     // returns number of bytes read from fmtEntry
     size_t handleAuthor(const FormatEntry &fmtEntry, String8 *body);
@@ -444,9 +578,10 @@ private:
 // when triggered, it awakes for a lapse of time, during which it periodically merges; if
 // retriggered, the timeout is reset.
 // The thread is triggered on AudioFlinger binder activity.
+// After each merge, the merged records are moved to the history of the MergeReader.
 class MergeThread : public Thread {
 public:
-    MergeThread(Merger &merger);
+    MergeThread(Merger &merger, MergeReader &mergeReader);
     virtual ~MergeThread() override;
 
     // Reset timeout and activate thread to merge periodically if it's idle
@@ -461,6 +596,9 @@ private:
     // the merger who actually does the work of merging the logs
     Merger&     mMerger;
 
+    // the reader of the merged log, which keeps its history
+    MergeReader& mMergeReader;
+
     // mutex for the condition variable
     Mutex       mMutex;
 
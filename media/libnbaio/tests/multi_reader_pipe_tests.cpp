@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "multi_reader_pipe_tests"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <log/log.h>
+#include <media/nbaio/MultiReaderPipe.h>
+#include <media/nbaio/MultiReaderPipeReader.h>
+
+using namespace android;
+
+// Each 16-bit stereo frame holds a 32-bit frame counter, so data can be checked after transfer.
+static const NBAIO_Format kFormat = Format_from_SR_C(48000, 2, AUDIO_FORMAT_PCM_16_BIT);
+
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+template <typename T>
+static void negotiate(T *port)
+{
+    NBAIO_Format offers[1] = { kFormat };
+    size_t numCounterOffers = 0;
+    ASSERT_EQ(0, port->negotiate(offers, 1, NULL, numCounterOffers));
+}
+
+static void fill(uint32_t *frames, size_t count, uint32_t first)
+{
+    for (size_t i = 0; i < count; i++) {
+        frames[i] = first + i;
+    }
+}
+
+TEST(multi_reader_pipe, single_reader)
+{
+    MultiReaderPipe pipe(100, kFormat);
+    negotiate(&pipe);
+    ASSERT_EQ(128u, pipe.maxFrames());
+    MultiReaderPipeReader reader(pipe);
+    ASSERT_EQ(NO_ERROR, reader.initCheck());
+    negotiate(&reader);
+
+    uint32_t in[256], out[256];
+    fill(in, 256, 0);
+    EXPECT_EQ(128, pipe.availableToWrite());
+    EXPECT_EQ(128, pipe.write(in, 200));   // short transfer count, as reader throttles
+    EXPECT_EQ(0, pipe.availableToWrite());
+    EXPECT_EQ(128, reader.availableToRead());
+    EXPECT_EQ(100, reader.read(out, 100));
+    EXPECT_EQ(100, pipe.availableToWrite());
+    EXPECT_EQ(100, pipe.write(in + 128, 100));
+    EXPECT_EQ(128, reader.read(out + 100, 200));
+    for (size_t i = 0; i < 228; i++) {
+        ASSERT_EQ(i, out[i]);
+    }
+    EXPECT_EQ(0, reader.overruns());
+    EXPECT_EQ(228, pipe.framesWritten());
+    EXPECT_EQ(228, reader.framesRead());
+}
+
+TEST(multi_reader_pipe, slowest_reader_throttles)
+{
+    MultiReaderPipe pipe(64, kFormat);
+    negotiate(&pipe);
+    MultiReaderPipeReader fast(pipe);
+    MultiReaderPipeReader *slow = new MultiReaderPipeReader(pipe);
+    negotiate(&fast);
+    negotiate(slow);
+
+    uint32_t in[64], out[64];
+    fill(in, 64, 0);
+    EXPECT_EQ(64, pipe.write(in, 64));
+    EXPECT_EQ(64, fast.read(out, 64));
+    EXPECT_EQ(0, pipe.availableToWrite());
+    EXPECT_EQ(16, slow->read(out, 16));
+    EXPECT_EQ(16, pipe.availableToWrite());
+    EXPECT_EQ(48, slow->availableToRead());
+    EXPECT_EQ(0, fast.availableToRead());
+
+    // a new reader starts at the write position
+    MultiReaderPipeReader late(pipe);
+    negotiate(&late);
+    EXPECT_EQ(0, late.availableToRead());
+    EXPECT_EQ(16, pipe.availableToWrite());
+
+    // removing the slow reader releases the writer
+    delete slow;
+    EXPECT_EQ(64, pipe.availableToWrite());
+}
+
+TEST(multi_reader_pipe, overrun_is_per_reader)
+{
+    MultiReaderPipe pipe(64, kFormat);
+    negotiate(&pipe);
+    MultiReaderPipeReader tap(pipe, false /*throttlesWriter*/);
+    MultiReaderPipeReader record(pipe);
+    negotiate(&tap);
+    negotiate(&record);
+
+    uint32_t in[64], out[64];
+    uint32_t next = 0;
+    for (int i = 0; i < 4; i++) {
+        fill(in, 48, next);
+        ASSERT_EQ(48, pipe.write(in, 48));
+        next += 48;
+        ASSERT_EQ(48, record.read(out, 64));
+        ASSERT_EQ(next - 48, out[0]);
+    }
+    // the tap was overrun, and gets the latest data after reporting it
+    EXPECT_EQ(OVERRUN, tap.availableToRead());
+    EXPECT_EQ(1, tap.overruns());
+    EXPECT_EQ(4 * 48 - 64, tap.framesOverrun());
+    EXPECT_EQ(64, tap.read(out, 64));
+    EXPECT_EQ(next - 64, out[0]);
+    EXPECT_EQ(next - 1, out[63]);
+    EXPECT_EQ(0, record.overruns());
+    EXPECT_EQ(0, record.framesOverrun());
+}
+
+TEST(multi_reader_pipe, max_readers)
+{
+    MultiReaderPipe pipe(64, kFormat);
+    std::vector<MultiReaderPipeReader *> readers;
+    for (size_t i = 0; i < MultiReaderPipe::kMaxReaders; i++) {
+        readers.push_back(new MultiReaderPipeReader(pipe));
+        EXPECT_EQ(NO_ERROR, readers.back()->initCheck());
+    }
+    MultiReaderPipeReader extra(pipe);
+    EXPECT_EQ(NO_INIT, extra.initCheck());
+    for (auto reader : readers) {
+        delete reader;
+    }
+    MultiReaderPipeReader another(pipe);
+    EXPECT_EQ(NO_ERROR, another.initCheck());
+}
+
+// One writer and readers consuming at different rates, as for an AEC reference,
+// a capture tap and a record track.  Throttling readers must see every frame in order.
+TEST(multi_reader_pipe, throughput_and_latency)
+{
+    static const size_t kFrames = 1 << 20;
+    static const size_t kBlock = 256;
+    static const size_t kReaders = 3;
+    static const useconds_t kReaderSleepUs[kReaders] = { 0, 50, 200 };
+
+    MultiReaderPipe pipe(4096, kFormat);
+    negotiate(&pipe);
+    std::vector<int64_t> writeTimeNs(kFrames / kBlock);
+    MultiReaderPipeReader *readers[kReaders];
+    for (size_t r = 0; r < kReaders; r++) {
+        readers[r] = new MultiReaderPipeReader(pipe);
+        negotiate(readers[r]);
+    }
+
+    struct Stats {
+        int64_t mTotalLatencyNs;
+        int64_t mMaxLatencyNs;
+        size_t  mLatencySamples;
+        size_t  mErrors;
+    } stats[kReaders] = {};
+
+    const int64_t startNs = nowNs();
+    std::thread writer([&]() {
+        uint32_t block[kBlock];
+        for (size_t written = 0; written < kFrames; ) {
+            fill(block, kBlock, written);
+            writeTimeNs[written / kBlock] = nowNs();
+            for (size_t done = 0; done < kBlock; ) {
+                ssize_t ret = pipe.write(block + done, kBlock - done);
+                if (ret <= 0) {
+                    usleep(10);
+                    continue;
+                }
+                done += ret;
+            }
+            written += kBlock;
+        }
+    });
+    std::vector<std::thread> readerThreads;
+    for (size_t r = 0; r < kReaders; r++) {
+        readerThreads.emplace_back([&, r]() {
+            uint32_t block[kBlock];
+            Stats& s = stats[r];
+            for (size_t read = 0; read < kFrames; ) {
+                ssize_t ret = readers[r]->read(block, kBlock);
+                if (ret <= 0) {
+                    s.mErrors += ret < 0;
+                    usleep(kReaderSleepUs[r] + 10);
+                    continue;
+                }
+                for (ssize_t i = 0; i < ret; i++) {
+                    s.mErrors += block[i] != read + i;
+                }
+                // latency of the first frame of each written block
+                if (read % kBlock == 0) {
+                    const int64_t latencyNs = nowNs() - writeTimeNs[read / kBlock];
+                    s.mTotalLatencyNs += latencyNs;
+                    if (latencyNs > s.mMaxLatencyNs) {
+                        s.mMaxLatencyNs = latencyNs;
+                    }
+                    s.mLatencySamples++;
+                }
+                read += ret;
+                if (kReaderSleepUs[r] != 0) {
+                    usleep(kReaderSleepUs[r]);
+                }
+            }
+        });
+    }
+    writer.join();
+    for (auto& t : readerThreads) {
+        t.join();
+    }
+    const double seconds = (nowNs() - startNs) * 1e-9;
+
+    printf("%zu frames in %.3f s, %.1f Mframes/s\n", kFrames, seconds, kFrames / seconds * 1e-6);
+    for (size_t r = 0; r < kReaders; r++) {
+        const Stats& s = stats[r];
+        printf("reader %zu sleeping %u us: latency avg %.1f us max %.1f us\n",
+                r, kReaderSleepUs[r],
+                s.mLatencySamples ? s.mTotalLatencyNs * 1e-3 / s.mLatencySamples : 0.,
+                s.mMaxLatencyNs * 1e-3);
+        EXPECT_EQ(0u, s.mErrors);
+        EXPECT_EQ(0, readers[r]->overruns());
+        EXPECT_EQ((int64_t) kFrames, readers[r]->framesRead());
+        delete readers[r];
+    }
+}
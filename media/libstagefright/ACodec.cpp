@@ -551,6 +551,7 @@ ACodec::ACodec()
       mCaptureFps(-1.0),
       mCreateInputBuffersSuspended(false),
       mLatency(0),
+      mOutputPartialFrames(false),
       mTunneled(false),
       mDescribeColorAspectsIndex((OMX_INDEXTYPE)0),
       mDescribeHDRStaticInfoIndex((OMX_INDEXTYPE)0),
@@ -583,6 +584,15 @@ ACodec::ACodec()
 }
 
 ACodec::~ACodec() {
+    if (mLatencyTracker.enabled()) {
+        AString latencies;
+        mLatencyTracker.dump(&latencies);
+        ALOGI("[%s] latencies:\n%s", mComponentName.c_str(), latencies.c_str());
+    }
+}
+
+void ACodec::exportMetrics(MediaAnalyticsItem *item) {
+    mLatencyTracker.exportMetrics(item);
 }
 
 void ACodec::initiateSetup(const sp<AMessage> &msg) {
@@ -831,15 +841,21 @@ status_t ACodec::setPortMode(int32_t portIndex, IOMX::PortMode mode) {
 status_t ACodec::allocateBuffersOnPort(OMX_U32 portIndex) {
     CHECK(portIndex == kPortIndexInput || portIndex == kPortIndexOutput);
 
-    if (getTrebleFlag()) {
-        CHECK(mAllocator[portIndex] == NULL);
-    } else {
-        CHECK(mDealer[portIndex] == NULL);
+    // The output port keeps its allocator or heap across a reconfiguration,
+    // see OutputPortSettingsChangedState.
+    if (portIndex == kPortIndexInput) {
+        if (getTrebleFlag()) {
+            CHECK(mAllocator[portIndex] == NULL);
+        } else {
+            CHECK(mDealer[portIndex] == NULL);
+        }
     }
     CHECK(mBuffers[portIndex].isEmpty());
 
     status_t err;
     if (mNativeWindow != NULL && portIndex == kPortIndexOutput) {
+        mAllocator[portIndex].clear();
+        mDealer[portIndex].clear();
         if (storingMetadataInDecodedBuffers()) {
             err = allocateOutputMetadataBuffers();
         } else {
@@ -898,9 +914,12 @@ status_t ACodec::allocateBuffersOnPort(OMX_U32 portIndex) {
                 return NO_MEMORY;
             }
 
+            bool reusedHeap = false;
             if (mode != IOMX::kPortModePresetSecureBuffer) {
                 if (getTrebleFlag()) {
-                    mAllocator[portIndex] = TAllocator::getService("ashmem");
+                    if (mAllocator[portIndex] == NULL) {
+                        mAllocator[portIndex] = TAllocator::getService("ashmem");
+                    }
                     if (mAllocator[portIndex] == nullptr) {
                         ALOGE("hidl allocator on port %d is null",
                                 (int)portIndex);
@@ -909,8 +928,20 @@ status_t ACodec::allocateBuffersOnPort(OMX_U32 portIndex) {
                 } else {
                     size_t totalSize = def.nBufferCountActual *
                             (alignedSize + alignedConvSize);
-                    mDealer[portIndex] = new MemoryDealer(totalSize, "ACodec");
+                    if (mDealer[portIndex] != NULL
+                            && mDealer[portIndex]->getMemoryHeap()->getSize() >= totalSize) {
+                        ALOGV("[%s] Reusing the %zu byte heap of the %s port",
+                                mComponentName.c_str(),
+                                mDealer[portIndex]->getMemoryHeap()->getSize(),
+                                portIndex == kPortIndexInput ? "input" : "output");
+                        reusedHeap = true;
+                    } else {
+                        mDealer[portIndex] = new MemoryDealer(totalSize, "ACodec");
+                    }
                 }
+            } else {
+                mAllocator[portIndex].clear();
+                mDealer[portIndex].clear();
             }
 
             const sp<AMessage> &format =
@@ -965,6 +996,16 @@ status_t ACodec::allocateBuffersOnPort(OMX_U32 portIndex) {
                                 portIndex, hidlMemToken, &info.mBufferID);
                     } else {
                         mem = mDealer[portIndex]->allocate(bufSize);
+                        if (mem == NULL && reusedHeap) {
+                            // Buffers of the old configuration still hold
+                            // part of the heap; the rest go in a new one.
+                            mDealer[portIndex] = new MemoryDealer(
+                                    (def.nBufferCountActual - i)
+                                            * (alignedSize + alignedConvSize),
+                                    "ACodec");
+                            reusedHeap = false;
+                            mem = mDealer[portIndex]->allocate(bufSize);
+                        }
                         if (mem == NULL || mem->pointer() == NULL) {
                             return NO_MEMORY;
                         }
@@ -1013,6 +1054,15 @@ status_t ACodec::allocateBuffersOnPort(OMX_U32 portIndex) {
                         } else {
                             mem = mDealer[portIndex]->allocate(
                                     conversionBufferSize);
+                            if (mem == NULL && reusedHeap) {
+                                mDealer[portIndex] = new MemoryDealer(
+                                        (def.nBufferCountActual - i)
+                                                * (alignedSize + alignedConvSize),
+                                        "ACodec");
+                                reusedHeap = false;
+                                mem = mDealer[portIndex]->allocate(
+                                        conversionBufferSize);
+                            }
                             if (mem == NULL|| mem->pointer() == NULL) {
                                 return NO_MEMORY;
                             }
@@ -1443,6 +1493,9 @@ void ACodec::notifyOfRenderedFrames(bool dropIncomplete, FrameRenderTracker::Inf
     // unlink untracked frames
     for (std::list<FrameRenderTracker::Info>::const_iterator it = done.cbegin();
             it != done.cend(); ++it) {
+        if (it->getRenderTimeNs() >= 0) {
+            mLatencyTracker.onFrameDisplayed(it->getMediaTimeUs(), it->getRenderTimeNs());
+        }
         ssize_t index = it->getIndex();
         if (index >= 0 && (size_t)index < mBuffers[kPortIndexOutput].size()) {
             mBuffers[kPortIndexOutput].editItemAt(index).mRenderInfo = NULL;
@@ -1690,6 +1743,7 @@ status_t ACodec::fillBuffer(BufferInfo *info) {
     info->mFenceFd = -1;
     if (err == OK) {
         info->mStatus = BufferInfo::OWNED_BY_COMPONENT;
+        mLatencyTracker.onFillBuffer(info->mBufferID);
     }
     return err;
 }
@@ -1801,6 +1855,13 @@ status_t ACodec::configureCodec(
     // opaque handle, to which we don't have access.
     int32_t video = !strncasecmp(mime, "video/", 6);
     mIsVideo = video;
+
+    // Video encoders that emit slices as they are coded leave
+    // OMX_BUFFERFLAG_ENDOFFRAME off all but the last buffer of a frame.
+    int32_t outputPartialFrames = 0;
+    mOutputPartialFrames = encoder && video
+            && msg->findInt32("output-partial-frames", &outputPartialFrames)
+            && outputPartialFrames != 0;
     if (encoder && video) {
         OMX_BOOL enable = (OMX_BOOL) (prependSPSPPS
             && msg->findInt32("android._store-metadata-in-buffers-output", &storeMeta)
@@ -2940,11 +3001,9 @@ status_t ACodec::setupAMRCodec(bool encoder, bool isWAMR, int32_t bitrate) {
             1 /* numChannels */);
 }
 
-status_t ACodec::setupG711Codec(bool encoder, int32_t sampleRate, int32_t numChannels) {
-    if (encoder) {
-        return INVALID_OPERATION;
-    }
-
+status_t ACodec::setupG711Codec(bool /* encoder */, int32_t sampleRate, int32_t numChannels) {
+    // The input port of the decoder and of the encoder both take the sample
+    // rate and channel count; the output port follows it.
     return setupRawAudioFormat(
             kPortIndexInput, sampleRate, numChannels);
 }
@@ -5620,6 +5679,7 @@ bool ACodec::BaseState::onOMXEmptyBufferDone(IOMX::buffer_id bufferID, int fence
         return false;
     }
     info->mStatus = BufferInfo::OWNED_BY_US;
+    mCodec->mLatencyTracker.onEmptyBufferDone(bufferID);
 
     // input buffers cannot take fences, so wait for any fence now
     (void)mCodec->waitForFence(fenceFd, "onOMXEmptyBufferDone");
@@ -5847,6 +5907,7 @@ void ACodec::BaseState::onInputBufferFilled(const sp<AMessage> &msg) {
                     return;
                 }
                 info->mStatus = BufferInfo::OWNED_BY_COMPONENT;
+                mCodec->mLatencyTracker.onEmptyBuffer(bufferID, timeUs);
                 // Hold the reference while component is using the buffer.
                 info->mData = buffer;
 
@@ -5952,6 +6013,8 @@ bool ACodec::BaseState::onOMXFillBufferDone(
     }
 #endif
 
+    mCodec->mLatencyTracker.onFillBufferDone(bufferID, timeUs);
+
     BufferInfo *info =
         mCodec->findBufferByID(kPortIndexOutput, bufferID, &index);
     BufferInfo::Status status = BufferInfo::getSafeStatus(info);
@@ -6057,6 +6120,11 @@ bool ACodec::BaseState::onOMXFillBufferDone(
 
             info->mData.clear();
 
+            if (!mCodec->mOutputPartialFrames) {
+                // many components don't set the flag at all
+                flags |= OMX_BUFFERFLAG_ENDOFFRAME;
+            }
+
             mCodec->mBufferChannel->drainThisBuffer(info->mBufferID, flags);
 
             info->mStatus = BufferInfo::OWNED_BY_DOWNSTREAM;
@@ -6111,6 +6179,7 @@ void ACodec::BaseState::onOutputBufferDrained(const sp<AMessage> &msg) {
             && !discarded && buffer->size() != 0) {
         ATRACE_NAME("render");
         // The client wants this buffer to be rendered.
+        mCodec->mLatencyTracker.onRenderRequested(bufferID);
 
         android_native_rect_t crop;
         if (buffer->format()->findRect("crop", &crop.left, &crop.top, &crop.right, &crop.bottom)) {
@@ -7813,13 +7882,10 @@ bool ACodec::OutputPortSettingsChangedState::onOMXEvent(
                     ALOGE("disabled port should be empty, but has %zu buffers",
                             mCodec->mBuffers[kPortIndexOutput].size());
                     err = FAILED_TRANSACTION;
-                } else {
-                    if (mCodec->getTrebleFlag()) {
-                        mCodec->mAllocator[kPortIndexOutput].clear();
-                    } else {
-                        mCodec->mDealer[kPortIndexOutput].clear();
-                    }
                 }
+                // The allocator and the heap of the port are kept, so that
+                // the new buffers come from the old heap if they fit in it,
+                // instead of a new heap being mapped on both sides.
 
                 if (err == OK) {
                     err = mCodec->mOMXNode->sendCommand(
@@ -8182,6 +8248,7 @@ void ACodec::FlushingState::changeStateIfWeOwnAllBuffers() {
         mCodec->waitUntilAllPossibleNativeWindowBuffersAreReturnedToUs();
 
         mCodec->mRenderTracker.clear(systemTime(CLOCK_MONOTONIC));
+        mCodec->mLatencyTracker.clearPending();
 
         mCodec->mCallback->onFlushCompleted();
 
@@ -23,6 +23,7 @@
 #include <android/media/IDescrambler.h>
 #include <binder/MemoryDealer.h>
 #include <media/openmax/OMX_Core.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/AUtils.h>
 #include <media/stagefright/MediaCodec.h>
@@ -37,28 +38,79 @@ namespace android {
 using binder::Status;
 using MediaDescrambler::DescrambleInfo;
 using BufferInfo = ACodecBufferChannel::BufferInfo;
-using BufferInfoIterator = std::vector<const BufferInfo>::const_iterator;
 
 ACodecBufferChannel::~ACodecBufferChannel() {
     if (mCrypto != nullptr && mDealer != nullptr && mHeapSeqNum >= 0) {
         mCrypto->unsetHeap(mHeapSeqNum);
     }
+
+    TurnaroundStats input, output;
+    getTurnaroundStats(&input, &output);
+    ALOGV("input turnaround: %llu buffers, avg %lld us, max %lld us",
+            (unsigned long long)input.mCount,
+            (long long)(input.mCount ? input.mTotalUs / (int64_t)input.mCount : 0),
+            (long long)input.mMaxUs);
+    ALOGV("output turnaround: %llu buffers, avg %lld us, max %lld us",
+            (unsigned long long)output.mCount,
+            (long long)(output.mCount ? output.mTotalUs / (int64_t)output.mCount : 0),
+            (long long)output.mMaxUs);
+}
+
+ACodecBufferChannel::BufferArray::BufferArray(std::vector<const BufferInfo> &&buffers)
+    : mBuffers(std::move(buffers)),
+      mHandedOutUs(new std::atomic<int64_t>[mBuffers.size()]) {
+    mClientBufferSlots.reserve(mBuffers.size());
+    mBufferIdSlots.reserve(mBuffers.size());
+    for (size_t i = 0; i < mBuffers.size(); ++i) {
+        mClientBufferSlots.emplace(mBuffers[i].mClientBuffer.get(), i);
+        mBufferIdSlots.emplace(mBuffers[i].mBufferId, i);
+        mHandedOutUs[i].store(-1, std::memory_order_relaxed);
+    }
+}
+
+ssize_t ACodecBufferChannel::BufferArray::findClientBuffer(
+        const sp<MediaCodecBuffer> &buffer) const {
+    auto it = mClientBufferSlots.find(buffer.get());
+    return it == mClientBufferSlots.end() ? -1 : (ssize_t)it->second;
+}
+
+ssize_t ACodecBufferChannel::BufferArray::findBufferId(IOMX::buffer_id bufferId) const {
+    auto it = mBufferIdSlots.find(bufferId);
+    return it == mBufferIdSlots.end() ? -1 : (ssize_t)it->second;
 }
 
-static BufferInfoIterator findClientBuffer(
-        const std::shared_ptr<const std::vector<const BufferInfo>> &array,
-        const sp<MediaCodecBuffer> &buffer) {
-    return std::find_if(
-            array->begin(), array->end(),
-            [buffer](const BufferInfo &info) { return info.mClientBuffer == buffer; });
+// static
+void ACodecBufferChannel::NoteHandedOut(const BufferArray &array, size_t slot) {
+    array.mHandedOutUs[slot].store(ALooper::GetNowUs(), std::memory_order_relaxed);
 }
 
-static BufferInfoIterator findBufferId(
-        const std::shared_ptr<const std::vector<const BufferInfo>> &array,
-        IOMX::buffer_id bufferId) {
-    return std::find_if(
-            array->begin(), array->end(),
-            [bufferId](const BufferInfo &info) { return bufferId == info.mBufferId; });
+// static
+void ACodecBufferChannel::NoteReturned(
+        const BufferArray &array, size_t slot, Turnaround *turnaround) {
+    int64_t handedOutUs = array.mHandedOutUs[slot].exchange(-1, std::memory_order_relaxed);
+    if (handedOutUs < 0) {
+        return;
+    }
+    int64_t latencyUs = ALooper::GetNowUs() - handedOutUs;
+    turnaround->mCount.fetch_add(1, std::memory_order_relaxed);
+    turnaround->mTotalUs.fetch_add(latencyUs, std::memory_order_relaxed);
+    int64_t maxUs = turnaround->mMaxUs.load(std::memory_order_relaxed);
+    while (latencyUs > maxUs && !turnaround->mMaxUs.compare_exchange_weak(
+            maxUs, latencyUs, std::memory_order_relaxed)) {
+    }
+}
+
+// static
+void ACodecBufferChannel::GetStats(const Turnaround &turnaround, TurnaroundStats *stats) {
+    stats->mCount = turnaround.mCount.load(std::memory_order_relaxed);
+    stats->mTotalUs = turnaround.mTotalUs.load(std::memory_order_relaxed);
+    stats->mMaxUs = turnaround.mMaxUs.load(std::memory_order_relaxed);
+}
+
+void ACodecBufferChannel::getTurnaroundStats(
+        TurnaroundStats *input, TurnaroundStats *output) const {
+    GetStats(mInputTurnaround, input);
+    GetStats(mOutputTurnaround, output);
 }
 
 ACodecBufferChannel::BufferInfo::BufferInfo(
@@ -85,12 +137,13 @@ status_t ACodecBufferChannel::queueInputBuffer(const sp<MediaCodecBuffer> &buffe
     if (mDealer != nullptr) {
         return -ENOSYS;
     }
-    std::shared_ptr<const std::vector<const BufferInfo>> array(
-            std::atomic_load(&mInputBuffers));
-    BufferInfoIterator it = findClientBuffer(array, buffer);
-    if (it == array->end()) {
+    std::shared_ptr<const BufferArray> array(std::atomic_load(&mInputBuffers));
+    ssize_t slot = array->findClientBuffer(buffer);
+    if (slot < 0) {
         return -ENOENT;
     }
+    const BufferInfo *it = &array->mBuffers[slot];
+    NoteReturned(*array, slot, &mInputTurnaround);
     ALOGV("queueInputBuffer #%d", it->mBufferId);
     sp<AMessage> msg = mInputBufferFilled->dup();
     msg->setObject("buffer", it->mCodecBuffer);
@@ -107,12 +160,31 @@ status_t ACodecBufferChannel::queueSecureInputBuffer(
     if (!hasCryptoOrDescrambler() || mDealer == nullptr) {
         return -ENOSYS;
     }
-    std::shared_ptr<const std::vector<const BufferInfo>> array(
-            std::atomic_load(&mInputBuffers));
-    BufferInfoIterator it = findClientBuffer(array, buffer);
-    if (it == array->end()) {
+    std::shared_ptr<const BufferArray> array(std::atomic_load(&mInputBuffers));
+    ssize_t slot = array->findClientBuffer(buffer);
+    if (slot < 0) {
         return -ENOENT;
     }
+    const BufferInfo *it = &array->mBuffers[slot];
+
+    // Samples that are all clear need no decryption, and a non-secure codec
+    // can take them straight from the shared memory, without a trip through
+    // the crypto plugin and the decrypt destination.
+    if (!secure && mCrypto != NULL && isAllClear(mode, subSamples, numSubSamples)) {
+        size_t size = 0;
+        for (size_t i = 0; i < numSubSamples; ++i) {
+            size += subSamples[i].mNumBytesOfClearData;
+        }
+        size_t offset = it->mClientBuffer->offset();
+        if (offset > it->mSharedEncryptedBuffer->size()
+                || size > it->mSharedEncryptedBuffer->size() - offset
+                || size > it->mCodecBuffer->capacity()) {
+            return BAD_VALUE;
+        }
+        memcpy(it->mCodecBuffer->base(),
+                (uint8_t *)it->mSharedEncryptedBuffer->pointer() + offset, size);
+        return queueDecryptedBuffer(array, slot, size, "queueSecureInputBuffer (clear)");
+    }
 
     ICrypto::DestinationBuffer destination;
     if (secure) {
@@ -182,7 +254,30 @@ status_t ACodecBufferChannel::queueSecureInputBuffer(
         memcpy(it->mCodecBuffer->base(), destination.mSharedMemory->pointer(), result);
     }
 
-    it->mCodecBuffer->setRange(0, result);
+    return queueDecryptedBuffer(array, slot, result, "queueSecureInputBuffer");
+}
+
+// static
+bool ACodecBufferChannel::isAllClear(
+        CryptoPlugin::Mode mode,
+        const CryptoPlugin::SubSample *subSamples,
+        size_t numSubSamples) {
+    if (mode == CryptoPlugin::kMode_Unencrypted) {
+        return true;
+    }
+    for (size_t i = 0; i < numSubSamples; ++i) {
+        if (subSamples[i].mNumBytesOfEncryptedData != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+status_t ACodecBufferChannel::queueDecryptedBuffer(
+        const std::shared_ptr<const BufferArray> &array, size_t slot, size_t size,
+        const char *what) {
+    const BufferInfo *it = &array->mBuffers[slot];
+    it->mCodecBuffer->setRange(0, size);
 
     // Copy metadata from client to codec buffer.
     it->mCodecBuffer->meta()->clear();
@@ -198,7 +293,8 @@ status_t ACodecBufferChannel::queueSecureInputBuffer(
         it->mCodecBuffer->meta()->setInt32("csd", csd);
     }
 
-    ALOGV("queueSecureInputBuffer #%d", it->mBufferId);
+    NoteReturned(*array, slot, &mInputTurnaround);
+    ALOGV("%s #%d", what, it->mBufferId);
     sp<AMessage> msg = mInputBufferFilled->dup();
     msg->setObject("buffer", it->mCodecBuffer);
     msg->setInt32("buffer-id", it->mBufferId);
@@ -208,12 +304,13 @@ status_t ACodecBufferChannel::queueSecureInputBuffer(
 
 status_t ACodecBufferChannel::renderOutputBuffer(
         const sp<MediaCodecBuffer> &buffer, int64_t timestampNs) {
-    std::shared_ptr<const std::vector<const BufferInfo>> array(
-            std::atomic_load(&mOutputBuffers));
-    BufferInfoIterator it = findClientBuffer(array, buffer);
-    if (it == array->end()) {
+    std::shared_ptr<const BufferArray> array(std::atomic_load(&mOutputBuffers));
+    ssize_t slot = array->findClientBuffer(buffer);
+    if (slot < 0) {
         return -ENOENT;
     }
+    const BufferInfo *it = &array->mBuffers[slot];
+    NoteReturned(*array, slot, &mOutputTurnaround);
 
     ALOGV("renderOutputBuffer #%d", it->mBufferId);
     sp<AMessage> msg = mOutputBufferDrained->dup();
@@ -226,18 +323,19 @@ status_t ACodecBufferChannel::renderOutputBuffer(
 }
 
 status_t ACodecBufferChannel::discardBuffer(const sp<MediaCodecBuffer> &buffer) {
-    std::shared_ptr<const std::vector<const BufferInfo>> array(
-            std::atomic_load(&mInputBuffers));
+    std::shared_ptr<const BufferArray> array(std::atomic_load(&mInputBuffers));
     bool input = true;
-    BufferInfoIterator it = findClientBuffer(array, buffer);
-    if (it == array->end()) {
+    ssize_t slot = array->findClientBuffer(buffer);
+    if (slot < 0) {
         array = std::atomic_load(&mOutputBuffers);
         input = false;
-        it = findClientBuffer(array, buffer);
-        if (it == array->end()) {
+        slot = array->findClientBuffer(buffer);
+        if (slot < 0) {
             return -ENOENT;
         }
     }
+    const BufferInfo *it = &array->mBuffers[slot];
+    NoteReturned(*array, slot, input ? &mInputTurnaround : &mOutputTurnaround);
     ALOGV("discardBuffer #%d", it->mBufferId);
     sp<AMessage> msg = input ? mInputBufferFilled->dup() : mOutputBufferDrained->dup();
     msg->setObject("buffer", it->mCodecBuffer);
@@ -248,19 +346,17 @@ status_t ACodecBufferChannel::discardBuffer(const sp<MediaCodecBuffer> &buffer)
 }
 
 void ACodecBufferChannel::getInputBufferArray(Vector<sp<MediaCodecBuffer>> *array) {
-    std::shared_ptr<const std::vector<const BufferInfo>> inputBuffers(
-            std::atomic_load(&mInputBuffers));
+    std::shared_ptr<const BufferArray> inputBuffers(std::atomic_load(&mInputBuffers));
     array->clear();
-    for (const BufferInfo &elem : *inputBuffers) {
+    for (const BufferInfo &elem : inputBuffers->mBuffers) {
         array->push_back(elem.mClientBuffer);
     }
 }
 
 void ACodecBufferChannel::getOutputBufferArray(Vector<sp<MediaCodecBuffer>> *array) {
-    std::shared_ptr<const std::vector<const BufferInfo>> outputBuffers(
-            std::atomic_load(&mOutputBuffers));
+    std::shared_ptr<const BufferArray> outputBuffers(std::atomic_load(&mOutputBuffers));
     array->clear();
-    for (const BufferInfo &elem : *outputBuffers) {
+    for (const BufferInfo &elem : outputBuffers->mBuffers) {
         array->push_back(elem.mClientBuffer);
     }
 }
@@ -315,7 +411,7 @@ void ACodecBufferChannel::setInputBufferArray(const std::vector<BufferAndId> &ar
     }
     std::atomic_store(
             &mInputBuffers,
-            std::make_shared<const std::vector<const BufferInfo>>(inputBuffers));
+            std::shared_ptr<const BufferArray>(new BufferArray(std::move(inputBuffers))));
 }
 
 void ACodecBufferChannel::setOutputBufferArray(const std::vector<BufferAndId> &array) {
@@ -325,40 +421,39 @@ void ACodecBufferChannel::setOutputBufferArray(const std::vector<BufferAndId> &a
     }
     std::atomic_store(
             &mOutputBuffers,
-            std::make_shared<const std::vector<const BufferInfo>>(outputBuffers));
+            std::shared_ptr<const BufferArray>(new BufferArray(std::move(outputBuffers))));
 }
 
 void ACodecBufferChannel::fillThisBuffer(IOMX::buffer_id bufferId) {
     ALOGV("fillThisBuffer #%d", bufferId);
-    std::shared_ptr<const std::vector<const BufferInfo>> array(
-            std::atomic_load(&mInputBuffers));
-    BufferInfoIterator it = findBufferId(array, bufferId);
+    std::shared_ptr<const BufferArray> array(std::atomic_load(&mInputBuffers));
+    ssize_t slot = array->findBufferId(bufferId);
 
-    if (it == array->end()) {
+    if (slot < 0) {
         ALOGE("fillThisBuffer: unrecognized buffer #%d", bufferId);
         return;
     }
+    const BufferInfo *it = &array->mBuffers[slot];
     if (it->mClientBuffer != it->mCodecBuffer) {
         it->mClientBuffer->setFormat(it->mCodecBuffer->format());
     }
 
-    mCallback->onInputBufferAvailable(
-            std::distance(array->begin(), it),
-            it->mClientBuffer);
+    NoteHandedOut(*array, slot);
+    mCallback->onInputBufferAvailable(slot, it->mClientBuffer);
 }
 
 void ACodecBufferChannel::drainThisBuffer(
         IOMX::buffer_id bufferId,
         OMX_U32 omxFlags) {
     ALOGV("drainThisBuffer #%d", bufferId);
-    std::shared_ptr<const std::vector<const BufferInfo>> array(
-            std::atomic_load(&mOutputBuffers));
-    BufferInfoIterator it = findBufferId(array, bufferId);
+    std::shared_ptr<const BufferArray> array(std::atomic_load(&mOutputBuffers));
+    ssize_t slot = array->findBufferId(bufferId);
 
-    if (it == array->end()) {
+    if (slot < 0) {
         ALOGE("drainThisBuffer: unrecognized buffer #%d", bufferId);
         return;
     }
+    const BufferInfo *it = &array->mBuffers[slot];
     if (it->mClientBuffer != it->mCodecBuffer) {
         it->mClientBuffer->setFormat(it->mCodecBuffer->format());
     }
@@ -373,11 +468,13 @@ void ACodecBufferChannel::drainThisBuffer(
     if (omxFlags & OMX_BUFFERFLAG_EOS) {
         flags |= MediaCodec::BUFFER_FLAG_EOS;
     }
+    if (!(omxFlags & OMX_BUFFERFLAG_ENDOFFRAME)) {
+        flags |= MediaCodec::BUFFER_FLAG_PARTIAL_FRAME;
+    }
     it->mClientBuffer->meta()->setInt32("flags", flags);
 
-    mCallback->onOutputBufferAvailable(
-            std::distance(array->begin(), it),
-            it->mClientBuffer);
+    NoteHandedOut(*array, slot);
+    mCallback->onOutputBufferAvailable(slot, it->mClientBuffer);
 }
 
 }  // namespace android
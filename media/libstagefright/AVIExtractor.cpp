@@ -778,6 +778,26 @@ status_t AVIExtractor::parseIndex(off64_t offset, size_t size) {
 
     const uint8_t *data = buffer->data();
 
+    // Size the per track indices up front, so that they don't have to be grown entry by entry.
+    Vector<size_t> numEntries;
+    numEntries.insertAt(0, 0, mTracks.size());
+    for (size_t i = 0; i < size; i += 16) {
+        uint32_t chunkType = U32_AT(&data[i]);
+        uint8_t hi = chunkType >> 24;
+        uint8_t lo = (chunkType >> 16) & 0xff;
+        size_t trackIndex = 10 * (hi - '0') + (lo - '0');
+        if (hi >= '0' && hi <= '9' && lo >= '0' && lo <= '9' && trackIndex < mTracks.size()) {
+            ++numEntries.editItemAt(trackIndex);
+        }
+    }
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        Track *track = &mTracks.editItemAt(i);
+        if (track->mKind != Track::OTHER) {
+            track->mSampleOffsets.setCapacity(track->numSamples() + numEntries[i]);
+            track->mSyncSampleBits.setCapacity((track->numSamples() + numEntries[i] + 31) / 32);
+        }
+    }
+
     while (size > 0) {
         uint32_t chunkType = U32_AT(data);
 
@@ -814,15 +834,10 @@ status_t AVIExtractor::parseIndex(off64_t offset, size_t size) {
             track->mMaxSampleSize = chunkSize;
         }
 
-        track->mSamples.push();
+        bool isKey = (flags & 0x10) != 0;
+        track->addSample(offset, isKey);
 
-        SampleInfo *info =
-            &track->mSamples.editItemAt(track->mSamples.size() - 1);
-
-        info->mOffset = offset;
-        info->mIsKey = (flags & 0x10) != 0;
-
-        if (info->mIsKey) {
+        if (isKey) {
             static const size_t kMaxNumSyncSamplesToScan = 20;
 
             if (track->mNumSyncSamples < kMaxNumSyncSamplesToScan) {
@@ -830,7 +845,7 @@ status_t AVIExtractor::parseIndex(off64_t offset, size_t size) {
                     track->mThumbnailSampleSize = chunkSize;
 
                     track->mThumbnailSampleIndex =
-                        track->mSamples.size() - 1;
+                        track->numSamples() - 1;
                 }
             }
 
@@ -870,7 +885,7 @@ status_t AVIExtractor::parseIndex(off64_t offset, size_t size) {
             // Compute the avg. size of the first 128 chunks (if there are
             // that many), but exclude the size of the first one, since
             // it may be an outlier.
-            size_t numSamplesToAverage = track->mSamples.size();
+            size_t numSamplesToAverage = track->numSamples();
             if (numSamplesToAverage > 256) {
                 numSamplesToAverage = 256;
             }
@@ -907,7 +922,7 @@ status_t AVIExtractor::parseIndex(off64_t offset, size_t size) {
 
         int64_t durationUs;
         CHECK_EQ((status_t)OK,
-                 getSampleTime(i, track->mSamples.size() - 1, &durationUs));
+                 getSampleTime(i, track->numSamples() - 1, &durationUs));
 
         ALOGV("track %d duration = %.2f secs", i, durationUs / 1E6);
 
@@ -1101,6 +1116,17 @@ status_t AVIExtractor::addH264CodecSpecificData(size_t trackIndex) {
     return OK;
 }
 
+void AVIExtractor::Track::addSample(uint32_t offset, bool isKey) {
+    size_t sampleIndex = mSampleOffsets.size();
+    mSampleOffsets.push(offset);
+    if (sampleIndex % 32 == 0) {
+        mSyncSampleBits.push(0);
+    }
+    if (isKey) {
+        mSyncSampleBits.editItemAt(sampleIndex / 32) |= 1u << (sampleIndex % 32);
+    }
+}
+
 status_t AVIExtractor::getSampleInfo(
         size_t trackIndex, size_t sampleIndex,
         off64_t *offset, size_t *size, bool *isKey,
@@ -1111,16 +1137,14 @@ status_t AVIExtractor::getSampleInfo(
 
     const Track &track = mTracks.itemAt(trackIndex);
 
-    if (sampleIndex >= track.mSamples.size()) {
+    if (sampleIndex >= track.numSamples()) {
         return -ERANGE;
     }
 
-    const SampleInfo &info = track.mSamples.itemAt(sampleIndex);
-
     if (!mOffsetsAreAbsolute) {
-        *offset = info.mOffset + mMovieOffset + 8;
+        *offset = track.mSampleOffsets[sampleIndex] + mMovieOffset + 8;
     } else {
-        *offset = info.mOffset;
+        *offset = track.mSampleOffsets[sampleIndex];
     }
 
     *size = 0;
@@ -1141,7 +1165,7 @@ status_t AVIExtractor::getSampleInfo(
     *offset += 8;
     *size = U32LE_AT(&tmp[4]);
 
-    *isKey = info.mIsKey;
+    *isKey = track.isSyncSample(sampleIndex);
 
     if (track.mBytesPerSample > 0) {
         size_t sampleStartInBytes;
@@ -1198,7 +1222,7 @@ status_t AVIExtractor::getSampleIndexAtTime(
         closestSampleIndex = timeUs / track.mRate * track.mScale / 1000000ll;
     }
 
-    ssize_t numSamples = track.mSamples.size();
+    ssize_t numSamples = track.numSamples();
 
     if (closestSampleIndex < 0) {
         closestSampleIndex = 0;
@@ -1214,10 +1238,7 @@ status_t AVIExtractor::getSampleIndexAtTime(
 
     ssize_t prevSyncSampleIndex = closestSampleIndex;
     while (prevSyncSampleIndex >= 0) {
-        const SampleInfo &info =
-            track.mSamples.itemAt(prevSyncSampleIndex);
-
-        if (info.mIsKey) {
+        if (track.isSyncSample(prevSyncSampleIndex)) {
             break;
         }
 
@@ -1226,10 +1247,7 @@ status_t AVIExtractor::getSampleIndexAtTime(
 
     ssize_t nextSyncSampleIndex = closestSampleIndex;
     while (nextSyncSampleIndex < numSamples) {
-        const SampleInfo &info =
-            track.mSamples.itemAt(nextSyncSampleIndex);
-
-        if (info.mIsKey) {
+        if (track.isSyncSample(nextSyncSampleIndex)) {
             break;
         }
 
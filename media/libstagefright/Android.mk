@@ -9,12 +9,14 @@ LOCAL_SRC_FILES:=                         \
         AACWriter.cpp                     \
         AMRExtractor.cpp                  \
         AMRWriter.cpp                     \
+        AsyncFileWriter.cpp               \
         AudioPlayer.cpp                   \
         AudioSource.cpp                   \
         BufferImpl.cpp                    \
         CallbackDataSource.cpp            \
         CameraSource.cpp                  \
         CameraSourceTimeLapse.cpp         \
+        CodecLatencyTracker.cpp           \
         DataConverter.cpp                 \
         DataSource.cpp                    \
         DataURISource.cpp                 \
@@ -26,6 +28,7 @@ LOCAL_SRC_FILES:=                         \
         HevcUtils.cpp                     \
         JPEGSource.cpp                    \
         MP3Extractor.cpp                  \
+        MP3FrameIndexSeeker.cpp           \
         MPEG2TSWriter.cpp                 \
         MPEG4Extractor.cpp                \
         MPEG4Writer.cpp                   \
@@ -45,6 +48,7 @@ LOCAL_SRC_FILES:=                         \
         NuMediaExtractor.cpp              \
         OMXClient.cpp                     \
         OggExtractor.cpp                  \
+        SampleIndex.cpp                   \
         SampleIterator.cpp                \
         SampleTable.cpp                   \
         SimpleDecodingSource.cpp          \
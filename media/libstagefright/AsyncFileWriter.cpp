@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AsyncFileWriter"
+#include <utils/Log.h>
+
+#include "include/AsyncFileWriter.h"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+
+namespace android {
+
+AsyncFileWriter::AsyncFileWriter(int fd, uint32_t flags)
+    : mFd(fd),
+      mFlags(flags),
+      mInitCheck(NO_INIT),
+      mThreadStarted(false),
+      mExit(false),
+      mError(OK),
+      mFill(NULL),
+      mFillPos(0),
+      mDirect(false),
+      mAllocatedEnd(0),
+      mEnd(0),
+      mNumWrites(0),
+      mBytesWritten(0) {
+    memset(mBuffers, 0, sizeof(mBuffers));
+    memset(mLatenciesUs, 0, sizeof(mLatenciesUs));
+
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        void *data;
+        if (posix_memalign(&data, kAlignment, kBufferSize) != 0) {
+            mInitCheck = NO_MEMORY;
+            return;
+        }
+        mBuffers[i].mData = (uint8_t *)data;
+    }
+
+    off64_t offset = lseek64(mFd, 0, SEEK_CUR);
+    if (offset < 0) {
+        ALOGE("cannot seek fd %d: %s", mFd, strerror(errno));
+        return;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    mThreadStarted = pthread_create(&mThread, &attr, ThreadWrapper, this) == 0;
+    pthread_attr_destroy(&attr);
+    if (!mThreadStarted) {
+        return;
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    startBuffer_l(offset);
+    mInitCheck = OK;
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    close();
+
+    for (size_t i = 0; i < kNumBuffers; ++i) {
+        free(mBuffers[i].mData);
+        mBuffers[i].mData = NULL;
+    }
+}
+
+void AsyncFileWriter::startBuffer_l(off64_t offset) {
+    while (true) {
+        for (size_t i = 0; i < kNumBuffers; ++i) {
+            if (!mBuffers[i].mQueued) {
+                mFill = &mBuffers[i];
+                mFill->mFileOffset = offset;
+                // end the buffer on an aligned file offset
+                mFill->mCapacity = kBufferSize - offset % kAlignment;
+                mFill->mSize = 0;
+                mFillPos = 0;
+                return;
+            }
+        }
+        mCondition.wait(mLock);
+    }
+}
+
+void AsyncFileWriter::queueFill_l() {
+    mFill->mQueued = true;
+    mQueue.push_back(mFill);
+    mFill = NULL;
+    mCondition.broadcast();
+}
+
+void AsyncFileWriter::seek(off64_t offset) {
+    Mutex::Autolock autoLock(mLock);
+    CHECK(mFill != NULL);
+
+    if (offset >= mFill->mFileOffset
+            && offset <= mFill->mFileOffset + (off64_t)mFill->mSize) {
+        mFillPos = offset - mFill->mFileOffset;
+        return;
+    }
+
+    if (mFill->mSize > 0) {
+        queueFill_l();
+        startBuffer_l(offset);
+    } else {
+        // nothing written to the buffer yet, move it
+        mFill->mFileOffset = offset;
+        mFill->mCapacity = kBufferSize - offset % kAlignment;
+        mFillPos = 0;
+    }
+}
+
+void AsyncFileWriter::write(const void *data, size_t size) {
+    Mutex::Autolock autoLock(mLock);
+    CHECK(mFill != NULL);
+
+    const uint8_t *ptr = (const uint8_t *)data;
+    while (size > 0) {
+        if (mFillPos == mFill->mCapacity) {
+            off64_t offset = mFill->mFileOffset + mFillPos;
+            queueFill_l();
+            startBuffer_l(offset);
+        }
+
+        size_t n = std::min(size, mFill->mCapacity - mFillPos);
+        memcpy(mFill->mData + mFillPos, ptr, n);
+        mFillPos += n;
+        if (mFillPos > mFill->mSize) {
+            mFill->mSize = mFillPos;
+        }
+        ptr += n;
+        size -= n;
+    }
+}
+
+void AsyncFileWriter::submit_l() {
+    if (mFill != NULL && mFill->mSize > 0) {
+        off64_t offset = mFill->mFileOffset + mFillPos;
+        queueFill_l();
+        startBuffer_l(offset);
+    }
+}
+
+void AsyncFileWriter::submit() {
+    Mutex::Autolock autoLock(mLock);
+    submit_l();
+}
+
+status_t AsyncFileWriter::flush() {
+    Mutex::Autolock autoLock(mLock);
+    submit_l();
+    while (!mQueue.empty()) {
+        mCondition.wait(mLock);
+    }
+    return mError;
+}
+
+status_t AsyncFileWriter::close() {
+    if (!mThreadStarted) {
+        return mInitCheck;
+    }
+
+    status_t err = flush();
+
+    {
+        Mutex::Autolock autoLock(mLock);
+        mExit = true;
+        mFill = NULL;
+        mCondition.broadcast();
+    }
+
+    void *dummy;
+    pthread_join(mThread, &dummy);
+    mThreadStarted = false;
+
+    if (mAllocatedEnd > mEnd && ftruncate64(mFd, mEnd) != 0) {
+        ALOGW("cannot trim preallocated file to %lld: %s",
+                (long long)mEnd, strerror(errno));
+    }
+    return err;
+}
+
+// static
+void *AsyncFileWriter::ThreadWrapper(void *me) {
+    static_cast<AsyncFileWriter *>(me)->threadFunc();
+    return NULL;
+}
+
+void AsyncFileWriter::threadFunc() {
+    prctl(PR_SET_NAME, (unsigned long)"AsyncFileWriter", 0, 0, 0);
+
+    Mutex::Autolock autoLock(mLock);
+    while (true) {
+        while (!mExit && mQueue.empty()) {
+            mCondition.wait(mLock);
+        }
+        if (mQueue.empty()) {
+            break;
+        }
+
+        // the caller does not touch queued buffers
+        Buffer *buffer = *mQueue.begin();
+        mLock.unlock();
+        int64_t startUs = ALooper::GetNowUs();
+        status_t err = writeBuffer(buffer);
+        int64_t latencyUs = ALooper::GetNowUs() - startUs;
+        mLock.lock();
+
+        mLatenciesUs[mNumWrites % kNumLatencies] = latencyUs;
+        ++mNumWrites;
+        mBytesWritten += buffer->mSize;
+        if (err != OK && mError == OK) {
+            mError = err;
+        }
+
+        buffer->mQueued = false;
+        mQueue.erase(mQueue.begin());
+        mCondition.broadcast();
+    }
+}
+
+status_t AsyncFileWriter::writeBuffer(const Buffer *buffer) {
+    off64_t end = buffer->mFileOffset + buffer->mSize;
+
+    if ((mFlags & kFlagPreallocate) && end > mAllocatedEnd) {
+        off64_t size = end + kPreallocateSize - mAllocatedEnd;
+        if (fallocate64(mFd, 0, mAllocatedEnd, size) == 0) {
+            mAllocatedEnd += size;
+        } else {
+            ALOGW("cannot preallocate, %s", strerror(errno));
+            mFlags &= ~kFlagPreallocate;
+        }
+    }
+
+    bool direct = (mFlags & kFlagDirectIo)
+            && buffer->mFileOffset % kAlignment == 0 && buffer->mSize % kAlignment == 0;
+    if (direct != mDirect) {
+        int fdFlags = fcntl(mFd, F_GETFL);
+        if (fdFlags >= 0 && fcntl(mFd, F_SETFL,
+                direct ? fdFlags | O_DIRECT : fdFlags & ~O_DIRECT) == 0) {
+            mDirect = direct;
+        } else if (direct) {
+            ALOGW("cannot use O_DIRECT, %s", strerror(errno));
+            mFlags &= ~kFlagDirectIo;
+        }
+    }
+
+    const uint8_t *data = buffer->mData;
+    size_t size = buffer->mSize;
+    off64_t offset = buffer->mFileOffset;
+    while (size > 0) {
+        ssize_t n = pwrite64(mFd, data, size, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EINVAL && mDirect) {
+                // not supported by this file system after all
+                int fdFlags = fcntl(mFd, F_GETFL);
+                if (fdFlags >= 0 && fcntl(mFd, F_SETFL, fdFlags & ~O_DIRECT) == 0) {
+                    ALOGW("O_DIRECT write failed, falling back to buffered writes");
+                    mDirect = false;
+                    mFlags &= ~kFlagDirectIo;
+                    continue;
+                }
+            }
+            ALOGE("write of %zu bytes at %lld failed: %s",
+                    size, (long long)offset, strerror(errno));
+            return -errno;
+        }
+        data += n;
+        size -= n;
+        offset += n;
+    }
+
+    if (end > mEnd) {
+        mEnd = end;
+    }
+    return OK;
+}
+
+void AsyncFileWriter::dump(String8 *result) const {
+    Mutex::Autolock autoLock(mLock);
+
+    size_t count = std::min(mNumWrites, (uint64_t)kNumLatencies);
+    int64_t latenciesUs[kNumLatencies];
+    memcpy(latenciesUs, mLatenciesUs, count * sizeof(latenciesUs[0]));
+    std::sort(latenciesUs, latenciesUs + count);
+
+    result->appendFormat("     writes: %" PRIu64 ", %" PRIu64 " bytes\n",
+            mNumWrites, mBytesWritten);
+    if (count > 0) {
+        result->appendFormat(
+                "     write latency of the last %zu (us): "
+                "p50 %" PRId64 ", p90 %" PRId64 ", p99 %" PRId64 ", max %" PRId64 "\n",
+                count, latenciesUs[count / 2], latenciesUs[count * 9 / 10],
+                latenciesUs[count * 99 / 100], latenciesUs[count - 1]);
+    }
+    if (mError != OK) {
+        result->appendFormat("     write error: %d\n", mError);
+    }
+}
+
+}  // namespace android
@@ -26,12 +26,16 @@
 
 #include <algorithm>
 
+#include <stdlib.h>
+#include <string.h>
+
 namespace android {
 
 CallbackDataSource::CallbackDataSource(
     const sp<IDataSource>& binderDataSource)
     : mIDataSource(binderDataSource),
-      mIsClosed(false) {
+      mIsClosed(false),
+      mRangesSupported(true) {
     // Set up the buffer to read into.
     mMemory = mIDataSource->getIMemory();
     mName = String8::format("CallbackDataSource(%s)", mIDataSource->toString().string());
@@ -85,6 +89,53 @@ ssize_t CallbackDataSource::readAt(off64_t offset, void* data, size_t size) {
     return totalNumRead;
 }
 
+void CallbackDataSource::readRanges(Range *ranges, size_t count) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += ranges[i].mSize;
+    }
+
+    if (mRangesSupported && mMemory != NULL && count > 1
+            && count <= IDataSource::kMaxRanges && total <= mMemory->size()) {
+        off64_t offsets[IDataSource::kMaxRanges];
+        size_t sizes[IDataSource::kMaxRanges];
+        ssize_t results[IDataSource::kMaxRanges];
+        for (size_t i = 0; i < count; ++i) {
+            offsets[i] = ranges[i].mOffset;
+            sizes[i] = ranges[i].mSize;
+        }
+
+        status_t err = mIDataSource->readRangesAt(offsets, sizes, count, results);
+        if (err == OK) {
+            const uint8_t *src = (const uint8_t *)mMemory->pointer();
+            for (size_t i = 0; i < count; ++i) {
+                ssize_t numRead = results[i];
+                if (numRead > (ssize_t)sizes[i]) {
+                    numRead = ERROR_OUT_OF_RANGE;
+                } else if (numRead > 0) {
+                    memcpy(ranges[i].mData, src, numRead);
+                }
+                ranges[i].mResult = numRead;
+                src += sizes[i];
+            }
+            return;
+        }
+
+        ALOGV("readRangesAt failed (%d), reading the ranges one by one", err);
+        if (err == UNKNOWN_TRANSACTION) {
+            mRangesSupported = false;
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        ranges[i].mResult = readAt(ranges[i].mOffset, ranges[i].mData, ranges[i].mSize);
+    }
+}
+
+size_t CallbackDataSource::getBufferSize() const {
+    return mMemory != NULL ? mMemory->size() : 0;
+}
+
 status_t CallbackDataSource::getSize(off64_t *size) {
     status_t err = mIDataSource->getSize(size);
     if (err != OK) {
@@ -117,66 +168,151 @@ sp<IDataSource> CallbackDataSource::getIDataSource() const {
     return mIDataSource;
 }
 
-TinyCacheSource::TinyCacheSource(const sp<DataSource>& source)
-    : mSource(source), mCachedOffset(0), mCachedSize(0) {
+TinyCacheSource::TinyCacheSource(const sp<CallbackDataSource>& source)
+    : mSource(source),
+      mUseCount(0),
+      mReadAhead(kMinReadAhead),
+      mLastMissOffset(-1),
+      mLastStride(0) {
+    memset(mSegments, 0, sizeof(mSegments));
+
+    // Two segments must fit the shared memory, to fill both in one read.
+    mMaxReadAhead = std::max((size_t)kMinReadAhead,
+            std::min((size_t)kMaxReadAhead, mSource->getBufferSize() / 2));
+
     mName = String8::format("TinyCacheSource(%s)", mSource->toString().string());
 }
 
+TinyCacheSource::~TinyCacheSource() {
+    for (size_t i = 0; i < kNumSegments; ++i) {
+        free(mSegments[i].mData);
+        mSegments[i].mData = NULL;
+    }
+}
+
 status_t TinyCacheSource::initCheck() const {
     return mSource->initCheck();
 }
 
-ssize_t TinyCacheSource::readAt(off64_t offset, void* data, size_t size) {
-    if (size >= kCacheSize) {
-        return mSource->readAt(offset, data, size);
+TinyCacheSource::Segment *TinyCacheSource::findSegment(off64_t offset) {
+    for (size_t i = 0; i < kNumSegments; ++i) {
+        Segment *segment = &mSegments[i];
+        if (segment->mSize > 0 && segment->mOffset <= offset
+                && offset < (off64_t)(segment->mOffset + segment->mSize)) {
+            return segment;
+        }
     }
+    return NULL;
+}
 
-    // Check if the cache satisfies the read.
-    if (mCachedOffset <= offset
-            && offset < (off64_t) (mCachedOffset + mCachedSize)) {
-        if (offset + size <= mCachedOffset + mCachedSize) {
-            memcpy(data, &mCache[offset - mCachedOffset], size);
-            return size;
-        } else {
-            // If the cache hits only partially, flush the cache and read the
-            // remainder.
-
-            // This value is guaranteed to be greater than 0 because of the
-            // enclosing if statement.
-            const ssize_t remaining = mCachedOffset + mCachedSize - offset;
-            memcpy(data, &mCache[offset - mCachedOffset], remaining);
-            const ssize_t readMore = readAt(offset + remaining,
-                    (uint8_t*)data + remaining, size - remaining);
-            if (readMore < 0) {
-                return readMore;
-            }
-            return remaining + readMore;
+TinyCacheSource::Segment *TinyCacheSource::leastRecentlyUsed(const Segment *exclude) {
+    Segment *lru = NULL;
+    for (size_t i = 0; i < kNumSegments; ++i) {
+        Segment *segment = &mSegments[i];
+        if (segment != exclude && (lru == NULL || segment->mLastUse < lru->mLastUse)) {
+            lru = segment;
+        }
+    }
+
+    if (lru->mData == NULL) {
+        lru->mData = (uint8_t *)malloc(mMaxReadAhead);
+        if (lru->mData == NULL) {
+            return NULL;
+        }
+    }
+    lru->mSize = 0;
+    return lru;
+}
+
+void TinyCacheSource::flush() {
+    for (size_t i = 0; i < kNumSegments; ++i) {
+        mSegments[i].mOffset = 0;
+        mSegments[i].mSize = 0;
+    }
+    mReadAhead = kMinReadAhead;
+    mLastMissOffset = -1;
+    mLastStride = 0;
+}
+
+ssize_t TinyCacheSource::fill(off64_t offset) {
+    bool sequential = false;
+    for (size_t i = 0; i < kNumSegments; ++i) {
+        if (mSegments[i].mSize > 0
+                && (off64_t)(mSegments[i].mOffset + mSegments[i].mSize) == offset) {
+            sequential = true;
+        }
+    }
+    mReadAhead = sequential ? std::min(2 * mReadAhead, mMaxReadAhead) : (size_t)kMinReadAhead;
+
+    off64_t stride = mLastMissOffset >= 0 ? offset - mLastMissOffset : 0;
+    bool predict = !sequential && stride == mLastStride
+            && (stride >= (off64_t)mReadAhead || -stride >= (off64_t)mReadAhead)
+            && offset + stride >= 0 && findSegment(offset + stride) == NULL;
+    mLastMissOffset = offset;
+    mLastStride = stride;
+
+    CallbackDataSource::Range ranges[2];
+    Segment *segments[2];
+    size_t count = predict ? 2 : 1;
+    for (size_t i = 0; i < count; ++i) {
+        segments[i] = leastRecentlyUsed(i > 0 ? segments[0] : NULL);
+        if (segments[i] == NULL) {
+            return NO_MEMORY;
         }
+        ranges[i].mOffset = offset + i * stride;
+        ranges[i].mSize = mReadAhead;
+        ranges[i].mData = segments[i]->mData;
+        segments[i]->mLastUse = ++mUseCount;
     }
 
+    mSource->readRanges(ranges, count);
+
+    for (size_t i = 0; i < count; ++i) {
+        ssize_t numRead = ranges[i].mResult;
+        if (numRead > (ssize_t)mReadAhead) {
+            numRead = ERROR_OUT_OF_RANGE;
+        }
+        if (numRead > 0) {
+            segments[i]->mOffset = ranges[i].mOffset;
+            segments[i]->mSize = numRead;
+        }
+        ranges[i].mResult = numRead;
+    }
+    return ranges[0].mResult;
+}
 
-    // Fill the cache and copy to the caller.
-    const ssize_t numRead = mSource->readAt(offset, mCache, kCacheSize);
-    if (numRead <= 0) {
-        // Flush cache on error
-        mCachedSize = 0;
-        mCachedOffset = 0;
-        return numRead;
+ssize_t TinyCacheSource::readAt(off64_t offset, void* data, size_t size) {
+    if (size >= mReadAhead) {
+        return mSource->readAt(offset, data, size);
     }
-    if ((size_t)numRead > kCacheSize) {
-        // Flush cache on error
-        mCachedSize = 0;
-        mCachedOffset = 0;
-        return ERROR_OUT_OF_RANGE;
+
+    Segment *segment = findSegment(offset);
+    if (segment == NULL) {
+        ssize_t numRead = fill(offset);
+        if (numRead == NO_MEMORY) {
+            return mSource->readAt(offset, data, size);
+        } else if (numRead <= 0) {
+            return numRead;
+        }
+        segment = findSegment(offset);
+        CHECK(segment != NULL);
     }
+    segment->mLastUse = ++mUseCount;
 
-    mCachedSize = numRead;
-    mCachedOffset = offset;
-    CHECK(mCachedSize <= kCacheSize && mCachedOffset >= 0);
-    const size_t numToReturn = std::min(size, (size_t)numRead);
-    memcpy(data, mCache, numToReturn);
+    const size_t available = segment->mOffset + segment->mSize - offset;
+    if (size <= available) {
+        memcpy(data, &segment->mData[offset - segment->mOffset], size);
+        return size;
+    }
 
-    return numToReturn;
+    // If the cache hits only partially, read the remainder.
+    memcpy(data, &segment->mData[offset - segment->mOffset], available);
+    const ssize_t readMore = readAt(offset + available,
+            (uint8_t*)data + available, size - available);
+    if (readMore < 0) {
+        return readMore;
+    }
+    return available + readMore;
 }
 
 status_t TinyCacheSource::getSize(off64_t *size) {
@@ -190,8 +326,7 @@ uint32_t TinyCacheSource::flags() {
 sp<DecryptHandle> TinyCacheSource::DrmInitialization(const char *mime) {
     // flush cache when DrmInitialization occurs since decrypted
     // data may differ from what is in cache.
-    mCachedOffset = 0;
-    mCachedSize = 0;
+    flush();
     return mSource->DrmInitialization(mime);
 }
 
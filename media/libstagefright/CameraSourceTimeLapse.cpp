@@ -94,6 +94,10 @@ CameraSourceTimeLapse::CameraSourceTimeLapse(
         mInitCheck = NO_INIT;
     }
 
+    if (OK == mInitCheck) {
+        trySettingCaptureFpsRange();
+    }
+
     // Initialize quick stop variables.
     mQuickStop = false;
     mForceRead = false;
@@ -168,6 +172,52 @@ bool CameraSourceTimeLapse::trySettingVideoSize(
     return isSuccessful;
 }
 
+void CameraSourceTimeLapse::trySettingCaptureFpsRange() {
+    ALOGV("trySettingCaptureFpsRange");
+    if (mTimeBetweenFrameCaptureUs <= 0) {
+        return;
+    }
+    // fps ranges are in frames per 1000 seconds
+    const int64_t captureFps = (1000000000LL + mTimeBetweenFrameCaptureUs - 1)
+            / mTimeBetweenFrameCaptureUs;
+
+    int64_t token = IPCThreadState::self()->clearCallingIdentity();
+    CameraParameters params(mCamera->getParameters());
+
+    int currentMin = -1, currentMax = -1;
+    params.getPreviewFpsRange(&currentMin, &currentMax);
+
+    // The supported ranges are sorted by maximum, then minimum fps, e.g.
+    // "(10500,26623),(15000,26623),(30000,30000)". Pick the first one fast enough.
+    const char *ranges = params.get(CameraParameters::KEY_SUPPORTED_PREVIEW_FPS_RANGE);
+    int bestMin = -1, bestMax = -1;
+    while (ranges != NULL && (ranges = strchr(ranges, '(')) != NULL) {
+        int min, max;
+        if (sscanf(ranges, "(%d,%d)", &min, &max) != 2) {
+            break;
+        }
+        if (max >= captureFps) {
+            bestMin = min;
+            bestMax = max;
+            break;
+        }
+        ranges++;
+    }
+
+    if (bestMax > 0 && (currentMax <= 0 || bestMax < currentMax)) {
+        String8 range = String8::format("%d,%d", bestMin, bestMax);
+        params.set(CameraParameters::KEY_PREVIEW_FPS_RANGE, range.string());
+        if (mCamera->setParameters(params.flatten()) == OK) {
+            ALOGD("time lapse capture fps range %s, was %d,%d",
+                    range.string(), currentMin, currentMax);
+        } else {
+            ALOGW("Failed to set time lapse capture fps range %s", range.string());
+        }
+    }
+
+    IPCThreadState::self()->restoreCallingIdentity(token);
+}
+
 void CameraSourceTimeLapse::signalBufferReturned(MediaBuffer* buffer) {
     ALOGV("signalBufferReturned");
     Mutex::Autolock autoLock(mQuickStopLock);
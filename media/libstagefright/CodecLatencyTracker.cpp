@@ -0,0 +1,224 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "CodecLatencyTracker"
+#include <utils/Log.h>
+
+#include <string.h>
+
+#include <cutils/properties.h>
+#include <media/MediaAnalyticsItem.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/CodecLatencyTracker.h>
+
+namespace android {
+
+static const char *kStageNames[CodecLatencyTracker::kNumStages] = {
+    "empty", "fill", "decode", "render", "display",
+};
+
+CodecLatencyTracker::CodecLatencyTracker()
+    : mEnabled(property_get_bool("media.stagefright.codec-latency", false)) {
+    memset(mHistograms, 0, sizeof(mHistograms));
+}
+
+void CodecLatencyTracker::onEmptyBuffer(uint32_t bufferId, int64_t mediaTimeUs) {
+    if (!mEnabled) {
+        return;
+    }
+    int64_t nowUs = ALooper::GetNowUs();
+    Mutex::Autolock autoLock(mLock);
+    mEmptyTimesUs.add(bufferId, nowUs);
+    AddMediaTimeStamp(&mEmptyTimesUsByMediaTime, mediaTimeUs, nowUs);
+}
+
+void CodecLatencyTracker::onEmptyBufferDone(uint32_t bufferId) {
+    if (!mEnabled) {
+        return;
+    }
+    int64_t nowUs = ALooper::GetNowUs();
+    Mutex::Autolock autoLock(mLock);
+    int64_t emptyTimeUs;
+    if (TakeStamp(&mEmptyTimesUs, bufferId, &emptyTimeUs)) {
+        addLatency(kStageEmpty, nowUs - emptyTimeUs);
+    }
+}
+
+void CodecLatencyTracker::onFillBuffer(uint32_t bufferId) {
+    if (!mEnabled) {
+        return;
+    }
+    int64_t nowUs = ALooper::GetNowUs();
+    Mutex::Autolock autoLock(mLock);
+    mFillTimesUs.add(bufferId, nowUs);
+}
+
+void CodecLatencyTracker::onFillBufferDone(uint32_t bufferId, int64_t mediaTimeUs) {
+    if (!mEnabled) {
+        return;
+    }
+    int64_t nowUs = ALooper::GetNowUs();
+    Mutex::Autolock autoLock(mLock);
+    int64_t timeUs;
+    if (TakeStamp(&mFillTimesUs, bufferId, &timeUs)) {
+        addLatency(kStageFill, nowUs - timeUs);
+    }
+    ssize_t index = mEmptyTimesUsByMediaTime.indexOfKey(mediaTimeUs);
+    if (index >= 0) {
+        addLatency(kStageDecode, nowUs - mEmptyTimesUsByMediaTime.valueAt(index));
+        mEmptyTimesUsByMediaTime.removeItemsAt(index);
+    }
+    mFillDoneTimesUs.add(bufferId, nowUs);
+    AddMediaTimeStamp(&mFillDoneTimesUsByMediaTime, mediaTimeUs, nowUs);
+}
+
+void CodecLatencyTracker::onRenderRequested(uint32_t bufferId) {
+    if (!mEnabled) {
+        return;
+    }
+    int64_t nowUs = ALooper::GetNowUs();
+    Mutex::Autolock autoLock(mLock);
+    int64_t fillDoneTimeUs;
+    if (TakeStamp(&mFillDoneTimesUs, bufferId, &fillDoneTimeUs)) {
+        addLatency(kStageRender, nowUs - fillDoneTimeUs);
+    }
+}
+
+void CodecLatencyTracker::onFrameDisplayed(int64_t mediaTimeUs, nsecs_t renderTimeNs) {
+    if (!mEnabled) {
+        return;
+    }
+    Mutex::Autolock autoLock(mLock);
+    ssize_t index = mFillDoneTimesUsByMediaTime.indexOfKey(mediaTimeUs);
+    if (index >= 0) {
+        // both on CLOCK_MONOTONIC
+        addLatency(kStageDisplay,
+                renderTimeNs / 1000 - mFillDoneTimesUsByMediaTime.valueAt(index));
+        mFillDoneTimesUsByMediaTime.removeItemsAt(index);
+    }
+}
+
+void CodecLatencyTracker::clearPending() {
+    if (!mEnabled) {
+        return;
+    }
+    Mutex::Autolock autoLock(mLock);
+    mEmptyTimesUs.clear();
+    mFillTimesUs.clear();
+    mFillDoneTimesUs.clear();
+    mEmptyTimesUsByMediaTime.clear();
+    mFillDoneTimesUsByMediaTime.clear();
+}
+
+void CodecLatencyTracker::addLatency(Stage stage, int64_t latencyUs) {
+    if (latencyUs < 0) {
+        latencyUs = 0;
+    }
+    Histogram *histogram = &mHistograms[stage];
+    int64_t ms = latencyUs / 1000;
+    size_t bucket = 0;
+    if (ms > 0) {
+        bucket = 64 - __builtin_clzll((uint64_t)ms);
+        if (bucket >= kNumBuckets) {
+            bucket = kNumBuckets - 1;
+        }
+    }
+    ++histogram->mBuckets[bucket];
+    ++histogram->mCount;
+    histogram->mTotalUs += latencyUs;
+    if (latencyUs > histogram->mMaxUs) {
+        histogram->mMaxUs = latencyUs;
+    }
+}
+
+// static
+bool CodecLatencyTracker::TakeStamp(
+        KeyedVector<uint32_t, int64_t> *stamps, uint32_t key, int64_t *timeUs) {
+    ssize_t index = stamps->indexOfKey(key);
+    if (index < 0) {
+        return false;
+    }
+    *timeUs = stamps->valueAt(index);
+    stamps->removeItemsAt(index);
+    return true;
+}
+
+// static
+void CodecLatencyTracker::AddMediaTimeStamp(
+        KeyedVector<int64_t, int64_t> *stamps, int64_t mediaTimeUs, int64_t timeUs) {
+    // Media times that never come out, e.g. of frames that the codec drops,
+    // must not pile up.
+    if (stamps->size() >= kMaxPendingMediaTimes) {
+        stamps->removeItemsAt(0);
+    }
+    stamps->add(mediaTimeUs, timeUs);
+}
+
+void CodecLatencyTracker::dump(AString *out) const {
+    Mutex::Autolock autoLock(mLock);
+    for (size_t i = 0; i < kNumStages; ++i) {
+        const Histogram &histogram = mHistograms[i];
+        if (histogram.mCount == 0) {
+            continue;
+        }
+        out->append(AStringPrintf("%s: %llu buffers, avg %lld us, max %lld us, ms:",
+                kStageNames[i], (unsigned long long)histogram.mCount,
+                (long long)(histogram.mTotalUs / (int64_t)histogram.mCount),
+                (long long)histogram.mMaxUs));
+        for (size_t j = 0; j < kNumBuckets; ++j) {
+            if (histogram.mBuckets[j] != 0) {
+                out->append(AStringPrintf(" %s%d=%u",
+                        j == 0 ? "<" : j + 1 == kNumBuckets ? ">=" : "",
+                        j == 0 ? 1 : 1 << (j - 1), histogram.mBuckets[j]));
+            }
+        }
+        out->append("\n");
+    }
+}
+
+void CodecLatencyTracker::exportMetrics(MediaAnalyticsItem *item) const {
+    if (!mEnabled || item == NULL) {
+        return;
+    }
+    Mutex::Autolock autoLock(mLock);
+    for (size_t i = 0; i < kNumStages; ++i) {
+        const Histogram &histogram = mHistograms[i];
+        if (histogram.mCount == 0) {
+            continue;
+        }
+        const char *stage = kStageNames[i];
+        item->setInt64(AStringPrintf(
+                "android.media.mediacodec.latency.%s.count", stage).c_str(),
+                histogram.mCount);
+        item->setInt64(AStringPrintf(
+                "android.media.mediacodec.latency.%s.avg", stage).c_str(),
+                histogram.mTotalUs / (int64_t)histogram.mCount);
+        item->setInt64(AStringPrintf(
+                "android.media.mediacodec.latency.%s.max", stage).c_str(),
+                histogram.mMaxUs);
+
+        AString buckets;
+        for (size_t j = 0; j < kNumBuckets; ++j) {
+            buckets.append(AStringPrintf(j == 0 ? "%u" : ",%u", histogram.mBuckets[j]));
+        }
+        item->setCString(AStringPrintf(
+                "android.media.mediacodec.latency.%s.hist", stage).c_str(),
+                buckets.c_str());
+    }
+}
+
+}  // namespace android
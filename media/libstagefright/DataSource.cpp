@@ -153,10 +153,32 @@ sp<DataSource> DataSource::CreateFromURI(
             *contentType = httpSource->getMIMEType();
         }
 
+        // Further connections fetch ahead in parallel, as ranges of a
+        // source of known size.
+        Vector<sp<DataSource> > rangeConnections;
+        int32_t numConnections =
+            property_get_int32("media.stagefright.cache-connections", 1);
+        off64_t size;
+        if (numConnections > 1 && httpSource->getSize(&size) == OK) {
+            for (int32_t i = 1; i < numConnections; ++i) {
+                sp<IMediaHTTPConnection> conn = httpService->makeHTTPConnection();
+                if (conn == NULL) {
+                    break;
+                }
+                sp<HTTPBase> rangeSource = new MediaHTTP(conn);
+                if (rangeSource->connect(uri, &nonCacheSpecificHeaders) != OK) {
+                    ALOGW("Failed to connect range source %d", i);
+                    break;
+                }
+                rangeConnections.push(rangeSource);
+            }
+        }
+
         source = NuCachedSource2::Create(
                 httpSource,
                 cacheConfig.isEmpty() ? NULL : cacheConfig.string(),
-                disconnectAtHighwatermark);
+                disconnectAtHighwatermark,
+                rangeConnections.empty() ? NULL : &rangeConnections);
     } else if (!strncasecmp("data:", uri, 5)) {
         source = DataURISource::Create(uri);
     } else {
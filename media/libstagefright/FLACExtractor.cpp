@@ -24,6 +24,11 @@
 // libFLAC parser
 #include "FLAC/stream_decoder.h"
 
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include <cutils/properties.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/DataSource.h>
 #include <media/stagefright/MediaBufferGroup.h>
@@ -75,6 +80,7 @@ class FLACParser : public RefBase {
 public:
     enum {
         kMaxChannels = 8,
+        kReadBufferSize = 64 * 1024,
     };
 
     explicit FLACParser(
@@ -127,6 +133,8 @@ private:
     size_t mMaxBufferSize;
     MediaBufferGroup *mGroup;
     void (*mCopy)(short *dst, const int * src[kMaxChannels], unsigned nSamples, unsigned nChannels);
+    // output float samples instead of 16-bit, keeping all bits of 24-bit streams
+    bool mOutputFloat;
 
     // handle to underlying libFLAC parser
     FLAC__StreamDecoder *mDecoder;
@@ -135,6 +143,12 @@ private:
     off64_t mCurrentPos;
     bool mEOF;
 
+    // libFLAC reads a few KB at a time; the data source is read ahead in
+    // blocks of kReadBufferSize, which start at mReadBufferPos
+    uint8_t *mReadBuffer;
+    off64_t mReadBufferPos;
+    size_t mReadBufferSize;
+
     // cached when the STREAMINFO metadata is parsed by libFLAC
     FLAC__StreamMetadata_StreamInfo mStreamInfo;
     bool mStreamInfoValid;
@@ -272,6 +286,27 @@ FLAC__StreamDecoderReadStatus FLACParser::readCallback(
         FLAC__byte buffer[], size_t *bytes)
 {
     size_t requested = *bytes;
+    if (mCurrentPos >= mReadBufferPos
+            && mCurrentPos < mReadBufferPos + (off64_t)mReadBufferSize) {
+        size_t offset = mCurrentPos - mReadBufferPos;
+        size_t actual = mReadBufferSize - offset;
+        if (actual > requested) {
+            actual = requested;
+        }
+        memcpy(buffer, mReadBuffer + offset, actual);
+        *bytes = actual;
+        mCurrentPos += actual;
+        return FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
+    }
+    if (requested < kReadBufferSize) {
+        ssize_t n = mDataSource->readAt(mCurrentPos, mReadBuffer, kReadBufferSize);
+        if (n > 0) {
+            mReadBufferPos = mCurrentPos;
+            mReadBufferSize = n;
+            return readCallback(buffer, bytes);
+        }
+        mReadBufferSize = 0;
+    }
     ssize_t actual = mDataSource->readAt(mCurrentPos, buffer, requested);
     if (0 > actual) {
         *bytes = 0;
@@ -429,7 +464,17 @@ static void copyStereo16(
         const int * src[FLACParser::kMaxChannels],
         unsigned nSamples,
         unsigned /* nChannels */) {
-    for (unsigned i = 0; i < nSamples; ++i) {
+    unsigned i = 0;
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+    for (; i + 4 <= nSamples; i += 4) {
+        int16x4x2_t lr;
+        lr.val[0] = vmovn_s32(vld1q_s32(src[0] + i));
+        lr.val[1] = vmovn_s32(vld1q_s32(src[1] + i));
+        vst2_s16(dst, lr);
+        dst += 8;
+    }
+#endif
+    for (; i < nSamples; ++i) {
         *dst++ = src[0][i];
         *dst++ = src[1][i];
     }
@@ -461,7 +506,17 @@ static void copyStereo24(
         const int * src[FLACParser::kMaxChannels],
         unsigned nSamples,
         unsigned /* nChannels */) {
-    for (unsigned i = 0; i < nSamples; ++i) {
+    unsigned i = 0;
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+    for (; i + 4 <= nSamples; i += 4) {
+        int16x4x2_t lr;
+        lr.val[0] = vshrn_n_s32(vld1q_s32(src[0] + i), 8);
+        lr.val[1] = vshrn_n_s32(vld1q_s32(src[1] + i), 8);
+        vst2_s16(dst, lr);
+        dst += 8;
+    }
+#endif
+    for (; i < nSamples; ++i) {
         *dst++ = src[0][i] >> 8;
         *dst++ = src[1][i] >> 8;
     }
@@ -476,6 +531,41 @@ static void copyMultiCh24(short *dst, const int * src[FLACParser::kMaxChannels],
     }
 }
 
+// Copy samples from FLAC native 32-bit non-interleaved to float interleaved,
+// scaled to [-1.0, 1.0).
+
+static void copyToFloat(
+        float *dst,
+        const int * src[FLACParser::kMaxChannels],
+        unsigned nSamples,
+        unsigned nChannels,
+        unsigned bitsPerSample) {
+    const float scale = 1.0f / (1 << (bitsPerSample - 1));
+    if (nChannels == 2) {
+        unsigned i = 0;
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+        const float32x4_t vscale = vdupq_n_f32(scale);
+        for (; i + 4 <= nSamples; i += 4) {
+            float32x4x2_t lr;
+            lr.val[0] = vmulq_f32(vcvtq_f32_s32(vld1q_s32(src[0] + i)), vscale);
+            lr.val[1] = vmulq_f32(vcvtq_f32_s32(vld1q_s32(src[1] + i)), vscale);
+            vst2q_f32(dst, lr);
+            dst += 8;
+        }
+#endif
+        for (; i < nSamples; ++i) {
+            *dst++ = src[0][i] * scale;
+            *dst++ = src[1][i] * scale;
+        }
+        return;
+    }
+    for (unsigned i = 0; i < nSamples; ++i) {
+        for (unsigned c = 0; c < nChannels; ++c) {
+            *dst++ = src[c][i] * scale;
+        }
+    }
+}
+
 static void copyTrespass(
         short * /* dst */,
         const int *[FLACParser::kMaxChannels] /* src */,
@@ -497,9 +587,13 @@ FLACParser::FLACParser(
       mMaxBufferSize(0),
       mGroup(NULL),
       mCopy(copyTrespass),
+      mOutputFloat(property_get_bool("media.stagefright.flac.float", false)),
       mDecoder(NULL),
       mCurrentPos(0LL),
       mEOF(false),
+      mReadBuffer(new uint8_t[kReadBufferSize]),
+      mReadBufferPos(0LL),
+      mReadBufferSize(0),
       mStreamInfoValid(false),
       mWriteRequested(false),
       mWriteCompleted(false),
@@ -518,6 +612,7 @@ FLACParser::~FLACParser()
         FLAC__stream_decoder_delete(mDecoder);
         mDecoder = NULL;
     }
+    delete[] mReadBuffer;
 }
 
 status_t FLACParser::init()
@@ -618,7 +713,8 @@ status_t FLACParser::init()
             mTrackMetadata->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_RAW);
             mTrackMetadata->setInt32(kKeyChannelCount, getChannels());
             mTrackMetadata->setInt32(kKeySampleRate, getSampleRate());
-            mTrackMetadata->setInt32(kKeyPcmEncoding, kAudioEncodingPcm16bit);
+            mTrackMetadata->setInt32(kKeyPcmEncoding,
+                    mOutputFloat ? kAudioEncodingPcmFloat : kAudioEncodingPcm16bit);
             // sample rate is non-zero, so division by zero not possible
             mTrackMetadata->setInt64(kKeyDuration,
                     (getTotalSamples() * 1000000LL) / getSampleRate());
@@ -637,7 +733,8 @@ void FLACParser::allocateBuffers()
 {
     CHECK(mGroup == NULL);
     mGroup = new MediaBufferGroup;
-    mMaxBufferSize = getMaxBlockSize() * getChannels() * sizeof(short);
+    mMaxBufferSize = getMaxBlockSize() * getChannels()
+            * (mOutputFloat ? sizeof(float) : sizeof(short));
     mGroup->add_buffer(new MediaBuffer(mMaxBufferSize));
 }
 
@@ -690,12 +787,17 @@ MediaBuffer *FLACParser::readBuffer(bool doSeek, FLAC__uint64 sample)
     if (err != OK) {
         return NULL;
     }
-    size_t bufferSize = blocksize * getChannels() * sizeof(short);
+    size_t bufferSize = blocksize * getChannels()
+            * (mOutputFloat ? sizeof(float) : sizeof(short));
     CHECK(bufferSize <= mMaxBufferSize);
-    short *data = (short *) buffer->data();
     buffer->set_range(0, bufferSize);
     // copy PCM from FLAC write buffer to our media buffer, with interleaving
-    (*mCopy)(data, mWriteBuffer, blocksize, getChannels());
+    if (mOutputFloat) {
+        copyToFloat((float *) buffer->data(), mWriteBuffer, blocksize, getChannels(),
+                getBitsPerSample());
+    } else {
+        (*mCopy)((short *) buffer->data(), mWriteBuffer, blocksize, getChannels());
+    }
     // fill in buffer metadata
     CHECK(mWriteHeader.number_type == FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER);
     FLAC__uint64 sampleNumber = mWriteHeader.number.sample_number;
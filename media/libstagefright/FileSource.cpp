@@ -18,10 +18,12 @@
 #define LOG_TAG "FileSource"
 #include <utils/Log.h>
 
+#include <cutils/properties.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/FileSource.h>
 #include <media/stagefright/Utils.h>
 #include <private/android_filesystem_config.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <sys/types.h>
@@ -35,6 +37,9 @@ FileSource::FileSource(const char *filename)
       mOffset(0),
       mLength(-1),
       mName("<null>"),
+      mMapping(NULL),
+      mMappingSize(0),
+      mMappingDelta(0),
       mDecryptHandle(NULL),
       mDrmManagerClient(NULL),
       mDrmBufOffset(0),
@@ -52,6 +57,10 @@ FileSource::FileSource(const char *filename)
     } else {
         ALOGE("Failed to open file '%s'. (%s)", filename, strerror(errno));
     }
+
+    if (mFd >= 0 && property_get_bool("media.stagefright.file-mmap", false)) {
+        map();
+    }
 }
 
 FileSource::FileSource(int fd, int64_t offset, int64_t length)
@@ -59,6 +68,9 @@ FileSource::FileSource(int fd, int64_t offset, int64_t length)
       mOffset(offset),
       mLength(length),
       mName("<null>"),
+      mMapping(NULL),
+      mMappingSize(0),
+      mMappingDelta(0),
       mDecryptHandle(NULL),
       mDrmManagerClient(NULL),
       mDrmBufOffset(0),
@@ -98,9 +110,17 @@ FileSource::FileSource(int fd, int64_t offset, int64_t length)
             (long long) mOffset,
             (long long) mLength);
 
+    if (property_get_bool("media.stagefright.file-mmap", false)) {
+        map();
+    }
 }
 
 FileSource::~FileSource() {
+    if (mMapping != NULL) {
+        munmap(mMapping, mMappingSize);
+        mMapping = NULL;
+    }
+
     if (mFd >= 0) {
         ::close(mFd);
         mFd = -1;
@@ -128,6 +148,47 @@ status_t FileSource::initCheck() const {
     return mFd >= 0 ? OK : NO_INIT;
 }
 
+status_t FileSource::map() {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mMapping != NULL) {
+        return OK;
+    }
+
+    struct stat s;
+    if (mFd < 0 || fstat(mFd, &s) != 0 || !S_ISREG(s.st_mode) || mLength <= 0) {
+        return INVALID_OPERATION;
+    }
+
+    // Leave room in the address space of 32 bit processes.
+    const uint64_t kMaxMappingSize =
+        sizeof(void *) == 4 ? 256 * 1024 * 1024 : UINT64_C(64) * 1024 * 1024 * 1024;
+
+    off64_t pageSize = sysconf(_SC_PAGESIZE);
+    off64_t start = mOffset - mOffset % pageSize;
+    uint64_t size = (uint64_t)(mOffset - start) + mLength;
+    if (size > kMaxMappingSize) {
+        ALOGV("not mapping %lld bytes", (long long)size);
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    void *mapping = mmap64(NULL, size, PROT_READ, MAP_SHARED, mFd, start);
+    if (mapping == MAP_FAILED) {
+        ALOGW("cannot map %s: %s", mName.string(), strerror(errno));
+        return UNKNOWN_ERROR;
+    }
+
+    mMapping = (uint8_t *)mapping;
+    mMappingSize = size;
+    mMappingDelta = mOffset - start;
+    return OK;
+}
+
+bool FileSource::isDrmContainer() const {
+    return mDecryptHandle != NULL
+        && mDecryptHandle->decryptApiType == DecryptApiType::CONTAINER_BASED;
+}
+
 ssize_t FileSource::readAt(off64_t offset, void *data, size_t size) {
     if (mFd < 0) {
         return NO_INIT;
@@ -145,10 +206,12 @@ ssize_t FileSource::readAt(off64_t offset, void *data, size_t size) {
         }
     }
 
-    if (mDecryptHandle != NULL && DecryptApiType::CONTAINER_BASED
-            == mDecryptHandle->decryptApiType) {
+    if (isDrmContainer()) {
         return readAtDRM(offset, data, size);
-   } else {
+    } else if (mMapping != NULL && offset >= 0) {
+        memcpy(data, mMapping + mMappingDelta + offset, size);
+        return size;
+    } else {
         off64_t result = lseek64(mFd, offset + mOffset, SEEK_SET);
         if (result == -1) {
             ALOGE("seek to %lld failed", (long long)(offset + mOffset));
@@ -159,6 +222,45 @@ ssize_t FileSource::readAt(off64_t offset, void *data, size_t size) {
     }
 }
 
+const void *FileSource::getMappedPointer(off64_t offset, size_t size) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mMapping == NULL || isDrmContainer()
+            || offset < 0 || offset > mLength || size > (uint64_t)(mLength - offset)) {
+        return NULL;
+    }
+    return mMapping + mMappingDelta + offset;
+}
+
+void FileSource::setAccessPattern(AccessPattern pattern) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mFd < 0) {
+        return;
+    }
+
+    int advice = POSIX_FADV_NORMAL;
+    int mappingAdvice = MADV_NORMAL;
+    switch (pattern) {
+        case kAccessSequential:
+            advice = POSIX_FADV_SEQUENTIAL;
+            mappingAdvice = MADV_SEQUENTIAL;
+            break;
+        case kAccessRandom:
+            advice = POSIX_FADV_RANDOM;
+            mappingAdvice = MADV_RANDOM;
+            break;
+        default:
+            break;
+    }
+
+    // Both only tune the read ahead, failures are harmless.
+    posix_fadvise(mFd, mOffset, mLength, advice);
+    if (mMapping != NULL) {
+        madvise(mMapping, mMappingSize, mappingAdvice);
+    }
+}
+
 status_t FileSource::getSize(off64_t *size) {
     Mutex::Autolock autoLock(mLock);
 
@@ -22,9 +22,11 @@
 
 #include "include/avc_utils.h"
 #include "include/ID3.h"
+#include "include/MP3FrameIndexSeeker.h"
 #include "include/VBRISeeker.h"
 #include "include/XINGSeeker.h"
 
+#include <cutils/properties.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/DataSource.h>
@@ -412,6 +414,16 @@ sp<IMediaSource> MP3Extractor::getTrack(size_t index) {
         return NULL;
     }
 
+    if (mSeeker == NULL
+            && (mDataSource->flags() & DataSource::kIsLocalFileSource)
+            && property_get_bool("media.stagefright.mp3.frame-index", true)) {
+        // Without a XING or VBRI table, index the frames in the background
+        // rather than seeking by the bitrate of the first frame. Only local
+        // files are scanned, as this reads the whole file.
+        mSeeker = MP3FrameIndexSeeker::CreateFromSource(
+                mDataSource, mFirstFramePos, mFixedHeader);
+    }
+
     return new MP3Source(
             mMeta, mDataSource, mFirstFramePos, mFixedHeader,
             mSeeker);
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MP3FrameIndexSeeker"
+#include <utils/Log.h>
+
+#include "include/MP3FrameIndexSeeker.h"
+
+#include "include/avc_utils.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <sys/prctl.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/Utils.h>
+
+namespace android {
+
+// The header bits all frames of a stream share, as in MP3Extractor.
+static const uint32_t kMask = 0xfffe0c00;
+
+// static
+sp<MP3FrameIndexSeeker> MP3FrameIndexSeeker::CreateFromSource(
+        const sp<DataSource> &source, off64_t firstFramePos, uint32_t fixedHeader) {
+    sp<MP3FrameIndexSeeker> seeker =
+        new (std::nothrow) MP3FrameIndexSeeker(source, firstFramePos, fixedHeader);
+    if (seeker == NULL) {
+        ALOGW("Couldn't allocate MP3FrameIndexSeeker");
+        return NULL;
+    }
+
+    if (seeker->start() != OK) {
+        return NULL;
+    }
+    return seeker;
+}
+
+MP3FrameIndexSeeker::MP3FrameIndexSeeker(
+        const sp<DataSource> &source, off64_t firstFramePos, uint32_t fixedHeader)
+    : mSource(source),
+      mFirstFramePos(firstFramePos),
+      mFixedHeader(fixedHeader),
+      mSampleRate(0),
+      mThreadStarted(false),
+      mAbort(false),
+      mIndexedOffset(firstFramePos),
+      mIndexedSamples(0),
+      mComplete(false) {
+}
+
+MP3FrameIndexSeeker::~MP3FrameIndexSeeker() {
+    if (mThreadStarted) {
+        mAbort = true;
+        void *dummy;
+        pthread_join(mThread, &dummy);
+        mThreadStarted = false;
+    }
+}
+
+status_t MP3FrameIndexSeeker::start() {
+    size_t frameSize;
+    if (!GetMPEGAudioFrameSize(mFixedHeader, &frameSize, &mSampleRate)
+            || mSampleRate <= 0) {
+        return ERROR_MALFORMED;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    mThreadStarted = pthread_create(&mThread, &attr, ThreadWrapper, this) == 0;
+    pthread_attr_destroy(&attr);
+
+    return mThreadStarted ? OK : UNKNOWN_ERROR;
+}
+
+// static
+void *MP3FrameIndexSeeker::ThreadWrapper(void *me) {
+    static_cast<MP3FrameIndexSeeker *>(me)->threadFunc();
+    return NULL;
+}
+
+void MP3FrameIndexSeeker::threadFunc() {
+    prctl(PR_SET_NAME, (unsigned long)"MP3FrameIndex", 0, 0, 0);
+
+    uint8_t *block = (uint8_t *)malloc(kBlockSize);
+    if (block == NULL) {
+        return;
+    }
+
+    int64_t startUs = ALooper::GetNowUs();
+    off64_t blockOffset = mFirstFramePos;
+    size_t blockSize = 0;
+    off64_t pos = mFirstFramePos;
+    int64_t samples = 0;
+    int64_t nextEntrySamples = 0;
+    size_t numFrames = 0;
+    while (!mAbort) {
+        if (pos + 4 > blockOffset + (off64_t)blockSize) {
+            ssize_t n = mSource->readAt(pos, block, kBlockSize);
+            if (n < 4) {
+                break;
+            }
+            blockOffset = pos;
+            blockSize = n;
+        }
+
+        uint32_t header = U32_AT(block + (pos - blockOffset));
+        size_t frameSize;
+        int sampleRate, numSamples;
+        if ((header & kMask) != (mFixedHeader & kMask)
+                || !GetMPEGAudioFrameSize(
+                        header, &frameSize, &sampleRate, NULL, NULL, &numSamples)) {
+            // Lost sync, look for the next frame header.
+            ++pos;
+            continue;
+        }
+
+        if (samples >= nextEntrySamples) {
+            Entry entry;
+            entry.mOffset = pos;
+            entry.mSamples = samples;
+
+            Mutex::Autolock autoLock(mLock);
+            mEntries.push(entry);
+            nextEntrySamples = samples + (int64_t)kEntryIntervalUs * mSampleRate / 1000000;
+        }
+
+        pos += frameSize;
+        samples += numSamples;
+        ++numFrames;
+
+        if (numFrames % 64 == 0) {
+            Mutex::Autolock autoLock(mLock);
+            mIndexedOffset = pos;
+            mIndexedSamples = samples;
+        }
+    }
+
+    free(block);
+
+    Mutex::Autolock autoLock(mLock);
+    mIndexedOffset = pos;
+    mIndexedSamples = samples;
+    mComplete = !mAbort;
+
+    ALOGV("indexed %zu frames, %" PRId64 " us in %zu entries, took %" PRId64 " us",
+            numFrames, samplesToUs(samples), mEntries.size(),
+            ALooper::GetNowUs() - startUs);
+}
+
+bool MP3FrameIndexSeeker::getDuration(int64_t *durationUs) {
+    Mutex::Autolock autoLock(mLock);
+    if (!mComplete) {
+        return false;
+    }
+    *durationUs = samplesToUs(mIndexedSamples);
+    return true;
+}
+
+bool MP3FrameIndexSeeker::getOffsetForTime(int64_t *timeUs, off64_t *pos) {
+    Entry entry;
+    off64_t endOffset;
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (mEntries.empty()
+                || (!mComplete && *timeUs >= samplesToUs(mIndexedSamples))) {
+            // not indexed yet
+            return false;
+        }
+
+        // the last entry at or before |*timeUs|
+        size_t lo = 0;
+        size_t hi = mEntries.size();
+        while (hi - lo > 1) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (samplesToUs(mEntries.itemAt(mid).mSamples) <= *timeUs) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        entry = mEntries.itemAt(lo);
+        endOffset = mIndexedOffset;
+    }
+
+    // Step to the frame that contains |*timeUs|. Entries are at most
+    // kEntryIntervalUs apart, so this reads a few dozen headers at most.
+    off64_t offset = entry.mOffset;
+    int64_t samples = entry.mSamples;
+    for (;;) {
+        uint8_t buf[4];
+        if (mSource->readAt(offset, buf, sizeof(buf)) < (ssize_t)sizeof(buf)) {
+            break;
+        }
+
+        uint32_t header = U32_AT(buf);
+        size_t frameSize;
+        int sampleRate, numSamples;
+        if ((header & kMask) != (mFixedHeader & kMask)
+                || !GetMPEGAudioFrameSize(
+                        header, &frameSize, &sampleRate, NULL, NULL, &numSamples)
+                || offset + (off64_t)frameSize >= endOffset
+                || samplesToUs(samples + numSamples) > *timeUs) {
+            break;
+        }
+
+        offset += frameSize;
+        samples += numSamples;
+    }
+
+    *pos = offset;
+    *timeUs = samplesToUs(samples);
+
+    ALOGV("seek to frame at %lld, time %" PRId64 " us", (long long)*pos, *timeUs);
+    return true;
+}
+
+}  // namespace android
@@ -25,6 +25,8 @@
 
 #include <utils/Log.h>
 
+#include <cutils/properties.h>
+
 #include "include/MPEG4Extractor.h"
 #include "include/SampleTable.h"
 #include "include/ESDS.h"
@@ -61,6 +63,8 @@ enum {
     kMaxAtomSize = 64 * 1024 * 1024,
 };
 
+struct MPEG4DataSource;
+
 class MPEG4Source : public MediaSource {
 public:
     // Caller retains ownership of both "dataSource" and "sampleTable".
@@ -104,6 +108,22 @@ private:
     off64_t mNextMoofOffset;
     uint32_t mCurrentTime;
     int32_t mLastParsedTrackId;
+
+    // Caches the next moof box, so that moving on to the next fragment does
+    // not have to read its tables box by box. NULL for caching data sources,
+    // where reading ahead of the sample data would move the cache.
+    sp<MPEG4DataSource> mFragmentCache;
+
+    // The moofs holding samples of this track and the decode time of their
+    // first sample, relative to the first one, for seeking in files without
+    // a sidx. Built from the tfra boxes, or a pass over the moof boxes, on
+    // the first such seek.
+    struct FragmentEntry {
+        off64_t mMoofOffset;
+        uint64_t mDecodeTime;
+    };
+    Vector<FragmentEntry> mFragments;
+    bool mFragmentsIndexed;
     int32_t mTrackId;
 
     int32_t mCryptoMode;    // passed in from extractor
@@ -139,6 +159,12 @@ private:
     status_t parseTrackFragmentRun(off64_t offset, off64_t size);
     status_t parseSampleAuxiliaryInformationSizes(off64_t offset, off64_t size);
     status_t parseSampleAuxiliaryInformationOffsets(off64_t offset, off64_t size);
+    void prefetchFragment(off64_t offset, uint64_t size);
+
+    status_t buildFragmentIndex();
+    status_t parseFragmentRandomAccess();
+    status_t skimFragments();
+    status_t findFragmentDecodeTime(off64_t offset, off64_t size, uint64_t *time);
 
     struct TrackFragmentHeaderInfo {
         enum Flags {
@@ -191,6 +217,8 @@ struct MPEG4DataSource : public DataSource {
     virtual ssize_t readAt(off64_t offset, void *data, size_t size);
     virtual status_t getSize(off64_t *size);
     virtual uint32_t flags();
+    virtual const void *getMappedPointer(off64_t offset, size_t size);
+    virtual void setAccessPattern(AccessPattern pattern);
 
     status_t setCachedRange(off64_t offset, size_t size);
 
@@ -255,6 +283,21 @@ uint32_t MPEG4DataSource::flags() {
     return mSource->flags();
 }
 
+const void *MPEG4DataSource::getMappedPointer(off64_t offset, size_t size) {
+    Mutex::Autolock autoLock(mLock);
+
+    // The cache lives as long as this source, like a mapping would.
+    if (isInRange(mCachedOffset, mCachedSize, offset, size)) {
+        return &mCache[offset - mCachedOffset];
+    }
+
+    return mSource->getMappedPointer(offset, size);
+}
+
+void MPEG4DataSource::setAccessPattern(AccessPattern pattern) {
+    mSource->setAccessPattern(pattern);
+}
+
 status_t MPEG4DataSource::setCachedRange(off64_t offset, size_t size) {
     Mutex::Autolock autoLock(mLock);
 
@@ -369,7 +412,24 @@ static bool AdjustChannelsAndRate(uint32_t fourcc, uint32_t *channels, uint32_t
     return false;
 }
 
-MPEG4Extractor::MPEG4Extractor(const sp<DataSource> &source)
+struct PathAdder {
+    PathAdder(Vector<uint32_t> *path, uint32_t chunkType)
+        : mPath(path) {
+        mPath->push(chunkType);
+    }
+
+    ~PathAdder() {
+        mPath->pop();
+    }
+
+private:
+    Vector<uint32_t> *mPath;
+
+    PathAdder(const PathAdder &);
+    PathAdder &operator=(const PathAdder &);
+};
+
+MPEG4Extractor::MPEG4Extractor(const sp<DataSource> &source, bool lazy)
     : mMoofOffset(0),
       mMoofFound(false),
       mMdatFound(false),
@@ -377,6 +437,8 @@ MPEG4Extractor::MPEG4Extractor(const sp<DataSource> &source)
       mInitCheck(NO_INIT),
       mHeaderTimescale(0),
       mIsQT(false),
+      mLazy(lazy),
+      mDeferMetaData(lazy),
       mFirstTrack(NULL),
       mLastTrack(NULL),
       mFileMetaData(new MetaData),
@@ -420,9 +482,29 @@ sp<MetaData> MPEG4Extractor::getMetaData() {
         return new MetaData;
     }
 
+    parseDeferredMetaData();
+
     return mFileMetaData;
 }
 
+void MPEG4Extractor::parseDeferredMetaData() {
+    if (!mDeferMetaData) {
+        return;
+    }
+    mDeferMetaData = false;
+
+    PathAdder autoAdder(&mPath, FOURCC('m', 'o', 'o', 'v'));
+    for (size_t i = 0; i < mDeferredMetaDataOffsets.size(); ++i) {
+        off64_t offset = mDeferredMetaDataOffsets[i];
+        status_t err = parseChunk(&offset, 1);
+        if (err != OK) {
+            ALOGW("failed to parse metadata at %lld (%d)",
+                    (long long)mDeferredMetaDataOffsets[i], err);
+        }
+    }
+    mDeferredMetaDataOffsets.clear();
+}
+
 size_t MPEG4Extractor::countTracks() {
     status_t err;
     if ((err = readMetaData()) != OK) {
@@ -463,7 +545,8 @@ sp<MetaData> MPEG4Extractor::getTrackMetaData(
     }
 
     if ((flags & kIncludeExtensiveMetaData)
-            && !track->includes_expensive_metadata) {
+            && !track->includes_expensive_metadata
+            && loadSampleTable(track) == OK) {
         track->includes_expensive_metadata = true;
 
         const char *mime;
@@ -528,6 +611,10 @@ status_t MPEG4Extractor::readMetaData() {
     status_t err;
     bool sawMoovOrSidx = false;
 
+    // Parsing the boxes jumps around the file in small reads, which read
+    // ahead would only slow down.
+    mDataSource->setAccessPattern(DataSource::kAccessRandom);
+
     while (!(sawMoovOrSidx && (mMdatFound || mMoofFound))) {
         off64_t orig_offset = offset;
         err = parseChunk(&offset, 0);
@@ -545,6 +632,8 @@ status_t MPEG4Extractor::readMetaData() {
         }
     }
 
+    mDataSource->setAccessPattern(DataSource::kAccessNormal);
+
     if (mInitCheck == OK) {
         if (findTrackByMimePrefix("video/") != NULL) {
             mFileMetaData->setCString(
@@ -754,23 +843,6 @@ status_t MPEG4Extractor::parseDrmSINF(
     return UNKNOWN_ERROR;  // Return a dummy error.
 }
 
-struct PathAdder {
-    PathAdder(Vector<uint32_t> *path, uint32_t chunkType)
-        : mPath(path) {
-        mPath->push(chunkType);
-    }
-
-    ~PathAdder() {
-        mPath->pop();
-    }
-
-private:
-    Vector<uint32_t> *mPath;
-
-    PathAdder(const PathAdder &);
-    PathAdder &operator=(const PathAdder &);
-};
-
 static bool underMetaDataPath(const Vector<uint32_t> &path) {
     return path.size() >= 5
         && path[0] == FOURCC('m', 'o', 'o', 'v')
@@ -918,6 +990,15 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
         return OK;
     }
 
+    if (mDeferMetaData && mPath.size() == 2 && mPath[0] == FOURCC('m', 'o', 'o', 'v')
+            && (chunk_type == FOURCC('u', 'd', 't', 'a')
+                || chunk_type == FOURCC('m', 'e', 't', 'a'))) {
+        // parsed on the first getMetaData()
+        mDeferredMetaDataOffsets.push_back(*offset);
+        *offset += chunk_size;
+        return OK;
+    }
+
     switch(chunk_type) {
         case FOURCC('m', 'o', 'o', 'v'):
         case FOURCC('t', 'r', 'a', 'k'):
@@ -984,6 +1065,7 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
                 mLastTrack = track;
 
                 track->meta = new MetaData;
+                track->sampleTableStatus = mLazy ? NO_INIT : OK;
                 track->includes_expensive_metadata = false;
                 track->skipTrack = false;
                 track->timescale = 0;
@@ -1595,6 +1677,13 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
             if ((mLastTrack == NULL) || (mLastTrack->sampleTable == NULL))
                 return ERROR_MALFORMED;
 
+            if (mLazy) {
+                DeferredBox box = { (uint32_t)chunk_type, data_offset, (size_t)chunk_data_size };
+                mLastTrack->deferredBoxes.push_back(box);
+                *offset += chunk_size;
+                break;
+            }
+
             status_t err =
                 mLastTrack->sampleTable->setSampleToChunkParams(
                         data_offset, chunk_data_size);
@@ -1624,54 +1713,11 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
                 return err;
             }
 
-            size_t max_size;
-            err = mLastTrack->sampleTable->getMaxSampleSize(&max_size);
-
-            if (err != OK) {
-                return err;
-            }
-
-            if (max_size != 0) {
-                // Assume that a given buffer only contains at most 10 chunks,
-                // each chunk originally prefixed with a 2 byte length will
-                // have a 4 byte header (0x00 0x00 0x00 0x01) after conversion,
-                // and thus will grow by 2 bytes per chunk.
-                if (max_size > SIZE_MAX - 10 * 2) {
-                    ALOGE("max sample size too big: %zu", max_size);
-                    return ERROR_MALFORMED;
-                }
-                mLastTrack->meta->setInt32(kKeyMaxInputSize, max_size + 10 * 2);
-            } else {
-                // No size was specified. Pick a conservatively large size.
-                uint32_t width, height;
-                if (!mLastTrack->meta->findInt32(kKeyWidth, (int32_t*)&width) ||
-                    !mLastTrack->meta->findInt32(kKeyHeight,(int32_t*) &height)) {
-                    ALOGE("No width or height, assuming worst case 1080p");
-                    width = 1920;
-                    height = 1080;
-                } else {
-                    // A resolution was specified, check that it's not too big. The values below
-                    // were chosen so that the calculations below don't cause overflows, they're
-                    // not indicating that resolutions up to 32kx32k are actually supported.
-                    if (width > 32768 || height > 32768) {
-                        ALOGE("can't support %u x %u video", width, height);
-                        return ERROR_MALFORMED;
-                    }
-                }
-
-                const char *mime;
-                CHECK(mLastTrack->meta->findCString(kKeyMIMEType, &mime));
-                if (!strcmp(mime, MEDIA_MIMETYPE_VIDEO_AVC)
-                        || !strcmp(mime, MEDIA_MIMETYPE_VIDEO_HEVC)) {
-                    // AVC & HEVC requires compression ratio of at least 2, and uses
-                    // macroblocks
-                    max_size = ((width + 15) / 16) * ((height + 15) / 16) * 192;
-                } else {
-                    // For all other formats there is no minimum compression
-                    // ratio. Use compression ratio of 1.
-                    max_size = width * height * 3 / 2;
+            if (!mLazy) {
+                err = setMaxInputSize(mLastTrack);
+                if (err != OK) {
+                    return err;
                 }
-                mLastTrack->meta->setInt32(kKeyMaxInputSize, max_size);
             }
 
             // NOTE: setting another piece of metadata invalidates any pointers (such as the
@@ -1718,6 +1764,12 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
 
             *offset += chunk_size;
 
+            if (mLazy) {
+                DeferredBox box = { (uint32_t)chunk_type, data_offset, (size_t)chunk_data_size };
+                mLastTrack->deferredBoxes.push_back(box);
+                break;
+            }
+
             status_t err =
                 mLastTrack->sampleTable->setTimeToSampleParams(
                         data_offset, chunk_data_size);
@@ -1736,6 +1788,12 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
 
             *offset += chunk_size;
 
+            if (mLazy) {
+                DeferredBox box = { (uint32_t)chunk_type, data_offset, (size_t)chunk_data_size };
+                mLastTrack->deferredBoxes.push_back(box);
+                break;
+            }
+
             status_t err =
                 mLastTrack->sampleTable->setCompositionTimeToSampleParams(
                         data_offset, chunk_data_size);
@@ -1754,6 +1812,12 @@ status_t MPEG4Extractor::parseChunk(off64_t *offset, int depth) {
 
             *offset += chunk_size;
 
+            if (mLazy) {
+                DeferredBox box = { (uint32_t)chunk_type, data_offset, (size_t)chunk_data_size };
+                mLastTrack->deferredBoxes.push_back(box);
+                break;
+            }
+
             status_t err =
                 mLastTrack->sampleTable->setSyncSampleParams(
                         data_offset, chunk_data_size);
@@ -3273,6 +3337,17 @@ sp<IMediaSource> MPEG4Extractor::getTrack(size_t index) {
         return NULL;
     }
 
+    if (loadSampleTable(track) != OK) {
+        return NULL;
+    }
+
+    // 1 indexes the samples before returning the track, 2 on a thread of the
+    // sample table, which requires a data source that can be read from
+    // several threads at once.
+    int32_t sampleIndexMode = property_get_int32("media.stagefright.mpeg4.sampleindex", 0);
+    if (sampleIndexMode > 0 && track->sampleTable != NULL) {
+        track->sampleTable->buildSampleIndex(sampleIndexMode == 2);
+    }
 
     Trex *trex = NULL;
     int32_t trackId;
@@ -3333,6 +3408,100 @@ sp<IMediaSource> MPEG4Extractor::getTrack(size_t index) {
     return source;
 }
 
+status_t MPEG4Extractor::setMaxInputSize(Track *track) {
+    size_t max_size;
+    status_t err = track->sampleTable->getMaxSampleSize(&max_size);
+
+    if (err != OK) {
+        return err;
+    }
+
+    if (max_size != 0) {
+        // Assume that a given buffer only contains at most 10 chunks,
+        // each chunk originally prefixed with a 2 byte length will
+        // have a 4 byte header (0x00 0x00 0x00 0x01) after conversion,
+        // and thus will grow by 2 bytes per chunk.
+        if (max_size > SIZE_MAX - 10 * 2) {
+            ALOGE("max sample size too big: %zu", max_size);
+            return ERROR_MALFORMED;
+        }
+        track->meta->setInt32(kKeyMaxInputSize, max_size + 10 * 2);
+    } else {
+        // No size was specified. Pick a conservatively large size.
+        uint32_t width, height;
+        if (!track->meta->findInt32(kKeyWidth, (int32_t*)&width) ||
+            !track->meta->findInt32(kKeyHeight,(int32_t*) &height)) {
+            ALOGE("No width or height, assuming worst case 1080p");
+            width = 1920;
+            height = 1080;
+        } else {
+            // A resolution was specified, check that it's not too big. The values below
+            // were chosen so that the calculations below don't cause overflows, they're
+            // not indicating that resolutions up to 32kx32k are actually supported.
+            if (width > 32768 || height > 32768) {
+                ALOGE("can't support %u x %u video", width, height);
+                return ERROR_MALFORMED;
+            }
+        }
+
+        const char *mime;
+        CHECK(track->meta->findCString(kKeyMIMEType, &mime));
+        if (!strcmp(mime, MEDIA_MIMETYPE_VIDEO_AVC)
+                || !strcmp(mime, MEDIA_MIMETYPE_VIDEO_HEVC)) {
+            // AVC & HEVC requires compression ratio of at least 2, and uses
+            // macroblocks
+            max_size = ((width + 15) / 16) * ((height + 15) / 16) * 192;
+        } else {
+            // For all other formats there is no minimum compression
+            // ratio. Use compression ratio of 1.
+            max_size = width * height * 3 / 2;
+        }
+        track->meta->setInt32(kKeyMaxInputSize, max_size);
+    }
+
+    return OK;
+}
+
+status_t MPEG4Extractor::loadSampleTable(Track *track) {
+    if (track->sampleTableStatus != NO_INIT) {
+        return track->sampleTableStatus;
+    }
+
+    status_t err = OK;
+    for (size_t i = 0; i < track->deferredBoxes.size() && err == OK; ++i) {
+        const DeferredBox &box = track->deferredBoxes[i];
+        switch (box.type) {
+            case FOURCC('s', 't', 's', 'c'):
+                err = track->sampleTable->setSampleToChunkParams(box.offset, box.size);
+                break;
+            case FOURCC('s', 't', 't', 's'):
+                err = track->sampleTable->setTimeToSampleParams(box.offset, box.size);
+                break;
+            case FOURCC('c', 't', 't', 's'):
+                err = track->sampleTable->setCompositionTimeToSampleParams(
+                        box.offset, box.size);
+                break;
+            case FOURCC('s', 't', 's', 's'):
+                err = track->sampleTable->setSyncSampleParams(box.offset, box.size);
+                break;
+            default:
+                TRESPASS();
+        }
+    }
+    track->deferredBoxes.clear();
+
+    if (err == OK && !track->sampleTable->isValid()) {
+        ALOGE("stbl atom missing/invalid.");
+        err = ERROR_MALFORMED;
+    }
+    if (err == OK) {
+        err = setMaxInputSize(track);
+    }
+
+    track->sampleTableStatus = err;
+    return err;
+}
+
 // static
 status_t MPEG4Extractor::verifyTrack(Track *track) {
     const char *mime;
@@ -3360,7 +3529,8 @@ status_t MPEG4Extractor::verifyTrack(Track *track) {
         }
     }
 
-    if (track->sampleTable == NULL || !track->sampleTable->isValid()) {
+    if (track->sampleTable == NULL
+            || (track->sampleTableStatus == OK && !track->sampleTable->isValid())) {
         // Make sure we have all the metadata we need.
         ALOGE("stbl atom missing/invalid.");
         return ERROR_MALFORMED;
@@ -3729,6 +3899,7 @@ MPEG4Source::MPEG4Source(
       mCurrentMoofOffset(firstMoofOffset),
       mNextMoofOffset(-1),
       mCurrentTime(0),
+      mFragmentsIndexed(false),
       mCurrentSampleInfoAllocSize(0),
       mCurrentSampleInfoSizes(NULL),
       mCurrentSampleInfoOffsetsAllocSize(0),
@@ -3792,6 +3963,11 @@ MPEG4Source::MPEG4Source(
 
     CHECK(format->findInt32(kKeyTrackID, &mTrackId));
 
+    if (mFirstMoofOffset != 0
+            && (mDataSource->flags() & DataSource::kIsCachingDataSource) == 0) {
+        mFragmentCache = new MPEG4DataSource(mDataSource);
+        mDataSource = mFragmentCache;
+    }
 }
 
 status_t MPEG4Source::init() {
@@ -3952,6 +4128,7 @@ status_t MPEG4Source::parseChunk(off64_t *offset) {
 
                     if (chunk_type == FOURCC('m', 'o', 'o', 'f')) {
                         mNextMoofOffset = *offset;
+                        prefetchFragment(*offset, chunk_size);
                         break;
                     } else if (chunk_size == 0) {
                         break;
@@ -4207,6 +4384,301 @@ status_t MPEG4Source::parseSampleAuxiliaryInformationOffsets(
     return OK;
 }
 
+// Moof boxes are a few kilobytes; don't cache unusually large ones.
+static const uint64_t kMaxFragmentPrefetchSize = 1024 * 1024;
+
+void MPEG4Source::prefetchFragment(off64_t offset, uint64_t size) {
+    if (mFragmentCache == NULL || size == 0 || size > kMaxFragmentPrefetchSize) {
+        return;
+    }
+    if (mFragmentCache->setCachedRange(offset, size) != OK) {
+        ALOGV("failed to prefetch moof @ %#llx", (long long)offset);
+    }
+}
+
+// Reads the header of the box at |offset|. A |size| of 0 means the box
+// extends to the end of the file.
+static status_t readBoxHeader(
+        const sp<DataSource> &source, off64_t offset,
+        uint32_t *type, uint64_t *size, off64_t *dataOffset) {
+    uint32_t hdr[2];
+    if (source->readAt(offset, hdr, 8) < 8) {
+        return ERROR_END_OF_STREAM;
+    }
+    *size = ntohl(hdr[0]);
+    *type = ntohl(hdr[1]);
+    *dataOffset = offset + 8;
+
+    if (*size == 1) {
+        if (!source->getUInt64(offset + 8, size)) {
+            return ERROR_IO;
+        }
+        *dataOffset += 8;
+        if (*size < 16) {
+            return ERROR_MALFORMED;
+        }
+    } else if (*size != 0 && *size < 8) {
+        return ERROR_MALFORMED;
+    }
+    return OK;
+}
+
+status_t MPEG4Source::buildFragmentIndex() {
+    mFragmentsIndexed = true;
+
+    if (mDataSource->flags() & DataSource::kIsCachingDataSource) {
+        // both would read all of a remote file
+        return ERROR_UNSUPPORTED;
+    }
+
+    status_t err = parseFragmentRandomAccess();
+    if (err != OK) {
+        mFragments.clear();
+        err = skimFragments();
+    }
+    if (err != OK || mFragments.isEmpty()) {
+        ALOGV("no fragment index (%d)", err);
+        mFragments.clear();
+        return err != OK ? err : ERROR_MALFORMED;
+    }
+
+    // playback from the first moof starts at time 0
+    uint64_t firstTime = mFragments[0].mDecodeTime;
+    for (size_t i = 0; i < mFragments.size(); ++i) {
+        if (mFragments[i].mDecodeTime < firstTime
+                || (i > 0 && mFragments[i].mMoofOffset <= mFragments[i - 1].mMoofOffset)) {
+            mFragments.clear();
+            return ERROR_MALFORMED;
+        }
+        mFragments.editItemAt(i).mDecodeTime -= firstTime;
+    }
+    ALOGV("indexed %zu fragments", mFragments.size());
+    return OK;
+}
+
+// Reads the tfra box of this track from the mfra box at the end of the
+// file, which mfro points to. Only entries for the first sample of a
+// fragment are used, since reading always starts at the first sample, and
+// their presentation time stands in for its decode time.
+status_t MPEG4Source::parseFragmentRandomAccess() {
+    off64_t fileSize;
+    if (mDataSource->getSize(&fileSize) != OK || fileSize < 16) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    uint8_t mfro[16];
+    if (mDataSource->readAt(fileSize - 16, mfro, 16) < 16) {
+        return ERROR_IO;
+    }
+    if (U32_AT(&mfro[0]) != 16 || U32_AT(&mfro[4]) != FOURCC('m', 'f', 'r', 'o')) {
+        return NAME_NOT_FOUND;
+    }
+    uint32_t mfraSize = U32_AT(&mfro[12]);
+    if (mfraSize < 8 || mfraSize > fileSize) {
+        return ERROR_MALFORMED;
+    }
+
+    off64_t offset = fileSize - mfraSize;
+    uint32_t type;
+    uint64_t size;
+    off64_t dataOffset;
+    status_t err = readBoxHeader(mDataSource, offset, &type, &size, &dataOffset);
+    if (err != OK) {
+        return err;
+    }
+    if (type != FOURCC('m', 'f', 'r', 'a') || size != mfraSize) {
+        return ERROR_MALFORMED;
+    }
+
+    off64_t stopOffset = offset + mfraSize;
+    for (offset = dataOffset; offset < stopOffset; offset += size) {
+        if ((err = readBoxHeader(mDataSource, offset, &type, &size, &dataOffset)) != OK) {
+            return err;
+        }
+        if (size == 0 || size > (uint64_t)(stopOffset - offset)) {
+            return ERROR_MALFORMED;
+        }
+        if (type != FOURCC('t', 'f', 'r', 'a')) {
+            continue;
+        }
+
+        uint8_t header[16];
+        if (size < (uint64_t)(dataOffset - offset) + sizeof(header)) {
+            return ERROR_MALFORMED;
+        }
+        if (mDataSource->readAt(dataOffset, header, sizeof(header)) < (ssize_t)sizeof(header)) {
+            return ERROR_IO;
+        }
+        if (U32_AT(&header[4]) != (uint32_t)mTrackId) {
+            continue;
+        }
+
+        bool is64Bit = header[0] == 1;
+        uint32_t lengths = U32_AT(&header[8]);
+        size_t trafNumSize = ((lengths >> 4) & 3) + 1;
+        size_t trunNumSize = ((lengths >> 2) & 3) + 1;
+        size_t sampleNumSize = (lengths & 3) + 1;
+        size_t entrySize = (is64Bit ? 16 : 8) + trafNumSize + trunNumSize + sampleNumSize;
+        uint32_t numEntries = U32_AT(&header[12]);
+
+        off64_t tableOffset = dataOffset + sizeof(header);
+        uint64_t tableSize = (uint64_t)numEntries * entrySize;
+        if (tableSize > (uint64_t)(offset + size - tableOffset) || tableSize > kMaxAtomSize) {
+            return ERROR_MALFORMED;
+        }
+
+        uint8_t *table = new (std::nothrow) uint8_t[tableSize];
+        if (table == NULL) {
+            return NO_MEMORY;
+        }
+        if (mDataSource->readAt(tableOffset, table, tableSize) < (ssize_t)tableSize) {
+            delete[] table;
+            return ERROR_IO;
+        }
+
+        for (uint32_t i = 0; i < numEntries; ++i) {
+            const uint8_t *ptr = &table[i * entrySize];
+            FragmentEntry entry;
+            if (is64Bit) {
+                entry.mDecodeTime = U64_AT(ptr);
+                entry.mMoofOffset = U64_AT(ptr + 8);
+                ptr += 16;
+            } else {
+                entry.mDecodeTime = U32_AT(ptr);
+                entry.mMoofOffset = U32_AT(ptr + 4);
+                ptr += 8;
+            }
+
+            // traf, trun and sample numbers all count from 1
+            bool firstSample = true;
+            const size_t numberSizes[3] = { trafNumSize, trunNumSize, sampleNumSize };
+            for (size_t j = 0; j < 3; ++j) {
+                uint32_t number = 0;
+                for (size_t k = 0; k < numberSizes[j]; ++k) {
+                    number = (number << 8) | *ptr++;
+                }
+                firstSample = firstSample && number == 1;
+            }
+
+            // a moof can hold several sync samples, but only the first one counts
+            if (firstSample && (mFragments.isEmpty()
+                    || mFragments[mFragments.size() - 1].mMoofOffset != entry.mMoofOffset)) {
+                mFragments.add(entry);
+            }
+        }
+        delete[] table;
+
+        if (mFragments.isEmpty() || mFragments[0].mMoofOffset != mFirstMoofOffset) {
+            // the first fragment anchors the times
+            return ERROR_MALFORMED;
+        }
+        return OK;
+    }
+    return NAME_NOT_FOUND;
+}
+
+// Walks the top level boxes from the first moof, reading only the box
+// headers and the tfdt of this track in each moof.
+status_t MPEG4Source::skimFragments() {
+    off64_t offset = mFirstMoofOffset;
+    while (true) {
+        uint32_t type;
+        uint64_t size;
+        off64_t dataOffset;
+        status_t err = readBoxHeader(mDataSource, offset, &type, &size, &dataOffset);
+        if (err == ERROR_END_OF_STREAM) {
+            return OK;
+        } else if (err != OK) {
+            return err;
+        }
+
+        if (type == FOURCC('m', 'o', 'o', 'f')) {
+            if (size == 0) {
+                return ERROR_MALFORMED;
+            }
+            FragmentEntry entry;
+            entry.mMoofOffset = offset;
+            err = findFragmentDecodeTime(dataOffset, offset + size - dataOffset,
+                    &entry.mDecodeTime);
+            if (err == OK) {
+                mFragments.add(entry);
+            } else if (err != NAME_NOT_FOUND) {
+                return err;
+            }
+        }
+
+        if (size == 0) {
+            return OK;
+        }
+        offset += size;
+    }
+}
+
+// Finds the tfdt in the traf of this track in the moof whose children span
+// |size| bytes at |offset|. Returns NAME_NOT_FOUND if the moof holds no
+// samples of this track, and ERROR_UNSUPPORTED if it does but has no tfdt.
+status_t MPEG4Source::findFragmentDecodeTime(off64_t offset, off64_t size, uint64_t *time) {
+    off64_t stopOffset = offset + size;
+    while (offset < stopOffset) {
+        uint32_t type;
+        uint64_t boxSize;
+        off64_t dataOffset;
+        status_t err = readBoxHeader(mDataSource, offset, &type, &boxSize, &dataOffset);
+        if (err != OK) {
+            return err;
+        }
+        if (boxSize == 0 || boxSize > (uint64_t)(stopOffset - offset)) {
+            return ERROR_MALFORMED;
+        }
+
+        if (type == FOURCC('t', 'r', 'a', 'f')) {
+            off64_t trafStop = offset + boxSize;
+            bool ourTrack = false;
+            for (off64_t child = dataOffset; child < trafStop; child += boxSize) {
+                if ((err = readBoxHeader(mDataSource, child, &type, &boxSize, &dataOffset))
+                        != OK) {
+                    return err;
+                }
+                if (boxSize == 0 || boxSize > (uint64_t)(trafStop - child)) {
+                    return ERROR_MALFORMED;
+                }
+
+                if (type == FOURCC('t', 'f', 'h', 'd')) {
+                    uint32_t trackId;
+                    if (!mDataSource->getUInt32(dataOffset + 4, &trackId)) {
+                        return ERROR_MALFORMED;
+                    }
+                    ourTrack = trackId == (uint32_t)mTrackId;
+                    if (!ourTrack) {
+                        break;
+                    }
+                } else if (type == FOURCC('t', 'f', 'd', 't') && ourTrack) {
+                    uint32_t flags;
+                    if (!mDataSource->getUInt32(dataOffset, &flags)) {
+                        return ERROR_MALFORMED;
+                    }
+                    if (flags >> 24 == 1) {
+                        return mDataSource->getUInt64(dataOffset + 4, time)
+                                ? OK : ERROR_MALFORMED;
+                    }
+                    uint32_t time32;
+                    if (!mDataSource->getUInt32(dataOffset + 4, &time32)) {
+                        return ERROR_MALFORMED;
+                    }
+                    *time = time32;
+                    return OK;
+                }
+            }
+            if (ourTrack) {
+                return ERROR_UNSUPPORTED;
+            }
+            boxSize = trafStop - offset;
+        }
+        offset += boxSize;
+    }
+    return NAME_NOT_FOUND;
+}
+
 status_t MPEG4Source::parseTrackFragmentHeader(off64_t offset, off64_t size) {
 
     if (size < 8) {
@@ -4847,8 +5319,38 @@ status_t MPEG4Source::fragmentedRead(
             }
             mCurrentTime = totalTime * mTimescale / 1000000ll;
         } else {
-            // without sidx boxes, we can only seek to 0
-            mCurrentMoofOffset = mFirstMoofOffset;
+            if (!mFragmentsIndexed) {
+                buildFragmentIndex();
+            }
+
+            // without sidx boxes or a fragment index, we can only seek to 0
+            off64_t moofOffset = mFirstMoofOffset;
+            uint64_t decodeTime = 0;
+            if (!mFragments.isEmpty()) {
+                uint64_t seekTime = seekTimeUs < 0 ? 0 : seekTimeUs * mTimescale / 1000000ll;
+                size_t left = 0;
+                size_t right = mFragments.size();
+                while (right - left > 1) {
+                    size_t center = left + (right - left) / 2;
+                    if (mFragments[center].mDecodeTime <= seekTime) {
+                        left = center;
+                    } else {
+                        right = center;
+                    }
+                }
+                // left is the last fragment starting at or before seekTime
+                if (right < mFragments.size() && mFragments[left].mDecodeTime < seekTime
+                        && (mode == ReadOptions::SEEK_NEXT_SYNC
+                            || (mode == ReadOptions::SEEK_CLOSEST_SYNC
+                                && mFragments[right].mDecodeTime - seekTime
+                                        < seekTime - mFragments[left].mDecodeTime))) {
+                    left = right;
+                }
+                moofOffset = mFragments[left].mMoofOffset;
+                decodeTime = mFragments[left].mDecodeTime;
+            }
+
+            mCurrentMoofOffset = moofOffset;
             mNextMoofOffset = -1;
             mCurrentSamples.clear();
             mCurrentSampleIndex = 0;
@@ -4857,7 +5359,7 @@ status_t MPEG4Source::fragmentedRead(
             if (err != OK) {
                 return err;
             }
-            mCurrentTime = 0;
+            mCurrentTime = decodeTime;
         }
 
         if (mBuffer != NULL) {
@@ -46,6 +46,7 @@
 #include <media/mediarecorder.h>
 #include <cutils/properties.h>
 
+#include "include/AsyncFileWriter.h"
 #include "include/ESDS.h"
 #include "include/HevcUtils.h"
 #include "include/avc_utils.h"
@@ -70,6 +71,7 @@ static const uint8_t kNalUnitTypeSeqParamSet = 0x07;
 static const uint8_t kNalUnitTypePicParamSet = 0x08;
 static const int64_t kInitialDelayTimeUs     = 700000LL;
 static const int64_t kMaxMetadataSize = 0x4000000LL;   // 64MB max per-frame metadata size
+static const int64_t kTrakFixedSizeBytes = 1024;       // trak box bytes besides the tables
 
 static const char kMetaKey_Version[]    = "com.android.version";
 static const char kMetaKey_Manufacturer[]      = "com.android.manufacturer";
@@ -111,6 +113,8 @@ public:
 
     int64_t getDurationUs() const;
     int64_t getEstimatedTrackSizeBytes() const;
+    int64_t getTableSizeBytes() const { return mTableSizeBytes; }
+    bool isReadyForFragments() const { return mReadyForFragments; }
     void writeTrackHeader(bool use32BitOffset = true);
     void bufferChunk(int64_t timestampUs);
     bool isAvc() const { return mIsAvc; }
@@ -124,6 +128,10 @@ public:
     const char *getTrackType() const;
     void resetInternal();
 
+    // Writes the samples accumulated since the last fragment as a moof and
+    // mdat pair, unless the moov box cannot be written yet.
+    void writeFragment();
+
 private:
     enum {
         kMaxCttsOffsetTimeUs = 1000000LL,  // 1 second
@@ -289,6 +297,7 @@ private:
 
     int64_t mEstimatedTrackSizeBytes;
     int64_t mMdatSizeBytes;
+    int64_t mTableSizeBytes;  // of the sample tables in the moov box
     int32_t mTimeScale;
 
     pthread_t mThread;
@@ -309,6 +318,19 @@ private:
     int64_t mMinCttsOffsetTimeUs;
     int64_t mMaxCttsOffsetTimeUs;
 
+    // Samples of the next fragment, when writing a fragmented file
+    struct FragmentSample {
+        MediaBuffer *mBuffer;
+        uint32_t mSize;
+        uint32_t mDurationTicks;
+        int32_t mCompositionOffsetTicks;
+        bool mIsSync;
+    };
+    List<FragmentSample> mFragmentSamples;
+    int64_t mFragmentDurationTicks;  // of mFragmentSamples
+    int64_t mFragmentDecodeTicks;    // of the next fragment, -1 before the first
+    bool mReadyForFragments;         // the codec specific data is known
+
     // Save the last 10 frames' timestamp for debug.
     std::list<std::pair<int64_t, int64_t>> mTimestampDebugHelper;
 
@@ -379,6 +401,10 @@ private:
     int32_t mRotation;
 
     void updateTrackSizeEstimate();
+    void addFragmentSample(
+            MediaBuffer *buffer, uint32_t size, int64_t prevDurationTicks,
+            int32_t compositionOffsetTicks, bool isSync);
+    void releaseFragmentSamples();
     void addOneStscTableEntry(size_t chunkId, size_t sampleId);
     void addOneStssTableEntry(size_t sampleId);
 
@@ -446,6 +472,7 @@ void MPEG4Writer::initInternal(int fd) {
     ALOGV("initInternal");
     mFd = dup(fd);
     mNextFd = -1;
+    mOutput = NULL;
     mInitCheck = mFd < 0? NO_INIT: OK;
     mIsRealTimeRecording = true;
     mUse4ByteNalLength = true;
@@ -459,6 +486,7 @@ void MPEG4Writer::initInternal(int fd) {
     mMdatOffset = 0;
     mMoovBoxBuffer = NULL;
     mMoovBoxBufferOffset = 0;
+    mMoovBoxBufferSize = 0;
     mWriteMoovBoxToMemory = false;
     mFreeBoxOffset = 0;
     mStreamableFile = false;
@@ -472,6 +500,10 @@ void MPEG4Writer::initInternal(int fd) {
     mAreGeoTagsAvailable = false;
     mStartTimeOffsetMs = -1;
     mSwitchPending = false;
+    mFragmentDurationUs = 0;
+    mMoovBoxWritten = false;
+    mFragmentSequenceNumber = 0;
+    mMehdOffset = 0;
     mMetaKeys = new AMessage();
     addDeviceMeta();
     // Verify mFd is seekable
@@ -479,6 +511,19 @@ void MPEG4Writer::initInternal(int fd) {
     if (off < 0) {
         ALOGE("cannot seek mFd: %s (%d) %lld", strerror(errno), errno, (long long)mFd);
         release();
+    } else if (mInitCheck == OK) {
+        uint32_t flags = 0;
+        if (property_get_bool("media.stagefright.mp4.direct-io", false)) {
+            flags |= AsyncFileWriter::kFlagDirectIo;
+        }
+        if (property_get_bool("media.stagefright.mp4.preallocate", false)) {
+            flags |= AsyncFileWriter::kFlagPreallocate;
+        }
+        mOutput = new AsyncFileWriter(mFd, flags);
+        if (mOutput->initCheck() != OK) {
+            ALOGE("cannot start writing to mFd: %d", mOutput->initCheck());
+            release();
+        }
     }
     for (List<Track *>::iterator it = mTracks.begin();
          it != mTracks.end(); ++it) {
@@ -495,6 +540,9 @@ status_t MPEG4Writer::dump(
     result.append(buffer);
     snprintf(buffer, SIZE, "     mStarted: %s\n", mStarted? "true": "false");
     result.append(buffer);
+    if (mOutput != NULL) {
+        mOutput->dump(&result);
+    }
     ::write(fd, result.string(), result.size());
     for (List<Track *>::iterator it = mTracks.begin();
          it != mTracks.end(); ++it) {
@@ -814,6 +862,15 @@ status_t MPEG4Writer::start(MetaData *param) {
     mWriteMoovBoxToMemory = false;
     mMoovBoxBuffer = NULL;
     mMoovBoxBufferOffset = 0;
+    mMoovBoxBufferSize = 0;
+
+    int64_t fragmentDurationUs;
+    if (param && param->findInt64(kKeyFragmentDurationUs, &fragmentDurationUs)) {
+        mFragmentDurationUs = fragmentDurationUs > 0 ? fragmentDurationUs : 0;
+    } else {
+        mFragmentDurationUs =
+            property_get_int32("media.stagefright.mp4.fragment-ms", 0) * 1000ll;
+    }
 
     writeFtypBox(param);
 
@@ -827,9 +884,16 @@ status_t MPEG4Writer::start(MetaData *param) {
         mEstimatedMoovBoxSize = estimateMoovBoxSize(bitRate);
     }
     CHECK_GE(mEstimatedMoovBoxSize, 8);
-    if (mStreamableFile) {
+    if (isFragmented()) {
+        // The moov box goes right after the ftyp box, once the codec
+        // specific data of all tracks is known; see writeFragmentedMoovBox_l().
+        ALOGI("writing a fragment every %" PRId64 " us", mFragmentDurationUs);
+        mMoovBoxWritten = false;
+        mFragmentSequenceNumber = 0;
+        mMdatOffset = mOffset;
+    } else if (mStreamableFile) {
         // Reserve a 'free' box only for streamable file
-        lseek64(mFd, mFreeBoxOffset, SEEK_SET);
+        mOutput->seek(mFreeBoxOffset);
         writeInt32(mEstimatedMoovBoxSize);
         write("free", 4);
         mMdatOffset = mFreeBoxOffset + mEstimatedMoovBoxSize;
@@ -837,12 +901,14 @@ status_t MPEG4Writer::start(MetaData *param) {
         mMdatOffset = mOffset;
     }
 
-    mOffset = mMdatOffset;
-    lseek64(mFd, mMdatOffset, SEEK_SET);
-    if (mUse32BitOffset) {
-        write("????mdat", 8);
-    } else {
-        write("\x00\x00\x00\x01mdat????????", 16);
+    if (!isFragmented()) {
+        mOffset = mMdatOffset;
+        mOutput->seek(mMdatOffset);
+        if (mUse32BitOffset) {
+            write("????mdat", 8);
+        } else {
+            write("\x00\x00\x00\x01mdat????????", 16);
+        }
     }
 
     status_t err = startWriterThread();
@@ -951,6 +1017,11 @@ void MPEG4Writer::writeCompositionMatrix(int degrees) {
 }
 
 void MPEG4Writer::release() {
+    if (mOutput != NULL) {
+        mOutput->close();
+        delete mOutput;
+        mOutput = NULL;
+    }
     close(mFd);
     mFd = -1;
     mInitCheck = NO_INIT;
@@ -1028,64 +1099,93 @@ status_t MPEG4Writer::reset(bool stopSource) {
         return err;
     }
 
+    if (isFragmented()) {
+        finishFragmentedFile(maxDurationUs);
+    } else {
+        finishFile(maxDurationUs);
+    }
+    CHECK(mBoxes.empty());
+
+    status_t writeErr = mOutput->flush();
+    if (writeErr != OK) {
+        ALOGE("failed to write the file: %d", writeErr);
+        err = ERROR_IO;
+    }
+
+    release();
+    return err;
+}
+
+void MPEG4Writer::finishFile(int64_t durationUs) {
     // Fix up the size of the 'mdat' chunk.
     if (mUse32BitOffset) {
-        lseek64(mFd, mMdatOffset, SEEK_SET);
+        mOutput->seek(mMdatOffset);
         uint32_t size = htonl(static_cast<uint32_t>(mOffset - mMdatOffset));
-        ::write(mFd, &size, 4);
+        mOutput->write(&size, 4);
     } else {
-        lseek64(mFd, mMdatOffset + 8, SEEK_SET);
+        mOutput->seek(mMdatOffset + 8);
         uint64_t size = mOffset - mMdatOffset;
         size = hton64(size);
-        ::write(mFd, &size, 8);
+        mOutput->write(&size, 8);
     }
-    lseek64(mFd, mOffset, SEEK_SET);
+    mOutput->seek(mOffset);
 
-    // Construct moov box now
-    mMoovBoxBufferOffset = 0;
-    mWriteMoovBoxToMemory = mStreamableFile;
-    if (mWriteMoovBoxToMemory) {
-        // There is no need to allocate in-memory cache
-        // for moov box if the file is not streamable.
-
-        mMoovBoxBuffer = (uint8_t *) malloc(mEstimatedMoovBoxSize);
-        CHECK(mMoovBoxBuffer != NULL);
+    if (!mStreamableFile) {
+        writeMoovBox(durationUs);
+        return;
     }
-    writeMoovBox(maxDurationUs);
-
-    // mWriteMoovBoxToMemory could be set to false in
-    // MPEG4Writer::write() method
-    if (mWriteMoovBoxToMemory) {
-        mWriteMoovBoxToMemory = false;
-        // Content of the moov box is saved in the cache, and the in-memory
-        // moov box needs to be written to the file in a single shot.
 
-        CHECK_LE(mMoovBoxBufferOffset + 8, mEstimatedMoovBoxSize);
+    // Construct the moov box in memory first, and write it to the file
+    // in a single shot once its size is known.
+    mMoovBoxBufferOffset = 0;
+    mMoovBoxBufferSize = mEstimatedMoovBoxSize;
+    mMoovBoxBuffer = (uint8_t *) malloc(mMoovBoxBufferSize);
+    CHECK(mMoovBoxBuffer != NULL);
+    mWriteMoovBoxToMemory = true;
+    writeMoovBox(durationUs);
+    mWriteMoovBoxToMemory = false;
 
-        // Moov box
-        lseek64(mFd, mFreeBoxOffset, SEEK_SET);
+    if (mMoovBoxBufferOffset + 8 <= mEstimatedMoovBoxSize) {
+        // Moov box, in the space reserved for it
+        mOutput->seek(mFreeBoxOffset);
         mOffset = mFreeBoxOffset;
         write(mMoovBoxBuffer, 1, mMoovBoxBufferOffset);
 
         // Free box
-        lseek64(mFd, mOffset, SEEK_SET);
+        mOutput->seek(mOffset);
         writeInt32(mEstimatedMoovBoxSize - mMoovBoxBufferOffset);
         write("free", 4);
     } else {
-        ALOGI("The mp4 file will not be streamable.");
+        // The reserved space stays a free box, and the moov box
+        // goes to the end of the file.
+        ALOGI("The mp4 file will not be streamable, moov box of %" PRId64
+                " bytes does not fit in %" PRId64 " bytes.",
+                (int64_t)mMoovBoxBufferOffset, (int64_t)mEstimatedMoovBoxSize);
+        write(mMoovBoxBuffer, 1, mMoovBoxBufferOffset);
     }
 
     // Free in-memory cache for moov box
-    if (mMoovBoxBuffer != NULL) {
-        free(mMoovBoxBuffer);
-        mMoovBoxBuffer = NULL;
-        mMoovBoxBufferOffset = 0;
-    }
+    free(mMoovBoxBuffer);
+    mMoovBoxBuffer = NULL;
+    mMoovBoxBufferOffset = 0;
+    mMoovBoxBufferSize = 0;
+}
 
-    CHECK(mBoxes.empty());
+void MPEG4Writer::finishFragmentedFile(int64_t durationUs) {
+    // Write whatever the tracks could not write yet; by now the
+    // codec specific data of all tracks is known.
+    for (List<Track *>::iterator it = mTracks.begin();
+         it != mTracks.end(); ++it) {
+        (*it)->writeFragment();
+    }
+    CHECK(mMoovBoxWritten);
 
-    release();
-    return err;
+    // The fragment duration of the mehd box is the only value of the moov
+    // box that is only known now.
+    mOutput->seek(mMehdOffset);
+    uint64_t duration = hton64((uint64_t)((durationUs * mTimeScale + 5E5) / 1E6));
+    mOutput->write(&duration, 8);
+    mOutput->seek(mOffset);
 }
 
 uint32_t MPEG4Writer::getMpeg4Time() {
@@ -1138,9 +1238,52 @@ void MPEG4Writer::writeMoovBox(int64_t durationUs) {
         it != mTracks.end(); ++it, ++id) {
         (*it)->writeTrackHeader(mUse32BitOffset);
     }
+    if (isFragmented()) {
+        writeMvexBox();
+    }
     endBox();  // moov
 }
 
+void MPEG4Writer::writeMvexBox() {
+    beginBox("mvex");
+    beginBox("mehd");
+    writeInt32(1 << 24);  // version=1, flags=0
+    mMehdOffset = mOffset;
+    writeInt64(0);        // fragment duration, set in finishFragmentedFile()
+    endBox();  // mehd
+    for (List<Track *>::iterator it = mTracks.begin();
+        it != mTracks.end(); ++it) {
+        beginBox("trex");
+        writeInt32(0);                     // version=0, flags=0
+        writeInt32((*it)->getTrackId());   // track id
+        writeInt32(1);                     // default sample description index
+        writeInt32(0);                     // default sample duration
+        writeInt32(0);                     // default sample size
+        writeInt32(0);                     // default sample flags
+        endBox();  // trex
+    }
+    endBox();  // mvex
+}
+
+bool MPEG4Writer::writeFragmentedMoovBox_l() {
+    if (mMoovBoxWritten) {
+        return true;
+    }
+    for (List<Track *>::iterator it = mTracks.begin();
+        it != mTracks.end(); ++it) {
+        if (!(*it)->isReadyForFragments()) {
+            return false;
+        }
+    }
+
+    // Written directly to the file, right after the ftyp box, so that
+    // mMehdOffset is a file offset.
+    CHECK(!mWriteMoovBoxToMemory);
+    writeMoovBox(0);
+    mMoovBoxWritten = true;
+    return true;
+}
+
 void MPEG4Writer::writeFtypBox(MetaData *param) {
     beginBox("ftyp");
 
@@ -1205,9 +1348,8 @@ void MPEG4Writer::unlock() {
 off64_t MPEG4Writer::addSample_l(MediaBuffer *buffer) {
     off64_t old_offset = mOffset;
 
-    ::write(mFd,
-          (const uint8_t *)buffer->data() + buffer->range_offset(),
-          buffer->range_length());
+    mOutput->write((const uint8_t *)buffer->data() + buffer->range_offset(),
+            buffer->range_length());
 
     mOffset += buffer->range_length();
 
@@ -1265,28 +1407,25 @@ off64_t MPEG4Writer::addLengthPrefixedSample_l(MediaBuffer *buffer) {
     size_t length = buffer->range_length();
 
     if (mUse4ByteNalLength) {
-        uint8_t x = length >> 24;
-        ::write(mFd, &x, 1);
-        x = (length >> 16) & 0xff;
-        ::write(mFd, &x, 1);
-        x = (length >> 8) & 0xff;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-
-        ::write(mFd,
-              (const uint8_t *)buffer->data() + buffer->range_offset(),
-              length);
+        uint8_t x[4];
+        x[0] = length >> 24;
+        x[1] = (length >> 16) & 0xff;
+        x[2] = (length >> 8) & 0xff;
+        x[3] = length & 0xff;
+        mOutput->write(x, 4);
+
+        mOutput->write((const uint8_t *)buffer->data() + buffer->range_offset(),
+                length);
 
         mOffset += length + 4;
     } else {
         CHECK_LT(length, 65536);
 
-        uint8_t x = length >> 8;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-        ::write(mFd, (const uint8_t *)buffer->data() + buffer->range_offset(), length);
+        uint8_t x[2];
+        x[0] = length >> 8;
+        x[1] = length & 0xff;
+        mOutput->write(x, 2);
+        mOutput->write((const uint8_t *)buffer->data() + buffer->range_offset(), length);
         mOffset += length + 2;
     }
 
@@ -1298,34 +1437,20 @@ size_t MPEG4Writer::write(
 
     const size_t bytes = size * nmemb;
     if (mWriteMoovBoxToMemory) {
-
-        off64_t moovBoxSize = 8 + mMoovBoxBufferOffset + bytes;
-        if (moovBoxSize > mEstimatedMoovBoxSize) {
-            // The reserved moov box at the beginning of the file
-            // is not big enough. Moov box should be written to
-            // the end of the file from now on, but not to the
-            // in-memory cache.
-
-            // We write partial moov box that is in the memory to
-            // the file first.
-            for (List<off64_t>::iterator it = mBoxes.begin();
-                 it != mBoxes.end(); ++it) {
-                (*it) += mOffset;
-            }
-            lseek64(mFd, mOffset, SEEK_SET);
-            ::write(mFd, mMoovBoxBuffer, mMoovBoxBufferOffset);
-            ::write(mFd, ptr, bytes);
-            mOffset += (bytes + mMoovBoxBufferOffset);
-
-            // All subsequent moov box content will be written
-            // to the end of the file.
-            mWriteMoovBoxToMemory = false;
-        } else {
-            memcpy(mMoovBoxBuffer + mMoovBoxBufferOffset, ptr, bytes);
-            mMoovBoxBufferOffset += bytes;
+        // The whole moov box is built in memory, so that its exact size is
+        // known before deciding where it goes; see finishFile().
+        if (mMoovBoxBufferOffset + (off64_t)bytes > mMoovBoxBufferSize) {
+            off64_t newSize = std::max(
+                    mMoovBoxBufferSize * 2, mMoovBoxBufferOffset + (off64_t)bytes);
+            uint8_t *newBuffer = (uint8_t *)realloc(mMoovBoxBuffer, newSize);
+            CHECK(newBuffer != NULL);
+            mMoovBoxBuffer = newBuffer;
+            mMoovBoxBufferSize = newSize;
         }
+        memcpy(mMoovBoxBuffer + mMoovBoxBufferOffset, ptr, bytes);
+        mMoovBoxBufferOffset += bytes;
     } else {
-        ::write(mFd, ptr, size * nmemb);
+        mOutput->write(ptr, size * nmemb);
         mOffset += bytes;
     }
     return bytes;
@@ -1359,10 +1484,10 @@ void MPEG4Writer::endBox() {
        int32_t x = htonl(mMoovBoxBufferOffset - offset);
        memcpy(mMoovBoxBuffer + offset, &x, 4);
     } else {
-        lseek64(mFd, offset, SEEK_SET);
+        mOutput->seek(offset);
         writeInt32(mOffset - offset);
         mOffset -= 4;
-        lseek64(mFd, mOffset, SEEK_SET);
+        mOutput->seek(mOffset);
     }
 }
 
@@ -1511,16 +1636,30 @@ bool MPEG4Writer::isFileStreamable() const {
     return mStreamableFile;
 }
 
-bool MPEG4Writer::exceedsFileSizeLimit() {
-    // No limit
-    if (mMaxFileSizeLimitBytes == 0) {
-        return false;
-    }
+int64_t MPEG4Writer::estimateFileSizeBytes() {
     int64_t nTotalBytesEstimate = static_cast<int64_t>(mEstimatedMoovBoxSize);
+    int64_t nTableBytes = 0;
     for (List<Track *>::iterator it = mTracks.begin();
          it != mTracks.end(); ++it) {
         nTotalBytesEstimate += (*it)->getEstimatedTrackSizeBytes();
+        nTableBytes += (*it)->getTableSizeBytes() + kTrakFixedSizeBytes;
+    }
+
+    // Once the sample tables outgrow the reserved space, the moov box will
+    // be appended to the file instead, next to the reserved space.
+    if (mStreamableFile && !isFragmented()
+            && nTableBytes + mMoovExtraSize > mEstimatedMoovBoxSize) {
+        nTotalBytesEstimate += nTableBytes + mMoovExtraSize;
     }
+    return nTotalBytesEstimate;
+}
+
+bool MPEG4Writer::exceedsFileSizeLimit() {
+    // No limit
+    if (mMaxFileSizeLimitBytes == 0) {
+        return false;
+    }
+    int64_t nTotalBytesEstimate = estimateFileSizeBytes();
 
     if (!mStreamableFile) {
         // Add 1024 bytes as error tolerance
@@ -1539,11 +1678,7 @@ bool MPEG4Writer::approachingFileSizeLimit() {
         return false;
     }
 
-    int64_t nTotalBytesEstimate = static_cast<int64_t>(mEstimatedMoovBoxSize);
-    for (List<Track *>::iterator it = mTracks.begin();
-         it != mTracks.end(); ++it) {
-        nTotalBytesEstimate += (*it)->getEstimatedTrackSizeBytes();
-    }
+    int64_t nTotalBytesEstimate = estimateFileSizeBytes();
 
     if (!mStreamableFile) {
         // Add 1024 bytes as error tolerance
@@ -1617,6 +1752,7 @@ MPEG4Writer::Track::Track(
       mTrackId(trackId),
       mTrackDurationUs(0),
       mEstimatedTrackSizeBytes(0),
+      mTableSizeBytes(0),
       mSamplesHaveSameSize(true),
       mStszTableEntries(new ListTableEntries<uint32_t, 1>(1000)),
       mStcoTableEntries(new ListTableEntries<uint32_t, 1>(1000)),
@@ -1625,6 +1761,9 @@ MPEG4Writer::Track::Track(
       mStssTableEntries(new ListTableEntries<uint32_t, 1>(1000)),
       mSttsTableEntries(new ListTableEntries<uint32_t, 2>(1000)),
       mCttsTableEntries(new ListTableEntries<uint32_t, 2>(1000)),
+      mFragmentDurationTicks(0),
+      mFragmentDecodeTicks(-1),
+      mReadyForFragments(false),
       mCodecSpecificData(NULL),
       mCodecSpecificDataSize(0),
       mGotAllCodecSpecificData(false),
@@ -1662,6 +1801,7 @@ void MPEG4Writer::Track::resetInternal() {
       mIsMalformed = false;
       mTrackDurationUs = 0;
       mEstimatedTrackSizeBytes = 0;
+      mTableSizeBytes = 0;
       mSamplesHaveSameSize = 0;
       if (mStszTableEntries != NULL) {
          delete mStszTableEntries;
@@ -1693,27 +1833,40 @@ void MPEG4Writer::Track::resetInternal() {
          delete mCttsTableEntries;
          mCttsTableEntries = new ListTableEntries<uint32_t, 2>(1000);
       }
+      releaseFragmentSamples();
+      mFragmentDecodeTicks = -1;
+      mReadyForFragments = false;
       mReachedEOS = false;
 }
 
 void MPEG4Writer::Track::updateTrackSizeEstimate() {
+    mEstimatedTrackSizeBytes = mMdatSizeBytes;  // media data size
 
-    uint32_t stcoBoxCount = (mOwner->use32BitFileOffset()
-                            ? mStcoTableEntries->count()
-                            : mCo64TableEntries->count());
-    int64_t stcoBoxSizeBytes = stcoBoxCount * 4;
+    if (mOwner->isFragmented()) {
+        // The sample tables are spread over the fragments, and take one
+        // trun entry per sample.
+        mTableSizeBytes = 0;
+        mEstimatedTrackSizeBytes += mStszTableEntries->count() * (mIsVideo ? 16 : 12);
+        return;
+    }
+
+    // These are the sizes of the table entries that writeStblBox() writes,
+    // which is all of the moov box that grows with the number of samples.
+    int64_t stcoBoxSizeBytes = mOwner->use32BitFileOffset()
+            ? mStcoTableEntries->count() * 4
+            : mCo64TableEntries->count() * 8;
     int64_t stszBoxSizeBytes = mSamplesHaveSameSize? 4: (mStszTableEntries->count() * 4);
+    mTableSizeBytes = mStscTableEntries->count() * 12 +  // stsc box size
+                      mStssTableEntries->count() * 4 +   // stss box size
+                      mSttsTableEntries->count() * 8 +   // stts box size
+                      mCttsTableEntries->count() * 8 +   // ctts box size
+                      stcoBoxSizeBytes +                 // stco box size
+                      stszBoxSizeBytes;                  // stsz box size
 
-    mEstimatedTrackSizeBytes = mMdatSizeBytes;  // media data size
     if (!mOwner->isFileStreamable()) {
         // Reserved free space is not large enough to hold
         // all meta data and thus wasted.
-        mEstimatedTrackSizeBytes += mStscTableEntries->count() * 12 +  // stsc box size
-                                    mStssTableEntries->count() * 4 +   // stss box size
-                                    mSttsTableEntries->count() * 8 +   // stts box size
-                                    mCttsTableEntries->count() * 8 +   // ctts box size
-                                    stcoBoxSizeBytes +           // stco box size
-                                    stszBoxSizeBytes;            // stsz box size
+        mEstimatedTrackSizeBytes += mTableSizeBytes;
     }
 }
 
@@ -1847,6 +2000,7 @@ void MPEG4Writer::Track::getCodecSpecificDataFromInputFormatIfPossible() {
 
 MPEG4Writer::Track::~Track() {
     stop();
+    releaseFragmentSamples();
 
     delete mStszTableEntries;
     delete mStcoTableEntries;
@@ -2109,6 +2263,7 @@ status_t MPEG4Writer::Track::start(MetaData *params) {
     mReachedEOS = false;
     mEstimatedTrackSizeBytes = 0;
     mMdatSizeBytes = 0;
+    mTableSizeBytes = 0;
     mMaxChunkDurationUs = 0;
     mLastDecodingTimeUs = -1;
 
@@ -2912,6 +3067,14 @@ status_t MPEG4Writer::Track::threadEntry() {
             }
             trackProgressStatus(timestampUs);
         }
+        if (mOwner->isFragmented()) {
+            // currDurationTicks is the duration of the previous sample
+            addFragmentSample(copy, sampleSize, currDurationTicks,
+                    mIsVideo ? currCttsOffsetTimeTicks - mTimeScale : 0,
+                    isSync || !mIsVideo);
+            copy = NULL;
+            continue;
+        }
         if (!hasMultipleTracks) {
             off64_t offset = (mIsAvc || mIsHevc) ? mOwner->addMultipleLengthPrefixedSamples_l(copy)
                                  : mOwner->addSample_l(copy);
@@ -2998,6 +3161,12 @@ status_t MPEG4Writer::Track::threadEntry() {
     }
 
     mTrackDurationUs += lastDurationUs;
+
+    if (!mFragmentSamples.empty()) {
+        (--mFragmentSamples.end())->mDurationTicks = lastDurationTicks;
+        mFragmentDurationTicks += lastDurationTicks;
+        writeFragment();
+    }
     mReachedEOS = true;
 
     sendTrackSummary(hasMultipleTracks);
@@ -3014,6 +3183,123 @@ status_t MPEG4Writer::Track::threadEntry() {
     return err;
 }
 
+void MPEG4Writer::Track::addFragmentSample(
+        MediaBuffer *buffer, uint32_t size, int64_t prevDurationTicks,
+        int32_t compositionOffsetTicks, bool isSync) {
+    if (!mFragmentSamples.empty()) {
+        // The duration of a sample is only known with the next one.
+        (--mFragmentSamples.end())->mDurationTicks = prevDurationTicks;
+        mFragmentDurationTicks += prevDurationTicks;
+
+        // Fragments start with a sync sample, so that each one can be
+        // decoded on its own.
+        if (isSync && mFragmentDurationTicks * 1000000LL
+                >= mOwner->fragmentDurationUs() * mTimeScale) {
+            writeFragment();
+        }
+    }
+
+    if (!mReadyForFragments) {
+        mOwner->lock();
+        mReadyForFragments = (checkCodecSpecificData() == OK);
+        mOwner->unlock();
+    }
+
+    FragmentSample sample;
+    sample.mBuffer = buffer;
+    sample.mSize = size;
+    sample.mDurationTicks = 0;
+    sample.mCompositionOffsetTicks = compositionOffsetTicks;
+    sample.mIsSync = isSync;
+    mFragmentSamples.push_back(sample);
+}
+
+void MPEG4Writer::Track::releaseFragmentSamples() {
+    for (List<FragmentSample>::iterator it = mFragmentSamples.begin();
+         it != mFragmentSamples.end(); ++it) {
+        it->mBuffer->release();
+    }
+    mFragmentSamples.clear();
+    mFragmentDurationTicks = 0;
+}
+
+void MPEG4Writer::Track::writeFragment() {
+    mOwner->lock();
+    bool moovBoxWritten = mOwner->writeFragmentedMoovBox_l();
+    mOwner->unlock();
+    if (!moovBoxWritten || mFragmentSamples.empty()) {
+        // Keep the samples until the other tracks are ready.
+        return;
+    }
+
+    if (mFragmentDecodeTicks < 0) {
+        // Takes the owner's lock. Like the first stts entry of a
+        // non-fragmented file, this keeps the tracks in sync.
+        mFragmentDecodeTicks = getStartTimeOffsetScaledTime();
+    }
+
+    const uint32_t numSamples = mFragmentSamples.size();
+    const uint32_t trunEntrySize = mIsVideo ? 16 : 12;
+    // moof, mfhd, traf, tfhd, tfdt and trun with its entries
+    const uint32_t moofSize = 8 + 16 + 8 + 16 + 20 + 20 + numSamples * trunEntrySize;
+
+    mOwner->lock();
+    const off64_t moofOffset = mOwner->mOffset;
+    mOwner->beginBox("moof");
+        mOwner->beginBox("mfhd");
+        mOwner->writeInt32(0);  // version=0, flags=0
+        mOwner->writeInt32(++mOwner->mFragmentSequenceNumber);
+        mOwner->endBox();  // mfhd
+        mOwner->beginBox("traf");
+            mOwner->beginBox("tfhd");
+            mOwner->writeInt32(0x020000);  // version=0, flags=default-base-is-moof
+            mOwner->writeInt32(mTrackId);
+            mOwner->endBox();  // tfhd
+            mOwner->beginBox("tfdt");
+            mOwner->writeInt32(1 << 24);   // version=1, flags=0
+            mOwner->writeInt64(mFragmentDecodeTicks);
+            mOwner->endBox();  // tfdt
+            mOwner->beginBox("trun");
+            // data offset, sample duration, size and flags, and for video
+            // signed composition time offsets
+            mOwner->writeInt32(mIsVideo ? (1 << 24) | 0xf01 : 0x701);
+            mOwner->writeInt32(numSamples);
+            mOwner->writeInt32(moofSize + 8);  // data offset, past the mdat header
+            for (List<FragmentSample>::iterator it = mFragmentSamples.begin();
+                 it != mFragmentSamples.end(); ++it) {
+                mOwner->writeInt32(it->mDurationTicks);
+                mOwner->writeInt32(it->mSize);
+                // depends on no other samples, or is a non-sync sample
+                // depending on others
+                mOwner->writeInt32(it->mIsSync ? 0x02000000 : 0x01010000);
+                if (mIsVideo) {
+                    mOwner->writeInt32(it->mCompositionOffsetTicks);
+                }
+            }
+            mOwner->endBox();  // trun
+        mOwner->endBox();  // traf
+    mOwner->endBox();  // moof
+    CHECK_EQ(mOwner->mOffset - moofOffset, (off64_t)moofSize);
+
+    mOwner->beginBox("mdat");
+    for (List<FragmentSample>::iterator it = mFragmentSamples.begin();
+         it != mFragmentSamples.end(); ++it) {
+        if (mIsAvc || mIsHevc) {
+            mOwner->addMultipleLengthPrefixedSamples_l(it->mBuffer);
+        } else {
+            mOwner->addSample_l(it->mBuffer);
+        }
+    }
+    mOwner->endBox();  // mdat
+
+    // Let the fragment reach the file without waiting for the next one.
+    mOwner->mOutput->submit();
+    mOwner->unlock();
+
+    mFragmentDecodeTicks += mFragmentDurationTicks;
+    releaseFragmentSamples();
+}
+
 bool MPEG4Writer::Track::isTrackMalFormed() const {
     if (mIsMalformed) {
         return true;
@@ -3226,6 +3512,21 @@ void MPEG4Writer::Track::writeStblBox(bool use32BitOffset) {
         writeMetadataFourCCBox();
     }
     mOwner->endBox();  // stsd
+    if (mOwner->isFragmented()) {
+        // The samples are described by the fragments.
+        const char *tables[] = { "stts", "stsc", "stsz", use32BitOffset ? "stco" : "co64" };
+        for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); ++i) {
+            mOwner->beginBox(tables[i]);
+            mOwner->writeInt32(0);  // version=0, flags=0
+            if (!strcmp(tables[i], "stsz")) {
+                mOwner->writeInt32(0);  // sample size
+            }
+            mOwner->writeInt32(0);  // entry count
+            mOwner->endBox();
+        }
+        mOwner->endBox();  // stbl
+        return;
+    }
     writeSttsBox();
     if (mIsVideo) {
         writeCttsBox();
@@ -3460,7 +3761,8 @@ void MPEG4Writer::Track::writeTkhdBox(uint32_t now) {
     mOwner->writeInt32(now);           // modification time
     mOwner->writeInt32(mTrackId);      // track id starts with 1
     mOwner->writeInt32(0);             // reserved
-    int64_t trakDurationUs = getDurationUs();
+    // fragmented files leave the duration to the fragments
+    int64_t trakDurationUs = mOwner->isFragmented() ? 0 : getDurationUs();
     int32_t mvhdTimeScale = mOwner->getTimeScale();
     int32_t tkhdDuration =
         (trakDurationUs * mvhdTimeScale + 5E5) / 1E6;
@@ -3533,7 +3835,7 @@ void MPEG4Writer::Track::writeHdlrBox() {
 }
 
 void MPEG4Writer::Track::writeMdhdBox(uint32_t now) {
-    int64_t trakDurationUs = getDurationUs();
+    int64_t trakDurationUs = mOwner->isFragmented() ? 0 : getDurationUs();
     int64_t mdhdDuration = (trakDurationUs * mTimeScale + 5E5) / 1E6;
     mOwner->beginBox("mdhd");
 
@@ -18,10 +18,13 @@
 #define LOG_TAG "MediaClock"
 #include <utils/Log.h>
 
+#include <algorithm>
+
 #include <media/stagefright/MediaClock.h>
 
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
 
 namespace android {
 
@@ -29,26 +32,43 @@ namespace android {
 // If larger than this threshold, it's treated as discontinuity.
 static const int64_t kAnchorFluctuationAllowedUs = 10000ll;
 
+MediaClock::Timer::Timer(const sp<AMessage> &notify, int64_t mediaTimeUs, int64_t adjustRealUs)
+    : mNotify(notify),
+      mMediaTimeUs(mediaTimeUs),
+      mAdjustRealUs(adjustRealUs) {
+}
+
 MediaClock::MediaClock()
     : mAnchorTimeMediaUs(-1),
       mAnchorTimeRealUs(-1),
       mMaxTimeMediaUs(INT64_MAX),
       mStartingTimeMediaUs(-1),
-      mPlaybackRate(1.0) {
+      mPlaybackRate(1.0),
+      mAnchorSeq(0),
+      mGeneration(0) {
+    publishAnchor_l();
 }
 
 MediaClock::~MediaClock() {
+    reset();
+    if (mLooper != NULL) {
+        mLooper->unregisterHandler(id());
+        mLooper->stop();
+    }
 }
 
 void MediaClock::setStartingTimeMedia(int64_t startingTimeMediaUs) {
     Mutex::Autolock autoLock(mLock);
     mStartingTimeMediaUs = startingTimeMediaUs;
+    publishAnchor_l();
 }
 
 void MediaClock::clearAnchor() {
     Mutex::Autolock autoLock(mLock);
     mAnchorTimeMediaUs = -1;
     mAnchorTimeRealUs = -1;
+    publishAnchor_l();
+    processTimers_l();
 }
 
 void MediaClock::updateAnchor(
@@ -77,16 +97,20 @@ void MediaClock::updateAnchor(
             mAnchorTimeMediaUs + (nowUs - mAnchorTimeRealUs) * (double)mPlaybackRate;
         if (nowMediaUs < oldNowMediaUs
                 && nowMediaUs > oldNowMediaUs - kAnchorFluctuationAllowedUs) {
+            publishAnchor_l();
             return;
         }
     }
     mAnchorTimeRealUs = nowUs;
     mAnchorTimeMediaUs = nowMediaUs;
+    publishAnchor_l();
+    processTimers_l();
 }
 
 void MediaClock::updateMaxTimeMedia(int64_t maxTimeMediaUs) {
     Mutex::Autolock autoLock(mLock);
     mMaxTimeMediaUs = maxTimeMediaUs;
+    publishAnchor_l();
 }
 
 void MediaClock::setPlaybackRate(float rate) {
@@ -94,6 +118,7 @@ void MediaClock::setPlaybackRate(float rate) {
     Mutex::Autolock autoLock(mLock);
     if (mAnchorTimeRealUs == -1) {
         mPlaybackRate = rate;
+        publishAnchor_l();
         return;
     }
 
@@ -105,11 +130,12 @@ void MediaClock::setPlaybackRate(float rate) {
     }
     mAnchorTimeRealUs = nowUs;
     mPlaybackRate = rate;
+    publishAnchor_l();
+    processTimers_l();
 }
 
 float MediaClock::getPlaybackRate() const {
-    Mutex::Autolock autoLock(mLock);
-    return mPlaybackRate;
+    return mPublishedPlaybackRate.load(std::memory_order_relaxed);
 }
 
 status_t MediaClock::getMediaTime(
@@ -118,23 +144,25 @@ status_t MediaClock::getMediaTime(
         return BAD_VALUE;
     }
 
-    Mutex::Autolock autoLock(mLock);
-    return getMediaTime_l(realUs, outMediaUs, allowPastMaxTime);
+    Anchor anchor;
+    getAnchor(&anchor);
+    return getMediaTime(anchor, realUs, outMediaUs, allowPastMaxTime);
 }
 
-status_t MediaClock::getMediaTime_l(
-        int64_t realUs, int64_t *outMediaUs, bool allowPastMaxTime) const {
-    if (mAnchorTimeRealUs == -1) {
+// static
+status_t MediaClock::getMediaTime(
+        const Anchor &anchor, int64_t realUs, int64_t *outMediaUs, bool allowPastMaxTime) {
+    if (anchor.mTimeRealUs == -1) {
         return NO_INIT;
     }
 
-    int64_t mediaUs = mAnchorTimeMediaUs
-            + (realUs - mAnchorTimeRealUs) * (double)mPlaybackRate;
-    if (mediaUs > mMaxTimeMediaUs && !allowPastMaxTime) {
-        mediaUs = mMaxTimeMediaUs;
+    int64_t mediaUs = anchor.mTimeMediaUs
+            + (realUs - anchor.mTimeRealUs) * (double)anchor.mPlaybackRate;
+    if (mediaUs > anchor.mMaxTimeMediaUs && !allowPastMaxTime) {
+        mediaUs = anchor.mMaxTimeMediaUs;
     }
-    if (mediaUs < mStartingTimeMediaUs) {
-        mediaUs = mStartingTimeMediaUs;
+    if (mediaUs < anchor.mStartingTimeMediaUs) {
+        mediaUs = anchor.mStartingTimeMediaUs;
     }
     if (mediaUs < 0) {
         mediaUs = 0;
@@ -149,20 +177,131 @@ status_t MediaClock::getRealTimeFor(
         return BAD_VALUE;
     }
 
-    Mutex::Autolock autoLock(mLock);
-    if (mPlaybackRate == 0.0) {
+    Anchor anchor;
+    getAnchor(&anchor);
+    if (anchor.mPlaybackRate == 0.0) {
         return NO_INIT;
     }
 
     int64_t nowUs = ALooper::GetNowUs();
     int64_t nowMediaUs;
     status_t status =
-            getMediaTime_l(nowUs, &nowMediaUs, true /* allowPastMaxTime */);
+            getMediaTime(anchor, nowUs, &nowMediaUs, true /* allowPastMaxTime */);
     if (status != OK) {
         return status;
     }
-    *outRealUs = (targetMediaUs - nowMediaUs) / (double)mPlaybackRate + nowUs;
+    *outRealUs = (targetMediaUs - nowMediaUs) / (double)anchor.mPlaybackRate + nowUs;
     return OK;
 }
 
+void MediaClock::getAnchor(Anchor *anchor) const {
+    uint32_t seq;
+    do {
+        seq = mAnchorSeq.load(std::memory_order_acquire);
+        anchor->mTimeMediaUs = mPublishedTimeMediaUs.load(std::memory_order_relaxed);
+        anchor->mTimeRealUs = mPublishedTimeRealUs.load(std::memory_order_relaxed);
+        anchor->mMaxTimeMediaUs = mPublishedMaxTimeMediaUs.load(std::memory_order_relaxed);
+        anchor->mStartingTimeMediaUs =
+                mPublishedStartingTimeMediaUs.load(std::memory_order_relaxed);
+        anchor->mPlaybackRate = mPublishedPlaybackRate.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) != 0 || seq != mAnchorSeq.load(std::memory_order_relaxed));
+}
+
+void MediaClock::publishAnchor_l() {
+    uint32_t seq = mAnchorSeq.load(std::memory_order_relaxed);
+    mAnchorSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    mPublishedTimeMediaUs.store(mAnchorTimeMediaUs, std::memory_order_relaxed);
+    mPublishedTimeRealUs.store(mAnchorTimeRealUs, std::memory_order_relaxed);
+    mPublishedMaxTimeMediaUs.store(mMaxTimeMediaUs, std::memory_order_relaxed);
+    mPublishedStartingTimeMediaUs.store(mStartingTimeMediaUs, std::memory_order_relaxed);
+    mPublishedPlaybackRate.store(mPlaybackRate, std::memory_order_relaxed);
+    mAnchorSeq.store(seq + 2, std::memory_order_release);
+}
+
+void MediaClock::addTimer(const sp<AMessage> &notify, int64_t mediaTimeUs,
+                          int64_t adjustRealUs) {
+    Mutex::Autolock autoLock(mLock);
+    if (mLooper == NULL) {
+        mLooper = new ALooper;
+        mLooper->setName("MediaClock");
+        mLooper->start(false /* runOnCallingThread */, false /* canCallJava */,
+                       ANDROID_PRIORITY_AUDIO);
+        mLooper->registerHandler(this);
+    }
+
+    mTimers.push_back(Timer(notify, mediaTimeUs, adjustRealUs));
+    processTimers_l();
+}
+
+void MediaClock::reset() {
+    Mutex::Autolock autoLock(mLock);
+    for (List<Timer>::iterator it = mTimers.begin(); it != mTimers.end(); ++it) {
+        it->mNotify->setInt32("reason", TIMER_REASON_RESET);
+        it->mNotify->post();
+    }
+    mTimers.clear();
+    ++mGeneration;
+}
+
+// Posts the timers that are due, and schedules a wake up for the next one.
+void MediaClock::processTimers_l() {
+    if (mTimers.empty()) {
+        return;
+    }
+    // Any wake up already scheduled was for the anchor or timers as they were.
+    ++mGeneration;
+
+    Anchor anchor = { mAnchorTimeMediaUs, mAnchorTimeRealUs, mMaxTimeMediaUs,
+                      mStartingTimeMediaUs, mPlaybackRate };
+    int64_t nowMediaUs;
+    if (mPlaybackRate == 0.0 || getMediaTime(
+            anchor, ALooper::GetNowUs(), &nowMediaUs, true /* allowPastMaxTime */) != OK) {
+        // The timers wait for the clock to start.
+        return;
+    }
+
+    int64_t nextLapseRealUs = INT64_MAX;
+    for (List<Timer>::iterator it = mTimers.begin(); it != mTimers.end(); ) {
+        int64_t diffRealUs = (it->mMediaTimeUs - nowMediaUs) / (double)mPlaybackRate
+                + it->mAdjustRealUs;
+        if (diffRealUs <= 0) {
+            it->mNotify->setInt32("reason", TIMER_REASON_REACHED);
+            it->mNotify->post();
+            it = mTimers.erase(it);
+        } else {
+            nextLapseRealUs = std::min(nextLapseRealUs, diffRealUs);
+            ++it;
+        }
+    }
+
+    if (nextLapseRealUs != INT64_MAX) {
+        sp<AMessage> msg = new AMessage(kWhatTimeIsUp, this);
+        msg->setInt32("generation", mGeneration);
+        msg->post(nextLapseRealUs);
+    }
+}
+
+void MediaClock::onMessageReceived(const sp<AMessage> &msg) {
+    switch (msg->what()) {
+        case kWhatTimeIsUp:
+        {
+            int32_t generation;
+            CHECK(msg->findInt32("generation", &generation));
+
+            Mutex::Autolock autoLock(mLock);
+            if (generation != mGeneration) {
+                break;
+            }
+            processTimers_l();
+            break;
+        }
+
+        default:
+            TRESPASS();
+            break;
+    }
+}
+
 }  // namespace android
@@ -486,6 +486,7 @@ MediaCodec::MediaCodec(const sp<ALooper> &looper, pid_t pid, uid_t uid)
       mDequeueInputReplyID(0),
       mDequeueOutputTimeoutGeneration(0),
       mDequeueOutputReplyID(0),
+      mDequeueOutputMaxBuffers(1),
       mHaveInputSurface(false),
       mHavePendingInputBuffers(false) {
     if (uid == kNoUid) {
@@ -507,6 +508,9 @@ MediaCodec::~MediaCodec() {
     mResourceManagerService->removeResource(getId(mResourceManagerClient));
 
     if (mAnalyticsItem != NULL ) {
+        if (mCodec != NULL) {
+            mCodec->exportMetrics(mAnalyticsItem);
+        }
         if (mAnalyticsItem->count() > 0) {
             mAnalyticsItem->setFinalized(true);
             mAnalyticsItem->selfrecord();
@@ -1021,6 +1025,27 @@ status_t MediaCodec::queueInputBuffer(
     return PostAndAwaitResponse(msg, &response);
 }
 
+status_t MediaCodec::queueInputBuffers(
+        const Vector<BufferDescriptor> &buffers,
+        size_t *numQueued,
+        AString *errorDetailMsg) {
+    if (errorDetailMsg != NULL) {
+        errorDetailMsg->clear();
+    }
+
+    sp<AMessage> msg = new AMessage(kWhatQueueInputBuffers, this);
+    msg->setPointer("buffers", (void *)&buffers);
+    msg->setPointer("errorDetailMsg", errorDetailMsg);
+
+    sp<AMessage> response;
+    status_t err = PostAndAwaitResponse(msg, &response);
+
+    if (response == NULL || !response->findSize("queued", numQueued)) {
+        *numQueued = 0;
+    }
+    return err;
+}
+
 status_t MediaCodec::queueSecureInputBuffer(
         size_t index,
         size_t offset,
@@ -1097,6 +1122,44 @@ status_t MediaCodec::dequeueOutputBuffer(
     return OK;
 }
 
+status_t MediaCodec::dequeueOutputBuffers(
+        Vector<BufferDescriptor> *buffers,
+        size_t maxBuffers,
+        int64_t timeoutUs) {
+    buffers->clear();
+    if (maxBuffers == 0) {
+        return BAD_VALUE;
+    }
+
+    sp<AMessage> msg = new AMessage(kWhatDequeueOutputBuffer, this);
+    msg->setInt64("timeoutUs", timeoutUs);
+    msg->setSize("maxBuffers", maxBuffers);
+
+    sp<AMessage> response;
+    status_t err;
+    if ((err = PostAndAwaitResponse(msg, &response)) != OK) {
+        return err;
+    }
+
+    sp<ABuffer> descs;
+    if (response->findBuffer("buffers", &descs)) {
+        buffers->appendArray(
+                (const BufferDescriptor *)descs->data(),
+                descs->size() / sizeof(BufferDescriptor));
+        return OK;
+    }
+
+    BufferDescriptor desc;
+    CHECK(response->findSize("index", &desc.mIndex));
+    CHECK(response->findSize("offset", &desc.mOffset));
+    CHECK(response->findSize("size", &desc.mSize));
+    CHECK(response->findInt64("timeUs", &desc.mPresentationTimeUs));
+    CHECK(response->findInt32("flags", (int32_t *)&desc.mFlags));
+    buffers->push_back(desc);
+
+    return OK;
+}
+
 status_t MediaCodec::renderOutputBufferAndRelease(size_t index) {
     sp<AMessage> msg = new AMessage(kWhatReleaseOutputBuffer, this);
     msg->setSize("index", index);
@@ -1341,7 +1404,8 @@ bool MediaCodec::handleDequeueInputBuffer(const sp<AReplyToken> &replyID, bool n
     return true;
 }
 
-bool MediaCodec::handleDequeueOutputBuffer(const sp<AReplyToken> &replyID, bool newRequest) {
+bool MediaCodec::handleDequeueOutputBuffer(
+        const sp<AReplyToken> &replyID, bool newRequest, size_t maxBuffers) {
     if (!isExecuting() || (mFlags & kFlagIsAsync)
             || (newRequest && (mFlags & kFlagDequeueOutputPending))) {
         PostReplyWithError(replyID, INVALID_OPERATION);
@@ -1362,22 +1426,29 @@ bool MediaCodec::handleDequeueOutputBuffer(const sp<AReplyToken> &replyID, bool
             return false;
         }
 
-        const sp<MediaCodecBuffer> &buffer =
-            mPortBuffers[kPortIndexOutput][index].mData;
-
-        response->setSize("index", index);
-        response->setSize("offset", buffer->offset());
-        response->setSize("size", buffer->size());
-
-        int64_t timeUs;
-        CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
-
-        response->setInt64("timeUs", timeUs);
-
-        int32_t flags;
-        CHECK(buffer->meta()->findInt32("flags", &flags));
+        BufferDescriptor desc;
+        getOutputBufferDescriptor(index, &desc);
+
+        response->setSize("index", desc.mIndex);
+        response->setSize("offset", desc.mOffset);
+        response->setSize("size", desc.mSize);
+        response->setInt64("timeUs", desc.mPresentationTimeUs);
+        response->setInt32("flags", desc.mFlags);
+
+        if (maxBuffers > 1) {
+            // The rest of the buffers that are ready, up to |maxBuffers|.
+            sp<ABuffer> descs = new ABuffer(maxBuffers * sizeof(BufferDescriptor));
+            BufferDescriptor *out = (BufferDescriptor *)descs->data();
+            size_t count = 0;
+            out[count++] = desc;
+            while (count < maxBuffers
+                    && (index = dequeuePortBuffer(kPortIndexOutput)) >= 0) {
+                getOutputBufferDescriptor(index, &out[count++]);
+            }
+            descs->setRange(0, count * sizeof(BufferDescriptor));
+            response->setBuffer("buffers", descs);
+        }
 
-        response->setInt32("flags", flags);
         response->postReply(replyID);
     }
 
@@ -1816,11 +1887,14 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
                     if (mFlags & kFlagIsAsync) {
                         onOutputBufferAvailable();
                     } else if (mFlags & kFlagDequeueOutputPending) {
-                        CHECK(handleDequeueOutputBuffer(mDequeueOutputReplyID));
+                        CHECK(handleDequeueOutputBuffer(
+                                mDequeueOutputReplyID, false /* newRequest */,
+                                mDequeueOutputMaxBuffers));
 
                         ++mDequeueOutputTimeoutGeneration;
                         mFlags &= ~kFlagDequeueOutputPending;
                         mDequeueOutputReplyID = 0;
+                        mDequeueOutputMaxBuffers = 1;
                     } else {
                         postActivityNotificationIfPossible();
                     }
@@ -1953,9 +2027,16 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
 
             mCallback = callback;
 
+            mFlags &= ~(kFlagBatchOutputCallbacks | kFlagOutputCallbacksPending);
             if (mCallback != NULL) {
                 ALOGI("MediaCodec will operate in async mode");
                 mFlags |= kFlagIsAsync;
+
+                int32_t batchOutputs;
+                if (mCallback->findInt32("batch-outputs", &batchOutputs)
+                        && batchOutputs) {
+                    mFlags |= kFlagBatchOutputCallbacks;
+                }
             } else {
                 mFlags &= ~kFlagIsAsync;
             }
@@ -2332,6 +2413,49 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatQueueInputBuffers:
+        {
+            sp<AReplyToken> replyID;
+            CHECK(msg->senderAwaitsResponse(&replyID));
+
+            if (!isExecuting()) {
+                PostReplyWithError(replyID, INVALID_OPERATION);
+                break;
+            } else if (mFlags & kFlagStickyError) {
+                PostReplyWithError(replyID, getStickyError());
+                break;
+            }
+
+            const Vector<BufferDescriptor> *buffers;
+            CHECK(msg->findPointer("buffers", (void **)&buffers));
+            void *errorDetailMsg;
+            CHECK(msg->findPointer("errorDetailMsg", &errorDetailMsg));
+
+            status_t err = OK;
+            size_t queued = 0;
+            for (; queued < buffers->size(); ++queued) {
+                const BufferDescriptor &desc = buffers->itemAt(queued);
+                sp<AMessage> bufferMsg = new AMessage;
+                bufferMsg->setSize("index", desc.mIndex);
+                bufferMsg->setSize("offset", desc.mOffset);
+                bufferMsg->setSize("size", desc.mSize);
+                bufferMsg->setInt64("timeUs", desc.mPresentationTimeUs);
+                bufferMsg->setInt32("flags", desc.mFlags);
+                bufferMsg->setPointer("errorDetailMsg", errorDetailMsg);
+
+                err = onQueueInputBuffer(bufferMsg);
+                if (err != OK) {
+                    break;
+                }
+            }
+
+            sp<AMessage> response = new AMessage;
+            response->setInt32("err", err);
+            response->setSize("queued", queued);
+            response->postReply(replyID);
+            break;
+        }
+
         case kWhatDequeueOutputBuffer:
         {
             sp<AReplyToken> replyID;
@@ -2343,7 +2467,12 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
                 break;
             }
 
-            if (handleDequeueOutputBuffer(replyID, true /* new request */)) {
+            size_t maxBuffers;
+            if (!msg->findSize("maxBuffers", &maxBuffers)) {
+                maxBuffers = 1;
+            }
+
+            if (handleDequeueOutputBuffer(replyID, true /* new request */, maxBuffers)) {
                 break;
             }
 
@@ -2357,6 +2486,9 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
 
             mFlags |= kFlagDequeueOutputPending;
             mDequeueOutputReplyID = replyID;
+            if (!msg->findSize("maxBuffers", &mDequeueOutputMaxBuffers)) {
+                mDequeueOutputMaxBuffers = 1;
+            }
 
             if (timeoutUs > 0ll) {
                 sp<AMessage> timeoutMsg =
@@ -2551,6 +2683,14 @@ void MediaCodec::onMessageReceived(const sp<AMessage> &msg) {
             break;
         }
 
+        case kWhatPostOutputCallbacks:
+        {
+            if (mFlags & kFlagOutputCallbacksPending) {
+                postOutputCallbacks();
+            }
+            break;
+        }
+
         case kWhatDrmReleaseCrypto:
         {
             onReleaseCrypto(msg);
@@ -2635,6 +2775,8 @@ void MediaCodec::setState(State newState) {
         mFlags &= ~kFlagStickyError;
         mFlags &= ~kFlagIsEncoder;
         mFlags &= ~kFlagIsAsync;
+        mFlags &= ~kFlagBatchOutputCallbacks;
+        mFlags &= ~kFlagOutputCallbacksPending;
         mStickyError = OK;
 
         mActivityNotify.clear();
@@ -3017,28 +3159,71 @@ void MediaCodec::onInputBufferAvailable() {
 }
 
 void MediaCodec::onOutputBufferAvailable() {
+    if (mFlags & kFlagBatchOutputCallbacks) {
+        // Let the buffers that the codec returns in this burst gather, and
+        // send them in one callback.
+        if (!(mFlags & kFlagOutputCallbacksPending)) {
+            mFlags |= kFlagOutputCallbacksPending;
+            (new AMessage(kWhatPostOutputCallbacks, this))->post();
+        }
+        return;
+    }
+
     int32_t index;
     while ((index = dequeuePortBuffer(kPortIndexOutput)) >= 0) {
-        const sp<MediaCodecBuffer> &buffer =
-            mPortBuffers[kPortIndexOutput][index].mData;
+        BufferDescriptor desc;
+        getOutputBufferDescriptor(index, &desc);
+
         sp<AMessage> msg = mCallback->dup();
         msg->setInt32("callbackID", CB_OUTPUT_AVAILABLE);
         msg->setInt32("index", index);
-        msg->setSize("offset", buffer->offset());
-        msg->setSize("size", buffer->size());
+        msg->setSize("offset", desc.mOffset);
+        msg->setSize("size", desc.mSize);
+        msg->setInt64("timeUs", desc.mPresentationTimeUs);
+        msg->setInt32("flags", desc.mFlags);
 
-        int64_t timeUs;
-        CHECK(buffer->meta()->findInt64("timeUs", &timeUs));
+        msg->post();
+    }
+}
 
-        msg->setInt64("timeUs", timeUs);
+void MediaCodec::postOutputCallbacks() {
+    mFlags &= ~kFlagOutputCallbacksPending;
+    if (mCallback == NULL) {
+        return;
+    }
 
-        int32_t flags;
-        CHECK(buffer->meta()->findInt32("flags", &flags));
+    Vector<BufferDescriptor> descs;
+    ssize_t index;
+    while ((index = dequeuePortBuffer(kPortIndexOutput)) >= 0) {
+        BufferDescriptor desc;
+        getOutputBufferDescriptor(index, &desc);
+        descs.push_back(desc);
+    }
+    if (descs.isEmpty()) {
+        return;
+    }
 
-        msg->setInt32("flags", flags);
+    sp<ABuffer> buffers = ABuffer::CreateAsCopy(
+            descs.array(), descs.size() * sizeof(BufferDescriptor));
+    sp<AMessage> msg = mCallback->dup();
+    msg->setInt32("callbackID", CB_OUTPUTS_AVAILABLE);
+    msg->setBuffer("buffers", buffers);
+    msg->post();
+}
 
-        msg->post();
-    }
+void MediaCodec::getOutputBufferDescriptor(size_t index, BufferDescriptor *desc) {
+    const sp<MediaCodecBuffer> &buffer =
+        mPortBuffers[kPortIndexOutput][index].mData;
+
+    desc->mIndex = index;
+    desc->mOffset = buffer->offset();
+    desc->mSize = buffer->size();
+
+    CHECK(buffer->meta()->findInt64("timeUs", &desc->mPresentationTimeUs));
+
+    int32_t flags;
+    CHECK(buffer->meta()->findInt32("flags", &flags));
+    desc->mFlags = flags;
 }
 
 void MediaCodec::onError(status_t err, int32_t actionCode, const char *detail) {
@@ -3057,6 +3242,10 @@ void MediaCodec::onError(status_t err, int32_t actionCode, const char *detail) {
 }
 
 void MediaCodec::onOutputFormatChanged() {
+    if (mFlags & kFlagOutputCallbacksPending) {
+        // Buffers in the old format go first.
+        postOutputCallbacks();
+    }
     if (mCallback != NULL) {
         sp<AMessage> msg = mCallback->dup();
         msg->setInt32("callbackID", CB_OUTPUT_FORMAT_CHANGED);
@@ -21,6 +21,7 @@
 #include "MediaCodecListOverrides.h"
 
 #include <binder/IServiceManager.h>
+#include <binder/Parcel.h>
 
 #include <media/IMediaCodecList.h>
 #include <media/IMediaPlayerService.h>
@@ -36,7 +37,10 @@
 #include <media/stagefright/MediaErrors.h>
 #include <media/stagefright/OMXClient.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <utils/threads.h>
 
 #include <cutils/properties.h>
@@ -46,6 +50,20 @@ namespace android {
 
 static Mutex sInitMutex;
 
+// Written by the media server next to the profiling results, and mapped by
+// every other process using the list.
+static const char *kCodecListSnapshot = "/data/misc/media/media_codecs_snapshot.bin";
+
+static const int32_t kSnapshotMagic = 0x4d434c53;  // 'MCLS'
+// bump when the layout of the snapshot or of the parceled MediaCodecInfos changes
+static const int32_t kSnapshotVersion = 1;
+static const off_t kMaxSnapshotSize = 4 * 1024 * 1024;
+
+static const char *kAdvancedFeatures[] = {
+    "feature-secure-playback",
+    "feature-tunneled-playback",
+};
+
 static bool parseBoolean(const char *s) {
     if (!strcasecmp(s, "true") || !strcasecmp(s, "yes") || !strcasecmp(s, "y")) {
         return true;
@@ -101,10 +119,12 @@ void *MediaCodecList::profilerThreadWrapper(void * /*arg*/) {
     profileCodecs(infos);
     ALOGV("Codec profiling completed.");
     codecList->parseTopLevelXMLFile(kProfilingResults, true /* ignore_errors */);
+    codecList->buildTypeIndex();
 
     {
         Mutex::Autolock autoLock(sInitMutex);
         sCodecList = codecList;
+        codecList->writeSnapshot(kCodecListSnapshot);
     }
     return NULL;
 }
@@ -117,6 +137,7 @@ sp<IMediaCodecList> MediaCodecList::getLocalInstance() {
         MediaCodecList *codecList = new MediaCodecList;
         if (codecList->initCheck() == OK) {
             sCodecList = codecList;
+            codecList->writeSnapshot(kCodecListSnapshot);
 
             if (isProfilingNeeded()) {
                 ALOGV("Codec profiling needed, will be run in separated thread.");
@@ -150,6 +171,14 @@ void MediaCodecList::BinderDeathObserver::binderDied(const wp<IBinder> &who __un
 sp<IMediaCodecList> MediaCodecList::getInstance() {
     Mutex::Autolock _l(sRemoteInitMutex);
     if (sRemoteList == NULL) {
+        // a snapshot of the media server's list avoids a binder call per query
+        MediaCodecList *snapshotList = new MediaCodecList(kCodecListSnapshot);
+        if (snapshotList->initCheck() == OK) {
+            sRemoteList = snapshotList;
+            return sRemoteList;
+        }
+        delete snapshotList;
+
         sp<IBinder> binder =
             defaultServiceManager()->getService(String16("media.player"));
         sp<IMediaPlayerService> service =
@@ -205,6 +234,168 @@ MediaCodecList::MediaCodecList()
         parseTopLevelXMLFile(config_file_path, true/* ignore_errors */);
     }
     parseTopLevelXMLFile(kProfilingResults, true/* ignore_errors */);
+    buildTypeIndex();
+}
+
+MediaCodecList::MediaCodecList(const char *snapshotPath)
+    : mInitCheck(NO_INIT),
+      mUpdate(false),
+      mGlobalSettings(new AMessage()) {
+    int fd = open(snapshotPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size <= kMaxSnapshotSize) {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            Parcel parcel;
+            if (parcel.setData((const uint8_t *)data, st.st_size) == OK) {
+                mInitCheck = readSnapshot(parcel);
+            }
+            munmap(data, st.st_size);
+        }
+    }
+    close(fd);
+
+    if (mInitCheck == OK) {
+        buildTypeIndex();
+    } else {
+        ALOGV("ignoring codec list snapshot %s (%d)", snapshotPath, mInitCheck);
+        mCodecInfos.clear();
+    }
+}
+
+static void appendFileKey(AString *key, const char *path) {
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        key->append(AStringPrintf(" %s:%lld:%lld.%09ld", path, (long long)st.st_size,
+                (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec));
+    }
+}
+
+// static
+AString MediaCodecList::getSnapshotKey() {
+    // the files included by media_codecs.xml only change with the build
+    AString key = getProfilingVersionString();
+    char config_file_path[MEDIA_CODECS_CONFIG_FILE_PATH_MAX_LENGTH];
+    if (findMediaCodecListFileFullPath("media_codecs.xml", config_file_path)) {
+        appendFileKey(&key, config_file_path);
+    }
+    if (findMediaCodecListFileFullPath("media_codecs_performance.xml",
+                                       config_file_path)) {
+        appendFileKey(&key, config_file_path);
+    }
+    appendFileKey(&key, kProfilingResults);
+    return key;
+}
+
+status_t MediaCodecList::writeSnapshot(const char *path) const {
+    Parcel parcel;
+    parcel.writeInt32(kSnapshotMagic);
+    parcel.writeInt32(kSnapshotVersion);
+    getSnapshotKey().writeToParcel(&parcel);
+    mGlobalSettings->writeToParcel(&parcel);
+    parcel.writeInt32(mCodecInfos.size());
+    for (size_t i = 0; i < mCodecInfos.size(); ++i) {
+        mCodecInfos.itemAt(i)->writeToParcel(&parcel);
+    }
+
+    // write to a temporary file and rename it so that readers never see a
+    // partial snapshot
+    AString tmpPath = AStringPrintf("%s.tmp", path);
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        status_t err = -errno;
+        // only the media server may write the snapshot
+        ALOGV("cannot create codec list snapshot %s (%s)", tmpPath.c_str(), strerror(-err));
+        return err;
+    }
+
+    const uint8_t *data = parcel.data();
+    size_t remaining = parcel.dataSize();
+    while (remaining > 0) {
+        ssize_t n = TEMP_FAILURE_RETRY(write(fd, data, remaining));
+        if (n <= 0) {
+            break;
+        }
+        data += n;
+        remaining -= n;
+    }
+    close(fd);
+
+    if (remaining > 0 || rename(tmpPath.c_str(), path) != 0) {
+        ALOGW("failed to write codec list snapshot %s", path);
+        unlink(tmpPath.c_str());
+        return ERROR_IO;
+    }
+    return OK;
+}
+
+status_t MediaCodecList::readSnapshot(const Parcel &parcel) {
+    if (parcel.readInt32() != kSnapshotMagic || parcel.readInt32() != kSnapshotVersion) {
+        return ERROR_MALFORMED;
+    }
+    if (AString::FromParcel(parcel) != getSnapshotKey()) {
+        return -ESTALE;
+    }
+
+    mGlobalSettings = AMessage::FromParcel(parcel);
+    if (mGlobalSettings == NULL) {
+        return ERROR_MALFORMED;
+    }
+
+    size_t numCodecs = static_cast<size_t>(parcel.readInt32());
+    if (numCodecs > parcel.dataAvail()) {
+        return ERROR_MALFORMED;
+    }
+    for (size_t i = 0; i < numCodecs; ++i) {
+        sp<MediaCodecInfo> info = MediaCodecInfo::FromParcel(parcel);
+        if (info == NULL) {
+            return ERROR_MALFORMED;
+        }
+        mCodecInfos.push_back(info);
+    }
+    return OK;
+}
+
+static bool isAdvancedCodec(const sp<AMessage> &details) {
+    int32_t required;
+    for (size_t ix = 0; ix < ARRAY_SIZE(kAdvancedFeatures); ix++) {
+        if (details->findInt32(kAdvancedFeatures[ix], &required) && required != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MediaCodecList::buildTypeIndex() {
+    mTypeIndex[0].clear();
+    mTypeIndex[1].clear();
+
+    for (size_t i = 0; i < mCodecInfos.size(); ++i) {
+        const MediaCodecInfo &info = *mCodecInfos.itemAt(i).get();
+        KeyedVector<AString, Vector<size_t> > &index = mTypeIndex[info.isEncoder()];
+
+        for (size_t j = 0; j < info.mCaps.size(); ++j) {
+            // findCodecByType() is a legacy method and skips advanced codecs
+            AString type = info.mCaps.keyAt(j);
+            type.tolower();
+            if (isAdvancedCodec(info.getCapabilitiesFor(type.c_str())->getDetails())) {
+                continue;
+            }
+
+            ssize_t ix = index.indexOfKey(type);
+            if (ix < 0) {
+                ix = index.add(type, Vector<size_t>());
+            }
+            Vector<size_t> &codecs = index.editValueAt(ix);
+            if (codecs.isEmpty() || codecs.itemAt(codecs.size() - 1) != i) {
+                codecs.push_back(i);
+            }
+        }
+    }
 }
 
 void MediaCodecList::parseTopLevelXMLFile(const char *codecs_xml, bool ignore_errors) {
@@ -877,36 +1068,22 @@ status_t MediaCodecList::addTypeFromAttributes(const char **attrs) {
 // legacy method for non-advanced codecs
 ssize_t MediaCodecList::findCodecByType(
         const char *type, bool encoder, size_t startIndex) const {
-    static const char *advancedFeatures[] = {
-        "feature-secure-playback",
-        "feature-tunneled-playback",
-    };
-
-    size_t numCodecs = mCodecInfos.size();
-    for (; startIndex < numCodecs; ++startIndex) {
-        const MediaCodecInfo &info = *mCodecInfos.itemAt(startIndex).get();
+    if (type == NULL) {
+        return -ENOENT;
+    }
 
-        if (info.isEncoder() != encoder) {
-            continue;
-        }
-        sp<MediaCodecInfo::Capabilities> capabilities = info.getCapabilitiesFor(type);
-        if (capabilities == NULL) {
-            continue;
-        }
-        const sp<AMessage> &details = capabilities->getDetails();
-
-        int32_t required;
-        bool isAdvanced = false;
-        for (size_t ix = 0; ix < ARRAY_SIZE(advancedFeatures); ix++) {
-            if (details->findInt32(advancedFeatures[ix], &required) &&
-                    required != 0) {
-                isAdvanced = true;
-                break;
-            }
-        }
+    AString lowerType(type);
+    lowerType.tolower();
+    const KeyedVector<AString, Vector<size_t> > &index = mTypeIndex[encoder];
+    ssize_t ix = index.indexOfKey(lowerType);
+    if (ix < 0) {
+        return -ENOENT;
+    }
 
-        if (!isAdvanced) {
-            return startIndex;
+    const Vector<size_t> &codecs = index.valueAt(ix);
+    for (size_t i = 0; i < codecs.size(); ++i) {
+        if (codecs.itemAt(i) >= startIndex) {
+            return codecs.itemAt(i);
         }
     }
 
@@ -498,6 +498,7 @@ status_t MediaCodecSource::initEncoder() {
         ALOGV("output format is '%s'", mOutputFormat->debugString(0).c_str());
 
         mEncoderActivityNotify = new AMessage(kWhatEncoderActivity, mReflector);
+        mEncoderActivityNotify->setInt32("batch-outputs", 1);
         mEncoder->setCallback(mEncoderActivityNotify);
 
         err = mEncoder->configure(
@@ -726,6 +727,95 @@ status_t MediaCodecSource::feedEncoderInputBuffers() {
     return OK;
 }
 
+bool MediaCodecSource::onEncoderOutputBuffer(
+        int32_t index, int64_t timeUs, int32_t flags, List<MediaBuffer *> *buffers) {
+    if (flags & MediaCodec::BUFFER_FLAG_EOS) {
+        mEncoder->releaseOutputBuffer(index);
+        return false;
+    }
+
+    sp<MediaCodecBuffer> outbuf;
+    status_t err = mEncoder->getOutputBuffer(index, &outbuf);
+    if (err != OK || outbuf == NULL || outbuf->data() == NULL
+        || outbuf->size() == 0) {
+        return false;
+    }
+
+    MediaBuffer *mbuf = new MediaBuffer(outbuf->size());
+    mbuf->setObserver(this);
+    mbuf->add_ref();
+
+    if (!(flags & MediaCodec::BUFFER_FLAG_CODECCONFIG)) {
+        if (mIsVideo) {
+            int64_t decodingTimeUs;
+            if (mFlags & FLAG_USE_SURFACE_INPUT) {
+                if (mFirstSampleSystemTimeUs < 0ll) {
+                    mFirstSampleSystemTimeUs = systemTime() / 1000;
+                    if (mPausePending) {
+                        mPausePending = false;
+                        onPause(mFirstSampleSystemTimeUs);
+                        mbuf->release();
+                        return true;
+                    }
+                }
+                // Timestamp offset is already adjusted in GraphicBufferSource.
+                // GraphicBufferSource is supposed to discard samples
+                // queued before start, and offset timeUs by start time
+                CHECK_GE(timeUs, 0ll);
+                // TODO:
+                // Decoding time for surface source is unavailable,
+                // use presentation time for now. May need to move
+                // this logic into MediaCodec.
+                decodingTimeUs = timeUs;
+            } else {
+                CHECK(!mDecodingTimeQueue.empty());
+                decodingTimeUs = *(mDecodingTimeQueue.begin());
+                mDecodingTimeQueue.erase(mDecodingTimeQueue.begin());
+            }
+            mbuf->meta_data()->setInt64(kKeyDecodingTime, decodingTimeUs);
+
+            ALOGV("[video] time %" PRId64 " us (%.2f secs), dts/pts diff %" PRId64,
+                    timeUs, timeUs / 1E6, decodingTimeUs - timeUs);
+        } else {
+            int64_t driftTimeUs = 0;
+#if DEBUG_DRIFT_TIME
+            CHECK(!mDriftTimeQueue.empty());
+            driftTimeUs = *(mDriftTimeQueue.begin());
+            mDriftTimeQueue.erase(mDriftTimeQueue.begin());
+            mbuf->meta_data()->setInt64(kKeyDriftTime, driftTimeUs);
+#endif // DEBUG_DRIFT_TIME
+            ALOGV("[audio] time %" PRId64 " us (%.2f secs), drift %" PRId64,
+                    timeUs, timeUs / 1E6, driftTimeUs);
+        }
+        mbuf->meta_data()->setInt64(kKeyTime, timeUs);
+    } else {
+        mbuf->meta_data()->setInt64(kKeyTime, 0ll);
+        mbuf->meta_data()->setInt32(kKeyIsCodecConfig, true);
+    }
+    if (flags & MediaCodec::BUFFER_FLAG_SYNCFRAME) {
+        mbuf->meta_data()->setInt32(kKeyIsSyncFrame, true);
+    }
+    memcpy(mbuf->data(), outbuf->data(), outbuf->size());
+
+    buffers->push_back(mbuf);
+
+    mEncoder->releaseOutputBuffer(index);
+    return true;
+}
+
+void MediaCodecSource::queueOutputBuffers(List<MediaBuffer *> *buffers) {
+    if (buffers->empty()) {
+        return;
+    }
+
+    Mutexed<Output>::Locked output(mOutput);
+    for (List<MediaBuffer *>::iterator it = buffers->begin(); it != buffers->end(); ++it) {
+        output->mBufferQueue.push_back(*it);
+    }
+    buffers->clear();
+    output->mCond.signal();
+}
+
 status_t MediaCodecSource::onStart(MetaData *params) {
     if (mStopping) {
         ALOGE("Failed to start while we're stopping");
@@ -858,83 +948,31 @@ void MediaCodecSource::onMessageReceived(const sp<AMessage> &msg) {
             CHECK(msg->findInt64("timeUs", &timeUs));
             CHECK(msg->findInt32("flags", &flags));
 
-            if (flags & MediaCodec::BUFFER_FLAG_EOS) {
-                mEncoder->releaseOutputBuffer(index);
-                signalEOS();
-                break;
-            }
-
-            sp<MediaCodecBuffer> outbuf;
-            status_t err = mEncoder->getOutputBuffer(index, &outbuf);
-            if (err != OK || outbuf == NULL || outbuf->data() == NULL
-                || outbuf->size() == 0) {
+            List<MediaBuffer *> buffers;
+            bool more = onEncoderOutputBuffer(index, timeUs, flags, &buffers);
+            queueOutputBuffers(&buffers);
+            if (!more) {
                 signalEOS();
-                break;
             }
-
-            MediaBuffer *mbuf = new MediaBuffer(outbuf->size());
-            mbuf->setObserver(this);
-            mbuf->add_ref();
-
-            if (!(flags & MediaCodec::BUFFER_FLAG_CODECCONFIG)) {
-                if (mIsVideo) {
-                    int64_t decodingTimeUs;
-                    if (mFlags & FLAG_USE_SURFACE_INPUT) {
-                        if (mFirstSampleSystemTimeUs < 0ll) {
-                            mFirstSampleSystemTimeUs = systemTime() / 1000;
-                            if (mPausePending) {
-                                mPausePending = false;
-                                onPause(mFirstSampleSystemTimeUs);
-                                mbuf->release();
-                                break;
-                            }
-                        }
-                        // Timestamp offset is already adjusted in GraphicBufferSource.
-                        // GraphicBufferSource is supposed to discard samples
-                        // queued before start, and offset timeUs by start time
-                        CHECK_GE(timeUs, 0ll);
-                        // TODO:
-                        // Decoding time for surface source is unavailable,
-                        // use presentation time for now. May need to move
-                        // this logic into MediaCodec.
-                        decodingTimeUs = timeUs;
-                    } else {
-                        CHECK(!mDecodingTimeQueue.empty());
-                        decodingTimeUs = *(mDecodingTimeQueue.begin());
-                        mDecodingTimeQueue.erase(mDecodingTimeQueue.begin());
-                    }
-                    mbuf->meta_data()->setInt64(kKeyDecodingTime, decodingTimeUs);
-
-                    ALOGV("[video] time %" PRId64 " us (%.2f secs), dts/pts diff %" PRId64,
-                            timeUs, timeUs / 1E6, decodingTimeUs - timeUs);
-                } else {
-                    int64_t driftTimeUs = 0;
-#if DEBUG_DRIFT_TIME
-                    CHECK(!mDriftTimeQueue.empty());
-                    driftTimeUs = *(mDriftTimeQueue.begin());
-                    mDriftTimeQueue.erase(mDriftTimeQueue.begin());
-                    mbuf->meta_data()->setInt64(kKeyDriftTime, driftTimeUs);
-#endif // DEBUG_DRIFT_TIME
-                    ALOGV("[audio] time %" PRId64 " us (%.2f secs), drift %" PRId64,
-                            timeUs, timeUs / 1E6, driftTimeUs);
-                }
-                mbuf->meta_data()->setInt64(kKeyTime, timeUs);
-            } else {
-                mbuf->meta_data()->setInt64(kKeyTime, 0ll);
-                mbuf->meta_data()->setInt32(kKeyIsCodecConfig, true);
-            }
-            if (flags & MediaCodec::BUFFER_FLAG_SYNCFRAME) {
-                mbuf->meta_data()->setInt32(kKeyIsSyncFrame, true);
+        } else if (cbID == MediaCodec::CB_OUTPUTS_AVAILABLE) {
+            sp<ABuffer> descs;
+            CHECK(msg->findBuffer("buffers", &descs));
+
+            // Hand the whole batch to the writer at once, so that it wakes
+            // up once per batch rather than once per buffer.
+            const MediaCodec::BufferDescriptor *desc =
+                (const MediaCodec::BufferDescriptor *)descs->data();
+            size_t count = descs->size() / sizeof(MediaCodec::BufferDescriptor);
+            List<MediaBuffer *> buffers;
+            bool more = true;
+            for (size_t i = 0; more && i < count; ++i) {
+                more = onEncoderOutputBuffer(
+                        desc[i].mIndex, desc[i].mPresentationTimeUs, desc[i].mFlags, &buffers);
             }
-            memcpy(mbuf->data(), outbuf->data(), outbuf->size());
-
-            {
-                Mutexed<Output>::Locked output(mOutput);
-                output->mBufferQueue.push_back(mbuf);
-                output->mCond.signal();
+            queueOutputBuffers(&buffers);
+            if (!more) {
+                signalEOS();
             }
-
-            mEncoder->releaseOutputBuffer(index);
        } else if (cbID == MediaCodec::CB_ERROR) {
             status_t err;
             CHECK(msg->findInt32("err", &err));
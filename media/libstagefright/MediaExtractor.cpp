@@ -20,6 +20,8 @@
 #include <inttypes.h>
 #include <pwd.h>
 
+#include <algorithm>
+
 #include "include/AMRExtractor.h"
 #include "include/MP3Extractor.h"
 #include "include/MPEG4Extractor.h"
@@ -171,7 +173,10 @@ sp<MediaExtractor> MediaExtractor::CreateFromService(
     MediaExtractor *ret = NULL;
     if (!strcasecmp(mime, MEDIA_MIMETYPE_CONTAINER_MPEG4)
             || !strcasecmp(mime, "audio/mp4")) {
-        ret = new MPEG4Extractor(source);
+        // lazy parsing leaves out kKeyMaxInputSize until a track is selected,
+        // so it is only used where no client configures codecs before that
+        ret = new MPEG4Extractor(
+                source, property_get_bool("media.stagefright.mpeg4.lazy", false));
     } else if (!strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_MPEG)) {
         ret = new MP3Extractor(source, meta);
     } else if (!strcasecmp(mime, MEDIA_MIMETYPE_AUDIO_AMR_NB)
@@ -222,8 +227,76 @@ sp<MediaExtractor> MediaExtractor::CreateFromService(
     return ret;
 }
 
+// Serves the sniffers from a copy of the start of the source, which is read
+// once, so that each sniffer does not read the same header from the source
+// again. Reads beyond the copy go to the source.
+class SniffSource : public DataSource {
+public:
+    explicit SniffSource(const sp<DataSource> &source)
+        : mSource(source),
+          mHeaderSize(0),
+          mHeaderIsWholeSource(false) {
+        ssize_t n = mSource->readAt(0, mHeader, sizeof(mHeader));
+        if (n > 0) {
+            mHeaderSize = n;
+            off64_t size;
+            mHeaderIsWholeSource = (size_t)n < sizeof(mHeader)
+                    && mSource->getSize(&size) == OK && size == n;
+        }
+    }
+
+    virtual status_t initCheck() const {
+        return mSource->initCheck();
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        if (offset >= 0 && offset < (off64_t)sizeof(mHeader)) {
+            if (offset + size <= mHeaderSize || mHeaderIsWholeSource) {
+                size_t n = offset < (off64_t)mHeaderSize
+                        ? std::min(size, (size_t)(mHeaderSize - offset)) : 0;
+                memcpy(data, mHeader + offset, n);
+                return n;
+            }
+        }
+        return mSource->readAt(offset, data, size);
+    }
+
+    virtual status_t getSize(off64_t *size) {
+        return mSource->getSize(size);
+    }
+
+    virtual uint32_t flags() {
+        return mSource->flags();
+    }
+
+    virtual String8 toString() {
+        return mSource->toString();
+    }
+
+    virtual const void *getMappedPointer(off64_t offset, size_t size) {
+        return mSource->getMappedPointer(offset, size);
+    }
+
+    virtual String8 getUri() {
+        return mSource->getUri();
+    }
+
+    virtual String8 getMIMEType() const {
+        return mSource->getMIMEType();
+    }
+
+private:
+    sp<DataSource> mSource;
+    size_t mHeaderSize;
+    bool mHeaderIsWholeSource;
+    // what most sniffers look at; MP3 and MPEG2 sniffing may scan further
+    uint8_t mHeader[32 * 1024];
+
+    DISALLOW_EVIL_CONSTRUCTORS(SniffSource);
+};
+
 Mutex MediaExtractor::gSnifferMutex;
-List<MediaExtractor::SnifferFunc> MediaExtractor::gSniffers;
+Vector<MediaExtractor::Sniffer> MediaExtractor::gSniffers;
 bool MediaExtractor::gSniffersRegistered = false;
 
 // static
@@ -233,24 +306,62 @@ bool MediaExtractor::sniff(
     *confidence = 0.0f;
     meta->clear();
 
+    Vector<Sniffer> sniffers;
     {
         Mutex::Autolock autoLock(gSnifferMutex);
         if (!gSniffersRegistered) {
             return false;
         }
+        sniffers = gSniffers;
     }
 
-    for (List<SnifferFunc>::iterator it = gSniffers.begin();
-         it != gSniffers.end(); ++it) {
+    // The result is that of sniffing in the order of registration: the
+    // highest confidence, and the first sniffer registered of those that
+    // report it. Trying the sniffers that won most often first lets the
+    // sniffing stop as soon as none of the rest can beat the result.
+    sp<DataSource> sniffSource = new SniffSource(source);
+    ssize_t best = -1;
+    for (size_t i = 0; i < sniffers.size(); ++i) {
+        if (best >= 0) {
+            bool canBeat = false;
+            for (size_t j = i; j < sniffers.size() && !canBeat; ++j) {
+                canBeat = sniffers[j].mMaxConfidence > *confidence
+                        || (sniffers[j].mMaxConfidence == *confidence
+                                && sniffers[j].mIndex < sniffers[best].mIndex);
+            }
+            if (!canBeat) {
+                break;
+            }
+        }
+
         String8 newMimeType;
         float newConfidence;
         sp<AMessage> newMeta;
-        if ((*it)(source, &newMimeType, &newConfidence, &newMeta)) {
-            if (newConfidence > *confidence) {
+        if (sniffers[i].mFunc(sniffSource, &newMimeType, &newConfidence, &newMeta)) {
+            if (newConfidence > *confidence
+                    || (best >= 0 && newConfidence == *confidence
+                            && sniffers[i].mIndex < sniffers[best].mIndex)) {
                 *mimeType = newMimeType;
                 *confidence = newConfidence;
                 *meta = newMeta;
+                best = i;
+            }
+        }
+    }
+
+    if (best >= 0) {
+        Mutex::Autolock autoLock(gSnifferMutex);
+        for (size_t i = 0; i < gSniffers.size(); ++i) {
+            if (gSniffers[i].mFunc != sniffers[best].mFunc) {
+                continue;
+            }
+            ++gSniffers.editItemAt(i).mWins;
+            for (; i > 0 && gSniffers[i].mWins > gSniffers[i - 1].mWins; --i) {
+                Sniffer sniffer = gSniffers[i];
+                gSniffers.replaceAt(gSniffers[i - 1], i);
+                gSniffers.replaceAt(sniffer, i - 1);
             }
+            break;
         }
     }
 
@@ -258,15 +369,19 @@ bool MediaExtractor::sniff(
 }
 
 // static
-void MediaExtractor::RegisterSniffer_l(SnifferFunc func) {
-    for (List<SnifferFunc>::iterator it = gSniffers.begin();
-         it != gSniffers.end(); ++it) {
-        if (*it == func) {
+void MediaExtractor::RegisterSniffer_l(SnifferFunc func, float maxConfidence) {
+    for (size_t i = 0; i < gSniffers.size(); ++i) {
+        if (gSniffers[i].mFunc == func) {
             return;
         }
     }
 
-    gSniffers.push_back(func);
+    Sniffer sniffer;
+    sniffer.mFunc = func;
+    sniffer.mMaxConfidence = maxConfidence;
+    sniffer.mIndex = gSniffers.size();
+    sniffer.mWins = 0;
+    gSniffers.push_back(sniffer);
 }
 
 // static
@@ -276,17 +391,18 @@ void MediaExtractor::RegisterDefaultSniffers() {
         return;
     }
 
-    RegisterSniffer_l(SniffMPEG4);
-    RegisterSniffer_l(SniffMatroska);
-    RegisterSniffer_l(SniffOgg);
-    RegisterSniffer_l(SniffWAV);
-    RegisterSniffer_l(SniffFLAC);
-    RegisterSniffer_l(SniffAMR);
-    RegisterSniffer_l(SniffMPEG2TS);
-    RegisterSniffer_l(SniffMP3);
-    RegisterSniffer_l(SniffAAC);
-    RegisterSniffer_l(SniffMPEG2PS);
-    RegisterSniffer_l(SniffMidi);
+    // The confidences must be kept in sync with those the sniffers report.
+    RegisterSniffer_l(SniffMPEG4, 0.4f);
+    RegisterSniffer_l(SniffMatroska, 0.6f);
+    RegisterSniffer_l(SniffOgg, 0.2f);
+    RegisterSniffer_l(SniffWAV, 0.3f);
+    RegisterSniffer_l(SniffFLAC, 0.5f);
+    RegisterSniffer_l(SniffAMR, 0.5f);
+    RegisterSniffer_l(SniffMPEG2TS, 0.1f);
+    RegisterSniffer_l(SniffMP3, 0.2f);
+    RegisterSniffer_l(SniffAAC, 0.2f);
+    RegisterSniffer_l(SniffMPEG2PS, 0.25f);
+    RegisterSniffer_l(SniffMidi, 0.8f);
 
     gSniffersRegistered = true;
 }
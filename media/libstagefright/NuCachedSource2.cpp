@@ -23,13 +23,223 @@
 #include "include/NuCachedSource2.h"
 #include "include/HTTPBase.h"
 
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
 #include <cutils/properties.h>
+#include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/MediaErrors.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
 
 namespace android {
 
+// A second tier for the data PageCache releases, so that seeking back does
+// not have to fetch it again. Extents of up to a slot each are kept in the
+// slots of an unlinked file, and once all slots are taken, the least
+// recently used extent makes room for a new one.
+struct DiskCache {
+    static DiskCache *Create(const char *dir, size_t slotSize, size_t numSlots);
+    ~DiskCache();
+
+    void write(off64_t offset, const void *data, size_t size);
+
+    // Reads |size| bytes at |offset| if all of them are cached.
+    bool read(off64_t offset, void *data, size_t size);
+
+private:
+    struct Extent {
+        off64_t mOffset;
+        size_t mSize;
+        size_t mSlot;
+        uint32_t mLastUse;
+    };
+
+    int mFd;
+    size_t mSlotSize;
+    size_t mNumSlots;
+    size_t mNumSlotsUsed;
+    uint32_t mUseCount;
+
+    // sorted by offset, and not overlapping
+    Vector<Extent> mExtents;
+    Vector<size_t> mFreeSlots;
+
+    DiskCache(int fd, size_t slotSize, size_t numSlots);
+
+    ssize_t findExtent(off64_t offset) const;
+    void removeExtentsIn(off64_t offset, size_t size);
+    ssize_t acquireSlot();
+
+    DISALLOW_EVIL_CONSTRUCTORS(DiskCache);
+};
+
+// static
+DiskCache *DiskCache::Create(const char *dir, size_t slotSize, size_t numSlots) {
+    if (numSlots == 0) {
+        return NULL;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/NuCachedSource2-XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        ALOGW("cannot create a disk cache in %s: %s", dir, strerror(errno));
+        return NULL;
+    }
+    // The file goes away with the last descriptor.
+    unlink(path);
+
+    return new DiskCache(fd, slotSize, numSlots);
+}
+
+DiskCache::DiskCache(int fd, size_t slotSize, size_t numSlots)
+    : mFd(fd),
+      mSlotSize(slotSize),
+      mNumSlots(numSlots),
+      mNumSlotsUsed(0),
+      mUseCount(0) {
+}
+
+DiskCache::~DiskCache() {
+    ::close(mFd);
+    mFd = -1;
+}
+
+ssize_t DiskCache::findExtent(off64_t offset) const {
+    // the last extent that starts at or before |offset|
+    size_t lo = 0;
+    size_t hi = mExtents.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (mExtents.itemAt(mid).mOffset <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == 0) {
+        return -1;
+    }
+    const Extent &extent = mExtents.itemAt(lo - 1);
+    return offset < extent.mOffset + (off64_t)extent.mSize ? lo - 1 : -1;
+}
+
+void DiskCache::removeExtentsIn(off64_t offset, size_t size) {
+    for (size_t i = mExtents.size(); i-- > 0;) {
+        const Extent &extent = mExtents.itemAt(i);
+        if (extent.mOffset < offset + (off64_t)size
+                && offset < extent.mOffset + (off64_t)extent.mSize) {
+            mFreeSlots.push(extent.mSlot);
+            mExtents.removeAt(i);
+        }
+    }
+}
+
+ssize_t DiskCache::acquireSlot() {
+    if (!mFreeSlots.empty()) {
+        size_t slot = mFreeSlots.top();
+        mFreeSlots.pop();
+        return slot;
+    }
+
+    if (mNumSlotsUsed < mNumSlots) {
+        return mNumSlotsUsed++;
+    }
+
+    if (mExtents.empty()) {
+        return -1;
+    }
+
+    size_t lru = 0;
+    for (size_t i = 1; i < mExtents.size(); ++i) {
+        if (mExtents.itemAt(i).mLastUse < mExtents.itemAt(lru).mLastUse) {
+            lru = i;
+        }
+    }
+    size_t slot = mExtents.itemAt(lru).mSlot;
+    mExtents.removeAt(lru);
+    return slot;
+}
+
+void DiskCache::write(off64_t offset, const void *data, size_t size) {
+    while (size > 0) {
+        size_t n = size < mSlotSize ? size : mSlotSize;
+
+        removeExtentsIn(offset, n);
+        ssize_t slot = acquireSlot();
+        if (slot < 0) {
+            return;
+        }
+
+        if (pwrite64(mFd, data, n, (off64_t)slot * mSlotSize) != (ssize_t)n) {
+            ALOGW("disk cache write failed: %s", strerror(errno));
+            mFreeSlots.push(slot);
+            return;
+        }
+
+        Extent extent;
+        extent.mOffset = offset;
+        extent.mSize = n;
+        extent.mSlot = slot;
+        extent.mLastUse = ++mUseCount;
+
+        size_t lo = 0;
+        size_t hi = mExtents.size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (mExtents.itemAt(mid).mOffset < offset) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        mExtents.insertAt(extent, lo);
+
+        offset += n;
+        data = (const uint8_t *)data + n;
+        size -= n;
+    }
+}
+
+bool DiskCache::read(off64_t offset, void *data, size_t size) {
+    while (size > 0) {
+        ssize_t index = findExtent(offset);
+        if (index < 0) {
+            return false;
+        }
+
+        Extent &extent = mExtents.editItemAt(index);
+        size_t delta = offset - extent.mOffset;
+        size_t n = extent.mSize - delta;
+        if (n > size) {
+            n = size;
+        }
+
+        if (pread64(mFd, data, n, (off64_t)extent.mSlot * mSlotSize + delta)
+                != (ssize_t)n) {
+            return false;
+        }
+        extent.mLastUse = ++mUseCount;
+
+        offset += n;
+        data = (uint8_t *)data + n;
+        size -= n;
+    }
+    return true;
+}
+
 struct PageCache {
     explicit PageCache(size_t pageSize);
     ~PageCache();
@@ -43,7 +253,11 @@ struct PageCache {
     void releasePage(Page *page);
 
     void appendPage(Page *page);
-    size_t releaseFromStart(size_t maxBytes);
+
+    // Writes the released pages to |spill| if not NULL, |startOffset| being
+    // the source offset of the first page.
+    size_t releaseFromStart(
+            size_t maxBytes, off64_t startOffset = 0, DiskCache *spill = NULL);
 
     size_t totalSize() const {
         return mTotalSize;
@@ -112,7 +326,8 @@ void PageCache::appendPage(Page *page) {
     mActivePages.push_back(page);
 }
 
-size_t PageCache::releaseFromStart(size_t maxBytes) {
+size_t PageCache::releaseFromStart(
+        size_t maxBytes, off64_t startOffset, DiskCache *spill) {
     size_t bytesReleased = 0;
 
     while (maxBytes > 0 && !mActivePages.empty()) {
@@ -126,6 +341,10 @@ size_t PageCache::releaseFromStart(size_t maxBytes) {
 
         mActivePages.erase(it);
 
+        if (spill != NULL) {
+            spill->write(startOffset + bytesReleased, page->mData, page->mSize);
+        }
+
         maxBytes -= page->mSize;
         bytesReleased += page->mSize;
 
@@ -177,6 +396,236 @@ void PageCache::copy(size_t from, void *data, size_t size) {
     }
 }
 
+// Downloads extents of the source over connections of its own, one thread
+// per connection, so that the cache fills at the rate of several
+// connections on links where a single one is bound by latency. Extents
+// complete in any order, NuCachedSource2 takes them in the order of the
+// source.
+struct RangeFetcher {
+    RangeFetcher(const Vector<sp<DataSource> > &connections, size_t extentSize);
+    ~RangeFetcher();
+
+    size_t extentSize() const {
+        return mExtentSize;
+    }
+
+    // Makes sure the |count| extents from |offset| on are requested, and
+    // drops the other ones that were not pinned.
+    void request(off64_t offset, size_t count);
+
+    // Requests the |size| bytes at |offset|, which request() keeps.
+    void pin(off64_t offset, size_t size);
+
+    // Returns OK and the data of the extent at |offset| once it has been
+    // downloaded, -EAGAIN until then or if it was not requested, or the
+    // error its download failed with. The data ends early at the end of
+    // the source.
+    status_t take(off64_t offset, sp<ABuffer> *data);
+
+    // Aborts the downloads in progress, for good.
+    void disconnect();
+
+private:
+    struct Extent {
+        off64_t mOffset;
+        size_t mSize;
+        bool mPinned;
+        bool mAssigned;
+        status_t mStatus;
+        sp<ABuffer> mData;
+    };
+
+    struct Worker {
+        RangeFetcher *mOwner;
+        sp<DataSource> mSource;
+        pthread_t mThread;
+    };
+
+    size_t mExtentSize;
+
+    Mutex mLock;
+    Condition mCondition;
+    bool mExit;
+    // sorted by offset
+    List<Extent> mExtents;
+    Vector<Worker *> mWorkers;
+
+    void add_l(off64_t offset, size_t size, bool pinned);
+
+    static void *ThreadWrapper(void *me);
+    void threadFunc(const sp<DataSource> &source);
+
+    DISALLOW_EVIL_CONSTRUCTORS(RangeFetcher);
+};
+
+RangeFetcher::RangeFetcher(const Vector<sp<DataSource> > &connections, size_t extentSize)
+    : mExtentSize(extentSize),
+      mExit(false) {
+    for (size_t i = 0; i < connections.size(); ++i) {
+        Worker *worker = new Worker;
+        worker->mOwner = this;
+        worker->mSource = connections[i];
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+        if (pthread_create(&worker->mThread, &attr, ThreadWrapper, worker) == 0) {
+            mWorkers.push(worker);
+        } else {
+            delete worker;
+        }
+        pthread_attr_destroy(&attr);
+    }
+}
+
+RangeFetcher::~RangeFetcher() {
+    disconnect();
+
+    for (size_t i = 0; i < mWorkers.size(); ++i) {
+        void *dummy;
+        pthread_join(mWorkers[i]->mThread, &dummy);
+        delete mWorkers[i];
+    }
+    mWorkers.clear();
+}
+
+void RangeFetcher::disconnect() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (mExit) {
+            return;
+        }
+        mExit = true;
+        mCondition.broadcast();
+    }
+
+    // Unblocks the reads in progress.
+    for (size_t i = 0; i < mWorkers.size(); ++i) {
+        if (mWorkers[i]->mSource->flags() & DataSource::kIsHTTPBasedSource) {
+            static_cast<HTTPBase *>(mWorkers[i]->mSource.get())->disconnect();
+        }
+    }
+}
+
+void RangeFetcher::add_l(off64_t offset, size_t size, bool pinned) {
+    List<Extent>::iterator it = mExtents.begin();
+    while (it != mExtents.end() && (*it).mOffset < offset) {
+        ++it;
+    }
+    if (it != mExtents.end() && (*it).mOffset == offset) {
+        (*it).mPinned = (*it).mPinned || pinned;
+        return;
+    }
+
+    Extent extent;
+    extent.mOffset = offset;
+    extent.mSize = size;
+    extent.mPinned = pinned;
+    extent.mAssigned = false;
+    extent.mStatus = -EAGAIN;
+    mExtents.insert(it, extent);
+    mCondition.broadcast();
+}
+
+void RangeFetcher::request(off64_t offset, size_t count) {
+    Mutex::Autolock autoLock(mLock);
+
+    off64_t end = offset + (off64_t)(count * mExtentSize);
+    List<Extent>::iterator it = mExtents.begin();
+    while (it != mExtents.end()) {
+        const Extent &extent = *it;
+        bool wanted = extent.mOffset >= offset && extent.mOffset < end
+                && (extent.mOffset - offset) % mExtentSize == 0;
+        if (!wanted && !extent.mPinned) {
+            // a download in progress finds its extent gone
+            it = mExtents.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        add_l(offset + (off64_t)(i * mExtentSize), mExtentSize, false);
+    }
+}
+
+void RangeFetcher::pin(off64_t offset, size_t size) {
+    Mutex::Autolock autoLock(mLock);
+    add_l(offset, size, true);
+}
+
+status_t RangeFetcher::take(off64_t offset, sp<ABuffer> *data) {
+    Mutex::Autolock autoLock(mLock);
+
+    for (List<Extent>::iterator it = mExtents.begin(); it != mExtents.end(); ++it) {
+        if ((*it).mOffset != offset) {
+            continue;
+        }
+        status_t err = (*it).mStatus;
+        if (err == -EAGAIN) {
+            return err;
+        }
+        *data = (*it).mData;
+        mExtents.erase(it);
+        return err;
+    }
+    return -EAGAIN;
+}
+
+// static
+void *RangeFetcher::ThreadWrapper(void *me) {
+    Worker *worker = static_cast<Worker *>(me);
+    worker->mOwner->threadFunc(worker->mSource);
+    return NULL;
+}
+
+void RangeFetcher::threadFunc(const sp<DataSource> &source) {
+    androidSetThreadName("NuCachedSource2Range");
+
+    Mutex::Autolock autoLock(mLock);
+    while (!mExit) {
+        // the first extent nobody downloads yet
+        List<Extent>::iterator it = mExtents.begin();
+        while (it != mExtents.end() && ((*it).mAssigned || (*it).mStatus != -EAGAIN)) {
+            ++it;
+        }
+        if (it == mExtents.end()) {
+            mCondition.wait(mLock);
+            continue;
+        }
+
+        (*it).mAssigned = true;
+        off64_t offset = (*it).mOffset;
+        size_t size = (*it).mSize;
+
+        mLock.unlock();
+        sp<ABuffer> data = new ABuffer(size);
+        size_t filled = 0;
+        status_t err = OK;
+        while (filled < size) {
+            ssize_t n = source->readAt(offset + filled, data->data() + filled, size - filled);
+            if (n <= 0) {
+                err = n;
+                break;
+            }
+            filled += n;
+        }
+        data->setRange(0, filled);
+        mLock.lock();
+
+        for (it = mExtents.begin(); it != mExtents.end(); ++it) {
+            if ((*it).mOffset == offset && (*it).mSize == size
+                    && (*it).mAssigned && (*it).mStatus == -EAGAIN) {
+                // A short read is the end of the source, unless it failed
+                // before reading anything.
+                (*it).mStatus = (filled == 0 && err != OK) ? err : OK;
+                (*it).mData = data;
+                break;
+            }
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 NuCachedSource2::NuCachedSource2(
@@ -188,6 +637,12 @@ NuCachedSource2::NuCachedSource2(
       mLooper(new ALooper),
       mCache(new PageCache(kPageSize)),
       mCacheOffset(0),
+      mRangeFetcher(NULL),
+      mNumRangeConnections(0),
+      mTailOffset(-1),
+      mDiskCache(NULL),
+      mDiskCacheHitBytes(0),
+      mDiskCacheMissBytes(0),
       mFinalStatus(OK),
       mLastAccessPos(0),
       mFetching(true),
@@ -214,6 +669,10 @@ NuCachedSource2::NuCachedSource2(
         mKeepAliveIntervalUs = 0;
     }
 
+    if (mSource->flags() & kIsHTTPBasedSource) {
+        createDiskCacheFromSystemProperty();
+    }
+
     mLooper->setName("NuCachedSource2");
     mLooper->registerHandler(mReflector);
 
@@ -232,22 +691,52 @@ NuCachedSource2::~NuCachedSource2() {
     mLooper->stop();
     mLooper->unregisterHandler(mReflector->id());
 
+    delete mRangeFetcher;
+    mRangeFetcher = NULL;
+
     delete mCache;
     mCache = NULL;
+
+    delete mDiskCache;
+    mDiskCache = NULL;
 }
 
 // static
 sp<NuCachedSource2> NuCachedSource2::Create(
         const sp<DataSource> &source,
         const char *cacheConfig,
-        bool disconnectAtHighwatermark) {
+        bool disconnectAtHighwatermark,
+        const Vector<sp<DataSource> > *rangeConnections) {
     sp<NuCachedSource2> instance = new NuCachedSource2(
             source, cacheConfig, disconnectAtHighwatermark);
     Mutex::Autolock autoLock(instance->mLock);
+    if (rangeConnections != NULL && !rangeConnections->empty()) {
+        // before the first fetch, which would otherwise read from |source|
+        instance->startRangeFetcher(*rangeConnections);
+    }
     (new AMessage(kWhatFetchMore, instance->mReflector))->post();
     return instance;
 }
 
+void NuCachedSource2::startRangeFetcher(const Vector<sp<DataSource> > &connections) {
+    Vector<sp<DataSource> > sources;
+    sources.push(mSource);
+    sources.appendVector(connections);
+
+    mRangeFetcher = new RangeFetcher(sources, kRangeExtentSize);
+    mNumRangeConnections = sources.size();
+
+    // Containers such as MP4 files that are not optimized for streaming
+    // keep their index at the end, which the extractor seeks to first.
+    off64_t size;
+    if (mSource->getSize(&size) == OK && size > 4 * kRangeExtentSize) {
+        mTailOffset = size - kRangeExtentSize;
+        mRangeFetcher->pin(mTailOffset, kRangeExtentSize);
+    }
+
+    ALOGV("fetching over %zu connections", mNumRangeConnections);
+}
+
 status_t NuCachedSource2::getEstimatedBandwidthKbps(int32_t *kbps) {
     if (mSource->flags() & kIsHTTPBasedSource) {
         HTTPBase* source = static_cast<HTTPBase *>(mSource.get());
@@ -274,9 +763,23 @@ void NuCachedSource2::disconnect() {
         // explicitly disconnect from the source, to allow any
         // pending reads to return more promptly
         static_cast<HTTPBase *>(mSource.get())->disconnect();
+
+        if (mRangeFetcher != NULL) {
+            mRangeFetcher->disconnect();
+        }
     }
 }
 
+status_t NuCachedSource2::getDiskCacheStats(int64_t *hitBytes, int64_t *missBytes) {
+    Mutex::Autolock autoLock(mLock);
+    if (mDiskCache == NULL) {
+        return ERROR_UNSUPPORTED;
+    }
+    *hitBytes = mDiskCacheHitBytes;
+    *missBytes = mDiskCacheMissBytes;
+    return OK;
+}
+
 status_t NuCachedSource2::setCacheStatCollectFreq(int32_t freqMs) {
     if (mSource->flags() & kIsHTTPBasedSource) {
         HTTPBase *source = static_cast<HTTPBase *>(mSource.get());
@@ -393,6 +896,63 @@ void NuCachedSource2::fetchInternal() {
     }
 }
 
+bool NuCachedSource2::fetchRanges() {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mTailOffset >= 0 && mTail == NULL) {
+        sp<ABuffer> tail;
+        status_t err = mRangeFetcher->take(mTailOffset, &tail);
+        if (err == OK) {
+            mTail = tail;
+        } else if (err != -EAGAIN) {
+            mTailOffset = -1;
+        }
+    }
+
+    off64_t offset = mCacheOffset + mCache->totalSize();
+    mRangeFetcher->request(offset, mNumRangeConnections * kNumExtentsPerConnection);
+
+    sp<ABuffer> data;
+    status_t err = mRangeFetcher->take(offset, &data);
+    if (err == -EAGAIN) {
+        return false;
+    }
+
+    if (mDisconnecting || (err == OK && data->size() == 0)) {
+        ALOGI("caching reached eos.");
+
+        mNumRetriesLeft = 0;
+        mFinalStatus = ERROR_END_OF_STREAM;
+        return true;
+    } else if (err != OK) {
+        // The next request() asks for the extent again.
+        mFinalStatus = err;
+        if (mNumRetriesLeft > 0) {
+            --mNumRetriesLeft;
+        }
+        ALOGE("range fetch returned error %d, %d retries left", err, mNumRetriesLeft);
+        return true;
+    }
+
+    mNumRetriesLeft = kMaxNumRetries;
+    mFinalStatus = OK;
+
+    for (size_t i = 0; i < data->size(); i += kPageSize) {
+        PageCache::Page *page = mCache->acquirePage();
+        page->mSize = std::min(data->size() - i, (size_t)kPageSize);
+        memcpy(page->mData, data->data() + i, page->mSize);
+        mCache->appendPage(page);
+    }
+
+    if (data->size() < mRangeFetcher->extentSize()) {
+        ALOGI("caching reached eos.");
+
+        mNumRetriesLeft = 0;
+        mFinalStatus = ERROR_END_OF_STREAM;
+    }
+    return true;
+}
+
 void NuCachedSource2::onFetch() {
     ALOGV("onFetch");
 
@@ -401,18 +961,25 @@ void NuCachedSource2::onFetch() {
         mFetching = false;
     }
 
+    // The connections of the range fetcher are not kept alive.
     bool keepAlive =
         !mFetching
+            && mRangeFetcher == NULL
             && mFinalStatus == OK
             && mKeepAliveIntervalUs > 0
             && ALooper::GetNowUs() >= mLastFetchTimeUs + mKeepAliveIntervalUs;
 
+    bool fetchedData = true;
     if (mFetching || keepAlive) {
         if (keepAlive) {
             ALOGI("Keep alive");
         }
 
-        fetchInternal();
+        if (mRangeFetcher != NULL) {
+            fetchedData = fetchRanges();
+        } else {
+            fetchInternal();
+        }
 
         mLastFetchTimeUs = ALooper::GetNowUs();
 
@@ -420,7 +987,7 @@ void NuCachedSource2::onFetch() {
             ALOGI("Cache full, done prefetching for now");
             mFetching = false;
 
-            if (mDisconnectAtHighwatermark
+            if (mDisconnectAtHighwatermark && mRangeFetcher == NULL
                     && (mSource->flags() & DataSource::kIsHTTPBasedSource)) {
                 ALOGV("Disconnecting at high watermark");
                 static_cast<HTTPBase *>(mSource.get())->disconnect();
@@ -437,6 +1004,9 @@ void NuCachedSource2::onFetch() {
         if (mFinalStatus != OK && mNumRetriesLeft > 0) {
             // We failed this time and will try again in 3 seconds.
             delayUs = 3000000ll;
+        } else if (!fetchedData) {
+            // Waiting for the range fetcher.
+            delayUs = 10000ll;
         } else {
             delayUs = 0;
         }
@@ -504,7 +1074,7 @@ void NuCachedSource2::restartPrefetcherIfNecessary_l(
         maxBytes -= kGrayArea;
     }
 
-    size_t actualBytes = mCache->releaseFromStart(maxBytes);
+    size_t actualBytes = mCache->releaseFromStart(maxBytes, mCacheOffset, mDiskCache);
     mCacheOffset += actualBytes;
 
     ALOGI("restarting prefetcher, totalSize = %zu", mCache->totalSize());
@@ -533,6 +1103,24 @@ ssize_t NuCachedSource2::readAt(off64_t offset, void *data, size_t size) {
         return size;
     }
 
+    if (mTail != NULL && offset >= mTailOffset
+            && offset + size <= mTailOffset + mTail->size()) {
+        memcpy(data, mTail->data() + (offset - mTailOffset), size);
+        return size;
+    }
+
+    // Data outside the page cache may have been spilled to the disk cache
+    // before a seek. Serving it from there leaves the page cache and the
+    // prefetcher alone.
+    if (mDiskCache != NULL && (offset < mCacheOffset
+            || offset > (off64_t)(mCacheOffset + mCache->totalSize()))) {
+        if (mDiskCache->read(offset, data, size)) {
+            mDiskCacheHitBytes += size;
+            return size;
+        }
+        mDiskCacheMissBytes += size;
+    }
+
     sp<AMessage> msg = new AMessage(kWhatRead, mReflector);
     msg->setInt64("offset", offset);
     msg->setPointer("data", data);
@@ -660,10 +1248,10 @@ status_t NuCachedSource2::seekInternal_l(off64_t offset) {
 
     ALOGI("new range: offset= %lld", (long long)offset);
 
-    mCacheOffset = offset;
-
     size_t totalSize = mCache->totalSize();
-    CHECK_EQ(mCache->releaseFromStart(totalSize), totalSize);
+    CHECK_EQ(mCache->releaseFromStart(totalSize, mCacheOffset, mDiskCache), totalSize);
+
+    mCacheOffset = offset;
 
     mNumRetriesLeft = kMaxNumRetries;
     mFetching = true;
@@ -693,6 +1281,22 @@ String8 NuCachedSource2::getMIMEType() const {
     return mSource->getMIMEType();
 }
 
+void NuCachedSource2::createDiskCacheFromSystemProperty() {
+    char dir[PROPERTY_VALUE_MAX];
+    if (property_get("media.stagefright.disk-cache-dir", dir, NULL) <= 0) {
+        return;
+    }
+
+    int32_t sizeMb = property_get_int32(
+            "media.stagefright.disk-cache-mb", kDefaultDiskCacheSizeMb);
+    if (sizeMb <= 0) {
+        return;
+    }
+
+    mDiskCache = DiskCache::Create(dir, kPageSize, (size_t)sizeMb * 1024 * 1024 / kPageSize);
+    ALOGV("disk cache of %d MB in %s: %s", sizeMb, dir, mDiskCache != NULL ? "ok" : "failed");
+}
+
 void NuCachedSource2::updateCacheParamsFromSystemProperty() {
     char value[PROPERTY_VALUE_MAX];
     if (!property_get("media.stagefright.cache-params", value, NULL)) {
@@ -20,6 +20,9 @@
 
 #include "include/OggExtractor.h"
 
+#include <algorithm>
+#include <inttypes.h>
+
 #include <cutils/properties.h>
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
@@ -105,6 +108,16 @@ protected:
         int64_t mTimeUs;
     };
 
+    enum {
+        // Reads of up to this size are served from an aligned window of
+        // twice the size, so that scanning for pages and reading small
+        // packets does not go to the source every time.
+        kCacheBlockSize = 32 * 1024,
+        // Bisection stops once the interval is this small, and the rest
+        // is scanned page by page.
+        kMaxSeekScanSize = kCacheBlockSize,
+    };
+
     sp<DataSource> mSource;
     off64_t mOffset;
     Page mCurrentPage;
@@ -127,10 +140,18 @@ protected:
     sp<MetaData> mMeta;
     sp<MetaData> mFileMeta;
 
+    // The pages that seeking came across, in file order.
     Vector<TOCEntry> mTableOfContents;
 
+    uint8_t *mCache;
+    off64_t mCacheOffset;
+    size_t mCacheSize;
+
+    ssize_t readAt(off64_t offset, void *data, size_t size);
     ssize_t readPage(off64_t offset, Page *page);
     status_t findNextPage(off64_t startOffset, off64_t *pageOffset);
+    status_t findNextPageWithGranule(
+            off64_t startOffset, off64_t endOffset, off64_t *pageOffset, Page *page);
 
     virtual int64_t getTimeUsOfGranule(uint64_t granulePos) const = 0;
 
@@ -157,7 +178,12 @@ protected:
 
     status_t findPrevGranulePosition(off64_t pageOffset, uint64_t *granulePos);
 
-    void buildTableOfContents();
+    // Finds the first page that ends at or after |timeUs|, and the granule
+    // position of the page before it.
+    status_t findPageForTime(
+            int64_t timeUs, off64_t size, off64_t *pageOffset, uint64_t *prevGranulePos);
+    void addToTableOfContents(off64_t pageOffset, uint64_t granulePos);
+    void seekToPage(off64_t pageOffset, uint64_t prevGranulePos);
 
     MyOggExtractor(const MyOggExtractor &);
     MyOggExtractor &operator=(const MyOggExtractor &);
@@ -309,7 +335,10 @@ MyOggExtractor::MyOggExtractor(
       mMimeType(mimeType),
       mNumHeaders(numHeaders),
       mSeekPreRollUs(seekPreRollUs),
-      mFirstDataOffset(-1) {
+      mFirstDataOffset(-1),
+      mCache(NULL),
+      mCacheOffset(0),
+      mCacheSize(0) {
     mCurrentPage.mNumSegments = 0;
 
     vorbis_info_init(&mVi);
@@ -319,19 +348,52 @@ MyOggExtractor::MyOggExtractor(
 MyOggExtractor::~MyOggExtractor() {
     vorbis_comment_clear(&mVc);
     vorbis_info_clear(&mVi);
+
+    free(mCache);
+    mCache = NULL;
 }
 
 sp<MetaData> MyOggExtractor::getFormat() const {
     return mMeta;
 }
 
+ssize_t MyOggExtractor::readAt(off64_t offset, void *data, size_t size) {
+    if (offset < mCacheOffset || offset + (off64_t)size > mCacheOffset + (off64_t)mCacheSize) {
+        if (size > kCacheBlockSize) {
+            return mSource->readAt(offset, data, size);
+        }
+        if (mCache == NULL) {
+            mCache = (uint8_t *)malloc(2 * kCacheBlockSize);
+            if (mCache == NULL) {
+                return mSource->readAt(offset, data, size);
+            }
+        }
+
+        off64_t blockOffset = offset - offset % kCacheBlockSize;
+        ssize_t n = mSource->readAt(blockOffset, mCache, 2 * kCacheBlockSize);
+        if (n < 0) {
+            mCacheSize = 0;
+            return n;
+        }
+        mCacheOffset = blockOffset;
+        mCacheSize = n;
+    }
+
+    if (offset >= mCacheOffset + (off64_t)mCacheSize) {
+        return 0;
+    }
+    size_t n = std::min(size, (size_t)(mCacheOffset + mCacheSize - offset));
+    memcpy(data, mCache + (offset - mCacheOffset), n);
+    return n;
+}
+
 status_t MyOggExtractor::findNextPage(
         off64_t startOffset, off64_t *pageOffset) {
     *pageOffset = startOffset;
 
     for (;;) {
         char signature[4];
-        ssize_t n = mSource->readAt(*pageOffset, &signature, 4);
+        ssize_t n = readAt(*pageOffset, &signature, 4);
 
         if (n < 4) {
             *pageOffset = 0;
@@ -416,7 +478,8 @@ status_t MyOggExtractor::seekToTime(int64_t timeUs) {
         timeUs = 0;
     }
 
-    if (mTableOfContents.isEmpty()) {
+    off64_t size;
+    if (mFirstDataOffset < 0 || mSource->getSize(&size) != OK) {
         // Perform approximate seeking based on avg. bitrate.
         uint64_t bps = approxBitrate();
         if (bps <= 0) {
@@ -429,33 +492,170 @@ status_t MyOggExtractor::seekToTime(int64_t timeUs) {
         return seekToOffset(pos);
     }
 
-    size_t left = 0;
-    size_t right_plus_one = mTableOfContents.size();
-    while (left < right_plus_one) {
-        size_t center = left + (right_plus_one - left) / 2;
+    off64_t pageOffset;
+    uint64_t prevGranulePos;
+    status_t err = findPageForTime(timeUs, size, &pageOffset, &prevGranulePos);
+    if (err != OK) {
+        return err;
+    }
+
+    ALOGV("seeking to page at offset %lld", (long long)pageOffset);
+    seekToPage(pageOffset, prevGranulePos);
+    return OK;
+}
+
+status_t MyOggExtractor::findNextPageWithGranule(
+        off64_t startOffset, off64_t endOffset, off64_t *pageOffset, Page *page) {
+    status_t err = findNextPage(startOffset, pageOffset);
+    while (err == OK && *pageOffset < endOffset) {
+        ssize_t n = readPage(*pageOffset, page);
+        if (n == ERROR_MALFORMED || n == ERROR_UNSUPPORTED) {
+            // "OggS" within the data of a page
+            err = findNextPage(*pageOffset + 1, pageOffset);
+            continue;
+        } else if (n <= 0) {
+            return n < 0 ? n : (status_t)ERROR_END_OF_STREAM;
+        }
+
+        // -1 marks pages on which no packet ends.
+        if (page->mGranulePosition != (uint64_t)-1) {
+            return OK;
+        }
+        *pageOffset += n;
+    }
+    return err == OK ? (status_t)ERROR_END_OF_STREAM : err;
+}
+
+void MyOggExtractor::addToTableOfContents(off64_t pageOffset, uint64_t granulePos) {
+    // Limit the maximum amount of RAM we spend on the table of contents.
+    static const size_t kMaxTOCSize = 8192;
+    static const size_t kMaxNumTOCEntries = kMaxTOCSize / sizeof(TOCEntry);
+
+    size_t lo = 0;
+    size_t hi = mTableOfContents.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (mTableOfContents.itemAt(mid).mPageOffset < pageOffset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
 
-        const TOCEntry &entry = mTableOfContents.itemAt(center);
+    if ((lo < mTableOfContents.size() && mTableOfContents.itemAt(lo).mPageOffset == pageOffset)
+            || mTableOfContents.size() >= kMaxNumTOCEntries) {
+        return;
+    }
+
+    TOCEntry entry;
+    entry.mPageOffset = pageOffset;
+    entry.mTimeUs = getTimeUsOfGranule(granulePos);
+    mTableOfContents.insertAt(entry, lo);
+}
 
-        if (timeUs < entry.mTimeUs) {
-            right_plus_one = center;
-        } else if (timeUs > entry.mTimeUs) {
-            left = center + 1;
+status_t MyOggExtractor::findPageForTime(
+        int64_t timeUs, off64_t size, off64_t *pageOffset, uint64_t *prevGranulePos) {
+    // The page sought is in [lo, hi], or is the first page with a granule
+    // position at or after hi. The table of contents narrows this down
+    // before reading anything.
+    off64_t lo = mFirstDataOffset;
+    int64_t loTimeUs = 0;
+    off64_t hi = size;
+    int64_t hiTimeUs;
+    if (!mMeta->findInt64(kKeyDuration, &hiTimeUs)) {
+        hiTimeUs = -1;
+    }
+
+    for (size_t i = 0; i < mTableOfContents.size(); ++i) {
+        const TOCEntry &entry = mTableOfContents.itemAt(i);
+        if (entry.mTimeUs < timeUs) {
+            lo = entry.mPageOffset;
+            loTimeUs = entry.mTimeUs;
         } else {
-            left = center;
+            hi = entry.mPageOffset;
+            hiTimeUs = entry.mTimeUs;
             break;
         }
     }
 
-    if (left == mTableOfContents.size()) {
-        --left;
+    for (size_t i = 0; hi - lo > kMaxSeekScanSize; ++i) {
+        // Interpolate on the times where known, but bisect every other
+        // time, so that uneven bitrates cannot slow the search down.
+        off64_t guess;
+        if (hiTimeUs > loTimeUs && i % 2 == 0) {
+            guess = lo + (off64_t)((double)(hi - lo) * (timeUs - loTimeUs) / (hiTimeUs - loTimeUs));
+        } else {
+            guess = lo + (hi - lo) / 2;
+        }
+        guess = std::max(lo + 1, std::min(guess, hi - 1));
+
+        off64_t offset;
+        Page page;
+        status_t err = findNextPageWithGranule(guess, hi, &offset, &page);
+        if (err == ERROR_END_OF_STREAM) {
+            // no page ends between guess and hi
+            hi = guess;
+            continue;
+        } else if (err != OK) {
+            return err;
+        }
+
+        addToTableOfContents(offset, page.mGranulePosition);
+        int64_t pageTimeUs = getTimeUsOfGranule(page.mGranulePosition);
+        ALOGV("bisecting [%lld, %lld], page at %lld ends at %" PRId64 " us",
+                (long long)lo, (long long)hi, (long long)offset, pageTimeUs);
+        if (pageTimeUs < timeUs) {
+            lo = offset;
+            loTimeUs = pageTimeUs;
+        } else {
+            hi = offset;
+            hiTimeUs = pageTimeUs;
+        }
+    }
+
+    // Scan the rest page by page, remembering the granule position of the
+    // page before the one sought.
+    off64_t offset;
+    status_t err = findNextPage(lo, &offset);
+    if (err != OK) {
+        return err;
     }
+    bool havePrevPage = false;
+    off64_t prevOffset = offset;
+    uint64_t prevGranule = 0;
+    for (;;) {
+        Page page;
+        ssize_t n = readPage(offset, &page);
+        if (n <= 0) {
+            if (!havePrevPage) {
+                return n < 0 ? n : (status_t)ERROR_END_OF_STREAM;
+            }
+            // Seeking past the end; go to the last page.
+            *pageOffset = prevOffset;
+            findPrevGranulePosition(prevOffset, prevGranulePos);
+            return OK;
+        }
 
-    const TOCEntry &entry = mTableOfContents.itemAt(left);
+        if (page.mGranulePosition != (uint64_t)-1) {
+            addToTableOfContents(offset, page.mGranulePosition);
+            if (getTimeUsOfGranule(page.mGranulePosition) >= timeUs) {
+                break;
+            }
+        }
 
-    ALOGV("seeking to entry %zu / %zu at offset %lld",
-         left, mTableOfContents.size(), (long long)entry.mPageOffset);
+        havePrevPage = true;
+        prevOffset = offset;
+        prevGranule = page.mGranulePosition;
+        offset += n;
+    }
 
-    return seekToOffset(entry.mPageOffset);
+    *pageOffset = offset;
+    if (havePrevPage) {
+        *prevGranulePos = prevGranule;
+    } else {
+        findPrevGranulePosition(offset, prevGranulePos);
+    }
+    return OK;
 }
 
 status_t MyOggExtractor::seekToOffset(off64_t offset) {
@@ -475,7 +675,15 @@ status_t MyOggExtractor::seekToOffset(off64_t offset) {
     // We found the page we wanted to seek to, but we'll also need
     // the page preceding it to determine how many valid samples are on
     // this page.
-    findPrevGranulePosition(pageOffset, &mPrevGranulePosition);
+    uint64_t prevGranulePos;
+    findPrevGranulePosition(pageOffset, &prevGranulePos);
+
+    seekToPage(pageOffset, prevGranulePos);
+    return OK;
+}
+
+void MyOggExtractor::seekToPage(off64_t pageOffset, uint64_t prevGranulePos) {
+    mPrevGranulePosition = prevGranulePos;
 
     mOffset = pageOffset;
 
@@ -487,14 +695,12 @@ status_t MyOggExtractor::seekToOffset(off64_t offset) {
     mNextLaceIndex = 0;
 
     // XXX what if new page continues packet from last???
-
-    return OK;
 }
 
 ssize_t MyOggExtractor::readPage(off64_t offset, Page *page) {
     uint8_t header[27];
     ssize_t n;
-    if ((n = mSource->readAt(offset, header, sizeof(header)))
+    if ((n = readAt(offset, header, sizeof(header)))
             < (ssize_t)sizeof(header)) {
         ALOGV("failed to read %zu bytes at offset %#016llx, got %zd bytes",
                 sizeof(header), (long long)offset, n);
@@ -536,8 +742,7 @@ ssize_t MyOggExtractor::readPage(off64_t offset, Page *page) {
     page->mPageNo = U32LE_AT(&header[18]);
 
     page->mNumSegments = header[26];
-    if (mSource->readAt(
-                offset + sizeof(header), page->mLace, page->mNumSegments)
+    if (readAt(offset + sizeof(header), page->mLace, page->mNumSegments)
             < (ssize_t)page->mNumSegments) {
         return ERROR_IO;
     }
@@ -721,7 +926,7 @@ status_t MyOggExtractor::_readNextPacket(MediaBuffer **out, bool calcVorbisTimes
             }
             buffer = tmp;
 
-            ssize_t n = mSource->readAt(
+            ssize_t n = readAt(
                     dataOffset,
                     (uint8_t *)buffer->data() + buffer->range_length(),
                     packetSize);
@@ -860,52 +1065,11 @@ status_t MyOggExtractor::init() {
         int64_t durationUs = getTimeUsOfGranule(lastGranulePosition);
 
         mMeta->setInt64(kKeyDuration, durationUs);
-
-        buildTableOfContents();
     }
 
     return OK;
 }
 
-void MyOggExtractor::buildTableOfContents() {
-    off64_t offset = mFirstDataOffset;
-    Page page;
-    ssize_t pageSize;
-    while ((pageSize = readPage(offset, &page)) > 0) {
-        mTableOfContents.push();
-
-        TOCEntry &entry =
-            mTableOfContents.editItemAt(mTableOfContents.size() - 1);
-
-        entry.mPageOffset = offset;
-        entry.mTimeUs = getTimeUsOfGranule(page.mGranulePosition);
-
-        offset += (size_t)pageSize;
-    }
-
-    // Limit the maximum amount of RAM we spend on the table of contents,
-    // if necessary thin out the table evenly to trim it down to maximum
-    // size.
-
-    static const size_t kMaxTOCSize = 8192;
-    static const size_t kMaxNumTOCEntries = kMaxTOCSize / sizeof(TOCEntry);
-
-    size_t numerator = mTableOfContents.size();
-
-    if (numerator > kMaxNumTOCEntries) {
-        size_t denom = numerator - kMaxNumTOCEntries;
-
-        size_t accum = 0;
-        for (ssize_t i = mTableOfContents.size() - 1; i >= 0; --i) {
-            accum += denom;
-            if (accum >= numerator) {
-                mTableOfContents.removeAt(i);
-                accum -= numerator;
-            }
-        }
-    }
-}
-
 int32_t MyOggExtractor::getPacketBlockSize(MediaBuffer *buffer) {
     const uint8_t *data =
         (const uint8_t *)buffer->data() + buffer->range_offset();
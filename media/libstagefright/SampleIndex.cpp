@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "SampleIndex"
+//#define LOG_NDEBUG 0
+#include <utils/Log.h>
+
+#include "include/SampleIndex.h"
+#include "include/SampleIterator.h"
+
+#include <errno.h>
+#include <new>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaErrors.h>
+
+namespace android {
+
+SampleIndex::PackedColumn::PackedColumn()
+    : mMin(0),
+      mWidth(0),
+      mMask(0),
+      mWords(NULL),
+      mNumWords(0) {
+}
+
+SampleIndex::PackedColumn::~PackedColumn() {
+    delete[] mWords;
+    mWords = NULL;
+}
+
+status_t SampleIndex::PackedColumn::pack(const uint32_t *values, size_t count) {
+    CHECK(mWords == NULL);
+
+    uint32_t minValue = UINT32_MAX;
+    uint32_t maxValue = 0;
+    for (size_t i = 0; i < count; ++i) {
+        minValue = values[i] < minValue ? values[i] : minValue;
+        maxValue = values[i] > maxValue ? values[i] : maxValue;
+    }
+
+    mMin = count > 0 ? minValue : 0;
+    uint32_t range = count > 0 ? maxValue - minValue : 0;
+    mWidth = range == 0 ? 0 : 32 - __builtin_clz(range);
+    mMask = (1ull << mWidth) - 1;
+    if (mWidth == 0) {
+        return OK;
+    }
+
+    // one more word, so that get() can always read two
+    mNumWords = ((uint64_t)count * mWidth + 31) / 32 + 1;
+    mWords = new (std::nothrow) uint32_t[mNumWords]();
+    if (mWords == NULL) {
+        return NO_MEMORY;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t bit = (uint64_t)i * mWidth;
+        uint64_t bits = (uint64_t)(values[i] - mMin) << (bit & 31);
+        mWords[bit >> 5] |= (uint32_t)bits;
+        mWords[(bit >> 5) + 1] |= (uint32_t)(bits >> 32);
+    }
+    return OK;
+}
+
+SampleIndex::SampleIndex()
+    : mNumSamples(0),
+      mIncreasingTimes(true),
+      mBlockOffsets(NULL),
+      mBlockTimes(NULL) {
+}
+
+SampleIndex::~SampleIndex() {
+    delete[] mBlockOffsets;
+    mBlockOffsets = NULL;
+
+    delete[] mBlockTimes;
+    mBlockTimes = NULL;
+}
+
+status_t SampleIndex::build(
+        SampleIterator *iterator, uint32_t numSamples,
+        const uint32_t *syncSamples, uint32_t numSyncSamples,
+        const std::atomic<bool> *abort) {
+    CHECK(mBlockOffsets == NULL);
+
+    if (numSamples == 0) {
+        return ERROR_MALFORMED;
+    }
+
+    size_t numBlocks = (numSamples + kBlockSize - 1) / kBlockSize;
+    mBlockOffsets = new (std::nothrow) off64_t[numBlocks];
+    mBlockTimes = new (std::nothrow) uint32_t[numBlocks];
+
+    // the unpacked columns, only needed while building
+    uint32_t *offsets = new (std::nothrow) uint32_t[numSamples];
+    uint32_t *sizes = new (std::nothrow) uint32_t[numSamples];
+    uint32_t *times = new (std::nothrow) uint32_t[numSamples];
+    uint32_t *durations = new (std::nothrow) uint32_t[numSamples];
+
+    status_t err = OK;
+    if (mBlockOffsets == NULL || mBlockTimes == NULL || offsets == NULL
+            || sizes == NULL || times == NULL || durations == NULL) {
+        err = NO_MEMORY;
+    }
+
+    for (size_t block = 0; block < numBlocks && err == OK; ++block) {
+        if (abort != NULL && abort->load()) {
+            err = -EINTR;
+            break;
+        }
+
+        uint32_t start = block * kBlockSize;
+        uint32_t end = numSamples - start > kBlockSize ? start + kBlockSize : numSamples;
+
+        off64_t sampleOffsets[kBlockSize];
+        off64_t minOffset = 0;
+        uint32_t minTime = 0;
+        for (uint32_t i = start; i < end; ++i) {
+            if ((err = iterator->seekTo(i)) != OK) {
+                break;
+            }
+            sampleOffsets[i - start] = iterator->getSampleOffset();
+            sizes[i] = iterator->getSampleSize();
+            times[i] = iterator->getSampleTime();
+            durations[i] = iterator->getSampleDuration();
+
+            if (i == start || sampleOffsets[i - start] < minOffset) {
+                minOffset = sampleOffsets[i - start];
+            }
+            if (i == start || times[i] < minTime) {
+                minTime = times[i];
+            }
+            if (i > 0 && times[i] < times[i - 1]) {
+                mIncreasingTimes = false;
+            }
+        }
+        if (err != OK) {
+            break;
+        }
+
+        mBlockOffsets[block] = minOffset;
+        mBlockTimes[block] = minTime;
+        for (uint32_t i = start; i < end; ++i) {
+            off64_t delta = sampleOffsets[i - start] - minOffset;
+            if (delta > UINT32_MAX) {
+                ALOGV("sample %u is %lld bytes from its block", i, (long long)delta);
+                err = ERROR_OUT_OF_RANGE;
+                break;
+            }
+            offsets[i] = (uint32_t)delta;
+            times[i] -= minTime;
+        }
+    }
+
+    if (err == OK) {
+        err = mOffsets.pack(offsets, numSamples);
+    }
+    if (err == OK) {
+        err = mSizes.pack(sizes, numSamples);
+    }
+    if (err == OK) {
+        err = mTimes.pack(times, numSamples);
+    }
+    if (err == OK) {
+        err = mDurations.pack(durations, numSamples);
+    }
+
+    if (err == OK) {
+        // reuse the offsets for the sync flags
+        uint32_t *syncFlags = offsets;
+        size_t j = 0;
+        for (uint32_t i = 0; i < numSamples; ++i) {
+            if (syncSamples == NULL) {
+                syncFlags[i] = 1;
+                continue;
+            }
+            while (j < numSyncSamples && syncSamples[j] < i) {
+                ++j;
+            }
+            syncFlags[i] = j < numSyncSamples && syncSamples[j] == i;
+        }
+        err = mSyncFlags.pack(syncFlags, numSamples);
+    }
+
+    delete[] offsets;
+    delete[] sizes;
+    delete[] times;
+    delete[] durations;
+
+    if (err == OK) {
+        mNumSamples = numSamples;
+        ALOGV("indexed %u samples in %zu bytes", numSamples, memorySize());
+    }
+    return err;
+}
+
+size_t SampleIndex::memorySize() const {
+    size_t numBlocks = (mNumSamples + kBlockSize - 1) / kBlockSize;
+    return numBlocks * (sizeof(off64_t) + sizeof(uint32_t))
+            + mOffsets.memorySize() + mSizes.memorySize() + mTimes.memorySize()
+            + mDurations.memorySize() + mSyncFlags.memorySize();
+}
+
+}  // namespace android
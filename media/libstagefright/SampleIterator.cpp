@@ -200,7 +200,15 @@ status_t SampleIterator::getChunkOffset(uint32_t chunk, off64_t *offset) {
         return ERROR_OUT_OF_RANGE;
     }
 
-    if (mTable->mChunkOffsetType == SampleTable::kChunkOffsetType32) {
+    if (mTable->mChunkOffsets != NULL) {
+        // the table is mapped into memory, read it in place
+        const uint8_t *entry = mTable->mChunkOffsets;
+        if (mTable->mChunkOffsetType == SampleTable::kChunkOffsetType32) {
+            *offset = U32_AT(entry + 4 * chunk);
+        } else {
+            *offset = U64_AT(entry + 8 * chunk);
+        }
+    } else if (mTable->mChunkOffsetType == SampleTable::kChunkOffsetType32) {
         uint32_t offset32;
 
         if (mTable->mDataSource->readAt(
@@ -241,6 +249,30 @@ status_t SampleIterator::getSampleSizeDirect(
         return OK;
     }
 
+    if (mTable->mSampleSizes != NULL) {
+        // the table is mapped into memory, read it in place
+        const uint8_t *entries = mTable->mSampleSizes;
+        switch (mTable->mSampleSizeFieldSize) {
+            case 32:
+                *size = U32_AT(entries + 4 * sampleIndex);
+                break;
+            case 16:
+                *size = U16_AT(entries + 2 * sampleIndex);
+                break;
+            case 8:
+                *size = entries[sampleIndex];
+                break;
+            default:
+            {
+                CHECK_EQ(mTable->mSampleSizeFieldSize, 4);
+                uint8_t x = entries[sampleIndex / 2];
+                *size = (sampleIndex & 1) ? x & 0x0f : x >> 4;
+                break;
+            }
+        }
+        return OK;
+    }
+
     switch (mTable->mSampleSizeFieldSize) {
         case 32:
         {
@@ -21,6 +21,7 @@
 #include <limits>
 
 #include "include/SampleTable.h"
+#include "include/SampleIndex.h"
 #include "include/SampleIterator.h"
 
 #include <arpa/inet.h>
@@ -119,12 +120,14 @@ SampleTable::SampleTable(const sp<DataSource> &source)
       mChunkOffsetOffset(-1),
       mChunkOffsetType(0),
       mNumChunkOffsets(0),
+      mChunkOffsets(NULL),
       mSampleToChunkOffset(-1),
       mNumSampleToChunkOffsets(0),
       mSampleSizeOffset(-1),
       mSampleSizeFieldSize(0),
       mDefaultSampleSize(0),
       mNumSampleSizes(0),
+      mSampleSizes(NULL),
       mHasTimeToSample(false),
       mTimeToSampleCount(0),
       mTimeToSample(NULL),
@@ -136,12 +139,23 @@ SampleTable::SampleTable(const sp<DataSource> &source)
       mNumSyncSamples(0),
       mSyncSamples(NULL),
       mLastSyncSampleIndex(0),
+      mSampleIndex(NULL),
+      mSampleIndexRequested(false),
+      mIndexThreadStarted(false),
+      mAbortIndexBuild(false),
       mSampleToChunkEntries(NULL),
       mTotalSize(0) {
     mSampleIterator = new SampleIterator(this);
 }
 
 SampleTable::~SampleTable() {
+    if (mIndexThreadStarted) {
+        mAbortIndexBuild = true;
+        pthread_join(mIndexThread, NULL);
+    }
+    delete mSampleIndex;
+    mSampleIndex = NULL;
+
     delete[] mSampleToChunkEntries;
     mSampleToChunkEntries = NULL;
 
@@ -209,6 +223,9 @@ status_t SampleTable::setChunkOffsetParams(
         }
     }
 
+    mChunkOffsets = (const uint8_t *)mDataSource->getMappedPointer(
+            data_offset + 8, data_size - 8);
+
     return OK;
 }
 
@@ -370,6 +387,9 @@ status_t SampleTable::setSampleSizeParams(
         }
     }
 
+    mSampleSizes = (const uint8_t *)mDataSource->getMappedPointer(
+            data_offset + 12, data_size - 12);
+
     return OK;
 }
 
@@ -718,10 +738,20 @@ void SampleTable::buildSampleEntriesTable() {
 status_t SampleTable::findSampleAtTime(
         uint64_t req_time, uint64_t scale_num, uint64_t scale_den,
         uint32_t *sample_index, uint32_t flags) {
-    buildSampleEntriesTable();
+    const SampleIndex *index;
+    {
+        Mutex::Autolock autoLock(mLock);
+        index = mSampleIndex;
+    }
 
-    if (mSampleTimeEntries == NULL) {
-        return ERROR_OUT_OF_RANGE;
+    // samples in increasing time order are their own time-sorted table
+    if (index == NULL || !index->hasIncreasingTimes()) {
+        index = NULL;
+        buildSampleEntriesTable();
+
+        if (mSampleTimeEntries == NULL) {
+            return ERROR_OUT_OF_RANGE;
+        }
     }
 
     uint32_t left = 0;
@@ -729,14 +759,14 @@ status_t SampleTable::findSampleAtTime(
     while (left < right_plus_one) {
         uint32_t center = left + (right_plus_one - left) / 2;
         uint64_t centerTime =
-            getSampleTime(center, scale_num, scale_den);
+            getSampleTime(index, center, scale_num, scale_den);
 
         if (req_time < centerTime) {
             right_plus_one = center;
         } else if (req_time > centerTime) {
             left = center + 1;
         } else {
-            *sample_index = mSampleTimeEntries[center].mSampleIndex;
+            *sample_index = index != NULL ? center : mSampleTimeEntries[center].mSampleIndex;
             return OK;
         }
     }
@@ -776,16 +806,17 @@ status_t SampleTable::findSampleAtTime(
             CHECK(flags == kFlagClosest);
             // pick closest based on timestamp. use abs_difference for safety
             if (abs_difference(
-                    getSampleTime(closestIndex, scale_num, scale_den), req_time) >
+                    getSampleTime(index, closestIndex, scale_num, scale_den), req_time) >
                 abs_difference(
-                    req_time, getSampleTime(closestIndex - 1, scale_num, scale_den))) {
+                    req_time, getSampleTime(index, closestIndex - 1, scale_num, scale_den))) {
                 --closestIndex;
             }
             break;
         }
     }
 
-    *sample_index = mSampleTimeEntries[closestIndex].mSampleIndex;
+    *sample_index =
+            index != NULL ? closestIndex : mSampleTimeEntries[closestIndex].mSampleIndex;
     return OK;
 }
 
@@ -934,6 +965,15 @@ status_t SampleTable::findThumbnailSample(uint32_t *sample_index) {
 
 status_t SampleTable::getSampleSize_l(
         uint32_t sampleIndex, size_t *sampleSize) {
+    if (mSampleIndex != NULL) {
+        if (sampleIndex >= mSampleIndex->countSamples()) {
+            *sampleSize = 0;
+            return ERROR_OUT_OF_RANGE;
+        }
+        *sampleSize = mSampleIndex->getSampleSize(sampleIndex);
+        return OK;
+    }
+
     return mSampleIterator->getSampleSizeDirect(
             sampleIndex, sampleSize);
 }
@@ -947,6 +987,28 @@ status_t SampleTable::getMetaDataForSample(
         uint32_t *sampleDuration) {
     Mutex::Autolock autoLock(mLock);
 
+    if (mSampleIndex != NULL) {
+        if (sampleIndex >= mSampleIndex->countSamples()) {
+            return ERROR_END_OF_STREAM;
+        }
+        if (offset) {
+            *offset = mSampleIndex->getSampleOffset(sampleIndex);
+        }
+        if (size) {
+            *size = mSampleIndex->getSampleSize(sampleIndex);
+        }
+        if (compositionTime) {
+            *compositionTime = mSampleIndex->getSampleTime(sampleIndex);
+        }
+        if (isSyncSample) {
+            *isSyncSample = mSampleIndex->isSyncSample(sampleIndex);
+        }
+        if (sampleDuration) {
+            *sampleDuration = mSampleIndex->getSampleDuration(sampleIndex);
+        }
+        return OK;
+    }
+
     status_t err;
     if ((err = mSampleIterator->seekTo(sampleIndex)) != OK) {
         return err;
@@ -993,6 +1055,80 @@ status_t SampleTable::getMetaDataForSample(
     return OK;
 }
 
+uint64_t SampleTable::getSampleTime(
+        const SampleIndex *index, size_t sample_index,
+        uint64_t scale_num, uint64_t scale_den) const {
+    if (sample_index >= (size_t)mNumSampleSizes || scale_den == 0) {
+        return 0;
+    }
+    if (index != NULL) {
+        return (index->getSampleTime(sample_index) * scale_num) / scale_den;
+    }
+    return mSampleTimeEntries != NULL
+            ? (mSampleTimeEntries[sample_index].mCompositionTime * scale_num) / scale_den : 0;
+}
+
+void SampleTable::buildSampleIndex(bool async) {
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (mSampleIndexRequested) {
+            return;
+        }
+        mSampleIndexRequested = true;
+    }
+
+    if (!async) {
+        buildSampleIndexNow();
+        return;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    mIndexThreadStarted =
+        pthread_create(&mIndexThread, &attr, IndexThreadWrapper, this) == 0;
+    pthread_attr_destroy(&attr);
+}
+
+// static
+void *SampleTable::IndexThreadWrapper(void *me) {
+    static_cast<SampleTable *>(me)->buildSampleIndexNow();
+    return NULL;
+}
+
+void SampleTable::buildSampleIndexNow() {
+    if (!isValid() || mNumSampleSizes == 0) {
+        return;
+    }
+
+    {
+        // the unpacked columns while building take 20 bytes per sample
+        Mutex::Autolock autoLock(mLock);
+        if (mTotalSize + (uint64_t)mNumSampleSizes * 20 > kMaxTotalSize) {
+            ALOGV("not indexing %u samples", mNumSampleSizes);
+            return;
+        }
+    }
+
+    // the tables are complete at this point, so a second iterator can read
+    // them without mLock
+    SampleIterator iterator(this);
+    SampleIndex *index = new SampleIndex;
+    status_t err = index->build(
+            &iterator, mNumSampleSizes,
+            mSyncSampleOffset < 0 ? NULL : mSyncSamples, mNumSyncSamples,
+            &mAbortIndexBuild);
+    if (err != OK) {
+        ALOGV("failed to index samples (%d)", err);
+        delete index;
+        return;
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    mTotalSize += index->memorySize();
+    mSampleIndex = index;
+}
+
 int32_t SampleTable::getCompositionTimeOffset(uint32_t sampleIndex) {
     return mCompositionDeltaLookup->getCompositionTimeOffset(sampleIndex);
 }
@@ -64,28 +64,8 @@ void SkipCutBuffer::submit(MediaBuffer *buffer) {
 
     int32_t offset = buffer->range_offset();
     int32_t buflen = buffer->range_length();
-
-    // drop the initial data from the buffer if needed
-    if (mFrontPadding > 0) {
-        // still data left to drop
-        int32_t to_drop = (buflen < mFrontPadding) ? buflen : mFrontPadding;
-        offset += to_drop;
-        buflen -= to_drop;
-        buffer->set_range(offset, buflen);
-        mFrontPadding -= to_drop;
-    }
-
-
-    // append data to cutbuffer
-    char *src = ((char*) buffer->data()) + offset;
-    write(src, buflen);
-
-
-    // the mediabuffer is now empty. Fill it from cutbuffer, always leaving
-    // at least mBackPadding bytes in the cutbuffer
-    char *dst = (char*) buffer->data();
-    size_t copied = read(dst, buffer->size());
-    buffer->set_range(0, copied);
+    process((char*) buffer->data(), buffer->size(), &offset, &buflen);
+    buffer->set_range(offset, buflen);
 }
 
 template <typename T>
@@ -97,28 +77,44 @@ void SkipCutBuffer::submitInternal(const sp<T>& buffer) {
 
     int32_t offset = buffer->offset();
     int32_t buflen = buffer->size();
+    process((char*) buffer->base(), buffer->capacity(), &offset, &buflen);
+    buffer->setRange(offset, buflen);
+}
 
+void SkipCutBuffer::process(char *base, size_t capacity, int32_t *offset, int32_t *buflen) {
     // drop the initial data from the buffer if needed
     if (mFrontPadding > 0) {
         // still data left to drop
-        int32_t to_drop = (buflen < mFrontPadding) ? buflen : mFrontPadding;
-        offset += to_drop;
-        buflen -= to_drop;
-        buffer->setRange(offset, buflen);
+        int32_t to_drop = (*buflen < mFrontPadding) ? *buflen : mFrontPadding;
+        *offset += to_drop;
+        *buflen -= to_drop;
         mFrontPadding -= to_drop;
     }
 
+    int32_t held = size();
+    if (mBackPadding == 0 && held == 0) {
+        // nothing to cut and nothing held back: the data can stay where it is
+        return;
+    }
+
+    if (held == mBackPadding && *buflen >= mBackPadding) {
+        // Steady state: the cutbuffer holds exactly the tail of the previous buffers. Trade it
+        // for the tail of this buffer, and shift the rest of the data up in place to make room
+        // for it, instead of copying everything through the cutbuffer.
+        char *data = base + *offset;
+        write(data + *buflen - mBackPadding, mBackPadding);
+        memmove(data + mBackPadding, data, *buflen - mBackPadding);
+        read(data, mBackPadding);
+        return;
+    }
 
     // append data to cutbuffer
-    char *src = (char*) buffer->data();
-    write(src, buflen);
+    write(base + *offset, *buflen);
 
-
-    // the mediabuffer is now empty. Fill it from cutbuffer, always leaving
+    // the buffer is now empty. Fill it from cutbuffer, always leaving
     // at least mBackPadding bytes in the cutbuffer
-    char *dst = (char*) buffer->base();
-    size_t copied = read(dst, buffer->capacity());
-    buffer->setRange(0, copied);
+    *offset = 0;
+    *buflen = read(base, capacity);
 }
 
 void SkipCutBuffer::submit(const sp<ABuffer>& buffer) {
@@ -179,6 +175,7 @@ size_t SkipCutBuffer::read(char *dst, size_t num) {
     if (available < int32_t(num)) {
         num = available;
     }
+    size_t copied = num;
 
     size_t copyfirst = (mCapacity - mReadHead);
     if (copyfirst > num) copyfirst = num;
@@ -194,7 +191,7 @@ size_t SkipCutBuffer::read(char *dst, size_t num) {
             mReadHead += num;
         }
     }
-    return available;
+    return copied;
 }
 
 size_t SkipCutBuffer::size() {
@@ -21,11 +21,13 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <pthread.h>
 
 #include <media/stagefright/StagefrightMediaScanner.h>
 
 #include <media/IMediaHTTPService.h>
 #include <media/mediametadataretriever.h>
+#include <media/stagefright/foundation/ABase.h>
 #include <private/media/VideoFrame.h>
 
 namespace android {
@@ -54,6 +56,48 @@ static bool FileHasAcceptableExtension(const char *extension) {
     return false;
 }
 
+struct KeyMap {
+    const char *tag;
+    int key;
+};
+static const KeyMap kKeyMap[] = {
+    { "tracknumber", METADATA_KEY_CD_TRACK_NUMBER },
+    { "discnumber", METADATA_KEY_DISC_NUMBER },
+    { "album", METADATA_KEY_ALBUM },
+    { "artist", METADATA_KEY_ARTIST },
+    { "albumartist", METADATA_KEY_ALBUMARTIST },
+    { "composer", METADATA_KEY_COMPOSER },
+    { "genre", METADATA_KEY_GENRE },
+    { "title", METADATA_KEY_TITLE },
+    { "year", METADATA_KEY_YEAR },
+    { "duration", METADATA_KEY_DURATION },
+    { "writer", METADATA_KEY_WRITER },
+    { "compilation", METADATA_KEY_COMPILATION },
+    { "isdrm", METADATA_KEY_IS_DRM },
+    { "date", METADATA_KEY_DATE },
+    { "width", METADATA_KEY_VIDEO_WIDTH },
+    { "height", METADATA_KEY_VIDEO_HEIGHT },
+};
+static const size_t kNumEntries = sizeof(kKeyMap) / sizeof(kKeyMap[0]);
+
+// What the retriever found in a file, kept until it is reported to the client.
+struct StagefrightMediaScanner::FileMetadata {
+    FileMetadata()
+        : mResult(MEDIA_SCAN_RESULT_SKIPPED),
+          mHasMimeType(false),
+          mDone(false) {
+    }
+
+    MediaScanResult mResult;
+    bool mHasMimeType;
+    String8 mMimeType;
+    // the tags of kKeyMap that were found, and their values
+    Vector<const char *> mTags;
+    Vector<String8> mValues;
+    // set once the file has been read, under ParallelScan::mLock
+    bool mDone;
+};
+
 MediaScanResult StagefrightMediaScanner::processFile(
         const char *path, const char *mimeType,
         MediaScannerClient &client) {
@@ -69,6 +113,19 @@ MediaScanResult StagefrightMediaScanner::processFile(
 MediaScanResult StagefrightMediaScanner::processFileInternal(
         const char *path, const char * /* mimeType */,
         MediaScannerClient &client) {
+    sp<MediaMetadataRetriever> retriever;
+    FileMetadata metadata;
+    MediaScanResult result = ExtractMetadata(path, &retriever, &metadata);
+    if (result != MEDIA_SCAN_RESULT_OK) {
+        return result;
+    }
+    return ReportMetadata(metadata, client);
+}
+
+// static
+MediaScanResult StagefrightMediaScanner::ExtractMetadata(
+        const char *path, sp<MediaMetadataRetriever> *retriever,
+        FileMetadata *metadata) {
     const char *extension = strrchr(path, '.');
 
     if (!extension) {
@@ -79,15 +136,17 @@ MediaScanResult StagefrightMediaScanner::processFileInternal(
         return MEDIA_SCAN_RESULT_SKIPPED;
     }
 
-    sp<MediaMetadataRetriever> mRetriever(new MediaMetadataRetriever);
+    if (*retriever == NULL) {
+        *retriever = new MediaMetadataRetriever;
+    }
 
     int fd = open(path, O_RDONLY | O_LARGEFILE);
     status_t status;
     if (fd < 0) {
         // couldn't open it locally, maybe the media server can?
-        status = mRetriever->setDataSource(NULL /* httpService */, path);
+        status = (*retriever)->setDataSource(NULL /* httpService */, path);
     } else {
-        status = mRetriever->setDataSource(fd, 0, 0x7ffffffffffffffL);
+        status = (*retriever)->setDataSource(fd, 0, 0x7ffffffffffffffL);
         close(fd);
     }
 
@@ -96,46 +155,175 @@ MediaScanResult StagefrightMediaScanner::processFileInternal(
     }
 
     const char *value;
-    if ((value = mRetriever->extractMetadata(
+    if ((value = (*retriever)->extractMetadata(
                     METADATA_KEY_MIMETYPE)) != NULL) {
-        status = client.setMimeType(value);
+        metadata->mHasMimeType = true;
+        metadata->mMimeType = value;
+    }
+
+    for (size_t i = 0; i < kNumEntries; ++i) {
+        if ((value = (*retriever)->extractMetadata(kKeyMap[i].key)) != NULL) {
+            metadata->mTags.push_back(kKeyMap[i].tag);
+            metadata->mValues.push_back(String8(value));
+        }
+    }
+
+    return MEDIA_SCAN_RESULT_OK;
+}
+
+// static
+MediaScanResult StagefrightMediaScanner::ReportMetadata(
+        const FileMetadata &metadata, MediaScannerClient &client) {
+    if (metadata.mHasMimeType) {
+        status_t status = client.setMimeType(metadata.mMimeType.string());
         if (status) {
             return MEDIA_SCAN_RESULT_ERROR;
         }
     }
 
-    struct KeyMap {
-        const char *tag;
-        int key;
-    };
-    static const KeyMap kKeyMap[] = {
-        { "tracknumber", METADATA_KEY_CD_TRACK_NUMBER },
-        { "discnumber", METADATA_KEY_DISC_NUMBER },
-        { "album", METADATA_KEY_ALBUM },
-        { "artist", METADATA_KEY_ARTIST },
-        { "albumartist", METADATA_KEY_ALBUMARTIST },
-        { "composer", METADATA_KEY_COMPOSER },
-        { "genre", METADATA_KEY_GENRE },
-        { "title", METADATA_KEY_TITLE },
-        { "year", METADATA_KEY_YEAR },
-        { "duration", METADATA_KEY_DURATION },
-        { "writer", METADATA_KEY_WRITER },
-        { "compilation", METADATA_KEY_COMPILATION },
-        { "isdrm", METADATA_KEY_IS_DRM },
-        { "date", METADATA_KEY_DATE },
-        { "width", METADATA_KEY_VIDEO_WIDTH },
-        { "height", METADATA_KEY_VIDEO_HEIGHT },
+    for (size_t i = 0; i < metadata.mTags.size(); ++i) {
+        status_t status = client.addStringTag(metadata.mTags[i], metadata.mValues[i].string());
+        if (status != OK) {
+            return MEDIA_SCAN_RESULT_ERROR;
+        }
+    }
+
+    return MEDIA_SCAN_RESULT_OK;
+}
+
+// The state shared by the threads of processFiles(). The workers take the
+// paths in order and read them; the calling thread reports the files that are
+// done, in order, and lets the workers get at most kMaxPendingFiles ahead of
+// it, which bounds the metadata held.
+struct StagefrightMediaScanner::ParallelScan {
+    enum {
+        kMaxPendingFiles = 64,
     };
-    static const size_t kNumEntries = sizeof(kKeyMap) / sizeof(kKeyMap[0]);
 
-    for (size_t i = 0; i < kNumEntries; ++i) {
-        const char *value;
-        if ((value = mRetriever->extractMetadata(kKeyMap[i].key)) != NULL) {
-            status = client.addStringTag(kKeyMap[i].tag, value);
-            if (status != OK) {
-                return MEDIA_SCAN_RESULT_ERROR;
+    explicit ParallelScan(const Vector<String8> &paths)
+        : mPaths(paths),
+          mMetadata(new FileMetadata[paths.size()]),
+          mNextPath(0),
+          mNextReport(0) {
+    }
+
+    ~ParallelScan() {
+        delete[] mMetadata;
+    }
+
+    static void *ThreadWrapper(void *me) {
+        static_cast<ParallelScan *>(me)->threadFunc();
+        return NULL;
+    }
+
+    void threadFunc() {
+        // Kept from file to file; a retriever that failed is replaced, in
+        // case its connection to the media server is what failed.
+        sp<MediaMetadataRetriever> retriever;
+
+        Mutex::Autolock autoLock(mLock);
+        for (;;) {
+            while (mNextPath < mPaths.size()
+                    && mNextPath >= mNextReport + kMaxPendingFiles) {
+                mWorkerCondition.wait(mLock);
+            }
+            if (mNextPath >= mPaths.size()) {
+                break;
+            }
+            size_t index = mNextPath++;
+            FileMetadata *metadata = &mMetadata[index];
+
+            mLock.unlock();
+            ALOGV("scanning '%s'", mPaths[index].string());
+            metadata->mResult = ExtractMetadata(mPaths[index].string(), &retriever, metadata);
+            if (metadata->mResult == MEDIA_SCAN_RESULT_ERROR) {
+                retriever.clear();
+            }
+            mLock.lock();
+
+            metadata->mDone = true;
+            mReportCondition.signal();
+        }
+    }
+
+    const Vector<String8> &mPaths;
+    FileMetadata *mMetadata;
+
+    Mutex mLock;
+    Condition mWorkerCondition;
+    Condition mReportCondition;
+    size_t mNextPath;
+    size_t mNextReport;
+
+private:
+    DISALLOW_EVIL_CONSTRUCTORS(ParallelScan);
+};
+
+MediaScanResult StagefrightMediaScanner::processFiles(
+        const Vector<String8> &paths, MediaScannerClient &client,
+        size_t maxConcurrency, Vector<MediaScanResult> *results) {
+    size_t numThreads = maxConcurrency < paths.size() ? maxConcurrency : paths.size();
+    if (numThreads <= 1) {
+        return MediaScanner::processFiles(paths, client, maxConcurrency, results);
+    }
+
+    ParallelScan scan(paths);
+    Vector<pthread_t> threads;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    for (size_t i = 0; i < numThreads; ++i) {
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, ParallelScan::ThreadWrapper, &scan) == 0) {
+            threads.push_back(thread);
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    if (threads.isEmpty()) {
+        ALOGW("no scanning threads, scanning in the calling thread");
+        return MediaScanner::processFiles(paths, client, maxConcurrency, results);
+    }
+
+    ALOGV("scanning %zu files with %zu threads", paths.size(), threads.size());
+
+    scan.mLock.lock();
+    while (scan.mNextReport < paths.size()) {
+        while (!scan.mMetadata[scan.mNextReport].mDone) {
+            scan.mReportCondition.wait(scan.mLock);
+        }
+        size_t end = scan.mNextReport;
+        while (end < paths.size() && scan.mMetadata[end].mDone) {
+            ++end;
+        }
+
+        // The client is only called from this thread, and without the lock
+        // so that the workers go on reading.
+        scan.mLock.unlock();
+        for (size_t i = scan.mNextReport; i < end; ++i) {
+            FileMetadata *metadata = &scan.mMetadata[i];
+            client.setLocale(locale());
+            client.beginFile();
+            MediaScanResult result = metadata->mResult;
+            if (result == MEDIA_SCAN_RESULT_OK) {
+                result = ReportMetadata(*metadata, client);
             }
+            client.endFile();
+            results->push_back(result);
+
+            metadata->mMimeType.clear();
+            metadata->mTags.clear();
+            metadata->mValues.clear();
         }
+        scan.mLock.lock();
+
+        scan.mNextReport = end;
+        scan.mWorkerCondition.broadcast();
+    }
+    scan.mLock.unlock();
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+        pthread_join(threads[i], NULL);
     }
 
     return MEDIA_SCAN_RESULT_OK;
@@ -19,7 +19,11 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+#include <vector>
+
 #include <utils/Log.h>
+#include <cutils/properties.h>
 #include <gui/Surface.h>
 
 #include "include/avc_utils.h"
@@ -53,13 +57,15 @@ static const size_t kRetryCount = 20; // must be >0
 
 StagefrightMetadataRetriever::StagefrightMetadataRetriever()
     : mParsedMetaData(false),
-      mAlbumArt(NULL) {
+      mAlbumArt(NULL),
+      mDecoderSeekingClosest(false) {
     ALOGV("StagefrightMetadataRetriever()");
 }
 
 StagefrightMetadataRetriever::~StagefrightMetadataRetriever() {
     ALOGV("~StagefrightMetadataRetriever()");
     clearMetadata();
+    releaseDecoder();
     if (mSource != NULL) {
         mSource->close();
     }
@@ -137,7 +143,17 @@ status_t StagefrightMetadataRetriever::setDataSource(
     return OK;
 }
 
-static VideoFrame *extractVideoFrame(
+void StagefrightMetadataRetriever::releaseDecoder() {
+    if (mDecoder != NULL) {
+        mDecoder->release();
+        mDecoder.clear();
+    }
+    mDecoderLooper.clear();
+    mDecoderName.clear();
+    mDecoderTrackMeta.clear();
+}
+
+VideoFrame *StagefrightMetadataRetriever::extractVideoFrame(
         const AString &componentName,
         const sp<MetaData> &trackMeta,
         const sp<IMediaSource> &source,
@@ -166,36 +182,61 @@ static VideoFrame *extractVideoFrame(
     }
 
     status_t err;
-    sp<ALooper> looper = new ALooper;
-    looper->start();
-    sp<MediaCodec> decoder = MediaCodec::CreateByComponentName(
-            looper, componentName, &err);
+    if (mDecoder != NULL && mDecoderName == componentName
+            && mDecoderTrackMeta == trackMeta && mDecoderSeekingClosest == isSeekingClosest) {
+        ALOGV("reusing decoder [%s]", componentName.c_str());
+    } else {
+        if (mDecoder != NULL && mDecoderName == componentName) {
+            // Instantiating the component is what takes the time; a stopped
+            // codec is configured anew.
+            ALOGV("reconfiguring decoder [%s]", componentName.c_str());
+            err = mDecoder->stop();
+            if (err != OK) {
+                releaseDecoder();
+            }
+        } else {
+            releaseDecoder();
+        }
 
-    if (decoder.get() == NULL || err != OK) {
-        ALOGW("Failed to instantiate decoder [%s]", componentName.c_str());
-        return NULL;
-    }
+        if (mDecoder == NULL) {
+            mDecoderLooper = new ALooper;
+            mDecoderLooper->start();
+            mDecoder = MediaCodec::CreateByComponentName(
+                    mDecoderLooper, componentName, &err);
 
-    err = decoder->configure(videoFormat, NULL /* surface */, NULL /* crypto */, 0 /* flags */);
-    if (err != OK) {
-        ALOGW("configure returned error %d (%s)", err, asString(err));
-        decoder->release();
-        return NULL;
-    }
+            if (mDecoder.get() == NULL || err != OK) {
+                ALOGW("Failed to instantiate decoder [%s]", componentName.c_str());
+                releaseDecoder();
+                return NULL;
+            }
+            mDecoderName = componentName;
+        }
 
-    err = decoder->start();
-    if (err != OK) {
-        ALOGW("start returned error %d (%s)", err, asString(err));
-        decoder->release();
-        return NULL;
+        err = mDecoder->configure(
+                videoFormat, NULL /* surface */, NULL /* crypto */, 0 /* flags */);
+        if (err != OK) {
+            ALOGW("configure returned error %d (%s)", err, asString(err));
+            releaseDecoder();
+            return NULL;
+        }
+
+        err = mDecoder->start();
+        if (err != OK) {
+            ALOGW("start returned error %d (%s)", err, asString(err));
+            releaseDecoder();
+            return NULL;
+        }
+        mDecoderTrackMeta = trackMeta;
+        mDecoderSeekingClosest = isSeekingClosest;
     }
+    sp<MediaCodec> decoder = mDecoder;
 
     MediaSource::ReadOptions options;
     if (seekMode < MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC ||
         seekMode > MediaSource::ReadOptions::SEEK_CLOSEST) {
 
         ALOGE("Unknown seek mode: %d", seekMode);
-        decoder->release();
+        releaseDecoder();
         return NULL;
     }
 
@@ -217,7 +258,7 @@ static VideoFrame *extractVideoFrame(
     err = source->start();
     if (err != OK) {
         ALOGW("source failed to start: %d (%s)", err, asString(err));
-        decoder->release();
+        releaseDecoder();
         return NULL;
     }
 
@@ -225,7 +266,7 @@ static VideoFrame *extractVideoFrame(
     err = decoder->getInputBuffers(&inputBuffers);
     if (err != OK) {
         ALOGW("failed to get input buffers: %d (%s)", err, asString(err));
-        decoder->release();
+        releaseDecoder();
         source->stop();
         return NULL;
     }
@@ -234,7 +275,7 @@ static VideoFrame *extractVideoFrame(
     err = decoder->getOutputBuffers(&outputBuffers);
     if (err != OK) {
         ALOGW("failed to get output buffers: %d (%s)", err, asString(err));
-        decoder->release();
+        releaseDecoder();
         source->stop();
         return NULL;
     }
@@ -369,7 +410,7 @@ static VideoFrame *extractVideoFrame(
     if (err != OK || size <= 0 || outputFormat == NULL) {
         ALOGE("Failed to decode thumbnail frame");
         source->stop();
-        decoder->release();
+        releaseDecoder();
         return NULL;
     }
 
@@ -405,6 +446,21 @@ static VideoFrame *extractVideoFrame(
     VideoFrame *frame = new VideoFrame;
     frame->mWidth = crop_right - crop_left + 1;
     frame->mHeight = crop_bottom - crop_top + 1;
+
+    // Frames larger than this are scaled down as they are converted.
+    int32_t maxSize = property_get_int32("media.stagefright.thumbnail.max-size", 0);
+    if (maxSize > 0 && (frame->mWidth > (uint32_t)maxSize || frame->mHeight > (uint32_t)maxSize)) {
+        if (frame->mWidth >= frame->mHeight) {
+            frame->mHeight = std::max<int64_t>(
+                    1, (int64_t)frame->mHeight * maxSize / frame->mWidth);
+            frame->mWidth = maxSize;
+        } else {
+            frame->mWidth = std::max<int64_t>(
+                    1, (int64_t)frame->mWidth * maxSize / frame->mHeight);
+            frame->mHeight = maxSize;
+        }
+        ALOGV("scaling the frame to %u x %u", frame->mWidth, frame->mHeight);
+    }
     frame->mDisplayWidth = frame->mWidth;
     frame->mDisplayHeight = frame->mHeight;
     frame->mSize = frame->mWidth * frame->mHeight * 2;
@@ -440,7 +496,7 @@ static VideoFrame *extractVideoFrame(
     ColorConverter converter((OMX_COLOR_FORMATTYPE)srcFormat, OMX_COLOR_Format16bitRGB565);
 
     if (converter.isValid()) {
-        err = converter.convert(
+        err = converter.convertScaled(
                 (const uint8_t *)videoFrameBuffer->data(),
                 width, height,
                 crop_left, crop_top, crop_right, crop_bottom,
@@ -457,7 +513,10 @@ static VideoFrame *extractVideoFrame(
     videoFrameBuffer.clear();
     source->stop();
     decoder->releaseOutputBuffer(index);
-    decoder->release();
+    // Flushing also clears the end of stream, for the next request.
+    if (decoder->flush() != OK) {
+        releaseDecoder();
+    }
 
     if (err != OK) {
         ALOGE("Colorconverter failed to convert frame.");
@@ -469,27 +528,26 @@ static VideoFrame *extractVideoFrame(
     return frame;
 }
 
-VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
-        int64_t timeUs, int option) {
-
-    ALOGV("getFrameAtTime: %" PRId64 " us option: %d", timeUs, option);
-
+bool StagefrightMetadataRetriever::getVideoTrack(
+        sp<MetaData> *trackMeta,
+        sp<IMediaSource> *source,
+        Vector<AString> *matchingCodecs) {
     if (mExtractor.get() == NULL) {
         ALOGV("no extractor.");
-        return NULL;
+        return false;
     }
 
     sp<MetaData> fileMeta = mExtractor->getMetaData();
 
     if (fileMeta == NULL) {
         ALOGV("extractor doesn't publish metadata, failed to initialize?");
-        return NULL;
+        return false;
     }
 
     int32_t drm = 0;
     if (fileMeta->findInt32(kKeyIsDRM, &drm) && drm != 0) {
         ALOGE("frame grab not allowed.");
-        return NULL;
+        return false;
     }
 
     size_t n = mExtractor->countTracks();
@@ -507,17 +565,17 @@ VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
 
     if (i == n) {
         ALOGV("no video track found.");
-        return NULL;
+        return false;
     }
 
-    sp<MetaData> trackMeta = mExtractor->getTrackMetaData(
+    *trackMeta = mExtractor->getTrackMetaData(
             i, MediaExtractor::kIncludeExtensiveMetaData);
 
-    sp<IMediaSource> source = mExtractor->getTrack(i);
+    *source = mExtractor->getTrack(i);
 
-    if (source.get() == NULL) {
+    if (source->get() == NULL) {
         ALOGV("unable to instantiate video track.");
-        return NULL;
+        return false;
     }
 
     const void *data;
@@ -529,14 +587,27 @@ VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
     }
 
     const char *mime;
-    CHECK(trackMeta->findCString(kKeyMIMEType, &mime));
+    CHECK((*trackMeta)->findCString(kKeyMIMEType, &mime));
 
-    Vector<AString> matchingCodecs;
     MediaCodecList::findMatchingCodecs(
             mime,
             false, /* encoder */
             MediaCodecList::kPreferSoftwareCodecs,
-            &matchingCodecs);
+            matchingCodecs);
+    return true;
+}
+
+VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
+        int64_t timeUs, int option) {
+
+    ALOGV("getFrameAtTime: %" PRId64 " us option: %d", timeUs, option);
+
+    sp<MetaData> trackMeta;
+    sp<IMediaSource> source;
+    Vector<AString> matchingCodecs;
+    if (!getVideoTrack(&trackMeta, &source, &matchingCodecs)) {
+        return NULL;
+    }
 
     for (size_t i = 0; i < matchingCodecs.size(); ++i) {
         const AString &componentName = matchingCodecs[i];
@@ -552,6 +623,54 @@ VideoFrame *StagefrightMetadataRetriever::getFrameAtTime(
     return NULL;
 }
 
+status_t StagefrightMetadataRetriever::getFramesAtTimes(
+        const Vector<int64_t> &timesUs, int option, Vector<VideoFrame *> *frames) {
+
+    ALOGV("getFramesAtTimes: %zu frames option: %d", timesUs.size(), option);
+
+    frames->clear();
+    frames->insertAt(NULL, 0, timesUs.size());
+
+    sp<MetaData> trackMeta;
+    sp<IMediaSource> source;
+    Vector<AString> matchingCodecs;
+    if (!getVideoTrack(&trackMeta, &source, &matchingCodecs)) {
+        return UNKNOWN_ERROR;
+    }
+    if (matchingCodecs.isEmpty()) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    // Extract the frames in presentation order, so that the track only ever
+    // seeks forward, and with the decoder that last succeeded, which is kept
+    // running from one frame to the next.
+    std::vector<size_t> order(timesUs.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&timesUs](size_t a, size_t b) {
+        return timesUs[a] < timesUs[b];
+    });
+
+    size_t codecIndex = 0;
+    for (size_t i : order) {
+        for (size_t j = 0; j < matchingCodecs.size(); ++j) {
+            size_t k = (codecIndex + j) % matchingCodecs.size();
+            VideoFrame *frame =
+                extractVideoFrame(matchingCodecs[k], trackMeta, source, timesUs[i], option);
+            if (frame != NULL) {
+                frames->editItemAt(i) = frame;
+                codecIndex = k;
+                break;
+            }
+            ALOGV("%s failed to extract frame at %" PRId64 " us, trying next decoder.",
+                    matchingCodecs[k].c_str(), timesUs[i]);
+        }
+    }
+
+    return OK;
+}
+
 MediaAlbumArt *StagefrightMetadataRetriever::extractAlbumArt() {
     ALOGV("extractAlbumArt (extractor: %s)", mExtractor.get() != NULL ? "YES" : "NO");
 
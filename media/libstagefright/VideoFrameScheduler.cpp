@@ -332,7 +332,8 @@ VideoFrameScheduler::VideoFrameScheduler()
       mVsyncPeriod(0),
       mVsyncRefreshAt(0),
       mLastVsyncTime(-1),
-      mTimeCorrection(0) {
+      mTimeCorrection(0),
+      mStats() {
 }
 
 void VideoFrameScheduler::updateVsync() {
@@ -472,6 +473,7 @@ nsecs_t VideoFrameScheduler::schedule(nsecs_t renderTime) {
                     ++vsyncsForLastFrame;
             }
             ATRACE_INT("FRAME_VSYNCS", vsyncsForLastFrame);
+            updateStats(vsyncsForLastFrame, videoPeriod);
         }
         mLastVsyncTime = nextVsyncTime;
     }
@@ -484,6 +486,30 @@ nsecs_t VideoFrameScheduler::schedule(nsecs_t renderTime) {
     return renderTime;
 }
 
+void VideoFrameScheduler::updateStats(size_t vsyncsForLastFrame, nsecs_t videoPeriod) {
+    size_t minVsyncsPerFrame = videoPeriod / mVsyncPeriod;
+    size_t maxVsyncsPerFrame = (videoPeriod + mVsyncPeriod - 1) / mVsyncPeriod;
+    nsecs_t judder = abs((nsecs_t)vsyncsForLastFrame * mVsyncPeriod - videoPeriod);
+
+    Mutex::Autolock autoLock(mStatsLock);
+    ++mStats.mNumFrames;
+    if (vsyncsForLastFrame > maxVsyncsPerFrame) {
+        ++mStats.mNumRepeats;
+    } else if (vsyncsForLastFrame < minVsyncsPerFrame || vsyncsForLastFrame == 0) {
+        ++mStats.mNumSkips;
+    }
+    mStats.mTotalJudderNs += judder;
+    if (judder > mStats.mMaxJudderNs) {
+        mStats.mMaxJudderNs = judder;
+    }
+    ++mStats.mVsyncsPerFrame[min(vsyncsForLastFrame, kMaxVsyncsPerFrameStats - 1)];
+}
+
+VideoFrameScheduler::Stats VideoFrameScheduler::getStats() {
+    Mutex::Autolock autoLock(mStatsLock);
+    return mStats;
+}
+
 void VideoFrameScheduler::release() {
     mComposer.clear();
 }
@@ -21,6 +21,7 @@
 #include "include/WAVExtractor.h"
 
 #include <audio_utils/primitives.h>
+#include <cutils/properties.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/DataSource.h>
 #include <media/stagefright/MediaBufferGroup.h>
@@ -84,6 +85,8 @@ private:
     int32_t mSampleRate;
     int32_t mNumChannels;
     int32_t mBitsPerSample;
+    // output float samples instead of 16-bit, see WAVExtractor::init()
+    bool mOutputFloat;
     off64_t mOffset;
     size_t mSize;
     bool mStarted;
@@ -311,7 +314,16 @@ status_t WAVExtractor::init() {
                 mTrackMeta->setInt32(kKeyChannelCount, mNumChannels);
                 mTrackMeta->setInt32(kKeyChannelMask, mChannelMask);
                 mTrackMeta->setInt32(kKeySampleRate, mSampleRate);
-                mTrackMeta->setInt32(kKeyPcmEncoding, kAudioEncodingPcm16bit);
+
+                // Samples wider than 16 bits are reduced to 16-bit unless float output is
+                // enabled, in which case float data is passed through without conversion.
+                int32_t pcmEncoding = kAudioEncodingPcm16bit;
+                if (((mWaveFormat == WAVE_FORMAT_PCM && mBitsPerSample > 16)
+                        || mWaveFormat == WAVE_FORMAT_IEEE_FLOAT)
+                        && property_get_bool("media.stagefright.wav.float", false)) {
+                    pcmEncoding = kAudioEncodingPcmFloat;
+                }
+                mTrackMeta->setInt32(kKeyPcmEncoding, pcmEncoding);
 
                 int64_t durationUs = 0;
                 if (mWaveFormat == WAVE_FORMAT_MSGSM) {
@@ -359,6 +371,7 @@ WAVSource::WAVSource(
       mSampleRate(0),
       mNumChannels(0),
       mBitsPerSample(bitsPerSample),
+      mOutputFloat(false),
       mOffset(offset),
       mSize(size),
       mStarted(false),
@@ -366,6 +379,10 @@ WAVSource::WAVSource(
     CHECK(mMeta->findInt32(kKeySampleRate, &mSampleRate));
     CHECK(mMeta->findInt32(kKeyChannelCount, &mNumChannels));
 
+    int32_t pcmEncoding;
+    mOutputFloat = mMeta->findInt32(kKeyPcmEncoding, &pcmEncoding)
+            && pcmEncoding == kAudioEncodingPcmFloat;
+
     mMeta->setInt32(kKeyMaxInputSize, kMaxFrameSize);
 }
 
@@ -447,10 +464,11 @@ status_t WAVSource::read(
         return err;
     }
 
-    // make sure that maxBytesToRead is multiple of 3, in 24-bit case
+    // make sure that maxBytesToRead is multiple of 3, in 24-bit case, and that 24-bit samples
+    // still fit once expanded to float
     size_t maxBytesToRead =
-        mBitsPerSample == 8 ? kMaxFrameSize / 2 : 
-        (mBitsPerSample == 24 ? 3*(kMaxFrameSize/3): kMaxFrameSize);
+        mBitsPerSample == 8 ? kMaxFrameSize / 2 :
+        (mBitsPerSample == 24 ? 3*(kMaxFrameSize/(mOutputFloat ? 4 : 3)): kMaxFrameSize);
 
     size_t maxBytesAvailable =
         (mCurrentPos - mOffset >= (off64_t)mSize)
@@ -486,8 +504,21 @@ status_t WAVSource::read(
 
     buffer->set_range(0, n);
 
-    // TODO: add capability to return data as float PCM instead of 16 bit PCM.
-    if (mWaveFormat == WAVE_FORMAT_PCM) {
+    if (mOutputFloat) {
+        if (mWaveFormat == WAVE_FORMAT_PCM && mBitsPerSample == 24) {
+            // Convert 24-bit signed samples to float in place, growing the buffer
+            const size_t numSamples = n / 3;
+
+            memcpy_to_float_from_p24((float *)buffer->data(), (const uint8_t *)buffer->data(), numSamples);
+            buffer->set_range(0, sizeof(float) * numSamples);
+        } else if (mWaveFormat == WAVE_FORMAT_PCM && mBitsPerSample == 32) {
+            // Convert 32-bit signed samples to float in place
+            const size_t numSamples = n / 4;
+
+            memcpy_to_float_from_i32((float *)buffer->data(), (const int32_t *)buffer->data(), numSamples);
+        }
+        // 32-bit float samples are already in the output format
+    } else if (mWaveFormat == WAVE_FORMAT_PCM) {
         if (mBitsPerSample == 8) {
             // Convert 8-bit unsigned samples to 16-bit signed.
 
@@ -31,47 +31,25 @@
 namespace android {
 
 unsigned parseUE(ABitReader *br) {
-    unsigned numZeroes = 0;
-    while (br->getBits(1) == 0) {
-        ++numZeroes;
-    }
-
-    unsigned x = br->getBits(numZeroes);
-
-    return x + (1u << numZeroes) - 1;
+    uint32_t x;
+    CHECK(br->getUEGolombGraceful(&x));
+    return x;
 }
 
 unsigned parseUEWithFallback(ABitReader *br, unsigned fallback) {
-    unsigned numZeroes = 0;
-    while (br->getBitsWithFallback(1, 1) == 0) {
-        ++numZeroes;
-    }
     uint32_t x;
-    if (numZeroes < 32) {
-        if (br->getBitsGraceful(numZeroes, &x)) {
-            return x + (1u << numZeroes) - 1;
-        } else {
-            return fallback;
-        }
-    } else {
-        br->skipBits(numZeroes);
-        return fallback;
-    }
+    return br->getUEGolombGraceful(&x) ? x : fallback;
 }
 
 signed parseSE(ABitReader *br) {
-    unsigned codeNum = parseUE(br);
-
-    return (codeNum & 1) ? (codeNum + 1) / 2 : -signed(codeNum / 2);
+    int32_t x;
+    CHECK(br->getSEGolombGraceful(&x));
+    return x;
 }
 
 signed parseSEWithFallback(ABitReader *br, signed fallback) {
-    // NOTE: parseUE cannot normally return ~0 as the max supported value is 0xFFFE
-    unsigned codeNum = parseUEWithFallback(br, ~0U);
-    if (codeNum == ~0U) {
-        return fallback;
-    }
-    return (codeNum & 1) ? (codeNum + 1) / 2 : -signed(codeNum / 2);
+    int32_t x;
+    return br->getSEGolombGraceful(&x) ? x : fallback;
 }
 
 static void skipScalingList(ABitReader *br, size_t sizeOfScalingList) {
@@ -254,6 +232,25 @@ void FindAVCDimensions(
     }
 }
 
+size_t findNextStartCode(const uint8_t *data, size_t size, size_t offset) {
+    // memchr() looks at many bytes at a time, so search for the 0x01 that
+    // ends a start code and check the two bytes before it.
+    size_t pos = offset + 2;
+    while (pos < size) {
+        const uint8_t *one = (const uint8_t *)memchr(&data[pos], 0x01, size - pos);
+        if (one == NULL) {
+            break;
+        }
+        pos = one - data;
+        if (data[pos - 1] == 0x00 && data[pos - 2] == 0x00) {
+            return pos - 2;
+        }
+        // The next start code needs two 0x00 bytes after this 0x01.
+        pos += 3;
+    }
+    return size;
+}
+
 status_t getNextNALUnit(
         const uint8_t **_data, size_t *_size,
         const uint8_t **nalStart, size_t *nalSize,
@@ -268,17 +265,10 @@ status_t getNextNALUnit(
         return -EAGAIN;
     }
 
-    size_t offset = 0;
-
     // A valid startcode consists of at least two 0x00 bytes followed by 0x01.
-    for (; offset + 2 < size; ++offset) {
-        if (data[offset + 2] == 0x01 && data[offset] == 0x00
-                && data[offset + 1] == 0x00) {
-            break;
-        }
-    }
-    if (offset + 2 >= size) {
-        *_data = &data[offset];
+    size_t offset = findNextStartCode(data, size);
+    if (offset == size) {
+        *_data = &data[size - 2];
         *_size = 2;
         return -EAGAIN;
     }
@@ -286,26 +276,11 @@ status_t getNextNALUnit(
 
     size_t startOffset = offset;
 
-    for (;;) {
-        while (offset < size && data[offset] != 0x01) {
-            ++offset;
-        }
-
-        if (offset == size) {
-            if (startCodeFollows) {
-                offset = size + 2;
-                break;
-            }
-
-            return -EAGAIN;
-        }
-
-        if (data[offset - 1] == 0x00 && data[offset - 2] == 0x00) {
-            break;
-        }
-
-        ++offset;
+    offset = findNextStartCode(data, size, startOffset);
+    if (offset == size && !startCodeFollows) {
+        return -EAGAIN;
     }
+    offset += 2;
 
     size_t endOffset = offset - 2;
     while (endOffset > startOffset + 1 && data[endOffset - 1] == 0x00) {
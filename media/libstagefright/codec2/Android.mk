@@ -3,9 +3,12 @@ include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES:= \
         C2.cpp    \
+        vndk/C2PooledAllocator.cpp \
+        vndk/C2WorkUtils.cpp \
 
 LOCAL_C_INCLUDES += \
         $(TOP)/frameworks/av/media/libstagefright/codec2/include \
+        $(TOP)/frameworks/av/media/libstagefright/codec2/vndk/include \
         $(TOP)/frameworks/native/include/media/hardware \
 
 LOCAL_MODULE:= libstagefright_codec2
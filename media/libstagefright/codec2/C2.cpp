@@ -32,5 +32,8 @@ namespace android {
  * Codec2 clients.
  */
 
+C2ComponentListener::~C2ComponentListener() {
+}
+
 } // namespace android
 
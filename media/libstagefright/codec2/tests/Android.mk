@@ -8,7 +8,9 @@ LOCAL_MODULE := codec2_test
 LOCAL_MODULE_TAGS := tests
 
 LOCAL_SRC_FILES := \
+	vndk/C2PooledAllocatorTest.cpp \
 	vndk/C2UtilTest.cpp \
+	vndk/C2WorkUtilsTest.cpp \
 	C2_test.cpp \
 	C2Param_test.cpp \
 
@@ -27,6 +29,30 @@ LOCAL_CLANG := true
 
 include $(BUILD_NATIVE_TEST)
 
+# Build the benchmarks.
+include $(CLEAR_VARS)
+LOCAL_ADDITIONAL_DEPENDENCIES := $(LOCAL_PATH)/Android.mk
+
+LOCAL_MODULE := C2Work_benchmark
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+	C2Work_benchmark.cpp \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright_codec2 \
+
+LOCAL_C_INCLUDES := \
+	frameworks/av/media/libstagefright/codec2/include \
+	frameworks/av/media/libstagefright/codec2/vndk/include \
+	$(TOP)/frameworks/native/include/media/openmax \
+
+LOCAL_CFLAGS += -Werror -Wall -std=c++14
+LOCAL_CLANG := true
+
+include $(BUILD_NATIVE_BENCHMARK)
+
 # Include subdirectory makefiles
 # ============================================================
 
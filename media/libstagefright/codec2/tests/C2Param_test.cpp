@@ -2138,6 +2138,8 @@ TEST_F(C2ParamTest, FlexParamOpsTest) {
 #include <util/C2ParamUtils.h>
 #include <C2Config.h>
 #include <C2Component.h>
+#include <algorithm>
+#include <chrono>
 #include <unordered_map>
 
 namespace android {
@@ -2684,4 +2686,110 @@ TEST_F(C2ParamTest, C2ValueTest) {
     EXPECT_EQ(15.25f, fp);
 }
 
+typedef C2ParamIndexTable<
+        C2PortMimeConfig::input, C2PortMimeConfig::output, C2ComponentDomainInfo,
+        C2VideoSizeStreamInfo::output, C2VideoConfigPortTuning::input,
+        C2VideoConfigPortTuning::output, C2ComponentLatencyInfo, C2PortLatencyInfo::output>
+        C2TestParamIndexTable;
+
+// the table is usable at compile time
+static_assert(C2TestParamIndexTable::find(C2ComponentDomainInfo::typeIndex) == 2,
+              "unexpected slot for C2ComponentDomainInfo");
+
+TEST_F(C2ParamTest, ParamIndexTableTest) {
+    typedef C2TestParamIndexTable Table;
+    EXPECT_EQ(8u, (size_t)Table::size);
+
+    EXPECT_EQ(0, Table::find(C2PortMimeConfig::input::typeIndex));
+    EXPECT_EQ(1, Table::find(C2PortMimeConfig::output::typeIndex));
+    EXPECT_EQ(2, Table::find(C2ComponentDomainInfo::typeIndex));
+    EXPECT_EQ(4, Table::find(C2VideoConfigPortTuning::input::typeIndex));
+    EXPECT_EQ(5, Table::find(C2VideoConfigPortTuning::output::typeIndex));
+    EXPECT_EQ(6, Table::find(C2ComponentLatencyInfo::typeIndex));
+    EXPECT_EQ(7, Table::find(C2PortLatencyInfo::output::typeIndex));
+
+    // stream parameters are found by type regardless of the stream
+    C2VideoSizeStreamInfo::output size0(0u);
+    C2VideoSizeStreamInfo::output size1(1u);
+    EXPECT_EQ(3, Table::find(size0.type()));
+    EXPECT_EQ(3, Table::find(size1.type()));
+
+    EXPECT_EQ(-1, Table::find(C2PortLatencyInfo::input::typeIndex));
+    EXPECT_EQ(-1, Table::find(C2VideoSizeStreamInfo::input::typeIndex));
+    EXPECT_EQ(-1, Table::find(0u));
+}
+
+TEST_F(C2ParamTest, ParamIndexTablePerfTest) {
+    typedef C2TestParamIndexTable Table;
+    const std::vector<uint32_t> types = {
+        C2PortMimeConfig::input::typeIndex, C2PortMimeConfig::output::typeIndex,
+        C2ComponentDomainInfo::typeIndex, C2VideoSizeStreamInfo::output::typeIndex,
+        C2VideoConfigPortTuning::input::typeIndex, C2VideoConfigPortTuning::output::typeIndex,
+        C2ComponentLatencyInfo::typeIndex, C2PortLatencyInfo::output::typeIndex,
+    };
+    // a mix of present and missing parameters, as in a per-frame query
+    const std::vector<uint32_t> queries = {
+        C2PortLatencyInfo::output::typeIndex, C2VideoSizeStreamInfo::output::typeIndex,
+        C2PortLatencyInfo::input::typeIndex, C2ComponentLatencyInfo::typeIndex,
+    };
+    const int kIterations = 100000;
+
+    // linear search over the supported types, which is what components do without a table
+    int64_t linearSum = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        for (uint32_t query : queries) {
+            auto it = std::find(types.begin(), types.end(), query);
+            linearSum += it == types.end() ? -1 : it - types.begin();
+        }
+    }
+    std::chrono::nanoseconds linearNs = std::chrono::steady_clock::now() - start;
+
+    int64_t tableSum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        for (uint32_t query : queries) {
+            tableSum += Table::find(query);
+        }
+    }
+    std::chrono::nanoseconds tableNs = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(linearSum, tableSum);
+    RecordProperty("linearNsPerLookup",
+                   (int)(linearNs.count() / (kIterations * (int64_t)queries.size())));
+    RecordProperty("tableNsPerLookup",
+                   (int)(tableNs.count() / (kIterations * (int64_t)queries.size())));
+}
+
+class CountingReflector : public MyReflector {
+public:
+    CountingReflector() : mCalls(0) { }
+
+    virtual std::unique_ptr<C2StructDescriptor> describe(C2Param::BaseIndex paramType) override {
+        ++mCalls;
+        return MyReflector::describe(paramType);
+    }
+
+    int mCalls;
+};
+
+TEST_F(C2ParamTest, ReflectorCacheTest) {
+    std::shared_ptr<CountingReflector> reflector = std::make_shared<CountingReflector>();
+    C2ParamReflectorCache cache(reflector);
+
+    const C2StructDescriptor *desc = cache.describe(C2VideoConfigPortTuning::output::typeIndex);
+    ASSERT_NE(nullptr, desc);
+    EXPECT_EQ(C2VideoConfigPortTuning::baseIndex, desc->baseIndex().baseIndex());
+    EXPECT_EQ(4u, desc->numFields());
+
+    // the input and output params share the structure and the description
+    EXPECT_EQ(desc, cache.describe(C2VideoConfigPortTuning::input::typeIndex));
+    EXPECT_EQ(1, reflector->mCalls);
+
+    // unsupported structures are remembered too
+    EXPECT_EQ(nullptr, cache.describe(C2ComponentDomainInfo::typeIndex));
+    EXPECT_EQ(nullptr, cache.describe(C2ComponentDomainInfo::typeIndex));
+    EXPECT_EQ(2, reflector->mCalls);
+}
+
 } // namespace android
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the per-frame cost on the component thread of creating a work item and returning it
+// to the client, with frames paced at 240 fps. Compares freshly allocated work delivered one
+// item per callback against pooled work delivered in coalesced batches.
+
+#include <benchmark/benchmark.h>
+
+#include <C2WorkUtils.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace android;
+
+namespace {
+
+const std::chrono::nanoseconds kFrameInterval(1000000000ll / 240);
+const int kFrames = 240 * 2;
+const size_t kMaxBatch = 8;
+
+// Takes finished work back into the pool, as a client would after reading it.
+class RecyclingListener : public C2ComponentListener {
+public:
+    explicit RecyclingListener(C2WorkPool *pool) : mPool(pool) {}
+
+    virtual void onWorkDone(std::weak_ptr<C2Component>,
+                            std::vector<std::unique_ptr<C2Work>> workItems) override {
+        if (mPool != nullptr) {
+            for (std::unique_ptr<C2Work> &work : workItems) {
+                mPool->put(std::move(work));
+            }
+        }
+    }
+
+    virtual void onTripped(std::weak_ptr<C2Component>,
+                           std::vector<std::shared_ptr<C2SettingResult>>) override {
+    }
+
+    virtual void onError(std::weak_ptr<C2Component>, uint32_t) override {
+    }
+
+private:
+    C2WorkPool *mPool;
+};
+
+}  // namespace
+
+static void BM_WorkPerFrame(benchmark::State &state, bool pooled, nsecs_t maxLatencyNs) {
+    C2WorkPool pool(16);
+    std::shared_ptr<RecyclingListener> listener =
+        std::make_shared<RecyclingListener>(pooled ? &pool : nullptr);
+    C2WorkDoneBatcher batcher(listener, std::weak_ptr<C2Component>(), maxLatencyNs, kMaxBatch);
+
+    uint64_t frameIndex = 0;
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    while (state.KeepRunning()) {
+        std::this_thread::sleep_until(next);
+        next += kFrameInterval;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::unique_ptr<C2Work> work;
+        if (pooled) {
+            work = pool.get(1);
+        } else {
+            work.reset(new C2Work());
+            work->worklets.emplace_back(new C2Worklet());
+        }
+        work->input.ordinal.frame_index = frameIndex++;
+        work->input.buffers.resize(1);
+        work->worklets.front()->output.buffers.resize(1);
+        batcher.onWorkDone(std::move(work));
+        state.SetIterationTime(std::chrono::duration_cast<std::chrono::duration<double>>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+    batcher.flush();
+}
+BENCHMARK_CAPTURE(BM_WorkPerFrame, fresh_unbatched, false, 0)
+        ->Iterations(kFrames)->UseManualTime();
+BENCHMARK_CAPTURE(BM_WorkPerFrame, pooled_unbatched, true, 0)
+        ->Iterations(kFrames)->UseManualTime();
+BENCHMARK_CAPTURE(BM_WorkPerFrame, pooled_batched, true, kFrameInterval.count() * 4)
+        ->Iterations(kFrames)->UseManualTime();
+
+BENCHMARK_MAIN();
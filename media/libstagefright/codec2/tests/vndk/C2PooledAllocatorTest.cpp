@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <C2PooledAllocator.h>
+
+/** \file
+ * Tests for vndk/C2PooledAllocator.
+ */
+
+namespace android {
+
+namespace {
+
+class TestLinearAllocation : public C2LinearAllocation {
+public:
+    TestLinearAllocation(uint32_t capacity, int *live)
+        : C2LinearAllocation(capacity), mLive(live) {
+        ++*mLive;
+    }
+
+    virtual ~TestLinearAllocation() override {
+        --*mLive;
+    }
+
+    virtual C2Error map(
+            size_t, size_t, C2MemoryUsage, int *, void **addr) override {
+        *addr = nullptr;
+        return C2_UNSUPPORTED;
+    }
+
+    virtual C2Error unmap(void *, size_t, int *) override {
+        return C2_UNSUPPORTED;
+    }
+
+    virtual bool isValid() const override {
+        return true;
+    }
+
+    virtual const C2Handle *handle() const override {
+        return nullptr;
+    }
+
+    virtual bool equals(const std::shared_ptr<C2LinearAllocation> &other) const override {
+        return other.get() == this;
+    }
+
+private:
+    int *mLive;
+};
+
+class TestAllocator : public C2Allocator {
+public:
+    TestAllocator() : mAllocated(0), mLive(0) {}
+
+    virtual C2Error allocateLinearBuffer(
+            uint32_t capacity, C2MemoryUsage,
+            std::shared_ptr<C2LinearAllocation> *allocation) override {
+        ++mAllocated;
+        *allocation = std::make_shared<TestLinearAllocation>(capacity, &mLive);
+        return C2_OK;
+    }
+
+    int mAllocated;
+    int mLive;
+};
+
+const C2MemoryUsage kUsage = { C2MemoryUsage::kSoftwareRead, C2MemoryUsage::kSoftwareWrite };
+
+} // namespace
+
+TEST(C2PooledAllocatorTest, RecyclesLinearAllocationsBySizeClass) {
+    std::shared_ptr<TestAllocator> base = std::make_shared<TestAllocator>();
+    C2PooledAllocator pool(base, 1 << 20, 0);
+
+    std::shared_ptr<C2LinearAllocation> first;
+    ASSERT_EQ(C2_OK, pool.allocateLinearBuffer(5000, kUsage, &first));
+    EXPECT_EQ(8192u, first->capacity());
+    C2LinearAllocation *raw = first.get();
+
+    // a copy keeps the allocation out of the pool
+    std::shared_ptr<C2LinearAllocation> copy = first;
+    first.reset();
+    EXPECT_EQ(0u, pool.getStats().mCachedLinearBytes);
+    copy.reset();
+    EXPECT_EQ(8192u, pool.getStats().mCachedLinearBytes);
+
+    std::shared_ptr<C2LinearAllocation> second;
+    ASSERT_EQ(C2_OK, pool.allocateLinearBuffer(6000, kUsage, &second));
+    EXPECT_EQ(raw, second.get());
+    EXPECT_EQ(1, base->mAllocated);
+
+    // a different size class is a new allocation
+    std::shared_ptr<C2LinearAllocation> third;
+    ASSERT_EQ(C2_OK, pool.allocateLinearBuffer(100, kUsage, &third));
+    EXPECT_EQ(4096u, third->capacity());
+    EXPECT_EQ(2, base->mAllocated);
+
+    C2PooledAllocator::Stats stats = pool.getStats();
+    EXPECT_EQ(1u, stats.mHits);
+    EXPECT_EQ(2u, stats.mMisses);
+}
+
+TEST(C2PooledAllocatorTest, LimitsCachedBytes) {
+    std::shared_ptr<TestAllocator> base = std::make_shared<TestAllocator>();
+    C2PooledAllocator pool(base, 8192, 0);
+
+    std::shared_ptr<C2LinearAllocation> a, b;
+    ASSERT_EQ(C2_OK, pool.allocateLinearBuffer(8192, kUsage, &a));
+    ASSERT_EQ(C2_OK, pool.allocateLinearBuffer(8192, kUsage, &b));
+    a.reset();
+    b.reset();
+    EXPECT_EQ(8192u, pool.getStats().mCachedLinearBytes);
+    EXPECT_EQ(1, base->mLive);
+
+    pool.clear();
+    EXPECT_EQ(0u, pool.getStats().mCachedLinearBytes);
+    EXPECT_EQ(0, base->mLive);
+}
+
+TEST(C2PooledAllocatorTest, AllocationsOutliveThePool) {
+    std::shared_ptr<TestAllocator> base = std::make_shared<TestAllocator>();
+    std::shared_ptr<C2LinearAllocation> alloc;
+    {
+        C2PooledAllocator pool(base, 1 << 20, 0);
+        ASSERT_EQ(C2_OK, pool.allocateLinearBuffer(4096, kUsage, &alloc));
+    }
+    EXPECT_EQ(1, base->mLive);
+    alloc.reset();
+    EXPECT_EQ(0, base->mLive);
+}
+
+} // namespace android
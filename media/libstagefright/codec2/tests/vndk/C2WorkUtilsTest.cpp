@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <C2WorkUtils.h>
+
+#include <chrono>
+
+/** \file
+ * Tests for vndk/C2WorkUtils.
+ */
+
+namespace android {
+
+namespace {
+
+class TestListener : public C2ComponentListener {
+public:
+    virtual void onWorkDone(std::weak_ptr<C2Component>,
+                            std::vector<std::unique_ptr<C2Work>> workItems) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        mBatchSizes.push_back(workItems.size());
+        for (const std::unique_ptr<C2Work> &work : workItems) {
+            mFrameIndices.push_back(work->input.ordinal.frame_index);
+        }
+        mCond.notify_all();
+    }
+
+    virtual void onTripped(std::weak_ptr<C2Component>,
+                           std::vector<std::shared_ptr<C2SettingResult>>) override {
+    }
+
+    virtual void onError(std::weak_ptr<C2Component>, uint32_t) override {
+    }
+
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::vector<size_t> mBatchSizes;
+    std::vector<uint64_t> mFrameIndices;
+};
+
+std::unique_ptr<C2Work> makeWork(uint64_t frameIndex) {
+    std::unique_ptr<C2Work> work(new C2Work());
+    work->input.ordinal.frame_index = frameIndex;
+    return work;
+}
+
+} // namespace
+
+TEST(C2WorkPoolTest, ReusesAndResetsWork) {
+    C2WorkPool pool(4);
+
+    std::unique_ptr<C2Work> work = pool.get(2);
+    ASSERT_EQ(2u, work->worklets.size());
+    C2Work *raw = work.get();
+    work->input.ordinal.frame_index = 7;
+    work->input.buffers.resize(3);
+    work->worklets.front()->component = 5;
+    work->worklets_processed = 2;
+    pool.put(std::move(work));
+
+    work = pool.get(1);
+    EXPECT_EQ(raw, work.get());
+    ASSERT_EQ(1u, work->worklets.size());
+    EXPECT_EQ(0u, work->input.ordinal.frame_index);
+    EXPECT_TRUE(work->input.buffers.empty());
+    EXPECT_EQ(0u, work->worklets.front()->component);
+    EXPECT_EQ(0u, work->worklets_processed);
+}
+
+TEST(C2WorkDoneBatcherTest, DeliversFullBatches) {
+    std::shared_ptr<TestListener> listener = std::make_shared<TestListener>();
+    {
+        C2WorkDoneBatcher batcher(listener, std::weak_ptr<C2Component>(),
+                1000000000ll /* 1s */, 3);
+        for (uint64_t i = 0; i < 7; ++i) {
+            batcher.onWorkDone(makeWork(i));
+        }
+        {
+            std::lock_guard<std::mutex> lock(listener->mLock);
+            EXPECT_EQ(std::vector<size_t>({ 3, 3 }), listener->mBatchSizes);
+        }
+        batcher.flush();
+    }
+    EXPECT_EQ(std::vector<size_t>({ 3, 3, 1 }), listener->mBatchSizes);
+    EXPECT_EQ(std::vector<uint64_t>({ 0, 1, 2, 3, 4, 5, 6 }), listener->mFrameIndices);
+}
+
+TEST(C2WorkDoneBatcherTest, DeliversAfterLatency) {
+    std::shared_ptr<TestListener> listener = std::make_shared<TestListener>();
+    C2WorkDoneBatcher batcher(listener, std::weak_ptr<C2Component>(),
+            5000000ll /* 5ms */, 100);
+    batcher.onWorkDone(makeWork(0));
+    batcher.onWorkDone(makeWork(1));
+
+    std::unique_lock<std::mutex> lock(listener->mLock);
+    ASSERT_TRUE(listener->mCond.wait_for(lock, std::chrono::seconds(1),
+            [&listener] { return !listener->mFrameIndices.empty(); }));
+    EXPECT_EQ(std::vector<size_t>({ 2 }), listener->mBatchSizes);
+}
+
+TEST(C2WorkDoneBatcherTest, DeliversRightAwayWithoutLatency) {
+    std::shared_ptr<TestListener> listener = std::make_shared<TestListener>();
+    C2WorkDoneBatcher batcher(listener, std::weak_ptr<C2Component>(), 0, 100);
+    batcher.onWorkDone(makeWork(0));
+    batcher.onWorkDone(makeWork(1));
+    EXPECT_EQ(std::vector<size_t>({ 1, 1 }), listener->mBatchSizes);
+}
+
+} // namespace android
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <C2PooledAllocator.h>
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace android {
+
+namespace {
+
+uint32_t linearSizeClass(uint32_t capacity) {
+    uint32_t sizeClass = C2PooledAllocator::kMinLinearCapacity;
+    while (sizeClass < capacity) {
+        sizeClass <<= 1;
+    }
+    return sizeClass;
+}
+
+} // namespace
+
+class C2PooledAllocator::Impl : public std::enable_shared_from_this<Impl> {
+public:
+    Impl(const std::shared_ptr<C2Allocator> &allocator,
+            size_t maxLinearBytes, size_t maxGraphicCount)
+        : mAllocator(allocator),
+          mMaxLinearBytes(maxLinearBytes),
+          mMaxGraphicCount(maxGraphicCount),
+          mHits(0),
+          mMisses(0),
+          mCachedLinearBytes(0) {
+    }
+
+    C2Error allocateLinearBuffer(
+            uint32_t capacity, C2MemoryUsage usage,
+            std::shared_ptr<C2LinearAllocation> *allocation) {
+        if (capacity > kMaxLinearCapacity) {
+            return mAllocator->allocateLinearBuffer(capacity, usage, allocation);
+        }
+
+        LinearKey key(linearSizeClass(capacity), usage.mConsumer, usage.mProducer);
+        std::shared_ptr<C2LinearAllocation> alloc;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            auto it = mLinear.find(key);
+            if (it != mLinear.end() && !it->second.empty()) {
+                alloc = std::move(it->second.front());
+                it->second.pop_front();
+                mCachedLinearBytes -= std::get<0>(key);
+                ++mHits;
+            } else {
+                ++mMisses;
+            }
+        }
+        if (alloc == nullptr) {
+            C2Error err = mAllocator->allocateLinearBuffer(std::get<0>(key), usage, &alloc);
+            if (err != C2_OK) {
+                *allocation = nullptr;
+                return err;
+            }
+        }
+
+        // Hand out a reference that returns the allocation to the pool when the last copy of it
+        // is released, instead of freeing it.
+        std::weak_ptr<Impl> weakImpl = shared_from_this();
+        C2LinearAllocation *raw = alloc.get();
+        *allocation = std::shared_ptr<C2LinearAllocation>(
+                raw, [weakImpl, key, alloc](C2LinearAllocation *) mutable {
+                    std::shared_ptr<Impl> impl = weakImpl.lock();
+                    if (impl != nullptr) {
+                        impl->recycleLinear(key, std::move(alloc));
+                    }
+                });
+        return C2_OK;
+    }
+
+    C2Error allocateGraphicBuffer(
+            uint32_t width, uint32_t height, uint32_t format, C2MemoryUsage usage,
+            std::shared_ptr<C2GraphicAllocation> *allocation) {
+        GraphicKey key(width, height, format, usage.mConsumer, usage.mProducer);
+        std::shared_ptr<C2GraphicAllocation> alloc;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            for (auto it = mGraphic.begin(); it != mGraphic.end(); ++it) {
+                if (it->first == key) {
+                    alloc = std::move(it->second);
+                    mGraphic.erase(it);
+                    ++mHits;
+                    break;
+                }
+            }
+            if (alloc == nullptr) {
+                ++mMisses;
+            }
+        }
+        if (alloc == nullptr) {
+            C2Error err = mAllocator->allocateGraphicBuffer(
+                    width, height, format, usage, &alloc);
+            if (err != C2_OK) {
+                *allocation = nullptr;
+                return err;
+            }
+        }
+
+        std::weak_ptr<Impl> weakImpl = shared_from_this();
+        C2GraphicAllocation *raw = alloc.get();
+        *allocation = std::shared_ptr<C2GraphicAllocation>(
+                raw, [weakImpl, key, alloc](C2GraphicAllocation *) mutable {
+                    std::shared_ptr<Impl> impl = weakImpl.lock();
+                    if (impl != nullptr) {
+                        impl->recycleGraphic(key, std::move(alloc));
+                    }
+                });
+        return C2_OK;
+    }
+
+    void clear() {
+        // free outside of the lock
+        std::map<LinearKey, std::list<std::shared_ptr<C2LinearAllocation>>> linear;
+        std::list<std::pair<GraphicKey, std::shared_ptr<C2GraphicAllocation>>> graphic;
+        std::lock_guard<std::mutex> lock(mLock);
+        linear.swap(mLinear);
+        graphic.swap(mGraphic);
+        mCachedLinearBytes = 0;
+    }
+
+    Stats getStats() const {
+        std::lock_guard<std::mutex> lock(mLock);
+        return Stats{ mHits, mMisses, mCachedLinearBytes, mGraphic.size() };
+    }
+
+    const std::shared_ptr<C2Allocator> mAllocator;
+
+private:
+    // size class, consumer usage, producer usage
+    typedef std::tuple<uint32_t, uint64_t, uint64_t> LinearKey;
+    // width, height, format, consumer usage, producer usage
+    typedef std::tuple<uint32_t, uint32_t, uint32_t, uint64_t, uint64_t> GraphicKey;
+
+    void recycleLinear(const LinearKey &key, std::shared_ptr<C2LinearAllocation> alloc) {
+        std::lock_guard<std::mutex> lock(mLock);
+        size_t size = std::get<0>(key);
+        if (mCachedLinearBytes + size > mMaxLinearBytes) {
+            // |alloc| is freed once the lock is released
+            return;
+        }
+        mLinear[key].push_back(std::move(alloc));
+        mCachedLinearBytes += size;
+    }
+
+    void recycleGraphic(const GraphicKey &key, std::shared_ptr<C2GraphicAllocation> alloc) {
+        std::shared_ptr<C2GraphicAllocation> evicted;
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mMaxGraphicCount == 0) {
+            return;
+        }
+        if (mGraphic.size() >= mMaxGraphicCount) {
+            // evict the allocation that has been unused the longest
+            evicted = std::move(mGraphic.front().second);
+            mGraphic.pop_front();
+        }
+        mGraphic.emplace_back(key, std::move(alloc));
+    }
+
+    mutable std::mutex mLock;
+    const size_t mMaxLinearBytes;
+    const size_t mMaxGraphicCount;
+    uint64_t mHits;
+    uint64_t mMisses;
+    size_t mCachedLinearBytes;
+    std::map<LinearKey, std::list<std::shared_ptr<C2LinearAllocation>>> mLinear;
+    std::list<std::pair<GraphicKey, std::shared_ptr<C2GraphicAllocation>>> mGraphic;
+};
+
+C2PooledAllocator::C2PooledAllocator(
+        const std::shared_ptr<C2Allocator> &allocator,
+        size_t maxLinearBytes, size_t maxGraphicCount)
+    : mImpl(std::make_shared<Impl>(allocator, maxLinearBytes, maxGraphicCount)) {
+}
+
+C2PooledAllocator::~C2PooledAllocator() {
+}
+
+C2Error C2PooledAllocator::allocateLinearBuffer(
+        uint32_t capacity, C2MemoryUsage usage,
+        std::shared_ptr<C2LinearAllocation> *allocation) {
+    return mImpl->allocateLinearBuffer(capacity, usage, allocation);
+}
+
+C2Error C2PooledAllocator::recreateLinearBuffer(
+        const C2Handle *handle, std::shared_ptr<C2LinearAllocation> *allocation) {
+    return mImpl->mAllocator->recreateLinearBuffer(handle, allocation);
+}
+
+C2Error C2PooledAllocator::allocateGraphicBuffer(
+        uint32_t width, uint32_t height, uint32_t format, C2MemoryUsage usage,
+        std::shared_ptr<C2GraphicAllocation> *allocation) {
+    return mImpl->allocateGraphicBuffer(width, height, format, usage, allocation);
+}
+
+C2Error C2PooledAllocator::recreateGraphicBuffer(
+        const C2Handle *handle, std::shared_ptr<C2GraphicAllocation> *allocation) {
+    return mImpl->mAllocator->recreateGraphicBuffer(handle, allocation);
+}
+
+void C2PooledAllocator::clear() {
+    mImpl->clear();
+}
+
+C2PooledAllocator::Stats C2PooledAllocator::getStats() const {
+    return mImpl->getStats();
+}
+
+} // namespace android
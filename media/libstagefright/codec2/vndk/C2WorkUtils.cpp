@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <C2WorkUtils.h>
+
+#include <chrono>
+
+namespace android {
+
+namespace {
+
+nsecs_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+/* --------------------------------------- C2WorkPool --------------------------------------- */
+
+C2WorkPool::C2WorkPool(size_t maxPooled)
+    : mMaxPooled(maxPooled) {
+}
+
+std::unique_ptr<C2Work> C2WorkPool::get(size_t numWorklets) {
+    std::unique_ptr<C2Work> work;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (!mFree.empty()) {
+            work = std::move(mFree.back());
+            mFree.pop_back();
+        }
+    }
+    if (work == nullptr) {
+        work.reset(new C2Work());
+    }
+    while (work->worklets.size() < numWorklets) {
+        work->worklets.emplace_back(new C2Worklet());
+    }
+    while (work->worklets.size() > numWorklets) {
+        work->worklets.pop_back();
+    }
+    return work;
+}
+
+void C2WorkPool::put(std::unique_ptr<C2Work> work) {
+    if (work == nullptr) {
+        return;
+    }
+    Reset(work.get());
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mFree.size() < mMaxPooled) {
+        mFree.push_back(std::move(work));
+    }
+}
+
+// static
+void C2WorkPool::Reset(C2Work *work) {
+    work->preChainInfos.clear();
+    work->preChainInfoBlobs.clear();
+    Reset(&work->input);
+    for (const std::unique_ptr<C2Worklet> &worklet : work->worklets) {
+        Reset(worklet.get());
+    }
+    work->worklets_processed = 0;
+    work->result = OK;
+}
+
+// static
+void C2WorkPool::Reset(C2Worklet *worklet) {
+    worklet->component = 0;
+    worklet->tunings.clear();
+    worklet->requestedInfos.clear();
+    worklet->allocators.clear();
+    Reset(&worklet->output);
+    worklet->failures.clear();
+}
+
+// static
+void C2WorkPool::Reset(C2BufferPack *pack) {
+    // clear() keeps the capacity of the buffer vector
+    pack->flags = (flags_t)0;
+    pack->ordinal.timestamp = 0;
+    pack->ordinal.frame_index = 0;
+    pack->ordinal.custom_ordinal = 0;
+    pack->buffers.clear();
+    pack->infos.clear();
+    pack->infoBuffers.clear();
+}
+
+/* ------------------------------------ C2WorkDoneBatcher ------------------------------------ */
+
+C2WorkDoneBatcher::C2WorkDoneBatcher(
+        const std::shared_ptr<C2ComponentListener> &listener,
+        const std::weak_ptr<C2Component> &component,
+        nsecs_t maxLatencyNs, size_t maxBatch)
+    : mListener(listener),
+      mComponent(component),
+      mMaxLatencyNs(maxLatencyNs),
+      mMaxBatch(maxBatch),
+      mOldestPendingNs(0),
+      mStopping(false) {
+    if (mMaxLatencyNs > 0) {
+        mThread = std::thread(&C2WorkDoneBatcher::threadLoop, this);
+    }
+}
+
+C2WorkDoneBatcher::~C2WorkDoneBatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopping = true;
+    }
+    mCond.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+    flush();
+}
+
+void C2WorkDoneBatcher::onWorkDone(std::unique_ptr<C2Work> work) {
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mPending.empty()) {
+            mOldestPendingNs = now();
+            mCond.notify_one();
+        }
+        mPending.push_back(std::move(work));
+        full = mMaxLatencyNs <= 0 || mPending.size() >= mMaxBatch;
+    }
+    if (full) {
+        deliver();
+    }
+}
+
+void C2WorkDoneBatcher::flush() {
+    deliver();
+}
+
+void C2WorkDoneBatcher::deliver() {
+    // Take the pending items only once it is our turn, so that a batch cannot overtake the one
+    // before it.
+    std::lock_guard<std::mutex> deliverLock(mDeliverLock);
+    std::vector<std::unique_ptr<C2Work>> items;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        items.swap(mPending);
+    }
+    if (!items.empty()) {
+        mListener->onWorkDone(mComponent, std::move(items));
+    }
+}
+
+void C2WorkDoneBatcher::threadLoop() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (!mStopping) {
+        if (mPending.empty()) {
+            mCond.wait(lock);
+            continue;
+        }
+        nsecs_t waitNs = mOldestPendingNs + mMaxLatencyNs - now();
+        if (waitNs > 0) {
+            mCond.wait_for(lock, std::chrono::nanoseconds(waitNs));
+            continue;
+        }
+        lock.unlock();
+        deliver();
+        lock.lock();
+    }
+}
+
+} // namespace android
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef C2_POOLED_ALLOCATOR_H_
+#define C2_POOLED_ALLOCATOR_H_
+
+#include <C2Buffer.h>
+
+#include <memory>
+
+/** \file
+ * Allocator that recycles the allocations of another allocator.
+ */
+
+namespace android {
+
+/**
+ * An allocator that keeps the allocations of an underlying allocator when they are released,
+ * and hands them out again for later requests of the same kind.
+ *
+ * Linear allocations are rounded up to power-of-two size classes (at least kMinLinearCapacity)
+ * so that requests of slightly different sizes, e.g. of compressed frames, share allocations.
+ * An allocation returns to the pool when the last reference to it goes away, i.e. when the last
+ * block or buffer carved out of it is destroyed. Graphic allocations are only reused for the
+ * exact same dimensions, format and usage.
+ *
+ * Recycled allocations are not cleared.
+ *
+ * Allocations that are recreated from handles are not pooled.
+ *
+ * This class is thread-safe. Allocations may outlive the pool; they are then freed on release.
+ */
+class C2PooledAllocator : public C2Allocator {
+public:
+    enum : uint32_t {
+        kMinLinearCapacity    = 4096,
+        kMaxLinearCapacity    = 1u << 24, ///< larger linear allocations are not pooled
+    };
+
+    struct Stats {
+        uint64_t mHits;             ///< allocations served from the pool
+        uint64_t mMisses;           ///< allocations made by the underlying allocator
+        size_t mCachedLinearBytes;  ///< bytes in linear allocations held by the pool
+        size_t mCachedGraphicCount; ///< graphic allocations held by the pool
+    };
+
+    /**
+     * Creates a pool on top of |allocator|.
+     *
+     * \param allocator       the allocator that makes new allocations
+     * \param maxLinearBytes  the most bytes of unused linear allocations to keep
+     * \param maxGraphicCount the most unused graphic allocations to keep
+     */
+    C2PooledAllocator(
+            const std::shared_ptr<C2Allocator> &allocator,
+            size_t maxLinearBytes, size_t maxGraphicCount);
+
+    virtual ~C2PooledAllocator() override;
+
+    virtual C2Error allocateLinearBuffer(
+            uint32_t capacity, C2MemoryUsage usage,
+            std::shared_ptr<C2LinearAllocation> *allocation /* nonnull */) override;
+
+    virtual C2Error recreateLinearBuffer(
+            const C2Handle *handle,
+            std::shared_ptr<C2LinearAllocation> *allocation /* nonnull */) override;
+
+    virtual C2Error allocateGraphicBuffer(
+            uint32_t width, uint32_t height, uint32_t format, C2MemoryUsage usage,
+            std::shared_ptr<C2GraphicAllocation> *allocation /* nonnull */) override;
+
+    virtual C2Error recreateGraphicBuffer(
+            const C2Handle *handle,
+            std::shared_ptr<C2GraphicAllocation> *allocation /* nonnull */) override;
+
+    /**
+     * Frees all unused allocations held by the pool.
+     */
+    void clear();
+
+    Stats getStats() const;
+
+private:
+    class Impl;
+    std::shared_ptr<Impl> mImpl;
+};
+
+} // namespace android
+
+#endif // C2_POOLED_ALLOCATOR_H_
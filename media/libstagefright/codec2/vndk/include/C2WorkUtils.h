@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef C2_WORK_UTILS_H_
+#define C2_WORK_UTILS_H_
+
+#include <C2Component.h>
+#include <C2Work.h>
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** \file
+ * Utilities for passing work between clients and Codec2 components.
+ */
+
+namespace android {
+
+/**
+ * A free list of work items.
+ *
+ * Clients get work items from the pool to queue, and put the items the component returns back
+ * into it, so that the work items, their worklets and the capacity of their buffer vectors are
+ * reused from frame to frame.
+ *
+ * This class is thread-safe.
+ */
+class C2WorkPool {
+public:
+    /**
+     * \param maxPooled   the most unused work items to keep
+     */
+    explicit C2WorkPool(size_t maxPooled);
+
+    /**
+     * Returns a work item with |numWorklets| worklets. All fields are cleared, as for a newly
+     * created work item.
+     */
+    std::unique_ptr<C2Work> get(size_t numWorklets);
+
+    /**
+     * Returns |work| to the pool. References to buffers, infos and parameters held by the work
+     * are released right away.
+     */
+    void put(std::unique_ptr<C2Work> work);
+
+private:
+    static void Reset(C2Work *work);
+    static void Reset(C2Worklet *worklet);
+    static void Reset(C2BufferPack *pack);
+
+    const size_t mMaxPooled;
+    std::mutex mLock;
+    std::vector<std::unique_ptr<C2Work>> mFree;
+};
+
+/**
+ * Coalesces finished work items into fewer onWorkDone() callbacks.
+ *
+ * Components hand each finished work item to the batcher instead of calling the listener. The
+ * listener gets the items in the order they finished, once |maxBatch| items are pending or the
+ * oldest pending item has waited |maxLatencyNs|, whichever comes first. A latency of 0 delivers
+ * every item at once on the calling thread.
+ *
+ * Components must call flush() when they complete a drain or flush, so that no work is held back.
+ * The listener must not finish work of the same batcher from within onWorkDone().
+ *
+ * This class is thread-safe.
+ */
+class C2WorkDoneBatcher {
+public:
+    C2WorkDoneBatcher(
+            const std::shared_ptr<C2ComponentListener> &listener,
+            const std::weak_ptr<C2Component> &component,
+            nsecs_t maxLatencyNs, size_t maxBatch);
+
+    /**
+     * Delivers any pending work, and stops the delivery thread.
+     */
+    ~C2WorkDoneBatcher();
+
+    /**
+     * Queues |work| for delivery.
+     */
+    void onWorkDone(std::unique_ptr<C2Work> work);
+
+    /**
+     * Delivers all pending work now, on the calling thread.
+     */
+    void flush();
+
+private:
+    const std::shared_ptr<C2ComponentListener> mListener;
+    const std::weak_ptr<C2Component> mComponent;
+    const nsecs_t mMaxLatencyNs;
+    const size_t mMaxBatch;
+
+    // serializes the listener calls, so that batches arrive in order. Taken before mLock.
+    std::mutex mDeliverLock;
+
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::vector<std::unique_ptr<C2Work>> mPending;
+    nsecs_t mOldestPendingNs;
+    bool mStopping;
+    std::thread mThread;
+
+    void deliver();
+    void threadLoop();
+};
+
+} // namespace android
+
+#endif // C2_WORK_UTILS_H_
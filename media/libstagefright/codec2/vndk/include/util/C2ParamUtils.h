@@ -21,6 +21,9 @@
 #include <util/_C2MacroUtils.h>
 
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 
 /** \file
  * Utilities for parameter handling to be used by Codec2 implementations.
@@ -264,6 +267,131 @@ public:
 
 /* ---------------------------- UTILITIES FOR PARAMETER REFLECTION ---------------------------- */
 
+/// \cond INTERNAL
+
+/**
+ * Parameter types of a C2ParamIndexTable, sorted at compile time.
+ */
+template<size_t N>
+struct C2_HIDE _C2ParamIndexEntries {
+    uint32_t mType[N];
+    size_t mSlot[N];
+
+    template<typename... Types>
+    constexpr _C2ParamIndexEntries(Types... types) : mType{}, mSlot{} {
+        const uint32_t unsorted[N] = { (uint32_t)types... };
+        // insertion sort, as N is small and this is evaluated by the compiler
+        for (size_t i = 0; i < N; ++i) {
+            size_t j = i;
+            for (; j > 0 && mType[j - 1] > unsorted[i]; --j) {
+                mType[j] = mType[j - 1];
+                mSlot[j] = mSlot[j - 1];
+            }
+            mType[j] = unsorted[i];
+            mSlot[j] = i;
+        }
+    }
+
+    constexpr bool isUnique() const {
+        for (size_t i = 1; i < N; ++i) {
+            if (mType[i - 1] == mType[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr int find(uint32_t type) const {
+        size_t lo = 0, hi = N;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (mType[mid] < type) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo < N && mType[lo] == type ? (int)mSlot[lo] : -1;
+    }
+};
+
+/// \endcond
+
+/**
+ * A table of the parameter types a component supports, sorted by type at compile time.
+ *
+ * Each parameter type is assigned the slot of its position in |Params|, so that a component can
+ * keep its current parameter values in a fixed array and find them during config_nb() and
+ * query_nb() by binary search, without any allocation. E.g.
+ *
+ *   typedef C2ParamIndexTable<C2PortMimeConfig::input, C2PortMimeConfig::output,
+ *                             C2VideoSizeStreamInfo::output> Table;
+ *   std::unique_ptr<C2Param> mParams[Table::size];
+ *   ...
+ *   int slot = Table::find(param->type());
+ *
+ * Stream parameters share the slot of all streams, as the type does not include the stream ID.
+ */
+template<typename... Params>
+class C2_HIDE C2ParamIndexTable {
+public:
+    enum : size_t {
+        size = sizeof...(Params),
+    };
+
+    /**
+     * Returns the slot of the parameter type |type|, or -1 if it is not in the table.
+     */
+    static constexpr int find(uint32_t type) {
+        return kEntries.find(type);
+    }
+
+private:
+    static_assert(size > 0, "parameter index table must not be empty");
+
+    static constexpr _C2ParamIndexEntries<sizeof...(Params)> kEntries{ Params::typeIndex... };
+
+    static_assert(kEntries.isUnique(), "parameter index table has duplicate types");
+};
+
+template<typename... Params>
+constexpr _C2ParamIndexEntries<sizeof...(Params)> C2ParamIndexTable<Params...>::kEntries;
+
+/**
+ * Caches the struct descriptors returned by a parameter reflector.
+ *
+ * Reflectors return a newly allocated descriptor for each describe() call. Components and clients
+ * that look up the layout of parameters for each configuration can use this cache instead, which
+ * calls the reflector at most once per base index.
+ *
+ * This class is thread-safe.
+ */
+class C2_HIDE C2ParamReflectorCache {
+public:
+    explicit C2ParamReflectorCache(const std::shared_ptr<C2ParamReflector> &reflector)
+        : mReflector(reflector) { }
+
+    /**
+     * Returns the description of the parameter structure with base index |index|, or nullptr if
+     * the reflector does not support it. The description lives as long as this cache.
+     */
+    const C2StructDescriptor *describe(C2Param::BaseIndex index) {
+        std::lock_guard<std::mutex> lock(mLock);
+        uint32_t baseIndex = index.baseIndex();
+        auto it = mDescriptors.find(baseIndex);
+        if (it == mDescriptors.end()) {
+            // also remember unsupported indices
+            it = mDescriptors.emplace(baseIndex, mReflector->describe(index)).first;
+        }
+        return it->second.get();
+    }
+
+private:
+    const std::shared_ptr<C2ParamReflector> mReflector;
+    std::mutex mLock;
+    std::map<uint32_t, std::unique_ptr<C2StructDescriptor>> mDescriptors;
+};
+
 /* ======================== UTILITY TEMPLATES FOR PARAMETER REFLECTION ======================== */
 
 #if 1
@@ -44,6 +44,7 @@
 #define PROP_DRC_OVERRIDE_BOOST      "aac_drc_boost"
 #define PROP_DRC_OVERRIDE_HEAVY      "aac_drc_heavy"
 #define PROP_DRC_OVERRIDE_ENC_LEVEL "aac_drc_enc_target_level"
+#define PROP_OUTPUT_FRAMES_PER_BUFFER "media.stagefright.aacdec.output-frames"
 
 namespace android {
 
@@ -78,6 +79,7 @@ SoftAAC2::SoftAAC2(
       mOutputBufferCount(0),
       mSignalledError(false),
       mLastInHeader(NULL),
+      mOutputFramesPerBuffer(property_get_int32(PROP_OUTPUT_FRAMES_PER_BUFFER, 0)),
       mOutputPortSettingsChange(NONE) {
     initPorts();
     CHECK_EQ(initDecoder(), (status_t)OK);
@@ -543,6 +545,24 @@ int32_t SoftAAC2::outputDelayRingBufferSpaceLeft() {
 }
 
 
+// Returns the number of samples to gather in the ring buffer before an
+// output buffer is filled while more input is queued: as many frames as
+// configured, as long as they fit the output buffer and half the ring buffer.
+int32_t SoftAAC2::getOutputBatchSamples(const OMX_BUFFERHEADERTYPE *outHeader) {
+    if (mOutputFramesPerBuffer <= 0) {
+        return 0;
+    }
+    int32_t frameSamples = mStreamInfo->frameSize * mStreamInfo->numChannels;
+    int32_t numFrames = outHeader->nAllocLen / sizeof(int16_t) / frameSamples;
+    if (numFrames > mOutputFramesPerBuffer) {
+        numFrames = mOutputFramesPerBuffer;
+    }
+    if (numFrames * frameSamples > mOutputDelayRingBufferSize / 2) {
+        numFrames = mOutputDelayRingBufferSize / 2 / frameSamples;
+    }
+    return numFrames * frameSamples;
+}
+
 void SoftAAC2::onQueueFilled(OMX_U32 /* portIndex */) {
     if (mSignalledError || mOutputPortSettingsChange != NONE) {
         return;
@@ -878,7 +898,10 @@ void SoftAAC2::onQueueFilled(OMX_U32 /* portIndex */) {
 
         while (!outQueue.empty()
                 && outputDelayRingBufferSamplesAvailable()
-                        >= mStreamInfo->frameSize * mStreamInfo->numChannels) {
+                        >= mStreamInfo->frameSize * mStreamInfo->numChannels
+                && (mEndOfInput || inQueue.empty()
+                        || outputDelayRingBufferSamplesAvailable()
+                                >= getOutputBatchSamples((*outQueue.begin())->mHeader))) {
             BufferInfo *outInfo = *outQueue.begin();
             OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
 
@@ -939,6 +962,11 @@ void SoftAAC2::onQueueFilled(OMX_U32 /* portIndex */) {
                             ALOGV("moved to next time/size: %lld/%d",
                                     (long long) *nextTimeStamp, *currentBufLeft);
                         }
+                        if (mOutputFramesPerBuffer > 0 && mBufferTimestamps.size() > 0) {
+                            // batching: go on with the frames of the next input buffer,
+                            // the output buffer keeps the time stamp of its first frame
+                            continue;
+                        }
                         // try to limit output buffer size to match input buffers
                         // (e.g when an input buffer contained 4 "sub" frames, output
                         // at most 4 decoded units in the corresponding output buffer)
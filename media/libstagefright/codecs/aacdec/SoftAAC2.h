@@ -63,6 +63,10 @@ private:
     Vector<int32_t> mDecodedSizes;
     Vector<int64_t> mBufferTimestamps;
 
+    // Decoded frames to gather in an output buffer while more input is
+    // queued, instead of one input buffer's worth; 0 if off.
+    int32_t mOutputFramesPerBuffer;
+
     CDrcPresModeWrapper mDrcWrap;
 
     enum {
@@ -89,6 +93,7 @@ private:
     int32_t outputDelayRingBufferGetSamples(INT_PCM *samples, int numSamples);
     int32_t outputDelayRingBufferSamplesAvailable();
     int32_t outputDelayRingBufferSpaceLeft();
+    int32_t getOutputBatchSamples(const OMX_BUFFERHEADERTYPE *outHeader);
 
     DISALLOW_EVIL_CONSTRUCTORS(SoftAAC2);
 };
@@ -24,6 +24,7 @@
 #include "ih264d.h"
 #include "SoftAVCDec.h"
 
+#include <cutils/properties.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/MediaDefs.h>
 #include <OMX_VideoExt.h>
@@ -112,6 +113,26 @@ static size_t GetCPUCoreCount() {
     return (size_t)cpuCoreCount;
 }
 
+static const size_t kPixelsPerCore = 640 * 360;
+
+// Returns the number of cores to decode pictures of |width| x |height| on:
+// one per 640x360 worth of pixels, as more threads than that spend more
+// time synchronizing than they save, up to the cores there are. The
+// media.stagefright.avcdec.cores property overrides it if set.
+static size_t GetDecoderCoreCount(size_t width, size_t height) {
+    size_t numCores = GetCPUCoreCount();
+    int32_t cores = property_get_int32("media.stagefright.avcdec.cores", 0);
+    if (cores > 0) {
+        return MIN((size_t)cores, numCores);
+    }
+
+    size_t needed = (width * height + kPixelsPerCore - 1) / kPixelsPerCore;
+    if (needed < 1) {
+        needed = 1;
+    }
+    return MIN(needed, numCores);
+}
+
 void SoftAVC::logVersion() {
     ivd_ctl_getversioninfo_ip_t s_ctl_ip;
     ivd_ctl_getversioninfo_op_t s_ctl_op;
@@ -207,6 +228,9 @@ status_t SoftAVC::setNumCores() {
     IV_API_CALL_STATUS_T status;
     s_set_cores_ip.e_cmd = IVD_CMD_VIDEO_CTL;
     s_set_cores_ip.e_sub_cmd = IVDEXT_CMD_CTL_SET_NUM_CORES;
+    // The resolution may have changed since the decoder was created.
+    mNumCores = GetDecoderCoreCount(mWidth, mHeight);
+    ALOGV("decoding %ux%u on %zu cores", mWidth, mHeight, mNumCores);
     s_set_cores_ip.u4_num_cores = MIN(mNumCores, CODEC_MAX_NUM_CORES);
     s_set_cores_ip.u4_size = sizeof(ivdext_ctl_set_num_cores_ip_t);
     s_set_cores_op.u4_size = sizeof(ivdext_ctl_set_num_cores_op_t);
@@ -247,7 +271,7 @@ status_t SoftAVC::setFlushMode() {
 status_t SoftAVC::initDecoder() {
     IV_API_CALL_STATUS_T status;
 
-    mNumCores = GetCPUCoreCount();
+    mNumCores = GetDecoderCoreCount(mWidth, mHeight);
     mCodecCtx = NULL;
 
     mStride = outputBufferWidth();
@@ -284,13 +284,20 @@ void SoftG711::onQueueFilled(OMX_U32 /* portIndex */) {
     }
 }
 
-// static
-void SoftG711::DecodeALaw(
-        int16_t *out, const uint8_t *in, size_t inSize) {
-    while (inSize > 0) {
-        inSize--;
-        int32_t x = *in++;
+// The linear sample of each A-law and mu-law code, as G.711 expands them.
+struct G711Tables {
+    G711Tables() {
+        for (int32_t x = 0; x < 256; ++x) {
+            mALaw[x] = ALawToLinear(x);
+            mMLaw[x] = MLawToLinear(x);
+        }
+    }
+
+    int16_t mALaw[256];
+    int16_t mMLaw[256];
 
+private:
+    static int16_t ALawToLinear(int32_t x) {
         int32_t ix = x ^ 0x55;
         ix &= 0x7f;
 
@@ -307,17 +314,10 @@ void SoftG711::DecodeALaw(
             mant = mant << (iexp - 1);
         }
 
-        *out++ = (x > 127) ? mant : -mant;
+        return (x > 127) ? mant : -mant;
     }
-}
-
-// static
-void SoftG711::DecodeMLaw(
-        int16_t *out, const uint8_t *in, size_t inSize) {
-    while (inSize > 0) {
-        inSize--;
-        int32_t x = *in++;
 
+    static int16_t MLawToLinear(int32_t x) {
         int32_t mantissa = ~x;
         int32_t exponent = (mantissa >> 4) & 7;
         int32_t segment = exponent + 1;
@@ -327,10 +327,44 @@ void SoftG711::DecodeMLaw(
 
         int32_t abs = (0x80l << exponent) + step * mantissa + step / 2 - 4 * 33;
 
-        *out++ = (x < 0x80) ? -abs : abs;
+        return (x < 0x80) ? -abs : abs;
+    }
+};
+
+static const G711Tables &GetG711Tables() {
+    static const G711Tables tables;
+    return tables;
+}
+
+static void DecodeWithTable(
+        int16_t *out, const uint8_t *in, size_t inSize, const int16_t *table) {
+    while (inSize >= 4) {
+        out[0] = table[in[0]];
+        out[1] = table[in[1]];
+        out[2] = table[in[2]];
+        out[3] = table[in[3]];
+        out += 4;
+        in += 4;
+        inSize -= 4;
+    }
+    while (inSize > 0) {
+        inSize--;
+        *out++ = table[*in++];
     }
 }
 
+// static
+void SoftG711::DecodeALaw(
+        int16_t *out, const uint8_t *in, size_t inSize) {
+    DecodeWithTable(out, in, inSize, GetG711Tables().mALaw);
+}
+
+// static
+void SoftG711::DecodeMLaw(
+        int16_t *out, const uint8_t *in, size_t inSize) {
+    DecodeWithTable(out, in, inSize, GetG711Tables().mMLaw);
+}
+
 }  // namespace android
 
 android::SoftOMXComponent *createSoftOMXComponent(
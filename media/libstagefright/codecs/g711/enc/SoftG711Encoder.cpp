@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SoftG711Encoder"
+#include <utils/Log.h>
+
+#include "SoftG711Encoder.h"
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaDefs.h>
+
+namespace android {
+
+template<class T>
+static void InitOMXParams(T *params) {
+    params->nSize = sizeof(T);
+    params->nVersion.s.nVersionMajor = 1;
+    params->nVersion.s.nVersionMinor = 0;
+    params->nVersion.s.nRevision = 0;
+    params->nVersion.s.nStep = 0;
+}
+
+SoftG711Encoder::SoftG711Encoder(
+        const char *name,
+        const OMX_CALLBACKTYPE *callbacks,
+        OMX_PTR appData,
+        OMX_COMPONENTTYPE **component)
+    : SimpleSoftOMXComponent(name, callbacks, appData, component),
+      mIsMLaw(true),
+      mSignalledError(false),
+      mNumChannels(1),
+      mSamplingRate(8000) {
+    if (!strcmp(name, "OMX.google.g711.alaw.encoder")) {
+        mIsMLaw = false;
+    } else {
+        CHECK(!strcmp(name, "OMX.google.g711.mlaw.encoder"));
+    }
+
+    initPorts();
+}
+
+SoftG711Encoder::~SoftG711Encoder() {
+}
+
+void SoftG711Encoder::initPorts() {
+    OMX_PARAM_PORTDEFINITIONTYPE def;
+    InitOMXParams(&def);
+
+    def.nPortIndex = 0;
+    def.eDir = OMX_DirInput;
+    def.nBufferCountMin = kNumBuffers;
+    def.nBufferCountActual = def.nBufferCountMin;
+    def.nBufferSize = kMaxNumSamplesPerFrame * sizeof(int16_t);
+    def.bEnabled = OMX_TRUE;
+    def.bPopulated = OMX_FALSE;
+    def.eDomain = OMX_PortDomainAudio;
+    def.bBuffersContiguous = OMX_FALSE;
+    def.nBufferAlignment = 2;
+
+    def.format.audio.cMIMEType = const_cast<char *>("audio/raw");
+    def.format.audio.pNativeRender = NULL;
+    def.format.audio.bFlagErrorConcealment = OMX_FALSE;
+    def.format.audio.eEncoding = OMX_AUDIO_CodingPCM;
+
+    addPort(def);
+
+    def.nPortIndex = 1;
+    def.eDir = OMX_DirOutput;
+    def.nBufferCountMin = kNumBuffers;
+    def.nBufferCountActual = def.nBufferCountMin;
+    def.nBufferSize = kMaxNumSamplesPerFrame;
+    def.bEnabled = OMX_TRUE;
+    def.bPopulated = OMX_FALSE;
+    def.eDomain = OMX_PortDomainAudio;
+    def.bBuffersContiguous = OMX_FALSE;
+    def.nBufferAlignment = 1;
+
+    def.format.audio.cMIMEType =
+        const_cast<char *>(
+                mIsMLaw
+                    ? MEDIA_MIMETYPE_AUDIO_G711_MLAW
+                    : MEDIA_MIMETYPE_AUDIO_G711_ALAW);
+
+    def.format.audio.pNativeRender = NULL;
+    def.format.audio.bFlagErrorConcealment = OMX_FALSE;
+    def.format.audio.eEncoding = OMX_AUDIO_CodingG711;
+
+    addPort(def);
+}
+
+OMX_ERRORTYPE SoftG711Encoder::internalGetParameter(
+        OMX_INDEXTYPE index, OMX_PTR params) {
+    switch (index) {
+        case OMX_IndexParamAudioPcm:
+        {
+            OMX_AUDIO_PARAM_PCMMODETYPE *pcmParams =
+                (OMX_AUDIO_PARAM_PCMMODETYPE *)params;
+
+            if (!isValidOMXParam(pcmParams)) {
+                return OMX_ErrorBadParameter;
+            }
+
+            if (pcmParams->nPortIndex > 1) {
+                return OMX_ErrorUndefined;
+            }
+
+            pcmParams->eNumData = OMX_NumericalDataSigned;
+            pcmParams->eEndian = OMX_EndianBig;
+            pcmParams->bInterleaved = OMX_TRUE;
+            pcmParams->nBitPerSample = 16;
+            if (pcmParams->nPortIndex == 0) {
+                // input port
+                pcmParams->ePCMMode = OMX_AUDIO_PCMModeLinear;
+            } else {
+                // output port
+                pcmParams->ePCMMode = mIsMLaw ? OMX_AUDIO_PCMModeMULaw
+                                              : OMX_AUDIO_PCMModeALaw;
+            }
+            pcmParams->eChannelMapping[0] = OMX_AUDIO_ChannelLF;
+            pcmParams->eChannelMapping[1] = OMX_AUDIO_ChannelRF;
+
+            pcmParams->nChannels = mNumChannels;
+            pcmParams->nSamplingRate = mSamplingRate;
+
+            return OMX_ErrorNone;
+        }
+
+        default:
+            return SimpleSoftOMXComponent::internalGetParameter(index, params);
+    }
+}
+
+OMX_ERRORTYPE SoftG711Encoder::internalSetParameter(
+        OMX_INDEXTYPE index, const OMX_PTR params) {
+    switch (index) {
+        case OMX_IndexParamAudioPcm:
+        {
+            OMX_AUDIO_PARAM_PCMMODETYPE *pcmParams =
+                (OMX_AUDIO_PARAM_PCMMODETYPE *)params;
+
+            if (!isValidOMXParam(pcmParams)) {
+                return OMX_ErrorBadParameter;
+            }
+
+            if (pcmParams->nPortIndex != 0 && pcmParams->nPortIndex != 1) {
+                return OMX_ErrorUndefined;
+            }
+
+            if (pcmParams->nChannels < 1 || pcmParams->nChannels > 2) {
+                return OMX_ErrorUndefined;
+            }
+
+            if (pcmParams->nPortIndex == 0) {
+                mNumChannels = pcmParams->nChannels;
+            }
+
+            mSamplingRate = pcmParams->nSamplingRate;
+
+            return OMX_ErrorNone;
+        }
+
+        case OMX_IndexParamStandardComponentRole:
+        {
+            const OMX_PARAM_COMPONENTROLETYPE *roleParams =
+                (const OMX_PARAM_COMPONENTROLETYPE *)params;
+
+            if (!isValidOMXParam(roleParams)) {
+                return OMX_ErrorBadParameter;
+            }
+
+            if (strncmp((const char *)roleParams->cRole,
+                        mIsMLaw ? "audio_encoder.g711mlaw" : "audio_encoder.g711alaw",
+                        OMX_MAX_STRINGNAME_SIZE - 1)) {
+                return OMX_ErrorUndefined;
+            }
+
+            return OMX_ErrorNone;
+        }
+
+        default:
+            return SimpleSoftOMXComponent::internalSetParameter(index, params);
+    }
+}
+
+void SoftG711Encoder::onQueueFilled(OMX_U32 /* portIndex */) {
+    if (mSignalledError) {
+        return;
+    }
+
+    List<BufferInfo *> &inQueue = getPortQueue(0);
+    List<BufferInfo *> &outQueue = getPortQueue(1);
+
+    while (!inQueue.empty() && !outQueue.empty()) {
+        BufferInfo *inInfo = *inQueue.begin();
+        OMX_BUFFERHEADERTYPE *inHeader = inInfo->mHeader;
+
+        BufferInfo *outInfo = *outQueue.begin();
+        OMX_BUFFERHEADERTYPE *outHeader = outInfo->mHeader;
+
+        if ((inHeader->nFlags & OMX_BUFFERFLAG_EOS) && inHeader->nFilledLen == 0) {
+            inQueue.erase(inQueue.begin());
+            inInfo->mOwnedByUs = false;
+            notifyEmptyBufferDone(inHeader);
+
+            outHeader->nFilledLen = 0;
+            outHeader->nFlags = OMX_BUFFERFLAG_EOS;
+
+            outQueue.erase(outQueue.begin());
+            outInfo->mOwnedByUs = false;
+            notifyFillBufferDone(outHeader);
+            return;
+        }
+
+        size_t numSamples = inHeader->nFilledLen / sizeof(int16_t);
+
+        if (numSamples > outHeader->nAllocLen) {
+            ALOGE("output buffer too small (%d).", outHeader->nAllocLen);
+
+            notify(OMX_EventError, OMX_ErrorUndefined, 0, NULL);
+            mSignalledError = true;
+            return;
+        }
+
+        const int16_t *inputptr =
+            reinterpret_cast<const int16_t *>(inHeader->pBuffer + inHeader->nOffset);
+
+        if (mIsMLaw) {
+            EncodeMLaw(outHeader->pBuffer, inputptr, numSamples);
+        } else {
+            EncodeALaw(outHeader->pBuffer, inputptr, numSamples);
+        }
+
+        outHeader->nTimeStamp = inHeader->nTimeStamp;
+        outHeader->nOffset = 0;
+        outHeader->nFilledLen = numSamples;
+        outHeader->nFlags = 0;
+
+        if (inHeader->nFlags & OMX_BUFFERFLAG_EOS) {
+            inHeader->nFilledLen = 0;
+        } else {
+            inInfo->mOwnedByUs = false;
+            inQueue.erase(inQueue.begin());
+            inInfo = NULL;
+            notifyEmptyBufferDone(inHeader);
+            inHeader = NULL;
+        }
+
+        outInfo->mOwnedByUs = false;
+        outQueue.erase(outQueue.begin());
+        outInfo = NULL;
+        notifyFillBufferDone(outHeader);
+        outHeader = NULL;
+    }
+}
+
+// The code of each linear sample. A-law keeps 13 bits of a 16-bit sample
+// and mu-law 14, so the tables are indexed by the sample shifted by 3 and 2.
+struct G711EncoderTables {
+    G711EncoderTables() {
+        for (int32_t i = 0; i < 8192; ++i) {
+            mALaw[i] = LinearToALaw((int16_t)(i << 3));
+        }
+        for (int32_t i = 0; i < 16384; ++i) {
+            mMLaw[i] = LinearToMLaw((int16_t)(i << 2));
+        }
+    }
+
+    uint8_t mALaw[8192];
+    uint8_t mMLaw[16384];
+
+private:
+    // the index of the first of the 8 segment ends that |x| does not exceed
+    static int32_t Segment(int32_t x, int32_t firstEnd) {
+        int32_t seg = 0;
+        for (int32_t end = firstEnd; seg < 8 && x > end; end = (end << 1) | 1) {
+            ++seg;
+        }
+        return seg;
+    }
+
+    static uint8_t LinearToALaw(int32_t sample) {
+        int32_t x = sample >> 3;
+        int32_t mask = 0xd5;
+        if (x < 0) {
+            mask = 0x55;
+            x = -x - 1;
+        }
+
+        int32_t seg = Segment(x, 0x1f);
+        if (seg >= 8) {
+            return 0x7f ^ mask;
+        }
+
+        int32_t code = (seg << 4) | ((x >> (seg < 2 ? 1 : seg)) & 0x0f);
+        return code ^ mask;
+    }
+
+    static uint8_t LinearToMLaw(int32_t sample) {
+        int32_t x = sample >> 2;
+        int32_t mask = 0xff;
+        if (x < 0) {
+            mask = 0x7f;
+            x = -x;
+        }
+        if (x > 8159) {
+            x = 8159;
+        }
+        x += 33;
+
+        int32_t seg = Segment(x, 0x3f);
+        if (seg >= 8) {
+            return 0x7f ^ mask;
+        }
+
+        int32_t code = (seg << 4) | ((x >> (seg + 1)) & 0x0f);
+        return code ^ mask;
+    }
+};
+
+static const G711EncoderTables &GetG711EncoderTables() {
+    static const G711EncoderTables tables;
+    return tables;
+}
+
+template<int kShift>
+static void EncodeWithTable(
+        uint8_t *out, const int16_t *in, size_t numSamples, const uint8_t *table) {
+    while (numSamples >= 4) {
+        out[0] = table[(uint16_t)in[0] >> kShift];
+        out[1] = table[(uint16_t)in[1] >> kShift];
+        out[2] = table[(uint16_t)in[2] >> kShift];
+        out[3] = table[(uint16_t)in[3] >> kShift];
+        out += 4;
+        in += 4;
+        numSamples -= 4;
+    }
+    while (numSamples > 0) {
+        numSamples--;
+        *out++ = table[(uint16_t)*in++ >> kShift];
+    }
+}
+
+// static
+void SoftG711Encoder::EncodeALaw(
+        uint8_t *out, const int16_t *in, size_t numSamples) {
+    EncodeWithTable<3>(out, in, numSamples, GetG711EncoderTables().mALaw);
+}
+
+// static
+void SoftG711Encoder::EncodeMLaw(
+        uint8_t *out, const int16_t *in, size_t numSamples) {
+    EncodeWithTable<2>(out, in, numSamples, GetG711EncoderTables().mMLaw);
+}
+
+}  // namespace android
+
+android::SoftOMXComponent *createSoftOMXComponent(
+        const char *name, const OMX_CALLBACKTYPE *callbacks,
+        OMX_PTR appData, OMX_COMPONENTTYPE **component) {
+    return new android::SoftG711Encoder(name, callbacks, appData, component);
+}
@@ -23,6 +23,12 @@
 #ifndef _SAD_INLINE_H_
 #define _SAD_INLINE_H_
 
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -79,6 +85,65 @@ extern "C"
 #include "sad_mb_offset.h"
 
 
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+
+    /* 16 pixels a row with absolute difference and accumulate; stops after
+       the row that takes the SAD past dmin, as the C version does, so that
+       the motion search sees the same values. */
+    __inline int32 simd_sad_mb(UChar *ref, UChar *blk, Int dmin, Int lx)
+    {
+        uint16x8_t acc = vdupq_n_u16(0);
+        int32 sad = 0;
+        Int i;
+
+        for (i = 0; i < 16; i++)
+        {
+            uint8x16_t r = vld1q_u8(ref);
+            uint8x16_t b = vld1q_u8(blk);
+
+            acc = vabal_u8(acc, vget_low_u8(r), vget_low_u8(b));
+            acc = vabal_u8(acc, vget_high_u8(r), vget_high_u8(b));
+
+            uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(acc));
+            sad = (int32)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+            if (sad > dmin)
+                break;
+
+            ref += lx;
+            blk += 16;
+        }
+
+        return sad;
+    }
+
+#elif defined(__SSE2__)
+
+    /* PSADBW a row at a time, with the same early exit as the C version. */
+    __inline int32 simd_sad_mb(UChar *ref, UChar *blk, Int dmin, Int lx)
+    {
+        __m128i acc = _mm_setzero_si128();
+        int32 sad = 0;
+        Int i;
+
+        for (i = 0; i < 16; i++)
+        {
+            __m128i r = _mm_loadu_si128((const __m128i *)ref);
+            __m128i b = _mm_loadu_si128((const __m128i *)blk);
+
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(r, b));
+            sad = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+            if (sad > dmin)
+                break;
+
+            ref += lx;
+            blk += 16;
+        }
+
+        return sad;
+    }
+
+#else
+
     __inline int32 simd_sad_mb(UChar *ref, UChar *blk, Int dmin, Int lx)
     {
         int32 x4, x5, x6, x8, x9, x10, x11, x12, x14;
@@ -172,6 +237,8 @@ SadMBOffset1:
 
     }
 
+#endif
+
 #elif defined(__CC_ARM)  /* only work with arm v5 */
 
     __inline int32 SUB_SAD(int32 sad, int32 tmp, int32 tmp2)
@@ -76,6 +76,10 @@ Input
 #include "pvmp3_dec_defs.h"
 #include "pvmp3_tables.h"
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 /*----------------------------------------------------------------------------
 ; MACROS
 ; Define module1 specific macros here
@@ -94,6 +98,92 @@ Input
 ; Function Prototype declaration
 ----------------------------------------------------------------------------*/
 
+#if defined(__aarch64__)
+
+/*
+ *  (a * b) >> 32 in each lane, truncated per product as fxp_mul32_Q32()
+ */
+static inline int32x4_t mul32_Q32_neon(int32x4_t a, int32x4_t b)
+{
+    int64x2_t lo = vmull_s32(vget_low_s32(a), vget_low_s32(b));
+    int64x2_t hi = vmull_s32(vget_high_s32(a), vget_high_s32(b));
+    return vcombine_s32(vshrn_n_s64(lo, 32), vshrn_n_s64(hi, 32));
+}
+
+/*
+ *  synth_buffer[offset - j - 3 .. offset - j] in the order of j
+ */
+static inline int32x4_t load_reversed_neon(const int32 *p)
+{
+    int32x4_t v = vrev64q_s32(vld1q_s32(p - 3));
+    return vcombine_s32(vget_high_s32(v), vget_low_s32(v));
+}
+
+/*
+ *  Computes the output samples of subbands j = 1 .. 12 four at a time, a
+ *  lane per subband, with the same products and sums as the C loop below,
+ *  so the output is bit exact. Returns the first subband left to do.
+ */
+static int16 polyphase_filter_window_neon(int32 *synth_buffer,
+        int16 *outPcm,
+        int32 numChannels)
+{
+    int16 j;
+
+    for (j = 1; j + 4 <= SUBBANDS_NUMBER / 2; j += 4)
+    {
+        /* the window of subband j + r is at pqmfSynthWin[16 * (j + r - 1)] */
+        const int32 *winPtr = &pqmfSynthWin[(j - 1) << 4];
+        int32x4_t sum1 = vdupq_n_s32(0x00000020);
+        int32x4_t sum2 = vdupq_n_s32(0x00000020);
+
+        /* the loop over i of the C version runs once */
+        int32 *pt_1 = &synth_buffer[(SUBBANDS_NUMBER >> 1) + j];
+        int32 *pt_2 = &synth_buffer[(SUBBANDS_NUMBER >> 1) - j];
+
+        for (int32 m = 0; m < 4; m++)
+        {
+            int32x4x2_t w01 = vtrnq_s32(vld1q_s32(winPtr + (m << 2)),
+                                        vld1q_s32(winPtr + 16 + (m << 2)));
+            int32x4x2_t w23 = vtrnq_s32(vld1q_s32(winPtr + 32 + (m << 2)),
+                                        vld1q_s32(winPtr + 48 + (m << 2)));
+            int32x4_t win0 = vcombine_s32(vget_low_s32(w01.val[0]), vget_low_s32(w23.val[0]));
+            int32x4_t win1 = vcombine_s32(vget_low_s32(w01.val[1]), vget_low_s32(w23.val[1]));
+            int32x4_t win2 = vcombine_s32(vget_high_s32(w01.val[0]), vget_high_s32(w23.val[0]));
+            int32x4_t win3 = vcombine_s32(vget_high_s32(w01.val[1]), vget_high_s32(w23.val[1]));
+
+            int32x4_t temp1 = vld1q_s32(pt_1 + SUBBANDS_NUMBER * (m << 1));
+            int32x4_t temp3 = load_reversed_neon(pt_2 + SUBBANDS_NUMBER * (15 - (m << 1)));
+            int32x4_t temp2 = load_reversed_neon(pt_2 + SUBBANDS_NUMBER * ((m << 1) + 1));
+            int32x4_t temp4 = vld1q_s32(pt_1 + SUBBANDS_NUMBER * (14 - (m << 1)));
+
+            sum1 = vaddq_s32(sum1, mul32_Q32_neon(temp1, win0));
+            sum2 = vaddq_s32(sum2, mul32_Q32_neon(temp3, win0));
+            sum2 = vaddq_s32(sum2, mul32_Q32_neon(temp1, win1));
+            sum1 = vsubq_s32(sum1, mul32_Q32_neon(temp3, win1));
+            sum1 = vaddq_s32(sum1, mul32_Q32_neon(temp2, win2));
+            sum2 = vsubq_s32(sum2, mul32_Q32_neon(temp4, win2));
+            sum2 = vaddq_s32(sum2, mul32_Q32_neon(temp2, win3));
+            sum1 = vaddq_s32(sum1, mul32_Q32_neon(temp4, win3));
+        }
+
+        int16 out1[4];
+        int16 out2[4];
+        vst1_s16(out1, vqmovn_s32(vshrq_n_s32(sum1, 6)));
+        vst1_s16(out2, vqmovn_s32(vshrq_n_s32(sum2, 6)));
+        for (int32 r = 0; r < 4; r++)
+        {
+            int32 k = (j + r) << (numChannels - 1);
+            outPcm[k] = out1[r];
+            outPcm[(numChannels<<5) - k] = out2[r];
+        }
+    }
+
+    return j;
+}
+
+#endif
+
 /*----------------------------------------------------------------------------
 ; LOCAL STORE/BUFFER/POINTER DEFINITIONS
 ; Variable declaration - defined here and used outside this module1
@@ -120,9 +210,14 @@ void pvmp3_polyphase_filter_window(int32 *synth_buffer,
     int32 sum2;
     const int32 *winPtr = pqmfSynthWin;
     int32 i;
+    int16 j = 1;
 
+#if defined(__aarch64__)
+    j = polyphase_filter_window_neon(synth_buffer, outPcm, numChannels);
+    winPtr += (j - 1) << 4;
+#endif
 
-    for (int16 j = 1; j < SUBBANDS_NUMBER / 2; j++)
+    for (; j < SUBBANDS_NUMBER / 2; j++)
     {
         sum1 = 0x00000020;
         sum2 = 0x00000020;
@@ -22,6 +22,7 @@
 
 #include "SoftVPX.h"
 
+#include <cutils/properties.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/MediaDefs.h>
 
@@ -87,6 +88,10 @@ status_t SoftVPX::initDecoder() {
     memset(&flags, 0, sizeof(vpx_codec_flags_t));
     cfg.threads = GetCPUCoreCount();
 
+    // Decoding several frames at once takes a frame of latency per thread,
+    // so it is only used when asked for.
+    mFrameParallelMode = mMode == MODE_VP9 && cfg.threads > 1
+            && property_get_bool("media.stagefright.vpx.frame-parallel", false);
     if (mFrameParallelMode) {
         flags |= VPX_CODEC_USE_FRAME_THREADING;
     }
@@ -99,6 +104,21 @@ status_t SoftVPX::initDecoder() {
         return UNKNOWN_ERROR;
     }
 
+#ifdef VPX_CTRL_VP9D_SET_ROW_MT
+    // Tiles only spread across the threads as far as there are tile columns,
+    // which narrow streams have few of; decoding superblock rows in parallel
+    // keeps the threads busy regardless, with the same output.
+    if (mMode == MODE_VP9 && !mFrameParallelMode && cfg.threads > 1
+            && property_get_bool("media.stagefright.vpx.row-mt", true)) {
+        vpx_err = vpx_codec_control((vpx_codec_ctx_t *)mCtx, VP9D_SET_ROW_MT, 1);
+        if (vpx_err != VPX_CODEC_OK) {
+            ALOGW("on2 decoder failed to enable row multithreading. (%d)", vpx_err);
+        }
+    }
+#endif
+
+    ALOGV("decoding on %u threads%s", cfg.threads,
+            mFrameParallelMode ? ", frame parallel" : "");
     return OK;
 }
 
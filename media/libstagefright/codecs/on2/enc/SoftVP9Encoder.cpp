@@ -77,9 +77,30 @@ vpx_codec_err_t SoftVP9Encoder::setCodecSpecificControls() {
               "returned %d", codecReturn);
         return codecReturn;
     }
+#ifdef VPX_CTRL_VP9E_SET_ROW_MT
+    // Without tile columns the threads have nothing to share but rows.
+    if (mAdaptive && mCodecConfiguration->g_threads > 1) {
+        codecReturn = vpx_codec_control(mCodecContext, VP9E_SET_ROW_MT, 1);
+        if (codecReturn != VPX_CODEC_OK) {
+            ALOGW("Error setting VP9E_SET_ROW_MT. vpx_codec_control() "
+                  "returned %d", codecReturn);
+            codecReturn = VPX_CODEC_OK;
+        }
+    }
+#endif
     return codecReturn;
 }
 
+void SoftVP9Encoder::getSpeedRange(int32_t *minSpeed, int32_t *maxSpeed) {
+    // the real time speeds
+    *minSpeed = 5;
+    *maxSpeed = 8;
+}
+
+int32_t SoftVP9Encoder::getCpuUsed(int32_t speed) {
+    return speed;
+}
+
 OMX_ERRORTYPE SoftVP9Encoder::internalGetParameter(
         OMX_INDEXTYPE index, OMX_PTR param) {
     // can include extension index OMX_INDEXEXTTYPE
@@ -64,6 +64,10 @@ protected:
     // Initializes codec specific encoder settings.
     virtual vpx_codec_err_t setCodecSpecificControls();
 
+    virtual void getSpeedRange(int32_t *minSpeed, int32_t *maxSpeed);
+
+    virtual int32_t getCpuUsed(int32_t speed);
+
     // Gets vp9 specific parameters.
     OMX_ERRORTYPE internalGetVp9Params(
         OMX_VIDEO_PARAM_VP9TYPE* vp9Params);
@@ -21,8 +21,10 @@
 #include "SoftVP8Encoder.h"
 #include "SoftVP9Encoder.h"
 
+#include <cutils/properties.h>
 #include <utils/Log.h>
 #include <utils/misc.h>
+#include <utils/Timers.h>
 
 #include <media/hardware/HardwareAPI.h>
 #include <media/hardware/MetadataBufferType.h>
@@ -86,7 +88,13 @@ SoftVPXEncoder::SoftVPXEncoder(const char *name,
       mTemporalPatternIdx(0),
       mLastTimestamp(0x7FFFFFFFFFFFFFFFLL),
       mConversionBuffer(NULL),
-      mKeyFrameRequested(false) {
+      mKeyFrameRequested(false),
+      mAdaptive(false),
+      mSpeed(0),
+      mMinSpeed(0),
+      mMaxSpeed(0),
+      mEncodeTimeUs(-1),
+      mFramesSinceSpeedChange(0) {
     memset(mTemporalLayerBitrateRatio, 0, sizeof(mTemporalLayerBitrateRatio));
     mTemporalLayerBitrateRatio[0] = 100;
 
@@ -247,6 +255,7 @@ status_t SoftVPXEncoder::initEncoder() {
         mCodecConfiguration->rc_max_quantizer = mMaxQuantizer;
     }
     setCodecSpecificConfiguration();
+    mAdaptive = property_get_bool("media.stagefright.vpxenc.adaptive", false);
     mCodecContext = new vpx_codec_ctx_t;
     codec_return = vpx_codec_enc_init(mCodecContext,
                                       mCodecInterface,
@@ -292,6 +301,19 @@ status_t SoftVPXEncoder::initEncoder() {
         goto CLEAN_UP;
     }
 
+    if (mAdaptive) {
+        // Start fast, and trade the spare time for quality once measured.
+        getSpeedRange(&mMinSpeed, &mMaxSpeed);
+        mSpeed = mMaxSpeed;
+        mEncodeTimeUs = -1;
+        mFramesSinceSpeedChange = 0;
+        if (vpx_codec_control(mCodecContext, VP8E_SET_CPUUSED, getCpuUsed(mSpeed))
+                != VPX_CODEC_OK) {
+            ALOGW("Unable to set the speed, not adapting it");
+            mAdaptive = false;
+        }
+    }
+
     if (mColorFormat != OMX_COLOR_FormatYUV420Planar || mInputDataIsMeta) {
         free(mConversionBuffer);
         mConversionBuffer = NULL;
@@ -614,6 +636,53 @@ vpx_enc_frame_flags_t SoftVPXEncoder::getEncodeFlags() {
     return flags;
 }
 
+void SoftVPXEncoder::getSpeedRange(int32_t *minSpeed, int32_t *maxSpeed) {
+    *minSpeed = 4;
+    *maxSpeed = 12;
+}
+
+int32_t SoftVPXEncoder::getCpuUsed(int32_t speed) {
+    // Negative values select a fixed speed in real time mode, as the CBR
+    // setup in initEncoder() does.
+    return -speed;
+}
+
+void SoftVPXEncoder::adaptSpeed(int64_t encodeTimeUs, uint32_t frameDurationUs) {
+    // Speed changes wait for this many frames, so that the average
+    // reflects the current speed.
+    static const uint32_t kMinFramesPerSpeedChange = 15;
+
+    if (mEncodeTimeUs < 0) {
+        mEncodeTimeUs = encodeTimeUs;
+    } else {
+        mEncodeTimeUs = (mEncodeTimeUs * 7 + encodeTimeUs) / 8;
+    }
+
+    if (++mFramesSinceSpeedChange < kMinFramesPerSpeedChange || frameDurationUs == 0) {
+        return;
+    }
+
+    int32_t speed = mSpeed;
+    if (mEncodeTimeUs * 10 > (int64_t)frameDurationUs * 8) {
+        ++speed;
+    } else if (mEncodeTimeUs * 10 < (int64_t)frameDurationUs * 4) {
+        --speed;
+    }
+    if (speed < mMinSpeed || speed > mMaxSpeed || speed == mSpeed) {
+        return;
+    }
+
+    vpx_codec_err_t res = vpx_codec_control(mCodecContext, VP8E_SET_CPUUSED, getCpuUsed(speed));
+    if (res != VPX_CODEC_OK) {
+        ALOGW("vpx encoder failed to change speed: %s", vpx_codec_err_to_string(res));
+        return;
+    }
+    ALOGV("encode time %lld us of %u us, speed %d -> %d",
+            (long long)mEncodeTimeUs, frameDurationUs, mSpeed, speed);
+    mSpeed = speed;
+    mFramesSinceSpeedChange = 0;
+}
+
 void SoftVPXEncoder::onQueueFilled(OMX_U32 /* portIndex */) {
     // Initialize encoder if not already
     if (mCodecContext == NULL) {
@@ -717,6 +786,7 @@ void SoftVPXEncoder::onQueueFilled(OMX_U32 /* portIndex */) {
             frameDuration = (uint32_t)(((uint64_t)1000000 << 16) / framerate);
         }
         mLastTimestamp = inputBufferHeader->nTimeStamp;
+        nsecs_t encodeStartNs = systemTime();
         codec_return = vpx_codec_encode(
                 mCodecContext,
                 &raw_frame,
@@ -732,6 +802,9 @@ void SoftVPXEncoder::onQueueFilled(OMX_U32 /* portIndex */) {
                    NULL);  // Notification data pointer
             return;
         }
+        if (mAdaptive) {
+            adaptSpeed((systemTime() - encodeStartNs) / 1000, frameDuration);
+        }
 
         vpx_codec_iter_t encoded_packet_iterator = NULL;
         const vpx_codec_cx_pkt_t* encoded_packet;
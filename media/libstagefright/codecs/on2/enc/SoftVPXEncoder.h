@@ -110,6 +110,13 @@ protected:
     // Get current encode flags.
     virtual vpx_enc_frame_flags_t getEncodeFlags();
 
+    // Sets the range of speeds the encoder adapts within in adaptive mode,
+    // the higher the faster.
+    virtual void getSpeedRange(int32_t *minSpeed, int32_t *maxSpeed);
+
+    // Returns the VP8E_SET_CPUUSED value for |speed|.
+    virtual int32_t getCpuUsed(int32_t speed);
+
     // Releases vpx encoder instance, with it's associated
     // data structures.
     //
@@ -245,6 +252,19 @@ protected:
 
     bool mKeyFrameRequested;
 
+    // In adaptive mode, the speed follows the time frames take to encode:
+    // it goes up when they take most of the frame interval, and back down,
+    // for quality, when they take little of it.
+    bool mAdaptive;
+    int32_t mSpeed;
+    int32_t mMinSpeed;
+    int32_t mMaxSpeed;
+    // the moving average of the encode time, or -1 if not yet measured
+    int64_t mEncodeTimeUs;
+    uint32_t mFramesSinceSpeedChange;
+
+    void adaptSpeed(int64_t encodeTimeUs, uint32_t frameDurationUs);
+
     DISALLOW_EVIL_CONSTRUCTORS(SoftVPXEncoder);
 };
 
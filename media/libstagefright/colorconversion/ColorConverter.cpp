@@ -22,22 +22,257 @@
 #include <media/stagefright/ColorConverter.h>
 #include <media/stagefright/MediaErrors.h>
 
+#include <algorithm>
+
+#include <pthread.h>
+#include <unistd.h>
+
 #include "libyuv/convert_from.h"
 
 #define USE_LIBYUV
 
 namespace android {
 
+namespace {
+
+// Rows are converted on more than one thread only if each gets this many
+// destination pixels or more.
+const size_t kMinPixelsPerThread = 256 * 1024;
+const size_t kMaxThreads = 4;
+
+// Where the samples of a YUV source are. |mY|, |mU| and |mV| point at the
+// first row of their planes, at the left edge of the crop rectangle, and
+// |mTop| is the first row of the crop rectangle.
+struct YUVSource {
+    const uint8_t *mY;
+    size_t mYStride;
+    size_t mYStep;
+    const uint8_t *mU;
+    const uint8_t *mV;
+    size_t mUVStride;
+    size_t mUVStep;
+    // whether there is a row of chroma per two rows of luma
+    bool mSubsampledRows;
+    // whether blue goes in the high bits of the pixel
+    bool mSwapRB;
+    size_t mTop;
+    size_t mWidth, mHeight;
+};
+
+// Converts a band of the destination rows. The bands are converted on
+// threads of their own, so a converter holds no state it writes to.
+struct RowConverter {
+    virtual ~RowConverter() {}
+    virtual void convert(size_t firstRow, size_t endRow) const = 0;
+};
+
+inline signed Clip(signed value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+// B = 1.164 * (Y - 16) + 2.018 * (U - 128)
+// G = 1.164 * (Y - 16) - 0.813 * (V - 128) - 0.391 * (U - 128)
+// R = 1.164 * (Y - 16) + 1.596 * (V - 128)
+//
+// B = 298/256 * (Y - 16) + 517/256 * (U - 128)
+// G = .................. - 208/256 * (V - 128) - 100/256 * (U - 128)
+// R = .................. + 409/256 * (V - 128)
+//
+// The results are clipped with arithmetic rather than looked up in a table,
+// which leaves the row loops free of loads the compiler cannot vectorize.
+template<bool kSwapRB>
+inline uint16_t ConvertPixel(signed y, signed u, signed v) {
+    signed tmp = (y - 16) * 298;
+    u -= 128;
+    v -= 128;
+
+    signed b = Clip((tmp + u * 517) / 256);
+    signed g = Clip((tmp - v * 208 - u * 100) / 256);
+    signed r = Clip((tmp + v * 409) / 256);
+
+    if (kSwapRB) {
+        return ((b >> 3) << 11) | ((g >> 2) << 5) | (r >> 3);
+    }
+    return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+}
+
+template<bool kSwapRB>
+void ConvertRow(
+        const uint8_t *y, size_t yStep,
+        const uint8_t *u, const uint8_t *v, size_t uvStep,
+        size_t srcWidth, uint16_t *dst, size_t width) {
+    if (srcWidth == width) {
+        for (size_t x = 0; x < width; ++x) {
+            size_t c = (x >> 1) * uvStep;
+            dst[x] = ConvertPixel<kSwapRB>(y[x * yStep], u[c], v[c]);
+        }
+        return;
+    }
+
+    // 16.16 fixed point
+    uint64_t step = ((uint64_t)srcWidth << 16) / width;
+    for (size_t x = 0; x < width; ++x) {
+        size_t srcX = (size_t)((x * step) >> 16);
+        size_t c = (srcX >> 1) * uvStep;
+        dst[x] = ConvertPixel<kSwapRB>(y[srcX * yStep], u[c], v[c]);
+    }
+}
+
+// Converts a YUVSource, scaling it to the destination by sampling the
+// nearest pixel if the sizes differ.
+struct YUVRowConverter : public RowConverter {
+    YUVRowConverter(const YUVSource &src, uint16_t *dst, size_t dstStride,
+            size_t width, size_t height)
+        : mSrc(src),
+          mDst(dst),
+          mDstStride(dstStride),
+          mWidth(width),
+          mHeight(height) {
+    }
+
+    virtual void convert(size_t firstRow, size_t endRow) const {
+        for (size_t row = firstRow; row < endRow; ++row) {
+            size_t srcRow = mSrc.mTop + (size_t)((uint64_t)row * mSrc.mHeight / mHeight);
+            size_t uvRow = mSrc.mSubsampledRows ? srcRow / 2 : srcRow;
+
+            const uint8_t *y = mSrc.mY + srcRow * mSrc.mYStride;
+            const uint8_t *u = mSrc.mU + uvRow * mSrc.mUVStride;
+            const uint8_t *v = mSrc.mV + uvRow * mSrc.mUVStride;
+            uint16_t *dst = mDst + row * mDstStride;
+
+            if (mSrc.mSwapRB) {
+                ConvertRow<true>(y, mSrc.mYStep, u, v, mSrc.mUVStep, mSrc.mWidth, dst, mWidth);
+            } else {
+                ConvertRow<false>(y, mSrc.mYStep, u, v, mSrc.mUVStep, mSrc.mWidth, dst, mWidth);
+            }
+        }
+    }
+
+private:
+    YUVSource mSrc;
+    uint16_t *mDst;
+    size_t mDstStride;
+    size_t mWidth, mHeight;
+};
+
+// Converts planar YUV 4:2:0 of the same size with libyuv. |y|, |u| and |v|
+// point at the top left of the crop rectangle.
+struct LibYUVRowConverter : public RowConverter {
+    LibYUVRowConverter(
+            const uint8_t *y, size_t yStride,
+            const uint8_t *u, const uint8_t *v, size_t uvStride,
+            uint16_t *dst, size_t dstStride, size_t width)
+        : mY(y),
+          mYStride(yStride),
+          mU(u),
+          mV(v),
+          mUVStride(uvStride),
+          mDst(dst),
+          mDstStride(dstStride),
+          mWidth(width) {
+    }
+
+    // |firstRow| is even, as the bands start on a row of chroma.
+    virtual void convert(size_t firstRow, size_t endRow) const {
+        size_t uvRow = firstRow / 2;
+        libyuv::I420ToRGB565(
+                mY + firstRow * mYStride, mYStride,
+                mU + uvRow * mUVStride, mUVStride,
+                mV + uvRow * mUVStride, mUVStride,
+                (uint8 *)(mDst + firstRow * mDstStride), mDstStride * 2,
+                mWidth, endRow - firstRow);
+    }
+
+private:
+    const uint8_t *mY;
+    size_t mYStride;
+    const uint8_t *mU, *mV;
+    size_t mUVStride;
+    uint16_t *mDst;
+    size_t mDstStride;
+    size_t mWidth;
+};
+
+struct Band {
+    const RowConverter *mConverter;
+    size_t mFirstRow, mEndRow;
+    pthread_t mThread;
+    bool mThreadStarted;
+};
+
+void *ConvertBand(void *me) {
+    Band *band = static_cast<Band *>(me);
+    band->mConverter->convert(band->mFirstRow, band->mEndRow);
+    return NULL;
+}
+
+// Converts |numRows| rows of |width| pixels, split in bands of even rows
+// across up to kMaxThreads threads for large frames. The calling thread
+// converts the first band.
+void ConvertRows(const RowConverter &converter, size_t numRows, size_t width) {
+    size_t numThreads = numRows * width / kMinPixelsPerThread;
+    long numCpus = 1;
+#if defined(_SC_NPROCESSORS_ONLN)
+    numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (numCpus > 0 && numThreads > (size_t)numCpus) {
+        numThreads = numCpus;
+    }
+    if (numThreads > kMaxThreads) {
+        numThreads = kMaxThreads;
+    }
+    if (numThreads <= 1) {
+        converter.convert(0, numRows);
+        return;
+    }
+
+    size_t bandRows = ((numRows + numThreads - 1) / numThreads + 1) & ~1;
+    Band bands[kMaxThreads];
+    size_t numBands = 0;
+    for (size_t row = 0; row < numRows; row += bandRows) {
+        Band &band = bands[numBands++];
+        band.mConverter = &converter;
+        band.mFirstRow = row;
+        band.mEndRow = std::min(row + bandRows, numRows);
+        band.mThreadStarted = false;
+    }
+
+    for (size_t i = 1; i < numBands; ++i) {
+        bands[i].mThreadStarted =
+            pthread_create(&bands[i].mThread, NULL, ConvertBand, &bands[i]) == 0;
+        if (!bands[i].mThreadStarted) {
+            ALOGW("Unable to start a conversion thread");
+        }
+    }
+
+    for (size_t i = 0; i < numBands; ++i) {
+        if (i == 0 || !bands[i].mThreadStarted) {
+            ConvertBand(&bands[i]);
+        }
+    }
+
+    for (size_t i = 1; i < numBands; ++i) {
+        if (bands[i].mThreadStarted) {
+            pthread_join(bands[i].mThread, NULL);
+        }
+    }
+}
+
+void ConvertYUV(const YUVSource &src, void *dstBits, size_t dstWidth,
+        size_t dstCropLeft, size_t dstCropTop, size_t width, size_t height) {
+    uint16_t *dst = (uint16_t *)dstBits + dstCropTop * dstWidth + dstCropLeft;
+    ConvertRows(YUVRowConverter(src, dst, dstWidth, width, height), height, width);
+}
+
+}  // namespace
+
 ColorConverter::ColorConverter(
         OMX_COLOR_FORMATTYPE from, OMX_COLOR_FORMATTYPE to)
     : mSrcFormat(from),
-      mDstFormat(to),
-      mClip(NULL) {
+      mDstFormat(to) {
 }
 
 ColorConverter::~ColorConverter() {
-    delete[] mClip;
-    mClip = NULL;
 }
 
 bool ColorConverter::isValid() const {
@@ -80,6 +315,7 @@ size_t ColorConverter::BitmapParams::cropHeight() const {
     return mCropBottom - mCropTop + 1;
 }
 
+
 status_t ColorConverter::convert(
         const void *srcBits,
         size_t srcWidth, size_t srcHeight,
@@ -89,10 +325,28 @@ status_t ColorConverter::convert(
         size_t dstWidth, size_t dstHeight,
         size_t dstCropLeft, size_t dstCropTop,
         size_t dstCropRight, size_t dstCropBottom) {
-    if (mDstFormat != OMX_COLOR_Format16bitRGB565) {
-        return ERROR_UNSUPPORTED;
-    }
+    BitmapParams src(
+            const_cast<void *>(srcBits),
+            srcWidth, srcHeight,
+            srcCropLeft, srcCropTop, srcCropRight, srcCropBottom);
+
+    BitmapParams dst(
+            dstBits,
+            dstWidth, dstHeight,
+            dstCropLeft, dstCropTop, dstCropRight, dstCropBottom);
+
+    return convertBitmap(src, dst, false /* scale */);
+}
 
+status_t ColorConverter::convertScaled(
+        const void *srcBits,
+        size_t srcWidth, size_t srcHeight,
+        size_t srcCropLeft, size_t srcCropTop,
+        size_t srcCropRight, size_t srcCropBottom,
+        void *dstBits,
+        size_t dstWidth, size_t dstHeight,
+        size_t dstCropLeft, size_t dstCropTop,
+        size_t dstCropRight, size_t dstCropBottom) {
     BitmapParams src(
             const_cast<void *>(srcBits),
             srcWidth, srcHeight,
@@ -103,15 +357,36 @@ status_t ColorConverter::convert(
             dstWidth, dstHeight,
             dstCropLeft, dstCropTop, dstCropRight, dstCropBottom);
 
+    return convertBitmap(src, dst, true /* scale */);
+}
+
+status_t ColorConverter::convertBitmap(
+        const BitmapParams &src, const BitmapParams &dst, bool scale) {
+    if (mDstFormat != OMX_COLOR_Format16bitRGB565) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    if ((src.mCropLeft & 1) != 0) {
+        return ERROR_UNSUPPORTED;
+    }
+
+    bool sameSize = src.cropWidth() == dst.cropWidth()
+            && src.cropHeight() == dst.cropHeight();
+    if (!sameSize && !scale) {
+        return ERROR_UNSUPPORTED;
+    }
+
     status_t err;
 
     switch (mSrcFormat) {
         case OMX_COLOR_FormatYUV420Planar:
 #ifdef USE_LIBYUV
-            err = convertYUV420PlanarUseLibYUV(src, dst);
-#else
-            err = convertYUV420Planar(src, dst);
+            if (sameSize) {
+                err = convertYUV420PlanarUseLibYUV(src, dst);
+                break;
+            }
 #endif
+            err = convertYUV420Planar(src, dst);
             break;
 
         case OMX_COLOR_FormatCbYCrY:
@@ -144,74 +419,30 @@ status_t ColorConverter::convertCbYCrY(
         const BitmapParams &src, const BitmapParams &dst) {
     // XXX Untested
 
-    uint8_t *kAdjustedClip = initClip();
-
-    if (!((src.mCropLeft & 1) == 0
-        && src.cropWidth() == dst.cropWidth()
-        && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
-    }
-
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
-    const uint8_t *src_ptr = (const uint8_t *)src.mBits
-        + (src.mCropTop * dst.mWidth + src.mCropLeft) * 2;
-
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_ptr[2 * x + 1] - 16;
-            signed y2 = (signed)src_ptr[2 * x + 3] - 16;
-            signed u = (signed)src_ptr[2 * x] - 128;
-            signed v = (signed)src_ptr[2 * x + 2] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[r1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[b1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[r2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[b2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
-
-        src_ptr += src.mWidth * 2;
-        dst_ptr += dst.mWidth;
-    }
+    const uint8_t *src_ptr = (const uint8_t *)src.mBits + src.mCropLeft * 2;
+
+    YUVSource yuv;
+    yuv.mY = src_ptr + 1;
+    yuv.mYStride = src.mWidth * 2;
+    yuv.mYStep = 2;
+    yuv.mU = src_ptr;
+    yuv.mV = src_ptr + 2;
+    yuv.mUVStride = src.mWidth * 2;
+    yuv.mUVStep = 4;
+    yuv.mSubsampledRows = false;
+    yuv.mSwapRB = false;
+    yuv.mTop = src.mCropTop;
+    yuv.mWidth = src.cropWidth();
+    yuv.mHeight = src.cropHeight();
+
+    ConvertYUV(yuv, dst.mBits, dst.mWidth, dst.mCropLeft, dst.mCropTop,
+            dst.cropWidth(), dst.cropHeight());
 
     return OK;
 }
 
 status_t ColorConverter::convertYUV420PlanarUseLibYUV(
         const BitmapParams &src, const BitmapParams &dst) {
-    if (!((src.mCropLeft & 1) == 0
-            && src.cropWidth() == dst.cropWidth()
-            && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
-    }
-
     uint16_t *dst_ptr = (uint16_t *)dst.mBits
         + dst.mCropTop * dst.mWidth + dst.mCropLeft;
 
@@ -219,181 +450,66 @@ status_t ColorConverter::convertYUV420PlanarUseLibYUV(
         (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
 
     const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * src.mHeight
-        + src.mCropTop * (src.mWidth / 2) + src.mCropLeft / 2;
+        (const uint8_t *)src.mBits + src.mWidth * src.mHeight
+        + (src.mCropTop / 2) * (src.mWidth / 2) + src.mCropLeft / 2;
 
     const uint8_t *src_v =
         src_u + (src.mWidth / 2) * (src.mHeight / 2);
 
-
-    libyuv::I420ToRGB565(src_y, src.mWidth, src_u, src.mWidth / 2, src_v, src.mWidth / 2,
-            (uint8 *)dst_ptr, dst.mWidth * 2, dst.mWidth, dst.mHeight);
+    ConvertRows(LibYUVRowConverter(
+                src_y, src.mWidth, src_u, src_v, src.mWidth / 2,
+                dst_ptr, dst.mWidth, dst.cropWidth()),
+            dst.cropHeight(), dst.cropWidth());
 
     return OK;
 }
 
 status_t ColorConverter::convertYUV420Planar(
         const BitmapParams &src, const BitmapParams &dst) {
-    if (!((src.mCropLeft & 1) == 0
-            && src.cropWidth() == dst.cropWidth()
-            && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
-    }
-
-    uint8_t *kAdjustedClip = initClip();
-
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
-    const uint8_t *src_y =
-        (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
-
     const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * src.mHeight
-        + src.mCropTop * (src.mWidth / 2) + src.mCropLeft / 2;
-
-    const uint8_t *src_v =
-        src_u + (src.mWidth / 2) * (src.mHeight / 2);
-
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            // B = 1.164 * (Y - 16) + 2.018 * (U - 128)
-            // G = 1.164 * (Y - 16) - 0.813 * (V - 128) - 0.391 * (U - 128)
-            // R = 1.164 * (Y - 16) + 1.596 * (V - 128)
-
-            // B = 298/256 * (Y - 16) + 517/256 * (U - 128)
-            // G = .................. - 208/256 * (V - 128) - 100/256 * (U - 128)
-            // R = .................. + 409/256 * (V - 128)
-
-            // min_B = (298 * (- 16) + 517 * (- 128)) / 256 = -277
-            // min_G = (298 * (- 16) - 208 * (255 - 128) - 100 * (255 - 128)) / 256 = -172
-            // min_R = (298 * (- 16) + 409 * (- 128)) / 256 = -223
-
-            // max_B = (298 * (255 - 16) + 517 * (255 - 128)) / 256 = 534
-            // max_G = (298 * (255 - 16) - 208 * (- 128) - 100 * (- 128)) / 256 = 432
-            // max_R = (298 * (255 - 16) + 409 * (255 - 128)) / 256 = 481
-
-            // clip range -278 .. 535
-
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
-
-            signed u = (signed)src_u[x / 2] - 128;
-            signed v = (signed)src_v[x / 2] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[r1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[b1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[r2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[b2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
-
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth / 2;
-            src_v += src.mWidth / 2;
-        }
-
-        dst_ptr += dst.mWidth;
-    }
+        (const uint8_t *)src.mBits + src.mWidth * src.mHeight + src.mCropLeft / 2;
+
+    YUVSource yuv;
+    yuv.mY = (const uint8_t *)src.mBits + src.mCropLeft;
+    yuv.mYStride = src.mWidth;
+    yuv.mYStep = 1;
+    yuv.mU = src_u;
+    yuv.mV = src_u + (src.mWidth / 2) * (src.mHeight / 2);
+    yuv.mUVStride = src.mWidth / 2;
+    yuv.mUVStep = 1;
+    yuv.mSubsampledRows = true;
+    yuv.mSwapRB = false;
+    yuv.mTop = src.mCropTop;
+    yuv.mWidth = src.cropWidth();
+    yuv.mHeight = src.cropHeight();
+
+    ConvertYUV(yuv, dst.mBits, dst.mWidth, dst.mCropLeft, dst.mCropTop,
+            dst.cropWidth(), dst.cropHeight());
 
     return OK;
 }
 
 status_t ColorConverter::convertQCOMYUV420SemiPlanar(
         const BitmapParams &src, const BitmapParams &dst) {
-    uint8_t *kAdjustedClip = initClip();
-
-    if (!((src.mCropLeft & 1) == 0
-            && src.cropWidth() == dst.cropWidth()
-            && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
-    }
-
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
-    const uint8_t *src_y =
-        (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
-
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * src.mHeight
-        + src.mCropTop * src.mWidth + src.mCropLeft;
-
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
-
-            signed u = (signed)src_u[x & ~1] - 128;
-            signed v = (signed)src_u[(x & ~1) + 1] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[b1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[r1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[b2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[r2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
-
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth;
-        }
-
-        dst_ptr += dst.mWidth;
-    }
+    const uint8_t *src_uv =
+        (const uint8_t *)src.mBits + src.mWidth * src.mHeight + src.mCropLeft;
+
+    YUVSource yuv;
+    yuv.mY = (const uint8_t *)src.mBits + src.mCropLeft;
+    yuv.mYStride = src.mWidth;
+    yuv.mYStep = 1;
+    yuv.mU = src_uv;
+    yuv.mV = src_uv + 1;
+    yuv.mUVStride = src.mWidth;
+    yuv.mUVStep = 2;
+    yuv.mSubsampledRows = true;
+    yuv.mSwapRB = true;
+    yuv.mTop = src.mCropTop;
+    yuv.mWidth = src.cropWidth();
+    yuv.mHeight = src.cropHeight();
+
+    ConvertYUV(yuv, dst.mBits, dst.mWidth, dst.mCropLeft, dst.mCropTop,
+            dst.cropWidth(), dst.cropHeight());
 
     return OK;
 }
@@ -402,159 +518,54 @@ status_t ColorConverter::convertYUV420SemiPlanar(
         const BitmapParams &src, const BitmapParams &dst) {
     // XXX Untested
 
-    uint8_t *kAdjustedClip = initClip();
-
-    if (!((src.mCropLeft & 1) == 0
-            && src.cropWidth() == dst.cropWidth()
-            && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
-    }
-
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
-    const uint8_t *src_y =
-        (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
-
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * src.mHeight
-        + src.mCropTop * src.mWidth + src.mCropLeft;
-
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
-
-            signed v = (signed)src_u[x & ~1] - 128;
-            signed u = (signed)src_u[(x & ~1) + 1] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[b1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[r1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[b2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[r2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
-
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth;
-        }
-
-        dst_ptr += dst.mWidth;
-    }
+    const uint8_t *src_vu =
+        (const uint8_t *)src.mBits + src.mWidth * src.mHeight + src.mCropLeft;
+
+    YUVSource yuv;
+    yuv.mY = (const uint8_t *)src.mBits + src.mCropLeft;
+    yuv.mYStride = src.mWidth;
+    yuv.mYStep = 1;
+    yuv.mU = src_vu + 1;
+    yuv.mV = src_vu;
+    yuv.mUVStride = src.mWidth;
+    yuv.mUVStep = 2;
+    yuv.mSubsampledRows = true;
+    yuv.mSwapRB = true;
+    yuv.mTop = src.mCropTop;
+    yuv.mWidth = src.cropWidth();
+    yuv.mHeight = src.cropHeight();
+
+    ConvertYUV(yuv, dst.mBits, dst.mWidth, dst.mCropLeft, dst.mCropTop,
+            dst.cropWidth(), dst.cropHeight());
 
     return OK;
 }
 
 status_t ColorConverter::convertTIYUV420PackedSemiPlanar(
         const BitmapParams &src, const BitmapParams &dst) {
-    uint8_t *kAdjustedClip = initClip();
-
-    if (!((src.mCropLeft & 1) == 0
-            && src.cropWidth() == dst.cropWidth()
-            && src.cropHeight() == dst.cropHeight())) {
-        return ERROR_UNSUPPORTED;
-    }
-
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
-        + dst.mCropTop * dst.mWidth + dst.mCropLeft;
-
-    const uint8_t *src_y = (const uint8_t *)src.mBits;
-
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * (src.mHeight - src.mCropTop / 2);
-
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
-
-            signed u = (signed)src_u[x & ~1] - 128;
-            signed v = (signed)src_u[(x & ~1) + 1] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[r1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[b1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[r2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[b2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
-
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth;
-        }
-
-        dst_ptr += dst.mWidth;
-    }
+    // The crop rectangle is at the top left of the luma plane, and the
+    // chroma plane ends where the padding of the buffer does.
+    const uint8_t *src_uv = (const uint8_t *)src.mBits
+        + src.mWidth * (src.mHeight - src.mCropTop / 2);
+
+    YUVSource yuv;
+    yuv.mY = (const uint8_t *)src.mBits;
+    yuv.mYStride = src.mWidth;
+    yuv.mYStep = 1;
+    yuv.mU = src_uv;
+    yuv.mV = src_uv + 1;
+    yuv.mUVStride = src.mWidth;
+    yuv.mUVStep = 2;
+    yuv.mSubsampledRows = true;
+    yuv.mSwapRB = false;
+    yuv.mTop = 0;
+    yuv.mWidth = src.cropWidth();
+    yuv.mHeight = src.cropHeight();
+
+    ConvertYUV(yuv, dst.mBits, dst.mWidth, dst.mCropLeft, dst.mCropTop,
+            dst.cropWidth(), dst.cropHeight());
 
     return OK;
 }
 
-uint8_t *ColorConverter::initClip() {
-    static const signed kClipMin = -278;
-    static const signed kClipMax = 535;
-
-    if (mClip == NULL) {
-        mClip = new uint8_t[kClipMax - kClipMin + 1];
-
-        for (signed i = kClipMin; i <= kClipMax; ++i) {
-            mClip[i - kClipMin] = (i < 0) ? 0 : (i > 255) ? 255 : (uint8_t)i;
-        }
-    }
-
-    return &mClip[-kClipMin];
-}
-
 }  // namespace android
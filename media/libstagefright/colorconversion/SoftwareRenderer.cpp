@@ -19,6 +19,8 @@
 
 #include "../include/SoftwareRenderer.h"
 
+#include <algorithm>
+
 #include <cutils/properties.h> // for property_get
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
@@ -27,6 +29,7 @@
 #include <ui/GraphicBufferMapper.h>
 #include <ui/GraphicBuffer.h>
 #include <ui/Rect.h>
+#include <utils/Timers.h>
 
 namespace android {
 
@@ -40,6 +43,26 @@ static int ALIGN(int x, int y) {
     return (x + y - 1) & ~(y - 1);
 }
 
+// Copies |height| rows of |rowSize| bytes, in one go if both planes are
+// contiguous.
+static void copyPlane(
+        uint8_t *dst, size_t dstStride, const uint8_t *src, size_t srcStride,
+        size_t rowSize, size_t height) {
+    if (dstStride == rowSize && srcStride == rowSize) {
+        memcpy(dst, src, rowSize * height);
+        return;
+    }
+    for (size_t y = 0; y < height; ++y) {
+        memcpy(dst, src, rowSize);
+        dst += dstStride;
+        src += srcStride;
+    }
+}
+
+static bool usePassThrough() {
+    return property_get_bool("media.stagefright.swrenderer.passthrough", false);
+}
+
 SoftwareRenderer::SoftwareRenderer(
         const sp<ANativeWindow> &nativeWindow, int32_t rotation)
     : mColorFormat(OMX_COLOR_FormatUnused),
@@ -54,10 +77,20 @@ SoftwareRenderer::SoftwareRenderer(
       mCropBottom(0),
       mCropWidth(0),
       mCropHeight(0),
-      mRotationDegrees(rotation) {
+      mRotationDegrees(rotation),
+      mNumFramesRendered(0),
+      mTotalRenderTimeNs(0),
+      mMaxRenderTimeNs(0) {
 }
 
 SoftwareRenderer::~SoftwareRenderer() {
+    if (mNumFramesRendered > 0) {
+        ALOGV("rendered %zu frames, %lld us on average, %lld us at most",
+                mNumFramesRendered,
+                (long long)(mTotalRenderTimeNs / mNumFramesRendered / 1000),
+                (long long)(mMaxRenderTimeNs / 1000));
+    }
+
     delete mConverter;
     mConverter = NULL;
 }
@@ -102,6 +135,10 @@ void SoftwareRenderer::resetFormatIfChanged(const sp<AMessage> &format) {
     mCropWidth = mCropRight - mCropLeft + 1;
     mCropHeight = mCropBottom - mCropTop + 1;
 
+    delete mConverter;
+    mConverter = NULL;
+    mYUVMode = None;
+
     // by default convert everything to RGB565
     int halFormat = HAL_PIXEL_FORMAT_RGB_565;
     size_t bufWidth = mCropWidth;
@@ -112,6 +149,14 @@ void SoftwareRenderer::resetFormatIfChanged(const sp<AMessage> &format) {
         switch (mColorFormat) {
             case OMX_COLOR_FormatYUV420Planar:
             case OMX_COLOR_FormatYUV420SemiPlanar:
+                if (usePassThrough()) {
+                    halFormat = HAL_PIXEL_FORMAT_YCbCr_420_888;
+                    mYUVMode = FlexibleYUV;
+                    bufWidth = (mCropWidth + 1) & ~1;
+                    bufHeight = (mCropHeight + 1) & ~1;
+                    break;
+                }
+                // fall through
             case OMX_TI_COLOR_FormatYUV420PackedSemiPlanar:
             {
                 halFormat = HAL_PIXEL_FORMAT_YV12;
@@ -200,6 +245,58 @@ void SoftwareRenderer::resetFormatIfChanged(const sp<AMessage> &format) {
                 mNativeWindow.get(), transform));
 }
 
+void SoftwareRenderer::copyToFlexibleYUV(
+        const void *data, const android_ycbcr &ycbcr) {
+    const uint8_t *src_y = (const uint8_t *)data;
+    copyPlane((uint8_t *)ycbcr.y, ycbcr.ystride, src_y, mWidth, mCropWidth, mCropHeight);
+
+    uint8_t *dst_u = (uint8_t *)ycbcr.cb;
+    uint8_t *dst_v = (uint8_t *)ycbcr.cr;
+    size_t chromaWidth = (mCropWidth + 1) / 2;
+    size_t chromaHeight = (mCropHeight + 1) / 2;
+
+    if (mColorFormat == OMX_COLOR_FormatYUV420Planar) {
+        const uint8_t *src_u = src_y + mWidth * mHeight;
+        const uint8_t *src_v = src_u + (mWidth / 2 * mHeight / 2);
+
+        if (ycbcr.chroma_step == 1) {
+            copyPlane(dst_u, ycbcr.cstride, src_u, mWidth / 2, chromaWidth, chromaHeight);
+            copyPlane(dst_v, ycbcr.cstride, src_v, mWidth / 2, chromaWidth, chromaHeight);
+            return;
+        }
+
+        for (size_t y = 0; y < chromaHeight; ++y) {
+            for (size_t x = 0; x < chromaWidth; ++x) {
+                dst_u[x * ycbcr.chroma_step] = src_u[x];
+                dst_v[x * ycbcr.chroma_step] = src_v[x];
+            }
+            src_u += mWidth / 2;
+            src_v += mWidth / 2;
+            dst_u += ycbcr.cstride;
+            dst_v += ycbcr.cstride;
+        }
+        return;
+    }
+
+    // OMX_COLOR_FormatYUV420SemiPlanar, with U before V
+    const uint8_t *src_uv = src_y + mWidth * mHeight;
+
+    if (ycbcr.chroma_step == 2 && dst_v == dst_u + 1) {
+        copyPlane(dst_u, ycbcr.cstride, src_uv, mWidth, chromaWidth * 2, chromaHeight);
+        return;
+    }
+
+    for (size_t y = 0; y < chromaHeight; ++y) {
+        for (size_t x = 0; x < chromaWidth; ++x) {
+            dst_u[x * ycbcr.chroma_step] = src_uv[2 * x];
+            dst_v[x * ycbcr.chroma_step] = src_uv[2 * x + 1];
+        }
+        src_uv += mWidth;
+        dst_u += ycbcr.cstride;
+        dst_v += ycbcr.cstride;
+    }
+}
+
 void SoftwareRenderer::clearTracker() {
     mRenderTracker.clear(-1 /* lastRenderTimeNs */);
 }
@@ -207,6 +304,7 @@ void SoftwareRenderer::clearTracker() {
 std::list<FrameRenderTracker::Info> SoftwareRenderer::render(
         const void *data, size_t size, int64_t mediaTimeUs, nsecs_t renderTimeNs,
         void* /*platformPrivate*/, const sp<AMessage>& format) {
+    nsecs_t startNs = systemTime();
     resetFormatIfChanged(format);
     FrameRenderTracker::Info *info = NULL;
 
@@ -229,13 +327,24 @@ std::list<FrameRenderTracker::Info> SoftwareRenderer::render(
 
     Rect bounds(mCropWidth, mCropHeight);
 
-    void *dst;
-    CHECK_EQ(0, mapper.lock(
-                buf->handle, GRALLOC_USAGE_SW_WRITE_OFTEN, bounds, &dst));
+    void *dst = NULL;
+    android_ycbcr ycbcr;
+    if (mYUVMode == FlexibleYUV) {
+        CHECK_EQ(0, mapper.lockYCbCr(
+                    buf->handle, GRALLOC_USAGE_SW_WRITE_OFTEN, bounds, &ycbcr));
+    } else {
+        CHECK_EQ(0, mapper.lock(
+                    buf->handle, GRALLOC_USAGE_SW_WRITE_OFTEN, bounds, &dst));
+    }
 
     // TODO move the other conversions also into ColorConverter, and
     // fix cropping issues (when mCropLeft/Top != 0 or mWidth != mCropWidth)
-    if (mConverter) {
+    if (mYUVMode == FlexibleYUV) {
+        if ((size_t)mWidth * mHeight * 3 / 2 > size) {
+            goto skip_copying;
+        }
+        copyToFlexibleYUV(data, ycbcr);
+    } else if (mConverter) {
         mConverter->convert(
                 data,
                 mWidth, mHeight,
@@ -259,22 +368,12 @@ std::list<FrameRenderTracker::Info> SoftwareRenderer::render(
         uint8_t *dst_v = dst_y + dst_y_size;
         uint8_t *dst_u = dst_v + dst_c_size;
 
-        for (int y = 0; y < mCropHeight; ++y) {
-            memcpy(dst_y, src_y, mCropWidth);
-
-            src_y += mWidth;
-            dst_y += buf->stride;
-        }
-
-        for (int y = 0; y < (mCropHeight + 1) / 2; ++y) {
-            memcpy(dst_u, src_u, (mCropWidth + 1) / 2);
-            memcpy(dst_v, src_v, (mCropWidth + 1) / 2);
+        copyPlane(dst_y, buf->stride, src_y, mWidth, mCropWidth, mCropHeight);
 
-            src_u += mWidth / 2;
-            src_v += mWidth / 2;
-            dst_u += dst_c_stride;
-            dst_v += dst_c_stride;
-        }
+        copyPlane(dst_u, dst_c_stride, src_u, mWidth / 2,
+                (mCropWidth + 1) / 2, (mCropHeight + 1) / 2);
+        copyPlane(dst_v, dst_c_stride, src_v, mWidth / 2,
+                (mCropWidth + 1) / 2, (mCropHeight + 1) / 2);
     } else if (mColorFormat == OMX_TI_COLOR_FormatYUV420PackedSemiPlanar
             || mColorFormat == OMX_COLOR_FormatYUV420SemiPlanar) {
         if ((size_t)mWidth * mHeight * 3 / 2 > size) {
@@ -292,12 +391,7 @@ std::list<FrameRenderTracker::Info> SoftwareRenderer::render(
         uint8_t *dst_v = dst_y + dst_y_size;
         uint8_t *dst_u = dst_v + dst_c_size;
 
-        for (int y = 0; y < mCropHeight; ++y) {
-            memcpy(dst_y, src_y, mCropWidth);
-
-            src_y += mWidth;
-            dst_y += buf->stride;
-        }
+        copyPlane(dst_y, buf->stride, src_y, mWidth, mCropWidth, mCropHeight);
 
         for (int y = 0; y < (mCropHeight + 1) / 2; ++y) {
             size_t tmp = (mCropWidth + 1) / 2;
@@ -314,14 +408,8 @@ std::list<FrameRenderTracker::Info> SoftwareRenderer::render(
         if ((size_t)mWidth * mHeight * 3 > size) {
             goto skip_copying;
         }
-        uint8_t* srcPtr = (uint8_t*)data;
-        uint8_t* dstPtr = (uint8_t*)dst;
-
-        for (size_t y = 0; y < (size_t)mCropHeight; ++y) {
-            memcpy(dstPtr, srcPtr, mCropWidth * 3);
-            srcPtr += mWidth * 3;
-            dstPtr += buf->stride * 3;
-        }
+        copyPlane((uint8_t *)dst, buf->stride * 3, (const uint8_t *)data, mWidth * 3,
+                mCropWidth * 3, mCropHeight);
     } else if (mColorFormat == OMX_COLOR_Format32bitARGB8888) {
         if ((size_t)mWidth * mHeight * 4 > size) {
             goto skip_copying;
@@ -343,14 +431,8 @@ std::list<FrameRenderTracker::Info> SoftwareRenderer::render(
         if ((size_t)mWidth * mHeight * 4 > size) {
             goto skip_copying;
         }
-        uint8_t* srcPtr = (uint8_t*)data;
-        uint8_t* dstPtr = (uint8_t*)dst;
-
-        for (size_t y = 0; y < (size_t)mCropHeight; ++y) {
-            memcpy(dstPtr, srcPtr, mCropWidth * 4);
-            srcPtr += mWidth * 4;
-            dstPtr += buf->stride * 4;
-        }
+        copyPlane((uint8_t *)dst, buf->stride * 4, (const uint8_t *)data, mWidth * 4,
+                mCropWidth * 4, mCropHeight);
     } else {
         LOG_ALWAYS_FATAL("bad color format %#x", mColorFormat);
     }
@@ -379,6 +461,11 @@ skip_copying:
         ALOGW("Surface::queueBuffer returned error %d", err);
     } else {
         mRenderTracker.onFrameQueued(mediaTimeUs, (GraphicBuffer *)buf, Fence::NO_FENCE);
+
+        nsecs_t renderNs = systemTime() - startNs;
+        ++mNumFramesRendered;
+        mTotalRenderTimeNs += renderNs;
+        mMaxRenderTimeNs = std::max(mMaxRenderTimeNs, renderNs);
     }
 
     buf = NULL;
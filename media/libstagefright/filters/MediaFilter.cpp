@@ -304,7 +304,8 @@ void MediaFilter::postDrainThisBuffer(BufferInfo *info) {
     sp<AMessage> reply = new AMessage(kWhatOutputBufferDrained, this);
     reply->setInt32("buffer-id", info->mBufferID);
 
-    mBufferChannel->drainThisBuffer(info->mBufferID, info->mOutputFlags);
+    mBufferChannel->drainThisBuffer(
+            info->mBufferID, info->mOutputFlags | OMX_BUFFERFLAG_ENDOFFRAME);
 
     info->mStatus = BufferInfo::OWNED_BY_UPSTREAM;
 }
@@ -18,6 +18,9 @@
 
 #include <media/stagefright/foundation/ADebug.h>
 
+#include <endian.h>
+#include <string.h>
+
 namespace android {
 
 ABitReader::ABitReader(const uint8_t *data, size_t size)
@@ -37,9 +40,19 @@ bool ABitReader::fillReservoir() {
         return false;
     }
 
+    if (mSize >= sizeof(mReservoir)) {
+        uint64_t bytes;
+        memcpy(&bytes, mData, sizeof(bytes));  // unaligned load
+        mReservoir = be64toh(bytes);
+        mData += sizeof(bytes);
+        mSize -= sizeof(bytes);
+        mNumBitsLeft = 64;
+        return true;
+    }
+
     mReservoir = 0;
     size_t i;
-    for (i = 0; mSize > 0 && i < 4; ++i) {
+    for (i = 0; mSize > 0 && i < 8; ++i) {
         mReservoir = (mReservoir << 8) | *mData;
 
         ++mData;
@@ -47,7 +60,7 @@ bool ABitReader::fillReservoir() {
     }
 
     mNumBitsLeft = 8 * i;
-    mReservoir <<= 32 - mNumBitsLeft;
+    mReservoir <<= 64 - mNumBitsLeft;
     return true;
 }
 
@@ -68,7 +81,20 @@ bool ABitReader::getBitsGraceful(size_t n, uint32_t *out) {
         return false;
     }
 
-    uint32_t result = 0;
+    if (n == 0) {
+        *out = 0;
+        return true;
+    }
+
+    if (n <= mNumBitsLeft) {
+        *out = mReservoir >> (64 - n);
+        mReservoir <<= n;
+        mNumBitsLeft -= n;
+        return true;
+    }
+
+    // the bits straddle the end of the reservoir
+    uint64_t result = 0;
     while (n > 0) {
         if (mNumBitsLeft == 0) {
             if (!fillReservoir()) {
@@ -81,7 +107,7 @@ bool ABitReader::getBitsGraceful(size_t n, uint32_t *out) {
             m = mNumBitsLeft;
         }
 
-        result = (result << m) | (mReservoir >> (32 - m));
+        result = (result << m) | (mReservoir >> (64 - m));
         mReservoir <<= m;
         mNumBitsLeft -= m;
 
@@ -93,17 +119,62 @@ bool ABitReader::getBitsGraceful(size_t n, uint32_t *out) {
 }
 
 bool ABitReader::skipBits(size_t n) {
-    uint32_t dummy;
-    while (n > 32) {
-        if (!getBitsGraceful(32, &dummy)) {
+    while (n > mNumBitsLeft) {
+        n -= mNumBitsLeft;
+        mReservoir = 0;
+        mNumBitsLeft = 0;
+        if (!fillReservoir()) {
             return false;
         }
-        n -= 32;
     }
 
-    if (n > 0) {
-        return getBitsGraceful(n, &dummy);
+    mReservoir = n < 64 ? mReservoir << n : 0;
+    mNumBitsLeft -= n;
+    return true;
+}
+
+bool ABitReader::getUEGolombGraceful(uint32_t *out) {
+    // the common case, where the whole code is in the reservoir
+    if (mReservoir != 0) {
+        const size_t numZeros = __builtin_clzll(mReservoir);
+        const size_t length = 2 * numZeros + 1;
+        if (numZeros < 32 && length <= mNumBitsLeft) {
+            *out = (mReservoir >> (64 - length)) - 1;
+            mReservoir <<= length;
+            mNumBitsLeft -= length;
+            return true;
+        }
+    }
+
+    size_t numZeros = 0;
+    for (;;) {
+        uint32_t bit;
+        if (!getBitsGraceful(1, &bit)) {
+            return false;
+        }
+        if (bit != 0) {
+            break;
+        }
+        ++numZeros;
     }
+
+    uint32_t x;
+    if (numZeros >= 32) {
+        (void)skipBits(numZeros);
+        return false;
+    } else if (!getBitsGraceful(numZeros, &x)) {
+        return false;
+    }
+    *out = x + (1u << numZeros) - 1;
+    return true;
+}
+
+bool ABitReader::getSEGolombGraceful(int32_t *out) {
+    uint32_t codeNum;
+    if (!getUEGolombGraceful(&codeNum)) {
+        return false;
+    }
+    *out = (codeNum & 1) ? (int32_t)((codeNum + 1) / 2) : -(int32_t)(codeNum / 2);
     return true;
 }
 
@@ -114,13 +185,17 @@ void ABitReader::putBits(uint32_t x, size_t n) {
 
     CHECK_LE(n, 32u);
 
-    while (mNumBitsLeft + n > 32) {
+    if (n == 0) {
+        return;
+    }
+
+    while (mNumBitsLeft + n > 64) {
         mNumBitsLeft -= 8;
         --mData;
         ++mSize;
     }
 
-    mReservoir = (mReservoir >> n) | (x << (32 - n));
+    mReservoir = (mReservoir >> n) | ((uint64_t)x << (64 - n));
     mNumBitsLeft += n;
 }
 
@@ -177,7 +252,7 @@ bool NALBitReader::fillReservoir() {
 
     mReservoir = 0;
     size_t i = 0;
-    while (mSize > 0 && i < 4) {
+    while (mSize > 0 && i < 8) {
         bool isEmulationPreventionByte = (mNumZeros >= 2 && *mData == 3);
 
         if (*mData == 0) {
@@ -196,8 +271,13 @@ bool NALBitReader::fillReservoir() {
         --mSize;
     }
 
+    if (i == 0) {
+        // only emulation prevention bytes were left
+        mOverRead = true;
+        return false;
+    }
     mNumBitsLeft = 8 * i;
-    mReservoir <<= 32 - mNumBitsLeft;
+    mReservoir <<= 64 - mNumBitsLeft;
     return true;
 }
 
@@ -16,6 +16,7 @@
 
 #include "ABuffer.h"
 
+#include "ABufferPool.h"
 #include "ADebug.h"
 #include "ALooper.h"
 #include "AMessage.h"
@@ -70,6 +71,26 @@ ABuffer::~ABuffer() {
     setMediaBufferBase(NULL);
 }
 
+// static
+void *ABuffer::operator new(size_t size) {
+    return ABufferPool::AllocateUnpooled(size);
+}
+
+// static
+void ABuffer::operator delete(void *object) {
+    ABufferPool::Free(object);
+}
+
+// static
+void *ABuffer::operator new(size_t /* size */, void *storage) {
+    return storage;
+}
+
+// static
+void ABuffer::operator delete(void * /* object */, void * /* storage */) {
+    // the storage belongs to ABufferPool, which frees it if construction fails
+}
+
 void ABuffer::setRange(size_t offset, size_t size) {
     CHECK_LE(offset, mCapacity);
     CHECK_LE(offset + size, mCapacity);
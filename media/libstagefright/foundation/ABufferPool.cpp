@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ABufferPool"
+#include <utils/Log.h>
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include <utils/threads.h>
+
+#include "ABufferPool.h"
+#include "ADebug.h"
+
+namespace android {
+
+// An ABuffer is preceded by a header. A pooled ABuffer is followed by its data.
+struct ABufferPool::Header {
+    uint32_t mSizeClass;
+    uint32_t mReserved[3];      // keeps the buffer and its data 16 byte aligned
+};
+
+static const uint32_t kUnpooled = UINT32_MAX;
+static const size_t kObjectSize = (sizeof(ABuffer) + 15) & ~(size_t)15;
+
+static const size_t kMinSizeClassShift = 8;     // 256 bytes
+static const size_t kNumSizeClasses = 13;       // up to 1 MB
+static const size_t kMaxPooledCapacity = (size_t)1 << (kMinSizeClassShift + kNumSizeClasses - 1);
+
+// memory kept for reuse in each size class
+static const size_t kMaxCachedBytes = 1 << 20;
+static const size_t kMinCachedBlocks = 2;
+static const size_t kMaxCachedBlocks = 64;
+
+static std::atomic<uint64_t> gAllocated(0);
+static std::atomic<uint64_t> gReused(0);
+static std::atomic<uint64_t> gReleased(0);
+static std::atomic<uint64_t> gFreed(0);
+
+struct ABufferPool::SizeClass {
+    Mutex mLock;
+    std::vector<Header *> mBlocks;
+};
+
+static size_t dataSize(uint32_t sizeClass) {
+    return (size_t)1 << (kMinSizeClassShift + sizeClass);
+}
+
+// static
+ABufferPool::SizeClass *ABufferPool::GetSizeClasses() {
+    // never deleted, as buffers may be released by static destructors
+    static SizeClass *sizeClasses = new SizeClass[kNumSizeClasses];
+    return sizeClasses;
+}
+
+// static
+sp<ABuffer> ABufferPool::Acquire(size_t capacity) {
+    if (capacity > kMaxPooledCapacity) {
+        return new ABuffer(capacity);
+    }
+    uint32_t sizeClass = 0;
+    while (dataSize(sizeClass) < capacity) {
+        ++sizeClass;
+    }
+
+    Header *header = NULL;
+    SizeClass *pool = &GetSizeClasses()[sizeClass];
+    {
+        Mutex::Autolock autoLock(pool->mLock);
+        if (!pool->mBlocks.empty()) {
+            header = pool->mBlocks.back();
+            pool->mBlocks.pop_back();
+        }
+    }
+    if (header != NULL) {
+        ++gReused;
+    } else {
+        header = (Header *)malloc(sizeof(Header) + kObjectSize + dataSize(sizeClass));
+        if (header == NULL) {
+            // leave the failure to ABuffer, which reports it with a 0 capacity
+            return new ABuffer(capacity);
+        }
+        ++gAllocated;
+        header->mSizeClass = sizeClass;
+    }
+    uint8_t *object = (uint8_t *)(header + 1);
+    return new (object) ABuffer(object + kObjectSize, capacity);
+}
+
+// static
+void *ABufferPool::AllocateUnpooled(size_t size) {
+    Header *header = (Header *)::operator new(sizeof(Header) + size);
+    header->mSizeClass = kUnpooled;
+    return header + 1;
+}
+
+// static
+void ABufferPool::Free(void *object) {
+    if (object == NULL) {
+        return;
+    }
+    Header *header = (Header *)object - 1;
+    if (header->mSizeClass == kUnpooled) {
+        ::operator delete(header);
+        return;
+    }
+
+    SizeClass *pool = &GetSizeClasses()[header->mSizeClass];
+    const size_t maxBlocks = std::min(kMaxCachedBlocks, std::max(
+            kMinCachedBlocks, kMaxCachedBytes / dataSize(header->mSizeClass)));
+    {
+        Mutex::Autolock autoLock(pool->mLock);
+        if (pool->mBlocks.size() < maxBlocks) {
+            pool->mBlocks.push_back(header);
+            header = NULL;
+        }
+    }
+    if (header != NULL) {
+        ++gFreed;
+        free(header);
+    } else {
+        ++gReleased;
+    }
+}
+
+// static
+void ABufferPool::GetStats(Stats *stats) {
+    stats->mAllocated = gAllocated;
+    stats->mReused = gReused;
+    stats->mReleased = gReleased;
+    stats->mFreed = gFreed;
+    stats->mCachedBytes = 0;
+    SizeClass *sizeClasses = GetSizeClasses();
+    for (uint32_t i = 0; i < kNumSizeClasses; ++i) {
+        Mutex::Autolock autoLock(sizeClasses[i].mLock);
+        stats->mCachedBytes += sizeClasses[i].mBlocks.size() * dataSize(i);
+    }
+}
+
+// static
+void ABufferPool::Trim() {
+    SizeClass *sizeClasses = GetSizeClasses();
+    for (uint32_t i = 0; i < kNumSizeClasses; ++i) {
+        std::vector<Header *> blocks;
+        {
+            Mutex::Autolock autoLock(sizeClasses[i].mLock);
+            blocks.swap(sizeClasses[i].mBlocks);
+        }
+        for (Header *header : blocks) {
+            free(header);
+        }
+        gFreed += blocks.size();
+    }
+}
+
+}  // namespace android
@@ -23,9 +23,12 @@
 
 #include <sys/time.h>
 
+#include <algorithm>
+
 #include "ALooper.h"
 
 #include "AHandler.h"
+#include "ALooperExecutor.h"
 #include "ALooperRoster.h"
 #include "AMessage.h"
 
@@ -33,6 +36,9 @@ namespace android {
 
 ALooperRoster gLooperRoster;
 
+// messages delivered by a shared looper before it lets the other loopers run
+static const size_t kSharedBatchSize = 16;
+
 struct ALooper::LooperThread : public Thread {
     LooperThread(ALooper *looper, bool canCallJava)
         : Thread(canCallJava),
@@ -70,7 +76,22 @@ int64_t ALooper::GetNowUs() {
 }
 
 ALooper::ALooper()
-    : mRunningLocally(false) {
+    : mImmediateEvents(NULL),
+      mImmediateHead(NULL),
+      mImmediateTail(NULL),
+      mWaiting(false),
+      mNextSequence(0),
+      mQueueDepth(0),
+      mMaxQueueDepth(0),
+      mDelivered(0),
+      mTotalLatencyUs(0),
+      mMaxLatencyUs(0),
+      mRunningLocally(false),
+      mUseSharedExecutor(false),
+      mRunningShared(false),
+      mSharedState(kSharedIdle),
+      mSharedThreadId(NULL),
+      mSharedTimerUs(-1) {
     // clean up stale AHandlers. Doing it here instead of in the destructor avoids
     // the side effect of objects being deleted from the unregister function recursively.
     gLooperRoster.unregisterStaleHandlers();
@@ -78,6 +99,14 @@ ALooper::ALooper()
 
 ALooper::~ALooper() {
     stop();
+
+    Mutex::Autolock autoLock(mLock);
+    takeImmediateEvents_l();
+    while (mImmediateHead != NULL) {
+        ImmediateEvent *event = mImmediateHead;
+        mImmediateHead = event->mNext;
+        delete event;
+    }
     // stale AHandlers are now cleaned up in the constructor of the next ALooper to come along
 }
 
@@ -85,6 +114,11 @@ void ALooper::setName(const char *name) {
     mName = name;
 }
 
+void ALooper::setUseSharedExecutor(bool shared) {
+    Mutex::Autolock autoLock(mLock);
+    mUseSharedExecutor = shared;
+}
+
 ALooper::handler_id ALooper::registerHandler(const sp<AHandler> &handler) {
     return gLooperRoster.registerHandler(this, handler);
 }
@@ -99,7 +133,7 @@ status_t ALooper::start(
         {
             Mutex::Autolock autoLock(mLock);
 
-            if (mThread != NULL || mRunningLocally) {
+            if (mThread != NULL || mRunningLocally || mRunningShared) {
                 return INVALID_OPERATION;
             }
 
@@ -114,10 +148,18 @@ status_t ALooper::start(
 
     Mutex::Autolock autoLock(mLock);
 
-    if (mThread != NULL || mRunningLocally) {
+    if (mThread != NULL || mRunningLocally || mRunningShared) {
         return INVALID_OPERATION;
     }
 
+    if (mUseSharedExecutor && !canCallJava && priority == PRIORITY_DEFAULT) {
+        mRunningShared = true;
+        mSharedTimerUs = -1;
+        // deliver what was posted before start()
+        scheduleShared();
+        return OK;
+    }
+
     mThread = new LooperThread(this, canCallJava);
 
     status_t err = mThread->run(
@@ -132,17 +174,26 @@ status_t ALooper::start(
 status_t ALooper::stop() {
     sp<LooperThread> thread;
     bool runningLocally;
+    bool runningShared;
 
     {
         Mutex::Autolock autoLock(mLock);
 
         thread = mThread;
         runningLocally = mRunningLocally;
+        runningShared = mRunningShared;
         mThread.clear();
         mRunningLocally = false;
+        mRunningShared = false;
+
+        // wait for the message being delivered, unless this is the thread delivering it
+        while (runningShared && mSharedState == kSharedRunning
+                && mSharedThreadId != androidGetThreadId()) {
+            mSharedIdleCondition.wait(mLock);
+        }
     }
 
-    if (thread == NULL && !runningLocally) {
+    if (thread == NULL && !runningLocally && !runningShared) {
         return INVALID_OPERATION;
     }
 
@@ -156,7 +207,7 @@ status_t ALooper::stop() {
         mRepliesCondition.broadcast();
     }
 
-    if (!runningLocally && !thread->isCurrentThread()) {
+    if (thread != NULL && !runningLocally && !thread->isCurrentThread()) {
         // If not running locally and this thread _is_ the looper thread,
         // the loop() function will return and never be called again.
         thread->requestExitAndWait();
@@ -166,29 +217,112 @@ status_t ALooper::stop() {
 }
 
 void ALooper::post(const sp<AMessage> &msg, int64_t delayUs) {
-    Mutex::Autolock autoLock(mLock);
-
-    int64_t whenUs;
-    if (delayUs > 0) {
-        whenUs = GetNowUs() + delayUs;
-    } else {
-        whenUs = GetNowUs();
+    const uint32_t depth = ++mQueueDepth;
+    uint32_t maxDepth = mMaxQueueDepth.load(std::memory_order_relaxed);
+    while (depth > maxDepth
+            && !mMaxQueueDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed)) {
     }
 
-    List<Event>::iterator it = mEventQueue.begin();
-    while (it != mEventQueue.end() && (*it).mWhenUs <= whenUs) {
-        ++it;
+    if (delayUs <= 0) {
+        // Most messages are posted without delay: append them to the queue without
+        // taking mLock, unless loop() is waiting and must be woken up.
+        ImmediateEvent *event = new ImmediateEvent;
+        event->mEvent.mWhenUs = GetNowUs();
+        event->mEvent.mSequence = mNextSequence++;
+        event->mEvent.mMessage = msg;
+        event->mNext = mImmediateEvents.load(std::memory_order_relaxed);
+        while (!mImmediateEvents.compare_exchange_weak(event->mNext, event)) {
+        }
+        // pairs with loop() setting mWaiting before it checks mImmediateEvents
+        if (mWaiting) {
+            Mutex::Autolock autoLock(mLock);
+            mQueueChangedCondition.signal();
+        }
+        if (mRunningShared) {
+            scheduleShared();
+        }
+        return;
     }
 
+    Mutex::Autolock autoLock(mLock);
+
     Event event;
-    event.mWhenUs = whenUs;
+    event.mWhenUs = GetNowUs() + delayUs;
+    event.mSequence = mNextSequence++;
     event.mMessage = msg;
 
-    if (it == mEventQueue.begin()) {
+    mEventQueue.push_back(event);
+    std::push_heap(mEventQueue.begin(), mEventQueue.end(), EventLater());
+
+    if (mEventQueue.front().mSequence == event.mSequence) {
         mQueueChangedCondition.signal();
+        if (mRunningShared && (mSharedTimerUs < 0 || event.mWhenUs < mSharedTimerUs)) {
+            mSharedTimerUs = event.mWhenUs;
+            ALooperExecutor::Get()->scheduleAt(this, event.mWhenUs);
+        }
     }
+}
 
-    mEventQueue.insert(it, event);
+// moves the events pushed by post() to the end of mImmediateHead
+void ALooper::takeImmediateEvents_l() {
+    ImmediateEvent *event = mImmediateEvents.exchange(NULL);
+    if (event == NULL) {
+        return;
+    }
+    // reverse the stack to posting order
+    ImmediateEvent *head = NULL;
+    ImmediateEvent *tail = event;
+    while (event != NULL) {
+        ImmediateEvent *next = event->mNext;
+        event->mNext = head;
+        head = event;
+        event = next;
+    }
+    if (mImmediateHead == NULL) {
+        mImmediateHead = head;
+    } else {
+        mImmediateTail->mNext = head;
+    }
+    mImmediateTail = tail;
+}
+
+bool ALooper::takeDueEvent_l(Event *event, int64_t *delayUs) {
+    takeImmediateEvents_l();
+
+    // the next event is the earliest of the oldest immediate event and the top of the heap
+    const bool immediate = mImmediateHead != NULL
+            && (mEventQueue.empty()
+                    || !EventLater()(mImmediateHead->mEvent, mEventQueue.front()));
+    if (!immediate) {
+        if (mEventQueue.empty()) {
+            *delayUs = -1;
+            return false;
+        }
+        *delayUs = mEventQueue.front().mWhenUs - GetNowUs();
+        if (*delayUs > 0) {
+            return false;
+        }
+    }
+
+    if (immediate) {
+        ImmediateEvent *next = mImmediateHead;
+        mImmediateHead = next->mNext;
+        *event = next->mEvent;
+        delete next;
+    } else {
+        std::pop_heap(mEventQueue.begin(), mEventQueue.end(), EventLater());
+        *event = mEventQueue.back();
+        mEventQueue.pop_back();
+    }
+
+    --mQueueDepth;
+    const int64_t latencyUs = GetNowUs() - event->mWhenUs;
+    ++mDelivered;
+    mTotalLatencyUs += latencyUs;
+    if (latencyUs > mMaxLatencyUs) {
+        mMaxLatencyUs = latencyUs;
+    }
+    return true;
 }
 
 bool ALooper::loop() {
@@ -199,22 +333,20 @@ bool ALooper::loop() {
         if (mThread == NULL && !mRunningLocally) {
             return false;
         }
-        if (mEventQueue.empty()) {
-            mQueueChangedCondition.wait(mLock);
-            return true;
-        }
-        int64_t whenUs = (*mEventQueue.begin()).mWhenUs;
-        int64_t nowUs = GetNowUs();
-
-        if (whenUs > nowUs) {
-            int64_t delayUs = whenUs - nowUs;
-            mQueueChangedCondition.waitRelative(mLock, delayUs * 1000ll);
+        int64_t delayUs;
+        if (!takeDueEvent_l(&event, &delayUs)) {
+            mWaiting = true;
+            if (mImmediateEvents.load() == NULL) {
+                if (delayUs < 0) {
+                    mQueueChangedCondition.wait(mLock);
+                } else {
+                    mQueueChangedCondition.waitRelative(mLock, delayUs * 1000ll);
+                }
+            }
+            mWaiting = false;
 
             return true;
         }
-
-        event = *mEventQueue.begin();
-        mEventQueue.erase(mEventQueue.begin());
     }
 
     event.mMessage->deliver();
@@ -227,6 +359,85 @@ bool ALooper::loop() {
     return true;
 }
 
+void ALooper::scheduleShared() {
+    int expected = kSharedIdle;
+    if (mSharedState.compare_exchange_strong(expected, kSharedScheduled)) {
+        ALooperExecutor::Get()->schedule(this);
+    }
+}
+
+void ALooper::runShared() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        mSharedState = kSharedRunning;
+        mSharedThreadId = androidGetThreadId();
+    }
+
+    // deliver a batch of messages at most, so that other loopers get their turn
+    for (size_t i = 0; i < kSharedBatchSize && mRunningShared; ++i) {
+        Event event;
+        {
+            Mutex::Autolock autoLock(mLock);
+            int64_t delayUs;
+            if (!takeDueEvent_l(&event, &delayUs)) {
+                break;
+            }
+        }
+        event.mMessage->deliver();
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    mSharedThreadId = NULL;
+    // pairs with post() pushing on mImmediateEvents before it calls scheduleShared()
+    mSharedState = kSharedIdle;
+    mSharedIdleCondition.broadcast();
+    if (!mRunningShared) {
+        return;
+    }
+    if (mImmediateEvents.load() != NULL || mImmediateHead != NULL) {
+        scheduleShared();
+    } else if (!mEventQueue.empty()) {
+        const int64_t whenUs = mEventQueue.front().mWhenUs;
+        if (whenUs <= GetNowUs()) {
+            scheduleShared();
+        } else if (mSharedTimerUs < 0 || whenUs < mSharedTimerUs) {
+            mSharedTimerUs = whenUs;
+            ALooperExecutor::Get()->scheduleAt(this, whenUs);
+        }
+    }
+}
+
+void ALooper::onSharedTimer(int64_t whenUs) {
+    {
+        Mutex::Autolock autoLock(mLock);
+        if (whenUs == mSharedTimerUs) {
+            mSharedTimerUs = -1;
+        }
+    }
+    if (mRunningShared) {
+        scheduleShared();
+    }
+}
+
+AString ALooper::debugStats(bool clear) {
+    Mutex::Autolock autoLock(mLock);
+    AString s = AStringPrintf(
+            "queue depth %u (max %u), %llu messages delivered",
+            mQueueDepth.load(), mMaxQueueDepth.load(), (unsigned long long)mDelivered);
+    if (mDelivered > 0) {
+        s.append(AStringPrintf(
+                ", latency mean %.2f ms max %.2f ms",
+                mTotalLatencyUs / 1000. / mDelivered, mMaxLatencyUs / 1000.));
+    }
+    if (clear) {
+        mMaxQueueDepth = mQueueDepth.load();
+        mDelivered = 0;
+        mTotalLatencyUs = 0;
+        mMaxLatencyUs = 0;
+    }
+    return s;
+}
+
 // to be called by AMessage::postAndAwaitResponse only
 sp<AReplyToken> ALooper::createReplyToken() {
     return new AReplyToken(this);
@@ -240,7 +451,7 @@ status_t ALooper::awaitResponse(const sp<AReplyToken> &replyToken, sp<AMessage>
     while (!replyToken->retrieveReply(response)) {
         {
             Mutex::Autolock autoLock(mLock);
-            if (mThread == NULL) {
+            if (mThread == NULL && !mRunningShared) {
                 return -ENOENT;
             }
         }
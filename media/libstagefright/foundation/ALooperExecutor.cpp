@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ALooperExecutor"
+
+#include <media/stagefright/foundation/ADebug.h>
+
+#include <cutils/properties.h>
+#include <utils/Log.h>
+
+#include <algorithm>
+#include <unistd.h>
+
+#include "ALooperExecutor.h"
+
+namespace android {
+
+static const size_t kMinWorkers = 2;
+static const size_t kMaxWorkers = 8;
+
+static Mutex gExecutorLock;
+static ALooperExecutor *gExecutor;
+
+struct ALooperExecutor::Worker : public Thread {
+    Worker(ALooperExecutor *executor)
+        : Thread(false /* canCallJava */),
+          mExecutor(executor) {
+    }
+
+    virtual bool threadLoop() {
+        return mExecutor->runWorker(this);
+    }
+
+    Mutex mLock;                        // protects mQueue
+    std::deque<wp<ALooper> > mQueue;    // runs the front, thieves take the back
+
+protected:
+    virtual ~Worker() {}
+
+private:
+    ALooperExecutor *mExecutor;
+
+    DISALLOW_EVIL_CONSTRUCTORS(Worker);
+};
+
+// static
+thread_local ALooperExecutor::Worker *ALooperExecutor::sCurrentWorker;
+
+// static
+ALooperExecutor *ALooperExecutor::Get() {
+    Mutex::Autolock autoLock(gExecutorLock);
+    if (gExecutor == NULL) {
+        // one thread per core by default
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        size_t numWorkers = property_get_int32(
+                "media.stagefright.looper_threads", cores > 0 ? cores : kMinWorkers);
+        numWorkers = std::min(std::max(numWorkers, kMinWorkers), kMaxWorkers);
+        // never deleted, as loopers may use it until the process exits
+        gExecutor = new ALooperExecutor(numWorkers);
+    }
+    return gExecutor;
+}
+
+// static
+AString ALooperExecutor::DebugStats() {
+    Mutex::Autolock autoLock(gExecutorLock);
+    if (gExecutor == NULL) {
+        return AString();
+    }
+    return AStringPrintf(
+            "%zu threads, %llu looper runs, %llu stolen",
+            gExecutor->mWorkers.size(),
+            (unsigned long long)gExecutor->mRuns.load(),
+            (unsigned long long)gExecutor->mSteals.load());
+}
+
+ALooperExecutor::ALooperExecutor(size_t numWorkers)
+    : mNextWorker(0),
+      mPending(0),
+      mIdle(0),
+      mRuns(0),
+      mSteals(0) {
+    for (size_t i = 0; i < numWorkers; ++i) {
+        mWorkers.push_back(new Worker(this));
+    }
+    // start the threads once mWorkers is complete, as they steal from each other
+    for (size_t i = 0; i < numWorkers; ++i) {
+        AString name = AStringPrintf("ALooperPool%zu", i);
+        status_t err = mWorkers[i]->run(name.c_str(), PRIORITY_DEFAULT);
+        CHECK_EQ(err, (status_t)OK);
+    }
+}
+
+void ALooperExecutor::schedule(const sp<ALooper> &looper) {
+    // prefer the current thread, which likely has the looper's data in its cache
+    Worker *worker = sCurrentWorker;
+    if (worker == NULL) {
+        worker = mWorkers[mNextWorker++ % mWorkers.size()].get();
+    }
+    {
+        Mutex::Autolock autoLock(worker->mLock);
+        worker->mQueue.push_back(looper);
+    }
+    ++mPending;
+    // pairs with runWorker() incrementing mIdle before it checks mPending
+    if (mIdle > 0) {
+        Mutex::Autolock autoLock(mLock);
+        mWorkAvailable.signal();
+    }
+}
+
+void ALooperExecutor::scheduleAt(const sp<ALooper> &looper, int64_t whenUs) {
+    Mutex::Autolock autoLock(mLock);
+    Timer timer;
+    timer.mWhenUs = whenUs;
+    timer.mLooper = looper;
+    mTimers.push_back(timer);
+    std::push_heap(mTimers.begin(), mTimers.end(), TimerLater());
+    if (mTimers.front().mWhenUs == whenUs) {
+        // the waiting workers need a shorter timeout
+        mWorkAvailable.signal();
+    }
+}
+
+sp<ALooper> ALooperExecutor::takeLooper(Worker *self) {
+    {
+        Mutex::Autolock autoLock(self->mLock);
+        while (!self->mQueue.empty()) {
+            sp<ALooper> looper = self->mQueue.front().promote();
+            self->mQueue.pop_front();
+            --mPending;
+            if (looper != NULL) {
+                return looper;
+            }
+        }
+    }
+    for (size_t i = 0; i < mWorkers.size() && mPending > 0; ++i) {
+        Worker *victim = mWorkers[i].get();
+        if (victim == self || victim->mLock.tryLock() != OK) {
+            continue;
+        }
+        sp<ALooper> looper;
+        while (looper == NULL && !victim->mQueue.empty()) {
+            looper = victim->mQueue.back().promote();
+            victim->mQueue.pop_back();
+            --mPending;
+        }
+        victim->mLock.unlock();
+        if (looper != NULL) {
+            ++mSteals;
+            return looper;
+        }
+    }
+    return NULL;
+}
+
+bool ALooperExecutor::runWorker(Worker *self) {
+    sCurrentWorker = self;
+
+    sp<ALooper> looper = takeLooper(self);
+    if (looper != NULL) {
+        ++mRuns;
+        looper->runShared();
+        return true;
+    }
+
+    std::vector<Timer> expired;
+    {
+        Mutex::Autolock autoLock(mLock);
+        const int64_t nowUs = ALooper::GetNowUs();
+        while (!mTimers.empty() && mTimers.front().mWhenUs <= nowUs) {
+            std::pop_heap(mTimers.begin(), mTimers.end(), TimerLater());
+            expired.push_back(mTimers.back());
+            mTimers.pop_back();
+        }
+        if (expired.empty()) {
+            ++mIdle;
+            if (mPending == 0) {
+                if (mTimers.empty()) {
+                    mWorkAvailable.wait(mLock);
+                } else {
+                    mWorkAvailable.waitRelative(
+                            mLock, (mTimers.front().mWhenUs - nowUs) * 1000ll);
+                }
+            }
+            --mIdle;
+        }
+    }
+
+    // the loopers are called without mLock, as they call the executor with their lock held
+    for (size_t i = 0; i < expired.size(); ++i) {
+        looper = expired[i].mLooper.promote();
+        if (looper != NULL) {
+            looper->onSharedTimer(expired[i].mWhenUs);
+        }
+    }
+    return true;
+}
+
+}  // namespace android
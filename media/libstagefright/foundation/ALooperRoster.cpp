@@ -22,6 +22,7 @@
 #include "ALooperRoster.h"
 
 #include "ADebug.h"
+#include "ALooperExecutor.h"
 #include "AHandler.h"
 #include "AMessage.h"
 
@@ -133,11 +134,19 @@ void ALooperRoster::dump(int fd, const Vector<String16>& args) {
     size_t n = mHandlers.size();
     s.appendFormat(" %zu registered handlers:\n", n);
 
+    Vector<sp<ALooper> > loopers;
     for (size_t i = 0; i < n; i++) {
         s.appendFormat("  %d: ", mHandlers.keyAt(i));
         HandlerInfo &info = mHandlers.editValueAt(i);
         sp<ALooper> looper = info.mLooper.promote();
         if (looper != NULL) {
+            size_t j = 0;
+            while (j < loopers.size() && loopers[j] != looper) {
+                ++j;
+            }
+            if (j == loopers.size()) {
+                loopers.add(looper);
+            }
             s.append(looper->getName());
             sp<AHandler> handler = info.mHandler.promote();
             if (handler != NULL) {
@@ -166,6 +175,15 @@ void ALooperRoster::dump(int fd, const Vector<String16>& args) {
         }
         s.append("\n");
     }
+
+    s.appendFormat(" %zu loopers:\n", loopers.size());
+    for (size_t i = 0; i < loopers.size(); i++) {
+        s.appendFormat("  %s: %s\n", loopers[i]->getName(), loopers[i]->debugStats(clear).c_str());
+    }
+    AString executorStats = ALooperExecutor::DebugStats();
+    if (!executorStats.empty()) {
+        s.appendFormat(" shared executor: %s\n", executorStats.c_str());
+    }
     write(fd, s.string(), s.size());
 }
 
@@ -19,6 +19,7 @@
 //#define DUMP_STATS
 
 #include <ctype.h>
+#include <pthread.h>
 
 #include "AMessage.h"
 
@@ -38,6 +39,81 @@ namespace android {
 
 extern ALooperRoster gLooperRoster;
 
+// Names longer than this are copied instead of interned, to bound the growth of the atom table
+static const size_t kMaxInternedNameLength = 64;
+
+// Hash of the length and of the first and last 8 characters of a name, which is enough to
+// tell apart the keys in use without walking the whole name.
+__attribute__((no_sanitize("integer")))
+static inline uint32_t hashName(const char *name, size_t *len) {
+    const size_t n = strlen(name);
+    uint64_t head = 0;
+    uint64_t tail = 0;
+    memcpy(&head, name, n < 8 ? n : 8);
+    if (n > 8) {
+        memcpy(&tail, name + n - 8, 8);
+    }
+    const uint64_t hash = (head * 0x9e3779b97f4a7c15ull) ^ (tail * 0xc2b2ae3d27d4eb4full) ^ n;
+    *len = n;
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+// Per thread cache of recently interned names, to not take the AAtomizer lock for every item
+struct AtomCacheEntry {
+    const char *mAtom;
+    uint32_t mLength;
+    uint32_t mHash;
+};
+static const size_t kAtomCacheSize = 64;
+static thread_local AtomCacheEntry gAtomCache[kAtomCacheSize];
+
+static const char *internName(const char *name, size_t len, uint32_t hash) {
+    AtomCacheEntry &entry = gAtomCache[hash % kAtomCacheSize];
+    if (entry.mAtom == NULL || entry.mHash != hash || entry.mLength != len
+            || memcmp(entry.mAtom, name, len)) {
+        entry.mAtom = AAtomizer::Atomize(name);
+        entry.mLength = len;
+        entry.mHash = hash;
+    }
+    return entry.mAtom;
+}
+
+// Free lists of AMessage storage, one per thread, freed when the thread exits
+struct MessagePool {
+    void *mHead;        // each free block starts with a pointer to the next one
+    size_t mCount;
+};
+static const size_t kMaxPooledMessages = 8;
+static pthread_key_t gMessagePoolKey;
+static pthread_once_t gMessagePoolOnce = PTHREAD_ONCE_INIT;
+
+static void freeMessagePool(void *arg) {
+    MessagePool *pool = (MessagePool *)arg;
+    while (pool->mHead != NULL) {
+        void *next = *(void **)pool->mHead;
+        ::operator delete(pool->mHead);
+        pool->mHead = next;
+    }
+    free(pool);
+}
+
+static void createMessagePoolKey() {
+    CHECK_EQ(pthread_key_create(&gMessagePoolKey, freeMessagePool), 0);
+}
+
+static MessagePool *getMessagePool(bool create) {
+    pthread_once(&gMessagePoolOnce, createMessagePoolKey);
+    MessagePool *pool = (MessagePool *)pthread_getspecific(gMessagePoolKey);
+    if (pool == NULL && create) {
+        pool = (MessagePool *)calloc(1, sizeof(MessagePool));
+        if (pool != NULL && pthread_setspecific(gMessagePoolKey, pool) != 0) {
+            free(pool);
+            pool = NULL;
+        }
+    }
+    return pool;
+}
+
 status_t AReplyToken::setReply(const sp<AMessage> &reply) {
     if (mReplied) {
         ALOGE("trying to post a duplicate reply");
@@ -53,11 +129,13 @@ AMessage::AMessage(void)
     : mWhat(0),
       mTarget(0),
       mNumItems(0) {
+    memset(mIndex, 0, sizeof(mIndex));
 }
 
 AMessage::AMessage(uint32_t what, const sp<const AHandler> &handler)
     : mWhat(what),
       mNumItems(0) {
+    memset(mIndex, 0, sizeof(mIndex));
     setTarget(handler);
 }
 
@@ -65,6 +143,34 @@ AMessage::~AMessage() {
     clear();
 }
 
+// static
+void *AMessage::operator new(size_t size) {
+    if (size == sizeof(AMessage)) {
+        MessagePool *pool = getMessagePool(false /* create */);
+        if (pool != NULL && pool->mHead != NULL) {
+            void *ptr = pool->mHead;
+            pool->mHead = *(void **)ptr;
+            --pool->mCount;
+            return ptr;
+        }
+    }
+    return ::operator new(size);
+}
+
+// static
+void AMessage::operator delete(void *ptr, size_t size) {
+    if (ptr != NULL && size == sizeof(AMessage)) {
+        MessagePool *pool = getMessagePool(true /* create */);
+        if (pool != NULL && pool->mCount < kMaxPooledMessages) {
+            *(void **)ptr = pool->mHead;
+            pool->mHead = ptr;
+            ++pool->mCount;
+            return;
+        }
+    }
+    ::operator delete(ptr);
+}
+
 void AMessage::setWhat(uint32_t what) {
     mWhat = what;
 }
@@ -88,18 +194,20 @@ void AMessage::setTarget(const sp<const AHandler> &handler) {
 void AMessage::clear() {
     for (size_t i = 0; i < mNumItems; ++i) {
         Item *item = &mItems[i];
-        delete[] item->mName;
-        item->mName = NULL;
+        item->freeName();
         freeItemValue(item);
     }
     mNumItems = 0;
+    memset(mIndex, 0, sizeof(mIndex));
 }
 
 void AMessage::freeItemValue(Item *item) {
     switch (item->mType) {
         case kTypeString:
         {
-            delete item->u.stringValue;
+            if (!(item->mFlags & kItemStringInline)) {
+                delete item->u.stringValue;
+            }
             break;
         }
 
@@ -148,19 +256,25 @@ static void reportStats() {
 }
 #endif
 
-inline size_t AMessage::findItemIndex(const char *name, size_t len) const {
+inline size_t AMessage::findItemIndex(const char *name, size_t len, uint32_t hash) const {
 #ifdef DUMP_STATS
     size_t memchecks = 0;
+    size_t probes = 0;
 #endif
-    size_t i = 0;
-    for (; i < mNumItems; i++) {
-        if (len != mItems[i].mNameLength) {
+    size_t i = mNumItems;
+    for (size_t slot = hash % kIndexSize; mIndex[slot] != 0; slot = (slot + 1) % kIndexSize) {
+#ifdef DUMP_STATS
+        ++probes;
+#endif
+        const Item &item = mItems[mIndex[slot] - 1];
+        if (hash != item.mNameHash || len != item.mNameLength) {
             continue;
         }
 #ifdef DUMP_STATS
         ++memchecks;
 #endif
-        if (!memcmp(mItems[i].mName, name, len)) {
+        if (item.mName == name || !memcmp(item.mName, name, len)) {
+            i = mIndex[slot] - 1;
             break;
         }
     }
@@ -170,23 +284,75 @@ inline size_t AMessage::findItemIndex(const char *name, size_t len) const {
         ++gFindItemCalls;
         gAverageNumItems += mNumItems;
         gAverageNumMemChecks += memchecks;
-        gAverageNumChecks += i;
+        gAverageNumChecks += probes;
         reportStats();
     }
 #endif
     return i;
 }
 
-// assumes item's name was uninitialized or NULL
-void AMessage::Item::setName(const char *name, size_t len) {
+// adds mItems[i], which must not be in the index yet
+void AMessage::addItemToIndex(size_t i) {
+    size_t slot = mItems[i].mNameHash % kIndexSize;
+    while (mIndex[slot] != 0) {
+        slot = (slot + 1) % kIndexSize;
+    }
+    mIndex[slot] = i + 1;
+}
+
+inline size_t AMessage::findItemIndex(const char *name) const {
+    size_t len;
+    uint32_t hash = hashName(name, &len);
+    return findItemIndex(name, len, hash);
+}
+
+// assumes item's name was uninitialized or freed
+void AMessage::Item::setName(const char *name, size_t len, uint32_t hash, bool intern) {
     mNameLength = len;
-    mName = new char[len + 1];
-    memcpy((void*)mName, name, len + 1);
+    mNameHash = hash;
+    if (intern && len <= kMaxInternedNameLength) {
+        mName = internName(name, len, hash);
+        mFlags = 0;
+    } else {
+        mName = new char[len + 1];
+        memcpy((void*)mName, name, len + 1);
+        mFlags = kItemNameOwned;
+    }
+}
+
+void AMessage::Item::freeName() {
+    if (mFlags & kItemNameOwned) {
+        delete[] mName;
+    }
+    mName = NULL;
+}
+
+// assumes the previous value was freed, and that mType is kTypeString
+void AMessage::Item::setStringValue(const char *s, size_t len) {
+    if (len <= kMaxInlineStringLength) {
+        memcpy(u.inlineStringValue, s, len);
+        u.inlineStringValue[len] = '\0';
+        mInlineStringLength = len;
+        mFlags |= kItemStringInline;
+    } else {
+        u.stringValue = new AString(s, len);
+        mFlags &= ~kItemStringInline;
+    }
+}
+
+const char *AMessage::Item::stringValue(size_t *len) const {
+    if (mFlags & kItemStringInline) {
+        *len = mInlineStringLength;
+        return u.inlineStringValue;
+    }
+    *len = u.stringValue->size();
+    return u.stringValue->c_str();
 }
 
 AMessage::Item *AMessage::allocateItem(const char *name) {
-    size_t len = strlen(name);
-    size_t i = findItemIndex(name, len);
+    size_t len;
+    uint32_t hash = hashName(name, &len);
+    size_t i = findItemIndex(name, len, hash);
     Item *item;
 
     if (i < mNumItems) {
@@ -196,7 +362,8 @@ AMessage::Item *AMessage::allocateItem(const char *name) {
         CHECK(mNumItems < kMaxNumItems);
         i = mNumItems++;
         item = &mItems[i];
-        item->setName(name, len);
+        item->setName(name, len, hash, true /* intern */);
+        addItemToIndex(i);
     }
 
     return item;
@@ -204,7 +371,7 @@ AMessage::Item *AMessage::allocateItem(const char *name) {
 
 const AMessage::Item *AMessage::findItem(
         const char *name, Type type) const {
-    size_t i = findItemIndex(name, strlen(name));
+    size_t i = findItemIndex(name);
     if (i < mNumItems) {
         const Item *item = &mItems[i];
         return item->mType == type ? item : NULL;
@@ -214,7 +381,7 @@ const AMessage::Item *AMessage::findItem(
 }
 
 bool AMessage::findAsFloat(const char *name, float *value) const {
-    size_t i = findItemIndex(name, strlen(name));
+    size_t i = findItemIndex(name);
     if (i < mNumItems) {
         const Item *item = &mItems[i];
         switch (item->mType) {
@@ -241,7 +408,7 @@ bool AMessage::findAsFloat(const char *name, float *value) const {
 }
 
 bool AMessage::findAsInt64(const char *name, int64_t *value) const {
-    size_t i = findItemIndex(name, strlen(name));
+    size_t i = findItemIndex(name);
     if (i < mNumItems) {
         const Item *item = &mItems[i];
         switch (item->mType) {
@@ -259,7 +426,7 @@ bool AMessage::findAsInt64(const char *name, int64_t *value) const {
 }
 
 bool AMessage::contains(const char *name) const {
-    size_t i = findItemIndex(name, strlen(name));
+    size_t i = findItemIndex(name);
     return i < mNumItems;
 }
 
@@ -294,7 +461,7 @@ void AMessage::setString(
         const char *name, const char *s, ssize_t len) {
     Item *item = allocateItem(name);
     item->mType = kTypeString;
-    item->u.stringValue = new AString(s, len < 0 ? strlen(s) : len);
+    item->setStringValue(s, len < 0 ? strlen(s) : len);
 }
 
 void AMessage::setString(
@@ -342,7 +509,9 @@ void AMessage::setRect(
 bool AMessage::findString(const char *name, AString *value) const {
     const Item *item = findItem(name, kTypeString);
     if (item) {
-        *value = *item->u.stringValue;
+        size_t len;
+        const char *s = item->stringValue(&len);
+        value->setTo(s, len);
         return true;
     }
     return false;
@@ -462,6 +631,7 @@ bool AMessage::senderAwaitsResponse(sp<AReplyToken> *replyToken) {
 sp<AMessage> AMessage::dup() const {
     sp<AMessage> msg = new AMessage(mWhat, mHandler.promote());
     msg->mNumItems = mNumItems;
+    memcpy(msg->mIndex, mIndex, sizeof(mIndex));
 
 #ifdef DUMP_STATS
     {
@@ -476,14 +646,23 @@ sp<AMessage> AMessage::dup() const {
         const Item *from = &mItems[i];
         Item *to = &msg->mItems[i];
 
-        to->setName(from->mName, from->mNameLength);
+        if (from->mFlags & kItemNameOwned) {
+            to->setName(from->mName, from->mNameLength, from->mNameHash, false /* intern */);
+        } else {
+            // atoms are never freed
+            to->mName = from->mName;
+            to->mNameLength = from->mNameLength;
+            to->mNameHash = from->mNameHash;
+            to->mFlags = 0;
+        }
         to->mType = from->mType;
 
         switch (from->mType) {
             case kTypeString:
             {
-                to->u.stringValue =
-                    new AString(*from->u.stringValue);
+                size_t len;
+                const char *s = from->stringValue(&len);
+                to->setStringValue(s, len);
                 break;
             }
 
@@ -584,11 +763,14 @@ AString AMessage::debugString(int32_t indent) const {
                         "void *%s = %p", item.mName, item.u.ptrValue);
                 break;
             case kTypeString:
+            {
+                size_t len;
                 tmp = AStringPrintf(
                         "string %s = \"%s\"",
                         item.mName,
-                        item.u.stringValue->c_str());
+                        item.stringValue(&len));
                 break;
+            }
             case kTypeObject:
                 tmp = AStringPrintf(
                         "RefBase *%s = %p", item.mName, item.u.refValue);
@@ -647,22 +829,24 @@ sp<AMessage> AMessage::FromParcel(const Parcel &parcel, size_t maxNestingLevel)
     sp<AMessage> msg = new AMessage();
     msg->setWhat(what);
 
-    msg->mNumItems = static_cast<size_t>(parcel.readInt32());
-    if (msg->mNumItems > kMaxNumItems) {
+    size_t numItems = static_cast<size_t>(parcel.readInt32());
+    if (numItems > kMaxNumItems) {
         ALOGE("Too large number of items clipped.");
-        msg->mNumItems = kMaxNumItems;
+        numItems = kMaxNumItems;
     }
 
-    for (size_t i = 0; i < msg->mNumItems; ++i) {
+    // mNumItems only counts the items which are fully initialized, so that the message
+    // can be released when parsing is aborted in the middle.
+    for (size_t i = 0; i < numItems; ++i) {
         Item *item = &msg->mItems[i];
 
         const char *name = parcel.readCString();
         if (name == NULL) {
             ALOGE("Failed reading name for an item. Parsing aborted.");
-            msg->mNumItems = i;
             break;
         }
 
+        const char *stringValue = NULL;
         item->mType = static_cast<Type>(parcel.readInt32());
         // setName() happens below so that we don't leak memory when parsing
         // is aborted in the middle.
@@ -699,15 +883,13 @@ sp<AMessage> AMessage::FromParcel(const Parcel &parcel, size_t maxNestingLevel)
 
             case kTypeString:
             {
-                const char *stringValue = parcel.readCString();
+                stringValue = parcel.readCString();
                 if (stringValue == NULL) {
                     ALOGE("Failed reading string value from a parcel. "
                         "Parsing aborted.");
-                    msg->mNumItems = i;
+                    numItems = i;
                     continue;
                     // The loop will terminate subsequently.
-                } else {
-                    item->u.stringValue = new AString(stringValue);
                 }
                 break;
             }
@@ -740,7 +922,15 @@ sp<AMessage> AMessage::FromParcel(const Parcel &parcel, size_t maxNestingLevel)
             }
         }
 
-        item->setName(name, strlen(name));
+        // names from other processes are not interned, as they could grow the table forever
+        size_t len;
+        uint32_t hash = hashName(name, &len);
+        item->setName(name, len, hash, false /* intern */);
+        if (stringValue != NULL) {
+            item->setStringValue(stringValue, strlen(stringValue));
+        }
+        msg->addItemToIndex(i);
+        msg->mNumItems = i + 1;
     }
 
     return msg;
@@ -789,7 +979,8 @@ void AMessage::writeToParcel(Parcel *parcel) const {
 
             case kTypeString:
             {
-                parcel->writeCString(item.u.stringValue->c_str());
+                size_t len;
+                parcel->writeCString(item.stringValue(&len));
                 break;
             }
 
@@ -856,10 +1047,15 @@ sp<AMessage> AMessage::changesFrom(const sp<const AMessage> &other, bool deep) c
                 break;
 
             case kTypeString:
-                if (oitem == NULL || *item.u.stringValue != *oitem->u.stringValue) {
-                    diff->setString(item.mName, *item.u.stringValue);
+            {
+                size_t len, olen = 0;
+                const char *s = item.stringValue(&len);
+                const char *os = oitem == NULL ? NULL : oitem->stringValue(&olen);
+                if (oitem == NULL || len != olen || memcmp(s, os, len)) {
+                    diff->setString(item.mName, s, len);
                 }
                 break;
+            }
 
             case kTypeRect:
                 if (oitem == NULL || memcmp(&item.u.rectValue, &oitem->u.rectValue, sizeof(Rect))) {
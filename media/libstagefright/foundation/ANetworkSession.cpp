@@ -27,10 +27,13 @@
 #include <net/if.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ABufferPool.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/hexdump.h>
@@ -52,6 +55,23 @@ static uint64_t U64_AT(const uint8_t *ptr) {
 static const size_t kMaxUDPSize = 1500;
 static const int32_t kMaxUDPRetries = 200;
 
+// Number of datagrams received or sent with a single system call.
+static const size_t kMaxDatagramBatch = 16;
+
+// Number of fragments of a stream written with a single system call.
+static const size_t kMaxWriteFragments = 16;
+
+// Limits the work done for a single session before the others get a turn.
+// A session which reaches the limit stays ready and is visited again on the
+// next wakeup.
+static const size_t kMaxReadBytesPerWakeup = 65536;
+static const size_t kMaxDatagramsPerWakeup = 64;
+
+static const int kMaxEpollEvents = 32;
+
+// epoll data of the interrupt pipe. Session IDs start at 1.
+static const uint64_t kPipeEventData = 0;
+
 struct ANetworkSession::NetworkThread : public Thread {
     explicit NetworkThread(ANetworkSession *session);
 
@@ -96,6 +116,20 @@ struct ANetworkSession::Session : public RefBase {
     bool wantsToRead();
     bool wantsToWrite();
 
+    // Records events reported by epoll. As the socket is registered edge
+    // triggered, it is considered readable or writable until a call
+    // returns EAGAIN.
+    void addReadiness(uint32_t events);
+
+    bool canRead();
+    bool canWrite();
+    bool isReady();
+
+    // Returns whether the session was in mReadySessions.
+    bool setInReadyList(bool inList);
+
+    void setReadable(bool readable);
+
     status_t readMore();
     status_t writeMore();
 
@@ -126,9 +160,14 @@ private:
     sp<AMessage> mNotify;
     bool mSawReceiveFailure, mSawSendFailure;
     int32_t mUDPRetries;
+    bool mReadable, mWritable;
+    bool mInReadyList;
 
     List<Fragment> mOutFragments;
 
+    // Buffers for the next datagrams, kept across calls to readMore().
+    sp<ABuffer> mRecvBuffers[kMaxDatagramBatch];
+
     AString mInBuffer;
 
     int64_t mLastStallReportUs;
@@ -138,6 +177,13 @@ private:
 
     void dumpFragmentStats(const Fragment &frag);
 
+    status_t readDatagrams();
+    status_t writeDatagrams();
+
+    void postDatagram(
+            const sp<ABuffer> &buf, const struct sockaddr_in &remoteAddr,
+            int64_t nowUs);
+
     DISALLOW_EVIL_CONSTRUCTORS(Session);
 };
 ////////////////////////////////////////////////////////////////////////////////
@@ -170,6 +216,9 @@ ANetworkSession::Session::Session(
       mSawReceiveFailure(false),
       mSawSendFailure(false),
       mUDPRetries(kMaxUDPRetries),
+      mReadable(false),
+      mWritable(false),
+      mInReadyList(false),
       mLastStallReportUs(-1ll) {
     if (mState == CONNECTED) {
         struct sockaddr_in localAddr;
@@ -265,57 +314,128 @@ bool ANetworkSession::Session::wantsToWrite() {
             || (mState == DATAGRAM && !mOutFragments.empty()));
 }
 
-status_t ANetworkSession::Session::readMore() {
-    if (mState == DATAGRAM) {
-        CHECK_EQ(mMode, MODE_DATAGRAM);
+void ANetworkSession::Session::addReadiness(uint32_t events) {
+    if (events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+        mReadable = true;
+    }
+    if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+        mWritable = true;
+    }
+}
+
+bool ANetworkSession::Session::canRead() {
+    return mReadable && wantsToRead();
+}
+
+bool ANetworkSession::Session::canWrite() {
+    return mWritable && wantsToWrite();
+}
+
+bool ANetworkSession::Session::isReady() {
+    return canRead() || canWrite();
+}
+
+bool ANetworkSession::Session::setInReadyList(bool inList) {
+    bool wasInList = mInReadyList;
+    mInReadyList = inList;
+    return wasInList;
+}
+
+void ANetworkSession::Session::setReadable(bool readable) {
+    mReadable = readable;
+}
+
+void ANetworkSession::Session::postDatagram(
+        const sp<ABuffer> &buf, const struct sockaddr_in &remoteAddr,
+        int64_t nowUs) {
+    buf->meta()->setInt64("arrivalTimeUs", nowUs);
+
+    sp<AMessage> notify = mNotify->dup();
+    notify->setInt32("sessionID", mSessionID);
+    notify->setInt32("reason", kWhatDatagram);
+
+    uint32_t ip = ntohl(remoteAddr.sin_addr.s_addr);
+    notify->setString(
+            "fromAddr",
+            AStringPrintf(
+                "%u.%u.%u.%u",
+                ip >> 24,
+                (ip >> 16) & 0xff,
+                (ip >> 8) & 0xff,
+                ip & 0xff).c_str());
+
+    notify->setInt32("fromPort", ntohs(remoteAddr.sin_port));
+
+    notify->setBuffer("data", buf);
+    notify->post();
+}
+
+status_t ANetworkSession::Session::readDatagrams() {
+    struct mmsghdr msgs[kMaxDatagramBatch];
+    struct iovec iovs[kMaxDatagramBatch];
+    struct sockaddr_in remoteAddrs[kMaxDatagramBatch];
+
+    size_t numReceived = 0;
+    while (numReceived < kMaxDatagramsPerWakeup) {
+        for (size_t i = 0; i < kMaxDatagramBatch; ++i) {
+            if (mRecvBuffers[i] == NULL) {
+                mRecvBuffers[i] = ABufferPool::Acquire(kMaxUDPSize);
+            }
 
-        status_t err;
+            iovs[i].iov_base = mRecvBuffers[i]->base();
+            iovs[i].iov_len = mRecvBuffers[i]->capacity();
+
+            memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+            msgs[i].msg_hdr.msg_name = &remoteAddrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(remoteAddrs[i]);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_len = 0;
+        }
+
+        int n;
         do {
-            sp<ABuffer> buf = new ABuffer(kMaxUDPSize);
+            n = recvmmsg(mSocket, msgs, kMaxDatagramBatch, 0, NULL /* timeout */);
+        } while (n < 0 && errno == EINTR);
 
-            struct sockaddr_in remoteAddr;
-            socklen_t remoteAddrLen = sizeof(remoteAddr);
+        if (n < 0) {
+            return -errno;
+        }
 
-            ssize_t n;
-            do {
-                n = recvfrom(
-                        mSocket, buf->data(), buf->capacity(), 0,
-                        (struct sockaddr *)&remoteAddr, &remoteAddrLen);
-            } while (n < 0 && errno == EINTR);
+        int64_t nowUs = ALooper::GetNowUs();
 
-            err = OK;
-            if (n < 0) {
-                err = -errno;
-            } else if (n == 0) {
+        status_t err = OK;
+        for (int i = 0; i < n; ++i) {
+            if (msgs[i].msg_len == 0) {
                 err = -ECONNRESET;
-            } else {
-                buf->setRange(0, n);
+                continue;
+            }
 
-                int64_t nowUs = ALooper::GetNowUs();
-                buf->meta()->setInt64("arrivalTimeUs", nowUs);
+            sp<ABuffer> buf = mRecvBuffers[i];
+            mRecvBuffers[i].clear();
 
-                sp<AMessage> notify = mNotify->dup();
-                notify->setInt32("sessionID", mSessionID);
-                notify->setInt32("reason", kWhatDatagram);
+            buf->setRange(0, msgs[i].msg_len);
+            postDatagram(buf, remoteAddrs[i], nowUs);
+        }
 
-                uint32_t ip = ntohl(remoteAddr.sin_addr.s_addr);
-                notify->setString(
-                        "fromAddr",
-                        AStringPrintf(
-                            "%u.%u.%u.%u",
-                            ip >> 24,
-                            (ip >> 16) & 0xff,
-                            (ip >> 8) & 0xff,
-                            ip & 0xff).c_str());
+        if (err != OK) {
+            return err;
+        }
 
-                notify->setInt32("fromPort", ntohs(remoteAddr.sin_port));
+        numReceived += n;
+    }
 
-                notify->setBuffer("data", buf);
-                notify->post();
-            }
-        } while (err == OK);
+    return OK;
+}
+
+status_t ANetworkSession::Session::readMore() {
+    if (mState == DATAGRAM) {
+        CHECK_EQ(mMode, MODE_DATAGRAM);
+
+        status_t err = readDatagrams();
 
         if (err == -EAGAIN) {
+            mReadable = false;
             err = OK;
         }
 
@@ -336,25 +456,35 @@ status_t ANetworkSession::Session::readMore() {
         return err;
     }
 
-    char tmp[512];
+    char tmp[4096];
     ssize_t n;
-    do {
-        n = recv(mSocket, tmp, sizeof(tmp), 0);
-    } while (n < 0 && errno == EINTR);
-
+    size_t numRead = 0;
     status_t err = OK;
 
-    if (n > 0) {
-        mInBuffer.append(tmp, n);
+    while (numRead < kMaxReadBytesPerWakeup) {
+        do {
+            n = recv(mSocket, tmp, sizeof(tmp), 0);
+        } while (n < 0 && errno == EINTR);
+
+        if (n > 0) {
+            mInBuffer.append(tmp, n);
+            numRead += n;
 
 #if 0
-        ALOGI("in:");
-        hexdump(tmp, n);
+            ALOGI("in:");
+            hexdump(tmp, n);
 #endif
-    } else if (n < 0) {
-        err = -errno;
-    } else {
-        err = -ECONNRESET;
+        } else if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                mReadable = false;
+            } else {
+                err = -errno;
+            }
+            break;
+        } else {
+            err = -ECONNRESET;
+            break;
+        }
     }
 
     if (mMode == MODE_DATAGRAM) {
@@ -548,36 +678,56 @@ void ANetworkSession::Session::dumpFragmentStats(const Fragment & /* frag */) {
 #endif
 }
 
-status_t ANetworkSession::Session::writeMore() {
-    if (mState == DATAGRAM) {
-        CHECK(!mOutFragments.empty());
+status_t ANetworkSession::Session::writeDatagrams() {
+    struct mmsghdr msgs[kMaxDatagramBatch];
+    struct iovec iovs[kMaxDatagramBatch];
 
-        status_t err;
+    do {
+        size_t count = 0;
+        for (List<Fragment>::iterator it = mOutFragments.begin();
+                it != mOutFragments.end() && count < kMaxDatagramBatch;
+                ++it, ++count) {
+            iovs[count].iov_base = it->mBuffer->data();
+            iovs[count].iov_len = it->mBuffer->size();
+
+            memset(&msgs[count].msg_hdr, 0, sizeof(msgs[count].msg_hdr));
+            msgs[count].msg_hdr.msg_iov = &iovs[count];
+            msgs[count].msg_hdr.msg_iovlen = 1;
+            msgs[count].msg_len = 0;
+        }
+
+        int n;
         do {
+            n = sendmmsg(mSocket, msgs, count, 0);
+        } while (n < 0 && errno == EINTR);
+
+        if (n < 0) {
+            return -errno;
+        } else if (n == 0) {
+            return -ECONNRESET;
+        }
+
+        for (int i = 0; i < n; ++i) {
             const Fragment &frag = *mOutFragments.begin();
-            const sp<ABuffer> &datagram = frag.mBuffer;
+            if (frag.mFlags & FRAGMENT_FLAG_TIME_VALID) {
+                dumpFragmentStats(frag);
+            }
 
-            int n;
-            do {
-                n = send(mSocket, datagram->data(), datagram->size(), 0);
-            } while (n < 0 && errno == EINTR);
+            mOutFragments.erase(mOutFragments.begin());
+        }
+    } while (!mOutFragments.empty());
 
-            err = OK;
+    return OK;
+}
 
-            if (n > 0) {
-                if (frag.mFlags & FRAGMENT_FLAG_TIME_VALID) {
-                    dumpFragmentStats(frag);
-                }
+status_t ANetworkSession::Session::writeMore() {
+    if (mState == DATAGRAM) {
+        CHECK(!mOutFragments.empty());
 
-                mOutFragments.erase(mOutFragments.begin());
-            } else if (n < 0) {
-                err = -errno;
-            } else if (n == 0) {
-                err = -ECONNRESET;
-            }
-        } while (err == OK && !mOutFragments.empty());
+        status_t err = writeDatagrams();
 
         if (err == -EAGAIN) {
+            mWritable = false;
             if (!mOutFragments.empty()) {
                 ALOGI("%zu datagrams remain queued.", mOutFragments.size());
             }
@@ -623,36 +773,62 @@ status_t ANetworkSession::Session::writeMore() {
     CHECK_EQ(mState, CONNECTED);
     CHECK(!mOutFragments.empty());
 
+    struct iovec iovs[kMaxWriteFragments];
+
     ssize_t n = -1;
     while (!mOutFragments.empty()) {
-        const Fragment &frag = *mOutFragments.begin();
+        size_t count = 0;
+        size_t total = 0;
+        for (List<Fragment>::iterator it = mOutFragments.begin();
+                it != mOutFragments.end() && count < kMaxWriteFragments;
+                ++it, ++count) {
+            iovs[count].iov_base = it->mBuffer->data();
+            iovs[count].iov_len = it->mBuffer->size();
+            total += it->mBuffer->size();
+        }
 
         do {
-            n = send(mSocket, frag.mBuffer->data(), frag.mBuffer->size(), 0);
+            n = writev(mSocket, iovs, count);
         } while (n < 0 && errno == EINTR);
 
         if (n <= 0) {
             break;
         }
 
-        frag.mBuffer->setRange(
-                frag.mBuffer->offset() + n, frag.mBuffer->size() - n);
+        size_t remaining = n;
+        while (remaining > 0) {
+            const Fragment &frag = *mOutFragments.begin();
 
-        if (frag.mBuffer->size() > 0) {
-            break;
-        }
+            if (remaining < frag.mBuffer->size()) {
+                frag.mBuffer->setRange(
+                        frag.mBuffer->offset() + remaining,
+                        frag.mBuffer->size() - remaining);
+                break;
+            }
+
+            remaining -= frag.mBuffer->size();
+
+            if (frag.mFlags & FRAGMENT_FLAG_TIME_VALID) {
+                dumpFragmentStats(frag);
+            }
 
-        if (frag.mFlags & FRAGMENT_FLAG_TIME_VALID) {
-            dumpFragmentStats(frag);
+            mOutFragments.erase(mOutFragments.begin());
         }
 
-        mOutFragments.erase(mOutFragments.begin());
+        if ((size_t)n < total) {
+            // The socket buffer is full.
+            break;
+        }
     }
 
     status_t err = OK;
 
     if (n < 0) {
-        err = -errno;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            mWritable = false;
+        } else {
+            err = -errno;
+        }
     } else if (n == 0) {
         err = -ECONNRESET;
     }
@@ -798,7 +974,8 @@ void ANetworkSession::Session::notify(NotificationReason reason) {
 ////////////////////////////////////////////////////////////////////////////////
 
 ANetworkSession::ANetworkSession()
-    : mNextSessionID(1) {
+    : mNextSessionID(1),
+      mEpollFd(-1) {
     mPipeFd[0] = mPipeFd[1] = -1;
 }
 
@@ -811,18 +988,50 @@ status_t ANetworkSession::start() {
         return INVALID_OPERATION;
     }
 
-    int res = pipe(mPipeFd);
+    int res = pipe2(mPipeFd, O_NONBLOCK | O_CLOEXEC);
     if (res != 0) {
         mPipeFd[0] = mPipeFd[1] = -1;
         return -errno;
     }
 
-    mThread = new NetworkThread(this);
+    status_t err = OK;
+    {
+        Mutex::Autolock autoLock(mLock);
+
+        mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (mEpollFd < 0) {
+            err = -errno;
+        } else {
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN;
+            ev.data.u64 = kPipeEventData;
+            if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mPipeFd[0], &ev) < 0) {
+                err = -errno;
+            }
+        }
+
+        // Sessions created before start().
+        for (size_t i = 0; err == OK && i < mSessions.size(); ++i) {
+            err = registerSession_l(mSessions.valueAt(i));
+        }
+    }
 
-    status_t err = mThread->run("ANetworkSession", ANDROID_PRIORITY_AUDIO);
+    if (err == OK) {
+        mThread = new NetworkThread(this);
+
+        err = mThread->run("ANetworkSession", ANDROID_PRIORITY_AUDIO);
+
+        if (err != OK) {
+            mThread.clear();
+        }
+    }
 
     if (err != OK) {
-        mThread.clear();
+        if (mEpollFd >= 0) {
+            close(mEpollFd);
+            mEpollFd = -1;
+        }
 
         close(mPipeFd[0]);
         close(mPipeFd[1]);
@@ -845,6 +1054,9 @@ status_t ANetworkSession::stop() {
 
     mThread.clear();
 
+    close(mEpollFd);
+    mEpollFd = -1;
+
     close(mPipeFd[0]);
     close(mPipeFd[1]);
     mPipeFd[0] = mPipeFd[1] = -1;
@@ -937,13 +1149,53 @@ status_t ANetworkSession::destroySession(int32_t sessionID) {
         return -ENOENT;
     }
 
+    const sp<Session> session = mSessions.valueAt(index);
+
+    // Another reference may keep the socket open for a little longer.
+    if (mEpollFd >= 0) {
+        epoll_ctl(mEpollFd, EPOLL_CTL_DEL, session->socket(), NULL);
+    }
+
     mSessions.removeItemsAt(index);
 
-    interrupt();
+    return OK;
+}
+
+void ANetworkSession::addSession_l(const sp<Session> &session) {
+    mSessions.add(session->sessionID(), session);
+
+    if (mEpollFd >= 0) {
+        status_t err = registerSession_l(session);
+        if (err != OK) {
+            ALOGE("Unable to watch socket %d, failed w/ error %d (%s)",
+                  session->socket(), err, strerror(-err));
+        }
+    }
+}
+
+status_t ANetworkSession::registerSession_l(const sp<Session> &session) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.u64 = session->sessionID();
+
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, session->socket(), &ev) < 0) {
+        return -errno;
+    }
 
     return OK;
 }
 
+bool ANetworkSession::markReady_l(const sp<Session> &session) {
+    if (!session->isReady() || session->setInReadyList(true)) {
+        return false;
+    }
+
+    mReadySessions.push_back(session->sessionID());
+
+    return mReadySessions.size() == 1;
+}
+
 // static
 status_t ANetworkSession::MakeSocketNonBlocking(int s) {
     int flags = fcntl(s, F_GETFL, 0);
@@ -1148,9 +1400,7 @@ status_t ANetworkSession::createClientOrServer(
         session->setMode(Session::MODE_RTSP);
     }
 
-    mSessions.add(session->sessionID(), session);
-
-    interrupt();
+    addSession_l(session);
 
     *sessionID = session->sessionID();
 
@@ -1217,7 +1467,11 @@ status_t ANetworkSession::sendRequest(
 
     status_t err = session->sendRequest(data, size, timeValid, timeUs);
 
-    interrupt();
+    // The thread is only woken up for the first of the ready sessions, and
+    // the socket of a session which is not writable reports when it is.
+    if (markReady_l(session)) {
+        interrupt();
+    }
 
     return err;
 }
@@ -1243,169 +1497,167 @@ void ANetworkSession::interrupt() {
         n = write(mPipeFd[1], &dummy, 1);
     } while (n < 0 && errno == EINTR);
 
-    if (n < 0) {
+    // EAGAIN means that a wakeup is pending already.
+    if (n < 0 && errno != EAGAIN) {
         ALOGW("Error writing to pipe (%s)", strerror(errno));
     }
 }
 
 void ANetworkSession::threadLoop() {
-    fd_set rs, ws;
-    FD_ZERO(&rs);
-    FD_ZERO(&ws);
-
-    FD_SET(mPipeFd[0], &rs);
-    int maxFd = mPipeFd[0];
-
+    int timeoutMs;
     {
         Mutex::Autolock autoLock(mLock);
+        timeoutMs = mReadySessions.empty() ? -1 : 0;
+    }
 
-        for (size_t i = 0; i < mSessions.size(); ++i) {
-            const sp<Session> &session = mSessions.valueAt(i);
+    struct epoll_event events[kMaxEpollEvents];
+    int res = epoll_wait(mEpollFd, events, kMaxEpollEvents, timeoutMs);
 
-            int s = session->socket();
+    if (res < 0) {
+        if (errno == EINTR) {
+            return;
+        }
 
-            if (s < 0) {
-                continue;
-            }
+        ALOGE("epoll_wait failed w/ error %d (%s)", errno, strerror(errno));
+        return;
+    }
 
-            if (session->wantsToRead()) {
-                FD_SET(s, &rs);
-                if (s > maxFd) {
-                    maxFd = s;
-                }
-            }
+    Mutex::Autolock autoLock(mLock);
 
-            if (session->wantsToWrite()) {
-                FD_SET(s, &ws);
-                if (s > maxFd) {
-                    maxFd = s;
-                }
+    for (int i = 0; i < res; ++i) {
+        if (events[i].data.u64 == kPipeEventData) {
+            char tmp[64];
+            ssize_t n;
+            do {
+                n = read(mPipeFd[0], tmp, sizeof(tmp));
+            } while (n > 0 || (n < 0 && errno == EINTR));
+
+            if (n < 0 && errno != EAGAIN) {
+                ALOGW("Error reading from pipe (%s)", strerror(errno));
             }
+            continue;
         }
-    }
 
-    int res = select(maxFd + 1, &rs, &ws, NULL, NULL /* tv */);
+        ssize_t index = mSessions.indexOfKey((int32_t)events[i].data.u64);
 
-    if (res == 0) {
-        return;
+        if (index < 0) {
+            // destroyed while the event was pending
+            continue;
+        }
+
+        const sp<Session> session = mSessions.valueAt(index);
+        session->addReadiness(events[i].events);
+        markReady_l(session);
     }
 
-    if (res < 0) {
-        if (errno == EINTR) {
-            return;
+    std::vector<int32_t> readySessions;
+    readySessions.swap(mReadySessions);
+
+    for (size_t i = 0; i < readySessions.size(); ++i) {
+        ssize_t index = mSessions.indexOfKey(readySessions[i]);
+
+        if (index < 0) {
+            continue;
         }
 
-        ALOGE("select failed w/ error %d (%s)", errno, strerror(errno));
-        return;
+        const sp<Session> session = mSessions.valueAt(index);
+        session->setInReadyList(false);
+
+        processSession_l(session);
+
+        // The session goes on if it reached one of the limits per wakeup.
+        markReady_l(session);
     }
+}
 
-    if (FD_ISSET(mPipeFd[0], &rs)) {
-        char c;
-        ssize_t n;
-        do {
-            n = read(mPipeFd[0], &c, 1);
-        } while (n < 0 && errno == EINTR);
+void ANetworkSession::processSession_l(const sp<Session> &session) {
+    int s = session->socket();
 
-        if (n < 0) {
-            ALOGW("Error reading from pipe (%s)", strerror(errno));
+    if (session->isRTSPServer() || session->isTCPDatagramServer()) {
+        if (session->canRead()) {
+            acceptConnections_l(session);
         }
-
-        --res;
+        return;
     }
 
-    {
-        Mutex::Autolock autoLock(mLock);
+    if (session->canRead()) {
+        status_t err = session->readMore();
+        if (err != OK) {
+            ALOGE("readMore on socket %d failed w/ error %d (%s)",
+                  s, err, strerror(-err));
+        }
+    }
 
-        List<sp<Session> > sessionsToAdd;
+    if (session->canWrite()) {
+        status_t err = session->writeMore();
+        if (err != OK) {
+            ALOGE("writeMore on socket %d failed w/ error %d (%s)",
+                  s, err, strerror(-err));
+        }
+    }
+}
 
-        for (size_t i = mSessions.size(); res > 0 && i > 0;) {
-            i--;
-            const sp<Session> &session = mSessions.valueAt(i);
+void ANetworkSession::acceptConnections_l(const sp<Session> &server) {
+    for (;;) {
+        struct sockaddr_in remoteAddr;
+        socklen_t remoteAddrLen = sizeof(remoteAddr);
 
-            int s = session->socket();
+        int clientSocket = accept(
+                server->socket(), (struct sockaddr *)&remoteAddr, &remoteAddrLen);
 
-            if (s < 0) {
+        if (clientSocket < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
                 continue;
             }
 
-            if (FD_ISSET(s, &rs) || FD_ISSET(s, &ws)) {
-                --res;
-            }
-
-            if (FD_ISSET(s, &rs)) {
-                if (session->isRTSPServer() || session->isTCPDatagramServer()) {
-                    struct sockaddr_in remoteAddr;
-                    socklen_t remoteAddrLen = sizeof(remoteAddr);
-
-                    int clientSocket = accept(
-                            s, (struct sockaddr *)&remoteAddr, &remoteAddrLen);
-
-                    if (clientSocket >= 0) {
-                        status_t err = MakeSocketNonBlocking(clientSocket);
-
-                        if (err != OK) {
-                            ALOGE("Unable to make client socket non blocking, "
-                                  "failed w/ error %d (%s)",
-                                  err, strerror(-err));
-
-                            close(clientSocket);
-                            clientSocket = -1;
-                        } else {
-                            in_addr_t addr = ntohl(remoteAddr.sin_addr.s_addr);
-
-                            ALOGI("incoming connection from %d.%d.%d.%d:%d "
-                                  "(socket %d)",
-                                  (addr >> 24),
-                                  (addr >> 16) & 0xff,
-                                  (addr >> 8) & 0xff,
-                                  addr & 0xff,
-                                  ntohs(remoteAddr.sin_port),
-                                  clientSocket);
-
-                            sp<Session> clientSession =
-                                new Session(
-                                        mNextSessionID++,
-                                        Session::CONNECTED,
-                                        clientSocket,
-                                        session->getNotificationMessage());
-
-                            clientSession->setMode(
-                                    session->isRTSPServer()
-                                        ? Session::MODE_RTSP
-                                        : Session::MODE_DATAGRAM);
-
-                            sessionsToAdd.push_back(clientSession);
-                        }
-                    } else {
-                        ALOGE("accept returned error %d (%s)",
-                              errno, strerror(errno));
-                    }
-                } else {
-                    status_t err = session->readMore();
-                    if (err != OK) {
-                        ALOGE("readMore on socket %d failed w/ error %d (%s)",
-                              s, err, strerror(-err));
-                    }
-                }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                // e.g. out of file descriptors, try again once the next
+                // connection comes in.
+                ALOGE("accept returned error %d (%s)",
+                      errno, strerror(errno));
             }
 
-            if (FD_ISSET(s, &ws)) {
-                status_t err = session->writeMore();
-                if (err != OK) {
-                    ALOGE("writeMore on socket %d failed w/ error %d (%s)",
-                          s, err, strerror(-err));
-                }
-            }
+            server->setReadable(false);
+            return;
         }
 
-        while (!sessionsToAdd.empty()) {
-            sp<Session> session = *sessionsToAdd.begin();
-            sessionsToAdd.erase(sessionsToAdd.begin());
+        status_t err = MakeSocketNonBlocking(clientSocket);
 
-            mSessions.add(session->sessionID(), session);
+        if (err != OK) {
+            ALOGE("Unable to make client socket non blocking, "
+                  "failed w/ error %d (%s)",
+                  err, strerror(-err));
 
-            ALOGI("added clientSession %d", session->sessionID());
+            close(clientSocket);
+            continue;
         }
+
+        in_addr_t addr = ntohl(remoteAddr.sin_addr.s_addr);
+
+        ALOGI("incoming connection from %d.%d.%d.%d:%d "
+              "(socket %d)",
+              (addr >> 24),
+              (addr >> 16) & 0xff,
+              (addr >> 8) & 0xff,
+              addr & 0xff,
+              ntohs(remoteAddr.sin_port),
+              clientSocket);
+
+        sp<Session> clientSession =
+            new Session(
+                    mNextSessionID++,
+                    Session::CONNECTED,
+                    clientSocket,
+                    server->getNotificationMessage());
+
+        clientSession->setMode(
+                server->isRTSPServer()
+                    ? Session::MODE_RTSP
+                    : Session::MODE_DATAGRAM);
+
+        addSession_l(clientSession);
+
+        ALOGI("added clientSession %d", clientSession->sessionID());
     }
 }
 
@@ -30,19 +30,18 @@
 
 namespace android {
 
-// static
-const char *AString::kEmptyString = "";
-
 AString::AString()
-    : mData((char *)kEmptyString),
+    : mData(mInlineData),
       mSize(0),
-      mAllocSize(1) {
+      mAllocSize(kInlineSize) {
+    mInlineData[0] = '\0';
 }
 
 AString::AString(const char *s)
-    : mData(NULL),
+    : mData(mInlineData),
       mSize(0),
-      mAllocSize(1) {
+      mAllocSize(kInlineSize) {
+    mInlineData[0] = '\0';
     if (!s) {
         ALOGW("ctor got NULL, using empty string instead");
         clear();
@@ -52,9 +51,10 @@ AString::AString(const char *s)
 }
 
 AString::AString(const char *s, size_t size)
-    : mData(NULL),
+    : mData(mInlineData),
       mSize(0),
-      mAllocSize(1) {
+      mAllocSize(kInlineSize) {
+    mInlineData[0] = '\0';
     if (!s) {
         ALOGW("ctor got NULL, using empty string instead");
         clear();
@@ -64,23 +64,26 @@ AString::AString(const char *s, size_t size)
 }
 
 AString::AString(const String8 &from)
-    : mData(NULL),
+    : mData(mInlineData),
       mSize(0),
-      mAllocSize(1) {
+      mAllocSize(kInlineSize) {
+    mInlineData[0] = '\0';
     setTo(from.string(), from.length());
 }
 
 AString::AString(const AString &from)
-    : mData(NULL),
+    : mData(mInlineData),
       mSize(0),
-      mAllocSize(1) {
+      mAllocSize(kInlineSize) {
+    mInlineData[0] = '\0';
     setTo(from, 0, from.size());
 }
 
 AString::AString(const AString &from, size_t offset, size_t n)
-    : mData(NULL),
+    : mData(mInlineData),
       mSize(0),
-      mAllocSize(1) {
+      mAllocSize(kInlineSize) {
+    mInlineData[0] = '\0';
     setTo(from, offset, n);
 }
 
@@ -125,14 +128,14 @@ void AString::setTo(const AString &from, size_t offset, size_t n) {
 }
 
 void AString::clear() {
-    if (mData && mData != kEmptyString) {
+    if (!isInline()) {
         free(mData);
-        mData = NULL;
     }
 
-    mData = (char *)kEmptyString;
+    mData = mInlineData;
+    mData[0] = '\0';
     mSize = 0;
-    mAllocSize = 1;
+    mAllocSize = kInlineSize;
 }
 
 size_t AString::hash() const {
@@ -149,8 +152,6 @@ bool AString::operator==(const AString &other) const {
 }
 
 void AString::trim() {
-    makeMutable();
-
     size_t i = 0;
     while (i < mSize && isspace(mData[i])) {
         ++i;
@@ -170,17 +171,29 @@ void AString::erase(size_t start, size_t n) {
     CHECK_LT(start, mSize);
     CHECK_LE(start + n, mSize);
 
-    makeMutable();
-
     memmove(&mData[start], &mData[start + n], mSize - start - n);
     mSize -= n;
     mData[mSize] = '\0';
 }
 
-void AString::makeMutable() {
-    if (mData == kEmptyString) {
-        mData = strdup(kEmptyString);
+void AString::reserveAdditional(size_t size) {
+    if (mSize + size + 1 <= mAllocSize) {
+        return;
+    }
+
+    size_t allocSize = (mAllocSize + size + 31) & -32;
+
+    if (isInline()) {
+        char *data = (char *)malloc(allocSize);
+        CHECK(data != NULL);
+        memcpy(data, mData, mSize + 1);
+        mData = data;
+    } else {
+        mData = (char *)realloc(mData, allocSize);
+        CHECK(mData != NULL);
     }
+
+    mAllocSize = allocSize;
 }
 
 void AString::append(const char *s) {
@@ -188,13 +201,7 @@ void AString::append(const char *s) {
 }
 
 void AString::append(const char *s, size_t size) {
-    makeMutable();
-
-    if (mSize + size + 1 > mAllocSize) {
-        mAllocSize = (mAllocSize + size + 31) & -32;
-        mData = (char *)realloc(mData, mAllocSize);
-        CHECK(mData != NULL);
-    }
+    reserveAdditional(size);
 
     memcpy(&mData[mSize], s, size);
     mSize += size;
@@ -292,13 +299,7 @@ void AString::insert(const char *from, size_t size, size_t insertionPos) {
     CHECK_GE(insertionPos, 0u);
     CHECK_LE(insertionPos, mSize);
 
-    makeMutable();
-
-    if (mSize + size + 1 > mAllocSize) {
-        mAllocSize = (mAllocSize + size + 31) & -32;
-        mData = (char *)realloc(mData, mAllocSize);
-        CHECK(mData != NULL);
-    }
+    reserveAdditional(size);
 
     memmove(&mData[insertionPos + size],
             &mData[insertionPos], mSize - insertionPos + 1);
@@ -329,8 +330,6 @@ bool AString::equalsIgnoreCase(const AString &other) const {
 }
 
 void AString::tolower() {
-    makeMutable();
-
     for (size_t i = 0; i < mSize; ++i) {
         mData[i] = ::tolower(mData[i]);
     }
@@ -21,6 +21,8 @@
 #include <media/stagefright/MediaBuffer.h>
 #include <media/stagefright/MediaBufferGroup.h>
 
+#include <sched.h>
+
 namespace android {
 
 // std::min is not constexpr in C++11
@@ -33,11 +35,27 @@ static const size_t kSharedMemoryThreshold = MIN(
         (size_t)MediaBuffer::kSharedMemThreshold, (size_t)(4 * 1024));
 
 MediaBufferGroup::MediaBufferGroup(size_t growthLimit) :
-    mGrowthLimit(growthLimit) {
+    mGrowthLimit(growthLimit),
+    mFixed(false),
+    mFixedUsers(0),
+    mFixedSize(0),
+    mWaiters(0),
+    mAcquired(0),
+    mWaited(0),
+    mWaitTotalUs(0),
+    mWaitMaxUs(0) {
 }
 
 MediaBufferGroup::MediaBufferGroup(size_t buffers, size_t buffer_size, size_t growthLimit)
-    : mGrowthLimit(growthLimit) {
+    : mGrowthLimit(growthLimit),
+      mFixed(false),
+      mFixedUsers(0),
+      mFixedSize(0),
+      mWaiters(0),
+      mAcquired(0),
+      mWaited(0),
+      mWaitTotalUs(0),
+      mWaitMaxUs(0) {
 
     if (mGrowthLimit > 0 && buffers > mGrowthLimit) {
         ALOGW("Preallocated buffers %zu > growthLimit %zu, increasing growthLimit",
@@ -65,22 +83,30 @@ MediaBufferGroup::MediaBufferGroup(size_t buffers, size_t buffer_size, size_t gr
             buffer->getSharedControl()->clear();
             add_buffer(buffer);
         }
-        return;
+    } else {
+        // Non-shared memory allocation.
+        for (size_t i = 0; i < buffers; ++i) {
+            MediaBuffer *buffer = new MediaBuffer(buffer_size);
+            if (buffer->data() == nullptr) {
+                delete buffer; // don't call release, it's not properly formed
+                ALOGW("Only allocated %zu malloc buffers of size %zu", i, buffer_size);
+                break;
+            }
+            add_buffer(buffer);
+        }
     }
 
-    // Non-shared memory allocation.
-    for (size_t i = 0; i < buffers; ++i) {
-        MediaBuffer *buffer = new MediaBuffer(buffer_size);
-        if (buffer->data() == nullptr) {
-            delete buffer; // don't call release, it's not properly formed
-            ALOGW("Only allocated %zu malloc buffers of size %zu", i, buffer_size);
-            break;
-        }
-        add_buffer(buffer);
+    // If acquire_buffer() cannot allocate, the buffers only change when it is asked for
+    // a larger one or when one is added.
+    if (!mBuffers.empty() && mBuffers.size() >= mGrowthLimit) {
+        mFixedBuffers.assign(mBuffers.begin(), mBuffers.end());
+        mFixedSize = buffer_size;
+        mFixed = true;
     }
 }
 
 MediaBufferGroup::~MediaBufferGroup() {
+    ALOGV("%s", debugStats().c_str());
     for (MediaBuffer *buffer : mBuffers) {
         if (buffer->refcount() != 0) {
             const int localRefcount = buffer->localRefcount();
@@ -107,6 +133,7 @@ MediaBufferGroup::~MediaBufferGroup() {
 
 void MediaBufferGroup::add_buffer(MediaBuffer *buffer) {
     Mutex::Autolock autoLock(mLock);
+    leaveFixed_l();
 
     // if we're above our growth limit, release buffers if we can
     for (auto it = mBuffers.begin();
@@ -138,69 +165,159 @@ bool MediaBufferGroup::has_buffers() {
     return false;
 }
 
-status_t MediaBufferGroup::acquire_buffer(
-        MediaBuffer **out, bool nonBlocking, size_t requestedSize) {
-    Mutex::Autolock autoLock(mLock);
-    for (;;) {
-        size_t smallest = requestedSize;
-        MediaBuffer *buffer = nullptr;
-        auto free = mBuffers.end();
-        for (auto it = mBuffers.begin(); it != mBuffers.end(); ++it) {
-            if ((*it)->refcount() == 0) {
-                const size_t size = (*it)->size();
-                if (size >= requestedSize) {
-                    buffer = *it;
-                    break;
-                }
-                if (size < smallest) {
-                    smallest = size; // always free the smallest buf
-                    free = it;
-                }
+bool MediaBufferGroup::acquireFixed(MediaBuffer **out) {
+    // pairs with leaveFixed_l() clearing mFixed before it checks mFixedUsers
+    ++mFixedUsers;
+    bool acquired = false;
+    if (mFixed) {
+        for (MediaBuffer *buffer : mFixedBuffers) {
+            if (__atomic_load_n(&buffer->mRefCount, __ATOMIC_SEQ_CST) != 0
+                    || buffer->remoteRefcount() != 0
+                    || !__sync_bool_compare_and_swap(&buffer->mRefCount, 0, 1)) {
+                continue;
             }
+            // Another thread may have acquired the buffer, sent it to a remote process and
+            // released it since we checked the remote refcount. Now that we own the buffer
+            // the remote refcount can only decrease.
+            if (buffer->remoteRefcount() != 0) {
+                (void)__sync_fetch_and_sub(&buffer->mRefCount, 1);
+                continue;
+            }
+            buffer->reset();
+            *out = buffer;
+            acquired = true;
+            break;
         }
-        if (buffer == nullptr
-                && (free != mBuffers.end() || mBuffers.size() < mGrowthLimit)) {
-            // We alloc before we free so failure leaves group unchanged.
-            const size_t allocateSize = requestedSize < SIZE_MAX / 3 * 2 /* NB: ordering */ ?
-                    requestedSize * 3 / 2 : requestedSize;
-            buffer = new MediaBuffer(allocateSize);
-            if (buffer->data() == nullptr) {
-                ALOGE("Allocation failure for size %zu", allocateSize);
-                delete buffer; // Invalid alloc, prefer not to call release.
-                buffer = nullptr;
+    }
+    --mFixedUsers;
+    return acquired;
+}
+
+void MediaBufferGroup::leaveFixed_l() {
+    if (!mFixed) {
+        return;
+    }
+    ALOGV("group of %zu buffers of size %zu is no longer fixed",
+            mFixedBuffers.size(), mFixedSize);
+    mFixed = false;
+    // another thread may still be looking for a free buffer in mFixedBuffers
+    while (mFixedUsers > 0) {
+        sched_yield();
+    }
+    mFixedBuffers.clear();
+}
+
+bool MediaBufferGroup::acquireGrowing_l(MediaBuffer **out, size_t requestedSize) {
+    size_t smallest = requestedSize;
+    MediaBuffer *buffer = nullptr;
+    auto free = mBuffers.end();
+    for (auto it = mBuffers.begin(); it != mBuffers.end(); ++it) {
+        if ((*it)->refcount() == 0) {
+            const size_t size = (*it)->size();
+            if (size >= requestedSize) {
+                buffer = *it;
+                break;
+            }
+            if (size < smallest) {
+                smallest = size; // always free the smallest buf
+                free = it;
+            }
+        }
+    }
+    if (buffer == nullptr
+            && (free != mBuffers.end() || mBuffers.size() < mGrowthLimit)) {
+        // We alloc before we free so failure leaves group unchanged.
+        const size_t allocateSize = requestedSize < SIZE_MAX / 3 * 2 /* NB: ordering */ ?
+                requestedSize * 3 / 2 : requestedSize;
+        buffer = new MediaBuffer(allocateSize);
+        if (buffer->data() == nullptr) {
+            ALOGE("Allocation failure for size %zu", allocateSize);
+            delete buffer; // Invalid alloc, prefer not to call release.
+            buffer = nullptr;
+        } else {
+            buffer->setObserver(this);
+            if (free != mBuffers.end()) {
+                ALOGV("reallocate buffer, requested size %zu vs available %zu",
+                        requestedSize, (*free)->size());
+                (*free)->setObserver(nullptr);
+                (*free)->release();
+                *free = buffer; // in-place replace
             } else {
-                buffer->setObserver(this);
-                if (free != mBuffers.end()) {
-                    ALOGV("reallocate buffer, requested size %zu vs available %zu",
-                            requestedSize, (*free)->size());
-                    (*free)->setObserver(nullptr);
-                    (*free)->release();
-                    *free = buffer; // in-place replace
-                } else {
-                    ALOGV("allocate buffer, requested size %zu", requestedSize);
-                    mBuffers.emplace_back(buffer);
-                }
+                ALOGV("allocate buffer, requested size %zu", requestedSize);
+                mBuffers.emplace_back(buffer);
             }
         }
-        if (buffer != nullptr) {
-            buffer->add_ref();
-            buffer->reset();
-            *out = buffer;
-            return OK;
+    }
+    if (buffer == nullptr) {
+        return false;
+    }
+    buffer->add_ref();
+    buffer->reset();
+    *out = buffer;
+    return true;
+}
+
+status_t MediaBufferGroup::acquire_buffer(
+        MediaBuffer **out, bool nonBlocking, size_t requestedSize) {
+    if (mFixed && requestedSize <= mFixedSize && acquireFixed(out)) {
+        ++mAcquired;
+        return OK;
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    // pairs with signalBufferReturned() checking mWaiters after a buffer was released
+    ++mWaiters;
+    if (requestedSize > mFixedSize) {
+        leaveFixed_l();
+    }
+    nsecs_t waitStartNs = 0;
+    for (;;) {
+        if (mFixed ? acquireFixed(out) : acquireGrowing_l(out, requestedSize)) {
+            break;
         }
         if (nonBlocking) {
+            --mWaiters;
             *out = nullptr;
             return WOULD_BLOCK;
         }
         // All buffers are in use, block until one of them is returned.
+        if (waitStartNs == 0) {
+            waitStartNs = systemTime(SYSTEM_TIME_MONOTONIC);
+        }
         mCondition.wait(mLock);
     }
-    // Never gets here.
+
+    --mWaiters;
+    ++mAcquired;
+    if (waitStartNs != 0) {
+        const int64_t waitUs = (systemTime(SYSTEM_TIME_MONOTONIC) - waitStartNs) / 1000;
+        ++mWaited;
+        mWaitTotalUs += waitUs;
+        if (waitUs > mWaitMaxUs) {
+            mWaitMaxUs = waitUs;
+        }
+    }
+    return OK;
 }
 
-void MediaBufferGroup::signalBufferReturned(MediaBuffer *) {
+void MediaBufferGroup::signalBufferReturned(MediaBuffer *buffer) {
+    // MediaBuffer::release() has decremented the refcount with a full barrier,
+    // so a thread which has not yet incremented mWaiters will find the buffer free.
+    if (buffer != nullptr && mWaiters == 0) {
+        return;
+    }
     Mutex::Autolock autoLock(mLock);
     mCondition.signal();
 }
 
+AString MediaBufferGroup::debugStats() {
+    Mutex::Autolock autoLock(mLock);
+    return AStringPrintf(
+            "%zu buffers%s, %llu acquired, %llu waited (mean %lld us, max %lld us)",
+            mBuffers.size(), mFixed ? " (fixed)" : "",
+            (unsigned long long)mAcquired.load(), (unsigned long long)mWaited,
+            (long long)(mWaited > 0 ? mWaitTotalUs / (int64_t)mWaited : 0),
+            (long long)mWaitMaxUs);
+}
+
 }  // namespace android
@@ -29,12 +29,36 @@
 
 namespace android {
 
-MetaData::MetaData() {
+// the keys in MetaData::mInlineItems
+static const uint32_t kInlineKeys[] = {
+    kKeyTime, kKeyIsSyncFrame, kKeyDuration, kKeyDecodingTime,
+};
+
+static inline ssize_t inlineIndexOfKey(uint32_t key) {
+    switch (key) {
+        case kKeyTime:          return 0;
+        case kKeyIsSyncFrame:   return 1;
+        case kKeyDuration:      return 2;
+        case kKeyDecodingTime:  return 3;
+        default:                return -1;
+    }
+}
+
+MetaData::MetaData()
+    : mInlineMask(0) {
+    static_assert(sizeof(kInlineKeys) / sizeof(kInlineKeys[0]) == kNumInlineKeys,
+            "kInlineKeys does not match kNumInlineKeys");
 }
 
 MetaData::MetaData(const MetaData &from)
     : RefBase(),
-      mItems(from.mItems) {
+      mItems(from.mItems),
+      mInlineMask(from.mInlineMask) {
+    for (size_t i = 0; i < kNumInlineKeys; ++i) {
+        if (mInlineMask & (1u << i)) {
+            mInlineItems[i] = from.mInlineItems[i];
+        }
+    }
 }
 
 MetaData::~MetaData() {
@@ -43,9 +67,25 @@ MetaData::~MetaData() {
 
 void MetaData::clear() {
     mItems.clear();
+    for (size_t i = 0; mInlineMask != 0; ++i) {
+        if (mInlineMask & (1u << i)) {
+            mInlineItems[i].clear();
+            mInlineMask &= ~(1u << i);
+        }
+    }
 }
 
 bool MetaData::remove(uint32_t key) {
+    ssize_t j = inlineIndexOfKey(key);
+    if (j >= 0) {
+        if (!(mInlineMask & (1u << j))) {
+            return false;
+        }
+        mInlineItems[j].clear();
+        mInlineMask &= ~(1u << j);
+        return true;
+    }
+
     ssize_t i = mItems.indexOfKey(key);
 
     if (i < 0) {
@@ -190,6 +230,14 @@ bool MetaData::findRect(
 
 bool MetaData::setData(
         uint32_t key, uint32_t type, const void *data, size_t size) {
+    ssize_t j = inlineIndexOfKey(key);
+    if (j >= 0) {
+        bool overwrote_existing = (mInlineMask & (1u << j)) != 0;
+        mInlineItems[j].setData(type, data, size);
+        mInlineMask |= 1u << j;
+        return overwrote_existing;
+    }
+
     bool overwrote_existing = true;
 
     ssize_t i = mItems.indexOfKey(key);
@@ -209,6 +257,15 @@ bool MetaData::setData(
 
 bool MetaData::findData(uint32_t key, uint32_t *type,
                         const void **data, size_t *size) const {
+    ssize_t j = inlineIndexOfKey(key);
+    if (j >= 0) {
+        if (!(mInlineMask & (1u << j))) {
+            return false;
+        }
+        mInlineItems[j].getData(type, data, size);
+        return true;
+    }
+
     ssize_t i = mItems.indexOfKey(key);
 
     if (i < 0) {
@@ -223,6 +280,11 @@ bool MetaData::findData(uint32_t key, uint32_t *type,
 }
 
 bool MetaData::hasData(uint32_t key) const {
+    ssize_t j = inlineIndexOfKey(key);
+    if (j >= 0) {
+        return (mInlineMask & (1u << j)) != 0;
+    }
+
     ssize_t i = mItems.indexOfKey(key);
 
     if (i < 0) {
@@ -379,6 +441,16 @@ String8 MetaData::toString() const {
             s.append(", ");
         }
     }
+    for (size_t i = 0; i < kNumInlineKeys; ++i) {
+        if (mInlineMask & (1u << i)) {
+            char cc[5];
+            MakeFourCCString(kInlineKeys[i], cc);
+            if (!s.isEmpty()) {
+                s.append(", ");
+            }
+            s.appendFormat("%s: %s", cc, mInlineItems[i].asString(false).string());
+        }
+    }
     return s;
 }
 void MetaData::dumpToLog() const {
@@ -389,44 +461,31 @@ void MetaData::dumpToLog() const {
         const typed_data &item = mItems.valueAt(i);
         ALOGI("%s: %s", cc, item.asString(true /* verbose */).string());
     }
+    for (size_t i = 0; i < kNumInlineKeys; ++i) {
+        if (mInlineMask & (1u << i)) {
+            char cc[5];
+            MakeFourCCString(kInlineKeys[i], cc);
+            ALOGI("%s: %s", cc, mInlineItems[i].asString(true /* verbose */).string());
+        }
+    }
 }
 
 status_t MetaData::writeToParcel(Parcel &parcel) {
     status_t ret;
     size_t numItems = mItems.size();
-    ret = parcel.writeUint32(uint32_t(numItems));
+    ret = parcel.writeUint32(uint32_t(numItems + __builtin_popcount(mInlineMask)));
     if (ret) {
         return ret;
     }
     for (size_t i = 0; i < numItems; i++) {
-        int32_t key = mItems.keyAt(i);
-        const typed_data &item = mItems.valueAt(i);
-        uint32_t type;
-        const void *data;
-        size_t size;
-        item.getData(&type, &data, &size);
-        ret = parcel.writeInt32(key);
+        ret = writeItemToParcel(parcel, mItems.keyAt(i), mItems.valueAt(i));
         if (ret) {
             return ret;
         }
-        ret = parcel.writeUint32(type);
-        if (ret) {
-            return ret;
-        }
-        if (type == TYPE_NONE) {
-            android::Parcel::WritableBlob blob;
-            ret = parcel.writeUint32(static_cast<uint32_t>(size));
-            if (ret) {
-                return ret;
-            }
-            ret = parcel.writeBlob(size, false, &blob);
-            if (ret) {
-                return ret;
-            }
-            memcpy(blob.data(), data, size);
-            blob.release();
-        } else {
-            ret = parcel.writeByteArray(size, (uint8_t*)data);
+    }
+    for (size_t i = 0; i < kNumInlineKeys; ++i) {
+        if (mInlineMask & (1u << i)) {
+            ret = writeItemToParcel(parcel, kInlineKeys[i], mInlineItems[i]);
             if (ret) {
                 return ret;
             }
@@ -435,6 +494,42 @@ status_t MetaData::writeToParcel(Parcel &parcel) {
     return OK;
 }
 
+// static
+status_t MetaData::writeItemToParcel(
+        Parcel &parcel, uint32_t key, const typed_data &item) {
+    uint32_t type;
+    const void *data;
+    size_t size;
+    item.getData(&type, &data, &size);
+    status_t ret = parcel.writeInt32(key);
+    if (ret) {
+        return ret;
+    }
+    ret = parcel.writeUint32(type);
+    if (ret) {
+        return ret;
+    }
+    if (type == TYPE_NONE) {
+        android::Parcel::WritableBlob blob;
+        ret = parcel.writeUint32(static_cast<uint32_t>(size));
+        if (ret) {
+            return ret;
+        }
+        ret = parcel.writeBlob(size, false, &blob);
+        if (ret) {
+            return ret;
+        }
+        memcpy(blob.data(), data, size);
+        blob.release();
+    } else {
+        ret = parcel.writeByteArray(size, (uint8_t*)data);
+        if (ret) {
+            return ret;
+        }
+    }
+    return OK;
+}
+
 status_t MetaData::updateFromParcel(const Parcel &parcel) {
     uint32_t numItems;
     if (parcel.readUint32(&numItems) == OK) {
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares ABitReader with the reader it replaced, which refilled a 32 bit reservoir one
+// byte at a time, on Exp-Golomb codes and fixed length fields such as those of slice headers.
+
+#include <benchmark/benchmark.h>
+
+#include <stdlib.h>
+#include <vector>
+
+#include <media/stagefright/foundation/ABitReader.h>
+
+using namespace android;
+
+namespace {
+
+// The previous ABitReader, without putBits() and the NAL unit reader. The methods are not
+// inlined, to compare with the calls into ABitReader.
+class LegacyBitReader {
+public:
+    LegacyBitReader(const uint8_t *data, size_t size)
+        : mData(data), mSize(size), mReservoir(0), mNumBitsLeft(0) { }
+
+    __attribute__((noinline)) bool getBitsGraceful(size_t n, uint32_t *out) {
+        if (n > 32) {
+            return false;
+        }
+        uint32_t result = 0;
+        while (n > 0) {
+            if (mNumBitsLeft == 0 && !fillReservoir()) {
+                return false;
+            }
+            size_t m = n;
+            if (m > mNumBitsLeft) {
+                m = mNumBitsLeft;
+            }
+            result = (result << m) | (mReservoir >> (32 - m));
+            mReservoir <<= m;
+            mNumBitsLeft -= m;
+            n -= m;
+        }
+        *out = result;
+        return true;
+    }
+
+    __attribute__((noinline)) uint32_t getBitsWithFallback(size_t n, uint32_t fallback) {
+        uint32_t ret = fallback;
+        (void)getBitsGraceful(n, &ret);
+        return ret;
+    }
+
+    __attribute__((noinline)) bool skipBits(size_t n) {
+        uint32_t dummy;
+        while (n > 32) {
+            if (!getBitsGraceful(32, &dummy)) {
+                return false;
+            }
+            n -= 32;
+        }
+        return n == 0 || getBitsGraceful(n, &dummy);
+    }
+
+    // parseUEWithFallback() as it was in avc_utils.cpp
+    __attribute__((noinline)) unsigned parseUEWithFallback(unsigned fallback) {
+        unsigned numZeroes = 0;
+        while (getBitsWithFallback(1, 1) == 0) {
+            ++numZeroes;
+        }
+        uint32_t x;
+        if (numZeroes < 32) {
+            return getBitsGraceful(numZeroes, &x) ? x + (1u << numZeroes) - 1 : fallback;
+        }
+        skipBits(numZeroes);
+        return fallback;
+    }
+
+private:
+    const uint8_t *mData;
+    size_t mSize;
+    uint32_t mReservoir;
+    size_t mNumBitsLeft;
+
+    __attribute__((noinline)) bool fillReservoir() {
+        if (mSize == 0) {
+            return false;
+        }
+        mReservoir = 0;
+        size_t i;
+        for (i = 0; mSize > 0 && i < 4; ++i) {
+            mReservoir = (mReservoir << 8) | *mData;
+            ++mData;
+            --mSize;
+        }
+        mNumBitsLeft = 8 * i;
+        mReservoir <<= 32 - mNumBitsLeft;
+        return true;
+    }
+};
+
+// Exp-Golomb codes of small values, as found in parameter sets and slice headers,
+// each followed by a fixed length field.
+class Stream {
+public:
+    Stream() : mNumBits(0) {
+        srand(1);
+        for (size_t i = 0; i < kNumCodes; ++i) {
+            uint32_t value = rand() % 64;
+            size_t numBits = 0;
+            while ((value + 1) >> numBits > 1) {
+                ++numBits;
+            }
+            putBits(0, numBits);
+            putBits(value + 1, numBits + 1);
+            putBits(rand() & 0xff, 1 + i % 8);
+        }
+    }
+
+    const uint8_t *data() const { return mData.data(); }
+    size_t size() const { return mData.size(); }
+
+    static const size_t kNumCodes = 4096;
+
+private:
+    std::vector<uint8_t> mData;
+    size_t mNumBits;
+
+    void putBits(uint32_t value, size_t n) {
+        while (n-- > 0) {
+            if (mNumBits % 8 == 0) {
+                mData.push_back(0);
+            }
+            mData.back() |= ((value >> n) & 1) << (7 - mNumBits % 8);
+            ++mNumBits;
+        }
+    }
+};
+
+const Stream &GetStream() {
+    static const Stream stream;
+    return stream;
+}
+
+}  // namespace
+
+static void BM_LegacyParse(benchmark::State &state) {
+    const Stream &stream = GetStream();
+    while (state.KeepRunning()) {
+        LegacyBitReader br(stream.data(), stream.size());
+        uint32_t sum = 0;
+        for (size_t i = 0; i < Stream::kNumCodes; ++i) {
+            sum += br.parseUEWithFallback(0);
+            sum += br.getBitsWithFallback(1 + i % 8, 0);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_LegacyParse);
+
+static void BM_ABitReaderParse(benchmark::State &state) {
+    const Stream &stream = GetStream();
+    while (state.KeepRunning()) {
+        ABitReader br(stream.data(), stream.size());
+        uint32_t sum = 0;
+        for (size_t i = 0; i < Stream::kNumCodes; ++i) {
+            uint32_t value = 0;
+            (void)br.getUEGolombGraceful(&value);
+            sum += value;
+            sum += br.getBitsWithFallback(1 + i % 8, 0);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_ABitReaderParse);
+
+static void BM_LegacySkip(benchmark::State &state) {
+    const Stream &stream = GetStream();
+    while (state.KeepRunning()) {
+        LegacyBitReader br(stream.data(), stream.size());
+        while (br.skipBits(100)) {
+        }
+    }
+}
+BENCHMARK(BM_LegacySkip);
+
+static void BM_ABitReaderSkip(benchmark::State &state) {
+    const Stream &stream = GetStream();
+    while (state.KeepRunning()) {
+        ABitReader br(stream.data(), stream.size());
+        while (br.skipBits(100)) {
+        }
+    }
+}
+BENCHMARK(BM_ABitReaderSkip);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ABitReader_test"
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/ABitReader.h>
+#include <media/stagefright/foundation/ADebug.h>
+
+namespace android {
+
+TEST(ABitReaderTest, GetSkipAcrossReservoir) {
+    uint8_t data[20];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = i;
+    }
+    ABitReader br(data, sizeof(data));
+    ASSERT_EQ(0x0001u, br.getBits(16));
+    ASSERT_TRUE(br.skipBits(44));               // to the middle of byte 7
+    ASSERT_EQ(0x7080u, br.getBits(16));          // straddles the first reservoir
+    ASSERT_EQ(0x9u, br.getBits(4));
+    ASSERT_EQ(data + 10, br.data());
+    ASSERT_EQ(80u, br.numBitsLeft());
+
+    br.putBits(0x9, 4);
+    ASSERT_EQ(84u, br.numBitsLeft());
+    ASSERT_EQ(0x90a0b0c0u, br.getBits(32));
+
+    ASSERT_TRUE(br.skipBits(52));
+    ASSERT_FALSE(br.overRead());
+    uint32_t value;
+    ASSERT_FALSE(br.getBitsGraceful(1, &value));
+    ASSERT_TRUE(br.overRead());
+}
+
+TEST(ABitReaderTest, ExpGolomb) {
+    // 1, 010, 011, 00100, 0001000, then 31 zeros and 32 ones: the largest ue(v)
+    const uint8_t data[] = {
+        0xa6, 0x41, 0x00, 0x00, 0x00, 0x00, 0x3f, 0xff, 0xff, 0xff, 0xc0,
+    };
+    ABitReader br(data, sizeof(data));
+    uint32_t value;
+    ASSERT_TRUE(br.getUEGolombGraceful(&value));
+    ASSERT_EQ(0u, value);
+    int32_t signedValue;
+    ASSERT_TRUE(br.getSEGolombGraceful(&signedValue));
+    ASSERT_EQ(1, signedValue);
+    ASSERT_TRUE(br.getSEGolombGraceful(&signedValue));
+    ASSERT_EQ(-1, signedValue);
+    ASSERT_TRUE(br.getUEGolombGraceful(&value));
+    ASSERT_EQ(3u, value);
+    ASSERT_TRUE(br.getUEGolombGraceful(&value));
+    ASSERT_EQ(7u, value);
+    ASSERT_TRUE(br.getUEGolombGraceful(&value));
+    ASSERT_EQ(0xfffffffeu, value);
+    ASSERT_EQ(6u, br.numBitsLeft());
+    ASSERT_FALSE(br.getUEGolombGraceful(&value));
+    ASSERT_TRUE(br.overRead());
+
+    // 32 leading zeros
+    const uint8_t tooLong[] = { 0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x80 };
+    ABitReader br2(tooLong, sizeof(tooLong));
+    ASSERT_FALSE(br2.getUEGolombGraceful(&value));
+    ASSERT_FALSE(br2.overRead());
+}
+
+TEST(ABitReaderTest, NALEmulationPrevention) {
+    const uint8_t data[] = {
+        0x00, 0x00, 0x03, 0x01, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x02, 0xff,
+    };
+    NALBitReader br(data, sizeof(data));
+    ASSERT_TRUE(br.atLeastNumBitsLeft(72));
+    ASSERT_FALSE(br.atLeastNumBitsLeft(73));
+    ASSERT_EQ(0x00000100u, br.getBits(32));
+    ASSERT_EQ(0x00000002u, br.getBits(32));
+    ASSERT_EQ(0xffu, br.getBits(8));
+    uint32_t value;
+    ASSERT_FALSE(br.getBitsGraceful(1, &value));
+}
+
+} // namespace android
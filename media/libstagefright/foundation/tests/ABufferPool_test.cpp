@@ -0,0 +1,88 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ABufferPool_test"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <vector>
+
+#include <media/stagefright/foundation/ABufferPool.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+namespace android {
+
+TEST(ABufferPoolTest, AcquireLikeNew) {
+    sp<ABuffer> buffer = ABufferPool::Acquire(1000);
+    ASSERT_EQ(1000u, buffer->capacity());
+    ASSERT_EQ(1000u, buffer->size());
+    ASSERT_EQ(0u, buffer->offset());
+    memset(buffer->data(), 0xff, buffer->size());
+    buffer->setRange(10, 20);
+    buffer->meta()->setInt64("timeUs", 1234);
+
+    // buffers too large to be pooled are allocated as usual
+    sp<ABuffer> large = ABufferPool::Acquire(4 << 20);
+    ASSERT_EQ((size_t)(4 << 20), large->capacity());
+}
+
+TEST(ABufferPoolTest, Reuse) {
+    ABufferPool::Trim();
+    ABufferPool::Stats before;
+    ABufferPool::GetStats(&before);
+    ASSERT_EQ(0u, before.mCachedBytes);
+
+    uint8_t *data;
+    {
+        sp<ABuffer> buffer = ABufferPool::Acquire(3000);
+        data = buffer->base();
+    }
+    ABufferPool::Stats stats;
+    ABufferPool::GetStats(&stats);
+    ASSERT_EQ(before.mAllocated + 1, stats.mAllocated);
+    ASSERT_EQ(before.mReleased + 1, stats.mReleased);
+    ASSERT_EQ(4096u, stats.mCachedBytes);
+
+    // a buffer of the same size class reuses the allocation, with a fresh state
+    sp<ABuffer> buffer = ABufferPool::Acquire(2500);
+    ASSERT_EQ(data, buffer->base());
+    ASSERT_EQ(2500u, buffer->size());
+    ASSERT_FALSE(buffer->meta()->contains("timeUs"));
+    ABufferPool::GetStats(&stats);
+    ASSERT_EQ(before.mReused + 1, stats.mReused);
+    ASSERT_EQ(0u, stats.mCachedBytes);
+}
+
+TEST(ABufferPoolTest, BoundedCache) {
+    ABufferPool::Trim();
+    std::vector<sp<ABuffer> > buffers;
+    for (size_t i = 0; i < 100; ++i) {
+        buffers.push_back(ABufferPool::Acquire(65536));
+    }
+    buffers.clear();
+
+    ABufferPool::Stats stats;
+    ABufferPool::GetStats(&stats);
+    ASSERT_GE((size_t)(1 << 20), stats.mCachedBytes);
+    ABufferPool::Trim();
+    ABufferPool::GetStats(&stats);
+    ASSERT_EQ(0u, stats.mCachedBytes);
+}
+
+} // namespace android
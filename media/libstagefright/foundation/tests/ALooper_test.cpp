@@ -0,0 +1,201 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ALooper_test"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <pthread.h>
+#include <unistd.h>
+#include <vector>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+namespace android {
+
+struct RecordingHandler : public AHandler {
+    enum {
+        kWhatRecord = 'reco',
+    };
+
+    size_t count() {
+        Mutex::Autolock autoLock(mLock);
+        return mReceived.size();
+    }
+
+    // waits for count messages, returns false on timeout
+    bool waitFor(size_t count) {
+        for (int i = 0; i < 500 && this->count() < count; ++i) {
+            usleep(10000);
+        }
+        return this->count() >= count;
+    }
+
+    int32_t received(size_t i) {
+        Mutex::Autolock autoLock(mLock);
+        return mReceived[i];
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        int32_t value;
+        CHECK(msg->findInt32("value", &value));
+        Mutex::Autolock autoLock(mLock);
+        mReceived.push_back(value);
+    }
+
+private:
+    Mutex mLock;
+    std::vector<int32_t> mReceived;
+};
+
+class ALooperTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mLooper = new ALooper;
+        mLooper->setName("ALooper_test");
+        mHandler = new RecordingHandler;
+        mLooper->registerHandler(mHandler);
+        ASSERT_EQ(OK, mLooper->start());
+    }
+
+    virtual void TearDown() {
+        mLooper->unregisterHandler(mHandler->id());
+        mLooper->stop();
+    }
+
+    void post(int32_t value, int64_t delayUs = 0) {
+        sp<AMessage> msg = new AMessage(RecordingHandler::kWhatRecord, mHandler);
+        msg->setInt32("value", value);
+        msg->post(delayUs);
+    }
+
+    sp<ALooper> mLooper;
+    sp<RecordingHandler> mHandler;
+};
+
+TEST_F(ALooperTest, DelayedOrder) {
+    // posted in reverse order of delivery, the immediate ones come first
+    post(5, 500000);
+    post(4, 400000);
+    post(3, 300000);
+    post(1);
+    post(2);
+    ASSERT_TRUE(mHandler->waitFor(5));
+    for (size_t i = 0; i < 5; ++i) {
+        ASSERT_EQ((int32_t)i + 1, mHandler->received(i));
+    }
+}
+
+struct PostArgs {
+    sp<RecordingHandler> mHandler;
+    int32_t mFirst;
+};
+
+static void *postMany(void *arg) {
+    PostArgs *args = (PostArgs *)arg;
+    for (int32_t i = 0; i < 1000; ++i) {
+        sp<AMessage> msg = new AMessage(RecordingHandler::kWhatRecord, args->mHandler);
+        msg->setInt32("value", args->mFirst + i);
+        msg->post(i % 10 == 0 ? 100 : 0);
+    }
+    return NULL;
+}
+
+TEST_F(ALooperTest, ConcurrentPosts) {
+    static const size_t kThreads = 4;
+    pthread_t threads[kThreads];
+    PostArgs args[kThreads];
+    for (size_t i = 0; i < kThreads; ++i) {
+        args[i].mHandler = mHandler;
+        args[i].mFirst = i * 1000;
+        ASSERT_EQ(0, pthread_create(&threads[i], NULL, postMany, &args[i]));
+    }
+    for (size_t i = 0; i < kThreads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    ASSERT_TRUE(mHandler->waitFor(kThreads * 1000));
+
+    // the messages posted without delay by each thread are delivered in order
+    int32_t last[kThreads] = { -1, -1, -1, -1 };
+    for (size_t i = 0; i < kThreads * 1000; ++i) {
+        int32_t value = mHandler->received(i);
+        if (value % 10 == 0) {
+            continue;
+        }
+        ASSERT_LT(last[value / 1000], value);
+        last[value / 1000] = value;
+    }
+    ASSERT_EQ(kThreads * 1000, mHandler->count());
+}
+
+// records the messages of several loopers, and whether a looper ever delivered two at once
+struct SharedHandler : public RecordingHandler {
+    SharedHandler() : mBusy(0), mOverlaps(0) {}
+
+    std::atomic<int> mBusy;
+    std::atomic<int> mOverlaps;
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        if (mBusy++ != 0) {
+            ++mOverlaps;
+        }
+        RecordingHandler::onMessageReceived(msg);
+        --mBusy;
+    }
+};
+
+TEST(ALooperSharedTest, SharedExecutor) {
+    static const size_t kLoopers = 16;
+    static const int32_t kMessages = 1000;
+    sp<ALooper> loopers[kLoopers];
+    sp<SharedHandler> handlers[kLoopers];
+    for (size_t i = 0; i < kLoopers; ++i) {
+        loopers[i] = new ALooper;
+        loopers[i]->setName("ALooper_shared_test");
+        loopers[i]->setUseSharedExecutor(true);
+        handlers[i] = new SharedHandler;
+        loopers[i]->registerHandler(handlers[i]);
+        ASSERT_EQ(OK, loopers[i]->start());
+    }
+
+    for (int32_t n = 0; n < kMessages; ++n) {
+        for (size_t i = 0; i < kLoopers; ++i) {
+            sp<AMessage> msg = new AMessage(RecordingHandler::kWhatRecord, handlers[i]);
+            msg->setInt32("value", n);
+            msg->post(n == kMessages - 1 ? 20000 : 0);
+        }
+    }
+
+    for (size_t i = 0; i < kLoopers; ++i) {
+        ASSERT_TRUE(handlers[i]->waitFor(kMessages));
+        // each looper delivers in order, one message at a time
+        for (int32_t n = 0; n < kMessages; ++n) {
+            ASSERT_EQ(n, handlers[i]->received(n));
+        }
+        ASSERT_EQ(0, handlers[i]->mOverlaps.load());
+        loopers[i]->unregisterHandler(handlers[i]->id());
+        loopers[i]->stop();
+    }
+}
+
+} // namespace android
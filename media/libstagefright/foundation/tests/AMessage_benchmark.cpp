@@ -0,0 +1,240 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares AMessage with the item storage it used before names were interned and hashed,
+// short strings stored inline, and messages pooled, on a format-like message.
+
+#include <benchmark/benchmark.h>
+
+#include <string.h>
+
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+
+using namespace android;
+
+namespace {
+
+// keys of a typical decoder output format
+const char *const kIntKeys[] = {
+    "width", "height", "stride", "slice-height", "color-format", "crop-left", "crop-top",
+    "crop-right", "crop-bottom", "color-range", "color-standard", "color-transfer",
+    "channel-count", "sample-rate", "pcm-encoding", "max-input-size", "priority",
+    "rotation-degrees", "profile", "level", "frame-rate", "using-sw-renderer",
+    "android._video-scaling", "push-blank-buffers-on-shutdown",
+};
+const size_t kNumIntKeys = sizeof(kIntKeys) / sizeof(kIntKeys[0]);
+const char *const kStringKeys[] = { "mime", "language", "android._codec-name" };
+const size_t kNumStringKeys = sizeof(kStringKeys) / sizeof(kStringKeys[0]);
+
+// The previous AMessage item storage: copied names found by a linear scan,
+// and strings in AStrings.
+class LegacyMessage {
+public:
+    LegacyMessage() : mNumItems(0) { }
+    ~LegacyMessage() { clear(); }
+
+    void clear() {
+        for (size_t i = 0; i < mNumItems; ++i) {
+            delete[] mItems[i].mName;
+            if (mItems[i].mIsString) {
+                delete mItems[i].u.stringValue;
+            }
+        }
+        mNumItems = 0;
+    }
+
+    void setInt32(const char *name, int32_t value) {
+        Item *item = allocateItem(name);
+        item->mIsString = false;
+        item->u.int32Value = value;
+    }
+
+    void setString(const char *name, const char *s) {
+        Item *item = allocateItem(name);
+        item->mIsString = true;
+        item->u.stringValue = new AString(s, strlen(s));
+    }
+
+    // not inlined, to compare with the calls into AMessage
+    __attribute__((noinline)) bool findInt32(const char *name, int32_t *value) const {
+        size_t i = findItemIndex(name, strlen(name));
+        if (i < mNumItems && !mItems[i].mIsString) {
+            *value = mItems[i].u.int32Value;
+            return true;
+        }
+        return false;
+    }
+
+    __attribute__((noinline)) bool findString(const char *name, AString *value) const {
+        size_t i = findItemIndex(name, strlen(name));
+        if (i < mNumItems && mItems[i].mIsString) {
+            *value = *mItems[i].u.stringValue;
+            return true;
+        }
+        return false;
+    }
+
+    LegacyMessage *dup() const {
+        LegacyMessage *msg = new LegacyMessage;
+        for (size_t i = 0; i < mNumItems; ++i) {
+            const Item *from = &mItems[i];
+            Item *to = &msg->mItems[i];
+            to->setName(from->mName, from->mNameLength);
+            to->mIsString = from->mIsString;
+            if (from->mIsString) {
+                to->u.stringValue = new AString(*from->u.stringValue);
+            } else {
+                to->u = from->u;
+            }
+        }
+        msg->mNumItems = mNumItems;
+        return msg;
+    }
+
+private:
+    struct Item {
+        union {
+            int32_t int32Value;
+            AString *stringValue;
+            int32_t rectValue[4];
+        } u;
+        const char *mName;
+        size_t mNameLength;
+        bool mIsString;
+
+        void setName(const char *name, size_t len) {
+            mNameLength = len;
+            mName = new char[len + 1];
+            memcpy((void *)mName, name, len + 1);
+        }
+    };
+
+    Item mItems[64];
+    size_t mNumItems;
+
+    size_t findItemIndex(const char *name, size_t len) const {
+        size_t i = 0;
+        for (; i < mNumItems; i++) {
+            if (len == mItems[i].mNameLength && !memcmp(mItems[i].mName, name, len)) {
+                break;
+            }
+        }
+        return i;
+    }
+
+    Item *allocateItem(const char *name) {
+        size_t len = strlen(name);
+        size_t i = findItemIndex(name, len);
+        if (i < mNumItems) {
+            if (mItems[i].mIsString) {
+                delete mItems[i].u.stringValue;
+            }
+        } else {
+            i = mNumItems++;
+            mItems[i].setName(name, len);
+        }
+        return &mItems[i];
+    }
+};
+
+template <typename Message>
+void fill(Message *msg) {
+    for (size_t i = 0; i < kNumIntKeys; ++i) {
+        msg->setInt32(kIntKeys[i], i);
+    }
+    msg->setString("mime", "video/avc");
+    msg->setString("language", "und");
+    msg->setString("android._codec-name", "OMX.google.h264.decoder");
+}
+
+template <typename Message>
+void findAll(const Message *msg) {
+    int32_t value;
+    AString s;
+    for (size_t i = 0; i < kNumIntKeys; ++i) {
+        benchmark::DoNotOptimize(msg->findInt32(kIntKeys[i], &value));
+    }
+    for (size_t i = 0; i < kNumStringKeys; ++i) {
+        benchmark::DoNotOptimize(msg->findString(kStringKeys[i], &s));
+    }
+    benchmark::DoNotOptimize(msg->findInt32("missing", &value));
+}
+
+// Build a format message and read it back, as when a codec reports a format change.
+
+void BM_LegacyFillFindRelease(benchmark::State &state) {
+    while (state.KeepRunning()) {
+        LegacyMessage *msg = new LegacyMessage;
+        fill(msg);
+        findAll(msg);
+        delete msg;
+    }
+}
+BENCHMARK(BM_LegacyFillFindRelease);
+
+void BM_AMessageFillFindRelease(benchmark::State &state) {
+    while (state.KeepRunning()) {
+        sp<AMessage> msg = new AMessage;
+        fill(msg.get());
+        findAll(msg.get());
+    }
+}
+BENCHMARK(BM_AMessageFillFindRelease);
+
+// Read all the keys of an existing message.
+
+void BM_LegacyFind(benchmark::State &state) {
+    LegacyMessage msg;
+    fill(&msg);
+    while (state.KeepRunning()) {
+        findAll(&msg);
+    }
+}
+BENCHMARK(BM_LegacyFind);
+
+void BM_AMessageFind(benchmark::State &state) {
+    sp<AMessage> msg = new AMessage;
+    fill(msg.get());
+    while (state.KeepRunning()) {
+        findAll(msg.get());
+    }
+}
+BENCHMARK(BM_AMessageFind);
+
+// Copy a message, as for each output format sent to the client.
+
+void BM_LegacyDup(benchmark::State &state) {
+    LegacyMessage msg;
+    fill(&msg);
+    while (state.KeepRunning()) {
+        delete msg.dup();
+    }
+}
+BENCHMARK(BM_LegacyDup);
+
+void BM_AMessageDup(benchmark::State &state) {
+    sp<AMessage> msg = new AMessage;
+    fill(msg.get());
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(msg->dup());
+    }
+}
+BENCHMARK(BM_AMessageDup);
+
+} // namespace
+
+BENCHMARK_MAIN();
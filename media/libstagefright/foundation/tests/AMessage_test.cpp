@@ -0,0 +1,141 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AMessage_test"
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AString.h>
+
+namespace android {
+
+class AMessageTest : public ::testing::Test {
+};
+
+TEST_F(AMessageTest, FindReplace) {
+    sp<AMessage> msg = new AMessage;
+    msg->setInt32("width", 1920);
+    msg->setInt64("durationUs", 1000000ll);
+    msg->setString("mime", "video/avc");
+
+    int32_t width;
+    int64_t durationUs;
+    ASSERT_TRUE(msg->findInt32("width", &width));
+    ASSERT_EQ(1920, width);
+    ASSERT_TRUE(msg->findInt64("durationUs", &durationUs));
+    ASSERT_EQ(1000000ll, durationUs);
+    ASSERT_FALSE(msg->findInt32("durationUs", &width));
+    ASSERT_FALSE(msg->contains("height"));
+
+    // the name does not need to be the same pointer
+    char name[] = "width";
+    ASSERT_TRUE(msg->contains(name));
+
+    msg->setString("width", "wide");
+    AString s;
+    ASSERT_FALSE(msg->findInt32("width", &width));
+    ASSERT_TRUE(msg->findString("width", &s));
+    ASSERT_STREQ("wide", s.c_str());
+    ASSERT_EQ(3u, msg->countEntries());
+}
+
+TEST_F(AMessageTest, Strings) {
+    static const char kShort[] = "audio/mp4a-latm";    // stored in the item
+    static const char kLong[] = "video/x-vnd.on2.vp9";  // stored in an AString
+    static const char kNul[] = "a\0b";
+
+    sp<AMessage> msg = new AMessage;
+    msg->setString("short", kShort);
+    msg->setString("long", kLong);
+    msg->setString("nul", kNul, sizeof(kNul) - 1);
+    msg->setString("empty", "");
+
+    AString s;
+    ASSERT_TRUE(msg->findString("short", &s));
+    ASSERT_STREQ(kShort, s.c_str());
+    ASSERT_TRUE(msg->findString("long", &s));
+    ASSERT_STREQ(kLong, s.c_str());
+    ASSERT_TRUE(msg->findString("nul", &s));
+    ASSERT_EQ(sizeof(kNul) - 1, s.size());
+    ASSERT_EQ(0, memcmp(kNul, s.c_str(), s.size()));
+    ASSERT_TRUE(msg->findString("empty", &s));
+    ASSERT_EQ(0u, s.size());
+
+    // replace an inline value with a heap value and back
+    msg->setString("short", kLong);
+    ASSERT_TRUE(msg->findString("short", &s));
+    ASSERT_STREQ(kLong, s.c_str());
+    msg->setString("long", kShort);
+    ASSERT_TRUE(msg->findString("long", &s));
+    ASSERT_STREQ(kShort, s.c_str());
+}
+
+TEST_F(AMessageTest, DupAndChanges) {
+    // longer than the longest interned name
+    AString longName("a name which is too long to be interned, so the message has a copy of it");
+
+    sp<AMessage> msg = new AMessage;
+    msg->setInt32("int", 1);
+    msg->setString("short", "short");
+    msg->setString("long", "a string which does not fit in an item");
+    msg->setInt32(longName.c_str(), 2);
+    sp<AMessage> inner = new AMessage;
+    inner->setString("inner", "value");
+    msg->setMessage("message", inner);
+
+    sp<AMessage> copy = msg->dup();
+    msg.clear();
+
+    int32_t value;
+    AString s;
+    sp<AMessage> innerCopy;
+    ASSERT_TRUE(copy->findInt32("int", &value));
+    ASSERT_EQ(1, value);
+    ASSERT_TRUE(copy->findString("short", &s));
+    ASSERT_STREQ("short", s.c_str());
+    ASSERT_TRUE(copy->findString("long", &s));
+    ASSERT_STREQ("a string which does not fit in an item", s.c_str());
+    ASSERT_TRUE(copy->findInt32(longName.c_str(), &value));
+    ASSERT_EQ(2, value);
+    ASSERT_TRUE(copy->findMessage("message", &innerCopy));
+    ASSERT_NE(inner.get(), innerCopy.get());
+    ASSERT_TRUE(innerCopy->findString("inner", &s));
+    ASSERT_STREQ("value", s.c_str());
+
+    sp<AMessage> other = copy->dup();
+    other->setString("short", "shorter");
+    sp<AMessage> diff = other->changesFrom(copy);
+    ASSERT_EQ(1u, diff->countEntries());
+    ASSERT_TRUE(diff->findString("short", &s));
+    ASSERT_STREQ("shorter", s.c_str());
+}
+
+TEST_F(AMessageTest, Pool) {
+    // released messages are reused by the same thread
+    AMessage *first = new AMessage;
+    first->incStrong(this);
+    first->setString("mime", "audio/raw");
+    first->decStrong(this);
+
+    sp<AMessage> second = new AMessage;
+    ASSERT_EQ(first, second.get());
+    ASSERT_EQ(0u, second->countEntries());
+    ASSERT_FALSE(second->contains("mime"));
+}
+
+} // namespace android
@@ -0,0 +1,251 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ANetworkSession_test"
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <map>
+#include <string>
+#include <sys/select.h>
+#include <unistd.h>
+#include <vector>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/ANetworkSession.h>
+
+namespace android {
+
+// Sessions use ports from here on, on the loopback interface.
+static const unsigned kBasePort = 47000;
+
+struct SessionHandler : public AHandler {
+    size_t numDatagrams(int32_t sessionID) {
+        Mutex::Autolock autoLock(mLock);
+        return mDatagrams[sessionID].size();
+    }
+
+    std::string datagram(int32_t sessionID, size_t i) {
+        Mutex::Autolock autoLock(mLock);
+        return mDatagrams[sessionID][i];
+    }
+
+    size_t numConnected() {
+        Mutex::Autolock autoLock(mLock);
+        return mNumConnected;
+    }
+
+    size_t numClients() {
+        Mutex::Autolock autoLock(mLock);
+        return mClients.size();
+    }
+
+    int32_t client(size_t i) {
+        Mutex::Autolock autoLock(mLock);
+        return mClients[i];
+    }
+
+    size_t numErrors() {
+        Mutex::Autolock autoLock(mLock);
+        return mNumErrors;
+    }
+
+    // waits until (this->*count)() reaches value, returns false on timeout
+    bool waitFor(size_t (SessionHandler::*count)(), size_t value) {
+        for (int i = 0; i < 500 && (this->*count)() < value; ++i) {
+            usleep(10000);
+        }
+        return (this->*count)() >= value;
+    }
+
+    bool waitForDatagrams(int32_t sessionID, size_t value) {
+        for (int i = 0; i < 500 && numDatagrams(sessionID) < value; ++i) {
+            usleep(10000);
+        }
+        return numDatagrams(sessionID) >= value;
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        int32_t reason, sessionID;
+        CHECK(msg->findInt32("reason", &reason));
+        CHECK(msg->findInt32("sessionID", &sessionID));
+
+        Mutex::Autolock autoLock(mLock);
+        switch (reason) {
+            case ANetworkSession::kWhatDatagram:
+            {
+                sp<ABuffer> data;
+                CHECK(msg->findBuffer("data", &data));
+                mDatagrams[sessionID].push_back(
+                        std::string((const char *)data->data(), data->size()));
+                break;
+            }
+            case ANetworkSession::kWhatConnected:
+                ++mNumConnected;
+                break;
+            case ANetworkSession::kWhatClientConnected:
+                mClients.push_back(sessionID);
+                break;
+            case ANetworkSession::kWhatError:
+                ++mNumErrors;
+                break;
+            default:
+                break;
+        }
+    }
+
+private:
+    Mutex mLock;
+    std::map<int32_t, std::vector<std::string> > mDatagrams;
+    std::vector<int32_t> mClients;
+    size_t mNumConnected = 0;
+    size_t mNumErrors = 0;
+};
+
+class ANetworkSessionTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mLooper = new ALooper;
+        mLooper->setName("ANetworkSession_test");
+        mHandler = new SessionHandler;
+        mLooper->registerHandler(mHandler);
+        ASSERT_EQ(OK, mLooper->start());
+
+        mSession = new ANetworkSession;
+        ASSERT_EQ(OK, mSession->start());
+    }
+
+    virtual void TearDown() {
+        mSession->stop();
+        mLooper->unregisterHandler(mHandler->id());
+        mLooper->stop();
+    }
+
+    sp<AMessage> notify() {
+        return new AMessage(0, mHandler);
+    }
+
+    static std::string payload(int i, size_t size) {
+        std::string s(size, '\0');
+        for (size_t j = 0; j < size; ++j) {
+            s[j] = (char)(i * 31 + j);
+        }
+        return s;
+    }
+
+    sp<ALooper> mLooper;
+    sp<SessionHandler> mHandler;
+    sp<ANetworkSession> mSession;
+};
+
+TEST_F(ANetworkSessionTest, UDP) {
+    int32_t server, client;
+    ASSERT_EQ(OK, mSession->createUDPSession(kBasePort, notify(), &server));
+    ASSERT_EQ(OK, mSession->createUDPSession(
+            kBasePort + 1, "127.0.0.1", kBasePort, notify(), &client));
+
+    // in batches, as datagrams are dropped when the socket buffer is full
+    const int kNumDatagrams = 500;
+    for (int i = 0; i < kNumDatagrams; ++i) {
+        std::string data = payload(i, 1 + (i * 7) % 1400);
+        ASSERT_EQ(OK, mSession->sendRequest(client, data.data(), data.size()));
+        if (i % 50 == 49) {
+            ASSERT_TRUE(mHandler->waitForDatagrams(server, i + 1));
+        }
+    }
+    for (int i = 0; i < kNumDatagrams; ++i) {
+        EXPECT_EQ(payload(i, 1 + (i * 7) % 1400), mHandler->datagram(server, i)) << i;
+    }
+
+    ASSERT_EQ(OK, mSession->connectUDPSession(server, "127.0.0.1", kBasePort + 1));
+    ASSERT_EQ(OK, mSession->sendRequest(server, "pong", 4));
+    ASSERT_TRUE(mHandler->waitForDatagrams(client, 1));
+    EXPECT_EQ("pong", mHandler->datagram(client, 0));
+    EXPECT_EQ(0u, mHandler->numErrors());
+}
+
+TEST_F(ANetworkSessionTest, TCPDatagrams) {
+    struct in_addr addr;
+    ASSERT_NE(0, inet_aton("127.0.0.1", &addr));
+
+    int32_t server, client;
+    ASSERT_EQ(OK, mSession->createTCPDatagramSession(
+            addr, kBasePort + 10, notify(), &server));
+    ASSERT_EQ(OK, mSession->createTCPDatagramSession(
+            kBasePort + 11, "127.0.0.1", kBasePort + 10, notify(), &client));
+    ASSERT_TRUE(mHandler->waitFor(&SessionHandler::numConnected, 1));
+    ASSERT_TRUE(mHandler->waitFor(&SessionHandler::numClients, 1));
+    int32_t peer = mHandler->client(0);
+
+    // large enough for partial writes
+    const int kNumDatagrams = 300;
+    for (int i = 0; i < kNumDatagrams; ++i) {
+        std::string data = payload(i, 1 + (i * 997) % 60000);
+        ASSERT_EQ(OK, mSession->sendRequest(client, data.data(), data.size()));
+    }
+    ASSERT_TRUE(mHandler->waitForDatagrams(peer, kNumDatagrams));
+    for (int i = 0; i < kNumDatagrams; ++i) {
+        EXPECT_EQ(payload(i, 1 + (i * 997) % 60000), mHandler->datagram(peer, i)) << i;
+    }
+
+    ASSERT_EQ(OK, mSession->sendRequest(peer, "back", 4));
+    ASSERT_TRUE(mHandler->waitForDatagrams(client, 1));
+    EXPECT_EQ("back", mHandler->datagram(client, 0));
+
+    // the client sees the connection go away
+    ASSERT_EQ(OK, mSession->destroySession(peer));
+    EXPECT_EQ(-ENOENT, mSession->destroySession(peer));
+    EXPECT_TRUE(mHandler->waitFor(&SessionHandler::numErrors, 1));
+}
+
+TEST_F(ANetworkSessionTest, BeyondFdSetSize) {
+    int32_t server;
+    ASSERT_EQ(OK, mSession->createUDPSession(kBasePort + 100, notify(), &server));
+
+    const int kNumSessions = FD_SETSIZE + 100;
+    std::vector<int32_t> sessions(kNumSessions);
+    for (int i = 0; i < kNumSessions; ++i) {
+        status_t err = mSession->createUDPSession(
+                kBasePort + 101 + i, "127.0.0.1", kBasePort + 100, notify(), &sessions[i]);
+        if (err == -EMFILE) {
+            sessions.resize(i);
+            break;
+        }
+        ASSERT_EQ(OK, err);
+    }
+
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        std::string data = payload(i, 64);
+        ASSERT_EQ(OK, mSession->sendRequest(sessions[i], data.data(), data.size()));
+        if (i % 100 == 99) {
+            ASSERT_TRUE(mHandler->waitForDatagrams(server, i + 1));
+        }
+    }
+    ASSERT_TRUE(mHandler->waitForDatagrams(server, sessions.size()));
+
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        ASSERT_EQ(OK, mSession->destroySession(sessions[i]));
+    }
+}
+
+} // namespace android
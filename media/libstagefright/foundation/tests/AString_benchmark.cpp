@@ -0,0 +1,298 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares AString with the heap only storage it had before short strings were kept
+// inline, on the string handling of an HLS playlist parse as done by M3UParser.
+
+#include <benchmark/benchmark.h>
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include <media/stagefright/foundation/AString.h>
+
+using namespace android;
+
+namespace {
+
+// The previous AString storage, reduced to what the parse below needs, and counting
+// its allocations.
+class LegacyString {
+public:
+    LegacyString() : mData((char *)kEmptyString), mSize(0), mAllocSize(1) { }
+    LegacyString(const LegacyString &from, size_t offset, size_t n)
+        : mData(NULL), mSize(0), mAllocSize(1) {
+        setTo(from.mData + offset, n);
+    }
+    explicit LegacyString(const char *s) : mData(NULL), mSize(0), mAllocSize(1) {
+        setTo(s, strlen(s));
+    }
+    ~LegacyString() { clear(); }
+
+    // not inlined, to compare with the calls into AString
+    __attribute__((noinline)) void setTo(const char *s, size_t size) {
+        clear();
+        append(s, size);
+    }
+
+    __attribute__((noinline)) void clear() {
+        if (mData && mData != kEmptyString) {
+            free(mData);
+        }
+        mData = (char *)kEmptyString;
+        mSize = 0;
+        mAllocSize = 1;
+    }
+
+    __attribute__((noinline)) void append(const char *s, size_t size) {
+        if (mData == kEmptyString) {
+            mData = strdup(kEmptyString);
+            ++sNumAllocations;
+        }
+        if (mSize + size + 1 > mAllocSize) {
+            mAllocSize = (mAllocSize + size + 31) & -32;
+            mData = (char *)realloc(mData, mAllocSize);
+            ++sNumAllocations;
+        }
+        memcpy(&mData[mSize], s, size);
+        mSize += size;
+        mData[mSize] = '\0';
+    }
+
+    __attribute__((noinline)) void trim() {
+        size_t i = 0;
+        while (i < mSize && isspace(mData[i])) {
+            ++i;
+        }
+        size_t j = mSize;
+        while (j > i && isspace(mData[j - 1])) {
+            --j;
+        }
+        memmove(mData, &mData[i], j - i);
+        mSize = j - i;
+        mData[mSize] = '\0';
+    }
+
+    __attribute__((noinline)) ssize_t find(const char *substring, size_t start = 0) const {
+        const char *match = strstr(mData + start, substring);
+        return match == NULL ? -1 : match - mData;
+    }
+
+    __attribute__((noinline)) bool startsWith(const char *prefix) const {
+        return !strncmp(mData, prefix, strlen(prefix));
+    }
+
+    size_t size() const { return mSize; }
+    const char *c_str() const { return mData; }
+    bool empty() const { return mSize == 0; }
+
+    static size_t sNumAllocations;
+
+private:
+    static const char *const kEmptyString;
+
+    char *mData;
+    size_t mSize;
+    size_t mAllocSize;
+};
+
+size_t LegacyString::sNumAllocations;
+const char *const LegacyString::kEmptyString = "";
+
+// A master playlist with its renditions, followed by a media playlist.
+class Playlist {
+public:
+    Playlist() {
+        mData = "#EXTM3U\n#EXT-X-VERSION:4\n#EXT-X-INDEPENDENT-SEGMENTS\n";
+        static const char *const kLanguages[] = { "en", "fr", "de", "es", "ja", "pt" };
+        for (size_t i = 0; i < 6; ++i) {
+            append("#EXT-X-MEDIA:TYPE=AUDIO,GROUP-ID=\"aac\",LANGUAGE=\"%s\",NAME=\"Audio %zu\","
+                   "AUTOSELECT=YES,DEFAULT=%s,URI=\"audio/%s/prog_index.m3u8\"\n",
+                   kLanguages[i], i, i == 0 ? "YES" : "NO", kLanguages[i]);
+        }
+        for (size_t i = 0; i < 8; ++i) {
+            append("#EXT-X-STREAM-INF:BANDWIDTH=%zu,AVERAGE-BANDWIDTH=%zu,"
+                   "CODECS=\"avc1.640028,mp4a.40.2\",RESOLUTION=%zux%zu,FRAME-RATE=29.970,"
+                   "AUDIO=\"aac\"\nv%zu/prog_index.m3u8\n",
+                   (i + 1) * 800000, (i + 1) * 700000, 160 * (i + 1), 90 * (i + 1), i);
+        }
+        mData += "#EXTM3U\n#EXT-X-TARGETDURATION:6\n#EXT-X-MEDIA-SEQUENCE:0\n";
+        append("#EXT-X-KEY:METHOD=AES-128,URI=\"https://example.com/key\",IV=0x%032x\n", 1);
+        for (size_t i = 0; i < 600; ++i) {
+            append("#EXTINF:6.00600,\n#EXT-X-BYTERANGE:%zu@%zu\nfileSequence%zu.ts\n",
+                   1000000 + i, 1000000 * i, i);
+        }
+        mData += "#EXT-X-ENDLIST\n";
+    }
+
+    const char *data() const { return mData.c_str(); }
+    size_t size() const { return mData.size(); }
+
+private:
+    std::string mData;
+
+    void append(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+        char tmp[512];
+        va_list ap;
+        va_start(ap, format);
+        vsnprintf(tmp, sizeof(tmp), format, ap);
+        va_end(ap);
+        mData += tmp;
+    }
+};
+
+const Playlist &GetPlaylist() {
+    static Playlist playlist;
+    return playlist;
+}
+
+// AString allocates once for each string too long to be stored inline.
+const size_t kMaxInlineLength = 23;
+size_t gNumLongStrings;
+
+template <typename String>
+void Use(const String &s) {
+    benchmark::DoNotOptimize(s.c_str());
+    if (s.size() > kMaxInlineLength) {
+        ++gNumLongStrings;
+    }
+}
+
+// The string handling of M3UParser::parse() and parseStreamInf(): each line, and the key
+// and value of each attribute, is copied into a string of its own.
+template <typename String>
+size_t ParsePlaylist(const char *data, size_t size) {
+    size_t numAttributes = 0;
+    size_t offset = 0;
+    while (offset < size) {
+        size_t offsetLF = offset;
+        while (offsetLF < size && data[offsetLF] != '\n') {
+            ++offsetLF;
+        }
+
+        String line;
+        line.setTo(&data[offset], offsetLF - offset);
+        offset = offsetLF + 1;
+
+        if (line.empty() || !line.startsWith("#EXT")) {
+            String uri(line, 0, line.size());
+            Use(uri);
+            Use(line);
+            continue;
+        }
+
+        Use(line);
+        ssize_t colonPos = line.find(":");
+        if (colonPos < 0) {
+            continue;
+        }
+
+        size_t attrOffset = colonPos + 1;
+        while (attrOffset < line.size()) {
+            ssize_t end = line.find(",", attrOffset);
+            if (end < 0) {
+                end = line.size();
+            }
+
+            String attr(line, attrOffset, end - attrOffset);
+            Use(attr);
+            attr.trim();
+            attrOffset = end + 1;
+
+            ssize_t equalPos = attr.find("=");
+            if (equalPos < 0) {
+                continue;
+            }
+
+            String key(attr, 0, equalPos);
+            key.trim();
+
+            String val(attr, equalPos + 1, attr.size() - equalPos - 1);
+            val.trim();
+
+            Use(key);
+            Use(val);
+            ++numAttributes;
+        }
+    }
+    return numAttributes;
+}
+
+void BM_ParsePlaylist(benchmark::State &state) {
+    const Playlist &playlist = GetPlaylist();
+    gNumLongStrings = 0;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(ParsePlaylist<AString>(playlist.data(), playlist.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * playlist.size());
+    state.counters["allocs/parse"] = (double)gNumLongStrings / state.iterations();
+}
+BENCHMARK(BM_ParsePlaylist);
+
+void BM_ParsePlaylistLegacy(benchmark::State &state) {
+    const Playlist &playlist = GetPlaylist();
+    LegacyString::sNumAllocations = 0;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(ParsePlaylist<LegacyString>(playlist.data(), playlist.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * playlist.size());
+    state.counters["allocs/parse"] = (double)LegacyString::sNumAllocations / state.iterations();
+}
+BENCHMARK(BM_ParsePlaylistLegacy);
+
+// The MIME types, component names and short values set while configuring a codec
+// with ACodec.
+const char *const kCodecValues[] = {
+    "video/avc", "audio/mp4a-latm", "OMX.google.h264.decoder", "video/raw", "en",
+    "OMX.google.aac.decoder", "audio/raw", "video/hevc",
+};
+
+template <typename String>
+void ConfigureStrings() {
+    for (const char *value : kCodecValues) {
+        String s(value);
+        String copy(s, 0, s.size());
+        Use(s);
+        Use(copy);
+    }
+}
+
+void BM_ShortStrings(benchmark::State &state) {
+    gNumLongStrings = 0;
+    while (state.KeepRunning()) {
+        ConfigureStrings<AString>();
+    }
+    state.counters["allocs/configure"] = (double)gNumLongStrings / state.iterations();
+}
+BENCHMARK(BM_ShortStrings);
+
+void BM_ShortStringsLegacy(benchmark::State &state) {
+    LegacyString::sNumAllocations = 0;
+    while (state.KeepRunning()) {
+        ConfigureStrings<LegacyString>();
+    }
+    state.counters["allocs/configure"] =
+            (double)LegacyString::sNumAllocations / state.iterations();
+}
+BENCHMARK(BM_ShortStringsLegacy);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AString_test"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <media/stagefright/foundation/AString.h>
+
+namespace android {
+
+TEST(AStringTest, Empty) {
+    AString s;
+    EXPECT_TRUE(s.empty());
+    EXPECT_EQ(0u, s.size());
+    EXPECT_STREQ("", s.c_str());
+
+    AString fromNull((const char *)NULL);
+    EXPECT_STREQ("", fromNull.c_str());
+
+    s.append("");
+    s.trim();
+    s.tolower();
+    EXPECT_STREQ("", s.c_str());
+}
+
+// Grows one character at a time across the inline storage limit, comparing with
+// std::string.
+TEST(AStringTest, Append) {
+    AString s;
+    std::string expected;
+    for (int i = 0; i < 100; ++i) {
+        s.append((char)('a' + i % 26));
+        expected += (char)('a' + i % 26);
+        ASSERT_EQ(expected.size(), s.size());
+        ASSERT_STREQ(expected.c_str(), s.c_str());
+        ASSERT_EQ('\0', s.c_str()[s.size()]);
+    }
+
+    s.clear();
+    EXPECT_STREQ("", s.c_str());
+    s.append("video/avc");
+    EXPECT_STREQ("video/avc", s.c_str());
+}
+
+TEST(AStringTest, CopyAndAssign) {
+    const char *const kValues[] = {
+        "", "en", "video/avc", "twenty three characters",
+        "a string which is too long to be stored inline",
+    };
+    for (const char *value : kValues) {
+        AString s(value);
+        AString copy(s);
+        EXPECT_STREQ(value, copy.c_str());
+        EXPECT_NE(s.c_str(), copy.c_str());
+
+        AString assigned("something else entirely, which is long");
+        assigned = s;
+        EXPECT_STREQ(value, assigned.c_str());
+        EXPECT_TRUE(assigned == s);
+
+        assigned = AString("ab");
+        EXPECT_STREQ("ab", assigned.c_str());
+    }
+
+    // copies in a vector stay valid as it grows
+    std::vector<AString> strings;
+    for (int i = 0; i < 100; ++i) {
+        strings.push_back(AStringPrintf("%d", i));
+    }
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(AStringPrintf("%d", i), strings[i]);
+    }
+}
+
+TEST(AStringTest, Edit) {
+    AString s("  AUDIO=\"aac\" ");
+    s.trim();
+    EXPECT_STREQ("AUDIO=\"aac\"", s.c_str());
+    s.tolower();
+    EXPECT_STREQ("audio=\"aac\"", s.c_str());
+    s.erase(0, 6);
+    EXPECT_STREQ("\"aac\"", s.c_str());
+    EXPECT_EQ(1, s.find("aac"));
+
+    // insertion across the inline storage limit
+    s.insert(AString("a longer prefix, "), 0);
+    EXPECT_STREQ("a longer prefix, \"aac\"", s.c_str());
+    s.insert("which is inserted ", strlen("which is inserted "), 2);
+    EXPECT_STREQ("a which is inserted longer prefix, \"aac\"", s.c_str());
+    EXPECT_TRUE(s.startsWith("a which"));
+    EXPECT_TRUE(s.endsWith("\"aac\""));
+
+    AString sub(s, 2, 5);
+    EXPECT_STREQ("which", sub.c_str());
+}
+
+} // namespace android
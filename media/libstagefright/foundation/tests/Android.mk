@@ -8,8 +8,15 @@ LOCAL_MODULE := sf_foundation_test
 LOCAL_MODULE_TAGS := tests
 
 LOCAL_SRC_FILES := \
+	ABitReader_test.cpp \
+	ABufferPool_test.cpp \
 	AData_test.cpp \
+	ALooper_test.cpp \
+	AMessage_test.cpp \
+	ANetworkSession_test.cpp \
+	AString_test.cpp \
 	Flagged_test.cpp \
+	MediaBufferGroup_test.cpp \
 	TypeTraits_test.cpp \
 	Utils_test.cpp \
 
@@ -25,6 +32,31 @@ LOCAL_CLANG := true
 
 include $(BUILD_NATIVE_TEST)
 
+# Build the benchmarks.
+include $(CLEAR_VARS)
+LOCAL_ADDITIONAL_DEPENDENCIES := $(LOCAL_PATH)/Android.mk
+
+LOCAL_MODULE := sf_foundation_benchmark
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+	ABitReader_benchmark.cpp \
+	AMessage_benchmark.cpp \
+	AString_benchmark.cpp \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright_foundation \
+	libutils \
+
+LOCAL_C_INCLUDES := \
+	frameworks/av/include \
+
+LOCAL_CFLAGS += -Werror -Wall
+LOCAL_CLANG := true
+
+include $(BUILD_NATIVE_BENCHMARK)
+
 # Include subdirectory makefiles
 # ============================================================
 
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MediaBufferGroup_test"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <pthread.h>
+#include <set>
+#include <unistd.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaBufferGroup.h>
+
+namespace android {
+
+static const size_t kBuffers = 4;
+static const size_t kBufferSize = 1024; // below the shared memory threshold
+
+TEST(MediaBufferGroupTest, FixedAcquireRelease) {
+    MediaBufferGroup group(kBuffers, kBufferSize);
+    std::set<MediaBuffer *> acquired;
+    for (size_t i = 0; i < kBuffers; ++i) {
+        MediaBuffer *buffer;
+        ASSERT_EQ(OK, group.acquire_buffer(&buffer, true /* nonBlocking */));
+        ASSERT_EQ(1, buffer->refcount());
+        ASSERT_EQ(kBufferSize, buffer->range_length());
+        acquired.insert(buffer);
+    }
+    ASSERT_EQ(kBuffers, acquired.size());
+    ASSERT_FALSE(group.has_buffers());
+
+    MediaBuffer *buffer;
+    ASSERT_EQ(WOULD_BLOCK, group.acquire_buffer(&buffer, true /* nonBlocking */));
+    ASSERT_EQ(nullptr, buffer);
+
+    MediaBuffer *first = *acquired.begin();
+    first->set_range(0, 10);
+    first->release();
+    ASSERT_EQ(OK, group.acquire_buffer(&buffer, true /* nonBlocking */));
+    ASSERT_EQ(first, buffer);
+    ASSERT_EQ(kBufferSize, buffer->range_length());
+
+    for (MediaBuffer *buffer : acquired) {
+        buffer->release();
+    }
+    ASSERT_EQ(kBuffers, group.buffers());
+}
+
+TEST(MediaBufferGroupTest, FixedLargerRequest) {
+    MediaBufferGroup group(kBuffers, kBufferSize);
+    MediaBuffer *buffer;
+    ASSERT_EQ(OK, group.acquire_buffer(&buffer, true /* nonBlocking */));
+    buffer->release();
+
+    // replaces a free buffer, as before
+    MediaBuffer *large;
+    ASSERT_EQ(OK, group.acquire_buffer(&large, true /* nonBlocking */, kBufferSize * 2));
+    ASSERT_LE(kBufferSize * 2, large->size());
+    ASSERT_EQ(kBuffers, group.buffers());
+    large->release();
+
+    ASSERT_EQ(OK, group.acquire_buffer(&buffer, true /* nonBlocking */, kBufferSize * 2));
+    ASSERT_EQ(large, buffer);
+    buffer->release();
+}
+
+struct AcquireArgs {
+    MediaBufferGroup *mGroup;
+    std::atomic<int> *mInUse;   // one counter per buffer of the group
+    MediaBuffer **mBuffers;
+    std::atomic<int> mErrors;
+};
+
+static void *acquireMany(void *arg) {
+    AcquireArgs *args = (AcquireArgs *)arg;
+    for (int i = 0; i < 10000; ++i) {
+        MediaBuffer *buffer;
+        if (args->mGroup->acquire_buffer(&buffer) != OK) {
+            ++args->mErrors;
+            continue;
+        }
+        size_t index = 0;
+        while (index < kBuffers && args->mBuffers[index] != buffer) {
+            ++index;
+        }
+        if (index == kBuffers) {
+            ++args->mErrors;
+            buffer->release();
+            continue;
+        }
+        if (args->mInUse[index]++ != 0) {
+            ++args->mErrors; // acquired by two threads at once
+        }
+        usleep(10); // hold the buffer, so that other threads wait for one
+        --args->mInUse[index];
+        buffer->release();
+    }
+    return NULL;
+}
+
+TEST(MediaBufferGroupTest, FixedConcurrentAcquire) {
+    MediaBufferGroup group(kBuffers, kBufferSize);
+    MediaBuffer *buffers[kBuffers];
+    for (size_t i = 0; i < kBuffers; ++i) {
+        ASSERT_EQ(OK, group.acquire_buffer(&buffers[i], true /* nonBlocking */));
+    }
+    for (size_t i = 0; i < kBuffers; ++i) {
+        buffers[i]->release();
+    }
+
+    static const size_t kThreads = kBuffers * 2; // so that some of them block
+    std::atomic<int> inUse[kBuffers];
+    for (size_t i = 0; i < kBuffers; ++i) {
+        inUse[i] = 0;
+    }
+    AcquireArgs args;
+    args.mGroup = &group;
+    args.mInUse = inUse;
+    args.mBuffers = buffers;
+    args.mErrors = 0;
+    pthread_t threads[kThreads];
+    for (size_t i = 0; i < kThreads; ++i) {
+        ASSERT_EQ(0, pthread_create(&threads[i], NULL, acquireMany, &args));
+    }
+    for (size_t i = 0; i < kThreads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    ASSERT_EQ(0, args.mErrors.load());
+    ASSERT_TRUE(group.has_buffers());
+    ALOGV("%s", group.debugStats().c_str());
+}
+
+} // namespace android
@@ -0,0 +1,295 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AbrController"
+#include <utils/Log.h>
+
+#include "AbrController.h"
+
+#include <algorithm>
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <utils/List.h>
+#include <utils/Mutex.h>
+
+namespace android {
+
+// An exponentially weighted moving average of throughput samples, weighted
+// by the time each sample took, so that a few short downloads do not
+// outweigh a long one.
+struct Ewma {
+    explicit Ewma(double halfLifeSecs)
+        : mHalfLifeSecs(halfLifeSecs),
+          mEstimate(0.0),
+          mTotalWeight(0.0) {
+    }
+
+    void addSample(double weight, double value) {
+        double alpha = pow(0.5, weight / mHalfLifeSecs);
+        mEstimate = value * (1.0 - alpha) + alpha * mEstimate;
+        mTotalWeight += weight;
+    }
+
+    double getEstimate() const {
+        // undo the bias towards the initial estimate of 0
+        double zeroFactor = 1.0 - pow(0.5, mTotalWeight / mHalfLifeSecs);
+        return zeroFactor > 0.0 ? mEstimate / zeroFactor : 0.0;
+    }
+
+private:
+    double mHalfLifeSecs;
+    double mEstimate;
+    double mTotalWeight;
+};
+
+// Estimates the throughput as the lower of a fast and a slow moving
+// average, so that it follows drops quickly and rises slowly, and only
+// switches up to a variant that the 20th percentile of the recent samples
+// can sustain as well, which keeps short bursts from causing an up switch
+// that is undone a few segments later. Between those bounds the variant
+// follows the buffered duration: above kReservoirUs the controller moves up
+// one variant at a time, at most every kMinUpSwitchIntervalUs, towards the
+// variant that the position of the buffer in the cushion above the
+// reservoir maps to.
+struct ThroughputBufferAbrController : public AbrController {
+    ThroughputBufferAbrController();
+
+    virtual void addBandwidthMeasurement(
+            size_t numBytes, int64_t delayUs, int64_t nowUs);
+    virtual int32_t getBandwidthEstimate();
+    virtual size_t selectVariant(
+            const Vector<int32_t> &bandwidths, size_t curIndex,
+            int64_t bufferedDurationUs, bool allowUpSwitch, int64_t nowUs,
+            ssize_t *predictedIndex);
+
+private:
+    static const double kFastHalfLifeSecs;
+    static const double kSlowHalfLifeSecs;
+    static const double kBandwidthFraction;
+    static const int64_t kReservoirUs;
+    static const int64_t kCushionUs;
+    static const int64_t kMinUpSwitchIntervalUs;
+    static const int64_t kMaxSampleAgeUs;
+
+    enum {
+        kMinSamples = 2,
+        kMaxSamples = 30,
+        kPercentile = 20,
+    };
+
+    struct Sample {
+        int64_t mTimeUs;
+        int32_t mBps;
+    };
+
+    Mutex mLock;
+    Ewma mFast;
+    Ewma mSlow;
+    List<Sample> mSamples;
+    int64_t mLastSwitchUs;
+
+    int32_t getBandwidthEstimate_l();
+    int32_t getPercentile_l(int64_t nowUs);
+
+    // Returns the highest playable variant within |bps|, or the lowest
+    // playable one if none is.
+    static size_t getIndexForBandwidth(const Vector<int32_t> &bandwidths, int64_t bps);
+
+    DISALLOW_EVIL_CONSTRUCTORS(ThroughputBufferAbrController);
+};
+
+const double ThroughputBufferAbrController::kFastHalfLifeSecs = 2.0;
+const double ThroughputBufferAbrController::kSlowHalfLifeSecs = 5.0;
+// the fraction of the estimate a variant may use, as getBandwidthIndex()
+const double ThroughputBufferAbrController::kBandwidthFraction = 0.7;
+const int64_t ThroughputBufferAbrController::kReservoirUs = 5000000ll;
+const int64_t ThroughputBufferAbrController::kCushionUs = 15000000ll;
+const int64_t ThroughputBufferAbrController::kMinUpSwitchIntervalUs = 10000000ll;
+const int64_t ThroughputBufferAbrController::kMaxSampleAgeUs = 60000000ll;
+
+ThroughputBufferAbrController::ThroughputBufferAbrController()
+    : mFast(kFastHalfLifeSecs),
+      mSlow(kSlowHalfLifeSecs),
+      mLastSwitchUs(-1ll) {
+}
+
+void ThroughputBufferAbrController::addBandwidthMeasurement(
+        size_t numBytes, int64_t delayUs, int64_t nowUs) {
+    if (delayUs <= 0) {
+        return;
+    }
+
+    Mutex::Autolock autoLock(mLock);
+
+    double bps = numBytes * 8E6 / delayUs;
+    double weight = delayUs / 1E6;
+    mFast.addSample(weight, bps);
+    mSlow.addSample(weight, bps);
+
+    Sample sample;
+    sample.mTimeUs = nowUs;
+    sample.mBps = (int32_t)std::min(bps, (double)INT32_MAX);
+    mSamples.push_back(sample);
+    while (mSamples.size() > kMaxSamples) {
+        mSamples.erase(mSamples.begin());
+    }
+}
+
+int32_t ThroughputBufferAbrController::getBandwidthEstimate() {
+    Mutex::Autolock autoLock(mLock);
+    return getBandwidthEstimate_l();
+}
+
+int32_t ThroughputBufferAbrController::getBandwidthEstimate_l() {
+    if (mSamples.size() < kMinSamples) {
+        return -1;
+    }
+    double bps = std::min(mFast.getEstimate(), mSlow.getEstimate());
+    return (int32_t)std::min(bps, (double)INT32_MAX);
+}
+
+int32_t ThroughputBufferAbrController::getPercentile_l(int64_t nowUs) {
+    Vector<int32_t> values;
+    for (List<Sample>::iterator it = mSamples.begin(); it != mSamples.end(); ++it) {
+        if (nowUs - (*it).mTimeUs <= kMaxSampleAgeUs) {
+            values.push((*it).mBps);
+        }
+    }
+    if (values.size() < kMinSamples) {
+        return -1;
+    }
+    std::sort(values.editArray(), values.editArray() + values.size());
+    return values[values.size() * kPercentile / 100];
+}
+
+// static
+size_t ThroughputBufferAbrController::getIndexForBandwidth(
+        const Vector<int32_t> &bandwidths, int64_t bps) {
+    ssize_t lowest = -1;
+    ssize_t index = -1;
+    for (size_t i = 0; i < bandwidths.size(); ++i) {
+        if (bandwidths[i] <= 0) {
+            continue;
+        }
+        if (lowest < 0) {
+            lowest = i;
+        }
+        if (bandwidths[i] <= bps) {
+            index = i;
+        }
+    }
+    if (index >= 0) {
+        return index;
+    }
+    return lowest >= 0 ? lowest : 0;
+}
+
+size_t ThroughputBufferAbrController::selectVariant(
+        const Vector<int32_t> &bandwidths, size_t curIndex,
+        int64_t bufferedDurationUs, bool allowUpSwitch, int64_t nowUs,
+        ssize_t *predictedIndex) {
+    Mutex::Autolock autoLock(mLock);
+
+    *predictedIndex = -1;
+
+    int32_t estimateBps = getBandwidthEstimate_l();
+    int32_t percentileBps = getPercentile_l(nowUs);
+    if (estimateBps < 0 || percentileBps < 0 || curIndex >= bandwidths.size()) {
+        return curIndex;
+    }
+
+    size_t throughputIndex =
+        getIndexForBandwidth(bandwidths, estimateBps * kBandwidthFraction);
+    size_t stableIndex = getIndexForBandwidth(
+            bandwidths, std::min(estimateBps, percentileBps) * kBandwidthFraction);
+
+    // the variant the buffer maps to, linearly between the lowest and the
+    // highest bandwidth across the cushion
+    int32_t minBps = -1, maxBps = -1;
+    for (size_t i = 0; i < bandwidths.size(); ++i) {
+        if (bandwidths[i] > 0) {
+            minBps = minBps < 0 ? bandwidths[i] : std::min(minBps, bandwidths[i]);
+            maxBps = std::max(maxBps, bandwidths[i]);
+        }
+    }
+    int64_t cushionUs = bufferedDurationUs - kReservoirUs;
+    if (cushionUs < 0) {
+        cushionUs = 0;
+    } else if (cushionUs > kCushionUs) {
+        cushionUs = kCushionUs;
+    }
+    size_t bufferIndex = getIndexForBandwidth(
+            bandwidths, minBps + (int64_t)(maxBps - minBps) * cushionUs / kCushionUs);
+
+    size_t index = curIndex;
+    if (throughputIndex < curIndex) {
+        // The current variant cannot be sustained; drop right away to one
+        // that can, unless the buffer is deep enough to ride it out.
+        if (bufferedDurationUs < kReservoirUs + kCushionUs) {
+            index = throughputIndex;
+        }
+    } else {
+        size_t targetIndex = std::min(stableIndex, bufferIndex);
+        if (targetIndex > curIndex) {
+            bool canSwitchUp = allowUpSwitch
+                    && bufferedDurationUs >= kReservoirUs
+                    && (mLastSwitchUs < 0 || nowUs - mLastSwitchUs >= kMinUpSwitchIntervalUs);
+            if (canSwitchUp) {
+                index = curIndex + 1;
+                while (index < bandwidths.size() && bandwidths[index] <= 0) {
+                    ++index;
+                }
+                if (index >= bandwidths.size()) {
+                    index = curIndex;
+                }
+            } else {
+                *predictedIndex = curIndex + 1;
+            }
+        } else if (stableIndex > curIndex) {
+            // The throughput supports a higher variant; the buffer will
+            // once it has filled.
+            *predictedIndex = curIndex + 1;
+        }
+    }
+
+    if (*predictedIndex >= (ssize_t)bandwidths.size()
+            || (*predictedIndex >= 0 && bandwidths[*predictedIndex] <= 0)) {
+        *predictedIndex = -1;
+    }
+
+    ALOGV("estimate %d bps, p%d %d bps, buffered %lld us: %zu -> %zu (predicted %zd)",
+            estimateBps, kPercentile, percentileBps, (long long)bufferedDurationUs,
+            curIndex, index, *predictedIndex);
+
+    if (index != curIndex) {
+        mLastSwitchUs = nowUs;
+    }
+    return index;
+}
+
+// static
+sp<AbrController> AbrController::Create(const char *name) {
+    if (name != NULL && !strcmp(name, "throughput-buffer")) {
+        return new ThroughputBufferAbrController;
+    }
+    return NULL;
+}
+
+}  // namespace android
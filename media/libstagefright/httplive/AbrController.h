@@ -0,0 +1,64 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ABR_CONTROLLER_H_
+
+#define ABR_CONTROLLER_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/RefBase.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+// Decides which variant of a stream LiveSession plays, from the throughput
+// of the downloads and the duration of the buffered content. Controllers
+// are given the time rather than reading the clock, so that abrsim can
+// replay recorded network traces through them.
+struct AbrController : public RefBase {
+    // Returns the controller called |name|, or NULL if there is none, in
+    // which case LiveSession uses its own bandwidth estimator.
+    static sp<AbrController> Create(const char *name);
+
+    // May be called from any thread.
+    virtual void addBandwidthMeasurement(
+            size_t numBytes, int64_t delayUs, int64_t nowUs) = 0;
+
+    // Returns the estimated throughput in bits per second, or -1 if there
+    // are too few measurements.
+    virtual int32_t getBandwidthEstimate() = 0;
+
+    // |bandwidths| are those of the variants, in ascending order, and 0
+    // for variants that cannot be played. Returns the index of the variant
+    // to play from now on, which is |curIndex| to stay, and sets
+    // |*predictedIndex| to the variant likely to be switched to next, or
+    // to -1.
+    virtual size_t selectVariant(
+            const Vector<int32_t> &bandwidths, size_t curIndex,
+            int64_t bufferedDurationUs, bool allowUpSwitch, int64_t nowUs,
+            ssize_t *predictedIndex) = 0;
+
+protected:
+    AbrController() {}
+    virtual ~AbrController() {}
+
+private:
+    DISALLOW_EVIL_CONSTRUCTORS(AbrController);
+};
+
+}  // namespace android
+
+#endif  // ABR_CONTROLLER_H_
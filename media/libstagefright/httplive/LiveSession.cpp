@@ -19,6 +19,7 @@
 #include <utils/Log.h>
 
 #include "LiveSession.h"
+#include "AbrController.h"
 #include "HTTPDownloader.h"
 #include "M3UParser.h"
 #include "PlaylistFetcher.h"
@@ -283,6 +284,7 @@ LiveSession::LiveSession(
       mLastBandwidthBps(-1ll),
       mLastBandwidthStable(false),
       mBandwidthEstimator(new BandwidthEstimator()),
+      mMinBufferedDurationUs(-1ll),
       mMaxWidth(720),
       mMaxHeight(480),
       mStreamMask(0),
@@ -309,6 +311,12 @@ LiveSession::LiveSession(
         mPacketSources.add(indexToType(i), new AnotherPacketSource(NULL /* meta */));
         mPacketSources2.add(indexToType(i), new AnotherPacketSource(NULL /* meta */));
     }
+
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get("media.httplive.abr", value, NULL)) {
+        mAbrController = AbrController::Create(value);
+        ALOGI("abr controller '%s'%s", value, mAbrController == NULL ? " not found" : "");
+    }
 }
 
 LiveSession::~LiveSession() {
@@ -892,7 +900,12 @@ void LiveSession::onMessageReceived(const sp<AMessage> &msg) {
 
                 case PlaylistFetcher::kWhatPlaylistFetched:
                 {
-                    onMasterPlaylistFetched(msg);
+                    int32_t prefetch;
+                    if (msg->findInt32("prefetch", &prefetch)) {
+                        onVariantPlaylistPrefetched(msg);
+                    } else {
+                        onMasterPlaylistFetched(msg);
+                    }
                     break;
                 }
 
@@ -1143,6 +1156,12 @@ void LiveSession::finishDisconnect() {
     }
     mFetcherInfos.clear();
 
+    for (size_t i = 0; i < mPlaylistPrefetchers.size(); ++i) {
+        mFetcherLooper->unregisterHandler(mPlaylistPrefetchers.valueAt(i)->id());
+    }
+    mPlaylistPrefetchers.clear();
+    mPrefetchedPlaylists.clear();
+
     mPacketSources.valueFor(STREAMTYPE_AUDIO)->signalEOS(ERROR_END_OF_STREAM);
     mPacketSources.valueFor(STREAMTYPE_VIDEO)->signalEOS(ERROR_END_OF_STREAM);
 
@@ -1175,6 +1194,13 @@ sp<PlaylistFetcher> LiveSession::addFetcher(const char *uri) {
     info.mToBeResumed = false;
     mFetcherLooper->registerHandler(info.mFetcher);
 
+    ssize_t prefetchedIndex = mPrefetchedPlaylists.indexOfKey(AString(uri));
+    if (prefetchedIndex >= 0) {
+        const PrefetchedPlaylist &prefetched = mPrefetchedPlaylists.valueAt(prefetchedIndex);
+        info.mFetcher->setPlaylist(prefetched.mPlaylist, prefetched.mFetchTimeUs);
+        mPrefetchedPlaylists.removeItemsAt(prefetchedIndex);
+    }
+
     mFetcherInfos.add(uri, info);
 
     return info.mFetcher;
@@ -1325,6 +1351,9 @@ float LiveSession::getAbortThreshold(
 
 void LiveSession::addBandwidthMeasurement(size_t numBytes, int64_t delayUs) {
     mBandwidthEstimator->addBandwidthMeasurement(numBytes, delayUs);
+    if (mAbrController != NULL) {
+        mAbrController->addBandwidthMeasurement(numBytes, delayUs, ALooper::GetNowUs());
+    }
 }
 
 ssize_t LiveSession::getLowestValidBandwidthIndex() const {
@@ -2163,6 +2192,7 @@ bool LiveSession::checkBuffering(
     size_t activeCount, underflowCount, readyCount, downCount, upCount;
     activeCount = underflowCount = readyCount = downCount = upCount =0;
     int32_t minBufferPercent = -1;
+    mMinBufferedDurationUs = -1ll;
     int64_t durationUs;
     if (getDuration(&durationUs) != OK) {
         durationUs = -1;
@@ -2209,6 +2239,9 @@ bool LiveSession::checkBuffering(
             ++readyCount;
         }
         if (!mPacketSources[i]->isFinished(0)) {
+            if (mMinBufferedDurationUs < 0 || bufferedDurationUs < mMinBufferedDurationUs) {
+                mMinBufferedDurationUs = bufferedDurationUs;
+            }
             if (bufferedDurationUs < mBufferingSettings.mRebufferingWatermarkLowMs * 1000ll) {
                 ++underflowCount;
             }
@@ -2320,6 +2353,12 @@ bool LiveSession::switchBandwidthIfNeeded(bool bufferHigh, bool bufferLow) {
         return false;
     }
 
+    if (mAbrController != NULL) {
+        // The controller goes by the buffered duration itself rather than
+        // the marks; as with them, it only switches down while preparing.
+        return switchBandwidthWithAbrController(!mInPreparationPhase);
+    }
+
     int32_t bandwidthBps, shortTermBps;
     bool isStable;
     if (mBandwidthEstimator->estimateBandwidth(
@@ -2372,6 +2411,103 @@ bool LiveSession::switchBandwidthIfNeeded(bool bufferHigh, bool bufferLow) {
     return false;
 }
 
+bool LiveSession::switchBandwidthWithAbrController(bool allowUpSwitch) {
+    if (mMinBufferedDurationUs < 0) {
+        // nothing buffered to go by
+        return false;
+    }
+
+    Vector<int32_t> bandwidths;
+    for (size_t i = 0; i < mBandwidthItems.size(); ++i) {
+        const BandwidthItem &item = mBandwidthItems.itemAt(i);
+        bandwidths.push(isBandwidthValid(item) ? item.mBandwidth : 0);
+    }
+
+    int64_t nowUs = ALooper::GetNowUs();
+    ssize_t predictedIndex;
+    size_t bandwidthIndex = mAbrController->selectVariant(
+            bandwidths, mCurBandwidthIndex, mMinBufferedDurationUs, allowUpSwitch,
+            nowUs, &predictedIndex);
+
+    int32_t bandwidthBps = mAbrController->getBandwidthEstimate();
+    if (bandwidthBps >= 0) {
+        // for getAbortThreshold(); the controller damps fluctuations itself
+        mLastBandwidthBps = bandwidthBps;
+        mLastBandwidthStable = true;
+    }
+
+    if ((ssize_t)bandwidthIndex != mCurBandwidthIndex) {
+        changeConfiguration(mInPreparationPhase ? 0 : -1ll, bandwidthIndex);
+        return true;
+    }
+
+    if (predictedIndex >= 0) {
+        prefetchVariantPlaylists(predictedIndex);
+    }
+    return false;
+}
+
+// Fetches the playlists of the variant at |bandwidthIndex| ahead of a switch
+// to it, so that its fetchers can start with the first segment.
+void LiveSession::prefetchVariantPlaylists(size_t bandwidthIndex) {
+    const BandwidthItem &item = mBandwidthItems.itemAt(bandwidthIndex);
+    for (size_t i = 0; i < kMaxStreams; ++i) {
+        AString uri;
+        if (!mPlaylist->getTypeURI(item.mPlaylistIndex, mStreams[i].mType, &uri)
+                || mFetcherInfos.indexOfKey(uri) >= 0
+                || mPrefetchedPlaylists.indexOfKey(uri) >= 0
+                || mPlaylistPrefetchers.indexOfKey(uri) >= 0) {
+            continue;
+        }
+
+        ALOGV("prefetching playlist %s", uriDebugString(uri).c_str());
+
+        sp<AMessage> notify = new AMessage(kWhatFetcherNotify, this);
+        notify->setString("uri", uri);
+        notify->setInt32("switchGeneration", mSwitchGeneration);
+        notify->setInt32("prefetch", true);
+
+        sp<PlaylistFetcher> fetcher = new PlaylistFetcher(
+                notify, this, uri.c_str(), bandwidthIndex, mSubtitleGeneration);
+        mFetcherLooper->registerHandler(fetcher);
+        mPlaylistPrefetchers.add(uri, fetcher);
+
+        fetcher->fetchPlaylistAsync();
+    }
+}
+
+void LiveSession::onVariantPlaylistPrefetched(const sp<AMessage> &msg) {
+    AString uri;
+    CHECK(msg->findString("uri", &uri));
+    ssize_t index = mPlaylistPrefetchers.indexOfKey(uri);
+    if (index < 0) {
+        return;
+    }
+    mFetcherLooper->unregisterHandler(mPlaylistPrefetchers.valueAt(index)->id());
+    mPlaylistPrefetchers.removeItemsAt(index);
+
+    sp<M3UParser> playlist;
+    CHECK(msg->findObject("playlist", (sp<RefBase> *)&playlist));
+    if (playlist == NULL) {
+        return;
+    }
+
+    // Older ones than a target duration would be refreshed right away.
+    for (size_t i = mPrefetchedPlaylists.size(); i-- > 0;) {
+        const PrefetchedPlaylist &prefetched = mPrefetchedPlaylists.valueAt(i);
+        if (!prefetched.mPlaylist->isComplete()
+                && ALooper::GetNowUs() - prefetched.mFetchTimeUs
+                        > prefetched.mPlaylist->getTargetDuration()) {
+            mPrefetchedPlaylists.removeItemsAt(i);
+        }
+    }
+
+    PrefetchedPlaylist prefetched;
+    prefetched.mPlaylist = playlist;
+    prefetched.mFetchTimeUs = ALooper::GetNowUs();
+    mPrefetchedPlaylists.add(uri, prefetched);
+}
+
 void LiveSession::postError(status_t err) {
     // if we reached EOS, notify buffering of 100%
     if (err == ERROR_END_OF_STREAM) {
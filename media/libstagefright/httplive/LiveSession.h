@@ -29,6 +29,7 @@
 namespace android {
 
 struct ABuffer;
+struct AbrController;
 struct AReplyToken;
 struct AnotherPacketSource;
 class DataSource;
@@ -151,6 +152,11 @@ private:
         int64_t mLastFailureUs;
     };
 
+    struct PrefetchedPlaylist {
+        sp<M3UParser> mPlaylist;
+        int64_t mFetchTimeUs;
+    };
+
     struct FetcherInfo {
         sp<PlaylistFetcher> mFetcher;
         int64_t mDurationUs;
@@ -205,6 +211,16 @@ private:
     bool mLastBandwidthStable;
     sp<BandwidthEstimator> mBandwidthEstimator;
 
+    // If not NULL, replaces mBandwidthEstimator and the buffer marks in
+    // deciding when to switch variants.
+    sp<AbrController> mAbrController;
+    // the least duration buffered by the audio and video streams
+    int64_t mMinBufferedDurationUs;
+    // playlists of the variant mAbrController predicts a switch to, and the
+    // fetchers downloading them
+    KeyedVector<AString, PrefetchedPlaylist> mPrefetchedPlaylists;
+    KeyedVector<AString, sp<PlaylistFetcher> > mPlaylistPrefetchers;
+
     sp<M3UParser> mPlaylist;
     int32_t mMaxWidth;
     int32_t mMaxHeight;
@@ -293,6 +309,9 @@ private:
             sp<AMessage> &msg, int64_t delayUs, bool *needResumeUntil);
 
     bool switchBandwidthIfNeeded(bool bufferHigh, bool bufferLow);
+    bool switchBandwidthWithAbrController(bool allowUpSwitch);
+    void prefetchVariantPlaylists(size_t bandwidthIndex);
+    void onVariantPlaylistPrefetched(const sp<AMessage> &msg);
     bool tryBandwidthFallback();
 
     void schedulePollBuffering();
@@ -243,7 +243,8 @@ bool M3UParser::MediaGroup::getActiveURI(AString *uri) const {
 ////////////////////////////////////////////////////////////////////////////////
 
 M3UParser::M3UParser(
-        const char *baseURI, const void *data, size_t size)
+        const char *baseURI, const void *data, size_t size,
+        const sp<M3UParser> &previous)
     : mInitCheck(NO_INIT),
       mBaseURI(baseURI),
       mIsExtM3U(false),
@@ -256,7 +257,7 @@ M3UParser::M3UParser(
       mDiscontinuitySeq(0),
       mDiscontinuityCount(0),
       mSelectedIndex(-1) {
-    mInitCheck = parse(data, size);
+    mInitCheck = parse(data, size, previous);
 }
 
 M3UParser::~M3UParser() {
@@ -320,17 +321,63 @@ bool M3UParser::itemAt(size_t index, AString *uri, sp<AMessage> *meta) {
         return false;
     }
 
+    const Item &item = mItems.itemAt(index);
+
     if (uri) {
-        *uri = mItems.itemAt(index).mURI;
+        *uri = item.mURI;
     }
 
     if (meta) {
-        *meta = mItems.itemAt(index).mMeta;
+        if (mIsVariantPlaylist) {
+            *meta = item.mMeta;
+        } else {
+            *meta = item.mMeta != NULL ? item.mMeta->dup() : new AMessage;
+            (*meta)->setInt64("durationUs", item.mDurationUs);
+            (*meta)->setInt32("discontinuity-sequence", item.mDiscontinuitySeq);
+            if (item.mDiscontinuity) {
+                (*meta)->setInt32("discontinuity", true);
+            }
+            if (item.mRangeOffset >= 0) {
+                (*meta)->setInt64("range-offset", item.mRangeOffset);
+                (*meta)->setInt64("range-length", item.mRangeLength);
+            }
+        }
+    }
+
+    return true;
+}
+
+bool M3UParser::itemDurationUsAt(size_t index, int64_t *durationUs) const {
+    if (mIsVariantPlaylist || index >= mItems.size()) {
+        return false;
     }
+    *durationUs = mItems.itemAt(index).mDurationUs;
+    return true;
+}
 
+bool M3UParser::itemDiscontinuitySeqAt(size_t index, int32_t *discontinuitySeq) const {
+    if (mIsVariantPlaylist || index >= mItems.size()) {
+        return false;
+    }
+    *discontinuitySeq = mItems.itemAt(index).mDiscontinuitySeq;
     return true;
 }
 
+sp<AMessage> M3UParser::getCipherInfo(size_t index) const {
+    if (mIsVariantPlaylist || index >= mItems.size()) {
+        return NULL;
+    }
+
+    for (ssize_t i = index; i >= 0; --i) {
+        const sp<AMessage> &meta = mItems.itemAt(i).mMeta;
+        AString method;
+        if (meta != NULL && meta->findString("cipher-method", &method)) {
+            return meta;
+        }
+    }
+    return NULL;
+}
+
 void M3UParser::pickRandomMediaItems() {
     for (size_t i = 0; i < mMediaGroups.size(); ++i) {
         mMediaGroups.valueAt(i)->pickRandomMediaItems();
@@ -544,10 +591,30 @@ static bool MakeURL(const char *baseURL, const char *url, AString *out) {
     return true;
 }
 
-status_t M3UParser::parse(const void *_data, size_t size) {
+status_t M3UParser::parse(
+        const void *_data, size_t size, const sp<M3UParser> &previous) {
     int32_t lineNo = 0;
 
+    // the stream info of the next variant
     sp<AMessage> itemMeta;
+    // the next segment
+    Item item;
+    bool hasDuration = false;
+
+    // A live media playlist slides over the same segments from one refresh
+    // to the next. The segments this one has in common with |previous|,
+    // going by their sequence numbers, are copied over, skipping the tags
+    // that describe them, and only the ones appended since are parsed.
+    bool reuse = previous != NULL
+            && previous->mInitCheck == OK
+            && !previous->mIsVariantPlaylist
+            && previous->mBaseURI == mBaseURI;
+    int32_t mediaSequence = 0;
+    // where the tags of the next segment start, to parse them after all if
+    // the segment is not the one in |previous|
+    size_t segmentOffset = 0;
+    bool parseSegment = false;
+    size_t numReused = 0;
 
     const char *data = (const char *)_data;
     size_t offset = 0;
@@ -576,6 +643,16 @@ status_t M3UParser::parse(const void *_data, size_t size) {
             mIsExtM3U = true;
         }
 
+        // the index in |previous| of the next segment, if it is to be reused
+        ssize_t reuseIndex = -1;
+        if (reuse && !parseSegment && !mIsVariantPlaylist) {
+            int64_t index = (int64_t)mediaSequence + mItems.size()
+                    - previous->mFirstSeqNumber;
+            if (index >= 0 && index < (int64_t)previous->mItems.size()) {
+                reuseIndex = index;
+            }
+        }
+
         if (mIsExtM3U) {
             status_t err = OK;
 
@@ -589,11 +666,16 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                     return ERROR_MALFORMED;
                 }
                 err = parseMetaData(line, &mMeta, "media-sequence");
+                if (err == OK) {
+                    mMeta->findInt32("media-sequence", &mediaSequence);
+                }
             } else if (line.startsWith("#EXT-X-KEY")) {
                 if (mIsVariantPlaylist) {
                     return ERROR_MALFORMED;
                 }
-                err = parseCipherInfo(line, &itemMeta, mBaseURI);
+                if (reuseIndex < 0) {
+                    err = parseCipherInfo(line, &item.mMeta, mBaseURI);
+                }
             } else if (line.startsWith("#EXT-X-ENDLIST")) {
                 mIsComplete = true;
             } else if (line.startsWith("#EXT-X-PLAYLIST-TYPE:EVENT")) {
@@ -602,7 +684,10 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                 if (mIsVariantPlaylist) {
                     return ERROR_MALFORMED;
                 }
-                err = parseMetaDataDuration(line, &itemMeta, "durationUs");
+                if (reuseIndex < 0) {
+                    err = parseDuration(line, &item.mDurationUs);
+                    hasDuration = (err == OK);
+                }
             } else if (line.startsWith("#EXT-X-DISCONTINUITY-SEQUENCE")) {
                 if (mIsVariantPlaylist) {
                     return ERROR_MALFORMED;
@@ -619,11 +704,10 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                 if (mIsVariantPlaylist) {
                     return ERROR_MALFORMED;
                 }
-                if (itemMeta == NULL) {
-                    itemMeta = new AMessage;
+                if (reuseIndex < 0) {
+                    item.mDiscontinuity = true;
+                    ++mDiscontinuityCount;
                 }
-                itemMeta->setInt32("discontinuity", true);
-                ++mDiscontinuityCount;
             } else if (line.startsWith("#EXT-X-STREAM-INF")) {
                 if (mMeta != NULL) {
                     return ERROR_MALFORMED;
@@ -635,18 +719,16 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                     return ERROR_MALFORMED;
                 }
 
-                uint64_t length, offset;
-                err = parseByteRange(line, segmentRangeOffset, &length, &offset);
+                if (reuseIndex < 0) {
+                    uint64_t length, offset;
+                    err = parseByteRange(line, segmentRangeOffset, &length, &offset);
 
-                if (err == OK) {
-                    if (itemMeta == NULL) {
-                        itemMeta = new AMessage;
-                    }
-
-                    itemMeta->setInt64("range-offset", offset);
-                    itemMeta->setInt64("range-length", length);
+                    if (err == OK) {
+                        item.mRangeOffset = offset;
+                        item.mRangeLength = length;
 
-                    segmentRangeOffset = offset + length;
+                        segmentRangeOffset = offset + length;
+                    }
                 }
             } else if (line.startsWith("#EXT-X-MEDIA")) {
                 err = parseMedia(line);
@@ -658,24 +740,50 @@ status_t M3UParser::parse(const void *_data, size_t size) {
         }
 
         if (!line.startsWith("#")) {
-            if (!mIsVariantPlaylist) {
-                int64_t durationUs;
-                if (itemMeta == NULL
-                        || !itemMeta->findInt64("durationUs", &durationUs)) {
+            if (mIsVariantPlaylist) {
+                mItems.push();
+                Item *variant = &mItems.editItemAt(mItems.size() - 1);
+
+                CHECK(MakeURL(mBaseURI.c_str(), line.c_str(), &variant->mURI));
+
+                variant->mMeta = itemMeta;
+
+                itemMeta.clear();
+            } else if (reuseIndex >= 0) {
+                const Item &prevItem = previous->mItems.itemAt(reuseIndex);
+                if (!prevItem.mURI.endsWith(line.c_str())) {
+                    // Not the same segment after all; go back and parse
+                    // its tags.
+                    ALOGV("segment %d changed, parsing it",
+                            mediaSequence + (int32_t)mItems.size());
+                    parseSegment = true;
+                    offset = segmentOffset;
+                    continue;
+                }
+
+                mItems.push(prevItem);
+                if (prevItem.mRangeOffset >= 0) {
+                    segmentRangeOffset = prevItem.mRangeOffset + prevItem.mRangeLength;
+                }
+                mDiscontinuityCount =
+                    prevItem.mDiscontinuitySeq - (int32_t)mDiscontinuitySeq;
+                ++numReused;
+            } else {
+                if (!hasDuration) {
                     return ERROR_MALFORMED;
                 }
-                itemMeta->setInt32("discontinuity-sequence",
-                        mDiscontinuitySeq + mDiscontinuityCount);
-            }
+                item.mDiscontinuitySeq = mDiscontinuitySeq + mDiscontinuityCount;
 
-            mItems.push();
-            Item *item = &mItems.editItemAt(mItems.size() - 1);
+                CHECK(MakeURL(mBaseURI.c_str(), line.c_str(), &item.mURI));
 
-            CHECK(MakeURL(mBaseURI.c_str(), line.c_str(), &item->mURI));
+                mItems.push(item);
 
-            item->mMeta = itemMeta;
+                item = Item();
+                hasDuration = false;
+                parseSegment = false;
+            }
 
-            itemMeta.clear();
+            segmentOffset = offsetLF + 1;
         }
 
         offset = offsetLF + 1;
@@ -694,11 +802,13 @@ status_t M3UParser::parse(const void *_data, size_t size) {
         }
         mTargetDurationUs = targetDurationSecs * 1000000ll;
 
-        mFirstSeqNumber = 0;
-        if (mMeta != NULL) {
-            mMeta->findInt32("media-sequence", &mFirstSeqNumber);
-        }
+        mFirstSeqNumber = mediaSequence;
         mLastSeqNumber = mFirstSeqNumber + mItems.size() - 1;
+
+        if (reuse) {
+            ALOGV("reused %zu of %zu segments", numReused, mItems.size());
+        }
+        return OK;
     }
 
     for (size_t i = 0; i < mItems.size(); ++i) {
@@ -745,8 +855,7 @@ status_t M3UParser::parseMetaData(
 }
 
 // static
-status_t M3UParser::parseMetaDataDuration(
-        const AString &line, sp<AMessage> *meta, const char *key) {
+status_t M3UParser::parseDuration(const AString &line, int64_t *durationUs) {
     ssize_t colonPos = line.find(":");
 
     if (colonPos < 0) {
@@ -760,10 +869,7 @@ status_t M3UParser::parseMetaDataDuration(
         return err;
     }
 
-    if (meta->get() == NULL) {
-        *meta = new AMessage;
-    }
-    (*meta)->setInt64(key, (int64_t)(x * 1E6));
+    *durationUs = (int64_t)(x * 1E6);
 
     return OK;
 }
@@ -27,7 +27,11 @@
 namespace android {
 
 struct M3UParser : public RefBase {
-    M3UParser(const char *baseURI, const void *data, size_t size);
+    // If |previous| is the last version of the same live media playlist,
+    // the segments the two have in common are taken over from it instead
+    // of being parsed again.
+    M3UParser(const char *baseURI, const void *data, size_t size,
+            const sp<M3UParser> &previous = NULL);
 
     status_t initCheck() const;
 
@@ -45,6 +49,15 @@ struct M3UParser : public RefBase {
     size_t size();
     bool itemAt(size_t index, AString *uri, sp<AMessage> *meta = NULL);
 
+    // Cheaper than itemAt() for media playlists, which build the meta of
+    // their items on demand.
+    bool itemDurationUsAt(size_t index, int64_t *durationUs) const;
+    bool itemDiscontinuitySeqAt(size_t index, int32_t *discontinuitySeq) const;
+
+    // Returns the cipher info of the last item up to |index| to have a
+    // cipher method, which is the one that applies to the item, or NULL.
+    sp<AMessage> getCipherInfo(size_t index) const;
+
     void pickRandomMediaItems();
     status_t selectTrack(size_t index, bool select);
     size_t getTrackCount() const;
@@ -62,8 +75,22 @@ private:
     struct MediaGroup;
 
     struct Item {
+        Item()
+            : mDurationUs(0ll),
+              mRangeOffset(-1ll),
+              mRangeLength(-1ll),
+              mDiscontinuitySeq(0),
+              mDiscontinuity(false) {
+        }
+
         AString mURI;
+        // the stream info of a variant, or the cipher info of a segment
         sp<AMessage> mMeta;
+        int64_t mDurationUs;
+        int64_t mRangeOffset;   // -1: entire file
+        int64_t mRangeLength;
+        int32_t mDiscontinuitySeq;
+        bool mDiscontinuity;
     };
 
     status_t mInitCheck;
@@ -86,13 +113,12 @@ private:
     // Media groups keyed by group ID.
     KeyedVector<AString, sp<MediaGroup> > mMediaGroups;
 
-    status_t parse(const void *data, size_t size);
+    status_t parse(const void *data, size_t size, const sp<M3UParser> &previous);
 
     static status_t parseMetaData(
             const AString &line, sp<AMessage> *meta, const char *key);
 
-    static status_t parseMetaDataDuration(
-            const AString &line, sp<AMessage> *meta, const char *key);
+    static status_t parseDuration(const AString &line, int64_t *durationUs);
 
     status_t parseStreamInf(
             const AString &line, sp<AMessage> *meta) const;
@@ -23,6 +23,7 @@
 #include "HTTPDownloader.h"
 #include "LiveSession.h"
 #include "M3UParser.h"
+#include "SegmentPrefetcher.h"
 #include "include/avc_utils.h"
 #include "include/ID3.h"
 #include "mpeg2ts/AnotherPacketSource.h"
@@ -35,6 +36,8 @@
 #include <media/stagefright/MetaData.h>
 #include <media/stagefright/Utils.h>
 
+#include <cutils/properties.h>
+
 #include <ctype.h>
 #include <inttypes.h>
 
@@ -49,6 +52,8 @@ const int64_t PlaylistFetcher::kMinBufferedDurationUs = 30000000ll;
 const int64_t PlaylistFetcher::kMaxMonitorDelayUs = 3000000ll;
 // LCM of 188 (size of a TS packet) & 1k works well
 const int32_t PlaylistFetcher::kDownloadBlockSize = 47 * 1024;
+// 16 TS packets, a multiple of the AES block size
+const size_t PlaylistFetcher::kDemuxBatchSize = 16 * 188;
 
 struct PlaylistFetcher::DownloadState : public RefBase {
     DownloadState();
@@ -144,6 +149,9 @@ PlaylistFetcher::PlaylistFetcher(
         int32_t subtitleGeneration)
     : mNotify(notify),
       mSession(session),
+      mNumPrefetchConnections(0),
+      mLastSegmentDownloadTimeUs(-1ll),
+      mLastSegmentDurationUs(-1ll),
       mURI(uri),
       mFetcherID(id),
       mStreamTypeMask(0),
@@ -170,10 +178,27 @@ PlaylistFetcher::PlaylistFetcher(
       mSampleAesKeyItemChanged(false),
       mThresholdRatio(-1.0f),
       mDownloadState(new DownloadState()),
-      mHasMetadata(false) {
+      mHasMetadata(false),
+      mMaxBufferedBytes(0),
+      mStreamingDemux(false),
+      mDecryptOffset(0),
+      mDecryptEnd(0) {
     memset(mPlaylistHash, 0, sizeof(mPlaylistHash));
     mHTTPDownloader = mSession->getHTTPDownloader();
 
+    int32_t numPrefetchConnections =
+        property_get_int32("media.httplive.prefetch-connections", 0);
+    if (numPrefetchConnections > 0) {
+        mNumPrefetchConnections = numPrefetchConnections;
+    }
+
+    mStreamingDemux = property_get_bool("media.httplive.streaming-demux", false);
+
+    int32_t maxBufferedKb = property_get_int32("media.httplive.max-buffered-kb", 0);
+    if (maxBufferedKb > 0) {
+        mMaxBufferedBytes = (size_t)maxBufferedKb * 1024;
+    }
+
     memset(mKeyData, 0, sizeof(mKeyData));
     memset(mAESInitVec, 0, sizeof(mAESInitVec));
 }
@@ -198,12 +223,8 @@ int64_t PlaylistFetcher::getSegmentStartTimeUs(int32_t seqNumber) const {
     int64_t segmentStartUs = 0ll;
     for (int32_t index = 0;
             index < seqNumber - firstSeqNumberInPlaylist; ++index) {
-        sp<AMessage> itemMeta;
-        CHECK(mPlaylist->itemAt(
-                    index, NULL /* uri */, &itemMeta));
-
         int64_t itemDurationUs;
-        CHECK(itemMeta->findInt64("durationUs", &itemDurationUs));
+        CHECK(mPlaylist->itemDurationUsAt(index, &itemDurationUs));
 
         segmentStartUs += itemDurationUs;
     }
@@ -222,12 +243,8 @@ int64_t PlaylistFetcher::getSegmentDurationUs(int32_t seqNumber) const {
     CHECK_LE(seqNumber, lastSeqNumberInPlaylist);
 
     int32_t index = seqNumber - firstSeqNumberInPlaylist;
-    sp<AMessage> itemMeta;
-    CHECK(mPlaylist->itemAt(
-                index, NULL /* uri */, &itemMeta));
-
     int64_t itemDurationUs;
-    CHECK(itemMeta->findInt64("durationUs", &itemDurationUs));
+    CHECK(mPlaylist->itemDurationUsAt(index, &itemDurationUs));
 
     return itemDurationUs;
 }
@@ -253,11 +270,8 @@ int64_t PlaylistFetcher::delayUsToRefreshPlaylist() const {
         {
             size_t n = mPlaylist->size();
             if (n > 0) {
-                sp<AMessage> itemMeta;
-                CHECK(mPlaylist->itemAt(n - 1, NULL /* uri */, &itemMeta));
-
                 int64_t itemDurationUs;
-                CHECK(itemMeta->findInt64("durationUs", &itemDurationUs));
+                CHECK(mPlaylist->itemDurationUsAt(n - 1, &itemDurationUs));
 
                 minPlaylistAgeUs = itemDurationUs;
                 break;
@@ -295,21 +309,15 @@ int64_t PlaylistFetcher::delayUsToRefreshPlaylist() const {
 
 status_t PlaylistFetcher::decryptBuffer(
         size_t playlistIndex, const sp<ABuffer> &buffer,
-        bool first) {
-    sp<AMessage> itemMeta;
-    bool found = false;
-    AString method;
-
-    for (ssize_t i = playlistIndex; i >= 0; --i) {
-        AString uri;
-        CHECK(mPlaylist->itemAt(i, &uri, &itemMeta));
-
-        if (itemMeta->findString("cipher-method", &method)) {
-            found = true;
-            break;
-        }
+        bool first, size_t *deferredSize) {
+    if (deferredSize != NULL) {
+        *deferredSize = 0;
     }
 
+    AString method;
+    sp<AMessage> itemMeta = mPlaylist->getCipherInfo(playlistIndex);
+    bool found = itemMeta != NULL && itemMeta->findString("cipher-method", &method);
+
     // TODO: Revise this when we add support for KEYFORMAT
     // If method has changed (e.g., -> NONE); sufficient to check at the segment boundary
     if (mSampleAesKeyItem != NULL && first && found && method != "SAMPLE-AES") {
@@ -342,8 +350,13 @@ status_t PlaylistFetcher::decryptBuffer(
     ssize_t index = mAESKeyForURI.indexOfKey(keyURI);
 
     sp<ABuffer> key;
+    int64_t downloadTimeUs;
     if (index >= 0) {
         key = mAESKeyForURI.valueAt(index);
+    } else if (mSegmentPrefetcher != NULL
+            && mSegmentPrefetcher->take(keyURI, 0, -1, &key, &downloadTimeUs)
+            && key->size() == 16) {
+        mAESKeyForURI.add(keyURI, key);
     } else {
         ssize_t err = mHTTPDownloader->fetchFile(keyURI.c_str(), &key);
 
@@ -433,8 +446,7 @@ status_t PlaylistFetcher::decryptBuffer(
     }
 
 
-    AES_KEY aes_key;
-    if (AES_set_decrypt_key(key->data(), 128, &aes_key) != 0) {
+    if (AES_set_decrypt_key(key->data(), 128, &mAESKey) != 0) {
         ALOGE("failed to set AES decryption key.");
         return UNKNOWN_ERROR;
     }
@@ -449,13 +461,41 @@ status_t PlaylistFetcher::decryptBuffer(
         return ERROR_MALFORMED;
     }
 
+    if (deferredSize != NULL) {
+        // Only the first block of a file is needed to tell its format.
+        size_t size = first ? AES_BLOCK_SIZE : 0;
+        if (size > 0) {
+            AES_cbc_encrypt(
+                    buffer->data(), buffer->data(), size,
+                    &mAESKey, mAESInitVec, AES_DECRYPT);
+        }
+        *deferredSize = n - size;
+        return OK;
+    }
+
     AES_cbc_encrypt(
             buffer->data(), buffer->data(), buffer->size(),
-            &aes_key, mAESInitVec, AES_DECRYPT);
+            &mAESKey, mAESInitVec, AES_DECRYPT);
 
     return OK;
 }
 
+void PlaylistFetcher::decryptDeferred(const sp<ABuffer> &buffer, size_t end) {
+    if (end > mDecryptEnd) {
+        end = mDecryptEnd;
+    }
+    if (end <= mDecryptOffset) {
+        return;
+    }
+
+    // The deferred range is whole AES blocks, so rounding up stays within it.
+    size_t size = (end - mDecryptOffset + AES_BLOCK_SIZE - 1) & ~(AES_BLOCK_SIZE - 1);
+    AES_cbc_encrypt(
+            buffer->base() + mDecryptOffset, buffer->base() + mDecryptOffset, size,
+            &mAESKey, mAESInitVec, AES_DECRYPT);
+    mDecryptOffset += size;
+}
+
 status_t PlaylistFetcher::checkDecryptPadding(const sp<ABuffer> &buffer) {
     AString method;
     CHECK(buffer->meta()->findString("cipher-method", &method));
@@ -507,6 +547,9 @@ void PlaylistFetcher::setStoppingThreshold(float thresholdRatio, bool disconnect
     }
     if (disconnect) {
         mHTTPDownloader->disconnect();
+        if (mSegmentPrefetcher != NULL) {
+            mSegmentPrefetcher->cancel();
+        }
     }
 }
 
@@ -517,6 +560,9 @@ void PlaylistFetcher::resetStoppingThreshold(bool disconnect) {
     }
     if (disconnect) {
         mHTTPDownloader->disconnect();
+        if (mSegmentPrefetcher != NULL) {
+            mSegmentPrefetcher->cancel();
+        }
     } else {
         // allow reconnect
         mHTTPDownloader->reconnect();
@@ -603,6 +649,12 @@ void PlaylistFetcher::fetchPlaylistAsync() {
     (new AMessage(kWhatFetchPlaylist, this))->post();
 }
 
+void PlaylistFetcher::setPlaylist(const sp<M3UParser> &playlist, int64_t fetchTimeUs) {
+    mPlaylist = playlist;
+    mLastPlaylistFetchTimeUs = fetchTimeUs;
+    mPlaylistTimeUs = fetchTimeUs;
+}
+
 void PlaylistFetcher::onMessageReceived(const sp<AMessage> &msg) {
     switch (msg->what()) {
         case kWhatStart:
@@ -761,6 +813,9 @@ status_t PlaylistFetcher::onStart(const sp<AMessage> &msg) {
         mSeqNumber = -1;
         mTimeChangeSignaled = false;
         mDownloadState->resetState();
+        if (mSegmentPrefetcher != NULL) {
+            mSegmentPrefetcher->cancel();
+        }
     }
 
     postMonitorQueue();
@@ -830,6 +885,51 @@ void PlaylistFetcher::queueDiscontinuity(
     }
 }
 
+int64_t PlaylistFetcher::getBufferedDurationUs(status_t *finalResult) {
+    if (mStreamTypeMask == LiveSession::STREAMTYPE_SUBTITLES) {
+        sp<AnotherPacketSource> packetSource =
+            mPacketSources.valueFor(LiveSession::STREAMTYPE_SUBTITLES);
+
+        return packetSource->getBufferedDurationUs(finalResult);
+    }
+
+    // Use min stream duration, but ignore streams that never have any packet
+    // enqueued to prevent us from waiting on a non-existent stream;
+    // when we cannot make out from the manifest what streams are included in
+    // a playlist we might assume extra streams.
+    int64_t bufferedDurationUs = -1ll;
+    for (size_t i = 0; i < mPacketSources.size(); ++i) {
+        if ((mStreamTypeMask & mPacketSources.keyAt(i)) == 0
+                || mPacketSources[i]->getLatestEnqueuedMeta() == NULL) {
+            continue;
+        }
+
+        int64_t bufferedStreamDurationUs =
+            mPacketSources.valueAt(i)->getBufferedDurationUs(finalResult);
+
+        FSLOGV(mPacketSources.keyAt(i), "buffered %lld", (long long)bufferedStreamDurationUs);
+
+        if (bufferedDurationUs == -1ll
+             || bufferedStreamDurationUs < bufferedDurationUs) {
+            bufferedDurationUs = bufferedStreamDurationUs;
+        }
+    }
+    if (bufferedDurationUs == -1ll) {
+        bufferedDurationUs = 0ll;
+    }
+    return bufferedDurationUs;
+}
+
+size_t PlaylistFetcher::getBufferedBytes() {
+    size_t bufferedBytes = 0;
+    for (size_t i = 0; i < mPacketSources.size(); ++i) {
+        if ((mStreamTypeMask & mPacketSources.keyAt(i)) != 0) {
+            bufferedBytes += mPacketSources.valueAt(i)->getBufferedBytes();
+        }
+    }
+    return bufferedBytes;
+}
+
 void PlaylistFetcher::onMonitorQueue() {
     // in the middle of an unfinished download, delay
     // playlist refresh as it'll change seq numbers
@@ -842,42 +942,21 @@ void PlaylistFetcher::onMonitorQueue() {
         targetDurationUs = mPlaylist->getTargetDuration();
     }
 
-    int64_t bufferedDurationUs = 0ll;
     status_t finalResult = OK;
-    if (mStreamTypeMask == LiveSession::STREAMTYPE_SUBTITLES) {
-        sp<AnotherPacketSource> packetSource =
-            mPacketSources.valueFor(LiveSession::STREAMTYPE_SUBTITLES);
-
-        bufferedDurationUs =
-                packetSource->getBufferedDurationUs(&finalResult);
-    } else {
-        // Use min stream duration, but ignore streams that never have any packet
-        // enqueued to prevent us from waiting on a non-existent stream;
-        // when we cannot make out from the manifest what streams are included in
-        // a playlist we might assume extra streams.
-        bufferedDurationUs = -1ll;
-        for (size_t i = 0; i < mPacketSources.size(); ++i) {
-            if ((mStreamTypeMask & mPacketSources.keyAt(i)) == 0
-                    || mPacketSources[i]->getLatestEnqueuedMeta() == NULL) {
-                continue;
-            }
+    int64_t bufferedDurationUs = getBufferedDurationUs(&finalResult);
 
-            int64_t bufferedStreamDurationUs =
-                mPacketSources.valueAt(i)->getBufferedDurationUs(&finalResult);
-
-            FSLOGV(mPacketSources.keyAt(i), "buffered %lld", (long long)bufferedStreamDurationUs);
-
-            if (bufferedDurationUs == -1ll
-                 || bufferedStreamDurationUs < bufferedDurationUs) {
-                bufferedDurationUs = bufferedStreamDurationUs;
-            }
-        }
-        if (bufferedDurationUs == -1ll) {
-            bufferedDurationUs = 0ll;
+    // Streams of high bitrates may fill the memory well before the duration
+    // target; hold off until enough has been played out of the sources.
+    bool bufferFull = false;
+    if (mMaxBufferedBytes > 0) {
+        size_t bufferedBytes = getBufferedBytes();
+        if (bufferedBytes >= mMaxBufferedBytes) {
+            FLOGV("buffered %zu bytes >= %zu", bufferedBytes, mMaxBufferedBytes);
+            bufferFull = true;
         }
     }
 
-    if (finalResult == OK && bufferedDurationUs < kMinBufferedDurationUs) {
+    if (finalResult == OK && bufferedDurationUs < kMinBufferedDurationUs && !bufferFull) {
         FLOGV("monitoring, buffered=%lld < %lld",
                 (long long)bufferedDurationUs, (long long)kMinBufferedDurationUs);
 
@@ -895,6 +974,9 @@ void PlaylistFetcher::onMonitorQueue() {
         if (delayUs > targetDurationUs / 2) {
             delayUs = targetDurationUs / 2;
         }
+        if (bufferFull && delayUs < 1000000ll) {
+            delayUs = 1000000ll;
+        }
 
         FLOGV("pausing for %lld, buffered=%lld > %lld",
                 (long long)delayUs,
@@ -909,7 +991,7 @@ status_t PlaylistFetcher::refreshPlaylist() {
     if (delayUsToRefreshPlaylist() <= 0) {
         bool unchanged;
         sp<M3UParser> playlist = mHTTPDownloader->fetchPlaylist(
-                mURI.c_str(), mPlaylistHash, &unchanged);
+                mURI.c_str(), mPlaylistHash, &unchanged, mPlaylist);
 
         if (playlist == NULL) {
             if (unchanged) {
@@ -1012,14 +1094,12 @@ void PlaylistFetcher::initSeqNumberForLiveStream(
     // start at least 3 target durations from the end.
     int64_t timeFromEnd = 0;
     size_t index = mPlaylist->size();
-    sp<AMessage> itemMeta;
     int64_t itemDurationUs;
     int32_t targetDuration;
     if (mPlaylist->meta()->findInt32("target-duration", &targetDuration)) {
         do {
             --index;
-            if (!mPlaylist->itemAt(index, NULL /* uri */, &itemMeta)
-                    || !itemMeta->findInt64("durationUs", &itemDurationUs)) {
+            if (!mPlaylist->itemDurationUsAt(index, &itemDurationUs)) {
                 ALOGW("item or itemDurationUs missing");
                 mSeqNumber = lastSeqNumberInPlaylist - 3;
                 break;
@@ -1298,6 +1378,83 @@ bool PlaylistFetcher::initDownloadState(
     return true;
 }
 
+// Requests the segments after mSeqNumber, and the keys they need, from
+// mSegmentPrefetcher. As many are kept ahead as it took segment durations
+// to download the last segment, so that a link whose requests are slow
+// compared to the segment duration keeps up, but never more than what
+// fits into the buffer on top of the segment being downloaded.
+void PlaylistFetcher::prefetchSegments(int32_t firstSeqNumberInPlaylist) {
+    if (mNumPrefetchConnections == 0
+            || mStreamTypeMask == LiveSession::STREAMTYPE_SUBTITLES
+            || (mMaxBufferedBytes > 0 && getBufferedBytes() >= mMaxBufferedBytes)) {
+        return;
+    }
+
+    if (mSegmentPrefetcher == NULL) {
+        mSegmentPrefetcher = new SegmentPrefetcher(mSession, mNumPrefetchConnections);
+    }
+
+    size_t maxSegments = 1;
+    if (mLastSegmentDownloadTimeUs > 0 && mLastSegmentDurationUs > 0) {
+        maxSegments += mLastSegmentDownloadTimeUs / mLastSegmentDurationUs;
+    }
+    if (maxSegments > mNumPrefetchConnections * kMaxPrefetchPerConnection) {
+        maxSegments = mNumPrefetchConnections * kMaxPrefetchPerConnection;
+    }
+
+    status_t finalResult = OK;
+    int64_t headroomUs = kMinBufferedDurationUs - getBufferedDurationUs(&finalResult)
+            - getSegmentDurationUs(mSeqNumber);
+
+    Vector<SegmentPrefetcher::Request> requests;
+    size_t numSegments = 0;
+    for (size_t index = mSeqNumber - firstSeqNumberInPlaylist + 1;
+            index < mPlaylist->size() && numSegments < maxSegments; ++index) {
+        AString uri;
+        sp<AMessage> itemMeta;
+        CHECK(mPlaylist->itemAt(index, &uri, &itemMeta));
+
+        int64_t itemDurationUs;
+        CHECK(itemMeta->findInt64("durationUs", &itemDurationUs));
+
+        int32_t val;
+        if (itemDurationUs > headroomUs
+                || (itemMeta->findInt32("discontinuity", &val) && val != 0)) {
+            // a discontinuity may well end this fetcher
+            break;
+        }
+        headroomUs -= itemDurationUs;
+
+        SegmentPrefetcher::Request request;
+        AString keyURI;
+        if (itemMeta->findString("cipher-uri", &keyURI)
+                && mAESKeyForURI.indexOfKey(keyURI) < 0) {
+            bool requested = false;
+            for (size_t i = 0; i < requests.size(); ++i) {
+                requested = requested || requests[i].mURI == keyURI;
+            }
+            if (!requested) {
+                request.mURI = keyURI;
+                request.mRangeOffset = 0;
+                request.mRangeLength = -1;
+                requests.push(request);
+            }
+        }
+
+        request.mURI = uri;
+        if (!itemMeta->findInt64("range-offset", &request.mRangeOffset)
+                || !itemMeta->findInt64("range-length", &request.mRangeLength)) {
+            request.mRangeOffset = 0;
+            request.mRangeLength = -1;
+        }
+        requests.push(request);
+        ++numSegments;
+    }
+
+    FLOGV("prefetching %zu segments after %d", numSegments, mSeqNumber);
+    mSegmentPrefetcher->prefetch(requests);
+}
+
 void PlaylistFetcher::onDownloadNext() {
     AString uri;
     sp<AMessage> itemMeta;
@@ -1335,15 +1492,39 @@ void PlaylistFetcher::onDownloadNext() {
         range_length = -1;
     }
 
+    // A segment that was prefetched as a whole is handed over as a single
+    // block, followed by the end of the segment.
+    sp<ABuffer> prefetched;
+    int64_t prefetchTimeUs = 0;
+    bool segmentPrefetched = false;
+    if (connectHTTP) {
+        segmentPrefetched = mSegmentPrefetcher != NULL
+                && mSegmentPrefetcher->take(
+                        uri, range_offset, range_length, &prefetched, &prefetchTimeUs);
+        prefetchSegments(firstSeqNumberInPlaylist);
+        mLastSegmentDownloadTimeUs = segmentPrefetched ? prefetchTimeUs : 0;
+        mLastSegmentDurationUs = getSegmentDurationUs(mSeqNumber);
+    }
+
     // block-wise download
     bool shouldPause = false;
     ssize_t bytesRead;
     do {
-        int64_t startUs = ALooper::GetNowUs();
-        bytesRead = mHTTPDownloader->fetchBlock(
-                uri.c_str(), &buffer, range_offset, range_length, kDownloadBlockSize,
-                NULL /* actualURL */, connectHTTP);
-        int64_t delayUs = ALooper::GetNowUs() - startUs;
+        int64_t delayUs;
+        if (segmentPrefetched) {
+            bytesRead = prefetched != NULL ? prefetched->size() : 0;
+            buffer = prefetched != NULL ? prefetched : buffer;
+            prefetched.clear();
+            delayUs = prefetchTimeUs;
+            prefetchTimeUs = 0;
+        } else {
+            int64_t startUs = ALooper::GetNowUs();
+            bytesRead = mHTTPDownloader->fetchBlock(
+                    uri.c_str(), &buffer, range_offset, range_length, kDownloadBlockSize,
+                    NULL /* actualURL */, connectHTTP);
+            delayUs = ALooper::GetNowUs() - startUs;
+            mLastSegmentDownloadTimeUs += delayUs;
+        }
 
         if (bytesRead == ERROR_NOT_CONNECTED) {
             return;
@@ -1376,10 +1557,14 @@ void PlaylistFetcher::onDownloadNext() {
         size_t size = buffer->size();
         // Set decryption range.
         buffer->setRange(size - bytesRead, bytesRead);
+        size_t deferredSize = 0;
         status_t err = decryptBuffer(mSeqNumber - firstSeqNumberInPlaylist, buffer,
-                buffer->offset() == 0 /* first */);
+                buffer->offset() == 0 /* first */,
+                mStreamingDemux ? &deferredSize : NULL);
         // Unset decryption range.
         buffer->setRange(0, size);
+        mDecryptOffset = size - deferredSize;
+        mDecryptEnd = size;
 
         if (err != OK) {
             ALOGE("decryptBuffer failed w/ error %d", err);
@@ -1404,6 +1589,9 @@ void PlaylistFetcher::onDownloadNext() {
             tsBuffer->setRange(tsBuffer->offset(), tsBuffer->size() + bytesRead);
             err = extractAndQueueAccessUnitsFromTs(tsBuffer);
         }
+        // the rest of the block, i.e. a partial packet, or all of it if the
+        // segment is not a transport stream
+        decryptDeferred(buffer, mDecryptEnd);
 
         if (err == -EAGAIN) {
             // starting sequence number too low/high
@@ -1432,8 +1620,9 @@ void PlaylistFetcher::onDownloadNext() {
         }
         if (shouldPause || shouldPauseDownload()) {
             // save state and return if this is not the last chunk,
-            // leaving the fetcher in paused state.
-            if (bytesRead != 0) {
+            // leaving the fetcher in paused state. A prefetched segment
+            // is there in full, and finished instead.
+            if (bytesRead != 0 && !segmentPrefetched) {
                 mDownloadState->saveState(
                         uri,
                         itemMeta,
@@ -1556,11 +1745,8 @@ bool PlaylistFetcher::adjustSeqNumberWithAnchorTime(int64_t anchorTimeUs) {
         while (index > 0 && diffUs > maxDiffUs) {
             --index;
 
-            sp<AMessage> itemMeta;
-            CHECK(mPlaylist->itemAt(index, NULL /* uri */, &itemMeta));
-
             int64_t itemDurationUs;
-            CHECK(itemMeta->findInt64("durationUs", &itemDurationUs));
+            CHECK(mPlaylist->itemDurationUsAt(index, &itemDurationUs));
 
             diffUs -= itemDurationUs;
         }
@@ -1569,11 +1755,8 @@ bool PlaylistFetcher::adjustSeqNumberWithAnchorTime(int64_t anchorTimeUs) {
                 && diffUs < minDiffUs) {
             ++index;
 
-            sp<AMessage> itemMeta;
-            CHECK(mPlaylist->itemAt(index, NULL /* uri */, &itemMeta));
-
             int64_t itemDurationUs;
-            CHECK(itemMeta->findInt64("durationUs", &itemDurationUs));
+            CHECK(mPlaylist->itemDurationUsAt(index, &itemDurationUs));
 
             diffUs += itemDurationUs;
         }
@@ -1596,10 +1779,9 @@ int32_t PlaylistFetcher::getSeqNumberForDiscontinuity(size_t discontinuitySeq) c
 
     size_t index = 0;
     while (index < mPlaylist->size()) {
-        sp<AMessage> itemMeta;
-        CHECK(mPlaylist->itemAt( index, NULL /* uri */, &itemMeta));
-        size_t curDiscontinuitySeq;
-        CHECK(itemMeta->findInt32("discontinuity-sequence", (int32_t *)&curDiscontinuitySeq));
+        int32_t itemDiscontinuitySeq;
+        CHECK(mPlaylist->itemDiscontinuitySeqAt(index, &itemDiscontinuitySeq));
+        size_t curDiscontinuitySeq = itemDiscontinuitySeq;
         int32_t seqNumber = firstSeqNumberInPlaylist + index;
         if (curDiscontinuitySeq == discontinuitySeq) {
             return seqNumber;
@@ -1617,12 +1799,8 @@ int32_t PlaylistFetcher::getSeqNumberForTime(int64_t timeUs) const {
     size_t index = 0;
     int64_t segmentStartUs = 0;
     while (index < mPlaylist->size()) {
-        sp<AMessage> itemMeta;
-        CHECK(mPlaylist->itemAt(
-                    index, NULL /* uri */, &itemMeta));
-
         int64_t itemDurationUs;
-        CHECK(itemMeta->findInt64("durationUs", &itemDurationUs));
+        CHECK(mPlaylist->itemDurationUsAt(index, &itemDurationUs));
 
         if (timeUs < segmentStartUs + itemDurationUs) {
             break;
@@ -1713,13 +1891,23 @@ status_t PlaylistFetcher::extractAndQueueAccessUnitsFromTs(const sp<ABuffer> &bu
 
     size_t offset = 0;
     while (offset + 188 <= buffer->size()) {
-        status_t err = mTSParser->feedTSPacket(buffer->data() + offset, 188);
+        size_t size = buffer->size() - offset;
+        if (size > kDemuxBatchSize) {
+            size = kDemuxBatchSize;
+        }
+        size -= size % 188;
+
+        // In streaming mode the packets are decrypted right before they are
+        // parsed, while they are still in the cache.
+        decryptDeferred(buffer, buffer->offset() + offset + size);
+
+        size_t consumed;
+        status_t err = mTSParser->feedTSPackets(buffer->data() + offset, size, &consumed);
+        offset += consumed;
 
         if (err != OK) {
             return err;
         }
-
-        offset += 188;
     }
     // setRange to indicate consumed bytes.
     buffer->setRange(buffer->offset() + offset, buffer->size() - offset);
@@ -2194,12 +2382,8 @@ status_t PlaylistFetcher::extractAndQueueAccessUnits(
 void PlaylistFetcher::updateDuration() {
     int64_t durationUs = 0ll;
     for (size_t index = 0; index < mPlaylist->size(); ++index) {
-        sp<AMessage> itemMeta;
-        CHECK(mPlaylist->itemAt(
-                    index, NULL /* uri */, &itemMeta));
-
         int64_t itemDurationUs;
-        CHECK(itemMeta->findInt64("durationUs", &itemDurationUs));
+        CHECK(mPlaylist->itemDurationUsAt(index, &itemDurationUs));
 
         durationUs += itemDurationUs;
     }
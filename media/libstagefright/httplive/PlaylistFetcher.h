@@ -32,11 +32,13 @@ class DataSource;
 struct HTTPBase;
 struct LiveDataSource;
 struct M3UParser;
+struct SegmentPrefetcher;
 class String8;
 
 struct PlaylistFetcher : public AHandler {
     static const int64_t kMinBufferedDurationUs;
     static const int32_t kDownloadBlockSize;
+    static const size_t kDemuxBatchSize;
     static const int64_t kFetcherResumeThreshold;
 
     enum {
@@ -82,6 +84,10 @@ struct PlaylistFetcher : public AHandler {
 
     void fetchPlaylistAsync();
 
+    // Starts with |playlist|, fetched at |fetchTimeUs|, instead of fetching
+    // it. Must be called before startAsync().
+    void setPlaylist(const sp<M3UParser> &playlist, int64_t fetchTimeUs);
+
     uint32_t getStreamTypeMask() const {
         return mStreamTypeMask;
     }
@@ -93,6 +99,8 @@ protected:
 private:
     enum {
         kMaxNumRetries         = 5,
+        // the most files prefetched per connection of mSegmentPrefetcher
+        kMaxPrefetchPerConnection = 2,
     };
 
     enum {
@@ -119,6 +127,13 @@ private:
 
     sp<HTTPDownloader> mHTTPDownloader;
     sp<LiveSession> mSession;
+
+    // Downloads the segments after the current one, if enabled.
+    sp<SegmentPrefetcher> mSegmentPrefetcher;
+    size_t mNumPrefetchConnections;
+    // how long the last segment took to download, and its duration
+    int64_t mLastSegmentDownloadTimeUs;
+    int64_t mLastSegmentDurationUs;
     AString mURI;
 
     int32_t mFetcherID;
@@ -188,6 +203,18 @@ private:
 
     bool mHasMetadata;
 
+    // The most the packet sources may hold before downloads pause, on top of
+    // kMinBufferedDurationUs, or 0 for no limit.
+    size_t mMaxBufferedBytes;
+
+    // In streaming mode, AES-128 segments are decrypted in the same pass
+    // that feeds them to the TS parser rather than block by block before it.
+    bool mStreamingDemux;
+    AES_KEY mAESKey;
+    // the range of the segment buffer that is still encrypted
+    size_t mDecryptOffset;
+    size_t mDecryptEnd;
+
     // Set first to true if decrypting the first segment of a playlist segment. When
     // first is true, reset the initialization vector based on the available
     // information in the manifest; otherwise, use the initialization vector as
@@ -196,9 +223,16 @@ private:
     // For the input to decrypt correctly, decryptBuffer must be called on
     // consecutive byte ranges on block boundaries, e.g. 0..15, 16..47, 48..63,
     // and so on.
+    //
+    // If |deferredSize| is not NULL, an AES-128 buffer is left encrypted but
+    // for its first block if |first|, and |*deferredSize| is set to the size
+    // left, for decryptDeferred() to decrypt.
     status_t decryptBuffer(
             size_t playlistIndex, const sp<ABuffer> &buffer,
-            bool first = true);
+            bool first = true, size_t *deferredSize = NULL);
+    // Decrypts the deferred range of the segment buffer up to |end|, an
+    // offset from the start of |buffer|'s memory.
+    void decryptDeferred(const sp<ABuffer> &buffer, size_t end);
     status_t checkDecryptPadding(const sp<ABuffer> &buffer);
 
     void postMonitorQueue(int64_t delayUs = 0, int64_t minDelayUs = 0);
@@ -207,6 +241,9 @@ private:
     void resetStoppingThreshold(bool disconnect);
     float getStoppingThreshold();
     bool shouldPauseDownload();
+    int64_t getBufferedDurationUs(status_t *finalResult);
+    size_t getBufferedBytes();
+    void prefetchSegments(int32_t firstSeqNumberInPlaylist);
 
     int64_t delayUsToRefreshPlaylist() const;
     status_t refreshPlaylist();
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SegmentPrefetcher"
+#include <utils/Log.h>
+
+#include "SegmentPrefetcher.h"
+#include "HTTPDownloader.h"
+#include "LiveSession.h"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/Utils.h>
+
+namespace android {
+
+SegmentPrefetcher::SegmentPrefetcher(
+        const sp<LiveSession> &session, size_t numConnections)
+    : mExit(false),
+      mGeneration(0) {
+    for (size_t i = 0; i < numConnections; ++i) {
+        Worker *worker = new Worker;
+        worker->mOwner = this;
+        worker->mDownloader = session->getHTTPDownloader();
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+        if (pthread_create(&worker->mThread, &attr, ThreadWrapper, worker) == 0) {
+            mWorkers.push(worker);
+        } else {
+            delete worker;
+        }
+        pthread_attr_destroy(&attr);
+    }
+}
+
+SegmentPrefetcher::~SegmentPrefetcher() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        mExit = true;
+        mCondition.broadcast();
+    }
+
+    for (size_t i = 0; i < mWorkers.size(); ++i) {
+        mWorkers[i]->mDownloader->disconnect();
+    }
+
+    for (size_t i = 0; i < mWorkers.size(); ++i) {
+        void *dummy;
+        pthread_join(mWorkers[i]->mThread, &dummy);
+        delete mWorkers[i];
+    }
+    mWorkers.clear();
+}
+
+// static
+bool SegmentPrefetcher::Matches(
+        const Request &request,
+        const AString &uri, int64_t rangeOffset, int64_t rangeLength) {
+    return request.mURI == uri
+            && request.mRangeOffset == rangeOffset
+            && request.mRangeLength == rangeLength;
+}
+
+void SegmentPrefetcher::prefetch(const Vector<Request> &requests) {
+    Mutex::Autolock autoLock(mLock);
+
+    List<Entry> entries;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const Request &request = requests[i];
+
+        List<Entry>::iterator it = mEntries.begin();
+        while (it != mEntries.end() && !Matches((*it).mRequest,
+                request.mURI, request.mRangeOffset, request.mRangeLength)) {
+            ++it;
+        }
+
+        if (it != mEntries.end()) {
+            entries.push_back(*it);
+            mEntries.erase(it);
+        } else {
+            Entry entry;
+            entry.mRequest = request;
+            entry.mState = QUEUED;
+            entry.mDownloadTimeUs = 0;
+            entries.push_back(entry);
+        }
+    }
+
+    // Downloads in progress of the remaining entries find them gone.
+    mEntries = entries;
+    mCondition.broadcast();
+}
+
+bool SegmentPrefetcher::take(
+        const AString &uri, int64_t rangeOffset, int64_t rangeLength,
+        sp<ABuffer> *data, int64_t *downloadTimeUs) {
+    Mutex::Autolock autoLock(mLock);
+
+    uint32_t generation = mGeneration;
+    for (;;) {
+        List<Entry>::iterator it = mEntries.begin();
+        while (it != mEntries.end()
+                && !Matches((*it).mRequest, uri, rangeOffset, rangeLength)) {
+            ++it;
+        }
+        if (it == mEntries.end()) {
+            return false;
+        }
+
+        switch ((*it).mState) {
+            case QUEUED:
+            {
+                // Not started yet, the caller is better off downloading it
+                // block by block itself.
+                mEntries.erase(it);
+                return false;
+            }
+
+            case DOWNLOADING:
+            {
+                mCondition.wait(mLock);
+                if (mGeneration != generation) {
+                    return false;
+                }
+                break;
+            }
+
+            case DONE:
+            {
+                *data = (*it).mData;
+                *downloadTimeUs = (*it).mDownloadTimeUs;
+                mEntries.erase(it);
+                return true;
+            }
+
+            default:
+            {
+                mEntries.erase(it);
+                return false;
+            }
+        }
+    }
+}
+
+void SegmentPrefetcher::cancel() {
+    {
+        Mutex::Autolock autoLock(mLock);
+        ++mGeneration;
+        mEntries.clear();
+        mCondition.broadcast();
+    }
+
+    for (size_t i = 0; i < mWorkers.size(); ++i) {
+        mWorkers[i]->mDownloader->disconnect();
+    }
+}
+
+// static
+void *SegmentPrefetcher::ThreadWrapper(void *me) {
+    Worker *worker = static_cast<Worker *>(me);
+    worker->mOwner->threadFunc(worker->mDownloader);
+    return NULL;
+}
+
+void SegmentPrefetcher::threadFunc(const sp<HTTPDownloader> &downloader) {
+    androidSetThreadName("SegmentPrefetch");
+
+    Mutex::Autolock autoLock(mLock);
+    while (!mExit) {
+        List<Entry>::iterator it = mEntries.begin();
+        while (it != mEntries.end() && (*it).mState != QUEUED) {
+            ++it;
+        }
+        if (it == mEntries.end()) {
+            mCondition.wait(mLock);
+            continue;
+        }
+
+        (*it).mState = DOWNLOADING;
+        Request request = (*it).mRequest;
+        uint32_t generation = mGeneration;
+
+        mLock.unlock();
+        // undo the disconnect of an earlier cancel()
+        downloader->reconnect();
+
+        int64_t startUs = ALooper::GetNowUs();
+        sp<ABuffer> data;
+        // Connecting again reuses the connection of the last file.
+        ssize_t bytesRead = downloader->fetchBlock(
+                request.mURI.c_str(), &data,
+                request.mRangeOffset, request.mRangeLength,
+                0 /* block_size */, NULL /* actualUrl */, true /* reconnect */);
+        int64_t downloadTimeUs = ALooper::GetNowUs() - startUs;
+        mLock.lock();
+
+        if (mGeneration != generation) {
+            continue;
+        }
+
+        for (it = mEntries.begin(); it != mEntries.end(); ++it) {
+            if ((*it).mState == DOWNLOADING && Matches((*it).mRequest,
+                    request.mURI, request.mRangeOffset, request.mRangeLength)) {
+                if (bytesRead < 0) {
+                    ALOGW("prefetch of '%s' failed: %zd",
+                            uriDebugString(request.mURI).c_str(), bytesRead);
+                    (*it).mState = FAILED;
+                } else {
+                    ALOGV("prefetched %zd bytes in %lld us",
+                            bytesRead, (long long)downloadTimeUs);
+                    (*it).mState = DONE;
+                    (*it).mData = data;
+                    (*it).mDownloadTimeUs = downloadTimeUs;
+                }
+                mCondition.broadcast();
+                break;
+            }
+        }
+    }
+}
+
+}  // namespace android
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SEGMENT_PREFETCHER_H_
+
+#define SEGMENT_PREFETCHER_H_
+
+#include <pthread.h>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/List.h>
+#include <utils/RefBase.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+struct ABuffer;
+struct HTTPDownloader;
+struct LiveSession;
+
+// Downloads the files a PlaylistFetcher is going to need next, segments and
+// their keys, over connections of its own, one thread per connection. Each
+// connection is an HTTPDownloader of its own that is reused from one file
+// to the next, so a fetcher whose segments are short compared to the round
+// trip time keeps several requests in flight instead of one.
+struct SegmentPrefetcher : public RefBase {
+    struct Request {
+        AString mURI;
+        int64_t mRangeOffset;
+        int64_t mRangeLength;   // -1: entire file
+    };
+
+    SegmentPrefetcher(const sp<LiveSession> &session, size_t numConnections);
+
+    // Makes |requests| the files to download, in order. Downloads that are
+    // not among them any more are dropped.
+    void prefetch(const Vector<Request> &requests);
+
+    // Returns true, the file, and the time its download took if the file
+    // was requested, waiting for the download if it is in progress. Returns
+    // false if the file was not requested, its download failed, or cancel()
+    // was called while waiting.
+    bool take(const AString &uri, int64_t rangeOffset, int64_t rangeLength,
+            sp<ABuffer> *data, int64_t *downloadTimeUs);
+
+    // Drops all files, and aborts the downloads in progress.
+    void cancel();
+
+protected:
+    virtual ~SegmentPrefetcher();
+
+private:
+    enum State {
+        QUEUED,
+        DOWNLOADING,
+        DONE,
+        FAILED,
+    };
+
+    struct Entry {
+        Request mRequest;
+        State mState;
+        sp<ABuffer> mData;
+        int64_t mDownloadTimeUs;
+    };
+
+    struct Worker {
+        SegmentPrefetcher *mOwner;
+        sp<HTTPDownloader> mDownloader;
+        pthread_t mThread;
+    };
+
+    Mutex mLock;
+    Condition mCondition;
+    bool mExit;
+    // incremented by cancel(), to fail the downloads in progress
+    uint32_t mGeneration;
+    List<Entry> mEntries;
+    Vector<Worker *> mWorkers;
+
+    static bool Matches(
+            const Request &request,
+            const AString &uri, int64_t rangeOffset, int64_t rangeLength);
+
+    static void *ThreadWrapper(void *me);
+    void threadFunc(const sp<HTTPDownloader> &downloader);
+
+    DISALLOW_EVIL_CONSTRUCTORS(SegmentPrefetcher);
+};
+
+}  // namespace android
+
+#endif  // SEGMENT_PREFETCHER_H_
@@ -328,12 +328,19 @@ struct id3_header {
 }
 
 void ID3::removeUnsynchronization() {
-    for (size_t i = 0; i + 1 < mSize; ++i) {
-        if (mData[i] == 0xff && mData[i + 1] == 0x00) {
-            memmove(&mData[i + 1], &mData[i + 2], mSize - i - 2);
-            --mSize;
+    // Compact in a single pass. Embedded JPEG artwork is full of 0xff 0x00 pairs, so moving
+    // the rest of the tag for every pair gets very expensive.
+    if (mSize == 0) {
+        return;
+    }
+    size_t writeOffset = 1;
+    for (size_t readOffset = 1; readOffset < mSize; ++readOffset) {
+        if (mData[readOffset - 1] == 0xff && mData[readOffset] == 0x00) {
+            continue;
         }
+        mData[writeOffset++] = mData[readOffset];
     }
+    mSize = writeOffset;
 }
 
 static void WriteSyncsafeInteger(uint8_t *dst, size_t x) {
@@ -346,8 +353,23 @@ static void WriteSyncsafeInteger(uint8_t *dst, size_t x) {
 bool ID3::removeUnsynchronizationV2_4(bool iTunesHack) {
     size_t oldSize = mSize;
 
+    // Frames are compacted as they are parsed instead of moving the rest of the tag every time
+    // bytes are removed. The first |compacted| bytes are final. The bytes that follow them are
+    // still |removed| bytes further into mData.
+    size_t compacted = 0;
+    size_t removed = 0;
+    auto compactTo = [this, &compacted, &removed](size_t end) {
+        if (end > compacted) {
+            if (removed > 0) {
+                memmove(&mData[compacted], &mData[compacted + removed], end - compacted);
+            }
+            compacted = end;
+        }
+    };
+
     size_t offset = 0;
     while (mSize >= 10 && offset <= mSize - 10) {
+        compactTo(offset + 10);
         if (!memcmp(&mData[offset], "\0\0\0\0", 4)) {
             break;
         }
@@ -372,7 +394,7 @@ bool ID3::removeUnsynchronizationV2_4(bool iTunesHack) {
             if (mSize < 14 || mSize - 14 < offset || dataSize < 4) {
                 return false;
             }
-            memmove(&mData[offset + 10], &mData[offset + 14], mSize - offset - 14);
+            removed += 4;
             mSize -= 4;
             dataSize -= 4;
 
@@ -383,7 +405,8 @@ bool ID3::removeUnsynchronizationV2_4(bool iTunesHack) {
             // This file has "unsynchronization", so we have to replace occurrences
             // of 0xff 0x00 with just 0xff in order to get the real data.
 
-            size_t readOffset = offset + 11;
+            compactTo(offset + 11);
+            size_t readOffset = offset + 11 + removed;
             size_t writeOffset = offset + 11;
             for (size_t i = 0; i + 1 < dataSize; ++i) {
                 if (mData[readOffset - 1] == 0xff
@@ -394,13 +417,12 @@ bool ID3::removeUnsynchronizationV2_4(bool iTunesHack) {
                 }
                 mData[writeOffset++] = mData[readOffset++];
             }
-            // move the remaining data following this frame
-            if (readOffset <= oldSize) {
-                memmove(&mData[writeOffset], &mData[readOffset], oldSize - readOffset);
-            } else {
+            if (readOffset > oldSize) {
                 ALOGE("b/34618607 (%zu %zu %zu %zu)", readOffset, writeOffset, oldSize, mSize);
                 android_errorWriteLog(0x534e4554, "34618607");
             }
+            compacted = writeOffset;
+            removed = readOffset <= oldSize ? readOffset - writeOffset : 0;
 
         }
         flags &= ~2;
@@ -413,6 +435,7 @@ bool ID3::removeUnsynchronizationV2_4(bool iTunesHack) {
         offset += 10 + dataSize;
     }
 
+    compactTo(mSize);
     memset(&mData[mSize], 0, oldSize - mSize);
 
     return true;
@@ -24,6 +24,7 @@
 #include <media/IOMX.h>
 #include <media/stagefright/foundation/AHierarchicalStateMachine.h>
 #include <media/stagefright/CodecBase.h>
+#include <media/stagefright/CodecLatencyTracker.h>
 #include <media/stagefright/FrameRenderTracker.h>
 #include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/SkipCutBuffer.h>
@@ -84,6 +85,7 @@ struct ACodec : public AHierarchicalStateMachine, public CodecBase {
     virtual void signalSetParameters(const sp<AMessage> &msg);
     virtual void signalEndOfInputStream();
     virtual void signalRequestIDRFrame();
+    virtual void exportMetrics(MediaAnalyticsItem *item);
 
     // AHierarchicalStateMachine implements the message handling
     virtual void onMessageReceived(const sp<AMessage> &msg) {
@@ -260,6 +262,7 @@ private:
     sp<AMessage> mBaseOutputFormat;
 
     FrameRenderTracker mRenderTracker; // render information for buffers rendered by ACodec
+    CodecLatencyTracker mLatencyTracker;
     Vector<BufferInfo> mBuffers[2];
     bool mPortEOS[2];
     status_t mInputEOSResult;
@@ -298,6 +301,7 @@ private:
     double mCaptureFps;
     bool mCreateInputBuffersSuspended;
     uint32_t mLatency;
+    bool mOutputPartialFrames;
 
     bool mTunneled;
 
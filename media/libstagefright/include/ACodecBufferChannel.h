@@ -18,9 +18,11 @@
 
 #define A_BUFFER_CHANNEL_H_
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include <media/openmax/OMX_Types.h>
@@ -58,6 +60,12 @@ public:
         const sp<IMemory> mSharedEncryptedBuffer;
     };
 
+    struct TurnaroundStats {
+        uint64_t mCount;
+        int64_t mTotalUs;
+        int64_t mMaxUs;
+    };
+
     ACodecBufferChannel(
             const sp<AMessage> &inputBufferFilled, const sp<AMessage> &outputBufferDrained);
     virtual ~ACodecBufferChannel();
@@ -106,11 +114,44 @@ public:
      * Request MediaCodec to drain the specified output buffer.
      *
      * @param bufferId  ID of the buffer, assigned by underlying component.
-     * @param omxFlags  flags associated with this buffer (e.g. EOS).
+     * @param omxFlags  flags associated with this buffer (e.g. EOS). A
+     *                  buffer without OMX_BUFFERFLAG_ENDOFFRAME holds only
+     *                  part of a frame.
      */
     void drainThisBuffer(IOMX::buffer_id bufferID, OMX_U32 omxFlags);
+    /**
+     * Get the time that buffers spent with MediaCodec and its clients, from
+     * fillThisBuffer()/drainThisBuffer() until they were queued, rendered or
+     * discarded.
+     */
+    void getTurnaroundStats(TurnaroundStats *input, TurnaroundStats *output) const;
 
 private:
+    // The buffers of a port, indexed by client buffer and by buffer ID. Only
+    // mHandedOutUs changes once the array is published.
+    struct BufferArray {
+        explicit BufferArray(std::vector<const BufferInfo> &&buffers);
+
+        // Returns the slot of the buffer, or -1.
+        ssize_t findClientBuffer(const sp<MediaCodecBuffer> &buffer) const;
+        ssize_t findBufferId(IOMX::buffer_id bufferId) const;
+
+        const std::vector<const BufferInfo> mBuffers;
+        std::unordered_map<const MediaCodecBuffer *, size_t> mClientBufferSlots;
+        std::unordered_map<IOMX::buffer_id, size_t> mBufferIdSlots;
+        // When each buffer was last handed to MediaCodec, or -1 if it is not
+        // out.
+        const std::unique_ptr<std::atomic<int64_t>[]> mHandedOutUs;
+    };
+
+    struct Turnaround {
+        Turnaround() : mCount(0), mTotalUs(0), mMaxUs(0) {}
+
+        std::atomic<uint64_t> mCount;
+        std::atomic<int64_t> mTotalUs;
+        std::atomic<int64_t> mMaxUs;
+    };
+
     const sp<AMessage> mInputBufferFilled;
     const sp<AMessage> mOutputBufferDrained;
 
@@ -120,16 +161,34 @@ private:
 
     // These should only be accessed via std::atomic_* functions.
     //
-    // Note on thread safety: since the vector and BufferInfo are const, it's
+    // Note on thread safety: since the array and BufferInfo are const, it's
     // safe to read them at any thread once the shared_ptr object is atomically
     // obtained. Inside BufferInfo, mBufferId and mSharedEncryptedBuffer are
     // immutable objects. We write internal states of mClient/CodecBuffer when
     // the caller has given up the reference, so that access is also safe.
-    std::shared_ptr<const std::vector<const BufferInfo>> mInputBuffers;
-    std::shared_ptr<const std::vector<const BufferInfo>> mOutputBuffers;
+    std::shared_ptr<const BufferArray> mInputBuffers;
+    std::shared_ptr<const BufferArray> mOutputBuffers;
+
+    Turnaround mInputTurnaround;
+    Turnaround mOutputTurnaround;
 
     sp<MemoryDealer> makeMemoryDealer(size_t heapSize);
 
+    // Returns true if no byte of the sample is encrypted.
+    static bool isAllClear(
+            CryptoPlugin::Mode mode,
+            const CryptoPlugin::SubSample *subSamples,
+            size_t numSubSamples);
+    // Sends the input buffer in |slot|, holding |size| bytes of decrypted
+    // data, to the codec.
+    status_t queueDecryptedBuffer(
+            const std::shared_ptr<const BufferArray> &array, size_t slot, size_t size,
+            const char *what);
+
+    static void NoteHandedOut(const BufferArray &array, size_t slot);
+    static void NoteReturned(const BufferArray &array, size_t slot, Turnaround *turnaround);
+    static void GetStats(const Turnaround &turnaround, TurnaroundStats *stats);
+
     bool hasCryptoOrDescrambler() {
         return mCrypto != NULL || mDescrambler != NULL;
     }
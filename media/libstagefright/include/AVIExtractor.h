@@ -45,14 +45,20 @@ private:
     struct AVISource;
     struct MP3Splitter;
 
-    struct SampleInfo {
-        uint32_t mOffset;
-        bool mIsKey;
-    };
-
     struct Track {
         sp<MetaData> mMeta;
-        Vector<SampleInfo> mSamples;
+
+        // The index of the track: the offset of each chunk, and one bit per chunk telling
+        // whether it is a key frame, which takes about half the memory of a struct per chunk.
+        Vector<uint32_t> mSampleOffsets;
+        Vector<uint32_t> mSyncSampleBits;
+
+        size_t numSamples() const { return mSampleOffsets.size(); }
+        bool isSyncSample(size_t sampleIndex) const {
+            return (mSyncSampleBits[sampleIndex / 32] >> (sampleIndex % 32)) & 1;
+        }
+        void addSample(uint32_t offset, bool isKey);
+
         uint32_t mRate;
         uint32_t mScale;
 
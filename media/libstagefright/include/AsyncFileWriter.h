@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ASYNC_FILE_WRITER_H_
+
+#define ASYNC_FILE_WRITER_H_
+
+#include <pthread.h>
+#include <sys/types.h>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Errors.h>
+#include <utils/List.h>
+#include <utils/String8.h>
+#include <utils/threads.h>
+
+namespace android {
+
+// Writes to a file descriptor from a thread of its own. Writes are copied
+// into one of two buffers, each of which is handed to the thread with a
+// single pwrite once it is full, so that the caller only blocks if both
+// buffers are waiting for the file. Buffers end on kAlignment boundaries of
+// the file, which allows full buffers to be written with O_DIRECT.
+//
+// The caller must serialize its calls, as it would for writes to the file
+// descriptor itself. Errors are sticky and returned by flush() and close().
+struct AsyncFileWriter {
+    enum Flags {
+        // Write aligned buffers with O_DIRECT, bypassing the page cache.
+        kFlagDirectIo   = 1,
+        // Allocate the file ahead of the writes with fallocate(), and trim
+        // it back to the written size in close().
+        kFlagPreallocate = 2,
+    };
+
+    // Does not take ownership of |fd|, which must stay open until close().
+    AsyncFileWriter(int fd, uint32_t flags);
+    ~AsyncFileWriter();
+
+    status_t initCheck() const { return mInitCheck; }
+
+    // Moves the position of the next write() to |offset|. Seeking back into
+    // the data that was not handed to the thread yet patches it in place.
+    void seek(off64_t offset);
+    void write(const void *data, size_t size);
+
+    // Hands what was written so far to the thread, without waiting for it.
+    void submit();
+
+    // Waits until everything written so far has reached the file.
+    status_t flush();
+
+    // Flushes, and stops the thread. No writes are allowed afterwards.
+    status_t close();
+
+    // Appends the number of writes and the percentiles of their latency.
+    void dump(String8 *result) const;
+
+private:
+    enum {
+        kBufferSize = 1024 * 1024,
+        kNumBuffers = 2,
+        kAlignment = 4096,
+        kPreallocateSize = 32 * 1024 * 1024,
+        kNumLatencies = 512,
+    };
+
+    struct Buffer {
+        uint8_t *mData;
+        off64_t mFileOffset;
+        size_t mCapacity;
+        size_t mSize;
+        bool mQueued;
+    };
+
+    int mFd;
+    uint32_t mFlags;
+    status_t mInitCheck;
+
+    mutable Mutex mLock;
+    Condition mCondition;
+    pthread_t mThread;
+    bool mThreadStarted;
+    bool mExit;
+
+    Buffer mBuffers[kNumBuffers];
+    List<Buffer *> mQueue;
+    status_t mError;
+
+    // the buffer being filled, and the position of the next write in it
+    Buffer *mFill;
+    size_t mFillPos;
+
+    // only used by the thread
+    bool mDirect;
+    off64_t mAllocatedEnd;
+
+    off64_t mEnd;
+    uint64_t mNumWrites;
+    uint64_t mBytesWritten;
+    int64_t mLatenciesUs[kNumLatencies];
+
+    void startBuffer_l(off64_t offset);
+    void queueFill_l();
+    void submit_l();
+    status_t writeBuffer(const Buffer *buffer);
+
+    static void *ThreadWrapper(void *me);
+    void threadFunc();
+
+    DISALLOW_EVIL_CONSTRUCTORS(AsyncFileWriter);
+};
+
+}  // namespace android
+
+#endif  // ASYNC_FILE_WRITER_H_
@@ -44,23 +44,46 @@ public:
     virtual sp<DecryptHandle> DrmInitialization(const char *mime = NULL);
     virtual sp<IDataSource> getIDataSource() const;
 
+    // A range of the source to read, and where to.
+    struct Range {
+        off64_t mOffset;
+        size_t mSize;
+        void *mData;
+        // what readAt() would have returned
+        ssize_t mResult;
+    };
+
+    // Reads |count| ranges in a single transaction if they fit the shared
+    // memory together, or one by one otherwise.
+    void readRanges(Range *ranges, size_t count);
+
+    // The most bytes a single transaction can read.
+    size_t getBufferSize() const;
+
 private:
     sp<IDataSource> mIDataSource;
     sp<IMemory> mMemory;
     bool mIsClosed;
+    // cleared if the IDataSource does not implement readRangesAt()
+    bool mRangesSupported;
     String8 mName;
 
     DISALLOW_EVIL_CONSTRUCTORS(CallbackDataSource);
 };
 
 
-// A caching DataSource that wraps a CallbackDataSource. For reads smaller
-// than kCacheSize it will read up to kCacheSize ahead and cache it.
+// A caching DataSource that wraps a CallbackDataSource. Reads smaller than
+// the current read ahead are served from a few cached segments, and a miss
+// fills the least recently used segment with the read ahead. The read ahead
+// grows while misses continue where a segment ended, and drops back to
+// kMinReadAhead on a jump. When misses recur at a constant stride, the
+// segment at the next stride is fetched in the same transaction.
 // This reduces the number of binder round trips to the IDataSource and has a significant
 // impact on time taken for filetype sniffing and metadata extraction.
 class TinyCacheSource : public DataSource {
 public:
-    explicit TinyCacheSource(const sp<DataSource>& source);
+    explicit TinyCacheSource(const sp<CallbackDataSource>& source);
+    virtual ~TinyCacheSource();
 
     virtual status_t initCheck() const;
     virtual ssize_t readAt(off64_t offset, void* data, size_t size);
@@ -76,17 +99,35 @@ public:
 private:
     // 2kb comes from experimenting with the time-to-first-frame from a MediaPlayer
     // with an in-memory MediaDataSource source on a Nexus 5. Beyond 2kb there was
-    // no improvement.
+    // no improvement for random reads, so the read ahead only grows on
+    // sequential ones.
     enum {
-        kCacheSize = 2048,
+        kMinReadAhead = 2048,
+        kMaxReadAhead = 32 * 1024,
+        kNumSegments = 4,
     };
 
-    sp<DataSource> mSource;
-    uint8_t mCache[kCacheSize];
-    off64_t mCachedOffset;
-    size_t mCachedSize;
+    struct Segment {
+        uint8_t *mData;
+        off64_t mOffset;
+        size_t mSize;
+        uint32_t mLastUse;
+    };
+
+    sp<CallbackDataSource> mSource;
+    Segment mSegments[kNumSegments];
+    uint32_t mUseCount;
+    size_t mReadAhead;
+    size_t mMaxReadAhead;
+    off64_t mLastMissOffset;
+    off64_t mLastStride;
     String8 mName;
 
+    Segment *findSegment(off64_t offset);
+    Segment *leastRecentlyUsed(const Segment *exclude);
+    ssize_t fill(off64_t offset);
+    void flush();
+
     DISALLOW_EVIL_CONSTRUCTORS(TinyCacheSource);
 };
 
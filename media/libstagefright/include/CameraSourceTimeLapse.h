@@ -177,6 +177,11 @@ private:
     // Otherwise returns false.
     bool trySettingVideoSize(int32_t width, int32_t height);
 
+    // Lowers the camera's frame rate range to the slowest supported range that still
+    // delivers a frame every mTimeBetweenFrameCaptureUs, so that fewer frames are
+    // captured only to be skipped. Leaves the camera unchanged if there is no such range.
+    void trySettingCaptureFpsRange();
+
     // When video camera is used for time lapse capture, returns true
     // until enough time has passed for the next time lapse frame. When
     // the frame needs to be encoded, it returns false and also modifies
@@ -41,6 +41,7 @@ namespace android {
 using namespace media;
 class BufferChannelBase;
 class BufferProducerWrapper;
+class MediaAnalyticsItem;
 class MediaCodecBuffer;
 struct PersistentSurface;
 struct RenderedFrameInfo;
@@ -222,6 +223,9 @@ struct CodecBase : public AHandler, /* static */ ColorUtils {
     virtual void signalSetParameters(const sp<AMessage> &msg) = 0;
     virtual void signalEndOfInputStream() = 0;
 
+    // Adds the metrics that the codec collected to |item|.
+    virtual void exportMetrics(MediaAnalyticsItem * /* item */) {}
+
     /*
      * Codec-related defines
      */
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CODEC_LATENCY_TRACKER_H_
+
+#define CODEC_LATENCY_TRACKER_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/KeyedVector.h>
+#include <utils/threads.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+class MediaAnalyticsItem;
+
+// Stamps the buffers of a codec as they pass between ACodec and the
+// component, and keeps a histogram of the time spent in each stage. Enabled
+// by the media.stagefright.codec-latency property; every call is a no-op
+// otherwise.
+struct CodecLatencyTracker {
+    enum Stage {
+        kStageEmpty,    // emptyBuffer() to EMPTY_BUFFER_DONE
+        kStageFill,     // fillBuffer() to FILL_BUFFER_DONE
+        kStageDecode,   // emptyBuffer() to FILL_BUFFER_DONE of the same media time
+        kStageRender,   // FILL_BUFFER_DONE to the client releasing it for render
+        kStageDisplay,  // FILL_BUFFER_DONE to the frame reaching the display
+        kNumStages,
+    };
+
+    CodecLatencyTracker();
+
+    bool enabled() const { return mEnabled; }
+
+    void onEmptyBuffer(uint32_t bufferId, int64_t mediaTimeUs);
+    void onEmptyBufferDone(uint32_t bufferId);
+    void onFillBuffer(uint32_t bufferId);
+    void onFillBufferDone(uint32_t bufferId, int64_t mediaTimeUs);
+    void onRenderRequested(uint32_t bufferId);
+    void onFrameDisplayed(int64_t mediaTimeUs, nsecs_t renderTimeNs);
+
+    // Forgets the buffers that are in flight, e.g. on a flush.
+    void clearPending();
+
+    void dump(AString *out) const;
+    void exportMetrics(MediaAnalyticsItem *item) const;
+
+private:
+    enum {
+        // <1ms, then doubling from 1ms up to >=1024ms
+        kNumBuckets = 12,
+        kMaxPendingMediaTimes = 64,
+    };
+
+    struct Histogram {
+        uint32_t mBuckets[kNumBuckets];
+        uint64_t mCount;
+        int64_t mTotalUs;
+        int64_t mMaxUs;
+    };
+
+    const bool mEnabled;
+
+    mutable Mutex mLock;
+    Histogram mHistograms[kNumStages];
+    KeyedVector<uint32_t, int64_t> mEmptyTimesUs;
+    KeyedVector<uint32_t, int64_t> mFillTimesUs;
+    KeyedVector<uint32_t, int64_t> mFillDoneTimesUs;
+    KeyedVector<int64_t, int64_t> mEmptyTimesUsByMediaTime;
+    KeyedVector<int64_t, int64_t> mFillDoneTimesUsByMediaTime;
+
+    void addLatency(Stage stage, int64_t latencyUs);
+    static bool TakeStamp(KeyedVector<uint32_t, int64_t> *stamps, uint32_t key, int64_t *timeUs);
+    static void AddMediaTimeStamp(
+            KeyedVector<int64_t, int64_t> *stamps, int64_t mediaTimeUs, int64_t timeUs);
+
+    DISALLOW_EVIL_CONSTRUCTORS(CodecLatencyTracker);
+};
+
+}  // namespace android
+
+#endif  // CODEC_LATENCY_TRACKER_H_
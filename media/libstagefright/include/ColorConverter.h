@@ -43,6 +43,19 @@ struct ColorConverter {
             size_t dstCropLeft, size_t dstCropTop,
             size_t dstCropRight, size_t dstCropBottom);
 
+    // As convert(), but scales the source crop rectangle to the size of the
+    // destination crop rectangle in the same pass, sampling the nearest
+    // source pixel.
+    status_t convertScaled(
+            const void *srcBits,
+            size_t srcWidth, size_t srcHeight,
+            size_t srcCropLeft, size_t srcCropTop,
+            size_t srcCropRight, size_t srcCropBottom,
+            void *dstBits,
+            size_t dstWidth, size_t dstHeight,
+            size_t dstCropLeft, size_t dstCropTop,
+            size_t dstCropRight, size_t dstCropBottom);
+
 private:
     struct BitmapParams {
         BitmapParams(
@@ -60,9 +73,9 @@ private:
     };
 
     OMX_COLOR_FORMATTYPE mSrcFormat, mDstFormat;
-    uint8_t *mClip;
 
-    uint8_t *initClip();
+    status_t convertBitmap(
+            const BitmapParams &src, const BitmapParams &dst, bool scale);
 
     status_t convertCbYCrY(
             const BitmapParams &src, const BitmapParams &dst);
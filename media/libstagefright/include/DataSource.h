@@ -47,6 +47,13 @@ public:
         kIsLocalFileSource     = 16,
     };
 
+    // How the source is going to be read, see setAccessPattern().
+    enum AccessPattern {
+        kAccessNormal,
+        kAccessSequential,
+        kAccessRandom,
+    };
+
     static sp<DataSource> CreateFromURI(
             const sp<IMediaHTTPService> &httpService,
             const char *uri,
@@ -102,6 +109,17 @@ public:
         return ERROR_UNSUPPORTED;
     }
 
+    // Returns a pointer to the "size" bytes at "offset" if the source is
+    // mapped into memory, or NULL if it is not or the range is out of
+    // bounds. The pointer stays valid as long as the source.
+    virtual const void *getMappedPointer(off64_t /*offset*/, size_t /*size*/) {
+        return NULL;
+    }
+
+    // Hints how the source is going to be read from now on, so that it can
+    // tune its read ahead.
+    virtual void setAccessPattern(AccessPattern /*pattern*/) {}
+
     ////////////////////////////////////////////////////////////////////////////
 
     // for DRM
@@ -43,6 +43,10 @@ public:
         return kIsLocalFileSource;
     }
 
+    virtual const void *getMappedPointer(off64_t offset, size_t size);
+
+    virtual void setAccessPattern(AccessPattern pattern);
+
     virtual sp<DecryptHandle> DrmInitialization(const char *mime);
 
     virtual void getDrmInfo(sp<DecryptHandle> &handle, DrmManagerClient **client);
@@ -53,6 +57,12 @@ public:
 
     static bool requiresDrm(int fd, int64_t offset, int64_t length, const char *mime);
 
+    // Maps a regular file into memory, so that reads are served by copying
+    // from the mapping instead of by a system call each. Done by the
+    // constructors if media.stagefright.file-mmap is set. Containers whose
+    // DRM decrypts them are still read through the DRM.
+    status_t map();
+
 protected:
     virtual ~FileSource();
 
@@ -63,6 +73,11 @@ private:
     Mutex mLock;
     String8 mName;
 
+    // the mapping of the file, which begins mMappingDelta bytes before mOffset
+    uint8_t *mMapping;
+    size_t mMappingSize;
+    size_t mMappingDelta;
+
     /*for DRM*/
     sp<DecryptHandle> mDecryptHandle;
     DrmManagerClient *mDrmManagerClient;
@@ -71,6 +86,7 @@ private:
     unsigned char *mDrmBuf;
 
     ssize_t readAtDRM(off64_t offset, void *data, size_t size);
+    bool isDrmContainer() const;
 
     FileSource(const FileSource &);
     FileSource &operator=(const FileSource &);
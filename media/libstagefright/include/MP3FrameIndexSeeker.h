@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MP3_FRAME_INDEX_SEEKER_H_
+
+#define MP3_FRAME_INDEX_SEEKER_H_
+
+#include "include/MP3Seeker.h"
+
+#include <atomic>
+
+#include <pthread.h>
+
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+class DataSource;
+
+// Seeks in MP3 files that carry neither a XING nor a VBRI header. A thread
+// of its own walks the frame headers from the first frame to the end of the
+// file, reading it in large blocks, and records the offset and the exact
+// time of a frame about every kEntryIntervalUs. Seeks within the part of
+// the file indexed so far step from the closest entry to the frame that
+// contains the requested time; other seeks are left to the caller's
+// bitrate based estimate.
+struct MP3FrameIndexSeeker : public MP3Seeker {
+    // |fixedHeader| is the header of the first frame, whose kMask bits all
+    // other frames must share.
+    static sp<MP3FrameIndexSeeker> CreateFromSource(
+            const sp<DataSource> &source, off64_t firstFramePos, uint32_t fixedHeader);
+
+    virtual bool getDuration(int64_t *durationUs);
+    virtual bool getOffsetForTime(int64_t *timeUs, off64_t *pos);
+
+protected:
+    virtual ~MP3FrameIndexSeeker();
+
+private:
+    enum {
+        kBlockSize = 256 * 1024,
+        kEntryIntervalUs = 500000,
+    };
+
+    // the offset of a frame, and the number of samples before it
+    struct Entry {
+        off64_t mOffset;
+        int64_t mSamples;
+    };
+
+    sp<DataSource> mSource;
+    off64_t mFirstFramePos;
+    uint32_t mFixedHeader;
+    int mSampleRate;
+
+    pthread_t mThread;
+    bool mThreadStarted;
+    std::atomic<bool> mAbort;
+
+    Mutex mLock;
+    Vector<Entry> mEntries;
+    // the offset and the number of samples up to which the file is indexed
+    off64_t mIndexedOffset;
+    int64_t mIndexedSamples;
+    bool mComplete;
+
+    MP3FrameIndexSeeker(
+            const sp<DataSource> &source, off64_t firstFramePos, uint32_t fixedHeader);
+
+    status_t start();
+
+    int64_t samplesToUs(int64_t samples) const {
+        return samples * 1000000ll / mSampleRate;
+    }
+
+    static void *ThreadWrapper(void *me);
+    void threadFunc();
+
+    DISALLOW_EVIL_CONSTRUCTORS(MP3FrameIndexSeeker);
+};
+
+}  // namespace android
+
+#endif  // MP3_FRAME_INDEX_SEEKER_H_
@@ -33,6 +33,7 @@ struct AMessage;
 struct AnotherPacketSource;
 struct ATSParser;
 class DataSource;
+struct MPEG2TSSeekIndex;
 struct MPEG2TSSource;
 class String8;
 
@@ -70,6 +71,10 @@ private:
     // If no video track is present, audio track will be used instead.
     KeyedVector<int64_t, off64_t> *mSeekSyncPoints;
 
+    // the sync points of the whole file, of the same track as
+    // mSeekSyncPoints, if enabled
+    sp<MPEG2TSSeekIndex> mSeekIndex;
+
     off64_t mOffset;
 
     static bool isScrambledFormat(const sp<MetaData> &format);
@@ -50,7 +50,12 @@ struct Trex {
 class MPEG4Extractor : public MediaExtractor {
 public:
     // Extractor assumes ownership of "source".
-    explicit MPEG4Extractor(const sp<DataSource> &source);
+    // In lazy mode the sample tables of a track are only read on the first
+    // getTrack() or getTrackMetaData(kIncludeExtensiveMetaData) for it, and the
+    // file's udta and meta boxes on the first getMetaData(). kKeyMaxInputSize,
+    // which needs a pass over all sample sizes, is set on the track's format
+    // at the same time as its sample tables are read.
+    explicit MPEG4Extractor(const sp<DataSource> &source, bool lazy = false);
 
     virtual size_t countTracks();
     virtual sp<IMediaSource> getTrack(size_t index);
@@ -75,11 +80,19 @@ private:
         uint32_t datalen;
         uint8_t *data;
     };
+    struct DeferredBox {
+        uint32_t type;
+        off64_t offset;
+        size_t size;
+    };
     struct Track {
         Track *next;
         sp<MetaData> meta;
         uint32_t timescale;
         sp<SampleTable> sampleTable;
+        // stbl boxes not yet set on sampleTable in lazy mode
+        Vector<DeferredBox> deferredBoxes;
+        status_t sampleTableStatus;
         bool includes_expensive_metadata;
         bool skipTrack;
     };
@@ -97,6 +110,9 @@ private:
     status_t mInitCheck;
     uint32_t mHeaderTimescale;
     bool mIsQT;
+    bool mLazy;
+    bool mDeferMetaData;
+    Vector<off64_t> mDeferredMetaDataOffsets;
 
     Track *mFirstTrack, *mLastTrack;
 
@@ -122,6 +138,9 @@ private:
             const void *esds_data, size_t esds_size);
 
     static status_t verifyTrack(Track *track);
+    status_t loadSampleTable(Track *track);
+    status_t setMaxInputSize(Track *track);
+    void parseDeferredMetaData();
 
     struct SINF {
         SINF *next;
@@ -30,6 +30,7 @@
 namespace android {
 
 class AMessage;
+struct AsyncFileWriter;
 class MediaBuffer;
 class MetaData;
 
@@ -85,6 +86,7 @@ private:
 
     int  mFd;
     int mNextFd;
+    AsyncFileWriter *mOutput;  // all writes to mFd go through it
     sp<MetaData> mStartMeta;
     status_t mInitCheck;
     bool mIsRealTimeRecording;
@@ -99,6 +101,7 @@ private:
     off_t mMdatOffset;
     uint8_t *mMoovBoxBuffer;
     off64_t mMoovBoxBufferOffset;
+    off64_t mMoovBoxBufferSize;
     bool  mWriteMoovBoxToMemory;
     off64_t mFreeBoxOffset;
     bool mStreamableFile;
@@ -113,6 +116,15 @@ private:
     int32_t mStartTimeOffsetMs;
     bool mSwitchPending;
 
+    // Fragmented files start with a moov box without samples, followed by a
+    // moof and mdat pair per fragment of each track, so that stopping only
+    // needs to write the last fragments, and what was written before a
+    // crash stays playable.
+    int64_t mFragmentDurationUs;  // 0 unless writing a fragmented file
+    bool mMoovBoxWritten;
+    uint32_t mFragmentSequenceNumber;
+    off64_t mMehdOffset;
+
     sp<ALooper> mLooper;
     sp<AHandlerReflector<MPEG4Writer> > mReflector;
 
@@ -208,6 +220,7 @@ private:
     off64_t addMultipleLengthPrefixedSamples_l(MediaBuffer *buffer);
 
     bool exceedsFileSizeLimit();
+    int64_t estimateFileSizeBytes();
     bool use32BitFileOffset() const;
     bool exceedsFileDurationLimit();
     bool approachingFileSizeLimit();
@@ -216,7 +229,19 @@ private:
     void writeCompositionMatrix(int32_t degrees);
     void writeMvhdBox(int64_t durationUs);
     void writeMoovBox(int64_t durationUs);
+    void writeMvexBox();
     void writeFtypBox(MetaData *param);
+
+    // Write what is left of the file once all tracks stopped.
+    void finishFile(int64_t durationUs);
+    void finishFragmentedFile(int64_t durationUs);
+
+    bool isFragmented() const { return mFragmentDurationUs > 0; }
+    int64_t fragmentDurationUs() const { return mFragmentDurationUs; }
+
+    // Writes the moov box of a fragmented file once the codec specific data
+    // of all tracks is known. Returns whether the moov box is written.
+    bool writeFragmentedMoovBox_l();
     void writeUdtaBox();
     void writeGeoDataBox();
     void writeLatitude(int degreex10000);
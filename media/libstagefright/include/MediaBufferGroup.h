@@ -18,10 +18,14 @@
 
 #define MEDIA_BUFFER_GROUP_H_
 
+#include <media/stagefright/foundation/AString.h>
 #include <media/stagefright/MediaBuffer.h>
 #include <utils/Errors.h>
 #include <utils/threads.h>
 
+#include <atomic>
+#include <vector>
+
 namespace android {
 
 class MediaBuffer;
@@ -32,6 +36,8 @@ public:
     MediaBufferGroup(size_t growthLimit = 0);
 
     // create a media buffer group with preallocated buffers
+    // If the group cannot grow, that is if growthLimit does not exceed the number of
+    // buffers, buffers of up to buffer_size are acquired and returned without locking.
     MediaBufferGroup(size_t buffers, size_t buffer_size, size_t growthLimit = 0);
 
     ~MediaBufferGroup();
@@ -56,14 +62,39 @@ public:
     // If buffer is nullptr, have acquire_buffer() check for remote release.
     virtual void signalBufferReturned(MediaBuffer *buffer);
 
+    // Returns the number of acquired buffers, and how many and how long
+    // acquire_buffer() calls had to wait for one.
+    AString debugStats();
+
 private:
     friend class MediaBuffer;
 
+    // Takes a free buffer of a fixed group without holding mLock.
+    bool acquireFixed(MediaBuffer **out);
+    // Takes a free buffer of at least requestedSize, or allocates one if the group can grow.
+    bool acquireGrowing_l(MediaBuffer **out, size_t requestedSize);
+    // Makes the group use mLock for all acquisitions, before its buffers change.
+    void leaveFixed_l();
+
     Mutex mLock;
     Condition mCondition;
     size_t mGrowthLimit;  // Do not automatically grow group larger than this.
     std::list<MediaBuffer *> mBuffers;
 
+    // A fixed group keeps its preallocated buffers in mFixedBuffers, which does not
+    // change while mFixed is set, and claims a buffer by setting its refcount from 0 to 1.
+    std::atomic<bool> mFixed;
+    std::atomic<int> mFixedUsers;   // threads using mFixedBuffers without mLock
+    std::vector<MediaBuffer *> mFixedBuffers;
+    size_t mFixedSize;              // size of the preallocated buffers of a fixed group
+    std::atomic<int> mWaiters;      // threads in acquire_buffer() holding or waiting on mLock
+
+    // statistics
+    std::atomic<uint64_t> mAcquired;
+    uint64_t mWaited;               // the following are protected by mLock
+    int64_t mWaitTotalUs;
+    int64_t mWaitMaxUs;
+
     MediaBufferGroup(const MediaBufferGroup &);
     MediaBufferGroup &operator=(const MediaBufferGroup &);
 };
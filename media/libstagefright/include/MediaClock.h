@@ -18,15 +18,25 @@
 
 #define MEDIA_CLOCK_H_
 
+#include <atomic>
+
 #include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <utils/List.h>
 #include <utils/Mutex.h>
 #include <utils/RefBase.h>
 
 namespace android {
 
 struct AMessage;
+struct ALooper;
+
+struct MediaClock : public AHandler {
+    enum {
+        TIMER_REASON_REACHED = 0,
+        TIMER_REASON_RESET = 1,
+    };
 
-struct MediaClock : public RefBase {
     MediaClock();
 
     void setStartingTimeMedia(int64_t startingTimeMediaUs);
@@ -54,15 +64,52 @@ struct MediaClock : public RefBase {
     // The result is saved in |outRealUs|.
     status_t getRealTimeFor(int64_t targetMediaUs, int64_t *outRealUs) const;
 
+    // Posts |notify| once the media time reaches |mediaTimeUs|, moved by
+    // |adjustRealUs| of real time. Timers only run while the clock does, and
+    // follow changes of its anchor and rate. |notify| gets the int32 "reason"
+    // TIMER_REASON_REACHED, or TIMER_REASON_RESET if reset() cancels it.
+    void addTimer(const sp<AMessage> &notify, int64_t mediaTimeUs,
+                  int64_t adjustRealUs = 0);
+
+    // Cancels all pending timers.
+    void reset();
+
 protected:
     virtual ~MediaClock();
 
+    virtual void onMessageReceived(const sp<AMessage> &msg);
+
 private:
-    status_t getMediaTime_l(
+    enum {
+        kWhatTimeIsUp = 'tIsU',
+    };
+
+    struct Anchor {
+        int64_t mTimeMediaUs;
+        int64_t mTimeRealUs;
+        int64_t mMaxTimeMediaUs;
+        int64_t mStartingTimeMediaUs;
+        float mPlaybackRate;
+    };
+
+    struct Timer {
+        Timer(const sp<AMessage> &notify, int64_t mediaTimeUs, int64_t adjustRealUs);
+        const sp<AMessage> mNotify;
+        int64_t mMediaTimeUs;
+        int64_t mAdjustRealUs;
+    };
+
+    static status_t getMediaTime(
+            const Anchor &anchor,
             int64_t realUs,
             int64_t *outMediaUs,
-            bool allowPastMaxTime) const;
+            bool allowPastMaxTime);
+    void getAnchor(Anchor *anchor) const;
+    void publishAnchor_l();
+    void processTimers_l();
 
+    // Serializes the updates. Queries read the published copy of the anchor
+    // below instead, so that they never block.
     mutable Mutex mLock;
 
     int64_t mAnchorTimeMediaUs;
@@ -72,6 +119,21 @@ private:
 
     float mPlaybackRate;
 
+    // The anchor as last published by publishAnchor_l(). mAnchorSeq is odd
+    // while it is being written, and readers retry until they see the same
+    // even sequence number before and after reading it.
+    std::atomic<uint32_t> mAnchorSeq;
+    std::atomic<int64_t> mPublishedTimeMediaUs;
+    std::atomic<int64_t> mPublishedTimeRealUs;
+    std::atomic<int64_t> mPublishedMaxTimeMediaUs;
+    std::atomic<int64_t> mPublishedStartingTimeMediaUs;
+    std::atomic<float> mPublishedPlaybackRate;
+
+    // Created along with the first timer.
+    sp<ALooper> mLooper;
+    List<Timer> mTimers;
+    int32_t mGeneration;
+
     DISALLOW_EVIL_CONSTRUCTORS(MediaClock);
 };
 
@@ -61,6 +61,7 @@ struct MediaCodec : public AHandler {
         BUFFER_FLAG_SYNCFRAME   = 1,
         BUFFER_FLAG_CODECCONFIG = 2,
         BUFFER_FLAG_EOS         = 4,
+        BUFFER_FLAG_PARTIAL_FRAME = 8,
     };
 
     enum {
@@ -69,6 +70,20 @@ struct MediaCodec : public AHandler {
         CB_ERROR = 3,
         CB_OUTPUT_FORMAT_CHANGED = 4,
         CB_RESOURCE_RECLAIMED = 5,
+        // Output buffers that became available together, as an ABuffer
+        // "buffers" of BufferDescriptor. Sent instead of CB_OUTPUT_AVAILABLE
+        // if the callback message has a nonzero int32 "batch-outputs".
+        CB_OUTPUTS_AVAILABLE = 6,
+    };
+
+    // A buffer to queue with queueInputBuffers(), or one dequeued by
+    // dequeueOutputBuffers().
+    struct BufferDescriptor {
+        size_t mIndex;
+        size_t mOffset;
+        size_t mSize;
+        int64_t mPresentationTimeUs;
+        uint32_t mFlags;
     };
 
     static const pid_t kNoPid = -1;
@@ -159,6 +174,22 @@ struct MediaCodec : public AHandler {
             uint32_t *flags,
             int64_t timeoutUs = 0ll);
 
+    // Queues |buffers| in order in one round trip to the codec's looper,
+    // stopping at the first that fails. Sets |*numQueued| to the number
+    // queued.
+    status_t queueInputBuffers(
+            const Vector<BufferDescriptor> &buffers,
+            size_t *numQueued,
+            AString *errorDetailMsg = NULL);
+
+    // Dequeues up to |maxBuffers| output buffers that are ready in one round
+    // trip to the codec's looper, waiting up to |timeoutUs| for the first.
+    // Returns the same errors as dequeueOutputBuffer() if none is dequeued.
+    status_t dequeueOutputBuffers(
+            Vector<BufferDescriptor> *buffers,
+            size_t maxBuffers,
+            int64_t timeoutUs = 0ll);
+
     status_t renderOutputBufferAndRelease(size_t index, int64_t timestampNs);
     status_t renderOutputBufferAndRelease(size_t index);
     status_t releaseOutputBuffer(size_t index);
@@ -253,6 +284,8 @@ private:
         kWhatSetCallback                    = 'setC',
         kWhatSetNotification                = 'setN',
         kWhatDrmReleaseCrypto               = 'rDrm',
+        kWhatQueueInputBuffers              = 'queB',
+        kWhatPostOutputCallbacks            = 'pOCb',
     };
 
     enum {
@@ -269,6 +302,8 @@ private:
         kFlagIsAsync                    = 1024,
         kFlagIsComponentAllocated       = 2048,
         kFlagPushBlankBuffersOnShutdown = 4096,
+        kFlagBatchOutputCallbacks       = 8192,
+        kFlagOutputCallbacksPending     = 16384,
     };
 
     struct BufferInfo {
@@ -353,6 +388,7 @@ private:
 
     int32_t mDequeueOutputTimeoutGeneration;
     sp<AReplyToken> mDequeueOutputReplyID;
+    size_t mDequeueOutputMaxBuffers;
 
     sp<ICrypto> mCrypto;
 
@@ -391,7 +427,8 @@ private:
             sp<MediaCodecBuffer> *buffer, sp<AMessage> *format);
 
     bool handleDequeueInputBuffer(const sp<AReplyToken> &replyID, bool newRequest = false);
-    bool handleDequeueOutputBuffer(const sp<AReplyToken> &replyID, bool newRequest = false);
+    bool handleDequeueOutputBuffer(
+            const sp<AReplyToken> &replyID, bool newRequest = false, size_t maxBuffers = 1);
     void cancelPendingDequeueOperations();
 
     void extractCSD(const sp<AMessage> &format);
@@ -409,6 +446,8 @@ private:
 
     void onInputBufferAvailable();
     void onOutputBufferAvailable();
+    void postOutputCallbacks();
+    void getOutputBufferDescriptor(size_t index, BufferDescriptor *desc);
     void onError(status_t err, int32_t actionCode, const char *detail = NULL);
     void onOutputFormatChanged();
 
@@ -35,6 +35,7 @@ namespace android {
 extern const char *kMaxEncoderInputBuffers;
 
 struct AMessage;
+class Parcel;
 
 struct MediaCodecList : public BnMediaCodecList {
     static sp<IMediaCodecList> getInstance();
@@ -116,7 +117,13 @@ private:
     Vector<sp<MediaCodecInfo> > mCodecInfos;
     sp<MediaCodecInfo> mCurrentInfo;
 
+    // indices of the non-advanced decoders [0] and encoders [1] of each
+    // lowercased type, in increasing order.
+    KeyedVector<AString, Vector<size_t> > mTypeIndex[2];
+
     MediaCodecList();
+    // loads the list from the snapshot at |path| instead of parsing the XMLs
+    explicit MediaCodecList(const char *snapshotPath);
     ~MediaCodecList();
 
     status_t initCheck() const;
@@ -145,6 +152,16 @@ private:
 
     status_t initializeCapabilities(const char *type);
 
+    void buildTypeIndex();
+
+    /* Snapshot of the parsed list, written by the media server and mapped by
+     * client processes so that they neither parse the XMLs nor query the
+     * media server for every codec info.
+     */
+    static AString getSnapshotKey();
+    status_t writeSnapshot(const char *path) const;
+    status_t readSnapshot(const Parcel &parcel);
+
     DISALLOW_EVIL_CONSTRUCTORS(MediaCodecList);
 };
 
@@ -110,6 +110,13 @@ private:
     status_t initEncoder();
     void releaseEncoder();
     status_t feedEncoderInputBuffers();
+    // Converts the encoder output buffer at |index| to a MediaBuffer and
+    // appends it to |buffers|. Returns false if the encoder reached EOS or
+    // failed.
+    bool onEncoderOutputBuffer(
+            int32_t index, int64_t timeUs, int32_t flags, List<MediaBuffer *> *buffers);
+    // Hands |buffers| to the reader and empties the list.
+    void queueOutputBuffers(List<MediaBuffer *> *buffers);
     // Resume GraphicBufferSource at resumeStartTimeUs. Buffers
     // from GraphicBufferSource with timestamp larger or equal to
     // resumeStartTimeUs will be encoded. resumeStartTimeUs uses
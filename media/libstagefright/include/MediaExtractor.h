@@ -21,6 +21,7 @@
 #include <media/IMediaExtractor.h>
 #include <media/IMediaSource.h>
 #include <media/MediaAnalyticsItem.h>
+#include <utils/Vector.h>
 
 namespace android {
 namespace media {
@@ -90,14 +91,25 @@ private:
             const sp<DataSource> &source, String8 *mimeType,
             float *confidence, sp<AMessage> *meta);
 
+    struct Sniffer {
+        SnifferFunc mFunc;
+        // the highest confidence the sniffer reports
+        float mMaxConfidence;
+        // the order of registration, which breaks ties between confidences
+        size_t mIndex;
+        // the number of sniffs the sniffer won
+        uint32_t mWins;
+    };
+
     static Mutex gSnifferMutex;
-    static List<SnifferFunc> gSniffers;
+    // in the order they are tried, the most successful first
+    static Vector<Sniffer> gSniffers;
     static bool gSniffersRegistered;
 
     // The sniffer can optionally fill in "meta" with an AMessage containing
     // a dictionary of values that helps the corresponding extractor initialize
     // its state without duplicating effort already exerted by the sniffer.
-    static void RegisterSniffer_l(SnifferFunc func);
+    static void RegisterSniffer_l(SnifferFunc func, float maxConfidence);
 
     static bool sniff(const sp<DataSource> &source,
             String8 *mimeType, float *confidence, sp<AMessage> *meta);
@@ -117,6 +117,10 @@ enum {
     kKey64BitFileOffset   = 'fobt',  // int32_t (bool)
     kKey2ByteNalLength    = '2NAL',  // int32_t (bool)
 
+    // Set this key to author a fragmented file, with a moof box for every
+    // this many us of each track.
+    kKeyFragmentDurationUs = 'frgD', // int64_t
+
     // Identify the file output format for authoring
     // Please see <media/mediarecorder.h> for the supported
     // file output formats.
@@ -294,11 +298,18 @@ private:
 
         union {
             void *ext_data;
-            float reservoir;
+            int64_t reservoir[2];   // holds all scalar types and Rect
         } u;
 
+        // Strings and other data only use the reservoir if they are very short, as callers
+        // may keep the pointer from findData() while setting other keys on the same MetaData.
         bool usesReservoir() const {
-            return mSize <= sizeof(u.reservoir);
+            return mSize <= (isScalar() ? sizeof(u.reservoir) : sizeof(float));
+        }
+
+        bool isScalar() const {
+            return mType == TYPE_INT32 || mType == TYPE_INT64 || mType == TYPE_FLOAT
+                    || mType == TYPE_POINTER || mType == TYPE_RECT;
         }
 
         void *allocateStorage(size_t size);
@@ -317,8 +328,18 @@ private:
         int32_t mLeft, mTop, mRight, mBottom;
     };
 
+    static status_t writeItemToParcel(Parcel &parcel, uint32_t key, const typed_data &item);
+
     KeyedVector<uint32_t, typed_data> mItems;
 
+    // The keys set on most MediaBuffers are kept out of mItems, so that setting them
+    // after MediaBuffer::reset() does not allocate.
+    enum {
+        kNumInlineKeys = 4,
+    };
+    typed_data mInlineItems[kNumInlineKeys];
+    uint32_t mInlineMask;   // bit i is set if mInlineItems[i] holds a value
+
     // MetaData &operator=(const MetaData &);
 };
 
@@ -24,14 +24,21 @@
 
 namespace android {
 
+struct ABuffer;
 struct ALooper;
+struct DiskCache;
 struct PageCache;
+struct RangeFetcher;
 
 struct NuCachedSource2 : public DataSource {
+    // If |rangeConnections| is not NULL, its sources, further connections
+    // to the same HTTP source that support range requests, fetch ahead in
+    // parallel with |source|.
     static sp<NuCachedSource2> Create(
             const sp<DataSource> &source,
             const char *cacheConfig = NULL,
-            bool disconnectAtHighwatermark = false);
+            bool disconnectAtHighwatermark = false,
+            const Vector<sp<DataSource> > *rangeConnections = NULL);
 
     virtual status_t initCheck() const;
 
@@ -65,6 +72,11 @@ struct NuCachedSource2 : public DataSource {
     status_t getEstimatedBandwidthKbps(int32_t *kbps);
     status_t setCacheStatCollectFreq(int32_t freqMs);
 
+    // Returns the number of bytes read from the disk cache, and the number
+    // of bytes it was asked for but did not have, or ERROR_UNSUPPORTED if
+    // there is no disk cache.
+    status_t getDiskCacheStats(int64_t *hitBytes, int64_t *missBytes);
+
     static void RemoveCacheSpecificHeaders(
             KeyedVector<String8, String8> *headers,
             String8 *cacheConfig,
@@ -89,6 +101,13 @@ private:
         // Read data after a 15 sec timeout whether we're actively
         // fetching or not.
         kDefaultKeepAliveIntervalUs     = 15000000,
+
+        kDefaultDiskCacheSizeMb         = 64,
+
+        // Parallel fetches request extents of this size, as many ahead as
+        // there are connections times kNumExtentsPerConnection.
+        kRangeExtentSize                = 1024 * 1024,
+        kNumExtentsPerConnection        = 2,
     };
 
     enum {
@@ -111,6 +130,21 @@ private:
 
     PageCache *mCache;
     off64_t mCacheOffset;
+
+    // Fetches ahead in parallel, if enabled. mSource is one of its
+    // connections, fetchInternal() is not used then.
+    RangeFetcher *mRangeFetcher;
+    size_t mNumRangeConnections;
+    // The tail of the source, where the index of many files is, fetched
+    // ahead of a seek there. Empty until the download completes.
+    off64_t mTailOffset;
+    sp<ABuffer> mTail;
+
+    // Holds the pages released from mCache, if enabled.
+    DiskCache *mDiskCache;
+    int64_t mDiskCacheHitBytes;
+    int64_t mDiskCacheMissBytes;
+
     status_t mFinalStatus;
     off64_t mLastAccessPos;
     sp<AMessage> mAsyncResult;
@@ -133,6 +167,8 @@ private:
     void onRead(const sp<AMessage> &msg);
 
     void fetchInternal();
+    void startRangeFetcher(const Vector<sp<DataSource> > &connections);
+    bool fetchRanges();
     ssize_t readInternal(off64_t offset, void *data, size_t size);
     status_t seekInternal_l(off64_t offset);
 
@@ -141,6 +177,7 @@ private:
     void restartPrefetcherIfNecessary_l(
             bool ignoreLowWaterThreshold = false, bool force = false);
 
+    void createDiskCacheFromSystemProperty();
     void updateCacheParamsFromSystemProperty();
     void updateCacheParamsFromString(const char *s);
 
@@ -50,6 +50,16 @@ public:
         }
         return mSource->readAt(offset, mMemory->pointer(), size);
     }
+    virtual status_t readRangesAt(
+            const off64_t *offsets, const size_t *sizes, size_t count, ssize_t *results) {
+        // The ranges fit the memory, see IDataSource::readRangesAt().
+        uint8_t *data = (uint8_t *)mMemory->pointer();
+        for (size_t i = 0; i < count; ++i) {
+            results[i] = mSource->readAt(offsets[i], data, sizes[i]);
+            data += sizes[i];
+        }
+        return OK;
+    }
     virtual status_t getSize(off64_t *size) {
         return mSource->getSize(size);
     }
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_INDEX_H_
+
+#define SAMPLE_INDEX_H_
+
+#include <atomic>
+
+#include <sys/types.h>
+#include <stdint.h>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <utils/Errors.h>
+
+namespace android {
+
+struct SampleIterator;
+
+// A precomputed index of the offset, size, composition time, duration and
+// sync flag of every sample of a SampleTable, with O(1) access by sample
+// index. Each column is bit packed to the width its values need. Offsets and
+// times are stored relative to the smallest one of each block of
+// kBlockSize samples, so that interleaved chunks and long files still pack
+// into a few bytes per sample.
+struct SampleIndex {
+    SampleIndex();
+    ~SampleIndex();
+
+    // Indexes the |numSamples| samples of |iterator|'s table. |syncSamples|
+    // lists the sync samples in increasing order, or is NULL if every sample
+    // is a sync sample. Returns ERROR_OUT_OF_RANGE if a sample lies too far
+    // from its block's smallest offset, and -EINTR once |abort| is set.
+    status_t build(
+            SampleIterator *iterator, uint32_t numSamples,
+            const uint32_t *syncSamples, uint32_t numSyncSamples,
+            const std::atomic<bool> *abort);
+
+    uint32_t countSamples() const { return mNumSamples; }
+
+    off64_t getSampleOffset(uint32_t sampleIndex) const {
+        return mBlockOffsets[sampleIndex / kBlockSize] + mOffsets.get(sampleIndex);
+    }
+    size_t getSampleSize(uint32_t sampleIndex) const {
+        return mSizes.get(sampleIndex);
+    }
+    uint32_t getSampleTime(uint32_t sampleIndex) const {
+        return mBlockTimes[sampleIndex / kBlockSize] + mTimes.get(sampleIndex);
+    }
+    uint32_t getSampleDuration(uint32_t sampleIndex) const {
+        return mDurations.get(sampleIndex);
+    }
+    bool isSyncSample(uint32_t sampleIndex) const {
+        return mSyncFlags.get(sampleIndex) != 0;
+    }
+
+    // Whether composition times never decrease with the sample index, so
+    // that they can be binary searched in sample order.
+    bool hasIncreasingTimes() const { return mIncreasingTimes; }
+
+    size_t memorySize() const;
+
+private:
+    enum {
+        kBlockSize = 32,
+    };
+
+    // values of up to 32 bits, stored as the difference to the smallest one
+    // in as many bits as the largest difference needs.
+    struct PackedColumn {
+        PackedColumn();
+        ~PackedColumn();
+
+        status_t pack(const uint32_t *values, size_t count);
+
+        uint32_t get(size_t index) const {
+            if (mWidth == 0) {
+                return mMin;
+            }
+            uint64_t bit = (uint64_t)index * mWidth;
+            const uint32_t *word = &mWords[bit >> 5];
+            uint64_t bits = word[0] | ((uint64_t)word[1] << 32);
+            return mMin + (uint32_t)((bits >> (bit & 31)) & mMask);
+        }
+
+        size_t memorySize() const { return mNumWords * sizeof(uint32_t); }
+
+    private:
+        uint32_t mMin;
+        uint32_t mWidth;
+        uint64_t mMask;
+        uint32_t *mWords;
+        size_t mNumWords;
+
+        DISALLOW_EVIL_CONSTRUCTORS(PackedColumn);
+    };
+
+    uint32_t mNumSamples;
+    bool mIncreasingTimes;
+
+    off64_t *mBlockOffsets;
+    uint32_t *mBlockTimes;
+
+    PackedColumn mOffsets;
+    PackedColumn mSizes;
+    PackedColumn mTimes;
+    PackedColumn mDurations;
+    PackedColumn mSyncFlags;
+
+    DISALLOW_EVIL_CONSTRUCTORS(SampleIndex);
+};
+
+}  // namespace android
+
+#endif  // SAMPLE_INDEX_H_
@@ -18,6 +18,9 @@
 
 #define SAMPLE_TABLE_H_
 
+#include <atomic>
+
+#include <pthread.h>
 #include <sys/types.h>
 #include <stdint.h>
 
@@ -28,6 +31,7 @@
 namespace android {
 
 class DataSource;
+struct SampleIndex;
 struct SampleIterator;
 
 class SampleTable : public RefBase {
@@ -84,6 +88,12 @@ public:
 
     status_t findThumbnailSample(uint32_t *sample_index);
 
+    // Builds a SampleIndex of all samples, which the lookups above use
+    // instead of the tables once it is complete. With |async| it is built on
+    // a thread of its own, which reads the data source concurrently with the
+    // caller's reads.
+    void buildSampleIndex(bool async);
+
 protected:
     ~SampleTable();
 
@@ -104,6 +114,8 @@ private:
     off64_t mChunkOffsetOffset;
     uint32_t mChunkOffsetType;
     uint32_t mNumChunkOffsets;
+    // the chunk offset entries if the data source is mapped into memory
+    const uint8_t *mChunkOffsets;
 
     off64_t mSampleToChunkOffset;
     uint32_t mNumSampleToChunkOffsets;
@@ -112,6 +124,8 @@ private:
     uint32_t mSampleSizeFieldSize;
     uint32_t mDefaultSampleSize;
     uint32_t mNumSampleSizes;
+    // the sample size entries if the data source is mapped into memory
+    const uint8_t *mSampleSizes;
 
     bool mHasTimeToSample;
     uint32_t mTimeToSampleCount;
@@ -134,6 +148,13 @@ private:
 
     SampleIterator *mSampleIterator;
 
+    // set once under mLock, and not modified afterwards
+    SampleIndex *mSampleIndex;
+    bool mSampleIndexRequested;
+    bool mIndexThreadStarted;
+    pthread_t mIndexThread;
+    std::atomic<bool> mAbortIndexBuild;
+
     struct SampleToChunkEntry {
         uint32_t startChunk;
         uint32_t samplesPerChunk;
@@ -146,13 +167,11 @@ private:
 
     friend struct SampleIterator;
 
-    // normally we don't round
-    inline uint64_t getSampleTime(
-            size_t sample_index, uint64_t scale_num, uint64_t scale_den) const {
-        return (sample_index < (size_t)mNumSampleSizes && mSampleTimeEntries != NULL
-                && scale_den != 0)
-                ? (mSampleTimeEntries[sample_index].mCompositionTime * scale_num) / scale_den : 0;
-    }
+    // normally we don't round. |index| is used instead of mSampleTimeEntries
+    // if it is not NULL.
+    uint64_t getSampleTime(
+            const SampleIndex *index, size_t sample_index,
+            uint64_t scale_num, uint64_t scale_den) const;
 
     status_t getSampleSize_l(uint32_t sample_index, size_t *sample_size);
     int32_t getCompositionTimeOffset(uint32_t sampleIndex);
@@ -161,6 +180,9 @@ private:
 
     void buildSampleEntriesTable();
 
+    static void *IndexThreadWrapper(void *me);
+    void buildSampleIndexNow();
+
     SampleTable(const SampleTable &);
     SampleTable &operator=(const SampleTable &);
 };
@@ -52,6 +52,8 @@ class SkipCutBuffer: public RefBase {
     size_t read(char *dst, size_t num);
     template <typename T>
     void submitInternal(const sp<T>& buffer);
+    // skips and cuts the data at |offset|, |buflen| in the buffer at |base|, updating the range
+    void process(char *base, size_t capacity, int32_t *offset, int32_t *buflen);
     int32_t mSkip;
     int32_t mFrontPadding;
     int32_t mBackPadding;
@@ -44,6 +44,9 @@ public:
 private:
     enum YUVMode {
         None,
+        // The window takes the planes of the decoder as they are, in a
+        // flexible YUV buffer, instead of a converted copy.
+        FlexibleYUV,
     };
 
     OMX_COLOR_FORMATTYPE mColorFormat;
@@ -57,10 +60,16 @@ private:
     android_dataspace mDataSpace;
     FrameRenderTracker mRenderTracker;
 
+    // the time render() takes, from dequeuing the buffer to queuing it
+    size_t mNumFramesRendered;
+    nsecs_t mTotalRenderTimeNs;
+    nsecs_t mMaxRenderTimeNs;
+
     SoftwareRenderer(const SoftwareRenderer &);
     SoftwareRenderer &operator=(const SoftwareRenderer &);
 
     void resetFormatIfChanged(const sp<AMessage> &format);
+    void copyToFlexibleYUV(const void *data, const android_ycbcr &ycbcr);
 };
 
 }  // namespace android
@@ -19,9 +19,12 @@
 #define STAGEFRIGHT_MEDIA_SCANNER_H_
 
 #include <media/mediascanner.h>
+#include <utils/StrongPointer.h>
 
 namespace android {
 
+class MediaMetadataRetriever;
+
 struct StagefrightMediaScanner : public MediaScanner {
     StagefrightMediaScanner();
     virtual ~StagefrightMediaScanner();
@@ -30,15 +33,33 @@ struct StagefrightMediaScanner : public MediaScanner {
             const char *path, const char *mimeType,
             MediaScannerClient &client);
 
+    // Reads the files on a pool of up to |maxConcurrency| threads, each
+    // with a retriever of its own that it keeps from file to file, and
+    // reports them to the client as they complete, in order.
+    virtual MediaScanResult processFiles(
+            const Vector<String8> &paths, MediaScannerClient &client,
+            size_t maxConcurrency, Vector<MediaScanResult> *results);
+
     virtual MediaAlbumArt *extractAlbumArt(int fd);
 
 private:
+    struct FileMetadata;
+    struct ParallelScan;
+
     StagefrightMediaScanner(const StagefrightMediaScanner &);
     StagefrightMediaScanner &operator=(const StagefrightMediaScanner &);
 
     MediaScanResult processFileInternal(
             const char *path, const char *mimeType,
             MediaScannerClient &client);
+
+    // Reads the metadata of |path| with |*retriever|, which is created if
+    // it is NULL.
+    static MediaScanResult ExtractMetadata(
+            const char *path, sp<MediaMetadataRetriever> *retriever,
+            FileMetadata *metadata);
+    static MediaScanResult ReportMetadata(
+            const FileMetadata &metadata, MediaScannerClient &client);
 };
 
 }  // namespace android
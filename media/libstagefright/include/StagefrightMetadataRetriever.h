@@ -20,13 +20,17 @@
 
 #include <media/IMediaExtractor.h>
 #include <media/MediaMetadataRetrieverInterface.h>
+#include <media/stagefright/foundation/AString.h>
 
 #include <utils/KeyedVector.h>
 
 namespace android {
 
+struct ALooper;
 class DataSource;
 class MediaExtractor;
+struct MediaCodec;
+class MetaData;
 
 struct StagefrightMetadataRetriever : public MediaMetadataRetrieverInterface {
     StagefrightMetadataRetriever();
@@ -41,6 +45,8 @@ struct StagefrightMetadataRetriever : public MediaMetadataRetrieverInterface {
     virtual status_t setDataSource(const sp<DataSource>& source);
 
     virtual VideoFrame *getFrameAtTime(int64_t timeUs, int option);
+    virtual status_t getFramesAtTimes(
+            const Vector<int64_t> &timesUs, int option, Vector<VideoFrame *> *frames);
     virtual MediaAlbumArt *extractAlbumArt();
     virtual const char *extractMetadata(int keyCode);
 
@@ -52,6 +58,27 @@ private:
     KeyedVector<int, String8> mMetaData;
     MediaAlbumArt *mAlbumArt;
 
+    // The decoder of the last frame extracted, flushed and kept running for
+    // the next request. It is reconfigured rather than instantiated again
+    // when the next frame is of another track, or of another file.
+    sp<ALooper> mDecoderLooper;
+    sp<MediaCodec> mDecoder;
+    AString mDecoderName;
+    sp<MetaData> mDecoderTrackMeta;
+    bool mDecoderSeekingClosest;
+
+    VideoFrame *extractVideoFrame(
+            const AString &componentName,
+            const sp<MetaData> &trackMeta,
+            const sp<IMediaSource> &source,
+            int64_t frameTimeUs,
+            int seekMode);
+    void releaseDecoder();
+    bool getVideoTrack(
+            sp<MetaData> *trackMeta,
+            sp<IMediaSource> *source,
+            Vector<AString> *matchingCodecs);
+
     void parseMetaData();
     // Delete album art and clear metadata.
     void clearMetadata();
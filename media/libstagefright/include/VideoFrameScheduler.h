@@ -17,6 +17,7 @@
 #ifndef VIDEO_FRAME_SCHEDULER_H_
 #define VIDEO_FRAME_SCHEDULER_H_
 
+#include <utils/Mutex.h>
 #include <utils/RefBase.h>
 #include <utils/Timers.h>
 
@@ -45,6 +46,24 @@ struct VideoFrameScheduler : public RefBase {
     void release();
 
     static const size_t kHistorySize = 8;
+    static const size_t kMaxVsyncsPerFrameStats = 5;
+
+    // Cadence statistics of the frames scheduled against VSYNC since the scheduler was
+    // created. A frame is repeated if it is shown for more VSYNCs than its period spans, and
+    // skipped if it is shown for fewer (or not at all). Judder is the difference between the
+    // time a frame is shown and the frame period.
+    struct Stats {
+        int64_t mNumFrames;
+        int64_t mNumRepeats;
+        int64_t mNumSkips;
+        nsecs_t mTotalJudderNs;
+        nsecs_t mMaxJudderNs;
+        // number of frames shown for 0, 1, ... VSYNCs; the last bucket also counts longer ones
+        int64_t mVsyncsPerFrame[kMaxVsyncsPerFrameStats];
+    };
+
+    // returns the statistics. This can be called from any thread.
+    Stats getStats();
 
 protected:
     virtual ~VideoFrameScheduler();
@@ -82,6 +101,7 @@ private:
     };
 
     void updateVsync();
+    void updateStats(size_t vsyncsForLastFrame, nsecs_t videoPeriod);
 
     nsecs_t mVsyncTime;        // vsync timing from display
     nsecs_t mVsyncPeriod;
@@ -94,6 +114,9 @@ private:
 
     sp<ISurfaceComposer> mComposer;
 
+    Mutex mStatsLock;
+    Stats mStats;
+
     DISALLOW_EVIL_CONSTRUCTORS(VideoFrameScheduler);
 };
 
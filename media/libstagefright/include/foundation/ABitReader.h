@@ -46,6 +46,13 @@ public:
     // Tries to skip |n| bits. Returns true iff successful. Skipping 0 bits will always succeed.
     bool skipBits(size_t n);
 
+    // Tries to get an unsigned Exp-Golomb code, ue(v). If not successful, returns false. This
+    // happens on over-read, or if the code has 32 leading zero bits or more, which is skipped.
+    bool getUEGolombGraceful(uint32_t *out);
+
+    // Tries to get a signed Exp-Golomb code, se(v), like getUEGolombGraceful().
+    bool getSEGolombGraceful(int32_t *out);
+
     // "Puts" |n| bits with the value |x| back virtually into the bit stream. The put-back bits
     // are not actually written into the data, but are tracked in a separate buffer that can
     // store at most 32 bits. This is a no-op if the stream has already been over-read.
@@ -63,7 +70,7 @@ protected:
     const uint8_t *mData;
     size_t mSize;
 
-    uint32_t mReservoir;  // left-aligned bits
+    uint64_t mReservoir;  // left-aligned bits
     size_t mNumBitsLeft;
     bool mOverRead;
 
@@ -52,10 +52,21 @@ struct ABuffer : public RefBase {
     MediaBufferBase *getMediaBufferBase();
     void setMediaBufferBase(MediaBufferBase *mediaBuffer);
 
+    // ABuffers are allocated behind a small header which tells whether their
+    // storage returns to an ABufferPool size class when they are deleted.
+    static void *operator new(size_t size);
+    static void operator delete(void *object);
+
 protected:
     virtual ~ABuffer();
 
 private:
+    friend struct ABufferPool;
+
+    // for ABufferPool, which constructs an ABuffer in storage it has set up
+    static void *operator new(size_t size, void *storage);
+    static void operator delete(void *object, void *storage);
+
     sp<AMessage> mMeta;
 
     MediaBufferBase *mMediaBufferBase;
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef A_BUFFER_POOL_H_
+
+#define A_BUFFER_POOL_H_
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/ABuffer.h>
+
+namespace android {
+
+// Recycles the storage of short lived ABuffers, such as the access units
+// assembled by the parsers.
+//
+// A pooled ABuffer and its data are a single allocation, rounded up to a power of 2 size
+// class from 256 bytes to 1 MB. When the last reference to the buffer goes away the
+// allocation returns to its size class, which keeps up to 1 MB of them for the next buffers.
+struct ABufferPool {
+    // Returns a buffer of the given capacity, as new ABuffer(capacity) would.
+    // Buffers larger than the largest size class are not pooled.
+    static sp<ABuffer> Acquire(size_t capacity);
+
+    struct Stats {
+        uint64_t mAllocated;    // allocations made for pooled buffers
+        uint64_t mReused;       // pooled buffers which reused an allocation
+        uint64_t mReleased;     // allocations kept for reuse
+        uint64_t mFreed;        // allocations freed, as their size class was full
+        size_t mCachedBytes;    // memory kept for reuse
+    };
+    static void GetStats(Stats *stats);
+
+    // Frees the memory kept for reuse.
+    static void Trim();
+
+private:
+    friend struct ABuffer;      // operator new and delete
+
+    struct Header;
+    struct SizeClass;
+
+    static void *AllocateUnpooled(size_t size);
+    static void Free(void *object);
+
+    static SizeClass *GetSizeClasses();
+
+    DISALLOW_EVIL_CONSTRUCTORS(ABufferPool);
+};
+
+}  // namespace android
+
+#endif  // A_BUFFER_POOL_H_
@@ -26,6 +26,9 @@
 #include <utils/RefBase.h>
 #include <utils/threads.h>
 
+#include <atomic>
+#include <vector>
+
 namespace android {
 
 struct AHandler;
@@ -41,6 +44,14 @@ struct ALooper : public RefBase {
     // Takes effect in a subsequent call to start().
     void setName(const char *name);
 
+    // Takes effect in a subsequent call to start(). Instead of starting a thread, the looper
+    // delivers its messages on the threads of the ALooperExecutor shared by all such loopers,
+    // one message at a time, in the same order as it would on its own thread.
+    // Ignored if start() asks for a thread that can call Java or has a non default priority.
+    // Handlers of a shared looper must not block for long, as each one that blocks takes
+    // a thread of the executor away from the other loopers.
+    void setUseSharedExecutor(bool shared);
+
     handler_id registerHandler(const sp<AHandler> &handler);
     void unregisterHandler(handler_id handlerID);
 
@@ -58,28 +69,78 @@ struct ALooper : public RefBase {
         return mName.c_str();
     }
 
+    // Returns the queue depth and delivery latency statistics, and resets them if clear is set.
+    AString debugStats(bool clear = false);
+
 protected:
     virtual ~ALooper();
 
 private:
     friend struct AMessage;       // post()
+    friend struct ALooperExecutor; // runShared(), onSharedTimer()
 
     struct Event {
         int64_t mWhenUs;
+        uint64_t mSequence;     // orders the events due at the same time by posting order
         sp<AMessage> mMessage;
     };
 
+    // heap order of mEventQueue, the earliest event is on top
+    struct EventLater {
+        bool operator()(const Event &a, const Event &b) const {
+            return a.mWhenUs > b.mWhenUs
+                    || (a.mWhenUs == b.mWhenUs && a.mSequence > b.mSequence);
+        }
+    };
+
+    // an event posted without delay
+    struct ImmediateEvent {
+        Event mEvent;
+        ImmediateEvent *mNext;
+    };
+
     Mutex mLock;
     Condition mQueueChangedCondition;
 
     AString mName;
 
-    List<Event> mEventQueue;
+    // events posted with a delay, a binary heap ordered by EventLater
+    std::vector<Event> mEventQueue;
+
+    // Events posted without delay are pushed on this stack, newest first, without mLock,
+    // and moved by loop() to mImmediateHead, oldest first.
+    std::atomic<ImmediateEvent *> mImmediateEvents;
+    ImmediateEvent *mImmediateHead;
+    ImmediateEvent *mImmediateTail;
+    // set while loop() waits on mQueueChangedCondition, so that posts without
+    // mLock know that they must signal it
+    std::atomic<bool> mWaiting;
+    std::atomic<uint64_t> mNextSequence;
+
+    // statistics, see debugStats()
+    std::atomic<uint32_t> mQueueDepth;
+    std::atomic<uint32_t> mMaxQueueDepth;
+    uint64_t mDelivered;                // the following are protected by mLock
+    int64_t mTotalLatencyUs;
+    int64_t mMaxLatencyUs;
 
     struct LooperThread;
     sp<LooperThread> mThread;
     bool mRunningLocally;
 
+    // shared executor mode, see setUseSharedExecutor()
+    enum SharedState {
+        kSharedIdle,                    // not queued on the executor
+        kSharedScheduled,               // queued on the executor
+        kSharedRunning,                 // delivering messages on an executor thread
+    };
+    bool mUseSharedExecutor;
+    std::atomic<bool> mRunningShared;
+    std::atomic<int> mSharedState;      // SharedState
+    android_thread_id_t mSharedThreadId; // executor thread while kSharedRunning, under mLock
+    int64_t mSharedTimerUs;             // earliest timer requested from the executor, or -1
+    Condition mSharedIdleCondition;     // signaled when leaving kSharedRunning
+
     // use a separate lock for reply handling, as it is always on another thread
     // use a central lock, however, to avoid creating a mutex for each reply
     Mutex mRepliesLock;
@@ -103,6 +164,18 @@ private:
 
     bool loop();
 
+    void takeImmediateEvents_l();
+    // takes the next event if it is due, otherwise returns the delay until the next
+    // event in delayUs, or -1 if there is none
+    bool takeDueEvent_l(Event *event, int64_t *delayUs);
+
+    // queues the looper on the executor if it is not queued or running
+    void scheduleShared();
+    // called by the executor to deliver due messages
+    void runShared();
+    // called by the executor when a timer requested for whenUs expires
+    void onSharedTimer(int64_t whenUs);
+
     DISALLOW_EVIL_CONSTRUCTORS(ALooper);
 };
 
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef A_LOOPER_EXECUTOR_H_
+
+#define A_LOOPER_EXECUTOR_H_
+
+#include <media/stagefright/foundation/ALooper.h>
+#include <utils/threads.h>
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+namespace android {
+
+// A pool of threads which deliver the messages of the loopers started with
+// ALooper::setUseSharedExecutor(true).
+//
+// A looper with messages to deliver is queued on one thread, preferably the one which
+// made it ready, and runs there until it has no due message or its batch is over.
+// A looper runs on one thread at a time, which keeps its messages in order.
+// Threads with an empty queue steal loopers from the other queues before they sleep.
+struct ALooperExecutor {
+    // the executor of the process, its threads are started on the first call
+    static ALooperExecutor *Get();
+
+    // returns the number of threads and of loopers run and stolen,
+    // or an empty string if there is no executor
+    static AString DebugStats();
+
+private:
+    friend struct ALooper;      // schedule(), scheduleAt()
+
+    struct Worker;
+    struct Timer {
+        int64_t mWhenUs;
+        wp<ALooper> mLooper;
+    };
+    struct TimerLater {
+        bool operator()(const Timer &a, const Timer &b) const {
+            return a.mWhenUs > b.mWhenUs;
+        }
+    };
+
+    explicit ALooperExecutor(size_t numWorkers);
+
+    // queues the looper to run as soon as possible
+    void schedule(const sp<ALooper> &looper);
+    // calls the looper back at whenUs
+    void scheduleAt(const sp<ALooper> &looper, int64_t whenUs);
+
+    // the worker running on the current thread, if any
+    static thread_local Worker *sCurrentWorker;
+
+    sp<ALooper> takeLooper(Worker *self);
+    bool runWorker(Worker *self);
+
+    std::vector<sp<Worker> > mWorkers;
+    std::atomic<uint32_t> mNextWorker;  // for schedule() from outside the executor
+    std::atomic<size_t> mPending;       // loopers queued on all the workers
+    std::atomic<size_t> mIdle;          // workers about to wait or waiting on mWorkAvailable
+
+    Mutex mLock;                        // protects mTimers, and mWorkAvailable waits
+    Condition mWorkAvailable;
+    std::vector<Timer> mTimers;         // a binary heap ordered by TimerLater
+
+    // statistics
+    std::atomic<uint64_t> mRuns;
+    std::atomic<uint64_t> mSteals;
+
+    DISALLOW_EVIL_CONSTRUCTORS(ALooperExecutor);
+};
+
+}  // namespace android
+
+#endif  // A_LOOPER_EXECUTOR_H_
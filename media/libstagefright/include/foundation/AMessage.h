@@ -183,6 +183,11 @@ struct AMessage : public RefBase {
     size_t countEntries() const;
     const char *getEntryNameAt(size_t index, Type *type) const;
 
+    // Messages are allocated from a small free list kept by the thread which released them,
+    // which for most messages is the thread of the looper that delivered them.
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
 protected:
     virtual ~AMessage();
 
@@ -212,18 +217,37 @@ private:
             RefBase *refValue;
             AString *stringValue;
             Rect rectValue;
+            char inlineStringValue[sizeof(Rect)];
         } u;
-        const char *mName;
-        size_t      mNameLength;
+        const char *mName;          // an AAtomizer atom unless kItemNameOwned is set
+        uint32_t    mNameLength;
+        uint32_t    mNameHash;
         Type mType;
-        void setName(const char *name, size_t len);
+        uint8_t     mFlags;
+        uint8_t     mInlineStringLength;    // if kItemStringInline is set
+        void setName(const char *name, size_t len, uint32_t hash, bool intern);
+        void freeName();
+        void setStringValue(const char *s, size_t len);
+        const char *stringValue(size_t *len) const;
     };
 
     enum {
-        kMaxNumItems = 64
+        kMaxNumItems = 64,
+        kIndexSize = 2 * kMaxNumItems,
+        // strings up to this length are stored in the item, with their terminating NUL
+        kMaxInlineStringLength = sizeof(Rect) - 1,
     };
+
+    enum {
+        kItemNameOwned      = 1,    // mName was copied instead of interned
+        kItemStringInline   = 2,    // a kTypeString value is in u.inlineStringValue
+    };
+
     Item mItems[kMaxNumItems];
     size_t mNumItems;
+    // open addressing hash table of the items, by name hash:
+    // 1 + the index in mItems of the item in each slot, 0 for a free slot
+    uint8_t mIndex[kIndexSize];
 
     Item *allocateItem(const char *name);
     void freeItemValue(Item *item);
@@ -232,7 +256,9 @@ private:
     void setObjectInternal(
             const char *name, const sp<RefBase> &obj, Type type);
 
-    size_t findItemIndex(const char *name, size_t len) const;
+    size_t findItemIndex(const char *name, size_t len, uint32_t hash) const;
+    size_t findItemIndex(const char *name) const;
+    void addItemToIndex(size_t i);
 
     void deliver();
 
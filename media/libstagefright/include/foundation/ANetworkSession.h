@@ -25,12 +25,18 @@
 
 #include <netinet/in.h>
 
+#include <vector>
+
 namespace android {
 
 struct AMessage;
 
 // Helper class to manage a number of live sockets (datagram and stream-based)
 // on a single thread. Clients are notified about activity through AMessages.
+//
+// The sockets are registered edge triggered with an epoll instance, so the
+// thread only visits the sessions which became readable or writable, or which
+// have more work left from a previous wakeup.
 struct ANetworkSession : public RefBase {
     ANetworkSession();
 
@@ -103,9 +109,14 @@ private:
     int32_t mNextSessionID;
 
     int mPipeFd[2];
+    int mEpollFd;
 
     KeyedVector<int32_t, sp<Session> > mSessions;
 
+    // IDs of the sessions with more to read or write before the next
+    // notification from epoll.
+    std::vector<int32_t> mReadySessions;
+
     enum Mode {
         kModeCreateUDPSession,
         kModeCreateTCPDatagramSessionPassive,
@@ -125,6 +136,12 @@ private:
     void threadLoop();
     void interrupt();
 
+    void addSession_l(const sp<Session> &session);
+    status_t registerSession_l(const sp<Session> &session);
+    bool markReady_l(const sp<Session> &session);
+    void processSession_l(const sp<Session> &session);
+    void acceptConnections_l(const sp<Session> &server);
+
     static status_t MakeSocketNonBlocking(int s);
 
     DISALLOW_EVIL_CONSTRUCTORS(ANetworkSession);
@@ -93,13 +93,21 @@ struct AString {
     status_t writeToParcel(Parcel *parcel) const;
 
 private:
-    static const char *kEmptyString;
+    // Strings of up to kInlineSize - 1 characters are stored in mInlineData,
+    // longer ones on the heap.
+    enum {
+        kInlineSize = 24,
+    };
 
     char *mData;
     size_t mSize;
     size_t mAllocSize;
+    char mInlineData[kInlineSize];
 
-    void makeMutable();
+    bool isInline() const { return mData == mInlineData; }
+
+    // Makes space for size more characters and the terminating nul.
+    void reserveAdditional(size_t size);
 };
 
 AString AStringPrintf(const char *format, ...);
@@ -35,13 +35,53 @@
 #include <media/stagefright/Utils.h>
 #include <utils/String8.h>
 
+#include <algorithm>
+
 #include <inttypes.h>
 
 namespace android {
 
+// Reads through to the DataSource, except for the clusters that are being
+// played: prefetch() reads those in large chunks, since mkvparser reads every
+// block header and frame on its own.
 struct DataSourceReader : public mkvparser::IMkvReader {
     explicit DataSourceReader(const sp<DataSource> &source)
-        : mSource(source) {
+        : mSource(source),
+          mPrefetch(false),
+          mNextWindow(0) {
+        memset(mWindows, 0, sizeof(mWindows));
+    }
+
+    virtual ~DataSourceReader() {
+        for (size_t i = 0; i < kNumWindows; ++i) {
+            free(mWindows[i].mData);
+        }
+    }
+
+    void setPrefetchEnabled(bool enabled) {
+        mPrefetch = enabled;
+    }
+
+    // Reads the start of the |size| bytes at |position|, and keeps reading
+    // them a window at a time as Read() gets there.
+    void prefetch(long long position, long long size) {
+        if (!mPrefetch || position < 0) {
+            return;
+        }
+        if (size <= 0) {
+            // not known before the cluster is parsed
+            size = kWindowSize;
+        }
+
+        Mutex::Autolock autoLock(mLock);
+        Window *window = findWindow_l(position, 1);
+        if (window == NULL) {
+            window = &mWindows[mNextWindow];
+            mNextWindow = (mNextWindow + 1) % kNumWindows;
+            fill_l(window, position, position + size);
+        } else if (window->mRangeEnd < position + size) {
+            window->mRangeEnd = position + size;
+        }
     }
 
     virtual int Read(long long position, long length, unsigned char* buffer) {
@@ -52,6 +92,27 @@ struct DataSourceReader : public mkvparser::IMkvReader {
             return 0;
         }
 
+        if (mPrefetch) {
+            Mutex::Autolock autoLock(mLock);
+            Window *window = findWindow_l(position, length);
+            if (window == NULL && length <= kWindowSize) {
+                // Slide the window of the prefetched range along.
+                for (size_t i = 0; i < kNumWindows; ++i) {
+                    Window *w = &mWindows[i];
+                    if (w->mSize > 0 && position >= w->mOffset
+                            && position + length <= w->mRangeEnd) {
+                        fill_l(w, position, w->mRangeEnd);
+                        window = findWindow_l(position, length);
+                        break;
+                    }
+                }
+            }
+            if (window != NULL) {
+                memcpy(buffer, window->mData + (position - window->mOffset), length);
+                return 0;
+            }
+        }
+
         ssize_t n = mSource->readAt(position, buffer, length);
 
         if (n <= 0) {
@@ -82,12 +143,66 @@ struct DataSourceReader : public mkvparser::IMkvReader {
     }
 
 private:
+    enum {
+        kWindowSize = 512 * 1024,
+        kNumWindows = 2,  // one per cluster being played, for audio and video
+    };
+
+    struct Window {
+        uint8_t *mData;
+        long long mOffset;
+        long long mSize;
+        long long mRangeEnd;  // of the prefetched range
+    };
+
     sp<DataSource> mSource;
+    bool mPrefetch;
+
+    Mutex mLock;
+    Window mWindows[kNumWindows];
+    size_t mNextWindow;
+
+    Window *findWindow_l(long long position, long length) {
+        for (size_t i = 0; i < kNumWindows; ++i) {
+            Window *window = &mWindows[i];
+            if (position >= window->mOffset
+                    && position + length <= window->mOffset + window->mSize) {
+                return window;
+            }
+        }
+        return NULL;
+    }
+
+    void fill_l(Window *window, long long position, long long rangeEnd) {
+        window->mSize = 0;
+        window->mRangeEnd = 0;
+        if (window->mData == NULL) {
+            window->mData = (uint8_t *)malloc(kWindowSize);
+            if (window->mData == NULL) {
+                return;
+            }
+        }
+
+        ssize_t n = mSource->readAt(
+                position, window->mData, std::min((long long)kWindowSize, rangeEnd - position));
+        if (n > 0) {
+            window->mOffset = position;
+            window->mSize = n;
+            window->mRangeEnd = rangeEnd;
+        }
+    }
 
     DataSourceReader(const DataSourceReader &);
     DataSourceReader &operator=(const DataSourceReader &);
 };
 
+// Starts reading |cluster| ahead of its blocks.
+static void PrefetchCluster(DataSourceReader *reader, const mkvparser::Cluster *cluster) {
+    if (cluster != NULL && !cluster->EOS()) {
+        reader->prefetch(cluster->m_element_start, cluster->GetElementSize());
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 struct BlockIterator {
@@ -115,6 +230,8 @@ private:
     long mBlockEntryIndex;
 
     void advance_l();
+    void seekWithinCluster_l(
+            int64_t seekTimeUs, bool isVideo, bool isAudio, int64_t *actualFrameTimeUs);
 
     BlockIterator(const BlockIterator &);
     BlockIterator &operator=(const BlockIterator &);
@@ -339,6 +456,7 @@ void BlockIterator::advance_l() {
             CHECK(!nextCluster->EOS());
 
             mCluster = nextCluster;
+            PrefetchCluster(mExtractor->mReader, mCluster);
 
             res = mCluster->Parse(pos, len);
             ALOGV("Parse (2) returned %ld", res);
@@ -364,6 +482,7 @@ void BlockIterator::reset() {
     mCluster = mExtractor->mSegment->GetFirst();
     mBlockEntry = NULL;
     mBlockEntryIndex = 0;
+    PrefetchCluster(mExtractor->mReader, mCluster);
 
     do {
         advance_l();
@@ -397,6 +516,7 @@ void BlockIterator::seek(
         ALOGV("Seek to beginning: %" PRId64, seekTimeUs);
         mCluster = pSegment->GetFirst();
         mBlockEntryIndex = 0;
+        PrefetchCluster(mExtractor->mReader, mCluster);
         do {
             advance_l();
         } while (!eos() && block()->GetTrackNumber() != mTrackNum);
@@ -405,6 +525,8 @@ void BlockIterator::seek(
 
     ALOGV("Seeking to: %" PRId64, seekTimeUs);
 
+    const mkvparser::Track *thisTrack = pSegment->GetTracks()->GetTrackByNumber(mTrackNum);
+
     // If the Cues have not been located then find them.
     const mkvparser::Cues* pCues = pSegment->GetCues();
     const mkvparser::SeekHead* pSH = pSegment->GetSeekHead();
@@ -424,14 +546,21 @@ void BlockIterator::seek(
                 break;
             }
         }
+    }
 
-        if (!pCues) {
-            ALOGE("No Cues in file");
+    if (!pCues) {
+        // Index the clusters instead, as far as needed.
+        ALOGV("No Cues in file, seeking by cluster");
+        mExtractor->loadClustersUntil_l(seekTimeNs);
+        mCluster = pSegment->FindCluster(seekTimeNs);
+        if (mCluster == NULL || mCluster->EOS()) {
+            ALOGE("No cluster to seek to");
+            mCluster = NULL;
             return;
         }
-    }
-    else if (!pSH) {
-        ALOGE("No SeekHead");
+        PrefetchCluster(mExtractor->mReader, mCluster);
+        mBlockEntryIndex = 0;
+        seekWithinCluster_l(seekTimeUs, thisTrack->GetType() == 1, isAudio, actualFrameTimeUs);
         return;
     }
 
@@ -458,7 +587,6 @@ void BlockIterator::seek(
     }
 
     const mkvparser::CuePoint::TrackPosition *pTP = NULL;
-    const mkvparser::Track *thisTrack = pTracks->GetTrackByNumber(mTrackNum);
     if (thisTrack->GetType() == 1) { // video
         MatroskaExtractor::TrackInfo& track = mExtractor->mTracks.editItemAt(mIndex);
         pTP = track.find(seekTimeNs);
@@ -485,11 +613,17 @@ void BlockIterator::seek(
 
     CHECK(mCluster);
     CHECK(!mCluster->EOS());
+    PrefetchCluster(mExtractor->mReader, mCluster);
 
     // mBlockEntryIndex starts at 0 but m_block starts at 1
     CHECK_GT(pTP->m_block, 0);
     mBlockEntryIndex = pTP->m_block - 1;
 
+    seekWithinCluster_l(seekTimeUs, thisTrack->GetType() == 1, isAudio, actualFrameTimeUs);
+}
+
+void BlockIterator::seekWithinCluster_l(
+        int64_t seekTimeUs, bool isVideo, bool isAudio, int64_t *actualFrameTimeUs) {
     for (;;) {
         advance_l();
 
@@ -498,7 +632,7 @@ void BlockIterator::seek(
         if (isAudio || block()->IsKey()) {
             // Accept the first key frame
             int64_t frameTimeUs = (block()->GetTime(mCluster) + 500LL) / 1000LL;
-            if (thisTrack->GetType() == 1 || frameTimeUs >= seekTimeUs) {
+            if (isVideo || frameTimeUs >= seekTimeUs) {
                 *actualFrameTimeUs = frameTimeUs;
                 ALOGV("Requested seek point: %" PRId64 " actual: %" PRId64,
                       seekTimeUs, *actualFrameTimeUs);
@@ -815,7 +949,8 @@ MatroskaExtractor::MatroskaExtractor(const sp<DataSource> &source)
       mSegment(NULL),
       mExtractedThumbnails(false),
       mIsWebm(false),
-      mSeekPreRollNs(0) {
+      mSeekPreRollNs(0),
+      mAllClustersLoaded(false) {
     off64_t size;
     mIsLiveStreaming =
         (mDataSource->flags()
@@ -823,6 +958,10 @@ MatroskaExtractor::MatroskaExtractor(const sp<DataSource> &source)
                 | DataSource::kIsCachingDataSource))
         && mDataSource->getSize(&size) != OK;
 
+    // Local files are read ahead by the kernel already.
+    mReader->setPrefetchEnabled(!mIsLiveStreaming
+            && !(mDataSource->flags() & DataSource::kIsLocalFileSource));
+
     mkvparser::EBMLHeader ebmlHeader;
     long long pos;
     if (ebmlHeader.Parse(mReader, pos) < 0) {
@@ -848,6 +987,7 @@ MatroskaExtractor::MatroskaExtractor(const sp<DataSource> &source)
         ret = mSegment->LoadCluster(pos, len);
         if (ret >= 1) {
             // no more clusters
+            mAllClustersLoaded = true;
             ret = 0;
         }
     } else if (ret > 0) {
@@ -880,6 +1020,27 @@ MatroskaExtractor::~MatroskaExtractor() {
     mReader = NULL;
 }
 
+void MatroskaExtractor::loadClustersUntil_l(long long timeNs) {
+    while (!mAllClustersLoaded) {
+        const mkvparser::Cluster *last = mSegment->GetLast();
+        if (last != NULL && !last->EOS() && last->GetTime() > timeNs) {
+            break;
+        }
+
+        long long pos;
+        long len;
+        long res = mSegment->LoadCluster(pos, len);
+        if (res < 0) {
+            ALOGW("LoadCluster returned %ld", res);
+            break;
+        } else if (res >= 1) {
+            // no more clusters
+            mAllClustersLoaded = true;
+        }
+    }
+    ALOGV("%lu clusters loaded", mSegment->GetCount());
+}
+
 size_t MatroskaExtractor::countTracks() {
     return mTracks.size();
 }
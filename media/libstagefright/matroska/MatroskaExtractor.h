@@ -84,6 +84,11 @@ private:
     bool mIsWebm;
     int64_t mSeekPreRollNs;
 
+    // Files without Cues are seeked through the clusters, which mkvparser
+    // keeps in order once loaded. They are only loaded as far as a seek needs.
+    bool mAllClustersLoaded;
+    void loadClustersUntil_l(long long timeNs);
+
     status_t synthesizeAVCC(TrackInfo *trackInfo, size_t index);
     status_t initTrackInfo(const mkvparser::Track *track, const sp<MetaData> &meta, TrackInfo *trackInfo);
     void addTracks();
@@ -103,6 +103,10 @@ struct ATSParser::Program : public RefBase {
         return mFirstPTS;
     }
 
+    const KeyedVector<unsigned, sp<Stream> > &streams() const {
+        return mStreams;
+    }
+
     void updateCasSessions();
 
     void signalNewSampleAesKey(const sp<AMessage> &keyItem);
@@ -206,6 +210,13 @@ private:
     sp<ABuffer> mDescrambledBuffer;
     List<SubSampleInfo> mSubSamples;
     sp<IDescrambler> mDescrambler;
+    // Subsample table passed to the descrambler, reused across PES packets
+    sp<ABuffer> mDescrambleSubSamples;
+
+    // Descrambling throughput, logged when the stream goes away
+    int64_t mDescrambleCount;
+    int64_t mDescrambledBytes;
+    int64_t mDescrambleTimeUs;
 
     // Flush accumulated payload if necessary --- i.e. at EOS or at the start of
     // another payload. event is set if the flushed payload is PES with a sync
@@ -394,6 +405,7 @@ bool ATSParser::Program::switchPIDs(const Vector<StreamInfo> &infos) {
             }
 
             mStreams.clear();
+            mParser->invalidatePIDTable();
             for (i = 0; i < temp.size(); ++i) {
                 // The two checks below shouldn't happen,
                 // we already checked above the stream count matches
@@ -599,6 +611,7 @@ status_t ATSParser::Program::parseProgramMap(ABitReader *br) {
 
             isAddingScrambledStream |= info.mCASystemId >= 0;
             mStreams.add(info.mPID, stream);
+            mParser->invalidatePIDTable();
         }
     }
 
@@ -720,7 +733,10 @@ ATSParser::Stream::Stream(
       mEOSReached(false),
       mPrevPTS(0),
       mQueue(NULL),
-      mScrambled(CA_system_ID >= 0) {
+      mScrambled(CA_system_ID >= 0),
+      mDescrambleCount(0),
+      mDescrambledBytes(0),
+      mDescrambleTimeUs(0) {
 
     mSampleEncrypted =
             mStreamType == STREAMTYPE_H264_ENCRYPTED ||
@@ -803,6 +819,10 @@ ATSParser::Stream::Stream(
 }
 
 ATSParser::Stream::~Stream() {
+    if (mDescrambleCount > 0) {
+        ALOGI("[stream %d] descrambled %" PRId64 " PES (%" PRId64 " bytes) in %" PRId64 " us",
+                mElementaryPID, mDescrambleCount, mDescrambledBytes, mDescrambleTimeUs);
+    }
     delete mQueue;
     mQueue = NULL;
 }
@@ -1365,8 +1385,11 @@ status_t ATSParser::Stream::flushScrambled(SyncEvent *event) {
         memcpy(mDescrambledBuffer->data(), mBuffer->data(), descrambleBytes);
         mDescrambledBuffer->setRange(0, descrambleBytes);
 
-        sp<ABuffer> subSamples = new ABuffer(
-                sizeof(DescramblerPlugin::SubSample) * descrambleSubSamples);
+        size_t subSamplesSize = sizeof(DescramblerPlugin::SubSample) * descrambleSubSamples;
+        if (mDescrambleSubSamples == NULL || mDescrambleSubSamples->capacity() < subSamplesSize) {
+            mDescrambleSubSamples = new ABuffer(subSamplesSize);
+        }
+        sp<ABuffer> subSamples = mDescrambleSubSamples;
 
         DescrambleInfo info;
         info.dstType = DescrambleInfo::kDestinationTypeVmPointer;
@@ -1396,6 +1419,7 @@ status_t ATSParser::Stream::flushScrambled(SyncEvent *event) {
         }
 
         int32_t result;
+        int64_t startUs = ALooper::GetNowUs();
         Status status = mDescrambler->descramble(info, &result);
 
         if (!status.isOk()) {
@@ -1403,9 +1427,24 @@ status_t ATSParser::Stream::flushScrambled(SyncEvent *event) {
                     mElementaryPID, status.exceptionCode());
             return UNKNOWN_ERROR;
         }
+        mDescrambleTimeUs += ALooper::GetNowUs() - startUs;
+        mDescrambleCount++;
+        mDescrambledBytes += descrambleBytes;
 
         ALOGV("[stream %d] descramble succeeded, %d bytes",
                 mElementaryPID, result);
+
+        // If the whole PES was descrambled and the queue doesn't need it back in mBuffer,
+        // parse it straight from the shared memory.
+        if (!mQueue->isScrambled() && (size_t)descrambleBytes == mBuffer->size()) {
+            ABitReader br(mDescrambledBuffer->data(), mDescrambledBuffer->size());
+            status_t err = parsePES(&br, event);
+            if (err != OK) {
+                ALOGE("[stream %d] failed to parse descrambled PES, err=%d",
+                        mElementaryPID, err);
+            }
+            return err;
+        }
         memcpy(mBuffer->data(), mDescrambledBuffer->data(), descrambleBytes);
     }
 
@@ -1615,6 +1654,7 @@ void ATSParser::Stream::setCasInfo(
 
 ATSParser::ATSParser(uint32_t flags)
     : mFlags(flags),
+      mPIDTableValid(false),
       mAbsoluteTimeAnchorUs(-1ll),
       mTimeOffsetValid(false),
       mTimeOffsetUs(0ll),
@@ -1639,6 +1679,47 @@ status_t ATSParser::feedTSPacket(const void *data, size_t size,
     return parseTS(&br, event);
 }
 
+status_t ATSParser::feedTSPackets(const void *data, size_t size, size_t *consumed) {
+    const uint8_t *packet = (const uint8_t *)data;
+    size_t numPackets = size / kTSPacketSize;
+
+    // Find the first packet that lost sync without branching per packet;
+    // parseTS() fails on it.
+    size_t numSynced = 0;
+    while (numSynced < numPackets) {
+        size_t n = numPackets - numSynced;
+        if (n > 16) {
+            n = 16;
+        }
+        unsigned mismatch = 0;
+        for (size_t i = 0; i < n; ++i) {
+            mismatch |= (unsigned)(packet[(numSynced + i) * kTSPacketSize] != 0x47) << i;
+        }
+        if (mismatch != 0) {
+            numSynced += __builtin_ctz(mismatch);
+            break;
+        }
+        numSynced += n;
+    }
+    if (numSynced < numPackets) {
+        ALOGW("lost sync at packet %zu of %zu", numSynced, numPackets);
+    }
+
+    size_t end = (numSynced < numPackets ? numSynced + 1 : numPackets) * kTSPacketSize;
+    size_t offset = 0;
+    status_t err = OK;
+    while (offset < end) {
+        ABitReader br(packet + offset, kTSPacketSize);
+        err = parseTS(&br, NULL /* event */);
+        if (err != OK) {
+            break;
+        }
+        offset += kTSPacketSize;
+    }
+    *consumed = offset;
+    return err;
+}
+
 status_t ATSParser::setMediaCas(const sp<ICas> &cas) {
     status_t err = mCasManager->setMediaCas(cas);
     if (err != OK) {
@@ -1761,6 +1842,7 @@ void ATSParser::parseProgramAssociationTable(ABitReader *br) {
             if (!found) {
                 mPrograms.push(
                         new Program(this, program_number, programMapPID, mLastRecoveredPTS));
+                invalidatePIDTable();
                 if (mSampleAesKeyItem != NULL) {
                     mPrograms.top()->signalNewSampleAesKey(mSampleAesKeyItem);
                 }
@@ -1768,6 +1850,7 @@ void ATSParser::parseProgramAssociationTable(ABitReader *br) {
 
             if (mPSISections.indexOfKey(programMapPID) < 0) {
                 mPSISections.add(programMapPID, new PSISection);
+                invalidatePIDTable();
             }
         }
     }
@@ -1782,7 +1865,21 @@ status_t ATSParser::parsePID(
         unsigned transport_scrambling_control,
         unsigned random_access_indicator,
         SyncEvent *event) {
-    ssize_t sectionIndex = mPSISections.indexOfKey(PID);
+    if (!mPIDTableValid) {
+        updatePIDTable();
+    }
+
+    uint8_t entry = mPIDTable[PID];
+    if (entry != kPIDUnknown && entry != kPIDSection) {
+        return mPIDStreams[entry - 1]->parse(
+                continuity_counter,
+                payload_unit_start_indicator,
+                transport_scrambling_control,
+                random_access_indicator,
+                br, event);
+    }
+
+    ssize_t sectionIndex = entry == kPIDSection ? mPSISections.indexOfKey(PID) : -1;
 
     if (sectionIndex >= 0) {
         sp<PSISection> section = mPSISections.valueAt(sectionIndex);
@@ -1837,6 +1934,7 @@ status_t ATSParser::parsePID(
 
             if (!handled) {
                 mPSISections.removeItem(PID);
+                invalidatePIDTable();
                 section.clear();
             }
         }
@@ -1877,6 +1975,39 @@ status_t ATSParser::parsePID(
     return OK;
 }
 
+void ATSParser::updatePIDTable() {
+    memset(mPIDTable, kPIDUnknown, sizeof(mPIDTable));
+    mPIDStreams.clear();
+
+    // The first program to have a stream on a PID gets its packets, and
+    // sections come before streams, as in parsePID().
+    for (size_t i = mPrograms.size(); i > 0;) {
+        --i;
+        const KeyedVector<unsigned, sp<Stream> > &streams = mPrograms[i]->streams();
+        for (size_t j = 0; j < streams.size(); ++j) {
+            unsigned pid = streams.keyAt(j);
+            if (pid >= kNumPIDs) {
+                continue;
+            }
+            if (mPIDStreams.size() >= kMaxPIDStreams) {
+                // left to the search in parsePID()
+                mPIDTable[pid] = kPIDUnknown;
+                continue;
+            }
+            mPIDStreams.push(streams.valueAt(j).get());
+            mPIDTable[pid] = mPIDStreams.size();
+        }
+    }
+    for (size_t i = 0; i < mPSISections.size(); ++i) {
+        unsigned pid = mPSISections.keyAt(i);
+        if (pid < kNumPIDs) {
+            mPIDTable[pid] = kPIDSection;
+        }
+    }
+
+    mPIDTableValid = true;
+}
+
 status_t ATSParser::parseAdaptationField(
         ABitReader *br, unsigned PID, unsigned *random_access_indicator) {
     *random_access_indicator = 0;
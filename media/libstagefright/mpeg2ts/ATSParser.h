@@ -119,6 +119,14 @@ struct ATSParser : public RefBase {
     status_t feedTSPacket(
             const void *data, size_t size, SyncEvent *event = NULL);
 
+    // Feeds the whole TS packets in |data| into the parser one after the
+    // other, stopping at the first that fails, and sets |*consumed| to the
+    // size of the packets parsed. For callers that have a run of packets
+    // and no use for sync events. The sync bytes of the run are checked up
+    // front, so that a run that lost sync fails before any of it is parsed
+    // past the last good packet.
+    status_t feedTSPackets(const void *data, size_t size, size_t *consumed);
+
     void signalDiscontinuity(
             DiscontinuityType type, const sp<AMessage> &extra);
 
@@ -180,6 +188,22 @@ private:
     // Keyed by PID
     KeyedVector<unsigned, sp<PSISection> > mPSISections;
 
+    enum {
+        kNumPIDs = 1 << 13,
+        // mPIDTable entries other than these are indices into mPIDStreams
+        // plus one.
+        kPIDUnknown = 0,
+        kPIDSection = 0xff,
+        kMaxPIDStreams = kPIDSection - 1,
+    };
+
+    // Where each PID goes, so that packets are dispatched without searching
+    // mPSISections and the streams of each program. Rebuilt on the next
+    // packet after a program, stream or section is added or removed.
+    bool mPIDTableValid;
+    uint8_t mPIDTable[kNumPIDs];
+    Vector<Stream *> mPIDStreams;
+
     int64_t mAbsoluteTimeAnchorUs;
 
     bool mTimeOffsetValid;
@@ -216,6 +240,9 @@ private:
     // see feedTSPacket().
     status_t parseTS(ABitReader *br, SyncEvent *event);
 
+    void invalidatePIDTable() { mPIDTableValid = false; }
+    void updatePIDTable();
+
     void updatePCR(unsigned PID, uint64_t PCR, uint64_t byteOffsetFromStart);
 
     uint64_t mPCR[2];
@@ -10,6 +10,7 @@ LOCAL_SRC_FILES:=                 \
         HlsSampleDecryptor.cpp    \
         MPEG2PSExtractor.cpp      \
         MPEG2TSExtractor.cpp      \
+        MPEG2TSSeekIndex.cpp      \
 
 LOCAL_C_INCLUDES:= \
 	$(TOP)/frameworks/av/media/libstagefright \
@@ -45,8 +45,10 @@ AnotherPacketSource::AnotherPacketSource(const sp<MetaData> &meta)
       mFormat(NULL),
       mLastQueuedTimeUs(0),
       mEstimatedBufferDurationUs(-1),
+      mBufferedBytes(0),
       mEOSResult(OK),
       mLatestEnqueuedMeta(NULL),
+      mLatestEnqueuedDurationUs(-1),
       mLatestDequeuedMeta(NULL) {
     setFormat(meta);
 
@@ -124,6 +126,7 @@ status_t AnotherPacketSource::dequeueAccessUnit(sp<ABuffer> *buffer) {
     if (!mBuffers.empty()) {
         *buffer = *mBuffers.begin();
         mBuffers.erase(mBuffers.begin());
+        mBufferedBytes -= (*buffer)->size();
 
         int32_t discontinuity;
         if ((*buffer)->meta()->findInt32("discontinuity", &discontinuity)) {
@@ -140,7 +143,7 @@ status_t AnotherPacketSource::dequeueAccessUnit(sp<ABuffer> *buffer) {
         DiscontinuitySegment &seg = *mDiscontinuitySegments.begin();
 
         int64_t timeUs;
-        mLatestDequeuedMeta = (*buffer)->meta()->dup();
+        mLatestDequeuedMeta = (*buffer)->meta();
         CHECK(mLatestDequeuedMeta->findInt64("timeUs", &timeUs));
         if (timeUs > seg.mMaxDequeTimeUs) {
             seg.mMaxDequeTimeUs = timeUs;
@@ -161,6 +164,7 @@ void AnotherPacketSource::requeueAccessUnit(const sp<ABuffer> &buffer) {
     // TODO: update corresponding book keeping info.
     Mutex::Autolock autoLock(mLock);
     mBuffers.push_front(buffer);
+    mBufferedBytes += buffer->size();
 }
 
 status_t AnotherPacketSource::read(
@@ -176,6 +180,7 @@ status_t AnotherPacketSource::read(
 
         const sp<ABuffer> buffer = *mBuffers.begin();
         mBuffers.erase(mBuffers.begin());
+        mBufferedBytes -= buffer->size();
 
         int32_t discontinuity;
         if (buffer->meta()->findInt32("discontinuity", &discontinuity)) {
@@ -188,7 +193,7 @@ status_t AnotherPacketSource::read(
             return INFO_DISCONTINUITY;
         }
 
-        mLatestDequeuedMeta = buffer->meta()->dup();
+        mLatestDequeuedMeta = buffer->meta();
 
         sp<RefBase> object;
         if (buffer->meta()->findObject("format", &object)) {
@@ -280,6 +285,7 @@ void AnotherPacketSource::queueAccessUnit(const sp<ABuffer> &buffer) {
 
     Mutex::Autolock autoLock(mLock);
     mBuffers.push_back(buffer);
+    mBufferedBytes += buffer->size();
     mCondition.signal();
 
     int32_t discontinuity;
@@ -310,19 +316,19 @@ void AnotherPacketSource::queueAccessUnit(const sp<ABuffer> &buffer) {
     }
 
     if (mLatestEnqueuedMeta == NULL) {
-        mLatestEnqueuedMeta = buffer->meta()->dup();
+        mLatestEnqueuedMeta = buffer->meta();
+        mLatestEnqueuedDurationUs = -1;
     } else {
         int64_t latestTimeUs = 0;
         int64_t frameDeltaUs = 0;
         CHECK(mLatestEnqueuedMeta->findInt64("timeUs", &latestTimeUs));
         if (lastQueuedTimeUs > latestTimeUs) {
-            mLatestEnqueuedMeta = buffer->meta()->dup();
-            frameDeltaUs = lastQueuedTimeUs - latestTimeUs;
-            mLatestEnqueuedMeta->setInt64("durationUs", frameDeltaUs);
-        } else if (!mLatestEnqueuedMeta->findInt64("durationUs", &frameDeltaUs)) {
+            mLatestEnqueuedMeta = buffer->meta();
+            mLatestEnqueuedDurationUs = lastQueuedTimeUs - latestTimeUs;
+        } else if (mLatestEnqueuedDurationUs < 0
+                && !mLatestEnqueuedMeta->findInt64("durationUs", &frameDeltaUs)) {
             // For B frames
-            frameDeltaUs = latestTimeUs - lastQueuedTimeUs;
-            mLatestEnqueuedMeta->setInt64("durationUs", frameDeltaUs);
+            mLatestEnqueuedDurationUs = latestTimeUs - lastQueuedTimeUs;
         }
     }
 }
@@ -331,6 +337,7 @@ void AnotherPacketSource::clear() {
     Mutex::Autolock autoLock(mLock);
 
     mBuffers.clear();
+    mBufferedBytes = 0;
     mEOSResult = OK;
 
     mDiscontinuitySegments.clear();
@@ -357,6 +364,7 @@ void AnotherPacketSource::queueDiscontinuity(
             int32_t oldDiscontinuityType;
             if (!oldBuffer->meta()->findInt32(
                         "discontinuity", &oldDiscontinuityType)) {
+                mBufferedBytes -= oldBuffer->size();
                 it = mBuffers.erase(it);
                 continue;
             }
@@ -462,6 +470,11 @@ int64_t AnotherPacketSource::getBufferedDurationUs(status_t *finalResult) {
     return durationUs;
 }
 
+size_t AnotherPacketSource::getBufferedBytes() {
+    Mutex::Autolock autoLock(mLock);
+    return mBufferedBytes;
+}
+
 int64_t AnotherPacketSource::getEstimatedBufferDurationUs() {
     Mutex::Autolock autoLock(mLock);
     if (mEstimatedBufferDurationUs >= 0) {
@@ -515,12 +528,22 @@ bool AnotherPacketSource::isFinished(int64_t duration) const {
 
 sp<AMessage> AnotherPacketSource::getLatestEnqueuedMeta() {
     Mutex::Autolock autoLock(mLock);
-    return mLatestEnqueuedMeta;
+    if (mLatestEnqueuedMeta == NULL) {
+        return NULL;
+    }
+    sp<AMessage> meta = mLatestEnqueuedMeta->dup();
+    if (mLatestEnqueuedDurationUs >= 0) {
+        meta->setInt64("durationUs", mLatestEnqueuedDurationUs);
+    }
+    return meta;
 }
 
 sp<AMessage> AnotherPacketSource::getLatestDequeuedMeta() {
     Mutex::Autolock autoLock(mLock);
-    return mLatestDequeuedMeta;
+    if (mLatestDequeuedMeta == NULL) {
+        return NULL;
+    }
+    return mLatestDequeuedMeta->dup();
 }
 
 void AnotherPacketSource::enable(bool enable) {
@@ -606,8 +629,12 @@ void AnotherPacketSource::trimBuffersAfterMeta(
         newLastQueuedTimeUs = curTime.mTimeUs;
     }
 
+    for (List<sp<ABuffer> >::iterator it3 = it; it3 != mBuffers.end(); ++it3) {
+        mBufferedBytes -= (*it3)->size();
+    }
     mBuffers.erase(it, mBuffers.end());
     mLatestEnqueuedMeta = newLatestEnqueuedMeta;
+    mLatestEnqueuedDurationUs = -1;
     mLastQueuedTimeUs = newLastQueuedTimeUs;
 
     DiscontinuitySegment &seg = *it2;
@@ -676,6 +703,9 @@ sp<AMessage> AnotherPacketSource::trimBuffersBeforeMeta(
             break;
         }
     }
+    for (List<sp<ABuffer> >::iterator it2 = mBuffers.begin(); it2 != it; ++it2) {
+        mBufferedBytes -= (*it2)->size();
+    }
     mBuffers.erase(mBuffers.begin(), it);
     mLatestDequeuedMeta = NULL;
 
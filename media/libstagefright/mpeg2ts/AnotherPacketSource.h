@@ -60,6 +60,9 @@ struct AnotherPacketSource : public MediaSource {
     // Returns the difference between the two largest timestamps queued
     int64_t getEstimatedBufferDurationUs();
 
+    // Returns the total size of the queued access units.
+    size_t getBufferedBytes();
+
     status_t nextBufferTime(int64_t *timeUs);
 
     void queueAccessUnit(const sp<ABuffer> &buffer);
@@ -118,8 +121,13 @@ private:
     int64_t mLastQueuedTimeUs;
     int64_t mEstimatedBufferDurationUs;
     List<sp<ABuffer> > mBuffers;
+    size_t mBufferedBytes;
     status_t mEOSResult;
+
+    // The metas of the latest access units, shared with them rather than
+    // copied for every access unit; the getters return copies.
     sp<AMessage> mLatestEnqueuedMeta;
+    int64_t mLatestEnqueuedDurationUs;
     sp<AMessage> mLatestDequeuedMeta;
 
     bool wasFormatChange(int32_t discontinuityType) const;
@@ -122,6 +122,10 @@ private:
     sp<ABuffer> dequeueAccessUnitPCMAudio();
     sp<ABuffer> dequeueAccessUnitMetadata();
 
+    // drops the first "size" bytes of mBuffer. The data that remains is not
+    // moved; appendData() reclaims the space once it runs out of room.
+    void consumeBuffer(size_t size);
+
     // consume a logical (compressed) access unit of size "size",
     // returns its timestamp in us (or -1 if no time information).
     int64_t fetchTimestamp(size_t size,
@@ -106,33 +106,38 @@ size_t HlsSampleDecryptor::processNal(uint8_t *nalData, size_t nalSize) {
         //    }
         //}
 
+        // The encrypted blocks start every 10 blocks after the leader and form a single CBC
+        // chain, so gather them, decrypt them with one call and scatter them back.
+        const size_t patternSize = 10 * AES_BLOCK_SIZE;
+        size_t encryptedBytes = 0;
+        for (size_t offset = VIDEO_CLEAR_LEAD; offset + AES_BLOCK_SIZE < nalSize;
+                offset += patternSize) {
+            encryptedBytes += AES_BLOCK_SIZE;
+        }
+        if (mEncryptedBlocks.size() < encryptedBytes) {
+            mEncryptedBlocks.resize(encryptedBytes);
+        }
+        uint8_t *blocks = mEncryptedBlocks.editArray();
+
         size_t offset = VIDEO_CLEAR_LEAD;
-        size_t remainingBytes = nalSize - VIDEO_CLEAR_LEAD;
+        for (size_t i = 0; i < encryptedBytes; i += AES_BLOCK_SIZE, offset += patternSize) {
+            memcpy(blocks + i, nalData + offset, AES_BLOCK_SIZE);
+        }
 
         // a copy of initVec as decryptBlock updates it
         unsigned char AESInitVec[AES_BLOCK_SIZE];
         memcpy(AESInitVec, mAESInitVec, AES_BLOCK_SIZE);
 
-        while (remainingBytes > 0) {
-            // encrypted_block: protected block uses 10% skip encryption
-            if (remainingBytes > AES_BLOCK_SIZE) {
-                uint8_t *encrypted = nalData + offset;
-                status_t ret = decryptBlock(encrypted, AES_BLOCK_SIZE, AESInitVec);
-                if (ret != OK) {
-                    ALOGE("processNal failed with %d", ret);
-                    return nalSize; // revisit this
-                }
-
-                offset += AES_BLOCK_SIZE;
-                remainingBytes -= AES_BLOCK_SIZE;
-            }
-
-            // unencrypted_block
-            size_t clearBytes = std::min(remainingBytes, (size_t)(9 * AES_BLOCK_SIZE));
+        status_t ret = decryptBlock(blocks, encryptedBytes, AESInitVec);
+        if (ret != OK) {
+            ALOGE("processNal failed with %d", ret);
+            return nalSize; // revisit this
+        }
 
-            offset += clearBytes;
-            remainingBytes -= clearBytes;
-        } // while
+        offset = VIDEO_CLEAR_LEAD;
+        for (size_t i = 0; i < encryptedBytes; i += AES_BLOCK_SIZE, offset += patternSize) {
+            memcpy(nalData + offset, blocks + i, AES_BLOCK_SIZE);
+        }
 
     } else { // isEncrypted == false
         ALOGV("processNal[%d]: Unencrypted NALU  (%p)/%zu", nalType, nalData, nalSize);
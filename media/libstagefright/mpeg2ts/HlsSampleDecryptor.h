@@ -55,6 +55,10 @@ private:
     uint8_t mAESInitVec[AES_BLOCK_SIZE];
     bool mValidKeyInfo;
 
+    // Encrypted blocks of the NAL unit being decrypted, gathered so that they can be
+    // decrypted in one call
+    Vector<uint8_t> mEncryptedBlocks;
+
     DISALLOW_EVIL_CONSTRUCTORS(HlsSampleDecryptor);
 };
 
@@ -23,6 +23,7 @@
 #include "include/MPEG2TSExtractor.h"
 #include "include/NuCachedSource2.h"
 
+#include <cutils/properties.h>
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/ALooper.h>
@@ -37,6 +38,7 @@
 
 #include "AnotherPacketSource.h"
 #include "ATSParser.h"
+#include "MPEG2TSSeekIndex.h"
 
 namespace android {
 
@@ -116,6 +118,7 @@ MPEG2TSExtractor::MPEG2TSExtractor(const sp<DataSource> &source)
     : mDataSource(source),
       mParser(new ATSParser),
       mLastSyncEvent(0),
+      mSeekSyncPoints(NULL),
       mOffset(0) {
     init();
 }
@@ -305,6 +308,17 @@ void MPEG2TSExtractor::init() {
         }
     }
 
+    if (mSeekIndex == NULL && mSeekSyncPoints != NULL
+            && (mDataSource->flags() & DataSource::kIsLocalFileSource)
+            && property_get_bool("media.stagefright.ts.seek-index", false)) {
+        // Index the sync points of the seek track in the background, which
+        // reads the whole file, hence only for local files.
+        char dir[PROPERTY_VALUE_MAX];
+        property_get("media.stagefright.ts.seek-index-dir", dir, "");
+        mSeekIndex = MPEG2TSSeekIndex::Create(
+                mDataSource, haveVideo ? ATSParser::VIDEO : ATSParser::AUDIO, dir);
+    }
+
     ALOGI("haveAudio=%d, haveVideo=%d, elaspedTime=%" PRId64,
             haveAudio, haveVideo, ALooper::GetNowUs() - startTime);
 }
@@ -472,53 +486,37 @@ status_t MPEG2TSExtractor::seek(int64_t seekTimeUs,
         return OK;
     }
 
-    // Determine whether we're seeking beyond the known area.
-    bool shouldSeekBeyond =
-            (seekTimeUs > mSeekSyncPoints->keyAt(mSeekSyncPoints->size() - 1));
-
-    // Determine the sync point to seek.
-    size_t index = 0;
-    for (; index < mSeekSyncPoints->size(); ++index) {
-        int64_t timeUs = mSeekSyncPoints->keyAt(index);
-        if (timeUs > seekTimeUs) {
-            break;
-        }
-    }
-
-    switch (seekMode) {
-        case MediaSource::ReadOptions::SEEK_NEXT_SYNC:
-            if (index == mSeekSyncPoints->size()) {
-                ALOGW("Next sync not found; starting from the latest sync.");
-                --index;
-            }
-            break;
-        case MediaSource::ReadOptions::SEEK_CLOSEST_SYNC:
-        case MediaSource::ReadOptions::SEEK_CLOSEST:
-            ALOGW("seekMode not supported: %d; falling back to PREVIOUS_SYNC",
-                    seekMode);
-            // fall-through
-        case MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC:
-            if (index == 0) {
-                ALOGW("Previous sync not found; starting from the earliest "
-                        "sync.");
-            } else {
-                --index;
-            }
-            break;
-    }
-    if (!shouldSeekBeyond || mOffset <= mSeekSyncPoints->valueAt(index)) {
-        int64_t actualSeekTimeUs = mSeekSyncPoints->keyAt(index);
-        mOffset = mSeekSyncPoints->valueAt(index);
-        status_t err = queueDiscontinuityForSeek(actualSeekTimeUs);
+    int64_t indexedTimeUs;
+    off64_t indexedOffset;
+    if (mSeekIndex != NULL && mSeekIndex->findSyncPoint(
+            seekTimeUs, seekMode, &indexedTimeUs, &indexedOffset)) {
+        // Go straight to the sync point, however far it is.
+        mOffset = indexedOffset;
+        status_t err = queueDiscontinuityForSeek(indexedTimeUs);
         if (err != OK) {
             return err;
         }
-    }
+    } else {
+        // Determine the sync point to seek, and whether we're seeking
+        // beyond the known area.
+        bool shouldSeekBeyond;
+        size_t index = MPEG2TSSeekIndex::SelectSyncPoint(
+                *mSeekSyncPoints, seekTimeUs, seekMode, &shouldSeekBeyond);
+
+        if (!shouldSeekBeyond || mOffset <= mSeekSyncPoints->valueAt(index)) {
+            int64_t actualSeekTimeUs = mSeekSyncPoints->keyAt(index);
+            mOffset = mSeekSyncPoints->valueAt(index);
+            status_t err = queueDiscontinuityForSeek(actualSeekTimeUs);
+            if (err != OK) {
+                return err;
+            }
+        }
 
-    if (shouldSeekBeyond) {
-        status_t err = seekBeyond(seekTimeUs);
-        if (err != OK) {
-            return err;
+        if (shouldSeekBeyond) {
+            status_t err = seekBeyond(seekTimeUs);
+            if (err != OK) {
+                return err;
+            }
         }
     }
 
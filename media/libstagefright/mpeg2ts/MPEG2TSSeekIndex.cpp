@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "MPEG2TSSeekIndex"
+#include <utils/Log.h>
+
+#include "MPEG2TSSeekIndex.h"
+
+#include "AnotherPacketSource.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/DataSource.h>
+#include <utils/String8.h>
+
+namespace android {
+
+static const size_t kTSPacketSize = 188;
+static const uint32_t kIndexMagic = 0x54534931;  // 'TSI1'
+
+// static
+sp<MPEG2TSSeekIndex> MPEG2TSSeekIndex::Create(
+        const sp<DataSource> &source, ATSParser::SourceType type, const char *dir) {
+    off64_t size;
+    if (source->getSize(&size) != OK || size <= 0) {
+        return NULL;
+    }
+
+    AString path;
+    String8 name = source->toString();
+    if (dir != NULL && *dir != '\0' && !name.isEmpty()) {
+        // FNV-1a of the name of the file
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < name.length(); ++i) {
+            hash = (hash ^ (uint8_t)name.string()[i]) * 0x100000001b3ull;
+        }
+        path = AStringPrintf("%s/%016" PRIx64 ".tsidx", dir, hash);
+    }
+
+    sp<MPEG2TSSeekIndex> index = new (std::nothrow) MPEG2TSSeekIndex(
+            source, type, size, path.empty() ? NULL : path.c_str());
+    if (index == NULL) {
+        ALOGW("Couldn't allocate MPEG2TSSeekIndex");
+        return NULL;
+    }
+
+    if (index->load()) {
+        return index;
+    }
+    if (index->start() != OK) {
+        return NULL;
+    }
+    return index;
+}
+
+MPEG2TSSeekIndex::MPEG2TSSeekIndex(
+        const sp<DataSource> &source, ATSParser::SourceType type,
+        off64_t size, const char *path)
+    : mSource(source),
+      mType(type),
+      mSize(size),
+      mPath(path != NULL ? path : ""),
+      mThreadStarted(false),
+      mAbort(false),
+      mComplete(false) {
+}
+
+MPEG2TSSeekIndex::~MPEG2TSSeekIndex() {
+    if (mThreadStarted) {
+        mAbort = true;
+        void *dummy;
+        pthread_join(mThread, &dummy);
+        mThreadStarted = false;
+    }
+}
+
+status_t MPEG2TSSeekIndex::start() {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    mThreadStarted = pthread_create(&mThread, &attr, ThreadWrapper, this) == 0;
+    pthread_attr_destroy(&attr);
+
+    return mThreadStarted ? OK : UNKNOWN_ERROR;
+}
+
+bool MPEG2TSSeekIndex::load() {
+    if (mPath.empty()) {
+        return false;
+    }
+
+    FILE *file = fopen(mPath.c_str(), "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    uint32_t magic, type, count;
+    int64_t size;
+    bool ok = fread(&magic, sizeof(magic), 1, file) == 1
+            && fread(&type, sizeof(type), 1, file) == 1
+            && fread(&size, sizeof(size), 1, file) == 1
+            && fread(&count, sizeof(count), 1, file) == 1
+            && magic == kIndexMagic && type == (uint32_t)mType && size == mSize;
+
+    KeyedVector<int64_t, off64_t> syncPoints;
+    for (uint32_t i = 0; ok && i < count; ++i) {
+        int64_t timeUs, offset;
+        ok = fread(&timeUs, sizeof(timeUs), 1, file) == 1
+                && fread(&offset, sizeof(offset), 1, file) == 1
+                && offset >= 0 && offset < mSize;
+        if (ok) {
+            syncPoints.add(timeUs, offset);
+        }
+    }
+    fclose(file);
+
+    if (!ok || syncPoints.isEmpty()) {
+        ALOGW("ignoring stale or corrupt index %s", mPath.c_str());
+        return false;
+    }
+
+    ALOGV("loaded %zu sync points from %s", syncPoints.size(), mPath.c_str());
+
+    Mutex::Autolock autoLock(mLock);
+    mSyncPoints = syncPoints;
+    mComplete = true;
+    return true;
+}
+
+void MPEG2TSSeekIndex::save() {
+    if (mPath.empty()) {
+        return;
+    }
+
+    KeyedVector<int64_t, off64_t> syncPoints;
+    {
+        Mutex::Autolock autoLock(mLock);
+        syncPoints = mSyncPoints;
+    }
+
+    // Written under another name first, so that a session that reads the
+    // index never sees it half written.
+    AString tmpPath = AStringPrintf("%s.tmp", mPath.c_str());
+    FILE *file = fopen(tmpPath.c_str(), "wb");
+    if (file == NULL) {
+        ALOGW("cannot write index %s", tmpPath.c_str());
+        return;
+    }
+
+    uint32_t magic = kIndexMagic;
+    uint32_t type = mType;
+    int64_t size = mSize;
+    uint32_t count = syncPoints.size();
+    bool ok = fwrite(&magic, sizeof(magic), 1, file) == 1
+            && fwrite(&type, sizeof(type), 1, file) == 1
+            && fwrite(&size, sizeof(size), 1, file) == 1
+            && fwrite(&count, sizeof(count), 1, file) == 1;
+    for (size_t i = 0; ok && i < syncPoints.size(); ++i) {
+        int64_t timeUs = syncPoints.keyAt(i);
+        int64_t offset = syncPoints.valueAt(i);
+        ok = fwrite(&timeUs, sizeof(timeUs), 1, file) == 1
+                && fwrite(&offset, sizeof(offset), 1, file) == 1;
+    }
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok || rename(tmpPath.c_str(), mPath.c_str()) != 0) {
+        ALOGW("cannot write index %s", mPath.c_str());
+        unlink(tmpPath.c_str());
+    }
+}
+
+// static
+void *MPEG2TSSeekIndex::ThreadWrapper(void *me) {
+    static_cast<MPEG2TSSeekIndex *>(me)->threadFunc();
+    return NULL;
+}
+
+void MPEG2TSSeekIndex::threadFunc() {
+    prctl(PR_SET_NAME, (unsigned long)"MPEG2TSIndex", 0, 0, 0);
+
+    uint8_t *block = (uint8_t *)malloc(kBlockSize);
+    if (block == NULL) {
+        return;
+    }
+
+    int64_t startUs = ALooper::GetNowUs();
+    sp<ATSParser> parser = new ATSParser;
+    off64_t offset = 0;
+    bool eos = false;
+    while (!mAbort) {
+        ssize_t n = mSource->readAt(offset, block, kBlockSize);
+        if (n < (ssize_t)kTSPacketSize) {
+            eos = (n >= 0);
+            break;
+        }
+
+        status_t err = OK;
+        size_t i = 0;
+        for (; i + kTSPacketSize <= (size_t)n; i += kTSPacketSize) {
+            ATSParser::SyncEvent event(offset + i);
+            err = parser->feedTSPacket(block + i, kTSPacketSize, &event);
+            if (event.hasReturnedData() && event.getType() == mType) {
+                Mutex::Autolock autoLock(mLock);
+                mSyncPoints.add(event.getTimeUs(), event.getOffset());
+            }
+            if (err != OK) {
+                break;
+            }
+        }
+        if (err != OK) {
+            ALOGW("stopped indexing at %lld: %d", (long long)(offset + i), err);
+            break;
+        }
+        offset += i;
+
+        // Only the sync events are of use; drop the access units.
+        for (int type = 0; type < ATSParser::NUM_SOURCE_TYPES; ++type) {
+            sp<AnotherPacketSource> source = static_cast<AnotherPacketSource *>(
+                    parser->getSource((ATSParser::SourceType)type).get());
+            if (source == NULL) {
+                continue;
+            }
+            status_t finalResult;
+            sp<ABuffer> accessUnit;
+            while (source->hasBufferAvailable(&finalResult)) {
+                source->dequeueAccessUnit(&accessUnit);
+            }
+        }
+    }
+
+    free(block);
+
+    size_t numSyncPoints;
+    {
+        Mutex::Autolock autoLock(mLock);
+        mComplete = eos && !mAbort;
+        numSyncPoints = mSyncPoints.size();
+    }
+
+    ALOGV("indexed %zu sync points in %lld bytes, took %" PRId64 " us",
+            numSyncPoints, (long long)offset, ALooper::GetNowUs() - startUs);
+
+    if (eos && !mAbort && numSyncPoints > 0) {
+        save();
+    }
+}
+
+bool MPEG2TSSeekIndex::findSyncPoint(
+        int64_t seekTimeUs, MediaSource::ReadOptions::SeekMode mode,
+        int64_t *syncTimeUs, off64_t *offset) {
+    Mutex::Autolock autoLock(mLock);
+    if (mSyncPoints.isEmpty()) {
+        return false;
+    }
+
+    bool beyond;
+    size_t index = SelectSyncPoint(mSyncPoints, seekTimeUs, mode, &beyond);
+    if (beyond && !mComplete) {
+        // A closer sync point may be yet to be indexed.
+        return false;
+    }
+
+    *syncTimeUs = mSyncPoints.keyAt(index);
+    *offset = mSyncPoints.valueAt(index);
+    return true;
+}
+
+// static
+size_t MPEG2TSSeekIndex::SelectSyncPoint(
+        const KeyedVector<int64_t, off64_t> &syncPoints,
+        int64_t seekTimeUs, MediaSource::ReadOptions::SeekMode mode,
+        bool *beyond) {
+    *beyond = seekTimeUs > syncPoints.keyAt(syncPoints.size() - 1);
+
+    // the first sync point after |seekTimeUs|
+    size_t lo = 0;
+    size_t hi = syncPoints.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (syncPoints.keyAt(mid) > seekTimeUs) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    size_t index = lo;
+
+    switch (mode) {
+        case MediaSource::ReadOptions::SEEK_NEXT_SYNC:
+            if (index == syncPoints.size()) {
+                ALOGW("Next sync not found; starting from the latest sync.");
+                --index;
+            }
+            break;
+        case MediaSource::ReadOptions::SEEK_CLOSEST_SYNC:
+        case MediaSource::ReadOptions::SEEK_CLOSEST:
+            ALOGW("seekMode not supported: %d; falling back to PREVIOUS_SYNC",
+                    mode);
+            // fall-through
+        case MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC:
+            if (index == 0) {
+                ALOGW("Previous sync not found; starting from the earliest "
+                        "sync.");
+            } else {
+                --index;
+            }
+            break;
+    }
+    return index;
+}
+
+}  // namespace android
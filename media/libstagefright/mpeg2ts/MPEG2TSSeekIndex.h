@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MPEG2_TS_SEEK_INDEX_H_
+
+#define MPEG2_TS_SEEK_INDEX_H_
+
+#include <atomic>
+
+#include <pthread.h>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <media/stagefright/MediaSource.h>
+#include <utils/KeyedVector.h>
+#include <utils/threads.h>
+
+#include "ATSParser.h"
+
+namespace android {
+
+class DataSource;
+
+// Indexes the sync points of one type of stream of a local transport
+// stream. A thread of its own parses the file from the start with an
+// ATSParser of its own, which sees the same first PTS and so yields the
+// same times as the extractor's parser, and records the time and the offset
+// of every sync frame. Seeks within the part indexed so far go straight to
+// the sync point instead of feeding packets from the last one known on.
+//
+// If |dir| is given, a complete index is saved there, keyed by the name and
+// the size of the file, and loaded instead of being built again by later
+// sessions.
+struct MPEG2TSSeekIndex : public RefBase {
+    static sp<MPEG2TSSeekIndex> Create(
+            const sp<DataSource> &source, ATSParser::SourceType type, const char *dir);
+
+    // Sets |*syncTimeUs| and |*offset| to the sync point to seek to for
+    // |seekTimeUs| and |mode|, as MPEG2TSExtractor::seek() picks it. Returns
+    // false if the sync point is beyond the indexed part.
+    bool findSyncPoint(
+            int64_t seekTimeUs, MediaSource::ReadOptions::SeekMode mode,
+            int64_t *syncTimeUs, off64_t *offset);
+
+    // Returns the index of the sync point to seek to in |syncPoints|, which
+    // must not be empty, and sets |*beyond| if |seekTimeUs| is past them all.
+    static size_t SelectSyncPoint(
+            const KeyedVector<int64_t, off64_t> &syncPoints,
+            int64_t seekTimeUs, MediaSource::ReadOptions::SeekMode mode,
+            bool *beyond);
+
+protected:
+    virtual ~MPEG2TSSeekIndex();
+
+private:
+    enum {
+        kBlockSize = 188 * 1024,
+    };
+
+    sp<DataSource> mSource;
+    ATSParser::SourceType mType;
+    off64_t mSize;
+    AString mPath;
+
+    pthread_t mThread;
+    bool mThreadStarted;
+    std::atomic<bool> mAbort;
+
+    Mutex mLock;
+    KeyedVector<int64_t, off64_t> mSyncPoints;
+    bool mComplete;
+
+    MPEG2TSSeekIndex(
+            const sp<DataSource> &source, ATSParser::SourceType type,
+            off64_t size, const char *path);
+
+    status_t start();
+    bool load();
+    void save();
+
+    static void *ThreadWrapper(void *me);
+    void threadFunc();
+
+    DISALLOW_EVIL_CONSTRUCTORS(MPEG2TSSeekIndex);
+};
+
+}  // namespace android
+
+#endif  // MPEG2_TS_SEEK_INDEX_H_
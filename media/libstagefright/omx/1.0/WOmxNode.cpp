@@ -188,6 +188,11 @@ status_t LWOmxNode::fillBuffer(
     if (!wrapAs(&codecBuffer, omxBuffer)) {
         return BAD_VALUE;
     }
+    if (fenceFd < 0) {
+        // A null handle reads as no fence on the other side, and costs
+        // neither an allocation nor a handle in the transaction.
+        return toStatusT(mBase->fillBuffer(buffer, codecBuffer, hidl_handle()));
+    }
     native_handle_t* fenceNh = native_handle_create_from_fd(fenceFd);
     if (!fenceNh) {
         return NO_MEMORY;
@@ -206,6 +211,14 @@ status_t LWOmxNode::emptyBuffer(
     if (!wrapAs(&codecBuffer, omxBuffer)) {
         return BAD_VALUE;
     }
+    if (fenceFd < 0) {
+        return toStatusT(mBase->emptyBuffer(
+                buffer,
+                codecBuffer,
+                flags,
+                toRawTicks(timestamp),
+                hidl_handle()));
+    }
     native_handle_t* fenceNh = native_handle_create_from_fd(fenceFd);
     if (!fenceNh) {
         return NO_MEMORY;
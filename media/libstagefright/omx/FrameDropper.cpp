@@ -55,7 +55,7 @@ bool FrameDropper::shouldDrop(int64_t timeUs) {
         return false;
     }
 
-    if (timeUs < (mDesiredMinTimeUs - kMaxJitterUs)) {
+    if (wouldDrop(timeUs)) {
         ALOGV("drop frame %lld, desired frame %lld, diff %lld",
                 (long long)timeUs, (long long)mDesiredMinTimeUs,
                 (long long)(mDesiredMinTimeUs - timeUs));
@@ -70,4 +70,9 @@ bool FrameDropper::shouldDrop(int64_t timeUs) {
     return false;
 }
 
+bool FrameDropper::wouldDrop(int64_t timeUs) const {
+    return mMinIntervalUs > 0 && mDesiredMinTimeUs >= 0
+            && timeUs < (mDesiredMinTimeUs - kMaxJitterUs);
+}
+
 }  // namespace android
@@ -35,6 +35,11 @@ struct FrameDropper : public RefBase {
     // Returns false if max frame rate has not been set via setMaxFrameRate.
     bool shouldDrop(int64_t timeUs);
 
+    // Returns what shouldDrop would return for |timeUs| without accounting
+    // for the frame. A frame that would be dropped stays dropped after any
+    // earlier frame is kept, so this can be asked ahead of the frame's turn.
+    bool wouldDrop(int64_t timeUs) const;
+
 protected:
     virtual ~FrameDropper();
 
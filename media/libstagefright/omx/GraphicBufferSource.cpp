@@ -278,7 +278,9 @@ GraphicBufferSource::GraphicBufferSource() :
     mFrameCount(0),
     mPrevCaptureUs(-1ll),
     mPrevFrameUs(-1ll),
-    mInputBufferTimeOffsetUs(0ll) {
+    mInputBufferTimeOffsetUs(0ll),
+    mNumFramesDroppedOnArrival(0),
+    mNumFramesRepeated(0) {
     ALOGV("GraphicBufferSource");
 
     String8 name("GraphicBufferSource");
@@ -303,12 +305,22 @@ GraphicBufferSource::GraphicBufferSource() :
     }
 
     memset(&mDefaultColorAspectsPacked, 0, sizeof(mDefaultColorAspectsPacked));
+    memset(mNumFramesDropped, 0, sizeof(mNumFramesDropped));
 
     CHECK(mInitCheck == NO_ERROR);
 }
 
 GraphicBufferSource::~GraphicBufferSource() {
     ALOGV("~GraphicBufferSource");
+    ALOGD("frames dropped: %lld before start, %lld suspended, %lld over max fps, "
+            "%lld over capture rate, %lld going backwards (%lld on arrival); repeated %lld",
+            (long long)mNumFramesDropped[kDropBeforeStart],
+            (long long)mNumFramesDropped[kDropSuspended],
+            (long long)mNumFramesDropped[kDropMaxFps],
+            (long long)mNumFramesDropped[kDropCaptureRate],
+            (long long)mNumFramesDropped[kDropBackwards],
+            (long long)mNumFramesDroppedOnArrival,
+            (long long)mNumFramesRepeated);
     {
         // all acquired buffers must be freed with the mutex locked otherwise our debug assertion
         // may trigger
@@ -615,27 +627,27 @@ bool GraphicBufferSource::fillCodecBuffer_l() {
     }
 
     if (mSuspended) {
+        ++mNumFramesDropped[kDropSuspended];
         return true;
     }
 
     int err = UNKNOWN_ERROR;
 
     // only submit sample if start time is unspecified, or sample
-    // is queued after the specified start time
+    // is queued after the specified start time. The timestamp is offset by
+    // the start time in calculateCodecTimestamp_l.
     if (mSkipFramesBeforeNs < 0ll || item.mTimestampNs >= mSkipFramesBeforeNs) {
-        // if start time is set, offset time stamp by start time
-        if (mSkipFramesBeforeNs > 0) {
-            item.mTimestampNs -= mSkipFramesBeforeNs;
-        }
-
         int64_t timeUs = item.mTimestampNs / 1000;
         if (mFrameDropper != NULL && mFrameDropper->shouldDrop(timeUs)) {
             ALOGV("skipping frame (%lld) to meet max framerate", static_cast<long long>(timeUs));
+            ++mNumFramesDropped[kDropMaxFps];
             // set err to OK so that the skipped frame can still be saved as the lastest frame
             err = OK;
         } else {
             err = submitBuffer_l(item); // this takes shared ownership of the acquired buffer on succeess
         }
+    } else {
+        ++mNumFramesDropped[kDropBeforeStart];
     }
 
     if (err != OK) {
@@ -676,6 +688,7 @@ bool GraphicBufferSource::repeatLatestBuffer_l() {
     if (err != OK) {
         return false;
     }
+    ++mNumFramesRepeated;
 
     /* repeat last frame up to kRepeatLastFrameCount times.
      * in case of static scene, a single repeat might not get rid of encoder
@@ -712,14 +725,29 @@ void GraphicBufferSource::queueFrameRepeat_l() {
     }
 }
 
+int64_t GraphicBufferSource::getSourceTimeUs_l(nsecs_t bufferTimeNs) const {
+    // if start time is set, offset time stamp by start time
+    if (mSkipFramesBeforeNs > 0) {
+        bufferTimeNs -= mSkipFramesBeforeNs;
+    }
+    return bufferTimeNs / 1000 + mInputBufferTimeOffsetUs;
+}
+
+bool GraphicBufferSource::isTimeLapseOrSlowMotion_l() const {
+    return mCaptureFps > 0.
+            && (mFps > 2 * mCaptureFps
+            || mCaptureFps > 2 * mFps);
+}
+
+int64_t GraphicBufferSource::getCaptureIntervalsSincePrev_l(int64_t timeUs) const {
+    return std::llround((timeUs - mPrevCaptureUs) * mCaptureFps);
+}
+
 bool GraphicBufferSource::calculateCodecTimestamp_l(
         nsecs_t bufferTimeNs, int64_t *codecTimeUs) {
-    int64_t timeUs = bufferTimeNs / 1000;
-    timeUs += mInputBufferTimeOffsetUs;
+    int64_t timeUs = getSourceTimeUs_l(bufferTimeNs);
 
-    if (mCaptureFps > 0.
-            && (mFps > 2 * mCaptureFps
-            || mCaptureFps > 2 * mFps)) {
+    if (isTimeLapseOrSlowMotion_l()) {
         // Time lapse or slow motion mode
         if (mPrevCaptureUs < 0ll) {
             // first capture
@@ -730,11 +758,11 @@ bool GraphicBufferSource::calculateCodecTimestamp_l(
             mFrameCount = 0;
         } else {
             // snap to nearest capture point
-            int64_t nFrames = std::llround(
-                    (timeUs - mPrevCaptureUs) * mCaptureFps);
+            int64_t nFrames = getCaptureIntervalsSincePrev_l(timeUs);
             if (nFrames <= 0) {
                 // skip this frame as it's too close to previous capture
                 ALOGV("skipping frame, timeUs %lld", static_cast<long long>(timeUs));
+                ++mNumFramesDropped[kDropCaptureRate];
                 return false;
             }
             mFrameCount += nFrames;
@@ -753,6 +781,7 @@ bool GraphicBufferSource::calculateCodecTimestamp_l(
             // Drop the frame if it's going backward in time. Bad timestamp
             // could disrupt encoder's rate control completely.
             ALOGW("Dropping frame that's going backward in time");
+            ++mNumFramesDropped[kDropBackwards];
             return false;
         }
 
@@ -895,14 +924,66 @@ status_t GraphicBufferSource::acquireBuffer_l(VideoBuffer *ab) {
     return OK;
 }
 
+bool GraphicBufferSource::shouldDropOnArrival_l(
+        nsecs_t timestampNs, DropReason *reason) const {
+    // Pending actions may suspend or resume the source at this frame, and frames that are
+    // discarded anyway need no prediction.
+    if (mNumAvailableUnacquiredBuffers != 1 || areWeDiscardingAvailableBuffers_l()
+            || !mActionQueue.empty()) {
+        return false;
+    }
+
+    if (mSkipFramesBeforeNs > 0 && timestampNs < mSkipFramesBeforeNs) {
+        *reason = kDropBeforeStart;
+        return true;
+    }
+
+    // A frame dropped to meet the max frame rate is still kept for repeating, which needs it to
+    // go through fillCodecBuffer_l.
+    if (mFrameDropper != NULL && mFrameRepeatIntervalUs <= 0
+            && mFrameDropper->wouldDrop(timestampNs / 1000)) {
+        *reason = kDropMaxFps;
+        return true;
+    }
+
+    // The previous capture only moves forward, so frames queued ahead of this one cannot make
+    // it any less close to it.
+    if (isTimeLapseOrSlowMotion_l() && mPrevCaptureUs >= 0ll
+            && getCaptureIntervalsSincePrev_l(getSourceTimeUs_l(timestampNs)) <= 0) {
+        *reason = kDropCaptureRate;
+        return true;
+    }
+
+    return false;
+}
+
 // BufferQueue::ConsumerListener callback
-void GraphicBufferSource::onFrameAvailable(const BufferItem& item __unused) {
+void GraphicBufferSource::onFrameAvailable(const BufferItem& item) {
     Mutex::Autolock autoLock(mMutex);
 
     ALOGV("onFrameAvailable: executing=%d available=%zu+%d",
             mExecuting, mAvailableBuffers.size(), mNumAvailableUnacquiredBuffers);
     ++mNumAvailableUnacquiredBuffers;
 
+    // If this frame is the next to be acquired and will be dropped anyway, release it right away
+    // instead of holding its slot until a codec buffer is free. It is released with its acquire
+    // fence, so nothing waits on it.
+    DropReason reason;
+    if (shouldDropOnArrival_l(item.mTimestamp, &reason)) {
+        VideoBuffer buffer;
+        status_t err = acquireBuffer_l(&buffer);
+        if (err != OK) {
+            ALOGE("onFrameAvailable: acquireBuffer returned err=%d", err);
+            return;
+        }
+        ALOGV("onFrameAvailable: dropping frame (%lld) on arrival, reason %d",
+                (long long)item.mTimestamp, reason);
+        ++mNumFramesDropped[reason];
+        ++mNumFramesDroppedOnArrival;
+        ++mRepeatLastFrameGeneration; // cancel any pending frame repeat
+        return;
+    }
+
     // For BufferQueue we cannot acquire a buffer if we cannot immediately feed it to the codec
     // UNLESS we are discarding this buffer (acquiring and immediately releasing it), which makes
     // this an ugly logic.
@@ -925,7 +1006,7 @@ void GraphicBufferSource::onFrameAvailable(const BufferItem& item __unused) {
     }
 }
 
-bool GraphicBufferSource::areWeDiscardingAvailableBuffers_l() {
+bool GraphicBufferSource::areWeDiscardingAvailableBuffers_l() const {
     return mEndOfStreamSent // already sent EOS to codec
             || mOMXNode == nullptr // there is no codec connected
             || (mSuspended && mActionQueue.empty()) // we are suspended and not waiting for
@@ -942,6 +1023,7 @@ void GraphicBufferSource::onBufferAcquired_l(const VideoBuffer &buffer) {
         // FIXME: if we are suspended but have a resume queued we will stop repeating the last
         // frame. Is that the desired behavior?
         ALOGV("onFrameAvailable: suspended, ignoring frame");
+        ++mNumFramesDropped[kDropSuspended];
     } else {
         ++mRepeatLastFrameGeneration; // cancel any pending frame repeat
         mAvailableBuffers.push_back(buffer);
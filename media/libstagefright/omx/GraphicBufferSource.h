@@ -338,7 +338,7 @@ private:
 
     // returns true if this source is unconditionally discarding acquired buffers at the moment
     // regardless of the metadata of those buffers
-    bool areWeDiscardingAvailableBuffers_l();
+    bool areWeDiscardingAvailableBuffers_l() const;
 
     // Our BufferQueue interfaces. mProducer is passed to the producer through
     // getIGraphicBufferProducer, and mConsumer is used internally to retrieve
@@ -466,6 +466,43 @@ private:
     // adjustment requests.
     bool calculateCodecTimestamp_l(nsecs_t bufferTimeNs, int64_t *codecTimeUs);
 
+    // Returns the timestamp of a buffer with |bufferTimeNs| after the start time and time offset
+    // adjustments, but before any time lapse or slow motion adjustment.
+    int64_t getSourceTimeUs_l(nsecs_t bufferTimeNs) const;
+
+    // Returns whether time lapse or slow motion mode is enabled.
+    bool isTimeLapseOrSlowMotion_l() const;
+
+    // Returns the number of capture intervals between the previous capture and |timeUs|.
+    int64_t getCaptureIntervalsSincePrev_l(int64_t timeUs) const;
+
+    // Frame statistics
+    // ----------------
+
+    enum DropReason {
+        kDropBeforeStart,   // before the start time
+        kDropSuspended,     // while suspended, or after EOS was sent
+        kDropMaxFps,        // to keep under the max frame rate
+        kDropCaptureRate,   // too close to the previous capture in time lapse mode
+        kDropBackwards,     // timestamp going backwards
+        kNumDropReasons,
+    };
+
+    // number of frames not encoded, by reason
+    int64_t mNumFramesDropped[kNumDropReasons];
+
+    // number of the dropped frames that were released as soon as they arrived
+    int64_t mNumFramesDroppedOnArrival;
+
+    // number of times the latest frame was repeated
+    int64_t mNumFramesRepeated;
+
+    // Returns true and stores the reason in |*reason| if the frame with |timestampNs| is known to
+    // be dropped before it is acquired. This requires it to be the only frame not yet acquired.
+    // Such a frame is acquired and released at once, instead of waiting in the BufferQueue for a
+    // codec buffer only to be dropped then.
+    bool shouldDropOnArrival_l(nsecs_t timestampNs, DropReason *reason) const;
+
     void onMessageReceived(const sp<AMessage> &msg);
 
     DISALLOW_EVIL_CONSTRUCTORS(GraphicBufferSource);
@@ -25,12 +25,18 @@
 #include <dlfcn.h>
 #include <fcntl.h>
 
+#include <cutils/properties.h>
 #include <media/stagefright/foundation/ADebug.h>
 
 namespace android {
 
+static const size_t kMaxPoolSize = 8;
+
 OMXMaster::OMXMaster()
-    : mVendorLibHandle(NULL) {
+    : mVendorLibHandle(NULL),
+      mSoftPlugin(NULL),
+      mPoolHits(0),
+      mPoolMisses(0) {
 
     pid_t pid = getpid();
     char filename[20];
@@ -51,11 +57,16 @@ OMXMaster::OMXMaster()
       close(fd);
     }
 
+    int32_t poolSize = property_get_int32("media.stagefright.omx.pool-size", 0);
+    mPoolSize = poolSize <= 0 ? 0 : poolSize > (int32_t)kMaxPoolSize ? kMaxPoolSize : poolSize;
+
     addVendorPlugin();
-    addPlugin(new SoftOMXPlugin);
+    mSoftPlugin = new SoftOMXPlugin;
+    addPlugin(mSoftPlugin);
 }
 
 OMXMaster::~OMXMaster() {
+    clearPool();
     clearPlugins();
 
     if (mVendorLibHandle != NULL) {
@@ -156,6 +167,26 @@ OMX_ERRORTYPE OMXMaster::makeComponentInstance(
     }
 
     OMXPluginBase *plugin = mPluginByComponentName.valueAt(index);
+    bool poolable = mPoolSize > 0 && plugin == mSoftPlugin && strstr(name, ".decoder") != NULL;
+
+    if (poolable) {
+        for (List<PooledInstance>::iterator it = mPool.begin(); it != mPool.end(); ++it) {
+            if (it->mName == name && it->mCallbacks == callbacks) {
+                // The soft components call back with the app data kept in
+                // the component, so only that needs to change.
+                *component = it->mComponent;
+                (*component)->pApplicationPrivate = appData;
+                mPool.erase(it);
+
+                ++mPoolHits;
+                ALOGI("reusing pooled %s (%zu hits, %zu misses)",
+                        name, mPoolHits, mPoolMisses);
+                return OMX_ErrorNone;
+            }
+        }
+        ++mPoolMisses;
+    }
+
     OMX_ERRORTYPE err =
         plugin->makeComponentInstance(name, callbacks, appData, component);
 
@@ -165,6 +196,14 @@ OMX_ERRORTYPE OMXMaster::makeComponentInstance(
 
     mPluginByInstance.add(*component, plugin);
 
+    if (poolable) {
+        PooledInstance instance;
+        instance.mName = name;
+        instance.mComponent = *component;
+        instance.mCallbacks = callbacks;
+        mPoolableInstances.add(*component, instance);
+    }
+
     return err;
 }
 
@@ -178,12 +217,51 @@ OMX_ERRORTYPE OMXMaster::destroyComponentInstance(
         return OMX_ErrorBadParameter;
     }
 
+    ssize_t poolIndex = mPoolableInstances.indexOfKey(component);
+    OMX_STATETYPE state;
+    if (poolIndex >= 0
+            && component->GetState(component, &state) == OMX_ErrorNone
+            && state == OMX_StateLoaded) {
+        // Keep it for the next client, unless it is the oldest of too many.
+        component->pApplicationPrivate = NULL;
+        mPool.push_back(mPoolableInstances.valueAt(poolIndex));
+        if (mPool.size() <= mPoolSize) {
+            ALOGV("pooled %s", mPoolableInstances.valueAt(poolIndex).mName.string());
+            return OMX_ErrorNone;
+        }
+        component = mPool.begin()->mComponent;
+        mPool.erase(mPool.begin());
+        index = mPluginByInstance.indexOfKey(component);
+        CHECK_GE(index, 0);
+        poolIndex = mPoolableInstances.indexOfKey(component);
+    }
+    if (poolIndex >= 0) {
+        mPoolableInstances.removeItemsAt(poolIndex);
+    }
+
     OMXPluginBase *plugin = mPluginByInstance.valueAt(index);
     mPluginByInstance.removeItemsAt(index);
 
     return plugin->destroyComponentInstance(component);
 }
 
+void OMXMaster::clearPool() {
+    Mutex::Autolock autoLock(mLock);
+
+    for (List<PooledInstance>::iterator it = mPool.begin(); it != mPool.end(); ++it) {
+        OMX_COMPONENTTYPE *component = it->mComponent;
+        mPoolableInstances.removeItem(component);
+
+        ssize_t index = mPluginByInstance.indexOfKey(component);
+        CHECK_GE(index, 0);
+        OMXPluginBase *plugin = mPluginByInstance.valueAt(index);
+        mPluginByInstance.removeItemsAt(index);
+
+        plugin->destroyComponentInstance(component);
+    }
+    mPool.clear();
+}
+
 OMX_ERRORTYPE OMXMaster::enumerateComponents(
         OMX_STRING name,
         size_t size,
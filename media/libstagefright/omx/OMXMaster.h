@@ -50,18 +50,34 @@ struct OMXMaster : public OMXPluginBase {
             Vector<String8> *roles);
 
 private:
+    // A software decoder that a client freed in the Loaded state, kept for
+    // the next client of the same component.
+    struct PooledInstance {
+        String8 mName;
+        OMX_COMPONENTTYPE *mComponent;
+        const OMX_CALLBACKTYPE *mCallbacks;
+    };
+
     char mProcessName[16];
     Mutex mLock;
     List<OMXPluginBase *> mPlugins;
     KeyedVector<String8, OMXPluginBase *> mPluginByComponentName;
     KeyedVector<OMX_COMPONENTTYPE *, OMXPluginBase *> mPluginByInstance;
 
+    OMXPluginBase *mSoftPlugin;
+    size_t mPoolSize;
+    KeyedVector<OMX_COMPONENTTYPE *, PooledInstance> mPoolableInstances;
+    List<PooledInstance> mPool;
+    size_t mPoolHits;
+    size_t mPoolMisses;
+
     void *mVendorLibHandle;
 
     void addVendorPlugin();
     void addPlugin(const char *libname);
     void addPlugin(OMXPluginBase *plugin);
     void clearPlugins();
+    void clearPool();
 
     OMXMaster(const OMXMaster &);
     OMXMaster &operator=(const OMXMaster &);
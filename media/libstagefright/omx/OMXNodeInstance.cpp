@@ -16,7 +16,9 @@
 
 //#define LOG_NDEBUG 0
 #define LOG_TAG "OMXNodeInstance"
+#define ATRACE_TAG ATRACE_TAG_VIDEO
 #include <utils/Log.h>
+#include <utils/Trace.h>
 
 #include <inttypes.h>
 
@@ -1578,8 +1580,11 @@ status_t OMXNodeInstance::fillBuffer(
         CLOG_BUMPED_BUFFER(fillBuffer, WITH_STATS(EMPTY_BUFFER(buffer, header, fenceFd)));
     }
 
+    // Spans the time the component takes to fill the buffer, per header.
+    ATRACE_ASYNC_BEGIN("OMX fillBuffer", (int32_t)(uintptr_t)header);
     OMX_ERRORTYPE err = OMX_FillThisBuffer(mHandle, header);
     if (err != OMX_ErrorNone) {
+        ATRACE_ASYNC_END("OMX fillBuffer", (int32_t)(uintptr_t)header);
         CLOG_ERROR(fillBuffer, err, EMPTY_BUFFER(buffer, header, fenceFd));
         Mutex::Autolock _l(mDebugLock);
         mOutputBuffersWithCodec.remove(header);
@@ -1749,8 +1754,12 @@ status_t OMXNodeInstance::emptyBuffer_l(
         CLOG_BUMPED_BUFFER(emptyBuffer, WITH_STATS(FULL_BUFFER(debugAddr, header, fenceFd)));
     }
 
+    ATRACE_ASYNC_BEGIN("OMX emptyBuffer", (int32_t)(uintptr_t)header);
     OMX_ERRORTYPE err = OMX_EmptyThisBuffer(mHandle, header);
     CLOG_IF_ERROR(emptyBuffer, err, FULL_BUFFER(debugAddr, header, fenceFd));
+    if (err != OMX_ErrorNone) {
+        ATRACE_ASYNC_END("OMX emptyBuffer", (int32_t)(uintptr_t)header);
+    }
 
     {
         Mutex::Autolock _l(mDebugLock);
@@ -2195,6 +2204,7 @@ OMX_ERRORTYPE OMXNodeInstance::OnEmptyBufferDone(
     if (instance->mDying) {
         return OMX_ErrorNone;
     }
+    ATRACE_ASYNC_END("OMX emptyBuffer", (int32_t)(uintptr_t)pBuffer);
     int fenceFd = instance->retrieveFenceFromMeta_l(pBuffer, kPortIndexOutput);
 
     omx_message msg;
@@ -2219,6 +2229,7 @@ OMX_ERRORTYPE OMXNodeInstance::OnFillBufferDone(
     if (instance->mDying) {
         return OMX_ErrorNone;
     }
+    ATRACE_ASYNC_END("OMX fillBuffer", (int32_t)(uintptr_t)pBuffer);
     int fenceFd = instance->retrieveFenceFromMeta_l(pBuffer, kPortIndexOutput);
 
     omx_message msg;
@@ -102,6 +102,7 @@ protected:
             int64_t testTimeUs = frames[i].timeUs + jitter;
             printf("time %lld, testTime %lld, jitter %d\n",
                     (long long)frames[i].timeUs, (long long)testTimeUs, jitter);
+            EXPECT_EQ(frames[i].shouldDrop, mFrameDropper->wouldDrop(testTimeUs));
             EXPECT_EQ(frames[i].shouldDrop, mFrameDropper->shouldDrop(testTimeUs));
         }
     }
@@ -23,6 +23,7 @@
 #include "ARTPSource.h"
 
 #include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ABufferPool.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/hexdump.h>
@@ -183,7 +184,7 @@ ARTPAssembler::AssemblyStatus AAMRAssembler::addPacket(
         }
     }
 
-    sp<ABuffer> accessUnit = new ABuffer(totalSize);
+    sp<ABuffer> accessUnit = ABufferPool::Acquire(totalSize);
     CopyTimes(accessUnit, buffer);
 
     size_t dstOffset = 0;
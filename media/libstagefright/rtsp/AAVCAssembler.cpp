@@ -23,10 +23,13 @@
 #include "ARTPSource.h"
 
 #include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ABufferPool.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/hexdump.h>
 
+#include <algorithm>
+
 #include <stdint.h>
 
 namespace android {
@@ -37,7 +40,9 @@ AAVCAssembler::AAVCAssembler(const sp<AMessage> &notify)
       mAccessUnitRTPTime(0),
       mNextExpectedSeqNoValid(false),
       mNextExpectedSeqNo(0),
-      mAccessUnitDamaged(false) {
+      mAccessUnitDamaged(false),
+      mNumNALUnits(0),
+      mAccessUnitSizeHint(0) {
 }
 
 AAVCAssembler::~AAVCAssembler() {
@@ -123,21 +128,51 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addNALUnit(
     }
 }
 
-void AAVCAssembler::addSingleNALUnit(const sp<ABuffer> &buffer) {
-    ALOGV("addSingleNALUnit of size %zu", buffer->size());
-#if !LOG_NDEBUG
-    hexdump(buffer->data(), buffer->size());
-#endif
-
+uint8_t *AAVCAssembler::appendNALUnit(const sp<ABuffer> &buffer, size_t size) {
     uint32_t rtpTime;
     CHECK(buffer->meta()->findInt32("rtp-time", (int32_t *)&rtpTime));
 
-    if (!mNALUnits.empty() && rtpTime != mAccessUnitRTPTime) {
+    if (mAccessUnit != NULL && rtpTime != mAccessUnitRTPTime) {
         submitAccessUnit();
     }
     mAccessUnitRTPTime = rtpTime;
 
-    mNALUnits.push_back(buffer);
+    size_t neededSize = (mAccessUnit == NULL ? 0 : mAccessUnit->size()) + 4 + size;
+    if (mAccessUnit == NULL || neededSize > mAccessUnit->capacity()) {
+        size_t capacity = neededSize;
+        if (mAccessUnit != NULL) {
+            capacity = std::max(capacity, 2 * mAccessUnit->capacity());
+        } else {
+            capacity = std::max(capacity, mAccessUnitSizeHint);
+        }
+
+        sp<ABuffer> accessUnit = ABufferPool::Acquire(capacity);
+        if (mAccessUnit != NULL) {
+            memcpy(accessUnit->data(), mAccessUnit->data(), mAccessUnit->size());
+            accessUnit->setRange(0, mAccessUnit->size());
+            CopyTimes(accessUnit, mAccessUnit);
+        } else {
+            accessUnit->setRange(0, 0);
+            CopyTimes(accessUnit, buffer);
+        }
+        mAccessUnit = accessUnit;
+    }
+
+    uint8_t *data = mAccessUnit->data() + mAccessUnit->size();
+    memcpy(data, "\x00\x00\x00\x01", 4);
+    mAccessUnit->setRange(0, neededSize);
+    ++mNumNALUnits;
+
+    return data + 4;
+}
+
+void AAVCAssembler::addSingleNALUnit(const sp<ABuffer> &buffer) {
+    ALOGV("addSingleNALUnit of size %zu", buffer->size());
+#if !LOG_NDEBUG
+    hexdump(buffer->data(), buffer->size());
+#endif
+
+    memcpy(appendNALUnit(buffer, buffer->size()), buffer->data(), buffer->size());
 }
 
 bool AAVCAssembler::addSingleTimeAggregationPacket(const sp<ABuffer> &buffer) {
@@ -159,12 +194,7 @@ bool AAVCAssembler::addSingleTimeAggregationPacket(const sp<ABuffer> &buffer) {
             return false;
         }
 
-        sp<ABuffer> unit = new ABuffer(nalSize);
-        memcpy(unit->data(), &data[2], nalSize);
-
-        CopyTimes(unit, buffer);
-
-        addSingleNALUnit(unit);
+        memcpy(appendNALUnit(buffer, nalSize), &data[2], nalSize);
 
         data += 2 + nalSize;
         size -= 2 + nalSize;
@@ -278,16 +308,16 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addFragmentedNALUnit(
 
     mNextExpectedSeqNo = expectedSeqNo;
 
-    // We found all the fragments that make up the complete NAL unit.
+    // We found all the fragments that make up the complete NAL unit; they
+    // are reassembled in place in the access unit.
 
     // Leave room for the header. So far totalSize did not include the
     // header byte.
     ++totalSize;
 
-    sp<ABuffer> unit = new ABuffer(totalSize);
-    CopyTimes(unit, *queue->begin());
+    uint8_t *unit = appendNALUnit(*queue->begin(), totalSize);
 
-    unit->data()[0] = (nri << 5) | nalType;
+    unit[0] = (nri << 5) | nalType;
 
     size_t offset = 1;
     List<sp<ABuffer> >::iterator it = queue->begin();
@@ -299,45 +329,24 @@ ARTPAssembler::AssemblyStatus AAVCAssembler::addFragmentedNALUnit(
         hexdump(buffer->data(), buffer->size());
 #endif
 
-        memcpy(unit->data() + offset, buffer->data() + 2, buffer->size() - 2);
+        memcpy(unit + offset, buffer->data() + 2, buffer->size() - 2);
         offset += buffer->size() - 2;
 
         it = queue->erase(it);
     }
 
-    unit->setRange(0, totalSize);
-
-    addSingleNALUnit(unit);
-
     ALOGV("successfully assembled a NAL unit from fragments.");
 
     return OK;
 }
 
 void AAVCAssembler::submitAccessUnit() {
-    CHECK(!mNALUnits.empty());
+    CHECK(mAccessUnit != NULL);
 
-    ALOGV("Access unit complete (%zu nal units)", mNALUnits.size());
-
-    size_t totalSize = 0;
-    for (List<sp<ABuffer> >::iterator it = mNALUnits.begin();
-         it != mNALUnits.end(); ++it) {
-        totalSize += 4 + (*it)->size();
-    }
-
-    sp<ABuffer> accessUnit = new ABuffer(totalSize);
-    size_t offset = 0;
-    for (List<sp<ABuffer> >::iterator it = mNALUnits.begin();
-         it != mNALUnits.end(); ++it) {
-        memcpy(accessUnit->data() + offset, "\x00\x00\x00\x01", 4);
-        offset += 4;
-
-        sp<ABuffer> nal = *it;
-        memcpy(accessUnit->data() + offset, nal->data(), nal->size());
-        offset += nal->size();
-    }
+    ALOGV("Access unit complete (%zu nal units)", mNumNALUnits);
 
-    CopyTimes(accessUnit, *mNALUnits.begin());
+    sp<ABuffer> accessUnit = mAccessUnit;
+    mAccessUnitSizeHint = accessUnit->size();
 
 #if 0
     printf(mAccessUnitDamaged ? "X" : ".");
@@ -348,7 +357,8 @@ void AAVCAssembler::submitAccessUnit() {
         accessUnit->meta()->setInt32("damaged", true);
     }
 
-    mNALUnits.clear();
+    mAccessUnit.clear();
+    mNumNALUnits = 0;
     mAccessUnitDamaged = false;
 
     sp<AMessage> msg = mNotifyMsg->dup();
@@ -45,9 +45,18 @@ private:
     bool mNextExpectedSeqNoValid;
     uint32_t mNextExpectedSeqNo;
     bool mAccessUnitDamaged;
-    List<sp<ABuffer> > mNALUnits;
+
+    // The access unit being assembled, which the NAL units are written to
+    // as they are received, each after a start code. It is allocated at the
+    // size of the last one, so that it rarely has to grow.
+    sp<ABuffer> mAccessUnit;
+    size_t mNumNALUnits;
+    size_t mAccessUnitSizeHint;
 
     AssemblyStatus addNALUnit(const sp<ARTPSource> &source);
+    // Returns where to write a NAL unit of |size| bytes, received in
+    // |buffer|, to the access unit of its RTP time.
+    uint8_t *appendNALUnit(const sp<ABuffer> &buffer, size_t size);
     void addSingleNALUnit(const sp<ABuffer> &buffer);
     AssemblyStatus addFragmentedNALUnit(List<sp<ABuffer> > *queue);
     bool addSingleTimeAggregationPacket(const sp<ABuffer> &buffer);
@@ -22,6 +22,7 @@
 #include "ARTPSource.h"
 
 #include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ABufferPool.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/hexdump.h>
@@ -165,7 +166,7 @@ void AH263Assembler::submitAccessUnit() {
         ++it;
     }
 
-    sp<ABuffer> accessUnit = new ABuffer(totalSize);
+    sp<ABuffer> accessUnit = ABufferPool::Acquire(totalSize);
     size_t offset = 0;
     it = mPackets.begin();
     while (it != mPackets.end()) {
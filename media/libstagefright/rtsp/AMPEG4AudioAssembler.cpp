@@ -24,6 +24,7 @@
 #include <media/stagefright/foundation/hexdump.h>
 #include <media/stagefright/foundation/ABitReader.h>
 #include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ABufferPool.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/MediaErrors.h>
@@ -362,7 +363,7 @@ static status_t parseStreamMuxConfig(
 sp<ABuffer> AMPEG4AudioAssembler::removeLATMFraming(const sp<ABuffer> &buffer) {
     CHECK(!mMuxConfigPresent);  // XXX to be implemented
 
-    sp<ABuffer> out = new ABuffer(buffer->size());
+    sp<ABuffer> out = ABufferPool::Acquire(buffer->size());
     out->setRange(0, 0);
 
     size_t offset = 0;
@@ -25,6 +25,7 @@
 
 #include <media/stagefright/foundation/ABitReader.h>
 #include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ABufferPool.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/hexdump.h>
@@ -350,7 +351,7 @@ ARTPAssembler::AssemblyStatus AMPEG4ElementaryAssembler::addPacket(
                 return MALFORMED_PACKET;
             }
 
-            sp<ABuffer> accessUnit = new ABuffer(header.mSize);
+            sp<ABuffer> accessUnit = ABufferPool::Acquire(header.mSize);
             memcpy(accessUnit->data(), buffer->data() + offset, header.mSize);
 
             offset += header.mSize;
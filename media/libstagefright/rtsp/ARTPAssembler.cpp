@@ -17,6 +17,7 @@
 #include "ARTPAssembler.h"
 
 #include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ABufferPool.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
@@ -81,7 +82,7 @@ sp<ABuffer> ARTPAssembler::MakeADTSCompoundFromAACFrames(
         totalSize += (*it)->size() + 7;
     }
 
-    sp<ABuffer> accessUnit = new ABuffer(totalSize);
+    sp<ABuffer> accessUnit = ABufferPool::Acquire(totalSize);
     size_t offset = 0;
     for (List<sp<ABuffer> >::const_iterator it = frames.begin();
          it != frames.end(); ++it) {
@@ -127,7 +128,7 @@ sp<ABuffer> ARTPAssembler::MakeCompoundFromPackets(
         totalSize += (*it)->size();
     }
 
-    sp<ABuffer> accessUnit = new ABuffer(totalSize);
+    sp<ABuffer> accessUnit = ABufferPool::Acquire(totalSize);
     size_t offset = 0;
     for (List<sp<ABuffer> >::const_iterator it = packets.begin();
          it != packets.end(); ++it) {
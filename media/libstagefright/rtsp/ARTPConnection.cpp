@@ -25,13 +25,17 @@
 #include "ASessionDescription.h"
 
 #include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ABufferPool.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/AString.h>
 #include <media/stagefright/foundation/hexdump.h>
 
 #include <arpa/inet.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
+#include <unistd.h>
 
 namespace android {
 
@@ -69,11 +73,19 @@ struct ARTPConnection::StreamInfo {
 
 ARTPConnection::ARTPConnection(uint32_t flags)
     : mFlags(flags),
+      mEpollFd(epoll_create1(EPOLL_CLOEXEC)),
+      mBatchData(NULL),
       mPollEventPending(false),
       mLastReceiverReportTimeUs(-1) {
+    CHECK_GE(mEpollFd, 0);
 }
 
 ARTPConnection::~ARTPConnection() {
+    close(mEpollFd);
+    mEpollFd = -1;
+
+    free(mBatchData);
+    mBatchData = NULL;
 }
 
 void ARTPConnection::addStream(
@@ -206,6 +218,7 @@ void ARTPConnection::onAddStream(const sp<AMessage> &msg) {
     memset(&info->mRemoteRTCPAddr, 0, sizeof(info->mRemoteRTCPAddr));
 
     if (!injected) {
+        startPolling(*info);
         postPollEvent();
     }
 }
@@ -225,9 +238,44 @@ void ARTPConnection::onRemoveStream(const sp<AMessage> &msg) {
         return;
     }
 
+    if (!it->mIsInjected) {
+        stopPolling(*it);
+    }
     mStreams.erase(it);
 }
 
+void ARTPConnection::startPolling(const StreamInfo &info) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+
+    event.data.fd = info.mRTPSocket;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, info.mRTPSocket, &event) < 0) {
+        ALOGE("cannot poll RTP socket %d (%s)", info.mRTPSocket, strerror(errno));
+    }
+
+    event.data.fd = info.mRTCPSocket;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, info.mRTCPSocket, &event) < 0) {
+        ALOGE("cannot poll RTCP socket %d (%s)", info.mRTCPSocket, strerror(errno));
+    }
+}
+
+void ARTPConnection::stopPolling(const StreamInfo &info) {
+    // The owner may have closed the sockets already, which stops polling
+    // them anyway.
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, info.mRTPSocket, NULL);
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, info.mRTCPSocket, NULL);
+}
+
+static bool isReady(const struct epoll_event *events, int numEvents, int fd) {
+    for (int i = 0; i < numEvents; ++i) {
+        if (events[i].data.fd == fd) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void ARTPConnection::postPollEvent() {
     if (mPollEventPending) {
         return;
@@ -246,36 +294,26 @@ void ARTPConnection::onPollStreams() {
         return;
     }
 
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = kSelectTimeoutUs;
-
-    fd_set rs;
-    FD_ZERO(&rs);
-
-    int maxSocket = -1;
+    bool polled = false;
     for (List<StreamInfo>::iterator it = mStreams.begin();
          it != mStreams.end(); ++it) {
-        if ((*it).mIsInjected) {
-            continue;
-        }
-
-        FD_SET(it->mRTPSocket, &rs);
-        FD_SET(it->mRTCPSocket, &rs);
-
-        if (it->mRTPSocket > maxSocket) {
-            maxSocket = it->mRTPSocket;
-        }
-        if (it->mRTCPSocket > maxSocket) {
-            maxSocket = it->mRTCPSocket;
+        if (!(*it).mIsInjected) {
+            polled = true;
+            break;
         }
     }
 
-    if (maxSocket == -1) {
+    if (!polled) {
         return;
     }
 
-    int res = select(maxSocket + 1, &rs, NULL, NULL, &tv);
+    // Sockets that are still ready past the first kMaxBatchSize are
+    // reported again by the next poll.
+    struct epoll_event events[kMaxBatchSize];
+    int res;
+    do {
+        res = epoll_wait(mEpollFd, events, kMaxBatchSize, kSelectTimeoutUs / 1000);
+    } while (res < 0 && errno == EINTR);
 
     if (res > 0) {
         List<StreamInfo>::iterator it = mStreams.begin();
@@ -286,10 +324,10 @@ void ARTPConnection::onPollStreams() {
             }
 
             status_t err = OK;
-            if (FD_ISSET(it->mRTPSocket, &rs)) {
+            if (isReady(events, res, it->mRTPSocket)) {
                 err = receive(&*it, true);
             }
-            if (err == OK && FD_ISSET(it->mRTCPSocket, &rs)) {
+            if (err == OK && isReady(events, res, it->mRTCPSocket)) {
                 err = receive(&*it, false);
             }
 
@@ -297,6 +335,7 @@ void ARTPConnection::onPollStreams() {
                 // socket failure, this stream is dead, Jim.
 
                 ALOGW("failed to receive RTP/RTCP datagram.");
+                stopPolling(*it);
                 it = mStreams.erase(it);
                 continue;
             }
@@ -330,6 +369,12 @@ void ARTPConnection::onPollStreams() {
             for (size_t i = 0; i < s->mSources.size(); ++i) {
                 sp<ARTPSource> source = s->mSources.valueAt(i);
 
+                ARTPSource::Stats stats;
+                source->getStats(&stats);
+                ALOGV("source 0x%08x: received %d of %u packets, jitter %lld us",
+                        s->mSources.keyAt(i), stats.mNumPacketsReceived,
+                        stats.mNumPacketsExpected, (long long)stats.mJitterUs);
+
                 source->addReceiverReport(buffer);
 
                 if (mFlags & kRegularlyRequestFIR) {
@@ -352,6 +397,7 @@ void ARTPConnection::onPollStreams() {
                     ALOGW("failed to send RTCP receiver report (%s).",
                          n == 0 ? "connection gone" : strerror(errno));
 
+                    stopPolling(*it);
                     it = mStreams.erase(it);
                     continue;
                 }
@@ -375,16 +421,19 @@ status_t ARTPConnection::receive(StreamInfo *s, bool receiveRTP) {
 
     CHECK(!s->mIsInjected);
 
-    sp<ABuffer> buffer = new ABuffer(65536);
+    if (receiveRTP) {
+        return receiveRTPBatch(s);
+    }
+
+    sp<ABuffer> buffer = ABufferPool::Acquire(65536);
 
     socklen_t remoteAddrLen =
-        (!receiveRTP && s->mNumRTCPPacketsReceived == 0)
-            ? sizeof(s->mRemoteRTCPAddr) : 0;
+        s->mNumRTCPPacketsReceived == 0 ? sizeof(s->mRemoteRTCPAddr) : 0;
 
     ssize_t nbytes;
     do {
         nbytes = recvfrom(
-            receiveRTP ? s->mRTPSocket : s->mRTCPSocket,
+            s->mRTCPSocket,
             buffer->data(),
             buffer->capacity(),
             0,
@@ -400,14 +449,58 @@ status_t ARTPConnection::receive(StreamInfo *s, bool receiveRTP) {
 
     // ALOGI("received %d bytes.", buffer->size());
 
-    status_t err;
-    if (receiveRTP) {
-        err = parseRTP(s, buffer);
-    } else {
-        err = parseRTCP(s, buffer);
+    return parseRTCP(s, buffer);
+}
+
+status_t ARTPConnection::receiveRTPBatch(StreamInfo *s) {
+    if (mBatchData == NULL) {
+        mBatchData = (uint8_t *)malloc(kMaxBatchSize * kMaxBatchDatagramSize);
+        if (mBatchData == NULL) {
+            return NO_MEMORY;
+        }
+    }
+
+    struct iovec iov[kMaxBatchSize];
+    struct mmsghdr msgs[kMaxBatchSize];
+    memset(msgs, 0, sizeof(msgs));
+    for (size_t i = 0; i < kMaxBatchSize; ++i) {
+        iov[i].iov_base = mBatchData + i * kMaxBatchDatagramSize;
+        iov[i].iov_len = kMaxBatchDatagramSize;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // Reads what has queued up at the socket, up to kMaxBatchSize datagrams,
+    // in a single system call.
+    int n;
+    do {
+        n = recvmmsg(s->mRTPSocket, msgs, kMaxBatchSize, MSG_DONTWAIT, NULL);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return OK;
+    }
+    if (n <= 0) {
+        return -ECONNRESET;
+    }
+
+    ALOGV("received %d RTP datagrams", n);
+
+    for (int i = 0; i < n; ++i) {
+        if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            ALOGW("dropping RTP datagram larger than %d bytes", kMaxBatchDatagramSize);
+            continue;
+        }
+
+        size_t size = msgs[i].msg_len;
+        sp<ABuffer> buffer = ABufferPool::Acquire(size);
+        memcpy(buffer->data(), iov[i].iov_base, size);
+        buffer->setRange(0, size);
+
+        parseRTP(s, buffer);
     }
 
-    return err;
+    return OK;
 }
 
 status_t ARTPConnection::parseRTP(StreamInfo *s, const sp<ABuffer> &buffer) {
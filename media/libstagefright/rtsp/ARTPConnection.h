@@ -64,11 +64,27 @@ private:
 
     static const int64_t kSelectTimeoutUs;
 
+    enum {
+        // the most datagrams read from a socket at once
+        kMaxBatchSize = 16,
+        // larger RTP datagrams, which would be fragmented at the IP layer,
+        // are dropped
+        kMaxBatchDatagramSize = 8192,
+    };
+
     uint32_t mFlags;
 
     struct StreamInfo;
     List<StreamInfo> mStreams;
 
+    // watches the sockets of the streams that are not injected
+    int mEpollFd;
+
+    // kMaxBatchSize datagrams of kMaxBatchDatagramSize bytes, that RTP
+    // packets are received into before being copied to buffers of their
+    // size; allocated on first use.
+    uint8_t *mBatchData;
+
     bool mPollEventPending;
     int64_t mLastReceiverReportTimeUs;
 
@@ -78,7 +94,11 @@ private:
     void onInjectPacket(const sp<AMessage> &msg);
     void onSendReceiverReports();
 
+    void startPolling(const StreamInfo &info);
+    void stopPolling(const StreamInfo &info);
+
     status_t receive(StreamInfo *info, bool receiveRTP);
+    status_t receiveRTPBatch(StreamInfo *info);
 
     status_t parseRTP(StreamInfo *info, const sp<ABuffer> &buffer);
     status_t parseRTCP(StreamInfo *info, const sp<ABuffer> &buffer);
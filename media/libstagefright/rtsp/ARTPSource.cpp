@@ -42,8 +42,15 @@ ARTPSource::ARTPSource(
         const sp<ASessionDescription> &sessionDesc, size_t index,
         const sp<AMessage> &notify)
     : mID(id),
+      mBaseSeqNumber(0),
       mHighestSeqNumber(0),
       mNumBuffersReceived(0),
+      mExpectedPrior(0),
+      mReceivedPrior(0),
+      mClockRate(0),
+      mLastArrivalUs(-1),
+      mLastRTPTime(0),
+      mJitter(0),
       mLastNTPTime(0),
       mLastNTPTimeUpdateUs(0),
       mIssueFIRRequests(false),
@@ -55,6 +62,9 @@ ARTPSource::ARTPSource(
     AString params;
     sessionDesc->getFormatType(index, &PT, &desc, &params);
 
+    int32_t numChannels;
+    ASessionDescription::ParseFormatDesc(desc.c_str(), &mClockRate, &numChannels);
+
     if (!strncmp(desc.c_str(), "H264/", 5)) {
         mAssembler = new AAVCAssembler(notify);
         mIssueFIRRequests = true;
@@ -86,6 +96,11 @@ static uint32_t AbsDiff(uint32_t seq1, uint32_t seq2) {
 }
 
 void ARTPSource::processRTPPacket(const sp<ABuffer> &buffer) {
+    int32_t rtpTime;
+    if (buffer->meta()->findInt32("rtp-time", &rtpTime)) {
+        updateJitter((uint32_t)rtpTime, ALooper::GetNowUs());
+    }
+
     if (queuePacket(buffer) && mAssembler != NULL) {
         mAssembler->onPacketReceived(this);
     }
@@ -106,6 +121,7 @@ bool ARTPSource::queuePacket(const sp<ABuffer> &buffer) {
     uint32_t seqNum = (uint32_t)buffer->int32Data();
 
     if (mNumBuffersReceived++ == 0) {
+        mBaseSeqNumber = seqNum;
         mHighestSeqNumber = seqNum;
         mQueue.push_back(buffer);
         return true;
@@ -151,9 +167,15 @@ bool ARTPSource::queuePacket(const sp<ABuffer> &buffer) {
 
     buffer->setInt32Data(seqNum);
 
-    List<sp<ABuffer> >::iterator it = mQueue.begin();
-    while (it != mQueue.end() && (uint32_t)(*it)->int32Data() < seqNum) {
-        ++it;
+    // Packets mostly arrive in order, so look for the place of this one from
+    // the back of the queue, which finds it right away.
+    List<sp<ABuffer> >::iterator it = mQueue.end();
+    while (it != mQueue.begin()) {
+        List<sp<ABuffer> >::iterator prev = it;
+        if ((uint32_t)(*--prev)->int32Data() < seqNum) {
+            break;
+        }
+        it = prev;
     }
 
     if (it != mQueue.end() && (uint32_t)(*it)->int32Data() == seqNum) {
@@ -166,6 +188,48 @@ bool ARTPSource::queuePacket(const sp<ABuffer> &buffer) {
     return true;
 }
 
+void ARTPSource::updateJitter(uint32_t rtpTime, int64_t arrivalUs) {
+    if (mClockRate <= 0) {
+        return;
+    }
+
+    if (mLastArrivalUs >= 0) {
+        // the difference between the transit times of this and the last
+        // packet, in RTP timestamp units
+        int64_t arrivalDelta = (arrivalUs - mLastArrivalUs) * mClockRate / 1000000ll;
+        int64_t rtpDelta = (int64_t)rtpTime - (int64_t)mLastRTPTime;
+        if (rtpDelta > INT32_MAX) {
+            rtpDelta -= 1ll << 32;
+        } else if (rtpDelta < INT32_MIN) {
+            rtpDelta += 1ll << 32;
+        }
+        int64_t d = arrivalDelta - rtpDelta;
+        if (d < 0) {
+            d = -d;
+        }
+        mJitter += d - ((mJitter + 8) >> 4);
+    }
+
+    mLastArrivalUs = arrivalUs;
+    mLastRTPTime = rtpTime;
+}
+
+uint32_t ARTPSource::getNumPacketsExpected() const {
+    if (mNumBuffersReceived == 0 || mHighestSeqNumber < mBaseSeqNumber) {
+        return 0;
+    }
+    return mHighestSeqNumber - mBaseSeqNumber + 1;
+}
+
+void ARTPSource::getStats(Stats *stats) const {
+    stats->mNumPacketsExpected = getNumPacketsExpected();
+    stats->mNumPacketsReceived = mNumBuffersReceived;
+    stats->mNumPacketsLost =
+        (int64_t)stats->mNumPacketsExpected - mNumBuffersReceived;
+    stats->mJitterUs =
+        mClockRate > 0 ? (mJitter >> 4) * 1000000ll / mClockRate : 0;
+}
+
 void ARTPSource::byeReceived() {
     mAssembler->onByeReceived();
 }
@@ -242,21 +306,45 @@ void ARTPSource::addReceiverReport(const sp<ABuffer> &buffer) {
     data[10] = (mID >> 8) & 0xff;
     data[11] = mID & 0xff;
 
-    data[12] = 0x00;  // fraction lost
+    uint32_t expected = getNumPacketsExpected();
+    int64_t expectedInterval = (int64_t)expected - mExpectedPrior;
+    int64_t lostInterval = expectedInterval - (mNumBuffersReceived - mReceivedPrior);
+    mExpectedPrior = expected;
+    mReceivedPrior = mNumBuffersReceived;
+
+    uint8_t fractionLost = 0;
+    if (expectedInterval > 0 && lostInterval > 0) {
+        int64_t fraction = (lostInterval << 8) / expectedInterval;
+        fractionLost = fraction > 255 ? 255 : fraction;
+    }
+
+    // a signed 24 bit number
+    int64_t lost = (int64_t)expected - mNumBuffersReceived;
+    if (lost > 0x7fffff) {
+        lost = 0x7fffff;
+    } else if (lost < -0x800000) {
+        lost = -0x800000;
+    }
+    uint32_t cumulativeLost = (uint32_t)(lost & 0xffffff);
+
+    int64_t jitter64 = mJitter >> 4;
+    uint32_t jitter = jitter64 > UINT32_MAX ? UINT32_MAX : (uint32_t)jitter64;
+
+    data[12] = fractionLost;
 
-    data[13] = 0x00;  // cumulative lost
-    data[14] = 0x00;
-    data[15] = 0x00;
+    data[13] = cumulativeLost >> 16;
+    data[14] = (cumulativeLost >> 8) & 0xff;
+    data[15] = cumulativeLost & 0xff;
 
     data[16] = mHighestSeqNumber >> 24;
     data[17] = (mHighestSeqNumber >> 16) & 0xff;
     data[18] = (mHighestSeqNumber >> 8) & 0xff;
     data[19] = mHighestSeqNumber & 0xff;
 
-    data[20] = 0x00;  // Interarrival jitter
-    data[21] = 0x00;
-    data[22] = 0x00;
-    data[23] = 0x00;
+    data[20] = jitter >> 24;  // Interarrival jitter
+    data[21] = (jitter >> 16) & 0xff;
+    data[22] = (jitter >> 8) & 0xff;
+    data[23] = jitter & 0xff;
 
     uint32_t LSR = 0;
     uint32_t DLSR = 0;
@@ -46,11 +46,35 @@ struct ARTPSource : public RefBase {
     void addReceiverReport(const sp<ABuffer> &buffer);
     void addFIR(const sp<ABuffer> &buffer);
 
+    // The reception statistics of RFC 3550, as sent in receiver reports.
+    struct Stats {
+        uint32_t mNumPacketsExpected;
+        int32_t mNumPacketsReceived;
+        // negative if more packets were duplicated than lost
+        int64_t mNumPacketsLost;
+        // the interarrival jitter
+        int64_t mJitterUs;
+    };
+    void getStats(Stats *stats) const;
+
 private:
     uint32_t mID;
+    uint32_t mBaseSeqNumber;
     uint32_t mHighestSeqNumber;
     int32_t mNumBuffersReceived;
 
+    // the expected and received packets at the last receiver report
+    uint32_t mExpectedPrior;
+    int32_t mReceivedPrior;
+
+    // the RTP clock rate, or 0 if unknown
+    int32_t mClockRate;
+    // the arrival and RTP times of the last packet, and the interarrival
+    // jitter in RTP timestamp units, scaled by 16 as in RFC 3550 A.8
+    int64_t mLastArrivalUs;
+    uint32_t mLastRTPTime;
+    int64_t mJitter;
+
     List<sp<ABuffer> > mQueue;
     sp<ARTPAssembler> mAssembler;
 
@@ -64,6 +88,8 @@ private:
     sp<AMessage> mNotify;
 
     bool queuePacket(const sp<ABuffer> &buffer);
+    void updateJitter(uint32_t rtpTime, int64_t arrivalUs);
+    uint32_t getNumPacketsExpected() const;
 
     DISALLOW_EVIL_CONSTRUCTORS(ARTPSource);
 };
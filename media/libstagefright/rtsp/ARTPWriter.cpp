@@ -20,6 +20,7 @@
 
 #include "ARTPWriter.h"
 
+#include <errno.h>
 #include <fcntl.h>
 
 #include <media/stagefright/foundation/ABuffer.h>
@@ -48,7 +49,8 @@ ARTPWriter::ARTPWriter(int fd)
     : mFlags(0),
       mFd(dup(fd)),
       mLooper(new ALooper),
-      mReflector(new AHandlerReflector<ARTPWriter>(this)) {
+      mReflector(new AHandlerReflector<ARTPWriter>(this)),
+      mNumQueuedPackets(0) {
     CHECK_GE(fd, 0);
 
     mLooper->setName("rtp writer");
@@ -327,6 +329,59 @@ void ARTPWriter::send(const sp<ABuffer> &buffer, bool isRTCP) {
 #endif
 }
 
+uint8_t *ARTPWriter::queueRTPPacket(
+        size_t headerSize, const uint8_t *payload, size_t payloadSize) {
+    CHECK_LE(headerSize, (size_t)kMaxHeaderSize);
+
+    if (mNumQueuedPackets == kMaxBatchSize) {
+        sendRTPPackets();
+    }
+
+    size_t i = mNumQueuedPackets++;
+
+    struct iovec *iov = mIOVecs[i];
+    iov[0].iov_base = mHeaders[i];
+    iov[0].iov_len = headerSize;
+    iov[1].iov_base = const_cast<uint8_t *>(payload);
+    iov[1].iov_len = payloadSize;
+
+    struct msghdr *hdr = &mMessages[i].msg_hdr;
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->msg_name = &mRTPAddr;
+    hdr->msg_namelen = sizeof(mRTPAddr);
+    hdr->msg_iov = iov;
+    hdr->msg_iovlen = 2;
+
+    return mHeaders[i];
+}
+
+void ARTPWriter::sendRTPPackets() {
+    size_t sent = 0;
+    while (sent < mNumQueuedPackets) {
+        int n = sendmmsg(mSocket, &mMessages[sent], mNumQueuedPackets - sent, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        CHECK_GT(n, 0);
+        sent += n;
+    }
+
+    for (size_t i = 0; i < mNumQueuedPackets; ++i) {
+        const struct iovec *iov = mIOVecs[i];
+        CHECK_EQ((size_t)mMessages[i].msg_len, iov[0].iov_len + iov[1].iov_len);
+
+#if LOG_TO_FILES
+        uint32_t ms = tolel(ALooper::GetNowUs() / 1000ll);
+        uint32_t length = tolel(iov[0].iov_len + iov[1].iov_len);
+        write(mRTPFd, &ms, sizeof(ms));
+        write(mRTPFd, &length, sizeof(length));
+        writev(mRTPFd, iov, 2);
+#endif
+    }
+
+    mNumQueuedPackets = 0;
+}
+
 void ARTPWriter::addSR(const sp<ABuffer> &buffer) {
     uint8_t *data = buffer->data() + buffer->size();
 
@@ -579,10 +634,9 @@ void ARTPWriter::sendAVCData(MediaBuffer *mediaBuf) {
     const uint8_t *mediaData =
         (const uint8_t *)mediaBuf->data() + mediaBuf->range_offset();
 
-    sp<ABuffer> buffer = new ABuffer(kMaxPacketSize);
-    if (mediaBuf->range_length() + 12 <= buffer->capacity()) {
+    if (mediaBuf->range_length() + 12 <= kMaxPacketSize) {
         // The data fits into a single packet
-        uint8_t *data = buffer->data();
+        uint8_t *data = queueRTPPacket(12, mediaData, mediaBuf->range_length());
         data[0] = 0x80;
         data[1] = (1 << 7) | PT;  // M-bit
         data[2] = (mSeqNo >> 8) & 0xff;
@@ -596,16 +650,9 @@ void ARTPWriter::sendAVCData(MediaBuffer *mediaBuf) {
         data[10] = (mSourceID >> 8) & 0xff;
         data[11] = mSourceID & 0xff;
 
-        memcpy(&data[12],
-               mediaData, mediaBuf->range_length());
-
-        buffer->setRange(0, mediaBuf->range_length() + 12);
-
-        send(buffer, false /* isRTCP */);
-
         ++mSeqNo;
         ++mNumRTPSent;
-        mNumRTPOctetsSent += buffer->size() - 12;
+        mNumRTPOctetsSent += mediaBuf->range_length();
     } else {
         // FU-A
 
@@ -616,12 +663,12 @@ void ARTPWriter::sendAVCData(MediaBuffer *mediaBuf) {
         while (offset < mediaBuf->range_length()) {
             size_t size = mediaBuf->range_length() - offset;
             bool lastPacket = true;
-            if (size + 12 + 2 > buffer->capacity()) {
+            if (size + 12 + 2 > kMaxPacketSize) {
                 lastPacket = false;
-                size = buffer->capacity() - 12 - 2;
+                size = kMaxPacketSize - 12 - 2;
             }
 
-            uint8_t *data = buffer->data();
+            uint8_t *data = queueRTPPacket(14, &mediaData[offset], size);
             data[0] = 0x80;
             data[1] = (lastPacket ? (1 << 7) : 0x00) | PT;  // M-bit
             data[2] = (mSeqNo >> 8) & 0xff;
@@ -644,21 +691,17 @@ void ARTPWriter::sendAVCData(MediaBuffer *mediaBuf) {
                 | (lastPacket ? 0x40 : 0x00)
                 | (nalType & 0x1f);
 
-            memcpy(&data[14], &mediaData[offset], size);
-
-            buffer->setRange(0, 14 + size);
-
-            send(buffer, false /* isRTCP */);
-
             ++mSeqNo;
             ++mNumRTPSent;
-            mNumRTPOctetsSent += buffer->size() - 12;
+            mNumRTPOctetsSent += 2 + size;
 
             firstPacket = false;
             offset += size;
         }
     }
 
+    sendRTPPackets();
+
     mLastRTPTime = rtpTime;
     mLastNTPTime = GetNowNTP();
 }
@@ -683,16 +726,13 @@ void ARTPWriter::sendH263Data(MediaBuffer *mediaBuf) {
     size_t size = mediaBuf->range_length();
 
     while (offset < size) {
-        sp<ABuffer> buffer = new ABuffer(kMaxPacketSize);
-        // CHECK_LE(mediaBuf->range_length() -2 + 14, buffer->capacity());
-
         size_t remaining = size - offset;
-        bool lastPacket = (remaining + 14 <= buffer->capacity());
+        bool lastPacket = (remaining + 14 <= kMaxPacketSize);
         if (!lastPacket) {
-            remaining = buffer->capacity() - 14;
+            remaining = kMaxPacketSize - 14;
         }
 
-        uint8_t *data = buffer->data();
+        uint8_t *data = queueRTPPacket(14, &mediaData[offset], remaining);
         data[0] = 0x80;
         data[1] = (lastPacket ? 0x80 : 0x00) | PT;  // M-bit
         data[2] = (mSeqNo >> 8) & 0xff;
@@ -709,18 +749,15 @@ void ARTPWriter::sendH263Data(MediaBuffer *mediaBuf) {
         data[12] = (offset == 2) ? 0x04 : 0x00;  // P=?, V=0
         data[13] = 0x00;  // PLEN = PEBIT = 0
 
-        memcpy(&data[14], &mediaData[offset], remaining);
         offset += remaining;
 
-        buffer->setRange(0, remaining + 14);
-
-        send(buffer, false /* isRTCP */);
-
         ++mSeqNo;
         ++mNumRTPSent;
-        mNumRTPOctetsSent += buffer->size() - 12;
+        mNumRTPOctetsSent += 2 + remaining;
     }
 
+    sendRTPPackets();
+
     mLastRTPTime = rtpTime;
     mLastNTPTime = GetNowNTP();
 }
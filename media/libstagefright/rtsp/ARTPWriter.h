@@ -26,6 +26,7 @@
 
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #define LOG_TO_FILES    0
 
@@ -61,6 +62,13 @@ private:
         kFlagEOS      = 2,
     };
 
+    enum {
+        // the most RTP packets handed to sendmmsg() at once
+        kMaxBatchSize = 32,
+        // 12 bytes RTP header + 2 bytes payload header
+        kMaxHeaderSize = 14,
+    };
+
     Mutex mLock;
     Condition mCondition;
     uint32_t mFlags;
@@ -94,6 +102,13 @@ private:
 
     int32_t mNumSRsSent;
 
+    // The RTP packets of the access unit being sent. Each is gathered from
+    // its header in |mHeaders| and its payload in the MediaBuffer.
+    uint8_t mHeaders[kMaxBatchSize][kMaxHeaderSize];
+    struct iovec mIOVecs[kMaxBatchSize][2];
+    struct mmsghdr mMessages[kMaxBatchSize];
+    size_t mNumQueuedPackets;
+
     enum {
         INVALID,
         H264,
@@ -120,6 +135,13 @@ private:
 
     void send(const sp<ABuffer> &buffer, bool isRTCP);
 
+    // Queues an RTP packet of a |headerSize| byte header, which the caller
+    // fills in through the returned pointer, followed by |payload|, which
+    // must stay valid until sendRTPPackets().
+    uint8_t *queueRTPPacket(
+            size_t headerSize, const uint8_t *payload, size_t payloadSize);
+    void sendRTPPackets();
+
     DISALLOW_EVIL_CONSTRUCTORS(ARTPWriter);
 };
 
@@ -67,6 +67,54 @@ LOCAL_CFLAGS += -Werror -Wall
 
 include $(BUILD_NATIVE_TEST)
 
+# Build the benchmarks.
+include $(CLEAR_VARS)
+LOCAL_ADDITIONAL_DEPENDENCIES := $(LOCAL_PATH)/Android.mk
+
+LOCAL_MODULE := FileSource_benchmark
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+	FileSource_benchmark.cpp \
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright \
+	libutils \
+
+LOCAL_CFLAGS += -Werror -Wall
+
+include $(BUILD_NATIVE_BENCHMARK)
+
+include $(CLEAR_VARS)
+LOCAL_ADDITIONAL_DEPENDENCIES := $(LOCAL_PATH)/Android.mk
+
+LOCAL_MODULE := ESQueue_benchmark
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+	ESQueue_benchmark.cpp \
+
+LOCAL_STATIC_LIBRARIES := \
+	libstagefright_mpeg2ts \
+
+LOCAL_SHARED_LIBRARIES := \
+	libcrypto \
+	libmedia \
+	libstagefright \
+	libstagefright_foundation \
+	libutils \
+	liblog \
+
+LOCAL_C_INCLUDES := \
+	frameworks/av/media/libstagefright \
+	frameworks/native/include/media/openmax \
+
+LOCAL_CFLAGS += -Werror -Wall
+
+include $(BUILD_NATIVE_BENCHMARK)
+
 # Include subdirectory makefiles
 # ============================================================
 
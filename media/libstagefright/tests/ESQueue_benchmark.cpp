@@ -0,0 +1,148 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the start code search of getNextNALUnit() against a byte at a time
+// search, and the rate at which ElementaryStreamQueue splits an H.264 stream
+// that arrives in PES payloads into access units.
+
+#include <benchmark/benchmark.h>
+
+#include <stdlib.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <utils/Vector.h>
+
+#include "include/avc_utils.h"
+#include "mpeg2ts/ESQueue.h"
+
+using namespace android;
+
+namespace {
+
+const size_t kNumAccessUnits = 256;
+const size_t kAccessUnitSize = 16 * 1024;
+const size_t kPayloadSize = 184 * 64;
+
+// An H.264 elementary stream of an access unit delimiter and a slice per
+// access unit. The slices are random bytes without zeros, so that they hold
+// no start codes, but as many 0x01 bytes as compressed data does.
+class TestStream {
+public:
+    TestStream() {
+        static const uint8_t kDelimiter[] = { 0x00, 0x00, 0x00, 0x01, 0x09, 0xf0 };
+        static const uint8_t kSliceHeader[] = { 0x00, 0x00, 0x00, 0x01, 0x41, 0x80 };
+
+        srand(1);
+        for (size_t i = 0; i < kNumAccessUnits; ++i) {
+            mData.appendArray(kDelimiter, sizeof(kDelimiter));
+            mData.appendArray(kSliceHeader, sizeof(kSliceHeader));
+            for (size_t j = 0; j < kAccessUnitSize; ++j) {
+                mData.push(rand() % 255 + 1);
+            }
+        }
+    }
+
+    const uint8_t *data() const { return mData.array(); }
+    size_t size() const { return mData.size(); }
+
+private:
+    Vector<uint8_t> mData;
+};
+
+const TestStream &GetStream() {
+    static const TestStream stream;
+    return stream;
+}
+
+// getNextNALUnit() as it was, searching a byte at a time.
+size_t CountNALUnitsBytewise(const uint8_t *data, size_t size) {
+    size_t count = 0;
+    size_t offset = 0;
+    for (;;) {
+        while (offset + 2 < size
+                && !(data[offset + 2] == 0x01 && data[offset] == 0x00
+                        && data[offset + 1] == 0x00)) {
+            ++offset;
+        }
+        if (offset + 2 >= size) {
+            return count;
+        }
+        offset += 3;
+        while (offset < size
+                && !(data[offset] == 0x01 && data[offset - 1] == 0x00
+                        && data[offset - 2] == 0x00)) {
+            ++offset;
+        }
+        ++count;
+        if (offset == size) {
+            return count;
+        }
+        offset -= 2;
+    }
+}
+
+}  // namespace
+
+static void BM_FindStartCodesBytewise(benchmark::State &state) {
+    const TestStream &stream = GetStream();
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(CountNALUnitsBytewise(stream.data(), stream.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * stream.size());
+}
+BENCHMARK(BM_FindStartCodesBytewise);
+
+static void BM_GetNextNALUnit(benchmark::State &state) {
+    const TestStream &stream = GetStream();
+    while (state.KeepRunning()) {
+        const uint8_t *data = stream.data();
+        size_t size = stream.size();
+        const uint8_t *nalStart;
+        size_t nalSize;
+        size_t count = 0;
+        while (getNextNALUnit(&data, &size, &nalStart, &nalSize, true) == OK) {
+            ++count;
+        }
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetBytesProcessed(state.iterations() * stream.size());
+}
+BENCHMARK(BM_GetNextNALUnit);
+
+// Appends the stream in PES payload sized pieces and dequeues the access
+// units as they complete, as ATSParser does.
+static void BM_DequeueAccessUnitH264(benchmark::State &state) {
+    const TestStream &stream = GetStream();
+    while (state.KeepRunning()) {
+        ElementaryStreamQueue queue(ElementaryStreamQueue::H264);
+        size_t count = 0;
+        for (size_t offset = 0; offset < stream.size(); offset += kPayloadSize) {
+            size_t size = stream.size() - offset;
+            if (size > kPayloadSize) {
+                size = kPayloadSize;
+            }
+            queue.appendData(stream.data() + offset, size, offset);
+            while (queue.dequeueAccessUnit() != NULL) {
+                ++count;
+            }
+        }
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetBytesProcessed(state.iterations() * stream.size());
+}
+BENCHMARK(BM_DequeueAccessUnitH264);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares FileSource reads through a system call each with reads from a mapping of the
+// file, on the access patterns of opening an MP4 file: walking box headers, and reading
+// sample table entries one at a time.
+
+#include <benchmark/benchmark.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <media/stagefright/FileSource.h>
+
+using namespace android;
+
+namespace {
+
+const size_t kFileSize = 4 * 1024 * 1024;
+const size_t kTableSize = 256 * 1024;
+
+// A file of random bytes, removed at exit.
+class TestFile {
+public:
+    TestFile() {
+        strcpy(mPath, "/data/local/tmp/FileSource_benchmark_XXXXXX");
+        int fd = mkstemp(mPath);
+        srand(1);
+        for (size_t i = 0; i < kFileSize; i += sizeof(mBlock)) {
+            for (size_t j = 0; j < sizeof(mBlock); ++j) {
+                mBlock[j] = rand();
+            }
+            (void)write(fd, mBlock, sizeof(mBlock));
+        }
+        close(fd);
+    }
+
+    ~TestFile() {
+        unlink(mPath);
+    }
+
+    // FileSource takes ownership of the file descriptor.
+    sp<FileSource> open(bool mapped) const {
+        sp<FileSource> source = new FileSource(::open(mPath, O_RDONLY), 0, kFileSize);
+        if (mapped) {
+            source->map();
+        }
+        return source;
+    }
+
+private:
+    char mPath[64];
+    uint8_t mBlock[4096];
+};
+
+const TestFile &GetFile() {
+    static const TestFile file;
+    return file;
+}
+
+}  // namespace
+
+// Reads 8 byte headers at pseudo random offsets, as parsing boxes does.
+static void BM_ReadHeaders(benchmark::State &state) {
+    sp<FileSource> source = GetFile().open(state.range(0));
+    source->setAccessPattern(DataSource::kAccessRandom);
+    uint32_t offset = 0;
+    while (state.KeepRunning()) {
+        uint8_t header[8];
+        for (size_t i = 0; i < 1024; ++i) {
+            offset = (offset * 1103515245 + 12345) % (kFileSize - sizeof(header));
+            benchmark::DoNotOptimize(source->readAt(offset, header, sizeof(header)));
+        }
+    }
+}
+BENCHMARK(BM_ReadHeaders)->Arg(0)->Arg(1);
+
+// Reads a table of 32 bit entries one entry at a time, as SampleIterator does.
+static void BM_ReadTableEntries(benchmark::State &state) {
+    sp<FileSource> source = GetFile().open(state.range(0));
+    while (state.KeepRunning()) {
+        uint32_t sum = 0;
+        for (size_t offset = 0; offset < kTableSize; offset += 4) {
+            uint32_t entry;
+            source->readAt(offset, &entry, sizeof(entry));
+            sum += entry;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_ReadTableEntries)->Arg(0)->Arg(1);
+
+// Reads the same table in place, as SampleIterator does if the file is mapped.
+static void BM_ReadTableMapped(benchmark::State &state) {
+    sp<FileSource> source = GetFile().open(true);
+    const uint32_t *table = (const uint32_t *)source->getMappedPointer(0, kTableSize);
+    if (table == NULL) {
+        state.SkipWithError("cannot map the file");
+        return;
+    }
+    while (state.KeepRunning()) {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < kTableSize / 4; ++i) {
+            sum += table[i];
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(BM_ReadTableMapped);
+
+BENCHMARK_MAIN();
@@ -8,6 +8,7 @@ LOCAL_SANITIZE := unsigned-integer-overflow signed-integer-overflow cfi
 LOCAL_SANITIZE_DIAG := cfi
 
 LOCAL_SRC_FILES:= EbmlUtil.cpp        \
+                  WebmClusterBuilder.cpp \
                   WebmElement.cpp     \
                   WebmFrame.cpp       \
                   WebmFrameThread.cpp \
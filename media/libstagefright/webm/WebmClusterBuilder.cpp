@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "WebmClusterBuilder"
+
+#include "EbmlUtil.h"
+#include "WebmClusterBuilder.h"
+#include "WebmConstants.h"
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <utils/Log.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace webm;
+
+namespace android {
+
+WebmClusterBuilder::WebmClusterBuilder()
+    : mTimecode(0),
+      mData(NULL),
+      mCapacity(0) {
+}
+
+WebmClusterBuilder::~WebmClusterBuilder() {
+    free(mData);
+}
+
+void WebmClusterBuilder::start(uint64_t timecode) {
+    mTimecode = timecode;
+    mFrames.clear();
+}
+
+void WebmClusterBuilder::addFrame(const sp<WebmFrame>& frame) {
+    mFrames.push_back(frame);
+}
+
+status_t WebmClusterBuilder::write(int fd, uint64_t& size) {
+    // The elements live on the stack; they only lay out the bytes, the same as WebmMaster would
+    // for a cluster of them.
+    WebmUnsigned timecode(kMkvTimecode, mTimecode);
+    uint64_t payloadSize = timecode.totalSize();
+    for (size_t i = 0; i < mFrames.size(); ++i) {
+        const sp<WebmFrame>& f = mFrames[i];
+        WebmSimpleBlock block(
+                f->mType == kVideoType ? kVideoTrackNum : kAudioTrackNum,
+                f->mAbsTimecode - mTimecode,
+                f->mKey,
+                f->mData);
+        payloadSize += block.totalSize();
+    }
+    size = sizeOf(kMkvCluster) + sizeOf(encodeUnsigned(payloadSize)) + payloadSize;
+
+    if (size > mCapacity) {
+        free(mData);
+        mData = (uint8_t *)malloc(size);
+        if (mData == NULL) {
+            mCapacity = 0;
+            return NO_MEMORY;
+        }
+        mCapacity = size;
+    }
+
+    uint8_t *cur = mData;
+    cur += serializeCodedUnsigned(kMkvCluster, cur);
+    cur += serializeCodedUnsigned(encodeUnsigned(payloadSize), cur);
+    cur += timecode.serializeInto(cur);
+    for (size_t i = 0; i < mFrames.size(); ++i) {
+        const sp<WebmFrame>& f = mFrames[i];
+        WebmSimpleBlock block(
+                f->mType == kVideoType ? kVideoTrackNum : kAudioTrackNum,
+                f->mAbsTimecode - mTimecode,
+                f->mKey,
+                f->mData);
+        cur += block.serializeInto(cur);
+    }
+    CHECK(cur == mData + size);
+    mFrames.clear();
+
+    uint64_t written = 0;
+    while (written < size) {
+        ssize_t n = ::write(fd, mData + written, size - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ALOGE("failed to write cluster; errno = %d", errno);
+            return -errno;
+        }
+        written += n;
+    }
+    return OK;
+}
+
+} /* namespace android */
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WEBMCLUSTERBUILDER_H_
+#define WEBMCLUSTERBUILDER_H_
+
+#include "WebmFrame.h"
+
+#include <utils/Errors.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+// Builds a cluster -- its timecode and a simple block per frame -- in a buffer that is kept from
+// one cluster to the next, and writes it out with a single write(), instead of allocating a
+// WebmElement per block and mapping the file for every cluster.
+class WebmClusterBuilder {
+public:
+    WebmClusterBuilder();
+    ~WebmClusterBuilder();
+
+    // Starts a cluster at |timecode|, dropping the frames of the previous one.
+    void start(uint64_t timecode);
+    void addFrame(const sp<WebmFrame>& frame);
+    size_t numFrames() const {
+        return mFrames.size();
+    }
+
+    // Writes the cluster at the current offset of |fd|; |size| is set to the size of the cluster.
+    status_t write(int fd, uint64_t& size);
+
+private:
+    uint64_t mTimecode;
+    Vector<sp<WebmFrame> > mFrames;
+    uint8_t *mData;
+    uint64_t mCapacity;
+
+    DISALLOW_EVIL_CONSTRUCTORS(WebmClusterBuilder);
+};
+
+} /* namespace android */
+#endif /* WEBMCLUSTERBUILDER_H_ */
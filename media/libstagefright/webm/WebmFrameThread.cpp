@@ -72,7 +72,7 @@ WebmFrameSinkThread::WebmFrameSinkThread(
         const uint64_t& off,
         sp<WebmFrameSourceThread> videoThread,
         sp<WebmFrameSourceThread> audioThread,
-        List<sp<WebmElement> >& cues)
+        Vector<uint8_t>& cues)
     : mFd(fd),
       mSegmentDataStart(off),
       mVideoFrames(videoThread->mSink),
@@ -86,7 +86,7 @@ WebmFrameSinkThread::WebmFrameSinkThread(
         const uint64_t& off,
         LinkedBlockingQueue<const sp<WebmFrame> >& videoSource,
         LinkedBlockingQueue<const sp<WebmFrame> >& audioSource,
-        List<sp<WebmElement> >& cues)
+        Vector<uint8_t>& cues)
     : mFd(fd),
       mSegmentDataStart(off),
       mVideoFrames(videoSource),
@@ -95,41 +95,15 @@ WebmFrameSinkThread::WebmFrameSinkThread(
       mDone(true) {
 }
 
-// Initializes a webm cluster with its starting timecode.
-//
-// frames:
-//   sequence of input audio/video frames received from the source.
-//
-// clusterTimecodeL:
-//   the starting timecode of the cluster; this is the timecode of the first
-//   frame since frames are ordered by timestamp.
-//
-// children:
-//   list to hold child elements in a webm cluster (start timecode and
-//   simple blocks).
-//
-// static
-void WebmFrameSinkThread::initCluster(
-    List<const sp<WebmFrame> >& frames,
-    uint64_t& clusterTimecodeL,
-    List<sp<WebmElement> >& children) {
-    CHECK(!frames.empty() && children.empty());
-
-    const sp<WebmFrame> f = *(frames.begin());
-    clusterTimecodeL = f->mAbsTimecode;
-    WebmUnsigned *clusterTimecode = new WebmUnsigned(kMkvTimecode, clusterTimecodeL);
-    children.clear();
-    children.push_back(clusterTimecode);
-}
-
-void WebmFrameSinkThread::writeCluster(List<sp<WebmElement> >& children) {
-    // children must contain at least one simpleblock and its timecode
-    CHECK_GE(children.size(), 2);
+void WebmFrameSinkThread::writeCluster() {
+    // the cluster must contain at least one simpleblock
+    CHECK_GT(mCluster.numFrames(), 0u);
 
     uint64_t size;
-    sp<WebmElement> cluster = new WebmMaster(kMkvCluster, children);
-    cluster->write(mFd, size);
-    children.clear();
+    status_t err = mCluster.write(mFd, size);
+    if (err != OK) {
+        ALOGE("failed to write cluster of %" PRIu64 " bytes: %d", size, err);
+    }
 }
 
 // Write out (possibly multiple) webm cluster(s) from frames split on video key frames.
@@ -141,9 +115,10 @@ void WebmFrameSinkThread::flushFrames(List<const sp<WebmFrame> >& frames, bool l
         return;
     }
 
-    uint64_t clusterTimecodeL;
-    List<sp<WebmElement> > children;
-    initCluster(frames, clusterTimecodeL, children);
+    // the starting timecode of the cluster; this is the timecode of the first frame since
+    // frames are ordered by timestamp.
+    uint64_t clusterTimecodeL = (*frames.begin())->mAbsTimecode;
+    mCluster.start(clusterTimecodeL);
 
     uint64_t cueTime = clusterTimecodeL;
     off_t fpos = ::lseek(mFd, 0, SEEK_CUR);
@@ -166,12 +141,13 @@ void WebmFrameSinkThread::flushFrames(List<const sp<WebmFrame> >& frames, bool l
         }
 
         if (f->mAbsTimecode - clusterTimecodeL > INT16_MAX) {
-            writeCluster(children);
-            initCluster(frames, clusterTimecodeL, children);
+            writeCluster();
+            clusterTimecodeL = f->mAbsTimecode;
+            mCluster.start(clusterTimecodeL);
         }
 
         frames.erase(frames.begin());
-        children.push_back(f->SimpleBlock(clusterTimecodeL));
+        mCluster.addFrame(f);
     }
 
     // equivalent to last==false
@@ -180,13 +156,18 @@ void WebmFrameSinkThread::flushFrames(List<const sp<WebmFrame> >& frames, bool l
         const sp<WebmFrame> secondLastFrame = *(frames.begin());
         if (secondLastFrame->mType == kVideoType) {
             frames.erase(frames.begin());
-            children.push_back(secondLastFrame->SimpleBlock(clusterTimecodeL));
+            mCluster.addFrame(secondLastFrame);
         }
     }
 
-    writeCluster(children);
+    writeCluster();
+
+    // Serialize the cue point right away, so that stopping only has to write the cues out.
     sp<WebmElement> cuePoint = WebmElement::CuePointEntry(cueTime, 1, fpos - mSegmentDataStart);
-    mCues.push_back(cuePoint);
+    size_t cuePointSize = cuePoint->totalSize();
+    size_t cuesSize = mCues.size();
+    mCues.insertAt(cuesSize, cuePointSize);
+    cuePoint->serializeInto(mCues.editArray() + cuesSize);
 }
 
 status_t WebmFrameSinkThread::start() {
@@ -204,14 +185,21 @@ status_t WebmFrameSinkThread::stop() {
 void WebmFrameSinkThread::run() {
     int numVideoKeyFrames = 0;
     List<const sp<WebmFrame> > outstandingFrames;
+    // The frame at the head of each queue is held here until it is placed, so that a frame is
+    // taken with one lock of its queue instead of a peek and a take.
+    sp<WebmFrame> videoFrame, audioFrame;
     while (!mDone) {
-        ALOGV("wait v frame");
-        const sp<WebmFrame> videoFrame = mVideoFrames.peek();
-        ALOGV("v frame: %p", videoFrame.get());
+        if (videoFrame == NULL) {
+            ALOGV("wait v frame");
+            videoFrame = mVideoFrames.take();
+            ALOGV("v frame: %p", videoFrame.get());
+        }
 
-        ALOGV("wait a frame");
-        const sp<WebmFrame> audioFrame = mAudioFrames.peek();
-        ALOGV("a frame: %p", audioFrame.get());
+        if (audioFrame == NULL) {
+            ALOGV("wait a frame");
+            audioFrame = mAudioFrames.take();
+            ALOGV("a frame: %p", audioFrame.get());
+        }
 
         if (videoFrame->mEos && audioFrame->mEos) {
             break;
@@ -219,14 +207,14 @@ void WebmFrameSinkThread::run() {
 
         if (*audioFrame < *videoFrame) {
             ALOGV("take a frame");
-            mAudioFrames.take();
             outstandingFrames.push_back(audioFrame);
+            audioFrame.clear();
         } else {
             ALOGV("take v frame");
-            mVideoFrames.take();
             outstandingFrames.push_back(videoFrame);
             if (videoFrame->mKey)
                 numVideoKeyFrames++;
+            videoFrame.clear();
         }
 
         if (numVideoKeyFrames == 2) {
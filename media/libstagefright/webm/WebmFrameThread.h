@@ -17,6 +17,7 @@
 #ifndef WEBMFRAMETHREAD_H_
 #define WEBMFRAMETHREAD_H_
 
+#include "WebmClusterBuilder.h"
 #include "WebmFrame.h"
 #include "LinkedBlockingQueue.h"
 
@@ -24,6 +25,7 @@
 #include <media/stagefright/MediaSource.h>
 
 #include <utils/List.h>
+#include <utils/Vector.h>
 #include <utils/Errors.h>
 
 #include <pthread.h>
@@ -61,14 +63,14 @@ public:
             const uint64_t& off,
             sp<WebmFrameSourceThread> videoThread,
             sp<WebmFrameSourceThread> audioThread,
-            List<sp<WebmElement> >& cues);
+            Vector<uint8_t>& cues);
 
     WebmFrameSinkThread(
             const int& fd,
             const uint64_t& off,
             LinkedBlockingQueue<const sp<WebmFrame> >& videoSource,
             LinkedBlockingQueue<const sp<WebmFrame> >& audioSource,
-            List<sp<WebmElement> >& cues);
+            Vector<uint8_t>& cues);
 
     void run();
     bool running() {
@@ -82,15 +84,13 @@ private:
     const uint64_t& mSegmentDataStart;
     LinkedBlockingQueue<const sp<WebmFrame> >& mVideoFrames;
     LinkedBlockingQueue<const sp<WebmFrame> >& mAudioFrames;
-    List<sp<WebmElement> >& mCues;
+    // serialized cue points, appended to as clusters are written
+    Vector<uint8_t>& mCues;
+    WebmClusterBuilder mCluster;
 
     volatile bool mDone;
 
-    static void initCluster(
-            List<const sp<WebmFrame> >& frames,
-            uint64_t& clusterTimecodeL,
-            List<sp<WebmElement> >& children);
-    void writeCluster(List<sp<WebmElement> >& children);
+    void writeCluster();
     void flushFrames(List<const sp<WebmFrame> >& frames, bool last);
 };
 
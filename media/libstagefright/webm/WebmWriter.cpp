@@ -29,6 +29,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <inttypes.h>
 
 using namespace webm;
@@ -305,18 +306,28 @@ status_t WebmWriter::reset() {
         return err;
     }
 
-    sp<WebmElement> cues = new WebmMaster(kMkvCues, mCuePoints);
-    uint64_t cuesSize = cues->totalSize();
+    // The cue points are serialized already; only the header of the cues is left to build.
+    uint8_t cuesHeader[sizeof(uint32_t) + sizeof(uint64_t)];
+    int cuesHeaderSize = serializeCodedUnsigned(kMkvCues, cuesHeader);
+    cuesHeaderSize += serializeCodedUnsigned(
+            mCuePoints.isEmpty() ? kMkvUnknownLength : encodeUnsigned(mCuePoints.size()),
+            cuesHeader + cuesHeaderSize);
+    struct iovec cues[2];
+    cues[0].iov_base = cuesHeader;
+    cues[0].iov_len = cuesHeaderSize;
+    cues[1].iov_base = (void *)mCuePoints.array();
+    cues[1].iov_len = mCuePoints.size();
+    uint64_t cuesSize = cuesHeaderSize + mCuePoints.size();
     // TRICKY Even when the cues do fit in the space we reserved, if they do not fit
     // perfectly, we still need to check if there is enough "extra space" to write an
     // EBML void element.
     if (cuesSize != mEstimatedCuesSize && cuesSize > mEstimatedCuesSize - kMinEbmlVoidSize) {
         mCuesOffset = ::lseek(mFd, 0, SEEK_CUR);
-        cues->write(mFd, cuesSize);
+        ::writev(mFd, cues, 2);
     } else {
         uint64_t spaceSize;
         ::lseek(mFd, mCuesOffset, SEEK_SET);
-        cues->write(mFd, cuesSize);
+        ::writev(mFd, cues, 2);
         sp<WebmElement> space = new EbmlVoid(mEstimatedCuesSize - cuesSize);
         space->write(mFd, spaceSize);
     }
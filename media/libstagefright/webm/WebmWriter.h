@@ -72,7 +72,8 @@ private:
     uint64_t mEstimatedCuesSize;
 
     Mutex mLock;
-    List<sp<WebmElement> > mCuePoints;
+    // the cue points, serialized by the sink thread as it writes the clusters
+    Vector<uint8_t> mCuePoints;
 
     enum {
         kAudioIndex     =  0,
@@ -27,14 +27,18 @@
 
 #include <media/IHDCP.h>
 #include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaErrors.h>
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/ANetworkSession.h>
+#include <media/stagefright/foundation/AString.h>
 #include <ui/GraphicBuffer.h>
 
 namespace android {
 
+const int64_t MediaSender::kLatencyLogIntervalUs = 5000000ll;
+
 MediaSender::MediaSender(
         const sp<ANetworkSession> &netSession,
         const sp<AMessage> &notify)
@@ -44,6 +48,7 @@ MediaSender::MediaSender(
       mGeneration(0),
       mPrevTimeUs(-1ll),
       mInitDoneCount(0),
+      mLastLatencyLogUs(-1ll),
       mLogFile(NULL) {
     // mLogFile = fopen("/data/misc/log.ts", "wb");
 }
@@ -74,6 +79,8 @@ ssize_t MediaSender::addTrack(const sp<AMessage> &format, uint32_t flags) {
     info.mFormat = format;
     info.mFlags = flags;
     info.mPacketizerTrackIndex = -1;
+    info.mInPartialFrame = false;
+    memset(info.mLatency, 0, sizeof(info.mLatency));
 
     AString mime;
     CHECK(format->findString("mime", &mime));
@@ -211,6 +218,8 @@ status_t MediaSender::queueAccessUnit(
         return -ERANGE;
     }
 
+    accessUnit->meta()->setInt64("senderInputUs", ALooper::GetNowUs());
+
     if (mMode == MODE_TRANSPORT_STREAM) {
         TrackInfo *info = &mTrackInfos.editItemAt(trackIndex);
         info->mAccessUnits.push_back(accessUnit);
@@ -248,7 +257,9 @@ status_t MediaSender::queueAccessUnit(
             sp<ABuffer> accessUnit = *info->mAccessUnits.begin();
             info->mAccessUnits.erase(info->mAccessUnits.begin());
 
-            sp<ABuffer> tsPackets;
+            int64_t packetizeStartUs = ALooper::GetNowUs();
+
+            sp<ABuffer> &tsPackets = mTSPackets;
             status_t err = packetizeAccessUnit(
                     minTrackIndex, accessUnit, &tsPackets);
 
@@ -270,16 +281,98 @@ status_t MediaSender::queueAccessUnit(
             if (err != OK) {
                 return err;
             }
+
+            onAccessUnitSent(minTrackIndex, accessUnit, packetizeStartUs);
         }
     }
 
     TrackInfo *info = &mTrackInfos.editItemAt(trackIndex);
 
-    return info->mSender->queueBuffer(
+    int64_t packetizeStartUs = ALooper::GetNowUs();
+
+    status_t err = info->mSender->queueBuffer(
             accessUnit,
             info->mIsAudio ? 96 : 97 /* packetType */,
             info->mIsAudio
                 ? RTPSender::PACKETIZATION_AAC : RTPSender::PACKETIZATION_H264);
+
+    if (err == OK) {
+        onAccessUnitSent(trackIndex, accessUnit, packetizeStartUs);
+    }
+
+    return err;
+}
+
+void MediaSender::addLatency(
+        TrackInfo *info, LatencyStage stage, int64_t latencyUs) {
+    LatencyStats *stats = &info->mLatency[stage];
+    stats->mSumUs += latencyUs;
+    if (stats->mCount == 0 || latencyUs > stats->mMaxUs) {
+        stats->mMaxUs = latencyUs;
+    }
+    ++stats->mCount;
+}
+
+void MediaSender::onAccessUnitSent(
+        size_t trackIndex, const sp<ABuffer> &accessUnit,
+        int64_t packetizeStartUs) {
+    TrackInfo *info = &mTrackInfos.editItemAt(trackIndex);
+
+    int32_t partialFrame;
+    info->mInPartialFrame =
+        accessUnit->meta()->findInt32("partial-frame", &partialFrame)
+            && partialFrame;
+
+    int64_t encoderInputUs, encoderOutputUs, senderInputUs;
+    CHECK(accessUnit->meta()->findInt64("senderInputUs", &senderInputUs));
+
+    if (accessUnit->meta()->findInt64("encoderOutputUs", &encoderOutputUs)) {
+        if (accessUnit->meta()->findInt64("encoderInputUs", &encoderInputUs)) {
+            addLatency(info, STAGE_ENCODE, encoderOutputUs - encoderInputUs);
+        }
+        addLatency(info, STAGE_DELIVER, senderInputUs - encoderOutputUs);
+    }
+    addLatency(info, STAGE_MUX_WAIT, packetizeStartUs - senderInputUs);
+    addLatency(info, STAGE_PACKETIZE, ALooper::GetNowUs() - packetizeStartUs);
+
+    logLatencyIfNecessary();
+}
+
+void MediaSender::logLatencyIfNecessary() {
+    int64_t nowUs = ALooper::GetNowUs();
+    if (mLastLatencyLogUs < 0ll) {
+        mLastLatencyLogUs = nowUs;
+        return;
+    } else if (nowUs < mLastLatencyLogUs + kLatencyLogIntervalUs) {
+        return;
+    }
+    mLastLatencyLogUs = nowUs;
+
+    static const char *kStageNames[NUM_LATENCY_STAGES] = {
+        "encode", "deliver", "mux wait", "packetize",
+    };
+
+    for (size_t i = 0; i < mTrackInfos.size(); ++i) {
+        TrackInfo *info = &mTrackInfos.editItemAt(i);
+
+        AString s;
+        for (size_t j = 0; j < NUM_LATENCY_STAGES; ++j) {
+            const LatencyStats &stats = info->mLatency[j];
+            if (stats.mCount == 0) {
+                continue;
+            }
+            s.append(AStringPrintf(
+                    "%s%s %.2f/%.2f ms", s.empty() ? "" : ", ", kStageNames[j],
+                    stats.mSumUs / 1E3 / stats.mCount, stats.mMaxUs / 1E3));
+        }
+
+        if (!s.empty()) {
+            ALOGI("%s track %zu latency (avg/max): %s",
+                  info->mIsAudio ? "audio" : "video", i, s.c_str());
+        }
+
+        memset(info->mLatency, 0, sizeof(info->mLatency));
+    }
 }
 
 void MediaSender::onMessageReceived(const sp<AMessage> &msg) {
@@ -393,6 +486,23 @@ status_t MediaSender::packetizeAccessUnit(
 
     uint32_t flags = 0;
 
+    int32_t partialFrame;
+    if (accessUnit->meta()->findInt32("partial-frame", &partialFrame)
+            && partialFrame && !info.mInPartialFrame) {
+        flags |= TSPacketizer::IS_PARTIAL_FRAME;
+    }
+    if (info.mInPartialFrame) {
+        flags |= TSPacketizer::CONTINUES_FRAME;
+    }
+
+    if (mHDCP != NULL && !info.mIsAudio
+            && (flags & (TSPacketizer::IS_PARTIAL_FRAME
+                    | TSPacketizer::CONTINUES_FRAME))) {
+        // The HDCP counters go into the PES header of each frame.
+        ALOGE("Can't HDCP-encrypt partial frames");
+        return ERROR_UNSUPPORTED;
+    }
+
     bool isHDCPEncrypted = false;
     uint64_t inputCTR;
     uint8_t HDCP_private_data[16];
@@ -400,6 +510,7 @@ status_t MediaSender::packetizeAccessUnit(
     bool manuallyPrependSPSPPS =
         !info.mIsAudio
         && (info.mFlags & FLAG_MANUALLY_PREPEND_SPS_PPS)
+        && !info.mInPartialFrame
         && IsIDR(accessUnit);
 
     if (mHDCP != NULL && !info.mIsAudio) {
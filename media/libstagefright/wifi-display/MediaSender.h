@@ -38,6 +38,8 @@ struct TSPacketizer;
 // track to RTP channel or muxing all tracks into a single RTP channel and
 // using transport stream encapsulation.
 // Optionally the (video) data is encrypted using the provided hdcp object.
+// Access units with "partial-frame" set in their meta are parts of a video
+// frame, and are sent out as they arrive.
 struct MediaSender : public AHandler {
     enum {
         kWhatInitDone,
@@ -85,6 +87,24 @@ private:
         MODE_ELEMENTARY_STREAMS,
     };
 
+    // The stages of the path of an access unit, from the encoder input to
+    // the RTP sender, whose latency is logged every kLatencyLogIntervalUs.
+    enum LatencyStage {
+        STAGE_ENCODE,       // encoder input to encoder output
+        STAGE_DELIVER,      // encoder output to queueAccessUnit()
+        STAGE_MUX_WAIT,     // waiting for the access units of other tracks
+        STAGE_PACKETIZE,    // packetizing and queueing the RTP packets
+        NUM_LATENCY_STAGES,
+    };
+
+    struct LatencyStats {
+        int64_t mSumUs;
+        int64_t mMaxUs;
+        size_t mCount;
+    };
+
+    static const int64_t kLatencyLogIntervalUs;
+
     struct TrackInfo {
         sp<AMessage> mFormat;
         uint32_t mFlags;
@@ -92,6 +112,8 @@ private:
         List<sp<ABuffer> > mAccessUnits;
         ssize_t mPacketizerTrackIndex;
         bool mIsAudio;
+        bool mInPartialFrame;
+        LatencyStats mLatency[NUM_LATENCY_STAGES];
     };
 
     sp<ANetworkSession> mNetSession;
@@ -106,10 +128,14 @@ private:
 
     sp<TSPacketizer> mTSPacketizer;
     sp<RTPSender> mTSSender;
+    // reused for every access unit, RTPSender copies the packets out
+    sp<ABuffer> mTSPackets;
     int64_t mPrevTimeUs;
 
     size_t mInitDoneCount;
 
+    int64_t mLastLatencyLogUs;
+
     FILE *mLogFile;
 
     void onSenderNotify(const sp<AMessage> &msg);
@@ -118,6 +144,12 @@ private:
     void notifyError(status_t err);
     void notifyNetworkStall(size_t numBytesQueued);
 
+    void addLatency(TrackInfo *info, LatencyStage stage, int64_t latencyUs);
+    void onAccessUnitSent(
+            size_t trackIndex, const sp<ABuffer> &accessUnit,
+            int64_t packetizeStartUs);
+    void logLatencyIfNecessary();
+
     status_t packetizeAccessUnit(
             size_t trackIndex,
             sp<ABuffer> accessUnit,
@@ -54,6 +54,7 @@ Converter::Converter(
       mIsH264(false),
       mIsPCMAudio(false),
       mNeedToManuallyPrependSPSPPS(false),
+      mInPartialFrame(false),
       mDoMoreWorkPending(false)
 #if ENABLE_SILENCE_DETECTION
       ,mFirstSilentFrameUs(-1ll)
@@ -86,6 +87,7 @@ void Converter::releaseEncoder() {
     mInputBufferQueue.clear();
     mEncoderInputBuffers.clear();
     mEncoderOutputBuffers.clear();
+    mEncoderInputTimesUs.clear();
 }
 
 Converter::~Converter() {
@@ -190,6 +192,10 @@ status_t Converter::initEncoder() {
         // to recover from a lost/corrupted packet.
         mbs = (((width + 15) / 16) * ((height + 15) / 16) * 10) / 100;
         mOutputFormat->setInt32("intra-refresh-CIR-mbs", mbs);
+
+        if (mFlags & FLAG_OUTPUT_PARTIAL_FRAMES) {
+            mOutputFormat->setInt32("output-partial-frames", 1);
+        }
     }
 
     ALOGV("output format is '%s'", mOutputFormat->debugString(0).c_str());
@@ -644,6 +650,14 @@ status_t Converter::feedEncoderInputBuffers() {
         if (err != OK) {
             return err;
         }
+
+        if (mIsVideo && buffer != NULL) {
+            if (mEncoderInputTimesUs.size() == kMaxNumEncoderInputTimes) {
+                // the encoder dropped frames
+                mEncoderInputTimesUs.removeItemsAt(0);
+            }
+            mEncoderInputTimesUs.add(timeUs, ALooper::GetNowUs());
+        }
     }
 
     return OK;
@@ -763,10 +777,28 @@ status_t Converter::doMoreWork() {
                 if (mNeedToManuallyPrependSPSPPS
                         && mIsH264
                         && (mFlags & FLAG_PREPEND_CSD_IF_NECESSARY)
+                        && !mInPartialFrame
                         && IsIDR(buffer)) {
                     buffer = prependCSD(buffer);
                 }
 
+                // latency stamps, logged by MediaSender
+                bool partialFrame = (flags & MediaCodec::BUFFER_FLAG_PARTIAL_FRAME) != 0;
+                ssize_t index = mEncoderInputTimesUs.indexOfKey(timeUs);
+                if (index >= 0) {
+                    buffer->meta()->setInt64(
+                            "encoderInputUs", mEncoderInputTimesUs.valueAt(index));
+                    if (!partialFrame) {
+                        mEncoderInputTimesUs.removeItemsAt(index);
+                    }
+                }
+                buffer->meta()->setInt64("encoderOutputUs", ALooper::GetNowUs());
+
+                if (partialFrame) {
+                    buffer->meta()->setInt32("partial-frame", 1);
+                }
+                mInPartialFrame = partialFrame;
+
                 sp<AMessage> notify = mNotify->dup();
                 notify->setInt32("what", kWhatAccessUnit);
                 notify->setBuffer("accessUnit", buffer);
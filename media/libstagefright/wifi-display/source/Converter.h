@@ -19,6 +19,7 @@
 #define CONVERTER_H_
 
 #include <media/stagefright/foundation/AHandler.h>
+#include <utils/KeyedVector.h>
 
 namespace android {
 
@@ -40,9 +41,13 @@ struct Converter : public AHandler {
         kWhatShutdownCompleted,
     };
 
+    // With FLAG_OUTPUT_PARTIAL_FRAMES, a video encoder that supports it
+    // emits the slices of a frame as they are coded. All access units but
+    // the last of a frame then have "partial-frame" set in their meta.
     enum FlagBits {
         FLAG_USE_SURFACE_INPUT          = 1,
         FLAG_PREPEND_CSD_IF_NECESSARY   = 2,
+        FLAG_OUTPUT_PARTIAL_FRAMES      = 4,
     };
     Converter(const sp<AMessage> &notify,
               const sp<ALooper> &codecLooper,
@@ -93,6 +98,10 @@ private:
         kWhatReleaseOutputBuffer,
     };
 
+    enum {
+        kMaxNumEncoderInputTimes = 64,
+    };
+
     sp<AMessage> mNotify;
     sp<ALooper> mCodecLooper;
     sp<AMessage> mOutputFormat;
@@ -116,6 +125,10 @@ private:
 
     sp<ABuffer> mCSD0;
 
+    // when each video frame still being encoded was queued, by its timeUs
+    KeyedVector<int64_t, int64_t> mEncoderInputTimesUs;
+    bool mInPartialFrame;
+
     bool mDoMoreWorkPending;
 
 #if ENABLE_SILENCE_DETECTION
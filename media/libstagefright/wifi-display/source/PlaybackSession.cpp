@@ -966,7 +966,16 @@ status_t WifiDisplaySource::PlaybackSession::addSource(
     notify = new AMessage(kWhatConverterNotify, this);
     notify->setSize("trackIndex", trackIndex);
 
-    sp<Converter> converter = new Converter(notify, codecLooper, format);
+    uint32_t converterFlags = 0;
+    if (isVideo && mHDCP == NULL
+            && Converter::GetInt32Property("media.wfd.low-latency", 0) > 0) {
+        // Send the slices of each frame out as they are encoded. HDCP
+        // encrypts whole frames, so this is only done without it.
+        converterFlags |= Converter::FLAG_OUTPUT_PARTIAL_FRAMES;
+    }
+
+    sp<Converter> converter =
+        new Converter(notify, codecLooper, format, converterFlags);
 
     looper()->registerHandler(converter);
 
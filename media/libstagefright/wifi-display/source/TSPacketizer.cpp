@@ -436,6 +436,11 @@ ssize_t TSPacketizer::addTrack(const sp<AMessage> &format) {
     }
 
     sp<Track> track = new Track(format, PID, streamType, streamID);
+
+    // The PMT lists the new track.
+    mPATPacket.clear();
+    mPMTPacket.clear();
+
     return mTracks.add(track);
 }
 
@@ -462,8 +467,6 @@ status_t TSPacketizer::packetize(
     int64_t timeUs;
     CHECK(accessUnit->meta()->findInt64("timeUs", &timeUs));
 
-    packets->clear();
-
     if (trackIndex >= mTracks.size()) {
         return -ERANGE;
     }
@@ -471,6 +474,7 @@ status_t TSPacketizer::packetize(
     const sp<Track> &track = mTracks.itemAt(trackIndex);
 
     if (track->isH264() && (flags & PREPEND_SPS_PPS_TO_IDR_FRAMES)
+            && !(flags & CONTINUES_FRAME)
             && IsIDR(accessUnit)) {
         // prepend codec specific data, i.e. SPS and PPS.
         accessUnit = track->prependCSD(accessUnit);
@@ -536,6 +540,8 @@ status_t TSPacketizer::packetize(
        ... padding
 
        followed by the payload
+
+       With CONTINUES_FRAME all packets are of the second kind.
     */
 
     size_t PES_packet_length = accessUnit->size() + 8 + numStuffingBytes;
@@ -543,33 +549,38 @@ status_t TSPacketizer::packetize(
         PES_packet_length += PES_private_data_len + 1;
     }
 
-    size_t numTSPackets = 1;
+    size_t numTSPackets = 0;
 
     {
-        // Make sure the PES header fits into a single TS packet:
-        size_t PES_header_size = 14 + numStuffingBytes;
-        if (PES_private_data_len > 0) {
-            PES_header_size += PES_private_data_len + 1;
-        }
+        size_t numBytesOfPayloadRemaining = accessUnit->size();
 
-        CHECK_LE(PES_header_size, 188u - 4u);
+        if (!(flags & CONTINUES_FRAME)) {
+            // Make sure the PES header fits into a single TS packet:
+            size_t PES_header_size = 14 + numStuffingBytes;
+            if (PES_private_data_len > 0) {
+                PES_header_size += PES_private_data_len + 1;
+            }
 
-        size_t sizeAvailableForPayload = 188 - 4 - PES_header_size;
-        size_t numBytesOfPayload = accessUnit->size();
+            CHECK_LE(PES_header_size, 188u - 4u);
 
-        if (numBytesOfPayload > sizeAvailableForPayload) {
-            numBytesOfPayload = sizeAvailableForPayload;
+            size_t sizeAvailableForPayload = 188 - 4 - PES_header_size;
+            size_t numBytesOfPayload = accessUnit->size();
 
-            if (alignPayload && numBytesOfPayload > 16) {
-                numBytesOfPayload -= (numBytesOfPayload % 16);
+            if (numBytesOfPayload > sizeAvailableForPayload) {
+                numBytesOfPayload = sizeAvailableForPayload;
+
+                if (alignPayload && numBytesOfPayload > 16) {
+                    numBytesOfPayload -= (numBytesOfPayload % 16);
+                }
             }
-        }
 
-        size_t numPaddingBytes = sizeAvailableForPayload - numBytesOfPayload;
-        ALOGV("packet 1 contains %zd padding bytes and %zd bytes of payload",
-              numPaddingBytes, numBytesOfPayload);
+            size_t numPaddingBytes = sizeAvailableForPayload - numBytesOfPayload;
+            ALOGV("packet 1 contains %zd padding bytes and %zd bytes of payload",
+                  numPaddingBytes, numBytesOfPayload);
 
-        size_t numBytesOfPayloadRemaining = accessUnit->size() - numBytesOfPayload;
+            numBytesOfPayloadRemaining -= numBytesOfPayload;
+            numTSPackets = 1;
+        }
 
 #if 0
         // The following hopefully illustrates the logic that led to the
@@ -598,7 +609,7 @@ status_t TSPacketizer::packetize(
 #else
         // This is how many bytes of payload each subsequent TS packet
         // can contain at most.
-        sizeAvailableForPayload = 188 - 4;
+        size_t sizeAvailableForPayload = 188 - 4;
         size_t sizeAvailableForAlignedPayload = sizeAvailableForPayload;
         if (alignPayload) {
             // We're only going to use a subset of the available space
@@ -639,186 +650,33 @@ status_t TSPacketizer::packetize(
         ++numTSPackets;
     }
 
-    sp<ABuffer> buffer = new ABuffer(numTSPackets * 188);
+    sp<ABuffer> buffer = *packets;
+    if (buffer == NULL || buffer->capacity() < numTSPackets * 188) {
+        buffer = new ABuffer(numTSPackets * 188);
+    }
+    buffer->setRange(0, numTSPackets * 188);
+
     uint8_t *packetDataStart = buffer->data();
 
     if (flags & EMIT_PAT_AND_PMT) {
-        // Program Association Table (PAT):
-        // 0x47
-        // transport_error_indicator = b0
-        // payload_unit_start_indicator = b1
-        // transport_priority = b0
-        // PID = b0000000000000 (13 bits)
-        // transport_scrambling_control = b00
-        // adaptation_field_control = b01 (no adaptation field, payload only)
-        // continuity_counter = b????
-        // skip = 0x00
-        // --- payload follows
-        // table_id = 0x00
-        // section_syntax_indicator = b1
-        // must_be_zero = b0
-        // reserved = b11
-        // section_length = 0x00d
-        // transport_stream_id = 0x0000
-        // reserved = b11
-        // version_number = b00001
-        // current_next_indicator = b1
-        // section_number = 0x00
-        // last_section_number = 0x00
-        //   one program follows:
-        //   program_number = 0x0001
-        //   reserved = b111
-        //   program_map_PID = kPID_PMT (13 bits!)
-        // CRC = 0x????????
+        if (mPMTPacket == NULL) {
+            buildProgramTables();
+        }
 
         if (++mPATContinuityCounter == 16) {
             mPATContinuityCounter = 0;
         }
 
-        uint8_t *ptr = packetDataStart;
-        *ptr++ = 0x47;
-        *ptr++ = 0x40;
-        *ptr++ = 0x00;
-        *ptr++ = 0x10 | mPATContinuityCounter;
-        *ptr++ = 0x00;
-
-        uint8_t *crcDataStart = ptr;
-        *ptr++ = 0x00;
-        *ptr++ = 0xb0;
-        *ptr++ = 0x0d;
-        *ptr++ = 0x00;
-        *ptr++ = 0x00;
-        *ptr++ = 0xc3;
-        *ptr++ = 0x00;
-        *ptr++ = 0x00;
-        *ptr++ = 0x00;
-        *ptr++ = 0x01;
-        *ptr++ = 0xe0 | (kPID_PMT >> 8);
-        *ptr++ = kPID_PMT & 0xff;
-
-        CHECK_EQ(ptr - crcDataStart, 12);
-        uint32_t crc = htonl(crc32(crcDataStart, ptr - crcDataStart));
-        memcpy(ptr, &crc, 4);
-        ptr += 4;
-
-        size_t sizeLeft = packetDataStart + 188 - ptr;
-        memset(ptr, 0xff, sizeLeft);
-
+        memcpy(packetDataStart, mPATPacket->data(), 188);
+        packetDataStart[3] |= mPATContinuityCounter;
         packetDataStart += 188;
 
-        // Program Map (PMT):
-        // 0x47
-        // transport_error_indicator = b0
-        // payload_unit_start_indicator = b1
-        // transport_priority = b0
-        // PID = kPID_PMT (13 bits)
-        // transport_scrambling_control = b00
-        // adaptation_field_control = b01 (no adaptation field, payload only)
-        // continuity_counter = b????
-        // skip = 0x00
-        // -- payload follows
-        // table_id = 0x02
-        // section_syntax_indicator = b1
-        // must_be_zero = b0
-        // reserved = b11
-        // section_length = 0x???
-        // program_number = 0x0001
-        // reserved = b11
-        // version_number = b00001
-        // current_next_indicator = b1
-        // section_number = 0x00
-        // last_section_number = 0x00
-        // reserved = b111
-        // PCR_PID = kPCR_PID (13 bits)
-        // reserved = b1111
-        // program_info_length = 0x???
-        //   program_info_descriptors follow
-        // one or more elementary stream descriptions follow:
-        //   stream_type = 0x??
-        //   reserved = b111
-        //   elementary_PID = b? ???? ???? ???? (13 bits)
-        //   reserved = b1111
-        //   ES_info_length = 0x000
-        // CRC = 0x????????
-
         if (++mPMTContinuityCounter == 16) {
             mPMTContinuityCounter = 0;
         }
 
-        ptr = packetDataStart;
-        *ptr++ = 0x47;
-        *ptr++ = 0x40 | (kPID_PMT >> 8);
-        *ptr++ = kPID_PMT & 0xff;
-        *ptr++ = 0x10 | mPMTContinuityCounter;
-        *ptr++ = 0x00;
-
-        crcDataStart = ptr;
-        *ptr++ = 0x02;
-
-        *ptr++ = 0x00;  // section_length to be filled in below.
-        *ptr++ = 0x00;
-
-        *ptr++ = 0x00;
-        *ptr++ = 0x01;
-        *ptr++ = 0xc3;
-        *ptr++ = 0x00;
-        *ptr++ = 0x00;
-        *ptr++ = 0xe0 | (kPID_PCR >> 8);
-        *ptr++ = kPID_PCR & 0xff;
-
-        size_t program_info_length = 0;
-        for (size_t i = 0; i < mProgramInfoDescriptors.size(); ++i) {
-            program_info_length += mProgramInfoDescriptors.itemAt(i)->size();
-        }
-
-        CHECK_LT(program_info_length, 0x400);
-        *ptr++ = 0xf0 | (program_info_length >> 8);
-        *ptr++ = (program_info_length & 0xff);
-
-        for (size_t i = 0; i < mProgramInfoDescriptors.size(); ++i) {
-            const sp<ABuffer> &desc = mProgramInfoDescriptors.itemAt(i);
-            memcpy(ptr, desc->data(), desc->size());
-            ptr += desc->size();
-        }
-
-        for (size_t i = 0; i < mTracks.size(); ++i) {
-            const sp<Track> &track = mTracks.itemAt(i);
-
-            // Make sure all the decriptors have been added.
-            track->finalize();
-
-            *ptr++ = track->streamType();
-            *ptr++ = 0xe0 | (track->PID() >> 8);
-            *ptr++ = track->PID() & 0xff;
-
-            size_t ES_info_length = 0;
-            for (size_t i = 0; i < track->countDescriptors(); ++i) {
-                ES_info_length += track->descriptorAt(i)->size();
-            }
-            CHECK_LE(ES_info_length, 0xfff);
-
-            *ptr++ = 0xf0 | (ES_info_length >> 8);
-            *ptr++ = (ES_info_length & 0xff);
-
-            for (size_t i = 0; i < track->countDescriptors(); ++i) {
-                const sp<ABuffer> &descriptor = track->descriptorAt(i);
-                memcpy(ptr, descriptor->data(), descriptor->size());
-                ptr += descriptor->size();
-            }
-        }
-
-        size_t section_length = ptr - (crcDataStart + 3) + 4 /* CRC */;
-
-        crcDataStart[1] = 0xb0 | (section_length >> 8);
-        crcDataStart[2] = section_length & 0xff;
-
-        crc = htonl(crc32(crcDataStart, ptr - crcDataStart));
-        memcpy(ptr, &crc, 4);
-        ptr += 4;
-
-        sizeLeft = packetDataStart + 188 - ptr;
-        memset(ptr, 0xff, sizeLeft);
-
+        memcpy(packetDataStart, mPMTPacket->data(), 188);
+        packetDataStart[3] |= mPMTContinuityCounter;
         packetDataStart += 188;
     }
 
@@ -870,89 +728,94 @@ status_t TSPacketizer::packetize(
         packetDataStart += 188;
     }
 
-    uint64_t PTS = (timeUs * 9ll) / 100ll;
+    size_t offset = 0;
 
-    if (PES_packet_length >= 65536) {
-        // This really should only happen for video.
-        CHECK(track->isVideo());
+    if (!(flags & CONTINUES_FRAME)) {
+        uint64_t PTS = (timeUs * 9ll) / 100ll;
 
-        // It's valid to set this to 0 for video according to the specs.
-        PES_packet_length = 0;
-    }
+        if (PES_packet_length >= 65536 || (flags & IS_PARTIAL_FRAME)) {
+            // This really should only happen for video.
+            CHECK(track->isVideo());
 
-    size_t sizeAvailableForPayload = 188 - 4 - 14 - numStuffingBytes;
-    if (PES_private_data_len > 0) {
-        sizeAvailableForPayload -= PES_private_data_len + 1;
-    }
+            // It's valid to set this to 0 for video according to the specs.
+            PES_packet_length = 0;
+        }
+
+        size_t sizeAvailableForPayload = 188 - 4 - 14 - numStuffingBytes;
+        if (PES_private_data_len > 0) {
+            sizeAvailableForPayload -= PES_private_data_len + 1;
+        }
 
-    size_t copy = accessUnit->size();
+        size_t copy = accessUnit->size();
 
-    if (copy > sizeAvailableForPayload) {
-        copy = sizeAvailableForPayload;
+        if (copy > sizeAvailableForPayload) {
+            copy = sizeAvailableForPayload;
 
-        if (alignPayload && copy > 16) {
-            copy -= (copy % 16);
+            if (alignPayload && copy > 16) {
+                copy -= (copy % 16);
+            }
         }
-    }
 
-    size_t numPaddingBytes = sizeAvailableForPayload - copy;
+        size_t numPaddingBytes = sizeAvailableForPayload - copy;
 
-    uint8_t *ptr = packetDataStart;
-    *ptr++ = 0x47;
-    *ptr++ = 0x40 | (track->PID() >> 8);
-    *ptr++ = track->PID() & 0xff;
-
-    *ptr++ = (numPaddingBytes > 0 ? 0x30 : 0x10)
-                | track->incrementContinuityCounter();
-
-    if (numPaddingBytes > 0) {
-        *ptr++ = numPaddingBytes - 1;
-        if (numPaddingBytes >= 2) {
-            *ptr++ = 0x00;
-            memset(ptr, 0xff, numPaddingBytes - 2);
-            ptr += numPaddingBytes - 2;
+        uint8_t *ptr = packetDataStart;
+        *ptr++ = 0x47;
+        *ptr++ = 0x40 | (track->PID() >> 8);
+        *ptr++ = track->PID() & 0xff;
+
+        *ptr++ = (numPaddingBytes > 0 ? 0x30 : 0x10)
+                    | track->incrementContinuityCounter();
+
+        if (numPaddingBytes > 0) {
+            *ptr++ = numPaddingBytes - 1;
+            if (numPaddingBytes >= 2) {
+                *ptr++ = 0x00;
+                memset(ptr, 0xff, numPaddingBytes - 2);
+                ptr += numPaddingBytes - 2;
+            }
         }
-    }
 
-    *ptr++ = 0x00;
-    *ptr++ = 0x00;
-    *ptr++ = 0x01;
-    *ptr++ = track->streamID();
-    *ptr++ = PES_packet_length >> 8;
-    *ptr++ = PES_packet_length & 0xff;
-    *ptr++ = 0x84;
-    *ptr++ = (PES_private_data_len > 0) ? 0x81 : 0x80;
+        *ptr++ = 0x00;
+        *ptr++ = 0x00;
+        *ptr++ = 0x01;
+        *ptr++ = track->streamID();
+        *ptr++ = PES_packet_length >> 8;
+        *ptr++ = PES_packet_length & 0xff;
+        *ptr++ = 0x84;
+        *ptr++ = (PES_private_data_len > 0) ? 0x81 : 0x80;
 
-    size_t headerLength = 0x05 + numStuffingBytes;
-    if (PES_private_data_len > 0) {
-        headerLength += 1 + PES_private_data_len;
-    }
+        size_t headerLength = 0x05 + numStuffingBytes;
+        if (PES_private_data_len > 0) {
+            headerLength += 1 + PES_private_data_len;
+        }
 
-    *ptr++ = headerLength;
+        *ptr++ = headerLength;
 
-    *ptr++ = 0x20 | (((PTS >> 30) & 7) << 1) | 1;
-    *ptr++ = (PTS >> 22) & 0xff;
-    *ptr++ = (((PTS >> 15) & 0x7f) << 1) | 1;
-    *ptr++ = (PTS >> 7) & 0xff;
-    *ptr++ = ((PTS & 0x7f) << 1) | 1;
+        *ptr++ = 0x20 | (((PTS >> 30) & 7) << 1) | 1;
+        *ptr++ = (PTS >> 22) & 0xff;
+        *ptr++ = (((PTS >> 15) & 0x7f) << 1) | 1;
+        *ptr++ = (PTS >> 7) & 0xff;
+        *ptr++ = ((PTS & 0x7f) << 1) | 1;
 
-    if (PES_private_data_len > 0) {
-        *ptr++ = 0x8e;  // PES_private_data_flag, reserved.
-        memcpy(ptr, PES_private_data, PES_private_data_len);
-        ptr += PES_private_data_len;
-    }
+        if (PES_private_data_len > 0) {
+            *ptr++ = 0x8e;  // PES_private_data_flag, reserved.
+            memcpy(ptr, PES_private_data, PES_private_data_len);
+            ptr += PES_private_data_len;
+        }
 
-    for (size_t i = 0; i < numStuffingBytes; ++i) {
-        *ptr++ = 0xff;
-    }
+        for (size_t i = 0; i < numStuffingBytes; ++i) {
+            *ptr++ = 0xff;
+        }
+
+        memcpy(ptr, accessUnit->data(), copy);
+        ptr += copy;
 
-    memcpy(ptr, accessUnit->data(), copy);
-    ptr += copy;
+        CHECK_EQ(ptr, packetDataStart + 188);
+        packetDataStart += 188;
 
-    CHECK_EQ(ptr, packetDataStart + 188);
-    packetDataStart += 188;
+        offset = copy;
+    }
 
-    size_t offset = copy;
     while (offset < accessUnit->size()) {
         // for subsequent fragments of "buffer":
         // 0x47
@@ -1004,13 +867,187 @@ status_t TSPacketizer::packetize(
         packetDataStart += 188;
     }
 
-    CHECK(packetDataStart == buffer->data() + buffer->capacity());
+    CHECK(packetDataStart == buffer->data() + buffer->size());
 
     *packets = buffer;
 
     return OK;
 }
 
+void TSPacketizer::buildProgramTables() {
+    // Program Association Table (PAT):
+    // 0x47
+    // transport_error_indicator = b0
+    // payload_unit_start_indicator = b1
+    // transport_priority = b0
+    // PID = b0000000000000 (13 bits)
+    // transport_scrambling_control = b00
+    // adaptation_field_control = b01 (no adaptation field, payload only)
+    // continuity_counter = b????
+    // skip = 0x00
+    // --- payload follows
+    // table_id = 0x00
+    // section_syntax_indicator = b1
+    // must_be_zero = b0
+    // reserved = b11
+    // section_length = 0x00d
+    // transport_stream_id = 0x0000
+    // reserved = b11
+    // version_number = b00001
+    // current_next_indicator = b1
+    // section_number = 0x00
+    // last_section_number = 0x00
+    //   one program follows:
+    //   program_number = 0x0001
+    //   reserved = b111
+    //   program_map_PID = kPID_PMT (13 bits!)
+    // CRC = 0x????????
+
+    mPATPacket = new ABuffer(188);
+
+    uint8_t *packetDataStart = mPATPacket->data();
+    uint8_t *ptr = packetDataStart;
+    *ptr++ = 0x47;
+    *ptr++ = 0x40;
+    *ptr++ = 0x00;
+    *ptr++ = 0x10;  // continuity_counter filled in by packetize()
+    *ptr++ = 0x00;
+
+    uint8_t *crcDataStart = ptr;
+    *ptr++ = 0x00;
+    *ptr++ = 0xb0;
+    *ptr++ = 0x0d;
+    *ptr++ = 0x00;
+    *ptr++ = 0x00;
+    *ptr++ = 0xc3;
+    *ptr++ = 0x00;
+    *ptr++ = 0x00;
+    *ptr++ = 0x00;
+    *ptr++ = 0x01;
+    *ptr++ = 0xe0 | (kPID_PMT >> 8);
+    *ptr++ = kPID_PMT & 0xff;
+
+    CHECK_EQ(ptr - crcDataStart, 12);
+    uint32_t crc = htonl(crc32(crcDataStart, ptr - crcDataStart));
+    memcpy(ptr, &crc, 4);
+    ptr += 4;
+
+    size_t sizeLeft = packetDataStart + 188 - ptr;
+    memset(ptr, 0xff, sizeLeft);
+
+    // Program Map (PMT):
+    // 0x47
+    // transport_error_indicator = b0
+    // payload_unit_start_indicator = b1
+    // transport_priority = b0
+    // PID = kPID_PMT (13 bits)
+    // transport_scrambling_control = b00
+    // adaptation_field_control = b01 (no adaptation field, payload only)
+    // continuity_counter = b????
+    // skip = 0x00
+    // -- payload follows
+    // table_id = 0x02
+    // section_syntax_indicator = b1
+    // must_be_zero = b0
+    // reserved = b11
+    // section_length = 0x???
+    // program_number = 0x0001
+    // reserved = b11
+    // version_number = b00001
+    // current_next_indicator = b1
+    // section_number = 0x00
+    // last_section_number = 0x00
+    // reserved = b111
+    // PCR_PID = kPCR_PID (13 bits)
+    // reserved = b1111
+    // program_info_length = 0x???
+    //   program_info_descriptors follow
+    // one or more elementary stream descriptions follow:
+    //   stream_type = 0x??
+    //   reserved = b111
+    //   elementary_PID = b? ???? ???? ???? (13 bits)
+    //   reserved = b1111
+    //   ES_info_length = 0x000
+    // CRC = 0x????????
+
+    mPMTPacket = new ABuffer(188);
+
+    packetDataStart = mPMTPacket->data();
+    ptr = packetDataStart;
+    *ptr++ = 0x47;
+    *ptr++ = 0x40 | (kPID_PMT >> 8);
+    *ptr++ = kPID_PMT & 0xff;
+    *ptr++ = 0x10;  // continuity_counter filled in by packetize()
+    *ptr++ = 0x00;
+
+    crcDataStart = ptr;
+    *ptr++ = 0x02;
+
+    *ptr++ = 0x00;  // section_length to be filled in below.
+    *ptr++ = 0x00;
+
+    *ptr++ = 0x00;
+    *ptr++ = 0x01;
+    *ptr++ = 0xc3;
+    *ptr++ = 0x00;
+    *ptr++ = 0x00;
+    *ptr++ = 0xe0 | (kPID_PCR >> 8);
+    *ptr++ = kPID_PCR & 0xff;
+
+    size_t program_info_length = 0;
+    for (size_t i = 0; i < mProgramInfoDescriptors.size(); ++i) {
+        program_info_length += mProgramInfoDescriptors.itemAt(i)->size();
+    }
+
+    CHECK_LT(program_info_length, 0x400);
+    *ptr++ = 0xf0 | (program_info_length >> 8);
+    *ptr++ = (program_info_length & 0xff);
+
+    for (size_t i = 0; i < mProgramInfoDescriptors.size(); ++i) {
+        const sp<ABuffer> &desc = mProgramInfoDescriptors.itemAt(i);
+        memcpy(ptr, desc->data(), desc->size());
+        ptr += desc->size();
+    }
+
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        const sp<Track> &track = mTracks.itemAt(i);
+
+        // Make sure all the decriptors have been added.
+        track->finalize();
+
+        *ptr++ = track->streamType();
+        *ptr++ = 0xe0 | (track->PID() >> 8);
+        *ptr++ = track->PID() & 0xff;
+
+        size_t ES_info_length = 0;
+        for (size_t i = 0; i < track->countDescriptors(); ++i) {
+            ES_info_length += track->descriptorAt(i)->size();
+        }
+        CHECK_LE(ES_info_length, 0xfff);
+
+        *ptr++ = 0xf0 | (ES_info_length >> 8);
+        *ptr++ = (ES_info_length & 0xff);
+
+        for (size_t i = 0; i < track->countDescriptors(); ++i) {
+            const sp<ABuffer> &descriptor = track->descriptorAt(i);
+            memcpy(ptr, descriptor->data(), descriptor->size());
+            ptr += descriptor->size();
+        }
+    }
+
+    size_t section_length = ptr - (crcDataStart + 3) + 4 /* CRC */;
+
+    crcDataStart[1] = 0xb0 | (section_length >> 8);
+    crcDataStart[2] = section_length & 0xff;
+
+    crc = htonl(crc32(crcDataStart, ptr - crcDataStart));
+    memcpy(ptr, &crc, 4);
+    ptr += 4;
+
+    sizeLeft = packetDataStart + 188 - ptr;
+    memset(ptr, 0xff, sizeLeft);
+}
+
 void TSPacketizer::initCrcTable() {
     uint32_t poly = 0x04C11DB7;
 
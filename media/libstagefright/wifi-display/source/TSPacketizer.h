@@ -41,12 +41,20 @@ struct TSPacketizer : public RefBase {
     // Returns trackIndex or error.
     ssize_t addTrack(const sp<AMessage> &format);
 
+    // A video frame may be packetized in parts as it is encoded: the first
+    // part with IS_PARTIAL_FRAME, which leaves the length of its PES packet
+    // open, and the rest with CONTINUES_FRAME, which carries them on in the
+    // same PES packet. Parts of a frame can't carry PES private data.
     enum {
         EMIT_PAT_AND_PMT                = 1,
         EMIT_PCR                        = 2,
         IS_ENCRYPTED                    = 4,
         PREPEND_SPS_PPS_TO_IDR_FRAMES   = 8,
+        IS_PARTIAL_FRAME                = 16,
+        CONTINUES_FRAME                 = 32,
     };
+    // Stores the packets in |*packets|, which is reused if it is large
+    // enough.
     status_t packetize(
             size_t trackIndex, const sp<ABuffer> &accessUnit,
             sp<ABuffer> *packets,
@@ -77,11 +85,18 @@ private:
 
     Vector<sp<ABuffer> > mProgramInfoDescriptors;
 
+    // The PAT and PMT packets, but for their continuity counters, built
+    // the first time they are emitted after a track is added.
+    sp<ABuffer> mPATPacket;
+    sp<ABuffer> mPMTPacket;
+
     unsigned mPATContinuityCounter;
     unsigned mPMTContinuityCounter;
 
     uint32_t mCrcTable[256];
 
+    void buildProgramTables();
+
     void initCrcTable();
     uint32_t crc32(const uint8_t *start, size_t size) const;
 
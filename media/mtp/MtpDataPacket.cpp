@@ -348,25 +348,34 @@ void MtpDataPacket::putUInt128(uint64_t value) {
     putUInt64(0);
 }
 
+void MtpDataPacket::reserveArray(size_t count, size_t elementSize) {
+    // count plus elements, so the loops below never reallocate
+    allocate(mOffset + 4 + count * elementSize);
+}
+
 void MtpDataPacket::putAInt8(const int8_t* values, int count) {
+    reserveArray(count, 1);
     putUInt32(count);
     for (int i = 0; i < count; i++)
         putInt8(*values++);
 }
 
 void MtpDataPacket::putAUInt8(const uint8_t* values, int count) {
+    reserveArray(count, 1);
     putUInt32(count);
     for (int i = 0; i < count; i++)
         putUInt8(*values++);
 }
 
 void MtpDataPacket::putAInt16(const int16_t* values, int count) {
+    reserveArray(count, 2);
     putUInt32(count);
     for (int i = 0; i < count; i++)
         putInt16(*values++);
 }
 
 void MtpDataPacket::putAUInt16(const uint16_t* values, int count) {
+    reserveArray(count, 2);
     putUInt32(count);
     for (int i = 0; i < count; i++)
         putUInt16(*values++);
@@ -374,18 +383,21 @@ void MtpDataPacket::putAUInt16(const uint16_t* values, int count) {
 
 void MtpDataPacket::putAUInt16(const UInt16List* values) {
     size_t count = (values ? values->size() : 0);
+    reserveArray(count, 2);
     putUInt32(count);
     for (size_t i = 0; i < count; i++)
         putUInt16((*values)[i]);
 }
 
 void MtpDataPacket::putAInt32(const int32_t* values, int count) {
+    reserveArray(count, 4);
     putUInt32(count);
     for (int i = 0; i < count; i++)
         putInt32(*values++);
 }
 
 void MtpDataPacket::putAUInt32(const uint32_t* values, int count) {
+    reserveArray(count, 4);
     putUInt32(count);
     for (int i = 0; i < count; i++)
         putUInt32(*values++);
@@ -396,6 +408,7 @@ void MtpDataPacket::putAUInt32(const UInt32List* list) {
         putEmptyArray();
     } else {
         size_t size = list->size();
+        reserveArray(size, 4);
         putUInt32(size);
         for (size_t i = 0; i < size; i++)
             putUInt32((*list)[i]);
@@ -403,12 +416,14 @@ void MtpDataPacket::putAUInt32(const UInt32List* list) {
 }
 
 void MtpDataPacket::putAInt64(const int64_t* values, int count) {
+    reserveArray(count, 8);
     putUInt32(count);
     for (int i = 0; i < count; i++)
         putInt64(*values++);
 }
 
 void MtpDataPacket::putAUInt64(const uint64_t* values, int count) {
+    reserveArray(count, 8);
     putUInt32(count);
     for (int i = 0; i < count; i++)
         putUInt64(*values++);
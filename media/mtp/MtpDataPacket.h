@@ -33,6 +33,8 @@ private:
     // current offset for get/put methods
     size_t              mOffset;
 
+    void                reserveArray(size_t count, size_t elementSize);
+
 public:
                         MtpDataPacket();
     virtual             ~MtpDataPacket();
@@ -16,6 +16,7 @@
 
 #include <android-base/logging.h>
 #include <android-base/properties.h>
+#include <chrono>
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -52,7 +53,9 @@ constexpr int MAX_PACKET_SIZE_FS = 64;
 constexpr int MAX_PACKET_SIZE_HS = 512;
 constexpr int MAX_PACKET_SIZE_SS = 1024;
 
-// Must be divisible by all max packet size values
+// Must be divisible by all max packet size values. Can be overridden per device with the
+// property sys.usb.ffs.file_chunk_size, which is rounded down to a multiple of
+// MAX_PACKET_SIZE_SS.
 constexpr int MAX_FILE_CHUNK_SIZE = 3145728;
 
 // Safe values since some devices cannot handle large DMAs
@@ -287,13 +290,24 @@ const struct {
     },
 };
 
+void logThroughput(const char *what, uint64_t bytes,
+        std::chrono::steady_clock::time_point start) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    if (elapsed > 0) {
+        LOG(DEBUG) << what << " " << bytes << " bytes in " << elapsed / 1000 << " ms ("
+                << bytes / elapsed << " MB/s)";
+    }
+}
+
 } // anonymous namespace
 
 namespace android {
 
 MtpFfsHandle::MtpFfsHandle() :
     mMaxWrite(USB_FFS_MAX_WRITE),
-    mMaxRead(USB_FFS_MAX_READ) {}
+    mMaxRead(USB_FFS_MAX_READ),
+    mFileChunkSize(MAX_FILE_CHUNK_SIZE) {}
 
 MtpFfsHandle::~MtpFfsHandle() {}
 
@@ -453,11 +467,18 @@ int MtpFfsHandle::start() {
         return -1;
     }
 
-    mBuffer1.resize(MAX_FILE_CHUNK_SIZE);
-    mBuffer2.resize(MAX_FILE_CHUNK_SIZE);
-    posix_madvise(mBuffer1.data(), MAX_FILE_CHUNK_SIZE,
+    // Larger chunks mean fewer, longer transfers for each file, which fast hosts need to
+    // get close to link speed
+    mFileChunkSize = android::base::GetIntProperty("sys.usb.ffs.file_chunk_size",
+            MAX_FILE_CHUNK_SIZE);
+    mFileChunkSize = std::max(mFileChunkSize - mFileChunkSize % MAX_PACKET_SIZE_SS,
+            MAX_PACKET_SIZE_SS);
+
+    mBuffer1.resize(mFileChunkSize);
+    mBuffer2.resize(mFileChunkSize);
+    posix_madvise(mBuffer1.data(), mFileChunkSize,
             POSIX_MADV_SEQUENTIAL | POSIX_MADV_WILLNEED);
-    posix_madvise(mBuffer2.data(), MAX_FILE_CHUNK_SIZE,
+    posix_madvise(mBuffer2.data(), mFileChunkSize,
             POSIX_MADV_SEQUENTIAL | POSIX_MADV_WILLNEED);
 
     // Get device specific r/w size
@@ -545,10 +566,12 @@ int MtpFfsHandle::receiveFile(mtp_file_range mfr, bool zero_packet) {
 
     posix_fadvise(mfr.fd, 0, 0, POSIX_FADV_SEQUENTIAL | POSIX_FADV_NOREUSE);
 
+    auto start = std::chrono::steady_clock::now();
+
     // Break down the file into pieces that fit in buffers
     while (file_length > 0 || write) {
         if (file_length > 0) {
-            length = std::min(static_cast<uint32_t>(MAX_FILE_CHUNK_SIZE), file_length);
+            length = std::min(static_cast<uint32_t>(mFileChunkSize), file_length);
 
             // Read data from USB, handle errors after waiting for write thread.
             ret = readHandle(mBulkOut, data, length);
@@ -610,6 +633,7 @@ int MtpFfsHandle::receiveFile(mtp_file_range mfr, bool zero_packet) {
             return -1;
         }
     }
+    logThroughput("Received", offset - mfr.offset, start);
     return 0;
 }
 
@@ -639,6 +663,8 @@ int MtpFfsHandle::sendFile(mtp_file_range mfr) {
 
     posix_fadvise(mfr.fd, 0, 0, POSIX_FADV_SEQUENTIAL | POSIX_FADV_NOREUSE);
 
+    auto start = std::chrono::steady_clock::now();
+
     struct aiocb aio;
     aio.aio_fildes = mfr.fd;
     struct aiocb *aiol[] = {&aio};
@@ -691,7 +717,7 @@ int MtpFfsHandle::sendFile(mtp_file_range mfr) {
         }
 
         if (file_length > 0) {
-            length = std::min(static_cast<uint64_t>(MAX_FILE_CHUNK_SIZE), file_length);
+            length = std::min(static_cast<uint64_t>(mFileChunkSize), file_length);
             // Queue up another read
             aio.aio_buf = data;
             aio.aio_offset = offset;
@@ -715,6 +741,7 @@ int MtpFfsHandle::sendFile(mtp_file_range mfr) {
         }
     }
 
+    logThroughput("Sent", mfr.length, start);
     return 0;
 }
 
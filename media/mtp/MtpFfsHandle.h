@@ -47,6 +47,8 @@ private:
 
     int mMaxWrite;
     int mMaxRead;
+    // Size of each of the two buffers file transfers alternate between
+    int mFileChunkSize;
 
     std::vector<char> mBuffer1;
     std::vector<char> mBuffer2;
@@ -54,7 +54,11 @@ void MtpPacket::reset() {
 
 void MtpPacket::allocate(size_t length) {
     if (length > mBufferSize) {
-        int newLength = length + mAllocationIncrement;
+        // Grow geometrically, so that building a large data packet one value at a time
+        // (object handle and property lists) does not copy the buffer over and over.
+        size_t newLength = length + mAllocationIncrement;
+        if (newLength < mBufferSize * 2)
+            newLength = mBufferSize * 2;
         mBuffer = (uint8_t *)realloc(mBuffer, newLength);
         if (!mBuffer) {
             ALOGE("out of memory!");
@@ -358,6 +358,18 @@ AImageReader::~AImageReader() {
 media_status_t
 AImageReader::acquireImageLocked(/*out*/AImage** image, /*out*/int* acquireFenceFd) {
     *image = nullptr;
+    BufferItem* buffer = nullptr;
+    // When the output paramter fence is not NULL, we are acquiring the image asynchronously.
+    media_status_t ret = acquireBufferItemLocked(&buffer, acquireFenceFd == nullptr);
+    if (ret != AMEDIA_OK) {
+        return ret;
+    }
+    return createImageLocked(buffer, image, acquireFenceFd);
+}
+
+media_status_t
+AImageReader::acquireBufferItemLocked(/*out*/BufferItem** outBuffer, bool waitForFence) {
+    *outBuffer = nullptr;
     BufferItem* buffer = getBufferItemLocked();
     if (buffer == nullptr) {
         ALOGW("Unable to acquire a lockedBuffer, very likely client tries to lock more than"
@@ -365,8 +377,6 @@ AImageReader::acquireImageLocked(/*out*/AImage** image, /*out*/int* acquireFence
         return AMEDIA_IMGREADER_MAX_IMAGES_ACQUIRED;
     }
 
-    // When the output paramter fence is not NULL, we are acquiring the image asynchronously.
-    bool waitForFence = acquireFenceFd == nullptr;
     status_t res = mBufferItemConsumer->acquireBuffer(buffer, 0, waitForFence);
 
     if (res != NO_ERROR) {
@@ -383,6 +393,14 @@ AImageReader::acquireImageLocked(/*out*/AImage** image, /*out*/int* acquireFence
         return AMEDIA_IMGREADER_NO_BUFFER_AVAILABLE;
     }
 
+    *outBuffer = buffer;
+    return AMEDIA_OK;
+}
+
+media_status_t
+AImageReader::createImageLocked(BufferItem* buffer,
+        /*out*/AImage** image, /*out*/int* acquireFenceFd) {
+    *image = nullptr;
     const int bufferWidth = getBufferWidth(buffer);
     const int bufferHeight = getBufferHeight(buffer);
     const int bufferFmt = buffer->mGraphicBuffer->getPixelFormat();
@@ -401,6 +419,8 @@ AImageReader::acquireImageLocked(/*out*/AImage** image, /*out*/int* acquireFence
         Point lt = buffer->mCrop.leftTop();
         if (lt.x != 0 || lt.y != 0) {
             ALOGE("Crop left top corner [%d, %d] not at origin", lt.x, lt.y);
+            mBufferItemConsumer->releaseBuffer(*buffer);
+            returnBufferItemLocked(buffer);
             return AMEDIA_ERROR_UNKNOWN;
         }
 
@@ -545,32 +565,36 @@ AImageReader::acquireLatestImage(/*out*/AImage** image, /*out*/int* acquireFence
     }
     Mutex::Autolock _l(mLock);
     *image = nullptr;
-    AImage* prevImage = nullptr;
-    AImage* nextImage = nullptr;
-    media_status_t ret = acquireImageLocked(&prevImage, acquireFenceFd);
-    if (prevImage == nullptr) {
+
+    // Skip to the newest queued buffer before setting up an AImage. Dropped buffers neither get
+    // an AImage nor wait for their acquire fence: they are released with that fence instead, so
+    // that the producer waits for it before refilling the buffer.
+    BufferItem* buffer = nullptr;
+    media_status_t ret = acquireBufferItemLocked(&buffer, /*waitForFence*/false);
+    if (ret != AMEDIA_OK) {
         return ret;
     }
     for (;;) {
-        ret = acquireImageLocked(&nextImage, acquireFenceFd);
-        if (nextImage == nullptr) {
-            *image = prevImage;
-            return AMEDIA_OK;
+        BufferItem* nextBuffer = nullptr;
+        if (acquireBufferItemLocked(&nextBuffer, /*waitForFence*/false) != AMEDIA_OK) {
+            break;
         }
+        mBufferItemConsumer->releaseBuffer(*buffer, buffer->mFence);
+        returnBufferItemLocked(buffer);
+        buffer = nextBuffer;
+    }
 
-        if (acquireFenceFd == nullptr) {
-            // No need for release fence here since the prevImage is unused and acquireImageLocked
-            // has already waited for acquired fence to be signaled.
-            prevImage->close();
-        } else {
-            // Use the acquire fence as release fence, so that producer can wait before trying to
-            // refill the buffer.
-            prevImage->close(*acquireFenceFd);
+    if (acquireFenceFd == nullptr && buffer->mFence->isValid()) {
+        status_t res = buffer->mFence->waitForever("AImageReader::acquireLatestImage");
+        if (res != OK) {
+            ALOGE("%s: Failed to wait for fence of acquired buffer: %s (%d)",
+                    __FUNCTION__, strerror(-res), res);
+            mBufferItemConsumer->releaseBuffer(*buffer);
+            returnBufferItemLocked(buffer);
+            return AMEDIA_ERROR_UNKNOWN;
         }
-        prevImage->free();
-        prevImage = nextImage;
-        nextImage = nullptr;
     }
+    return createImageLocked(buffer, image, acquireFenceFd);
 }
 
 EXPORT
@@ -85,6 +85,13 @@ struct AImageReader : public RefBase {
     // Called by AImageReader_acquireXXX to acquire a Buffer and setup AImage.
     media_status_t acquireImageLocked(/*out*/AImage** image, /*out*/int* fenceFd);
 
+    // Acquires the next queued buffer into a free BufferItem.
+    media_status_t acquireBufferItemLocked(/*out*/BufferItem** buffer, bool waitForFence);
+
+    // Sets up an AImage for an acquired buffer, or releases the buffer on failure.
+    media_status_t createImageLocked(BufferItem* buffer,
+            /*out*/AImage** image, /*out*/int* fenceFd);
+
     // Called by AImage to close image
     void releaseImageLocked(AImage* image, int releaseFenceFd);
 
@@ -359,6 +359,62 @@ ssize_t AMediaCodec_dequeueOutputBuffer(AMediaCodec *mData,
     return translate_error(ret);
 }
 
+EXPORT
+media_status_t AMediaCodec_queueInputBuffers(AMediaCodec *mData,
+        const size_t *idx, const AMediaCodecBufferInfo *info, size_t count, size_t *queued) {
+    Vector<MediaCodec::BufferDescriptor> buffers;
+    buffers.setCapacity(count);
+    for (size_t i = 0; i < count; ++i) {
+        MediaCodec::BufferDescriptor desc;
+        desc.mIndex = idx[i];
+        desc.mOffset = info[i].offset;
+        desc.mSize = info[i].size;
+        desc.mPresentationTimeUs = info[i].presentationTimeUs;
+        desc.mFlags = info[i].flags;
+        buffers.push_back(desc);
+    }
+
+    AString errorMsg;
+    size_t numQueued;
+    status_t ret = mData->mCodec->queueInputBuffers(buffers, &numQueued, &errorMsg);
+    if (queued != NULL) {
+        *queued = numQueued;
+    }
+    return translate_error(ret);
+}
+
+EXPORT
+ssize_t AMediaCodec_dequeueOutputBuffers(AMediaCodec *mData,
+        size_t *idx, AMediaCodecBufferInfo *info, size_t maxCount, int64_t timeoutUs) {
+    if (maxCount == 0) {
+        return AMEDIA_ERROR_INVALID_PARAMETER;
+    }
+    Vector<MediaCodec::BufferDescriptor> buffers;
+    status_t ret = mData->mCodec->dequeueOutputBuffers(&buffers, maxCount, timeoutUs);
+    requestActivityNotification(mData);
+    switch (ret) {
+        case OK:
+            for (size_t i = 0; i < buffers.size(); ++i) {
+                const MediaCodec::BufferDescriptor &desc = buffers[i];
+                idx[i] = desc.mIndex;
+                info[i].offset = desc.mOffset;
+                info[i].size = desc.mSize;
+                info[i].flags = desc.mFlags;
+                info[i].presentationTimeUs = desc.mPresentationTimeUs;
+            }
+            return buffers.size();
+        case -EAGAIN:
+            return AMEDIACODEC_INFO_TRY_AGAIN_LATER;
+        case android::INFO_FORMAT_CHANGED:
+            return AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED;
+        case INFO_OUTPUT_BUFFERS_CHANGED:
+            return AMEDIACODEC_INFO_OUTPUT_BUFFERS_CHANGED;
+        default:
+            break;
+    }
+    return translate_error(ret);
+}
+
 EXPORT
 AMediaFormat* AMediaCodec_getOutputFormat(AMediaCodec *mData) {
     sp<AMessage> format;
@@ -17,6 +17,11 @@
 #define LOG_TAG "SchedulingPolicyService"
 //#define LOG_NDEBUG 0
 
+#include <errno.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 #include <binder/IServiceManager.h>
 #include <utils/Mutex.h>
 #include "ISchedulingPolicyService.h"
@@ -59,4 +64,42 @@ int requestPriority(pid_t pid, pid_t tid, int32_t prio, bool isForApp, bool asyn
     return ret;
 }
 
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+// struct sched_attr of the sched_setattr() system call, which has no libc wrapper
+struct SchedAttr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t  sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+};
+
+int requestDeadline(pid_t tid, uint64_t runtimeNs, uint64_t deadlineNs, uint64_t periodNs)
+{
+#ifdef __NR_sched_setattr
+    SchedAttr attr = {};
+    attr.size = sizeof(attr);
+    attr.sched_policy = SCHED_DEADLINE;
+    attr.sched_runtime = runtimeNs;
+    attr.sched_deadline = deadlineNs;
+    attr.sched_period = periodNs;
+    if (syscall(__NR_sched_setattr, tid, &attr, 0 /*flags*/) != 0) {
+        return -errno;
+    }
+    return 0;
+#else
+    (void) tid;
+    (void) runtimeNs;
+    (void) deadlineNs;
+    (void) periodNs;
+    return -ENOSYS;
+#endif
+}
+
 }   // namespace android
@@ -26,6 +26,12 @@ namespace android {
 // The default value 'false' means to return after request has been enqueued and executed.
 int requestPriority(pid_t pid, pid_t tid, int32_t prio, bool isForApp, bool asynchronous = false);
 
+// Set thread tid to SCHED_DEADLINE, reserving runtimeNs of CPU time in each periodNs, to be
+// completed within deadlineNs of the start of the period.  Unlike requestPriority(), this is
+// not done by the system server: it needs CAP_SYS_NICE and a kernel with SCHED_DEADLINE.
+// Returns 0 on success, or a negative errno; callers should then fall back to requestPriority().
+int requestDeadline(pid_t tid, uint64_t runtimeNs, uint64_t deadlineNs, uint64_t periodNs);
+
 }   // namespace android
 
 #endif  // _ANDROID_SCHEDULING_POLICY_SERVICE_H
@@ -31,7 +31,9 @@ LOCAL_SRC_FILES:=               \
     PatchPanel.cpp              \
     StateQueue.cpp              \
     BufLog.cpp                  \
-    TypedLogger.cpp
+    TypedLogger.cpp             \
+    WritePeriodController.cpp   \
+    BurstWriteController.cpp
 
 LOCAL_C_INCLUDES := \
     $(TOPDIR)frameworks/av/services/audiopolicy \
@@ -49,6 +51,7 @@ LOCAL_SHARED_LIBRARIES := \
     libbinder \
     libaudioclient \
     libmedialogservice \
+    libmediametrics \
     libmediautils \
     libnbaio \
     libpowermanager \
@@ -49,6 +49,7 @@
 #include "AudioFlinger.h"
 #include "ServiceUtilities.h"
 
+#include <media/AudioResampler.h>
 #include <media/AudioResamplerPublic.h>
 
 #include <system/audio_effects/effect_visualizer.h>
@@ -146,6 +147,7 @@ std::string formatToString(audio_format_t format) {
 AudioFlinger::AudioFlinger()
     : BnAudioFlinger(),
       mMediaLogNotifier(new AudioFlinger::MediaLogNotifier()),
+      mCreateTrackLatencyNs(1000 /* 1 us */),
       mPrimaryHardwareDev(NULL),
       mAudioHwDevs(NULL),
       mHardwareStatus(AUDIO_HW_IDLE),
@@ -389,6 +391,28 @@ void AudioFlinger::dumpClients(int fd, const Vector<String16>& args __unused)
         }
     }
 
+    result.append("Retained clients:\n");
+    for (size_t i = 0; i < mRetainedClients.size(); ++i) {
+        snprintf(buffer, SIZE, "  pid: %d\n", mRetainedClients[i]->pid());
+        result.append(buffer);
+    }
+
+    {
+        Mutex::Autolock _ll(mCreateTrackLatencyLock);
+        const uint32_t n = mCreateTrackLatencyNs.n();
+        snprintf(buffer, SIZE, "Track creation latency (ms): %u tracks", n);
+        result.append(buffer);
+        if (n > 0) {
+            snprintf(buffer, SIZE, ", p50 %.3f p90 %.3f p99 %.3f p99.9 %.3f",
+                    mCreateTrackLatencyNs.percentile(50) * 1e-6,
+                    mCreateTrackLatencyNs.percentile(90) * 1e-6,
+                    mCreateTrackLatencyNs.percentile(99) * 1e-6,
+                    mCreateTrackLatencyNs.percentile(99.9) * 1e-6);
+            result.append(buffer);
+        }
+        result.append("\n");
+    }
+
     result.append("Notification Clients:\n");
     for (size_t i = 0; i < mNotificationClients.size(); ++i) {
         snprintf(buffer, SIZE, "  pid: %d\n", mNotificationClients.keyAt(i));
@@ -419,6 +443,8 @@ void AudioFlinger::dumpInternals(int fd, const Vector<String16>& args __unused)
                             (uint32_t)(mStandbyTimeInNsecs / 1000000));
     result.append(buffer);
     write(fd, result.string(), result.size());
+
+    AudioResampler::dumpFilterCache(fd);
 }
 
 void AudioFlinger::dumpPermissionDenial(int fd, const Vector<String16>& args __unused)
@@ -575,6 +601,23 @@ sp<AudioFlinger::Client> AudioFlinger::registerPid(pid_t pid)
         mClients.add(pid, client);
     }
 
+    // Keep the most recently active clients alive when their last track goes away, so that
+    // apps creating many short-lived tracks (e.g. SoundPool) don't get a new shared heap,
+    // which they then have to map, for each of them.
+    if (!isLowRamDevice()) {
+        for (size_t i = 0; i < mRetainedClients.size(); i++) {
+            if (mRetainedClients[i] == client) {
+                mRetainedClients.removeAt(i);
+                break;
+            }
+        }
+        mRetainedClients.push(client);
+        if (mRetainedClients.size() > kMaxRetainedClients) {
+            // may call ~Client(), which requires mClientLock
+            mRetainedClients.removeAt(0);
+        }
+    }
+
     return client;
 }
 
@@ -657,6 +700,7 @@ sp<IAudioTrack> AudioFlinger::createTrack(
     sp<Client> client;
     status_t lStatus;
     audio_session_t lSessionId;
+    const nsecs_t startNs = systemTime();
 
     const uid_t callingUid = IPCThreadState::self()->getCallingUid();
     if (pid == -1 || !isTrustedCallingUid(callingUid)) {
@@ -791,6 +835,11 @@ sp<IAudioTrack> AudioFlinger::createTrack(
     // return handle to client
     trackHandle = new TrackHandle(track);
 
+    {
+        Mutex::Autolock _ll(mCreateTrackLatencyLock);
+        mCreateTrackLatencyNs.sample(systemTime() - startNs);
+    }
+
 Exit:
     *status = lStatus;
     return trackHandle;
@@ -1087,6 +1136,49 @@ status_t AudioFlinger::setStreamVolume(audio_stream_type_t stream, float value,
     return NO_ERROR;
 }
 
+status_t AudioFlinger::setStreamVolumes(const Vector<audio_stream_type_t>& streams,
+        const Vector<float>& values, audio_io_handle_t output)
+{
+    // check calling permissions
+    if (!settingsAllowed()) {
+        return PERMISSION_DENIED;
+    }
+    if (streams.size() != values.size()) {
+        return BAD_VALUE;
+    }
+
+    // validate the whole batch before applying any of it
+    for (size_t i = 0; i < streams.size(); i++) {
+        status_t status = checkStreamType(streams[i]);
+        if (status != NO_ERROR) {
+            return status;
+        }
+        ALOG_ASSERT(streams[i] != AUDIO_STREAM_PATCH,
+                "attempt to change AUDIO_STREAM_PATCH volume");
+    }
+
+    AutoMutex lock(mLock);
+    Vector<VolumeInterface *> volumeInterfaces;
+    if (output != AUDIO_IO_HANDLE_NONE) {
+        VolumeInterface *volumeInterface = getVolumeInterface_l(output);
+        if (volumeInterface == NULL) {
+            return BAD_VALUE;
+        }
+        volumeInterfaces.add(volumeInterface);
+    } else {
+        volumeInterfaces = getAllVolumeInterfaces_l();
+    }
+
+    for (size_t i = 0; i < streams.size(); i++) {
+        mStreamTypes[streams[i]].volume = values[i];
+        for (size_t j = 0; j < volumeInterfaces.size(); j++) {
+            volumeInterfaces[j]->setStreamVolume(streams[i], values[i]);
+        }
+    }
+
+    return NO_ERROR;
+}
+
 status_t AudioFlinger::setStreamMute(audio_stream_type_t stream, bool muted)
 {
     // check calling permissions
@@ -1425,6 +1517,13 @@ void AudioFlinger::removeNotificationClient(pid_t pid)
     {
         Mutex::Autolock _cl(mClientLock);
         mNotificationClients.removeItem(pid);
+        // the process is gone, so there is no point in keeping its shared heap
+        for (size_t i = 0; i < mRetainedClients.size(); i++) {
+            if (mRetainedClients[i]->pid() == pid) {
+                mRetainedClients.removeAt(i);
+                break;
+            }
+        }
     }
 
     ALOGV("%d died, releasing its sessions", pid);
@@ -1726,12 +1825,40 @@ audio_module_handle_t AudioFlinger::loadHwModule(const char *name)
     if (!settingsAllowed()) {
         return AUDIO_MODULE_HANDLE_NONE;
     }
+    {
+        Mutex::Autolock _l(mLock);
+        audio_module_handle_t handle = findLoadedHwModule_l(name);
+        if (handle != AUDIO_MODULE_HANDLE_NONE) {
+            return handle;
+        }
+    }
+    // Opening a HAL can be slow: do it without holding mLock, so that the policy manager
+    // can load several modules at the same time. addHwDevice_l() handles the case where
+    // the same module was loaded in the meantime.
+    sp<DeviceHalInterface> dev;
+    if (openHwDevice(name, &dev) != NO_ERROR) {
+        return AUDIO_MODULE_HANDLE_NONE;
+    }
     Mutex::Autolock _l(mLock);
-    return loadHwModule_l(name);
+    return addHwDevice_l(name, dev);
 }
 
 // loadHwModule_l() must be called with AudioFlinger::mLock held
 audio_module_handle_t AudioFlinger::loadHwModule_l(const char *name)
+{
+    audio_module_handle_t handle = findLoadedHwModule_l(name);
+    if (handle != AUDIO_MODULE_HANDLE_NONE) {
+        return handle;
+    }
+    sp<DeviceHalInterface> dev;
+    if (openHwDevice(name, &dev) != NO_ERROR) {
+        return AUDIO_MODULE_HANDLE_NONE;
+    }
+    return addHwDevice_l(name, dev);
+}
+
+// findLoadedHwModule_l() must be called with AudioFlinger::mLock held
+audio_module_handle_t AudioFlinger::findLoadedHwModule_l(const char *name)
 {
     for (size_t i = 0; i < mAudioHwDevs.size(); i++) {
         if (strncmp(mAudioHwDevs.valueAt(i)->moduleName(), name, strlen(name)) == 0) {
@@ -1739,21 +1866,37 @@ audio_module_handle_t AudioFlinger::loadHwModule_l(const char *name)
             return mAudioHwDevs.keyAt(i);
         }
     }
+    return AUDIO_MODULE_HANDLE_NONE;
+}
 
-    sp<DeviceHalInterface> dev;
-
-    int rc = mDevicesFactoryHal->openDevice(name, &dev);
+// openHwDevice() does not need AudioFlinger::mLock
+status_t AudioFlinger::openHwDevice(const char *name, sp<DeviceHalInterface> *dev)
+{
+    int rc = mDevicesFactoryHal->openDevice(name, dev);
     if (rc) {
         ALOGE("loadHwModule() error %d loading module %s", rc, name);
-        return AUDIO_MODULE_HANDLE_NONE;
+        return rc;
     }
 
     mHardwareStatus = AUDIO_HW_INIT;
-    rc = dev->initCheck();
+    rc = (*dev)->initCheck();
     mHardwareStatus = AUDIO_HW_IDLE;
     if (rc) {
         ALOGE("loadHwModule() init check error %d for module %s", rc, name);
-        return AUDIO_MODULE_HANDLE_NONE;
+        dev->clear();
+        return rc;
+    }
+    return NO_ERROR;
+}
+
+// addHwDevice_l() must be called with AudioFlinger::mLock held
+audio_module_handle_t AudioFlinger::addHwDevice_l(const char *name,
+                                                  const sp<DeviceHalInterface>& dev)
+{
+    // the module may have been loaded by another thread while dev was opened
+    audio_module_handle_t loadedHandle = findLoadedHwModule_l(name);
+    if (loadedHandle != AUDIO_MODULE_HANDLE_NONE) {
+        return loadedHandle;
     }
 
     // Check and cache this HAL's level of support for master mute and master
@@ -37,6 +37,8 @@
 #include <media/MmapStreamInterface.h>
 #include <media/MmapStreamCallback.h>
 
+#include <cpustats/LogHistogram.h>
+
 #include <utils/Atomic.h>
 #include <utils/Errors.h>
 #include <utils/threads.h>
@@ -64,6 +66,8 @@
 #include "FastMixer.h"
 #include <media/nbaio/NBAIO.h>
 #include "AudioWatchdog.h"
+#include "WritePeriodController.h"
+#include "BurstWriteController.h"
 #include "AudioStreamOut.h"
 #include "SpdifStreamOut.h"
 #include "AudioHwDevice.h"
@@ -97,6 +101,8 @@ static const nsecs_t kDefaultStandbyTimeInNsecs = seconds(3);
 static const size_t kClientSharedHeapSizeBytes = 1024*1024;
 // Shared memory size multiplier for non low ram devices
 static const size_t kClientSharedHeapSizeMultiplier = 4;
+// Number of recently active client processes whose shared heap is kept when they have no tracks
+static const size_t kMaxRetainedClients = 4;
 
 #define INCLUDING_FROM_AUDIOFLINGER_H
 
@@ -160,6 +166,9 @@ public:
 
     virtual     status_t    setStreamVolume(audio_stream_type_t stream, float value,
                                             audio_io_handle_t output);
+    virtual     status_t    setStreamVolumes(const Vector<audio_stream_type_t>& streams,
+                                             const Vector<float>& values,
+                                             audio_io_handle_t output);
     virtual     status_t    setStreamMute(audio_stream_type_t stream, bool muted);
 
     virtual     float       streamVolume(audio_stream_type_t stream,
@@ -723,6 +732,12 @@ private:
     mutable     Mutex                               mClientLock;
                 // protected by mClientLock
                 DefaultKeyedVector< pid_t, wp<Client> >     mClients;   // see ~Client()
+                // protected by mClientLock, most recently used last, see registerPid()
+                Vector< sp<Client> >                        mRetainedClients;
+
+                // wall time of successful createTrack() calls in ns, for dumpsys
+                Mutex                               mCreateTrackLatencyLock;
+                LogHistogram                        mCreateTrackLatencyNs;
 
                 mutable     Mutex                   mHardwareLock;
                 // NOTE: If both mLock and mHardwareLock mutexes must be held,
@@ -787,6 +802,11 @@ private:
                 float       masterVolume_l() const;
                 bool        masterMute_l() const;
                 audio_module_handle_t loadHwModule_l(const char *name);
+                audio_module_handle_t findLoadedHwModule_l(const char *name);
+                // opens and checks the HAL of a module, without registering it
+                status_t    openHwDevice(const char *name, sp<DeviceHalInterface> *dev);
+                audio_module_handle_t addHwDevice_l(const char *name,
+                                                    const sp<DeviceHalInterface>& dev);
 
                 Vector < sp<SyncEvent> > mPendingSyncEvents; // sync events awaiting for a session
                                                              // to be created
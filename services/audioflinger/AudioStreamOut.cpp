@@ -115,6 +115,23 @@ status_t AudioStreamOut::getPresentationPosition(uint64_t *frames, struct timesp
     return status;
 }
 
+status_t AudioStreamOut::getQueuedFrames(uint64_t *frames)
+{
+    if (!mHalFormatHasProportionalFrames) {
+        return INVALID_OPERATION;
+    }
+    uint64_t position;
+    struct timespec timestamp;
+    status_t status = getPresentationPosition(&position, &timestamp);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    // both are relative to the last standby
+    const uint64_t written = (mFramesWritten - mFramesWrittenAtStandby) / mRateMultiplier;
+    *frames = written > position ? written - position : 0;
+    return status;
+}
+
 status_t AudioStreamOut::open(
         audio_io_handle_t handle,
         audio_devices_t devices,
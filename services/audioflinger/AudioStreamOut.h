@@ -60,6 +60,13 @@ public:
 
     virtual status_t getPresentationPosition(uint64_t *frames, struct timespec *timestamp);
 
+    /**
+     * Get the number of frames written to the HAL which have not been presented yet,
+     * from the presentation position. PCM streams only.
+     * @return frames in the perspective of the application and the AudioFlinger.
+     */
+    status_t getQueuedFrames(uint64_t *frames);
+
     /**
     * Write audio buffer to driver. Returns number of bytes written, or a
     * negative status_t. If at least one frame was written successfully prior to the error,
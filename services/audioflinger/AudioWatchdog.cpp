@@ -21,8 +21,6 @@
 #include <utils/Log.h>
 #include "AudioWatchdog.h"
 
-#ifdef AUDIO_WATCHDOG
-
 namespace android {
 
 void AudioWatchdogDump::dump(int fd)
@@ -36,6 +34,30 @@ void AudioWatchdogDump::dump(int fd)
     }
     dprintf(fd, "Watchdog: underruns=%u, logs=%u, most recent underrun log at %s",
             mUnderruns, mLogs, buf);
+    if (mSamplePeriodUs == 0) {
+        return;
+    }
+    uint32_t totalSamples = 0;
+    for (uint32_t phase = 0; phase < FastThreadDumpState::PHASE_CNT; ++phase) {
+        totalSamples += mPhaseSamples[phase];
+    }
+    dprintf(fd, "  Fast thread phases sampled every %u us, %u samples\n",
+            mSamplePeriodUs, totalSamples);
+    dprintf(fd, "  Phase instances by number of consecutive samples:\n");
+    dprintf(fd, "    %-8s   time%%", "phase");
+    for (uint32_t i = 0; i < kPhaseHistogramBuckets; ++i) {
+        dprintf(fd, " %6u%s", 1u << i, i + 1 < kPhaseHistogramBuckets ? "" : "+");
+    }
+    dprintf(fd, "\n");
+    for (uint32_t phase = 0; phase < FastThreadDumpState::PHASE_CNT; ++phase) {
+        dprintf(fd, "    %-8s %6.1f%%",
+                FastThreadDumpState::phaseToString((FastThreadDumpState::Phase) phase),
+                totalSamples != 0 ? mPhaseSamples[phase] * 100. / totalSamples : 0.);
+        for (uint32_t i = 0; i < kPhaseHistogramBuckets; ++i) {
+            dprintf(fd, " %6u", mPhaseHistogram[phase][i]);
+        }
+        dprintf(fd, "\n");
+    }
 }
 
 bool AudioWatchdog::threadLoop()
@@ -46,6 +68,8 @@ bool AudioWatchdog::threadLoop()
             mMyCond.wait(mMyLock);
             // ignore previous timestamp after resume()
             mOldTsValid = false;
+            // the fast thread was idle, so the phase instance seen last is over
+            mPhaseRunValid = false;
             // force an immediate log on first underrun after resume()
             mLogTs.tv_sec = MIN_TIME_BETWEEN_LOGS_SEC;
             mLogTs.tv_nsec = 0;
@@ -91,14 +115,18 @@ bool AudioWatchdog::threadLoop()
             mDump->mLogs = ++mLogs;
             mDump->mMostRecent = time(NULL);
             ALOGW("Insufficient CPU for load: expected=%.1f actual=%.1f ms; underruns=%u logs=%u",
-                mPeriodNs * 1e-6, cycleNs * 1e-6, mUnderruns, mLogs);
+                (mPhase != NULL ? mSamplePeriodNs : mPeriodNs) * 1e-6, cycleNs * 1e-6,
+                mUnderruns, mLogs);
             mLogTs.tv_sec = 0;
             mLogTs.tv_nsec = 0;
         }
     }
+    if (mPhase != NULL) {
+        samplePhase();
+    }
     struct timespec req;
     req.tv_sec = 0;
-    req.tv_nsec = mPeriodNs;
+    req.tv_nsec = mPhase != NULL ? mSamplePeriodNs : mPeriodNs;
     rc = nanosleep(&req, NULL);
     if (!((rc == 0) || (rc == -1 && errno == EINTR))) {
         pause();
@@ -107,6 +135,33 @@ bool AudioWatchdog::threadLoop()
     return true;
 }
 
+void AudioWatchdog::samplePhase()
+{
+    const uint32_t word = *mPhase;
+    const uint32_t phase = word & FastThreadDumpState::kPhaseMask;
+    if (phase >= FastThreadDumpState::PHASE_CNT) {
+        mPhaseRunValid = false;
+        return;
+    }
+    mDump->mPhaseSamples[phase]++;
+    if (mPhaseRunValid && word == mPhaseWord) {
+        // still in the same instance of the phase
+        mPhaseRun++;
+        return;
+    }
+    if (mPhaseRunValid) {
+        // the previous phase instance lasted about mPhaseRun sample periods
+        uint32_t bucket = 31 - __builtin_clz(mPhaseRun);
+        if (bucket >= AudioWatchdogDump::kPhaseHistogramBuckets) {
+            bucket = AudioWatchdogDump::kPhaseHistogramBuckets - 1;
+        }
+        mDump->mPhaseHistogram[mPhaseWord & FastThreadDumpState::kPhaseMask][bucket]++;
+    }
+    mPhaseWord = word;
+    mPhaseRun = 1;
+    mPhaseRunValid = true;
+}
+
 void AudioWatchdog::requestExit()
 {
     // must be in this order to avoid a race condition
@@ -134,6 +189,21 @@ void AudioWatchdog::setDump(AudioWatchdogDump *dump)
     mDump = dump != NULL ? dump : &mDummyDump;
 }
 
-}   // namespace android
+void AudioWatchdog::setProfiling(const uint32_t *phase, uint32_t samplePeriodUs)
+{
+    if (phase == NULL || samplePeriodUs == 0) {
+        mPhase = NULL;
+        mDump->mSamplePeriodUs = 0;
+        return;
+    }
+    // nanosleep() is given less than one second
+    if (samplePeriodUs > 999999) {
+        samplePeriodUs = 999999;
+    }
+    mPhase = phase;
+    mSamplePeriodNs = samplePeriodUs * 1000;
+    mPhaseRunValid = false;
+    mDump->mSamplePeriodUs = samplePeriodUs;
+}
 
-#endif // AUDIO_WATCHDOG
+}   // namespace android
@@ -17,24 +17,39 @@
 // The watchdog thread runs periodically.  It has two functions:
 //   (a) verify that adequate CPU time is available, and log
 //       as soon as possible when there appears to be a CPU shortage
-//   (b) monitor the other threads [not yet implemented]
+//   (b) monitor the other threads: when profiling, sample the phase of a fast thread
+//       and build a distribution of the duration of each phase
 
 #ifndef AUDIO_WATCHDOG_H
 #define AUDIO_WATCHDOG_H
 
+#include <string.h>
 #include <time.h>
 #include <utils/Thread.h>
+#include "FastThreadDumpState.h"
 
 namespace android {
 
 // Keeps a cache of AudioWatchdog statistics that can be logged by dumpsys.
 // The usual caveats about atomicity of information apply.
 struct AudioWatchdogDump {
-    AudioWatchdogDump() : mUnderruns(0), mLogs(0), mMostRecent(0) { }
+    AudioWatchdogDump() : mUnderruns(0), mLogs(0), mMostRecent(0), mSamplePeriodUs(0) {
+        memset(mPhaseSamples, 0, sizeof(mPhaseSamples));
+        memset(mPhaseHistogram, 0, sizeof(mPhaseHistogram));
+    }
     /*virtual*/ ~AudioWatchdogDump() { }
     uint32_t mUnderruns;    // total number of underruns
     uint32_t mLogs;         // total number of log messages
     time_t   mMostRecent;   // time of most recent log
+
+    // Phase profile, only when mSamplePeriodUs != 0.
+    // Bucket i of the histogram counts the phase instances which were seen by
+    // [2^i, 2^(i+1)) consecutive samples, the last bucket is unbounded.
+    static const uint32_t kPhaseHistogramBuckets = 12;
+    uint32_t mSamplePeriodUs;
+    uint32_t mPhaseSamples[FastThreadDumpState::PHASE_CNT];     // samples seen in each phase
+    uint32_t mPhaseHistogram[FastThreadDumpState::PHASE_CNT][kPhaseHistogramBuckets];
+
     void     dump(int fd);  // should only be called on a stable copy, not the original
 };
 
@@ -45,7 +60,8 @@ public:
             mPeriodNs(periodMs * 1000000), mMaxCycleNs(mPeriodNs * 2),
             // mOldTs
             // mLogTs initialized below
-            mOldTsValid(false), mUnderruns(0), mLogs(0), mDump(&mDummyDump)
+            mOldTsValid(false), mUnderruns(0), mLogs(0), mDump(&mDummyDump),
+            mPhase(NULL), mSamplePeriodNs(0), mPhaseWord(0), mPhaseRun(0), mPhaseRunValid(false)
         {
 #define MIN_TIME_BETWEEN_LOGS_SEC 60
             // force an immediate log on first underrun
@@ -65,8 +81,14 @@ public:
     // Where to store the dump, or NULL to not update
     void            setDump(AudioWatchdogDump* dump);
 
+    // Enables continuous profiling of a fast thread: the thread then wakes up every
+    // samplePeriodUs to read phase, which is the FastThreadDumpState::mPhase of the fast
+    // thread. Must be called after setDump() and before run().
+    void            setProfiling(const uint32_t* phase, uint32_t samplePeriodUs);
+
 private:
     virtual bool    threadLoop();
+            void    samplePhase();
 
     Mutex           mMyLock;        // Thread::mLock is private
     Condition       mMyCond;        // Thread::mThreadExitedCondition is private
@@ -81,6 +103,13 @@ private:
     uint32_t        mLogs;          // total number of logs
     AudioWatchdogDump*  mDump;      // where to store the dump, always non-NULL
     AudioWatchdogDump   mDummyDump; // default area for dump in case setDump() is not called
+
+    // accessed only by threadLoop(), after setProfiling()
+    const volatile uint32_t* mPhase; // phase of the profiled fast thread, or NULL
+    uint32_t        mSamplePeriodNs; // period of threadLoop() when profiling
+    uint32_t        mPhaseWord;     // phase and sequence at the previous sample
+    uint32_t        mPhaseRun;      // number of consecutive samples which have seen mPhaseWord
+    bool            mPhaseRunValid; // whether mPhaseWord and mPhaseRun are valid
 };
 
 }   // namespace android
@@ -24,6 +24,7 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <string.h>
+#include <system/audio.h>
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
@@ -55,11 +56,19 @@ bool BufLogSingleton::instanceExists() {
 // BufLog
 // ------------------------------
 
-BufLog::BufLog() {
+BufLog::BufLog() : mExiting(false), mTriggered(false) {
     memset(mStreams, 0, sizeof(mStreams));
+    mDrainThread = std::thread(&BufLog::drainLoop, this);
 }
 
 BufLog::~BufLog() {
+    {
+        std::lock_guard<std::mutex> drainLock(mDrainLock);
+        mExiting = true;
+    }
+    mDrainCond.notify_one();
+    mDrainThread.join();
+
     android::Mutex::Autolock autoLock(mLock);
 
     for (unsigned int id = 0; id < BUFLOG_MAXSTREAMS; id++) {
@@ -88,6 +97,7 @@ size_t BufLog::write(int streamid, const char *tag, int format, int channels,
 }
 
 void BufLog::reset() {
+    std::lock_guard<std::mutex> drainLock(mDrainLock);
     android::Mutex::Autolock autoLock(mLock);
     ALOGV("Resetting all BufLogs");
     int count = 0;
@@ -103,6 +113,33 @@ void BufLog::reset() {
     ALOGV("Reset %d BufLogs", count);
 }
 
+void BufLog::trigger() {
+    mTriggered = true;
+}
+
+void BufLog::drainLoop() {
+    std::unique_lock<std::mutex> drainLock(mDrainLock);
+    while (!mExiting) {
+        mDrainCond.wait_for(drainLock, std::chrono::milliseconds(BUFLOG_WRITE_PERIOD_MS));
+        drainAll(mTriggered.exchange(false));
+    }
+}
+
+// must be called with mDrainLock held, so that the streams are not deleted meanwhile
+void BufLog::drainAll(bool saveRolling) {
+    BufLogStream *streams[BUFLOG_MAXSTREAMS];
+    {
+        // only hold mLock long enough to not delay the audio threads calling write()
+        android::Mutex::Autolock autoLock(mLock);
+        memcpy(streams, mStreams, sizeof(streams));
+    }
+    for (unsigned int id = 0; id < BUFLOG_MAXSTREAMS; id++) {
+        if (streams[id] != NULL) {
+            streams[id]->drain(saveRolling);
+        }
+    }
+}
+
 // ------------------------------
 // BufLogStream
 // ------------------------------
@@ -113,8 +150,12 @@ BufLogStream::BufLogStream(unsigned int id,
         unsigned int channels,
         unsigned int samplingRate,
         size_t maxBytes = 0) : mId(id), mFormat(format), mChannels(channels),
-                mSamplingRate(samplingRate), mMaxBytes(maxBytes) {
+                mSamplingRate(samplingRate), mMaxBytes(maxBytes),
+                mRolling(BUFLOG_ROLLING_SECONDS > 0) {
     mByteCount = 0l;
+    mBytesWritten = 0l;
+    mClosed = false;
+    mFile = NULL;
     mPaused = false;
     if (tag != NULL) {
         strncpy(mTag, tag, BUFLOGSTREAM_MAX_TAGSIZE);
@@ -132,17 +173,25 @@ BufLogStream::BufLogStream(unsigned int id,
     struct tm tm;
     localtime_r(&tv.tv_sec, &tm);
     strftime(timeStr, sizeof(timeStr), "%Y%m%d%H%M%S", &tm);
-    char logPath[BUFLOG_MAX_PATH_SIZE];
-    snprintf(logPath, BUFLOG_MAX_PATH_SIZE, "%s/%s_%d_%s_%d_%d_%d.raw", BUFLOG_BASE_PATH, timeStr,
+    // the file is opened by the background thread; rolling streams get "_trigger" added to it
+    snprintf(mPath, BUFLOG_MAX_PATH_SIZE, "%s/%s_%d_%s_%d_%d_%d", BUFLOG_BASE_PATH, timeStr,
             mId, mTag, mFormat, mChannels, mSamplingRate);
-    ALOGV("data output: %s", logPath);
+    ALOGV("data output: %s", mPath);
 
-    mFile = fopen(logPath, "wb");
-    if (mFile != NULL) {
-        ALOGV("Success creating file at: %p", mFile);
-    } else {
-        ALOGE("Error: could not create file BufLogStream %s", strerror(errno));
+    size_t bytesPerSample = audio_bytes_per_sample((audio_format_t) mFormat);
+    if (bytesPerSample == 0) {
+        bytesPerSample = sizeof(int32_t);
     }
+    size_t fifoBytes = (size_t) mSamplingRate * mChannels * bytesPerSample
+            * (mRolling ? BUFLOG_ROLLING_SECONDS : BUFLOG_FIFO_SECONDS);
+    if (fifoBytes < 65536) {
+        fifoBytes = 65536;
+    }
+    mFifoBuffer = new uint8_t[fifoBytes];
+    mFifo = new audio_utils_fifo(fifoBytes, sizeof(uint8_t), mFifoBuffer,
+            false /*throttlesWriter*/);
+    mFifoWriter = new audio_utils_fifo_writer(*mFifo);
+    mFifoReader = new audio_utils_fifo_reader(*mFifo, false /*throttlesWriter*/, true /*flush*/);
 }
 
 void BufLogStream::closeStream_l() {
@@ -151,30 +200,37 @@ void BufLogStream::closeStream_l() {
         fclose(mFile);
         mFile = NULL;
     }
+    mClosed = true;
 }
 
 BufLogStream::~BufLogStream() {
     ALOGV("Destroying BufLogStream id:%d tag:%s", mId, mTag);
-    android::Mutex::Autolock autoLock(mLock);
-    closeStream_l();
+    {
+        android::Mutex::Autolock autoLock(mLock);
+        if (!mRolling) {
+            drain_l(false);
+        }
+        closeStream_l();
+    }
+    delete mFifoReader;
+    delete mFifoWriter;
+    delete mFifo;
+    delete[] mFifoBuffer;
 }
 
 size_t BufLogStream::write(const void *buf, size_t size) {
 
     size_t bytes = 0;
-    if (!mPaused && mFile != NULL) {
+    if (!mPaused && !mClosed) {
         if (size > 0 && buf != NULL) {
-            android::Mutex::Autolock autoLock(mLock);
-            if (mMaxBytes > 0) {
+            if (mMaxBytes > 0 && !mRolling) {
                 size = MIN(size, mMaxBytes - mByteCount);
             }
-            bytes = fwrite(buf, 1, size, mFile);
+            ssize_t written = mFifoWriter->write(buf, size);
+            bytes = written > 0 ? written : 0;
             mByteCount += bytes;
-            if (mMaxBytes > 0 && mMaxBytes == mByteCount) {
-                closeStream_l();
-            }
         }
-        ALOGV("wrote %zu/%zu bytes to BufLogStream %d tag:%s. Total Bytes: %zu", bytes, size, mId,
+        ALOGV("queued %zu/%zu bytes to BufLogStream %d tag:%s. Total Bytes: %zu", bytes, size, mId,
                 mTag, mByteCount);
     } else {
         ALOGV("Warning: trying to write to %s BufLogStream id:%d tag:%s",
@@ -183,6 +239,56 @@ size_t BufLogStream::write(const void *buf, size_t size) {
     return bytes;
 }
 
+void BufLogStream::drain(bool saveRolling) {
+    android::Mutex::Autolock autoLock(mLock);
+    drain_l(saveRolling);
+}
+
+void BufLogStream::drain_l(bool saveRolling) {
+    if (mClosed || (mRolling && !saveRolling)) {
+        return;
+    }
+
+    char logPath[BUFLOG_MAX_PATH_SIZE + 16];
+    if (mRolling) {
+        snprintf(logPath, sizeof(logPath), "%s_trigger.raw", mPath);
+        mFile = fopen(logPath, "wb");
+    } else if (mFile == NULL) {
+        snprintf(logPath, sizeof(logPath), "%s.raw", mPath);
+        mFile = fopen(logPath, "wb");
+        if (mFile == NULL) {
+            ALOGE("Error: could not create file BufLogStream %s", strerror(errno));
+            closeStream_l();
+            return;
+        }
+    }
+    if (mFile == NULL) {
+        ALOGE("Error: could not create file BufLogStream %s", strerror(errno));
+        return;
+    }
+
+    uint8_t chunk[4096];
+    for (;;) {
+        size_t lost = 0;
+        ssize_t bytes = mFifoReader->read(chunk, sizeof(chunk), NULL /*timeout*/, &lost);
+        if (lost > 0 && !mRolling) {
+            ALOGW("BufLogStream id:%d tag:%s dropped %zu bytes", mId, mTag, lost);
+        }
+        if (bytes <= 0) {
+            break;
+        }
+        mBytesWritten += fwrite(chunk, 1, bytes, mFile);
+    }
+
+    if (mRolling) {
+        ALOGV("saved BufLogStream id:%d tag:%s to %s", mId, mTag, logPath);
+        fclose(mFile);
+        mFile = NULL;
+    } else if (mMaxBytes > 0 && mBytesWritten >= mMaxBytes) {
+        closeStream_l();
+    }
+}
+
 bool BufLogStream::setPause(bool pause) {
     bool old = mPaused;
     mPaused = pause;
@@ -23,6 +23,14 @@
  * are named following this format:
  *   YYYYMMDDHHMMSS_id_format_channels_samplingrate.raw
  *
+ * The thread calling BUFLOG only copies the data into a FIFO. A background thread writes it out,
+ * so that file I/O doesn't delay the audio threads being debugged. If the file can't keep up,
+ * data is dropped and a warning is logged.
+ *
+ * If BUFLOG_ROLLING_SECONDS is not 0, streams instead keep only their most recent
+ * BUFLOG_ROLLING_SECONDS of data, and save it to a file, with "_trigger" added to the name,
+ * each time BUFLOG_TRIGGER is used, e.g. when an underrun is detected.
+ *
  * Normally we strip BUFLOG dumps from release builds.
  * You can modify this (for example with "#define BUFLOG_NDEBUG 0"
  * at the top of your source file) to change that behavior.
@@ -64,6 +72,9 @@
  *  BUFLOG_RESET        If an instance of BufLog exists, it stops the capture and closes all
  *                      streams.
  *                      If a new call to BUFLOG(..) is done, new streams are created.
+ *
+ *  BUFLOG_TRIGGER      If an instance of BufLog exists, requests that the rolling streams be
+ *                      saved. Does not block, so it may be used on audio threads.
  */
 
 #ifndef BUFLOG_NDEBUG
@@ -100,15 +111,29 @@
 #endif
 
 
+#ifndef BUFLOG_TRIGGER
+#define BUFLOG_TRIGGER do { if (BufLogSingleton::instanceExists()) { \
+    BufLogSingleton::instance()->trigger(); } } while (0)
+#endif
+
+
+#include <atomic>
+#include <audio_utils/fifo.h>
+#include <condition_variable>
+#include <mutex>
 #include <stdint.h>
 #include <stdio.h>
 #include <sys/types.h>
+#include <thread>
 #include <utils/Mutex.h>
 
 //BufLog configuration
 #define BUFLOGSTREAM_MAX_TAGSIZE    32
 #define BUFLOG_BASE_PATH            "/data/misc/audioserver"
 #define BUFLOG_MAX_PATH_SIZE        300
+#define BUFLOG_FIFO_SECONDS         1       // FIFO size of the streams written continuously
+#define BUFLOG_ROLLING_SECONDS      0       // 0 for continuous capture
+#define BUFLOG_WRITE_PERIOD_MS      50      // how often the background thread writes out data
 
 class BufLogStream {
 public:
@@ -120,11 +145,15 @@ public:
             size_t maxBytes);
     ~BufLogStream();
 
-    // write buffer to stream
+    // write buffer to stream, without blocking. Only one thread may write to a stream.
     //  buf:  pointer to buffer
     //  size: number of bytes to write
     size_t          write(const void *buf, size_t size);
 
+    // write the data received so far to the file. Called by the BufLog background thread.
+    //  saveRolling: for a rolling stream, save its most recent data to a new file
+    void            drain(bool saveRolling);
+
     // pause/resume stream
     //  pause: true = paused, false = not paused
     //  return value: previous state of stream (paused or not).
@@ -142,11 +171,20 @@ private:
     const unsigned int  mChannels;
     const unsigned int  mSamplingRate;
     const size_t        mMaxBytes;
-    size_t              mByteCount;
+    const bool          mRolling;
+    size_t              mByteCount;         // bytes accepted by write()
+    size_t              mBytesWritten;      // bytes written to the file
+    std::atomic<bool>   mClosed;
     FILE                *mFile;
-    mutable android::Mutex mLock;
+    char                mPath[BUFLOG_MAX_PATH_SIZE];
+    uint8_t             *mFifoBuffer;
+    audio_utils_fifo    *mFifo;
+    audio_utils_fifo_writer *mFifoWriter;
+    audio_utils_fifo_reader *mFifoReader;
+    mutable android::Mutex mLock;           // serializes drain() and finalize()
 
     void            closeStream_l();
+    void            drain_l(bool saveRolling);
 };
 
 
@@ -180,10 +218,24 @@ public:
     //  New streams will be created if write() is called again.
     void            reset();
 
+    // save the most recent data of the rolling streams. Doesn't block.
+    void            trigger();
+
 protected:
     static const unsigned int BUFLOG_MAXSTREAMS = 16;
     BufLogStream    *mStreams[BUFLOG_MAXSTREAMS];
-    mutable android::Mutex mLock;
+    mutable android::Mutex mLock;           // protects mStreams
+
+    // Writes the streams out in the background. mDrainLock is held while streams are drained,
+    // and must be taken before mLock.
+    std::mutex              mDrainLock;
+    std::condition_variable mDrainCond;
+    bool                    mExiting;
+    std::atomic<bool>       mTriggered;
+    std::thread             mDrainThread;
+
+    void            drainLoop();
+    void            drainAll(bool saveRolling);
 };
 
 class BufLogSingleton {
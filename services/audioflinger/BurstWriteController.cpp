@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "BurstWriteController"
+//#define LOG_NDEBUG 0
+
+#include <stdio.h>
+#include <utils/Log.h>
+#include "BurstWriteController.h"
+
+namespace android {
+
+BurstWriteController::BurstWriteController()
+    : mFrameCount(0), mSampleRate(0), mPeriodNs(0),
+      mFirstWriteNs(0), mLastWriteNs(0), mWrites(0), mWakes(0), mBursts(0),
+      mTotalBurstWrites(0), mTotalSleepNs(0), mMaxSleepNs(0), mUnknownQueue(0)
+{
+    restart();
+}
+
+void BurstWriteController::setPeriod(size_t frameCount, uint32_t sampleRate)
+{
+    mFrameCount = frameCount;
+    mSampleRate = sampleRate;
+    mPeriodNs = sampleRate != 0 ? seconds(frameCount) / sampleRate : 0;
+    restart();
+}
+
+void BurstWriteController::restart()
+{
+    mHighFrames = 0;
+    mWriteCount = 0;
+    mBurstWrites = 0;
+}
+
+nsecs_t BurstWriteController::onWrite(nsecs_t startNs, nsecs_t endNs, int64_t queuedFrames)
+{
+    const nsecs_t writeNs = endNs > startNs ? endNs - startNs : 0;
+    if (mWrites++ == 0) {
+        mFirstWriteNs = startNs;
+    }
+    mLastWriteNs = endNs;
+    // a write which blocked for a good part of a period was woken up by the HAL
+    if (writeNs > mPeriodNs / 4) {
+        mWakes++;
+    }
+    mBurstWrites++;
+
+    if (queuedFrames < 0 || mPeriodNs <= 0) {
+        // fall back to the pacing of the blocking writes
+        mUnknownQueue++;
+        restart();
+        return 0;
+    }
+    if (queuedFrames > mHighFrames) {
+        mHighFrames = queuedFrames;
+    }
+    if (mWriteCount < kWarmupWrites) {
+        mWriteCount++;
+        return 0;
+    }
+
+    const int64_t lowFrames = (int64_t) mFrameCount * kLowPeriods;
+    if (mHighFrames <= lowFrames + (int64_t) mFrameCount) {
+        // the HAL buffer is too small for bursts to save anything
+        return 0;
+    }
+    if (queuedFrames + (int64_t) mFrameCount <= mHighFrames) {
+        // there is room for another buffer, keep filling
+        return 0;
+    }
+
+    // full: sleep until the queue has drained down to the low watermark
+    const nsecs_t sleepNs = queuedFrames > lowFrames ?
+            seconds(queuedFrames - lowFrames) / mSampleRate : 0;
+    mBursts++;
+    mTotalBurstWrites += mBurstWrites;
+    mBurstWrites = 0;
+    if (sleepNs > 0) {
+        mWakes++;
+        mTotalSleepNs += sleepNs;
+        if (sleepNs > mMaxSleepNs) {
+            mMaxSleepNs = sleepNs;
+        }
+    }
+    ALOGV("burst full at %lld queued frames, sleeping %lld ns",
+            (long long) queuedFrames, (long long) sleepNs);
+    return sleepNs;
+}
+
+void BurstWriteController::dump(int fd) const
+{
+    dprintf(fd, "  Burst write period: %.2f ms, HAL capacity %lld frames\n",
+            mPeriodNs * 1e-6, (long long) mHighFrames);
+    if (mWrites == 0) {
+        return;
+    }
+    const nsecs_t elapsedNs = mLastWriteNs - mFirstWriteNs;
+    dprintf(fd, "    Writes: %llu, wakes: %llu (%.2f per second), unknown queue: %llu\n",
+            (unsigned long long) mWrites, (unsigned long long) mWakes,
+            elapsedNs > 0 ? mWakes * 1e9 / elapsedNs : 0.,
+            (unsigned long long) mUnknownQueue);
+    if (mBursts == 0) {
+        return;
+    }
+    dprintf(fd, "    Bursts: %llu, mean writes per burst %.2f, sleep mean %.2f ms max %.2f ms\n",
+            (unsigned long long) mBursts, (double) mTotalBurstWrites / mBursts,
+            (double) mTotalSleepNs / mBursts * 1e-6, mMaxSleepNs * 1e-6);
+}
+
+}   // namespace android
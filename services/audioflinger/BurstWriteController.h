@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// "Burst fill then sleep" pacing of the blocking HAL writes of a deep buffer PlaybackThread.
+//
+// With the default pacing a deep buffer thread wakes up once per period, when the HAL has room
+// for one more buffer. Instead, the controller fills the HAL buffer with back to back writes,
+// then sleeps until the frames queued in the HAL, as reported by the presentation position,
+// have drained down to a low watermark, so that the system can stay suspended between bursts.
+// The HAL capacity is learned from the largest queue seen right after a write,
+// which is reached when a burst write blocks.
+
+#ifndef ANDROID_AUDIO_BURST_WRITE_CONTROLLER_H
+#define ANDROID_AUDIO_BURST_WRITE_CONTROLLER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+class BurstWriteController {
+
+public:
+    BurstWriteController();
+    /*virtual*/ ~BurstWriteController() { }
+
+    // Set the frames per write and the sample rate, and forget the learned state.
+    // The statistics are kept.
+    void        setPeriod(size_t frameCount, uint32_t sampleRate);
+
+    // Forget the learned state, for example after standby. The statistics are kept.
+    void        restart();
+
+    // Account for a write that started at startNs and returned at endNs, after which
+    // queuedFrames frames were waiting to be presented, or -1 if unknown.
+    // Returns the time to sleep before the next mix, >= 0.
+    nsecs_t     onWrite(nsecs_t startNs, nsecs_t endNs, int64_t queuedFrames);
+
+    // Not synchronized with onWrite(); the usual caveats about atomicity apply.
+    void        dump(int fd) const;
+
+private:
+    static const uint32_t kWarmupWrites = 8;         // writes before pacing starts
+    static const uint32_t kLowPeriods = 2;           // low watermark, in periods
+
+    size_t      mFrameCount;        // frames per write
+    uint32_t    mSampleRate;
+    nsecs_t     mPeriodNs;          // derived from the above
+
+    // learned state
+    int64_t     mHighFrames;        // largest queue after a write since restart, HAL capacity
+    uint32_t    mWriteCount;        // writes since restart, saturates at kWarmupWrites
+    uint32_t    mBurstWrites;       // writes in the current burst
+
+    // statistics
+    nsecs_t     mFirstWriteNs;      // start of the first write, for the wake rate
+    nsecs_t     mLastWriteNs;
+    uint64_t    mWrites;
+    uint64_t    mWakes;             // returns from a blocked write or a burst sleep
+    uint64_t    mBursts;            // number of burst sleeps
+    uint64_t    mTotalBurstWrites;  // writes in completed bursts
+    nsecs_t     mTotalSleepNs;
+    nsecs_t     mMaxSleepNs;
+    uint64_t    mUnknownQueue;      // writes for which the queue could not be measured
+};
+
+}   // namespace android
+
+#endif  // ANDROID_AUDIO_BURST_WRITE_CONTROLLER_H
@@ -23,7 +23,8 @@
 // uncomment to enable detailed battery usage reporting (not debugged)
 //#define ADD_BATTERY_DATA
 
-// uncomment to enable the audio watchdog
+// uncomment to always enable the audio watchdog, otherwise it only runs when
+// af.watchdog.profile_us is set
 //#define AUDIO_WATCHDOG
 
 // uncomment to display CPU load adjusted for CPU frequency
@@ -70,6 +70,7 @@ AudioFlinger::EffectModule::EffectModule(ThreadBase *thread,
       // mMaxDisableWaitCnt is set by configure() and not used before then
       // mDisableWaitCnt is set by process() and updateState() and not used before then
       mSuspended(false),
+      mBytesCopied(0),
       mAudioFlinger(thread->mAudioFlinger)
 {
     ALOGV("Constructor %p pinned %d", this, pinned);
@@ -276,6 +277,7 @@ void AudioFlinger::EffectModule::process()
 {
     Mutex::Autolock _l(mLock);
 
+    mBytesCopied = 0;
     if (mState == DESTROYED || mEffectInterface == 0 || mInBuffer == 0 || mOutBuffer == 0) {
         return;
     }
@@ -286,6 +288,7 @@ void AudioFlinger::EffectModule::process()
             ditherAndClamp(mConfig.inputCfg.buffer.s32,
                                         mConfig.inputCfg.buffer.s32,
                                         mConfig.inputCfg.buffer.frameCount/2);
+            mBytesCopied += mConfig.inputCfg.buffer.frameCount * sizeof(int32_t);
         }
         int ret;
         if (isProcessImplemented()) {
@@ -305,6 +308,7 @@ void AudioFlinger::EffectModule::process()
                     memcpy(mConfig.outputCfg.buffer.raw, mConfig.inputCfg.buffer.raw,
                            frameCnt * sizeof(int16_t));
                 }
+                mBytesCopied += frameCnt * sizeof(int16_t);
             }
             ret = -ENODATA;
         }
@@ -330,6 +334,7 @@ void AudioFlinger::EffectModule::process()
             for (size_t i = 0; i < frameCnt; i++) {
                 out[i] = clamp16((int32_t)out[i] + (int32_t)in[i]);
             }
+            mBytesCopied += frameCnt * sizeof(int16_t);
         }
     }
 }
@@ -1526,6 +1531,8 @@ void AudioFlinger::EffectHandle::dumpToBuffer(char* buffer, size_t size)
 AudioFlinger::EffectChain::EffectChain(ThreadBase *thread,
                                         audio_session_t sessionId)
     : mThread(thread), mSessionId(sessionId), mActiveTrackCnt(0), mTrackCnt(0), mTailBufferCount(0),
+      mBytesCopiedLast(0), mBytesCopiedTotal(0), mProcessCount(0),
+      mProcessNs(0), mProcessNsCount(0),
       mVolumeCtrlIdx(-1), mLeftVolume(UINT_MAX), mRightVolume(UINT_MAX),
       mNewLeftVolume(UINT_MAX), mNewRightVolume(UINT_MAX)
 {
@@ -1610,6 +1617,18 @@ void AudioFlinger::EffectChain::clearInputBuffer_l(const sp<ThreadBase>& thread)
     mInBuffer->commit();
 }
 
+// Size of the copy done by update() or commit() of a chain buffer, 0 if the buffer is not a
+// mirror of external data.
+static size_t mirroredSize(EffectBufferHalInterface *buffer)
+{
+    if (buffer->externalData() == nullptr ||
+            buffer->externalData() == buffer->audioBuffer()->raw) {
+        return 0;
+    }
+    // chain buffers are stereo AUDIO_FORMAT_PCM_16_BIT, see clearInputBuffer_l()
+    return buffer->audioBuffer()->frameCount * FCC_2 * sizeof(int16_t);
+}
+
 // Must be called with EffectChain::mLock locked
 void AudioFlinger::EffectChain::process_l()
 {
@@ -1646,20 +1665,40 @@ void AudioFlinger::EffectChain::process_l()
 
     size_t size = mEffects.size();
     if (doProcess) {
+        const bool inPlace = mInBuffer->audioBuffer()->raw == mOutBuffer->audioBuffer()->raw;
+        // An in place chain whose effects are all idle doesn't touch its buffer,
+        // so the copies to and from mirrored external data can be skipped.
+        bool anyProcessEnabled = !inPlace;
+        for (size_t i = 0; i < size && !anyProcessEnabled; i++) {
+            anyProcessEnabled = mEffects[i]->isProcessEnabled();
+        }
+        size_t bytesCopied = 0;
         // Only the input and output buffers of the chain can be external,
         // and 'update' / 'commit' do nothing for allocated buffers, thus
         // it's not needed to consider any other buffers here.
-        mInBuffer->update();
-        if (mInBuffer->audioBuffer()->raw != mOutBuffer->audioBuffer()->raw) {
-            mOutBuffer->update();
+        if (anyProcessEnabled) {
+            mInBuffer->update();
+            bytesCopied += mirroredSize(mInBuffer.get());
+            if (!inPlace) {
+                mOutBuffer->update();
+                bytesCopied += mirroredSize(mOutBuffer.get());
+            }
         }
         for (size_t i = 0; i < size; i++) {
             mEffects[i]->process();
+            bytesCopied += mEffects[i]->bytesCopied();
+        }
+        if (anyProcessEnabled) {
+            mInBuffer->commit();
+            bytesCopied += mirroredSize(mInBuffer.get());
+            if (!inPlace) {
+                mOutBuffer->commit();
+                bytesCopied += mirroredSize(mOutBuffer.get());
+            }
         }
-        mInBuffer->commit();
-        if (mInBuffer->audioBuffer()->raw != mOutBuffer->audioBuffer()->raw) {
-            mOutBuffer->commit();
-        }
+        mBytesCopiedLast = bytesCopied;
+        mBytesCopiedTotal += bytesCopied;
+        mProcessCount++;
     }
     bool doResetVolume = false;
     for (size_t i = 0; i < size; i++) {
@@ -1999,6 +2038,15 @@ void AudioFlinger::EffectChain::dump(int fd, const Vector<String16>& args)
         result.append(buffer);
         snprintf(buffer, SIZE, "\t%s   %s   %d\n", inBufferStr, outBufferStr, mActiveTrackCnt);
         result.append(buffer);
+        snprintf(buffer, SIZE, "\tBytes copied per period: last %zu, average %llu\n",
+                mBytesCopiedLast, (unsigned long long)
+                        (mProcessCount != 0 ? mBytesCopiedTotal / mProcessCount : 0));
+        result.append(buffer);
+        if (mProcessNsCount != 0) {
+            snprintf(buffer, SIZE, "\tCPU time in process: total %.3f ms, average %.1f us\n",
+                    mProcessNs * 1e-6, mProcessNs * 1e-3 / mProcessNsCount);
+            result.append(buffer);
+        }
         write(fd, result.string(), result.size());
 
         for (size_t i = 0; i < numEffects; ++i) {
@@ -133,6 +133,9 @@ public:
     void             addEffectToHal_l();
     void             release_l();
 
+    // bytes copied or converted by the last process() outside of the effect engine
+    size_t           bytesCopied() const { return mBytesCopied; }
+
     void             dump(int fd, const Vector<String16>& args);
 
 protected:
@@ -168,6 +171,7 @@ mutable Mutex               mLock;      // mutex for process, commands and handl
     uint32_t mDisableWaitCnt;       // current process() calls count during disable period.
     bool     mSuspended;            // effect is suspended: temporarily disabled by framework
     bool     mOffloaded;            // effect is currently offloaded to the audio DSP
+    size_t   mBytesCopied;          // see bytesCopied()
     wp<AudioFlinger>    mAudioFlinger;
 };
 
@@ -277,6 +281,10 @@ public:
 
     void process_l();
 
+    // CPU time spent in process_l(), when accounted by the thread
+    void addProcessNs(int64_t ns) { mProcessNs += ns; mProcessNsCount++; }
+    int64_t processNs() const { return mProcessNs; }
+
     void lock() {
         mLock.lock();
     }
@@ -408,6 +416,12 @@ protected:
 
              int32_t mTailBufferCount;   // current effect tail buffer count
              int32_t mMaxTailBuffers;    // maximum effect tail buffers
+             // copies done by process_l() outside of the effect engines, for dump()
+             size_t mBytesCopiedLast;    // during the last period
+             uint64_t mBytesCopiedTotal; // since the chain was created
+             uint64_t mProcessCount;     // number of periods processed
+             int64_t mProcessNs;         // see addProcessNs()
+             uint64_t mProcessNsCount;   // number of periods included in mProcessNs
              int mVolumeCtrlIdx;         // index of insert effect having control over volume
              uint32_t mLeftVolume;       // previous volume on left channel
              uint32_t mRightVolume;      // previous volume on right channel
@@ -337,6 +337,8 @@ void FastMixer::onWork()
 
     if ((command & FastMixerState::MIX) && (mMixer != NULL) && mIsWarm) {
         ALOG_ASSERT(mMixerBuffer != NULL);
+        dumpState->setPhase(FastThreadDumpState::PHASE_MIX);
+        mLogWriter->logMixStart();
 
         // AudioMixer::mState.enabledTracks is undefined if mState.hook == process__validate,
         // so we keep a side copy of enabledTracks
@@ -411,6 +413,22 @@ void FastMixer::onWork()
                 anyEnabledTracks = true;
             }
             ftDump->mUnderruns = underruns;
+
+            // The frames left over from the previous mix, if the client has not written since.
+            const size_t prevFramesReady = ftDump->mFramesReady;
+            const size_t framesLeft = prevFramesReady > frameCount ?
+                    prevFramesReady - frameCount : 0;
+            if (framesReady > framesLeft && mOldTsValid) {
+                ftDump->mLastClientWriteNs = mOldTs.tv_sec * 1000000000LL + mOldTs.tv_nsec;
+            }
+            ftDump->mFramesRequested += frameCount;
+            ftDump->mFramesDelivered += framesReady < frameCount ? framesReady : frameCount;
+            size_t bucket = framesReady == 0 ? 0 : 32 - __builtin_clz((unsigned) framesReady);
+            if (bucket >= FRAMES_READY_HISTOGRAM_BUCKETS) {
+                bucket = FRAMES_READY_HISTOGRAM_BUCKETS - 1;
+            }
+            ftDump->mFramesReadyHistogram[bucket]++;
+
             ftDump->mFramesReady = framesReady;
             ftDump->mFramesWritten = trackFramesWritten;
         }
@@ -422,12 +440,14 @@ void FastMixer::onWork()
         } else if (mMixerBufferState != ZEROED) {
             mMixerBufferState = UNDEFINED;
         }
+        mLogWriter->logMixEnd();
 
     } else if (mMixerBufferState == MIXED) {
         mMixerBufferState = UNDEFINED;
     }
     //bool didFullWrite = false;    // dumpsys could display a count of partial writes
     if ((command & FastMixerState::WRITE) && (mOutputSink != NULL) && (mMixerBuffer != NULL)) {
+        dumpState->setPhase(FastThreadDumpState::PHASE_POST_MIX);
         if (mMixerBufferState == UNDEFINED) {
             memset(mMixerBuffer, 0, mMixerBufferSize);
             mMixerBufferState = ZEROED;
@@ -451,9 +471,16 @@ void FastMixer::onWork()
         // FIXME write() is non-blocking and lock-free for a properly implemented NBAIO sink,
         //       but this code should be modified to handle both non-blocking and blocking sinks
         dumpState->mWriteSequence++;
+        dumpState->setPhase(FastThreadDumpState::PHASE_WRITE);
         ATRACE_BEGIN("write");
+        const nsecs_t writeStartNs = mLogWriter->isEnabled() ?
+                systemTime(SYSTEM_TIME_MONOTONIC) : 0;
         ssize_t framesWritten = mOutputSink->write(buffer, frameCount);
+        if (writeStartNs != 0) {
+            mLogWriter->logWriteDuration(systemTime(SYSTEM_TIME_MONOTONIC) - writeStartNs);
+        }
         ATRACE_END();
+        dumpState->setPhase(FastThreadDumpState::PHASE_STATE);
         dumpState->mWriteSequence++;
         if (framesWritten >= 0) {
             ALOG_ASSERT((size_t) framesWritten <= frameCount);
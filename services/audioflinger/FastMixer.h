@@ -27,7 +27,7 @@ namespace android {
 
 class AudioMixer;
 
-typedef StateQueue<FastMixerState> FastMixerStateQueue;
+typedef StateQueue<FastMixerState, FastMixerState::kStateQueueDepth> FastMixerStateQueue;
 
 class FastMixer : public FastThread {
 
@@ -20,12 +20,14 @@
 #include "Configuration.h"
 #ifdef FAST_THREAD_STATISTICS
 #include <cpustats/CentralTendencyStatistics.h>
+#include <cpustats/LogHistogram.h>
 #ifdef CPU_FREQUENCY_STATISTICS
 #include <cpustats/ThreadCpuUsage.h>
 #endif
 #endif
 #include <utils/Debug.h>
 #include <utils/Log.h>
+#include <utils/Timers.h>
 #include "FastMixerDumpState.h"
 
 namespace android {
@@ -86,6 +88,7 @@ void FastMixerDumpState::dump(int fd) const
     // statistics for monotonic (wall clock) time, thread raw CPU load in time, CPU clock frequency,
     // and adjusted CPU load in MHz normalized for CPU clock frequency
     CentralTendencyStatistics wall, loadNs;
+    LogHistogram wallPercentiles(1000 /* 1 us */);
 #ifdef CPU_FREQUENCY_STATISTICS
     CentralTendencyStatistics kHz, loadMHz;
     uint32_t previousCpukHz = 0;
@@ -103,6 +106,7 @@ void FastMixerDumpState::dump(int fd) const
             tail[j] = wallNs;
         }
         wall.sample(wallNs);
+        wallPercentiles.sample(wallNs);
         uint32_t sampleLoadNs = mLoadNs[i];
         loadNs.sample(sampleLoadNs);
 #ifdef CPU_FREQUENCY_STATISTICS
@@ -126,6 +130,9 @@ void FastMixerDumpState::dump(int fd) const
                     "      mean=%.2f min=%.2f max=%.2f stddev=%.2f\n",
                     wall.mean()*1e-6, wall.minimum()*1e-6, wall.maximum()*1e-6,
                     wall.stddev()*1e-6);
+        dprintf(fd, "      p50=%.2f p90=%.2f p99=%.2f p99.9=%.2f\n",
+                    wallPercentiles.percentile(50)*1e-6, wallPercentiles.percentile(90)*1e-6,
+                    wallPercentiles.percentile(99)*1e-6, wallPercentiles.percentile(99.9)*1e-6);
         dprintf(fd, "    raw CPU load in us per mix cycle:\n"
                     "      mean=%.0f min=%.0f max=%.0f stddev=%.0f\n",
                     loadNs.mean()*1e-3, loadNs.minimum()*1e-3, loadNs.maximum()*1e-3,
@@ -196,6 +203,50 @@ void FastMixerDumpState::dump(int fd) const
                 mostRecent, ftDump->mFramesReady,
                 (long long)ftDump->mFramesWritten);
     }
+
+    // Per-track delivery statistics, for the tracks that have been mixed at least once.
+    const nsecs_t now = systemTime();
+    dprintf(fd, "  Index  Requested  Delivered LastWrite
+");
+    for (uint32_t i = 0; i < FastMixerState::sMaxFastTracks; ++i) {
+        const FastTrackDump *ftDump = &mTracks[i];
+        if (ftDump->mFramesRequested == 0) {
+            continue;
+        }
+        char lastWrite[16];
+        if (ftDump->mLastClientWriteNs != 0) {
+            snprintf(lastWrite, sizeof(lastWrite), "%.1f ms",
+                    (now - ftDump->mLastClientWriteNs) * 1e-6);
+        } else {
+            strcpy(lastWrite, "never");
+        }
+        dprintf(fd, "  %5u %10lld %10lld %9s\n",
+                i, (long long)ftDump->mFramesRequested,
+                (long long)ftDump->mFramesDelivered, lastWrite);
+    }
+    dprintf(fd, "  Histogram of framesReady at each mix, by power of 2 upper bound:\n");
+    dprintf(fd, "  Index");
+    for (int j = 0; j < FRAMES_READY_HISTOGRAM_BUCKETS; ++j) {
+        if (j == 0) {
+            dprintf(fd, "      0");
+        } else if (j < FRAMES_READY_HISTOGRAM_BUCKETS - 1) {
+            dprintf(fd, " %6u", 1u << j);
+        } else {
+            dprintf(fd, "   more");
+        }
+    }
+    dprintf(fd, "\n");
+    for (uint32_t i = 0; i < FastMixerState::sMaxFastTracks; ++i) {
+        const FastTrackDump *ftDump = &mTracks[i];
+        if (ftDump->mFramesRequested == 0) {
+            continue;
+        }
+        dprintf(fd, "  %5u", i);
+        for (int j = 0; j < FRAMES_READY_HISTOGRAM_BUCKETS; ++j) {
+            dprintf(fd, " %6u", ftDump->mFramesReadyHistogram[j]);
+        }
+        dprintf(fd, "\n");
+    }
 }
 
 }   // android
@@ -51,13 +51,25 @@ private:
     uint32_t mAtomic;
 };
 
+// Number of buckets in the histogram of framesReady() at each mix.
+// Bucket 0 counts framesReady() == 0, bucket i > 0 counts 2^(i-1) <= framesReady() < 2^i,
+// and the last bucket also counts all larger values.
+#define FRAMES_READY_HISTOGRAM_BUCKETS 16
+
 // Represents the dump state of a fast track
+// Like the underrun counters, these statistics are not reset for new tracks.
 struct FastTrackDump {
-    FastTrackDump() : mFramesReady(0) { }
+    FastTrackDump() : mFramesReady(0), mFramesWritten(0), mFramesRequested(0),
+            mFramesDelivered(0), mLastClientWriteNs(0), mFramesReadyHistogram() { }
     /*virtual*/ ~FastTrackDump() { }
     FastTrackUnderruns  mUnderruns;
     size_t              mFramesReady;        // most recent value only; no long-term statistics kept
     int64_t             mFramesWritten;      // last value from track
+    int64_t             mFramesRequested;    // total frames needed by the mixer
+    int64_t             mFramesDelivered;    // total frames available to the mixer, <= requested
+    int64_t             mLastClientWriteNs;  // CLOCK_MONOTONIC of the last mix cycle that saw
+                                             // new frames from the client, or 0 if none yet
+    uint32_t            mFramesReadyHistogram[FRAMES_READY_HISTOGRAM_BUCKETS];
 };
 
 struct FastMixerDumpState : FastThreadDumpState {
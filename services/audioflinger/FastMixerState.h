@@ -60,6 +60,10 @@ struct FastMixerState : FastThreadState {
     static const unsigned kDefaultFastTracks = 8;
 
     static unsigned sMaxFastTracks;             // Configured maximum number of fast tracks
+
+    // Number of states in the FastMixerStateQueue: the normal mixer can push up to
+    // kStateQueueDepth - 3 states before it waits for the fast mixer to acknowledge one.
+    static const unsigned kStateQueueDepth = 6;
     static pthread_once_t sMaxFastTracksOnce;   // Protects initializer for sMaxFastTracks
 
     // all pointer fields use raw pointers; objects are owned and ref-counted by the normal mixer
@@ -93,6 +93,7 @@ bool FastThread::threadLoop()
     for (;;) {
 
         // either nanosleep, sched_yield, or busy wait
+        mDumpState->setPhase(FastThreadDumpState::PHASE_SLEEP);
         if (mSleepNs >= 0) {
             if (mSleepNs > 0) {
                 ALOG_ASSERT(mSleepNs < 1000000000);
@@ -102,6 +103,7 @@ bool FastThread::threadLoop()
                 sched_yield();
             }
         }
+        mDumpState->setPhase(FastThreadDumpState::PHASE_STATE);
         // default to long sleep for next cycle
         mSleepNs = FAST_DEFAULT_NS;
 
@@ -266,6 +268,7 @@ bool FastThread::threadLoop()
                         ALOGV("underrun: time since last cycle %d.%03ld sec",
                                 (int) sec, nsec / 1000000L);
                         mDumpState->mUnderruns++;
+                        mLogWriter->logUnderrun(sec * 1000000000LL + nsec);
                         mIgnoreNextOverrun = true;
                     } else if (nsec < mOverrunNs) {
                         if (mIgnoreNextOverrun) {
@@ -275,6 +278,7 @@ bool FastThread::threadLoop()
                             ALOGV("overrun: time since last cycle %d.%03ld sec",
                                     (int) sec, nsec / 1000000L);
                             mDumpState->mOverruns++;
+                            mLogWriter->logOverrun(sec * 1000000000LL + nsec);
                         }
                         // This forces a minimum cycle time. It:
                         //  - compensates for an audio HAL with jitter due to sample rate conversion
@@ -22,7 +22,7 @@ namespace android {
 FastThreadDumpState::FastThreadDumpState() :
     mCommand(FastThreadState::INITIAL), mUnderruns(0), mOverruns(0),
     /* mMeasuredWarmupTs({0, 0}), */
-    mWarmupCycles(0)
+    mWarmupCycles(0), mPhase(PHASE_SLEEP)
 #ifdef FAST_THREAD_STATISTICS
     , mSamplingN(0), mBounds(0)
 #endif
@@ -38,6 +38,19 @@ FastThreadDumpState::~FastThreadDumpState()
 {
 }
 
+/*static*/
+const char *FastThreadDumpState::phaseToString(Phase phase)
+{
+    switch (phase) {
+    case PHASE_SLEEP:       return "sleep";
+    case PHASE_STATE:       return "state";
+    case PHASE_MIX:         return "mix";
+    case PHASE_POST_MIX:    return "post-mix";
+    case PHASE_WRITE:       return "write";
+    default:                return "?";
+    }
+}
+
 #ifdef FAST_THREAD_STATISTICS
 void FastThreadDumpState::increaseSamplingN(uint32_t samplingN)
 {
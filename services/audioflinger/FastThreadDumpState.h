@@ -38,6 +38,24 @@ struct FastThreadDumpState {
     struct timespec mMeasuredWarmupTs;  // measured warmup time
     uint32_t mWarmupCycles;     // number of loop cycles required to warmup
 
+    // What the fast thread is currently doing, sampled by the AudioWatchdog when profiling.
+    // The low bits of mPhase are the Phase, and the upper bits count the phase changes so that
+    // a sampler can tell two consecutive instances of the same phase apart.
+    enum Phase {
+        PHASE_SLEEP,        // sleeping until the next cycle
+        PHASE_STATE,        // polling and handling the state, and cycle bookkeeping
+        PHASE_MIX,          // updating the tracks and mixing (FastMixer only)
+        PHASE_POST_MIX,     // mono blend and format conversion of the mix (FastMixer only)
+        PHASE_WRITE,        // writing to the sink (FastMixer only)
+        PHASE_CNT
+    };
+    static const uint32_t kPhaseMask = 7;
+    uint32_t mPhase;
+    void setPhase(Phase phase) {
+        mPhase = ((mPhase | kPhaseMask) + 1) | phase;
+    }
+    static const char *phaseToString(Phase phase);
+
 #ifdef FAST_THREAD_STATISTICS
     // Recently collected samples of per-cycle monotonic time, thread CPU time, and CPU frequency.
     // kSamplingN is max size of sampling frame (statistics), and must be a power of 2 <= 0x8000.
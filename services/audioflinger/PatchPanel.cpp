@@ -20,6 +20,7 @@
 //#define LOG_NDEBUG 0
 
 #include "Configuration.h"
+#include <cutils/properties.h>
 #include <utils/Log.h>
 #include <audio_utils/primitives.h>
 
@@ -42,6 +43,9 @@
 #define ALOGVV(a...) do { } while(0)
 #endif
 
+// When true, software patches between two devices use a PatchBridge when possible
+#define PROPERTY_PATCH_DIRECT_BRIDGE "audio.patch.direct_bridge"
+
 namespace android {
 
 /* List connected audio ports and their attributes */
@@ -174,7 +178,8 @@ status_t AudioFlinger::PatchPanel::createAudioPatch(const struct audio_patch *pa
                 if ((removedPatch->mRecordPatchHandle
                         != AUDIO_PATCH_HANDLE_NONE) ||
                         (removedPatch->mPlaybackPatchHandle !=
-                                AUDIO_PATCH_HANDLE_NONE)) {
+                                AUDIO_PATCH_HANDLE_NONE) ||
+                        (removedPatch->mPatchBridge != 0)) {
                     clearPatchConnections(removedPatch);
                 }
                 // 2) if the new patch and old patch source or sink are devices from different
@@ -252,6 +257,15 @@ status_t AudioFlinger::PatchPanel::createAudioPatch(const struct audio_patch *pa
                 ((patch->sinks[0].type == AUDIO_PORT_TYPE_DEVICE) &&
                  ((patch->sinks[0].ext.device.hw_module != srcModule) ||
                   !audioHwDevice->supportsAudioPatches()))) {
+                if (patch->num_sources == 1 &&
+                        property_get_bool(PROPERTY_PATCH_DIRECT_BRIDGE, false /* default_value */)) {
+                    status = createPatchBridge(newPatch, patch);
+                    if (status == NO_ERROR) {
+                        goto exit;
+                    }
+                    ALOGW("createAudioPatch() cannot bridge devices directly, status %d", status);
+                    status = NO_ERROR;
+                }
                 if (patch->num_sources == 2) {
                     if (patch->sources[1].type != AUDIO_PORT_TYPE_MIX ||
                             (patch->num_sinks != 0 && patch->sinks[0].ext.device.hw_module !=
@@ -515,6 +529,94 @@ status_t AudioFlinger::PatchPanel::createPatchConnections(Patch *patch,
     return status;
 }
 
+status_t AudioFlinger::PatchPanel::createPatchBridge(Patch *patch,
+                                                     const struct audio_patch *audioPatch)
+{
+    sp<AudioFlinger> audioflinger = mAudioFlinger.promote();
+    if (audioflinger == 0) {
+        return NO_INIT;
+    }
+    const struct audio_port_config *source = &audioPatch->sources[0];
+    const struct audio_port_config *sink = &audioPatch->sinks[0];
+
+    AudioHwDevice *outHwDev = audioflinger->findSuitableHwDev_l(sink->ext.device.hw_module,
+                                                                sink->ext.device.type);
+    AudioHwDevice *inHwDev = audioflinger->findSuitableHwDev_l(source->ext.device.hw_module,
+                                                               source->ext.device.type);
+    if (outHwDev == NULL || inHwDev == NULL) {
+        return BAD_VALUE;
+    }
+
+    // open the output with the sink device audio properties if provided, or the source device
+    // ones otherwise. The input must then accept the configuration of the output as is.
+    audio_config_t config = AUDIO_CONFIG_INITIALIZER;
+    if (sink->config_mask & AUDIO_PORT_CONFIG_SAMPLE_RATE) {
+        config.sample_rate = sink->sample_rate;
+    } else if (source->config_mask & AUDIO_PORT_CONFIG_SAMPLE_RATE) {
+        config.sample_rate = source->sample_rate;
+    }
+    if (sink->config_mask & AUDIO_PORT_CONFIG_CHANNEL_MASK) {
+        config.channel_mask = sink->channel_mask;
+    } else if (source->config_mask & AUDIO_PORT_CONFIG_CHANNEL_MASK) {
+        config.channel_mask = audio_channel_out_mask_from_count(
+                audio_channel_count_from_in_mask(source->channel_mask));
+    }
+    if (sink->config_mask & AUDIO_PORT_CONFIG_FORMAT) {
+        config.format = sink->format;
+    } else if (source->config_mask & AUDIO_PORT_CONFIG_FORMAT) {
+        config.format = source->format;
+    }
+
+    audio_io_handle_t output = audioflinger->nextUniqueId(AUDIO_UNIQUE_ID_USE_OUTPUT);
+    AudioStreamOut *outputStream = NULL;
+    status_t status = outHwDev->openOutputStream(&outputStream,
+                                                 output,
+                                                 sink->ext.device.type,
+                                                 AUDIO_OUTPUT_FLAG_NONE,
+                                                 &config,
+                                                 sink->ext.device.address);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    if (!audio_is_linear_pcm(outputStream->getFormat())) {
+        delete outputStream;
+        return INVALID_OPERATION;
+    }
+
+    audio_config_t inConfig = AUDIO_CONFIG_INITIALIZER;
+    inConfig.sample_rate = outputStream->getSampleRate();
+    inConfig.channel_mask = audio_channel_in_mask_from_count(
+            audio_channel_count_from_out_mask(outputStream->getChannelMask()));
+    inConfig.format = outputStream->getFormat();
+    audio_io_handle_t input = audioflinger->nextUniqueId(AUDIO_UNIQUE_ID_USE_INPUT);
+    sp<StreamInHalInterface> inStream;
+    status = inHwDev->hwDevice()->openInputStream(input,
+                                                  source->ext.device.type,
+                                                  &inConfig,
+                                                  AUDIO_INPUT_FLAG_NONE,
+                                                  source->ext.device.address,
+                                                  AUDIO_SOURCE_MIC,
+                                                  &inStream);
+    if (status != NO_ERROR || inStream == 0) {
+        delete outputStream;
+        return status != NO_ERROR ? status : NO_INIT;
+    }
+    ALOGV("createPatchBridge() input %d output %d sample rate %u format %#x channels %#x",
+          input, output, inConfig.sample_rate, inConfig.format, inConfig.channel_mask);
+
+    patch->mPatchBridge = new PatchBridge(new AudioStreamIn(inHwDev, inStream,
+                                                            AUDIO_INPUT_FLAG_NONE),
+                                          input, outputStream, output);
+    status = patch->mPatchBridge->connect(audioPatch);
+    if (status == NO_ERROR) {
+        status = patch->mPatchBridge->run("AudioPatchBridge", ANDROID_PRIORITY_URGENT_AUDIO);
+    }
+    if (status != NO_ERROR) {
+        patch->mPatchBridge.clear();
+    }
+    return status;
+}
+
 void AudioFlinger::PatchPanel::clearPatchConnections(Patch *patch)
 {
     sp<AudioFlinger> audioflinger = mAudioFlinger.promote();
@@ -525,6 +627,12 @@ void AudioFlinger::PatchPanel::clearPatchConnections(Patch *patch)
     ALOGV("clearPatchConnections() patch->mRecordPatchHandle %d patch->mPlaybackPatchHandle %d",
           patch->mRecordPatchHandle, patch->mPlaybackPatchHandle);
 
+    if (patch->mPatchBridge != 0) {
+        // the streams are closed when the last reference goes away
+        patch->mPatchBridge->requestExitAndWait();
+        patch->mPatchBridge.clear();
+    }
+
     if (patch->mPatchRecord != 0) {
         patch->mPatchRecord->stop();
     }
@@ -569,6 +677,171 @@ void AudioFlinger::PatchPanel::clearPatchConnections(Patch *patch)
 
 }
 
+AudioFlinger::PatchPanel::PatchBridge::PatchBridge(AudioStreamIn *input,
+                                                   audio_io_handle_t inputHandle,
+                                                   AudioStreamOut *output,
+                                                   audio_io_handle_t outputHandle)
+    :   Thread(false /*canCallJava*/),
+        mInput(input), mInputHandle(inputHandle),
+        mOutput(output), mOutputHandle(outputHandle),
+        mInputPatchHandle(AUDIO_PATCH_HANDLE_NONE), mOutputPatchHandle(AUDIO_PATCH_HANDLE_NONE),
+        mInitCheck(NO_INIT), mFrameSize(0), mReadFrames(0), mWriteFrames(0),
+        mBuffer(NULL), mFrames(0)
+{
+    size_t inFrameSize;
+    size_t inBufferSize;
+    size_t outBufferSize;
+    status_t status = mInput->stream->getFrameSize(&inFrameSize);
+    if (status == NO_ERROR) {
+        status = mInput->stream->getBufferSize(&inBufferSize);
+    }
+    if (status == NO_ERROR) {
+        status = mOutput->stream->getBufferSize(&outBufferSize);
+    }
+    if (status != NO_ERROR) {
+        mInitCheck = status;
+        return;
+    }
+    if (inFrameSize == 0 || inFrameSize != mOutput->getFrameSize()) {
+        ALOGW("PatchBridge input frame size %zu, output frame size %zu",
+              inFrameSize, mOutput->getFrameSize());
+        mInitCheck = BAD_VALUE;
+        return;
+    }
+    mFrameSize = inFrameSize;
+    mReadFrames = inBufferSize / mFrameSize;
+    mWriteFrames = outBufferSize / mFrameSize;
+    if (mReadFrames == 0 || mWriteFrames == 0) {
+        mInitCheck = BAD_VALUE;
+        return;
+    }
+    // less than mWriteFrames are left after writing, so one more read always fits
+    mBuffer = new uint8_t[(mReadFrames + mWriteFrames) * mFrameSize];
+    mInitCheck = NO_ERROR;
+}
+
+AudioFlinger::PatchPanel::PatchBridge::~PatchBridge()
+{
+    if (mInputPatchHandle != AUDIO_PATCH_HANDLE_NONE) {
+        mInput->hwDev()->releaseAudioPatch(mInputPatchHandle);
+    }
+    if (mOutputPatchHandle != AUDIO_PATCH_HANDLE_NONE) {
+        mOutput->hwDev()->releaseAudioPatch(mOutputPatchHandle);
+    }
+    mInput->stream->standby();
+    mOutput->standby();
+    delete mInput;
+    delete mOutput;
+    delete[] mBuffer;
+}
+
+status_t AudioFlinger::PatchPanel::PatchBridge::connect(const struct audio_patch *audioPatch)
+{
+    if (mInitCheck != NO_ERROR) {
+        return mInitCheck;
+    }
+    status_t status = routeInput(&audioPatch->sources[0]);
+    if (status == NO_ERROR) {
+        status = routeOutput(&audioPatch->sinks[0]);
+    }
+    ALOGV("PatchBridge::connect() read %zu frames, write %zu frames, status %d",
+          mReadFrames, mWriteFrames, status);
+    return status;
+}
+
+// Same as RecordThread::createAudioPatch_l(), for a stream without thread
+status_t AudioFlinger::PatchPanel::PatchBridge::routeInput(const struct audio_port_config *source)
+{
+    if (mInput->audioHwDev->supportsAudioPatches()) {
+        struct audio_port_config sink = {};
+        sink.role = AUDIO_PORT_ROLE_SINK;
+        sink.type = AUDIO_PORT_TYPE_MIX;
+        sink.ext.mix.hw_module = mInput->audioHwDev->handle();
+        sink.ext.mix.handle = mInputHandle;
+        sink.ext.mix.usecase.source = AUDIO_SOURCE_MIC;
+        sink.config_mask = AUDIO_PORT_CONFIG_SAMPLE_RATE | AUDIO_PORT_CONFIG_CHANNEL_MASK |
+                AUDIO_PORT_CONFIG_FORMAT;
+        mInput->stream->getSampleRate(&sink.sample_rate);
+        mInput->stream->getChannelMask(&sink.channel_mask);
+        mInput->stream->getFormat(&sink.format);
+        return mInput->hwDev()->createAudioPatch(1, source, 1, &sink, &mInputPatchHandle);
+    }
+    char *address;
+    if (strcmp(source->ext.device.address, "") != 0) {
+        address = audio_device_address_to_parameter(source->ext.device.type,
+                                                    source->ext.device.address);
+    } else {
+        address = (char *)calloc(1, 1);
+    }
+    AudioParameter param = AudioParameter(String8(address));
+    free(address);
+    param.addInt(String8(AudioParameter::keyRouting), (int)source->ext.device.type);
+    param.addInt(String8(AudioParameter::keyInputSource), (int)AUDIO_SOURCE_MIC);
+    return mInput->stream->setParameters(param.toString());
+}
+
+// Same as PlaybackThread::createAudioPatch_l(), for a stream without thread
+status_t AudioFlinger::PatchPanel::PatchBridge::routeOutput(const struct audio_port_config *sink)
+{
+    if (mOutput->audioHwDev->supportsAudioPatches()) {
+        struct audio_port_config source = {};
+        source.role = AUDIO_PORT_ROLE_SOURCE;
+        source.type = AUDIO_PORT_TYPE_MIX;
+        source.ext.mix.hw_module = mOutput->audioHwDev->handle();
+        source.ext.mix.handle = mOutputHandle;
+        source.ext.mix.usecase.stream = AUDIO_STREAM_PATCH;
+        source.config_mask = AUDIO_PORT_CONFIG_SAMPLE_RATE | AUDIO_PORT_CONFIG_CHANNEL_MASK |
+                AUDIO_PORT_CONFIG_FORMAT;
+        source.sample_rate = mOutput->getSampleRate();
+        source.channel_mask = mOutput->getChannelMask();
+        source.format = mOutput->getFormat();
+        return mOutput->hwDev()->createAudioPatch(1, &source, 1, sink, &mOutputPatchHandle);
+    }
+    char *address;
+    if (strcmp(sink->ext.device.address, "") != 0) {
+        address = audio_device_address_to_parameter(sink->ext.device.type,
+                                                    sink->ext.device.address);
+    } else {
+        address = (char *)calloc(1, 1);
+    }
+    AudioParameter param = AudioParameter(String8(address));
+    free(address);
+    param.addInt(String8(AudioParameter::keyRouting), (int)sink->ext.device.type);
+    return mOutput->stream->setParameters(param.toString());
+}
+
+bool AudioFlinger::PatchPanel::PatchBridge::threadLoop()
+{
+    // the read paces the loop
+    size_t bytesRead = 0;
+    status_t status = mInput->stream->read(mBuffer + mFrames * mFrameSize,
+                                           mReadFrames * mFrameSize, &bytesRead);
+    if (status != NO_ERROR || bytesRead < mFrameSize) {
+        ALOGW_IF(status != NO_ERROR, "PatchBridge read error %d", status);
+        usleep(kErrorSleepUs);
+        return true;
+    }
+    mFrames += bytesRead / mFrameSize;
+
+    size_t framesWritten = 0;
+    while (mFrames - framesWritten >= mWriteFrames) {
+        ssize_t bytesWritten = mOutput->write(mBuffer + framesWritten * mFrameSize,
+                                              mWriteFrames * mFrameSize);
+        if (bytesWritten < (ssize_t)mFrameSize) {
+            // drop what was read rather than adding latency
+            ALOGW_IF(bytesWritten < 0, "PatchBridge write error %zd", bytesWritten);
+            framesWritten = mFrames;
+            break;
+        }
+        framesWritten += bytesWritten / mFrameSize;
+    }
+    if (framesWritten > 0) {
+        mFrames -= framesWritten;
+        memmove(mBuffer, mBuffer + framesWritten * mFrameSize, mFrames * mFrameSize);
+    }
+    return true;
+}
+
 /* Disconnect a patch */
 status_t AudioFlinger::PatchPanel::releaseAudioPatch(audio_patch_handle_t handle)
 {
@@ -605,7 +878,8 @@ status_t AudioFlinger::PatchPanel::releaseAudioPatch(audio_patch_handle_t handle
             }
 
             if (removedPatch->mRecordPatchHandle != AUDIO_PATCH_HANDLE_NONE ||
-                    removedPatch->mPlaybackPatchHandle != AUDIO_PATCH_HANDLE_NONE) {
+                    removedPatch->mPlaybackPatchHandle != AUDIO_PATCH_HANDLE_NONE ||
+                    removedPatch->mPatchBridge != 0) {
                 clearPatchConnections(removedPatch);
                 break;
             }
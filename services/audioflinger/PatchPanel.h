@@ -50,8 +50,50 @@ public:
 
     status_t createPatchConnections(Patch *patch,
                                     const struct audio_patch *audioPatch);
+    // Connect the source and sink devices of a software patch with a PatchBridge, if both can
+    // be opened with the same PCM configuration.
+    status_t createPatchBridge(Patch *patch,
+                               const struct audio_patch *audioPatch);
     void clearPatchConnections(Patch *patch);
 
+    // A software patch between two devices that runs on a single thread: each read from the
+    // input stream is written directly to the output stream, going through a buffer of less
+    // than one input plus one output HAL buffer. There is no RecordThread, PlaybackThread or
+    // mixer, so no conversion either: both streams have the same format, rate and channel count.
+    class PatchBridge : public Thread {
+    public:
+        // Takes ownership of the streams, which are closed on destruction.
+        PatchBridge(AudioStreamIn *input, audio_io_handle_t inputHandle,
+                    AudioStreamOut *output, audio_io_handle_t outputHandle);
+        virtual ~PatchBridge();
+
+        // Route the streams to the source and sink devices of the patch
+        status_t connect(const struct audio_patch *audioPatch);
+
+        // Thread virtuals
+        virtual bool threadLoop();
+
+    private:
+        status_t routeInput(const struct audio_port_config *source);
+        status_t routeOutput(const struct audio_port_config *sink);
+
+        // wait after a failed read, to not spin on a HAL which is in error
+        static const uint32_t kErrorSleepUs = 5000;
+
+        AudioStreamIn * const       mInput;
+        const audio_io_handle_t     mInputHandle;
+        AudioStreamOut * const      mOutput;
+        const audio_io_handle_t     mOutputHandle;
+        audio_patch_handle_t        mInputPatchHandle;  // HAL patches, when supported
+        audio_patch_handle_t        mOutputPatchHandle;
+        status_t                    mInitCheck;
+        size_t                      mFrameSize;
+        size_t                      mReadFrames;    // frames per read, the input HAL buffer
+        size_t                      mWriteFrames;   // frames per write, the output HAL buffer
+        uint8_t                    *mBuffer;        // mReadFrames + mWriteFrames frames
+        size_t                      mFrames;        // frames read and not yet written
+    };
+
     class Patch {
     public:
         explicit Patch(const struct audio_patch *patch) :
@@ -81,6 +123,9 @@ public:
         // handle for audio patch connecting playback thread output to sink device
         // created by createPatchConnections() and released by clearPatchConnections()
         audio_patch_handle_t            mPlaybackPatchHandle;
+        // used instead of the threads and tracks above for a direct device to device patch.
+        // created by createPatchBridge() and released by clearPatchConnections()
+        sp<PatchBridge>                 mPatchBridge;
 
     };
 
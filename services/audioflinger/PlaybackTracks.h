@@ -175,6 +175,9 @@ private:
                                     // but the slot is only used if track is active
     FastTrackUnderruns  mObservedUnderruns; // Most recently observed value of
                                     // mFastMixerDumpState.mTracks[mFastIndex].mUnderruns
+    // CPU time charged to the track by the AudioMixer, see af.thread.cpu_accounting
+    int64_t             mMixNs;
+    uint64_t            mMixPeriods; // number of mixer cycles included in mMixNs
     volatile float      mCachedVolume;  // combined master volume and stream type volume;
                                         // 'volatile' means accessed without lock or
                                         // barrier, but is read/written atomically
@@ -189,13 +192,36 @@ private:
 class OutputTrack : public Track {
 public:
 
-    class Buffer : public AudioBufferProvider::Buffer {
+    /* The PeriodBuffer holds the frames mixed by a DuplicatingThread.  It is shared by
+     * all of the OutputTracks that the DuplicatingThread feeds, and is used directly as
+     * their track buffer, so each period is copied once no matter how many downstream
+     * threads read it.  Like a Pipe, there is a single writer and each OutputTrack keeps
+     * its own read position; the frame count is a power of 2 so that the control block
+     * indices of all the OutputTracks map to the same frames.
+     */
+    class PeriodBuffer : public RefBase {
     public:
-        void *mBuffer;
+                            PeriodBuffer(size_t frameCount, size_t frameSize);
+        virtual             ~PeriodBuffer();
+
+                void*       buffer() const { return mBuffer; }
+                size_t      frameCount() const { return mFrameCount; }
+                // last written frame + 1
+                int32_t     rear() const { return android_atomic_acquire_load(&mRear); }
+
+                // copy frames from data into the buffer, overwriting the oldest frames
+                void        write(const void* data, size_t frames);
+
+    private:
+        const size_t        mFrameCount;    // power of 2
+        const size_t        mFrameSize;
+        void*               mBuffer;
+        volatile int32_t    mRear;          // only written by the DuplicatingThread
     };
 
                         OutputTrack(PlaybackThread *thread,
                                 DuplicatingThread *sourceThread,
+                                const sp<PeriodBuffer>& periodBuffer,
                                 uint32_t sampleRate,
                                 audio_format_t format,
                                 audio_channel_mask_t channelMask,
@@ -207,24 +233,25 @@ public:
                                     AudioSystem::SYNC_EVENT_NONE,
                              audio_session_t triggerSession = AUDIO_SESSION_NONE);
     virtual void        stop();
-            bool        write(void* data, uint32_t frames);
-            bool        bufferQueueEmpty() const { return mBufferQueue.size() == 0; }
+            // publish to the downstream thread the frames written to the period buffer
+            // since the last call, waiting up to waitTimeMs() for the track to make room.
+            // Returns true if they could not all be published.
+            bool        write(uint32_t frames);
             bool        isActive() const { return mActive; }
     const wp<ThreadBase>& thread() const { return mThread; }
+    const sp<PeriodBuffer>& periodBuffer() const { return mPeriodBuffer; }
 
 private:
 
     status_t            obtainBuffer(AudioBufferProvider::Buffer* buffer,
                                      uint32_t waitTimeMs);
-    void                clearBufferQueue();
+    // frames of the period buffer not yet published to this track
+    size_t              framesPending();
 
     void                restartIfDisabled();
 
-    // Maximum number of pending buffers allocated by OutputTrack::write()
-    static const uint8_t kMaxOverFlowBuffers = 10;
-
-    Vector < Buffer* >          mBufferQueue;
-    AudioBufferProvider::Buffer mOutBuffer;
+    const sp<PeriodBuffer>      mPeriodBuffer;
+    int32_t                     mRear;      // last published frame of mPeriodBuffer + 1
     bool                        mActive;
     DuplicatingThread* const    mSourceThread; // for waitTimeMs() in write()
     sp<AudioTrackClientProxy>   mClientProxy;
@@ -90,6 +90,11 @@ private:
 
             // used by the record thread to convert frames to proper destination format
             RecordBufferConverter              *mRecordBufferConverter;
+
+            // if set, the converted frames are read from this stream shared with other tracks
+            // instead of being converted by mRecordBufferConverter
+            sp<ConvertedStream>                 mConvertedStream;
+            int32_t                             mConvertedFront;  // read position in the stream
             audio_input_flags_t                mFlags;
 };
 
@@ -17,6 +17,8 @@
 
 #define LOG_TAG "AudioFlinger"
 //#define LOG_NDEBUG 0
+#include <string.h>
+#include <cutils/properties.h>
 #include <system/audio.h>
 #include <utils/Log.h>
 
@@ -40,9 +42,17 @@ SpdifStreamOut::SpdifStreamOut(AudioHwDevice *dev,
         , mApplicationFormat(AUDIO_FORMAT_DEFAULT)
         , mApplicationSampleRate(0)
         , mApplicationChannelMask(0)
+        , mAggregationBuffer(NULL)
+        , mAggregationBufferSize(0)
+        , mAggregatedBytes(0)
 {
 }
 
+SpdifStreamOut::~SpdifStreamOut()
+{
+    delete[] mAggregationBuffer;
+}
+
 status_t SpdifStreamOut::open(
                               audio_io_handle_t handle,
                               audio_devices_t devices,
@@ -98,24 +108,82 @@ status_t SpdifStreamOut::open(
 
     ALOGI("SpdifStreamOut::open() status = %d", status);
 
+    if (status == NO_ERROR &&
+            property_get_bool("ro.audio.spdif.aggregate", false /* default_value */)) {
+        size_t bufferSize = 0;
+        if (stream->getBufferSize(&bufferSize) == OK && bufferSize > 0) {
+            mAggregationBuffer = new uint8_t[bufferSize];
+            mAggregationBufferSize = bufferSize;
+            ALOGI("SpdifStreamOut::open() aggregating bursts up to %zu bytes", bufferSize);
+        }
+    }
+
     return status;
 }
 
 int SpdifStreamOut::flush()
 {
     mSpdifEncoder.reset();
+    mAggregatedBytes = 0;
     return AudioStreamOut::flush();
 }
 
 int SpdifStreamOut::standby()
 {
     mSpdifEncoder.reset();
+    // The bursts held back are played before standby, so that mFramesWrittenAtStandby
+    // includes them.
+    if (mAggregatedBytes > 0) {
+        (void) writeAggregatedBursts();
+        mAggregatedBytes = 0;
+    }
     return AudioStreamOut::standby();
 }
 
 ssize_t SpdifStreamOut::writeDataBurst(const void* buffer, size_t bytes)
 {
-    return AudioStreamOut::write(buffer, bytes);
+    if (mAggregationBuffer == NULL) {
+        return AudioStreamOut::write(buffer, bytes);
+    }
+    if (mAggregatedBytes + bytes > mAggregationBufferSize) {
+        status_t status = writeAggregatedBursts();
+        if (status != NO_ERROR) {
+            return status;
+        }
+        if (bytes > mAggregationBufferSize) {
+            // a burst larger than the HAL buffer is not worth copying
+            return AudioStreamOut::write(buffer, bytes);
+        }
+    }
+    memcpy(mAggregationBuffer + mAggregatedBytes, buffer, bytes);
+    mAggregatedBytes += bytes;
+    if (mAggregatedBytes == mAggregationBufferSize) {
+        status_t status = writeAggregatedBursts();
+        if (status != NO_ERROR) {
+            return status;
+        }
+    }
+    return bytes;
+}
+
+status_t SpdifStreamOut::writeAggregatedBursts()
+{
+    size_t offset = 0;
+    status_t status = NO_ERROR;
+    while (offset < mAggregatedBytes) {
+        ssize_t written = AudioStreamOut::write(mAggregationBuffer + offset,
+                mAggregatedBytes - offset);
+        if (written <= 0) {
+            status = written < 0 ? (status_t) written : WOULD_BLOCK;
+            break;
+        }
+        offset += written;
+    }
+    if (offset > 0) {
+        mAggregatedBytes -= offset;
+        memmove(mAggregationBuffer, mAggregationBuffer + offset, mAggregatedBytes);
+    }
+    return status;
 }
 
 ssize_t SpdifStreamOut::write(const void* buffer, size_t numBytes)
@@ -32,6 +32,11 @@ namespace android {
 /**
  * Stream that is a PCM data burst in the HAL but looks like an encoded stream
  * to the AudioFlinger. Wraps encoded data in an SPDIF wrapper per IEC61973-3.
+ *
+ * If ro.audio.spdif.aggregate is true, the data bursts are packed into a buffer of the HAL
+ * buffer size, which is written to the HAL when it is full, so that the HAL gets a few large
+ * writes instead of one write per burst. The HAL position is not affected, as it only counts
+ * the frames that the HAL has been given.
  */
 class SpdifStreamOut : public AudioStreamOut {
 public:
@@ -39,7 +44,7 @@ public:
     SpdifStreamOut(AudioHwDevice *dev, audio_output_flags_t flags,
             audio_format_t format);
 
-    virtual ~SpdifStreamOut() { }
+    virtual ~SpdifStreamOut();
 
     virtual status_t open(
             audio_io_handle_t handle,
@@ -114,6 +119,14 @@ private:
     ssize_t  writeDataBurst(const void* data, size_t bytes);
     ssize_t  writeInternal(const void* buffer, size_t bytes);
 
+    // Writes the aggregated bursts to the HAL. Returns NO_ERROR if they were all written,
+    // or an error and keeps the bytes which were not written.
+    status_t writeAggregatedBursts();
+
+    uint8_t             *mAggregationBuffer; // NULL if the bursts are not aggregated
+    size_t               mAggregationBufferSize; // in bytes, the HAL buffer size
+    size_t               mAggregatedBytes;   // bytes in mAggregationBuffer not yet written
+
 };
 
 } // namespace android
@@ -18,6 +18,7 @@
 //#define LOG_NDEBUG 0
 
 #include "Configuration.h"
+#include <string.h>
 #include <time.h>
 #include <cutils/atomic.h>
 #include <utils/Log.h>
@@ -40,28 +41,32 @@ void StateQueueMutatorDump::dump(int fd)
 
 // Constructor and destructor
 
-template<typename T> StateQueue<T>::StateQueue() :
+template<typename T, unsigned N> StateQueue<T, N>::StateQueue() :
     mAck(NULL), mCurrent(NULL),
-    mMutating(&mStates[0]), mExpecting(NULL),
+    mMutating(&mStates[0]), mExpecting(NULL), mPushSequence(0),
     mInMutation(false), mIsDirty(false), mIsInitialized(false)
 #ifdef STATE_QUEUE_DUMP
     , mObserverDump(&mObserverDummyDump), mMutatorDump(&mMutatorDummyDump)
 #endif
 {
     atomic_init(&mNext, static_cast<uintptr_t>(0));
+    atomic_init(&mObserverStates, 0u);
+    memset(mStateSequence, 0, sizeof(mStateSequence));
 }
 
-template<typename T> StateQueue<T>::~StateQueue()
+template<typename T, unsigned N> StateQueue<T, N>::~StateQueue()
 {
 }
 
 // Observer APIs
 
-template<typename T> const T* StateQueue<T>::poll()
+template<typename T, unsigned N> const T* StateQueue<T, N>::poll()
 {
     const T *next = (const T *) atomic_load_explicit(&mNext, memory_order_acquire);
 
     if (next != mCurrent) {
+        atomic_store_explicit(&mObserverStates, (stateIndex(mCurrent) << 8) | stateIndex(next),
+                memory_order_release);
         mAck = next;    // no additional barrier needed
         mCurrent = next;
 #ifdef STATE_QUEUE_DUMP
@@ -73,14 +78,14 @@ template<typename T> const T* StateQueue<T>::poll()
 
 // Mutator APIs
 
-template<typename T> T* StateQueue<T>::begin()
+template<typename T, unsigned N> T* StateQueue<T, N>::begin()
 {
     ALOG_ASSERT(!mInMutation, "begin() called when in a mutation");
     mInMutation = true;
     return mMutating;
 }
 
-template<typename T> void StateQueue<T>::end(bool didModify)
+template<typename T, unsigned N> void StateQueue<T, N>::end(bool didModify)
 {
     ALOG_ASSERT(mInMutation, "end() called when not in a mutation");
     ALOG_ASSERT(mIsInitialized || didModify, "first end() must modify for initialization");
@@ -91,7 +96,7 @@ template<typename T> void StateQueue<T>::end(bool didModify)
     mInMutation = false;
 }
 
-template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
+template<typename T, unsigned N> bool StateQueue<T, N>::push(StateQueue<T, N>::block_t block)
 {
 #define PUSH_BLOCK_ACK_NS    3000000L   // 3 ms: time between checks for ack in push()
                                         //       FIXME should be configurable
@@ -111,16 +116,15 @@ template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
         mMutatorDump->mPushDirty++;
 #endif
 
-        // wait for prior push to be acknowledged
-        if (mExpecting != NULL) {
+        // wait until there is a state which the observer is not using, to mutate next
+        T *following;
+        {
 #ifdef STATE_QUEUE_DUMP
             unsigned count = 0;
 #endif
             for (;;) {
-                const T *ack = (const T *) mAck;    // no additional barrier needed
-                if (ack == mExpecting) {
-                    // unnecessary as we're about to rewrite
-                    //mExpecting = NULL;
+                following = findUnusedState();
+                if (following != NULL) {
                     break;
                 }
                 if (block == BLOCK_NEVER) {
@@ -143,12 +147,10 @@ template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
 
         // publish
         atomic_store_explicit(&mNext, (uintptr_t)mMutating, memory_order_release);
+        mStateSequence[mMutating - mStates] = ++mPushSequence;
         mExpecting = mMutating;
 
-        // copy with circular wraparound
-        if (++mMutating >= &mStates[kN]) {
-            mMutating = &mStates[0];
-        }
+        mMutating = following;
         *mMutating = *mExpecting;
         mIsDirty = false;
 
@@ -185,6 +187,26 @@ template<typename T> bool StateQueue<T>::push(StateQueue<T>::block_t block)
     return true;
 }
 
+template<typename T, unsigned N> T* StateQueue<T, N>::findUnusedState() const
+{
+    const unsigned observerStates = atomic_load_explicit(&mObserverStates, memory_order_acquire);
+    const unsigned current = observerStates & 0xFF;
+    const unsigned previous = (observerStates >> 8) & 0xFF;
+    // Before the first acknowledgement, the observer may be polling any pushed state
+    const uint32_t currentSequence = current != 0 ? mStateSequence[current - 1] : 0;
+    for (unsigned i = 0; i < kN; ++i) {
+        if (&mStates[i] == mMutating || i + 1 == current || i + 1 == previous) {
+            continue;
+        }
+        // a state pushed after the current one may be polled at any time
+        if (mStateSequence[i] != 0 && (int32_t) (mStateSequence[i] - currentSequence) > 0) {
+            continue;
+        }
+        return const_cast<T *>(&mStates[i]);
+    }
+    return NULL;
+}
+
 }   // namespace android
 
 // hack for gcc
@@ -89,7 +89,13 @@
 //  a mutation is pushed onto the queue.  To the observer, the state pointers are
 //  effectively in random order, that is the observer should not do address
 //  arithmetic on the state pointers.  However to the mutator, the state pointers
-//  are in a definite circular order.
+//  are in a definite order.
+//  The observer only uses its current and previous states, plus any state pushed after its
+//  current one, which it may be about to poll.  The observer publishes its current and previous
+//  states together with each acknowledgement, and the mutator reuses any other state.  So with
+//  a queue of N states, up to N - 3 pushed states can be waiting for an acknowledgement, and
+//  the observer may skip some of them.  With N == 4, each push waits for the previous one to be
+//  acknowledged.
 
 #include "Configuration.h"
 
@@ -123,8 +129,8 @@ struct StateQueueMutatorDump {
 };
 #endif
 
-// manages a FIFO queue of states
-template<typename T> class StateQueue {
+// manages a FIFO queue of N states, see above for the number of states which can be in flight
+template<typename T, unsigned N = 4> class StateQueue {
 
 public:
             StateQueue();
@@ -173,6 +179,34 @@ public:
     // Return whether the current state is dirty (modified and not pushed).
     bool    isDirty() const { return mIsDirty; }
 
+    // Applies several mutations to one state, and pushes it once when it goes out of scope:
+    //      {
+    //          StateQueue<T>::Batch batch(sq, BLOCK_UNTIL_PUSHED);
+    //          batch.state()->... = ...;
+    //          batch.modified();
+    //          ...
+    //      }
+    // The state is not pushed if modified() was not called.
+    class Batch {
+    public:
+        Batch(StateQueue *sq, block_t block) : mSQ(sq), mBlock(block), mDidModify(false),
+                mState(sq->begin()) { }
+        ~Batch() {
+            mSQ->end(mDidModify);
+            if (mDidModify) {
+                mSQ->push(mBlock);
+            }
+        }
+        T*      state() const { return mState; }
+        void    modified() { mDidModify = true; }
+        void    setBlock(block_t block) { mBlock = block; }
+    private:
+        StateQueue * const  mSQ;
+        block_t             mBlock;
+        bool                mDidModify;
+        T * const           mState;
+    };
+
 #ifdef STATE_QUEUE_DUMP
     // Register location of observer dump area
     void    setObserverDump(StateQueueObserverDump *dump)
@@ -184,12 +218,19 @@ public:
 #endif
 
 private:
-    static const unsigned kN = 4;       // values < 4 are not supported by this code
+    static const unsigned kN = N;       // values < 4 are not supported by this code
+    static_assert(N >= 4, "a StateQueue needs at least 4 states");
     T                 mStates[kN];      // written by mutator, read by observer
 
     // "volatile" is meaningless with SMP, but here it indicates that we're using atomic ops
     atomic_uintptr_t  mNext; // written by mutator to advance next, read by observer
     volatile const T* mAck;  // written by observer to acknowledge advance of next, read by mutator
+    // written by observer before mAck, read by mutator to find a state to mutate:
+    // 1 + index of the current state in bits 0-7, 1 + index of the previous state in bits 8-15,
+    // or 0 if there is no such state.
+    atomic_uint       mObserverStates;
+    unsigned          stateIndex(const T *state) const
+                          { return state != NULL ? state - mStates + 1 : 0; }
 
     // only used by observer
     const T*          mCurrent;         // most recent value returned by poll()
@@ -197,10 +238,15 @@ private:
     // only used by mutator
     T*                mMutating;        // where updates by mutator are done in place
     const T*          mExpecting;       // what the mutator expects mAck to be set to
+    uint32_t          mPushSequence;    // number of pushes
+    uint32_t          mStateSequence[kN]; // value of mPushSequence when each state was pushed
     bool              mInMutation;      // whether we're currently in the middle of a mutation
     bool              mIsDirty;         // whether mutating state has been modified since last push
     bool              mIsInitialized;   // whether mutating state has been initialized yet
 
+    // Returns a state which is not used by the observer, other than mMutating, or NULL
+    T*                findUnusedState() const;
+
 #ifdef STATE_QUEUE_DUMP
     StateQueueObserverDump  mObserverDummyDump; // default area for observer dump if not set
     StateQueueObserverDump* mObserverDump;      // pointer to active observer dump, always non-NULL
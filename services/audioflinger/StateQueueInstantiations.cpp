@@ -23,7 +23,7 @@
 
 namespace android {
 
-template class StateQueue<FastMixerState>;      // typedef FastMixerStateQueue
+template class StateQueue<FastMixerState, FastMixerState::kStateQueueDepth>; // FastMixerStateQueue
 template class StateQueue<FastCaptureState>;    // typedef FastCaptureStateQueue
 
 }
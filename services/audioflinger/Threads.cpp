@@ -52,11 +52,13 @@
 #include <media/nbaio/Pipe.h>
 #include <media/nbaio/PipeReader.h>
 #include <media/nbaio/SourceAudioBufferProvider.h>
+#include <media/MediaAnalyticsItem.h>
 #include <mediautils/BatteryNotifier.h>
 
 #include <powermanager/PowerManager.h>
 
 #include "AudioFlinger.h"
+#include "BufLog.h"
 #include "FastMixer.h"
 #include "FastCapture.h"
 #include "ServiceUtilities.h"
@@ -219,6 +221,25 @@ static void sFastTrackMultiplierInit()
     }
 }
 
+// If af.fast_deadline_pct is set, schedules fast thread tid with SCHED_DEADLINE, reserving that
+// percentage of its period of frameCount frames.  Returns false if this is disabled or refused,
+// in which case the caller requests SCHED_FIFO as usual.  Missed periods still show up as
+// overruns and underruns in the fast thread's dump.
+static bool requestFastThreadDeadline(pid_t tid, size_t frameCount, uint32_t sampleRate)
+{
+    const int32_t runtimePct = property_get_int32("af.fast_deadline_pct", 0);
+    if (runtimePct <= 0 || runtimePct > 100 || sampleRate == 0) {
+        return false;
+    }
+    const uint64_t periodNs = (uint64_t) frameCount * 1000000000 / sampleRate;
+    const int err = requestDeadline(tid, periodNs * runtimePct / 100, periodNs, periodNs);
+    if (err != 0) {
+        ALOGW("SCHED_DEADLINE is unavailable for tid %d, error %d; using SCHED_FIFO", tid, err);
+        return false;
+    }
+    return true;
+}
+
 // ----------------------------------------------------------------------------
 
 #ifdef ADD_BATTERY_DATA
@@ -1663,7 +1684,11 @@ AudioFlinger::PlaybackThread::PlaybackThread(const sp<AudioFlinger>& audioFlinge
         mScreenState(AudioFlinger::mScreenState),
         // index 0 is reserved for normal mixer's submix
         mFastTrackAvailMask(((1 << FastMixerState::sMaxFastTracks) - 1) & ~1),
-        mHwSupportsPause(false), mHwPaused(false), mFlushPending(false)
+        mHwSupportsPause(false), mHwPaused(false), mFlushPending(false),
+        // mAdaptiveWrite initialized by readOutputParameters_l()
+        mAdaptiveWriteBoosted(false),
+        // mBurstWrite initialized by readOutputParameters_l()
+        // mCpuAccounting initialized by readOutputParameters_l()
 {
     snprintf(mThreadName, kThreadNameLength, "AudioOut_%X", id);
     mNBLogWriter = audioFlinger->newWriter_l(kLogSize, mThreadName);
@@ -1702,7 +1727,9 @@ AudioFlinger::PlaybackThread::~PlaybackThread()
     mAudioFlinger->unregisterWriter(mNBLogWriter);
     free(mSinkBuffer);
     free(mMixerBuffer);
-    free(mEffectBuffer);
+    if (mEffectBufferHal == 0) {
+        free(mEffectBuffer);
+    }
 }
 
 void AudioFlinger::PlaybackThread::dump(int fd, const Vector<String16>& args)
@@ -1777,6 +1804,78 @@ void AudioFlinger::PlaybackThread::dumpTracks(int fd, const Vector<String16>& ar
     }
 
     write(fd, result.string(), result.size());
+
+    if (mCpuAccounting) {
+        dumpCpuAccounting(fd);
+    }
+}
+
+void AudioFlinger::PlaybackThread::processEffectChains(
+        const Vector< sp<EffectChain> >& effectChains)
+{
+    for (size_t i = 0; i < effectChains.size(); i ++) {
+        if (CC_UNLIKELY(mCpuAccounting)) {
+            const nsecs_t startNs = systemTime();
+            effectChains[i]->process_l();
+            effectChains[i]->addProcessNs(systemTime() - startNs);
+        } else {
+            effectChains[i]->process_l();
+        }
+    }
+}
+
+void AudioFlinger::PlaybackThread::dumpCpuAccounting(int fd)
+{
+    dprintf(fd, "  CPU accounting per track:\n");
+    dprintf(fd, "    Name Session   Uid    Mix ms  Mix us/period\n");
+    KeyedVector<audio_session_t, int64_t> sessionMixNs;
+    for (size_t i = 0; i < mTracks.size(); ++i) {
+        const sp<Track>& track = mTracks[i];
+        dprintf(fd, "    %4d %7d %5d %9.3f %14.1f\n",
+                track->name() - AudioMixer::TRACK0, track->sessionId(), track->uid(),
+                track->mMixNs * 1e-6,
+                track->mMixPeriods != 0 ? track->mMixNs * 1e-3 / track->mMixPeriods : 0.);
+        const ssize_t index = sessionMixNs.indexOfKey(track->sessionId());
+        if (index >= 0) {
+            sessionMixNs.editValueAt(index) += track->mMixNs;
+        } else {
+            sessionMixNs.add(track->sessionId(), track->mMixNs);
+        }
+    }
+    for (size_t i = 0; i < mEffectChains.size(); ++i) {
+        if (sessionMixNs.indexOfKey(mEffectChains[i]->sessionId()) < 0) {
+            sessionMixNs.add(mEffectChains[i]->sessionId(), 0);
+        }
+    }
+    dprintf(fd, "  CPU accounting per session:\n");
+    dprintf(fd, "    Session    Mix ms  Effects ms\n");
+    for (size_t i = 0; i < sessionMixNs.size(); ++i) {
+        const sp<EffectChain> chain = getEffectChain_l(sessionMixNs.keyAt(i));
+        dprintf(fd, "    %7d %9.3f %11.3f\n", sessionMixNs.keyAt(i),
+                sessionMixNs.valueAt(i) * 1e-6, chain != 0 ? chain->processNs() * 1e-6 : 0.);
+    }
+}
+
+// Submits the CPU time of a track and of the effects of its session to the media metrics
+// service when the track is removed.
+void AudioFlinger::PlaybackThread::reportCpuAccounting_l(const sp<Track>& track)
+{
+    const sp<EffectChain> chain = getEffectChain_l(track->sessionId());
+    const int64_t effectsNs = chain != 0 ? chain->processNs() : 0;
+    if (track->mMixNs == 0 && effectsNs == 0) {
+        return;
+    }
+    MediaAnalyticsItem *item = new MediaAnalyticsItem("audiothread");
+    item->generateSessionID();
+    item->setUid(track->uid());
+    item->setInt32("android.media.audiothread.session", track->sessionId());
+    item->setInt32("android.media.audiothread.type", mType);
+    item->setInt64("android.media.audiothread.mixNs", track->mMixNs);
+    item->setInt64("android.media.audiothread.mixPeriods", track->mMixPeriods);
+    item->setInt64("android.media.audiothread.effectsNs", effectsNs);
+    item->setFinalized(true);
+    item->selfrecord();
+    delete item;
 }
 
 void AudioFlinger::PlaybackThread::dumpInternals(int fd, const Vector<String16>& args)
@@ -2215,6 +2314,9 @@ void AudioFlinger::PlaybackThread::removeTrack_l(const sp<Track>& track)
     track->dump(buffer, ARRAY_SIZE(buffer), false /* active */);
     mLocalLog.log("removeTrack_l (%p) %s", track.get(), buffer + 4); // log for analysis
 
+    if (mCpuAccounting) {
+        reportCpuAccounting_l(track);
+    }
     mTracks.remove(track);
     deleteTrackName_l(track->name());
     // redundant as track is about to be destroyed, for dumpsys only
@@ -2423,6 +2525,19 @@ void AudioFlinger::PlaybackThread::readOutputParameters_l()
     mThreadThrottleEndMs = 0;
     mHalfBufferMs = mNormalFrameCount * 1000 / (2 * mSampleRate);
 
+    // Check if we want to pace the writes from their measured duration instead
+    mAdaptiveWrite = mType == MIXER &&
+            property_get_bool("af.thread.adaptive", false /* default_value */);
+    mWritePeriodController.setPeriod(seconds(mNormalFrameCount) / mSampleRate);
+
+    // Check if we want to fill the HAL buffer in bursts and sleep in between
+    mBurstWrite = mType == MIXER && (mOutput->flags & AUDIO_OUTPUT_FLAG_DEEP_BUFFER) != 0 &&
+            property_get_bool("af.thread.burst_write", false /* default_value */);
+    mBurstWriteController.setPeriod(mNormalFrameCount, mSampleRate);
+
+    // Check if we want to measure the CPU time of each track and effect chain
+    mCpuAccounting = property_get_bool("af.thread.cpu_accounting", false /* default_value */);
+
     // mSinkBuffer is the sink buffer.  Size is always multiple-of-16 frames.
     // Originally this was int16_t[] array, need to remove legacy implications.
     free(mSinkBuffer);
@@ -2442,13 +2557,24 @@ void AudioFlinger::PlaybackThread::readOutputParameters_l()
                 * audio_bytes_per_sample(mMixerBufferFormat);
         (void)posix_memalign(&mMixerBuffer, 32, mMixerBufferSize);
     }
-    free(mEffectBuffer);
+    if (mEffectBufferHal == 0) {
+        free(mEffectBuffer);
+    }
     mEffectBuffer = NULL;
+    mEffectBufferHal.clear();
     if (mEffectBufferEnabled) {
         mEffectBufferFormat = AUDIO_FORMAT_PCM_16_BIT; // Note: Effects support 16b only
         mEffectBufferSize = mNormalFrameCount * mChannelCount
                 * audio_bytes_per_sample(mEffectBufferFormat);
-        (void)posix_memalign(&mEffectBuffer, 32, mEffectBufferSize);
+        // The memory comes from the effect HAL, so that the effect chains can share it
+        // with the effects instead of mirroring it.
+        if (EffectBufferHalInterface::allocate(mEffectBufferSize, &mEffectBufferHal) == OK) {
+            mEffectBuffer = mEffectBufferHal->audioBuffer()->raw;
+        } else {
+            ALOGW("cannot allocate effect HAL buffer, effect chains will copy the mix");
+            mEffectBufferHal.clear();
+            (void)posix_memalign(&mEffectBuffer, 32, mEffectBufferSize);
+        }
     }
 
     // force reconfiguration of effect chains and engines to take new buffer size and audio
@@ -2785,13 +2911,17 @@ status_t AudioFlinger::PlaybackThread::addEffectChain_l(const sp<EffectChain>& c
 {
     audio_session_t session = chain->sessionId();
     sp<EffectBufferHalInterface> halInBuffer, halOutBuffer;
-    status_t result = EffectBufferHalInterface::mirror(
-            mEffectBufferEnabled ? mEffectBuffer : mSinkBuffer,
-            mEffectBufferEnabled ? mEffectBufferSize : mSinkBufferSize,
-            &halInBuffer);
-    if (result != OK) return result;
+    if (mEffectBufferEnabled && mEffectBufferHal != 0) {
+        halInBuffer = mEffectBufferHal;
+    } else {
+        status_t result = EffectBufferHalInterface::mirror(
+                mEffectBufferEnabled ? mEffectBuffer : mSinkBuffer,
+                mEffectBufferEnabled ? mEffectBufferSize : mSinkBufferSize,
+                &halInBuffer);
+        if (result != OK) return result;
+    }
     halOutBuffer = halInBuffer;
-    int16_t *buffer = reinterpret_cast<int16_t*>(halInBuffer->externalData());
+    int16_t *buffer = reinterpret_cast<int16_t*>(halInBuffer->ptr());
 
     ALOGV("addEffectChain_l() %p on thread %p for session %d", chain.get(), this, session);
     if (session > AUDIO_SESSION_OUTPUT_MIX) {
@@ -3110,6 +3240,15 @@ bool AudioFlinger::PlaybackThread::threadLoop()
                     threadLoop_standby();
 
                     mStandby = true;
+
+                    if (mAdaptiveWrite) {
+                        // the HAL timing after standby is unrelated to what was learned
+                        mWritePeriodController.restart();
+                        updateAdaptiveWritePriority();
+                    }
+                    if (mBurstWrite) {
+                        mBurstWriteController.restart();
+                    }
                 }
 
                 if (!mActiveTracks.size() && mConfigEvents.isEmpty()) {
@@ -3207,9 +3346,7 @@ bool AudioFlinger::PlaybackThread::threadLoop()
 
             // only process effects if we're going to write
             if (mSleepTimeUs == 0 && mType != OFFLOAD) {
-                for (size_t i = 0; i < effectChains.size(); i ++) {
-                    effectChains[i]->process_l();
-                }
+                processEffectChains(effectChains);
             }
         }
         // Process effect chains for offloaded thread even if no audio
@@ -3217,9 +3354,7 @@ bool AudioFlinger::PlaybackThread::threadLoop()
         // and thus does have to be synchronized with audio writes but may have
         // to be called while waiting for async write callback
         if (mType == OFFLOAD) {
-            for (size_t i = 0; i < effectChains.size(); i ++) {
-                effectChains[i]->process_l();
-            }
+            processEffectChains(effectChains);
         }
 
         // Only if the Effects buffer is enabled and there is data in the
@@ -3276,10 +3411,41 @@ bool AudioFlinger::PlaybackThread::threadLoop()
                             ALOGW("write blocked for %llu msecs, %d delayed writes, thread %p",
                                     (unsigned long long) ns2ms(delta), mNumDelayedWrites, this);
                             lastWarning = lastWriteFinished;
+                            // save the rolling debug captures, if any
+                            BUFLOG_TRIGGER;
                         }
                     }
 
-                    if (mThreadThrottle
+                    if (mBurstWrite) {
+                        if (mMixerStatus == MIXER_TRACKS_READY && ret > 0) {
+                            uint64_t queued;
+                            const nsecs_t sleepNs = mBurstWriteController.onWrite(
+                                    mLastWriteTime, lastWriteFinished,
+                                    mOutput->getQueuedFrames(&queued) == NO_ERROR ?
+                                            (int64_t) queued : -1);
+                            if (sleepNs > 0) {
+                                // Unlike the other pacing, this sleep spans several periods,
+                                // so let new tracks and config events end it early.
+                                Mutex::Autolock _l(mLock);
+                                if (!mSignalPending && mConfigEvents.isEmpty() && !exitPending()) {
+                                    mWaitWorkCV.waitRelative(mLock, sleepNs);
+                                }
+                                lastWriteFinished = systemTime();
+                            }
+                        }
+                    } else if (mAdaptiveWrite) {
+                        if (mMixerStatus == MIXER_TRACKS_READY && ret > 0) {
+                            // Sleep so that the next write finds the HAL with the target
+                            // headroom, instead of the fixed throttle below.
+                            const nsecs_t sleepNs = mWritePeriodController.onWrite(
+                                    mLastWriteTime, lastWriteFinished);
+                            updateAdaptiveWritePriority();
+                            if (sleepNs > 0) {
+                                usleep(sleepNs / 1000);
+                                lastWriteFinished += sleepNs;
+                            }
+                        }
+                    } else if (mThreadThrottle
                             && mMixerStatus == MIXER_TRACKS_READY // we are mixing (active tracks)
                             && ret > 0) {                         // we wrote something
                         // Limit MixerThread data processing to no more than twice the
@@ -3393,6 +3559,19 @@ bool AudioFlinger::PlaybackThread::threadLoop()
     return false;
 }
 
+// updateAdaptiveWritePriority() must be called from threadLoop()
+void AudioFlinger::PlaybackThread::updateAdaptiveWritePriority()
+{
+    if (mWritePeriodController.wantsBoost() == mAdaptiveWriteBoosted) {
+        return;
+    }
+    mAdaptiveWriteBoosted = !mAdaptiveWriteBoosted;
+    int err = androidSetThreadPriority(gettid(), mAdaptiveWriteBoosted ?
+            ANDROID_PRIORITY_HIGHEST : ANDROID_PRIORITY_URGENT_AUDIO);
+    ALOGW_IF(err != 0, "thread %p failed to %s priority: %d", this,
+            mAdaptiveWriteBoosted ? "raise" : "restore", err);
+}
+
 // removeTracks_l() must be called with ThreadBase::mLock held
 void AudioFlinger::PlaybackThread::removeTracks_l(const Vector< sp<Track> >& tracksToRemove)
 {
@@ -3599,6 +3778,7 @@ AudioFlinger::MixerThread::MixerThread(const sp<AudioFlinger>& audioFlinger, Aud
             mSampleRate, mChannelMask, mChannelCount, mFormat, mFrameSize, mFrameCount,
             mNormalFrameCount);
     mAudioMixer = new AudioMixer(mNormalFrameCount, mSampleRate);
+    mAudioMixer->setCpuAccounting(mCpuAccounting);
 
     if (type == DUPLICATING) {
         // The Duplicating thread uses the AudioMixer and delivers data to OutputTracks
@@ -3738,17 +3918,29 @@ AudioFlinger::MixerThread::MixerThread(const sp<AudioFlinger>& audioFlinger, Aud
         // start the fast mixer
         mFastMixer->run("FastMixer", PRIORITY_URGENT_AUDIO);
         pid_t tid = mFastMixer->getTid();
-        sendPrioConfigEvent(getpid_cached, tid, kPriorityFastMixer, false);
+        if (!requestFastThreadDeadline(tid, mFrameCount, mSampleRate)) {
+            sendPrioConfigEvent(getpid_cached, tid, kPriorityFastMixer, false);
+        }
         stream()->setHalThreadPriority(kPriorityFastMixer);
 
+        // create and start the watchdog, in continuous profiling mode if
+        // af.watchdog.profile_us is the period at which to sample the fast mixer phase
+        const int32_t profileUs = property_get_int32("af.watchdog.profile_us", 0);
 #ifdef AUDIO_WATCHDOG
-        // create and start the watchdog
-        mAudioWatchdog = new AudioWatchdog();
-        mAudioWatchdog->setDump(&mAudioWatchdogDump);
-        mAudioWatchdog->run("AudioWatchdog", PRIORITY_URGENT_AUDIO);
-        tid = mAudioWatchdog->getTid();
-        sendPrioConfigEvent(getpid_cached, tid, kPriorityFastMixer);
+        const bool createWatchdog = true;
+#else
+        const bool createWatchdog = profileUs > 0;
 #endif
+        if (createWatchdog) {
+            mAudioWatchdog = new AudioWatchdog();
+            mAudioWatchdog->setDump(&mAudioWatchdogDump);
+            if (profileUs > 0) {
+                mAudioWatchdog->setProfiling(&mFastMixerDumpState.mPhase, profileUs);
+            }
+            mAudioWatchdog->run("AudioWatchdog", PRIORITY_URGENT_AUDIO);
+            tid = mAudioWatchdog->getTid();
+            sendPrioConfigEvent(getpid_cached, tid, kPriorityFastMixer);
+        }
 
     }
 
@@ -3791,13 +3983,11 @@ AudioFlinger::MixerThread::~MixerThread()
         delete fastTrack->mBufferProvider;
         sq->end(false /*didModify*/);
         mFastMixer.clear();
-#ifdef AUDIO_WATCHDOG
         if (mAudioWatchdog != 0) {
             mAudioWatchdog->requestExit();
             mAudioWatchdog->requestExitAndWait();
             mAudioWatchdog.clear();
         }
-#endif
     }
     mAudioFlinger->unregisterWriter(mFastMixerNBLogWriter);
     delete mAudioMixer;
@@ -3839,11 +4029,9 @@ ssize_t AudioFlinger::MixerThread::threadLoop_write()
                 if (old == -1) {
                     (void) syscall(__NR_futex, &mFastMixerFutex, FUTEX_WAKE_PRIVATE, 1);
                 }
-#ifdef AUDIO_WATCHDOG
                 if (mAudioWatchdog != 0) {
                     mAudioWatchdog->resume();
                 }
-#endif
             }
             state->mCommand = FastMixerState::MIX_WRITE;
 #ifdef FAST_THREAD_STATISTICS
@@ -3888,11 +4076,9 @@ void AudioFlinger::MixerThread::threadLoop_standby()
             if (kUseFastMixer == FastMixer_Dynamic) {
                 mNormalSink = mOutputSink;
             }
-#ifdef AUDIO_WATCHDOG
             if (mAudioWatchdog != 0) {
                 mAudioWatchdog->pause();
             }
-#endif
         } else {
             sq->end(false /*didModify*/);
         }
@@ -4217,6 +4403,14 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
         // The first time a track is added we wait
         // for all its buffers to be filled before processing it
         int name = track->name();
+        if (mCpuAccounting) {
+            // charged during the previous mix
+            const int64_t mixNs = mAudioMixer->consumeTrackProcessNs(name);
+            if (mixNs != 0) {
+                track->mMixNs += mixNs;
+                track->mMixPeriods++;
+            }
+        }
         // make sure that we have enough frames to mix one full buffer.
         // enforce this condition only once to enable draining the buffer in case the client
         // app does not call stop() and relies on underrun to stop:
@@ -4542,11 +4736,9 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
         // active tracks, which may be added or removed.
         sq->push(coldIdle ? FastMixerStateQueue::BLOCK_NEVER : block);
     }
-#ifdef AUDIO_WATCHDOG
     if (pauseAudioWatchdog && mAudioWatchdog != 0) {
         mAudioWatchdog->pause();
     }
-#endif
 
     // Now perform the deferred reset on fast tracks that have stopped
     while (resetMask != 0) {
@@ -4719,6 +4911,7 @@ bool AudioFlinger::MixerThread::checkForNewParameter_l(const String8& keyValuePa
             readOutputParameters_l();
             delete mAudioMixer;
             mAudioMixer = new AudioMixer(mNormalFrameCount, mSampleRate);
+            mAudioMixer->setCpuAccounting(mCpuAccounting);
             for (size_t i = 0; i < mTracks.size() ; i++) {
                 int name = getTrackName_l(mTracks[i]->mChannelMask,
                         mTracks[i]->mFormat, mTracks[i]->mSessionId, mTracks[i]->uid());
@@ -4739,6 +4932,12 @@ void AudioFlinger::MixerThread::dumpInternals(int fd, const Vector<String16>& ar
 {
     PlaybackThread::dumpInternals(fd, args);
     dprintf(fd, "  Thread throttle time (msecs): %u\n", mThreadThrottleTimeMs);
+    if (mAdaptiveWrite) {
+        mWritePeriodController.dump(fd);
+    }
+    if (mBurstWrite) {
+        mBurstWriteController.dump(fd);
+    }
     dprintf(fd, "  AudioMixer tracks: 0x%08x\n", mAudioMixer->trackNames());
     dprintf(fd, "  Master mono: %s\n", mMasterMono ? "on" : "off");
 
@@ -4761,13 +4960,11 @@ void AudioFlinger::MixerThread::dumpInternals(int fd, const Vector<String16>& ar
         mutatorCopy.dump(fd);
 #endif
 
-#ifdef AUDIO_WATCHDOG
         if (mAudioWatchdog != 0) {
             // Make a non-atomic copy of audio watchdog dump so it won't change underneath us
             AudioWatchdogDump wdCopy = mAudioWatchdogDump;
             wdCopy.dump(fd);
         }
-#endif
 
     } else {
         dprintf(fd, "  No FastMixer\n");
@@ -5784,7 +5981,7 @@ void AudioFlinger::DuplicatingThread::threadLoop_sleepTime()
             writeFrames = mNormalFrameCount;
             memset(mSinkBuffer, 0, mSinkBufferSize);
         } else {
-            // flush remaining overflow buffers in output tracks
+            // publish remaining frames of the period buffers to output tracks
             writeFrames = 0;
         }
         mSleepTimeUs = 0;
@@ -5793,8 +5990,13 @@ void AudioFlinger::DuplicatingThread::threadLoop_sleepTime()
 
 ssize_t AudioFlinger::DuplicatingThread::threadLoop_write()
 {
+    // The period buffers are the output track buffers, so the sink buffer is copied
+    // once per period buffer rather than once per output track.
+    for (size_t i = 0; i < periodBuffers.size(); i++) {
+        periodBuffers[i]->write(mSinkBuffer, writeFrames);
+    }
     for (size_t i = 0; i < outputTracks.size(); i++) {
-        outputTracks[i]->write(mSinkBuffer, writeFrames);
+        outputTracks[i]->write(writeFrames);
     }
     mStandby = false;
     return (ssize_t)mSinkBufferSize;
@@ -5811,11 +6013,13 @@ void AudioFlinger::DuplicatingThread::threadLoop_standby()
 void AudioFlinger::DuplicatingThread::saveOutputTracks()
 {
     outputTracks = mOutputTracks;
+    periodBuffers = mPeriodBuffers;
 }
 
 void AudioFlinger::DuplicatingThread::clearOutputTracks()
 {
     outputTracks.clear();
+    periodBuffers.clear();
 }
 
 void AudioFlinger::DuplicatingThread::addOutputTrack(MixerThread *thread)
@@ -5830,8 +6034,24 @@ void AudioFlinger::DuplicatingThread::addOutputTrack(MixerThread *thread)
     // from different OutputTracks and their associated MixerThreads (e.g. one may
     // nearly empty and the other may be dropping data).
 
+    // Share a period buffer with the other OutputTracks if one is large enough.
+    // It must hold at least twice the track buffer, so that a full track does not have
+    // its unread frames overwritten while the other tracks are being written.
+    const size_t periodBufferFrames = roundup(2 * max(frameCount, mNormalFrameCount));
+    sp<OutputTrack::PeriodBuffer> periodBuffer;
+    for (size_t i = 0; i < mPeriodBuffers.size(); i++) {
+        if (mPeriodBuffers[i]->frameCount() >= periodBufferFrames) {
+            periodBuffer = mPeriodBuffers[i];
+            break;
+        }
+    }
+    if (periodBuffer == 0) {
+        periodBuffer = new OutputTrack::PeriodBuffer(periodBufferFrames, mFrameSize);
+    }
+
     sp<OutputTrack> outputTrack = new OutputTrack(thread,
                                             this,
+                                            periodBuffer,
                                             mSampleRate,
                                             mFormat,
                                             mChannelMask,
@@ -5844,6 +6064,7 @@ void AudioFlinger::DuplicatingThread::addOutputTrack(MixerThread *thread)
     }
     thread->setStreamVolume(AUDIO_STREAM_PATCH, 1.0f);
     mOutputTracks.add(outputTrack);
+    mPeriodBuffers.add(periodBuffer);
     ALOGV("addOutputTrack() track %p, on thread %p", outputTrack.get(), thread);
     updateWaitTime_l();
 }
@@ -5853,8 +6074,10 @@ void AudioFlinger::DuplicatingThread::removeOutputTrack(MixerThread *thread)
     Mutex::Autolock _l(mLock);
     for (size_t i = 0; i < mOutputTracks.size(); i++) {
         if (mOutputTracks[i]->thread() == thread) {
+            const sp<OutputTrack::PeriodBuffer> periodBuffer = mOutputTracks[i]->periodBuffer();
             mOutputTracks[i]->destroy();
             mOutputTracks.removeAt(i);
+            removePeriodBufferIfUnused_l(periodBuffer);
             updateWaitTime_l();
             if (thread->getOutput() == mOutput) {
                 mOutput = NULL;
@@ -5865,6 +6088,19 @@ void AudioFlinger::DuplicatingThread::removeOutputTrack(MixerThread *thread)
     ALOGV("removeOutputTrack(): unknown thread: %p", thread);
 }
 
+// caller must hold mLock
+void AudioFlinger::DuplicatingThread::removePeriodBufferIfUnused_l(
+        const sp<OutputTrack::PeriodBuffer>& periodBuffer)
+{
+    for (size_t i = 0; i < mOutputTracks.size(); i++) {
+        if (mOutputTracks[i]->periodBuffer() == periodBuffer) {
+            return;
+        }
+    }
+    // the OutputTracks still hold a reference until the downstream threads release them
+    mPeriodBuffers.remove(periodBuffer);
+}
+
 // caller must hold mLock
 void AudioFlinger::DuplicatingThread::updateWaitTime_l()
 {
@@ -5934,6 +6170,8 @@ AudioFlinger::RecordThread::RecordThread(const sp<AudioFlinger>& audioFlinger,
     mInput(input), mRsmpInBuffer(NULL),
     // mRsmpInFrames, mRsmpInFramesP2, and mRsmpInFramesOA are set by readInputParameters_l()
     mRsmpInRear(0)
+    , mSharedConversion(property_get_bool("ro.audio.record.shared_conversion",
+            false /* default_value */))
 #ifdef TEE_SINK
     , mTeeSink(teeSink)
 #endif
@@ -6042,7 +6280,9 @@ AudioFlinger::RecordThread::RecordThread(const sp<AudioFlinger>& audioFlinger,
         // start the fast capture
         mFastCapture->run("FastCapture", ANDROID_PRIORITY_URGENT_AUDIO);
         pid_t tid = mFastCapture->getTid();
-        sendPrioConfigEvent(getpid_cached, tid, kPriorityFastCapture, false);
+        if (!requestFastThreadDeadline(tid, mFrameCount, mSampleRate)) {
+            sendPrioConfigEvent(getpid_cached, tid, kPriorityFastCapture, false);
+        }
         stream()->setHalThreadPriority(kPriorityFastCapture);
 #ifdef AUDIO_WATCHDOG
         // FIXME
@@ -6389,6 +6629,10 @@ reacquire_wakelock:
         }
         rear = mRsmpInRear += framesRead;
 
+        if (mSharedConversion) {
+            updateConvertedStreams(activeTracks, framesRead);
+        }
+
         size = activeTracks.size();
         // loop over each active track
         for (size_t i = 0; i < size; i++) {
@@ -6419,25 +6663,39 @@ reacquire_wakelock:
                 // check available frames and handle overrun conditions
                 // if the record track isn't draining fast enough.
                 bool hasOverrun;
-                size_t framesIn;
-                activeTrack->mResamplerBufferProvider->sync(&framesIn, &hasOverrun);
-                if (hasOverrun) {
-                    overrun = OVERRUN_TRUE;
-                }
-                if (framesOut == 0 || framesIn == 0) {
-                    break;
-                }
+                if (activeTrack->mConvertedStream != 0) {
+                    // copy frames already converted for all the tracks sharing the stream
+                    framesOut = activeTrack->mConvertedStream->read(activeTrack->mSink.raw,
+                            &activeTrack->mConvertedFront, framesOut, &hasOverrun);
+                    if (hasOverrun) {
+                        overrun = OVERRUN_TRUE;
+                    }
+                    if (framesOut == 0) {
+                        break;
+                    }
+                } else {
+                    size_t framesIn;
+                    activeTrack->mResamplerBufferProvider->sync(&framesIn, &hasOverrun);
+                    if (hasOverrun) {
+                        overrun = OVERRUN_TRUE;
+                    }
+                    if (framesOut == 0 || framesIn == 0) {
+                        break;
+                    }
 
-                // Don't allow framesOut to be larger than what is possible with resampling
-                // from framesIn.
-                // This isn't strictly necessary but helps limit buffer resizing in
-                // RecordBufferConverter.  TODO: remove when no longer needed.
-                framesOut = min(framesOut,
-                        destinationFramesPossible(
-                                framesIn, mSampleRate, activeTrack->mSampleRate));
-                // process frames from the RecordThread buffer provider to the RecordTrack buffer
-                framesOut = activeTrack->mRecordBufferConverter->convert(
-                        activeTrack->mSink.raw, activeTrack->mResamplerBufferProvider, framesOut);
+                    // Don't allow framesOut to be larger than what is possible with resampling
+                    // from framesIn.
+                    // This isn't strictly necessary but helps limit buffer resizing in
+                    // RecordBufferConverter.  TODO: remove when no longer needed.
+                    framesOut = min(framesOut,
+                            destinationFramesPossible(
+                                    framesIn, mSampleRate, activeTrack->mSampleRate));
+                    // process frames from the RecordThread buffer provider to the RecordTrack
+                    // buffer
+                    framesOut = activeTrack->mRecordBufferConverter->convert(
+                            activeTrack->mSink.raw, activeTrack->mResamplerBufferProvider,
+                            framesOut);
+                }
 
                 if (framesOut > 0 && (overrun == OVERRUN_UNKNOWN)) {
                     overrun = OVERRUN_FALSE;
@@ -6791,6 +7049,8 @@ status_t AudioFlinger::RecordThread::start(RecordThread::RecordTrack* recordTrac
         recordTrack->mResamplerBufferProvider->reset();
         // clear any converter state as new data will be discontinuous
         recordTrack->mRecordBufferConverter->reset();
+        // the track attaches to a converted stream again at its current position
+        recordTrack->mConvertedStream.clear();
         recordTrack->mState = TrackBase::STARTING_2;
         // signal thread to start
         mWaitWorkCV.broadcast();
@@ -6975,9 +7235,17 @@ void AudioFlinger::RecordThread::dumpTracks(int fd, const Vector<String16>& args
 }
 
 
+sp<AudioFlinger::ThreadBase> AudioFlinger::RecordThread::ResamplerBufferProvider::getThread() const
+{
+    if (mRecordTrack == NULL) {
+        return mRecordThread;
+    }
+    return mRecordTrack->mThread.promote();
+}
+
 void AudioFlinger::RecordThread::ResamplerBufferProvider::reset()
 {
-    sp<ThreadBase> threadBase = mRecordTrack->mThread.promote();
+    sp<ThreadBase> threadBase = getThread();
     RecordThread *recordThread = (RecordThread *) threadBase.get();
     mRsmpInFront = recordThread->mRsmpInRear;
     mRsmpInUnrel = 0;
@@ -6986,7 +7254,7 @@ void AudioFlinger::RecordThread::ResamplerBufferProvider::reset()
 void AudioFlinger::RecordThread::ResamplerBufferProvider::sync(
         size_t *framesAvailable, bool *hasOverrun)
 {
-    sp<ThreadBase> threadBase = mRecordTrack->mThread.promote();
+    sp<ThreadBase> threadBase = getThread();
     RecordThread *recordThread = (RecordThread *) threadBase.get();
     const int32_t rear = recordThread->mRsmpInRear;
     const int32_t front = mRsmpInFront;
@@ -7019,7 +7287,7 @@ void AudioFlinger::RecordThread::ResamplerBufferProvider::sync(
 status_t AudioFlinger::RecordThread::ResamplerBufferProvider::getNextBuffer(
         AudioBufferProvider::Buffer* buffer)
 {
-    sp<ThreadBase> threadBase = mRecordTrack->mThread.promote();
+    sp<ThreadBase> threadBase = getThread();
     if (threadBase == 0) {
         buffer->frameCount = 0;
         buffer->raw = NULL;
@@ -7073,6 +7341,174 @@ void AudioFlinger::RecordThread::ResamplerBufferProvider::releaseBuffer(
 }
 
 
+AudioFlinger::RecordThread::ConvertedStream::ConvertedStream(RecordThread* recordThread,
+        audio_channel_mask_t channelMask, audio_format_t format, uint32_t sampleRate)
+    : mUpdated(false),
+      mWasUpdated(false),
+      mRecordThread(recordThread),
+      mSrcChannelMask(recordThread->mChannelMask),
+      mSrcFormat(recordThread->mFormat),
+      mSrcSampleRate(recordThread->mSampleRate),
+      mChannelMask(channelMask),
+      mFormat(format),
+      mSampleRate(sampleRate),
+      mConverter(new RecordBufferConverter(mSrcChannelMask, mSrcFormat, mSrcSampleRate,
+              channelMask, format, sampleRate)),
+      mProvider(recordThread),
+      mBuffer(NULL),
+      // enough for all the frames held by the RecordThread
+      mFramesP2(roundup(destinationFramesPossible(recordThread->mRsmpInFrames,
+              mSrcSampleRate, sampleRate) + 2)),
+      mFrameSize(audio_channel_count_from_in_mask(channelMask) * audio_bytes_per_sample(format)),
+      mRear(0)
+{
+    if (mConverter->initCheck() == NO_ERROR) {
+        (void)posix_memalign(&mBuffer, 32, mFramesP2 * mFrameSize);
+    }
+}
+
+AudioFlinger::RecordThread::ConvertedStream::~ConvertedStream()
+{
+    free(mBuffer);
+    delete mConverter;
+}
+
+status_t AudioFlinger::RecordThread::ConvertedStream::initCheck() const
+{
+    return mBuffer != NULL ? NO_ERROR : NO_INIT;
+}
+
+bool AudioFlinger::RecordThread::ConvertedStream::matches(audio_channel_mask_t channelMask,
+        audio_format_t format, uint32_t sampleRate) const
+{
+    return mChannelMask == channelMask && mFormat == format && mSampleRate == sampleRate
+            && mSrcChannelMask == mRecordThread->mChannelMask
+            && mSrcFormat == mRecordThread->mFormat
+            && mSrcSampleRate == mRecordThread->mSampleRate;
+}
+
+void AudioFlinger::RecordThread::ConvertedStream::reset(int32_t front)
+{
+    mProvider.setFront(front);
+    mConverter->reset();
+}
+
+void AudioFlinger::RecordThread::ConvertedStream::update()
+{
+    size_t framesIn;
+    mProvider.sync(&framesIn);
+    while (framesIn > 0) {
+        size_t framesOut = destinationFramesPossible(framesIn, mSrcSampleRate, mSampleRate);
+        const size_t rear = mRear & (mFramesP2 - 1);
+        if (framesOut > mFramesP2 - rear) {
+            framesOut = mFramesP2 - rear;
+        }
+        if (framesOut == 0) {
+            break;
+        }
+        framesOut = mConverter->convert((uint8_t *)mBuffer + rear * mFrameSize,
+                &mProvider, framesOut);
+        if (framesOut == 0) {
+            break;
+        }
+        mRear += framesOut;
+        mProvider.sync(&framesIn);
+    }
+}
+
+size_t AudioFlinger::RecordThread::ConvertedStream::read(void *dst, int32_t *front,
+        size_t frames, bool *hasOverrun) const
+{
+    const ssize_t filled = mRear - *front;
+    size_t available;
+    *hasOverrun = false;
+    if (filled < 0) {
+        // should not happen, but treat like a massive overrun and re-sync
+        *front = mRear;
+        available = 0;
+        *hasOverrun = true;
+    } else if ((size_t) filled <= mFramesP2) {
+        available = (size_t) filled;
+    } else {
+        // the track is not keeping up with the stream, but give it the latest data
+        available = mFramesP2;
+        *front = mRear - available;
+        *hasOverrun = true;
+    }
+    if (frames > available) {
+        frames = available;
+    }
+    for (size_t remaining = frames; remaining > 0; ) {
+        const size_t offset = *front & (mFramesP2 - 1);
+        size_t part = mFramesP2 - offset;
+        if (part > remaining) {
+            part = remaining;
+        }
+        memcpy(dst, (const uint8_t *)mBuffer + offset * mFrameSize, part * mFrameSize);
+        dst = (uint8_t *)dst + part * mFrameSize;
+        *front += part;
+        remaining -= part;
+    }
+    return frames;
+}
+
+void AudioFlinger::RecordThread::updateConvertedStreams(
+        const Vector< sp<RecordTrack> >& activeTracks, size_t framesRead)
+{
+    for (size_t i = 0; i < mConvertedStreams.size(); i++) {
+        mConvertedStreams[i]->mWasUpdated = mConvertedStreams[i]->mUpdated;
+        mConvertedStreams[i]->mUpdated = false;
+    }
+    for (size_t i = 0; i < activeTracks.size(); i++) {
+        const sp<RecordTrack> &track = activeTracks[i];
+        if (track->isFastTrack() || track->mSampleRate == mSampleRate) {
+            continue;
+        }
+        sp<ConvertedStream> stream = track->mConvertedStream;
+        if (stream != 0 && !stream->matches(track->mChannelMask, track->mFormat,
+                track->mSampleRate)) {
+            // the input was reconfigured
+            stream.clear();
+        }
+        if (stream == 0) {
+            for (size_t j = 0; j < mConvertedStreams.size(); j++) {
+                if (mConvertedStreams[j]->matches(track->mChannelMask, track->mFormat,
+                        track->mSampleRate)) {
+                    stream = mConvertedStreams[j];
+                    break;
+                }
+            }
+            if (stream == 0) {
+                stream = new ConvertedStream(this, track->mChannelMask, track->mFormat,
+                        track->mSampleRate);
+                if (stream->initCheck() != NO_ERROR) {
+                    // keep converting for this track only
+                    continue;
+                }
+                mConvertedStreams.add(stream);
+            }
+            if (!stream->mUpdated && !stream->mWasUpdated) {
+                // new or idle stream: start converting from the frames just read
+                stream->reset(mRsmpInRear - framesRead);
+            }
+            track->mConvertedStream = stream;
+            track->mConvertedFront = stream->rear();
+        }
+        stream->mUpdated = true;
+    }
+    for (size_t i = 0; i < mConvertedStreams.size(); ) {
+        const sp<ConvertedStream> &stream = mConvertedStreams[i];
+        if (stream->mUpdated) {
+            stream->update();
+        } else if (stream->getStrongCount() == 1) {
+            // no track refers to the stream any more
+            mConvertedStreams.removeAt(i);
+            continue;
+        }
+        i++;
+    }
+}
+
 bool AudioFlinger::RecordThread::checkForNewParameter_l(const String8& keyValuePair,
                                                         status_t& status)
 {
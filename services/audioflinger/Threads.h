@@ -830,6 +830,11 @@ protected:
     // Due to constraints on mNormalFrameCount, the buffer size is a multiple of 16 frames.
     void*                           mEffectBuffer;
 
+    // The effect HAL buffer which owns the memory of mEffectBuffer, if it could be allocated.
+    // All the effect chains of the thread process it directly instead of a mirror of
+    // mEffectBuffer, so no copy is made to pass the mix to effects hosted by the HAL.
+    sp<EffectBufferHalInterface>    mEffectBufferHal;
+
     // Size of mEffectsBuffer in bytes: mNormalFrameCount * #channels * sampsize.
     size_t                          mEffectBufferSize;
 
@@ -997,6 +1002,23 @@ protected:
                 bool        mHwSupportsPause;
                 bool        mHwPaused;
                 bool        mFlushPending;
+
+                // adaptive write pacing, see af.thread.adaptive. MIXER threads only.
+                bool        mAdaptiveWrite;         // updated by readOutputParameters_l()
+                WritePeriodController mWritePeriodController;
+                bool        mAdaptiveWriteBoosted;  // thread priority raised for the controller
+                void        updateAdaptiveWritePriority();
+
+                // burst fill then sleep pacing, see af.thread.burst_write. Deep buffer MIXER
+                // threads only, takes precedence over adaptive pacing.
+                bool        mBurstWrite;            // updated by readOutputParameters_l()
+                BurstWriteController mBurstWriteController;
+
+                // per track and per session CPU accounting, see af.thread.cpu_accounting
+                bool        mCpuAccounting;         // updated by readOutputParameters_l()
+                void        processEffectChains(const Vector< sp<EffectChain> >& effectChains);
+                void        dumpCpuAccounting(int fd);
+                void        reportCpuAccounting_l(const sp<Track>& track);
 };
 
 class MixerThread : public PlaybackThread {
@@ -1225,6 +1247,9 @@ protected:
 private:
     // called from threadLoop, addOutputTrack, removeOutputTrack
     virtual     void        updateWaitTime_l();
+    // called from removeOutputTrack
+                void        removePeriodBufferIfUnused_l(
+                                    const sp<OutputTrack::PeriodBuffer>& periodBuffer);
 protected:
     virtual     void        saveOutputTracks();
     virtual     void        clearOutputTracks();
@@ -1233,6 +1258,9 @@ private:
                 uint32_t    mWaitTimeMs;
     SortedVector < sp<OutputTrack> >  outputTracks;
     SortedVector < sp<OutputTrack> >  mOutputTracks;
+    // period buffers read by the output tracks; each one is written once per mix period
+    SortedVector < sp<OutputTrack::PeriodBuffer> >  periodBuffers;
+    SortedVector < sp<OutputTrack::PeriodBuffer> >  mPeriodBuffers;
 public:
     virtual     bool        hasFastMixer() const { return false; }
 };
@@ -1252,7 +1280,11 @@ public:
     {
     public:
         explicit ResamplerBufferProvider(RecordTrack* recordTrack) :
-            mRecordTrack(recordTrack),
+            mRecordTrack(recordTrack), mRecordThread(NULL),
+            mRsmpInUnrel(0), mRsmpInFront(0) { }
+        // for a provider owned by the RecordThread itself
+        explicit ResamplerBufferProvider(RecordThread* recordThread) :
+            mRecordTrack(NULL), mRecordThread(recordThread),
             mRsmpInUnrel(0), mRsmpInFront(0) { }
         virtual ~ResamplerBufferProvider() { }
 
@@ -1276,8 +1308,13 @@ public:
         // AudioBufferProvider interface
         virtual status_t    getNextBuffer(AudioBufferProvider::Buffer* buffer);
         virtual void        releaseBuffer(AudioBufferProvider::Buffer* buffer);
+        // sets the read position to the given RecordThread frame
+        void        setFront(int32_t front) { mRsmpInFront = front; mRsmpInUnrel = 0; }
     private:
+        sp<ThreadBase>      getThread() const;
+
         RecordTrack * const mRecordTrack;
+        RecordThread * const mRecordThread; // if not owned by a RecordTrack
         size_t              mRsmpInUnrel;   // unreleased frames remaining from
                                             // most recent getNextBuffer
                                             // for debug only
@@ -1285,6 +1322,58 @@ public:
                                             // rolling counter that is never cleared
     };
 
+    /* The ConvertedStream converts the RecordThread data once for all the RecordTracks
+     * which need the same sample rate conversion to the same format and channel mask.
+     * The converted frames are kept in a ring buffer, which each RecordTrack reads at its
+     * own position. It is only accessed by the RecordThread loop.
+     */
+    class ConvertedStream : public RefBase
+    {
+    public:
+        ConvertedStream(RecordThread* recordThread, audio_channel_mask_t channelMask,
+                        audio_format_t format, uint32_t sampleRate);
+        virtual ~ConvertedStream();
+
+        status_t    initCheck() const;
+
+        // true if the stream gives frames with these parameters from the current
+        // RecordThread configuration
+        bool        matches(audio_channel_mask_t channelMask, audio_format_t format,
+                            uint32_t sampleRate) const;
+
+        // restarts the conversion from the RecordThread frame at position front
+        void        reset(int32_t front);
+
+        // converts the frames read by the RecordThread since the previous update
+        void        update();
+
+        // position of the next converted frame, rolling counter that is never cleared
+        int32_t     rear() const { return mRear; }
+
+        // Copies up to frames converted frames from position *front to dst, and advances
+        // *front. If the reader has fallen behind by more than the ring buffer, it is moved
+        // to the oldest frame available and *hasOverrun is set.
+        size_t      read(void *dst, int32_t *front, size_t frames, bool *hasOverrun) const;
+
+        bool        mUpdated;       // updated during the current RecordThread loop
+        bool        mWasUpdated;    // updated during the previous RecordThread loop
+
+    private:
+        RecordThread * const        mRecordThread;
+        const audio_channel_mask_t  mSrcChannelMask;
+        const audio_format_t        mSrcFormat;
+        const uint32_t              mSrcSampleRate;
+        const audio_channel_mask_t  mChannelMask;
+        const audio_format_t        mFormat;
+        const uint32_t              mSampleRate;
+        RecordBufferConverter      *mConverter;
+        ResamplerBufferProvider     mProvider;
+        void                       *mBuffer;
+        size_t                      mFramesP2;      // size of mBuffer in frames, a power of 2
+        size_t                      mFrameSize;
+        int32_t                     mRear;
+    };
+
 #include "RecordTracks.h"
 
             RecordThread(const sp<AudioFlinger>& audioFlinger,
@@ -1395,6 +1484,12 @@ private:
             // Call the HAL standby method unconditionally, and don't change mStandby flag
             void    inputStandBy();
 
+            // Attach the active tracks which need sample rate conversion to the converted
+            // stream for their parameters, and convert the frames just read for each stream
+            // in use. framesRead is the number of frames just read.
+            void    updateConvertedStreams(const Vector< sp<RecordTrack> >& activeTracks,
+                                           size_t framesRead);
+
             AudioStreamIn                       *mInput;
             SortedVector < sp<RecordTrack> >    mTracks;
             // mActiveTracks has dual roles:  it indicates the current active track(s), and
@@ -1412,6 +1507,11 @@ private:
             // rolling index that is never cleared
             int32_t                             mRsmpInRear;    // last filled frame + 1
 
+            // tracks which need the same sample rate conversion share a converted stream,
+            // accessible only within the threadLoop(), no locks required
+            const bool                          mSharedConversion;
+            Vector< sp<ConvertedStream> >       mConvertedStreams;
+
             // For dumpsys
             const sp<NBAIO_Sink>                mTeeSink;
 
@@ -392,6 +392,8 @@ AudioFlinger::PlaybackThread::Track::Track(
     mVolumeHandler(new VolumeHandler(sampleRate)),
     // mSinkTimestamp
     mFastIndex(-1),
+    mMixNs(0),
+    mMixPeriods(0),
     mCachedVolume(1.0),
     mResumeToStopping(false),
     mFlushHwPending(false),
@@ -1225,23 +1227,61 @@ void AudioFlinger::PlaybackThread::Track::updateTrackFrameInfo(
 
 // ----------------------------------------------------------------------------
 
+AudioFlinger::PlaybackThread::OutputTrack::PeriodBuffer::PeriodBuffer(
+            size_t frameCount, size_t frameSize)
+    :   mFrameCount(frameCount), mFrameSize(frameSize),
+        mBuffer(calloc(frameCount, frameSize)), mRear(0)
+{
+    ALOG_ASSERT(frameCount == roundup(frameCount));
+}
+
+AudioFlinger::PlaybackThread::OutputTrack::PeriodBuffer::~PeriodBuffer()
+{
+    free(mBuffer);
+}
+
+void AudioFlinger::PlaybackThread::OutputTrack::PeriodBuffer::write(const void* data,
+                                                                    size_t frames)
+{
+    int32_t rear = mRear;
+    if (frames > mFrameCount) {
+        // only the most recent frames fit
+        data = (const int8_t *)data + (frames - mFrameCount) * mFrameSize;
+        rear += frames - mFrameCount;
+        frames = mFrameCount;
+    }
+    const size_t offset = rear & (mFrameCount - 1);
+    const size_t part1 = frames < mFrameCount - offset ? frames : mFrameCount - offset;
+    memcpy((int8_t *)mBuffer + offset * mFrameSize, data, part1 * mFrameSize);
+    if (part1 < frames) {
+        memcpy(mBuffer, (const int8_t *)data + part1 * mFrameSize,
+                (frames - part1) * mFrameSize);
+    }
+    android_atomic_release_store(rear + frames, &mRear);
+}
+
 AudioFlinger::PlaybackThread::OutputTrack::OutputTrack(
             PlaybackThread *playbackThread,
             DuplicatingThread *sourceThread,
+            const sp<PeriodBuffer>& periodBuffer,
             uint32_t sampleRate,
             audio_format_t format,
             audio_channel_mask_t channelMask,
             size_t frameCount,
             uid_t uid)
     :   Track(playbackThread, NULL, AUDIO_STREAM_PATCH,
-              sampleRate, format, channelMask, frameCount,
-              NULL, 0, AUDIO_SESSION_NONE, uid, AUDIO_OUTPUT_FLAG_NONE,
+              sampleRate, format, channelMask, periodBuffer->frameCount(),
+              periodBuffer->buffer(), 0, AUDIO_SESSION_NONE, uid, AUDIO_OUTPUT_FLAG_NONE,
               TYPE_OUTPUT),
+    mPeriodBuffer(periodBuffer),
+    // The control block rear starts at 0, so start reading the period buffer at its
+    // next wrap in order to index the same frames.
+    mRear((periodBuffer->rear() + (int32_t)periodBuffer->frameCount() - 1) &
+            ~((int32_t)periodBuffer->frameCount() - 1)),
     mActive(false), mSourceThread(sourceThread)
 {
 
     if (mCblk != NULL) {
-        mOutBuffer.frameCount = 0;
         playbackThread->mTracks.add(this);
         ALOGV("OutputTrack constructor mCblk %p, mBuffer %p, "
                 "frameCount %zu, mChannelMask 0x%08x",
@@ -1251,6 +1291,9 @@ AudioFlinger::PlaybackThread::OutputTrack::OutputTrack(
         // the buffer has the same virtual address on both sides
         mClientProxy = new AudioTrackClientProxy(mCblk, mBuffer, mFrameCount, mFrameSize,
                 true /*clientInServer*/);
+        // The period buffer is larger than the track needs, so that it can be written
+        // while the track is full without overwriting unread frames.
+        mClientProxy->setBufferSizeInFrames(frameCount);
         mClientProxy->setVolumeLR(GAIN_MINIFLOAT_PACKED_UNITY);
         mClientProxy->setSendLevel(0.0);
         mClientProxy->setSampleRate(sampleRate);
@@ -1261,7 +1304,6 @@ AudioFlinger::PlaybackThread::OutputTrack::OutputTrack(
 
 AudioFlinger::PlaybackThread::OutputTrack::~OutputTrack()
 {
-    clearBufferQueue();
     // superclass destructor will now delete the server proxy and shared memory both refer to
 }
 
@@ -1281,19 +1323,12 @@ status_t AudioFlinger::PlaybackThread::OutputTrack::start(AudioSystem::sync_even
 void AudioFlinger::PlaybackThread::OutputTrack::stop()
 {
     Track::stop();
-    clearBufferQueue();
-    mOutBuffer.frameCount = 0;
     mActive = false;
 }
 
-bool AudioFlinger::PlaybackThread::OutputTrack::write(void* data, uint32_t frames)
+bool AudioFlinger::PlaybackThread::OutputTrack::write(uint32_t frames)
 {
-    Buffer *pInBuffer;
-    Buffer inBuffer;
     bool outputBufferFull = false;
-    inBuffer.frameCount = frames;
-    inBuffer.raw = data;
-
     uint32_t waitTimeLeftMs = mSourceThread->waitTimeMs();
 
     if (!mActive && frames != 0) {
@@ -1301,94 +1336,73 @@ bool AudioFlinger::PlaybackThread::OutputTrack::write(void* data, uint32_t frame
     }
 
     while (waitTimeLeftMs) {
-        // First write pending buffers, then new data
-        if (mBufferQueue.size()) {
-            pInBuffer = mBufferQueue.itemAt(0);
-        } else {
-            pInBuffer = &inBuffer;
+        const size_t pending = framesPending();
+        if (pending == 0) {
+            break;
         }
 
-        if (pInBuffer->frameCount == 0) {
+        AudioBufferProvider::Buffer outBuffer;
+        outBuffer.frameCount = pending;
+        nsecs_t startTime = systemTime();
+        status_t status = obtainBuffer(&outBuffer, waitTimeLeftMs);
+        if (status != NO_ERROR && status != NOT_ENOUGH_DATA) {
+            ALOGV("OutputTrack::write() %p thread %p no more output buffers; status %d", this,
+                    mThread.unsafe_get(), status);
+            outputBufferFull = true;
             break;
         }
-
-        if (mOutBuffer.frameCount == 0) {
-            mOutBuffer.frameCount = pInBuffer->frameCount;
-            nsecs_t startTime = systemTime();
-            status_t status = obtainBuffer(&mOutBuffer, waitTimeLeftMs);
-            if (status != NO_ERROR && status != NOT_ENOUGH_DATA) {
-                ALOGV("OutputTrack::write() %p thread %p no more output buffers; status %d", this,
-                        mThread.unsafe_get(), status);
-                outputBufferFull = true;
-                break;
-            }
-            uint32_t waitTimeMs = (uint32_t)ns2ms(systemTime() - startTime);
-            if (waitTimeLeftMs >= waitTimeMs) {
-                waitTimeLeftMs -= waitTimeMs;
-            } else {
-                waitTimeLeftMs = 0;
-            }
-            if (status == NOT_ENOUGH_DATA) {
-                restartIfDisabled();
-                continue;
-            }
+        uint32_t waitTimeMs = (uint32_t)ns2ms(systemTime() - startTime);
+        if (waitTimeLeftMs >= waitTimeMs) {
+            waitTimeLeftMs -= waitTimeMs;
+        } else {
+            waitTimeLeftMs = 0;
+        }
+        if (status == NOT_ENOUGH_DATA) {
+            restartIfDisabled();
+            continue;
         }
 
-        uint32_t outFrames = pInBuffer->frameCount > mOutBuffer.frameCount ? mOutBuffer.frameCount :
-                pInBuffer->frameCount;
-        memcpy(mOutBuffer.raw, pInBuffer->raw, outFrames * mFrameSize);
+        // The frames are already in place, as the period buffer is the track buffer.
+        ALOG_ASSERT(outBuffer.raw == (int8_t *)mPeriodBuffer->buffer() +
+                (mRear & (mPeriodBuffer->frameCount() - 1)) * mFrameSize);
         Proxy::Buffer buf;
-        buf.mFrameCount = outFrames;
+        buf.mFrameCount = outBuffer.frameCount;
         buf.mRaw = NULL;
         mClientProxy->releaseBuffer(&buf);
         restartIfDisabled();
-        pInBuffer->frameCount -= outFrames;
-        pInBuffer->raw = (int8_t *)pInBuffer->raw + outFrames * mFrameSize;
-        mOutBuffer.frameCount -= outFrames;
-        mOutBuffer.raw = (int8_t *)mOutBuffer.raw + outFrames * mFrameSize;
-
-        if (pInBuffer->frameCount == 0) {
-            if (mBufferQueue.size()) {
-                mBufferQueue.removeAt(0);
-                free(pInBuffer->mBuffer);
-                delete pInBuffer;
-                ALOGV("OutputTrack::write() %p thread %p released overflow buffer %zu", this,
-                        mThread.unsafe_get(), mBufferQueue.size());
-            } else {
-                break;
-            }
-        }
-    }
-
-    // If we could not write all frames, allocate a buffer and queue it for next time.
-    if (inBuffer.frameCount) {
-        sp<ThreadBase> thread = mThread.promote();
-        if (thread != 0 && !thread->standby()) {
-            if (mBufferQueue.size() < kMaxOverFlowBuffers) {
-                pInBuffer = new Buffer;
-                pInBuffer->mBuffer = malloc(inBuffer.frameCount * mFrameSize);
-                pInBuffer->frameCount = inBuffer.frameCount;
-                pInBuffer->raw = pInBuffer->mBuffer;
-                memcpy(pInBuffer->raw, inBuffer.raw, inBuffer.frameCount * mFrameSize);
-                mBufferQueue.add(pInBuffer);
-                ALOGV("OutputTrack::write() %p thread %p adding overflow buffer %zu", this,
-                        mThread.unsafe_get(), mBufferQueue.size());
-            } else {
-                ALOGW("OutputTrack::write() %p thread %p no more overflow buffers",
-                        mThread.unsafe_get(), this);
-            }
-        }
+        mRear += outBuffer.frameCount;
     }
 
-    // Calling write() with a 0 length buffer means that no more data will be written:
+    // Calling write() with 0 frames means that no more data will be written:
     // We rely on stop() to set the appropriate flags to allow the remaining frames to play out.
-    if (frames == 0 && mBufferQueue.size() == 0 && mActive) {
+    if (frames == 0 && framesPending() == 0 && mActive) {
         stop();
     }
 
     return outputBufferFull;
 }
 
+size_t AudioFlinger::PlaybackThread::OutputTrack::framesPending()
+{
+    const int32_t rear = mPeriodBuffer->rear();
+    const size_t frameCount = mPeriodBuffer->frameCount();
+    ssize_t filled = rear - mRear;
+    if (filled < 0) {
+        // the period buffer has not yet reached our start position
+        return 0;
+    }
+    if ((size_t) filled > frameCount) {
+        // The downstream thread is not keeping up with the duplicating thread,
+        // so give it the latest data.  Only whole buffers are skipped,
+        // as mRear must keep indexing the same frames as the control block rear.
+        ALOGV("OutputTrack::framesPending() %p thread %p overrun by %zd frames", this,
+                mThread.unsafe_get(), filled - (ssize_t) frameCount);
+        mRear += (int32_t) (filled & ~(frameCount - 1));
+        filled &= frameCount - 1;
+    }
+    return (size_t) filled;
+}
+
 status_t AudioFlinger::PlaybackThread::OutputTrack::obtainBuffer(
         AudioBufferProvider::Buffer* buffer, uint32_t waitTimeMs)
 {
@@ -1403,18 +1417,6 @@ status_t AudioFlinger::PlaybackThread::OutputTrack::obtainBuffer(
     return status;
 }
 
-void AudioFlinger::PlaybackThread::OutputTrack::clearBufferQueue()
-{
-    size_t size = mBufferQueue.size();
-
-    for (size_t i = 0; i < size; i++) {
-        Buffer *pBuffer = mBufferQueue.itemAt(i);
-        free(pBuffer->mBuffer);
-        delete pBuffer;
-    }
-    mBufferQueue.clear();
-}
-
 void AudioFlinger::PlaybackThread::OutputTrack::restartIfDisabled()
 {
     int32_t flags = android_atomic_and(~CBLK_DISABLED, &mCblk->mFlags);
@@ -1582,6 +1584,7 @@ AudioFlinger::RecordThread::RecordTrack::RecordTrack(
         mFramesToDrop(0),
         mResamplerBufferProvider(NULL), // initialize in case of early constructor exit
         mRecordBufferConverter(NULL),
+        mConvertedFront(0),
         mFlags(flags)
 {
     if (mCblk == NULL) {
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "WritePeriodController"
+//#define LOG_NDEBUG 0
+
+#include <stdio.h>
+#include <utils/Log.h>
+#include "WritePeriodController.h"
+
+namespace android {
+
+WritePeriodController::WritePeriodController()
+    : mPeriodNs(0), mTargetMinNs(0), mTargetMaxNs(0),
+      mWrites(0), mLastHeadroomNs(0), mTotalHeadroomNs(0), mMinHeadroomNs(0), mMaxWriteNs(0),
+      mBelowWindow(0), mAboveWindow(0), mBoosts(0)
+{
+    restart();
+}
+
+void WritePeriodController::setPeriod(nsecs_t periodNs)
+{
+    mPeriodNs = periodNs;
+    // keep between 1/8 and 1/4 of a period of headroom
+    mTargetMinNs = periodNs / 8;
+    mTargetMaxNs = periodNs / 4;
+    restart();
+}
+
+void WritePeriodController::restart()
+{
+    mCopyNs = 0;
+    mWriteCount = 0;
+    mSleepNs = 0;
+    mLowCount = 0;
+    mGoodCount = 0;
+    mBoosted = false;
+}
+
+nsecs_t WritePeriodController::onWrite(nsecs_t startNs, nsecs_t endNs)
+{
+    const nsecs_t writeNs = endNs > startNs ? endNs - startNs : 0;
+    if (mWriteCount == 0 || writeNs < mCopyNs) {
+        mCopyNs = writeNs;
+    }
+    if (mWriteCount < kWarmupWrites) {
+        mWriteCount++;
+    }
+    const nsecs_t headroomNs = writeNs - mCopyNs;
+
+    mWrites++;
+    mLastHeadroomNs = headroomNs;
+    mTotalHeadroomNs += headroomNs;
+    if (mWrites == 1 || headroomNs < mMinHeadroomNs) {
+        mMinHeadroomNs = headroomNs;
+    }
+    if (writeNs > mMaxWriteNs) {
+        mMaxWriteNs = writeNs;
+    }
+
+    // don't pace until the copy cost estimate has settled
+    if (mWriteCount < kWarmupWrites || mPeriodNs <= 0) {
+        return 0;
+    }
+
+    const nsecs_t targetNs = (mTargetMinNs + mTargetMaxNs) / 2;
+    if (headroomNs < mTargetMinNs) {
+        // back off by the full deficit, as running out of headroom risks an underrun
+        mBelowWindow++;
+        mSleepNs -= targetNs - headroomNs;
+        mGoodCount = 0;
+        if (++mLowCount >= kBoostAfter && !mBoosted) {
+            mBoosted = true;
+            mBoosts++;
+            ALOGV("headroom %lld ns below window for %u writes, boosting",
+                    (long long) headroomNs, mLowCount);
+        }
+    } else {
+        if (headroomNs > mTargetMaxNs) {
+            // approach the target by half of the excess, to not oscillate on a jittery HAL
+            mAboveWindow++;
+            mSleepNs += (headroomNs - targetNs) / 2;
+        }
+        mLowCount = 0;
+        if (mBoosted && ++mGoodCount >= kUnboostAfter) {
+            mBoosted = false;
+            mGoodCount = 0;
+        }
+    }
+    if (mSleepNs < 0) {
+        mSleepNs = 0;
+    } else if (mSleepNs > mPeriodNs - mTargetMinNs) {
+        mSleepNs = mPeriodNs - mTargetMinNs;
+    }
+    return mSleepNs;
+}
+
+void WritePeriodController::dump(int fd) const
+{
+    dprintf(fd, "  Adaptive write period: %.2f ms, target headroom %.2f to %.2f ms\n",
+            mPeriodNs * 1e-6, mTargetMinNs * 1e-6, mTargetMaxNs * 1e-6);
+    if (mWrites == 0) {
+        return;
+    }
+    dprintf(fd, "    Writes: %llu, max write %.2f ms, sleep after write %.2f ms\n",
+            (unsigned long long) mWrites, mMaxWriteNs * 1e-6, mSleepNs * 1e-6);
+    dprintf(fd, "    Headroom: last %.2f ms, mean %.2f ms, min %.2f ms\n",
+            mLastHeadroomNs * 1e-6, (double) mTotalHeadroomNs / mWrites * 1e-6,
+            mMinHeadroomNs * 1e-6);
+    dprintf(fd, "    Below window: %llu, above window: %llu, boosts: %u%s\n",
+            (unsigned long long) mBelowWindow, (unsigned long long) mAboveWindow, mBoosts,
+            mBoosted ? " (boosted)" : "");
+}
+
+}   // namespace android
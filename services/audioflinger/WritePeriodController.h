@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Adaptive pacing of the blocking HAL writes of a PlaybackThread.
+//
+// A blocking write returns when the HAL has accepted the data, so the time the write
+// spends blocked, beyond the cost of copying the data, is the headroom the thread had
+// when it started the write: how much earlier than necessary it woke up.
+// The controller learns the copy cost from the shortest write since it was restarted,
+// which is typically the first write after standby, and adjusts the
+// time to sleep after each write so that the blocked time stays inside a target window.
+// When the headroom stays below the window, it asks for a higher thread priority.
+
+#ifndef ANDROID_AUDIO_WRITE_PERIOD_CONTROLLER_H
+#define ANDROID_AUDIO_WRITE_PERIOD_CONTROLLER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+class WritePeriodController {
+
+public:
+    WritePeriodController();
+    /*virtual*/ ~WritePeriodController() { }
+
+    // Set the nominal period of the thread, and forget the learned state.
+    // The statistics are kept.
+    void        setPeriod(nsecs_t periodNs);
+
+    // Forget the learned state, for example after standby. The statistics are kept.
+    void        restart();
+
+    // Account for a write that started at startNs and returned at endNs.
+    // Returns the time to sleep before the next mix, >= 0.
+    nsecs_t     onWrite(nsecs_t startNs, nsecs_t endNs);
+
+    // Whether the thread priority should currently be raised.
+    bool        wantsBoost() const { return mBoosted; }
+
+    // Not synchronized with onWrite(); the usual caveats about atomicity apply.
+    void        dump(int fd) const;
+
+private:
+    static const uint32_t kWarmupWrites = 16;        // writes before pacing starts
+    static const uint32_t kBoostAfter = 3;           // consecutive low headroom writes to boost
+    static const uint32_t kUnboostAfter = 64;        // consecutive good writes to unboost
+
+    nsecs_t     mPeriodNs;          // nominal period
+    nsecs_t     mTargetMinNs;       // headroom window, derived from mPeriodNs
+    nsecs_t     mTargetMaxNs;
+
+    // learned state
+    nsecs_t     mCopyNs;            // shortest write since restart, cost of a non-blocking write
+    uint32_t    mWriteCount;        // writes since restart, saturates at kWarmupWrites
+    nsecs_t     mSleepNs;           // current sleep after each write
+    uint32_t    mLowCount;          // consecutive writes with headroom below window
+    uint32_t    mGoodCount;         // consecutive writes with headroom at or above window
+    bool        mBoosted;
+
+    // statistics
+    uint64_t    mWrites;
+    nsecs_t     mLastHeadroomNs;
+    nsecs_t     mTotalHeadroomNs;
+    nsecs_t     mMinHeadroomNs;
+    nsecs_t     mMaxWriteNs;
+    uint64_t    mBelowWindow;       // writes with headroom below window
+    uint64_t    mAboveWindow;       // writes with headroom above window
+    uint32_t    mBoosts;            // number of times a boost was requested
+};
+
+}   // namespace android
+
+#endif  // ANDROID_AUDIO_WRITE_PERIOD_CONTROLLER_H
@@ -305,6 +305,13 @@ public:
     // for each output (destination device) it is attached to.
     virtual status_t setStreamVolume(audio_stream_type_t stream, float volume, audio_io_handle_t output, int delayMs = 0) = 0;
 
+    // set the volumes of several stream types for a particular output at once. Used when the
+    // volumes of an output are reapplied, to send one request per output instead of one per stream.
+    virtual status_t setStreamVolumes(const Vector<audio_stream_type_t>& streams,
+                                      const Vector<float>& volumes,
+                                      audio_io_handle_t output,
+                                      int delayMs = 0) = 0;
+
     // invalidate a stream type, causing a reroute to an unspecified new output
     virtual status_t invalidateStream(audio_stream_type_t stream) = 0;
 
@@ -18,6 +18,7 @@ LOCAL_SRC_FILES:= \
     src/EffectDescriptor.cpp \
     src/SoundTriggerSession.cpp \
     src/SessionRoute.cpp \
+    src/RoutingCache.cpp \
     src/AudioSourceDescriptor.cpp \
     src/VolumeCurve.cpp \
     src/TypeConverter.cpp \
@@ -39,7 +40,9 @@ LOCAL_C_INCLUDES := \
 
 ifeq ($(USE_XML_AUDIO_POLICY_CONF), 1)
 
-LOCAL_SRC_FILES += src/Serializer.cpp
+LOCAL_SRC_FILES += \
+    src/Serializer.cpp \
+    src/AudioPolicyConfigCache.cpp
 
 LOCAL_SHARED_LIBRARIES += libicuuc libxml2
 
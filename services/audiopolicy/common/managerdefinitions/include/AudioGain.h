@@ -28,6 +28,9 @@ public:
     AudioGain(int index, bool useInChannelMask);
     virtual ~AudioGain() {}
 
+    int getIndex() const { return mIndex; }
+    bool useInChannelMask() const { return mUseInChannelMask; }
+
     void setMode(audio_gain_mode_t mode) { mGain.mode = mode; }
     const audio_gain_mode_t &getMode() const { return mGain.mode; }
 
@@ -23,6 +23,7 @@
 #include <system/audio.h>
 #include <utils/SortedVector.h>
 #include <utils/KeyedVector.h>
+#include <unordered_map>
 
 namespace android {
 
@@ -109,6 +110,10 @@ public:
     audio_devices_t getSupportedDevices(audio_io_handle_t handle) const;
 
     status_t dump(int fd) const;
+
+private:
+    // inputs found by getInputFromId(), checked against the collection before use
+    mutable std::unordered_map<audio_port_handle_t, sp<AudioInputDescriptor> > mIdIndex;
 };
 
 
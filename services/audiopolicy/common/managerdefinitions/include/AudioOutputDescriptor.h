@@ -24,6 +24,7 @@
 #include <utils/Timers.h>
 #include <utils/KeyedVector.h>
 #include <system/audio.h>
+#include <unordered_map>
 #include "AudioSourceDescriptor.h"
 
 namespace android {
@@ -59,6 +60,10 @@ public:
                            audio_devices_t device,
                            uint32_t delayMs,
                            bool force);
+    // Volume changes made by setVolume() between beginVolumeBatch() and endVolumeBatch() are
+    // sent to the client interface together when the batch ends. Batches can be nested.
+    virtual void beginVolumeBatch() {}
+    virtual void endVolumeBatch() {}
     virtual void changeRefCount(audio_stream_type_t stream, int delta);
 
     bool isActive(uint32_t inPastMs = 0) const;
@@ -118,6 +123,8 @@ public:
                            audio_devices_t device,
                            uint32_t delayMs,
                            bool force);
+    virtual void beginVolumeBatch();
+    virtual void endVolumeBatch();
 
     virtual void toAudioPortConfig(struct audio_port_config *dstConfig,
                            const struct audio_port_config *srcConfig = NULL) const;
@@ -132,6 +139,15 @@ public:
     uint32_t mDirectOpenCount; // number of clients using this output (direct outputs only)
     audio_session_t mDirectClientSession; // session id of the direct output client
     uint32_t mGlobalRefCount;  // non-stream-specific ref count
+
+private:
+    void sendVolume(audio_stream_type_t stream, float volume, uint32_t delayMs);
+    void flushVolumeBatch();
+
+    uint32_t mVolumeBatchDepth;    // nesting level of beginVolumeBatch()
+    uint32_t mVolumeBatchDelayMs;  // delay of the volumes in the current batch
+    Vector<audio_stream_type_t> mVolumeBatchStreams; // streams with a pending volume
+    Vector<float> mVolumeBatchVolumes; // pending volumes, as amplitudes
 };
 
 // Audio output driven by an input device directly.
@@ -191,6 +207,10 @@ public:
     audio_devices_t getSupportedDevices(audio_io_handle_t handle) const;
 
     status_t dump(int fd) const;
+
+private:
+    // outputs found by getOutputFromId(), checked against the collection before use
+    mutable std::unordered_map<audio_port_handle_t, sp<SwAudioOutputDescriptor> > mIdIndex;
 };
 
 class HwAudioOutputCollection :
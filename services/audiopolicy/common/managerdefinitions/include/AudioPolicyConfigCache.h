@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "AudioPolicyConfig.h"
+#include <utils/Errors.h>
+#include <string>
+#include <vector>
+
+namespace android {
+
+/**
+ * Binary image of a configuration parsed by the PolicySerializer: the modules with their mix
+ * ports, device ports and routes, the attached and default devices, and the volume curves.
+ * Loading it avoids parsing the XML files at boot.
+ *
+ * The image records the size, modification time and a hash of each XML file it was built
+ * from, and is only used while all of them are unchanged.
+ */
+class AudioPolicyConfigCache
+{
+public:
+    // Fills config from the image in cachePath if it was built from configFile and is still
+    // up to date. config is left untouched on failure.
+    static status_t load(const char *cachePath, const char *configFile,
+                         AudioPolicyConfig &config);
+
+    // Writes config, which must have just been deserialized from sourceFiles (the main file
+    // first), to cachePath. Must be called before the policy manager modifies the config.
+    static status_t save(const char *cachePath, const std::vector<std::string> &sourceFiles,
+                         const AudioPolicyConfig &config);
+
+private:
+    static const uint32_t kMagic = 0x43435041;  // "APCC"
+    static const uint32_t kVersion = 1;         // increment when the layout changes
+};
+
+}; // namespace android
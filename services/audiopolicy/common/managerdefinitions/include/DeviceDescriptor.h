@@ -23,6 +23,7 @@
 #include <cutils/config_utils.h>
 #include <system/audio.h>
 #include <system/audio_policy.h>
+#include <unordered_map>
 
 namespace android {
 
@@ -68,6 +69,10 @@ class DeviceVector : public SortedVector<sp<DeviceDescriptor> >
 {
 public:
     DeviceVector() : SortedVector(), mDeviceTypes(AUDIO_DEVICE_NONE) {}
+    // the lookup indices are not copied: they are rebuilt on demand
+    DeviceVector(const DeviceVector &other) :
+        SortedVector(other), mDeviceTypes(other.mDeviceTypes) {}
+    DeviceVector &operator=(const DeviceVector &other);
 
     ssize_t add(const sp<DeviceDescriptor>& item);
     void add(const DeviceVector &devices);
@@ -88,7 +93,19 @@ public:
 
 private:
     void refreshTypes();
+    // returns true if device is still an element of this vector
+    bool contains(const sp<DeviceDescriptor>& device) const;
+    static uint64_t typeAddrKey(audio_devices_t type, const String8& address);
+
     audio_devices_t mDeviceTypes;
+
+    // Indices of the devices found by getDeviceFromId() and getDevice() with a non empty
+    // address. An entry is only a hint: it is checked against the vector and the device
+    // before being returned, so that the indices stay correct when the vector is modified
+    // through the SortedVector methods or when a device ID is assigned after insertion.
+    // They are cleared whenever a device is added or removed.
+    mutable std::unordered_map<audio_port_handle_t, sp<DeviceDescriptor> > mIdIndex;
+    mutable std::unordered_map<uint64_t, sp<DeviceDescriptor> > mTypeAddrIndex;
 };
 
 }; // namespace android
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <RoutingStrategy.h>
+#include <system/audio.h>
+#include <utils/Errors.h>
+#include <utils/KeyedVector.h>
+
+namespace android {
+
+/**
+ * Remembers the device and the mixed output selected for a playback request, so that
+ * creating many tracks with the same attributes does not query the engine and scan the
+ * outputs every time.
+ * The owner must invalidate the cache whenever anything the selection depends upon changes,
+ * and must only use it for requests which are not explicitly routed.
+ */
+class RoutingCache
+{
+public:
+    RoutingCache()
+        : mHits(0), mMisses(0), mBypasses(0), mInvalidations(0) {}
+
+    // Returns true and sets device and output if the request was seen since the last
+    // invalidation.
+    bool lookup(routing_strategy strategy, audio_stream_type_t stream,
+                audio_output_flags_t flags, audio_format_t format,
+                audio_devices_t *device, audio_io_handle_t *output);
+
+    void add(routing_strategy strategy, audio_stream_type_t stream,
+             audio_output_flags_t flags, audio_format_t format,
+             audio_devices_t device, audio_io_handle_t output);
+
+    // Counts a request that could not use the cache.
+    void bypass() { mBypasses++; }
+
+    void invalidate();
+
+    status_t dump(int fd) const;
+
+private:
+    static const size_t kMaxEntries = 64;
+
+    struct Key {
+        routing_strategy mStrategy;
+        audio_stream_type_t mStream;
+        audio_output_flags_t mFlags;
+        audio_format_t mFormat;
+
+        bool operator<(const Key& other) const;
+    };
+
+    struct Entry {
+        audio_devices_t mDevice;
+        audio_io_handle_t mOutput;
+    };
+
+    KeyedVector<Key, Entry> mEntries;
+    uint32_t mHits;
+    uint32_t mMisses;
+    uint32_t mBypasses;
+    uint32_t mInvalidations;
+};
+
+}; // namespace android
@@ -21,6 +21,7 @@
 #include <utils/Errors.h>
 #include <utils/RefBase.h>
 #include <string>
+#include <vector>
 #include <sstream>
 #include <fstream>
 
@@ -225,11 +226,16 @@ public:
     PolicySerializer();
     status_t deserialize(const char *str, AudioPolicyConfig &config);
 
+    // Files the last deserialized configuration was read from: the main file first,
+    // followed by the files it includes.
+    const std::vector<std::string> &getSourceFiles() const { return mSourceFiles; }
+
 private:
     typedef AudioPolicyConfig Element;
 
     std::string mRootElementName;
     std::string mVersion;
+    std::vector<std::string> mSourceFiles;
 
     // Children are: ModulesTraits, VolumeTraits
 };
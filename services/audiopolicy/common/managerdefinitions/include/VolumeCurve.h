@@ -56,6 +56,7 @@ public:
     audio_stream_type_t getStreamType() const { return mStreamType; }
 
     void add(const CurvePoint &point) { mCurvePoints.add(point); }
+    const SortedVector<CurvePoint> &getCurvePoints() const { return mCurvePoints; }
 
     float volIndexToDb(int indexInUi, int volIndexMin, int volIndexMax) const;
 
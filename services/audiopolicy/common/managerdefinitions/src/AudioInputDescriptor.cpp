@@ -229,14 +229,28 @@ bool AudioInputCollection::isSourceActive(audio_source_t source) const
 
 sp<AudioInputDescriptor> AudioInputCollection::getInputFromId(audio_port_handle_t id) const
 {
-    sp<AudioInputDescriptor> inputDesc = NULL;
+    // see SwAudioOutputCollection::getOutputFromId()
+    auto it = mIdIndex.find(id);
+    if (it != mIdIndex.end()) {
+        const sp<AudioInputDescriptor> &inputDesc = it->second;
+        ssize_t index = indexOfKey(inputDesc->mIoHandle);
+        if (index >= 0 && valueAt(index) == inputDesc && inputDesc->getId() == id) {
+            return inputDesc;
+        }
+        mIdIndex.erase(it);
+    }
     for (size_t i = 0; i < size(); i++) {
-        inputDesc = valueAt(i);
+        const sp<AudioInputDescriptor> &inputDesc = valueAt(i);
         if (inputDesc->getId() == id) {
-            break;
+            if (mIdIndex.size() >= size()) {
+                // some entries are stale: do not keep closed descriptors alive
+                mIdIndex.clear();
+            }
+            mIdIndex[id] = inputDesc;
+            return inputDesc;
         }
     }
-    return inputDesc;
+    return NULL;
 }
 
 uint32_t AudioInputCollection::activeInputsCountOnDevices(audio_devices_t devices) const
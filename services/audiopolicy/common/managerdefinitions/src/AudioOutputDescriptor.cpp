@@ -224,7 +224,8 @@ SwAudioOutputDescriptor::SwAudioOutputDescriptor(const sp<IOProfile>& profile,
     mProfile(profile), mLatency(0),
     mFlags((audio_output_flags_t)0), mPolicyMix(NULL),
     mOutput1(0), mOutput2(0), mDirectOpenCount(0),
-    mDirectClientSession(AUDIO_SESSION_NONE), mGlobalRefCount(0)
+    mDirectClientSession(AUDIO_SESSION_NONE), mGlobalRefCount(0),
+    mVolumeBatchDepth(0), mVolumeBatchDelayMs(0)
 {
     if (profile != NULL) {
         mFlags = (audio_output_flags_t)profile->getFlags();
@@ -379,14 +380,62 @@ bool SwAudioOutputDescriptor::setVolume(float volume,
         // enabled
         float volume = Volume::DbToAmpl(mCurVolume[stream]);
         if (stream == AUDIO_STREAM_BLUETOOTH_SCO) {
-            mClientInterface->setStreamVolume(
-                    AUDIO_STREAM_VOICE_CALL, volume, mIoHandle, delayMs);
+            sendVolume(AUDIO_STREAM_VOICE_CALL, volume, delayMs);
         }
-        mClientInterface->setStreamVolume(stream, volume, mIoHandle, delayMs);
+        sendVolume(stream, volume, delayMs);
     }
     return changed;
 }
 
+void SwAudioOutputDescriptor::beginVolumeBatch()
+{
+    mVolumeBatchDepth++;
+}
+
+void SwAudioOutputDescriptor::endVolumeBatch()
+{
+    ALOG_ASSERT(mVolumeBatchDepth > 0, "endVolumeBatch() without beginVolumeBatch()");
+    if (mVolumeBatchDepth > 0 && --mVolumeBatchDepth == 0) {
+        flushVolumeBatch();
+    }
+}
+
+void SwAudioOutputDescriptor::sendVolume(audio_stream_type_t stream,
+                                         float volume,
+                                         uint32_t delayMs)
+{
+    if (mVolumeBatchDepth == 0) {
+        mClientInterface->setStreamVolume(stream, volume, mIoHandle, delayMs);
+        return;
+    }
+    // a batch is sent with a single delay
+    if (mVolumeBatchStreams.size() != 0 && delayMs != mVolumeBatchDelayMs) {
+        flushVolumeBatch();
+    }
+    mVolumeBatchDelayMs = delayMs;
+    for (size_t i = 0; i < mVolumeBatchStreams.size(); i++) {
+        if (mVolumeBatchStreams[i] == stream) {
+            mVolumeBatchVolumes.editItemAt(i) = volume;
+            return;
+        }
+    }
+    mVolumeBatchStreams.add(stream);
+    mVolumeBatchVolumes.add(volume);
+}
+
+void SwAudioOutputDescriptor::flushVolumeBatch()
+{
+    if (mVolumeBatchStreams.size() == 1) {
+        mClientInterface->setStreamVolume(mVolumeBatchStreams[0], mVolumeBatchVolumes[0],
+                                          mIoHandle, mVolumeBatchDelayMs);
+    } else if (mVolumeBatchStreams.size() > 1) {
+        mClientInterface->setStreamVolumes(mVolumeBatchStreams, mVolumeBatchVolumes,
+                                           mIoHandle, mVolumeBatchDelayMs);
+    }
+    mVolumeBatchStreams.clear();
+    mVolumeBatchVolumes.clear();
+}
+
 // HwAudioOutputDescriptor implementation
 HwAudioOutputDescriptor::HwAudioOutputDescriptor(const sp<AudioSourceDescriptor>& source,
                                                  AudioPolicyClientInterface *clientInterface)
@@ -499,14 +548,29 @@ sp<SwAudioOutputDescriptor> SwAudioOutputCollection::getPrimaryOutput() const
 
 sp<SwAudioOutputDescriptor> SwAudioOutputCollection::getOutputFromId(audio_port_handle_t id) const
 {
-    sp<SwAudioOutputDescriptor> outputDesc = NULL;
+    // outputs are added and removed with the KeyedVector methods, so an indexed output is
+    // only returned if it is still the one registered for its I/O handle
+    auto it = mIdIndex.find(id);
+    if (it != mIdIndex.end()) {
+        const sp<SwAudioOutputDescriptor> &outputDesc = it->second;
+        ssize_t index = indexOfKey(outputDesc->mIoHandle);
+        if (index >= 0 && valueAt(index) == outputDesc && outputDesc->getId() == id) {
+            return outputDesc;
+        }
+        mIdIndex.erase(it);
+    }
     for (size_t i = 0; i < size(); i++) {
-        outputDesc = valueAt(i);
+        const sp<SwAudioOutputDescriptor> &outputDesc = valueAt(i);
         if (outputDesc->getId() == id) {
-            break;
+            if (mIdIndex.size() >= size()) {
+                // some entries are stale: do not keep closed descriptors alive
+                mIdIndex.clear();
+            }
+            mIdIndex[id] = outputDesc;
+            return outputDesc;
         }
     }
-    return outputDesc;
+    return NULL;
 }
 
 bool SwAudioOutputCollection::isAnyOutputActive(audio_stream_type_t streamToIgnore) const
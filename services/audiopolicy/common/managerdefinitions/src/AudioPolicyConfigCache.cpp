@@ -0,0 +1,645 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "APM::AudioPolicyConfigCache"
+//#define LOG_NDEBUG 0
+
+#include "AudioPolicyConfigCache.h"
+#include "AudioGain.h"
+#include <utils/Log.h>
+#include <utils/String8.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace android {
+
+namespace {
+
+// Image layout: a fixed header followed by the payload. All values are in host byte order,
+// strings and collections are preceded by their length.
+struct CacheHeader {
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mPayloadSize;
+    uint32_t mReserved;
+    uint64_t mPayloadHash;
+};
+
+// FNV-1a
+const uint64_t kHashSeed = 14695981039346656037ULL;
+
+uint64_t hashBytes(const uint8_t *data, size_t size, uint64_t hash = kHashSeed)
+{
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+struct SourceFileInfo {
+    int64_t mSize;
+    int64_t mMtimeSec;
+    int64_t mMtimeNsec;
+    uint64_t mHash;
+};
+
+status_t getSourceFileInfo(const char *path, SourceFileInfo &info)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NAME_NOT_FOUND;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NAME_NOT_FOUND;
+    }
+    info.mSize = st.st_size;
+    info.mMtimeSec = st.st_mtim.tv_sec;
+    info.mMtimeNsec = st.st_mtim.tv_nsec;
+    info.mHash = kHashSeed;
+    uint8_t buffer[4096];
+    ssize_t count;
+    while ((count = read(fd, buffer, sizeof(buffer))) > 0) {
+        info.mHash = hashBytes(buffer, count, info.mHash);
+    }
+    close(fd);
+    return count < 0 ? INVALID_OPERATION : NO_ERROR;
+}
+
+class CacheWriter
+{
+public:
+    void writeU32(uint32_t value) { append(&value, sizeof(value)); }
+    void writeI64(int64_t value) { append(&value, sizeof(value)); }
+    void writeU64(uint64_t value) { append(&value, sizeof(value)); }
+    void writeString(const char *str)
+    {
+        uint32_t length = strlen(str);
+        writeU32(length);
+        append(str, length);
+    }
+
+    const std::vector<uint8_t> &data() const { return mData; }
+
+private:
+    void append(const void *data, size_t size)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        mData.insert(mData.end(), bytes, bytes + size);
+    }
+
+    std::vector<uint8_t> mData;
+};
+
+// Any read past the end of the image sets an error and returns zeroes.
+class CacheReader
+{
+public:
+    CacheReader(const uint8_t *data, size_t size)
+        : mData(data), mSize(size), mPos(0), mError(false) {}
+
+    uint32_t readU32() { uint32_t value = 0; read(&value, sizeof(value)); return value; }
+    int64_t readI64() { int64_t value = 0; read(&value, sizeof(value)); return value; }
+    uint64_t readU64() { uint64_t value = 0; read(&value, sizeof(value)); return value; }
+
+    // Rejects counts which could not fit in the remaining data, so a corrupted count
+    // does not cause a huge allocation.
+    uint32_t readCount()
+    {
+        uint32_t count = readU32();
+        if (count > mSize - mPos) {
+            mError = true;
+            return 0;
+        }
+        return count;
+    }
+
+    String8 readString()
+    {
+        uint32_t length = readCount();
+        if (mError) {
+            return String8();
+        }
+        String8 str(reinterpret_cast<const char *>(mData + mPos), length);
+        mPos += length;
+        return str;
+    }
+
+    bool hasError() const { return mError; }
+    bool isAtEnd() const { return mPos == mSize; }
+
+private:
+    void read(void *value, size_t size)
+    {
+        if (mError || size > mSize - mPos) {
+            mError = true;
+            return;
+        }
+        memcpy(value, mData + mPos, size);
+        mPos += size;
+    }
+
+    const uint8_t *mData;
+    const size_t mSize;
+    size_t mPos;
+    bool mError;
+};
+
+enum {
+    DYNAMIC_FORMAT = 0x1,
+    DYNAMIC_CHANNELS = 0x2,
+    DYNAMIC_RATE = 0x4,
+};
+
+void writeProfiles(CacheWriter &writer, const AudioProfileVector &profiles)
+{
+    writer.writeU32(profiles.size());
+    for (size_t i = 0; i < profiles.size(); i++) {
+        const sp<AudioProfile> &profile = profiles[i];
+        writer.writeU32(profile->getFormat());
+        const ChannelsVector &channels = profile->getChannels();
+        writer.writeU32(channels.size());
+        for (size_t j = 0; j < channels.size(); j++) {
+            writer.writeU32(channels[j]);
+        }
+        const SampleRateVector &rates = profile->getSampleRates();
+        writer.writeU32(rates.size());
+        for (size_t j = 0; j < rates.size(); j++) {
+            writer.writeU32(rates[j]);
+        }
+        writer.writeU32((profile->isDynamicFormat() ? DYNAMIC_FORMAT : 0) |
+                        (profile->isDynamicChannels() ? DYNAMIC_CHANNELS : 0) |
+                        (profile->isDynamicRate() ? DYNAMIC_RATE : 0));
+    }
+}
+
+AudioProfileVector readProfiles(CacheReader &reader)
+{
+    AudioProfileVector profiles;
+    uint32_t count = reader.readCount();
+    for (uint32_t i = 0; i < count && !reader.hasError(); i++) {
+        audio_format_t format = (audio_format_t)reader.readU32();
+        ChannelsVector channels;
+        uint32_t channelCount = reader.readCount();
+        for (uint32_t j = 0; j < channelCount; j++) {
+            channels.add((audio_channel_mask_t)reader.readU32());
+        }
+        SampleRateVector rates;
+        uint32_t rateCount = reader.readCount();
+        for (uint32_t j = 0; j < rateCount; j++) {
+            rates.add(reader.readU32());
+        }
+        uint32_t dynamic = reader.readU32();
+        sp<AudioProfile> profile = new AudioProfile(format, channels, rates);
+        profile->setDynamicFormat((dynamic & DYNAMIC_FORMAT) != 0);
+        profile->setDynamicChannels((dynamic & DYNAMIC_CHANNELS) != 0);
+        profile->setDynamicRate((dynamic & DYNAMIC_RATE) != 0);
+        profiles.add(profile);
+    }
+    return profiles;
+}
+
+void writeGains(CacheWriter &writer, const AudioGainCollection &gains)
+{
+    writer.writeU32(gains.size());
+    for (size_t i = 0; i < gains.size(); i++) {
+        const struct audio_gain &gain = gains[i]->getGain();
+        writer.writeU32(gains[i]->getIndex());
+        writer.writeU32(gains[i]->useInChannelMask());
+        writer.writeU32(gain.mode);
+        writer.writeU32(gain.channel_mask);
+        writer.writeU32(gain.min_value);
+        writer.writeU32(gain.max_value);
+        writer.writeU32(gain.default_value);
+        writer.writeU32(gain.step_value);
+        writer.writeU32(gain.min_ramp_ms);
+        writer.writeU32(gain.max_ramp_ms);
+    }
+}
+
+AudioGainCollection readGains(CacheReader &reader)
+{
+    AudioGainCollection gains;
+    uint32_t count = reader.readCount();
+    for (uint32_t i = 0; i < count && !reader.hasError(); i++) {
+        int index = reader.readU32();
+        bool useInChannelMask = reader.readU32() != 0;
+        sp<AudioGain> gain = new AudioGain(index, useInChannelMask);
+        gain->setMode((audio_gain_mode_t)reader.readU32());
+        gain->setChannelMask((audio_channel_mask_t)reader.readU32());
+        gain->setMinValueInMb(reader.readU32());
+        gain->setMaxValueInMb(reader.readU32());
+        gain->setDefaultValueInMb(reader.readU32());
+        gain->setStepValueInMb(reader.readU32());
+        gain->setMinRampInMs(reader.readU32());
+        gain->setMaxRampInMs(reader.readU32());
+        gains.add(gain);
+    }
+    return gains;
+}
+
+// Devices are referred to by module and tag name: unlike indexes in a DeviceVector, which is
+// sorted by address, these are stable from one boot to the next.
+status_t writeDeviceRef(CacheWriter &writer, const HwModuleCollection &modules,
+                        const sp<DeviceDescriptor> &device)
+{
+    for (size_t i = 0; i < modules.size(); i++) {
+        if (modules[i]->getDeclaredDevices().indexOf(device) >= 0) {
+            writer.writeU32(i);
+            writer.writeString(device->getTagName().string());
+            return NO_ERROR;
+        }
+    }
+    ALOGW("%s: device %08x is not declared by any module", __FUNCTION__, device->type());
+    return BAD_VALUE;
+}
+
+sp<DeviceDescriptor> readDeviceRef(CacheReader &reader, const HwModuleCollection &modules)
+{
+    uint32_t moduleIndex = reader.readU32();
+    String8 tagName = reader.readString();
+    if (reader.hasError() || moduleIndex >= modules.size()) {
+        return 0;
+    }
+    return modules[moduleIndex]->getDeclaredDevices().getDeviceFromTagName(tagName);
+}
+
+status_t writeModule(CacheWriter &writer, const sp<HwModule> &module)
+{
+    writer.writeString(module->getName());
+    writer.writeU32(module->getHalVersionMajor());
+    writer.writeU32(module->getHalVersionMinor());
+
+    // The module keeps output and input mix ports apart, they are written in this order.
+    const IOProfileCollection *mixPortLists[] = {
+        &module->getOutputProfiles(), &module->getInputProfiles()
+    };
+    writer.writeU32(mixPortLists[0]->size() + mixPortLists[1]->size());
+    for (const IOProfileCollection *mixPorts : mixPortLists) {
+        for (size_t i = 0; i < mixPorts->size(); i++) {
+            const sp<IOProfile> &mixPort = mixPorts->itemAt(i);
+            writer.writeString(mixPort->getName().string());
+            writer.writeU32(mixPort->getRole());
+            writer.writeU32(mixPort->getFlags());
+            writeProfiles(writer, mixPort->getAudioProfiles());
+            writeGains(writer, mixPort->getGains());
+        }
+    }
+
+    const DeviceVector &devices = module->getDeclaredDevices();
+    writer.writeU32(devices.size());
+    for (size_t i = 0; i < devices.size(); i++) {
+        const sp<DeviceDescriptor> &device = devices[i];
+        writer.writeU32(device->type());
+        writer.writeString(device->getTagName().string());
+        writer.writeString(device->mAddress.string());
+        writeProfiles(writer, device->getAudioProfiles());
+        writeGains(writer, device->mGains);
+    }
+
+    const AudioRouteVector &routes = module->getRoutes();
+    writer.writeU32(routes.size());
+    for (size_t i = 0; i < routes.size(); i++) {
+        const sp<AudioRoute> &route = routes[i];
+        if (route->getSink() == 0) {
+            return BAD_VALUE;
+        }
+        writer.writeU32(route->getType());
+        writer.writeString(route->getSink()->getTagName().string());
+        const AudioPortVector &sources = route->getSources();
+        writer.writeU32(sources.size());
+        for (size_t j = 0; j < sources.size(); j++) {
+            writer.writeString(sources[j]->getTagName().string());
+        }
+    }
+    return NO_ERROR;
+}
+
+// Builds the module the same way ModuleTraits::deserialize() does.
+sp<HwModule> readModule(CacheReader &reader)
+{
+    String8 name = reader.readString();
+    uint32_t versionMajor = reader.readU32();
+    uint32_t versionMinor = reader.readU32();
+    if (reader.hasError()) {
+        return 0;
+    }
+    sp<HwModule> module = new HwModule(name.string(), versionMajor, versionMinor);
+
+    IOProfileCollection mixPorts;
+    uint32_t count = reader.readCount();
+    for (uint32_t i = 0; i < count && !reader.hasError(); i++) {
+        String8 portName = reader.readString();
+        audio_port_role_t role = (audio_port_role_t)reader.readU32();
+        sp<IOProfile> mixPort = new IOProfile(portName, role);
+        mixPort->setFlags(reader.readU32());
+        mixPort->setAudioProfiles(readProfiles(reader));
+        mixPort->setGains(readGains(reader));
+        mixPorts.add(mixPort);
+    }
+    module->setProfiles(mixPorts);
+
+    DeviceVector devices;
+    count = reader.readCount();
+    for (uint32_t i = 0; i < count && !reader.hasError(); i++) {
+        audio_devices_t type = reader.readU32();
+        String8 tagName = reader.readString();
+        sp<DeviceDescriptor> device = new DeviceDescriptor(type, tagName);
+        device->mAddress = reader.readString();
+        device->setAudioProfiles(readProfiles(reader));
+        device->mGains = readGains(reader);
+        devices.add(device);
+    }
+    module->setDeclaredDevices(devices);
+
+    AudioRouteVector routes;
+    count = reader.readCount();
+    for (uint32_t i = 0; i < count && !reader.hasError(); i++) {
+        sp<AudioRoute> route = new AudioRoute((audio_route_type_t)reader.readU32());
+        sp<AudioPort> sink = module->findPortByTagName(reader.readString());
+        if (sink == 0) {
+            return 0;
+        }
+        route->setSink(sink);
+        AudioPortVector sources;
+        uint32_t sourceCount = reader.readCount();
+        for (uint32_t j = 0; j < sourceCount; j++) {
+            sp<AudioPort> source = module->findPortByTagName(reader.readString());
+            if (source == 0) {
+                return 0;
+            }
+            sources.add(source);
+        }
+        sink->addRoute(route);
+        for (size_t j = 0; j < sources.size(); j++) {
+            sources[j]->addRoute(route);
+        }
+        route->setSources(sources);
+        routes.add(route);
+    }
+    module->setRoutes(routes);
+
+    return reader.hasError() ? 0 : module;
+}
+
+} // anonymous namespace
+
+// static
+status_t AudioPolicyConfigCache::save(const char *cachePath,
+                                      const std::vector<std::string> &sourceFiles,
+                                      const AudioPolicyConfig &config)
+{
+    if (sourceFiles.empty()) {
+        return BAD_VALUE;
+    }
+    CacheWriter writer;
+
+    writer.writeU32(sourceFiles.size());
+    for (const std::string &sourceFile : sourceFiles) {
+        SourceFileInfo info;
+        status_t status = getSourceFileInfo(sourceFile.c_str(), info);
+        if (status != NO_ERROR) {
+            ALOGW("%s: cannot read %s", __FUNCTION__, sourceFile.c_str());
+            return status;
+        }
+        writer.writeString(sourceFile.c_str());
+        writer.writeI64(info.mSize);
+        writer.writeI64(info.mMtimeSec);
+        writer.writeI64(info.mMtimeNsec);
+        writer.writeU64(info.mHash);
+    }
+
+    writer.writeU32(config.isSpeakerDrcEnabled());
+
+    const HwModuleCollection modules = config.getHwModules();
+    writer.writeU32(modules.size());
+    for (size_t i = 0; i < modules.size(); i++) {
+        status_t status = writeModule(writer, modules[i]);
+        if (status != NO_ERROR) {
+            return status;
+        }
+    }
+
+    const DeviceVector *availableDeviceLists[] = {
+        &config.getAvailableOutputDevices(), &config.getAvailableInputDevices()
+    };
+    writer.writeU32(availableDeviceLists[0]->size() + availableDeviceLists[1]->size());
+    for (const DeviceVector *availableDevices : availableDeviceLists) {
+        for (size_t i = 0; i < availableDevices->size(); i++) {
+            status_t status = writeDeviceRef(writer, modules, availableDevices->itemAt(i));
+            if (status != NO_ERROR) {
+                return status;
+            }
+        }
+    }
+
+    const sp<DeviceDescriptor> &defaultOutputDevice = config.getDefaultOutputDevice();
+    writer.writeU32(defaultOutputDevice != 0);
+    if (defaultOutputDevice != 0) {
+        status_t status = writeDeviceRef(writer, modules, defaultOutputDevice);
+        if (status != NO_ERROR) {
+            return status;
+        }
+    }
+
+    Vector<sp<VolumeCurve> > curves;
+    const VolumeCurvesCollection *volumes = config.getVolumes();
+    for (size_t i = 0; volumes != nullptr && i < volumes->size(); i++) {
+        const VolumeCurvesForStream &curvesForStream = volumes->valueAt(i);
+        for (size_t j = 0; j < curvesForStream.size(); j++) {
+            curves.add(curvesForStream.valueAt(j));
+        }
+    }
+    writer.writeU32(curves.size());
+    for (size_t i = 0; i < curves.size(); i++) {
+        writer.writeU32(curves[i]->getStreamType());
+        writer.writeU32(curves[i]->getDeviceCategory());
+        const SortedVector<CurvePoint> &points = curves[i]->getCurvePoints();
+        writer.writeU32(points.size());
+        for (size_t j = 0; j < points.size(); j++) {
+            writer.writeU32(points[j].mIndex);
+            writer.writeU32(points[j].mAttenuationInMb);
+        }
+    }
+
+    const std::vector<uint8_t> &payload = writer.data();
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.mMagic = kMagic;
+    header.mVersion = kVersion;
+    header.mPayloadSize = payload.size();
+    header.mPayloadHash = hashBytes(payload.data(), payload.size());
+
+    // write a temporary file and rename it, so that a reader never sees a partial image
+    std::string tmpPath = std::string(cachePath) + ".tmp";
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        ALOGW("%s: cannot create %s: %s", __FUNCTION__, tmpPath.c_str(), strerror(errno));
+        return INVALID_OPERATION;
+    }
+    bool written = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+            write(fd, payload.data(), payload.size()) == (ssize_t)payload.size() &&
+            fsync(fd) == 0;
+    close(fd);
+    if (!written || rename(tmpPath.c_str(), cachePath) != 0) {
+        ALOGW("%s: cannot write %s: %s", __FUNCTION__, cachePath, strerror(errno));
+        unlink(tmpPath.c_str());
+        return INVALID_OPERATION;
+    }
+    ALOGV("%s: wrote %zu bytes to %s", __FUNCTION__, sizeof(header) + payload.size(), cachePath);
+    return NO_ERROR;
+}
+
+// static
+status_t AudioPolicyConfigCache::load(const char *cachePath, const char *configFile,
+                                      AudioPolicyConfig &config)
+{
+    int fd = open(cachePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NAME_NOT_FOUND;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CacheHeader)) {
+        close(fd);
+        return BAD_VALUE;
+    }
+    size_t size = st.st_size;
+    void *image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        return NO_MEMORY;
+    }
+
+    status_t status = BAD_VALUE;
+    const uint8_t *data = static_cast<const uint8_t *>(image);
+    CacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    const uint8_t *payload = data + sizeof(header);
+
+    HwModuleCollection modules;
+    DeviceVector availableDevices;
+    sp<DeviceDescriptor> defaultOutputDevice;
+    VolumeCurvesCollection volumes;
+    bool speakerDrcEnabled = false;
+
+    if (header.mMagic != kMagic || header.mVersion != kVersion ||
+            header.mPayloadSize != size - sizeof(header) ||
+            header.mPayloadHash != hashBytes(payload, header.mPayloadSize)) {
+        ALOGW("%s: ignoring invalid %s", __FUNCTION__, cachePath);
+        goto exit;
+    }
+
+    {
+        CacheReader reader(payload, header.mPayloadSize);
+
+        uint32_t count = reader.readCount();
+        for (uint32_t i = 0; i < count; i++) {
+            String8 sourceFile = reader.readString();
+            SourceFileInfo cached;
+            cached.mSize = reader.readI64();
+            cached.mMtimeSec = reader.readI64();
+            cached.mMtimeNsec = reader.readI64();
+            cached.mHash = reader.readU64();
+            SourceFileInfo current;
+            if (reader.hasError() || (i == 0 && strcmp(sourceFile.string(), configFile) != 0)) {
+                goto exit;
+            }
+            if (getSourceFileInfo(sourceFile.string(), current) != NO_ERROR ||
+                    current.mSize != cached.mSize ||
+                    current.mMtimeSec != cached.mMtimeSec ||
+                    current.mMtimeNsec != cached.mMtimeNsec ||
+                    current.mHash != cached.mHash) {
+                ALOGV("%s: %s has changed", __FUNCTION__, sourceFile.string());
+                goto exit;
+            }
+        }
+        if (count == 0) {
+            goto exit;
+        }
+
+        speakerDrcEnabled = reader.readU32() != 0;
+
+        count = reader.readCount();
+        for (uint32_t i = 0; i < count; i++) {
+            sp<HwModule> module = readModule(reader);
+            if (module == 0) {
+                goto exit;
+            }
+            modules.add(module);
+        }
+
+        count = reader.readCount();
+        for (uint32_t i = 0; i < count; i++) {
+            sp<DeviceDescriptor> device = readDeviceRef(reader, modules);
+            if (device == 0) {
+                goto exit;
+            }
+            availableDevices.add(device);
+        }
+
+        if (reader.readU32() != 0) {
+            defaultOutputDevice = readDeviceRef(reader, modules);
+            if (defaultOutputDevice == 0) {
+                goto exit;
+            }
+        }
+
+        count = reader.readCount();
+        for (uint32_t i = 0; i < count && !reader.hasError(); i++) {
+            audio_stream_type_t stream = (audio_stream_type_t)reader.readU32();
+            device_category category = (device_category)reader.readU32();
+            if (stream >= AUDIO_STREAM_CNT || category >= DEVICE_CATEGORY_CNT) {
+                goto exit;
+            }
+            sp<VolumeCurve> curve = new VolumeCurve(category, stream);
+            uint32_t pointCount = reader.readCount();
+            for (uint32_t j = 0; j < pointCount; j++) {
+                uint32_t index = reader.readU32();
+                int attenuationInMb = (int32_t)reader.readU32();
+                curve->add(CurvePoint(index, attenuationInMb));
+            }
+            volumes.add(curve);
+        }
+
+        if (reader.hasError() || !reader.isAtEnd()) {
+            goto exit;
+        }
+    }
+
+    config.setHwModules(modules);
+    for (size_t i = 0; i < availableDevices.size(); i++) {
+        config.addAvailableDevice(availableDevices[i]);
+    }
+    if (defaultOutputDevice != 0) {
+        config.setDefaultOutputDevice(defaultOutputDevice);
+    }
+    config.setVolumes(volumes);
+    config.setSpeakerDrcEnabled(speakerDrcEnabled);
+    ALOGV("%s: loaded %s from %s", __FUNCTION__, configFile, cachePath);
+    status = NO_ERROR;
+
+exit:
+    munmap(image, size);
+    return status;
+}
+
+}; // namespace android
@@ -57,8 +57,21 @@ bool DeviceDescriptor::equals(const sp<DeviceDescriptor>& other) const
     return (mDeviceType == other->mDeviceType) && (mAddress == other->mAddress);
 }
 
+DeviceVector &DeviceVector::operator=(const DeviceVector &other)
+{
+    if (this != &other) {
+        SortedVector::operator=(other);
+        mDeviceTypes = other.mDeviceTypes;
+        mIdIndex.clear();
+        mTypeAddrIndex.clear();
+    }
+    return *this;
+}
+
 void DeviceVector::refreshTypes()
 {
+    mIdIndex.clear();
+    mTypeAddrIndex.clear();
     mDeviceTypes = AUDIO_DEVICE_NONE;
     for(size_t i = 0; i < size(); i++) {
         mDeviceTypes |= itemAt(i)->type();
@@ -128,9 +141,40 @@ audio_devices_t DeviceVector::getDevicesFromHwModule(audio_module_handle_t modul
     return devices;
 }
 
+bool DeviceVector::contains(const sp<DeviceDescriptor>& device) const
+{
+    // SortedVector::indexOf() is a binary search on the pointer, unlike indexOf() which
+    // compares the type and address of each device
+    return SortedVector::indexOf(device) >= 0;
+}
+
+uint64_t DeviceVector::typeAddrKey(audio_devices_t type, const String8& address)
+{
+    // FNV-1a hash of the address, combined with the device type
+    uint32_t hash = 2166136261u;
+    for (const char *c = address.string(); *c != '\0'; c++) {
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+    }
+    return ((uint64_t)type << 32) | hash;
+}
+
 sp<DeviceDescriptor> DeviceVector::getDevice(audio_devices_t type, const String8& address) const
 {
     sp<DeviceDescriptor> device;
+    uint64_t key = 0;
+    if (address != "") {
+        // an exact match is unique as add() rejects devices with the same type and address
+        key = typeAddrKey(type, address);
+        auto it = mTypeAddrIndex.find(key);
+        if (it != mTypeAddrIndex.end()) {
+            device = it->second;
+            if (device->type() == type && device->mAddress == address && contains(device)) {
+                return device;
+            }
+            mTypeAddrIndex.erase(it);
+            device.clear();
+        }
+    }
     for (size_t i = 0; i < size(); i++) {
         if (itemAt(i)->type() == type) {
             if (address == "" || itemAt(i)->mAddress == address) {
@@ -141,6 +185,9 @@ sp<DeviceDescriptor> DeviceVector::getDevice(audio_devices_t type, const String8
             }
         }
     }
+    if (device != 0 && address != "" && device->mAddress == address) {
+        mTypeAddrIndex[key] = device;
+    }
     ALOGV("DeviceVector::getDevice() for type %08x address %s found %p",
           type, address.string(), device.get());
     return device;
@@ -149,12 +196,27 @@ sp<DeviceDescriptor> DeviceVector::getDevice(audio_devices_t type, const String8
 sp<DeviceDescriptor> DeviceVector::getDeviceFromId(audio_port_handle_t id) const
 {
     sp<DeviceDescriptor> device;
+    // devices which are not attached to a module all have the same ID and are not indexed
+    if (id != AUDIO_PORT_HANDLE_NONE) {
+        auto it = mIdIndex.find(id);
+        if (it != mIdIndex.end()) {
+            device = it->second;
+            if (device->getId() == id && contains(device)) {
+                return device;
+            }
+            mIdIndex.erase(it);
+            device.clear();
+        }
+    }
     for (size_t i = 0; i < size(); i++) {
         if (itemAt(i)->getId() == id) {
             device = itemAt(i);
             break;
         }
     }
+    if (device != 0 && id != AUDIO_PORT_HANDLE_NONE) {
+        mIdIndex[id] = device;
+    }
     return device;
 }
 
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "APM::RoutingCache"
+//#define LOG_NDEBUG 0
+
+#include "RoutingCache.h"
+#include <utils/Log.h>
+#include <utils/String8.h>
+
+namespace android {
+
+bool RoutingCache::Key::operator<(const Key& other) const
+{
+    if (mStrategy != other.mStrategy) {
+        return mStrategy < other.mStrategy;
+    }
+    if (mStream != other.mStream) {
+        return mStream < other.mStream;
+    }
+    if (mFlags != other.mFlags) {
+        return mFlags < other.mFlags;
+    }
+    return mFormat < other.mFormat;
+}
+
+bool RoutingCache::lookup(routing_strategy strategy, audio_stream_type_t stream,
+                          audio_output_flags_t flags, audio_format_t format,
+                          audio_devices_t *device, audio_io_handle_t *output)
+{
+    const Key key = { strategy, stream, flags, format };
+    ssize_t index = mEntries.indexOfKey(key);
+    if (index < 0) {
+        mMisses++;
+        return false;
+    }
+    mHits++;
+    *device = mEntries.valueAt(index).mDevice;
+    *output = mEntries.valueAt(index).mOutput;
+    return true;
+}
+
+void RoutingCache::add(routing_strategy strategy, audio_stream_type_t stream,
+                       audio_output_flags_t flags, audio_format_t format,
+                       audio_devices_t device, audio_io_handle_t output)
+{
+    if (mEntries.size() >= kMaxEntries) {
+        mEntries.clear();
+    }
+    const Key key = { strategy, stream, flags, format };
+    const Entry entry = { device, output };
+    mEntries.add(key, entry);
+}
+
+void RoutingCache::invalidate()
+{
+    if (mEntries.size() > 0) {
+        ALOGV("invalidate() %zu entries", mEntries.size());
+        mEntries.clear();
+        mInvalidations++;
+    }
+}
+
+status_t RoutingCache::dump(int fd) const
+{
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    String8 result;
+
+    snprintf(buffer, SIZE, "\nRouting cache: %zu entries\n", mEntries.size());
+    result.append(buffer);
+    snprintf(buffer, SIZE, " Hits %u, misses %u, bypasses %u, invalidations %u\n",
+             mHits, mMisses, mBypasses, mInvalidations);
+    result.append(buffer);
+    for (size_t i = 0; i < mEntries.size(); i++) {
+        const Key& key = mEntries.keyAt(i);
+        const Entry& entry = mEntries.valueAt(i);
+        snprintf(buffer, SIZE, "  strategy %d stream %d flags 0x%x format 0x%x:"
+                 " device 0x%x output %d\n", key.mStrategy, key.mStream, key.mFlags,
+                 key.mFormat, entry.mDevice, entry.mOutput);
+        result.append(buffer);
+    }
+    write(fd, result.string(), result.size());
+    return NO_ERROR;
+}
+
+}; //namespace android
@@ -22,6 +22,7 @@
 #include "TypeConverter.h"
 #include <libxml/parser.h>
 #include <libxml/xinclude.h>
+#include <libxml/uri.h>
 #include <string>
 #include <sstream>
 #include <istream>
@@ -577,6 +578,35 @@ status_t VolumeTraits::deserialize(_xmlDoc *doc, const _xmlNode *root, PtrElemen
     return NO_ERROR;
 }
 
+// XInclude processing leaves an XINCLUDE_START node where each file was included.
+static void collectIncludedFiles(xmlDocPtr doc, const xmlNode *cur, std::vector<string> &files)
+{
+    for (const xmlNode *node = cur; node != NULL; node = node->next) {
+        if (node->type == XML_ELEMENT_NODE) {
+            collectIncludedFiles(doc, node->xmlChildrenNode, files);
+            continue;
+        }
+        if (node->type != XML_XINCLUDE_START) {
+            continue;
+        }
+        // xmlGetProp() only accepts element nodes
+        for (const xmlAttr *attr = node->properties; attr != NULL; attr = attr->next) {
+            if (xmlStrcmp(attr->name, (const xmlChar *)"href")) {
+                continue;
+            }
+            xmlChar *href = xmlNodeListGetString(doc, attr->children, 1);
+            xmlChar *base = xmlNodeGetBase(doc, node);
+            xmlChar *uri = href != NULL ? xmlBuildURI(href, base) : NULL;
+            if (uri != NULL) {
+                files.push_back((const char *)uri);
+                xmlFree(uri);
+            }
+            xmlFree(base);
+            xmlFree(href);
+        }
+    }
+}
+
 PolicySerializer::PolicySerializer() : mRootElementName(rootName)
 {
     std::ostringstream oss;
@@ -602,6 +632,9 @@ status_t PolicySerializer::deserialize(const char *configFile, AudioPolicyConfig
     if (xmlXIncludeProcess(doc) < 0) {
          ALOGE("%s: libxml failed to resolve XIncludes on %s document.", __FUNCTION__, configFile);
     }
+    mSourceFiles.clear();
+    mSourceFiles.push_back(configFile);
+    collectIncludedFiles(doc, cur, mSourceFiles);
 
     if (xmlStrcmp(cur->name, (const xmlChar *) mRootElementName.c_str()))  {
         ALOGE("%s: No %s root element found in xml data %s.", __FUNCTION__, mRootElementName.c_str(),
@@ -26,6 +26,7 @@
 
 #define AUDIO_POLICY_XML_CONFIG_FILE_PATH_MAX_LENGTH 128
 #define AUDIO_POLICY_XML_CONFIG_FILE_NAME "audio_policy_configuration.xml"
+#define AUDIO_POLICY_CONFIG_CACHE_FILE "/data/misc/audioserver/audio_policy_configuration.cache"
 
 #include <inttypes.h>
 #include <math.h>
@@ -35,6 +36,7 @@
 #include <cutils/atomic.h>
 #include <cutils/properties.h>
 #include <utils/Log.h>
+#include <utils/Thread.h>
 #include <media/AudioParameter.h>
 #include <media/AudioPolicyHelper.h>
 #include <soundtrigger/SoundTrigger.h>
@@ -46,6 +48,9 @@
 #include <StreamDescriptor.h>
 #endif
 #include <Serializer.h>
+#ifdef USE_XML_AUDIO_POLICY_CONF
+#include <AudioPolicyConfigCache.h>
+#endif
 #include "TypeConverter.h"
 #include <policy.h>
 
@@ -827,12 +832,24 @@ status_t AudioPolicyManager::getOutputForAttr(const audio_attributes_t *attr,
     mOutputRoutes.addRoute(session, *stream, SessionRoute::SOURCE_TYPE_NA, deviceDesc, uid);
 
     routing_strategy strategy = (routing_strategy) getStrategyForAttr(&attributes);
-    audio_devices_t device = getDeviceForStrategy(strategy, false /*fromCache*/);
 
     if ((attributes.flags & AUDIO_FLAG_HW_AV_SYNC) != 0) {
         flags = (audio_output_flags_t)(flags | AUDIO_OUTPUT_FLAG_HW_AV_SYNC);
     }
 
+    const bool cacheable = isRoutingCacheable(strategy, flags, config);
+    audio_devices_t device;
+    if (cacheable && mRoutingCache.lookup(strategy, *stream, flags, config->format,
+                                          &device, output)) {
+        ALOGV("getOutputForAttr() cached device 0x%x, output %d", device, *output);
+        return NO_ERROR;
+    }
+    if (!cacheable) {
+        mRoutingCache.bypass();
+    }
+
+    device = getDeviceForStrategy(strategy, false /*fromCache*/);
+
     ALOGV("getOutputForAttr() device 0x%x, samplingRate %d, format %x, channelMask %x, flags %x",
           device, config->sample_rate, config->format, config->channel_mask, flags);
 
@@ -843,10 +860,52 @@ status_t AudioPolicyManager::getOutputForAttr(const audio_attributes_t *attr,
         mOutputRoutes.removeRoute(session);
         return INVALID_OPERATION;
     }
+    if (cacheable) {
+        mRoutingCache.add(strategy, *stream, flags, config->format, device, *output);
+    }
 
     return NO_ERROR;
 }
 
+bool AudioPolicyManager::hasActiveRouteForStrategy(routing_strategy strategy)
+{
+    for (size_t routeIndex = 0; routeIndex < mOutputRoutes.size(); routeIndex++) {
+        sp<SessionRoute> route = mOutputRoutes.valueAt(routeIndex);
+        if (route->isActive() && getStrategy(route->mStreamType) == strategy) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AudioPolicyManager::isRoutingCacheable(routing_strategy strategy,
+                                            audio_output_flags_t flags,
+                                            const audio_config_t *config)
+{
+    if (!mRoutingCacheEnabled) {
+        return false;
+    }
+    // The engine may choose the device of other strategies from the recent activity of the
+    // streams, which does not invalidate the cache. The media device only depends on the
+    // devices, outputs, phone state and forced usages.
+    if (strategy != STRATEGY_MEDIA || hasActiveRouteForStrategy(strategy)) {
+        return false;
+    }
+#ifdef AUDIO_POLICY_TEST
+    if (mCurOutput != 0) {
+        return false;
+    }
+#endif //AUDIO_POLICY_TEST
+    // Only requests that getOutputForDevice() sends straight to a mixed output:
+    // a direct output depends on the session, the effects and the opened direct outputs.
+    const audio_output_flags_t directFlags = (audio_output_flags_t)(AUDIO_OUTPUT_FLAG_DIRECT |
+            AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD | AUDIO_OUTPUT_FLAG_HW_AV_SYNC);
+    return (flags & directFlags) == 0 &&
+            audio_is_linear_pcm(config->format) &&
+            config->sample_rate <= SAMPLE_RATE_HZ_MAX &&
+            audio_channel_count_from_out_mask(config->channel_mask) <= 2;
+}
+
 audio_io_handle_t AudioPolicyManager::getOutputForDevice(
         audio_devices_t device,
         audio_session_t session,
@@ -2131,6 +2190,7 @@ status_t AudioPolicyManager::setStreamVolumeIndex(audio_stream_type_t stream,
     for (size_t i = 0; i < mOutputs.size(); i++) {
         sp<SwAudioOutputDescriptor> desc = mOutputs.valueAt(i);
         audio_devices_t curDevice = Volume::getDeviceForVolume(desc->device());
+        desc->beginVolumeBatch();
         for (int curStream = 0; curStream < AUDIO_STREAM_FOR_POLICY_CNT; curStream++) {
             if (!streamsMatchForvolume(stream, (audio_stream_type_t)curStream)) {
                 continue;
@@ -2166,6 +2226,7 @@ status_t AudioPolicyManager::setStreamVolumeIndex(audio_stream_type_t stream,
                 }
             }
         }
+        desc->endVolumeBatch();
     }
     return status;
 }
@@ -2334,6 +2395,7 @@ status_t AudioPolicyManager::registerPolicyMixes(const Vector<AudioMix>& mixes)
 {
     ALOGV("registerPolicyMixes() %zu mix(es)", mixes.size());
     status_t res = NO_ERROR;
+    mRoutingCache.invalidate();
 
     sp<HwModule> rSubmixModule;
     // examine each mix's route type
@@ -2437,6 +2499,7 @@ status_t AudioPolicyManager::unregisterPolicyMixes(Vector<AudioMix> mixes)
 {
     ALOGV("unregisterPolicyMixes() num mixes %zu", mixes.size());
     status_t res = NO_ERROR;
+    mRoutingCache.invalidate();
     sp<HwModule> rSubmixModule;
     // examine each mix's route type
     for (size_t i = 0; i < mixes.size(); i++) {
@@ -2538,6 +2601,7 @@ status_t AudioPolicyManager::dump(int fd)
     mEffects.dump(fd);
     mAudioPatches.dump(fd);
     mPolicyMixes.dump(fd);
+    mRoutingCache.dump(fd);
 
     return NO_ERROR;
 }
@@ -3429,6 +3493,8 @@ static const int kConfigLocationListSize =
 static status_t deserializeAudioPolicyXmlConfig(AudioPolicyConfig &config) {
     char audioPolicyXmlConfigFile[AUDIO_POLICY_XML_CONFIG_FILE_PATH_MAX_LENGTH];
     status_t ret;
+    // The binary cache of the parsed configuration avoids parsing the XML files at each boot.
+    bool useCache = property_get_bool("ro.audio.policy.config_cache", false /* default_value */);
 
     for (int i = 0; i < kConfigLocationListSize; i++) {
         PolicySerializer serializer;
@@ -3437,8 +3503,19 @@ static status_t deserializeAudioPolicyXmlConfig(AudioPolicyConfig &config) {
                  "%s/%s",
                  kConfigLocationList[i],
                  AUDIO_POLICY_XML_CONFIG_FILE_NAME);
+        // the cache only matches the file it was built from, so a configuration file added
+        // to a location which takes precedence is parsed
+        if (useCache && AudioPolicyConfigCache::load(AUDIO_POLICY_CONFIG_CACHE_FILE,
+                                                     audioPolicyXmlConfigFile,
+                                                     config) == NO_ERROR) {
+            return NO_ERROR;
+        }
         ret = serializer.deserialize(audioPolicyXmlConfigFile, config);
         if (ret == NO_ERROR) {
+            if (useCache) {
+                AudioPolicyConfigCache::save(AUDIO_POLICY_CONFIG_CACHE_FILE,
+                                             serializer.getSourceFiles(), config);
+            }
             break;
         }
     }
@@ -3446,6 +3523,220 @@ static status_t deserializeAudioPolicyXmlConfig(AudioPolicyConfig &config) {
 }
 #endif
 
+// Runs openModuleStreams() for one module, see the parallel initialization mode.
+class AudioPolicyManager::ModuleLoaderThread : public Thread
+{
+public:
+    ModuleLoaderThread(AudioPolicyManager *manager,
+                       const sp<HwModule>& module,
+                       audio_devices_t outputDeviceTypes,
+                       audio_devices_t inputDeviceTypes)
+        : Thread(false /*canCallJava*/),
+          mManager(manager), mModule(module),
+          mOutputDeviceTypes(outputDeviceTypes), mInputDeviceTypes(inputDeviceTypes) {}
+
+    // also called directly if the thread could not be started
+    void load()
+    {
+        mManager->openModuleStreams(mModule, mOutputDeviceTypes, mInputDeviceTypes, mStreams);
+    }
+
+    // only valid once the thread has been joined
+    const ModuleStreams& getStreams() const { return mStreams; }
+
+private:
+    virtual bool threadLoop()
+    {
+        load();
+        return false;
+    }
+
+    AudioPolicyManager * const mManager;
+    const sp<HwModule> mModule;
+    const audio_devices_t mOutputDeviceTypes;
+    const audio_devices_t mInputDeviceTypes;
+    ModuleStreams mStreams;
+};
+
+void AudioPolicyManager::openModuleStreams(const sp<HwModule>& module,
+                                           audio_devices_t outputDeviceTypes,
+                                           audio_devices_t inputDeviceTypes,
+                                           ModuleStreams& streams)
+{
+    module->mHandle = mpClientInterface->loadHwModule(module->getName());
+    if (module->mHandle == 0) {
+        return;
+    }
+    // open all output streams needed to access attached devices
+    // except for direct output streams that are only opened when they are actually
+    // required by an app.
+    // This also validates mAvailableOutputDevices list
+    for (size_t j = 0; j < module->mOutputProfiles.size(); j++)
+    {
+        const sp<IOProfile> outProfile = module->mOutputProfiles[j];
+
+        if (!outProfile->hasSupportedDevices()) {
+            ALOGW("Output profile contains no device on module %s", module->getName());
+            continue;
+        }
+        if ((outProfile->getFlags() & AUDIO_OUTPUT_FLAG_DIRECT) != 0) {
+            continue;
+        }
+        audio_devices_t profileType = outProfile->getSupportedDevicesType();
+        if ((profileType & mDefaultOutputDevice->type()) != AUDIO_DEVICE_NONE) {
+            profileType = mDefaultOutputDevice->type();
+        } else {
+            // chose first device present in profile's SupportedDevices also part of
+            // outputDeviceTypes
+            profileType = outProfile->getSupportedDeviceForType(outputDeviceTypes);
+        }
+        if ((profileType & outputDeviceTypes) == 0) {
+            continue;
+        }
+        sp<SwAudioOutputDescriptor> outputDesc = new SwAudioOutputDescriptor(outProfile,
+                                                                             mpClientInterface);
+        const DeviceVector &supportedDevices = outProfile->getSupportedDevices();
+        const DeviceVector &devicesForType = supportedDevices.getDevicesFromType(profileType);
+        String8 address = devicesForType.size() > 0 ? devicesForType.itemAt(0)->mAddress
+                : String8("");
+
+        outputDesc->mDevice = profileType;
+        audio_config_t config = AUDIO_CONFIG_INITIALIZER;
+        config.sample_rate = outputDesc->mSamplingRate;
+        config.channel_mask = outputDesc->mChannelMask;
+        config.format = outputDesc->mFormat;
+        audio_io_handle_t output = AUDIO_IO_HANDLE_NONE;
+        status_t status = mpClientInterface->openOutput(outProfile->getModuleHandle(),
+                                                        &output,
+                                                        &config,
+                                                        &outputDesc->mDevice,
+                                                        address,
+                                                        &outputDesc->mLatency,
+                                                        outputDesc->mFlags);
+
+        if (status != NO_ERROR) {
+            ALOGW("Cannot open output stream for device %08x on hw module %s",
+                  outputDesc->mDevice,
+                  module->getName());
+        } else {
+            outputDesc->mSamplingRate = config.sample_rate;
+            outputDesc->mChannelMask = config.channel_mask;
+            outputDesc->mFormat = config.format;
+
+            ModuleStreams::OpenedOutput openedOutput;
+            openedOutput.mDesc = outputDesc;
+            openedOutput.mOutput = output;
+            openedOutput.mAddress = address;
+            streams.mOutputs.add(openedOutput);
+        }
+    }
+    // open input streams needed to access attached devices to validate
+    // mAvailableInputDevices list
+    for (size_t j = 0; j < module->mInputProfiles.size(); j++)
+    {
+        const sp<IOProfile> inProfile = module->mInputProfiles[j];
+
+        if (!inProfile->hasSupportedDevices()) {
+            ALOGW("Input profile contains no device on module %s", module->getName());
+            continue;
+        }
+        // chose first device present in profile's SupportedDevices also part of
+        // inputDeviceTypes
+        audio_devices_t profileType = inProfile->getSupportedDeviceForType(inputDeviceTypes);
+
+        if ((profileType & inputDeviceTypes) == 0) {
+            continue;
+        }
+        sp<AudioInputDescriptor> inputDesc =
+                new AudioInputDescriptor(inProfile);
+
+        inputDesc->mDevice = profileType;
+
+        // find the address
+        DeviceVector inputDevices = mAvailableInputDevices.getDevicesFromType(profileType);
+        //   the inputs vector must be of size 1, but we don't want to crash here
+        String8 address = inputDevices.size() > 0 ? inputDevices.itemAt(0)->mAddress
+                : String8("");
+        ALOGV("  for input device 0x%x using address %s", profileType, address.string());
+        ALOGE_IF(inputDevices.size() == 0, "Input device list is empty!");
+
+        audio_config_t config = AUDIO_CONFIG_INITIALIZER;
+        config.sample_rate = inputDesc->mSamplingRate;
+        config.channel_mask = inputDesc->mChannelMask;
+        config.format = inputDesc->mFormat;
+        audio_io_handle_t input = AUDIO_IO_HANDLE_NONE;
+        status_t status = mpClientInterface->openInput(inProfile->getModuleHandle(),
+                                                       &input,
+                                                       &config,
+                                                       &inputDesc->mDevice,
+                                                       address,
+                                                       AUDIO_SOURCE_MIC,
+                                                       AUDIO_INPUT_FLAG_NONE);
+
+        if (status == NO_ERROR) {
+            streams.mInputProfiles.add(inProfile);
+            mpClientInterface->closeInput(input);
+        } else {
+            ALOGW("Cannot open input stream for device %08x on hw module %s",
+                  inputDesc->mDevice,
+                  module->getName());
+        }
+    }
+}
+
+void AudioPolicyManager::addModuleStreams(const sp<HwModule>& module,
+                                          const ModuleStreams& streams)
+{
+    if (module->mHandle == 0) {
+        ALOGW("could not open HW module %s", module->getName());
+        return;
+    }
+    for (size_t j = 0; j < module->mOutputProfiles.size(); j++) {
+        const sp<IOProfile> outProfile = module->mOutputProfiles[j];
+        if (outProfile->hasSupportedDevices() &&
+                (outProfile->getFlags() & AUDIO_OUTPUT_FLAG_TTS) != 0) {
+            mTtsOutputAvailable = true;
+        }
+    }
+    for (size_t j = 0; j < streams.mOutputs.size(); j++) {
+        const sp<SwAudioOutputDescriptor>& outputDesc = streams.mOutputs[j].mDesc;
+        const DeviceVector &supportedDevices = outputDesc->mProfile->getSupportedDevices();
+        for (size_t k = 0; k  < supportedDevices.size(); k++) {
+            ssize_t index = mAvailableOutputDevices.indexOf(supportedDevices[k]);
+            // give a valid ID to an attached device once confirmed it is reachable
+            if (index >= 0 && !mAvailableOutputDevices[index]->isAttached()) {
+                mAvailableOutputDevices[index]->attach(module);
+            }
+        }
+        if (mPrimaryOutput == 0 &&
+                outputDesc->mProfile->getFlags() & AUDIO_OUTPUT_FLAG_PRIMARY) {
+            mPrimaryOutput = outputDesc;
+        }
+        addOutput(streams.mOutputs[j].mOutput, outputDesc);
+        setOutputDevice(outputDesc,
+                        outputDesc->mDevice,
+                        true,
+                        0,
+                        NULL,
+                        streams.mOutputs[j].mAddress.string());
+    }
+    for (size_t j = 0; j < streams.mInputProfiles.size(); j++) {
+        const sp<IOProfile>& inProfile = streams.mInputProfiles[j];
+        const DeviceVector &supportedDevices = inProfile->getSupportedDevices();
+        for (size_t k = 0; k  < supportedDevices.size(); k++) {
+            ssize_t index =  mAvailableInputDevices.indexOf(supportedDevices[k]);
+            // give a valid ID to an attached device once confirmed it is reachable
+            if (index >= 0) {
+                sp<DeviceDescriptor> devDesc = mAvailableInputDevices[index];
+                if (!devDesc->isAttached()) {
+                    devDesc->attach(module);
+                    devDesc->importAudioPort(inProfile);
+                }
+            }
+        }
+    }
+}
+
 AudioPolicyManager::AudioPolicyManager(AudioPolicyClientInterface *clientInterface)
     :
 #ifdef AUDIO_POLICY_TEST
@@ -3463,6 +3754,7 @@ AudioPolicyManager::AudioPolicyManager(AudioPolicyClientInterface *clientInterfa
 {
     mUidCached = getuid();
     mpClientInterface = clientInterface;
+    mRoutingCacheEnabled = property_get_bool("audio.policy.routing_cache", true /* default_value */);
 
     // TODO: remove when legacy conf file is removed. true on devices that use DRC on the
     // DEVICE_CATEGORY_SPEAKER path to boost soft sounds, used to adjust volume curves accordingly.
@@ -3509,154 +3801,31 @@ AudioPolicyManager::AudioPolicyManager(AudioPolicyClientInterface *clientInterfa
     // open all output streams needed to access attached devices
     audio_devices_t outputDeviceTypes = mAvailableOutputDevices.types();
     audio_devices_t inputDeviceTypes = mAvailableInputDevices.types() & ~AUDIO_DEVICE_BIT_IN;
-    for (size_t i = 0; i < mHwModules.size(); i++) {
-        mHwModules[i]->mHandle = mpClientInterface->loadHwModule(mHwModules[i]->getName());
-        if (mHwModules[i]->mHandle == 0) {
-            ALOGW("could not open HW module %s", mHwModules[i]->getName());
-            continue;
-        }
-        // open all output streams needed to access attached devices
-        // except for direct output streams that are only opened when they are actually
-        // required by an app.
-        // This also validates mAvailableOutputDevices list
-        for (size_t j = 0; j < mHwModules[i]->mOutputProfiles.size(); j++)
-        {
-            const sp<IOProfile> outProfile = mHwModules[i]->mOutputProfiles[j];
-
-            if (!outProfile->hasSupportedDevices()) {
-                ALOGW("Output profile contains no device on module %s", mHwModules[i]->getName());
-                continue;
-            }
-            if ((outProfile->getFlags() & AUDIO_OUTPUT_FLAG_TTS) != 0) {
-                mTtsOutputAvailable = true;
-            }
-
-            if ((outProfile->getFlags() & AUDIO_OUTPUT_FLAG_DIRECT) != 0) {
-                continue;
-            }
-            audio_devices_t profileType = outProfile->getSupportedDevicesType();
-            if ((profileType & mDefaultOutputDevice->type()) != AUDIO_DEVICE_NONE) {
-                profileType = mDefaultOutputDevice->type();
-            } else {
-                // chose first device present in profile's SupportedDevices also part of
-                // outputDeviceTypes
-                profileType = outProfile->getSupportedDeviceForType(outputDeviceTypes);
-            }
-            if ((profileType & outputDeviceTypes) == 0) {
-                continue;
-            }
-            sp<SwAudioOutputDescriptor> outputDesc = new SwAudioOutputDescriptor(outProfile,
-                                                                                 mpClientInterface);
-            const DeviceVector &supportedDevices = outProfile->getSupportedDevices();
-            const DeviceVector &devicesForType = supportedDevices.getDevicesFromType(profileType);
-            String8 address = devicesForType.size() > 0 ? devicesForType.itemAt(0)->mAddress
-                    : String8("");
-
-            outputDesc->mDevice = profileType;
-            audio_config_t config = AUDIO_CONFIG_INITIALIZER;
-            config.sample_rate = outputDesc->mSamplingRate;
-            config.channel_mask = outputDesc->mChannelMask;
-            config.format = outputDesc->mFormat;
-            audio_io_handle_t output = AUDIO_IO_HANDLE_NONE;
-            status_t status = mpClientInterface->openOutput(outProfile->getModuleHandle(),
-                                                            &output,
-                                                            &config,
-                                                            &outputDesc->mDevice,
-                                                            address,
-                                                            &outputDesc->mLatency,
-                                                            outputDesc->mFlags);
-
-            if (status != NO_ERROR) {
-                ALOGW("Cannot open output stream for device %08x on hw module %s",
-                      outputDesc->mDevice,
-                      mHwModules[i]->getName());
-            } else {
-                outputDesc->mSamplingRate = config.sample_rate;
-                outputDesc->mChannelMask = config.channel_mask;
-                outputDesc->mFormat = config.format;
-
-                for (size_t k = 0; k  < supportedDevices.size(); k++) {
-                    ssize_t index = mAvailableOutputDevices.indexOf(supportedDevices[k]);
-                    // give a valid ID to an attached device once confirmed it is reachable
-                    if (index >= 0 && !mAvailableOutputDevices[index]->isAttached()) {
-                        mAvailableOutputDevices[index]->attach(mHwModules[i]);
-                    }
-                }
-                if (mPrimaryOutput == 0 &&
-                        outProfile->getFlags() & AUDIO_OUTPUT_FLAG_PRIMARY) {
-                    mPrimaryOutput = outputDesc;
-                }
-                addOutput(output, outputDesc);
-                setOutputDevice(outputDesc,
-                                outputDesc->mDevice,
-                                true,
-                                0,
-                                NULL,
-                                address.string());
-            }
+    // Loading a module and opening its streams waits on the HAL. In parallel mode each module
+    // is processed on its own thread, and the results are then added in module order, so that
+    // the resulting state does not depend on which module comes up first.
+    bool parallelInit = property_get_bool("ro.audio.policy.parallel_init", false /* default_value */);
+    if (parallelInit && mHwModules.size() > 1) {
+        Vector<sp<ModuleLoaderThread> > loaders;
+        for (size_t i = 0; i < mHwModules.size(); i++) {
+            sp<ModuleLoaderThread> loader = new ModuleLoaderThread(this, mHwModules[i],
+                                                                   outputDeviceTypes,
+                                                                   inputDeviceTypes);
+            if (loader->run("APM module loader") != NO_ERROR) {
+                ALOGW("could not start loader thread for HW module %s", mHwModules[i]->getName());
+                loader->load();
+            }
+            loaders.add(loader);
+        }
+        for (size_t i = 0; i < mHwModules.size(); i++) {
+            loaders[i]->join();
+            addModuleStreams(mHwModules[i], loaders[i]->getStreams());
         }
-        // open input streams needed to access attached devices to validate
-        // mAvailableInputDevices list
-        for (size_t j = 0; j < mHwModules[i]->mInputProfiles.size(); j++)
-        {
-            const sp<IOProfile> inProfile = mHwModules[i]->mInputProfiles[j];
-
-            if (!inProfile->hasSupportedDevices()) {
-                ALOGW("Input profile contains no device on module %s", mHwModules[i]->getName());
-                continue;
-            }
-            // chose first device present in profile's SupportedDevices also part of
-            // inputDeviceTypes
-            audio_devices_t profileType = inProfile->getSupportedDeviceForType(inputDeviceTypes);
-
-            if ((profileType & inputDeviceTypes) == 0) {
-                continue;
-            }
-            sp<AudioInputDescriptor> inputDesc =
-                    new AudioInputDescriptor(inProfile);
-
-            inputDesc->mDevice = profileType;
-
-            // find the address
-            DeviceVector inputDevices = mAvailableInputDevices.getDevicesFromType(profileType);
-            //   the inputs vector must be of size 1, but we don't want to crash here
-            String8 address = inputDevices.size() > 0 ? inputDevices.itemAt(0)->mAddress
-                    : String8("");
-            ALOGV("  for input device 0x%x using address %s", profileType, address.string());
-            ALOGE_IF(inputDevices.size() == 0, "Input device list is empty!");
-
-            audio_config_t config = AUDIO_CONFIG_INITIALIZER;
-            config.sample_rate = inputDesc->mSamplingRate;
-            config.channel_mask = inputDesc->mChannelMask;
-            config.format = inputDesc->mFormat;
-            audio_io_handle_t input = AUDIO_IO_HANDLE_NONE;
-            status_t status = mpClientInterface->openInput(inProfile->getModuleHandle(),
-                                                           &input,
-                                                           &config,
-                                                           &inputDesc->mDevice,
-                                                           address,
-                                                           AUDIO_SOURCE_MIC,
-                                                           AUDIO_INPUT_FLAG_NONE);
-
-            if (status == NO_ERROR) {
-                const DeviceVector &supportedDevices = inProfile->getSupportedDevices();
-                for (size_t k = 0; k  < supportedDevices.size(); k++) {
-                    ssize_t index =  mAvailableInputDevices.indexOf(supportedDevices[k]);
-                    // give a valid ID to an attached device once confirmed it is reachable
-                    if (index >= 0) {
-                        sp<DeviceDescriptor> devDesc = mAvailableInputDevices[index];
-                        if (!devDesc->isAttached()) {
-                            devDesc->attach(mHwModules[i]);
-                            devDesc->importAudioPort(inProfile);
-                        }
-                    }
-                }
-                mpClientInterface->closeInput(input);
-            } else {
-                ALOGW("Cannot open input stream for device %08x on hw module %s",
-                      inputDesc->mDevice,
-                      mHwModules[i]->getName());
-            }
+    } else {
+        for (size_t i = 0; i < mHwModules.size(); i++) {
+            ModuleStreams streams;
+            openModuleStreams(mHwModules[i], outputDeviceTypes, inputDeviceTypes, streams);
+            addModuleStreams(mHwModules[i], streams);
         }
     }
     // make sure all attached devices have been allocated a unique ID
@@ -3903,6 +4072,7 @@ void AudioPolicyManager::addOutput(audio_io_handle_t output, const sp<SwAudioOut
 {
     outputDesc->setIoHandle(output);
     mOutputs.add(output, outputDesc);
+    mRoutingCache.invalidate();
     updateMono(output); // update mono status when adding to output list
     selectOutputForMusicEffects();
     nextAudioPortGeneration();
@@ -3911,6 +4081,7 @@ void AudioPolicyManager::addOutput(audio_io_handle_t output, const sp<SwAudioOut
 void AudioPolicyManager::removeOutput(audio_io_handle_t output)
 {
     mOutputs.removeItem(output);
+    mRoutingCache.invalidate();
     selectOutputForMusicEffects();
 }
 
@@ -4824,6 +4995,7 @@ void AudioPolicyManager::updateDevicesAndOutputs()
         mDeviceForStrategy[i] = getDeviceForStrategy((routing_strategy)i, false /*fromCache*/);
     }
     mPreviousOutputs = mOutputs;
+    mRoutingCache.invalidate();
 }
 
 uint32_t AudioPolicyManager::checkDeviceMuteStrategies(const sp<AudioOutputDescriptor>& outputDesc,
@@ -5344,6 +5516,8 @@ void AudioPolicyManager::applyStreamVolumes(const sp<AudioOutputDescriptor>& out
 {
     ALOGVV("applyStreamVolumes() for device %08x", device);
 
+    // only the volumes which change are sent, and they are sent in a single request
+    outputDesc->beginVolumeBatch();
     for (int stream = 0; stream < AUDIO_STREAM_FOR_POLICY_CNT; stream++) {
         checkAndSetVolume((audio_stream_type_t)stream,
                           mVolumeCurves->getVolumeIndex((audio_stream_type_t)stream, device),
@@ -5352,6 +5526,7 @@ void AudioPolicyManager::applyStreamVolumes(const sp<AudioOutputDescriptor>& out
                           delayMs,
                           force);
     }
+    outputDesc->endVolumeBatch();
 }
 
 void AudioPolicyManager::setStrategyMute(routing_strategy strategy,
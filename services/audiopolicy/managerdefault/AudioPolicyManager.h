@@ -42,6 +42,7 @@
 #include <EffectDescriptor.h>
 #include <SoundTriggerSession.h>
 #include <SessionRoute.h>
+#include <RoutingCache.h>
 #include <VolumeCurve.h>
 
 namespace android {
@@ -408,6 +409,15 @@ protected:
         // selects the most appropriate device on input for current state
         audio_devices_t getNewInputDevice(const sp<AudioInputDescriptor>& inputDesc);
 
+        // true if an explicit route currently applies to the strategy,
+        // see getDeviceForStrategy()
+        bool hasActiveRouteForStrategy(routing_strategy strategy);
+
+        // true if the output selected for these parameters only depends on state
+        // which invalidates mRoutingCache when it changes
+        bool isRoutingCacheable(routing_strategy strategy, audio_output_flags_t flags,
+                                const audio_config_t *config);
+
         virtual uint32_t getMaxEffectsCpuLoad()
         {
             return mEffects.getMaxEffectsCpuLoad();
@@ -532,6 +542,10 @@ protected:
         SessionRouteMap mOutputRoutes = SessionRouteMap(SessionRouteMap::MAPTYPE_OUTPUT);
         SessionRouteMap mInputRoutes = SessionRouteMap(SessionRouteMap::MAPTYPE_INPUT);
 
+        // device and output selected by getOutputForAttr() for mixed outputs
+        RoutingCache mRoutingCache;
+        bool mRoutingCacheEnabled;
+
         IVolumeCurvesCollection *mVolumeCurves; // Volume Curves per use case and device category
 
         bool    mLimitRingtoneVolume;        // limit ringtone volume to music volume if headset connected
@@ -593,6 +607,28 @@ protected:
         // Audio Policy Engine Interface.
         AudioPolicyManagerInterface *mEngine;
 protected:
+        // Streams opened on a HW module by openModuleStreams()
+        struct ModuleStreams {
+            struct OpenedOutput {
+                sp<SwAudioOutputDescriptor> mDesc;
+                audio_io_handle_t mOutput;
+                String8 mAddress;
+            };
+            Vector<OpenedOutput> mOutputs;          // outputs left open, in profile order
+            Vector<sp<IOProfile> > mInputProfiles;  // input profiles which could be opened
+        };
+        class ModuleLoaderThread;
+
+        // Loads a HW module and opens the streams needed to validate its attached devices.
+        // Only calls the client interface and reads the configuration, so that it can run for
+        // several modules at the same time.
+        void openModuleStreams(const sp<HwModule>& module,
+                               audio_devices_t outputDeviceTypes,
+                               audio_devices_t inputDeviceTypes,
+                               ModuleStreams& streams);
+        // Adds the streams found by openModuleStreams() and attaches the devices they reach.
+        void addModuleStreams(const sp<HwModule>& module, const ModuleStreams& streams);
+
         // Add or remove AC3 DTS encodings based on user preferences.
         void filterSurroundFormats(FormatVector *formatsPtr);
         void filterSurroundChannelMasks(ChannelsVector *channelMasksPtr);
@@ -131,6 +131,15 @@ status_t AudioPolicyService::AudioPolicyClient::setStreamVolume(audio_stream_typ
                                                delay_ms);
 }
 
+status_t AudioPolicyService::AudioPolicyClient::setStreamVolumes(
+                     const Vector<audio_stream_type_t>& streams,
+                     const Vector<float>& volumes, audio_io_handle_t output,
+                     int delay_ms)
+{
+    return mAudioPolicyService->setStreamVolumes(streams, volumes, output,
+                                                delay_ms);
+}
+
 status_t AudioPolicyService::AudioPolicyClient::invalidateStream(audio_stream_type_t stream)
 {
     sp<IAudioFlinger> af = AudioSystem::get_audio_flinger();
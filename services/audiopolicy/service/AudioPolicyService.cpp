@@ -436,6 +436,14 @@ bool AudioPolicyService::AudioCommandThread::threadLoop()
                                                                     data->mVolume,
                                                                     data->mIO);
                     }break;
+                case SET_VOLUMES: {
+                    VolumesData *data = (VolumesData *)command->mParam.get();
+                    ALOGV("AudioCommandThread() processing set volumes for %zu streams, \
+                            output %d", data->mStreams.size(), data->mIO);
+                    command->mStatus = AudioSystem::setStreamVolumes(data->mStreams,
+                                                                     data->mVolumes,
+                                                                     data->mIO);
+                    }break;
                 case SET_PARAMETERS: {
                     ParametersData *data = (ParametersData *)command->mParam.get();
                     ALOGV("AudioCommandThread() processing set parameters string %s, io %d",
@@ -673,6 +681,28 @@ status_t AudioPolicyService::AudioCommandThread::volumeCommand(audio_stream_type
     return sendCommand(command, delayMs);
 }
 
+status_t AudioPolicyService::AudioCommandThread::volumesCommand(
+                                                    const Vector<audio_stream_type_t>& streams,
+                                                    const Vector<float>& volumes,
+                                                    audio_io_handle_t output,
+                                                    int delayMs)
+{
+    if (streams.size() != volumes.size()) {
+        return BAD_VALUE;
+    }
+    sp<AudioCommand> command = new AudioCommand();
+    command->mCommand = SET_VOLUMES;
+    sp<VolumesData> data = new VolumesData();
+    data->mStreams = streams;
+    data->mVolumes = volumes;
+    data->mIO = output;
+    command->mParam = data;
+    command->mWaitStatus = true;
+    ALOGV("AudioCommandThread() adding set volumes for %zu streams, output %d",
+            streams.size(), output);
+    return sendCommand(command, delayMs);
+}
+
 status_t AudioPolicyService::AudioCommandThread::parametersCommand(audio_io_handle_t ioHandle,
                                                                    const char *keyValuePairs,
                                                                    int delayMs)
@@ -873,6 +903,13 @@ void AudioPolicyService::AudioCommandThread::insertCommand_l(sp<AudioCommand>& c
                     (command2->mCommand != RELEASE_AUDIO_PATCH)) {
                 continue;
             }
+        // likewise for set volume and set volumes commands
+        } else if ((command->mCommand == SET_VOLUME) ||
+                (command->mCommand == SET_VOLUMES)) {
+            if ((command2->mCommand != SET_VOLUME) &&
+                    (command2->mCommand != SET_VOLUMES)) {
+                continue;
+            }
         } else if (command2->mCommand != command->mCommand) continue;
 
         switch (command->mCommand) {
@@ -912,14 +949,54 @@ void AudioPolicyService::AudioCommandThread::insertCommand_l(sp<AudioCommand>& c
             delayMs = 1;
         } break;
 
-        case SET_VOLUME: {
-            VolumeData *data = (VolumeData *)command->mParam.get();
-            VolumeData *data2 = (VolumeData *)command2->mParam.get();
-            if (data->mIO != data2->mIO) break;
-            if (data->mStream != data2->mStream) break;
-            ALOGV("Filtering out volume command on output %d for stream %d",
-                    data->mIO, data->mStream);
-            removedCommands.add(command2);
+        case SET_VOLUME:
+        case SET_VOLUMES: {
+            // the volumes set by the new command, as a set volumes command
+            audio_io_handle_t io;
+            Vector<audio_stream_type_t> streams;
+            if (command->mCommand == SET_VOLUME) {
+                VolumeData *data = (VolumeData *)command->mParam.get();
+                io = data->mIO;
+                streams.add(data->mStream);
+            } else {
+                VolumesData *data = (VolumesData *)command->mParam.get();
+                io = data->mIO;
+                streams = data->mStreams;
+            }
+            bool filtered = false;
+            if (command2->mCommand == SET_VOLUME) {
+                VolumeData *data2 = (VolumeData *)command2->mParam.get();
+                if (data2->mIO != io) break;
+                for (size_t j = 0; j < streams.size(); j++) {
+                    if (streams[j] == data2->mStream) {
+                        ALOGV("Filtering out volume command on output %d for stream %d",
+                                io, data2->mStream);
+                        removedCommands.add(command2);
+                        filtered = true;
+                        break;
+                    }
+                }
+            } else {
+                // only remove the streams that the new command overrides
+                VolumesData *data2 = (VolumesData *)command2->mParam.get();
+                if (data2->mIO != io) break;
+                for (size_t j = 0; j < streams.size(); j++) {
+                    for (size_t k = 0; k < data2->mStreams.size(); k++) {
+                        if (data2->mStreams[k] == streams[j]) {
+                            ALOGV("Filtering out volume on output %d for stream %d",
+                                    io, streams[j]);
+                            data2->mStreams.removeAt(k);
+                            data2->mVolumes.removeAt(k);
+                            filtered = true;
+                            break;
+                        }
+                    }
+                }
+                if (data2->mStreams.size() == 0) {
+                    removedCommands.add(command2);
+                }
+            }
+            if (!filtered) break;
             command->mTime = command2->mTime;
             // force delayMs to non 0 so that code below does not request to wait for
             // command status as the command is now delayed
@@ -1065,6 +1142,15 @@ int AudioPolicyService::setStreamVolume(audio_stream_type_t stream,
                                                    output, delayMs);
 }
 
+int AudioPolicyService::setStreamVolumes(const Vector<audio_stream_type_t>& streams,
+                                         const Vector<float>& volumes,
+                                         audio_io_handle_t output,
+                                         int delayMs)
+{
+    return (int)mAudioCommandThread->volumesCommand(streams, volumes,
+                                                    output, delayMs);
+}
+
 int AudioPolicyService::startTone(audio_policy_tone_t tone,
                                   audio_stream_type_t stream)
 {
@@ -161,6 +161,10 @@ public:
                                      float volume,
                                      audio_io_handle_t output,
                                      int delayMs = 0);
+    virtual status_t setStreamVolumes(const Vector<audio_stream_type_t>& streams,
+                                      const Vector<float>& volumes,
+                                      audio_io_handle_t output,
+                                      int delayMs = 0);
     virtual status_t startTone(audio_policy_tone_t tone, audio_stream_type_t stream);
     virtual status_t stopTone();
     virtual status_t setVoiceVolume(float volume, int delayMs = 0);
@@ -263,7 +267,8 @@ private:
             UPDATE_AUDIOPATCH_LIST,
             SET_AUDIOPORT_CONFIG,
             DYN_POLICY_MIX_STATE_UPDATE,
-            RECORDING_CONFIGURATION_UPDATE
+            RECORDING_CONFIGURATION_UPDATE,
+            SET_VOLUMES
         };
 
         AudioCommandThread (String8 name, const wp<AudioPolicyService>& service);
@@ -281,6 +286,9 @@ private:
                     void        stopToneCommand();
                     status_t    volumeCommand(audio_stream_type_t stream, float volume,
                                             audio_io_handle_t output, int delayMs = 0);
+                    status_t    volumesCommand(const Vector<audio_stream_type_t>& streams,
+                                            const Vector<float>& volumes,
+                                            audio_io_handle_t output, int delayMs = 0);
                     status_t    parametersCommand(audio_io_handle_t ioHandle,
                                             const char *keyValuePairs, int delayMs = 0);
                     status_t    voiceVolumeCommand(float volume, int delayMs = 0);
@@ -351,6 +359,13 @@ private:
             audio_io_handle_t mIO;
         };
 
+        class VolumesData : public AudioCommandData {
+        public:
+            Vector<audio_stream_type_t> mStreams;
+            Vector<float> mVolumes;
+            audio_io_handle_t mIO;
+        };
+
         class ParametersData : public AudioCommandData {
         public:
             audio_io_handle_t mIO;
@@ -477,6 +492,10 @@ private:
         // set a stream volume for a particular output. For the same user setting, a given stream type can have different volumes
         // for each output (destination device) it is attached to.
         virtual status_t setStreamVolume(audio_stream_type_t stream, float volume, audio_io_handle_t output, int delayMs = 0);
+        virtual status_t setStreamVolumes(const Vector<audio_stream_type_t>& streams,
+                                          const Vector<float>& volumes,
+                                          audio_io_handle_t output,
+                                          int delayMs = 0);
 
         // invalidate a stream type, causing a reroute to an unspecified new output
         virtual status_t invalidateStream(audio_stream_type_t stream);
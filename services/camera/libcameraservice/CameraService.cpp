@@ -165,6 +165,10 @@ static void torch_mode_status_change(
 // ----------------------------------------------------------------------------
 
 CameraService::CameraService() :
+        mConnectLockLatency(kConnectLatencyBinSizeMs),
+        mConnectEvictionLatency(kConnectLatencyBinSizeMs),
+        mConnectOpenLatency(kConnectLatencyBinSizeMs),
+        mConnectTotalLatency(kConnectLatencyBinSizeMs),
         mEventLog(DEFAULT_EVENT_LOG_LENGTH),
         mNumberOfCameras(0), mNumberOfNormalCameras(0),
         mSoundRef(0), mInitialized(false) {
@@ -1280,6 +1284,7 @@ Status CameraService::connectHelper(const sp<CALLBACK>& cameraCb, const String8&
     String8 clientName8(clientPackageName);
 
     int originalClientPid = 0;
+    nsecs_t connectStart = systemTime();
 
     ALOGI("CameraService::connect call (PID %d \"%s\", camera ID %s) for HAL version %s and "
             "Camera API version %d", clientPid, clientName8.string(), cameraId.string(),
@@ -1299,6 +1304,7 @@ Status CameraService::connectHelper(const sp<CALLBACK>& cameraCb, const String8&
                     "Cannot open camera %s for \"%s\" (PID %d): Too many other clients connecting",
                     cameraId.string(), clientName8.string(), clientPid);
         }
+        nsecs_t lockAcquired = systemTime();
 
         // Enforce client permissions and do basic sanity checks
         if(!(ret = validateConnectLocked(cameraId, clientName8,
@@ -1344,6 +1350,8 @@ Status CameraService::connectHelper(const sp<CALLBACK>& cameraCb, const String8&
             return ret;
         }
 
+        nsecs_t evictionsDone = systemTime();
+
         // give flashlight a chance to close devices if necessary.
         mFlashlight->prepareDeviceOpen(cameraId);
 
@@ -1395,6 +1403,12 @@ Status CameraService::connectHelper(const sp<CALLBACK>& cameraCb, const String8&
             }
         }
 
+        nsecs_t clientOpened = systemTime();
+        mConnectLockLatency.add(connectStart, lockAcquired);
+        mConnectEvictionLatency.add(lockAcquired, evictionsDone);
+        mConnectOpenLatency.add(evictionsDone, clientOpened);
+        mConnectTotalLatency.add(connectStart, clientOpened);
+
         // Update shim paremeters for legacy clients
         if (effectiveApiLevel == API_1) {
             // Assume we have always received a Client subclass for API1
@@ -2497,6 +2511,12 @@ status_t CameraService::dump(int fd, const Vector<String16>& args) {
     String8 activeClientString = mActiveClientManager.toString();
     dprintf(fd, "Active Camera Clients:\n%s", activeClientString.string());
     dprintf(fd, "Allowed user IDs: %s\n", toString(mAllowedUsers).string());
+    if (locked) {
+        mConnectLockLatency.dump(fd, "Connect latency waiting for other connect calls");
+        mConnectEvictionLatency.dump(fd, "Connect latency checking permissions and evictions");
+        mConnectOpenLatency.dump(fd, "Connect latency opening the device");
+        mConnectTotalLatency.dump(fd, "Connect latency total");
+    }
 
     dumpEventLog(fd);
 
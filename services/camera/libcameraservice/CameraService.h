@@ -41,6 +41,7 @@
 #include "media/RingBuffer.h"
 #include "utils/AutoConditionLock.h"
 #include "utils/ClientManager.h"
+#include "utils/LatencyHistogram.h"
 
 #include <set>
 #include <string>
@@ -83,6 +84,9 @@ public:
     // Default number of messages to store in eviction log
     static const size_t DEFAULT_EVENT_LOG_LENGTH = 100;
 
+    // Bin size of the connect latency histograms
+    static const int32_t kConnectLatencyBinSizeMs = 50;
+
     // Event log ID
     static const int SN_EVENT_LOG_ID = 0x534e4554;
 
@@ -544,6 +548,14 @@ private:
     // Condition to use with mServiceLock, used to handle simultaneous connect calls from clients
     std::shared_ptr<WaitableMutexWrapper> mServiceLockWrapper;
 
+    // Latency of successful connect calls by stage, for dumps; guarded by mServiceLock:
+    // waiting for other connect calls, permission checks and evictions, creating the client and
+    // opening the HAL device, and the whole call
+    CameraLatencyHistogram mConnectLockLatency;
+    CameraLatencyHistogram mConnectEvictionLatency;
+    CameraLatencyHistogram mConnectOpenLatency;
+    CameraLatencyHistogram mConnectTotalLatency;
+
     // Return NO_ERROR if the device with a give ID can be connected to
     status_t checkIfDeviceIsUsable(const String8& cameraId) const;
 
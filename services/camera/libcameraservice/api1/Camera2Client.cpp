@@ -367,6 +367,8 @@ status_t Camera2Client::dumpClient(int fd, const Vector<String16>& args) {
 
     mCaptureSequencer->dump(fd, args);
 
+    mJpegProcessor->dump(fd, args);
+
     mFrameProcessor->dump(fd, args);
 
     mZslProcessor->dump(fd, args);
@@ -1506,6 +1508,16 @@ status_t Camera2Client::setParameters(const String8& params) {
 
     SharedParameters::Lock l(mParameters);
 
+    // Legacy apps often set the parameters they just got back unchanged, as often as every
+    // frame. Skip parsing them and rebuilding the requests if nothing changed since they were
+    // last applied.
+    if (!mAppliedParameters.isEmpty() && params == mAppliedParameters &&
+            l.mParameters.paramsFlattened == mAppliedParameters) {
+        ALOGV("%s: Camera %d: Parameters unchanged", __FUNCTION__, mCameraId);
+        return OK;
+    }
+    mAppliedParameters.clear();
+
     Parameters::focusMode_t focusModeBefore = l.mParameters.focusMode;
     res = l.mParameters.set(params);
     if (res != OK) return res;
@@ -1516,6 +1528,9 @@ status_t Camera2Client::setParameters(const String8& params) {
     }
 
     res = updateRequests(l.mParameters);
+    if (res == OK && params == l.mParameters.paramsFlattened) {
+        mAppliedParameters = params;
+    }
 
     return res;
 }
@@ -216,6 +216,10 @@ private:
     /** Utility members */
     bool mLegacyMode;
 
+    // Parameters last applied to the requests by setParameters, guarded by
+    // mBinderSerializationLock
+    String8 mAppliedParameters;
+
     // Wait until the camera device has received the latest control settings
     status_t syncWithDevice();
 
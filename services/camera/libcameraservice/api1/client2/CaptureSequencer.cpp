@@ -45,6 +45,10 @@ CaptureSequencer::CaptureSequencer(wp<Camera2Client> client):
         mShutterNotified(false),
         mHalNotifiedShutter(false),
         mShutterCaptureId(-1),
+        mCaptureStartTime(0),
+        mLastCaptureDeliveredTime(0),
+        mCaptureLatency(kCaptureLatencyBinSizeMs),
+        mCaptureInterval(kCaptureLatencyBinSizeMs),
         mClient(client),
         mCaptureState(IDLE),
         mStateTransitionCount(0),
@@ -74,6 +78,7 @@ status_t CaptureSequencer::startCapture(int msgType) {
     }
     if (!mStartCapture) {
         mMsgType = msgType;
+        mCaptureStartTime = systemTime();
         mStartCapture = true;
         mStartCaptureSignal.signal();
     }
@@ -165,6 +170,10 @@ void CaptureSequencer::dump(int fd, const Vector<String16>& /*args*/) {
     result.append("    Latest captured frame:\n");
     write(fd, result.string(), result.size());
     mNewFrame.dump(fd, 2, 6);
+
+    Mutex::Autolock l(mInputMutex);
+    mCaptureLatency.dump(fd, "Still capture latency");
+    mCaptureInterval.dump(fd, "Still capture interval");
 }
 
 /** Private members */
@@ -317,6 +326,14 @@ CaptureSequencer::CaptureState CaptureSequencer::manageDone(sp<Camera2Client> &c
         } else {
             ALOGV("%s: No client!", __FUNCTION__);
         }
+
+        nsecs_t now = systemTime();
+        Mutex::Autolock il(mInputMutex);
+        mCaptureLatency.add(mCaptureStartTime, now);
+        if (mLastCaptureDeliveredTime != 0) {
+            mCaptureInterval.add(mLastCaptureDeliveredTime, now);
+        }
+        mLastCaptureDeliveredTime = now;
     }
     mCaptureBuffer.clear();
 
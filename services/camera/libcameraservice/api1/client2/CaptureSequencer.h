@@ -25,6 +25,7 @@
 #include <utils/Condition.h>
 #include "camera/CameraMetadata.h"
 #include "camera/CaptureResult.h"
+#include "utils/LatencyHistogram.h"
 #include "Parameters.h"
 #include "FrameProcessor.h"
 
@@ -104,6 +105,13 @@ class CaptureSequencer:
     int32_t mShutterCaptureId; // The captureId which is waiting for shutter notification
     Condition mShutterNotifySignal;
 
+    // Still capture throughput, for dumps: from startCapture to the JPEG callback, and
+    // between consecutive JPEG callbacks
+    nsecs_t mCaptureStartTime;
+    nsecs_t mLastCaptureDeliveredTime;
+    CameraLatencyHistogram mCaptureLatency;
+    CameraLatencyHistogram mCaptureInterval;
+
     /**
      * Internal to CaptureSequencer
      */
@@ -112,6 +120,7 @@ class CaptureSequencer:
     static const int kMaxTimeoutsForPrecaptureEnd = 20;  // 2 sec
     static const int kMaxTimeoutsForCaptureEnd    = 40;  // 4 sec
     static const int kMaxRetryCount = 3; // 3 retries in case of buffer drop
+    static const int32_t kCaptureLatencyBinSizeMs = 100;
 
     wp<Camera2Client> mClient;
     wp<ZslProcessor> mZslProcessor;
@@ -44,7 +44,8 @@ JpegProcessor::JpegProcessor(
         mId(client->getCameraId()),
         mCaptureDone(false),
         mCaptureSuccess(false),
-        mCaptureStreamId(NO_STREAM) {
+        mCaptureStreamId(NO_STREAM),
+        mNextCaptureHeap(0) {
 }
 
 JpegProcessor::~JpegProcessor() {
@@ -117,22 +118,30 @@ status_t JpegProcessor::updateStream(const Parameters &params) {
     // Since ashmem heaps are rounded up to page size, don't reallocate if
     // the capture heap isn't exactly the same size as the required JPEG buffer
     const size_t HEAP_SLACK_FACTOR = 2;
-    if (mCaptureHeap == 0 ||
-            (mCaptureHeap->getSize() < static_cast<size_t>(maxJpegSize)) ||
-            (mCaptureHeap->getSize() >
-                    static_cast<size_t>(maxJpegSize) * HEAP_SLACK_FACTOR) ) {
-        // Create memory for API consumption
-        mCaptureHeap.clear();
-        mCaptureHeap =
-                new MemoryHeapBase(maxJpegSize, 0, "Camera2Client::CaptureHeap");
-        if (mCaptureHeap->getSize() == 0) {
-            ALOGE("%s: Camera %d: Unable to allocate memory for capture",
-                    __FUNCTION__, mId);
-            return NO_MEMORY;
+    if (mCaptureHeaps.size() != kCaptureHeapCount) {
+        mCaptureHeaps.clear();
+        mCaptureHeaps.insertAt(0, kCaptureHeapCount);
+        mNextCaptureHeap = 0;
+    }
+    for (size_t i = 0; i < kCaptureHeapCount; i++) {
+        sp<MemoryHeapBase>& heap = mCaptureHeaps.editItemAt(i);
+        if (heap == 0 ||
+                (heap->getSize() < static_cast<size_t>(maxJpegSize)) ||
+                (heap->getSize() >
+                        static_cast<size_t>(maxJpegSize) * HEAP_SLACK_FACTOR) ) {
+            // Create memory for API consumption
+            heap.clear();
+            heap = new MemoryHeapBase(maxJpegSize, 0, "Camera2Client::CaptureHeap");
+            if (heap->getSize() == 0) {
+                ALOGE("%s: Camera %d: Unable to allocate memory for capture",
+                        __FUNCTION__, mId);
+                mCaptureHeaps.clear();
+                return NO_MEMORY;
+            }
         }
     }
-    ALOGV("%s: Camera %d: JPEG capture heap now %zu bytes; requested %zd bytes",
-            __FUNCTION__, mId, mCaptureHeap->getSize(), maxJpegSize);
+    ALOGV("%s: Camera %d: %zu JPEG capture heaps now %zu bytes; requested %zd bytes",
+            __FUNCTION__, mId, kCaptureHeapCount, mCaptureHeaps[0]->getSize(), maxJpegSize);
 
     if (mCaptureStreamId != NO_STREAM) {
         // Check if stream parameters have to change
@@ -201,7 +210,8 @@ status_t JpegProcessor::deleteStream() {
 
         device->deleteStream(mCaptureStreamId);
 
-        mCaptureHeap.clear();
+        mCaptureHeaps.clear();
+        mNextCaptureHeap = 0;
         mCaptureWindow.clear();
         mCaptureConsumer.clear();
 
@@ -215,7 +225,12 @@ int JpegProcessor::getStreamId() const {
     return mCaptureStreamId;
 }
 
-void JpegProcessor::dump(int /*fd*/, const Vector<String16>& /*args*/) const {
+void JpegProcessor::dump(int fd, const Vector<String16>& /*args*/) const {
+    Mutex::Autolock l(mInputMutex);
+    String8 result = String8::format("    JPEG capture heaps: %zu of %zu bytes, next %zu\n",
+            mCaptureHeaps.size(), mCaptureHeaps.isEmpty() ? 0 : mCaptureHeaps[0]->getSize(),
+            mNextCaptureHeap);
+    write(fd, result.string(), result.size());
 }
 
 bool JpegProcessor::threadLoop() {
@@ -254,6 +269,10 @@ status_t JpegProcessor::processNewCapture(bool captureSuccess) {
             ALOGW("%s: Camera %d: No stream is available", __FUNCTION__, mId);
             return INVALID_OPERATION;
         }
+        if (mCaptureHeaps.isEmpty()) {
+            ALOGW("%s: Camera %d: No capture heap is available", __FUNCTION__, mId);
+            return INVALID_OPERATION;
+        }
 
         res = mCaptureConsumer->lockNextBuffer(&imgBuffer);
         if (res != OK) {
@@ -282,7 +301,9 @@ status_t JpegProcessor::processNewCapture(bool captureSuccess) {
         if (jpegSize == 0) { // failed to find size, default to whole buffer
             jpegSize = imgBuffer.width;
         }
-        size_t heapSize = mCaptureHeap->getSize();
+        sp<MemoryHeapBase> heap = mCaptureHeaps[mNextCaptureHeap];
+        mNextCaptureHeap = (mNextCaptureHeap + 1) % mCaptureHeaps.size();
+        size_t heapSize = heap->getSize();
         if (jpegSize > heapSize) {
             ALOGW("%s: JPEG image is larger than expected, truncating "
                     "(got %zu, expected at most %zu bytes)",
@@ -291,8 +312,8 @@ status_t JpegProcessor::processNewCapture(bool captureSuccess) {
         }
 
         // TODO: Optimize this to avoid memcopy
-        captureBuffer = new MemoryBase(mCaptureHeap, 0, jpegSize);
-        void* captureMemory = mCaptureHeap->getBase();
+        captureBuffer = new MemoryBase(heap, 0, jpegSize);
+        void* captureMemory = heap->getBase();
         memcpy(captureMemory, imgBuffer.data, jpegSize);
 
         mCaptureConsumer->unlockBuffer(imgBuffer);
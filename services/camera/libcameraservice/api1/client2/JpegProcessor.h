@@ -61,6 +61,9 @@ class JpegProcessor:
     void dump(int fd, const Vector<String16>& args) const;
   private:
     static const nsecs_t kWaitDuration = 10000000; // 10 ms
+    // Number of heaps JPEG images are copied into in turn, so that a new capture does not
+    // overwrite an image the client may still be reading
+    static const size_t kCaptureHeapCount = 3;
     wp<CameraDeviceBase> mDevice;
     wp<CaptureSequencer> mSequencer;
     int mId;
@@ -77,7 +80,8 @@ class JpegProcessor:
     int mCaptureStreamId;
     sp<CpuConsumer>    mCaptureConsumer;
     sp<Surface>        mCaptureWindow;
-    sp<MemoryHeapBase> mCaptureHeap;
+    Vector<sp<MemoryHeapBase> > mCaptureHeaps;
+    size_t             mNextCaptureHeap;
 
     virtual bool threadLoop();
 
@@ -24,6 +24,7 @@
 #include <inttypes.h>
 #include <hidl/ServiceManagement.h>
 #include <functional>
+#include <thread>
 #include <camera_metadata_hidden.h>
 
 namespace android {
@@ -517,16 +518,50 @@ status_t CameraProviderManager::ProviderInfo::initialize() {
         return mapToStatusT(status);
     }
 
-    sp<StatusListener> listener = mManager->getStatusListener();
-    for (auto& device : devices) {
+    // Query the static information of all devices concurrently, as each device takes a few
+    // HIDL round trips to the provider, and providers with many devices would otherwise hold
+    // up camera service startup.
+    struct PendingDevice {
+        std::string name;
         std::string id;
-        status_t res = addDevice(device,
-                hardware::camera::common::V1_0::CameraDeviceStatus::PRESENT, &id);
+        uint16_t major;
+        uint16_t minor;
+        std::unique_ptr<DeviceInfo> deviceInfo;
+    };
+    std::vector<PendingDevice> pending;
+    pending.reserve(devices.size());
+    for (auto& device : devices) {
+        ALOGI("Enumerating new camera device: %s", device.c_str());
+        PendingDevice p;
+        p.name = device;
+        status_t res = checkDeviceName(device, &p.major, &p.minor, &p.id);
         if (res != OK) {
             ALOGE("%s: Unable to enumerate camera device '%s': %s (%d)",
                     __FUNCTION__, device.c_str(), strerror(-res), res);
             continue;
         }
+        pending.push_back(std::move(p));
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(pending.size());
+    for (auto& p : pending) {
+        threads.emplace_back([this, &p]() {
+            p.deviceInfo = createDeviceInfo(p.name, p.id, p.major, p.minor);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Add the devices in the order the provider listed them
+    for (auto& p : pending) {
+        if (p.deviceInfo == nullptr) {
+            ALOGE("%s: Unable to enumerate camera device '%s'", __FUNCTION__, p.name.c_str());
+            continue;
+        }
+        p.deviceInfo->mStatus = hardware::camera::common::V1_0::CameraDeviceStatus::PRESENT;
+        mDevices.push_back(std::move(p.deviceInfo));
     }
 
     for (auto& device : mDevices) {
@@ -553,9 +588,30 @@ status_t CameraProviderManager::ProviderInfo::addDevice(const std::string& name,
     ALOGI("Enumerating new camera device: %s", name.c_str());
 
     uint16_t major, minor;
-    std::string type, id;
+    std::string id;
+
+    status_t res = checkDeviceName(name, &major, &minor, &id);
+    if (res != OK) {
+        return res;
+    }
+
+    std::unique_ptr<DeviceInfo> deviceInfo = createDeviceInfo(name, id, major, minor);
+    if (deviceInfo == nullptr) return BAD_VALUE;
+    deviceInfo->mStatus = initialStatus;
+
+    mDevices.push_back(std::move(deviceInfo));
+
+    if (parsedId != nullptr) {
+        *parsedId = id;
+    }
+    return OK;
+}
+
+status_t CameraProviderManager::ProviderInfo::checkDeviceName(const std::string& name,
+        uint16_t *major, uint16_t *minor, std::string *id) const {
+    std::string type;
 
-    status_t res = parseDeviceName(name, &major, &minor, &type, &id);
+    status_t res = parseDeviceName(name, major, minor, &type, id);
     if (res != OK) {
         return res;
     }
@@ -564,36 +620,27 @@ status_t CameraProviderManager::ProviderInfo::addDevice(const std::string& name,
                 type.c_str(), mType.c_str());
         return BAD_VALUE;
     }
-    if (mManager->isValidDeviceLocked(id, major)) {
+    if (mManager->isValidDeviceLocked(*id, *major)) {
         ALOGE("%s: Device %s: ID %s is already in use for device major version %d", __FUNCTION__,
-                name.c_str(), id.c_str(), major);
+                name.c_str(), id->c_str(), *major);
         return BAD_VALUE;
     }
+    return OK;
+}
 
-    std::unique_ptr<DeviceInfo> deviceInfo;
+std::unique_ptr<CameraProviderManager::ProviderInfo::DeviceInfo>
+CameraProviderManager::ProviderInfo::createDeviceInfo(const std::string &name,
+        const std::string &id, uint16_t major, uint16_t minor) const {
     switch (major) {
         case 1:
-            deviceInfo = initializeDeviceInfo<DeviceInfo1>(name, mProviderTagid,
-                    id, minor);
-            break;
+            return initializeDeviceInfo<DeviceInfo1>(name, mProviderTagid, id, minor);
         case 3:
-            deviceInfo = initializeDeviceInfo<DeviceInfo3>(name, mProviderTagid,
-                    id, minor);
-            break;
+            return initializeDeviceInfo<DeviceInfo3>(name, mProviderTagid, id, minor);
         default:
             ALOGE("%s: Device %s: Unknown HIDL device HAL major version %d:", __FUNCTION__,
                     name.c_str(), major);
-            return BAD_VALUE;
-    }
-    if (deviceInfo == nullptr) return BAD_VALUE;
-    deviceInfo->mStatus = initialStatus;
-
-    mDevices.push_back(std::move(deviceInfo));
-
-    if (parsedId != nullptr) {
-        *parsedId = id;
+            return nullptr;
     }
-    return OK;
 }
 
 status_t CameraProviderManager::ProviderInfo::dump(int fd, const Vector<String16>&) const {
@@ -1339,6 +1386,7 @@ status_t HidlVendorTagDescriptor::createDescriptorFromHidl(
         desc->mReverseMapping[reverseIndex]->add(desc->mTagToNameMap.valueFor(tag), tag);
     }
 
+    desc->buildTagInfoIndex();
     descriptor = desc;
     return OK;
 }
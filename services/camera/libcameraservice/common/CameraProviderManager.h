@@ -363,6 +363,16 @@ private:
 
         CameraProviderManager *mManager;
 
+        // Parse a device name reported by this provider, and check that its ID isn't used
+        // by another provider already
+        status_t checkDeviceName(const std::string& name, uint16_t *major, uint16_t *minor,
+                std::string *id) const;
+
+        // Instantiate the DeviceInfo for a checked device name. This queries the device's
+        // static information from the HAL, and is safe to call from several threads at once.
+        std::unique_ptr<DeviceInfo> createDeviceInfo(const std::string &name,
+                const std::string &id, uint16_t major, uint16_t minor) const;
+
         // Templated method to instantiate the right kind of DeviceInfo and call the
         // right CameraProvider getCameraDeviceInterface_* method.
         template<class DeviceInfoT>
@@ -18,8 +18,10 @@
 #define LOG_TAG "Camera3-BufferManager"
 #define ATRACE_TAG ATRACE_TAG_CAMERA
 
+#include <cutils/properties.h>
 #include <gui/ISurfaceComposer.h>
 #include <private/gui/ComposerService.h>
+#include <ui/PixelFormat.h>
 #include <utils/Log.h>
 #include <utils/Trace.h>
 #include "utils/CameraTraces.h"
@@ -29,10 +31,19 @@ namespace android {
 
 namespace camera3 {
 
-Camera3BufferManager::Camera3BufferManager() {
+Camera3BufferManager::Camera3BufferManager() :
+        mCachedBytes(0),
+        mMaxCachedBytes(std::max(0,
+                property_get_int32("camera.buffer_cache.max_kb", kDefaultMaxCachedKb)) * 1024),
+        mCacheHits(0),
+        mCacheMisses(0) {
 }
 
 Camera3BufferManager::~Camera3BufferManager() {
+    if (mPrewarmThread != nullptr) {
+        mPrewarmThread->requestExit();
+        mPrewarmThread->join();
+    }
 }
 
 status_t Camera3BufferManager::registerStream(wp<Camera3OutputStream>& stream,
@@ -110,6 +121,21 @@ status_t Camera3BufferManager::registerStream(wp<Camera3OutputStream>& stream,
        currentStreamSet.maxAllowedBufferCount = streamInfo.totalBufferCount;
     }
 
+    if (mMaxCachedBytes > 0) {
+        if (mPrewarmThread == nullptr) {
+            mPrewarmThread = new PrewarmThread(this);
+            status_t res = mPrewarmThread->run("C3BufMgr-Prewarm");
+            if (res != OK) {
+                ALOGW("%s: Unable to start buffer prewarm thread: %s (%d)",
+                        __FUNCTION__, strerror(-res), res);
+                mPrewarmThread.clear();
+            }
+        }
+        if (mPrewarmThread != nullptr) {
+            mPrewarmThread->queue(streamInfo);
+        }
+    }
+
     return OK;
 }
 
@@ -272,22 +298,26 @@ status_t Camera3BufferManager::getBufferForStream(int streamId, int streamSetId,
     if (mGrallocVersion < HARDWARE_DEVICE_API_VERSION(1,0)) {
         const StreamInfo& info = streamSet.streamInfoMap.valueFor(streamId);
         GraphicBufferEntry buffer;
-        buffer.fenceFd = -1;
-        buffer.graphicBuffer = new GraphicBuffer(
-                info.width, info.height, PixelFormat(info.format), info.combinedUsage,
-                std::string("Camera3BufferManager pid [") +
-                        std::to_string(getpid()) + "]");
-        status_t res = buffer.graphicBuffer->initCheck();
-
-        ALOGV("%s: allocating a new graphic buffer (%dx%d, format 0x%x) %p with handle %p",
-                __FUNCTION__, info.width, info.height, info.format,
-                buffer.graphicBuffer.get(), buffer.graphicBuffer->handle);
-        if (res < 0) {
-            ALOGE("%s: graphic buffer allocation failed: (error %d %s) ",
-                    __FUNCTION__, res, strerror(-res));
-            return res;
+        status_t res;
+        if (takeCachedBufferLocked(info, &buffer)) {
+            ALOGV("%s: reusing cached graphic buffer (%dx%d, format 0x%x) %p with handle %p",
+                    __FUNCTION__, info.width, info.height, info.format,
+                    buffer.graphicBuffer.get(), buffer.graphicBuffer->handle);
+        } else {
+            buffer.fenceFd = -1;
+            buffer.graphicBuffer = allocateBuffer(info);
+            res = buffer.graphicBuffer->initCheck();
+
+            ALOGV("%s: allocating a new graphic buffer (%dx%d, format 0x%x) %p with handle %p",
+                    __FUNCTION__, info.width, info.height, info.format,
+                    buffer.graphicBuffer.get(), buffer.graphicBuffer->handle);
+            if (res < 0) {
+                ALOGE("%s: graphic buffer allocation failed: (error %d %s) ",
+                        __FUNCTION__, res, strerror(-res));
+                return res;
+            }
+            ALOGV("%s: allocation done", __FUNCTION__);
         }
-        ALOGV("%s: allocation done", __FUNCTION__);
 
         // Increase the hand-out and attached buffer counts for tracking purposes.
         bufferCount++;
@@ -462,9 +492,157 @@ void Camera3BufferManager::dump(int fd, const Vector<String16>& args) const {
                     streamId, bufferCount);
         }
     }
+    lines.appendFormat("      Buffer cache: %zu buffers, %zu KB (max %zu KB), %zu hits, %zu misses\n",
+            mCachedBuffers.size(), mCachedBytes / 1024, mMaxCachedBytes / 1024,
+            mCacheHits, mCacheMisses);
     write(fd, lines.string(), lines.size());
 }
 
+void Camera3BufferManager::cacheBuffer(int streamId, int streamSetId,
+        const sp<GraphicBuffer>& buffer, const sp<Fence>& fence) {
+    Mutex::Autolock l(mLock);
+    if (buffer == nullptr || mMaxCachedBytes == 0 ||
+            !checkIfStreamRegisteredLocked(streamId, streamSetId)) {
+        return;
+    }
+    const StreamInfo& info =
+            mStreamSetMap.valueFor(streamSetId).streamInfoMap.valueFor(streamId);
+    addToCacheLocked(info, buffer, fence);
+}
+
+sp<GraphicBuffer> Camera3BufferManager::allocateBuffer(const StreamInfo& info) {
+    return new GraphicBuffer(
+            info.width, info.height, PixelFormat(info.format), info.combinedUsage,
+            std::string("Camera3BufferManager pid [") + std::to_string(getpid()) + "]");
+}
+
+bool Camera3BufferManager::isCompatible(const CachedBuffer& cached, const StreamInfo& info) {
+    return cached.width == info.width && cached.height == info.height &&
+            cached.format == info.format && cached.usage == info.combinedUsage;
+}
+
+void Camera3BufferManager::addToCacheLocked(const StreamInfo& info,
+        const sp<GraphicBuffer>& buffer, const sp<Fence>& fence) {
+    CachedBuffer cached;
+    cached.width = info.width;
+    cached.height = info.height;
+    cached.format = info.format;
+    cached.usage = info.combinedUsage;
+    cached.graphicBuffer = buffer;
+    cached.fence = fence;
+
+    // An estimate only; the actual size depends on the gralloc implementation
+    if (info.format == HAL_PIXEL_FORMAT_BLOB) {
+        cached.bytes = info.width;
+    } else {
+        ssize_t bpp = bytesPerPixel(info.format);
+        size_t pixels = static_cast<size_t>(buffer->getStride()) * info.height;
+        cached.bytes = (bpp > 0) ? pixels * bpp : pixels * 3 / 2;
+    }
+    if (cached.bytes > mMaxCachedBytes) {
+        return;
+    }
+
+    mCachedBuffers.push_front(cached);
+    mCachedBytes += cached.bytes;
+    while (mCachedBytes > mMaxCachedBytes) {
+        mCachedBytes -= mCachedBuffers.back().bytes;
+        mCachedBuffers.pop_back();
+    }
+}
+
+bool Camera3BufferManager::takeCachedBufferLocked(const StreamInfo& info,
+        GraphicBufferEntry* buffer) {
+    for (auto it = mCachedBuffers.begin(); it != mCachedBuffers.end(); it++) {
+        if (isCompatible(*it, info)) {
+            buffer->graphicBuffer = it->graphicBuffer;
+            buffer->fenceFd = (it->fence != nullptr && it->fence->isValid()) ?
+                    it->fence->dup() : -1;
+            mCachedBytes -= it->bytes;
+            mCachedBuffers.erase(it);
+            mCacheHits++;
+            return true;
+        }
+    }
+    mCacheMisses++;
+    return false;
+}
+
+void Camera3BufferManager::prewarm(const StreamInfo& info) {
+    ATRACE_CALL();
+    size_t count;
+    {
+        Mutex::Autolock l(mLock);
+        if (!checkIfStreamRegisteredLocked(info.streamId, info.streamSetId)) {
+            return;
+        }
+        size_t cached = 0;
+        for (const auto& it : mCachedBuffers) {
+            if (isCompatible(it, info)) cached++;
+        }
+        size_t wanted = std::min(kPrewarmBufferCount, info.totalBufferCount);
+        if (cached >= wanted) {
+            return;
+        }
+        count = wanted - cached;
+    }
+
+    // Allocate without holding mLock, so that streams aren't blocked meanwhile
+    for (size_t i = 0; i < count; i++) {
+        sp<GraphicBuffer> buffer = allocateBuffer(info);
+        status_t res = buffer->initCheck();
+        if (res != OK) {
+            ALOGW("%s: Stream %d: Unable to allocate buffer ahead of time: %s (%d)",
+                    __FUNCTION__, info.streamId, strerror(-res), res);
+            return;
+        }
+        Mutex::Autolock l(mLock);
+        if (!checkIfStreamRegisteredLocked(info.streamId, info.streamSetId)) {
+            return;
+        }
+        addToCacheLocked(info, buffer, /*fence*/ nullptr);
+    }
+}
+
+Camera3BufferManager::PrewarmThread::PrewarmThread(wp<Camera3BufferManager> parent) :
+        Thread(/*canCallJava*/false),
+        mParent(parent) {
+}
+
+void Camera3BufferManager::PrewarmThread::queue(const StreamInfo& info) {
+    Mutex::Autolock l(mLock);
+    mPending.push_back(info);
+    mSignal.signal();
+}
+
+void Camera3BufferManager::PrewarmThread::requestExit() {
+    Thread::requestExit();
+    Mutex::Autolock l(mLock);
+    mSignal.signal();
+}
+
+bool Camera3BufferManager::PrewarmThread::threadLoop() {
+    StreamInfo info;
+    {
+        Mutex::Autolock l(mLock);
+        while (mPending.empty()) {
+            if (exitPending()) {
+                return false;
+            }
+            mSignal.waitRelative(mLock, kWaitDuration);
+        }
+        info = *mPending.begin();
+        mPending.erase(mPending.begin());
+    }
+
+    sp<Camera3BufferManager> parent = mParent.promote();
+    if (parent == nullptr) {
+        return false;
+    }
+    parent->prewarm(info);
+    return true;
+}
+
 bool Camera3BufferManager::checkIfStreamRegisteredLocked(int streamId, int streamSetId) const {
     ssize_t setIdx = mStreamSetMap.indexOfKey(streamSetId);
     if (setIdx == NAME_NOT_FOUND) {
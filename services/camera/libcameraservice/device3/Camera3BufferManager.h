@@ -19,9 +19,13 @@
 
 #include <list>
 #include <algorithm>
+#include <ui/Fence.h>
 #include <ui/GraphicBuffer.h>
+#include <utils/Condition.h>
 #include <utils/RefBase.h>
 #include <utils/KeyedVector.h>
+#include <utils/List.h>
+#include <utils/Thread.h>
 #include "Camera3OutputStream.h"
 
 namespace android {
@@ -41,6 +45,11 @@ class Camera3OutputStream;
  * In doing so, it reduces the memory footprint unless it is already minimal without impacting
  * performance.
  *
+ * Buffers of streams that are torn down are kept in a cache bounded in size, and reused by
+ * streams configured later with the same size, format and usage, e.g. when switching between
+ * photo and video stream configurations. A few buffers are also allocated ahead of time in the
+ * background for each newly registered stream.
+ *
  */
 class Camera3BufferManager: public virtual RefBase {
 public:
@@ -173,12 +182,30 @@ public:
      */
     void notifyBufferRemoved(int streamId, int streamSetId);
 
+    /**
+     * This method hands a free buffer detached from a stream that is about to be unregistered
+     * over to the buffer manager, so that it can be handed out again to a stream configured later
+     * with the same size, format and usage instead of allocating a new buffer.
+     *
+     * The buffer is dropped if the stream isn't registered, or if the cache is disabled.
+     * Otherwise, the least recently cached buffers are freed once the cache grows beyond the size
+     * set by the camera.buffer_cache.max_kb property.
+     */
+    void cacheBuffer(int streamId, int streamSetId, const sp<GraphicBuffer>& buffer,
+            const sp<Fence>& fence);
+
     /**
      * Dump the buffer manager statistics.
      */
     void     dump(int fd, const Vector<String16> &args) const;
 
 private:
+    // Default size limit of the buffer cache, in KB
+    static const int kDefaultMaxCachedKb = 32 * 1024;
+
+    // Number of buffers allocated in the background for each newly registered stream
+    static const size_t kPrewarmBufferCount = 2;
+
     // allocatedBufferWaterMark will be decreased when:
     //   numAllocatedBuffersThisSet > numHandoutBuffersThisSet + BUFFER_WATERMARK_DEC_THRESHOLD
     // This allows the watermark go back down after a burst of buffer requests
@@ -305,6 +332,73 @@ private:
      * free one if so.
      */
     status_t checkAndFreeBufferOnOtherStreamsLocked(int streamId, int streamSetId);
+
+    /**
+     * A free buffer kept for reuse, along with the stream properties it was allocated for.
+     */
+    struct CachedBuffer {
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;
+        uint32_t usage;
+        size_t bytes;
+        sp<GraphicBuffer> graphicBuffer;
+        sp<Fence> fence;
+    };
+
+    // Most recently cached buffers first
+    std::list<CachedBuffer> mCachedBuffers;
+    size_t mCachedBytes;
+    const size_t mMaxCachedBytes;
+    size_t mCacheHits;
+    size_t mCacheMisses;
+
+    static sp<GraphicBuffer> allocateBuffer(const StreamInfo& info);
+
+    static bool isCompatible(const CachedBuffer& cached, const StreamInfo& info);
+
+    /**
+     * Add a buffer allocated for the given stream to the cache, freeing the least recently cached
+     * buffers if the cache grows too large.
+     */
+    void addToCacheLocked(const StreamInfo& info, const sp<GraphicBuffer>& buffer,
+            const sp<Fence>& fence);
+
+    /**
+     * Remove a buffer compatible with the given stream from the cache. Returns false if there is
+     * none.
+     */
+    bool takeCachedBufferLocked(const StreamInfo& info, GraphicBufferEntry* buffer);
+
+    /**
+     * Allocate up to kPrewarmBufferCount buffers for a stream into the cache, unless compatible
+     * buffers are cached already.
+     */
+    void prewarm(const StreamInfo& info);
+
+    /**
+     * Thread allocating buffers for newly registered streams, so that the allocations are done
+     * by the time the first capture requests need them.
+     */
+    class PrewarmThread : public Thread {
+      public:
+        explicit PrewarmThread(wp<Camera3BufferManager> parent);
+
+        void queue(const StreamInfo& info);
+
+        virtual void requestExit() override;
+
+      private:
+        static const nsecs_t kWaitDuration = 500000000; // 500 ms
+
+        virtual bool threadLoop() override;
+
+        wp<Camera3BufferManager> mParent;
+        Mutex mLock;
+        Condition mSignal;
+        List<StreamInfo> mPending;
+    };
+    sp<PrewarmThread> mPrewarmThread;
 };
 
 } // namespace camera3
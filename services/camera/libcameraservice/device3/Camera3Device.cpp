@@ -80,6 +80,7 @@ Camera3Device::Camera3Device(const String8 &id):
     ATRACE_CALL();
     camera3_callback_ops::notify = &sNotify;
     camera3_callback_ops::process_capture_result = &sProcessCaptureResult;
+    CameraMetadata::getBufferStats(&mMetadataAllocatedAtStart, &mMetadataSharedAtStart);
     ALOGV("%s: Created device for camera %s", __FUNCTION__, mId.string());
 }
 
@@ -613,6 +614,23 @@ status_t Camera3Device::dump(int fd, const Vector<String16> &args) {
     }
     write(fd, lines.string(), lines.size());
 
+    {
+        // The counts are process-wide, so they include any other open device
+        uint64_t allocated, shared;
+        CameraMetadata::getBufferStats(&allocated, &shared);
+        allocated -= mMetadataAllocatedAtStart;
+        shared -= mMetadataSharedAtStart;
+        uint32_t captures = mNextResultFrameNumber;
+        lines = String8::format("    Metadata buffers since open: %" PRIu64 " allocated, %"
+                PRIu64 " shared copies", allocated, shared);
+        if (captures > 0) {
+            lines.appendFormat(" (%.2f allocated, %.2f shared per capture)",
+                    (double)allocated / captures, (double)shared / captures);
+        }
+        lines.append("\n");
+        write(fd, lines.string(), lines.size());
+    }
+
     if (mRequestThread != NULL) {
         mRequestThread->dumpCaptureRequestLatency(fd,
                 "    ProcessCaptureRequest latency histogram:");
@@ -2411,10 +2429,7 @@ void Camera3Device::insertResultLocked(CaptureResult *result,
         uint32_t frameNumber) {
     if (result == nullptr) return;
 
-    camera_metadata_t *meta = const_cast<camera_metadata_t *>(
-            result->mMetadata.getAndLock());
-    set_camera_metadata_vendor_id(meta, mVendorTagId);
-    result->mMetadata.unlock(meta);
+    result->mMetadata.setVendorId(mVendorTagId);
 
     if (result->mMetadata.update(ANDROID_REQUEST_FRAME_COUNT,
             (int32_t*)&frameNumber, 1) != OK) {
@@ -2544,6 +2559,10 @@ void Camera3Device::processCaptureResult(const camera3_capture_result *result) {
     // arrives. Update the in-flight status and remove the in-flight entry if
     // all result data and shutter timestamp have been received.
     nsecs_t shutterTimestamp = 0;
+    // Returning buffers to their streams can block on the consumers, so once
+    // the shutter is known, it is done after mInFlightLock is released to
+    // avoid stalling the request thread and notify().
+    bool returnBuffersAfterUnlock = false;
 
     {
         Mutex::Autolock l(mInFlightLock);
@@ -2635,8 +2654,7 @@ void Camera3Device::processCaptureResult(const camera3_capture_result *result) {
             request.pendingOutputBuffers.appendArray(result->output_buffers,
                 result->num_output_buffers);
         } else {
-            returnOutputBuffers(result->output_buffers,
-                result->num_output_buffers, shutterTimestamp);
+            returnBuffersAfterUnlock = result->num_output_buffers > 0;
         }
 
         if (result->result != NULL && !isPartialResult) {
@@ -2652,9 +2670,24 @@ void Camera3Device::processCaptureResult(const camera3_capture_result *result) {
             }
         }
 
-        removeInFlightRequestIfReadyLocked(idx);
+        // The request must stay in flight until its buffers are back, so
+        // that the device doesn't look idle while streams are still in use.
+        if (!returnBuffersAfterUnlock) {
+            removeInFlightRequestIfReadyLocked(idx);
+        }
     } // scope for mInFlightLock
 
+    if (returnBuffersAfterUnlock) {
+        returnOutputBuffers(result->output_buffers,
+            result->num_output_buffers, shutterTimestamp);
+
+        Mutex::Autolock l(mInFlightLock);
+        ssize_t idx = mInFlightMap.indexOfKey(frameNumber);
+        if (idx >= 0) {
+            removeInFlightRequestIfReadyLocked(idx);
+        }
+    }
+
     if (result->input_buffer != NULL) {
         if (hasInputBufferInRequest) {
             Camera3Stream *stream =
@@ -3879,6 +3912,36 @@ bool Camera3Device::RequestThread::threadLoop() {
     return submitRequestSuccess;
 }
 
+bool Camera3Device::RequestThread::isSameSettings(
+        const camera_metadata_t *a, const camera_metadata_t *b) {
+    if (a == b) {
+        return true;
+    }
+    if (a == NULL || b == NULL) {
+        return false;
+    }
+    size_t entryCount = get_camera_metadata_entry_count(a);
+    if (entryCount != get_camera_metadata_entry_count(b)) {
+        return false;
+    }
+    for (size_t i = 0; i < entryCount; i++) {
+        camera_metadata_ro_entry_t entryA, entryB;
+        if (get_camera_metadata_ro_entry(a, i, &entryA) != OK ||
+                get_camera_metadata_ro_entry(b, i, &entryB) != OK) {
+            return false;
+        }
+        if (entryA.tag != entryB.tag || entryA.type != entryB.type ||
+                entryA.count != entryB.count) {
+            return false;
+        }
+        if (memcmp(entryA.data.u8, entryB.data.u8,
+                camera_metadata_type_size[entryA.type] * entryA.count) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
 status_t Camera3Device::RequestThread::prepareHalRequests() {
     ATRACE_CALL();
 
@@ -3904,6 +3967,23 @@ status_t Camera3Device::RequestThread::prepareHalRequests() {
         bool triggersMixedIn = (triggerCount > 0 || mPrevTriggers > 0);
         mPrevTriggers = triggerCount;
 
+        // A repeating burst cycles through distinct requests that often carry
+        // identical settings; don't resend those to the HAL either. Only the
+        // first request of a batch is checked, as the previous request is still
+        // locked for submission within a batch.
+        if (i == 0 && mPrevRequest != NULL && mPrevRequest != captureRequest &&
+                !triggersMixedIn) {
+            captureRequest->mSettings.sort();
+            const camera_metadata_t *prevSettings = mPrevRequest->mSettings.getAndLock();
+            const camera_metadata_t *settings = captureRequest->mSettings.getAndLock();
+            bool sameSettings = isSameSettings(prevSettings, settings);
+            mPrevRequest->mSettings.unlock(prevSettings);
+            captureRequest->mSettings.unlock(settings);
+            if (sameSettings) {
+                mPrevRequest = captureRequest;
+            }
+        }
+
         // If the request is the same as last, or we had triggers last time
         if (mPrevRequest != captureRequest || triggersMixedIn) {
             /**
@@ -745,6 +745,10 @@ class Camera3Device :
         // request batch.
         status_t prepareHalRequests();
 
+        // Whether the two sorted settings buffers hold the same entries, so that
+        // the HAL can be told to reuse the settings it already has.
+        static bool isSameSettings(const camera_metadata_t *a, const camera_metadata_t *b);
+
         // Return buffers, etc, for requests in mNextRequests that couldn't be fully constructed and
         // send request errors if sendRequestError is true. The buffers will be returned in the
         // ERROR state to mark them as not having valid data. mNextRequests will be cleared.
@@ -1038,6 +1042,11 @@ class Camera3Device :
 
     metadata_vendor_id_t mVendorTagId;
 
+    // Process-wide CameraMetadata buffer counts when this device was created,
+    // for the per-capture allocation counts in dump()
+    uint64_t mMetadataAllocatedAtStart;
+    uint64_t mMetadataSharedAtStart;
+
     /**
      * Static callback forwarding methods from HAL to instance
      */
@@ -586,6 +586,23 @@ status_t Camera3OutputStream::disconnectLocked() {
 
     ALOGV("%s: disconnecting stream %d from native window", __FUNCTION__, getId());
 
+    // Hand the free buffers over to the buffer manager, so that streams configured later can
+    // reuse them rather than allocating new ones.
+    if (mUseBufferManager) {
+        for (size_t i = 0; i < mTotalBufferCount; i++) {
+            sp<GraphicBuffer> buffer;
+            sp<Fence> fence;
+            if (mConsumer->detachNextBuffer(&buffer, &fence) != OK || buffer == nullptr) {
+                break;
+            }
+            mBufferManager->cacheBuffer(getId(), getStreamSetId(), buffer, fence);
+        }
+        std::vector<sp<GraphicBuffer>> removedBuffers;
+        if (mConsumer->getAndFlushRemovedBuffers(&removedBuffers) == OK) {
+            onBuffersRemovedLocked(removedBuffers);
+        }
+    }
+
     res = native_window_api_disconnect(mConsumer.get(),
                                        NATIVE_WINDOW_API_CAMERA);
     /**
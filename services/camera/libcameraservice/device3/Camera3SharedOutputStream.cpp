@@ -100,6 +100,19 @@ status_t Camera3SharedOutputStream::setConsumers(const std::vector<sp<Surface>>&
     return ret;
 }
 
+void Camera3SharedOutputStream::dump(int fd, const Vector<String16> &args) const {
+    Camera3OutputStream::dump(fd, args);
+
+    sp<Camera3StreamSplitter> splitter;
+    {
+        Mutex::Autolock l(mLock);
+        splitter = mStreamSplitter;
+    }
+    if (splitter != nullptr) {
+        splitter->dump(fd);
+    }
+}
+
 status_t Camera3SharedOutputStream::getBufferLocked(camera3_stream_buffer *buffer,
         const std::vector<size_t>& surface_ids) {
     ANativeWindowBuffer* anb;
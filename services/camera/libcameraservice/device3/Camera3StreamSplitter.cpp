@@ -15,6 +15,7 @@
  */
 
 #include <inttypes.h>
+#include <algorithm>
 
 #define LOG_TAG "Camera3StreamSplitter"
 #define ATRACE_TAG ATRACE_TAG_CAMERA
@@ -121,6 +122,7 @@ void Camera3StreamSplitter::disconnect() {
     }
     mOutputs.clear();
     mOutputSlots.clear();
+    mOutputStats.clear();
 
     mConsumer->consumerDisconnect();
 
@@ -213,6 +215,7 @@ status_t Camera3StreamSplitter::addOutputLocked(const sp<Surface>& outputQueue)
     mOutputs.push_back(gbp);
     mNotifiers[gbp] = listener;
     mOutputSlots[gbp] = std::make_unique<OutputSlots>(totalBufferCount);
+    mOutputStats[gbp] = OutputStats();
 
     mMaxConsumerBuffers += maxConsumerBuffers;
     return NO_ERROR;
@@ -234,6 +237,11 @@ status_t Camera3StreamSplitter::outputBufferLocked(const sp<IGraphicBufferProduc
     const BufferTracker& tracker = *(mBuffers[bufferId]);
     int slot = getSlotForOutputLocked(output, tracker.getBuffer());
 
+    // Note the queue time before unlocking, as the output may release the
+    // buffer before queueBuffer returns.
+    OutputStats& stats = mOutputStats[output];
+    stats.queueTimes[bufferId] = systemTime();
+
     // In case the output BufferQueue has its own lock, if we hold splitter lock while calling
     // queueBuffer (which will try to acquire the output lock), the output could be holding its
     // own lock calling releaseBuffer (which  will try to acquire the splitter lock), running into
@@ -245,6 +253,7 @@ status_t Camera3StreamSplitter::outputBufferLocked(const sp<IGraphicBufferProduc
     SP_LOGV("%s: Queuing buffer to buffer queue %p slot %d returns %d",
             __FUNCTION__, output.get(), slot, res);
     if (res != OK) {
+        mOutputStats[output].queueTimes.erase(bufferId);
         if (res != NO_INIT && res != DEAD_OBJECT) {
             SP_LOGE("Queuing buffer to output failed (%d)", res);
         }
@@ -256,10 +265,13 @@ status_t Camera3StreamSplitter::outputBufferLocked(const sp<IGraphicBufferProduc
         return res;
     }
 
+    mOutputStats[output].queuedFrames++;
+
     // If the queued buffer replaces a pending buffer in the async
     // queue, no onBufferReleased is called by the buffer queue.
     // Proactively trigger the callback to avoid buffer loss.
     if (queueOutput.bufferReplaced) {
+        mOutputStats[output].replacedFrames++;
         onBufferReleasedByOutputLocked(output);
     }
 
@@ -281,15 +293,7 @@ status_t Camera3StreamSplitter::notifyBufferReleased(const sp<GraphicBuffer>& bu
     std::unique_ptr<BufferTracker> tracker_ptr = std::move(mBuffers[bufferId]);
     mBuffers.erase(bufferId);
 
-    for (const auto surface : tracker_ptr->requestedSurfaces()) {
-        sp<IGraphicBufferProducer>& gbp = mOutputs[surface];
-        OutputSlots& outputSlots = *(mOutputSlots[gbp]);
-        int slot = getSlotForOutputLocked(gbp, buffer);
-        if (slot != BufferItem::INVALID_BUFFER_SLOT) {
-             gbp->detachBuffer(slot);
-             outputSlots[slot].clear();
-        }
-    }
+    detachBufferFromOutputsLocked(buffer, tracker_ptr->requestedSurfaces());
 
     return res;
 }
@@ -304,11 +308,12 @@ status_t Camera3StreamSplitter::attachBufferToOutputs(ANativeWindowBuffer* anb,
     sp<GraphicBuffer> gb(static_cast<GraphicBuffer*>(anb));
     uint64_t bufferId = gb->getId();
 
-    // Initialize buffer tracker for this input buffer
-    auto tracker = std::make_unique<BufferTracker>(gb, surface_ids);
+    // Outputs the buffer got attached to
+    std::vector<size_t> attachedSurfaces;
+    status_t dropRes = OK;
 
     for (auto& surface_id : surface_ids) {
-        sp<IGraphicBufferProducer>& gbp = mOutputs[surface_id];
+        sp<IGraphicBufferProducer> gbp = mOutputs[surface_id];
         int slot = BufferItem::INVALID_BUFFER_SLOT;
         //Temporarly Unlock the mutex when trying to attachBuffer to the output
         //queue, because attachBuffer could block in case of a slow consumer. If
@@ -317,9 +322,19 @@ status_t Camera3StreamSplitter::attachBufferToOutputs(ANativeWindowBuffer* anb,
         mMutex.unlock();
         res = gbp->attachBuffer(&slot, gb);
         mMutex.lock();
+        if ((res == TIMED_OUT || res == WOULD_BLOCK) && surface_ids.size() > 1) {
+            // The consumer of this output can't keep up. Drop the frame for it
+            // rather than failing the request for the other outputs too.
+            SP_LOGW("%s: Output %p has no free slot, dropping frame: %s (%d)",
+                    __FUNCTION__, gbp.get(), strerror(-res), res);
+            mOutputStats[gbp].droppedFrames++;
+            dropRes = res;
+            continue;
+        }
         if (res != OK) {
             SP_LOGE("%s: Cannot acquireBuffer from GraphicBufferProducer %p: %s (%d)",
                     __FUNCTION__, gbp.get(), strerror(-res), res);
+            detachBufferFromOutputsLocked(gb, attachedSurfaces);
             return res;
         }
         auto& outputSlots = *mOutputSlots[gbp];
@@ -332,11 +347,51 @@ status_t Camera3StreamSplitter::attachBufferToOutputs(ANativeWindowBuffer* anb,
         SP_LOGV("%s: Attached buffer %p to slot %d on output %p.",__FUNCTION__, gb.get(),
                 slot, gbp.get());
         outputSlots[slot] = gb;
+        attachedSurfaces.push_back(surface_id);
     }
 
-    mBuffers[bufferId] = std::move(tracker);
+    if (attachedSurfaces.empty()) {
+        SP_LOGE("%s: Buffer %p couldn't be attached to any output", __FUNCTION__, gb.get());
+        return dropRes;
+    }
 
-    return res;
+    // Initialize buffer tracker for this input buffer
+    mBuffers[bufferId] = std::make_unique<BufferTracker>(gb, attachedSurfaces);
+
+    return OK;
+}
+
+void Camera3StreamSplitter::detachBufferFromOutputsLocked(const sp<GraphicBuffer>& gb,
+        const std::vector<size_t>& surface_ids) {
+    for (const auto surface_id : surface_ids) {
+        sp<IGraphicBufferProducer>& gbp = mOutputs[surface_id];
+        OutputSlots& outputSlots = *(mOutputSlots[gbp]);
+        int slot = getSlotForOutputLocked(gbp, gb);
+        if (slot != BufferItem::INVALID_BUFFER_SLOT) {
+             gbp->detachBuffer(slot);
+             outputSlots[slot].clear();
+        }
+    }
+}
+
+void Camera3StreamSplitter::dump(int fd) {
+    Mutex::Autolock lock(mMutex);
+
+    String8 lines = String8::format("      Stream splitter %s outputs:\n", mConsumerName.string());
+    for (size_t i = 0; i < mOutputs.size(); i++) {
+        auto it = mOutputStats.find(mOutputs[i]);
+        if (it == mOutputStats.end()) {
+            continue;
+        }
+        const OutputStats& stats = it->second;
+        double avgHoldMs = (stats.releasedFrames == 0) ? 0 :
+                stats.totalHoldNs / 1000000.0 / stats.releasedFrames;
+        lines.appendFormat("        Output %zu: %zu frames queued, %zu dropped, %zu replaced, "
+                "hold time avg %.2f ms, max %.2f ms\n", i, stats.queuedFrames,
+                stats.droppedFrames, stats.replacedFrames, avgHoldMs,
+                stats.maxHoldNs / 1000000.0);
+    }
+    write(fd, lines.string(), lines.size());
 }
 
 void Camera3StreamSplitter::onFrameAvailable(const BufferItem& /*item*/) {
@@ -475,6 +530,16 @@ void Camera3StreamSplitter::onBufferReleasedByOutputLocked(
     SP_LOGV("detached buffer %" PRId64 " %p from output %p",
             buffer->getId(), buffer.get(), from.get());
 
+    OutputStats& stats = mOutputStats[from];
+    auto queueTime = stats.queueTimes.find(buffer->getId());
+    if (queueTime != stats.queueTimes.end()) {
+        nsecs_t holdNs = systemTime() - queueTime->second;
+        stats.queueTimes.erase(queueTime);
+        stats.releasedFrames++;
+        stats.totalHoldNs += holdNs;
+        stats.maxHoldNs = std::max(stats.maxHoldNs, holdNs);
+    }
+
     // Check to see if this is the last outstanding reference to this buffer
     decrementBufRefCountLocked(buffer->getId(), from);
 }
@@ -75,6 +75,10 @@ public:
 
     // Attach a buffer to the specified outputs. This call reserves a buffer
     // slot in the output queue.
+    //
+    // If an output has no free slot within its dequeue timeout, the frame is
+    // dropped for that output only, as long as at least one of the other
+    // outputs gets it. This way a slow consumer doesn't fail the whole request.
     status_t attachBufferToOutputs(ANativeWindowBuffer* anb,
             const std::vector<size_t>& surface_ids);
 
@@ -86,6 +90,9 @@ public:
     // Disconnect the buffer queue from output surfaces.
     void disconnect();
 
+    // Dump the frame and hold time statistics of each output.
+    void dump(int fd);
+
 private:
     // From IConsumerListener
     //
@@ -193,6 +200,10 @@ private:
 
     status_t addOutputLocked(const sp<Surface>& outputQueue);
 
+    // Detach a buffer from the given outputs, and free up the slots it used.
+    void detachBufferFromOutputsLocked(const sp<GraphicBuffer>& gb,
+            const std::vector<size_t>& surface_ids);
+
     // Send a buffer to particular output, and increment the reference count
     // of the buffer. If this output is abandoned, the buffer's reference count
     // won't be incremented.
@@ -242,6 +253,22 @@ private:
     std::unordered_map<sp<IGraphicBufferProducer>, std::unique_ptr<OutputSlots>,
             GBPHash> mOutputSlots;
 
+    struct OutputStats {
+        // Frames queued to the output
+        size_t queuedFrames = 0;
+        // Frames not sent to the output because it had no free slot in time
+        size_t droppedFrames = 0;
+        // Queued frames replaced by a newer one before the consumer acquired them
+        size_t replacedFrames = 0;
+        // Time from queueing a buffer to the output until the consumer releases it
+        size_t releasedFrames = 0;
+        nsecs_t totalHoldNs = 0;
+        nsecs_t maxHoldNs = 0;
+        // Queue time of the buffers held by the output, by GraphicBuffer ID
+        std::unordered_map<uint64_t, nsecs_t> queueTimes;
+    };
+    std::unordered_map<sp<IGraphicBufferProducer>, OutputStats, GBPHash> mOutputStats;
+
     // Latest onFrameAvailable return value
     std::atomic<status_t> mOnFrameAvailableRes{0};
 
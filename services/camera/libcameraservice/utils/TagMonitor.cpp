@@ -115,11 +115,7 @@ void TagMonitor::monitorMetadata(eventSource source, int64_t frameNumber, nsecs_
                 mLastMonitoredRequestValues : mLastMonitoredResultValues;
         if (lastValues.isEmpty()) {
             lastValues = CameraMetadata(mMonitoredTagList.size());
-            const camera_metadata_t *metaBuffer =
-                    lastValues.getAndLock();
-            set_camera_metadata_vendor_id(
-                    const_cast<camera_metadata_t *> (metaBuffer), mVendorTagId);
-            lastValues.unlock(metaBuffer);
+            lastValues.setVendorId(mVendorTagId);
         }
 
         camera_metadata_entry lastEntry = lastValues.find(tag);
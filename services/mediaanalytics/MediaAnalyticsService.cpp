@@ -89,6 +89,8 @@ static const nsecs_t kNewSetIntervalNs = 3600*(1000*1000*1000ll);
 static const int kMaxRecordSets = 48;
 // individual records kept in memory
 static const int kMaxRecords    = 100;
+// finalized records waiting for the summarizer thread
+static const size_t kMaxPendingSummaries = 1000;
 
 
 static const char *kServiceName = "media.metrics";
@@ -167,15 +169,35 @@ MediaAnalyticsService::MediaAnalyticsService()
     mItemsSubmitted = 0;
     mItemsFinalized = 0;
     mItemsDiscarded = 0;
+    mSetsDiscarded = 0;
+    mSummariesDropped = 0;
 
     mLastSessionID = 0;
     // recover any persistency we set up
     // etc
+
+    mPendingSummaries = new List<MediaAnalyticsItem *>();
+    mStopping = false;
+    mSummarizerThread = new SummarizerThread(this);
+    mSummarizerThread->run("MediaAnalyticsSummarizer", PRIORITY_BACKGROUND);
 }
 
 MediaAnalyticsService::~MediaAnalyticsService() {
         ALOGD("MediaAnalyticsService destroyed");
 
+    {
+        Mutex::Autolock _l(mLock);
+        mStopping = true;
+        mPendingSummariesCond.signal();
+    }
+    mSummarizerThread->requestExitAndWait();
+    while (mPendingSummaries->size() > 0) {
+        delete *(mPendingSummaries->begin());
+        mPendingSummaries->erase(mPendingSummaries->begin());
+    }
+    delete mPendingSummaries;
+    mPendingSummaries = NULL;
+
     // clean out mOpen and mFinalized
     delete mOpen;
     mOpen = NULL;
@@ -234,6 +256,8 @@ MediaAnalyticsItem::SessionID_t MediaAnalyticsService::submit(MediaAnalyticsItem
     }
 
 
+    Mutex::Autolock _l(mLock);
+
     mItemsSubmitted++;
 
     // validate the record; we discard if we don't like it
@@ -270,12 +294,12 @@ MediaAnalyticsItem::SessionID_t MediaAnalyticsService::submit(MediaAnalyticsItem
                 oitem = NULL;
             } else {
                 oitem->setFinalized(true);
-                summarize(oitem);
+                queueSummary(oitem);
                 saveItem(mFinalized, oitem, 0);
             }
             // new record could itself be marked finalized...
             if (finalizing) {
-                summarize(item);
+                queueSummary(item);
                 saveItem(mFinalized, item, 0);
                 mItemsFinalized++;
             } else {
@@ -286,7 +310,7 @@ MediaAnalyticsItem::SessionID_t MediaAnalyticsService::submit(MediaAnalyticsItem
             // combine the records, send it to finalized if appropriate
             oitem->merge(item);
             if (finalizing) {
-                summarize(oitem);
+                queueSummary(oitem);
                 saveItem(mFinalized, oitem, 0);
                 mItemsFinalized++;
             }
@@ -305,7 +329,7 @@ MediaAnalyticsItem::SessionID_t MediaAnalyticsService::submit(MediaAnalyticsItem
                 delete item;
                 item = NULL;
             } else {
-                summarize(item);
+                queueSummary(item);
                 saveItem(mFinalized, item, 0);
                 mItemsFinalized++;
             }
@@ -316,6 +340,13 @@ MediaAnalyticsItem::SessionID_t MediaAnalyticsService::submit(MediaAnalyticsItem
     return id;
 }
 
+// caller surrenders ownership of the items
+void MediaAnalyticsService::submitBatch(const Vector<MediaAnalyticsItem *> &items, bool forcenew) {
+    for (size_t i = 0; i < items.size(); i++) {
+        submit(items[i], forcenew);
+    }
+}
+
 status_t MediaAnalyticsService::dump(int fd, const Vector<String16>& args)
 {
     const size_t SIZE = 512;
@@ -391,6 +422,7 @@ status_t MediaAnalyticsService::dump(int fd, const Vector<String16>& args)
     }
 
     Mutex::Autolock _l(mLock);
+    Mutex::Autolock _ls(mLock_summaries);
 
     // we ALWAYS dump this piece
     snprintf(buffer, SIZE, "Dump of the %s process:\n", kServiceName);
@@ -445,6 +477,10 @@ void MediaAnalyticsService::dumpHeaders(String8 &result, nsecs_t ts_since) {
     snprintf(buffer, SIZE,
         "Summary Sets Discarded: %" PRId64 "\n", mSetsDiscarded);
     result.append(buffer);
+    snprintf(buffer, SIZE,
+        "Summaries Pending: %zu Dropped: %" PRId64 "\n",
+        mPendingSummaries->size(), mSummariesDropped);
+    result.append(buffer);
     if (ts_since != 0) {
         snprintf(buffer, SIZE,
             "Dumping Queue entries more recent than: %" PRId64 "\n",
@@ -538,10 +574,9 @@ String8 MediaAnalyticsService::dumpQueue(List<MediaAnalyticsItem *> *theList, ns
 // XXX: rewrite this to manage persistence, etc.
 
 // insert appropriately into queue
+// caller has locked mLock...
 void MediaAnalyticsService::saveItem(List<MediaAnalyticsItem *> *l, MediaAnalyticsItem * item, int front) {
 
-    Mutex::Autolock _l(mLock);
-
     // adding at back of queue (fifo order)
     if (front)  {
         l->push_front(item);
@@ -604,8 +639,7 @@ MediaAnalyticsItem *MediaAnalyticsService::findItem(List<MediaAnalyticsItem*> *t
 
     MediaAnalyticsItem *item = NULL;
 
-    Mutex::Autolock _l(mLock);
-
+    // caller has locked mLock...
     for (List<MediaAnalyticsItem *>::iterator it = theList->begin();
         it != theList->end(); it++) {
         MediaAnalyticsItem *tmp = (*it);
@@ -679,8 +713,64 @@ bool MediaAnalyticsService::rateLimited(MediaAnalyticsItem *) {
     return false;
 }
 
+// hand a copy of a finalized record to the summarizer thread
+// caller has locked mLock...
+void MediaAnalyticsService::queueSummary(MediaAnalyticsItem *item) {
+
+    if (item == NULL) {
+        return;
+    }
+
+    if (mPendingSummaries->size() >= kMaxPendingSummaries) {
+        // the summarizer can't keep up; don't let the backlog grow without bound
+        mSummariesDropped++;
+        return;
+    }
+
+    MediaAnalyticsItem *copy = item->dup();
+    if (copy == NULL) {
+        ALOGE("unable to queue MediaMetrics record for summary");
+        return;
+    }
+    mPendingSummaries->push_back(copy);
+    mPendingSummariesCond.signal();
+}
+
+bool MediaAnalyticsService::summarizePending() {
+
+    List<MediaAnalyticsItem *> *pending;
+    {
+        Mutex::Autolock _l(mLock);
+        while (mPendingSummaries->empty() && !mStopping) {
+            mPendingSummariesCond.wait(mLock);
+        }
+        if (mStopping) {
+            return false;
+        }
+        // take the whole batch, so submitters only wait for the swap
+        pending = mPendingSummaries;
+        mPendingSummaries = new List<MediaAnalyticsItem *>();
+    }
+
+    {
+        Mutex::Autolock _l(mLock_summaries);
+        for (List<MediaAnalyticsItem *>::iterator it = pending->begin();
+            it != pending->end(); it++) {
+            summarize(*it);
+        }
+    }
+
+    while (pending->size() > 0) {
+        delete *(pending->begin());
+        pending->erase(pending->begin());
+    }
+    delete pending;
+    return true;
+}
+
 // insert into the appropriate summarizer.
 // we make our own copy to save/summarize
+// caller has locked mLock_summaries...
 void MediaAnalyticsService::summarize(MediaAnalyticsItem *item) {
 
     ALOGV("MediaAnalyticsService::summarize()");
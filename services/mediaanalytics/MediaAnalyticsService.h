@@ -40,6 +40,7 @@ class MediaAnalyticsService : public BnMediaAnalyticsService
 
     // on this side, caller surrenders ownership
     virtual int64_t submit(MediaAnalyticsItem *item, bool forcenew);
+    virtual void submitBatch(const Vector<MediaAnalyticsItem *> &items, bool forcenew);
 
     static  void            instantiate();
     virtual status_t        dump(int fd, const Vector<String16>& args);
@@ -55,11 +56,14 @@ class MediaAnalyticsService : public BnMediaAnalyticsService
     int64_t mItemsFinalized;
     int64_t mItemsDiscarded;
     int64_t mSetsDiscarded;
+    int64_t mSummariesDropped;
     MediaAnalyticsItem::SessionID_t mLastSessionID;
 
     // partitioned a bit so we don't over serialize
+    // when both are needed, mLock is taken before mLock_summaries
     mutable Mutex           mLock;
     mutable Mutex           mLock_ids;
+    mutable Mutex           mLock_summaries;
 
     // the most we hold in memory
     // up to this many in each queue (open, finalized)
@@ -83,7 +87,28 @@ class MediaAnalyticsService : public BnMediaAnalyticsService
     MediaAnalyticsItem *findItem(List<MediaAnalyticsItem *> *,
                                      MediaAnalyticsItem *, bool removeit);
 
-    // summarizers
+    // finalized records waiting to be summarized, oldest at front.
+    // copies, owned by the queue; protected by mLock.
+    List<MediaAnalyticsItem *> *mPendingSummaries;
+    Condition mPendingSummariesCond;
+    bool mStopping;
+    void queueSummary(MediaAnalyticsItem *item);
+    // waits for and summarizes pending records; false once we're stopping
+    bool summarizePending();
+
+    // summarizes records off the binder threads, so that submit()
+    // doesn't wait on the summarizer scans.
+    class SummarizerThread : public Thread {
+      public:
+        explicit SummarizerThread(MediaAnalyticsService *service)
+            : Thread(false /* canCallJava */), mService(service) {}
+      private:
+        virtual bool threadLoop() { return mService->summarizePending(); }
+        MediaAnalyticsService *mService;
+    };
+    sp<SummarizerThread> mSummarizerThread;
+
+    // summarizers, protected by mLock_summaries
     void summarize(MediaAnalyticsItem *item);
     class SummarizerSet {
         nsecs_t mStarted;
@@ -32,7 +32,7 @@ MediaLogService::MediaLogService() :
     mMergerShared((NBLog::Shared*) malloc(NBLog::Timeline::sharedSize(kMergeBufferSize))),
     mMerger(mMergerShared, kMergeBufferSize),
     mMergeReader(mMergerShared, kMergeBufferSize, mMerger),
-    mMergeThread(new NBLog::MergeThread(mMerger))
+    mMergeThread(new NBLog::MergeThread(mMerger, mMergeReader))
 {
     mMergeThread->run("MergeThread");
 }
@@ -87,7 +87,7 @@ bool MediaLogService::dumpTryLock(Mutex& mutex)
     return locked;
 }
 
-status_t MediaLogService::dump(int fd, const Vector<String16>& args __unused)
+status_t MediaLogService::dump(int fd, const Vector<String16>& args)
 {
     // FIXME merge with similar but not identical code at services/audioflinger/ServiceUtilities.cpp
     static const String16 sDump("android.permission.DUMP");
@@ -128,8 +128,26 @@ status_t MediaLogService::dump(int fd, const Vector<String16>& args __unused)
         mLock.unlock();
     }
 #endif
+    // --last-ms <ms> limits the merged log to its most recent <ms> milliseconds,
+    // --raw writes the merged log in its binary format instead of text, for offline analysis
+    int64_t windowNs = 0;
+    bool raw = false;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == String16("--raw")) {
+            raw = true;
+        } else if (args[i] == String16("--last-ms") && i + 1 < args.size()) {
+            windowNs = (int64_t) atoi(String8(args[++i]).string()) * 1000000;
+        }
+    }
+
     // FIXME request merge to make sure log is up to date
-    mMergeReader.dump(fd);
+    mMergeReader.updateHistory();
+    if (raw) {
+        mMergeReader.dumpHistoryRaw(fd);
+        return NO_ERROR;
+    }
+    mMergeReader.dumpHistory(fd, 0 /*indent*/, windowNs);
+    mMergeReader.dumpAnalysis(fd);
     return NO_ERROR;
 }
 
@@ -146,12 +146,18 @@ status_t ResourceManagerService::dump(int fd, const Vector<String16>& /* args */
     bool supportsMultipleSecureCodecs;
     bool supportsSecureWithNonSecureCodec;
     String8 serviceLog;
+    size_t reclaimCount;
+    nsecs_t reclaimTotalNs;
+    nsecs_t reclaimMaxNs;
     {
         Mutex::Autolock lock(mLock);
         mapCopy = mMap;  // Shadow copy, real copy will happen on write.
         supportsMultipleSecureCodecs = mSupportsMultipleSecureCodecs;
         supportsSecureWithNonSecureCodec = mSupportsSecureWithNonSecureCodec;
         serviceLog = mServiceLog->toString("    " /* linePrefix */);
+        reclaimCount = mReclaimCount;
+        reclaimTotalNs = mReclaimTotalNs;
+        reclaimMaxNs = mReclaimMaxNs;
     }
 
     const size_t SIZE = 256;
@@ -187,6 +193,14 @@ status_t ResourceManagerService::dump(int fd, const Vector<String16>& /* args */
             }
         }
     }
+    result.append("  Reclaims:\n");
+    snprintf(buffer, SIZE, "    Count: %zu\n", reclaimCount);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "    Client selection time: avg %lld us, max %lld us\n",
+            reclaimCount > 0 ? (long long)(reclaimTotalNs / reclaimCount / 1000) : 0ll,
+            (long long)(reclaimMaxNs / 1000));
+    result.append(buffer);
+
     result.append("  Events logs (most recent at top):\n");
     result.append(serviceLog);
 
@@ -201,7 +215,10 @@ ResourceManagerService::ResourceManagerService(sp<ProcessInfoInterface> processI
     : mProcessInfo(processInfo),
       mServiceLog(new ServiceLog()),
       mSupportsMultipleSecureCodecs(true),
-      mSupportsSecureWithNonSecureCodec(true) {}
+      mSupportsSecureWithNonSecureCodec(true),
+      mReclaimCount(0),
+      mReclaimTotalNs(0),
+      mReclaimMaxNs(0) {}
 
 ResourceManagerService::~ResourceManagerService() {}
 
@@ -243,6 +260,7 @@ void ResourceManagerService::addResource(
         info.deathNotifier = new DeathNotifier(this, pid, clientId);
         IInterface::asBinder(client)->linkToDeath(info.deathNotifier);
     }
+    updateTypePids_l(pid);
     notifyResourceGranted(pid, resources);
 }
 
@@ -278,6 +296,8 @@ void ResourceManagerService::removeResource(int pid, int64_t clientId, bool chec
     }
     if (!found) {
         ALOGV("didn't find client");
+    } else {
+        updateTypePids_l(pid);
     }
 }
 
@@ -292,6 +312,69 @@ void ResourceManagerService::getClientForResource_l(
     }
 }
 
+bool ResourceManagerService::getClientsToReclaim_l(
+        int callingPid, const Vector<MediaResource> &resources,
+        Vector<sp<IResourceManagerClient>> *clients) {
+    const MediaResource *secureCodec = NULL;
+    const MediaResource *nonSecureCodec = NULL;
+    const MediaResource *graphicMemory = NULL;
+    for (size_t i = 0; i < resources.size(); ++i) {
+        MediaResource::Type type = resources[i].mType;
+        if (resources[i].mType == MediaResource::kSecureCodec) {
+            secureCodec = &resources[i];
+        } else if (type == MediaResource::kNonSecureCodec) {
+            nonSecureCodec = &resources[i];
+        } else if (type == MediaResource::kGraphicMemory) {
+            graphicMemory = &resources[i];
+        }
+    }
+
+    // first pass to handle secure/non-secure codec conflict
+    if (secureCodec != NULL) {
+        if (!mSupportsMultipleSecureCodecs) {
+            if (!getAllClients_l(callingPid, MediaResource::kSecureCodec, clients)) {
+                return false;
+            }
+        }
+        if (!mSupportsSecureWithNonSecureCodec) {
+            if (!getAllClients_l(callingPid, MediaResource::kNonSecureCodec, clients)) {
+                return false;
+            }
+        }
+    }
+    if (nonSecureCodec != NULL) {
+        if (!mSupportsSecureWithNonSecureCodec) {
+            if (!getAllClients_l(callingPid, MediaResource::kSecureCodec, clients)) {
+                return false;
+            }
+        }
+    }
+
+    if (clients->size() == 0) {
+        // if no secure/non-secure codec conflict, run second pass to handle other resources.
+        getClientForResource_l(callingPid, graphicMemory, clients);
+    }
+
+    if (clients->size() == 0) {
+        // if we are here, run the third pass to free one codec with the same type.
+        getClientForResource_l(callingPid, secureCodec, clients);
+        getClientForResource_l(callingPid, nonSecureCodec, clients);
+    }
+
+    if (clients->size() == 0) {
+        // if we are here, run the fourth pass to free one codec with the different type.
+        if (secureCodec != NULL) {
+            MediaResource temp(MediaResource::kNonSecureCodec, 1);
+            getClientForResource_l(callingPid, &temp, clients);
+        }
+        if (nonSecureCodec != NULL) {
+            MediaResource temp(MediaResource::kSecureCodec, 1);
+            getClientForResource_l(callingPid, &temp, clients);
+        }
+    }
+    return true;
+}
+
 bool ResourceManagerService::reclaimResource(
         int callingPid, const Vector<MediaResource> &resources) {
     String8 log = String8::format("reclaimResource(callingPid %d, resources %s)",
@@ -305,62 +388,18 @@ bool ResourceManagerService::reclaimResource(
             ALOGE("Rejected reclaimResource call with invalid callingPid.");
             return false;
         }
-        const MediaResource *secureCodec = NULL;
-        const MediaResource *nonSecureCodec = NULL;
-        const MediaResource *graphicMemory = NULL;
-        for (size_t i = 0; i < resources.size(); ++i) {
-            MediaResource::Type type = resources[i].mType;
-            if (resources[i].mType == MediaResource::kSecureCodec) {
-                secureCodec = &resources[i];
-            } else if (type == MediaResource::kNonSecureCodec) {
-                nonSecureCodec = &resources[i];
-            } else if (type == MediaResource::kGraphicMemory) {
-                graphicMemory = &resources[i];
-            }
+        // priorities may have changed since the last reclaim
+        mPriorityCache.clear();
+        nsecs_t startNs = systemTime();
+        bool canReclaim = getClientsToReclaim_l(callingPid, resources, &clients);
+        nsecs_t elapsedNs = systemTime() - startNs;
+        ++mReclaimCount;
+        mReclaimTotalNs += elapsedNs;
+        if (elapsedNs > mReclaimMaxNs) {
+            mReclaimMaxNs = elapsedNs;
         }
-
-        // first pass to handle secure/non-secure codec conflict
-        if (secureCodec != NULL) {
-            if (!mSupportsMultipleSecureCodecs) {
-                if (!getAllClients_l(callingPid, MediaResource::kSecureCodec, &clients)) {
-                    return false;
-                }
-            }
-            if (!mSupportsSecureWithNonSecureCodec) {
-                if (!getAllClients_l(callingPid, MediaResource::kNonSecureCodec, &clients)) {
-                    return false;
-                }
-            }
-        }
-        if (nonSecureCodec != NULL) {
-            if (!mSupportsSecureWithNonSecureCodec) {
-                if (!getAllClients_l(callingPid, MediaResource::kSecureCodec, &clients)) {
-                    return false;
-                }
-            }
-        }
-
-        if (clients.size() == 0) {
-            // if no secure/non-secure codec conflict, run second pass to handle other resources.
-            getClientForResource_l(callingPid, graphicMemory, &clients);
-        }
-
-        if (clients.size() == 0) {
-            // if we are here, run the third pass to free one codec with the same type.
-            getClientForResource_l(callingPid, secureCodec, &clients);
-            getClientForResource_l(callingPid, nonSecureCodec, &clients);
-        }
-
-        if (clients.size() == 0) {
-            // if we are here, run the fourth pass to free one codec with the different type.
-            if (secureCodec != NULL) {
-                MediaResource temp(MediaResource::kNonSecureCodec, 1);
-                getClientForResource_l(callingPid, &temp, &clients);
-            }
-            if (nonSecureCodec != NULL) {
-                MediaResource temp(MediaResource::kSecureCodec, 1);
-                getClientForResource_l(callingPid, &temp, &clients);
-            }
+        if (!canReclaim) {
+            return false;
         }
     }
 
@@ -396,6 +435,7 @@ bool ResourceManagerService::reclaimResource(
                 }
             }
             if (found) {
+                updateTypePids_l(mMap.keyAt(i));
                 break;
             }
         }
@@ -410,18 +450,23 @@ bool ResourceManagerService::reclaimResource(
 bool ResourceManagerService::getAllClients_l(
         int callingPid, MediaResource::Type type, Vector<sp<IResourceManagerClient>> *clients) {
     Vector<sp<IResourceManagerClient>> temp;
-    for (size_t i = 0; i < mMap.size(); ++i) {
-        ResourceInfos &infos = mMap.editValueAt(i);
-        for (size_t j = 0; j < infos.size(); ++j) {
-            if (hasResourceType(type, infos[j].resources)) {
-                if (!isCallingPriorityHigher_l(callingPid, mMap.keyAt(i))) {
-                    // some higher/equal priority process owns the resource,
-                    // this request can't be fulfilled.
-                    ALOGE("getAllClients_l: can't reclaim resource %s from pid %d",
-                            asString(type), mMap.keyAt(i));
-                    return false;
+    ssize_t typeIndex = mTypePids.indexOfKey(type);
+    if (typeIndex >= 0) {
+        const SortedVector<int> &pids = mTypePids.valueAt(typeIndex);
+        for (size_t i = 0; i < pids.size(); ++i) {
+            int pid = pids[i];
+            if (!isCallingPriorityHigher_l(callingPid, pid)) {
+                // some higher/equal priority process owns the resource,
+                // this request can't be fulfilled.
+                ALOGE("getAllClients_l: can't reclaim resource %s from pid %d",
+                        asString(type), pid);
+                return false;
+            }
+            const ResourceInfos &infos = mMap.valueFor(pid);
+            for (size_t j = 0; j < infos.size(); ++j) {
+                if (hasResourceType(type, infos[j].resources)) {
+                    temp.push_back(infos[j].client);
                 }
-                temp.push_back(infos[j].client);
             }
         }
     }
@@ -438,7 +483,7 @@ bool ResourceManagerService::getLowestPriorityBiggestClient_l(
     int lowestPriorityPid;
     int lowestPriority;
     int callingPriority;
-    if (!mProcessInfo->getPriority(callingPid, &callingPriority)) {
+    if (!getPriority_l(callingPid, &callingPriority)) {
         ALOGE("getLowestPriorityBiggestClient_l: can't get process priority for pid %d",
                 callingPid);
         return false;
@@ -462,18 +507,16 @@ bool ResourceManagerService::getLowestPriorityPid_l(
         MediaResource::Type type, int *lowestPriorityPid, int *lowestPriority) {
     int pid = -1;
     int priority = -1;
-    for (size_t i = 0; i < mMap.size(); ++i) {
-        if (mMap.valueAt(i).size() == 0) {
-            // no client on this process.
-            continue;
-        }
-        if (!hasResourceType(type, mMap.valueAt(i))) {
-            // doesn't have the requested resource type
-            continue;
-        }
-        int tempPid = mMap.keyAt(i);
+    ssize_t typeIndex = mTypePids.indexOfKey(type);
+    if (typeIndex < 0) {
+        // no process has the requested resource type
+        return false;
+    }
+    const SortedVector<int> &pids = mTypePids.valueAt(typeIndex);
+    for (size_t i = 0; i < pids.size(); ++i) {
+        int tempPid = pids[i];
         int tempPriority;
-        if (!mProcessInfo->getPriority(tempPid, &tempPriority)) {
+        if (!getPriority_l(tempPid, &tempPriority)) {
             ALOGV("getLowestPriorityPid_l: can't get priority of pid %d, skipped", tempPid);
             // TODO: remove this pid from mMap?
             continue;
@@ -493,18 +536,52 @@ bool ResourceManagerService::getLowestPriorityPid_l(
 
 bool ResourceManagerService::isCallingPriorityHigher_l(int callingPid, int pid) {
     int callingPidPriority;
-    if (!mProcessInfo->getPriority(callingPid, &callingPidPriority)) {
+    if (!getPriority_l(callingPid, &callingPidPriority)) {
         return false;
     }
 
     int priority;
-    if (!mProcessInfo->getPriority(pid, &priority)) {
+    if (!getPriority_l(pid, &priority)) {
         return false;
     }
 
     return (callingPidPriority < priority);
 }
 
+bool ResourceManagerService::getPriority_l(int pid, int *priority) {
+    ssize_t index = mPriorityCache.indexOfKey(pid);
+    if (index >= 0) {
+        *priority = mPriorityCache.valueAt(index);
+        return true;
+    }
+    if (!mProcessInfo->getPriority(pid, priority)) {
+        return false;
+    }
+    mPriorityCache.add(pid, *priority);
+    return true;
+}
+
+void ResourceManagerService::updateTypePids_l(int pid) {
+    for (size_t i = 0; i < mTypePids.size(); ++i) {
+        mTypePids.editValueAt(i).remove(pid);
+    }
+    ssize_t index = mMap.indexOfKey(pid);
+    if (index < 0) {
+        return;
+    }
+    const ResourceInfos &infos = mMap.valueAt(index);
+    for (size_t i = 0; i < infos.size(); ++i) {
+        const Vector<MediaResource> &resources = infos[i].resources;
+        for (size_t j = 0; j < resources.size(); ++j) {
+            ssize_t typeIndex = mTypePids.indexOfKey(resources[j].mType);
+            if (typeIndex < 0) {
+                typeIndex = mTypePids.add(resources[j].mType, SortedVector<int>());
+            }
+            mTypePids.editValueAt(typeIndex).add(pid);
+        }
+    }
+}
+
 bool ResourceManagerService::getBiggestClient_l(
         int pid, MediaResource::Type type, sp<IResourceManagerClient> *client) {
     ssize_t index = mMap.indexOfKey(pid);
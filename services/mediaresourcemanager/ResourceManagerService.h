@@ -22,6 +22,7 @@
 #include <binder/BinderService.h>
 #include <utils/Errors.h>
 #include <utils/KeyedVector.h>
+#include <utils/SortedVector.h>
 #include <utils/String8.h>
 #include <utils/threads.h>
 #include <utils/Vector.h>
@@ -42,6 +43,8 @@ struct ResourceInfo {
 
 typedef Vector<ResourceInfo> ResourceInfos;
 typedef KeyedVector<int, ResourceInfos> PidResourceInfosMap;
+typedef KeyedVector<int /* MediaResource::Type */, SortedVector<int>> TypePidsMap;
+typedef KeyedVector<int, int> PidPriorityMap;
 
 class ResourceManagerService
     : public BinderService<ResourceManagerService>,
@@ -101,6 +104,18 @@ private:
 
     bool isCallingPriorityHigher_l(int callingPid, int pid);
 
+    // Gets the priority of pid. Priorities are cached until the next reclaim, as a reclaim
+    // queries the same processes several times.
+    bool getPriority_l(int pid, int *priority);
+
+    // Updates mTypePids after the resources of pid have changed.
+    void updateTypePids_l(int pid);
+
+    // Gets the clients to reclaim the requested resources from.
+    // Returns false if the resources can't be reclaimed.
+    bool getClientsToReclaim_l(int callingPid, const Vector<MediaResource> &resources,
+            Vector<sp<IResourceManagerClient>> *clients);
+
     // A helper function basically calls getLowestPriorityBiggestClient_l and add the result client
     // to the given Vector.
     void getClientForResource_l(
@@ -110,6 +125,12 @@ private:
     sp<ProcessInfoInterface> mProcessInfo;
     sp<ServiceLog> mServiceLog;
     PidResourceInfosMap mMap;
+    // The pids that own each type of resource, so that a reclaim only visits those.
+    TypePidsMap mTypePids;
+    PidPriorityMap mPriorityCache;
+    size_t mReclaimCount;
+    nsecs_t mReclaimTotalNs;
+    nsecs_t mReclaimMaxNs;
     bool mSupportsMultipleSecureCodecs;
     bool mSupportsSecureWithNonSecureCodec;
 };
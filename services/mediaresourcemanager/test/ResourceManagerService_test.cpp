@@ -232,6 +232,15 @@ protected:
         EXPECT_EQ(1u, infos2.size());
         // mTestClient2 has been removed.
         EXPECT_EQ(mTestClient3, infos2[0].client);
+
+        // no process owns a non-secure codec anymore.
+        int pid;
+        int priority;
+        EXPECT_FALSE(mService->getLowestPriorityPid_l(
+                MediaResource::kNonSecureCodec, &pid, &priority));
+        EXPECT_TRUE(mService->getLowestPriorityPid_l(
+                MediaResource::kSecureCodec, &pid, &priority));
+        EXPECT_EQ(kTestPid1, pid);
     }
 
     void testGetAllClients() {
@@ -21,10 +21,53 @@
 #include <cstring>
 #include "AAudioMixer.h"
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AAUDIO_MIXER_USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define AAUDIO_MIXER_USE_SSE2
+#endif
+
 using android::WrappingBuffer;
 using android::FifoBuffer;
 using android::fifo_frames_t;
 
+#if defined(AAUDIO_MIXER_USE_NEON) || defined(AAUDIO_MIXER_USE_SSE2)
+
+// Mix 4 samples at a time with a gain per sample, which is advanced by gainStep
+// after each vector. Returns the number of samples mixed.
+static int32_t mixVectors(float *destination, const float *source, int32_t numSamples,
+                          const float gain[4], float gainStep, bool accumulate) {
+    const int32_t numVectorSamples = numSamples & ~3;
+#if defined(AAUDIO_MIXER_USE_NEON)
+    float32x4_t gains = vld1q_f32(gain);
+    const float32x4_t steps = vdupq_n_f32(gainStep);
+    for (int32_t i = 0; i < numVectorSamples; i += 4) {
+        float32x4_t samples = vmulq_f32(vld1q_f32(source + i), gains);
+        if (accumulate) {
+            samples = vaddq_f32(vld1q_f32(destination + i), samples);
+        }
+        vst1q_f32(destination + i, samples);
+        gains = vaddq_f32(gains, steps);
+    }
+#else
+    __m128 gains = _mm_loadu_ps(gain);
+    const __m128 steps = _mm_set1_ps(gainStep);
+    for (int32_t i = 0; i < numVectorSamples; i += 4) {
+        __m128 samples = _mm_mul_ps(_mm_loadu_ps(source + i), gains);
+        if (accumulate) {
+            samples = _mm_add_ps(_mm_loadu_ps(destination + i), samples);
+        }
+        _mm_storeu_ps(destination + i, samples);
+        gains = _mm_add_ps(gains, steps);
+    }
+#endif
+    return numVectorSamples;
+}
+
+#endif
+
 AAudioMixer::~AAudioMixer() {
     delete[] mOutputBuffer;
 }
@@ -35,16 +78,23 @@ void AAudioMixer::allocate(int32_t samplesPerFrame, int32_t framesPerBurst) {
     int32_t samplesPerBuffer = samplesPerFrame * framesPerBurst;
     mOutputBuffer = new float[samplesPerBuffer];
     mBufferSizeInBytes = samplesPerBuffer * sizeof(float);
+    mOutputEmpty = true;
 }
 
 void AAudioMixer::clear() {
-    memset(mOutputBuffer, 0, mBufferSizeInBytes);
+    mOutputEmpty = true;
 }
 
 bool AAudioMixer::mix(FifoBuffer *fifo, float volume) {
+    return mix(fifo, volume, volume);
+}
+
+bool AAudioMixer::mix(FifoBuffer *fifo, float volumeFrom, float volumeTo) {
     WrappingBuffer wrappingBuffer;
     float *destination = mOutputBuffer;
     fifo_frames_t framesLeft = mFramesPerBurst;
+    const float volumeIncrement = (volumeTo - volumeFrom) / mFramesPerBurst;
+    const bool accumulate = !mOutputEmpty;
 
     // Gather the data from the client. May be in two parts.
     fifo->getFullDataAvailable(&wrappingBuffer);
@@ -58,13 +108,20 @@ bool AAudioMixer::mix(FifoBuffer *fifo, float volume) {
             if (framesToMix > framesAvailable) {
                 framesToMix = framesAvailable;
             }
-            mixPart(destination, (float *)wrappingBuffer.data[partIndex], framesToMix, volume);
+            const float volume = volumeFrom + (mFramesPerBurst - framesLeft) * volumeIncrement;
+            mixPart(destination, (const float *)wrappingBuffer.data[partIndex], framesToMix,
+                    volume, volumeIncrement, accumulate);
 
             destination += framesToMix * mSamplesPerFrame;
             framesLeft -= framesToMix;
         }
         partIndex++;
     }
+    if (!accumulate && framesLeft > 0) {
+        // the first stream defines the whole burst
+        memset(destination, 0, framesLeft * mSamplesPerFrame * sizeof(float));
+    }
+    mOutputEmpty = false;
     fifo->getFifoControllerBase()->advanceReadIndex(mFramesPerBurst - framesLeft);
     if (framesLeft > 0) {
         //ALOGW("AAudioMixer::mix() UNDERFLOW by %d / %d frames ----- UNDERFLOW !!!!!!!!!!",
@@ -74,13 +131,47 @@ bool AAudioMixer::mix(FifoBuffer *fifo, float volume) {
 }
 
 void AAudioMixer::mixPart(float *destination, float *source, int32_t numFrames, float volume) {
-    int32_t numSamples = numFrames * mSamplesPerFrame;
-    // TODO maybe optimize using SIMD
-    for (int sampleIndex = 0; sampleIndex < numSamples; sampleIndex++) {
-        *destination++ += *source++ * volume;
+    mixPart(destination, source, numFrames, volume, 0.0f /* volumeIncrement */,
+            true /* accumulate */);
+}
+
+// The volume of frame i is volume + i * volumeIncrement.
+void AAudioMixer::mixPart(float *destination, const float *source, int32_t numFrames,
+                          float volume, float volumeIncrement, bool accumulate) {
+    const int32_t numSamples = numFrames * mSamplesPerFrame;
+    int32_t sampleIndex = 0;
+#if defined(AAUDIO_MIXER_USE_NEON) || defined(AAUDIO_MIXER_USE_SSE2)
+    if (volumeIncrement == 0.0f) {
+        const float gain[4] = { volume, volume, volume, volume };
+        sampleIndex = mixVectors(destination, source, numSamples, gain, 0.0f, accumulate);
+    } else if (mSamplesPerFrame == 1) {
+        const float gain[4] = { volume, volume + volumeIncrement,
+                                volume + 2 * volumeIncrement, volume + 3 * volumeIncrement };
+        sampleIndex = mixVectors(destination, source, numSamples, gain, 4 * volumeIncrement,
+                                 accumulate);
+    } else if (mSamplesPerFrame == 2) {
+        const float gain[4] = { volume, volume,
+                                volume + volumeIncrement, volume + volumeIncrement };
+        sampleIndex = mixVectors(destination, source, numSamples, gain, 2 * volumeIncrement,
+                                 accumulate);
+    }
+#endif
+    // Remaining samples, or all of them for other channel counts.
+    for (; sampleIndex < numSamples; sampleIndex++) {
+        const float gain = volume + (sampleIndex / mSamplesPerFrame) * volumeIncrement;
+        if (accumulate) {
+            destination[sampleIndex] += source[sampleIndex] * gain;
+        } else {
+            destination[sampleIndex] = source[sampleIndex] * gain;
+        }
     }
 }
 
 float *AAudioMixer::getOutputBuffer() {
+    if (mOutputEmpty) {
+        // no stream was mixed, play silence
+        memset(mOutputBuffer, 0, mBufferSizeInBytes);
+        mOutputEmpty = false;
+    }
     return mOutputBuffer;
 }
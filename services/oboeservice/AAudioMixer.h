@@ -29,6 +29,10 @@ public:
 
     void allocate(int32_t samplesPerFrame, int32_t framesPerBurst);
 
+    /**
+     * Start a new burst. The output buffer is only zeroed if no stream is mixed into it;
+     * the first stream mixed is written instead of accumulated.
+     */
     void clear();
 
     /**
@@ -39,15 +43,28 @@ public:
      */
     bool mix(android::FifoBuffer *fifo, float volume);
 
+    /**
+     * Mix from this FIFO, changing the volume linearly over the burst.
+     * @param fifo
+     * @param volumeFrom volume of the first frame of the burst
+     * @param volumeTo volume after the last frame of the burst
+     * @return true if underflowed
+     */
+    bool mix(android::FifoBuffer *fifo, float volumeFrom, float volumeTo);
+
     void mixPart(float *destination, float *source, int32_t numFrames, float volume);
 
     float *getOutputBuffer();
 
 private:
+    void mixPart(float *destination, const float *source, int32_t numFrames,
+                 float volume, float volumeIncrement, bool accumulate);
+
     float   *mOutputBuffer = nullptr;
     int32_t  mSamplesPerFrame = 0;
     int32_t  mFramesPerBurst = 0;
     int32_t  mBufferSizeInBytes = 0;
+    bool     mOutputEmpty = true; // no stream has been mixed since clear()
 };
 
 
@@ -21,6 +21,7 @@
 #include <assert.h>
 #include <map>
 #include <mutex>
+#include <unistd.h>
 #include <utils/Singleton.h>
 
 #include "AAudioEndpointManager.h"
@@ -44,6 +45,15 @@ using namespace aaudio;   // TODO just import names needed
 // This is the maximum size in frames. The effective size can be tuned smaller at runtime.
 #define DEFAULT_BUFFER_CAPACITY   (48 * 8)
 
+// How often to check whether the callback loop is done with a previous stream list.
+#define SNAPSHOT_POLL_MICROS      200
+
+AAudioServiceEndpoint::AAudioServiceEndpoint()
+        : mRunningSnapshot(new StreamList())
+        , mRunningSnapshotPointer(mRunningSnapshot.get())
+        , mReadSequence(0) {
+}
+
 // Set up an EXCLUSIVE MMAP stream that will be shared.
 aaudio_result_t AAudioServiceEndpoint::open(int32_t deviceId) {
     mStreamInternal = getStreamInternal();
@@ -78,9 +88,9 @@ aaudio_result_t AAudioServiceEndpoint::unregisterStream(AAudioServiceStreamShare
 }
 
 aaudio_result_t AAudioServiceEndpoint::startStream(AAudioServiceStreamShared *sharedStream) {
-    // TODO use real-time technique to avoid mutex, eg. atomic command FIFO
     std::lock_guard<std::mutex> lock(mLockStreams);
     mRunningStreams.push_back(sharedStream);
+    publishRunningStreams_l();
     if (mRunningStreams.size() == 1) {
         startSharingThread_l();
     }
@@ -94,6 +104,7 @@ aaudio_result_t AAudioServiceEndpoint::stopStream(AAudioServiceStreamShared *sha
         mRunningStreams.erase(
                 std::remove(mRunningStreams.begin(), mRunningStreams.end(), sharedStream),
                 mRunningStreams.end());
+        publishRunningStreams_l();
         numRunningStreams = mRunningStreams.size();
     }
     if (numRunningStreams == 0) {
@@ -133,8 +144,32 @@ void AAudioServiceEndpoint::disconnectRegisteredStreams() {
         sharedStream->onStop();
     }
     mRunningStreams.clear();
+    publishRunningStreams_l();
     for(AAudioServiceStreamShared *sharedStream : mRegisteredStreams) {
         sharedStream->onDisconnect();
     }
     mRegisteredStreams.clear();
 }
+
+const AAudioServiceEndpoint::StreamList &AAudioServiceEndpoint::beginReadRunningStreams() {
+    mReadSequence++; // the sequential consistency orders this before the load of the pointer
+    return *mRunningSnapshotPointer.load();
+}
+
+void AAudioServiceEndpoint::endReadRunningStreams() {
+    mReadSequence++;
+}
+
+void AAudioServiceEndpoint::publishRunningStreams_l() {
+    std::unique_ptr<const StreamList> previous = std::move(mRunningSnapshot);
+    mRunningSnapshot.reset(new StreamList(mRunningStreams));
+    mRunningSnapshotPointer.store(mRunningSnapshot.get());
+    // If the callback loop is not reading now, its next read will get the new snapshot.
+    // Otherwise wait for the end of the read, which may be using the previous snapshot.
+    const uint32_t sequence = mReadSequence.load();
+    if (sequence & 1) {
+        while (mReadSequence.load() == sequence) {
+            usleep(SNAPSHOT_POLL_MICROS);
+        }
+    }
+}
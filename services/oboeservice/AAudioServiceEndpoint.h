@@ -19,6 +19,7 @@
 
 #include <atomic>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -34,6 +35,7 @@ namespace aaudio {
 
 class AAudioServiceEndpoint {
 public:
+    AAudioServiceEndpoint();
     virtual ~AAudioServiceEndpoint() = default;
 
     virtual aaudio_result_t open(int32_t deviceId);
@@ -75,12 +77,38 @@ public:
     std::vector<AAudioServiceStreamShared *> mRegisteredStreams;
     std::vector<AAudioServiceStreamShared *> mRunningStreams;
 
+protected:
+    typedef std::vector<AAudioServiceStreamShared *> StreamList;
+
+    /**
+     * Get the running streams for one burst of the callback loop, without locking.
+     * Each call must be followed by a call to endReadRunningStreams().
+     * The streams in the list are not stopped before that.
+     *
+     * @return a snapshot of mRunningStreams
+     */
+    const StreamList &beginReadRunningStreams();
+
+    void endReadRunningStreams();
+
 private:
     aaudio_result_t startSharingThread_l();
     aaudio_result_t stopSharingThread();
 
+    /**
+     * Make a copy of mRunningStreams the new snapshot, then wait until the callback loop
+     * is done with the previous one.
+     */
+    void publishRunningStreams_l();
+
     AudioStreamInternal     *mStreamInternal = nullptr;
     int32_t                  mReferenceCount = 0;
+
+    // The snapshot of mRunningStreams read by the callback loop. The previous snapshot is
+    // only deleted when the loop cannot be using it any more, like in RCU.
+    std::unique_ptr<const StreamList> mRunningSnapshot;
+    std::atomic<const StreamList *>   mRunningSnapshotPointer;
+    std::atomic<uint32_t>             mReadSequence; // odd while the callback loop reads it
 };
 
 } /* namespace aaudio */
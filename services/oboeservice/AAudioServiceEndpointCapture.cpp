@@ -76,9 +76,9 @@ void *AAudioServiceEndpointCapture::callbackLoop() {
         }
 
         // Distribute data to each active stream.
-        { // use lock guard
-            std::lock_guard <std::mutex> lock(mLockStreams);
-            for (AAudioServiceStreamShared *sharedStream : mRunningStreams) {
+        {
+            const StreamList &runningStreams = beginReadRunningStreams();
+            for (AAudioServiceStreamShared *sharedStream : runningStreams) {
                 FifoBuffer *fifo = sharedStream->getDataFifoBuffer();
                 if (fifo->getFifoControllerBase()->getEmptyFramesAvailable() <
                     getFramesPerBurst()) {
@@ -88,6 +88,7 @@ void *AAudioServiceEndpointCapture::callbackLoop() {
                 }
                 sharedStream->markTransferTime(AudioClock::getNanoseconds());
             }
+            endReadRunningStreams();
         }
     }
 
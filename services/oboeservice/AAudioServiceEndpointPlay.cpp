@@ -39,6 +39,9 @@ using namespace aaudio;   // TODO just import names needed
 
 #define BURSTS_PER_BUFFER_DEFAULT   2
 
+// Below this, the synchronization with the workers costs more than the mixing.
+#define MIN_STREAMS_PER_MIXER_THREAD   8
+
 AAudioServiceEndpointPlay::AAudioServiceEndpointPlay(AAudioService &audioService)
         : mStreamInternalPlay(audioService, true) {
 }
@@ -60,10 +63,93 @@ aaudio_result_t AAudioServiceEndpointPlay::open(int32_t deviceId) {
         ALOGD("AAudioServiceEndpoint(): burstsPerBuffer = %d", burstsPerBuffer);
         int32_t desiredBufferSize = burstsPerBuffer * getStreamInternal()->getFramesPerBurst();
         getStreamInternal()->setBufferSize(desiredBufferSize);
+
+        int32_t mixerThreads = AAudioProperty_getMixerThreads();
+        ALOGD("AAudioServiceEndpoint(): mixerThreads = %d", mixerThreads);
+        mWorkers.clear();
+        for (int32_t i = 1; i < mixerThreads; i++) {
+            std::unique_ptr<MixerWorker> worker(new MixerWorker(*this, i));
+            worker->mMixer.allocate(getStreamInternal()->getSamplesPerFrame(),
+                                    getStreamInternal()->getFramesPerBurst());
+            mWorkers.push_back(std::move(worker));
+        }
     }
     return result;
 }
 
+int32_t AAudioServiceEndpointPlay::mixStreams(const StreamList &streams, AAudioMixer *mixer,
+                                              size_t first, size_t step) {
+    int32_t underflowCount = 0;
+    for (size_t i = first; i < streams.size(); i += step) {
+        AAudioServiceStreamShared *sharedStream = streams[i];
+        FifoBuffer *fifo = sharedStream->getDataFifoBuffer();
+        float volumeFrom;
+        float volumeTo;
+        sharedStream->getVolumeRamp().nextSegment(getFramesPerBurst(),
+                                                  &volumeFrom, &volumeTo);
+        bool underflowed = mixer->mix(fifo, volumeFrom, volumeTo);
+        underflowCount += underflowed ? 1 : 0;
+        // TODO log underflows in each stream
+        sharedStream->markTransferTime(AudioClock::getNanoseconds());
+    }
+    return underflowCount;
+}
+
+void AAudioServiceEndpointPlay::MixerWorker::run() {
+    uint64_t bursts = 0;
+    for (;;) {
+        const StreamList *streams;
+        size_t step;
+        {
+            std::unique_lock<std::mutex> lock(mEndpoint.mWorkerLock);
+            mEndpoint.mWorkerStart.wait(lock, [this, bursts] {
+                return mEndpoint.mWorkersExit || mEndpoint.mWorkerBursts != bursts;
+            });
+            if (mEndpoint.mWorkersExit) {
+                return;
+            }
+            bursts = mEndpoint.mWorkerBursts;
+            streams = mEndpoint.mWorkerStreams;
+            step = mEndpoint.mWorkerStep;
+        }
+
+        mMixer.clear();
+        mUnderflowCount = mEndpoint.mixStreams(*streams, &mMixer, mIndex, step);
+
+        std::lock_guard<std::mutex> lock(mEndpoint.mWorkerLock);
+        if (--mEndpoint.mWorkersPending == 0) {
+            mEndpoint.mWorkerDone.notify_one();
+        }
+    }
+}
+
+void AAudioServiceEndpointPlay::startWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mWorkerLock);
+        mWorkersExit = false;
+        mWorkerBursts = 0;
+    }
+    for (size_t i = 0; i < mWorkers.size(); i++) {
+        aaudio_result_t result = mWorkers[i]->mThread.start(mWorkers[i].get());
+        if (result != AAUDIO_OK) {
+            ALOGE("AAudioServiceEndpointPlay(): cannot start mixer thread, %d", result);
+            mWorkers.resize(i); // mix with the threads we have
+            break;
+        }
+    }
+}
+
+void AAudioServiceEndpointPlay::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mWorkerLock);
+        mWorkersExit = true;
+    }
+    mWorkerStart.notify_all();
+    for (std::unique_ptr<MixerWorker> &worker : mWorkers) {
+        worker->mThread.stop();
+    }
+}
+
 // Mix data from each application stream and write result to the shared MMAP stream.
 void *AAudioServiceEndpointPlay::callbackLoop() {
     ALOGD("AAudioServiceEndpointPlay(): callbackLoop() entering");
@@ -73,20 +159,40 @@ void *AAudioServiceEndpointPlay::callbackLoop() {
 
     int64_t timeoutNanos = getStreamInternal()->calculateReasonableTimeout();
 
+    startWorkers();
+    const size_t numMixers = mWorkers.size() + 1;
+
     // result might be a frame count
     while (mCallbackEnabled.load() && getStreamInternal()->isActive() && (result >= 0)) {
         // Mix data from each active stream.
         mMixer.clear();
-        { // use lock guard
-            std::lock_guard <std::mutex> lock(mLockStreams);
-            for (AAudioServiceStreamShared *sharedStream : mRunningStreams) {
-                FifoBuffer *fifo = sharedStream->getDataFifoBuffer();
-                float volume = 0.5; // TODO get from system
-                bool underflowed = mMixer.mix(fifo, volume);
-                underflowCount += underflowed ? 1 : 0;
-                // TODO log underflows in each stream
-                sharedStream->markTransferTime(AudioClock::getNanoseconds());
+        {
+            const StreamList &runningStreams = beginReadRunningStreams();
+            if (numMixers == 1
+                    || runningStreams.size() < numMixers * MIN_STREAMS_PER_MIXER_THREAD) {
+                underflowCount += mixStreams(runningStreams, &mMixer, 0, 1);
+            } else {
+                {
+                    std::lock_guard<std::mutex> lock(mWorkerLock);
+                    mWorkerStreams = &runningStreams;
+                    mWorkerStep = numMixers;
+                    mWorkersPending = mWorkers.size();
+                    mWorkerBursts++;
+                }
+                mWorkerStart.notify_all();
+                underflowCount += mixStreams(runningStreams, &mMixer, 0, numMixers);
+                {
+                    std::unique_lock<std::mutex> lock(mWorkerLock);
+                    mWorkerDone.wait(lock, [this] { return mWorkersPending == 0; });
+                }
+                // Sum the partial mixes.
+                for (std::unique_ptr<MixerWorker> &worker : mWorkers) {
+                    mMixer.mixPart(mMixer.getOutputBuffer(), worker->mMixer.getOutputBuffer(),
+                                   getFramesPerBurst(), 1.0f);
+                    underflowCount += worker->mUnderflowCount;
+                }
             }
+            endReadRunningStreams();
         }
 
         // Write mixer output to stream using a blocking write.
@@ -102,6 +208,8 @@ void *AAudioServiceEndpointPlay::callbackLoop() {
         }
     }
 
+    stopWorkers();
+
     result = getStreamInternal()->requestStop();
 
     ALOGD("AAudioServiceEndpointPlay(): callbackLoop() exiting, %d underflows", underflowCount);
@@ -18,7 +18,9 @@
 #define AAUDIO_SERVICE_ENDPOINT_PLAY_H
 
 #include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -29,6 +31,7 @@
 #include "AAudioServiceStreamMMAP.h"
 #include "AAudioMixer.h"
 #include "AAudioService.h"
+#include "AAudioThread.h"
 
 namespace aaudio {
 
@@ -46,9 +49,51 @@ public:
     void *callbackLoop() override;
 
 private:
+    /**
+     * Mixes every Nth running stream of a burst into its own mixer,
+     * when the streams are split between several threads. See AAUDIO_PROP_MIXER_THREADS.
+     */
+    class MixerWorker : public Runnable {
+    public:
+        MixerWorker(AAudioServiceEndpointPlay &endpoint, int32_t index)
+                : mEndpoint(endpoint)
+                , mIndex(index) {}
+
+        void run() override;
+
+        AAudioMixer   mMixer;
+        int32_t       mUnderflowCount = 0; // in the last burst
+        AAudioThread  mThread;
+
+    private:
+        AAudioServiceEndpointPlay &mEndpoint;
+        const int32_t              mIndex;
+    };
+
+    /**
+     * Mix streams[first], streams[first + step], ... into the mixer.
+     * @return number of streams that underflowed
+     */
+    int32_t mixStreams(const StreamList &streams, AAudioMixer *mixer,
+                       size_t first, size_t step);
+
+    // Called from the callback thread, so that the workers get its scheduling.
+    void startWorkers();
+    void stopWorkers();
+
     AudioStreamInternalPlay  mStreamInternalPlay; // for playing output of mixer
     bool                     mLatencyTuningEnabled = false; // TODO implement tuning
     AAudioMixer              mMixer;    //
+
+    std::vector<std::unique_ptr<MixerWorker>> mWorkers;
+    std::mutex               mWorkerLock;
+    std::condition_variable  mWorkerStart;  // a burst is ready, or the workers must exit
+    std::condition_variable  mWorkerDone;   // all workers are done with the burst
+    const StreamList        *mWorkerStreams = nullptr;  // streams of the current burst
+    size_t                   mWorkerStep = 1;
+    uint64_t                 mWorkerBursts = 0;  // number of bursts handed to the workers
+    int32_t                  mWorkersPending = 0;
+    bool                     mWorkersExit = false;
 };
 
 } /* namespace aaudio */
@@ -30,6 +30,9 @@
 using namespace android;  // TODO just import names needed
 using namespace aaudio;   // TODO just import names needed
 
+// The service stops queueing timestamps when the client is this far behind.
+#define MAX_PENDING_TIMESTAMPS   (QUEUE_UP_CAPACITY_COMMANDS / 4)
+
 /**
  * Base class for streams in the service.
  * @return
@@ -156,7 +159,21 @@ aaudio_result_t AAudioServiceStreamBase::writeUpMessageQueue(AAudioServiceMessag
     }
 }
 
+int32_t AAudioServiceStreamBase::getUpMessageQueueBacklog() {
+    std::lock_guard<std::mutex> lock(mLockUpMessageQueue);
+    if (mUpMessageQueue == nullptr) {
+        return 0;
+    }
+    return mUpMessageQueue->getFifoBuffer()->getFifoControllerBase()->getFullFramesAvailable();
+}
+
 aaudio_result_t AAudioServiceStreamBase::sendCurrentTimestamp() {
+    // A client that is this far behind only uses the latest of its pending timestamps.
+    // So do not queue more of them, and keep room for the events.
+    if (getUpMessageQueueBacklog() >= MAX_PENDING_TIMESTAMPS) {
+        return AAUDIO_OK;
+    }
+
     AAudioServiceMessage command;
     aaudio_result_t result = getFreeRunningPosition(&command.timestamp.position,
                                                     &command.timestamp.timestamp);
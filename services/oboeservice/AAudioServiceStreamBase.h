@@ -116,6 +116,9 @@ public:
 protected:
     aaudio_result_t writeUpMessageQueue(AAudioServiceMessage *command);
 
+    // Number of messages the client has not read yet.
+    int32_t getUpMessageQueueBacklog();
+
     aaudio_result_t sendCurrentTimestamp();
 
     virtual aaudio_result_t getFreeRunningPosition(int64_t *positionFrames, int64_t *timeNanos) = 0;
@@ -37,6 +37,9 @@ using namespace aaudio;
 #define MIN_BURSTS_PER_BUFFER   2
 #define MAX_BURSTS_PER_BUFFER   32
 
+#define MIXER_VOLUME            0.5f // TODO get from system
+#define VOLUME_RAMP_PER_SECOND  50   // 20 msec ramps
+
 AAudioServiceStreamShared::AAudioServiceStreamShared(AAudioService &audioService)
     : mAudioService(audioService)
     {
@@ -112,6 +115,10 @@ aaudio_result_t AAudioServiceStreamShared::open(const aaudio::AAudioStreamReques
     mAudioDataQueue = new SharedRingBuffer();
     mAudioDataQueue->allocate(calculateBytesPerFrame(), mCapacityInFrames);
 
+    // The first ramp starts at 0.0 so the stream fades in.
+    mVolumeRamp.setLengthInFrames(mSampleRate / VOLUME_RAMP_PER_SECOND);
+    mVolumeRamp.setTarget(MIXER_VOLUME);
+
     // Fill in configuration for client.
     configurationOutput.setSampleRate(mSampleRate);
     configurationOutput.setSamplesPerFrame(mSamplesPerFrame);
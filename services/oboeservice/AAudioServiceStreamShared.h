@@ -21,6 +21,7 @@
 #include "binding/AAudioServiceMessage.h"
 #include "binding/AAudioStreamRequest.h"
 #include "binding/AAudioStreamConfiguration.h"
+#include "utility/LinearRamp.h"
 
 #include "AAudioService.h"
 #include "AAudioServiceStreamBase.h"
@@ -82,6 +83,11 @@ public:
 
     android::FifoBuffer *getDataFifoBuffer() { return mAudioDataQueue->getFifoBuffer(); }
 
+    /**
+     * Volume at which the endpoint mixes this stream. Only used by the mixer thread.
+     */
+    LinearRamp &getVolumeRamp() { return mVolumeRamp; }
+
     /* Keep a record of when a buffer transfer completed.
      * This allows for a more accurate timing model.
      */
@@ -104,6 +110,7 @@ private:
 
     int64_t                  mMarkedPosition = 0;
     int64_t                  mMarkedTime = 0;
+    LinearRamp               mVolumeRamp;
 };
 
 } /* namespace aaudio */
@@ -23,6 +23,7 @@ LOCAL_C_INCLUDES := \
 
 LOCAL_SRC_FILES += \
     $(LIBAAUDIO_SRC_DIR)/utility/HandleTracker.cpp \
+    $(LIBAAUDIO_SRC_DIR)/utility/LinearRamp.cpp \
     SharedMemoryProxy.cpp \
     SharedRingBuffer.cpp \
     AAudioEndpointManager.cpp \
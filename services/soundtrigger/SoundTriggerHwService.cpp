@@ -237,9 +237,8 @@ sp<IMemory> SoundTriggerHwService::prepareRecognitionEvent_l(
     }
 
     size_t size = event->data_offset + event->data_size;
-    eventMemory = mMemoryDealer->allocate(size);
-    if (eventMemory == 0 || eventMemory->pointer() == NULL) {
-        eventMemory.clear();
+    eventMemory = allocateRecognitionEventMemory_l(size);
+    if (eventMemory == 0) {
         return eventMemory;
     }
     memcpy(eventMemory->pointer(), event, size);
@@ -247,6 +246,28 @@ sp<IMemory> SoundTriggerHwService::prepareRecognitionEvent_l(
     return eventMemory;
 }
 
+// Clients fetch the heap and offset of each new IMemory with a binder call
+// before they can read the event. Handing them the same memory again, once
+// no one holds on to it anymore, saves that round trip between the
+// recognition and the client starting the capture.
+sp<IMemory> SoundTriggerHwService::allocateRecognitionEventMemory_l(size_t size)
+{
+    if (mRecognitionEventMemory != 0
+            && mRecognitionEventMemory->getStrongCount() == 1
+            && mRecognitionEventMemory->size() >= size) {
+        return mRecognitionEventMemory;
+    }
+    mRecognitionEventMemory.clear();
+
+    sp<IMemory> eventMemory = mMemoryDealer->allocate(size);
+    if (eventMemory == 0 || eventMemory->pointer() == NULL) {
+        eventMemory.clear();
+        return eventMemory;
+    }
+    mRecognitionEventMemory = eventMemory;
+    return eventMemory;
+}
+
 void SoundTriggerHwService::sendRecognitionEvent(struct sound_trigger_recognition_event *event,
                                                  Module *module)
  {
@@ -217,6 +217,7 @@ public:
 
     static void recognitionCallback(struct sound_trigger_recognition_event *event, void *cookie);
            sp<IMemory> prepareRecognitionEvent_l(struct sound_trigger_recognition_event *event);
+           sp<IMemory> allocateRecognitionEventMemory_l(size_t size);
            void sendRecognitionEvent(struct sound_trigger_recognition_event *event, Module *module);
 
     static void soundModelCallback(struct sound_trigger_model_event *event, void *cookie);
@@ -240,6 +241,9 @@ private:
     DefaultKeyedVector< sound_trigger_module_handle_t, sp<Module> >     mModules;
     sp<CallbackThread>  mCallbackThread;
     sp<MemoryDealer>    mMemoryDealer;
+    // The memory of the last recognition event, reused for the next one once
+    // the clients have released it.
+    sp<IMemory>         mRecognitionEventMemory;
     bool                mCaptureState;
 };
 